@@ -0,0 +1,18 @@
+/* contrib/amcheck/amcheck--1.3--1.4.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "ALTER EXTENSION amcheck UPDATE TO '1.4'" to load this file. \quit
+
+--
+-- bt_index_check_blocks()
+--
+CREATE FUNCTION bt_index_check_blocks(index regclass,
+									  startblock bigint default null,
+									  endblock bigint default null)
+RETURNS VOID
+AS 'MODULE_PATHNAME', 'bt_index_check_blocks'
+LANGUAGE C PARALLEL RESTRICTED;
+
+-- Don't want this to be available to public
+REVOKE ALL ON FUNCTION bt_index_check_blocks(regclass, bigint, bigint)
+FROM PUBLIC;
@@ -81,6 +81,9 @@ SELECT bt_index_parent_check('bttest_multi_idx', true, true);
 TRUNCATE bttest_multi;
 INSERT INTO bttest_multi SELECT i, i%2  FROM generate_series(1, 100000) as i;
 SELECT bt_index_parent_check('bttest_multi_idx', true, true);
+-- check the same index in separate block ranges
+SELECT bt_index_check_blocks('bttest_multi_idx', 0, 9);
+SELECT bt_index_check_blocks('bttest_multi_idx', 10);
 
 --
 -- Test for multilevel page deletion/downlink present checks, and rootdescend
@@ -93,6 +96,7 @@ ALTER TABLE delete_test_table ADD PRIMARY KEY (a,b,c,d);
 DELETE FROM delete_test_table WHERE a < 79990;
 VACUUM delete_test_table;
 SELECT bt_index_parent_check('delete_test_table_pkey', true);
+SELECT bt_index_check_blocks('delete_test_table_pkey');
 
 --
 -- BUG #15597: must not assume consistent input toasting state when forming
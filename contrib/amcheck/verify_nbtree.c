@@ -135,19 +135,26 @@ typedef struct BtreeLevel
 
 PG_FUNCTION_INFO_V1(bt_index_check);
 PG_FUNCTION_INFO_V1(bt_index_parent_check);
+PG_FUNCTION_INFO_V1(bt_index_check_blocks);
 
 static void bt_index_check_internal(Oid indrelid, bool parentcheck,
-									bool heapallindexed, bool rootdescend);
+									bool heapallindexed, bool rootdescend,
+									bool blockrange, int64 startblock,
+									int64 endblock);
 static inline void btree_index_checkable(Relation rel);
 static inline bool btree_index_mainfork_expected(Relation rel);
 static void bt_check_every_level(Relation rel, Relation heaprel,
 								 bool heapkeyspace, bool readonly, bool heapallindexed,
 								 bool rootdescend);
+static void bt_check_block_range(Relation rel, bool heapkeyspace,
+								 int64 startblock, int64 endblock);
 static BtreeLevel bt_check_level_from_leftmost(BtreeCheckState *state,
 											   BtreeLevel level);
 static void bt_recheck_sibling_links(BtreeCheckState *state,
 									 BlockNumber btpo_prev_from_target,
 									 BlockNumber leftcurrent);
+static void bt_check_left_sibling(BtreeCheckState *state,
+								  BlockNumber leftblock, uint32 level);
 static void bt_target_page_check(BtreeCheckState *state);
 static BTScanInsert bt_right_page_check_scankey(BtreeCheckState *state);
 static void bt_child_check(BtreeCheckState *state, BTScanInsert targetkey,
@@ -206,7 +213,8 @@ bt_index_check(PG_FUNCTION_ARGS)
 	if (PG_NARGS() == 2)
 		heapallindexed = PG_GETARG_BOOL(1);
 
-	bt_index_check_internal(indrelid, false, heapallindexed, false);
+	bt_index_check_internal(indrelid, false, heapallindexed, false,
+							false, -1, -1);
 
 	PG_RETURN_VOID();
 }
@@ -232,17 +240,59 @@ bt_index_parent_check(PG_FUNCTION_ARGS)
 	if (PG_NARGS() == 3)
 		rootdescend = PG_GETARG_BOOL(2);
 
-	bt_index_check_internal(indrelid, true, heapallindexed, rootdescend);
+	bt_index_check_internal(indrelid, true, heapallindexed, rootdescend,
+							false, -1, -1);
 
 	PG_RETURN_VOID();
 }
 
 /*
- * Helper for bt_index_[parent_]check, coordinating the bulk of the work.
+ * bt_index_check_blocks(index regclass, startblock bigint, endblock bigint)
+ *
+ * Verify integrity of the B-Tree pages stored in a range of physical blocks.
+ *
+ * Acquires AccessShareLock on heap & index relations.  Performs the same
+ * checks as bt_index_check() on every page in the range, but visits pages in
+ * physical rather than logical order, so that a large index can be verified
+ * by several concurrent callers that each take a different range.  Because
+ * no single caller walks a whole level, the checks that depend on following
+ * a level from its leftmost page are replaced by a check of each page's left
+ * sibling.  A NULL startblock or endblock means the first or last block of
+ * the index, respectively.
+ */
+Datum
+bt_index_check_blocks(PG_FUNCTION_ARGS)
+{
+	Oid			indrelid;
+	int64		startblock = -1;
+	int64		endblock = -1;
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("index cannot be null")));
+	indrelid = PG_GETARG_OID(0);
+	if (!PG_ARGISNULL(1))
+		startblock = PG_GETARG_INT64(1);
+	if (!PG_ARGISNULL(2))
+		endblock = PG_GETARG_INT64(2);
+
+	bt_index_check_internal(indrelid, false, false, false,
+							true, startblock, endblock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Helper for bt_index_[parent_]check and bt_index_check_blocks, coordinating
+ * the bulk of the work.  When blockrange is true, only the pages between
+ * startblock and endblock (-1 meaning the start or end of the index) are
+ * checked.
  */
 static void
 bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed,
-						bool rootdescend)
+						bool rootdescend, bool blockrange, int64 startblock,
+						int64 endblock)
 {
 	Oid			heapid;
 	Relation	indrel;
@@ -321,8 +371,11 @@ bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed,
 							RelationGetRelationName(indrel))));
 
 		/* Check index, possibly against table it is an index on */
-		bt_check_every_level(indrel, heaprel, heapkeyspace, parentcheck,
-							 heapallindexed, rootdescend);
+		if (blockrange)
+			bt_check_block_range(indrel, heapkeyspace, startblock, endblock);
+		else
+			bt_check_every_level(indrel, heaprel, heapkeyspace, parentcheck,
+								 heapallindexed, rootdescend);
 	}
 
 	/*
@@ -635,6 +688,134 @@ bt_check_every_level(Relation rel, Relation heaprel, bool heapkeyspace,
 	MemoryContextDelete(state->targetcontext);
 }
 
+/*
+ * Entry point for bt_index_check_blocks().  Verifies every page stored
+ * between startblock and endblock in physical order, performing the checks
+ * bt_check_every_level() performs without a ShareLock.
+ *
+ * A plain relation-order scan reads the index sequentially, and can be split
+ * among concurrent callers, but unlike a logical scan it does not establish
+ * that every page is reachable from the root, or that each level is a single
+ * chain of siblings.  The sibling checks are instead performed from each page
+ * towards its left sibling.  New and deleted pages are skipped, since they are
+ * expected to be found among the other pages of an index.
+ */
+static void
+bt_check_block_range(Relation rel, bool heapkeyspace, int64 startblock,
+					 int64 endblock)
+{
+	BtreeCheckState *state;
+	MemoryContext oldcontext;
+	BlockNumber nblocks;
+	BlockNumber first_block;
+	BlockNumber last_block;
+	BlockNumber blkno;
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+
+	/* Validate block numbers, or handle -1 for the start or end */
+	if (startblock < 0)
+		first_block = 0;
+	else if (startblock >= nblocks)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("starting block number must be between 0 and %u",
+						nblocks - 1)));
+	else
+		first_block = (BlockNumber) startblock;
+	if (endblock < 0)
+		last_block = nblocks - 1;
+	else if (endblock >= nblocks)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("ending block number must be between 0 and %u",
+						nblocks - 1)));
+	else
+		last_block = (BlockNumber) endblock;
+
+	elog(DEBUG1, "verifying blocks %u to %u of index \"%s\"",
+		 first_block, last_block, RelationGetRelationName(rel));
+
+	/*
+	 * Initialize state for entire verification operation
+	 */
+	state = palloc0(sizeof(BtreeCheckState));
+	state->rel = rel;
+	state->heaprel = NULL;
+	state->heapkeyspace = heapkeyspace;
+	state->readonly = false;
+	state->heapallindexed = false;
+	state->rootdescend = false;
+	state->targetcontext = AllocSetContextCreate(CurrentMemoryContext,
+												 "amcheck context",
+												 ALLOCSET_DEFAULT_SIZES);
+	state->checkstrategy = GetAccessStrategy(BAS_BULKREAD);
+
+	/* The metapage is always checked, the caller's range notwithstanding */
+	pfree(palloc_btree_page(state, BTREE_METAPAGE));
+
+	oldcontext = MemoryContextSwitchTo(state->targetcontext);
+
+	for (blkno = Max(first_block, BTREE_METAPAGE + 1); blkno <= last_block;
+		 blkno++)
+	{
+		Buffer		buffer;
+		bool		isnew;
+		BTPageOpaque opaque;
+
+		/* Don't rely on CHECK_FOR_INTERRUPTS() calls at lower level */
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * An all-zeroes page is left behind by a crash after the relation
+		 * was extended, and is recycled by VACUUM.  palloc_btree_page()
+		 * would reject it, so look before copying the page.
+		 */
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									state->checkstrategy);
+		LockBuffer(buffer, BT_READ);
+		isnew = PageIsNew(BufferGetPage(buffer));
+		UnlockReleaseBuffer(buffer);
+		if (isnew)
+			continue;
+
+		/* Initialize state for this iteration */
+		state->targetblock = blkno;
+		state->target = palloc_btree_page(state, blkno);
+		state->targetlsn = PageGetLSN(state->target);
+
+		opaque = (BTPageOpaque) PageGetSpecialPointer(state->target);
+
+		if (!P_IGNORE(opaque))
+		{
+			/* Sibling links should be in mutual agreement */
+			if (!P_LEFTMOST(opaque))
+			{
+				if (opaque->btpo_prev == blkno)
+					ereport(ERROR,
+							(errcode(ERRCODE_INDEX_CORRUPTED),
+							 errmsg("circular link chain found in block %u of index \"%s\"",
+									blkno, RelationGetRelationName(rel))));
+				bt_check_left_sibling(state, opaque->btpo_prev,
+									  opaque->btpo_level);
+			}
+
+			/* Verify invariants for page */
+			bt_target_page_check(state);
+		}
+
+		/* Free page and associated memory for this iteration */
+		MemoryContextReset(state->targetcontext);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Be tidy: */
+	MemoryContextDelete(state->targetcontext);
+	FreeAccessStrategy(state->checkstrategy);
+	pfree(state);
+}
+
 /*
  * Given a left-most block at some level, move right, verifying each page
  * individually (with more verification across pages for "readonly"
@@ -1006,6 +1187,89 @@ bt_recheck_sibling_links(BtreeCheckState *state,
 								btpo_prev_from_target)));
 }
 
+/*
+ * Raise an error when the left sibling of the current target page, as given
+ * by the target's left link, does not point back to the target through its
+ * right link, or is not on the same level.  Used by bt_check_block_range(),
+ * which reaches the target page without following any sibling link.
+ *
+ * The target's copy of its left link may be stale by the time the left
+ * sibling is read, because of a concurrent page split of the left sibling or
+ * deletion of the target.  When the links disagree, we therefore lock the left
+ * sibling and then the target, in the usual left-to-right order, and compare
+ * the links again while both pages are locked.
+ */
+static void
+bt_check_left_sibling(BtreeCheckState *state, BlockNumber leftblock,
+					  uint32 level)
+{
+	Buffer		lbuf;
+	Buffer		tbuf;
+	Page		page;
+	BTPageOpaque lopaque;
+	BTPageOpaque topaque;
+	BlockNumber rightlink;
+	uint32		leftlevel;
+	bool		agree;
+
+	lbuf = ReadBufferExtended(state->rel, MAIN_FORKNUM, leftblock,
+							  RBM_NORMAL, state->checkstrategy);
+	LockBuffer(lbuf, BT_READ);
+	_bt_checkpage(state->rel, lbuf);
+	page = BufferGetPage(lbuf);
+	lopaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	if (P_ISDELETED(lopaque))
+	{
+		/*
+		 * Cannot reason about concurrently deleted page -- the left link in
+		 * the target is expected to point to some other page by now.
+		 */
+		UnlockReleaseBuffer(lbuf);
+		return;
+	}
+
+	rightlink = lopaque->btpo_next;
+	leftlevel = lopaque->btpo_level;
+	agree = (rightlink == state->targetblock);
+
+	if (!agree && rightlink != leftblock)
+	{
+		tbuf = ReadBufferExtended(state->rel, MAIN_FORKNUM,
+								  state->targetblock, RBM_NORMAL,
+								  state->checkstrategy);
+		LockBuffer(tbuf, BT_READ);
+		_bt_checkpage(state->rel, tbuf);
+		page = BufferGetPage(tbuf);
+		topaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+		/*
+		 * If the target was deleted, or no longer has leftblock as its left
+		 * sibling, the disagreement was caused by a concurrent change.
+		 */
+		if (P_IGNORE(topaque) || topaque->btpo_prev != leftblock)
+			agree = true;
+		UnlockReleaseBuffer(tbuf);
+	}
+	UnlockReleaseBuffer(lbuf);
+
+	if (!agree)
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg("left link/right link pair in index \"%s\" not in agreement",
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Block=%u left block=%u right link from left block=%u.",
+									state->targetblock, leftblock, rightlink)));
+
+	if (leftlevel != level)
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg("left sibling of block in index \"%s\" is on a different level",
+						RelationGetRelationName(state->rel)),
+				 errdetail_internal("Block=%u level=%u left block=%u left block level=%u.",
+									state->targetblock, level, leftblock,
+									leftlevel)));
+}
+
 /*
  * Function performs the following checks on target page, or pages ancillary to
  * target page:
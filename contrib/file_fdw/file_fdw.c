@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -27,12 +28,17 @@
 #include "commands/vacuum.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
 #include "utils/acl.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -75,6 +81,9 @@ static const struct FileFdwOption valid_options[] = {
 	{"force_not_null", AttributeRelationId},
 	{"force_null", AttributeRelationId},
 
+	/* Planner options */
+	{"parallel", ForeignTableRelationId},
+
 	/*
 	 * force_quote is not supported by file_fdw because it's for COPY TO.
 	 */
@@ -106,8 +115,49 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyFromState cstate;		/* COPY execution state */
+
+	/* These are used only for parallel scans */
+	bool		parallel;		/* is the plan parallel-aware? */
+	bool		text_mode;		/* can a backslash escape a newline? */
+	List	   *chunk_options;	/* options, without header */
+	struct FileFdwParallelState *pstate;	/* shared state, or NULL */
+	int			fd;				/* file to read chunks from, or -1 */
+	off_t		read_pos;		/* next byte of current chunk to return */
+	off_t		read_end;		/* end of current chunk, or -1 for EOF */
 } FileFdwExecutionState;
 
+/*
+ * Shared state of a parallel scan, in dynamic shared memory.
+ *
+ * The file is divided into chunks of chunk_size bytes, which the participants
+ * claim one at a time.  Each line belongs to the chunk in which it begins, so
+ * a participant skips the partial line at the start of its chunk and reads on
+ * past the end of the chunk to finish the last line.  In text format, a
+ * newline preceded by an odd number of backslashes doesn't end a line.  In
+ * CSV format, a quoted value may contain a newline, which we can't detect
+ * without parsing the file from the start, so parallel scans of CSV files
+ * must be enabled explicitly with the "parallel" option.
+ */
+typedef struct FileFdwParallelState
+{
+	off_t		file_size;		/* size of the file when the scan started */
+	off_t		chunk_size;		/* bytes per chunk */
+	pg_atomic_uint64 next_chunk;	/* next chunk to be claimed */
+} FileFdwParallelState;
+
+/* Aim for this many chunks per participant, to even out the load */
+#define FILE_FDW_CHUNKS_PER_PARTICIPANT	4
+
+/* But don't make chunks larger than this */
+#define FILE_FDW_MAX_CHUNK_SIZE		((off_t) 64 * 1024 * 1024)
+
+/*
+ * Scan whose chunk is being read by file_read_chunk().  The COPY data source
+ * callback has no argument, so fileIterateForeignScan() sets this before
+ * each call to NextCopyFrom().
+ */
+static FileFdwExecutionState *reading_festate = NULL;
+
 /*
  * SQL functions
  */
@@ -140,6 +190,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -157,7 +218,15 @@ static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 						  FileFdwPlanState *fdw_private);
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 						   FileFdwPlanState *fdw_private,
+						   double parallel_divisor,
 						   Cost *startup_cost, Cost *total_cost);
+static bool file_can_split(Oid foreigntableid, FileFdwPlanState *fdw_private);
+static double file_parallel_divisor(int parallel_workers);
+static bool file_begin_next_chunk(ForeignScanState *node,
+								  FileFdwExecutionState *festate);
+static off_t file_find_line_end(FileFdwExecutionState *festate, off_t from);
+static bool file_newline_escaped(FileFdwExecutionState *festate, off_t eol);
+static int	file_read_chunk(void *outbuf, int minread, int maxread);
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
@@ -182,6 +251,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -200,6 +273,7 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 	char	   *filename = NULL;
 	DefElem    *force_not_null = NULL;
 	DefElem    *force_null = NULL;
+	DefElem    *parallel = NULL;
 	List	   *other_options = NIL;
 	ListCell   *cell;
 
@@ -309,6 +383,16 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 			force_null = def;
 			(void) defGetBoolean(def);
 		}
+		/* parallel is only used by the planner; don't pass it to COPY */
+		else if (strcmp(def->defname, "parallel") == 0)
+		{
+			if (parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			parallel = def;
+			(void) defGetBoolean(def);
+		}
 		else
 			other_options = lappend(other_options, def);
 	}
@@ -413,6 +497,15 @@ fileGetOptions(Oid foreigntableid,
 	if (*filename == NULL)
 		elog(ERROR, "either filename or program is required for file_fdw foreign tables");
 
+	/* Likewise remove the parallel option, which is for file_can_split() */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel") == 0)
+			options = foreach_delete_current(options, lc);
+	}
+
 	*other_options = options;
 }
 
@@ -526,7 +619,8 @@ fileGetForeignRelSize(PlannerInfo *root,
  *
  *		Currently we don't support any push-down feature, so there is only one
  *		possible access path, which simply returns all records in the order in
- *		the data file.
+ *		the data file, plus a partial path for parallel scans if the file can
+ *		be split at line boundaries.
  */
 static void
 fileGetForeignPaths(PlannerInfo *root,
@@ -547,7 +641,7 @@ fileGetForeignPaths(PlannerInfo *root,
 										  (Node *) columns, -1));
 
 	/* Estimate costs */
-	estimate_costs(root, baserel, fdw_private,
+	estimate_costs(root, baserel, fdw_private, 1.0,
 				   &startup_cost, &total_cost);
 
 	/*
@@ -570,6 +664,43 @@ fileGetForeignPaths(PlannerInfo *root,
 									 NULL,	/* no extra plan */
 									 coptions));
 
+	/*
+	 * Add a partial path if a parallel scan is possible.  Like a parallel
+	 * heap scan, it divides the CPU cost but not the I/O cost among the
+	 * participants.
+	 */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL &&
+		file_can_split(foreigntableid, fdw_private))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel, fdw_private->pages,
+												   -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			double		parallel_divisor = file_parallel_divisor(parallel_workers);
+			ForeignPath *path;
+
+			estimate_costs(root, baserel, fdw_private, parallel_divisor,
+						   &startup_cost, &total_cost);
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(baserel->rows /
+														 parallel_divisor),
+										   startup_cost,
+										   total_cost,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+										   coptions);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+
 	/*
 	 * If data file was sorted, and we knew it somehow, we could insert
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
@@ -655,8 +786,9 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	char	   *filename;
 	bool		is_program;
 	List	   *options;
-	CopyFromState cstate;
+	CopyFromState cstate = NULL;
 	FileFdwExecutionState *festate;
+	ListCell   *lc;
 
 	/*
 	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
@@ -673,26 +805,44 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 
 	/*
 	 * Create CopyState from FDW options.  We always acquire all columns, so
-	 * as to match the expected ScanTupleSlot signature.
+	 * as to match the expected ScanTupleSlot signature.  A parallel scan
+	 * creates one for each chunk instead, once it knows whether it has
+	 * shared state.
 	 */
-	cstate = BeginCopyFrom(NULL,
-						   node->ss.ss_currentRelation,
-						   NULL,
-						   filename,
-						   is_program,
-						   NULL,
-						   NIL,
-						   options);
+	if (!plan->scan.plan.parallel_aware)
+		cstate = BeginCopyFrom(NULL,
+							   node->ss.ss_currentRelation,
+							   NULL,
+							   filename,
+							   is_program,
+							   NULL,
+							   NIL,
+							   options);
 
 	/*
 	 * Save state in node->fdw_state.  We must save enough information to call
 	 * BeginCopyFrom() again.
 	 */
-	festate = (FileFdwExecutionState *) palloc(sizeof(FileFdwExecutionState));
+	festate = (FileFdwExecutionState *) palloc0(sizeof(FileFdwExecutionState));
 	festate->filename = filename;
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
+	festate->parallel = plan->scan.plan.parallel_aware;
+	festate->text_mode = true;
+	festate->fd = -1;
+
+	/* Only the chunk at the start of the file has a header line */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "header") == 0)
+			continue;
+		if (strcmp(def->defname, "format") == 0)
+			festate->text_mode = (strcmp(defGetString(def), "text") == 0);
+		festate->chunk_options = lappend(festate->chunk_options, def);
+	}
 
 	node->fdw_state = (void *) festate;
 }
@@ -710,29 +860,51 @@ fileIterateForeignScan(ForeignScanState *node)
 	bool		found;
 	ErrorContextCallback errcallback;
 
-	/* Set up callback to identify error line number. */
-	errcallback.callback = CopyFromErrorCallback;
-	errcallback.arg = (void *) festate->cstate;
-	errcallback.previous = error_context_stack;
-	error_context_stack = &errcallback;
-
 	/*
 	 * The protocol for loading a virtual tuple into a slot is first
 	 * ExecClearTuple, then fill the values/isnull arrays, then
 	 * ExecStoreVirtualTuple.  If we don't find another row in the file, we
 	 * just skip the last step, leaving the slot empty as required.
-	 *
-	 * We can pass ExprContext = NULL because we read all columns from the
-	 * file, so no need to evaluate default expressions.
 	 */
 	ExecClearTuple(slot);
-	found = NextCopyFrom(festate->cstate, NULL,
-						 slot->tts_values, slot->tts_isnull);
-	if (found)
-		ExecStoreVirtualTuple(slot);
 
-	/* Remove error callback. */
-	error_context_stack = errcallback.previous;
+	for (;;)
+	{
+		/* In a parallel scan, claim a chunk if we have none */
+		if (festate->cstate == NULL &&
+			!file_begin_next_chunk(node, festate))
+			break;
+
+		/* Set up callback to identify error line number. */
+		errcallback.callback = CopyFromErrorCallback;
+		errcallback.arg = (void *) festate->cstate;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		/*
+		 * We can pass ExprContext = NULL because we read all columns from the
+		 * file, so no need to evaluate default expressions.
+		 */
+		reading_festate = festate;
+		found = NextCopyFrom(festate->cstate, NULL,
+							 slot->tts_values, slot->tts_isnull);
+
+		/* Remove error callback. */
+		error_context_stack = errcallback.previous;
+
+		if (found)
+		{
+			ExecStoreVirtualTuple(slot);
+			break;
+		}
+
+		/* Unless we're reading chunks, we've reached the end of the file */
+		if (festate->pstate == NULL)
+			break;
+
+		EndCopyFrom(festate->cstate);
+		festate->cstate = NULL;
+	}
 
 	return slot;
 }
@@ -746,7 +918,13 @@ fileReScanForeignScan(ForeignScanState *node)
 {
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
-	EndCopyFrom(festate->cstate);
+	if (festate->cstate)
+		EndCopyFrom(festate->cstate);
+	festate->cstate = NULL;
+
+	/* A parallel scan begins again at its first chunk */
+	if (festate->parallel)
+		return;
 
 	festate->cstate = BeginCopyFrom(NULL,
 									node->ss.ss_currentRelation,
@@ -768,8 +946,13 @@ fileEndForeignScan(ForeignScanState *node)
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
 	/* if festate is NULL, we are in EXPLAIN; nothing to do */
-	if (festate)
+	if (festate == NULL)
+		return;
+
+	if (festate->cstate)
 		EndCopyFrom(festate->cstate);
+	if (festate->fd >= 0)
+		CloseTransientFile(festate->fd);
 }
 
 /*
@@ -834,6 +1017,72 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Estimate the size of a parallel scan's shared state
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up a parallel scan's shared state and divide the file into chunks
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+	struct stat stat_buf;
+	off_t		chunk_size;
+
+	if (stat(festate->filename, &stat_buf) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						festate->filename)));
+
+	chunk_size = stat_buf.st_size /
+		(FILE_FDW_CHUNKS_PER_PARTICIPANT * (pcxt->nworkers + 1));
+	chunk_size = Min(chunk_size, FILE_FDW_MAX_CHUNK_SIZE);
+
+	pstate->file_size = stat_buf.st_size;
+	pstate->chunk_size = Max(chunk_size, 1);
+	pg_atomic_init_u64(&pstate->next_chunk, 0);
+
+	festate->pstate = pstate;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset a parallel scan's shared state for a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+
+	pg_atomic_write_u64(&pstate->next_chunk, 0);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the scan's shared state
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelState *) coordinate;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1046,11 +1295,15 @@ estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 /*
  * Estimate costs of scanning a foreign table.
  *
+ * For a partial path, parallel_divisor is the share of the tuples each
+ * participant processes; it is 1.0 otherwise.
+ *
  * Results are returned in *startup_cost and *total_cost.
  */
 static void
 estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 			   FileFdwPlanState *fdw_private,
+			   double parallel_divisor,
 			   Cost *startup_cost, Cost *total_cost)
 {
 	BlockNumber pages = fdw_private->pages;
@@ -1066,17 +1319,281 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 	 *
 	 * In the case of a program source, this calculation is even more divorced
 	 * from reality, but we have no good alternative; and it's not clear that
-	 * the numbers we produce here matter much anyway, since there's only one
-	 * access path for the rel.
+	 * the numbers we produce here matter much anyway, since programs can't
+	 * be scanned in parallel and so there's only one access path for the
+	 * rel.
 	 */
 	run_cost += seq_page_cost * pages;
 
 	*startup_cost = baserel->baserestrictcost.startup;
 	cpu_per_tuple = cpu_tuple_cost * 10 + baserel->baserestrictcost.per_tuple;
-	run_cost += cpu_per_tuple * ntuples;
+	run_cost += cpu_per_tuple * ntuples / parallel_divisor;
 	*total_cost = *startup_cost + run_cost;
 }
 
+/*
+ * Check whether a parallel scan may split the foreign table's file at line
+ * boundaries; see FileFdwParallelState.
+ *
+ * That is never possible for programs and binary format.  Text format files
+ * are split unless the "parallel" option is false, or the file's encoding
+ * can have a backslash as the second byte of a character, which would make
+ * us miscount backslash escapes.  CSV files are split only if the "parallel"
+ * option is true.
+ */
+static bool
+file_can_split(Oid foreigntableid, FileFdwPlanState *fdw_private)
+{
+	ForeignTable *table;
+	bool		text_mode = true;
+	bool		parallel = true;
+	bool		parallel_set = false;
+	int			encoding = pg_get_client_encoding();
+	ListCell   *lc;
+
+	if (fdw_private->is_program)
+		return false;
+
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0)
+		{
+			char	   *format = defGetString(def);
+
+			if (strcmp(format, "binary") == 0)
+				return false;
+			text_mode = (strcmp(format, "text") == 0);
+		}
+		else if (strcmp(def->defname, "encoding") == 0)
+			encoding = pg_char_to_encoding(defGetString(def));
+	}
+
+	/* fileGetOptions() removed the parallel option from the merged list */
+	table = GetForeignTable(foreigntableid);
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel") == 0)
+		{
+			parallel = defGetBoolean(def);
+			parallel_set = true;
+		}
+	}
+
+	if (text_mode)
+		return parallel && PG_VALID_BE_ENCODING(encoding);
+	else
+		return parallel && parallel_set;
+}
+
+/*
+ * Estimate the share of the tuples that each participant of a parallel scan
+ * processes.  This is the same estimate as get_parallel_divisor() in
+ * costsize.c makes: the leader helps less the more workers there are.
+ */
+static double
+file_parallel_divisor(int parallel_workers)
+{
+	double		parallel_divisor = parallel_workers;
+
+	if (parallel_leader_participation)
+	{
+		double		leader_contribution;
+
+		leader_contribution = 1.0 - (0.3 * parallel_workers);
+		if (leader_contribution > 0)
+			parallel_divisor += leader_contribution;
+	}
+
+	return parallel_divisor;
+}
+
+/*
+ * Claim the next chunk of a parallel scan that contains the beginning of at
+ * least one line, and create a CopyState to read its lines.  Returns false
+ * when no chunks are left.
+ *
+ * If the plan is parallel-aware but is run without shared state, for
+ * example because no DSM segment could be set up, just read the whole file.
+ */
+static bool
+file_begin_next_chunk(ForeignScanState *node, FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	List	   *options;
+
+	if (pstate == NULL)
+	{
+		festate->cstate = BeginCopyFrom(NULL,
+										node->ss.ss_currentRelation,
+										NULL,
+										festate->filename,
+										festate->is_program,
+										NULL,
+										NIL,
+										festate->options);
+		return true;
+	}
+
+	if (festate->fd < 0)
+	{
+		festate->fd = OpenTransientFile(festate->filename, O_RDONLY | PG_BINARY);
+		if (festate->fd < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							festate->filename)));
+	}
+
+	for (;;)
+	{
+		uint64		chunk = pg_atomic_fetch_add_u64(&pstate->next_chunk, 1);
+		off_t		start;
+		off_t		end;
+
+		if (chunk >= (uint64) (pstate->file_size / pstate->chunk_size + 1))
+			return false;
+		start = (off_t) chunk * pstate->chunk_size;
+		if (start >= pstate->file_size)
+			return false;
+		end = Min(start + pstate->chunk_size, pstate->file_size);
+
+		/* Skip the partial line, which belongs to the previous chunk */
+		if (start > 0)
+		{
+			start = file_find_line_end(festate, start - 1);
+			if (start < 0 || start >= end)
+				continue;
+		}
+
+		/* Read on to the end of the line containing the chunk's last byte */
+		festate->read_pos = start;
+		festate->read_end = file_find_line_end(festate, end - 1);
+		break;
+	}
+
+	options = (festate->read_pos == 0) ? festate->options : festate->chunk_options;
+	reading_festate = festate;
+	festate->cstate = BeginCopyFrom(NULL,
+									node->ss.ss_currentRelation,
+									NULL,
+									NULL,
+									false,
+									file_read_chunk,
+									NIL,
+									options);
+	return true;
+}
+
+/*
+ * Return the offset just past the first newline at or after "from" that ends
+ * a line, or -1 if the file ends first.
+ */
+static off_t
+file_find_line_end(FileFdwExecutionState *festate, off_t from)
+{
+	char		buf[BLCKSZ];
+	off_t		pos = from;
+
+	for (;;)
+	{
+		ssize_t		nread;
+		char	   *start = buf;
+		char	   *eol;
+
+		nread = pg_pread(festate->fd, buf, sizeof(buf), pos);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+		if (nread == 0)
+			return -1;
+
+		while ((eol = memchr(start, '\n', buf + nread - start)) != NULL)
+		{
+			if (!festate->text_mode ||
+				(eol > buf && eol[-1] != '\\') ||
+				!file_newline_escaped(festate, pos + (eol - buf)))
+				return pos + (eol - buf) + 1;
+			start = eol + 1;
+		}
+
+		pos += nread;
+	}
+}
+
+/*
+ * Check whether the newline at offset eol is escaped by a backslash, which
+ * is the case if it follows an odd number of backslashes.
+ */
+static bool
+file_newline_escaped(FileFdwExecutionState *festate, off_t eol)
+{
+	char		buf[64];
+	off_t		pos = eol;
+	int			nbackslashes = 0;
+
+	while (pos > 0)
+	{
+		int			len = (int) Min(pos, (off_t) sizeof(buf));
+		int			i;
+
+		if (pg_pread(festate->fd, buf, len, pos - len) != len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+
+		for (i = len - 1; i >= 0 && buf[i] == '\\'; i--)
+			nbackslashes++;
+		if (i >= 0)
+			break;
+		pos -= len;
+	}
+
+	return (nbackslashes % 2) != 0;
+}
+
+/*
+ * COPY data source callback for parallel scans: return the bytes of the
+ * current chunk of reading_festate.
+ */
+static int
+file_read_chunk(void *outbuf, int minread, int maxread)
+{
+	FileFdwExecutionState *festate = reading_festate;
+	int			nread = 0;
+
+	Assert(festate != NULL && festate->fd >= 0);
+
+	if (festate->read_end >= 0)
+		maxread = (int) Min((off_t) maxread,
+							festate->read_end - festate->read_pos);
+
+	while (nread < minread && nread < maxread)
+	{
+		ssize_t		n;
+
+		n = pg_pread(festate->fd, (char *) outbuf + nread, maxread - nread,
+					 festate->read_pos);
+		if (n < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+		if (n == 0)
+			break;
+		nread += n;
+		festate->read_pos += n;
+	}
+
+	return nread;
+}
+
 /*
  * file_acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -10,11 +10,17 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		leader worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, there's a leader worker that reads and sorts the
+ *		list of blocks to be prewarmed and then launches per-database
+ *		workers for each relevant database in turn.  Up to
+ *		pg_prewarm.autoprewarm_workers workers prewarm a database at the
+ *		same time, each taking batches of blocks from the shared list.  The
+ *		leader keeps running after the initial prewarm is complete to update
+ *		the dump file periodically.
+ *
+ *		The blocks that had the highest usage count when they were dumped
+ *		are loaded first, and runs of consecutive blocks are read with a
+ *		read stream, so that they can be read with a single system call.
  *
  *	Copyright (c) 2016-2021, PostgreSQL Global Development Group
  *
@@ -32,11 +38,14 @@
 #include "access/xact.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/latch.h"
@@ -47,6 +56,7 @@
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
+#include "utils/builtins.h"
 #include "utils/datetime.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -56,6 +66,9 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Number of blocks a per-database worker takes from the list at a time */
+#define APW_BLOCKS_PER_BATCH	1024
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -64,8 +77,17 @@ typedef struct BlockInfoRecord
 	Oid			filenode;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usagecount;		/* 0 if the dump file doesn't have it */
 } BlockInfoRecord;
 
+/* State of the prewarm after startup, as shown by autoprewarm_progress */
+typedef enum AutoPrewarmStatus
+{
+	APW_STATUS_IDLE,			/* not started, or nothing to prewarm */
+	APW_STATUS_PREWARMING,
+	APW_STATUS_FINISHED
+} AutoPrewarmStatus;
+
 /* Shared state information for autoprewarm bgworker. */
 typedef struct AutoPrewarmSharedState
 {
@@ -73,25 +95,49 @@ typedef struct AutoPrewarmSharedState
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	int			prewarm_next_idx;	/* next block to hand out (protected by
+									 * lock) */
+
+	/* Progress of the prewarm; status and workers are protected by lock */
+	AutoPrewarmStatus prewarm_status;
+	int			prewarm_workers;	/* workers running for this database */
+	int			prewarm_total_blocks;
+	pg_atomic_uint32 processed_blocks;	/* blocks handed out and done */
+	pg_atomic_uint32 prewarmed_blocks;	/* blocks read into shared buffers */
 } AutoPrewarmSharedState;
 
+/* Callback state of the read stream used by apw_prewarm_blocks() */
+typedef struct AutoPrewarmReadStreamData
+{
+	BlockInfoRecord *block_info;
+	int			pos;
+	int			stop;
+	BlockNumber nblocks;
+} AutoPrewarmReadStreamData;
+
 void		_PG_init(void);
 void		autoprewarm_main(Datum main_arg);
 void		autoprewarm_database_main(Datum main_arg);
 
 PG_FUNCTION_INFO_V1(autoprewarm_start_worker);
 PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
+PG_FUNCTION_INFO_V1(autoprewarm_progress);
 
 static void apw_load_buffers(void);
+static bool apw_claim_blocks(int *start, int *stop);
+static void apw_prewarm_blocks(BlockInfoRecord *block_info, int start,
+							   int stop);
+static BlockNumber apw_read_stream_next_block(ReadStream *stream,
+											  void *callback_private);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_leader_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_workers(int nworkers);
+static void apw_set_status(AutoPrewarmStatus status);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -102,6 +148,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers;	/* per-database workers */
 
 /*
  * Module load callback.
@@ -121,6 +168,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the number of workers that prewarm a database at the same time",
+							NULL,
+							&autoprewarm_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -265,8 +324,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers, one database at a
+ * time, to prewarm the buffers found there.
  */
 static void
 apw_load_buffers(void)
@@ -325,14 +384,25 @@ apw_load_buffers(void)
 	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
 	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
-	/* Read records, one per line. */
+	/*
+	 * Read records, one per line.  The usage count at the end of each line
+	 * is missing in files written by older versions.
+	 */
 	for (i = 0; i < num_elements; i++)
 	{
+		char		line[128];
 		unsigned	forknum;
-
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
-				   &forknum, &blkinfo[i].blocknum) != 5)
+		int			nfields;
+
+		blkinfo[i].usagecount = 0;
+		if (fgets(line, sizeof(line), file) != NULL)
+			nfields = sscanf(line, "%u,%u,%u,%u,%u,%u", &blkinfo[i].database,
+							 &blkinfo[i].tablespace, &blkinfo[i].filenode,
+							 &forknum, &blkinfo[i].blocknum,
+							 &blkinfo[i].usagecount);
+		else
+			nfields = 0;
+		if (nfields != 5 && nfields != 6)
 			ereport(ERROR,
 					(errmsg("autoprewarm block dump file is corrupted at line %d",
 							i + 1)));
@@ -348,13 +418,17 @@ apw_load_buffers(void)
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
 	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
+	apw_state->prewarm_total_blocks = num_elements;
+	pg_atomic_write_u32(&apw_state->processed_blocks, 0);
+	pg_atomic_write_u32(&apw_state->prewarmed_blocks, 0);
+	apw_set_status(APW_STATUS_PREWARMING);
 
 	/* Get the info position of the first block of the next database. */
 	while (apw_state->prewarm_start_idx < num_elements)
 	{
 		int			j = apw_state->prewarm_start_idx;
 		Oid			current_db = blkinfo[j].database;
+		int			nbatches;
 
 		/*
 		 * Advance the prewarm_stop_idx to the first BlockInfoRecord that does
@@ -385,8 +459,9 @@ apw_load_buffers(void)
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
+		/* Configure stop point and database for next per-database workers. */
 		apw_state->prewarm_stop_idx = j;
+		apw_state->prewarm_next_idx = apw_state->prewarm_start_idx;
 		apw_state->database = current_db;
 		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
 
@@ -402,10 +477,13 @@ apw_load_buffers(void)
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Start per-database workers to load blocks for this database; this
+		 * function will return once they have all exited.  There's no point
+		 * in starting more workers than there are batches of blocks.
 		 */
-		apw_start_database_worker();
+		nbatches = (apw_state->prewarm_stop_idx - apw_state->prewarm_start_idx +
+					APW_BLOCKS_PER_BATCH - 1) / APW_BLOCKS_PER_BATCH;
+		apw_start_database_workers(Min(autoprewarm_workers, nbatches));
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
@@ -416,28 +494,30 @@ apw_load_buffers(void)
 	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
 	apw_state->block_info_handle = DSM_HANDLE_INVALID;
 	apw_state->pid_using_dumpfile = InvalidPid;
+	apw_state->prewarm_status = APW_STATUS_FINISHED;
 	LWLockRelease(&apw_state->lock);
 
 	/* Report our success, if we were able to finish. */
 	if (!ShutdownRequestPending)
 		ereport(LOG,
-				(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-						apw_state->prewarmed_blocks, num_elements)));
+				(errmsg("autoprewarm successfully prewarmed %u of %d previously-loaded blocks",
+						pg_atomic_read_u32(&apw_state->prewarmed_blocks),
+						num_elements)));
 }
 
 /*
- * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * Prewarm blocks for one database (and possibly also global objects, if
+ * those got grouped with this database).  Several of these workers can run
+ * for the same database at once; each one takes batches of blocks from the
+ * shared list until the list is exhausted.
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
 	BlockInfoRecord *block_info;
-	Relation	rel = NULL;
-	BlockNumber nblocks = 0;
-	BlockInfoRecord *old_blk = NULL;
 	dsm_segment *seg;
+	int			start;
+	int			stop;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
 	pqsignal(SIGTERM, die);
@@ -452,108 +532,135 @@ autoprewarm_database_main(Datum main_arg)
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (have_free_buffer() && apw_claim_blocks(&start, &stop))
+		apw_prewarm_blocks(block_info, start, stop);
+
+	dsm_detach(seg);
+}
+
+/*
+ * Take the next batch of blocks of the current database to prewarm from the
+ * shared list.  Returns false if there are none left.
+ */
+static bool
+apw_claim_blocks(int *start, int *stop)
+{
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	*start = apw_state->prewarm_next_idx;
+	*stop = Min(*start + APW_BLOCKS_PER_BATCH, apw_state->prewarm_stop_idx);
+	apw_state->prewarm_next_idx = Max(*start, *stop);
+	LWLockRelease(&apw_state->lock);
+
+	return *start < *stop;
+}
+
+/*
+ * Prewarm the blocks in block_info[start .. stop - 1].
+ *
+ * Each run of increasing block numbers of the same relation fork is read
+ * through one read stream, which combines consecutive blocks into a single
+ * read.
+ */
+static void
+apw_prewarm_blocks(BlockInfoRecord *block_info, int start, int stop)
+{
+	int			pos = start;
+
+	while (pos < stop && have_free_buffer())
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
-		Buffer		buf;
+		BlockInfoRecord *blk = &block_info[pos];
+		int			end = pos + 1;
+		Relation	rel = NULL;
+		Oid			reloid;
 
 		CHECK_FOR_INTERRUPTS();
 
-		/*
-		 * Quit if we've reached records for another database. If previous
-		 * blocks are of some global objects, then continue pre-warming.
-		 */
-		if (old_blk != NULL && old_blk->database != blk->database &&
-			old_blk->database != 0)
-			break;
+		/* Find the end of this run. */
+		while (end < stop &&
+			   block_info[end].database == blk->database &&
+			   block_info[end].tablespace == blk->tablespace &&
+			   block_info[end].filenode == blk->filenode &&
+			   block_info[end].forknum == blk->forknum &&
+			   block_info[end].blocknum > block_info[end - 1].blocknum)
+			end++;
 
 		/*
-		 * As soon as we encounter a block of a new relation, close the old
-		 * relation. Note that rel will be NULL if try_relation_open failed
-		 * previously; in that case, there is nothing to close.
+		 * Try to open the relation.  If it's been dropped, skip the
+		 * associated blocks.
 		 */
-		if (old_blk != NULL && old_blk->filenode != blk->filenode &&
-			rel != NULL)
-		{
-			relation_close(rel, AccessShareLock);
-			rel = NULL;
-			CommitTransactionCommand();
-		}
+		StartTransactionCommand();
+		reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
+		if (OidIsValid(reloid))
+			rel = try_relation_open(reloid, AccessShareLock);
 
 		/*
-		 * Try to open each new relation, but only once, when we first
-		 * encounter it. If it's been dropped, skip the associated blocks.
+		 * smgrexists is not safe for illegal forknum, hence check whether the
+		 * passed forknum is valid before using it in smgrexists.
 		 */
-		if (old_blk == NULL || old_blk->filenode != blk->filenode)
+		if (rel != NULL &&
+			blk->forknum > InvalidForkNumber &&
+			blk->forknum <= MAX_FORKNUM &&
+			smgrexists(RelationGetSmgr(rel), blk->forknum))
 		{
-			Oid			reloid;
-
-			Assert(rel == NULL);
-			StartTransactionCommand();
-			reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
-			if (OidIsValid(reloid))
-				rel = try_relation_open(reloid, AccessShareLock);
+			AutoPrewarmReadStreamData stream_data;
+			ReadStream *stream;
+			Buffer		buf;
+
+			stream_data.block_info = block_info;
+			stream_data.pos = pos;
+			stream_data.stop = end;
+			stream_data.nblocks =
+				RelationGetNumberOfBlocksInFork(rel, blk->forknum);
+
+			/* Prewarm buffers. */
+			stream = ReadStreamBegin(rel, blk->forknum, NULL,
+									 apw_read_stream_next_block,
+									 &stream_data);
+			while (BufferIsValid(buf = ReadStreamNextBuffer(stream)))
+			{
+				pg_atomic_fetch_add_u32(&apw_state->prewarmed_blocks, 1);
+				ReleaseBuffer(buf);
 
-			if (!rel)
-				CommitTransactionCommand();
-		}
-		if (!rel)
-		{
-			old_blk = blk;
-			continue;
+				if (!have_free_buffer())
+					break;
+			}
+			ReadStreamEnd(stream);
 		}
 
-		/* Once per fork, check for fork existence and size. */
-		if (old_blk == NULL ||
-			old_blk->filenode != blk->filenode ||
-			old_blk->forknum != blk->forknum)
-		{
-			/*
-			 * smgrexists is not safe for illegal forknum, hence check whether
-			 * the passed forknum is valid before using it in smgrexists.
-			 */
-			if (blk->forknum > InvalidForkNumber &&
-				blk->forknum <= MAX_FORKNUM &&
-				smgrexists(RelationGetSmgr(rel), blk->forknum))
-				nblocks = RelationGetNumberOfBlocksInFork(rel, blk->forknum);
-			else
-				nblocks = 0;
-		}
+		if (rel != NULL)
+			relation_close(rel, AccessShareLock);
+		CommitTransactionCommand();
 
-		/* Check whether blocknum is valid and within fork file size. */
-		if (blk->blocknum >= nblocks)
-		{
-			/* Move to next forknum. */
-			old_blk = blk;
-			continue;
-		}
+		pg_atomic_fetch_add_u32(&apw_state->processed_blocks, end - pos);
+		pos = end;
+	}
+}
 
-		/* Prewarm buffer. */
-		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
-								 NULL);
-		if (BufferIsValid(buf))
-		{
-			apw_state->prewarmed_blocks++;
-			ReleaseBuffer(buf);
-		}
+/*
+ * Read stream callback for apw_prewarm_blocks(): return the blocks of the
+ * run in order, stopping at the first one past the end of the fork.
+ */
+static BlockNumber
+apw_read_stream_next_block(ReadStream *stream, void *callback_private)
+{
+	AutoPrewarmReadStreamData *stream_data = callback_private;
+	BlockNumber blocknum;
 
-		old_blk = blk;
-	}
+	if (stream_data->pos >= stream_data->stop)
+		return InvalidBlockNumber;
 
-	dsm_detach(seg);
+	/* The run is in increasing block order, so the rest is past the end too */
+	blocknum = stream_data->block_info[stream_data->pos].blocknum;
+	if (blocknum >= stream_data->nblocks)
+		return InvalidBlockNumber;
 
-	/* Release lock on previous relation. */
-	if (rel)
-	{
-		relation_close(rel, AccessShareLock);
-		CommitTransactionCommand();
-	}
+	stream_data->pos++;
+	return blocknum;
 }
 
 /*
@@ -620,6 +727,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].filenode = bufHdr->tag.rnode.relNode;
 			block_info_array[num_blocks].forknum = bufHdr->tag.forkNum;
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usagecount =
+				BUF_STATE_GET_USAGECOUNT(buf_state);
 			++num_blocks;
 		}
 
@@ -652,12 +761,13 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	{
 		CHECK_FOR_INTERRUPTS();
 
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
+		ret = fprintf(file, "%u,%u,%u,%u,%u,%u\n",
 					  block_info_array[i].database,
 					  block_info_array[i].tablespace,
 					  block_info_array[i].filenode,
 					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
+					  block_info_array[i].blocknum,
+					  block_info_array[i].usagecount);
 		if (ret < 0)
 		{
 			int			save_errno = errno;
@@ -750,6 +860,60 @@ autoprewarm_dump_now(PG_FUNCTION_ARGS)
 	PG_RETURN_INT64((int64) num_blocks);
 }
 
+/*
+ * SQL-callable function to report the progress of the prewarm done at
+ * startup.
+ */
+Datum
+autoprewarm_progress(PG_FUNCTION_ARGS)
+{
+#define AUTOPREWARM_PROGRESS_COLS	6
+	TupleDesc	tupdesc;
+	Datum		values[AUTOPREWARM_PROGRESS_COLS];
+	bool		nulls[AUTOPREWARM_PROGRESS_COLS];
+	AutoPrewarmStatus status;
+	const char *status_name = NULL;
+	Oid			database;
+	int			workers;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	apw_init_shmem();
+
+	LWLockAcquire(&apw_state->lock, LW_SHARED);
+	status = apw_state->prewarm_status;
+	database = apw_state->database;
+	workers = apw_state->prewarm_workers;
+	LWLockRelease(&apw_state->lock);
+
+	switch (status)
+	{
+		case APW_STATUS_IDLE:
+			status_name = "idle";
+			break;
+		case APW_STATUS_PREWARMING:
+			status_name = "prewarming";
+			break;
+		case APW_STATUS_FINISHED:
+			status_name = "finished";
+			break;
+	}
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum(status_name);
+	if (status == APW_STATUS_PREWARMING && OidIsValid(database))
+		values[1] = ObjectIdGetDatum(database);
+	else
+		nulls[1] = true;
+	values[2] = Int32GetDatum(workers);
+	values[3] = Int64GetDatum((int64) apw_state->prewarm_total_blocks);
+	values[4] = Int64GetDatum((int64) pg_atomic_read_u32(&apw_state->processed_blocks));
+	values[5] = Int64GetDatum((int64) pg_atomic_read_u32(&apw_state->prewarmed_blocks));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * Allocate and initialize autoprewarm related shared memory, if not already
  * done, and set up backend-local pointer to that state.  Returns true if an
@@ -770,6 +934,11 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		apw_state->prewarm_status = APW_STATUS_IDLE;
+		apw_state->prewarm_workers = 0;
+		apw_state->prewarm_total_blocks = 0;
+		pg_atomic_init_u32(&apw_state->processed_blocks, 0);
+		pg_atomic_init_u32(&apw_state->prewarmed_blocks, 0);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -835,13 +1004,15 @@ apw_start_leader_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start up to nworkers autoprewarm per-database worker processes, and wait
+ * for them to exit.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_workers(int nworkers)
 {
 	BackgroundWorker worker;
-	BackgroundWorkerHandle *handle;
+	BackgroundWorkerHandle **handles;
+	int			nstarted;
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -856,17 +1027,51 @@ apw_start_database_worker(void)
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
-	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	handles = palloc(sizeof(BackgroundWorkerHandle *) * nworkers);
+
+	/*
+	 * Fewer workers than requested are fine, as long as there is at least
+	 * one; the ones we get will prewarm all the blocks.
+	 */
+	for (nstarted = 0; nstarted < nworkers; nstarted++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &handles[nstarted]))
+			break;
+	}
+
+	if (nstarted == 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
 
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->prewarm_workers = nstarted;
+	LWLockRelease(&apw_state->lock);
+
 	/*
 	 * Ignore return value; if it fails, postmaster has died, but we have
 	 * checks for that elsewhere.
 	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	for (int i = 0; i < nstarted; i++)
+		WaitForBackgroundWorkerShutdown(handles[i]);
+
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->prewarm_workers = 0;
+	LWLockRelease(&apw_state->lock);
+
+	pfree(handles);
+}
+
+/*
+ * Set the status reported by autoprewarm_progress.
+ */
+static void
+apw_set_status(AutoPrewarmStatus status)
+{
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->prewarm_status = status;
+	LWLockRelease(&apw_state->lock);
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -882,10 +1087,12 @@ do { \
  * apw_compare_blockinfo
  *
  * We depend on all records for a particular database being consecutive
- * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenode, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * in the dump file, as the per-database workers only prewarm the blocks
+ * from the start of the range for the database to the first block of some
+ * other database.  Within a database, blocks with a higher usage count come
+ * first, so that the hottest blocks are loaded first.  Sorting by
+ * tablespace, filenode, forknum, and blocknum after that isn't critical for
+ * correctness, but helps us get a sequential I/O pattern.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
@@ -894,6 +1101,11 @@ apw_compare_blockinfo(const void *p, const void *q)
 	const BlockInfoRecord *b = (const BlockInfoRecord *) q;
 
 	cmp_member_elem(database);
+
+	/* higher usage counts first */
+	if (a->usagecount != b->usagecount)
+		return (a->usagecount > b->usagecount) ? -1 : 1;
+
 	cmp_member_elem(tablespace);
 	cmp_member_elem(filenode);
 	cmp_member_elem(forknum);
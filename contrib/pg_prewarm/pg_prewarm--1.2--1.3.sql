@@ -0,0 +1,18 @@
+/* contrib/pg_prewarm/pg_prewarm--1.2--1.3.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_prewarm UPDATE TO '1.3'" to load this file. \quit
+
+CREATE FUNCTION autoprewarm_progress(
+    OUT status text,
+    OUT database oid,
+    OUT workers integer,
+    OUT total_blocks int8,
+    OUT processed_blocks int8,
+    OUT prewarmed_blocks int8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME', 'autoprewarm_progress'
+LANGUAGE C;
+
+CREATE VIEW autoprewarm_progress AS
+    SELECT * FROM autoprewarm_progress();
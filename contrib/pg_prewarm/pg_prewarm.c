@@ -38,6 +38,27 @@ typedef enum
 
 static PGAlignedBlock blockbuffer;
 
+/* State for the read stream used in buffer mode */
+struct pg_prewarm_stream_state
+{
+	int64		next_block;
+	int64		last_block;		/* -1 for an empty fork */
+};
+
+/*
+ * Read stream callback: hand out the requested block range in order.
+ */
+static BlockNumber
+pg_prewarm_stream_next_block(ReadStream *stream, void *callback_private)
+{
+	struct pg_prewarm_stream_state *state = callback_private;
+
+	if (state->next_block > state->last_block)
+		return InvalidBlockNumber;
+
+	return (BlockNumber) state->next_block++;
+}
+
 /*
  * pg_prewarm(regclass, mode text, fork text,
  *			  first_block int8, last_block int8)
@@ -183,18 +204,28 @@ pg_prewarm(PG_FUNCTION_ARGS)
 	}
 	else if (ptype == PREWARM_BUFFER)
 	{
+		struct pg_prewarm_stream_state state;
+		ReadStream *stream;
+		Buffer		buf;
+
 		/*
-		 * In buffer mode, we actually pull the data into shared_buffers.
+		 * In buffer mode, we actually pull the data into shared_buffers.  A
+		 * read stream lets runs of uncached blocks be read with one system
+		 * call.
 		 */
-		for (block = first_block; block <= last_block; ++block)
-		{
-			Buffer		buf;
+		state.next_block = first_block;
+		state.last_block = last_block;
+		stream = ReadStreamBegin(rel, forkNumber, NULL,
+								 pg_prewarm_stream_next_block, &state);
 
+		while (BufferIsValid(buf = ReadStreamNextBuffer(stream)))
+		{
 			CHECK_FOR_INTERRUPTS();
-			buf = ReadBufferExtended(rel, forkNumber, block, RBM_NORMAL, NULL);
 			ReleaseBuffer(buf);
 			++blocks_done;
 		}
+
+		ReadStreamEnd(stream);
 	}
 
 	/* Close relation, release lock. */
@@ -14,24 +14,39 @@
  *
  * To facilitate presenting entries to users, we create "representative" query
  * strings in which constants are replaced with parameter symbols ($n), to
- * make it clearer what a normalized entry can represent.  To save on shared
- * memory, and to avoid having to truncate oversized query strings, we store
- * these strings in a temporary external query-texts file.  Offsets into this
- * file are kept in shared memory.
+ * make it clearer what a normalized entry can represent.  To avoid having to
+ * reserve room for the longest possible string in every entry, and to avoid
+ * having to truncate oversized query strings, we store these strings in a
+ * separate shared query text area, whose size is set by
+ * pg_stat_statements.text_memory.  Entries refer to their texts by offsets
+ * into this area.  When it fills up, it is compacted to squeeze out the texts
+ * of entries that are gone.
  *
- * Note about locking issues: to create or delete an entry in the shared
- * hashtable, one must hold pgss->lock exclusively.  Modifying any field
- * in an entry except the counters requires the same.  To look up an entry,
- * one must hold the lock shared.  To read or update the counters within
- * an entry, one must hold the lock shared or exclusive (so the entry doesn't
- * disappear!) and also take the entry's mutex spinlock.
- * The shared state variable pgss->extent (the next free spot in the external
- * query-text file) should be accessed only while holding either the
- * pgss->mutex spinlock, or exclusive lock on pgss->lock.  We use the mutex to
- * allow reserving file space while holding only shared lock on pgss->lock.
- * Rewriting the entire external query-text file, eg for garbage collection,
- * requires holding pgss->lock exclusively; this allows individual entries
- * in the file to be read or written while holding only shared lock.
+ * Note about locking issues: the shared hashtable is split into
+ * PGSS_NUM_PARTITIONS partitions, each a separate hashtable protected by its
+ * own LWLock, so that backends working on unrelated statements don't contend
+ * with each other, and so that making room for new entries only has to lock
+ * and scan one partition.  To create or delete an entry, one must hold the
+ * entry's partition lock exclusively, and also hold pgss->lock at least
+ * shared.  Modifying any field in an entry except the counters and the query
+ * text location requires the partition lock exclusively.  To look up an
+ * entry, one must hold the partition lock shared.  To read or update the
+ * counters within an entry, one must hold the partition lock shared or
+ * exclusive (so the entry doesn't disappear!) and also take the entry's mutex
+ * spinlock.  A process needing both pgss->lock and a partition lock must
+ * acquire pgss->lock first, and must not hold more than one partition lock
+ * unless it holds pgss->lock exclusively.
+ *
+ * pgss->lock protects the query text area, and the query text location
+ * (query_offset and query_len) of every entry.  The shared state variables
+ * pgss->extent (the next free spot in the query text area) and pgss->garbage
+ * should be accessed only while holding either the pgss->mutex spinlock, or
+ * exclusive lock on pgss->lock.  We use the mutex to allow reserving space
+ * in the area while holding only shared lock on pgss->lock.  Compacting the
+ * area requires holding pgss->lock exclusively; this allows individual texts
+ * in the area to be read or written while holding only shared lock.  Since
+ * no entry can be created or deleted while pgss->lock is held exclusively,
+ * that also allows scanning the partitions without taking their locks.
  *
  *
  * Copyright (c) 2008-2021, PostgreSQL Global Development Group
@@ -44,7 +59,6 @@
 #include "postgres.h"
 
 #include <math.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 #include "access/parallel.h"
@@ -77,18 +91,8 @@ PG_MODULE_MAGIC;
 /* Location of permanent stats file (valid when database is shut down) */
 #define PGSS_DUMP_FILE	PGSTAT_STAT_PERMANENT_DIRECTORY "/pg_stat_statements.stat"
 
-/*
- * Location of external query text file.  We don't keep it in the core
- * system's stats_temp_directory.  The core system can safely use that GUC
- * setting, because the statistics collector temp file paths are set only once
- * as part of changing the GUC, but pg_stat_statements has no way of avoiding
- * race conditions.  Besides, we only expect modest, infrequent I/O for query
- * strings, so placing the file on a faster filesystem is not compelling.
- */
-#define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
-
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20201227;
+static const uint32 PGSS_FILE_HEADER = 0x20211030;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -97,12 +101,27 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 #define USAGE_EXEC(duration)	(1.0)
 #define USAGE_INIT				(1.0)	/* including initial planning */
 #define ASSUMED_MEDIAN_INIT		(10.0)	/* initial assumed median usage */
-#define ASSUMED_LENGTH_INIT		1024	/* initial assumed mean query length */
+#define ASSUMED_LENGTH_INIT		1024	/* assumed mean query length */
 #define USAGE_DECREASE_FACTOR	(0.99)	/* decreased every entry_dealloc */
 #define STICKY_DECREASE_FACTOR	(0.50)	/* factor for sticky entries */
 #define USAGE_DEALLOC_PERCENT	5	/* free this % of entries at once */
 #define IS_STICKY(c)	((c.calls[PGSS_PLAN] + c.calls[PGSS_EXEC]) == 0)
 
+/* Number of partitions of the shared hashtable (must be a power of 2) */
+#define PGSS_NUM_PARTITIONS_LOG2	4
+#define PGSS_NUM_PARTITIONS		(1 << PGSS_NUM_PARTITIONS_LOG2)
+
+/*
+ * The partition is chosen by the high-order bits of the hash code, since
+ * dynahash uses the low-order ones to choose a bucket within the partition.
+ */
+#define PGSS_PARTITION(hashcode) \
+	((hashcode) >> (32 - PGSS_NUM_PARTITIONS_LOG2))
+
+/* Maximum number of entries in each partition */
+#define pgss_partition_max \
+	((pgss_max + PGSS_NUM_PARTITIONS - 1) / PGSS_NUM_PARTITIONS)
+
 /*
  * Utility statements that pgss_ProcessUtility and pgss_post_parse_analyze
  * ignores.
@@ -121,7 +140,8 @@ typedef enum pgssVersion
 	PGSS_V1_2,
 	PGSS_V1_3,
 	PGSS_V1_8,
-	PGSS_V1_9
+	PGSS_V1_9,
+	PGSS_V1_10
 } pgssVersion;
 
 typedef enum pgssStoreKind
@@ -144,8 +164,9 @@ typedef enum pgssStoreKind
  * queries by user and by database even if they are otherwise identical.
  *
  * If you add a new key to this struct, make sure to teach pgss_store() to
- * zero the padding bytes.  Otherwise, things will break, because pgss_hash is
- * created using HASH_BLOBS, and thus tag_hash is used to hash this.
+ * zero the padding bytes.  Otherwise, things will break, because the pgss_hash
+ * partitions are created using HASH_BLOBS, and thus tag_hash is used to hash
+ * this.
 
  */
 typedef struct pgssHashKey
@@ -189,6 +210,7 @@ typedef struct Counters
 	int64		wal_records;	/* # of WAL records generated */
 	int64		wal_fpi;		/* # of WAL full page images generated */
 	uint64		wal_bytes;		/* total amount of WAL generated in bytes */
+	double		wait_time;		/* time spent in timed waits, in msec */
 } Counters;
 
 /*
@@ -203,32 +225,40 @@ typedef struct pgssGlobalStats
 /*
  * Statistics per statement
  *
- * Note: in event of a failure in garbage collection of the query text file,
- * we reset query_offset to zero and query_len to -1.  This will be seen as
- * an invalid state by qtext_fetch().
+ * Note: if there was no room for the query text, we set query_offset to zero
+ * and query_len to -1.  This will be seen as an invalid state by
+ * qtext_fetch().
  */
 typedef struct pgssEntry
 {
 	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
 	Counters	counters;		/* the statistics for this query */
-	Size		query_offset;	/* query text offset in external file */
+	Size		query_offset;	/* query text offset in query text area */
 	int			query_len;		/* # of valid bytes in query string, or -1 */
 	int			encoding;		/* query text encoding */
 	slock_t		mutex;			/* protects the counters only */
 } pgssEntry;
 
+/*
+ * Shared state of one hashtable partition
+ */
+typedef struct pgssPartition
+{
+	LWLock	   *lock;			/* protects the partition's hashtable */
+	double		cur_median_usage;	/* current median usage in partition */
+} pgssPartition;
+
 /*
  * Global shared state
  */
 typedef struct pgssSharedState
 {
-	LWLock	   *lock;			/* protects hashtable search/modification */
-	double		cur_median_usage;	/* current median usage in hashtable */
-	Size		mean_query_len; /* current mean entry text length */
+	LWLock	   *lock;			/* protects query texts, see above */
+	pgssPartition partitions[PGSS_NUM_PARTITIONS];
+	Size		text_size;		/* size of query text area */
 	slock_t		mutex;			/* protects following fields only: */
-	Size		extent;			/* current extent of query file */
-	int			n_writers;		/* number of active writers to query file */
-	int			gc_count;		/* query file garbage collection cycle count */
+	Size		extent;			/* current extent of query text area */
+	Size		garbage;		/* # of bytes in area used by removed entries */
 	pgssGlobalStats stats;		/* global statistics for pgss */
 } pgssSharedState;
 
@@ -252,7 +282,8 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 
 /* Links to shared memory state */
 static pgssSharedState *pgss = NULL;
-static HTAB *pgss_hash = NULL;
+static HTAB *pgss_hash[PGSS_NUM_PARTITIONS];
+static char *pgss_texts = NULL;
 
 /*---- GUC variables ----*/
 
@@ -272,6 +303,7 @@ static const struct config_enum_entry track_options[] =
 };
 
 static int	pgss_max;			/* max # statements to track */
+static int	pgss_text_memory;	/* kB of memory for query texts, or -1 */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_track_planning;	/* whether to track planning duration */
@@ -283,14 +315,6 @@ static bool pgss_save;			/* whether to save stats across shutdown */
 	(pgss_track == PGSS_TRACK_ALL || \
 	(pgss_track == PGSS_TRACK_TOP && (level) == 0)))
 
-#define record_gc_qtexts() \
-	do { \
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss; \
-		SpinLockAcquire(&s->mutex); \
-		s->gc_count++; \
-		SpinLockRelease(&s->mutex); \
-	} while(0)
-
 /*---- Function declarations ----*/
 
 void		_PG_init(void);
@@ -302,6 +326,7 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_8);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_9);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_10);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
 PG_FUNCTION_INFO_V1(pg_stat_statements_info);
 
@@ -330,21 +355,23 @@ static void pgss_store(const char *query, uint64 queryId,
 					   double total_time, uint64 rows,
 					   const BufferUsage *bufusage,
 					   const WalUsage *walusage,
+					   double wait_time,
 					   JumbleState *jstate);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
 static Size pgss_memsize(void);
-static pgssEntry *entry_alloc(pgssHashKey *key, Size query_offset, int query_len,
+static Size pgss_text_memsize(void);
+static uint32 pgss_hash_key(const pgssHashKey *key);
+static pgssEntry *entry_alloc(pgssHashKey *key, uint32 hashcode,
+							  Size query_offset, int query_len,
 							  int encoding, bool sticky);
-static void entry_dealloc(void);
+static void entry_dealloc(int partno);
 static bool qtext_store(const char *query, int query_len,
-						Size *query_offset, int *gc_count);
-static char *qtext_load_file(Size *buffer_size);
-static char *qtext_fetch(Size query_offset, int query_len,
-						 char *buffer, Size buffer_size);
-static bool need_gc_qtexts(void);
-static void gc_qtexts(void);
+						Size *query_offset);
+static char *qtext_fetch(Size query_offset, int query_len);
+static bool qtext_compact_worthwhile(int query_len);
+static void qtext_compact(void);
 static void entry_reset(Oid userid, Oid dbid, uint64 queryid);
 static char *generate_normalized_query(JumbleState *jstate, const char *query,
 									   int query_loc, int *query_len_p);
@@ -392,6 +419,19 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_stat_statements.text_memory",
+							"Sets the amount of shared memory used to store query texts.",
+							"-1 means 1kB for each statement tracked.",
+							&pgss_text_memory,
+							-1,
+							-1,
+							MAX_KILOBYTES,
+							PGC_POSTMASTER,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomEnumVariable("pg_stat_statements.track",
 							 "Selects which statements are tracked by pg_stat_statements.",
 							 NULL,
@@ -445,7 +485,7 @@ _PG_init(void)
 	 * resources in pgss_shmem_startup().
 	 */
 	RequestAddinShmemSpace(pgss_memsize());
-	RequestNamedLWLockTranche("pg_stat_statements", 1);
+	RequestNamedLWLockTranche("pg_stat_statements", 1 + PGSS_NUM_PARTITIONS);
 
 	/*
 	 * Install hooks.
@@ -488,16 +528,14 @@ _PG_fini(void)
 /*
  * shmem_startup hook: allocate or attach to shared memory,
  * then load any pre-existing statistics from file.
- * Also create and load the query-texts file, which is expected to exist
- * (even if empty) while the module is enabled.
  */
 static void
 pgss_shmem_startup(void)
 {
 	bool		found;
+	bool		texts_found;
 	HASHCTL		info;
 	FILE	   *file = NULL;
-	FILE	   *qfile = NULL;
 	uint32		header;
 	int32		num;
 	int32		pgver;
@@ -510,7 +548,8 @@ pgss_shmem_startup(void)
 
 	/* reset in case this is a restart within the postmaster */
 	pgss = NULL;
-	pgss_hash = NULL;
+	memset(pgss_hash, 0, sizeof(pgss_hash));
+	pgss_texts = NULL;
 
 	/*
 	 * Create or attach to the shared memory state, including hash table
@@ -524,23 +563,38 @@ pgss_shmem_startup(void)
 	if (!found)
 	{
 		/* First time through ... */
-		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))->lock;
-		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		LWLockPadded *locks = GetNamedLWLockTranche("pg_stat_statements");
+
+		pgss->lock = &locks[0].lock;
+		for (i = 0; i < PGSS_NUM_PARTITIONS; i++)
+		{
+			pgss->partitions[i].lock = &locks[i + 1].lock;
+			pgss->partitions[i].cur_median_usage = ASSUMED_MEDIAN_INIT;
+		}
+		pgss->text_size = pgss_text_memsize();
 		SpinLockInit(&pgss->mutex);
 		pgss->extent = 0;
-		pgss->n_writers = 0;
-		pgss->gc_count = 0;
+		pgss->garbage = 0;
 		pgss->stats.dealloc = 0;
 		pgss->stats.stats_reset = GetCurrentTimestamp();
 	}
 
 	info.keysize = sizeof(pgssHashKey);
 	info.entrysize = sizeof(pgssEntry);
-	pgss_hash = ShmemInitHash("pg_stat_statements hash",
-							  pgss_max, pgss_max,
-							  &info,
-							  HASH_ELEM | HASH_BLOBS);
+	for (i = 0; i < PGSS_NUM_PARTITIONS; i++)
+	{
+		char		name[64];
+
+		snprintf(name, sizeof(name), "pg_stat_statements hash %d", i);
+		pgss_hash[i] = ShmemInitHash(name,
+									 pgss_partition_max, pgss_partition_max,
+									 &info,
+									 HASH_ELEM | HASH_BLOBS);
+	}
+
+	pgss_texts = ShmemInitStruct("pg_stat_statements query texts",
+								 pgss_text_memsize(),
+								 &texts_found);
 
 	LWLockRelease(AddinShmemInitLock);
 
@@ -562,24 +616,13 @@ pgss_shmem_startup(void)
 	 * processes running when this code is reached.
 	 */
 
-	/* Unlink query text file possibly left over from crash */
-	unlink(PGSS_TEXT_FILE);
-
-	/* Allocate new query text temp file */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-		goto write_error;
-
 	/*
 	 * If we were told not to load old statistics, we're done.  (Note we do
 	 * not try to unlink any old dump file in this case.  This seems a bit
 	 * questionable but it's the historical behavior.)
 	 */
 	if (!pgss_save)
-	{
-		FreeFile(qfile);
 		return;
-	}
 
 	/*
 	 * Attempt to load old statistics from the dump file.
@@ -590,7 +633,6 @@ pgss_shmem_startup(void)
 		if (errno != ENOENT)
 			goto read_error;
 		/* No existing persisted stats file, so we're done */
-		FreeFile(qfile);
 		return;
 	}
 
@@ -636,14 +678,16 @@ pgss_shmem_startup(void)
 		if (IS_STICKY(temp.counters))
 			continue;
 
-		/* Store the query text */
-		query_offset = pgss->extent;
-		if (fwrite(buffer, 1, temp.query_len + 1, qfile) != temp.query_len + 1)
-			goto write_error;
-		pgss->extent += temp.query_len + 1;
+		/* Store the query text, dropping it if there's no room */
+		if (!qtext_store(buffer, temp.query_len, &query_offset))
+		{
+			query_offset = 0;
+			temp.query_len = -1;
+		}
 
 		/* make the hashtable entry (discards old entries if too many) */
-		entry = entry_alloc(&temp.key, query_offset, temp.query_len,
+		entry = entry_alloc(&temp.key, pgss_hash_key(&temp.key),
+							query_offset, temp.query_len,
 							temp.encoding,
 							false);
 
@@ -657,20 +701,11 @@ pgss_shmem_startup(void)
 
 	pfree(buffer);
 	FreeFile(file);
-	FreeFile(qfile);
 
 	/*
 	 * Remove the persisted stats file so it's not included in
 	 * backups/replication standbys, etc.  A new file will be written on next
 	 * shutdown.
-	 *
-	 * Note: it's okay if the PGSS_TEXT_FILE is included in a basebackup,
-	 * because we remove that file on startup; it acts inversely to
-	 * PGSS_DUMP_FILE, in that it is only supposed to be around when the
-	 * server is running, whereas PGSS_DUMP_FILE is only supposed to be around
-	 * when the server is not running.  Leaving the file creates no danger of
-	 * a newly restored database having a spurious record of execution costs,
-	 * which is what we're really concerned about here.
 	 */
 	unlink(PGSS_DUMP_FILE);
 
@@ -687,26 +722,13 @@ data_error:
 			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 			 errmsg("ignoring invalid data in file \"%s\"",
 					PGSS_DUMP_FILE)));
-	goto fail;
-write_error:
-	ereport(LOG,
-			(errcode_for_file_access(),
-			 errmsg("could not write file \"%s\": %m",
-					PGSS_TEXT_FILE)));
 fail:
 	if (buffer)
 		pfree(buffer);
 	if (file)
 		FreeFile(file);
-	if (qfile)
-		FreeFile(qfile);
 	/* If possible, throw away the bogus file; ignore any error */
 	unlink(PGSS_DUMP_FILE);
-
-	/*
-	 * Don't unlink PGSS_TEXT_FILE here; it should always be around while the
-	 * server is running with pg_stat_statements enabled
-	 */
 }
 
 /*
@@ -719,18 +741,17 @@ static void
 pgss_shmem_shutdown(int code, Datum arg)
 {
 	FILE	   *file;
-	char	   *qbuffer = NULL;
-	Size		qbuffer_size = 0;
 	HASH_SEQ_STATUS hash_seq;
 	int32		num_entries;
 	pgssEntry  *entry;
+	int			partno;
 
 	/* Don't try to dump during a crash. */
 	if (code)
 		return;
 
 	/* Safety check ... shouldn't get here unless shmem is set up. */
-	if (!pgss || !pgss_hash)
+	if (!pgss || !pgss_hash[0])
 		return;
 
 	/* Don't dump if told not to. */
@@ -745,34 +766,34 @@ pgss_shmem_shutdown(int code, Datum arg)
 		goto error;
 	if (fwrite(&PGSS_PG_MAJOR_VERSION, sizeof(uint32), 1, file) != 1)
 		goto error;
-	num_entries = hash_get_num_entries(pgss_hash);
+	num_entries = 0;
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
+		num_entries += hash_get_num_entries(pgss_hash[partno]);
 	if (fwrite(&num_entries, sizeof(int32), 1, file) != 1)
 		goto error;
 
-	qbuffer = qtext_load_file(&qbuffer_size);
-	if (qbuffer == NULL)
-		goto error;
-
 	/*
 	 * When serializing to disk, we store query texts immediately after their
 	 * entry data.  Any orphaned query texts are thereby excluded.
 	 */
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
 	{
-		int			len = entry->query_len;
-		char	   *qstr = qtext_fetch(entry->query_offset, len,
-									   qbuffer, qbuffer_size);
+		hash_seq_init(&hash_seq, pgss_hash[partno]);
+		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		{
+			int			len = entry->query_len;
+			char	   *qstr = qtext_fetch(entry->query_offset, len);
 
-		if (qstr == NULL)
-			continue;			/* Ignore any entries with bogus texts */
+			if (qstr == NULL)
+				continue;		/* Ignore any entries with bogus texts */
 
-		if (fwrite(entry, sizeof(pgssEntry), 1, file) != 1 ||
-			fwrite(qstr, 1, len + 1, file) != len + 1)
-		{
-			/* note: we assume hash_seq_term won't change errno */
-			hash_seq_term(&hash_seq);
-			goto error;
+			if (fwrite(entry, sizeof(pgssEntry), 1, file) != 1 ||
+				fwrite(qstr, 1, len + 1, file) != len + 1)
+			{
+				/* note: we assume hash_seq_term won't change errno */
+				hash_seq_term(&hash_seq);
+				goto error;
+			}
 		}
 	}
 
@@ -780,9 +801,6 @@ pgss_shmem_shutdown(int code, Datum arg)
 	if (fwrite(&pgss->stats, sizeof(pgssGlobalStats), 1, file) != 1)
 		goto error;
 
-	free(qbuffer);
-	qbuffer = NULL;
-
 	if (FreeFile(file))
 	{
 		file = NULL;
@@ -794,9 +812,6 @@ pgss_shmem_shutdown(int code, Datum arg)
 	 */
 	(void) durable_rename(PGSS_DUMP_FILE ".tmp", PGSS_DUMP_FILE, LOG);
 
-	/* Unlink query-texts file; it's not needed while shutdown */
-	unlink(PGSS_TEXT_FILE);
-
 	return;
 
 error:
@@ -804,12 +819,9 @@ error:
 			(errcode_for_file_access(),
 			 errmsg("could not write file \"%s\": %m",
 					PGSS_DUMP_FILE ".tmp")));
-	if (qbuffer)
-		free(qbuffer);
 	if (file)
 		FreeFile(file);
 	unlink(PGSS_DUMP_FILE ".tmp");
-	unlink(PGSS_TEXT_FILE);
 }
 
 /*
@@ -822,7 +834,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query, JumbleState *jstate)
 		prev_post_parse_analyze_hook(pstate, query, jstate);
 
 	/* Safety check... */
-	if (!pgss || !pgss_hash || !pgss_enabled(exec_nested_level))
+	if (!pgss || !pgss_hash[0] || !pgss_enabled(exec_nested_level))
 		return;
 
 	/*
@@ -854,6 +866,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query, JumbleState *jstate)
 				   0,
 				   NULL,
 				   NULL,
+				   0,
 				   jstate);
 }
 
@@ -938,6 +951,7 @@ pgss_planner(Query *parse,
 				   0,
 				   &bufusage,
 				   &walusage,
+				   0,
 				   NULL);
 	}
 	else
@@ -1056,6 +1070,8 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 				   queryDesc->estate->es_processed,
 				   &queryDesc->totaltime->bufusage,
 				   &queryDesc->totaltime->walusage,
+				   (double) queryDesc->totaltime->wait_ticks * 1000.0 /
+				   (double) pg_get_ticks_per_sec(),
 				   NULL);
 	}
 
@@ -1119,9 +1135,11 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 					bufusage;
 		WalUsage	walusage_start,
 					walusage;
+		uint64		wait_ticks_start;
 
 		bufusage_start = pgBufferUsage;
 		walusage_start = pgWalUsage;
+		wait_ticks_start = pgStatWaitTicks;
 		INSTR_TIME_SET_CURRENT(start);
 
 		exec_nested_level++;
@@ -1173,6 +1191,8 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 				   rows,
 				   &bufusage,
 				   &walusage,
+				   (double) (pgStatWaitTicks - wait_ticks_start) * 1000.0 /
+				   (double) pg_get_ticks_per_sec(),
 				   NULL);
 	}
 	else
@@ -1197,8 +1217,8 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
  *
  * If jstate is not NULL then we're trying to create an entry for which
  * we have no statistics as yet; we just want to record the normalized
- * query string.  total_time, rows, bufusage and walusage are ignored in this
- * case.
+ * query string.  total_time, rows, bufusage, walusage and wait_time are
+ * ignored in this case.
  *
  * If kind is PGSS_PLAN or PGSS_EXEC, its value is used as the array position
  * for the arrays in the Counters field.
@@ -1210,9 +1230,13 @@ pgss_store(const char *query, uint64 queryId,
 		   double total_time, uint64 rows,
 		   const BufferUsage *bufusage,
 		   const WalUsage *walusage,
+		   double wait_time,
 		   JumbleState *jstate)
 {
 	pgssHashKey key;
+	uint32		hashcode;
+	int			partno;
+	LWLock	   *partition_lock;
 	pgssEntry  *entry;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
@@ -1220,7 +1244,7 @@ pgss_store(const char *query, uint64 queryId,
 	Assert(query != NULL);
 
 	/* Safety check... */
-	if (!pgss || !pgss_hash)
+	if (!pgss || !pgss_hash[0])
 		return;
 
 	/*
@@ -1247,72 +1271,96 @@ pgss_store(const char *query, uint64 queryId,
 	key.queryid = queryId;
 	key.toplevel = (exec_nested_level == 0);
 
-	/* Lookup the hash table entry with shared lock. */
-	LWLockAcquire(pgss->lock, LW_SHARED);
+	hashcode = pgss_hash_key(&key);
+	partno = PGSS_PARTITION(hashcode);
+	partition_lock = pgss->partitions[partno].lock;
 
-	entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_FIND, NULL);
+	/* Lookup the hash table entry with shared lock on its partition. */
+	LWLockAcquire(partition_lock, LW_SHARED);
+
+	entry = (pgssEntry *) hash_search_with_hash_value(pgss_hash[partno],
+													  &key, hashcode,
+													  HASH_FIND, NULL);
 
 	/* Create new entry, if not present */
 	if (!entry)
 	{
 		Size		query_offset;
-		int			gc_count;
 		bool		stored;
-		bool		do_gc;
+
+		LWLockRelease(partition_lock);
 
 		/*
 		 * Create a new, normalized query string if caller asked.  We don't
-		 * need to hold the lock while doing this work.  (Note: in any case,
+		 * need to hold any lock while doing this work.  (Note: in any case,
 		 * it's possible that someone else creates a duplicate hashtable entry
-		 * in the interval where we don't hold the lock below.  That case is
-		 * handled by entry_alloc.)
+		 * in the interval where we don't hold the partition lock below.  That
+		 * case is handled by entry_alloc.)
 		 */
 		if (jstate)
-		{
-			LWLockRelease(pgss->lock);
 			norm_query = generate_normalized_query(jstate, query,
 												   query_location,
 												   &query_len);
-			LWLockAcquire(pgss->lock, LW_SHARED);
-		}
-
-		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
 
 		/*
-		 * Determine whether we need to garbage collect external query texts
-		 * while the shared lock is still held.  This micro-optimization
-		 * avoids taking the time to decide this while holding exclusive lock.
+		 * Store the new query text with only shared lock held.  Holding the
+		 * lock until the entry exists keeps a compaction from discarding the
+		 * text in between.
 		 */
-		do_gc = need_gc_qtexts();
+		LWLockAcquire(pgss->lock, LW_SHARED);
 
-		/* Need exclusive lock to make a new hashtable entry - promote */
-		LWLockRelease(pgss->lock);
-		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+		stored = qtext_store(norm_query ? norm_query : query, query_len,
+							 &query_offset);
 
 		/*
-		 * A garbage collection may have occurred while we weren't holding the
-		 * lock.  In the unlikely event that this happens, the query text we
-		 * stored above will have been garbage collected, so write it again.
-		 * This should be infrequent enough that doing it while holding
-		 * exclusive lock isn't a performance problem.
+		 * If the text area is full, compact it if that will make room.  This
+		 * needs exclusive lock, but should be infrequent enough that that
+		 * isn't a performance problem.
 		 */
-		if (!stored || pgss->gc_count != gc_count)
+		if (!stored && qtext_compact_worthwhile(query_len))
+		{
+			LWLockRelease(pgss->lock);
+			LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+
+			/* someone else may have compacted it meanwhile */
+			if (qtext_compact_worthwhile(query_len))
+				qtext_compact();
+
 			stored = qtext_store(norm_query ? norm_query : query, query_len,
-								 &query_offset, NULL);
+								 &query_offset);
+		}
 
-		/* If we failed to write to the text file, give up */
+		/*
+		 * If there's still no room, track the statement anyway, without its
+		 * text.
+		 */
 		if (!stored)
-			goto done;
+		{
+			query_offset = 0;
+			query_len = -1;
+		}
+
+		/* Need exclusive lock on the partition to make a new entry */
+		LWLockAcquire(partition_lock, LW_EXCLUSIVE);
 
 		/* OK to create a new hashtable entry */
-		entry = entry_alloc(&key, query_offset, query_len, encoding,
+		entry = entry_alloc(&key, hashcode, query_offset, query_len, encoding,
 							jstate != NULL);
 
-		/* If needed, perform garbage collection while exclusive lock held */
-		if (do_gc)
-			gc_qtexts();
+		/*
+		 * If someone else created the entry meanwhile, the text we stored is
+		 * unused.
+		 */
+		if (stored && entry->query_offset != query_offset)
+		{
+			volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+
+			SpinLockAcquire(&s->mutex);
+			s->garbage += query_len + 1;
+			SpinLockRelease(&s->mutex);
+		}
+
+		LWLockRelease(pgss->lock);
 	}
 
 	/* Increment the counts, except when jstate is not NULL */
@@ -1377,12 +1425,12 @@ pgss_store(const char *query, uint64 queryId,
 		e->counters.wal_records += walusage->wal_records;
 		e->counters.wal_fpi += walusage->wal_fpi;
 		e->counters.wal_bytes += walusage->wal_bytes;
+		e->counters.wait_time += wait_time;
 
 		SpinLockRelease(&e->mutex);
 	}
 
-done:
-	LWLockRelease(pgss->lock);
+	LWLockRelease(partition_lock);
 
 	/* We postpone this clean-up until we're out of the lock */
 	if (norm_query)
@@ -1426,7 +1474,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_3	23
 #define PG_STAT_STATEMENTS_COLS_V1_8	32
 #define PG_STAT_STATEMENTS_COLS_V1_9	33
-#define PG_STAT_STATEMENTS_COLS			33	/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_10	34
+#define PG_STAT_STATEMENTS_COLS			34	/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1438,6 +1487,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_10(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_10, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_9(PG_FUNCTION_ARGS)
 {
@@ -1504,18 +1563,15 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	MemoryContext oldcontext;
 	Oid			userid = GetUserId();
 	bool		is_allowed_role = false;
-	char	   *qbuffer = NULL;
-	Size		qbuffer_size = 0;
-	Size		extent = 0;
-	int			gc_count = 0;
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
+	int			partno;
 
 	/* Superusers or members of pg_read_all_stats members are allowed */
 	is_allowed_role = is_member_of_role(GetUserId(), ROLE_PG_READ_ALL_STATS);
 
 	/* hash table must exist already */
-	if (!pgss || !pgss_hash)
+	if (!pgss || !pgss_hash[0])
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
@@ -1571,6 +1627,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_9)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_10:
+			if (api_version != PGSS_V1_10)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1583,236 +1643,189 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	MemoryContextSwitchTo(oldcontext);
 
 	/*
-	 * We'd like to load the query text file (if needed) while not holding any
-	 * lock on pgss->lock.  In the worst case we'll have to do this again
-	 * after we have the lock, but it's unlikely enough to make this a win
-	 * despite occasional duplicated work.  We need to reload if anybody
-	 * writes to the file (either a retail qtext_store(), or a garbage
-	 * collection) between this point and where we've gotten shared lock.  If
-	 * a qtext_store is actually in progress when we look, we might as well
-	 * skip the speculative load entirely.
-	 */
-	if (showtext)
-	{
-		int			n_writers;
-
-		/* Take the mutex so we can examine variables */
-		{
-			volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
-
-			SpinLockAcquire(&s->mutex);
-			extent = s->extent;
-			n_writers = s->n_writers;
-			gc_count = s->gc_count;
-			SpinLockRelease(&s->mutex);
-		}
-
-		/* No point in loading file now if there are active writers */
-		if (n_writers == 0)
-			qbuffer = qtext_load_file(&qbuffer_size);
-	}
-
-	/*
-	 * Get shared lock, load or reload the query text file if we must, and
-	 * iterate over the hashtable entries.
+	 * Get shared lock, and iterate over the hashtable entries one partition
+	 * at a time.  The query texts are read directly from the shared text
+	 * area, which the shared lock keeps from being compacted under us.
 	 *
-	 * With a large hash table, we might be holding the lock rather longer
-	 * than one could wish.  However, this only blocks creation of new hash
-	 * table entries, and the larger the hash table the less likely that is to
-	 * be needed.  So we can hope this is okay.  Perhaps someday we'll decide
-	 * we need to partition the hash table to limit the time spent holding any
-	 * one lock.
+	 * With a large hash table, we might be holding pgss->lock rather longer
+	 * than one could wish.  However, this only blocks compaction of the query
+	 * texts and resets, and each partition lock is only held while scanning
+	 * that partition, blocking the creation of new entries in it.  So we can
+	 * hope this is okay.
 	 */
 	LWLockAcquire(pgss->lock, LW_SHARED);
 
-	if (showtext)
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
 	{
-		/*
-		 * Here it is safe to examine extent and gc_count without taking the
-		 * mutex.  Note that although other processes might change
-		 * pgss->extent just after we look at it, the strings they then write
-		 * into the file cannot yet be referenced in the hashtable, so we
-		 * don't care whether we see them or not.
-		 *
-		 * If qtext_load_file fails, we just press on; we'll return NULL for
-		 * every query text.
-		 */
-		if (qbuffer == NULL ||
-			pgss->extent != extent ||
-			pgss->gc_count != gc_count)
-		{
-			if (qbuffer)
-				free(qbuffer);
-			qbuffer = qtext_load_file(&qbuffer_size);
-		}
-	}
+		LWLockAcquire(pgss->partitions[partno].lock, LW_SHARED);
 
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
-	{
-		Datum		values[PG_STAT_STATEMENTS_COLS];
-		bool		nulls[PG_STAT_STATEMENTS_COLS];
-		int			i = 0;
-		Counters	tmp;
-		double		stddev;
-		int64		queryid = entry->key.queryid;
-
-		memset(values, 0, sizeof(values));
-		memset(nulls, 0, sizeof(nulls));
-
-		values[i++] = ObjectIdGetDatum(entry->key.userid);
-		values[i++] = ObjectIdGetDatum(entry->key.dbid);
-		if (api_version >= PGSS_V1_9)
-			values[i++] = BoolGetDatum(entry->key.toplevel);
-
-		if (is_allowed_role || entry->key.userid == userid)
+		hash_seq_init(&hash_seq, pgss_hash[partno]);
+		while ((entry = hash_seq_search(&hash_seq)) != NULL)
 		{
-			if (api_version >= PGSS_V1_2)
-				values[i++] = Int64GetDatumFast(queryid);
-
-			if (showtext)
+			Datum		values[PG_STAT_STATEMENTS_COLS];
+			bool		nulls[PG_STAT_STATEMENTS_COLS];
+			int			i = 0;
+			Counters	tmp;
+			double		stddev;
+			int64		queryid = entry->key.queryid;
+
+			memset(values, 0, sizeof(values));
+			memset(nulls, 0, sizeof(nulls));
+
+			values[i++] = ObjectIdGetDatum(entry->key.userid);
+			values[i++] = ObjectIdGetDatum(entry->key.dbid);
+			if (api_version >= PGSS_V1_9)
+				values[i++] = BoolGetDatum(entry->key.toplevel);
+
+			if (is_allowed_role || entry->key.userid == userid)
 			{
-				char	   *qstr = qtext_fetch(entry->query_offset,
-											   entry->query_len,
-											   qbuffer,
-											   qbuffer_size);
+				if (api_version >= PGSS_V1_2)
+					values[i++] = Int64GetDatumFast(queryid);
 
-				if (qstr)
+				if (showtext)
 				{
-					char	   *enc;
-
-					enc = pg_any_to_server(qstr,
-										   entry->query_len,
-										   entry->encoding);
+					char	   *qstr = qtext_fetch(entry->query_offset,
+												   entry->query_len);
 
-					values[i++] = CStringGetTextDatum(enc);
+					if (qstr)
+					{
+						char	   *enc;
 
-					if (enc != qstr)
-						pfree(enc);
+						enc = pg_any_to_server(qstr,
+											   entry->query_len,
+											   entry->encoding);
+
+						values[i++] = CStringGetTextDatum(enc);
+
+						if (enc != qstr)
+							pfree(enc);
+					}
+					else
+					{
+						/* Just return a null if we fail to find the text */
+						nulls[i++] = true;
+					}
 				}
 				else
 				{
-					/* Just return a null if we fail to find the text */
+					/* Query text not requested */
 					nulls[i++] = true;
 				}
 			}
 			else
 			{
-				/* Query text not requested */
-				nulls[i++] = true;
-			}
-		}
-		else
-		{
-			/* Don't show queryid */
-			if (api_version >= PGSS_V1_2)
-				nulls[i++] = true;
+				/* Don't show queryid */
+				if (api_version >= PGSS_V1_2)
+					nulls[i++] = true;
 
-			/*
-			 * Don't show query text, but hint as to the reason for not doing
-			 * so if it was requested
-			 */
-			if (showtext)
-				values[i++] = CStringGetTextDatum("<insufficient privilege>");
-			else
-				nulls[i++] = true;
-		}
+				/*
+				 * Don't show query text, but hint as to the reason for not doing
+				 * so if it was requested
+				 */
+				if (showtext)
+					values[i++] = CStringGetTextDatum("<insufficient privilege>");
+				else
+					nulls[i++] = true;
+			}
 
-		/* copy counters to a local variable to keep locking time short */
-		{
-			volatile pgssEntry *e = (volatile pgssEntry *) entry;
+			/* copy counters to a local variable to keep locking time short */
+			{
+				volatile pgssEntry *e = (volatile pgssEntry *) entry;
 
-			SpinLockAcquire(&e->mutex);
-			tmp = e->counters;
-			SpinLockRelease(&e->mutex);
-		}
+				SpinLockAcquire(&e->mutex);
+				tmp = e->counters;
+				SpinLockRelease(&e->mutex);
+			}
 
-		/* Skip entry if unexecuted (ie, it's a pending "sticky" entry) */
-		if (IS_STICKY(tmp))
-			continue;
+			/* Skip entry if unexecuted (ie, it's a pending "sticky" entry) */
+			if (IS_STICKY(tmp))
+				continue;
 
-		/* Note that we rely on PGSS_PLAN being 0 and PGSS_EXEC being 1. */
-		for (int kind = 0; kind < PGSS_NUMKIND; kind++)
-		{
-			if (kind == PGSS_EXEC || api_version >= PGSS_V1_8)
+			/* Note that we rely on PGSS_PLAN being 0 and PGSS_EXEC being 1. */
+			for (int kind = 0; kind < PGSS_NUMKIND; kind++)
 			{
-				values[i++] = Int64GetDatumFast(tmp.calls[kind]);
-				values[i++] = Float8GetDatumFast(tmp.total_time[kind]);
-			}
+				if (kind == PGSS_EXEC || api_version >= PGSS_V1_8)
+				{
+					values[i++] = Int64GetDatumFast(tmp.calls[kind]);
+					values[i++] = Float8GetDatumFast(tmp.total_time[kind]);
+				}
 
-			if ((kind == PGSS_EXEC && api_version >= PGSS_V1_3) ||
-				api_version >= PGSS_V1_8)
-			{
-				values[i++] = Float8GetDatumFast(tmp.min_time[kind]);
-				values[i++] = Float8GetDatumFast(tmp.max_time[kind]);
-				values[i++] = Float8GetDatumFast(tmp.mean_time[kind]);
+				if ((kind == PGSS_EXEC && api_version >= PGSS_V1_3) ||
+					api_version >= PGSS_V1_8)
+				{
+					values[i++] = Float8GetDatumFast(tmp.min_time[kind]);
+					values[i++] = Float8GetDatumFast(tmp.max_time[kind]);
+					values[i++] = Float8GetDatumFast(tmp.mean_time[kind]);
 
-				/*
-				 * Note we are calculating the population variance here, not
-				 * the sample variance, as we have data for the whole
-				 * population, so Bessel's correction is not used, and we
-				 * don't divide by tmp.calls - 1.
-				 */
-				if (tmp.calls[kind] > 1)
-					stddev = sqrt(tmp.sum_var_time[kind] / tmp.calls[kind]);
-				else
-					stddev = 0.0;
-				values[i++] = Float8GetDatumFast(stddev);
+					/*
+					 * Note we are calculating the population variance here, not
+					 * the sample variance, as we have data for the whole
+					 * population, so Bessel's correction is not used, and we
+					 * don't divide by tmp.calls - 1.
+					 */
+					if (tmp.calls[kind] > 1)
+						stddev = sqrt(tmp.sum_var_time[kind] / tmp.calls[kind]);
+					else
+						stddev = 0.0;
+					values[i++] = Float8GetDatumFast(stddev);
+				}
 			}
-		}
-		values[i++] = Int64GetDatumFast(tmp.rows);
-		values[i++] = Int64GetDatumFast(tmp.shared_blks_hit);
-		values[i++] = Int64GetDatumFast(tmp.shared_blks_read);
-		if (api_version >= PGSS_V1_1)
-			values[i++] = Int64GetDatumFast(tmp.shared_blks_dirtied);
-		values[i++] = Int64GetDatumFast(tmp.shared_blks_written);
-		values[i++] = Int64GetDatumFast(tmp.local_blks_hit);
-		values[i++] = Int64GetDatumFast(tmp.local_blks_read);
-		if (api_version >= PGSS_V1_1)
-			values[i++] = Int64GetDatumFast(tmp.local_blks_dirtied);
-		values[i++] = Int64GetDatumFast(tmp.local_blks_written);
-		values[i++] = Int64GetDatumFast(tmp.temp_blks_read);
-		values[i++] = Int64GetDatumFast(tmp.temp_blks_written);
-		if (api_version >= PGSS_V1_1)
-		{
-			values[i++] = Float8GetDatumFast(tmp.blk_read_time);
-			values[i++] = Float8GetDatumFast(tmp.blk_write_time);
-		}
-		if (api_version >= PGSS_V1_8)
-		{
-			char		buf[256];
-			Datum		wal_bytes;
+			values[i++] = Int64GetDatumFast(tmp.rows);
+			values[i++] = Int64GetDatumFast(tmp.shared_blks_hit);
+			values[i++] = Int64GetDatumFast(tmp.shared_blks_read);
+			if (api_version >= PGSS_V1_1)
+				values[i++] = Int64GetDatumFast(tmp.shared_blks_dirtied);
+			values[i++] = Int64GetDatumFast(tmp.shared_blks_written);
+			values[i++] = Int64GetDatumFast(tmp.local_blks_hit);
+			values[i++] = Int64GetDatumFast(tmp.local_blks_read);
+			if (api_version >= PGSS_V1_1)
+				values[i++] = Int64GetDatumFast(tmp.local_blks_dirtied);
+			values[i++] = Int64GetDatumFast(tmp.local_blks_written);
+			values[i++] = Int64GetDatumFast(tmp.temp_blks_read);
+			values[i++] = Int64GetDatumFast(tmp.temp_blks_written);
+			if (api_version >= PGSS_V1_1)
+			{
+				values[i++] = Float8GetDatumFast(tmp.blk_read_time);
+				values[i++] = Float8GetDatumFast(tmp.blk_write_time);
+			}
+			if (api_version >= PGSS_V1_8)
+			{
+				char		buf[256];
+				Datum		wal_bytes;
 
-			values[i++] = Int64GetDatumFast(tmp.wal_records);
-			values[i++] = Int64GetDatumFast(tmp.wal_fpi);
+				values[i++] = Int64GetDatumFast(tmp.wal_records);
+				values[i++] = Int64GetDatumFast(tmp.wal_fpi);
 
-			snprintf(buf, sizeof buf, UINT64_FORMAT, tmp.wal_bytes);
+				snprintf(buf, sizeof buf, UINT64_FORMAT, tmp.wal_bytes);
 
-			/* Convert to numeric. */
-			wal_bytes = DirectFunctionCall3(numeric_in,
-											CStringGetDatum(buf),
-											ObjectIdGetDatum(0),
-											Int32GetDatum(-1));
-			values[i++] = wal_bytes;
+				/* Convert to numeric. */
+				wal_bytes = DirectFunctionCall3(numeric_in,
+												CStringGetDatum(buf),
+												ObjectIdGetDatum(0),
+												Int32GetDatum(-1));
+				values[i++] = wal_bytes;
+			}
+			if (api_version >= PGSS_V1_10)
+				values[i++] = Float8GetDatumFast(tmp.wait_time);
+
+			Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
+						 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
+						 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
+						 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
+						 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
+						 api_version == PGSS_V1_9 ? PG_STAT_STATEMENTS_COLS_V1_9 :
+						 api_version == PGSS_V1_10 ? PG_STAT_STATEMENTS_COLS_V1_10 :
+						 -1 /* fail if you forget to update this assert */ ));
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 		}
 
-		Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
-					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
-					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
-					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
-					 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
-					 api_version == PGSS_V1_9 ? PG_STAT_STATEMENTS_COLS_V1_9 :
-					 -1 /* fail if you forget to update this assert */ ));
-
-		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		LWLockRelease(pgss->partitions[partno].lock);
 	}
 
 	/* clean up and return the tuplestore */
 	LWLockRelease(pgss->lock);
 
-	if (qbuffer)
-		free(qbuffer);
-
 	tuplestore_donestoring(tupstore);
 }
 
@@ -1830,7 +1843,7 @@ pg_stat_statements_info(PG_FUNCTION_ARGS)
 	Datum		values[PG_STAT_STATEMENTS_INFO_COLS];
 	bool		nulls[PG_STAT_STATEMENTS_INFO_COLS];
 
-	if (!pgss || !pgss_hash)
+	if (!pgss || !pgss_hash[0])
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
@@ -1866,14 +1879,40 @@ pgss_memsize(void)
 	Size		size;
 
 	size = MAXALIGN(sizeof(pgssSharedState));
-	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size,
+					mul_size(PGSS_NUM_PARTITIONS,
+							 hash_estimate_size(pgss_partition_max,
+												sizeof(pgssEntry))));
+	size = add_size(size, pgss_text_memsize());
 
 	return size;
 }
 
+/*
+ * Size of the shared query text area.
+ */
+static Size
+pgss_text_memsize(void)
+{
+	if (pgss_text_memory < 0)
+		return mul_size(pgss_max, ASSUMED_LENGTH_INIT);
+	return mul_size(pgss_text_memory, 1024);
+}
+
+/*
+ * Compute the hash code of a hashtable key.  All the partitions use the same
+ * hash function, so any of them will do.
+ */
+static uint32
+pgss_hash_key(const pgssHashKey *key)
+{
+	return get_hash_value(pgss_hash[0], key);
+}
+
 /*
  * Allocate a new hashtable entry.
- * caller must hold an exclusive lock on pgss->lock
+ * caller must hold an exclusive lock on the partition containing hashcode,
+ * and at least a shared lock on pgss->lock
  *
  * "query" need not be null-terminated; we rely on query_len instead
  *
@@ -1887,20 +1926,27 @@ pgss_memsize(void)
  * entry to already exist.  This is because pgss_store releases and
  * reacquires lock after failing to find a match; so someone else could
  * have made the entry while we waited to get exclusive lock.
+ *
+ * (If the entry does already exist, the query text just stored by the caller
+ * is orphaned; the next compaction of the query text area will get rid of
+ * it.)
  */
 static pgssEntry *
-entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
-			bool sticky)
+entry_alloc(pgssHashKey *key, uint32 hashcode,
+			Size query_offset, int query_len, int encoding, bool sticky)
 {
+	int			partno = PGSS_PARTITION(hashcode);
+	HTAB	   *htab = pgss_hash[partno];
 	pgssEntry  *entry;
 	bool		found;
 
 	/* Make space if needed */
-	while (hash_get_num_entries(pgss_hash) >= pgss_max)
-		entry_dealloc();
+	while (hash_get_num_entries(htab) >= pgss_partition_max)
+		entry_dealloc(partno);
 
 	/* Find or create an entry with desired hash code */
-	entry = (pgssEntry *) hash_search(pgss_hash, key, HASH_ENTER, &found);
+	entry = (pgssEntry *) hash_search_with_hash_value(htab, key, hashcode,
+													  HASH_ENTER, &found);
 
 	if (!found)
 	{
@@ -1909,11 +1955,12 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 		/* reset the statistics */
 		memset(&entry->counters, 0, sizeof(Counters));
 		/* set the appropriate initial usage count */
-		entry->counters.usage = sticky ? pgss->cur_median_usage : USAGE_INIT;
+		entry->counters.usage =
+			sticky ? pgss->partitions[partno].cur_median_usage : USAGE_INIT;
 		/* re-initialize the mutex each time ... we assume no one using it */
 		SpinLockInit(&entry->mutex);
 		/* ... and don't forget the query text metadata */
-		Assert(query_len >= 0);
+		Assert(query_len >= -1);
 		entry->query_offset = query_offset;
 		entry->query_len = query_len;
 		entry->encoding = encoding;
@@ -1940,40 +1987,40 @@ entry_cmp(const void *lhs, const void *rhs)
 }
 
 /*
- * Deallocate least-used entries.
+ * Deallocate least-used entries of one partition.
+ *
+ * Only the given partition is scanned, so that making room for a new entry
+ * doesn't block access to the rest of the hashtable, and costs time in
+ * proportion to the size of one partition rather than the whole table.
  *
- * Caller must hold an exclusive lock on pgss->lock.
+ * Caller must hold an exclusive lock on the partition, and at least a
+ * shared lock on pgss->lock.
  */
 static void
-entry_dealloc(void)
+entry_dealloc(int partno)
 {
+	HTAB	   *htab = pgss_hash[partno];
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry **entries;
 	pgssEntry  *entry;
 	int			nvictims;
 	int			i;
-	Size		tottextlen;
-	int			nvalidtexts;
+	Size		freed_text = 0;
 
 	/*
 	 * Sort entries by usage and deallocate USAGE_DEALLOC_PERCENT of them.
-	 * While we're scanning the table, apply the decay factor to the usage
-	 * values, and update the mean query length.
+	 * While we're scanning the partition, apply the decay factor to the
+	 * usage values.
 	 *
-	 * Note that the mean query length is almost immediately obsolete, since
-	 * we compute it before not after discarding the least-used entries.
-	 * Hopefully, that doesn't affect the mean too much; it doesn't seem worth
-	 * making two passes to get a more current result.  Likewise, the new
-	 * cur_median_usage includes the entries we're about to zap.
+	 * Note that the new cur_median_usage includes the entries we're about to
+	 * zap.
 	 */
 
-	entries = palloc(hash_get_num_entries(pgss_hash) * sizeof(pgssEntry *));
+	entries = palloc(hash_get_num_entries(htab) * sizeof(pgssEntry *));
 
 	i = 0;
-	tottextlen = 0;
-	nvalidtexts = 0;
 
-	hash_seq_init(&hash_seq, pgss_hash);
+	hash_seq_init(&hash_seq, htab);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
 		entries[i++] = entry;
@@ -1982,12 +2029,6 @@ entry_dealloc(void)
 			entry->counters.usage *= STICKY_DECREASE_FACTOR;
 		else
 			entry->counters.usage *= USAGE_DECREASE_FACTOR;
-		/* In the mean length computation, ignore dropped texts. */
-		if (entry->query_len >= 0)
-		{
-			tottextlen += entry->query_len + 1;
-			nvalidtexts++;
-		}
 	}
 
 	/* Sort into increasing order by usage */
@@ -1995,459 +2036,289 @@ entry_dealloc(void)
 
 	/* Record the (approximate) median usage */
 	if (i > 0)
-		pgss->cur_median_usage = entries[i / 2]->counters.usage;
-	/* Record the mean query length */
-	if (nvalidtexts > 0)
-		pgss->mean_query_len = tottextlen / nvalidtexts;
-	else
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		pgss->partitions[partno].cur_median_usage =
+			entries[i / 2]->counters.usage;
 
-	/* Now zap an appropriate fraction of lowest-usage entries */
-	nvictims = Max(10, i * USAGE_DEALLOC_PERCENT / 100);
+	/*
+	 * Now zap an appropriate fraction of lowest-usage entries.  The minimum
+	 * is scaled down along with the size of a partition.
+	 */
+	nvictims = Max(10 / PGSS_NUM_PARTITIONS + 1,
+				   i * USAGE_DEALLOC_PERCENT / 100);
 	nvictims = Min(nvictims, i);
 
 	for (i = 0; i < nvictims; i++)
 	{
-		hash_search(pgss_hash, &entries[i]->key, HASH_REMOVE, NULL);
+		if (entries[i]->query_len >= 0)
+			freed_text += entries[i]->query_len + 1;
+		hash_search(htab, &entries[i]->key, HASH_REMOVE, NULL);
 	}
 
 	pfree(entries);
 
-	/* Increment the number of times entries are deallocated */
+	/*
+	 * Account for the query texts that are no longer used, and increment the
+	 * number of times entries are deallocated
+	 */
 	{
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 
 		SpinLockAcquire(&s->mutex);
+		s->garbage += freed_text;
 		s->stats.dealloc += 1;
 		SpinLockRelease(&s->mutex);
 	}
 }
 
 /*
- * Given a query string (not necessarily null-terminated), allocate a new
- * entry in the external query text file and store the string there.
+ * Given a query string (not necessarily null-terminated), allocate space for
+ * it in the shared query text area and store the string there.
  *
- * If successful, returns true, and stores the new entry's offset in the file
- * into *query_offset.  Also, if gc_count isn't NULL, *gc_count is set to the
- * number of garbage collections that have occurred so far.
+ * If successful, returns true, and stores the string's offset in the area
+ * into *query_offset.
  *
- * On failure, returns false.
+ * Returns false if there isn't enough free space at the end of the area.
+ * The caller may then try again after compacting the area with
+ * qtext_compact(), if qtext_compact_worthwhile() says it'll help.
  *
  * At least a shared lock on pgss->lock must be held by the caller, so as
- * to prevent a concurrent garbage collection.  Share-lock-holding callers
- * should pass a gc_count pointer to obtain the number of garbage collections,
- * so that they can recheck the count after obtaining exclusive lock to
- * detect whether a garbage collection occurred (and removed this entry).
+ * to prevent a concurrent compaction.  The caller should continue to hold it
+ * until the text is referenced by a hashtable entry, since a compaction would
+ * otherwise discard it.
  */
 static bool
 qtext_store(const char *query, int query_len,
-			Size *query_offset, int *gc_count)
+			Size *query_offset)
 {
 	Size		off;
-	int			fd;
 
 	/*
-	 * We use a spinlock to protect extent/n_writers/gc_count, so that
-	 * multiple processes may execute this function concurrently.
+	 * We use a spinlock to protect extent, so that multiple processes may
+	 * reserve space concurrently.  Each then copies its string into its own
+	 * part of the area without holding the spinlock.
 	 */
 	{
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 
 		SpinLockAcquire(&s->mutex);
 		off = s->extent;
+		if (off + query_len + 1 > s->text_size)
+		{
+			SpinLockRelease(&s->mutex);
+			return false;
+		}
 		s->extent += query_len + 1;
-		s->n_writers++;
-		if (gc_count)
-			*gc_count = s->gc_count;
 		SpinLockRelease(&s->mutex);
 	}
 
-	*query_offset = off;
-
-	/* Now write the data into the successfully-reserved part of the file */
-	fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDWR | O_CREAT | PG_BINARY);
-	if (fd < 0)
-		goto error;
-
-	if (pg_pwrite(fd, query, query_len, off) != query_len)
-		goto error;
-	if (pg_pwrite(fd, "\0", 1, off + query_len) != 1)
-		goto error;
-
-	CloseTransientFile(fd);
-
-	/* Mark our write complete */
-	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
-
-		SpinLockAcquire(&s->mutex);
-		s->n_writers--;
-		SpinLockRelease(&s->mutex);
-	}
+	memcpy(pgss_texts + off, query, query_len);
+	pgss_texts[off + query_len] = '\0';
 
+	*query_offset = off;
 	return true;
-
-error:
-	ereport(LOG,
-			(errcode_for_file_access(),
-			 errmsg("could not write file \"%s\": %m",
-					PGSS_TEXT_FILE)));
-
-	if (fd >= 0)
-		CloseTransientFile(fd);
-
-	/* Mark our write complete */
-	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
-
-		SpinLockAcquire(&s->mutex);
-		s->n_writers--;
-		SpinLockRelease(&s->mutex);
-	}
-
-	return false;
 }
 
 /*
- * Read the external query text file into a malloc'd buffer.
- *
- * Returns NULL (without throwing an error) if unable to read, eg
- * file not there or insufficient memory.
- *
- * On success, the buffer size is also returned into *buffer_size.
- *
- * This can be called without any lock on pgss->lock, but in that case
- * the caller is responsible for verifying that the result is sane.
- */
-static char *
-qtext_load_file(Size *buffer_size)
-{
-	char	   *buf;
-	int			fd;
-	struct stat stat;
-
-	fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDONLY | PG_BINARY);
-	if (fd < 0)
-	{
-		if (errno != ENOENT)
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not read file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-		return NULL;
-	}
-
-	/* Get file length */
-	if (fstat(fd, &stat))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not stat file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	/* Allocate buffer; beware that off_t might be wider than size_t */
-	if (stat.st_size <= MaxAllocHugeSize)
-		buf = (char *) malloc(stat.st_size);
-	else
-		buf = NULL;
-	if (buf == NULL)
-	{
-		ereport(LOG,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("out of memory"),
-				 errdetail("Could not allocate enough memory to read file \"%s\".",
-						   PGSS_TEXT_FILE)));
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	/*
-	 * OK, slurp in the file.  If we get a short read and errno doesn't get
-	 * set, the reason is probably that garbage collection truncated the file
-	 * since we did the fstat(), so we don't log a complaint --- but we don't
-	 * return the data, either, since it's most likely corrupt due to
-	 * concurrent writes from garbage collection.
-	 */
-	errno = 0;
-	if (read(fd, buf, stat.st_size) != stat.st_size)
-	{
-		if (errno)
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not read file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-		free(buf);
-		CloseTransientFile(fd);
-		return NULL;
-	}
-
-	if (CloseTransientFile(fd) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close file \"%s\": %m", PGSS_TEXT_FILE)));
-
-	*buffer_size = stat.st_size;
-	return buf;
-}
-
-/*
- * Locate a query text in the file image previously read by qtext_load_file().
+ * Locate a query text in the shared query text area.
  *
  * We validate the given offset/length, and return NULL if bogus.  Otherwise,
- * the result points to a null-terminated string within the buffer.
+ * the result points to a null-terminated string within the area.
+ *
+ * Caller must hold at least a shared lock on pgss->lock, and must not use
+ * the result after releasing it.
  */
 static char *
-qtext_fetch(Size query_offset, int query_len,
-			char *buffer, Size buffer_size)
+qtext_fetch(Size query_offset, int query_len)
 {
-	/* File read failed? */
-	if (buffer == NULL)
+	/* Text dropped? */
+	if (query_len < 0)
 		return NULL;
 	/* Bogus offset/length? */
-	if (query_len < 0 ||
-		query_offset + query_len >= buffer_size)
+	if (query_offset + query_len >= pgss->text_size)
 		return NULL;
 	/* As a further sanity check, make sure there's a trailing null */
-	if (buffer[query_offset + query_len] != '\0')
+	if (pgss_texts[query_offset + query_len] != '\0')
 		return NULL;
 	/* Looks OK */
-	return buffer + query_offset;
+	return pgss_texts + query_offset;
 }
 
 /*
- * Do we need to garbage-collect the external query text file?
+ * Would compacting the query text area make room for a string of the given
+ * length?
  *
- * Caller should hold at least a shared lock on pgss->lock.
+ * The count of unused bytes is an upper bound, since removing an entry that
+ * shares its text with another (see qtext_compact) counts the text as unused
+ * even though it isn't; in that case compaction may not free as much as we
+ * hope, but compaction resets the count, so we won't retry it pointlessly.
  */
 static bool
-need_gc_qtexts(void)
+qtext_compact_worthwhile(int query_len)
 {
-	Size		extent;
+	volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+	bool		result;
 
-	/* Read shared extent pointer */
-	{
-		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+	SpinLockAcquire(&s->mutex);
+	result = (s->garbage > 0 &&
+			  s->extent - s->garbage + query_len + 1 <= s->text_size);
+	SpinLockRelease(&s->mutex);
 
-		SpinLockAcquire(&s->mutex);
-		extent = s->extent;
-		SpinLockRelease(&s->mutex);
-	}
-
-	/* Don't proceed if file does not exceed 512 bytes per possible entry */
-	if (extent < 512 * pgss_max)
-		return false;
+	return result;
+}
 
-	/*
-	 * Don't proceed if file is less than about 50% bloat.  Nothing can or
-	 * should be done in the event of unusually large query texts accounting
-	 * for file's large size.  We go to the trouble of maintaining the mean
-	 * query length in order to prevent garbage collection from thrashing
-	 * uselessly.
-	 */
-	if (extent < pgss->mean_query_len * pgss_max * 2)
-		return false;
+/*
+ * qsort comparator for sorting entries into increasing query_offset order
+ */
+static int
+qtext_offset_cmp(const void *lhs, const void *rhs)
+{
+	Size		l_offset = (*(pgssEntry *const *) lhs)->query_offset;
+	Size		r_offset = (*(pgssEntry *const *) rhs)->query_offset;
 
-	return true;
+	if (l_offset < r_offset)
+		return -1;
+	else if (l_offset > r_offset)
+		return +1;
+	else
+		return 0;
 }
 
+/* Hashtable entry used by qtext_compact() to find duplicate texts */
+typedef struct pgssTextDup
+{
+	uint64		queryid;		/* hash key - MUST BE FIRST */
+	Size		query_offset;	/* new offset of the first text seen */
+	int			query_len;
+	int			encoding;
+} pgssTextDup;
+
 /*
- * Garbage-collect orphaned query texts in external file.
+ * Compact the shared query text area, squeezing out the texts of entries
+ * that no longer exist.
  *
- * This won't be called often in the typical case, since it's likely that
- * there won't be too much churn, and besides, a similar compaction process
- * occurs when serializing to disk at shutdown or as part of resetting.
- * Despite this, it seems prudent to plan for the edge case where the file
- * becomes unreasonably large, with no other method of compaction likely to
- * occur in the foreseeable future.
+ * While we're at it, entries with the same query identifier and the same
+ * text, which are common since the identifier doesn't depend on the user or
+ * database, are made to share a single copy of the text.  Such sharing is
+ * only ever set up here, and is preserved by later compactions, since
+ * entries sharing a text are adjacent in offset order.
  *
- * The caller must hold an exclusive lock on pgss->lock.
+ * Texts only ever move towards the start of the area, and we process them in
+ * order of their current offsets, so moving one text never overwrites a
+ * text we have yet to process.
  *
- * At the first sign of trouble we unlink the query text file to get a clean
- * slate (although existing statistics are retained), rather than risk
- * thrashing by allowing the same problem case to recur indefinitely.
+ * The caller must hold an exclusive lock on pgss->lock, which also allows
+ * us to scan the partitions without their locks.
  */
 static void
-gc_qtexts(void)
+qtext_compact(void)
 {
-	char	   *qbuffer;
-	Size		qbuffer_size;
-	FILE	   *qfile = NULL;
 	HASH_SEQ_STATUS hash_seq;
+	HASHCTL		ctl;
+	HTAB	   *dups;
+	pgssEntry **entries;
 	pgssEntry  *entry;
+	long		num_entries;
+	long		nvalid;
+	long		i;
+	int			partno;
 	Size		extent;
-	int			nentries;
+	Size		last_old_offset = 0;
+	Size		last_new_offset = 0;
 
-	/*
-	 * When called from pgss_store, some other session might have proceeded
-	 * with garbage collection in the no-lock-held interim of lock strength
-	 * escalation.  Check once more that this is actually necessary.
-	 */
-	if (!need_gc_qtexts())
-		return;
+	num_entries = 0;
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
+		num_entries += hash_get_num_entries(pgss_hash[partno]);
 
-	/*
-	 * Load the old texts file.  If we fail (out of memory, for instance),
-	 * invalidate query texts.  Hopefully this is rare.  It might seem better
-	 * to leave things alone on an OOM failure, but the problem is that the
-	 * file is only going to get bigger; hoping for a future non-OOM result is
-	 * risky and can easily lead to complete denial of service.
-	 */
-	qbuffer = qtext_load_file(&qbuffer_size);
-	if (qbuffer == NULL)
-		goto gc_fail;
+	entries = palloc(Max(num_entries, 1) * sizeof(pgssEntry *));
 
-	/*
-	 * We overwrite the query texts file in place, so as to reduce the risk of
-	 * an out-of-disk-space failure.  Since the file is guaranteed not to get
-	 * larger, this should always work on traditional filesystems; though we
-	 * could still lose on copy-on-write filesystems.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
+	nvalid = 0;
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto gc_fail;
+		hash_seq_init(&hash_seq, pgss_hash[partno]);
+		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		{
+			if (qtext_fetch(entry->query_offset, entry->query_len) != NULL)
+				entries[nvalid++] = entry;
+			else
+			{
+				/* Trouble ... drop the text */
+				entry->query_offset = 0;
+				entry->query_len = -1;
+			}
+		}
 	}
 
-	extent = 0;
-	nentries = 0;
+	qsort(entries, nvalid, sizeof(pgssEntry *), qtext_offset_cmp);
 
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	ctl.keysize = sizeof(uint64);
+	ctl.entrysize = sizeof(pgssTextDup);
+	ctl.hcxt = CurrentMemoryContext;
+	dups = hash_create("pg_stat_statements duplicate texts", Max(nvalid, 1),
+					   &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	extent = 0;
+	for (i = 0; i < nvalid; i++)
 	{
-		int			query_len = entry->query_len;
-		char	   *qry = qtext_fetch(entry->query_offset,
-									  query_len,
-									  qbuffer,
-									  qbuffer_size);
+		pgssTextDup *dup;
+		bool		found;
+
+		entry = entries[i];
 
-		if (qry == NULL)
+		/* Already sharing the previous entry's text? */
+		if (i > 0 && entry->query_offset == last_old_offset)
 		{
-			/* Trouble ... drop the text */
-			entry->query_offset = 0;
-			entry->query_len = -1;
-			/* entry will not be counted in mean query length computation */
+			entry->query_offset = last_new_offset;
 			continue;
 		}
-
-		if (fwrite(qry, 1, query_len + 1, qfile) != query_len + 1)
+		last_old_offset = entry->query_offset;
+
+		/* Same text as an earlier entry with the same query identifier? */
+		dup = (pgssTextDup *) hash_search(dups, &entry->key.queryid,
+										  HASH_ENTER, &found);
+		if (found &&
+			dup->query_len == entry->query_len &&
+			dup->encoding == entry->encoding &&
+			memcmp(pgss_texts + dup->query_offset,
+				   pgss_texts + entry->query_offset,
+				   entry->query_len) == 0)
 		{
-			ereport(LOG,
-					(errcode_for_file_access(),
-					 errmsg("could not write file \"%s\": %m",
-							PGSS_TEXT_FILE)));
-			hash_seq_term(&hash_seq);
-			goto gc_fail;
+			entry->query_offset = dup->query_offset;
+			last_new_offset = dup->query_offset;
+			continue;
 		}
 
+		memmove(pgss_texts + extent, pgss_texts + entry->query_offset,
+				entry->query_len + 1);
 		entry->query_offset = extent;
-		extent += query_len + 1;
-		nentries++;
-	}
+		last_new_offset = extent;
+		extent += entry->query_len + 1;
 
-	/*
-	 * Truncate away any now-unused space.  If this fails for some odd reason,
-	 * we log it, but there's no need to fail.
-	 */
-	if (ftruncate(fileno(qfile), extent) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-
-	if (FreeFile(qfile))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		qfile = NULL;
-		goto gc_fail;
+		if (!found)
+		{
+			dup->query_offset = entry->query_offset;
+			dup->query_len = entry->query_len;
+			dup->encoding = entry->encoding;
+		}
 	}
 
-	elog(DEBUG1, "pgss gc of queries file shrunk size from %zu to %zu",
-		 pgss->extent, extent);
-
-	/* Reset the shared extent pointer */
-	pgss->extent = extent;
-
-	/*
-	 * Also update the mean query length, to be sure that need_gc_qtexts()
-	 * won't still think we have a problem.
-	 */
-	if (nentries > 0)
-		pgss->mean_query_len = extent / nentries;
-	else
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
-
-	free(qbuffer);
-
-	/*
-	 * OK, count a garbage collection cycle.  (Note: even though we have
-	 * exclusive lock on pgss->lock, we must take pgss->mutex for this, since
-	 * other processes may examine gc_count while holding only the mutex.
-	 * Also, we have to advance the count *after* we've rewritten the file,
-	 * else other processes might not realize they read a stale file.)
-	 */
-	record_gc_qtexts();
-
-	return;
+	hash_destroy(dups);
+	pfree(entries);
 
-gc_fail:
-	/* clean up resources */
-	if (qfile)
-		FreeFile(qfile);
-	if (qbuffer)
-		free(qbuffer);
+	elog(DEBUG1, "pgss compaction of query texts shrunk size from %zu to %zu",
+		 pgss->extent, extent);
 
 	/*
-	 * Since the contents of the external file are now uncertain, mark all
-	 * hashtable entries as having invalid texts.
+	 * Reset the shared extent pointer.  (We hold exclusive lock, but others
+	 * may examine these while holding only the mutex.)
 	 */
-	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
-		entry->query_offset = 0;
-		entry->query_len = -1;
-	}
-
-	/*
-	 * Destroy the query text file and create a new, empty one
-	 */
-	(void) unlink(PGSS_TEXT_FILE);
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not recreate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-	else
-		FreeFile(qfile);
-
-	/* Reset the shared extent pointer */
-	pgss->extent = 0;
-
-	/* Reset mean_query_len to match the new state */
-	pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 
-	/*
-	 * Bump the GC count even though we failed.
-	 *
-	 * This is needed to make concurrent readers of file without any lock on
-	 * pgss->lock notice existence of new version of file.  Once readers
-	 * subsequently observe a change in GC count with pgss->lock held, that
-	 * forces a safe reopen of file.  Writers also require that we bump here,
-	 * of course.  (As required by locking protocol, readers and writers don't
-	 * trust earlier file contents until gc_count is found unchanged after
-	 * pgss->lock acquired in shared or exclusive mode respectively.)
-	 */
-	record_gc_qtexts();
+		SpinLockAcquire(&s->mutex);
+		s->extent = extent;
+		s->garbage = 0;
+		SpinLockRelease(&s->mutex);
+	}
 }
 
 /*
@@ -2458,18 +2329,28 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 {
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
-	FILE	   *qfile;
 	long		num_entries;
 	long		num_remove = 0;
 	pgssHashKey key;
+	uint32		hashcode;
+	int			partno;
 
-	if (!pgss || !pgss_hash)
+	if (!pgss || !pgss_hash[0])
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	/*
+	 * Lock out everyone else.  With pgss->lock held exclusively, there's no
+	 * deadlock risk in taking all the partition locks.
+	 */
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
-	num_entries = hash_get_num_entries(pgss_hash);
+	num_entries = 0;
+	for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
+	{
+		LWLockAcquire(pgss->partitions[partno].lock, LW_EXCLUSIVE);
+		num_entries += hash_get_num_entries(pgss_hash[partno]);
+	}
 
 	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0))
 	{
@@ -2481,41 +2362,65 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 
 		/* Remove the key if it exists, starting with the top-level entry  */
 		key.toplevel = false;
-		entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_REMOVE, NULL);
+		hashcode = pgss_hash_key(&key);
+		entry = (pgssEntry *)
+			hash_search_with_hash_value(pgss_hash[PGSS_PARTITION(hashcode)],
+										&key, hashcode, HASH_REMOVE, NULL);
 		if (entry)				/* found */
+		{
+			if (entry->query_len >= 0)
+				pgss->garbage += entry->query_len + 1;
 			num_remove++;
+		}
 
 		/* Also remove entries for top level statements */
 		key.toplevel = true;
 
 		/* Remove the key if exists */
-		entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_REMOVE, NULL);
+		hashcode = pgss_hash_key(&key);
+		entry = (pgssEntry *)
+			hash_search_with_hash_value(pgss_hash[PGSS_PARTITION(hashcode)],
+										&key, hashcode, HASH_REMOVE, NULL);
 		if (entry)				/* found */
+		{
+			if (entry->query_len >= 0)
+				pgss->garbage += entry->query_len + 1;
 			num_remove++;
+		}
 	}
 	else if (userid != 0 || dbid != 0 || queryid != UINT64CONST(0))
 	{
 		/* Remove entries corresponding to valid parameters. */
-		hash_seq_init(&hash_seq, pgss_hash);
-		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
 		{
-			if ((!userid || entry->key.userid == userid) &&
-				(!dbid || entry->key.dbid == dbid) &&
-				(!queryid || entry->key.queryid == queryid))
+			hash_seq_init(&hash_seq, pgss_hash[partno]);
+			while ((entry = hash_seq_search(&hash_seq)) != NULL)
 			{
-				hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
-				num_remove++;
+				if ((!userid || entry->key.userid == userid) &&
+					(!dbid || entry->key.dbid == dbid) &&
+					(!queryid || entry->key.queryid == queryid))
+				{
+					if (entry->query_len >= 0)
+						pgss->garbage += entry->query_len + 1;
+					hash_search(pgss_hash[partno], &entry->key,
+								HASH_REMOVE, NULL);
+					num_remove++;
+				}
 			}
 		}
 	}
 	else
 	{
 		/* Remove all entries. */
-		hash_seq_init(&hash_seq, pgss_hash);
-		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		for (partno = 0; partno < PGSS_NUM_PARTITIONS; partno++)
 		{
-			hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
-			num_remove++;
+			hash_seq_init(&hash_seq, pgss_hash[partno]);
+			while ((entry = hash_seq_search(&hash_seq)) != NULL)
+			{
+				hash_search(pgss_hash[partno], &entry->key,
+							HASH_REMOVE, NULL);
+				num_remove++;
+			}
 		}
 	}
 
@@ -2537,35 +2442,13 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 		SpinLockRelease(&s->mutex);
 	}
 
-	/*
-	 * Write new empty query file, perhaps even creating a new one to recover
-	 * if the file was missing.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not create file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto done;
-	}
-
-	/* If ftruncate fails, log it, but it's not a fatal problem */
-	if (ftruncate(fileno(qfile), 0) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-
-	FreeFile(qfile);
-
-done:
+	/* The query text area is now empty, too */
 	pgss->extent = 0;
-	/* This counts as a query text garbage collection for our purposes */
-	record_gc_qtexts();
+	pgss->garbage = 0;
 
 release_lock:
+	for (partno = PGSS_NUM_PARTITIONS; --partno >= 0;)
+		LWLockRelease(pgss->partitions[partno].lock);
 	LWLockRelease(pgss->lock);
 }
 
@@ -84,6 +84,8 @@ select count(*) > 0 from pg_visibility('matview_visibility_test');
 insert into regular_table values (1), (2);
 refresh materialized view matview_visibility_test;
 select count(*) > 0 from pg_visibility('matview_visibility_test');
+-- refresh writes frozen rows, so the new pages are all-visible, all-frozen
+select * from pg_visibility_map('matview_visibility_test');
 
 -- regular tables which are part of a partition *do* have visibility maps
 insert into test_partition values (1);
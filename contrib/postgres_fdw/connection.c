@@ -206,6 +206,9 @@ GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 		/* Process a pending asynchronous request if any. */
 		if (entry->state.pendingAreq)
 			process_pending_request(entry->state.pendingAreq);
+		/* Likewise for a pending modification. */
+		if (entry->state.pendingFmstate)
+			process_pending_modify(entry->state.pendingFmstate);
 		/* Start a new transaction or subtransaction if needed. */
 		begin_remote_xact(entry);
 	}
@@ -704,6 +707,9 @@ pgfdw_exec_query(PGconn *conn, const char *query, PgFdwConnState *state)
 	/* First, process a pending asynchronous request, if any. */
 	if (state && state->pendingAreq)
 		process_pending_request(state->pendingAreq);
+	/* Likewise for a pending modification. */
+	if (state && state->pendingFmstate)
+		process_pending_modify(state->pendingFmstate);
 
 	/*
 	 * Submit a query.  Since we don't use non-blocking mode, this also can
@@ -722,7 +728,8 @@ pgfdw_exec_query(PGconn *conn, const char *query, PgFdwConnState *state)
  * This function offers quick responsiveness by checking for any interruptions.
  *
  * This function emulates PQexec()'s behavior of returning the last result
- * when there are many.
+ * when there are many, and of returning as soon as a COPY FROM STDIN is
+ * ready for data.
  *
  * Caller is responsible for the error handling on the result.
  */
@@ -766,6 +773,10 @@ pgfdw_get_result(PGconn *conn, const char *query)
 
 			PQclear(last_res);
 			last_res = res;
+
+			/* The COPY can't complete until the caller sends the data. */
+			if (PQresultStatus(res) == PGRES_COPY_IN)
+				break;
 		}
 	}
 	PG_CATCH();
@@ -945,6 +956,7 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 
 		/* Reset state to show we're out of a transaction */
 		entry->xact_depth = 0;
+		entry->state.snapshot_imported = false;
 
 		/*
 		 * If the connection isn't in a good idle state, it is marked as
@@ -1354,6 +1366,18 @@ pgfdw_abort_cleanup(ConnCacheEntry *entry, const char *sql, bool toplevel)
 	/* Assume we might have lost track of prepared statements */
 	entry->have_error = true;
 
+	/*
+	 * If a modification left pipelined commands or a COPY in progress, we'd
+	 * have to read back their results before issuing anything else.  Don't
+	 * bother; the connection will be discarded.
+	 */
+	if (entry->state.pendingFmstate != NULL ||
+		PQpipelineStatus(entry->conn) != PQ_PIPELINE_OFF)
+	{
+		entry->state.pendingFmstate = NULL;
+		return;
+	}
+
 	/*
 	 * If a command has been submitted to the remote server by using an
 	 * asynchronous execution function, the command might not have yet
@@ -1904,6 +1904,44 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
+/*
+ * deparse remote COPY FROM STDIN statement
+ *
+ * The statement loads the non-generated columns among targetAttrs in text
+ * format, leaving generated columns to the remote server like
+ * deparseInsertSql.
+ */
+void
+deparseCopyFromSql(StringInfo buf, RangeTblEntry *rte,
+				   Index rtindex, Relation rel,
+				   List *targetAttrs)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	bool		first;
+	ListCell   *lc;
+
+	appendStringInfoString(buf, "COPY ");
+	deparseRelation(buf, rel);
+
+	first = true;
+	foreach(lc, targetAttrs)
+	{
+		int			attnum = lfirst_int(lc);
+
+		if (TupleDescAttr(tupdesc, attnum - 1)->attgenerated)
+			continue;
+
+		appendStringInfoString(buf, first ? "(" : ", ");
+		first = false;
+
+		deparseColumnRef(buf, rtindex, attnum, rte, false);
+	}
+	if (!first)
+		appendStringInfoChar(buf, ')');
+
+	appendStringInfoString(buf, " FROM STDIN");
+}
+
 /*
  * rebuild remote INSERT statement
  *
@@ -2266,6 +2304,49 @@ deparseAnalyzeSizeSql(StringInfo buf, Relation rel)
 	appendStringInfo(buf, "::pg_catalog.regclass) / %d", BLCKSZ);
 }
 
+/*
+ * Construct SELECT statement to set up a parallel scan of given relation.
+ *
+ * It returns the relation's relkind and its size in blocks, and, if
+ * export_snapshot is true, the exported snapshot of the remote transaction,
+ * unless that transaction has written anything.  The remote server must be
+ * at least 9.6 for the latter.
+ */
+void
+deparseParallelScanSetupSql(StringInfo buf, Relation rel, bool export_snapshot)
+{
+	StringInfoData relname;
+
+	/* We'll need the remote relation name as a literal. */
+	initStringInfo(&relname);
+	deparseRelation(&relname, rel);
+
+	appendStringInfo(buf, "SELECT relkind, pg_catalog.pg_relation_size(oid) / %d, ",
+					 BLCKSZ);
+	if (export_snapshot)
+		appendStringInfoString(buf, "CASE WHEN pg_catalog.txid_current_if_assigned() IS NULL THEN pg_catalog.pg_export_snapshot() END");
+	else
+		appendStringInfoString(buf, "NULL");
+	appendStringInfoString(buf, " FROM pg_catalog.pg_class WHERE oid = ");
+	deparseStringLiteral(buf, relname.data);
+	appendStringInfoString(buf, "::pg_catalog.regclass");
+}
+
+/*
+ * Append conditions restricting a parallel scan of a foreign table to a range
+ * of ctids, whose bounds are the remote parameters numbered paramno and
+ * paramno + 1, to a SELECT statement built by deparseSelectStmtForRel.
+ *
+ * has_where tells whether the statement already has a WHERE clause.  The
+ * statement must not have any clauses after that.
+ */
+void
+appendTidRangeConditions(StringInfo buf, bool has_where, int paramno)
+{
+	appendStringInfo(buf, " %s (ctid >= $%d::pg_catalog.tid) AND (ctid < $%d::pg_catalog.tid)",
+					 has_where ? "AND" : "WHERE", paramno, paramno + 1);
+}
+
 /*
  * Construct SELECT statement to acquire sample rows of given relation.
  *
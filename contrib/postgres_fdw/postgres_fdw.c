@@ -15,7 +15,9 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
+#include "access/xact.h"
 #include "access/table.h"
 #include "catalog/pg_class.h"
 #include "commands/defrem.h"
@@ -75,6 +77,8 @@ enum FdwScanPrivateIndex
 	FdwScanPrivateRetrievedAttrs,
 	/* Integer representing the desired fetch_size */
 	FdwScanPrivateFetchSize,
+	/* SELECT statement restricted to a range of ctids, or empty String */
+	FdwScanPrivateParallelSql,
 
 	/*
 	 * String describing join i.e. names of relations being joined and types
@@ -130,6 +134,36 @@ enum FdwDirectModifyPrivateIndex
 	FdwDirectModifyPrivateSetProcessed
 };
 
+/*
+ * Length of buffer for an exported snapshot identifier; they are much shorter
+ * in practice.
+ */
+#define PGFDW_SNAPSHOT_ID_LEN	64
+
+/*
+ * Number of ranges of blocks ("chunks") to divide a remote table into, per
+ * participant of a parallel scan.
+ */
+#define PGFDW_CHUNKS_PER_PARTICIPANT	4
+
+/*
+ * Shared state of a parallel foreign scan.
+ *
+ * The remote table is divided into chunks, which the participants claim one
+ * by one and scan with a cursor restricted by ctid.  All of them use the
+ * leader's remote snapshot, exported into snapshot_id.  If that couldn't be
+ * done, snapshot_id is empty and the leader scans everything by itself.  If
+ * the table can't be scanned by ctid, nchunks is 1 and one participant scans
+ * it all.
+ */
+typedef struct PgFdwParallelScanState
+{
+	pg_atomic_uint32 next_chunk;	/* next chunk to be claimed */
+	uint32		nchunks;		/* total number of chunks */
+	BlockNumber chunk_blocks;	/* blocks in each chunk, if nchunks > 1 */
+	char		snapshot_id[PGFDW_SNAPSHOT_ID_LEN]; /* leader's snapshot */
+} PgFdwParallelScanState;
+
 /*
  * Execution state of a foreign scan using postgres_fdw.
  */
@@ -166,6 +200,11 @@ typedef struct PgFdwScanState
 	/* for asynchronous execution */
 	bool		async_capable;	/* engage asynchronous-capable logic? */
 
+	/* for parallel scans */
+	char	   *parallel_query; /* SELECT restricted to a range of ctids */
+	PgFdwParallelScanState *pscan;	/* shared state, or NULL if not parallel */
+	uint32		cur_chunk;		/* chunk we're scanning */
+
 	/* working memory contexts */
 	MemoryContext batch_cxt;	/* context holding current batch of tuples */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
@@ -203,6 +242,12 @@ typedef struct PgFdwModifyState
 	/* batch operation stuff */
 	int			num_slots;		/* number of slots to insert */
 
+	/* pipelined UPDATE/DELETE and remote COPY stuff */
+	bool		use_pipeline;	/* send commands without awaiting results? */
+	int			num_pipelined;	/* number of commands awaiting results */
+	uint64	   *es_processed;	/* row count to correct, or NULL */
+	char	   *copy_query;		/* COPY command, if inserting by COPY */
+
 	/* working memory context */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
@@ -339,6 +384,20 @@ static void postgresBeginForeignScan(ForeignScanState *node, int eflags);
 static TupleTableSlot *postgresIterateForeignScan(ForeignScanState *node);
 static void postgresReScanForeignScan(ForeignScanState *node);
 static void postgresEndForeignScan(ForeignScanState *node);
+static bool postgresIsForeignScanParallelSafe(PlannerInfo *root,
+											  RelOptInfo *rel,
+											  RangeTblEntry *rte);
+static Size postgresEstimateDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt);
+static void postgresInitializeDSMForeignScan(ForeignScanState *node,
+											 ParallelContext *pcxt,
+											 void *coordinate);
+static void postgresReInitializeDSMForeignScan(ForeignScanState *node,
+											   ParallelContext *pcxt,
+											   void *coordinate);
+static void postgresInitializeWorkerForeignScan(ForeignScanState *node,
+												shm_toc *toc,
+												void *coordinate);
 static void postgresAddForeignUpdateTargets(PlannerInfo *root,
 											Index rtindex,
 											RangeTblEntry *target_rte,
@@ -445,6 +504,7 @@ static void adjust_foreign_grouping_path_cost(PlannerInfo *root,
 static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 									  EquivalenceClass *ec, EquivalenceMember *em,
 									  void *arg);
+static bool claim_parallel_chunk(PgFdwScanState *fsstate);
 static void create_cursor(ForeignScanState *node);
 static void fetch_more_data(ForeignScanState *node);
 static void close_cursor(PGconn *conn, unsigned int cursor_number,
@@ -466,6 +526,10 @@ static TupleTableSlot **execute_foreign_modify(EState *estate,
 											   TupleTableSlot **planSlots,
 											   int *numSlots);
 static void prepare_foreign_modify(PgFdwModifyState *fmstate);
+static void copy_foreign_rows(PgFdwModifyState *fmstate,
+							  TupleTableSlot **slots, int numSlots);
+static bool subplan_reads_foreign_rel(Plan *plan, Index rtindex,
+									  Oid serverid);
 static const char **convert_prep_stmt_params(PgFdwModifyState *fmstate,
 											 ItemPointer tupleid,
 											 TupleTableSlot **slots,
@@ -534,6 +598,7 @@ static void add_foreign_final_paths(PlannerInfo *root,
 									RelOptInfo *input_rel,
 									RelOptInfo *final_rel,
 									FinalPathExtraData *extra);
+static void add_foreign_path(RelOptInfo *rel, Path *path);
 static void apply_server_options(PgFdwRelationInfo *fpinfo);
 static void apply_table_options(PgFdwRelationInfo *fpinfo);
 static void merge_fdw_options(PgFdwRelationInfo *fpinfo,
@@ -560,6 +625,13 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	routine->ReScanForeignScan = postgresReScanForeignScan;
 	routine->EndForeignScan = postgresEndForeignScan;
 
+	/* Functions for parallel scans */
+	routine->IsForeignScanParallelSafe = postgresIsForeignScanParallelSafe;
+	routine->EstimateDSMForeignScan = postgresEstimateDSMForeignScan;
+	routine->InitializeDSMForeignScan = postgresInitializeDSMForeignScan;
+	routine->ReInitializeDSMForeignScan = postgresReInitializeDSMForeignScan;
+	routine->InitializeWorkerForeignScan = postgresInitializeWorkerForeignScan;
+
 	/* Functions for updating foreign tables */
 	routine->AddForeignUpdateTargets = postgresAddForeignUpdateTargets;
 	routine->PlanForeignModify = postgresPlanForeignModify;
@@ -641,8 +713,8 @@ postgresGetForeignRelSize(PlannerInfo *root,
 
 	/*
 	 * Extract user-settable option values.  Note that per-table settings of
-	 * use_remote_estimate, fetch_size and async_capable override per-server
-	 * settings of them, respectively.
+	 * use_remote_estimate, fetch_size, async_capable and parallel_scan
+	 * override per-server settings of them, respectively.
 	 */
 	fpinfo->use_remote_estimate = false;
 	fpinfo->fdw_startup_cost = DEFAULT_FDW_STARTUP_COST;
@@ -650,6 +722,7 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	fpinfo->shippable_extensions = NIL;
 	fpinfo->fetch_size = 100;
 	fpinfo->async_capable = false;
+	fpinfo->parallel_scan = false;
 
 	apply_server_options(fpinfo);
 	apply_table_options(fpinfo);
@@ -1037,7 +1110,53 @@ postgresGetForeignPaths(PlannerInfo *root,
 								   baserel->lateral_relids,
 								   NULL,	/* no extra plan */
 								   NIL);	/* no fdw_private list */
-	add_path(baserel, (Path *) path);
+	add_foreign_path(baserel, (Path *) path);
+
+	/*
+	 * If the parallel_scan option allows, also create a partial path, which
+	 * the participants of a parallel query scan together, each taking some
+	 * ranges of the remote table's blocks.  Estimate the number of workers
+	 * from the table's size like for a local table, and charge each for its
+	 * share of the rows as in cost_seqscan.
+	 */
+	if (fpinfo->parallel_scan && baserel->consider_parallel &&
+		baserel->lateral_relids == NULL)
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel, baserel->pages,
+												   -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			double		parallel_divisor = parallel_workers;
+			double		leader_contribution;
+
+			if (parallel_leader_participation)
+			{
+				leader_contribution = 1.0 - (0.3 * parallel_workers);
+				if (leader_contribution > 0)
+					parallel_divisor += leader_contribution;
+			}
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(fpinfo->rows /
+														 parallel_divisor),
+										   fpinfo->startup_cost,
+										   fpinfo->startup_cost +
+										   (fpinfo->total_cost -
+											fpinfo->startup_cost) /
+										   parallel_divisor,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+										   NIL);	/* no fdw_private list */
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
 
 	/* Add paths with pathkeys */
 	add_paths_with_pathkeys_for_rel(root, baserel, NULL);
@@ -1209,7 +1328,7 @@ postgresGetForeignPaths(PlannerInfo *root,
 									   param_info->ppi_req_outer,
 									   NULL,
 									   NIL);	/* no fdw_private list */
-		add_path(baserel, (Path *) path);
+		add_foreign_path(baserel, (Path *) path);
 	}
 }
 
@@ -1236,6 +1355,7 @@ postgresGetForeignPlan(PlannerInfo *root,
 	List	   *fdw_recheck_quals = NIL;
 	List	   *retrieved_attrs;
 	StringInfoData sql;
+	StringInfoData parallel_sql;
 	bool		has_final_sort = false;
 	bool		has_limit = false;
 	ListCell   *lc;
@@ -1405,13 +1525,31 @@ postgresGetForeignPlan(PlannerInfo *root,
 	/* Remember remote_exprs for possible use by postgresPlanDirectModify */
 	fpinfo->final_remote_exprs = remote_exprs;
 
+	/*
+	 * For a parallel scan, also build the query restricted to a range of
+	 * ctids, which are sent as two more parameters.  Partial paths have no
+	 * pathkeys, and no locking clause is needed in a parallel query, so the
+	 * query ends with its WHERE clause, if any.
+	 */
+	initStringInfo(&parallel_sql);
+	if (best_path->path.parallel_aware)
+	{
+		Assert(IS_SIMPLE_REL(foreignrel));
+		Assert(best_path->path.pathkeys == NIL && !has_limit);
+
+		appendStringInfoString(&parallel_sql, sql.data);
+		appendTidRangeConditions(&parallel_sql, remote_exprs != NIL,
+								 list_length(params_list) + 1);
+	}
+
 	/*
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match order in enum FdwScanPrivateIndex.
 	 */
-	fdw_private = list_make3(makeString(sql.data),
+	fdw_private = list_make4(makeString(sql.data),
 							 retrieved_attrs,
-							 makeInteger(fpinfo->fetch_size));
+							 makeInteger(fpinfo->fetch_size),
+							 makeString(parallel_sql.data));
 	if (IS_JOIN_REL(foreignrel) || IS_UPPER_REL(foreignrel))
 		fdw_private = lappend(fdw_private,
 							  makeString(fpinfo->relation_name));
@@ -1547,6 +1685,8 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 												 FdwScanPrivateRetrievedAttrs);
 	fsstate->fetch_size = intVal(list_nth(fsplan->fdw_private,
 										  FdwScanPrivateFetchSize));
+	fsstate->parallel_query = strVal(list_nth(fsplan->fdw_private,
+											  FdwScanPrivateParallelSql));
 
 	/* Create contexts for batches of tuples and per-tuple temp workspace. */
 	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
@@ -1608,7 +1748,12 @@ postgresIterateForeignScan(ForeignScanState *node)
 	 * first call after Begin or ReScan.
 	 */
 	if (!fsstate->cursor_exists)
+	{
+		/* In a parallel scan, begin with a chunk of our own, if any remain. */
+		if (fsstate->pscan && !claim_parallel_chunk(fsstate))
+			return ExecClearTuple(slot);
 		create_cursor(node);
+	}
 
 	/*
 	 * Get some more tuples, if we've run out.
@@ -1621,9 +1766,33 @@ postgresIterateForeignScan(ForeignScanState *node)
 		/* No point in another fetch if we already detected EOF, though. */
 		if (!fsstate->eof_reached)
 			fetch_more_data(node);
-		/* If we didn't get any tuples, must be end of data. */
-		if (fsstate->next_tuple >= fsstate->num_tuples)
-			return ExecClearTuple(slot);
+
+		/*
+		 * If we didn't get any tuples, must be end of data.  In a parallel
+		 * scan, that's just the end of our chunk; move on to the next one.
+		 */
+		while (fsstate->next_tuple >= fsstate->num_tuples)
+		{
+			if (fsstate->pscan == NULL)
+			{
+				/*
+				 * If we're feeding a modification of our table, which
+				 * pipelines its commands, let them complete before it sees
+				 * the end of its rows.  See postgresBeginForeignModify.
+				 */
+				if (fsstate->conn_state->pendingFmstate)
+					process_pending_modify(fsstate->conn_state->pendingFmstate);
+				return ExecClearTuple(slot);
+			}
+
+			close_cursor(fsstate->conn, fsstate->cursor_number,
+						 fsstate->conn_state);
+			fsstate->cursor_exists = false;
+			if (!claim_parallel_chunk(fsstate))
+				return ExecClearTuple(slot);
+			create_cursor(node);
+			fetch_more_data(node);
+		}
 	}
 
 	/*
@@ -1655,9 +1824,10 @@ postgresReScanForeignScan(ForeignScanState *node)
 	 * If any internal parameters affecting this node have changed, we'd
 	 * better destroy and recreate the cursor.  Otherwise, rewinding it should
 	 * be good enough.  If we've only fetched zero or one batch, we needn't
-	 * even rewind the cursor, just rescan what we have.
+	 * even rewind the cursor, just rescan what we have.  A parallel scan
+	 * starts afresh with whatever chunks it gets.
 	 */
-	if (node->ss.ps.chgParam != NULL)
+	if (node->ss.ps.chgParam != NULL || fsstate->pscan != NULL)
 	{
 		fsstate->cursor_exists = false;
 		snprintf(sql, sizeof(sql), "CLOSE c%u",
@@ -1717,6 +1887,201 @@ postgresEndForeignScan(ForeignScanState *node)
 	/* MemoryContexts will be deleted automatically. */
 }
 
+/*
+ * postgresIsForeignScanParallelSafe
+ *		Determine whether a foreign table may be scanned in parallel mode
+ *
+ * That's up to the parallel_scan option.  Note that only the partial paths
+ * created by postgresGetForeignPaths are really safe to run in a worker; see
+ * add_foreign_path.
+ */
+static bool
+postgresIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								  RangeTblEntry *rte)
+{
+	ForeignTable *table = GetForeignTable(rte->relid);
+	ForeignServer *server = GetForeignServer(table->serverid);
+	bool		parallel_scan = false;
+	ListCell   *lc;
+
+	/* The table-level setting overrides the server-level one. */
+	foreach(lc, server->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+			parallel_scan = defGetBoolean(def);
+	}
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+			parallel_scan = defGetBoolean(def);
+	}
+
+	return parallel_scan;
+}
+
+/*
+ * postgresEstimateDSMForeignScan
+ *		Estimate space needed for the shared state of a parallel scan
+ */
+static Size
+postgresEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(PgFdwParallelScanState);
+}
+
+/*
+ * postgresInitializeDSMForeignScan
+ *		Set up the shared state of a parallel scan
+ *
+ * We ask the remote server how big the table is, to divide it into chunks,
+ * and export the snapshot of our remote transaction for the workers.  That
+ * snapshot wouldn't show them what the transaction has itself written, so
+ * in that case we don't share it, nor if we're in a subtransaction, which
+ * can't export one.  The leader then has to do the whole scan.
+ */
+static void
+postgresInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								 void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+	PGconn	   *conn = fsstate->conn;
+	PGresult   *volatile res = NULL;
+	StringInfoData sql;
+	char		relkind;
+	BlockNumber nblocks;
+
+	pg_atomic_init_u32(&pscan->next_chunk, 0);
+	pscan->nchunks = 1;
+	pscan->chunk_blocks = 0;
+	pscan->snapshot_id[0] = '\0';
+	fsstate->pscan = pscan;
+
+	/* First, process a pending asynchronous request, if any. */
+	if (fsstate->conn_state->pendingAreq)
+		process_pending_request(fsstate->conn_state->pendingAreq);
+	/* Likewise for a pending modification. */
+	if (fsstate->conn_state->pendingFmstate)
+		process_pending_modify(fsstate->conn_state->pendingFmstate);
+
+	initStringInfo(&sql);
+	deparseParallelScanSetupSql(&sql, fsstate->rel,
+								GetCurrentTransactionNestLevel() == 1 &&
+								PQserverVersion(conn) >= 90600);
+
+	/* In what follows, do not risk leaking any PGresults. */
+	PG_TRY();
+	{
+		res = pgfdw_exec_query(conn, sql.data, NULL);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pgfdw_report_error(ERROR, res, conn, false, sql.data);
+
+		if (PQntuples(res) != 1 || PQnfields(res) != 3)
+			elog(ERROR, "unexpected result from deparseParallelScanSetupSql query");
+		relkind = *PQgetvalue(res, 0, 0);
+		nblocks = strtoul(PQgetvalue(res, 0, 1), NULL, 10);
+		if (!PQgetisnull(res, 0, 2))
+			strlcpy(pscan->snapshot_id, PQgetvalue(res, 0, 2),
+					PGFDW_SNAPSHOT_ID_LEN);
+	}
+	PG_FINALLY();
+	{
+		if (res)
+			PQclear(res);
+	}
+	PG_END_TRY();
+
+	if (pscan->snapshot_id[0] == '\0')
+	{
+		/* Nobody would scan the table if the leader doesn't take part. */
+		if (!parallel_leader_participation)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot share the remote snapshot of foreign table \"%s\" with parallel workers",
+							RelationGetRelationName(fsstate->rel)),
+					 errdetail("The remote transaction has modified data, or is in a subtransaction."),
+					 errhint("Enable parallel_leader_participation, or disable the parallel_scan option.")));
+		return;
+	}
+
+	/*
+	 * Divide the table into chunks, if it's a table at all and the remote
+	 * server can scan it by ranges of ctids efficiently.
+	 */
+	if ((relkind == RELKIND_RELATION || relkind == RELKIND_MATVIEW) &&
+		PQserverVersion(conn) >= 140000)
+	{
+		BlockNumber chunk_blocks;
+
+		chunk_blocks = nblocks / ((pcxt->nworkers + 1) *
+								  PGFDW_CHUNKS_PER_PARTICIPANT);
+		chunk_blocks = Max(chunk_blocks, 1);
+		if (nblocks > chunk_blocks)
+		{
+			pscan->chunk_blocks = chunk_blocks;
+			pscan->nchunks = (nblocks + chunk_blocks - 1) / chunk_blocks;
+		}
+	}
+}
+
+/*
+ * postgresReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan for a rescan
+ */
+static void
+postgresReInitializeDSMForeignScan(ForeignScanState *node,
+								   ParallelContext *pcxt, void *coordinate)
+{
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+
+	/* The shared snapshot stays valid as long as our remote transaction. */
+	pg_atomic_write_u32(&pscan->next_chunk, 0);
+}
+
+/*
+ * postgresInitializeWorkerForeignScan
+ *		Attach to the shared state of a parallel scan, in a worker
+ *
+ * Our remote transaction must use the leader's snapshot, which has to be set
+ * before it runs any query.  Another parallel scan in the same worker might
+ * have done so already.
+ */
+static void
+postgresInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+									void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+
+	fsstate->pscan = pscan;
+
+	if (pscan->snapshot_id[0] != '\0' &&
+		!fsstate->conn_state->snapshot_imported)
+	{
+		StringInfoData sql;
+		PGresult   *res;
+
+		initStringInfo(&sql);
+		appendStringInfoString(&sql, "SET TRANSACTION SNAPSHOT ");
+		deparseStringLiteral(&sql, pscan->snapshot_id);
+
+		/*
+		 * We don't use a PG_TRY block here, so be careful not to throw error
+		 * without releasing the PGresult.
+		 */
+		res = pgfdw_exec_query(fsstate->conn, sql.data, fsstate->conn_state);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(ERROR, res, fsstate->conn, true, sql.data);
+		PQclear(res);
+
+		fsstate->conn_state->snapshot_imported = true;
+	}
+}
+
 /*
  * postgresAddForeignUpdateTargets
  *		Add resjunk column(s) needed for update/delete on a foreign table
@@ -1937,6 +2302,28 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 									has_returning,
 									retrieved_attrs);
 
+	/*
+	 * UPDATE and DELETE commands can be pipelined, up to batch_size of them,
+	 * if nothing needs their results one row at a time.  That leaves the
+	 * number of rows actually modified, for the command's row count, to be
+	 * determined when we collect the results.  To have that done before
+	 * ModifyTable finishes, we insist that the rows to modify come
+	 * straight from a synchronous scan over the same connection, which
+	 * waits for any pipelined commands before reporting the end of its data.
+	 */
+	if ((mtstate->operation == CMD_UPDATE ||
+		 mtstate->operation == CMD_DELETE) &&
+		!has_returning && fmstate->batch_size > 1 &&
+		mtstate->mt_transition_capture == NULL &&
+		subplan_reads_foreign_rel(outerPlanState(mtstate)->plan,
+								  resultRelInfo->ri_RangeTableIndex,
+								  GetForeignTable(rte->relid)->serverid))
+	{
+		fmstate->use_pipeline = true;
+		if (mtstate->canSetTag)
+			fmstate->es_processed = &mtstate->ps.state->es_processed;
+	}
+
 	resultRelInfo->ri_FdwState = fmstate;
 }
 
@@ -2222,6 +2609,18 @@ postgresBeginForeignInsert(ModifyTableState *mtstate,
 									retrieved_attrs != NIL,
 									retrieved_attrs);
 
+	/*
+	 * With batch_size greater than one, COPY FROM streams the rows into a
+	 * remote COPY instead of inserting them in batches, which it doesn't do.
+	 * That's impossible if we need RETURNING data for each row.
+	 */
+	if (plan == NULL && retrieved_attrs == NIL && fmstate->batch_size > 1)
+	{
+		initStringInfo(&sql);
+		deparseCopyFromSql(&sql, rte, resultRelation, rel, targetAttrs);
+		fmstate->copy_query = sql.data;
+	}
+
 	/*
 	 * If the given resultRelInfo already has PgFdwModifyState set, it means
 	 * the foreign table is an UPDATE subplan result rel; in which case, store
@@ -2884,7 +3283,10 @@ postgresExplainForeignScan(ForeignScanState *node, ExplainState *es)
 	{
 		char	   *sql;
 
-		sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
+		if (plan->scan.plan.parallel_aware)
+			sql = strVal(list_nth(fdw_private, FdwScanPrivateParallelSql));
+		else
+			sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
 		ExplainPropertyText("Remote SQL", sql, es);
 	}
 }
@@ -3676,8 +4078,36 @@ ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * Claim the next chunk of a parallel scan, returning false if none is left.
+ */
+static bool
+claim_parallel_chunk(PgFdwScanState *fsstate)
+{
+	PgFdwParallelScanState *pscan = fsstate->pscan;
+	uint32		chunk;
+
+	/* Without the leader's snapshot, workers mustn't scan anything. */
+	if (pscan->snapshot_id[0] == '\0' && IsParallelWorker())
+		return false;
+
+	/* Avoid advancing the counter indefinitely once we're done. */
+	if (pg_atomic_read_u32(&pscan->next_chunk) >= pscan->nchunks)
+		return false;
+
+	chunk = pg_atomic_fetch_add_u32(&pscan->next_chunk, 1);
+	if (chunk >= pscan->nchunks)
+		return false;
+
+	fsstate->cur_chunk = chunk;
+	return true;
+}
+
 /*
  * Create cursor for node's query with current parameter values.
+ *
+ * In a parallel scan of a table divided into chunks, the cursor covers just
+ * the chunk we've claimed.
  */
 static void
 create_cursor(ForeignScanState *node)
@@ -3686,6 +4116,7 @@ create_cursor(ForeignScanState *node)
 	ExprContext *econtext = node->ss.ps.ps_ExprContext;
 	int			numParams = fsstate->numParams;
 	const char **values = fsstate->param_values;
+	const char *query = fsstate->query;
 	PGconn	   *conn = fsstate->conn;
 	StringInfoData buf;
 	PGresult   *res;
@@ -3693,6 +4124,9 @@ create_cursor(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (fsstate->conn_state->pendingAreq)
 		process_pending_request(fsstate->conn_state->pendingAreq);
+	/* Likewise for a pending modification. */
+	if (fsstate->conn_state->pendingFmstate)
+		process_pending_modify(fsstate->conn_state->pendingFmstate);
 
 	/*
 	 * Construct array of query parameter values in text format.  We do the
@@ -3713,10 +4147,40 @@ create_cursor(ForeignScanState *node)
 		MemoryContextSwitchTo(oldcontext);
 	}
 
+	/* Add the bounds of our chunk, if any, as two more parameters. */
+	if (fsstate->pscan && fsstate->pscan->nchunks > 1)
+	{
+		PgFdwParallelScanState *pscan = fsstate->pscan;
+		BlockNumber start = fsstate->cur_chunk * pscan->chunk_blocks;
+		BlockNumber end;
+		const char **chunk_values;
+		MemoryContext oldcontext;
+
+		/* The last chunk extends indefinitely. */
+		if (fsstate->cur_chunk == pscan->nchunks - 1)
+			end = InvalidBlockNumber;
+		else
+			end = start + pscan->chunk_blocks;
+
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+		chunk_values = (const char **) palloc((numParams + 2) * sizeof(char *));
+		if (numParams > 0)
+			memcpy(chunk_values, values, numParams * sizeof(char *));
+		chunk_values[numParams] = psprintf("(%u,0)", start);
+		chunk_values[numParams + 1] = psprintf("(%u,0)", end);
+
+		MemoryContextSwitchTo(oldcontext);
+
+		query = fsstate->parallel_query;
+		values = chunk_values;
+		numParams += 2;
+	}
+
 	/* Construct the DECLARE CURSOR command */
 	initStringInfo(&buf);
 	appendStringInfo(&buf, "DECLARE c%u CURSOR FOR\n%s",
-					 fsstate->cursor_number, fsstate->query);
+					 fsstate->cursor_number, query);
 
 	/*
 	 * Notice that we pass NULL for paramTypes, thus forcing the remote server
@@ -3737,7 +4201,7 @@ create_cursor(ForeignScanState *node)
 	 */
 	res = pgfdw_get_result(conn, buf.data);
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		pgfdw_report_error(ERROR, res, conn, true, fsstate->query);
+		pgfdw_report_error(ERROR, res, conn, true, query);
 	PQclear(res);
 
 	/* Mark the cursor as created, and show no tuples have been retrieved */
@@ -4024,9 +4488,11 @@ create_foreign_modify(EState *estate,
 
 	Assert(fmstate->p_nums <= n_params);
 
-	/* Set batch_size from foreign server/table options. */
-	if (operation == CMD_INSERT)
-		fmstate->batch_size = get_batch_size_option(rel);
+	/*
+	 * Set batch_size from foreign server/table options.  It also allows
+	 * UPDATE and DELETE to be pipelined.
+	 */
+	fmstate->batch_size = get_batch_size_option(rel);
 
 	fmstate->num_slots = 1;
 
@@ -4066,6 +4532,18 @@ execute_foreign_modify(EState *estate,
 	/* First, process a pending asynchronous request, if any. */
 	if (fmstate->conn_state->pendingAreq)
 		process_pending_request(fmstate->conn_state->pendingAreq);
+	/* Likewise for another modification, but not our own. */
+	if (fmstate->conn_state->pendingFmstate &&
+		fmstate->conn_state->pendingFmstate != fmstate)
+		process_pending_modify(fmstate->conn_state->pendingFmstate);
+
+	/* Rows to insert may go to a remote COPY instead. */
+	if (fmstate->copy_query)
+	{
+		Assert(operation == CMD_INSERT);
+		copy_foreign_rows(fmstate, slots, *numSlots);
+		return slots;
+	}
 
 	/*
 	 * If the existing query was deparsed and prepared for a different number
@@ -4112,6 +4590,15 @@ execute_foreign_modify(EState *estate,
 	/* Convert parameters needed by prepared statement to text form */
 	p_values = convert_prep_stmt_params(fmstate, ctid, slots, *numSlots);
 
+	/* Enter pipeline mode for the first of a run of pipelined commands. */
+	if (fmstate->use_pipeline && fmstate->conn_state->pendingFmstate == NULL)
+	{
+		if (!PQenterPipelineMode(fmstate->conn))
+			pgfdw_report_error(ERROR, NULL, fmstate->conn, false,
+							   fmstate->query);
+		fmstate->conn_state->pendingFmstate = fmstate;
+	}
+
 	/*
 	 * Execute the prepared statement.
 	 */
@@ -4124,6 +4611,23 @@ execute_foreign_modify(EState *estate,
 							 0))
 		pgfdw_report_error(ERROR, NULL, fmstate->conn, false, fmstate->query);
 
+	/*
+	 * If pipelining, don't wait for the result unless the pipeline is full.
+	 * Report the row as modified; process_pending_modify corrects the row
+	 * count if it wasn't.
+	 */
+	if (fmstate->use_pipeline)
+	{
+		Assert(*numSlots == 1);
+
+		MemoryContextReset(fmstate->temp_cxt);
+
+		if (++fmstate->num_pipelined >= fmstate->batch_size)
+			process_pending_modify(fmstate);
+
+		return slots;
+	}
+
 	/*
 	 * Get the result, and check for success.
 	 *
@@ -4159,6 +4663,223 @@ execute_foreign_modify(EState *estate,
 	return (n_rows > 0) ? slots : NULL;
 }
 
+/*
+ * copy_foreign_rows
+ *		Send rows to insert to the remote COPY of a foreign insert, starting
+ *		the COPY if it isn't running
+ *
+ * The COPY stays open until something else needs the connection, or the
+ * insert finishes; process_pending_modify ends it then.
+ */
+static void
+copy_foreign_rows(PgFdwModifyState *fmstate, TupleTableSlot **slots,
+				  int numSlots)
+{
+	PGconn	   *conn = fmstate->conn;
+	const char **p_values;
+	StringInfoData buf;
+	MemoryContext oldcontext;
+	int			pindex = 0;
+	int			i;
+	int			j;
+
+	if (fmstate->conn_state->pendingFmstate != fmstate)
+	{
+		PGresult   *res;
+
+		/*
+		 * We don't use a PG_TRY block here, so be careful not to throw error
+		 * without releasing the PGresult.
+		 */
+		res = pgfdw_exec_query(conn, fmstate->copy_query, fmstate->conn_state);
+		if (PQresultStatus(res) != PGRES_COPY_IN)
+			pgfdw_report_error(ERROR, res, conn, true, fmstate->copy_query);
+		PQclear(res);
+
+		fmstate->conn_state->pendingFmstate = fmstate;
+	}
+
+	/* Convert the values to text form */
+	p_values = convert_prep_stmt_params(fmstate, NULL, slots, numSlots);
+
+	/*
+	 * Build lines of COPY text format data, escaping the characters that
+	 * COPY would otherwise take for delimiters.
+	 */
+	oldcontext = MemoryContextSwitchTo(fmstate->temp_cxt);
+	initStringInfo(&buf);
+	for (i = 0; i < numSlots; i++)
+	{
+		for (j = 0; j < fmstate->p_nums; j++)
+		{
+			const char *value = p_values[pindex++];
+
+			if (j > 0)
+				appendStringInfoChar(&buf, '\t');
+			if (value == NULL)
+			{
+				appendStringInfoString(&buf, "\\N");
+				continue;
+			}
+			for (; *value; value++)
+			{
+				switch (*value)
+				{
+					case '\\':
+						appendStringInfoString(&buf, "\\\\");
+						break;
+					case '\n':
+						appendStringInfoString(&buf, "\\n");
+						break;
+					case '\r':
+						appendStringInfoString(&buf, "\\r");
+						break;
+					case '\t':
+						appendStringInfoString(&buf, "\\t");
+						break;
+					default:
+						appendStringInfoChar(&buf, *value);
+						break;
+				}
+			}
+		}
+		appendStringInfoChar(&buf, '\n');
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	if (PQputCopyData(conn, buf.data, buf.len) != 1)
+		pgfdw_report_error(ERROR, NULL, conn, false, fmstate->copy_query);
+
+	MemoryContextReset(fmstate->temp_cxt);
+}
+
+/*
+ * Finish a modification that has pipelined commands or a COPY pending on
+ * its connection, so that the connection can be used for something else.
+ *
+ * Pipelined commands report errors only now.  A command that turns out not
+ * to have modified its row is taken off the command's row count, which we
+ * reported it in.
+ */
+void
+process_pending_modify(PgFdwModifyState *fmstate)
+{
+	PGconn	   *conn = fmstate->conn;
+	PGresult   *volatile res = NULL;
+
+	Assert(fmstate->conn_state->pendingFmstate == fmstate);
+
+	if (fmstate->copy_query)
+	{
+		if (PQputCopyEnd(conn, NULL) != 1)
+			pgfdw_report_error(ERROR, NULL, conn, false, fmstate->copy_query);
+
+		/*
+		 * We don't use a PG_TRY block here, so be careful not to throw error
+		 * without releasing the PGresult.
+		 */
+		res = pgfdw_get_result(conn, fmstate->copy_query);
+		fmstate->conn_state->pendingFmstate = NULL;
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(ERROR, res, conn, true, fmstate->copy_query);
+		PQclear(res);
+		return;
+	}
+
+	Assert(fmstate->use_pipeline);
+
+	/*
+	 * Collect the results of all the commands, keeping the first error, if
+	 * any, to report once we're out of pipeline mode.  The commands after a
+	 * failed one are skipped.
+	 */
+	PG_TRY();
+	{
+		uint64		n_unmodified = 0;
+		int			i;
+
+		if (!PQpipelineSync(conn))
+			pgfdw_report_error(ERROR, NULL, conn, false, fmstate->query);
+
+		for (i = 0; i < fmstate->num_pipelined; i++)
+		{
+			PGresult   *cmdres = pgfdw_get_result(conn, fmstate->query);
+
+			if (PQresultStatus(cmdres) == PGRES_COMMAND_OK)
+			{
+				if (atoi(PQcmdTuples(cmdres)) == 0)
+					n_unmodified++;
+				PQclear(cmdres);
+			}
+			else if (res == NULL)
+				res = cmdres;
+			else
+				PQclear(cmdres);
+		}
+		fmstate->num_pipelined = 0;
+
+		/* Absorb the result of the sync, then leave pipeline mode. */
+		PQclear(pgfdw_get_result(conn, fmstate->query));
+		if (!PQexitPipelineMode(conn))
+			pgfdw_report_error(ERROR, NULL, conn, false, fmstate->query);
+		fmstate->conn_state->pendingFmstate = NULL;
+
+		if (fmstate->es_processed)
+			*fmstate->es_processed -= n_unmodified;
+	}
+	PG_CATCH();
+	{
+		if (res)
+			PQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	if (res)
+		pgfdw_report_error(ERROR, res, conn, true, fmstate->query);
+}
+
+/*
+ * subplan_reads_foreign_rel
+ *		Does plan produce rows from a synchronous scan of the given foreign
+ *		table on the given server, and nothing else?
+ *
+ * Other children of an Append are fine, as they produce rows for other
+ * result relations.
+ */
+static bool
+subplan_reads_foreign_rel(Plan *plan, Index rtindex, Oid serverid)
+{
+	ListCell   *lc;
+
+	switch (nodeTag(plan))
+	{
+		case T_ForeignScan:
+			{
+				ForeignScan *fscan = (ForeignScan *) plan;
+
+				return fscan->fs_server == serverid &&
+					bms_is_member(rtindex, fscan->fs_relids) &&
+					!plan->async_capable;
+			}
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+			{
+				if (subplan_reads_foreign_rel((Plan *) lfirst(lc), rtindex,
+											  serverid))
+					return true;
+			}
+			return false;
+		case T_Result:
+			if (outerPlan(plan))
+				return subplan_reads_foreign_rel(outerPlan(plan), rtindex,
+												 serverid);
+			return false;
+		default:
+			return false;
+	}
+}
+
 /*
  * prepare_foreign_modify
  *		Establish a prepared statement for execution of INSERT/UPDATE/DELETE
@@ -4336,6 +5057,10 @@ finish_foreign_modify(PgFdwModifyState *fmstate)
 {
 	Assert(fmstate != NULL);
 
+	/* Collect results of pipelined commands, or end our COPY */
+	if (fmstate->conn_state->pendingFmstate == fmstate)
+		process_pending_modify(fmstate);
+
 	/* If we created a prepared statement, destroy it */
 	deallocate_query(fmstate);
 
@@ -4516,6 +5241,9 @@ execute_dml_stmt(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (dmstate->conn_state->pendingAreq)
 		process_pending_request(dmstate->conn_state->pendingAreq);
+	/* Likewise for a pending modification. */
+	if (dmstate->conn_state->pendingFmstate)
+		process_pending_modify(dmstate->conn_state->pendingFmstate);
 
 	/*
 	 * Construct array of query parameter values in text format.
@@ -5793,7 +6521,7 @@ add_paths_with_pathkeys_for_rel(PlannerInfo *root, RelOptInfo *rel,
 								 -1.0);
 
 		if (IS_SIMPLE_REL(rel))
-			add_path(rel, (Path *)
+			add_foreign_path(rel, (Path *)
 					 create_foreignscan_path(root, rel,
 											 NULL,
 											 rows,
@@ -5804,7 +6532,7 @@ add_paths_with_pathkeys_for_rel(PlannerInfo *root, RelOptInfo *rel,
 											 sorted_epq_path,
 											 NIL));
 		else
-			add_path(rel, (Path *)
+			add_foreign_path(rel, (Path *)
 					 create_foreign_join_path(root, rel,
 											  NULL,
 											  rows,
@@ -5817,6 +6545,23 @@ add_paths_with_pathkeys_for_rel(PlannerInfo *root, RelOptInfo *rel,
 	}
 }
 
+/*
+ * add_foreign_path
+ *		add_path() for paths of ours other than partial paths
+ *
+ * With the parallel_scan option, the core planner considers our base rels,
+ * and joins and upper rels including them, as safe to scan in parallel mode.
+ * But only a parallel-aware scan shares the leader's remote snapshot with the
+ * workers, so any other remote query might see different data if run in a
+ * worker.  Mark such paths parallel-restricted.
+ */
+static void
+add_foreign_path(RelOptInfo *rel, Path *path)
+{
+	path->parallel_safe = false;
+	add_path(rel, path);
+}
+
 /*
  * Parse options from foreign server and apply them to fpinfo.
  *
@@ -5846,6 +6591,8 @@ apply_server_options(PgFdwRelationInfo *fpinfo)
 			(void) parse_int(defGetString(def), &fpinfo->fetch_size, 0, NULL);
 		else if (strcmp(def->defname, "async_capable") == 0)
 			fpinfo->async_capable = defGetBoolean(def);
+		else if (strcmp(def->defname, "parallel_scan") == 0)
+			fpinfo->parallel_scan = defGetBoolean(def);
 	}
 }
 
@@ -5869,6 +6616,8 @@ apply_table_options(PgFdwRelationInfo *fpinfo)
 			(void) parse_int(defGetString(def), &fpinfo->fetch_size, 0, NULL);
 		else if (strcmp(def->defname, "async_capable") == 0)
 			fpinfo->async_capable = defGetBoolean(def);
+		else if (strcmp(def->defname, "parallel_scan") == 0)
+			fpinfo->parallel_scan = defGetBoolean(def);
 	}
 }
 
@@ -6068,7 +6817,7 @@ postgresGetForeignJoinPaths(PlannerInfo *root,
 										NIL);	/* no fdw_private */
 
 	/* Add generated path into joinrel by add_path(). */
-	add_path(joinrel, (Path *) joinpath);
+	add_foreign_path(joinrel, (Path *) joinpath);
 
 	/* Consider pathkeys for the join relation */
 	add_paths_with_pathkeys_for_rel(root, joinrel, epq_path);
@@ -6453,7 +7202,7 @@ add_foreign_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 										  NIL); /* no fdw_private */
 
 	/* Add generated path into grouped_rel by add_path(). */
-	add_path(grouped_rel, (Path *) grouppath);
+	add_foreign_path(grouped_rel, (Path *) grouppath);
 }
 
 /*
@@ -6580,7 +7329,7 @@ add_foreign_ordered_paths(PlannerInfo *root, RelOptInfo *input_rel,
 											 fdw_private);
 
 	/* and add it to the ordered_rel */
-	add_path(ordered_rel, (Path *) ordered_path);
+	add_foreign_path(ordered_rel, (Path *) ordered_path);
 }
 
 /*
@@ -6695,7 +7444,7 @@ add_foreign_final_paths(PlannerInfo *root, RelOptInfo *input_rel,
 													   NULL);	/* no fdw_private */
 
 				/* and add it to the final_rel */
-				add_path(final_rel, (Path *) final_path);
+				add_foreign_path(final_rel, (Path *) final_path);
 
 				/* Safe to push down */
 				fpinfo->pushdown_safe = true;
@@ -6815,7 +7564,7 @@ add_foreign_final_paths(PlannerInfo *root, RelOptInfo *input_rel,
 										   fdw_private);
 
 	/* and add it to the final_rel */
-	add_path(final_rel, (Path *) final_path);
+	add_foreign_path(final_rel, (Path *) final_path);
 }
 
 /*
@@ -7036,6 +7785,10 @@ fetch_more_data_begin(AsyncRequest *areq)
 
 	Assert(!fsstate->conn_state->pendingAreq);
 
+	/* Process a pending modification, if any. */
+	if (fsstate->conn_state->pendingFmstate)
+		process_pending_modify(fsstate->conn_state->pendingFmstate);
+
 	/* Create the cursor synchronously. */
 	if (!fsstate->cursor_exists)
 		create_cursor(node);
@@ -80,6 +80,7 @@ typedef struct PgFdwRelationInfo
 	Cost		fdw_tuple_cost;
 	List	   *shippable_extensions;	/* OIDs of shippable extensions */
 	bool		async_capable;
+	bool		parallel_scan;
 
 	/* Cached catalog information. */
 	ForeignTable *table;
@@ -132,12 +133,16 @@ typedef struct PgFdwRelationInfo
 typedef struct PgFdwConnState
 {
 	AsyncRequest *pendingAreq;	/* pending async request */
+	struct PgFdwModifyState *pendingFmstate;	/* modification with pipelined
+												 * commands or COPY pending */
+	bool		snapshot_imported;	/* remote xact uses leader's snapshot? */
 } PgFdwConnState;
 
 /* in postgres_fdw.c */
 extern int	set_transmission_modes(void);
 extern void reset_transmission_modes(int nestlevel);
 extern void process_pending_request(AsyncRequest *areq);
+extern void process_pending_modify(struct PgFdwModifyState *fmstate);
 
 /* in connection.c */
 extern PGconn *GetConnection(UserMapping *user, bool will_prep_stmt,
@@ -195,6 +200,9 @@ extern void deparseDirectUpdateSql(StringInfo buf, PlannerInfo *root,
 								   List **params_list,
 								   List *returningList,
 								   List **retrieved_attrs);
+extern void deparseCopyFromSql(StringInfo buf, RangeTblEntry *rte,
+							   Index rtindex, Relation rel,
+							   List *targetAttrs);
 extern void deparseDeleteSql(StringInfo buf, RangeTblEntry *rte,
 							 Index rtindex, Relation rel,
 							 List *returningList,
@@ -207,6 +215,10 @@ extern void deparseDirectDeleteSql(StringInfo buf, PlannerInfo *root,
 								   List *returningList,
 								   List **retrieved_attrs);
 extern void deparseAnalyzeSizeSql(StringInfo buf, Relation rel);
+extern void deparseParallelScanSetupSql(StringInfo buf, Relation rel,
+										bool export_snapshot);
+extern void appendTidRangeConditions(StringInfo buf, bool has_where,
+									 int paramno);
 extern void deparseAnalyzeSql(StringInfo buf, Relation rel,
 							  List **retrieved_attrs);
 extern void deparseTruncateSql(StringInfo buf,
@@ -3408,6 +3408,163 @@ DROP TABLE join_tbl;
 ALTER SERVER loopback OPTIONS (DROP async_capable);
 ALTER SERVER loopback2 OPTIONS (DROP async_capable);
 
+-- ===================================================================
+-- test parallel foreign scans
+-- ===================================================================
+CREATE TABLE pbase_tbl (a int, b text);
+INSERT INTO pbase_tbl SELECT g, 'row ' || g FROM generate_series(1, 10000) g;
+CREATE FOREIGN TABLE ftpar (a int, b text)
+  SERVER loopback OPTIONS (table_name 'pbase_tbl', parallel_scan 'true');
+ANALYZE ftpar;
+-- a filter we can't push down, so that the scan isn't replaced by a remote
+-- aggregate
+CREATE FUNCTION pgfdw_even(int) RETURNS bool AS $$
+BEGIN
+  RETURN $1 % 2 = 0;
+END
+$$ LANGUAGE plpgsql IMMUTABLE PARALLEL SAFE;
+
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a);
+SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a);
+
+-- the Gather is rescanned for each outer row
+SET enable_material = off;
+EXPLAIN (COSTS OFF)
+SELECT * FROM (VALUES (1), (2)) v(x)
+  LEFT JOIN (SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a)) ss ON true;
+SELECT * FROM (VALUES (1), (2)) v(x)
+  LEFT JOIN (SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a)) ss ON true;
+RESET enable_material;
+
+-- Once the remote transaction has written anything, the workers can't use
+-- its snapshot, so the leader scans everything
+BEGIN;
+INSERT INTO ftpar VALUES (0, 'row 0');
+SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a);
+SET LOCAL parallel_leader_participation = off;
+SELECT count(*), sum(a) FROM ftpar WHERE pgfdw_even(a);
+ROLLBACK;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+DROP FOREIGN TABLE ftpar;
+DROP TABLE pbase_tbl;
+DROP FUNCTION pgfdw_even(int);
+
+-- ===================================================================
+-- test pipelined UPDATE/DELETE and COPY FROM through a remote COPY
+-- ===================================================================
+CREATE TABLE pl_base (a int CHECK (a < 100), b text);
+INSERT INTO pl_base SELECT g, 'v' || g FROM generate_series(1, 20) g;
+CREATE FOREIGN TABLE ftpl (a int, b text) SERVER loopback
+  OPTIONS (table_name 'pl_base', batch_size '4', fetch_size '6');
+-- a condition we can't push down
+CREATE FUNCTION pgfdw_local(int) RETURNS int AS $$
+BEGIN
+  RETURN $1;
+END
+$$ LANGUAGE plpgsql IMMUTABLE;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+UPDATE ftpl SET b = b || 'x' WHERE pgfdw_local(a) > 0;
+
+-- An error in the middle of a pipeline is reported, and everything is rolled
+-- back
+UPDATE ftpl SET a = a + 90 WHERE pgfdw_local(a) > 0;
+SELECT count(*), sum(a) FROM ftpl;
+
+-- Rows that the remote server doesn't modify aren't counted
+CREATE FUNCTION pl_skip_trig() RETURNS trigger AS $$
+BEGIN
+  IF OLD.a % 3 = 0 THEN
+    RETURN NULL;
+  END IF;
+  IF TG_OP = 'DELETE' THEN
+    RETURN OLD;
+  END IF;
+  RETURN NEW;
+END
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER pl_skip BEFORE UPDATE OR DELETE ON pl_base
+  FOR EACH ROW EXECUTE FUNCTION pl_skip_trig();
+DO $$
+DECLARE
+  n int;
+BEGIN
+  UPDATE ftpl SET b = b || 'x' WHERE pgfdw_local(a) > 0;
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RAISE NOTICE 'updated % rows', n;
+END
+$$;
+SELECT count(*) FROM ftpl WHERE b LIKE '%x';
+
+-- No pipelining if the rows are needed back
+WITH u AS (UPDATE ftpl SET b = b || 'y' WHERE pgfdw_local(a) > 0 RETURNING a)
+SELECT count(*), sum(a) FROM u;
+CREATE FUNCTION pl_notice_trig() RETURNS trigger AS $$
+BEGIN
+  RAISE NOTICE 'updated row %', NEW.a;
+  RETURN NEW;
+END
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER pl_notice AFTER UPDATE ON ftpl
+  FOR EACH ROW EXECUTE FUNCTION pl_notice_trig();
+UPDATE ftpl SET b = b || 'z' WHERE pgfdw_local(a) < 5;
+DROP TRIGGER pl_notice ON ftpl;
+DO $$
+DECLARE
+  n int;
+BEGIN
+  DELETE FROM ftpl WHERE pgfdw_local(a) > 0;
+  GET DIAGNOSTICS n = ROW_COUNT;
+  RAISE NOTICE 'deleted % rows', n;
+END
+$$;
+SELECT a FROM ftpl ORDER BY a;
+DROP TRIGGER pl_skip ON pl_base;
+
+-- COPY FROM, directly and through a partitioned table
+COPY ftpl FROM stdin;
+21	v21
+22	v22
+\.
+COPY ftpl FROM stdin; -- ERROR
+23	v23
+123	v123
+24	v24
+\.
+CREATE TABLE pl_parted (a int, b text) PARTITION BY RANGE (a);
+CREATE TABLE pl_parted_local PARTITION OF pl_parted
+  FOR VALUES FROM (1000) TO (2000);
+ALTER TABLE pl_parted ATTACH PARTITION ftpl FOR VALUES FROM (0) TO (1000);
+COPY pl_parted FROM stdin;
+25	v25
+1500	v1500
+26	v26
+\.
+COPY pl_parted FROM stdin; -- ERROR
+27	v27
+127	v127
+28	v28
+\.
+SELECT tableoid::regclass, * FROM pl_parted WHERE a > 20 ORDER BY a;
+
+ALTER TABLE pl_parted DETACH PARTITION ftpl;
+DROP TABLE pl_parted;
+DROP FOREIGN TABLE ftpl;
+DROP TABLE pl_base;
+DROP FUNCTION pgfdw_local(int);
+DROP FUNCTION pl_skip_trig();
+DROP FUNCTION pl_notice_trig();
+
 -- ===================================================================
 -- test invalid server, foreign table and foreign data wrapper options
 -- ===================================================================
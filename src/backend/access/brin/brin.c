@@ -33,6 +33,7 @@
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
+#include "storage/lmgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -74,6 +75,8 @@ static BrinBuildState *initialize_brin_buildstate(Relation idxRel,
 static void terminate_brin_buildstate(BrinBuildState *state);
 static void brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 						  bool include_partial, double *numSummarized, double *numExisting);
+static bool summarize_tail_range(Relation idxRel, Relation heapRel,
+								 BlockNumber heapBlk, BlockNumber pagesPerRange);
 static void form_and_insert_tuple(BrinBuildState *state);
 static void union_tuples(BrinDesc *bdesc, BrinMemTuple *a,
 						 BrinTuple *b);
@@ -115,6 +118,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = brinbuild;
 	amroutine->ambuildempty = brinbuildempty;
 	amroutine->aminsert = brininsert;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = brinbulkdelete;
 	amroutine->amvacuumcleanup = brinvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -148,7 +152,8 @@ brinhandler(PG_FUNCTION_ARGS)
  * page range.
  *
  * If the range is not currently summarized (i.e. the revmap returns NULL for
- * it), there's nothing to do for this tuple.
+ * it), there's nothing to do for this tuple, except that with autosummarize
+ * we summarize the final range of the table right away.
  */
 bool
 brininsert(Relation idxRel, Datum *values, bool *nulls,
@@ -166,6 +171,7 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 	MemoryContext tupcxt = NULL;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	bool		autosummarize = BrinGetAutoSummarize(idxRel);
+	bool		triedtail = false;
 
 	revmap = brinRevmapInitialize(idxRel, &pagesPerRange, NULL);
 
@@ -222,9 +228,26 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 		brtup = brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off,
 										 NULL, BUFFER_LOCK_SHARE, NULL);
 
-		/* if range is unsummarized, there's nothing to do */
+		/*
+		 * If range is unsummarized, there's nothing to do.  But if
+		 * auto-summarization is enabled and this is the final range of the
+		 * table, summarize it now rather than leaving it to autovacuum, so
+		 * that an append-only table never has an unsummarized tail that
+		 * every scan must read.  This is cheap, since the range usually holds
+		 * little more than our own tuple at this point.  Then go around again
+		 * to find the new summary tuple.
+		 */
 		if (!brtup)
+		{
+			if (autosummarize && !triedtail)
+			{
+				triedtail = true;
+				if (summarize_tail_range(idxRel, heapRel, heapBlk,
+										 pagesPerRange))
+					continue;
+			}
 			break;
+		}
 
 		/* First time through in this statement? */
 		if (bdesc == NULL)
@@ -1534,6 +1557,33 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 	}
 }
 
+/*
+ * Summarize the page range starting at heapBlk during an insertion, if it is
+ * the final range of the table.  brinsummarize() relies on our holding
+ * ShareUpdateExclusiveLock on the table to keep other summarizers away, so
+ * we give up if we can't get it at once; the range will then be summarized
+ * in the usual ways.  We release the lock again right away, since the new
+ * summary doesn't depend on our transaction.
+ *
+ * Returns true if the range was summarized.
+ */
+static bool
+summarize_tail_range(Relation idxRel, Relation heapRel, BlockNumber heapBlk,
+					 BlockNumber pagesPerRange)
+{
+	if (heapBlk + pagesPerRange < RelationGetNumberOfBlocks(heapRel))
+		return false;
+
+	if (!ConditionalLockRelation(heapRel, ShareUpdateExclusiveLock))
+		return false;
+
+	brinsummarize(idxRel, heapRel, heapBlk, true, NULL, NULL);
+
+	UnlockRelation(heapRel, ShareUpdateExclusiveLock);
+
+	return true;
+}
+
 /*
  * Given a deformed tuple in the build state, convert it into the on-disk
  * format and insert it into the index, making the revmap point to it.
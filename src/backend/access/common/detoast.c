@@ -244,16 +244,23 @@ detoast_attr_slice(struct varlena *attr,
 
 			/*
 			 * Determine maximum amount of compressed data needed for a prefix
-			 * of a given length (after decompression).
-			 *
-			 * At least for now, if it's LZ4 data, we'll have to fetch the
-			 * whole thing, because there doesn't seem to be an API call to
-			 * determine how much compressed data we need to be sure of being
-			 * able to decompress the required slice.
+			 * of a given length (after decompression).  This only reads the
+			 * TOAST chunks covering that much of the value.
 			 */
-			if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
-				TOAST_PGLZ_COMPRESSION_ID)
-				max_size = pglz_maximum_compressed_size(slicelimit, max_size);
+			switch (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer))
+			{
+				case TOAST_PGLZ_COMPRESSION_ID:
+					max_size = pglz_maximum_compressed_size(slicelimit, max_size);
+					break;
+				case TOAST_LZ4_COMPRESSION_ID:
+					max_size = lz4_maximum_compressed_size(slicelimit, max_size);
+					break;
+				case TOAST_ZSTD_COMPRESSION_ID:
+					max_size = zstd_maximum_compressed_size(slicelimit, max_size);
+					break;
+				default:
+					break;
+			}
 
 			/*
 			 * Fetch enough compressed slices (compressed marker will get set
@@ -485,6 +492,8 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -528,6 +537,8 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
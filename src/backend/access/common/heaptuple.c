@@ -1342,25 +1342,17 @@ heap_freetuple(HeapTuple htup)
 
 
 /*
- * heap_form_minimal_tuple
- *		construct a MinimalTuple from the given values[] and isnull[] arrays,
- *		which are of the length indicated by tupleDescriptor->natts
- *
- * This is exactly like heap_form_tuple() except that the result is a
- * "minimal" tuple lacking a HeapTupleData header as well as room for system
- * columns.
- *
- * The result is allocated in the current memory context.
+ * heap_compute_minimal_tuple_size
+ *		compute the total length of the MinimalTuple that
+ *		heap_form_minimal_tuple would build from the given values[] and
+ *		isnull[] arrays
  */
-MinimalTuple
-heap_form_minimal_tuple(TupleDesc tupleDescriptor,
-						Datum *values,
-						bool *isnull)
+Size
+heap_compute_minimal_tuple_size(TupleDesc tupleDescriptor,
+								Datum *values,
+								bool *isnull)
 {
-	MinimalTuple tuple;			/* return tuple */
-	Size		len,
-				data_len;
-	int			hoff;
+	Size		len;
 	bool		hasnull = false;
 	int			numberOfAttributes = tupleDescriptor->natts;
 	int			i;
@@ -1391,20 +1383,47 @@ heap_form_minimal_tuple(TupleDesc tupleDescriptor,
 	if (hasnull)
 		len += BITMAPLEN(numberOfAttributes);
 
-	hoff = len = MAXALIGN(len); /* align user data safely */
+	len = MAXALIGN(len);		/* align user data safely */
 
-	data_len = heap_compute_data_size(tupleDescriptor, values, isnull);
+	len += heap_compute_data_size(tupleDescriptor, values, isnull);
 
-	len += data_len;
+	return len;
+}
 
-	/*
-	 * Allocate and zero the space needed.
-	 */
-	tuple = (MinimalTuple) palloc0(len);
+/*
+ * heap_fill_minimal_tuple
+ *		construct a MinimalTuple from the given values[] and isnull[] arrays
+ *		in caller-supplied, zeroed memory
+ *
+ * len must be the result of heap_compute_minimal_tuple_size for the same
+ * values, and tuple must point to at least that many MAXALIGN'd bytes.
+ */
+void
+heap_fill_minimal_tuple(TupleDesc tupleDescriptor,
+						Datum *values,
+						bool *isnull,
+						MinimalTuple tuple,
+						Size len)
+{
+	int			hoff;
+	bool		hasnull = false;
+	int			numberOfAttributes = tupleDescriptor->natts;
+	int			i;
+
+	for (i = 0; i < numberOfAttributes; i++)
+	{
+		if (isnull[i])
+		{
+			hasnull = true;
+			break;
+		}
+	}
+
+	hoff = SizeofMinimalTupleHeader;
+	if (hasnull)
+		hoff += BITMAPLEN(numberOfAttributes);
+	hoff = MAXALIGN(hoff);
 
-	/*
-	 * And fill in the information.
-	 */
 	tuple->t_len = len;
 	HeapTupleHeaderSetNatts(tuple, numberOfAttributes);
 	tuple->t_hoff = hoff + MINIMAL_TUPLE_OFFSET;
@@ -1413,9 +1432,38 @@ heap_form_minimal_tuple(TupleDesc tupleDescriptor,
 					values,
 					isnull,
 					(char *) tuple + hoff,
-					data_len,
+					len - hoff,
 					&tuple->t_infomask,
 					(hasnull ? tuple->t_bits : NULL));
+}
+
+/*
+ * heap_form_minimal_tuple
+ *		construct a MinimalTuple from the given values[] and isnull[] arrays,
+ *		which are of the length indicated by tupleDescriptor->natts
+ *
+ * This is exactly like heap_form_tuple() except that the result is a
+ * "minimal" tuple lacking a HeapTupleData header as well as room for system
+ * columns.
+ *
+ * The result is allocated in the current memory context.
+ */
+MinimalTuple
+heap_form_minimal_tuple(TupleDesc tupleDescriptor,
+						Datum *values,
+						bool *isnull)
+{
+	MinimalTuple tuple;			/* return tuple */
+	Size		len;
+
+	len = heap_compute_minimal_tuple_size(tupleDescriptor, values, isnull);
+
+	/*
+	 * Allocate and zero the space needed, and fill in the information.
+	 */
+	tuple = (MinimalTuple) palloc0(len);
+
+	heap_fill_minimal_tuple(tupleDescriptor, values, isnull, tuple, len);
 
 	return tuple;
 }
@@ -15,13 +15,20 @@
  */
 #include "postgres.h"
 
+#include <float.h>
+
 #include "access/printtup.h"
+#include "common/shortest_dec.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "tcop/pquery.h"
+#include "utils/builtins.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
+#include "utils/uuid.h"
 
 
 static void printtup_startup(DestReceiver *self, int operation,
@@ -40,17 +47,49 @@ static void printtup_destroy(DestReceiver *self);
  *
  * NOTE: finfo is the lookup info for either typoutput or typsend, whichever
  * we are using for this column.
+ *
+ * For a handful of very common built-in types, printtup() formats the value
+ * straight into the DataRow message instead of calling the output or send
+ * function through fmgr.  The fast path is chosen by the function OID, so
+ * that domains over these types benefit as well; whatever it emits must be
+ * byte-for-byte identical to what the regular function would produce.
  * ----------------
  */
+typedef enum PrinttupFastPath
+{
+	PRINTTUP_GENERIC,			/* call the output/send function */
+	PRINTTUP_INT2,
+	PRINTTUP_INT4,
+	PRINTTUP_INT8,
+	PRINTTUP_BOOL,
+	PRINTTUP_FLOAT4,
+	PRINTTUP_FLOAT8,
+	PRINTTUP_TEXT,				/* text, varchar and bpchar */
+	PRINTTUP_UUID
+} PrinttupFastPath;
+
 typedef struct
 {								/* Per-attribute information */
+	Oid			typid;			/* type of the column */
 	Oid			typoutput;		/* Oid for the type's text output fn */
 	Oid			typsend;		/* Oid for the type's binary output fn */
 	bool		typisvarlena;	/* is it varlena (ie possibly toastable)? */
 	int16		format;			/* format code for this column */
+	PrinttupFastPath fastpath;	/* built-in formatting to use, if any */
 	FmgrInfo	finfo;			/* Precomputed call info for output fn */
 } PrinttupAttrInfo;
 
+/*
+ * The per-attribute info is kept in the portal's memory, so that a portal
+ * fetched from by many Execute messages only has to look it up once.
+ */
+typedef struct
+{
+	TupleDesc	attrinfo;		/* The attr info this was set up for */
+	int			nattrs;
+	PrinttupAttrInfo *myinfo;	/* Cached info about each attr */
+} PrinttupPortalInfo;
+
 typedef struct
 {
 	DestReceiver pub;			/* publicly-known function pointers */
@@ -243,27 +282,117 @@ SendRowDescriptionMessage(StringInfo buf, TupleDesc typeinfo,
 	pq_endmessage_reuse(buf);
 }
 
+/*
+ * Select the built-in formatting for an output or send function, if we
+ * have one
+ */
+static PrinttupFastPath
+printtup_fast_path(Oid funcid)
+{
+	switch (funcid)
+	{
+		case F_INT2OUT:
+		case F_INT2SEND:
+			return PRINTTUP_INT2;
+		case F_INT4OUT:
+		case F_INT4SEND:
+			return PRINTTUP_INT4;
+		case F_INT8OUT:
+		case F_INT8SEND:
+			return PRINTTUP_INT8;
+		case F_BOOLOUT:
+		case F_BOOLSEND:
+			return PRINTTUP_BOOL;
+		case F_FLOAT4OUT:
+		case F_FLOAT4SEND:
+			return PRINTTUP_FLOAT4;
+		case F_FLOAT8OUT:
+		case F_FLOAT8SEND:
+			return PRINTTUP_FLOAT8;
+		case F_TEXTOUT:
+		case F_TEXTSEND:
+		case F_VARCHAROUT:
+		case F_VARCHARSEND:
+		case F_BPCHAROUT:
+		case F_BPCHARSEND:
+			return PRINTTUP_TEXT;
+		case F_UUID_OUT:
+		case F_UUID_SEND:
+			return PRINTTUP_UUID;
+		default:
+			return PRINTTUP_GENERIC;
+	}
+}
+
+/*
+ * Is the portal's cached lookup info usable for this tuple descriptor?
+ *
+ * Comparing the descriptor pointer is normally enough, but the cache can
+ * outlive the descriptor it was built for, so check the column types too.
+ */
+static bool
+printtup_portal_info_matches(PrinttupPortalInfo *pinfo, TupleDesc typeinfo,
+							 int numAttrs)
+{
+	int			i;
+
+	if (pinfo->attrinfo != typeinfo || pinfo->nattrs != numAttrs)
+		return false;
+
+	for (i = 0; i < numAttrs; i++)
+	{
+		if (pinfo->myinfo[i].typid != TupleDescAttr(typeinfo, i)->atttypid)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Get the lookup info that printtup() needs
+ *
+ * The info lives in the portal's context and is shared by every printtup
+ * receiver attached to the portal, so it is never freed here.
  */
 static void
 printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 {
-	int16	   *formats = myState->portal->formats;
+	Portal		portal = myState->portal;
+	int16	   *formats = portal->formats;
+	PrinttupPortalInfo *pinfo = (PrinttupPortalInfo *) portal->printtupInfo;
 	int			i;
 
+	myState->attrinfo = typeinfo;
+	myState->nattrs = numAttrs;
+
+	if (pinfo && printtup_portal_info_matches(pinfo, typeinfo, numAttrs))
+	{
+		myState->myinfo = pinfo->myinfo;
+		return;
+	}
+
 	/* get rid of any old data */
-	if (myState->myinfo)
-		pfree(myState->myinfo);
+	if (pinfo == NULL)
+	{
+		pinfo = (PrinttupPortalInfo *)
+			MemoryContextAllocZero(portal->portalContext,
+								   sizeof(PrinttupPortalInfo));
+		portal->printtupInfo = pinfo;
+	}
+	else if (pinfo->myinfo)
+		pfree(pinfo->myinfo);
+	pinfo->myinfo = NULL;
 	myState->myinfo = NULL;
 
-	myState->attrinfo = typeinfo;
-	myState->nattrs = numAttrs;
+	pinfo->attrinfo = typeinfo;
+	pinfo->nattrs = numAttrs;
 	if (numAttrs <= 0)
 		return;
 
-	myState->myinfo = (PrinttupAttrInfo *)
-		palloc0(numAttrs * sizeof(PrinttupAttrInfo));
+	pinfo->myinfo = (PrinttupAttrInfo *)
+		MemoryContextAllocZero(portal->portalContext,
+							   numAttrs * sizeof(PrinttupAttrInfo));
+	myState->myinfo = pinfo->myinfo;
 
 	for (i = 0; i < numAttrs; i++)
 	{
@@ -271,20 +400,25 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 		int16		format = (formats ? formats[i] : 0);
 		Form_pg_attribute attr = TupleDescAttr(typeinfo, i);
 
+		thisState->typid = attr->atttypid;
 		thisState->format = format;
 		if (format == 0)
 		{
 			getTypeOutputInfo(attr->atttypid,
 							  &thisState->typoutput,
 							  &thisState->typisvarlena);
-			fmgr_info(thisState->typoutput, &thisState->finfo);
+			fmgr_info_cxt(thisState->typoutput, &thisState->finfo,
+						  portal->portalContext);
+			thisState->fastpath = printtup_fast_path(thisState->typoutput);
 		}
 		else if (format == 1)
 		{
 			getTypeBinaryOutputInfo(attr->atttypid,
 									&thisState->typsend,
 									&thisState->typisvarlena);
-			fmgr_info(thisState->typsend, &thisState->finfo);
+			fmgr_info_cxt(thisState->typsend, &thisState->finfo,
+						  portal->portalContext);
+			thisState->fastpath = printtup_fast_path(thisState->typsend);
 		}
 		else
 			ereport(ERROR,
@@ -293,6 +427,142 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 	}
 }
 
+/*
+ * Append a column value of a fast-path type in text format
+ *
+ * Apart from text, which may need encoding conversion, the output is plain
+ * ASCII and is written directly into the message buffer, which is valid in
+ * every client encoding.
+ */
+static void
+printtup_text_fast(StringInfo buf, PrinttupFastPath fastpath, Datum attr)
+{
+	static const char hex_chars[] = "0123456789abcdef";
+	char	   *str;
+	int			len;
+
+	if (fastpath == PRINTTUP_TEXT)
+	{
+		text	   *t = DatumGetTextPP(attr);
+
+		pq_sendcountedtext(buf, VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t), false);
+		return;
+	}
+
+	/* leave room for the length word, the value and a trailing null */
+	enlargeStringInfo(buf, sizeof(int32) + 40);
+	str = buf->data + buf->len + sizeof(int32);
+
+	switch (fastpath)
+	{
+		case PRINTTUP_INT2:
+			len = pg_itoa(DatumGetInt16(attr), str);
+			break;
+		case PRINTTUP_INT4:
+			len = pg_ltoa(DatumGetInt32(attr), str);
+			break;
+		case PRINTTUP_INT8:
+			len = pg_lltoa(DatumGetInt64(attr), str);
+			break;
+		case PRINTTUP_BOOL:
+			str[0] = DatumGetBool(attr) ? 't' : 'f';
+			len = 1;
+			break;
+		case PRINTTUP_FLOAT4:
+			/* keep this in sync with float4out() */
+			if (extra_float_digits > 0)
+				len = float_to_shortest_decimal_buf(DatumGetFloat4(attr), str);
+			else
+				len = pg_strfromd(str, 32, FLT_DIG + extra_float_digits,
+								  DatumGetFloat4(attr));
+			break;
+		case PRINTTUP_FLOAT8:
+			/* keep this in sync with float8out_internal() */
+			if (extra_float_digits > 0)
+				len = double_to_shortest_decimal_buf(DatumGetFloat8(attr), str);
+			else
+				len = pg_strfromd(str, 32, DBL_DIG + extra_float_digits,
+								  DatumGetFloat8(attr));
+			break;
+		case PRINTTUP_UUID:
+			{
+				pg_uuid_t  *uuid = DatumGetUUIDP(attr);
+				int			i;
+
+				/* same layout as uuid_out() */
+				len = 0;
+				for (i = 0; i < UUID_LEN; i++)
+				{
+					if (i == 4 || i == 6 || i == 8 || i == 10)
+						str[len++] = '-';
+					str[len++] = hex_chars[uuid->data[i] >> 4];
+					str[len++] = hex_chars[uuid->data[i] & 0x0F];
+				}
+			}
+			break;
+		default:
+			elog(ERROR, "unrecognized printtup fast path: %d", (int) fastpath);
+			len = 0;			/* keep compiler quiet */
+			break;
+	}
+
+	pq_writeint32(buf, len);
+	buf->len += len;
+}
+
+/*
+ * Append a column value of a fast-path type in binary format
+ *
+ * The result must match what the type's send function would produce.
+ */
+static void
+printtup_binary_fast(StringInfo buf, PrinttupFastPath fastpath, Datum attr)
+{
+	switch (fastpath)
+	{
+		case PRINTTUP_INT2:
+			pq_sendint32(buf, sizeof(int16));
+			pq_sendint16(buf, DatumGetInt16(attr));
+			break;
+		case PRINTTUP_INT4:
+			pq_sendint32(buf, sizeof(int32));
+			pq_sendint32(buf, DatumGetInt32(attr));
+			break;
+		case PRINTTUP_INT8:
+			pq_sendint32(buf, sizeof(int64));
+			pq_sendint64(buf, DatumGetInt64(attr));
+			break;
+		case PRINTTUP_BOOL:
+			pq_sendint32(buf, 1);
+			pq_sendbyte(buf, DatumGetBool(attr) ? 1 : 0);
+			break;
+		case PRINTTUP_FLOAT4:
+			pq_sendint32(buf, sizeof(float4));
+			pq_sendfloat4(buf, DatumGetFloat4(attr));
+			break;
+		case PRINTTUP_FLOAT8:
+			pq_sendint32(buf, sizeof(float8));
+			pq_sendfloat8(buf, DatumGetFloat8(attr));
+			break;
+		case PRINTTUP_TEXT:
+			{
+				text	   *t = DatumGetTextPP(attr);
+
+				/* textsend() converts to the client encoding, too */
+				pq_sendcountedtext(buf, VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t),
+								   false);
+			}
+			break;
+		case PRINTTUP_UUID:
+			pq_sendint32(buf, UUID_LEN);
+			pq_sendbytes(buf, (char *) DatumGetUUIDP(attr)->data, UUID_LEN);
+			break;
+		default:
+			elog(ERROR, "unrecognized printtup fast path: %d", (int) fastpath);
+			break;
+	}
+}
+
 /* ----------------
  *		printtup --- send a tuple to the client
  * ----------------
@@ -349,7 +619,15 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 			VALGRIND_CHECK_MEM_IS_DEFINED(DatumGetPointer(attr),
 										  VARSIZE_ANY(attr));
 
-		if (thisState->format == 0)
+		if (thisState->fastpath != PRINTTUP_GENERIC)
+		{
+			/* Built-in type we know how to format ourselves */
+			if (thisState->format == 0)
+				printtup_text_fast(buf, thisState->fastpath, attr);
+			else
+				printtup_binary_fast(buf, thisState->fastpath, attr);
+		}
+		else if (thisState->format == 0)
 		{
 			/* Text output */
 			char	   *outputstr;
@@ -387,8 +665,7 @@ printtup_shutdown(DestReceiver *self)
 {
 	DR_printtup *myState = (DR_printtup *) self;
 
-	if (myState->myinfo)
-		pfree(myState->myinfo);
+	/* myinfo belongs to the portal, see printtup_prepare_info() */
 	myState->myinfo = NULL;
 
 	myState->attrinfo = NULL;
@@ -131,6 +131,15 @@ static relopt_bool boolRelOpts[] =
 		},
 		true
 	},
+	{
+		{
+			"autocleanup",
+			"Enables pending list cleanup by autovacuum on this GIN index",
+			RELOPT_KIND_GIN,
+			AccessExclusiveLock
+		},
+		false
+	},
 	{
 		{
 			"security_barrier",
@@ -16,6 +16,9 @@
 #ifdef USE_LZ4
 #include <lz4.h>
 #endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/toast_compression.h"
@@ -33,6 +36,13 @@ int			default_toast_compression = TOAST_PGLZ_COMPRESSION;
 			 errdetail("This functionality requires the server to be built with lz4 support."), \
 			 errhint("You need to rebuild PostgreSQL using %s.", "--with-lz4")))
 
+#define NO_ZSTD_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("compression method zstd not supported"), \
+			 errdetail("This functionality requires the server to be built with zstd support."), \
+			 errhint("You need to rebuild PostgreSQL using %s.", "--with-zstd")))
+
 /*
  * Compress a varlena using PGLZ.
  *
@@ -247,6 +257,191 @@ lz4_decompress_datum_slice(const struct varlena *value, int32 slicelength)
 #endif
 }
 
+/*
+ * Determine how much LZ4-compressed data we need to decompress a prefix of
+ * rawsize bytes with lz4_decompress_datum_slice.
+ *
+ * Literal bytes occupy one byte each, plus a token and a length byte per 255
+ * literals, while a match always decompresses to more bytes than it takes
+ * up, so the prefix needs little more than rawsize bytes; the slack covers
+ * the sequence straddling its end and the decoder's end-of-input margins.
+ * Only LZ4 1.9.4 and later are known to accept input cut off after the
+ * required prefix, though; with older versions, we need all of it.
+ */
+int32
+lz4_maximum_compressed_size(int32 rawsize, int32 total_compressed_size)
+{
+#ifndef USE_LZ4
+	return total_compressed_size;
+#else
+	int64		compressed_size;
+
+	if (LZ4_versionNumber() < 10904)
+		return total_compressed_size;
+
+	compressed_size = (int64) rawsize + rawsize / 255 + 32;
+
+	return (int32) Min(compressed_size, total_compressed_size);
+#endif
+}
+
+/*
+ * Compress a varlena using zstd.
+ *
+ * Returns the compressed varlena, or NULL if compression fails.
+ */
+struct varlena *
+zstd_compress_datum(const struct varlena *value)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	int32		valsize;
+	size_t		len;
+	size_t		max_size;
+	struct varlena *tmp = NULL;
+
+	valsize = VARSIZE_ANY_EXHDR(value);
+
+	/*
+	 * Figure out the maximum possible size of the zstd output, add the bytes
+	 * that will be needed for varlena overhead, and allocate that amount.
+	 */
+	max_size = ZSTD_compressBound(valsize);
+	tmp = (struct varlena *) palloc(max_size + VARHDRSZ_COMPRESSED);
+
+	len = ZSTD_compress((char *) tmp + VARHDRSZ_COMPRESSED, max_size,
+						VARDATA_ANY(value), valsize,
+						ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(len))
+		elog(ERROR, "zstd compression failed: %s", ZSTD_getErrorName(len));
+
+	/* data is incompressible so just free the memory and return NULL */
+	if (len > valsize)
+	{
+		pfree(tmp);
+		return NULL;
+	}
+
+	SET_VARSIZE_COMPRESSED(tmp, len + VARHDRSZ_COMPRESSED);
+
+	return tmp;
+#endif
+}
+
+/*
+ * Decompress a varlena that was compressed using zstd.
+ */
+struct varlena *
+zstd_decompress_datum(const struct varlena *value)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	size_t		rawsize;
+	struct varlena *result;
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(VARDATA_COMPRESSED_GET_EXTSIZE(value) + VARHDRSZ);
+
+	/* decompress the data */
+	rawsize = ZSTD_decompress(VARDATA(result),
+							  VARDATA_COMPRESSED_GET_EXTSIZE(value),
+							  (char *) value + VARHDRSZ_COMPRESSED,
+							  VARSIZE(value) - VARHDRSZ_COMPRESSED);
+	if (ZSTD_isError(rawsize))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Decompress part of a varlena that was compressed using zstd.
+ *
+ * zstd has no one-shot partial decompression, so we use the streaming API
+ * and stop as soon as the output buffer is full.
+ */
+struct varlena *
+zstd_decompress_datum_slice(const struct varlena *value, int32 slicelength)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	struct varlena *result;
+	ZSTD_DCtx  *dctx;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	size_t		ret;
+
+	dctx = ZSTD_createDCtx();
+	if (dctx == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	in.src = (char *) value + VARHDRSZ_COMPRESSED;
+	in.size = VARSIZE(value) - VARHDRSZ_COMPRESSED;
+	in.pos = 0;
+	out.dst = VARDATA(result);
+	out.size = slicelength;
+	out.pos = 0;
+
+	/* decompress until the slice is full or the frame ends */
+	do
+	{
+		ret = ZSTD_decompressStream(dctx, &out, &in);
+	} while (!ZSTD_isError(ret) && ret != 0 && out.pos < out.size &&
+			 in.pos < in.size);
+
+	ZSTD_freeDCtx(dctx);
+
+	if (ZSTD_isError(ret))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+
+	SET_VARSIZE(result, out.pos + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Determine how much zstd-compressed data we need to decompress a prefix of
+ * rawsize bytes with zstd_decompress_datum_slice.
+ *
+ * zstd never stores a block in more space than its raw contents plus a
+ * 3-byte block header, but it can only decompress whole blocks, so we need
+ * the frame header plus every block overlapping the prefix: at most one
+ * maximum-sized block beyond rawsize.
+ */
+int32
+zstd_maximum_compressed_size(int32 rawsize, int32 total_compressed_size)
+{
+#ifndef USE_ZSTD
+	return total_compressed_size;
+#else
+	int64		compressed_size;
+
+	/* blocks hold at most 128kB; frame headers take at most 18 bytes */
+	compressed_size = (int64) rawsize + 128 * 1024;
+	compressed_size += compressed_size / 256 + 18;
+
+	return (int32) Min(compressed_size, total_compressed_size);
+#endif
+}
+
 /*
  * Extract compression ID from a varlena.
  *
@@ -295,6 +490,13 @@ CompressionNameToMethod(const char *compression)
 #endif
 		return TOAST_LZ4_COMPRESSION;
 	}
+	else if (strcmp(compression, "zstd") == 0)
+	{
+#ifndef USE_ZSTD
+		NO_ZSTD_SUPPORT();
+#endif
+		return TOAST_ZSTD_COMPRESSION;
+	}
 
 	return InvalidCompressionMethod;
 }
@@ -311,6 +513,8 @@ GetCompressionMethodName(char method)
 			return "pglz";
 		case TOAST_LZ4_COMPRESSION:
 			return "lz4";
+		case TOAST_ZSTD_COMPRESSION:
+			return "zstd";
 		default:
 			elog(ERROR, "invalid compression method %c", method);
 			return NULL;		/* keep compiler quiet */
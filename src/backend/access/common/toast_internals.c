@@ -22,11 +22,15 @@
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
 #include "miscadmin.h"
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 
+/* most chunks that toast_save_datum() inserts with one heap_multi_insert() */
+#define TOAST_MULTI_INSERT_CHUNKS	64
+
 static bool toastrel_valueid_exists(Relation toastrel, Oid valueid);
 static bool toastid_valueid_exists(Oid toastrelid, Oid valueid);
 
@@ -72,6 +76,10 @@ toast_compress_datum(Datum value, char cmethod)
 			tmp = lz4_compress_datum((const struct varlena *) value);
 			cmid = TOAST_LZ4_COMPRESSION_ID;
 			break;
+		case TOAST_ZSTD_COMPRESSION:
+			tmp = zstd_compress_datum((const struct varlena *) value);
+			cmid = TOAST_ZSTD_COMPRESSION_ID;
+			break;
 		default:
 			elog(ERROR, "invalid compression method %c", cmethod);
 	}
@@ -113,7 +121,11 @@ toast_compress_datum(Datum value, char cmethod)
  * rel: the main relation we're working with (not the toast rel!)
  * value: datum to be pushed to toast storage
  * oldexternal: if not NULL, toast pointer previously representing the datum
- * options: options to be passed to heap_insert() for toast rows
+ * options: options to be passed to heap_multi_insert() for toast rows
+ *
+ * The chunks are inserted in batches of up to TOAST_MULTI_INSERT_CHUNKS,
+ * which fills whole pages of the toast table per WAL record and lets the
+ * index AM insert the index entries of a batch together.
  * ----------
  */
 Datum
@@ -126,6 +138,12 @@ toast_save_datum(Relation rel, Datum value,
 	TupleDesc	toasttupDesc;
 	Datum		t_values[3];
 	bool		t_isnull[3];
+	TupleTableSlot *slots[TOAST_MULTI_INSERT_CHUNKS];
+	int			nslots = 0;
+	Datum		idx_values[TOAST_MULTI_INSERT_CHUNKS][2];
+	Datum	   *idx_valuesp[TOAST_MULTI_INSERT_CHUNKS];
+	bool	   *idx_isnullp[TOAST_MULTI_INSERT_CHUNKS];
+	ItemPointerData idx_tids[TOAST_MULTI_INSERT_CHUNKS];
 	CommandId	mycid = GetCurrentCommandId(true);
 	struct varlena *result;
 	struct varatt_external toast_pointer;
@@ -300,64 +318,106 @@ toast_save_datum(Relation rel, Datum value,
 	t_isnull[2] = false;
 
 	/*
-	 * Split up the item into chunks
+	 * Split up the item into chunks, and store them a batch at a time
 	 */
 	while (data_todo > 0)
 	{
+		int			nchunks = 0;
+		int32		first_seq = chunk_seq;
 		int			i;
 
 		CHECK_FOR_INTERRUPTS();
 
-		/*
-		 * Calculate the size of this chunk
-		 */
-		chunk_size = Min(TOAST_MAX_CHUNK_SIZE, data_todo);
+		while (data_todo > 0 && nchunks < TOAST_MULTI_INSERT_CHUNKS)
+		{
+			/*
+			 * Calculate the size of this chunk
+			 */
+			chunk_size = Min(TOAST_MAX_CHUNK_SIZE, data_todo);
 
-		/*
-		 * Build a tuple and store it
-		 */
-		t_values[1] = Int32GetDatum(chunk_seq++);
-		SET_VARSIZE(&chunk_data, chunk_size + VARHDRSZ);
-		memcpy(VARDATA(&chunk_data), data_p, chunk_size);
-		toasttup = heap_form_tuple(toasttupDesc, t_values, t_isnull);
+			/*
+			 * Build a tuple and add it to the batch
+			 */
+			t_values[1] = Int32GetDatum(chunk_seq++);
+			SET_VARSIZE(&chunk_data, chunk_size + VARHDRSZ);
+			memcpy(VARDATA(&chunk_data), data_p, chunk_size);
+			toasttup = heap_form_tuple(toasttupDesc, t_values, t_isnull);
+
+			if (nchunks == nslots)
+				slots[nslots++] = MakeSingleTupleTableSlot(toasttupDesc,
+														   &TTSOpsHeapTuple);
+			ExecStoreHeapTuple(toasttup, slots[nchunks], true);
+
+			idx_values[nchunks][0] = t_values[0];
+			idx_values[nchunks][1] = t_values[1];
+			idx_valuesp[nchunks] = idx_values[nchunks];
+			idx_isnullp[nchunks] = t_isnull;
+			nchunks++;
 
-		heap_insert(toastrel, toasttup, mycid, options, NULL);
+			/*
+			 * Move on to next chunk
+			 */
+			data_todo -= chunk_size;
+			data_p += chunk_size;
+		}
+
+		heap_multi_insert(toastrel, slots, nchunks, mycid, options, NULL);
+
+		for (i = 0; i < nchunks; i++)
+			idx_tids[i] = slots[i]->tts_tid;
 
 		/*
-		 * Create the index entry.  We cheat a little here by not using
+		 * Create the index entries.  We cheat a little here by not using
 		 * FormIndexDatum: this relies on the knowledge that the index columns
 		 * are the same as the initial columns of the table for all the
 		 * indexes.  We also cheat by not providing an IndexInfo: this is okay
 		 * for now because btree doesn't need one, but we might have to be
 		 * more honest someday.
 		 *
+		 * Batch insertion doesn't check uniqueness.  The entry for the first
+		 * chunk is inserted on its own with the check, which is enough to
+		 * protect the whole value: another backend could only collide with
+		 * us by using the same value ID, and then it would collide on chunk
+		 * zero too.
+		 *
 		 * Note also that there had better not be any user-created index on
 		 * the TOAST table, since we don't bother to update anything else.
 		 */
 		for (i = 0; i < num_indexes; i++)
 		{
+			int			first = 0;
+
 			/* Only index relations marked as ready can be updated */
-			if (toastidxs[i]->rd_index->indisready)
-				index_insert(toastidxs[i], t_values, t_isnull,
-							 &(toasttup->t_self),
+			if (!toastidxs[i]->rd_index->indisready)
+				continue;
+
+			if (first_seq == 0)
+			{
+				index_insert(toastidxs[i], idx_valuesp[0], idx_isnullp[0],
+							 &idx_tids[0],
 							 toastrel,
 							 toastidxs[i]->rd_index->indisunique ?
 							 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
 							 false, NULL);
+				first = 1;
+			}
+
+			if (nchunks > first)
+				index_insert_batch(toastidxs[i], &idx_valuesp[first],
+								   &idx_isnullp[first], &idx_tids[first],
+								   nchunks - first, toastrel, NULL);
 		}
 
 		/*
 		 * Free memory
 		 */
-		heap_freetuple(toasttup);
-
-		/*
-		 * Move on to next chunk
-		 */
-		data_todo -= chunk_size;
-		data_p += chunk_size;
+		for (i = 0; i < nchunks; i++)
+			ExecClearTuple(slots[i]);
 	}
 
+	for (int i = 0; i < nslots; i++)
+		ExecDropSingleTupleTableSlot(slots[i]);
+
 	/*
 	 * Done - close toast relation and its indexes
 	 */
@@ -227,6 +227,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		mustCleanup = false;
 	int			cleanupSize;
 	bool		needWal;
 
@@ -444,11 +445,17 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * while pending list is still small enough to fit into
 	 * gin_pending_list_limit.
 	 *
+	 * If the index has autocleanup set, we try to hand the work to autovacuum
+	 * instead, and only do it ourselves once the list has grown to twice the
+	 * limit.
+	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
 	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
 		needCleanup = true;
+	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 2048L)
+		mustCleanup = true;
 
 	UnlockReleaseBuffer(metabuffer);
 
@@ -459,7 +466,14 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * pending list not forcibly.
 	 */
 	if (needCleanup)
-		ginInsertCleanup(ginstate, false, true, false, NULL);
+	{
+		if (mustCleanup || !GinGetAutoCleanup(index) ||
+			!AutoVacuumingActive() ||
+			!AutoVacuumRequestWork(AVW_GINCleanPendingList,
+								   RelationGetRelid(index),
+								   InvalidBlockNumber))
+			ginInsertCleanup(ginstate, false, true, false, NULL);
+	}
 }
 
 /*
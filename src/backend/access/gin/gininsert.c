@@ -539,3 +539,81 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Insert index entries for several heap tuples.
+ *
+ * With fastupdate, the entries go to the pending list one heap tuple at a
+ * time, as the pending list requires.  Otherwise, we accumulate the entries
+ * of all the tuples, like ginInsertCleanup() does, so that each distinct key
+ * is looked up once and gets all its new item pointers in one go.
+ */
+void
+gininsertbatch(Relation index, Datum **values, bool **isnull,
+			   ItemPointer heap_tids, int ntuples, Relation heapRel,
+			   IndexInfo *indexInfo)
+{
+	GinState   *ginstate;
+	BuildAccumulator accum;
+	MemoryContext oldCtx;
+	MemoryContext insertCtx;
+	ItemPointerData *list;
+	OffsetNumber attnum;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	int			i,
+				j;
+
+	if (GinGetUseFastUpdate(index))
+	{
+		for (i = 0; i < ntuples; i++)
+			gininsert(index, values[i], isnull[i], &heap_tids[i], heapRel,
+					  UNIQUE_CHECK_NO, false, indexInfo);
+		return;
+	}
+
+	/* Initialize GinState cache if first call in this statement */
+	ginstate = (GinState *) indexInfo->ii_AmCache;
+	if (ginstate == NULL)
+	{
+		oldCtx = MemoryContextSwitchTo(indexInfo->ii_Context);
+		ginstate = (GinState *) palloc(sizeof(GinState));
+		initGinState(ginstate, index);
+		indexInfo->ii_AmCache = (void *) ginstate;
+		MemoryContextSwitchTo(oldCtx);
+	}
+
+	insertCtx = AllocSetContextCreate(CurrentMemoryContext,
+									  "Gin insert temporary context",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	oldCtx = MemoryContextSwitchTo(insertCtx);
+
+	ginInitBA(&accum);
+	accum.ginstate = ginstate;
+
+	for (i = 0; i < ntuples; i++)
+	{
+		for (j = 0; j < ginstate->origTupdesc->natts; j++)
+		{
+			Datum	   *entries;
+			GinNullCategory *categories;
+			int32		nentries;
+
+			entries = ginExtractEntries(ginstate, (OffsetNumber) (j + 1),
+										values[i][j], isnull[i][j],
+										&nentries, &categories);
+			ginInsertBAEntries(&accum, &heap_tids[i], (OffsetNumber) (j + 1),
+							   entries, categories, nentries);
+		}
+	}
+
+	ginBeginBAScan(&accum);
+	while ((list = ginGetBAEntry(&accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+		ginEntryInsert(ginstate, attnum, key, category, list, nlist, NULL);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(insertCtx);
+}
@@ -14,6 +14,9 @@
  *
  * The sorted method is used if the operator classes for all columns have
  * a 'sortsupport' defined. Otherwise, we resort to the second strategy.
+ * The table scan and sort of the sorted method can be performed by
+ * parallel workers, like in a B-tree build; the leader then merges their
+ * sorted runs and builds the pages.
  *
  * The second strategy can optionally use buffers at different levels of
  * the tree to reduce I/O, see "Buffering build algorithm" in the README
@@ -37,17 +40,31 @@
 #include "access/genam.h"
 #include "access/gist_private.h"
 #include "access/gistxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "optimizer/optimizer.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/smgr.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 #include "utils/tuplesort.h"
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIST_SHARED		UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
 /* Step of index tuples for check whether to switch to buffering build mode */
 #define BUFFERING_MODE_SWITCH_CHECK_STEP 256
 
@@ -78,6 +95,58 @@ typedef enum
 	GIST_BUFFERING_ACTIVE		/* in buffering build mode */
 } GistBuildMode;
 
+/*
+ * Status for sorted index builds performed in parallel.  This is allocated
+ * in a dynamic shared memory segment, followed by the parallel table scan
+ * descriptor.  As in nbtsort.c, there is a separate tuplesort TOC entry,
+ * private to tuplesort.c.
+ */
+typedef struct GISTShared
+{
+	/* Immutable state, used by workers to set up their own build state */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+
+	/* Signaled by each participant when it has finished scanning */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the following fields, which are reported back to the
+	 * leader at the end of the parallel scan.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+} GISTShared;
+
+#define ParallelTableScanFromGISTShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GISTShared)))
+
+/*
+ * Status for leader in parallel sorted index build.
+ */
+typedef struct GISTLeader
+{
+	ParallelContext *pcxt;
+
+	/*
+	 * Number of worker processes launched, plus one for the leader, which
+	 * always participates in the scan.
+	 */
+	int			nparticipanttuplesorts;
+
+	/* Convenience pointers to shared state */
+	GISTShared *gistshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GISTLeader;
+
 /* Working state for gistbuild and its callback */
 typedef struct
 {
@@ -104,6 +173,7 @@ typedef struct
 	 * Extra data structures used during a sorting build.
 	 */
 	Tuplesortstate *sortstate;	/* state data for tuplesort.c */
+	GISTLeader *gistleader;		/* parallel build leader state, or NULL */
 
 	BlockNumber pages_allocated;
 	BlockNumber pages_written;
@@ -136,6 +206,15 @@ static void gist_indexsortbuild_pagestate_add(GISTBuildState *state,
 static void gist_indexsortbuild_pagestate_flush(GISTBuildState *state,
 												GistSortedBuildPageState *pagestate);
 static void gist_indexsortbuild_flush_ready_pages(GISTBuildState *state);
+static void gistBeginParallel(GISTBuildState *buildstate, bool isconcurrent,
+							  int request);
+static void gistEndParallel(GISTLeader *gistleader);
+static double gistParallelHeapScan(GISTBuildState *buildstate,
+								   bool *brokenhotchain);
+static void gistParallelScanAndSort(Relation heap, Relation index,
+									GISTShared *gistshared,
+									Sharedsort *sharedsort,
+									int sortmem, bool progress);
 
 static void gistInitBuffering(GISTBuildState *buildstate);
 static int	calculatePagesPerBuffer(GISTBuildState *buildstate, int levelStep);
@@ -179,7 +258,6 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	GISTBuildState buildstate;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	int			fillfactor;
-	Oid			SortSupportFnOids[INDEX_MAX_KEYS];
 	GiSTOptions *options = (GiSTOptions *) index->rd_options;
 
 	/*
@@ -193,6 +271,7 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.indexrel = index;
 	buildstate.heaprel = heap;
 	buildstate.sortstate = NULL;
+	buildstate.gistleader = NULL;
 	buildstate.giststate = initGISTstate(index);
 
 	/*
@@ -224,24 +303,8 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/*
 	 * Unless buffering mode was forced, see if we can use sorting instead.
 	 */
-	if (buildstate.buildMode != GIST_BUFFERING_STATS)
-	{
-		bool		hasallsortsupports = true;
-		int			keyscount = IndexRelationGetNumberOfKeyAttributes(index);
-
-		for (int i = 0; i < keyscount; i++)
-		{
-			SortSupportFnOids[i] = index_getprocid(index, i + 1,
-												   GIST_SORTSUPPORT_PROC);
-			if (!OidIsValid(SortSupportFnOids[i]))
-			{
-				hasallsortsupports = false;
-				break;
-			}
-		}
-		if (hasallsortsupports)
-			buildstate.buildMode = GIST_SORTED_BUILD;
-	}
+	if (gistbuildcansort(index))
+		buildstate.buildMode = GIST_SORTED_BUILD;
 
 	/*
 	 * Calculate target amount of free space to leave on pages.
@@ -257,19 +320,46 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 
 	if (buildstate.buildMode == GIST_SORTED_BUILD)
 	{
+		SortCoordinate coordinate = NULL;
+
+		/*
+		 * Attempt to launch parallel workers to scan the table and sort
+		 * their share of it.  The leader takes part in the scan before we
+		 * get back here.
+		 */
+		if (indexInfo->ii_ParallelWorkers > 0)
+			gistBeginParallel(&buildstate, indexInfo->ii_Concurrent,
+							  indexInfo->ii_ParallelWorkers);
+
+		if (buildstate.gistleader)
+		{
+			coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+			coordinate->isWorker = false;
+			coordinate->nParticipants =
+				buildstate.gistleader->nparticipanttuplesorts;
+			coordinate->sharedsort = buildstate.gistleader->sharedsort;
+		}
+
 		/*
 		 * Sort all data, build the index from bottom up.
 		 */
 		buildstate.sortstate = tuplesort_begin_index_gist(heap,
 														  index,
 														  maintenance_work_mem,
-														  NULL,
+														  coordinate,
 														  false);
 
-		/* Scan the table, adding all tuples to the tuplesort */
-		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
-										   gistSortedBuildCallback,
-										   (void *) &buildstate, NULL);
+		/*
+		 * Scan the table, adding all tuples to the tuplesort, or wait for
+		 * the participants of a parallel build to finish doing so.
+		 */
+		if (!buildstate.gistleader)
+			reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+											   gistSortedBuildCallback,
+											   (void *) &buildstate, NULL);
+		else
+			reltuples = gistParallelHeapScan(&buildstate,
+											 &indexInfo->ii_BrokenHotChain);
 
 		/*
 		 * Perform the sort and build index pages.
@@ -279,6 +369,9 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 		gist_indexsortbuild(&buildstate);
 
 		tuplesort_end(buildstate.sortstate);
+
+		if (buildstate.gistleader)
+			gistEndParallel(buildstate.gistleader);
 	}
 	else
 	{
@@ -350,6 +443,30 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ * Will gistbuild() build the index by sorting?  This is the case if the
+ * operator classes of all key columns provide a sortsupport function,
+ * unless buffering was explicitly requested.  Only sorted builds can be
+ * performed in parallel.
+ */
+bool
+gistbuildcansort(Relation index)
+{
+	GiSTOptions *options = (GiSTOptions *) index->rd_options;
+	int			keyscount = IndexRelationGetNumberOfKeyAttributes(index);
+
+	if (options && options->buffering_mode == GIST_OPTION_BUFFERING_ON)
+		return false;
+
+	for (int i = 0; i < keyscount; i++)
+	{
+		if (!OidIsValid(index_getprocid(index, i + 1, GIST_SORTSUPPORT_PROC)))
+			return false;
+	}
+
+	return true;
+}
+
 /*-------------------------------------------------------------------------
  * Routines for sorted build
  *-------------------------------------------------------------------------
@@ -588,6 +705,336 @@ gist_indexsortbuild_flush_ready_pages(GISTBuildState *state)
 }
 
 
+/*-------------------------------------------------------------------------
+ * Routines for parallel sorted build
+ *
+ * These closely follow the corresponding routines in nbtsort.c.  Each
+ * participant scans part of the table and sorts its tuples into a run of
+ * the shared tuplesort; the leader then merges the runs and builds the
+ * index pages from the merged output with gist_indexsortbuild().
+ *-------------------------------------------------------------------------
+ */
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * If at least one worker was launched, buildstate->gistleader is set, and
+ * caller must use gistEndParallel() once the index has been built.  The
+ * leader's own share of the scan is done before we return.  Otherwise,
+ * caller should proceed with a serial build.
+ */
+static void
+gistBeginParallel(GISTBuildState *buildstate, bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estgistshared;
+	Size		estsort;
+	GISTShared *gistshared;
+	Sharedsort *sharedsort;
+	GISTLeader *gistleader = (GISTLeader *) palloc0(sizeof(GISTLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gist_parallel_build_main",
+								 request);
+
+	/* The leader participates as a worker, too */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * As in a B-tree build, a normal build scans with SnapshotAny and does
+	 * its own visibility checks, while a concurrent build uses an MVCC
+	 * snapshot.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/* Estimate size of shared state, tuplesort state, and usage counters */
+	estgistshared = add_size(BUFFERALIGN(sizeof(GISTShared)),
+							 table_parallelscan_estimate(buildstate->heaprel,
+														 snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estgistshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	gistshared = (GISTShared *) shm_toc_allocate(pcxt->toc, estgistshared);
+	gistshared->heaprelid = RelationGetRelid(buildstate->heaprel);
+	gistshared->indexrelid = RelationGetRelid(buildstate->indexrel);
+	gistshared->isconcurrent = isconcurrent;
+	gistshared->scantuplesortstates = scantuplesortstates;
+	ConditionVariableInit(&gistshared->workersdonecv);
+	SpinLockInit(&gistshared->mutex);
+	gistshared->nparticipantsdone = 0;
+	gistshared->reltuples = 0.0;
+	gistshared->indtuples = 0.0;
+	gistshared->brokenhotchain = false;
+	table_parallelscan_initialize(buildstate->heaprel,
+								  ParallelTableScanFromGISTShared(gistshared),
+								  snapshot);
+
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIST_SHARED, gistshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+	gistleader->pcxt = pcxt;
+	gistleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	gistleader->gistshared = gistshared;
+	gistleader->sharedsort = sharedsort;
+	gistleader->snapshot = snapshot;
+	gistleader->walusage = walusage;
+	gistleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		gistEndParallel(gistleader);
+		return;
+	}
+
+	buildstate->gistleader = gistleader;
+
+	/*
+	 * Join the scan ourselves, with a fair share of maintenance_work_mem.
+	 * Our own sort is finished and its memory released before the leader's
+	 * merging tuplesort is started.
+	 */
+	gistParallelScanAndSort(buildstate->heaprel, buildstate->indexrel,
+							gistshared, sharedsort,
+							maintenance_work_mem / gistleader->nparticipanttuplesorts,
+							true);
+
+	/* Make sure that the failure-to-start case will not hang forever */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+gistEndParallel(GISTLeader *gistleader)
+{
+	WaitForParallelWorkersToFinish(gistleader->pcxt);
+
+	/* Accumulate the workers' WAL and buffer usage */
+	for (int i = 0; i < gistleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&gistleader->bufferusage[i],
+								&gistleader->walusage[i]);
+
+	if (IsMVCCSnapshot(gistleader->snapshot))
+		UnregisterSnapshot(gistleader->snapshot);
+	DestroyParallelContext(gistleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, wait for all participants to finish their scan.
+ *
+ * Fills in the tuple count of buildstate and *brokenhotchain, and returns
+ * the total number of heap tuples scanned.
+ */
+static double
+gistParallelHeapScan(GISTBuildState *buildstate, bool *brokenhotchain)
+{
+	GISTShared *gistshared = buildstate->gistleader->gistshared;
+	int			nparticipanttuplesorts;
+	double		reltuples;
+
+	nparticipanttuplesorts = buildstate->gistleader->nparticipanttuplesorts;
+	for (;;)
+	{
+		SpinLockAcquire(&gistshared->mutex);
+		if (gistshared->nparticipantsdone == nparticipanttuplesorts)
+		{
+			buildstate->indtuples = (int64) gistshared->indtuples;
+			*brokenhotchain = gistshared->brokenhotchain;
+			reltuples = gistshared->reltuples;
+			SpinLockRelease(&gistshared->mutex);
+			break;
+		}
+		SpinLockRelease(&gistshared->mutex);
+
+		ConditionVariableSleep(&gistshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Perform a participant's share of the scan, and sort its tuples.
+ *
+ * sortmem is the amount of working memory to use, in KBs.
+ */
+static void
+gistParallelScanAndSort(Relation heap, Relation index,
+						GISTShared *gistshared, Sharedsort *sharedsort,
+						int sortmem, bool progress)
+{
+	GISTBuildState buildstate;
+	SortCoordinate coordinate;
+	TableScanDesc scan;
+	IndexInfo  *indexInfo;
+	double		reltuples;
+
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Set up just enough build state for gistSortedBuildCallback() */
+	memset(&buildstate, 0, sizeof(buildstate));
+	buildstate.indexrel = index;
+	buildstate.heaprel = heap;
+	buildstate.buildMode = GIST_SORTED_BUILD;
+	buildstate.giststate = initGISTstate(index);
+	buildstate.giststate->tempCxt = createTempGistContext();
+	buildstate.sortstate = tuplesort_begin_index_gist(heap, index, sortmem,
+													  coordinate, false);
+
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = gistshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGISTShared(gistshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   gistSortedBuildCallback,
+									   (void *) &buildstate, scan);
+
+	tuplesort_performsort(buildstate.sortstate);
+
+	SpinLockAcquire(&gistshared->mutex);
+	gistshared->nparticipantsdone++;
+	gistshared->reltuples += reltuples;
+	gistshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		gistshared->brokenhotchain = true;
+	SpinLockRelease(&gistshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&gistshared->workersdonecv);
+
+	tuplesort_end(buildstate.sortstate);
+	MemoryContextDelete(buildstate.giststate->tempCxt);
+	freeGISTstate(buildstate.giststate);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gist_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GISTShared *gistshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	gistshared = shm_toc_lookup(toc, PARALLEL_KEY_GIST_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!gistshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	heapRel = table_open(gistshared->heaprelid, heapLockmode);
+	indexRel = index_open(gistshared->indexrelid, indexLockmode);
+
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	gistParallelScanAndSort(heapRel, indexRel, gistshared, sharedsort,
+							maintenance_work_mem / gistshared->scantuplesortstates,
+							false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
 /*-------------------------------------------------------------------------
  * Routines for non-sorted build
  *-------------------------------------------------------------------------
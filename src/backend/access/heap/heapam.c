@@ -67,6 +67,7 @@
 #include "utils/datum.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/spccache.h"
@@ -219,6 +220,31 @@ static const int MultiXactStatusLock[MaxMultiXactStatus + 1] =
  * ----------------------------------------------------------------
  */
 
+/*
+ * heap_scan_stream_next_block - read stream callback for sequential scans
+ *
+ * Hands out pages in the order heapgettup visits them when moving forward,
+ * wrapping around at the end of the relation.
+ */
+static BlockNumber
+heap_scan_stream_next_block(ReadStream *stream, void *callback_private)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_private;
+	BlockNumber blkno = scan->rs_stream_next;
+
+	if (blkno != InvalidBlockNumber)
+	{
+		BlockNumber next = blkno + 1;
+
+		if (next >= scan->rs_nblocks)
+			next = 0;
+		scan->rs_stream_next = (next == scan->rs_stream_stop) ?
+			InvalidBlockNumber : next;
+	}
+
+	return blkno;
+}
+
 /* ----------------
  *		initscan - scan code common to heap_beginscan and heap_rescan
  * ----------------
@@ -314,6 +340,43 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 		scan->rs_startblock = 0;
 	}
 
+	/*
+	 * Plain sequential scans read the relation in block order (apart from a
+	 * possible wraparound for synchronized scans), so they can prefetch
+	 * ahead of themselves.  Parallel workers each see only a fraction of the
+	 * blocks, and sample scans skip around, so leave them alone.
+	 */
+	if ((scan->rs_base.rs_flags & SO_TYPE_SEQSCAN) &&
+		scan->rs_base.rs_parallel == NULL)
+		ReadAheadInit(&scan->rs_readahead, MAIN_FORKNUM, scan->rs_nblocks,
+					  get_tablespace_io_concurrency(scan->rs_base.rs_rd->rd_rel->reltablespace));
+	else
+		ReadAheadInit(&scan->rs_readahead, MAIN_FORKNUM, scan->rs_nblocks, 0);
+
+	/*
+	 * (Re)create the read stream, since the strategy may have changed.  It's
+	 * allocated alongside the scan descriptor, whatever context we're in now.
+	 */
+	if (scan->rs_stream != NULL)
+	{
+		ReadStreamEnd(scan->rs_stream);
+		scan->rs_stream = NULL;
+	}
+	if ((scan->rs_base.rs_flags & SO_TYPE_SEQSCAN) &&
+		scan->rs_base.rs_parallel == NULL)
+	{
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(GetMemoryChunkContext(scan));
+		scan->rs_stream = ReadStreamBegin(scan->rs_base.rs_rd, MAIN_FORKNUM,
+										  scan->rs_strategy,
+										  heap_scan_stream_next_block,
+										  scan);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	scan->rs_stream_expect = InvalidBlockNumber;
+	scan->rs_stream_next = InvalidBlockNumber;
+
 	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
 	scan->rs_ctup.t_data = NULL;
@@ -358,6 +421,10 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 
 	scan->rs_startblock = startBlk;
 	scan->rs_numblocks = numBlks;
+
+	/* don't read ahead past the end of the range */
+	if (numBlks != InvalidBlockNumber)
+		scan->rs_readahead.nblocks = Min(scan->rs_nblocks, startBlk + numBlks);
 }
 
 /*
@@ -396,11 +463,45 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
-	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	/* get the kernel started on the pages that follow, if worthwhile */
+	ReadAheadBlock(&scan->rs_readahead, scan->rs_base.rs_rd, page);
+
+	/*
+	 * If the scan is moving forward page by page, take the page from the
+	 * read stream, which reads runs of pages with one system call.
+	 */
+	if (scan->rs_stream != NULL && page == scan->rs_stream_expect)
+		scan->rs_cbuf = ReadStreamNextBuffer(scan->rs_stream);
+
+	if (!BufferIsValid(scan->rs_cbuf))
+	{
+		/*
+		 * First page, or the scan changed direction or position: read this
+		 * page directly, and restart the stream just after it.
+		 */
+		if (scan->rs_stream != NULL)
+		{
+			ReadStreamReset(scan->rs_stream);
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				scan->rs_stream_stop = (page + scan->rs_numblocks) % scan->rs_nblocks;
+			else
+				scan->rs_stream_stop = scan->rs_startblock;
+			/* consume this page from the callback's point of view */
+			scan->rs_stream_next = page;
+			(void) heap_scan_stream_next_block(scan->rs_stream, scan);
+		}
+
+		/* read page using selected strategy */
+		scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM,
+										   page, RBM_NORMAL, scan->rs_strategy);
+	}
+	Assert(BufferGetBlockNumber(scan->rs_cbuf) == page);
 	scan->rs_cblock = page;
 
+	/* the page that continues a forward scan, if there is one */
+	if (scan->rs_stream != NULL)
+		scan->rs_stream_expect = (page + 1 < scan->rs_nblocks) ? page + 1 : 0;
+
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
 		return;
 
@@ -1209,6 +1310,8 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	scan->rs_base.rs_flags = flags;
 	scan->rs_base.rs_parallel = parallel_scan;
 	scan->rs_strategy = NULL;	/* set in initscan */
+	scan->rs_stream = NULL;		/* set in initscan */
+	scan->rs_skipatts = NULL;
 
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
@@ -1324,12 +1427,18 @@ heap_endscan(TableScanDesc sscan)
 	if (scan->rs_base.rs_key)
 		pfree(scan->rs_base.rs_key);
 
+	if (scan->rs_stream != NULL)
+		ReadStreamEnd(scan->rs_stream);
+
 	if (scan->rs_strategy != NULL)
 		FreeAccessStrategy(scan->rs_strategy);
 
 	if (scan->rs_parallelworkerdata != NULL)
 		pfree(scan->rs_parallelworkerdata);
 
+	if (scan->rs_skipatts != NULL)
+		pfree(scan->rs_skipatts);
+
 	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
 		UnregisterSnapshot(scan->rs_base.rs_snapshot);
 
@@ -1412,9 +1521,44 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 
 	ExecStoreBufferHeapTuple(&scan->rs_ctup, slot,
 							 scan->rs_cbuf);
+	((BufferHeapTupleTableSlot *) slot)->skipatts = scan->rs_skipatts;
 	return true;
 }
 
+/*
+ * heap_set_column_projection - remember which columns the caller needs
+ *
+ * Heap tuples always have to be read whole, but slots filled by
+ * heap_getnextslot() are told to skip over the columns that aren't needed
+ * when deforming, rather than fetching each of them.
+ */
+void
+heap_set_column_projection(TableScanDesc sscan, Bitmapset *attrs)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	TupleDesc	tupdesc = RelationGetDescr(sscan->rs_rd);
+	bool	   *skipatts;
+	bool		anyskipped = false;
+
+	skipatts = palloc(tupdesc->natts * sizeof(bool));
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		skipatts[i] = !bms_is_member(i + 1 - FirstLowInvalidHeapAttributeNumber,
+									 attrs);
+		anyskipped |= skipatts[i];
+	}
+
+	if (scan->rs_skipatts != NULL)
+		pfree(scan->rs_skipatts);
+	if (anyskipped)
+		scan->rs_skipatts = skipatts;
+	else
+	{
+		pfree(skipatts);
+		scan->rs_skipatts = NULL;
+	}
+}
+
 void
 heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 				  ItemPointer maxtid)
@@ -2011,6 +2155,9 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->already_extended_by = 0;
 	return bistate;
 }
 
@@ -2035,6 +2182,14 @@ ReleaseBulkInsertStatePin(BulkInsertState bistate)
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	bistate->current_buf = InvalidBuffer;
+
+	/*
+	 * Forget about any blocks we extended by but haven't used; the caller
+	 * might be about to switch to inserting into a different relation.
+	 */
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->already_extended_by = 0;
 }
 
 
@@ -2065,6 +2220,7 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	Buffer		buffer;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		all_visible_cleared = false;
+	bool		all_frozen_set = false;
 
 	/* Cheap, simplistic check that the tuple matches the rel's rowtype. */
 	Assert(HeapTupleHeaderGetNatts(tup->t_data) <=
@@ -2086,6 +2242,15 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 									   InvalidBuffer, options, bistate,
 									   &vmbuffer, NULL);
 
+	/*
+	 * If we're inserting a frozen tuple into an empty page, the page can be
+	 * marked all-visible and all-frozen right away, as in heap_multi_insert.
+	 * RelationGetBufferForTuple has pinned the visibility map page for that.
+	 */
+	if ((options & HEAP_INSERT_FROZEN) &&
+		PageGetMaxOffsetNumber(BufferGetPage(buffer)) == 0)
+		all_frozen_set = true;
+
 	/*
 	 * We're about to do the actual insert -- but check for conflict first, to
 	 * avoid possibly having to roll back work we've just done.
@@ -2109,7 +2274,13 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	RelationPutHeapTuple(relation, buffer, heaptup,
 						 (options & HEAP_INSERT_SPECULATIVE) != 0);
 
-	if (PageIsAllVisible(BufferGetPage(buffer)))
+	/*
+	 * If the page is all visible, need to clear that, unless the tuple we
+	 * added is frozen.  If it's the first tuple on the page, mark the page
+	 * all-visible (see above).
+	 */
+	if (PageIsAllVisible(BufferGetPage(buffer)) &&
+		!(options & HEAP_INSERT_FROZEN))
 	{
 		all_visible_cleared = true;
 		PageClearAllVisible(BufferGetPage(buffer));
@@ -2117,6 +2288,8 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 							ItemPointerGetBlockNumber(&(heaptup->t_self)),
 							vmbuffer, VISIBILITYMAP_VALID_BITS);
 	}
+	else if (all_frozen_set)
+		PageSetAllVisible(BufferGetPage(buffer));
 
 	/*
 	 * XXX Should we set PageSetPrunable on this page ?
@@ -2164,6 +2337,8 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 		xlrec.flags = 0;
 		if (all_visible_cleared)
 			xlrec.flags |= XLH_INSERT_ALL_VISIBLE_CLEARED;
+		if (all_frozen_set)
+			xlrec.flags |= XLH_INSERT_ALL_FROZEN_SET;
 		if (options & HEAP_INSERT_SPECULATIVE)
 			xlrec.flags |= XLH_INSERT_IS_SPECULATIVE;
 		Assert(ItemPointerGetBlockNumber(&heaptup->t_self) == BufferGetBlockNumber(buffer));
@@ -2212,6 +2387,21 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
 	END_CRIT_SECTION();
 
+	/*
+	 * If we've frozen everything on the page, update the visibility map.  See
+	 * heap_multi_insert for why InvalidTransactionId is fine here.
+	 */
+	if (all_frozen_set)
+	{
+		Assert(PageIsAllVisible(BufferGetPage(buffer)));
+		Assert(visibilitymap_pin_ok(BufferGetBlockNumber(buffer), vmbuffer));
+
+		visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
+						  InvalidXLogRecPtr, vmbuffer,
+						  InvalidTransactionId,
+						  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+	}
+
 	UnlockReleaseBuffer(buffer);
 	if (vmbuffer != InvalidBuffer)
 		ReleaseBuffer(vmbuffer);
@@ -2314,8 +2504,9 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	bool		need_tuple_data = RelationIsLogicallyLogged(relation);
 	bool		need_cids = RelationIsAccessibleInLogicalDecoding(relation);
 
-	/* currently not needed (thus unsupported) for heap_multi_insert() */
-	AssertArg(!(options & HEAP_INSERT_NO_LOGICAL));
+	/* as in heap_insert(), the caller can keep the tuples from decoding */
+	if (options & HEAP_INSERT_NO_LOGICAL)
+		need_tuple_data = false;
 
 	needwal = RelationNeedsWAL(relation);
 	saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
@@ -2521,8 +2712,13 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 			Assert((scratchptr - scratch.data) < BLCKSZ);
 
 			if (need_tuple_data)
+			{
 				xlrec->flags |= XLH_INSERT_CONTAINS_NEW_TUPLE;
 
+				if (IsToastRelation(relation))
+					xlrec->flags |= XLH_INSERT_ON_TOAST_RELATION;
+			}
+
 			/*
 			 * Signal that this is the last xl_heap_multi_insert record
 			 * emitted by this call to heap_multi_insert(). Needed for logical
@@ -8716,9 +8912,10 @@ heap_xlog_freeze_page(XLogReaderState *record)
 
 	/*
 	 * In Hot Standby mode, ensure that there's no queries running which still
-	 * consider the frozen xids as running.
+	 * consider the frozen xids as running.  The cutoff is invalid if none
+	 * of the frozen xids could be considered running by anyone.
 	 */
-	if (InHotStandby)
+	if (InHotStandby && TransactionIdIsValid(cutoff_xid))
 	{
 		RelFileNode rnode;
 		TransactionId latestRemovedXid = cutoff_xid;
@@ -27,6 +27,7 @@
 #include "access/syncscan.h"
 #include "access/tableam.h"
 #include "access/tsmapi.h"
+#include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/index.h"
@@ -82,6 +83,8 @@ heapam_index_fetch_begin(Relation rel)
 
 	hscan->xs_base.rel = rel;
 	hscan->xs_cbuf = InvalidBuffer;
+	hscan->xs_prefetch_block = InvalidBlockNumber;
+	hscan->xs_vmbuffer = InvalidBuffer;
 
 	return &hscan->xs_base;
 }
@@ -96,6 +99,7 @@ heapam_index_fetch_reset(IndexFetchTableData *scan)
 		ReleaseBuffer(hscan->xs_cbuf);
 		hscan->xs_cbuf = InvalidBuffer;
 	}
+	hscan->xs_prefetch_block = InvalidBlockNumber;
 }
 
 static void
@@ -105,9 +109,33 @@ heapam_index_fetch_end(IndexFetchTableData *scan)
 
 	heapam_index_fetch_reset(scan);
 
+	if (BufferIsValid(hscan->xs_vmbuffer))
+		ReleaseBuffer(hscan->xs_vmbuffer);
+
 	pfree(hscan);
 }
 
+static void
+heapam_index_fetch_prefetch(IndexFetchTableData *scan, ItemPointer tid,
+							bool skip_all_visible)
+{
+#ifdef USE_PREFETCH
+	IndexFetchHeapData *hscan = (IndexFetchHeapData *) scan;
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+
+	/* index order often visits the same block several times in a row */
+	if (blkno == hscan->xs_prefetch_block)
+		return;
+	hscan->xs_prefetch_block = blkno;
+
+	if (skip_all_visible &&
+		VM_ALL_VISIBLE(scan->rel, blkno, &hscan->xs_vmbuffer))
+		return;
+
+	(void) PrefetchBuffer(scan->rel, MAIN_FORKNUM, blkno);
+#endif							/* USE_PREFETCH */
+}
+
 static bool
 heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 						 ItemPointer tid,
@@ -1792,8 +1820,16 @@ heapam_index_validate_scan(Relation heapRelation,
 								 false);	/* syncscan not OK */
 	hscan = (HeapScanDesc) scan;
 
-	pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
-								 hscan->rs_nblocks);
+	/*
+	 * In a parallel validation, we scan only the part of the table matching
+	 * our share of the TIDs, and validate_index takes care of progress
+	 * reporting.
+	 */
+	if (state->numblocks != InvalidBlockNumber)
+		heap_setscanlimits(scan, state->startblock, state->numblocks);
+	else
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+									 hscan->rs_nblocks);
 
 	/*
 	 * Scan all tuples matching the snapshot.
@@ -1808,8 +1844,9 @@ heapam_index_validate_scan(Relation heapRelation,
 
 		state->htups += 1;
 
-		if ((previous_blkno == InvalidBlockNumber) ||
-			(hscan->rs_cblock != previous_blkno))
+		if (state->numblocks == InvalidBlockNumber &&
+			((previous_blkno == InvalidBlockNumber) ||
+			 (hscan->rs_cblock != previous_blkno)))
 		{
 			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
 										 hscan->rs_cblock);
@@ -1868,9 +1905,6 @@ heapam_index_validate_scan(Relation heapRelation,
 			   (!indexcursor ||
 				ItemPointerCompare(indexcursor, &rootTuple) < 0))
 		{
-			Datum		ts_val;
-			bool		ts_isnull;
-
 			if (indexcursor)
 			{
 				/*
@@ -1880,19 +1914,9 @@ heapam_index_validate_scan(Relation heapRelation,
 					in_index[ItemPointerGetOffsetNumber(indexcursor) - 1] = true;
 			}
 
-			tuplesort_empty = !tuplesort_getdatum(state->tuplesort, true,
-												  &ts_val, &ts_isnull, NULL);
-			Assert(tuplesort_empty || !ts_isnull);
+			tuplesort_empty = !validate_index_next_tid(state, &decoded);
 			if (!tuplesort_empty)
-			{
-				itemptr_decode(&decoded, DatumGetInt64(ts_val));
 				indexcursor = &decoded;
-
-				/* If int8 is pass-by-ref, free (encoded) TID Datum memory */
-#ifndef USE_FLOAT8_BYVAL
-				pfree(DatumGetPointer(ts_val));
-#endif
-			}
 			else
 			{
 				/* Be tidy */
@@ -2547,6 +2571,7 @@ static const TableAmRoutine heapam_methods = {
 
 	.scan_set_tidrange = heap_set_tidrange,
 	.scan_getnextslot_tidrange = heap_getnextslot_tidrange,
+	.scan_set_column_projection = heap_set_column_projection,
 
 	.parallelscan_estimate = table_block_parallelscan_estimate,
 	.parallelscan_initialize = table_block_parallelscan_initialize,
@@ -2556,6 +2581,7 @@ static const TableAmRoutine heapam_methods = {
 	.index_fetch_reset = heapam_index_fetch_reset,
 	.index_fetch_end = heapam_index_fetch_end,
 	.index_fetch_tuple = heapam_index_fetch_tuple,
+	.index_fetch_prefetch = heapam_index_fetch_prefetch,
 
 	.tuple_insert = heapam_tuple_insert,
 	.tuple_insert_speculative = heapam_tuple_insert_speculative,
@@ -78,6 +78,9 @@
 #include "utils/snapmgr.h"
 
 
+/* GUC parameter */
+bool		write_hint_bits = true;
+
 /*
  * SetHintBits()
  *
@@ -108,6 +111,13 @@
  *
  * The caller should pass xid as the XID of the transaction to check, or
  * InvalidTransactionId if no check is needed.
+ *
+ * If write_hint_bits is off, the hint bits are only set in the buffer, which
+ * is not marked dirty unless it already is.  That saves the writes (and with
+ * checksums, the full-page images) caused by the first read of freshly
+ * loaded data, at the price of checking the commit log again after the page
+ * has been evicted.  Modifying the page without dirtying it is OK for hints,
+ * as MarkBufferDirtyHint itself sometimes doesn't dirty the page either.
  */
 static inline void
 SetHintBits(HeapTupleHeader tuple, Buffer buffer,
@@ -127,7 +137,8 @@ SetHintBits(HeapTupleHeader tuple, Buffer buffer,
 	}
 
 	tuple->t_infomask |= infomask;
-	MarkBufferDirtyHint(buffer, true);
+	if (write_hint_bits || BufferIsDirty(buffer))
+		MarkBufferDirtyHint(buffer, true);
 }
 
 /*
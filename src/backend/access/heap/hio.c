@@ -19,11 +19,26 @@
 #include "access/hio.h"
 #include "access/htup_details.h"
 #include "access/visibilitymap.h"
+#include "storage/backendid.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
 
+/*
+ * With insert_page_affinity, backends start looking for free space this many
+ * pages apart at most, see RelationGetBufferForTuple.
+ */
+#define INSERT_AFFINITY_SPREAD	64
+
+/* GUC parameter */
+bool		insert_page_affinity = false;
+
+/*
+ * A bulk insert extends the relation by at most this many blocks at a time.
+ */
+#define BULK_INSERT_MAX_EXTEND	64
+
 
 /*
  * RelationPutHeapTuple - place tuple at specified page
@@ -185,6 +200,30 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 	}
 }
 
+/*
+ * Extend a relation by nblocks all-zeroes pages with a single request to the
+ * storage manager, and return the number of the first one.  The caller must
+ * hold the relation extension lock, if one is needed.
+ *
+ * The pages don't go through shared buffers, and we don't initialize them:
+ * if we did, they would potentially get flushed out to disk before we add
+ * any useful content.  There's no guarantee that that'd happen before a
+ * potential crash, so we need to deal with uninitialized pages anyway (see
+ * RelationGetBufferForTuple), thus avoid the potential for unnecessary
+ * writes.
+ */
+static BlockNumber
+RelationExtendZeroed(Relation relation, int nblocks)
+{
+	SMgrRelation reln = RelationGetSmgr(relation);
+	BlockNumber firstBlock;
+
+	firstBlock = smgrnblocks(reln, MAIN_FORKNUM);
+	smgrzeroextend(reln, MAIN_FORKNUM, firstBlock, nblocks, false);
+
+	return firstBlock;
+}
+
 /*
  * Extend a relation by multiple blocks to avoid future contention on the
  * relation extension lock.  Our goal is to pre-extend the relation by an
@@ -192,10 +231,11 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  * the result to some sane overall value.
  */
 static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+RelationAddExtraBlocks(Relation relation)
 {
 	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
+				firstBlock;
+	Size		freespace;
 	int			extraBlocks;
 	int			lockWaiters;
 
@@ -212,53 +252,20 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 */
 	extraBlocks = Min(512, lockWaiters * 20);
 
-	do
-	{
-		Buffer		buffer;
-		Page		page;
-		Size		freespace;
-
-		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout, and we don't immediately
-		 * initialize the page (see below).
-		 */
-		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-		page = BufferGetPage(buffer);
-
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
-
-		/*
-		 * Add the page to the FSM without initializing. If we were to
-		 * initialize here, the page would potentially get flushed out to disk
-		 * before we add any useful content. There's no guarantee that that'd
-		 * happen before a potential crash, so we need to deal with
-		 * uninitialized pages anyway, thus avoid the potential for
-		 * unnecessary writes.
-		 */
-
-		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
-
-		UnlockReleaseBuffer(buffer);
-
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+	/*
+	 * Reserve all the blocks at once, so that the waiters are held up by
+	 * only one storage request rather than one per block.
+	 */
+	firstBlock = RelationExtendZeroed(relation, extraBlocks);
+	freespace = BLCKSZ - SizeOfPageHeaderData;
 
-		/*
-		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
-		 */
+	/*
+	 * Immediately update the bottom level of the FSM.  This has a good chance
+	 * of making these pages visible to other concurrently inserting backends,
+	 * and we want that to happen without delay.
+	 */
+	for (blockNum = firstBlock; blockNum < firstBlock + extraBlocks; blockNum++)
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
-	}
-	while (--extraBlocks > 0);
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
@@ -266,7 +273,7 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
 	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	FreeSpaceMapVacuumRange(relation, firstBlock, firstBlock + extraBlocks);
 }
 
 /*
@@ -405,8 +412,23 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		/*
 		 * We have no cached target page, so ask the FSM for an initial
 		 * target.
+		 *
+		 * Concurrent inserters tend to be handed the same page, and then
+		 * contend for its buffer lock.  With insert_page_affinity, each
+		 * backend instead starts from its own offset from the page the FSM
+		 * suggests, and later keeps searching onwards from its own current
+		 * page (see below), so that concurrent inserters fill different
+		 * pages.
 		 */
 		targetBlock = GetPageWithFreeSpace(relation, targetFreeSpace);
+		if (insert_page_affinity && targetBlock != InvalidBlockNumber)
+		{
+			BlockNumber nearBlock;
+
+			nearBlock = targetBlock + MyBackendId % INSERT_AFFINITY_SPREAD;
+			targetBlock = GetPageWithFreeSpaceNear(relation, targetFreeSpace,
+												   nearBlock);
+		}
 	}
 
 	/*
@@ -560,10 +582,33 @@ loop:
 		 * Update FSM as to condition of this page, and ask for another page
 		 * to try.
 		 */
-		targetBlock = RecordAndGetPageWithFreeSpace(relation,
-													targetBlock,
-													pageFreeSpace,
-													targetFreeSpace);
+		if (insert_page_affinity)
+		{
+			RecordPageWithFreeSpace(relation, targetBlock, pageFreeSpace);
+			targetBlock = GetPageWithFreeSpaceNear(relation, targetFreeSpace,
+												   targetBlock + 1);
+		}
+		else
+			targetBlock = RecordAndGetPageWithFreeSpace(relation,
+														targetBlock,
+														pageFreeSpace,
+														targetFreeSpace);
+	}
+
+	/*
+	 * If this bulk insert extended the relation by several blocks before, use
+	 * the next of those before extending again.  Someone else might have
+	 * found the block and put tuples on it meanwhile (VACUUM records empty
+	 * pages in the FSM), but the loop above copes with that.
+	 */
+	if (bistate && bistate->next_free != InvalidBlockNumber)
+	{
+		targetBlock = bistate->next_free;
+		if (bistate->next_free == bistate->last_free)
+			bistate->next_free = bistate->last_free = InvalidBlockNumber;
+		else
+			bistate->next_free++;
+		goto loop;
 	}
 
 	/*
@@ -608,7 +653,33 @@ loop:
 			}
 
 			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
+			RelationAddExtraBlocks(relation);
+		}
+	}
+
+	/*
+	 * A bulk insert is likely to need many more blocks, so extend by
+	 * several at once, keeping the extra ones for our own use in later
+	 * calls.  Starting with one block and doubling each time keeps small
+	 * bulk inserts from leaving many empty blocks behind.
+	 */
+	if (bistate)
+	{
+		uint32		extraBlocks;
+
+		extraBlocks = Min(bistate->already_extended_by,
+						  BULK_INSERT_MAX_EXTEND - 1);
+		bistate->already_extended_by += extraBlocks + 1;
+
+		if (extraBlocks > 0)
+		{
+			BlockNumber firstBlock;
+
+			firstBlock = RelationExtendZeroed(relation, extraBlocks);
+
+			if (bistate->next_free == InvalidBlockNumber)
+				bistate->next_free = firstBlock;
+			bistate->last_free = firstBlock + extraBlocks - 1;
 		}
 	}
 
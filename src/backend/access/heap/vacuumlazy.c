@@ -61,6 +61,7 @@
 #include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
@@ -79,6 +80,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/spccache.h"
 #include "utils/timestamp.h"
 
 
@@ -408,6 +410,10 @@ static void lazy_scan_prune(LVRelState *vacrel, Buffer buf,
 							BlockNumber blkno, Page page,
 							GlobalVisState *vistest,
 							LVPagePruneState *prunestate);
+static bool lazy_page_freeze_is_cheap(LVRelState *vacrel, Buffer buf,
+									  Page page, int nfrozen);
+static void lazy_freeze_conflict_xid(HeapTupleHeader tuple,
+									 TransactionId *conflict_xid);
 static void lazy_vacuum(LVRelState *vacrel);
 static bool lazy_vacuum_all_indexes(LVRelState *vacrel);
 static void lazy_vacuum_heap_rel(LVRelState *vacrel);
@@ -447,7 +453,6 @@ static void lazy_space_alloc(LVRelState *vacrel, int nworkers,
 							 BlockNumber relblocks);
 static void lazy_space_free(LVRelState *vacrel);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(LVRelState *vacrel, Buffer buf,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 static int	compute_parallel_vacuum_workers(LVRelState *vacrel,
@@ -914,6 +919,7 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		skipping_blocks;
+	ReadAheadState readahead;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
@@ -949,6 +955,13 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	vacrel->lpdead_item_pages = 0;
 	vacrel->nonempty_pages = 0;
 
+	/*
+	 * Blocks we can't skip are read in increasing order, so let the kernel
+	 * read ahead of us.  Runs of skipped all-visible pages just pause it.
+	 */
+	ReadAheadInit(&readahead, MAIN_FORKNUM, nblocks,
+				  get_tablespace_maintenance_io_concurrency(vacrel->rel->rd_rel->reltablespace));
+
 	/* Initialize instrumentation counters */
 	vacrel->num_index_scans = 0;
 	vacrel->tuples_deleted = 0;
@@ -1214,6 +1227,7 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 		 */
 		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
 
+		ReadAheadBlock(&readahead, vacrel->rel, blkno);
 		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
 								 RBM_NORMAL, vacrel->bstrategy);
 
@@ -1713,6 +1727,7 @@ lazy_scan_prune(LVRelState *vacrel,
 				num_tuples,
 				live_tuples;
 	int			nfrozen;
+	TransactionId freeze_conflict_xid;
 	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
 	xl_heap_freeze_tuple frozen[MaxHeapTuplesPerPage];
 
@@ -1952,6 +1967,48 @@ retry:
 	 */
 	vacrel->offnum = InvalidOffsetNumber;
 
+	/*
+	 * If the page is all-visible, but not all-frozen, consider freezing all
+	 * of it now rather than only the tuples older than FreezeLimit.  Every
+	 * remaining tuple's xmin precedes OldestXmin, so using that as the cutoff
+	 * freezes them all (barring MultiXacts newer than MultiXactCutoff), and
+	 * the page can be marked all-frozen in the visibility map.  Otherwise, an
+	 * aggressive VACUUM has to come back later to freeze the page, at the
+	 * price of dirtying and WAL-logging it once more.  Do it only when that
+	 * costs little now, see lazy_page_freeze_is_cheap().
+	 */
+	if (prunestate->all_visible && !prunestate->all_frozen &&
+		lazy_page_freeze_is_cheap(vacrel, buf, page, nfrozen))
+	{
+		nfrozen = 0;
+		prunestate->all_frozen = true;
+
+		for (offnum = FirstOffsetNumber;
+			 offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			HeapTupleHeader htup;
+			bool		tuple_totally_frozen;
+
+			itemid = PageGetItemId(page, offnum);
+			if (!ItemIdIsNormal(itemid))
+				continue;
+
+			htup = (HeapTupleHeader) PageGetItem(page, itemid);
+			if (heap_prepare_freeze_tuple(htup,
+										  vacrel->relfrozenxid,
+										  vacrel->relminmxid,
+										  vacrel->OldestXmin,
+										  vacrel->MultiXactCutoff,
+										  &frozen[nfrozen],
+										  &tuple_totally_frozen))
+				frozen[nfrozen++].offset = offnum;
+
+			if (!tuple_totally_frozen)
+				prunestate->all_frozen = false;
+		}
+	}
+
 	/*
 	 * Consider the need to freeze any items with tuple storage from the page
 	 * first (arbitrary)
@@ -1967,7 +2024,13 @@ retry:
 		 * If we need to freeze any tuples we'll mark the buffer dirty, and
 		 * write a WAL record recording the changes.  We must log the changes
 		 * to be crash-safe against future truncation of CLOG.
+		 *
+		 * Only standby queries that still consider one of the XIDs we're
+		 * about to freeze as running conflict with this, which is usually
+		 * far fewer than those whose xmin precedes the cutoff we froze with.
 		 */
+		freeze_conflict_xid = InvalidTransactionId;
+
 		START_CRIT_SECTION();
 
 		MarkBufferDirty(buf);
@@ -1980,6 +2043,7 @@ retry:
 			itemid = PageGetItemId(page, frozen[i].offset);
 			htup = (HeapTupleHeader) PageGetItem(page, itemid);
 
+			lazy_freeze_conflict_xid(htup, &freeze_conflict_xid);
 			heap_execute_freeze_tuple(htup, &frozen[i]);
 		}
 
@@ -1988,7 +2052,7 @@ retry:
 		{
 			XLogRecPtr	recptr;
 
-			recptr = log_heap_freeze(vacrel->rel, buf, vacrel->FreezeLimit,
+			recptr = log_heap_freeze(vacrel->rel, buf, freeze_conflict_xid,
 									 frozen, nfrozen);
 			PageSetLSN(page, recptr);
 		}
@@ -2068,6 +2132,77 @@ retry:
 	vacrel->live_tuples += live_tuples;
 }
 
+/*
+ * Would freezing all of this all-visible page in lazy_scan_prune() cost
+ * little extra?
+ *
+ * That's the case if we're writing a freeze record for the page anyway, or
+ * if the page gets dirtied anyway (by pruning, or by setting PD_ALL_VISIBLE)
+ * and the freeze record doesn't cost a full-page image of its own.  With
+ * checksums or wal_log_hints, setting PD_ALL_VISIBLE logs a full-page image
+ * of the page, which the freeze record then takes instead.
+ */
+static bool
+lazy_page_freeze_is_cheap(LVRelState *vacrel, Buffer buf, Page page,
+						  int nfrozen)
+{
+	if (nfrozen > 0)
+		return true;
+
+	if (PageIsAllVisible(page) && !BufferIsDirty(buf))
+		return false;
+
+	if (!RelationNeedsWAL(vacrel->rel))
+		return true;
+
+	if (!PageIsAllVisible(page) && XLogHintBitIsNeeded())
+		return true;
+
+	return !XLogCheckBufferNeedsBackup(buf);
+}
+
+/*
+ * Advance *conflict_xid past the XIDs that freezing this tuple makes appear
+ * committed to everyone, ie. its xmin and, for tuples moved by an old-style
+ * VACUUM FULL, its xvac.  A snapshot that considers any of those running
+ * must conflict with the freeze record on a standby.
+ *
+ * The xmax can be ignored: freezing only removes an xmax that is a locker
+ * or an aborted updater, which doesn't change the tuple's visibility.
+ *
+ * Must be called before the tuple is frozen.  *conflict_xid stays invalid
+ * if the tuple's freezing can't conflict with any snapshot.
+ */
+static void
+lazy_freeze_conflict_xid(HeapTupleHeader tuple, TransactionId *conflict_xid)
+{
+	TransactionId xid;
+
+	if (!HeapTupleHeaderXminFrozen(tuple))
+	{
+		xid = HeapTupleHeaderGetRawXmin(tuple);
+		if (TransactionIdIsNormal(xid))
+		{
+			TransactionIdAdvance(xid);
+			if (!TransactionIdIsValid(*conflict_xid) ||
+				TransactionIdFollows(xid, *conflict_xid))
+				*conflict_xid = xid;
+		}
+	}
+
+	if (tuple->t_infomask & HEAP_MOVED)
+	{
+		xid = HeapTupleHeaderGetXvac(tuple);
+		if (TransactionIdIsNormal(xid))
+		{
+			TransactionIdAdvance(xid);
+			if (!TransactionIdIsValid(*conflict_xid) ||
+				TransactionIdFollows(xid, *conflict_xid))
+				*conflict_xid = xid;
+		}
+	}
+}
+
 /*
  * Remove the collected garbage tuples from the table and its indexes.
  *
@@ -3449,9 +3584,12 @@ compute_max_dead_tuples(BlockNumber relblocks, bool hasindex)
 
 	if (hasindex)
 	{
+		/*
+		 * The array is allocated with MemoryContextAllocHuge (or in DSM), so
+		 * we're only limited by the int in LVDeadTuples.
+		 */
 		maxtuples = MAXDEADTUPLES(vac_work_mem * 1024L);
 		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MAXDEADTUPLES(MaxAllocSize));
 
 		/* curious coding here to ensure the multiplication can't overflow */
 		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
@@ -3509,7 +3647,8 @@ lazy_space_alloc(LVRelState *vacrel, int nworkers, BlockNumber nblocks)
 
 	maxtuples = compute_max_dead_tuples(nblocks, vacrel->nindexes > 0);
 
-	dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(maxtuples));
+	dead_tuples = (LVDeadTuples *) MemoryContextAllocHuge(CurrentMemoryContext,
+														  SizeOfDeadTuples(maxtuples));
 	dead_tuples->num_tuples = 0;
 	dead_tuples->max_tuples = (int) maxtuples;
 
@@ -3546,58 +3685,43 @@ lazy_tid_reaped(ItemPointer itemptr, void *state)
 	int64		litem,
 				ritem,
 				item;
-	ItemPointer res;
+	int			low,
+				high;
 
 	litem = itemptr_encode(&dead_tuples->itemptrs[0]);
 	ritem = itemptr_encode(&dead_tuples->itemptrs[dead_tuples->num_tuples - 1]);
 	item = itemptr_encode(itemptr);
 
 	/*
-	 * Doing a simple bound check before bsearch() is useful to avoid the
-	 * extra cost of bsearch(), especially if dead tuples on the heap are
-	 * concentrated in a certain range.  Since this function is called for
-	 * every index tuple, it pays to be really fast.
+	 * Doing a simple bound check before the binary search is useful to avoid
+	 * its extra cost, especially if dead tuples on the heap are concentrated
+	 * in a certain range.  Since this function is called for every index
+	 * tuple, it pays to be really fast.
 	 */
 	if (item < litem || item > ritem)
 		return false;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) dead_tuples->itemptrs,
-								dead_tuples->num_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
-
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	/*
+	 * Binary search the array.  We do this by hand rather than with bsearch()
+	 * so that comparing TIDs is just comparing their encoded int64 forms,
+	 * without a call through a function pointer for every probe.
+	 */
+	low = 0;
+	high = dead_tuples->num_tuples - 1;
+	while (low <= high)
+	{
+		int			mid = low + (high - low) / 2;
+		int64		miditem = itemptr_encode(&dead_tuples->itemptrs[mid]);
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+		if (miditem == item)
+			return true;
+		if (miditem < item)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
 
-	return 0;
+	return false;
 }
 
 /*
@@ -104,6 +104,7 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 		scan->orderByData = NULL;
 
 	scan->xs_want_itup = false; /* may be set later */
+	scan->xs_prefetch_target = 0;	/* likewise */
 
 	/*
 	 * During recovery we ignore killed tuples and don't bother to kill them
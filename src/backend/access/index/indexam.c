@@ -196,6 +196,43 @@ index_insert(Relation indexRelation,
 											 indexInfo);
 }
 
+/* ----------------
+ *		index_insert_batch - insert index tuples for several heap tuples
+ *
+ * This is like calling index_insert() with UNIQUE_CHECK_NO for each of the
+ * tuples, but lets the access method share work between them.  Falls back
+ * to doing just that if the access method doesn't support batch insertion.
+ * ----------------
+ */
+void
+index_insert_batch(Relation indexRelation,
+				   Datum **values,
+				   bool **isnull,
+				   ItemPointer heap_tids,
+				   int ntuples,
+				   Relation heapRelation,
+				   IndexInfo *indexInfo)
+{
+	RELATION_CHECKS;
+
+	if (indexRelation->rd_indam->aminsertbatch == NULL)
+	{
+		for (int i = 0; i < ntuples; i++)
+			index_insert(indexRelation, values[i], isnull[i], &heap_tids[i],
+						 heapRelation, UNIQUE_CHECK_NO, false, indexInfo);
+		return;
+	}
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertbatch(indexRelation, values, isnull,
+										   heap_tids, ntuples, heapRelation,
+										   indexInfo);
+}
+
 /*
  * index_beginscan - start a scan of an index with amgettuple
  *
@@ -553,6 +590,23 @@ index_getnext_tid(IndexScanDesc scan, ScanDirection direction)
 	return &scan->xs_heaptid;
 }
 
+/* ----------------
+ *		index_prefetch_tid - hint that a TID will probably be fetched soon
+ *
+ * An index AM whose amgettuple knows which TIDs it is going to return next
+ * calls this for up to scan->xs_prefetch_target of them, so that the table
+ * AM can start reading in the tuples while the caller deals with the ones
+ * before.  This only makes sense for scans that fetch from the table.
+ * ----------------
+ */
+void
+index_prefetch_tid(IndexScanDesc scan, ItemPointer tid)
+{
+	if (scan->xs_heapfetch)
+		table_index_fetch_prefetch(scan->xs_heapfetch, tid,
+								   scan->xs_want_itup);
+}
+
 /* ----------------
  *		index_fetch_heap - get the scan's next heap tuple
  *
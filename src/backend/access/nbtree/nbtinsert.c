@@ -28,8 +28,17 @@
 /* Minimum tree height for application of fastpath optimization */
 #define BTREE_FASTPATH_MIN_LEVEL	2
 
+/* A tuple to be inserted by _bt_doinsert_batch(), with its scan key */
+typedef struct BTBatchItem
+{
+	IndexTuple	itup;
+	BTScanInsert itup_key;
+} BTBatchItem;
+
 
 static BTStack _bt_search_insert(Relation rel, BTInsertState insertstate);
+static int	_bt_batch_cmp(const void *a, const void *b, void *arg);
+static bool _bt_batch_leaf_suits(Relation rel, BTInsertState insertstate);
 static TransactionId _bt_check_unique(Relation rel, BTInsertState insertstate,
 									  Relation heapRel,
 									  IndexUniqueCheck checkUnique, bool *is_unique,
@@ -272,6 +281,169 @@ search:
 	return is_unique;
 }
 
+/*
+ *	_bt_doinsert_batch() -- Insert several index tuples, without
+ *		uniqueness checks.
+ *
+ *		The tuples are inserted in index order, so that successive tuples
+ *		often belong on the same leaf page.  After each insertion we
+ *		remember the leaf page, and the next tuple goes directly onto it,
+ *		without a descent from the root, if it still covers the tuple's key
+ *		and has room for it.  The caller must have filled in the TIDs.
+ */
+void
+_bt_doinsert_batch(Relation rel, IndexTuple *itups, int nitups,
+				   Relation heapRel)
+{
+	BTBatchItem *items;
+	BlockNumber leafblkno = InvalidBlockNumber;
+	int			i;
+
+	items = (BTBatchItem *) palloc(sizeof(BTBatchItem) * nitups);
+	for (i = 0; i < nitups; i++)
+	{
+		items[i].itup = itups[i];
+		items[i].itup_key = _bt_mkscankey(rel, itups[i]);
+	}
+
+	if (nitups > 1)
+		qsort_arg(items, nitups, sizeof(BTBatchItem), _bt_batch_cmp, rel);
+
+	for (i = 0; i < nitups; i++)
+	{
+		IndexTuple	itup = items[i].itup;
+		BTScanInsert itup_key = items[i].itup_key;
+		BTInsertStateData insertstate;
+		BTStack		stack = NULL;
+		OffsetNumber newitemoff;
+
+		insertstate.itup = itup;
+		insertstate.itemsz = MAXALIGN(IndexTupleSize(itup));
+		insertstate.itup_key = itup_key;
+		insertstate.bounds_valid = false;
+		insertstate.buf = InvalidBuffer;
+		insertstate.postingoff = 0;
+
+		/* Try the leaf page the previous tuple went to */
+		if (BlockNumberIsValid(leafblkno) && itup_key->heapkeyspace)
+		{
+			insertstate.buf = _bt_getbuf(rel, leafblkno, BT_WRITE);
+			if (!_bt_batch_leaf_suits(rel, &insertstate))
+			{
+				_bt_relbuf(rel, insertstate.buf);
+				insertstate.buf = InvalidBuffer;
+			}
+		}
+
+		/*
+		 * Otherwise, search the tree as _bt_doinsert() does.  When we do use
+		 * the remembered page, we have no stack, but we've made sure that no
+		 * page split can happen.
+		 */
+		if (insertstate.buf == InvalidBuffer)
+			stack = _bt_search_insert(rel, &insertstate);
+
+		CheckForSerializableConflictIn(rel, NULL, BufferGetBlockNumber(insertstate.buf));
+
+		newitemoff = _bt_findinsertloc(rel, &insertstate, false, false,
+									   stack, heapRel);
+		leafblkno = BufferGetBlockNumber(insertstate.buf);
+		_bt_insertonpg(rel, itup_key, insertstate.buf, InvalidBuffer, stack,
+					   itup, insertstate.itemsz, newitemoff,
+					   insertstate.postingoff, false);
+
+		if (stack)
+			_bt_freestack(stack);
+		pfree(itup_key);
+	}
+
+	pfree(items);
+}
+
+/*
+ * qsort_arg comparator for _bt_doinsert_batch(): order tuples the way the
+ * index does, by key and then by heap TID.  This compares the key columns
+ * like _bt_compare() does.
+ */
+static int
+_bt_batch_cmp(const void *a, const void *b, void *arg)
+{
+	Relation	rel = (Relation) arg;
+	const BTBatchItem *ia = (const BTBatchItem *) a;
+	const BTBatchItem *ib = (const BTBatchItem *) b;
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	ScanKey		scankey = ia->itup_key->scankeys;
+
+	for (int i = 1; i <= ia->itup_key->keysz; i++, scankey++)
+	{
+		Datum		datum;
+		bool		isNull;
+		int32		result;
+
+		datum = index_getattr(ib->itup, scankey->sk_attno, itupdesc, &isNull);
+
+		if (scankey->sk_flags & SK_ISNULL)	/* a is NULL */
+		{
+			if (isNull)
+				result = 0;
+			else if (scankey->sk_flags & SK_BT_NULLS_FIRST)
+				result = -1;
+			else
+				result = 1;
+		}
+		else if (isNull)		/* a is NOT_NULL and b is NULL */
+		{
+			if (scankey->sk_flags & SK_BT_NULLS_FIRST)
+				result = 1;
+			else
+				result = -1;
+		}
+		else
+		{
+			/* See _bt_compare() about the argument order and sign flip */
+			result = DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+													 scankey->sk_collation,
+													 datum,
+													 scankey->sk_argument));
+
+			if (!(scankey->sk_flags & SK_BT_DESC))
+				INVERT_COMPARE_RESULT(result);
+		}
+
+		if (result != 0)
+			return result;
+	}
+
+	return ItemPointerCompare(&ia->itup->t_tid, &ib->itup->t_tid);
+}
+
+/*
+ * Can the tuple of insertstate go onto the locked page in insertstate->buf,
+ * without a search from the root, for _bt_doinsert_batch()?
+ *
+ * The page must be a live leaf page whose key space includes the new tuple,
+ * and it must have enough free space that no split can be needed, since
+ * there is no descent stack to insert a downlink with.  Like the fastpath in
+ * _bt_search_insert(), we require the new tuple to be strictly greater than
+ * the first tuple on the page rather than looking at the left sibling.
+ */
+static bool
+_bt_batch_leaf_suits(Relation rel, BTInsertState insertstate)
+{
+	Page		page = BufferGetPage(insertstate->buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+	return P_ISLEAF(opaque) &&
+		!P_IGNORE(opaque) &&
+		!P_INCOMPLETE_SPLIT(opaque) &&
+		PageGetFreeSpace(page) > insertstate->itemsz &&
+		PageGetMaxOffsetNumber(page) >= P_FIRSTDATAKEY(opaque) &&
+		_bt_compare(rel, insertstate->itup_key, page,
+					P_FIRSTDATAKEY(opaque)) > 0 &&
+		(P_RIGHTMOST(opaque) ||
+		 _bt_compare(rel, insertstate->itup_key, page, P_HIKEY) <= 0);
+}
+
 /*
  *	_bt_search_insert() -- _bt_search() wrapper for inserts
  *
@@ -77,6 +77,7 @@ typedef struct BTParallelScanDescData
 typedef struct BTParallelScanDescData *BTParallelScanDesc;
 
 
+static void _bt_prefetch_items(IndexScanDesc scan, ScanDirection dir);
 static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 						 IndexBulkDeleteCallback callback, void *callback_state,
 						 BTCycleId cycleid);
@@ -120,6 +121,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = btbuild;
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
+	amroutine->aminsertbatch = btinsertbatch;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -203,6 +205,67 @@ btinsert(Relation rel, Datum *values, bool *isnull,
 	return result;
 }
 
+/*
+ *	btinsertbatch() -- insert index tuples for several heap tuples.
+ *
+ *		No uniqueness checks are made.  See _bt_doinsert_batch().
+ */
+void
+btinsertbatch(Relation rel, Datum **values, bool **isnull,
+			  ItemPointer heap_tids, int ntuples, Relation heapRel,
+			  IndexInfo *indexInfo)
+{
+	IndexTuple *itups;
+	int			i;
+
+	itups = (IndexTuple *) palloc(sizeof(IndexTuple) * ntuples);
+	for (i = 0; i < ntuples; i++)
+	{
+		itups[i] = index_form_tuple(RelationGetDescr(rel), values[i],
+									isnull[i]);
+		itups[i]->t_tid = heap_tids[i];
+	}
+
+	_bt_doinsert_batch(rel, itups, ntuples, heapRel);
+
+	for (i = 0; i < ntuples; i++)
+		pfree(itups[i]);
+	pfree(itups);
+}
+
+/*
+ * Let the table AM know about the heap TIDs of the next few items on the
+ * current page, so that it can prefetch them while the caller deals with the
+ * one we're about to return.  currPos.prefetchIndex remembers how far we got
+ * on earlier calls, not to hint the same TIDs over and over.
+ */
+static void
+_bt_prefetch_items(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTScanPos	pos = &so->currPos;
+	int			i;
+
+	if (ScanDirectionIsForward(dir))
+	{
+		int			last = Min(pos->itemIndex + scan->xs_prefetch_target,
+							   pos->lastItem);
+
+		for (i = Max(pos->prefetchIndex, pos->itemIndex + 1); i <= last; i++)
+			index_prefetch_tid(scan, &pos->items[i].heapTid);
+		pos->prefetchIndex = i;
+	}
+	else
+	{
+		int			first = Max(pos->itemIndex - scan->xs_prefetch_target,
+								pos->firstItem);
+
+		for (i = Min(pos->prefetchIndex, pos->itemIndex - 1); i >= first; i--)
+			index_prefetch_tid(scan, &pos->items[i].heapTid);
+		pos->prefetchIndex = i;
+	}
+}
+
 /*
  *	btgettuple() -- Get the next tuple in the scan.
  */
@@ -229,7 +292,17 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		_bt_start_array_keys(scan, dir);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	/* Likewise find the first value of the first column for a skip scan */
+	if (so->skipScan && so->skipCount == 0)
+	{
+		if (!_bt_start_skip_key(scan, dir))
+			return false;
+	}
+
+	/*
+	 * This loop handles advancing to the next array elements or skip key
+	 * values, if any
+	 */
 	do
 	{
 		/*
@@ -270,9 +343,16 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 
 		/* If we have a tuple, return it ... */
 		if (res)
+		{
+			if (so->skipScan)
+				so->skipLastPage = so->currPos.currPage;
+			if (scan->xs_prefetch_target > 0)
+				_bt_prefetch_items(scan, dir);
 			break;
+		}
 		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+	} while ((so->numArrayKeys && _bt_advance_array_keys(scan, dir)) ||
+			 (so->skipScan && _bt_advance_skip_key(scan, dir)));
 
 	return res;
 }
@@ -299,7 +379,16 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		_bt_start_array_keys(scan, ForwardScanDirection);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	if (so->skipScan)
+	{
+		if (!_bt_start_skip_key(scan, ForwardScanDirection))
+			return ntids;
+	}
+
+	/*
+	 * This loop handles advancing to the next array elements or skip key
+	 * values, if any
+	 */
 	do
 	{
 		/* Fetch the first page & tuple */
@@ -318,6 +407,9 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 				 */
 				if (++so->currPos.itemIndex > so->currPos.lastItem)
 				{
+					/* remember where this skip key value's matches ended */
+					so->skipLastPage = so->currPos.currPage;
+
 					/* let _bt_next do the heavy lifting */
 					if (!_bt_next(scan, ForwardScanDirection))
 						break;
@@ -330,7 +422,10 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 			}
 		}
 		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+	} while ((so->numArrayKeys &&
+			  _bt_advance_array_keys(scan, ForwardScanDirection)) ||
+			 (so->skipScan &&
+			  _bt_advance_skip_key(scan, ForwardScanDirection)));
 
 	return ntids;
 }
@@ -354,8 +449,9 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+	/* leave room for a skip key, see _bt_preprocess_skip_key */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey) palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -364,6 +460,11 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
+	so->skipScan = false;
+	so->skipKeyData = NULL;
+
+	so->lastLeafPage = InvalidBlockNumber;
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
@@ -438,6 +539,9 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
+
+	/* Otherwise, maybe we can skip over stretches of the index */
+	_bt_preprocess_skip_key(scan);
 }
 
 /*
@@ -504,6 +608,8 @@ btmarkpos(IndexScanDesc scan)
 	/* Also record the current positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_mark_array_keys(scan);
+	if (so->skipScan)
+		_bt_mark_skip_key(scan);
 }
 
 /*
@@ -517,6 +623,8 @@ btrestrpos(IndexScanDesc scan)
 	/* Restore the marked positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_restore_array_keys(scan);
+	if (so->skipScan)
+		_bt_restore_skip_key(scan);
 
 	if (so->markItemIndex >= 0)
 	{
@@ -20,6 +20,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
@@ -43,6 +44,8 @@ static bool _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirectio
 static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
 								  ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf, Snapshot snapshot);
+static Buffer _bt_search_last_leaf(Relation rel, BTScanInsert key,
+								   BlockNumber blkno, Snapshot snapshot);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
 static inline void _bt_initialize_more_data(BTScanOpaque so, ScanDirection dir);
 
@@ -1365,13 +1368,22 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	inskey.keysz = keysCount;
 
 	/*
-	 * Use the manufactured insertion scan key to descend the tree and
-	 * position ourselves on the target leaf page.
+	 * If the target leaf page is the one the previous scan position was on,
+	 * just go straight there.  Otherwise use the manufactured insertion scan
+	 * key to descend the tree and position ourselves on the target leaf
+	 * page.
 	 */
-	stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
+	buf = InvalidBuffer;
+	if (BlockNumberIsValid(so->lastLeafPage) && scan->parallel_scan == NULL)
+		buf = _bt_search_last_leaf(rel, &inskey, so->lastLeafPage,
+								   scan->xs_snapshot);
+	if (!BufferIsValid(buf))
+	{
+		stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
 
-	/* don't need to keep the stack around... */
-	_bt_freestack(stack);
+		/* don't need to keep the stack around... */
+		_bt_freestack(stack);
+	}
 
 	if (!BufferIsValid(buf))
 	{
@@ -1562,6 +1574,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	 * This allows us to re-read the buffer if it is needed again for hinting.
 	 */
 	so->currPos.currPage = BufferGetBlockNumber(so->currPos.buf);
+	so->lastLeafPage = so->currPos.currPage;
 
 	/*
 	 * We save the LSN of the page as we read it, so that we know whether it
@@ -1677,6 +1690,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
+		so->currPos.prefetchIndex = 0;
 	}
 	else
 	{
@@ -1772,6 +1786,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = itemIndex;
 		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
 		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
+		so->currPos.prefetchIndex = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -2300,6 +2315,48 @@ _bt_walk_left(Relation rel, Buffer buf, Snapshot snapshot)
 	return InvalidBuffer;
 }
 
+/*
+ * _bt_search_last_leaf() -- Check for a scan key on a known leaf page
+ *
+ * Lock leaf page blkno, typically the last one read by this scan before a
+ * rescan, and check whether key's position falls on it, per the same rules
+ * that _bt_moveright and _bt_binsrch apply.  If so, return the read-locked
+ * buffer so that the caller can skip the descent from the root; otherwise
+ * return InvalidBuffer.
+ *
+ * Since the page's items bound its key space from below and its high key
+ * bounds it from above, the checks are valid no matter what happened to the
+ * page since we last looked at it, even if it was deleted and recycled.  We
+ * insist on key being strictly to the right of the first item (or on it, if
+ * nextkey) because equal items could also be at the end of the left sibling.
+ */
+static Buffer
+_bt_search_last_leaf(Relation rel, BTScanInsert key, BlockNumber blkno,
+					 Snapshot snapshot)
+{
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	int32		cmpval;
+
+	buf = _bt_getbuf(rel, blkno, BT_READ);
+	page = BufferGetPage(buf);
+	TestForOldSnapshot(snapshot, rel, page);
+	opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+	cmpval = key->nextkey ? 0 : 1;
+	if (P_ISLEAF(opaque) && !P_IGNORE(opaque) &&
+		P_FIRSTDATAKEY(opaque) <= PageGetMaxOffsetNumber(page) &&
+		(P_RIGHTMOST(opaque) ||
+		 _bt_compare(rel, key, page, P_HIKEY) < cmpval) &&
+		(P_LEFTMOST(opaque) ||
+		 _bt_compare(rel, key, page, P_FIRSTDATAKEY(opaque)) >= cmpval))
+		return buf;
+
+	_bt_relbuf(rel, buf);
+	return InvalidBuffer;
+}
+
 /*
  * _bt_get_endpoint() -- Find the first or last page on a given tree level
  *
@@ -2383,6 +2440,135 @@ _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 	return buf;
 }
 
+/*
+ * _bt_skip_find_value() -- Find the next first-column value for a skip scan
+ *
+ * If first is true, we find the first-column value of the first tuple in the
+ * index in the given scan direction.  Otherwise we find the first value past
+ * the one currently held in the skip key.  On success, *value and *isnull are
+ * set to the value found, copied into so->arrayContext, and *blkno to the
+ * leaf page it was found on.  Returns false if there are no more values.
+ *
+ * No buffer lock or pin is held on return.  The value may well have been
+ * deleted by then, but that's harmless: the following primitive indexscan
+ * just finds nothing.
+ */
+bool
+_bt_skip_find_value(IndexScanDesc scan, ScanDirection dir, bool first,
+					Datum *value, bool *isnull, BlockNumber *blkno)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+
+	if (first)
+	{
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir),
+							   scan->xs_snapshot);
+		if (!BufferIsValid(buf))
+			return false;
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		if (ScanDirectionIsBackward(dir))
+			offnum = PageGetMaxOffsetNumber(page);
+		else
+			offnum = P_FIRSTDATAKEY(opaque);
+	}
+	else
+	{
+		ScanKey		skipkey = &so->skipKeyData[0];
+		BTScanInsertData inskey;
+		BTStack		stack;
+
+		/*
+		 * Build an insertion scan key for the current value.  In a forward
+		 * scan, we want the first item > it; in a backward scan, the item
+		 * just before the first one >= it.
+		 */
+		_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+		inskey.anynullkeys = false; /* unused */
+		inskey.nextkey = ScanDirectionIsForward(dir);
+		inskey.pivotsearch = false;
+		inskey.scantid = NULL;
+		inskey.keysz = 1;
+		ScanKeyEntryInitializeWithInfo(&inskey.scankeys[0],
+									   (skipkey->sk_flags & SK_ISNULL) |
+									   (rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT),
+									   1,
+									   InvalidStrategy,
+									   InvalidOid,
+									   rel->rd_indcollation[0],
+									   index_getprocinfo(rel, 1, BTORDER_PROC),
+									   skipkey->sk_argument);
+
+		stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
+		_bt_freestack(stack);
+		if (!BufferIsValid(buf))
+			return false;
+
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		offnum = _bt_binsrch(rel, &inskey, buf);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+	}
+
+	/* Step across pages until we're on an actual item */
+	for (;;)
+	{
+		if (!P_IGNORE(opaque) &&
+			offnum >= P_FIRSTDATAKEY(opaque) &&
+			offnum <= PageGetMaxOffsetNumber(page))
+		{
+			Form_pg_attribute att = TupleDescAttr(RelationGetDescr(rel), 0);
+			IndexTuple	itup;
+			Datum		datum;
+
+			itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+			datum = index_getattr(itup, 1, RelationGetDescr(rel), isnull);
+			if (*isnull)
+				*value = (Datum) 0;
+			else
+			{
+				MemoryContext oldcontext;
+
+				oldcontext = MemoryContextSwitchTo(so->arrayContext);
+				*value = datumCopy(datum, att->attbyval, att->attlen);
+				MemoryContextSwitchTo(oldcontext);
+			}
+			*blkno = BufferGetBlockNumber(buf);
+			_bt_relbuf(rel, buf);
+			return true;
+		}
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			page = BufferGetPage(buf);
+			TestForOldSnapshot(scan->xs_snapshot, rel, page);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = P_FIRSTDATAKEY(opaque);
+		}
+		else
+		{
+			buf = _bt_walk_left(rel, buf, scan->xs_snapshot);
+			if (!BufferIsValid(buf))
+				return false;
+			page = BufferGetPage(buf);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = PageGetMaxOffsetNumber(page);
+		}
+	}
+}
+
 /*
  *	_bt_endpoint() -- Find the first or last page in the index, and scan
  * from there to the first key satisfying all the quals.
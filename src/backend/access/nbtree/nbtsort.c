@@ -258,6 +258,8 @@ typedef struct BTWriteState
 
 static double _bt_spools_heapscan(Relation heap, Relation index,
 								  BTBuildState *buildstate, IndexInfo *indexInfo);
+static IndexBuildResult *_bt_build_finish(BTBuildState *buildstate,
+										  double reltuples);
 static void _bt_spooldestroy(BTSpool *btspool);
 static void _bt_spool(BTSpool *btspool, ItemPointer self,
 					  Datum *values, bool *isnull);
@@ -324,22 +326,7 @@ btbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 
 	reltuples = _bt_spools_heapscan(heap, index, &buildstate, indexInfo);
 
-	/*
-	 * Finish the build by (1) completing the sort of the spool file, (2)
-	 * inserting the sorted tuples into btree pages and (3) building the upper
-	 * levels.  Finally, it may also be necessary to end use of parallelism.
-	 */
-	_bt_leafbuild(buildstate.spool, buildstate.spool2);
-	_bt_spooldestroy(buildstate.spool);
-	if (buildstate.spool2)
-		_bt_spooldestroy(buildstate.spool2);
-	if (buildstate.btleader)
-		_bt_end_parallel(buildstate.btleader);
-
-	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
-
-	result->heap_tuples = reltuples;
-	result->index_tuples = buildstate.indtuples;
+	result = _bt_build_finish(&buildstate, reltuples);
 
 #ifdef BTREE_BUILD_STATS
 	if (log_btree_build_stats)
@@ -352,6 +339,124 @@ btbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ *	btbuildbegin() -- start building a btree index from tuples that the
+ *		caller supplies.
+ *
+ * This is used to build several indexes of the same table from a single
+ * table scan: the caller scans the table itself and hands each index's
+ * values to btbuildtuple(), then calls btbuildend() to sort and load the
+ * index.  Only serial builds are supported.  sortmem is the amount of memory
+ * (in kilobytes) to use for sorting this index's tuples; callers building
+ * several indexes at once should divide maintenance_work_mem among them.
+ */
+void *
+btbuildbegin(Relation heap, Relation index, IndexInfo *indexInfo, int sortmem)
+{
+	BTBuildState *buildstate = (BTBuildState *) palloc0(sizeof(BTBuildState));
+	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
+
+	Assert(indexInfo->ii_ParallelWorkers == 0);
+
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	buildstate->isunique = indexInfo->ii_Unique;
+	buildstate->heap = heap;
+
+	btspool->heap = heap;
+	btspool->index = index;
+	btspool->isunique = indexInfo->ii_Unique;
+	btspool->sortstate = tuplesort_begin_index_btree(heap, index,
+													 btspool->isunique,
+													 sortmem, NULL, false);
+	buildstate->spool = btspool;
+
+	/* As in _bt_spools_heapscan, dead tuples of a unique index go aside */
+	if (indexInfo->ii_Unique)
+	{
+		BTSpool    *btspool2 = (BTSpool *) palloc0(sizeof(BTSpool));
+
+		btspool2->heap = heap;
+		btspool2->index = index;
+		btspool2->isunique = false;
+		btspool2->sortstate = tuplesort_begin_index_btree(heap, index, false,
+														  work_mem, NULL,
+														  false);
+		buildstate->spool2 = btspool2;
+	}
+
+	return buildstate;
+}
+
+/*
+ *	btbuildtuple() -- add one heap tuple's entry to an index being built by
+ *		btbuildbegin().
+ */
+void
+btbuildtuple(void *state, ItemPointer tid, Datum *values, bool *isnull,
+			 bool tupleIsAlive)
+{
+	BTBuildState *buildstate = (BTBuildState *) state;
+
+	_bt_build_callback(buildstate->spool->index, tid, values, isnull,
+					   tupleIsAlive, buildstate);
+}
+
+/*
+ *	btbuildend() -- finish an index build started by btbuildbegin().
+ *
+ * reltuples is the number of heap tuples that the caller's scan saw.
+ */
+IndexBuildResult *
+btbuildend(void *state, double reltuples)
+{
+	BTBuildState *buildstate = (BTBuildState *) state;
+	IndexBuildResult *result;
+
+	/* Set the progress target for loading the index */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
+								 buildstate->indtuples);
+
+	if (buildstate->spool2 && !buildstate->havedead)
+	{
+		/* spool2 turns out to be unnecessary */
+		_bt_spooldestroy(buildstate->spool2);
+		buildstate->spool2 = NULL;
+	}
+
+	result = _bt_build_finish(buildstate, reltuples);
+	pfree(buildstate);
+
+	return result;
+}
+
+/*
+ * Finish the build by (1) completing the sort of the spool file, (2)
+ * inserting the sorted tuples into btree pages and (3) building the upper
+ * levels.  Finally, it may also be necessary to end use of parallelism.
+ */
+static IndexBuildResult *
+_bt_build_finish(BTBuildState *buildstate, double reltuples)
+{
+	IndexBuildResult *result;
+
+	_bt_leafbuild(buildstate->spool, buildstate->spool2);
+	_bt_spooldestroy(buildstate->spool);
+	if (buildstate->spool2)
+		_bt_spooldestroy(buildstate->spool2);
+	if (buildstate->btleader)
+		_bt_end_parallel(buildstate->btleader);
+
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate->indtuples;
+
+	return result;
+}
+
 /*
  * Create and initialize one or two spool structures, and save them in caller's
  * buildstate argument.  May also fill-in fields within indexInfo used by index
@@ -23,11 +23,15 @@
 #include "catalog/catalog.h"
 #include "commands/progress.h"
 #include "lib/qunique.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "storage/predicate.h"
 #include "utils/array.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/pg_locale.h"
 #include "utils/rel.h"
 
 
@@ -53,6 +57,8 @@ static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 								 IndexTuple tuple, int tupnatts, TupleDesc tupdesc,
 								 ScanDirection dir, bool *continuescan);
+static IndexTuple _bt_truncate_datum(Relation rel, IndexTuple lastleft,
+									 IndexTuple firstright, int keepnatts);
 static int	_bt_keep_natts(Relation rel, IndexTuple lastleft,
 						   IndexTuple firstright, BTScanInsert itup_key);
 
@@ -654,6 +660,289 @@ _bt_restore_array_keys(IndexScanDesc scan)
 }
 
 
+/*
+ * Minimum number of first-column values to visit before judging whether a
+ * skip scan pays off, and the fraction (in quarters) of them that may have
+ * started on a page we had read anyway before we give up on skipping.
+ */
+#define BT_SKIP_MIN_VALUES		16
+#define BT_SKIP_MAX_FUTILE_QUARTERS 3
+
+/* Operators on the first column that a skip scan needs */
+static const StrategyNumber btskipstrats[] = {
+	BTLessEqualStrategyNumber,
+	BTEqualStrategyNumber,
+	BTGreaterEqualStrategyNumber
+};
+
+/*
+ *	_bt_skip_scan_supported() -- Can scans of this index skip?
+ *
+ * The index needs a second key column, and we must be able to apply the
+ * opclass's "<=", "=" and ">=" operators to the first column's stored
+ * values, which isn't so for opclasses like name_ops whose storage type
+ * differs from the input type.  btcostestimate() uses this too, so that the
+ * planner doesn't cost scans as skip scans that we won't do.
+ */
+bool
+_bt_skip_scan_supported(Relation rel)
+{
+	Oid			opfamily = rel->rd_opfamily[0];
+	Oid			opcintype = rel->rd_opcintype[0];
+
+	if (IndexRelationGetNumberOfKeyAttributes(rel) < 2)
+		return false;
+
+	if (TupleDescAttr(RelationGetDescr(rel), 0)->attlen != get_typlen(opcintype))
+		return false;
+
+	for (int i = 0; i < lengthof(btskipstrats); i++)
+	{
+		if (!OidIsValid(get_opfamily_member(opfamily, opcintype, opcintype,
+											btskipstrats[i])))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ *	_bt_preprocess_skip_key() -- Set up a skip scan, if worthwhile
+ *
+ * A scan with keys on the second index column but none on the first would
+ * otherwise have to read the whole index, since no key can be required (see
+ * _bt_preprocess_keys).  Instead, we manufacture an "=" key on the first
+ * column and run one primitive indexscan per distinct value of that column,
+ * much as for an array key whose elements we discover as we go.  The keys on
+ * the second column are then required, so each primitive scan reads only the
+ * part of the index that can match, and between them we descend the tree to
+ * find the next value.
+ *
+ * We don't try this together with array keys or for parallel scans, whose
+ * primitive scan bookkeeping assumes array keys only.  Whether the index
+ * itself allows skip scans is decided by _bt_skip_scan_supported().
+ */
+void
+_bt_preprocess_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Oid			opfamily = rel->rd_opfamily[0];
+	Oid			opcintype = rel->rd_opcintype[0];
+	MemoryContext oldContext;
+
+	so->skipScan = false;
+	so->skipKeyData = NULL;
+
+	if (so->numArrayKeys != 0 ||
+		scan->parallel_scan != NULL ||
+		scan->numberOfKeys == 0 ||
+		scan->keyData[0].sk_attno != 2 ||
+		!_bt_skip_scan_supported(rel))
+		return;
+
+	if (so->arrayContext == NULL)
+		so->arrayContext = AllocSetContextCreate(CurrentMemoryContext,
+												 "BTree array context",
+												 ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(so->arrayContext);
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+	for (int i = 0; i < lengthof(btskipstrats); i++)
+	{
+		Oid			opr = get_opfamily_member(opfamily, opcintype, opcintype,
+											  btskipstrats[i]);
+
+		fmgr_info(get_opcode(opr), &so->skipProcs[btskipstrats[i] - 1]);
+	}
+
+	/* skip key goes first, its contents are set by _bt_start_skip_key */
+	so->skipKeyData = (ScanKey) palloc0((scan->numberOfKeys + 1) *
+										sizeof(ScanKeyData));
+	so->skipKeyData[0].sk_flags = SK_ISNULL | SK_SEARCHNULL;
+	memcpy(&so->skipKeyData[1],
+		   scan->keyData,
+		   scan->numberOfKeys * sizeof(ScanKeyData));
+
+	MemoryContextSwitchTo(oldContext);
+
+	so->skipScan = true;
+	so->skipFinalDir = NoMovementScanDirection;
+	so->skipCount = 0;
+	so->skipFutile = 0;
+	so->skipLastPage = InvalidBlockNumber;
+	so->skipMarkStrategy = InvalidStrategy;
+}
+
+/*
+ * _bt_set_skip_key() -- Point the skip key at a new first-column value
+ *
+ * The value must have been allocated in so->arrayContext; we take ownership
+ * of it, and free the previous one.
+ */
+static void
+_bt_set_skip_key(IndexScanDesc scan, StrategyNumber strategy,
+				 Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	ScanKey		skey = &so->skipKeyData[0];
+
+	if (!(skey->sk_flags & SK_ISNULL) &&
+		!TupleDescAttr(RelationGetDescr(rel), 0)->attbyval)
+		pfree(DatumGetPointer(skey->sk_argument));
+
+	/* leave it to _bt_preprocess_keys to apply indoption */
+	if (isnull)
+		ScanKeyEntryInitialize(skey, SK_ISNULL | SK_SEARCHNULL, 1,
+							   InvalidStrategy, InvalidOid, InvalidOid,
+							   InvalidOid, (Datum) 0);
+	else
+		ScanKeyEntryInitializeWithInfo(skey, 0, 1, strategy, InvalidOid,
+									   rel->rd_indcollation[0],
+									   &so->skipProcs[strategy - 1], value);
+	so->skipStrategy = strategy;
+}
+
+/*
+ * _bt_start_skip_key() -- Initialize the skip key at start of a scan
+ *
+ * Returns false if the index is empty.
+ */
+bool
+_bt_start_skip_key(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Datum		value;
+	bool		isnull;
+	BlockNumber blkno;
+
+	/*
+	 * Primitive scans only lock the pages they read, which doesn't cover
+	 * insertions of new first-column values into the parts we skip.
+	 */
+	PredicateLockRelation(scan->indexRelation, scan->xs_snapshot);
+
+	if (!_bt_skip_find_value(scan, dir, true, &value, &isnull, &blkno))
+		return false;
+
+	_bt_set_skip_key(scan, BTEqualStrategyNumber, value, isnull);
+	so->skipCount = 1;
+	so->skipLastPage = InvalidBlockNumber;
+	return true;
+}
+
+/*
+ * _bt_advance_skip_key() -- Advance to the next first-column value
+ *
+ * Returns true if there is another primitive indexscan to run.
+ *
+ * If most of the values we've visited started on the page where the scan of
+ * the previous value ended, values are too dense for skipping to save
+ * anything, and the descents are pure overhead.  In that case we turn the
+ * skip key into a ">=" (or "<=") key, and let one last primitive scan read
+ * the rest of the index just as if there were no key on the first column.
+ * If the scan direction is reversed after that, we go back to skipping.
+ */
+bool
+_bt_advance_skip_key(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Datum		value;
+	bool		isnull;
+	BlockNumber blkno;
+
+	if (so->skipFinalDir == dir)
+		return false;
+	so->skipFinalDir = NoMovementScanDirection;
+
+	if (!_bt_skip_find_value(scan, dir, false, &value, &isnull, &blkno))
+		return false;
+
+	so->skipCount++;
+	if (blkno == so->skipLastPage)
+		so->skipFutile++;
+	so->skipLastPage = InvalidBlockNumber;
+
+	if (!isnull &&
+		so->skipCount >= BT_SKIP_MIN_VALUES &&
+		so->skipFutile * 4 > so->skipCount * BT_SKIP_MAX_FUTILE_QUARTERS)
+	{
+		bool		desc = (scan->indexRelation->rd_indoption[0] & INDOPTION_DESC) != 0;
+
+		/* the rest of the index in scan direction, in terms of values */
+		if (ScanDirectionIsForward(dir) != desc)
+			_bt_set_skip_key(scan, BTGreaterEqualStrategyNumber, value, false);
+		else
+			_bt_set_skip_key(scan, BTLessEqualStrategyNumber, value, false);
+		so->skipFinalDir = dir;
+	}
+	else
+		_bt_set_skip_key(scan, BTEqualStrategyNumber, value, isnull);
+
+	return true;
+}
+
+/*
+ * _bt_mark_skip_key() -- Handle the skip key during btmarkpos
+ */
+void
+_bt_mark_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	ScanKey		skey = &so->skipKeyData[0];
+	MemoryContext oldContext;
+
+	if (so->skipMarkStrategy != InvalidStrategy &&
+		!so->skipMarkIsNull && !att->attbyval)
+		pfree(DatumGetPointer(so->skipMarkValue));
+
+	so->skipMarkStrategy = so->skipStrategy;
+	so->skipMarkIsNull = (skey->sk_flags & SK_ISNULL) != 0;
+	so->skipMarkFinalDir = so->skipFinalDir;
+	if (so->skipMarkIsNull)
+		so->skipMarkValue = (Datum) 0;
+	else
+	{
+		oldContext = MemoryContextSwitchTo(so->arrayContext);
+		so->skipMarkValue = datumCopy(skey->sk_argument,
+									  att->attbyval, att->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+/*
+ * _bt_restore_skip_key() -- Handle the skip key during btrestrpos
+ */
+void
+_bt_restore_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	Datum		value = (Datum) 0;
+	MemoryContext oldContext;
+
+	if (so->skipMarkStrategy == InvalidStrategy)
+		return;
+
+	if (!so->skipMarkIsNull)
+	{
+		oldContext = MemoryContextSwitchTo(so->arrayContext);
+		value = datumCopy(so->skipMarkValue, att->attbyval, att->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	_bt_set_skip_key(scan, so->skipMarkStrategy, value, so->skipMarkIsNull);
+	so->skipFinalDir = so->skipMarkFinalDir;
+
+	/* as in _bt_restore_array_keys */
+	_bt_preprocess_keys(scan);
+	Assert(so->qual_ok);
+}
+
+
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
  *
@@ -763,9 +1052,15 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		return;					/* done if qual-less scan */
 
 	/*
-	 * Read so->arrayKeyData if array keys are present, else scan->keyData
+	 * Read so->skipKeyData if this is a skip scan, so->arrayKeyData if array
+	 * keys are present, else scan->keyData
 	 */
-	if (so->arrayKeyData != NULL)
+	if (so->skipScan)
+	{
+		inkeys = so->skipKeyData;
+		numberOfKeys++;
+	}
+	else if (so->arrayKeyData != NULL)
 		inkeys = so->arrayKeyData;
 	else
 		inkeys = scan->keyData;
@@ -2191,10 +2486,8 @@ btbuildphasename(int64 phasenum)
  * from firstright), the size of the returned tuple is the size of firstright
  * plus the size of an additional MAXALIGN()'d item pointer.  This guarantee
  * is important, since callers need to stay under the 1/3 of a page
- * restriction on tuple size.  If this routine is ever taught to truncate
- * within an attribute/datum, it will need to avoid returning an enlarged
- * tuple to caller when truncation + TOAST compression ends up enlarging the
- * final datum.
+ * restriction on tuple size.  _bt_truncate_datum() takes care not to return
+ * an enlarged tuple when it truncates within the final attribute/datum.
  */
 IndexTuple
 _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
@@ -2222,8 +2515,12 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	keepnatts = nkeyatts + 1;
 #endif
 
-	pivot = index_truncate_tuple(itupdesc, firstright,
-								 Min(keepnatts, nkeyatts));
+	pivot = NULL;
+	if (itup_key->heapkeyspace && keepnatts <= nkeyatts)
+		pivot = _bt_truncate_datum(rel, lastleft, firstright, keepnatts);
+	if (pivot == NULL)
+		pivot = index_truncate_tuple(itupdesc, firstright,
+									 Min(keepnatts, nkeyatts));
 
 	if (BTreeTupleIsPosting(pivot))
 	{
@@ -2330,6 +2627,115 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	return tidpivot;
 }
 
+/*
+ * _bt_truncate_datum - truncate within the distinguishing attribute.
+ *
+ * Caller has determined that attribute keepnatts is the first one in which
+ * lastleft and firstright differ.  When the attribute is ordered bytewise
+ * (bytea, or text with a "C" collation or text_pattern_ops), the shortest
+ * prefix of firstright's value that still sorts after lastleft's value
+ * separates the two halves of the split just as well as the full value.
+ * Return a new pivot tuple with firstright's first keepnatts attributes, the
+ * last of which cut down to that prefix, or NULL if the attribute cannot be
+ * truncated profitably.
+ *
+ * Returned tuple is never larger than firstright, even when firstright's
+ * value is stored compressed.
+ */
+static IndexTuple
+_bt_truncate_datum(Relation rel, IndexTuple lastleft, IndexTuple firstright,
+				   int keepnatts)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	RegProcedure cmpproc;
+	bool		istext;
+	Datum		datum;
+	bool		datumnull;
+	bytea	   *left;
+	bytea	   *right;
+	char	   *leftp;
+	char	   *rightp;
+	int			leftlen;
+	int			rightlen;
+	int			prefixlen;
+	bytea	   *prefix;
+	IndexTuple	pivot;
+
+	if (rel->rd_indoption[keepnatts - 1] & INDOPTION_DESC)
+		return NULL;
+
+	cmpproc = index_getprocid(rel, keepnatts, BTORDER_PROC);
+	if (cmpproc == F_BYTEACMP)
+		istext = false;
+	else if (cmpproc == F_BTTEXT_PATTERN_CMP ||
+			 (cmpproc == F_BTTEXTCMP &&
+			  lc_collate_is_c(rel->rd_indcollation[keepnatts - 1])))
+		istext = true;
+	else
+		return NULL;
+
+	datum = index_getattr(lastleft, keepnatts, itupdesc, &datumnull);
+	if (datumnull)
+		return NULL;
+	left = DatumGetByteaPP(datum);
+	datum = index_getattr(firstright, keepnatts, itupdesc, &datumnull);
+	if (datumnull)
+		return NULL;
+	right = DatumGetByteaPP(datum);
+
+	leftp = VARDATA_ANY(left);
+	leftlen = VARSIZE_ANY_EXHDR(left);
+	rightp = VARDATA_ANY(right);
+	rightlen = VARSIZE_ANY_EXHDR(right);
+
+	/* Keep everything up to and including the first distinguishing byte */
+	for (prefixlen = 0; prefixlen < Min(leftlen, rightlen); prefixlen++)
+	{
+		if (leftp[prefixlen] != rightp[prefixlen])
+			break;
+	}
+	prefixlen++;
+
+	/* Don't split a multibyte character in two */
+	if (istext && prefixlen < rightlen)
+	{
+		int			charend = 0;
+
+		while (charend < prefixlen)
+			charend += pg_mblen(rightp + charend);
+		prefixlen = charend;
+	}
+
+	if (prefixlen >= rightlen)
+		return NULL;
+
+	prefix = (bytea *) palloc(VARHDRSZ + prefixlen);
+	SET_VARSIZE(prefix, VARHDRSZ + prefixlen);
+	memcpy(VARDATA(prefix), rightp, prefixlen);
+
+	/* Form pivot from firstright's remaining attributes plus prefix */
+	truncdesc = palloc(TupleDescSize(itupdesc));
+	TupleDescCopy(truncdesc, itupdesc);
+	truncdesc->natts = keepnatts;
+	index_deform_tuple(firstright, truncdesc, values, isnull);
+	values[keepnatts - 1] = PointerGetDatum(prefix);
+	pivot = index_form_tuple(truncdesc, values, isnull);
+	pivot->t_tid = firstright->t_tid;
+	pfree(truncdesc);
+	pfree(prefix);
+
+	if (IndexTupleSize(pivot) > IndexTupleSize(firstright))
+	{
+		pfree(pivot);
+		return NULL;
+	}
+
+	return pivot;
+}
+
 /*
  * _bt_keep_natts - how many key attributes to keep when truncating.
  *
@@ -39,8 +39,11 @@
 
 /* The number of I/O chunks we try to break a parallel seqscan down into */
 #define PARALLEL_SEQSCAN_NCHUNKS			2048
-/* Ramp down size of allocations when we've only this number of chunks left */
-#define PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS	64
+/*
+ * Once all ranges are claimed, ramp down size of allocations when we've only
+ * this number of chunks left in the range
+ */
+#define PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS	4
 /* Cap the size of parallel I/O chunks to this number of blocks */
 #define PARALLEL_SEQSCAN_MAX_CHUNK_SIZE		8192
 
@@ -409,7 +412,10 @@ table_block_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
 		bpscan->phs_nblocks > NBuffers / 4;
 	SpinLockInit(&bpscan->phs_mutex);
 	bpscan->phs_startblock = InvalidBlockNumber;
-	pg_atomic_init_u64(&bpscan->phs_nallocated, 0);
+	bpscan->phs_nranges = Min(PARALLEL_SEQSCAN_NRANGES, bpscan->phs_nblocks);
+	pg_atomic_init_u32(&bpscan->phs_nextrange, 0);
+	for (int i = 0; i < PARALLEL_SEQSCAN_NRANGES; i++)
+		pg_atomic_init_u64(&bpscan->phs_nallocated[i], 0);
 
 	return sizeof(ParallelBlockTableScanDescData);
 }
@@ -419,7 +425,9 @@ table_block_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
 {
 	ParallelBlockTableScanDesc bpscan = (ParallelBlockTableScanDesc) pscan;
 
-	pg_atomic_write_u64(&bpscan->phs_nallocated, 0);
+	pg_atomic_write_u32(&bpscan->phs_nextrange, 0);
+	for (int i = 0; i < PARALLEL_SEQSCAN_NRANGES; i++)
+		pg_atomic_write_u64(&bpscan->phs_nallocated[i], 0);
 }
 
 /*
@@ -438,6 +446,7 @@ table_block_parallelscan_startblock_init(Relation rel,
 
 	/* Reset the state we use for controlling allocation size. */
 	memset(pbscanwork, 0, sizeof(*pbscanwork));
+	pbscanwork->phsw_range = -1;
 
 	StaticAssertStmt(MaxBlockNumber <= 0xFFFFFFFE,
 					 "pg_nextpower2_32 may be too small for non-standard BlockNumber width");
@@ -491,6 +500,124 @@ retry:
 	SpinLockRelease(&pbscan->phs_mutex);
 }
 
+/*
+ * Return the offset, relative to the scan's startblock, of the first block of
+ * the given range.  Passing phs_nranges returns the number of blocks.
+ */
+static inline uint64
+table_block_parallelscan_rangestart(ParallelBlockTableScanDesc pbscan,
+									uint32 range)
+{
+	return (uint64) pbscan->phs_nblocks * range / pbscan->phs_nranges;
+}
+
+/*
+ * Return the number of blocks not yet allocated from the given range.
+ */
+static uint64
+table_block_parallelscan_rangeremaining(ParallelBlockTableScanDesc pbscan,
+										uint32 range)
+{
+	uint64		size;
+	uint64		nallocated;
+
+	size = table_block_parallelscan_rangestart(pbscan, range + 1) -
+		table_block_parallelscan_rangestart(pbscan, range);
+	nallocated = pg_atomic_read_u64(&pbscan->phs_nallocated[range]);
+
+	return nallocated >= size ? 0 : size - nallocated;
+}
+
+/*
+ * allocate a new chunk of blocks to this worker
+ *
+ * Returns the offset, relative to the scan's startblock, of the chunk's first
+ * block, and sets up pbscanwork to return the rest of the chunk.  Returns
+ * phs_nblocks if all blocks have been allocated.
+ */
+static uint64
+table_block_parallelscan_nextchunk(ParallelBlockTableScanWorker pbscanwork,
+								   ParallelBlockTableScanDesc pbscan)
+{
+	for (;;)
+	{
+		int			range = pbscanwork->phsw_range;
+		uint64		remaining;
+		int			best;
+
+		if (range >= 0)
+		{
+			uint64		start;
+			uint64		size;
+			uint64		offset;
+			uint32		chunk_size = pbscanwork->phsw_chunk_size;
+
+			start = table_block_parallelscan_rangestart(pbscan, range);
+			size = table_block_parallelscan_rangestart(pbscan, range + 1) - start;
+
+			/*
+			 * Once no range is left unclaimed, the remaining work has to be
+			 * divided between all the workers as evenly as possible.  When
+			 * we've only got PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS chunks remaining
+			 * in the range, we halve the chunk size, so that the last few
+			 * blocks are done with a chunk size of 1.
+			 */
+			if (pg_atomic_read_u32(&pbscan->phs_nextrange) >= pbscan->phs_nranges)
+			{
+				remaining = table_block_parallelscan_rangeremaining(pbscan,
+																	range);
+				while (chunk_size > 1 &&
+					   remaining < (uint64) chunk_size * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS)
+					chunk_size >>= 1;
+			}
+
+			offset = pg_atomic_fetch_add_u64(&pbscan->phs_nallocated[range],
+											 chunk_size);
+			if (offset < size)
+			{
+				/*
+				 * Set the remaining number of blocks in this chunk so that
+				 * subsequent calls from this worker continue on with this
+				 * chunk until it's done.
+				 */
+				pbscanwork->phsw_nallocated = start + offset;
+				pbscanwork->phsw_chunk_remaining = Min(chunk_size, size - offset) - 1;
+				return start + offset;
+			}
+		}
+
+		/* The current range is done, so claim the next unclaimed one */
+		if (pg_atomic_read_u32(&pbscan->phs_nextrange) < pbscan->phs_nranges)
+		{
+			uint32		next = pg_atomic_fetch_add_u32(&pbscan->phs_nextrange, 1);
+
+			if (next < pbscan->phs_nranges)
+			{
+				pbscanwork->phsw_range = next;
+				continue;
+			}
+		}
+
+		/* Help with the range that has the most blocks left */
+		best = -1;
+		remaining = 0;
+		for (uint32 i = 0; i < pbscan->phs_nranges; i++)
+		{
+			uint64		r = table_block_parallelscan_rangeremaining(pbscan, i);
+
+			if (r > remaining)
+			{
+				best = i;
+				remaining = r;
+			}
+		}
+
+		pbscanwork->phsw_range = best;
+		if (best < 0)
+			return pbscan->phs_nblocks; /* all blocks have been allocated */
+	}
+}
+
 /*
  * get the next page to scan
  *
@@ -516,36 +643,34 @@ table_block_parallelscan_nextpage(Relation rel,
 	 * operating systems would not detect the sequential I/O pattern due to
 	 * each backend being a different process which could result in poor
 	 * performance due to inefficient or no readahead.  To work around this
-	 * issue, we now allocate a range of block numbers for each worker and
-	 * when they come back for another block, we give them the next one in
-	 * that range until the range is complete.  When the worker completes the
-	 * range of blocks we then allocate another range for it and return the
-	 * first block number from that range.
+	 * issue, we split the relation into PARALLEL_SEQSCAN_NRANGES ranges, and
+	 * each worker claims a whole range.  Within the range, we allocate the
+	 * blocks to the worker a chunk at a time, and when they come back for
+	 * another block, we give them the next one in that chunk until the chunk
+	 * is complete.  A worker only moves on to another range when its range
+	 * is complete.
 	 *
-	 * Here we name these ranges of blocks "chunks".  The initial size of
-	 * these chunks is determined in table_block_parallelscan_startblock_init
-	 * based on the size of the relation.  Towards the end of the scan, we
-	 * start making reductions in the size of the chunks in order to attempt
-	 * to divide the remaining work over all the workers as evenly as
+	 * The initial size of the chunks is determined in
+	 * table_block_parallelscan_startblock_init based on the size of the
+	 * relation.  Once all ranges have been claimed, workers that complete
+	 * their range help out with the range that has the most blocks left, and
+	 * we start making reductions in the size of the chunks in order to
+	 * attempt to divide the remaining work over all the workers as evenly as
 	 * possible.
 	 *
 	 * Here pbscanwork is local worker memory.  phsw_chunk_remaining tracks
 	 * the number of blocks remaining in the chunk.  When that reaches 0 then
 	 * we must allocate a new chunk for the worker.
 	 *
-	 * phs_nallocated tracks how many blocks have been allocated to workers
-	 * already.  When phs_nallocated >= rs_nblocks, all blocks have been
-	 * allocated.
+	 * phs_nallocated[] tracks how many blocks of each range have been
+	 * allocated to workers already.  Workers only update the counter of the
+	 * range they're working on, so the counters are contended much less than
+	 * a single counter for the whole relation would be.  Because we use an
+	 * atomic fetch-and-add to fetch the current value, a counter can exceed
+	 * the size of its range, so it must be 64 bits wide.
 	 *
-	 * Because we use an atomic fetch-and-add to fetch the current value, the
-	 * phs_nallocated counter will exceed rs_nblocks, because workers will
-	 * still increment the value, when they try to allocate the next block but
-	 * all blocks have been allocated already. The counter must be 64 bits
-	 * wide because of that, to avoid wrapping around when rs_nblocks is close
-	 * to 2^32.
-	 *
-	 * The actual block to return is calculated by adding the counter to the
-	 * starting block number, modulo nblocks.
+	 * The actual block to return is calculated by adding the block's offset
+	 * to the starting block number, modulo nblocks.
 	 */
 
 	/*
@@ -563,30 +688,7 @@ table_block_parallelscan_nextpage(Relation rel,
 		pbscanwork->phsw_chunk_remaining--;
 	}
 	else
-	{
-		/*
-		 * When we've only got PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS chunks
-		 * remaining in the scan, we half the chunk size.  Since we reduce the
-		 * chunk size here, we'll hit this again after doing
-		 * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS at the new size.  After a few
-		 * iterations of this, we'll end up doing the last few blocks with the
-		 * chunk size set to 1.
-		 */
-		if (pbscanwork->phsw_chunk_size > 1 &&
-			pbscanwork->phsw_nallocated > pbscan->phs_nblocks -
-			(pbscanwork->phsw_chunk_size * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS))
-			pbscanwork->phsw_chunk_size >>= 1;
-
-		nallocated = pbscanwork->phsw_nallocated =
-			pg_atomic_fetch_add_u64(&pbscan->phs_nallocated,
-									pbscanwork->phsw_chunk_size);
-
-		/*
-		 * Set the remaining number of blocks in this chunk so that subsequent
-		 * calls from this worker continue on with this chunk until it's done.
-		 */
-		pbscanwork->phsw_chunk_remaining = pbscanwork->phsw_chunk_size - 1;
-	}
+		nallocated = table_block_parallelscan_nextchunk(pbscanwork, pbscan);
 
 	if (nallocated >= pbscan->phs_nblocks)
 		page = InvalidBlockNumber;	/* all blocks have been allocated */
@@ -594,19 +696,13 @@ table_block_parallelscan_nextpage(Relation rel,
 		page = (nallocated + pbscan->phs_startblock) % pbscan->phs_nblocks;
 
 	/*
-	 * Report scan location.  Normally, we report the current page number.
-	 * When we reach the end of the scan, though, we report the starting page,
-	 * not the ending page, just so the starting positions for later scans
-	 * doesn't slew backwards.  We only report the position at the end of the
-	 * scan once, though: subsequent callers will report nothing.
+	 * Report scan location.  The first range starts at the starting page,
+	 * so whoever scans it reports its progress, and later scans start where
+	 * that left off.
 	 */
-	if (pbscan->base.phs_syncscan)
-	{
-		if (page != InvalidBlockNumber)
-			ss_report_location(rel, page);
-		else if (nallocated == pbscan->phs_nblocks)
-			ss_report_location(rel, pbscan->phs_startblock);
-	}
+	if (pbscan->base.phs_syncscan && page != InvalidBlockNumber &&
+		pbscanwork->phsw_range == 0)
+		ss_report_location(rel, page);
 
 	return page;
 }
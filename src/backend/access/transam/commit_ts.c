@@ -508,12 +508,14 @@ pg_xact_commit_timestamp_origin(PG_FUNCTION_ARGS)
 /*
  * Number of shared CommitTS buffers.
  *
- * We use a very similar logic as for the number of CLOG buffers; see comments
- * in CLOGShmemBuffers.
+ * This is commit_timestamp_buffers if set; otherwise, we use a very similar
+ * logic as for the number of CLOG buffers; see comments in CLOGShmemBuffers.
  */
 Size
 CommitTsShmemBuffers(void)
 {
+	if (commit_timestamp_buffers > 0)
+		return commit_timestamp_buffers;
 	return Min(16, Max(4, NBuffers / 1024));
 }
 
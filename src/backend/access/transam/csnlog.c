@@ -0,0 +1,483 @@
+/*-------------------------------------------------------------------------
+ *
+ * csnlog.c
+ *		Commit sequence number log manager
+ *
+ * When csn_snapshots is enabled, every transaction that commits with an XID
+ * is assigned a commit sequence number (CSN) from a single, monotonically
+ * increasing counter, just before it is removed from the ProcArray.  The
+ * pg_csn log records the CSN assigned to each XID, including subtransaction
+ * XIDs.  An MVCC snapshot can then be represented by the next CSN to be
+ * assigned at the time the snapshot was taken: a transaction is visible to
+ * the snapshot if and only if its CSN is smaller.  Taking such a snapshot
+ * does not require scanning the ProcArray, see GetSnapshotData().
+ *
+ * Like pg_subtrans, the log only needs to remember CSNs for transactions
+ * that may still be considered running by some snapshot, i.e., XIDs that
+ * follow the oldest xmin of any snapshot in use.  Anything older is simply
+ * looked up in pg_xact.  So there is no need to preserve data over a crash
+ * and restart, and there are no XLOG interactions: during startup we just
+ * reinitialize the currently-active pages of the log.
+ *
+ * Assigning a CSN is a three-step process.  We first mark the XIDs as
+ * committing, then obtain the CSN from the counter, and finally store it.
+ * A reader that finds an XID marked as committing has to wait until the
+ * final value is stored, since it can't yet tell whether the CSN will be
+ * smaller than its snapshot's or not.  Without the intermediate state, a
+ * snapshot could see the transaction as still running and, a moment later,
+ * as committed before the snapshot was taken.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/csnlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/clog.h"
+#include "access/csnlog.h"
+#include "access/slru.h"
+#include "access/transam.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/proc.h"
+#include "storage/s_lock.h"
+#include "storage/shmem.h"
+#include "utils/snapmgr.h"
+
+
+/*
+ * Defines for CSNLog page sizes.  A page is the same BLCKSZ as is used
+ * everywhere else in Postgres.
+ *
+ * Note: because TransactionIds are 32 bits and wrap around at 0xFFFFFFFF,
+ * CSNLog page numbering also wraps around at
+ * 0xFFFFFFFF/CSNLOG_XACTS_PER_PAGE, and segment numbering at
+ * 0xFFFFFFFF/CSNLOG_XACTS_PER_PAGE/SLRU_PAGES_PER_SEGMENT.  We need take no
+ * explicit notice of that fact in this module, except when comparing segment
+ * and page numbers in TruncateCSNLog (see CSNLogPagePrecedes) and zeroing
+ * them in StartupCSNLog.
+ */
+
+/* We need eight bytes per xact */
+#define CSNLOG_XACTS_PER_PAGE (BLCKSZ / sizeof(CommitSeqNo))
+
+#define TransactionIdToPage(xid) ((xid) / (TransactionId) CSNLOG_XACTS_PER_PAGE)
+#define TransactionIdToEntry(xid) ((xid) % (TransactionId) CSNLOG_XACTS_PER_PAGE)
+
+/*
+ * Special values stored in the log.  An XID whose entry is still
+ * InvalidCommitSeqNo has not committed (yet).  FrozenCommitSeqNo marks XIDs
+ * that had already finished, one way or the other, when the log was started
+ * up; it precedes every snapshot's CSN.
+ */
+#define CommittingCommitSeqNo		((CommitSeqNo) 1)
+#define FrozenCommitSeqNo			((CommitSeqNo) 2)
+#define FirstNormalCommitSeqNo		((CommitSeqNo) 3)
+
+/* GUC */
+bool		csn_snapshots = false;
+
+/*
+ * Link to shared-memory data structures for CSNLog control
+ */
+static SlruCtlData CSNLogCtlData;
+
+#define CSNLogCtl (&CSNLogCtlData)
+
+/*
+ * The CSN counter.  All CSNs handed out so far are smaller than
+ * nextCommitSeqNo.
+ */
+typedef struct CSNLogSharedData
+{
+	pg_atomic_uint64 nextCommitSeqNo;
+} CSNLogSharedData;
+
+static CSNLogSharedData *csnShared = NULL;
+
+
+static int	ZeroCSNLogPage(int pageno);
+static bool CSNLogPagePrecedes(int page1, int page2);
+static void CSNLogSetEntries(int nxids, TransactionId *xids, CommitSeqNo csn);
+
+
+/*
+ * Record that the given transaction tree has committed, assigning it the
+ * next commit sequence number.
+ *
+ * This must be called after the commit has been recorded in pg_xact, and
+ * before the transaction is removed from the ProcArray.
+ */
+void
+CSNLogSetCommitSeqNo(TransactionId xid, int nsubxids, TransactionId *subxids)
+{
+	TransactionId xidbuf[PGPROC_MAX_CACHED_SUBXIDS + 1];
+	TransactionId *xids;
+	int			nxids = nsubxids + 1;
+	CommitSeqNo csn;
+
+	Assert(csn_snapshots);
+	Assert(TransactionIdIsNormal(xid));
+
+	/* Put all the XIDs of the tree into one array */
+	if (nxids <= lengthof(xidbuf))
+		xids = xidbuf;
+	else
+		xids = palloc(nxids * sizeof(TransactionId));
+	xids[0] = xid;
+	memcpy(&xids[1], subxids, nsubxids * sizeof(TransactionId));
+
+	/*
+	 * Once the transaction has been marked as committing, readers will wait
+	 * for us to finish, so we'd better not fail in between.
+	 */
+	START_CRIT_SECTION();
+
+	CSNLogSetEntries(nxids, xids, CommittingCommitSeqNo);
+
+	/*
+	 * The CSN must be obtained only after the transaction is marked as
+	 * committing; pairs with the barrier in GetSnapshotData().
+	 */
+	pg_memory_barrier();
+	csn = pg_atomic_fetch_add_u64(&csnShared->nextCommitSeqNo, 1);
+
+	CSNLogSetEntries(nxids, xids, csn);
+
+	END_CRIT_SECTION();
+
+	if (xids != xidbuf)
+		pfree(xids);
+}
+
+/*
+ * Store the given value in the log entries of all the given XIDs.  The XIDs
+ * need not be sorted, but we visit each page only once per run of XIDs on
+ * the same page, which is the common case.
+ */
+static void
+CSNLogSetEntries(int nxids, TransactionId *xids, CommitSeqNo csn)
+{
+	int			i = 0;
+
+	while (i < nxids)
+	{
+		int			pageno = TransactionIdToPage(xids[i]);
+		int			slotno;
+		CommitSeqNo *page;
+
+		LWLockAcquire(CSNLogSLRULock, LW_EXCLUSIVE);
+
+		slotno = SimpleLruReadPage(CSNLogCtl, pageno, true, xids[i]);
+		page = (CommitSeqNo *) CSNLogCtl->shared->page_buffer[slotno];
+
+		do
+		{
+			page[TransactionIdToEntry(xids[i])] = csn;
+			i++;
+		} while (i < nxids && TransactionIdToPage(xids[i]) == pageno);
+
+		CSNLogCtl->shared->page_dirty[slotno] = true;
+
+		LWLockRelease(CSNLogSLRULock);
+	}
+}
+
+/*
+ * Return the commit sequence number of a transaction, or InvalidCommitSeqNo
+ * if it has not committed.
+ *
+ * If the transaction is in the middle of being assigned its CSN, wait for
+ * that to finish.
+ */
+CommitSeqNo
+CSNLogGetCommitSeqNo(TransactionId xid)
+{
+	int			pageno = TransactionIdToPage(xid);
+	int			entryno = TransactionIdToEntry(xid);
+	SpinDelayStatus delayStatus;
+	CommitSeqNo csn;
+
+	/* Can't ask about stuff that might not be around anymore */
+	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
+	Assert(csn_snapshots);
+
+	init_local_spin_delay(&delayStatus);
+
+	for (;;)
+	{
+		int			slotno;
+
+		/* lock is acquired by SimpleLruReadPage_ReadOnly */
+		slotno = SimpleLruReadPage_ReadOnly(CSNLogCtl, pageno, xid);
+		csn = ((CommitSeqNo *) CSNLogCtl->shared->page_buffer[slotno])[entryno];
+		LWLockRelease(CSNLogSLRULock);
+
+		if (csn != CommittingCommitSeqNo)
+			break;
+
+		/*
+		 * The committer doesn't hold any lock while it obtains the CSN, but
+		 * it won't take long.
+		 */
+		perform_spin_delay(&delayStatus);
+	}
+
+	finish_spin_delay(&delayStatus);
+
+	return csn;
+}
+
+/*
+ * Return the CSN that will be assigned to the next committing transaction.
+ * A snapshot taken now sees exactly the transactions with smaller CSNs.
+ */
+CommitSeqNo
+ReadNextCommitSeqNo(void)
+{
+	Assert(csn_snapshots);
+
+	return pg_atomic_read_u64(&csnShared->nextCommitSeqNo);
+}
+
+/*
+ * Number of shared CSNLog buffers.
+ *
+ * CSNs are twice the size of subtransaction parent XIDs, so use a little
+ * more memory than pg_subtrans does, scaled like CLOGShmemBuffers.
+ */
+static int
+CSNLogShmemBuffers(void)
+{
+	return Min(128, Max(16, NBuffers / 512));
+}
+
+/*
+ * Initialization of shared memory for CSNLog
+ */
+Size
+CSNLogShmemSize(void)
+{
+	if (!csn_snapshots)
+		return 0;
+
+	return add_size(SimpleLruShmemSize(CSNLogShmemBuffers(), 0),
+					sizeof(CSNLogSharedData));
+}
+
+void
+CSNLogShmemInit(void)
+{
+	bool		found;
+
+	if (!csn_snapshots)
+		return;
+
+	CSNLogCtl->PagePrecedes = CSNLogPagePrecedes;
+	SimpleLruInit(CSNLogCtl, "CSNLog", CSNLogShmemBuffers(), 0,
+				  CSNLogSLRULock, "pg_csn",
+				  LWTRANCHE_CSNLOG_BUFFER, SYNC_HANDLER_NONE);
+	SlruPagePrecedesUnitTests(CSNLogCtl, CSNLOG_XACTS_PER_PAGE);
+
+	csnShared = ShmemInitStruct("CSNLog shared",
+								sizeof(CSNLogSharedData),
+								&found);
+
+	if (!IsUnderPostmaster)
+	{
+		Assert(!found);
+		pg_atomic_init_u64(&csnShared->nextCommitSeqNo, FirstNormalCommitSeqNo);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Initialize (or reinitialize) a page of CSNLog to zeroes.
+ *
+ * The page is not actually written, just set up in shared memory.
+ * The slot number of the new page is returned.
+ *
+ * Control lock must be held at entry, and will be held at exit.
+ */
+static int
+ZeroCSNLogPage(int pageno)
+{
+	return SimpleLruZeroPage(CSNLogCtl, pageno);
+}
+
+/*
+ * This must be called ONCE during postmaster or standalone-backend startup,
+ * at the end of recovery, before CSN-based snapshots can be taken.
+ *
+ * oldestActiveXID is the oldest XID of any prepared transaction, or nextXid
+ * if there are none.
+ */
+void
+StartupCSNLog(TransactionId oldestActiveXID)
+{
+	TransactionId xid;
+	TransactionId nextXid;
+	int			startPage;
+	int			endPage;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Since we don't expect pg_csn to be valid across crashes, we initialize
+	 * the currently-active page(s) to zeroes during startup.  Whenever we
+	 * advance into a new page, ExtendCSNLog will likewise zero the new page
+	 * without regard to whatever was previously on disk.
+	 */
+	LWLockAcquire(CSNLogSLRULock, LW_EXCLUSIVE);
+
+	startPage = TransactionIdToPage(oldestActiveXID);
+	nextXid = XidFromFullTransactionId(ShmemVariableCache->nextXid);
+	endPage = TransactionIdToPage(nextXid);
+
+	while (startPage != endPage)
+	{
+		(void) ZeroCSNLogPage(startPage);
+		startPage++;
+		/* must account for wraparound */
+		if (startPage > TransactionIdToPage(MaxTransactionId))
+			startPage = 0;
+	}
+	(void) ZeroCSNLogPage(startPage);
+
+	/*
+	 * XIDs between oldestActiveXID and nextXid that are known committed or
+	 * aborted must not look in-progress to new snapshots, so give them a CSN
+	 * older than any snapshot.  That leaves prepared transactions, which will
+	 * get a real CSN when they commit, and transactions cut short by a crash,
+	 * which never commit.  This loop only has work to do if there are
+	 * prepared transactions.
+	 */
+	for (xid = oldestActiveXID; TransactionIdPrecedes(xid, nextXid);)
+	{
+		XLogRecPtr	lsn;
+		XidStatus	status = TransactionIdGetStatus(xid, &lsn);
+
+		if (status == TRANSACTION_STATUS_COMMITTED ||
+			status == TRANSACTION_STATUS_ABORTED)
+		{
+			int			slotno;
+			CommitSeqNo *page;
+
+			slotno = SimpleLruReadPage(CSNLogCtl, TransactionIdToPage(xid),
+									   true, xid);
+			page = (CommitSeqNo *) CSNLogCtl->shared->page_buffer[slotno];
+			page[TransactionIdToEntry(xid)] = FrozenCommitSeqNo;
+			CSNLogCtl->shared->page_dirty[slotno] = true;
+		}
+
+		TransactionIdAdvance(xid);
+	}
+
+	LWLockRelease(CSNLogSLRULock);
+}
+
+/*
+ * Perform a checkpoint --- either during shutdown, or on-the-fly
+ */
+void
+CheckPointCSNLog(void)
+{
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Write dirty CSNLog pages to disk
+	 *
+	 * This is not actually necessary from a correctness point of view. We do
+	 * it merely to improve the odds that writing of dirty pages is done by
+	 * the checkpoint process and not by backends.
+	 */
+	SimpleLruWriteAll(CSNLogCtl, true);
+}
+
+/*
+ * Make sure that CSNLog has room for a newly-allocated XID.
+ *
+ * NB: this is called while holding XidGenLock.  We want it to be very fast
+ * most of the time; even when it's not so fast, no actual I/O need happen
+ * unless we're forced to write out a dirty CSNLog page to make room
+ * in shared memory.
+ */
+void
+ExtendCSNLog(TransactionId newestXact)
+{
+	int			pageno;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * No work except at first XID of a page.  But beware: just after
+	 * wraparound, the first XID of page zero is FirstNormalTransactionId.
+	 */
+	if (TransactionIdToEntry(newestXact) != 0 &&
+		!TransactionIdEquals(newestXact, FirstNormalTransactionId))
+		return;
+
+	pageno = TransactionIdToPage(newestXact);
+
+	LWLockAcquire(CSNLogSLRULock, LW_EXCLUSIVE);
+
+	/* Zero the page */
+	ZeroCSNLogPage(pageno);
+
+	LWLockRelease(CSNLogSLRULock);
+}
+
+/*
+ * Remove all CSNLog segments before the one holding the passed transaction ID
+ *
+ * oldestXact is the oldest TransactionXmin of any running transaction.  This
+ * is called only during checkpoint.
+ */
+void
+TruncateCSNLog(TransactionId oldestXact)
+{
+	int			cutoffPage;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * The cutoff point is the start of the segment containing oldestXact. We
+	 * pass the *page* containing oldestXact to SimpleLruTruncate.  We step
+	 * back one transaction to avoid passing a cutoff page that hasn't been
+	 * created yet in the rare case that oldestXact would be the first item on
+	 * a page and oldestXact == next XID.  In that case, if we didn't subtract
+	 * one, we'd trigger SimpleLruTruncate's wraparound detection.
+	 */
+	TransactionIdRetreat(oldestXact);
+	cutoffPage = TransactionIdToPage(oldestXact);
+
+	SimpleLruTruncate(CSNLogCtl, cutoffPage);
+}
+
+
+/*
+ * Decide whether a CSNLog page number is "older" for truncation purposes.
+ * Analogous to CLOGPagePrecedes().
+ */
+static bool
+CSNLogPagePrecedes(int page1, int page2)
+{
+	TransactionId xid1;
+	TransactionId xid2;
+
+	xid1 = ((TransactionId) page1) * CSNLOG_XACTS_PER_PAGE;
+	xid1 += FirstNormalTransactionId + 1;
+	xid2 = ((TransactionId) page2) * CSNLOG_XACTS_PER_PAGE;
+	xid2 += FirstNormalTransactionId + 1;
+
+	return (TransactionIdPrecedes(xid1, xid2) &&
+			TransactionIdPrecedes(xid1, xid2 + CSNLOG_XACTS_PER_PAGE - 1));
+}
@@ -14,6 +14,7 @@
 
 #include "postgres.h"
 
+#include "access/gist_private.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
@@ -34,6 +35,8 @@
 #include "pgstat.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/sinval.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
@@ -43,6 +46,7 @@
 #include "utils/memutils.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 #include "utils/typcache.h"
 
 /*
@@ -126,6 +130,64 @@ static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
 /* Backend-local copy of data from FixedParallelState. */
 static pid_t ParallelLeaderPid;
 
+/*
+ * Shared memory state of the parallel worker pool.
+ *
+ * A parallel worker that has finished its work and has detached from the
+ * leader's segment can stay around for parallel_worker_idle_timeout, waiting
+ * for the same leader to hand it another parallel context.  That saves the
+ * cost of starting a new background worker, connecting to the database and
+ * joining the lock group on every Gather.  Idle workers wait in a slot of
+ * this array; the leader assigns a segment to a slot and sets the worker's
+ * latch.  All fields are protected by the mutex.
+ */
+typedef enum ParallelPoolSlotState
+{
+	PARALLEL_POOL_SLOT_FREE,	/* not in use */
+	PARALLEL_POOL_SLOT_IDLE,	/* worker waits for its leader */
+	PARALLEL_POOL_SLOT_ASSIGNED,	/* leader has handed over a segment */
+	PARALLEL_POOL_SLOT_BUSY,	/* worker is working for its leader */
+	PARALLEL_POOL_SLOT_SHUTDOWN /* leader has gone away */
+} ParallelPoolSlotState;
+
+typedef struct ParallelPoolSlot
+{
+	ParallelPoolSlotState state;
+	pid_t		leader_pid;		/* the only leader that can use the worker */
+	pid_t		worker_pid;
+	PGPROC	   *worker_proc;
+	dsm_handle	handle;			/* segment of the assigned parallel context */
+	int			worker_number;	/* worker number in that context */
+} ParallelPoolSlot;
+
+typedef struct ParallelPoolControl
+{
+	slock_t		mutex;
+	int			nslots;
+	ParallelPoolSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelPoolControl;
+
+/* A worker that the leader may reuse, in its backend-local list. */
+typedef struct ParallelPoolMember
+{
+	pid_t		pid;
+	int			slotno;
+	BackgroundWorkerHandle *bgwhandle;
+} ParallelPoolMember;
+
+/* GUC variable */
+int			parallel_worker_idle_timeout = 0;
+
+static ParallelPoolControl *ParallelPool = NULL;
+
+/* In the leader: idle pooled workers we may hand a parallel context to. */
+static List *ParallelPoolIdleWorkers = NIL;
+static bool ParallelPoolLeaderExitRegistered = false;
+
+/* In a worker: our pool slot, and the segment we're working on. */
+static int	MyParallelPoolSlot = -1;
+static dsm_segment *ParallelWorkerSegment = NULL;
+
 /*
  * List of internal parallel worker entry points.  We need this for
  * reasons explained in LookupParallelWorkerFunction(), below.
@@ -143,8 +205,14 @@ static const struct
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
 	},
+	{
+		"_gist_parallel_build_main", _gist_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"validate_index_parallel_main", validate_index_parallel_main
 	}
 };
 
@@ -153,6 +221,48 @@ static void HandleParallelMessage(ParallelContext *pcxt, int i, StringInfo msg);
 static void WaitForParallelWorkersToExit(ParallelContext *pcxt);
 static parallel_worker_main_type LookupParallelWorkerFunction(const char *libraryname, const char *funcname);
 static void ParallelWorkerShutdown(int code, Datum arg);
+static bool ParallelWorkerRunJob(dsm_handle handle, int worker_number);
+static bool ParallelWorkerAwaitJob(PGPROC *leader, dsm_handle *handle,
+								   int *worker_number);
+static bool ParallelWorkerPoolAssign(dsm_handle handle, int worker_number,
+									 BackgroundWorkerHandle **bgwhandle);
+static bool ParallelWorkerPoolAdopt(BackgroundWorkerHandle *bgwhandle,
+									pid_t pid);
+static void ParallelWorkerPoolLeaderExit(int code, Datum arg);
+
+
+/*
+ * ParallelWorkerPoolShmemSize
+ *		Compute space needed for the parallel worker pool.
+ */
+Size
+ParallelWorkerPoolShmemSize(void)
+{
+	return add_size(offsetof(ParallelPoolControl, slots),
+					mul_size(max_worker_processes, sizeof(ParallelPoolSlot)));
+}
+
+/*
+ * ParallelWorkerPoolShmemInit
+ *		Allocate and initialize the parallel worker pool.
+ */
+void
+ParallelWorkerPoolShmemInit(void)
+{
+	bool		found;
+
+	ParallelPool = (ParallelPoolControl *)
+		ShmemInitStruct("Parallel Worker Pool", ParallelWorkerPoolShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		SpinLockInit(&ParallelPool->mutex);
+		ParallelPool->nslots = max_worker_processes;
+		memset(ParallelPool->slots, 0,
+			   max_worker_processes * sizeof(ParallelPoolSlot));
+	}
+}
 
 
 /*
@@ -553,8 +663,12 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	/* If we do have workers, we'd better have a DSM segment. */
 	Assert(pcxt->seg != NULL);
 
-	/* We might be running in a short-lived memory context. */
-	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	/*
+	 * We might be running in a short-lived memory context.  The worker
+	 * handles go into TopMemoryContext, since a worker that enters the pool
+	 * can outlive the transaction.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
 
 	/* Configure a worker. */
 	memset(&worker, 0, sizeof(worker));
@@ -581,6 +695,16 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	 */
 	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
 	{
+		/* Prefer an idle worker of ours, if there's one */
+		if (ParallelWorkerPoolAssign(dsm_segment_handle(pcxt->seg), i,
+									 &pcxt->worker[i].bgwhandle))
+		{
+			shm_mq_set_handle(pcxt->worker[i].error_mqh,
+							  pcxt->worker[i].bgwhandle);
+			pcxt->nworkers_launched++;
+			continue;
+		}
+
 		memcpy(worker.bgw_extra, &i, sizeof(int));
 		if (!any_registrations_failed &&
 			RegisterDynamicBackgroundWorker(&worker,
@@ -608,6 +732,8 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 		}
 	}
 
+	MemoryContextSwitchTo(TopTransactionContext);
+
 	/*
 	 * Now that nworkers_launched has taken its final value, we can initialize
 	 * known_attached_workers.
@@ -871,21 +997,52 @@ WaitForParallelWorkersToFinish(ParallelContext *pcxt)
  * difference between WaitForParallelWorkersToFinish and this function is
  * that the former just ensures that last message sent by a worker backend is
  * received by the leader backend whereas this ensures the complete shutdown.
+ *
+ * A worker that has entered the parallel worker pool after detaching from
+ * our segment counts as shut down, too; we remember it for LaunchParallelWorkers.
  */
 static void
 WaitForParallelWorkersToExit(ParallelContext *pcxt)
 {
 	int			i;
 
-	/* Wait until the workers actually die. */
+	/* Wait until the workers actually die, or go idle in the pool. */
 	for (i = 0; i < pcxt->nworkers_launched; ++i)
 	{
 		BgwHandleStatus status;
+		pid_t		pid;
+		bool		pooled = false;
 
 		if (pcxt->worker == NULL || pcxt->worker[i].bgwhandle == NULL)
 			continue;
 
-		status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
+		for (;;)
+		{
+			int			rc;
+
+			status = GetBackgroundWorkerPid(pcxt->worker[i].bgwhandle, &pid);
+			if (status == BGWH_STOPPED)
+				break;
+			if (status == BGWH_STARTED &&
+				ParallelWorkerPoolAdopt(pcxt->worker[i].bgwhandle, pid))
+			{
+				pooled = true;
+				break;
+			}
+
+			/*
+			 * The postmaster tells us when the worker exits, and the worker
+			 * sets our latch when it enters the pool.
+			 */
+			rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_POSTMASTER_DEATH, -1,
+						   WAIT_EVENT_BGWORKER_SHUTDOWN);
+			if (rc & WL_POSTMASTER_DEATH)
+			{
+				status = BGWH_POSTMASTER_DIED;
+				break;
+			}
+			ResetLatch(MyLatch);
+		}
 
 		/*
 		 * If the postmaster kicked the bucket, we have no chance of cleaning
@@ -898,12 +1055,137 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
 					(errcode(ERRCODE_ADMIN_SHUTDOWN),
 					 errmsg("postmaster exited during a parallel transaction")));
 
-		/* Release memory. */
-		pfree(pcxt->worker[i].bgwhandle);
+		/* Release memory, unless the pool has taken over the handle. */
+		if (!pooled)
+			pfree(pcxt->worker[i].bgwhandle);
 		pcxt->worker[i].bgwhandle = NULL;
 	}
 }
 
+/*
+ * Hand a parallel context to one of our idle pooled workers, if we have one.
+ * On success, *bgwhandle is set to the worker's handle.
+ */
+static bool
+ParallelWorkerPoolAssign(dsm_handle handle, int worker_number,
+						 BackgroundWorkerHandle **bgwhandle)
+{
+	while (ParallelPoolIdleWorkers != NIL)
+	{
+		ParallelPoolMember *member = linitial(ParallelPoolIdleWorkers);
+		ParallelPoolSlot *slot = &ParallelPool->slots[member->slotno];
+		PGPROC	   *proc = NULL;
+
+		ParallelPoolIdleWorkers = list_delete_first(ParallelPoolIdleWorkers);
+
+		SpinLockAcquire(&ParallelPool->mutex);
+		if (slot->state == PARALLEL_POOL_SLOT_IDLE &&
+			slot->leader_pid == MyProcPid &&
+			slot->worker_pid == member->pid)
+		{
+			slot->handle = handle;
+			slot->worker_number = worker_number;
+			slot->state = PARALLEL_POOL_SLOT_ASSIGNED;
+			proc = slot->worker_proc;
+		}
+		SpinLockRelease(&ParallelPool->mutex);
+
+		if (proc != NULL)
+		{
+			SetLatch(&proc->procLatch);
+			*bgwhandle = member->bgwhandle;
+			pfree(member);
+			return true;
+		}
+
+		/* The worker timed out and left; forget about it. */
+		pfree(member->bgwhandle);
+		pfree(member);
+	}
+
+	return false;
+}
+
+/*
+ * If the worker with the given handle and PID is idle in the pool, waiting
+ * for us, remember it for a later LaunchParallelWorkers and return true.
+ */
+static bool
+ParallelWorkerPoolAdopt(BackgroundWorkerHandle *bgwhandle, pid_t pid)
+{
+	ParallelPoolMember *member;
+	MemoryContext oldcontext;
+	int			slotno = -1;
+	int			i;
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (i = 0; i < ParallelPool->nslots; i++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[i];
+
+		if (slot->state == PARALLEL_POOL_SLOT_IDLE &&
+			slot->leader_pid == MyProcPid &&
+			slot->worker_pid == pid)
+		{
+			slotno = i;
+			break;
+		}
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+
+	if (slotno < 0)
+		return false;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	member = palloc(sizeof(ParallelPoolMember));
+	member->pid = pid;
+	member->slotno = slotno;
+	member->bgwhandle = bgwhandle;
+	ParallelPoolIdleWorkers = lappend(ParallelPoolIdleWorkers, member);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Our pooled workers must not wait for us after we exit. */
+	if (!ParallelPoolLeaderExitRegistered)
+	{
+		on_shmem_exit(ParallelWorkerPoolLeaderExit, (Datum) 0);
+		ParallelPoolLeaderExitRegistered = true;
+	}
+
+	return true;
+}
+
+/*
+ * Tell our idle pooled workers to exit, at leader exit.
+ */
+static void
+ParallelWorkerPoolLeaderExit(int code, Datum arg)
+{
+	PGPROC	  **procs;
+	int			nprocs = 0;
+	int			i;
+
+	procs = palloc(ParallelPool->nslots * sizeof(PGPROC *));
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (i = 0; i < ParallelPool->nslots; i++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[i];
+
+		if (slot->state == PARALLEL_POOL_SLOT_IDLE &&
+			slot->leader_pid == MyProcPid)
+		{
+			slot->state = PARALLEL_POOL_SLOT_SHUTDOWN;
+			procs[nprocs++] = slot->worker_proc;
+		}
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+
+	for (i = 0; i < nprocs; i++)
+		SetLatch(&procs[i]->procLatch);
+
+	pfree(procs);
+}
+
 /*
  * Destroy a parallel context.
  *
@@ -1250,6 +1532,38 @@ AtEOXact_Parallel(bool isCommit)
 void
 ParallelWorkerMain(Datum main_arg)
 {
+	dsm_handle	handle = DatumGetUInt32(main_arg);
+	int			worker_number;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Determine our parallel worker number for the first job. */
+	Assert(ParallelWorkerNumber == -1);
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/* Arrange to signal the leader if we exit. */
+	before_shmem_exit(ParallelWorkerShutdown, (Datum) 0);
+
+	/*
+	 * Do the work we were started for, and then maybe more for the same
+	 * leader if it hands us another parallel context while we're idle in the
+	 * pool.
+	 */
+	while (ParallelWorkerRunJob(handle, worker_number) &&
+		   ParallelWorkerAwaitJob(MyProc->lockGroupLeader, &handle,
+								  &worker_number))
+		;
+}
+
+/*
+ * Work for one parallel context.  Returns false if the leader has gone away.
+ */
+static bool
+ParallelWorkerRunJob(dsm_handle handle, int worker_number)
+{
+	MemoryContext jobcontext;
 	dsm_segment *seg;
 	shm_toc    *toc;
 	FixedParallelState *fps;
@@ -1278,29 +1592,25 @@ ParallelWorkerMain(Datum main_arg)
 	/* Set flag to indicate that we're initializing a parallel worker. */
 	InitializingParallelWorker = true;
 
-	/* Establish signal handlers. */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/* Determine and set our parallel worker number. */
-	Assert(ParallelWorkerNumber == -1);
-	memcpy(&ParallelWorkerNumber, MyBgworkerEntry->bgw_extra, sizeof(int));
+	/* Set our parallel worker number. */
+	ParallelWorkerNumber = worker_number;
 
 	/* Set up a memory context to work in, just for cleanliness. */
-	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
-												 "Parallel worker",
-												 ALLOCSET_DEFAULT_SIZES);
+	jobcontext = AllocSetContextCreate(TopMemoryContext,
+									   "Parallel worker",
+									   ALLOCSET_DEFAULT_SIZES);
+	CurrentMemoryContext = jobcontext;
 
 	/*
 	 * Attach to the dynamic shared memory segment for the parallel query, and
 	 * find its table of contents.
 	 *
 	 * Note: at this point, we have not created any ResourceOwner in this
-	 * process.  This will result in our DSM mapping surviving until process
-	 * exit, which is fine.  If there were a ResourceOwner, it would acquire
-	 * ownership of the mapping, but we have no need for that.
+	 * process.  This will result in our DSM mapping surviving until we detach
+	 * explicitly or exit, which is fine.  If there were a ResourceOwner, it
+	 * would acquire ownership of the mapping, but we have no need for that.
 	 */
-	seg = dsm_attach(DatumGetUInt32(main_arg));
+	seg = dsm_attach(handle);
 	if (seg == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1318,7 +1628,7 @@ ParallelWorkerMain(Datum main_arg)
 	/* Arrange to signal the leader if we exit. */
 	ParallelLeaderPid = fps->parallel_leader_pid;
 	ParallelLeaderBackendId = fps->parallel_leader_backend_id;
-	before_shmem_exit(ParallelWorkerShutdown, PointerGetDatum(seg));
+	ParallelWorkerSegment = seg;
 
 	/*
 	 * Now we can find and attach to the error queue provided for us.  That's
@@ -1359,11 +1669,17 @@ ParallelWorkerMain(Datum main_arg)
 	 * leader or against some process which in turn waits for a lock that
 	 * conflicts with the parallel group leader, causing an undetected
 	 * deadlock.  (If we can't join the lock group, the leader has gone away,
-	 * so just exit quietly.)
+	 * so just exit quietly.)  A pooled worker only ever works for the leader
+	 * whose group it has joined already.
 	 */
-	if (!BecomeLockGroupMember(fps->parallel_leader_pgproc,
-							   fps->parallel_leader_pid))
-		return;
+	if (MyProc->lockGroupLeader == NULL)
+	{
+		if (!BecomeLockGroupMember(fps->parallel_leader_pgproc,
+								   fps->parallel_leader_pid))
+			return false;
+	}
+	else
+		Assert(MyProc->lockGroupLeader == fps->parallel_leader_pgproc);
 
 	/*
 	 * Restore transaction and statement start-time timestamps.  This must
@@ -1383,16 +1699,21 @@ ParallelWorkerMain(Datum main_arg)
 
 	entrypt = LookupParallelWorkerFunction(library_name, function_name);
 
-	/* Restore database connection. */
-	BackgroundWorkerInitializeConnectionByOid(fps->database_id,
-											  fps->authenticated_user_id,
-											  0);
+	/* Restore database connection, unless this is a pooled worker's rerun. */
+	if (!OidIsValid(MyDatabaseId))
+	{
+		BackgroundWorkerInitializeConnectionByOid(fps->database_id,
+												  fps->authenticated_user_id,
+												  0);
 
-	/*
-	 * Set the client encoding to the database encoding, since that is what
-	 * the leader will expect.
-	 */
-	SetClientEncoding(GetDatabaseEncoding());
+		/*
+		 * Set the client encoding to the database encoding, since that is
+		 * what the leader will expect.
+		 */
+		SetClientEncoding(GetDatabaseEncoding());
+	}
+	else if (MyDatabaseId != fps->database_id)
+		elog(ERROR, "pooled parallel worker connected to the wrong database");
 
 	/*
 	 * Load libraries that were loaded by original backend.  We want to do
@@ -1508,6 +1829,112 @@ ParallelWorkerMain(Datum main_arg)
 
 	/* Report success. */
 	pq_putmessage('X', NULL, 0);
+
+	/*
+	 * Clean up, in case we stay around for another job.  Reindex state is
+	 * the only restored state that commit doesn't reset, and the query
+	 * string lives in the segment.
+	 */
+	ResetReindexState(0);
+	debug_query_string = NULL;
+
+	ParallelWorkerSegment = NULL;
+	MyFixedParallelState = NULL;
+	dsm_detach(seg);
+
+	MemoryContextSwitchTo(TopMemoryContext);
+	MemoryContextDelete(jobcontext);
+
+	return true;
+}
+
+/*
+ * Wait in the parallel worker pool for our leader to hand us another
+ * parallel context, for up to parallel_worker_idle_timeout.  Returns false
+ * if we should exit instead.
+ */
+static bool
+ParallelWorkerAwaitJob(PGPROC *leader, dsm_handle *handle, int *worker_number)
+{
+	ParallelPoolSlot *slot;
+	TimestampTz start;
+	int			timeout = parallel_worker_idle_timeout;
+	int			i;
+
+	if (timeout <= 0)
+		return false;
+
+	/* Find ourselves a slot in the pool, unless we have one already */
+	SpinLockAcquire(&ParallelPool->mutex);
+	if (MyParallelPoolSlot < 0)
+	{
+		for (i = 0; i < ParallelPool->nslots; i++)
+		{
+			if (ParallelPool->slots[i].state == PARALLEL_POOL_SLOT_FREE)
+			{
+				MyParallelPoolSlot = i;
+				break;
+			}
+		}
+	}
+	if (MyParallelPoolSlot < 0)
+	{
+		SpinLockRelease(&ParallelPool->mutex);
+		return false;
+	}
+	slot = &ParallelPool->slots[MyParallelPoolSlot];
+	slot->state = PARALLEL_POOL_SLOT_IDLE;
+	slot->leader_pid = ParallelLeaderPid;
+	slot->worker_pid = MyProcPid;
+	slot->worker_proc = MyProc;
+	SpinLockRelease(&ParallelPool->mutex);
+
+	/*
+	 * Let the leader know that we're done with its segment.  Its PGPROC stays
+	 * valid while we're a member of its lock group.
+	 */
+	SetLatch(&leader->procLatch);
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	start = GetCurrentTimestamp();
+	for (;;)
+	{
+		long		remaining;
+		bool		done = false;
+		bool		assigned = false;
+
+		remaining = timeout -
+			TimestampDifferenceMilliseconds(start, GetCurrentTimestamp());
+
+		SpinLockAcquire(&ParallelPool->mutex);
+		if (slot->state == PARALLEL_POOL_SLOT_ASSIGNED)
+		{
+			*handle = slot->handle;
+			*worker_number = slot->worker_number;
+			slot->state = PARALLEL_POOL_SLOT_BUSY;
+			done = assigned = true;
+		}
+		else if (slot->state == PARALLEL_POOL_SLOT_SHUTDOWN || remaining <= 0)
+		{
+			slot->state = PARALLEL_POOL_SLOT_FREE;
+			slot->leader_pid = 0;
+			slot->worker_pid = 0;
+			slot->worker_proc = NULL;
+			MyParallelPoolSlot = -1;
+			done = true;
+		}
+		SpinLockRelease(&ParallelPool->mutex);
+
+		if (done)
+			return assigned;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 remaining, WAIT_EVENT_PARALLEL_WORKER_IDLE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
 }
 
 /*
@@ -1530,7 +1957,7 @@ ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end)
  * Make sure the leader tries to read from our error queue one more time.
  * This guards against the case where we exit uncleanly without sending an
  * ErrorResponse to the leader, for example because some code calls proc_exit
- * directly.
+ * directly.  If we're idle in the pool instead, just leave it.
  *
  * Also explicitly detach from dsm segment so that subsystems using
  * on_dsm_detach() have a chance to send stats before the stats subsystem is
@@ -1545,11 +1972,30 @@ ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end)
 static void
 ParallelWorkerShutdown(int code, Datum arg)
 {
+	/* Leave the pool, if we're in it */
+	if (MyParallelPoolSlot >= 0)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[MyParallelPoolSlot];
+
+		SpinLockAcquire(&ParallelPool->mutex);
+		slot->state = PARALLEL_POOL_SLOT_FREE;
+		slot->leader_pid = 0;
+		slot->worker_pid = 0;
+		slot->worker_proc = NULL;
+		SpinLockRelease(&ParallelPool->mutex);
+		MyParallelPoolSlot = -1;
+	}
+
+	/* Nothing more to do if we're idle between jobs */
+	if (ParallelWorkerSegment == NULL)
+		return;
+
 	SendProcSignal(ParallelLeaderPid,
 				   PROCSIG_PARALLEL_MESSAGE,
 				   ParallelLeaderBackendId);
 
-	dsm_detach((dsm_segment *) DatumGetPointer(arg));
+	dsm_detach(ParallelWorkerSegment);
+	ParallelWorkerSegment = NULL;
 }
 
 /*
@@ -7,11 +7,15 @@
  * buffers.  Under ordinary circumstances we expect that write
  * traffic will occur mostly to the latest page (and to the just-prior
  * page, soon after a page transition).  Read traffic will probably touch
- * a larger span of pages, but in any case a fairly small number of page
- * buffers should be sufficient.  So, we just search the buffers using plain
- * linear search; there's no need for a hashtable or anything fancy.
- * The management algorithm is straight LRU except that we will never swap
- * out the latest page (since we know it's going to be hit again eventually).
+ * a larger span of pages, and some workloads (lots of subtransactions or
+ * multixacts, for example) benefit from caching a great many pages.  To keep
+ * lookups cheap regardless of the number of buffers, the buffers are
+ * organized as a set-associative cache: they are divided into banks of
+ * SLRU_BANK_SIZE slots, and each page can live only in the bank selected by
+ * its page number.  Looking up a page, or choosing a victim to replace,
+ * therefore only requires a linear search of one bank.  Within a bank the
+ * management algorithm is straight LRU except that we will never swap out
+ * the latest page (since we know it's going to be hit again eventually).
  *
  * We use a control LWLock to protect the shared data structures, plus
  * per-buffer LWLocks that synchronize I/O for each buffer.  The control lock
@@ -120,6 +124,23 @@ typedef struct SlruWriteAllData *SlruWriteAll;
 		} \
 	} while (0)
 
+/*
+ * Number of buffer slots actually allocated for a requested count: anything
+ * larger than one bank is rounded up to a whole number of banks.
+ */
+#define SlruAdjustNSlots(nslots) \
+	((nslots) <= SLRU_BANK_SIZE ? (nslots) : \
+	 TYPEALIGN(SLRU_BANK_SIZE, (nslots)))
+
+/*
+ * Return the first slot of the bank that pageno maps to.
+ */
+static inline int
+SlruBankStart(SlruShared shared, int pageno)
+{
+	return ((uint32) pageno % shared->num_banks) * shared->bank_size;
+}
+
 /* Saved info for SlruReportIOError */
 typedef enum
 {
@@ -157,6 +178,8 @@ SimpleLruShmemSize(int nslots, int nlsns)
 {
 	Size		sz;
 
+	nslots = SlruAdjustNSlots(nslots);
+
 	/* we assume nslots isn't so large as to risk overflow */
 	sz = MAXALIGN(sizeof(SlruSharedData));
 	sz += MAXALIGN(nslots * sizeof(char *));	/* page_buffer[] */
@@ -177,7 +200,8 @@ SimpleLruShmemSize(int nslots, int nlsns)
  *
  * ctl: address of local (unshared) control structure.
  * name: name of SLRU.  (This is user-visible, pick with care!)
- * nslots: number of page slots to use.
+ * nslots: number of page slots to use (rounded up to a multiple of
+ *		SLRU_BANK_SIZE when larger than that).
  * nlsns: number of LSN groups per page (set to zero if not relevant).
  * ctllock: LWLock to use to control access to the shared control structure.
  * subdir: PGDATA-relative subdirectory that will contain the files.
@@ -208,7 +232,10 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 
 		shared->ControlLock = ctllock;
 
+		nslots = SlruAdjustNSlots(nslots);
 		shared->num_slots = nslots;
+		shared->bank_size = Min(nslots, SLRU_BANK_SIZE);
+		shared->num_banks = nslots / shared->bank_size;
 		shared->lsn_groups_per_page = nlsns;
 
 		shared->cur_lru_count = 0;
@@ -495,13 +522,15 @@ int
 SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankstart = SlruBankStart(shared, pageno);
+	int			bankend = bankstart + shared->bank_size;
 	int			slotno;
 
 	/* Try to find the page while holding only shared lock */
 	LWLockAcquire(shared->ControlLock, LW_SHARED);
 
 	/* See if page is already in a buffer */
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (slotno = bankstart; slotno < bankend; slotno++)
 	{
 		if (shared->page_number[slotno] == pageno &&
 			shared->page_status[slotno] != SLRU_PAGE_EMPTY &&
@@ -1000,7 +1029,8 @@ SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid)
 }
 
 /*
- * Select the slot to re-use when we need a free slot.
+ * Select the slot to re-use when we need a free slot.  Only the bank that
+ * pageno maps to is considered.
  *
  * The target page number is passed because we need to consider the
  * possibility that some other process reads in the target page while
@@ -1016,6 +1046,8 @@ static int
 SlruSelectLRUPage(SlruCtl ctl, int pageno)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankstart = SlruBankStart(shared, pageno);
+	int			bankend = bankstart + shared->bank_size;
 
 	/* Outer loop handles restart after I/O */
 	for (;;)
@@ -1025,12 +1057,12 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		int			bestvalidslot = 0;	/* keep compiler quiet */
 		int			best_valid_delta = -1;
 		int			best_valid_page_number = 0; /* keep compiler quiet */
-		int			bestinvalidslot = 0;	/* keep compiler quiet */
+		int			bestinvalidslot = bankstart;
 		int			best_invalid_delta = -1;
 		int			best_invalid_page_number = 0;	/* keep compiler quiet */
 
 		/* See if page already has a buffer assigned */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			if (shared->page_number[slotno] == pageno &&
 				shared->page_status[slotno] != SLRU_PAGE_EMPTY)
@@ -1038,8 +1070,8 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		}
 
 		/*
-		 * If we find any EMPTY slot, just select that one. Else choose a
-		 * victim page to replace.  We normally take the least recently used
+		 * If we find any EMPTY slot in the page's bank, just select that one.
+		 * Else choose a victim page in the bank to replace.  We normally take the least recently used
 		 * valid page, but we will never take the slot containing
 		 * latest_page_number, even if it appears least recently used.  We
 		 * will select a slot that is already I/O busy only if there is no
@@ -1065,7 +1097,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		 * multiple pages with the same lru_count.
 		 */
 		cur_count = (shared->cur_lru_count)++;
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			int			this_delta;
 			int			this_page_number;
@@ -1115,7 +1147,8 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		}
 
 		/*
-		 * If all pages (except possibly the latest one) are I/O busy, we'll
+		 * If all pages of the bank (except possibly the latest one) are I/O
+		 * busy, we'll
 		 * have to wait for an I/O to complete and then retry.  In that
 		 * unhappy case, we choose to wait for the I/O on the least recently
 		 * used slot, on the assumption that it was likely initiated first of
@@ -31,7 +31,9 @@
 #include "access/slru.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
+#include "miscadmin.h"
 #include "pg_trace.h"
+#include "storage/proc.h"
 #include "utils/snapmgr.h"
 
 
@@ -54,6 +56,34 @@
 #define TransactionIdToPage(xid) ((xid) / (TransactionId) SUBTRANS_XACTS_PER_PAGE)
 #define TransactionIdToEntry(xid) ((xid) % (TransactionId) SUBTRANS_XACTS_PER_PAGE)
 
+/*
+ * Backend-local cache of SubTransGetTopmostTransaction() results.
+ *
+ * Once a snapshot has overflowed its subxid cache, XidInMVCCSnapshot() looks
+ * up the topmost parent of each xid it is asked about, and usually asks
+ * about the same few subtransactions over and over, for every tuple they
+ * wrote.  Remember the answers, so that each needs to be looked up in
+ * pg_subtrans only once.
+ *
+ * An answer stays right for as long as the xid can't be recycled, which is
+ * at least until the end of our top-level transaction (wraparound can't get
+ * past TransactionXmin).  Entries are therefore tagged with the local
+ * transaction id they were computed in, which invalidates them all at no
+ * cost at transaction end.  TransactionXmin only ever advances within a
+ * transaction, so an intermediate parent returned because it preceded
+ * TransactionXmin remains an acceptable answer too.
+ */
+#define SUBTRANS_CACHE_SIZE		1024
+
+typedef struct SubTransCacheEntry
+{
+	LocalTransactionId lxid;	/* transaction the entry is valid in */
+	TransactionId xid;
+	TransactionId topxid;
+} SubTransCacheEntry;
+
+static SubTransCacheEntry SubTransCache[SUBTRANS_CACHE_SIZE];
+
 
 /*
  * Link to shared-memory data structures for SUBTRANS control
@@ -151,10 +181,20 @@ SubTransGetTopmostTransaction(TransactionId xid)
 {
 	TransactionId parentXid = xid,
 				previousXid = xid;
+	LocalTransactionId lxid;
+	SubTransCacheEntry *entry = NULL;
 
 	/* Can't ask about stuff that might not be around anymore */
 	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
 
+	lxid = MyProc ? MyProc->lxid : InvalidLocalTransactionId;
+	if (LocalTransactionIdIsValid(lxid))
+	{
+		entry = &SubTransCache[xid % SUBTRANS_CACHE_SIZE];
+		if (entry->lxid == lxid && entry->xid == xid)
+			return entry->topxid;
+	}
+
 	while (TransactionIdIsValid(parentXid))
 	{
 		previousXid = parentXid;
@@ -174,6 +214,13 @@ SubTransGetTopmostTransaction(TransactionId xid)
 
 	Assert(TransactionIdIsValid(previousXid));
 
+	if (entry)
+	{
+		entry->lxid = lxid;
+		entry->xid = xid;
+		entry->topxid = previousXid;
+	}
+
 	return previousXid;
 }
 
@@ -184,14 +231,14 @@ SubTransGetTopmostTransaction(TransactionId xid)
 Size
 SUBTRANSShmemSize(void)
 {
-	return SimpleLruShmemSize(NUM_SUBTRANS_BUFFERS, 0);
+	return SimpleLruShmemSize(subtransaction_buffers, 0);
 }
 
 void
 SUBTRANSShmemInit(void)
 {
 	SubTransCtl->PagePrecedes = SubTransPagePrecedes;
-	SimpleLruInit(SubTransCtl, "Subtrans", NUM_SUBTRANS_BUFFERS, 0,
+	SimpleLruInit(SubTransCtl, "Subtrans", subtransaction_buffers, 0,
 				  SubtransSLRULock, "pg_subtrans",
 				  LWTRANCHE_SUBTRANS_BUFFER, SYNC_HANDLER_NONE);
 	SlruPagePrecedesUnitTests(SubTransCtl, SUBTRANS_XACTS_PER_PAGE);
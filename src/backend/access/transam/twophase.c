@@ -77,6 +77,7 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/htup_details.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
@@ -1540,6 +1541,10 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 									   hdr->nabortrels, abortrels,
 									   gid);
 
+	/* Assign a commit sequence number before becoming visible as committed */
+	if (isCommit && csn_snapshots)
+		CSNLogSetCommitSeqNo(xid, hdr->nsubxacts, children);
+
 	ProcArrayRemove(proc, latestXid);
 
 	/*
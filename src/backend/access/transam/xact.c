@@ -21,6 +21,7 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/multixact.h"
 #include "access/parallel.h"
 #include "access/subtrans.h"
@@ -837,6 +838,8 @@ SetCurrentStatementStartTimestamp(void)
 		stmtStartTimestamp = GetCurrentTimestamp();
 	else
 		Assert(stmtStartTimestamp != 0);
+
+	SetCatCacheClock(stmtStartTimestamp);
 }
 
 /*
@@ -2205,6 +2208,21 @@ CommitTransaction(void)
 
 	TRACE_POSTGRESQL_TRANSACTION_COMMIT(MyProc->lxid);
 
+	/*
+	 * With CSN snapshots, our commit becomes visible to new snapshots once we
+	 * have been assigned a commit sequence number, so that too has to happen
+	 * after RecordTransactionCommit.
+	 */
+	if (csn_snapshots && !is_parallel_worker &&
+		TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		TransactionId *children;
+		int			nchildren;
+
+		nchildren = xactGetCommittedChildren(&children);
+		CSNLogSetCommitSeqNo(GetTopTransactionIdIfAny(), nchildren, children);
+	}
+
 	/*
 	 * Let others know about no transaction in progress by me. Note that this
 	 * must be done _before_ releasing locks we hold and _after_
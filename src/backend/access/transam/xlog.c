@@ -24,6 +24,7 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/heaptoast.h"
 #include "access/multixact.h"
 #include "access/rewriteheap.h"
@@ -35,6 +36,8 @@
 #include "access/xlog_internal.h"
 #include "access/xlogarchive.h"
 #include "access/xloginsert.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -43,13 +46,16 @@
 #include "commands/progress.h"
 #include "commands/tablespace.h"
 #include "common/controldata_utils.h"
+#include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/pgarch.h"
 #include "postmaster/startup.h"
 #include "postmaster/walwriter.h"
 #include "replication/basebackup.h"
@@ -60,6 +66,7 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/large_object.h"
@@ -109,6 +116,10 @@ int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
 int			CommitDelay = 0;	/* precommit delay in microseconds */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
+bool		AdaptiveCommitDelay = false;	/* size the delay from observations */
+
+/* weight of the newest observation in adaptive_commit_delay's averages */
+#define ADAPTIVE_COMMIT_DELAY_SMOOTHING 16.0
 int			wal_retrieve_retry_interval = 5000;
 int			max_slot_wal_keep_size_mb = -1;
 bool		track_wal_io_timing = false;
@@ -120,11 +131,12 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead
+ * to flushing the WAL, which needs to iterate all the locks.  -1 means to
+ * choose a value based on max_connections, see XLOGChooseNumInsertLocks.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			wal_insert_locks = -1;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -476,7 +488,7 @@ typedef struct XLogwrtResult
 typedef struct
 {
 	LWLock		lock;
-	XLogRecPtr	insertingAt;
+	pg_atomic_uint64 insertingAt;
 	XLogRecPtr	lastImportantAt;
 } WALInsertLock;
 
@@ -493,6 +505,25 @@ typedef union WALInsertLockPadded
 	char		pad[PG_CACHE_LINE_SIZE];
 } WALInsertLockPadded;
 
+/*
+ * Reserving WAL space doesn't take a lock: an inserter advances CurrBytePos
+ * with an atomic fetch-and-add.  That alone doesn't tell it where the
+ * previous record started, which it needs for xl_prev, so every reservation
+ * also leaves a link from its end position to its start position in a small
+ * shared hash table.  The next inserter, whose record starts at that end
+ * position, looks the link up and removes it.  Links only live between an
+ * inserter's reservation and its successor's, so the table needs only a few
+ * entries per WAL insertion lock; see XLogPrevLinkPublish.
+ *
+ * endpos is 0 for a free slot.  prevpos is stored plus one, so that 0 means
+ * the link is being set up.
+ */
+typedef struct XLogPrevLink
+{
+	pg_atomic_uint64 endpos;
+	pg_atomic_uint64 prevpos;
+} XLogPrevLink;
+
 /*
  * State of an exclusive backup, necessary to control concurrent activities
  * across sessions when working on exclusive backups.
@@ -527,24 +558,21 @@ static SessionBackupState sessionBackupState = SESSION_BACKUP_NONE;
  */
 typedef struct XLogCtlInsert
 {
-	slock_t		insertpos_lck;	/* protects CurrBytePos and PrevBytePos */
-
 	/*
 	 * CurrBytePos is the end of reserved WAL. The next record will be
-	 * inserted at that position. PrevBytePos is the start position of the
-	 * previously inserted (or rather, reserved) record - it is copied to the
-	 * prev-link of the next record. These are stored as "usable byte
-	 * positions" rather than XLogRecPtrs (see XLogBytePosToRecPtr()).
+	 * inserted at that position. It is stored as a "usable byte position"
+	 * rather than an XLogRecPtr (see XLogBytePosToRecPtr()).  The start
+	 * position of the previously reserved record, for the prev-link of the
+	 * next record, is found in PrevLinks (see XLogPrevLink).
 	 */
-	uint64		CurrBytePos;
-	uint64		PrevBytePos;
+	pg_atomic_uint64 CurrBytePos;
 
 	/*
-	 * Make sure the above heavily-contended spinlock and byte positions are
-	 * on their own cache line. In particular, the RedoRecPtr and full page
-	 * write variables below should be on a different cache line. They are
-	 * read on every WAL insertion, but updated rarely, and we don't want
-	 * those reads to steal the cache line containing Curr/PrevBytePos.
+	 * Make sure the above heavily-contended byte position is on its own
+	 * cache line. In particular, the RedoRecPtr and full page write variables
+	 * below should be on a different cache line. They are read on every WAL
+	 * insertion, but updated rarely, and we don't want those reads to steal
+	 * the cache line containing CurrBytePos.
 	 */
 	char		pad[PG_CACHE_LINE_SIZE];
 
@@ -576,9 +604,10 @@ typedef struct XLogCtlInsert
 	XLogRecPtr	lastBackupStart;
 
 	/*
-	 * WAL insertion locks.
+	 * WAL insertion locks, and the prev-link table (NumPrevLinks entries).
 	 */
 	WALInsertLockPadded *WALInsertLocks;
+	XLogPrevLink *PrevLinks;
 } XLogCtlInsert;
 
 /*
@@ -676,6 +705,19 @@ typedef struct XLogCtlData
 	 */
 	bool		WalWriterSleeping;
 
+	/*
+	 * Observations for adaptive_commit_delay.  flushRequests counts
+	 * XLogFlush() calls that had to wait for a flush; the rest is protected
+	 * by WALWriteLock and maintained by whoever does the flushing.
+	 * commitArrivalUsec and walFlushUsec are moving averages of the time
+	 * between flush requests and of the time a flush takes.
+	 */
+	pg_atomic_uint64 flushRequests;
+	uint64		lastFlushRequests;
+	instr_time	lastFlushTime;
+	double		commitArrivalUsec;
+	double		walFlushUsec;
+
 	/*
 	 * recoveryWakeupLatch is used to wake up the startup process to continue
 	 * WAL replay, if it is waiting for WAL to arrive or failover trigger file
@@ -741,6 +783,10 @@ static XLogCtlData *XLogCtl = NULL;
 /* a private copy of XLogCtl->Insert.WALInsertLocks, for convenience */
 static WALInsertLockPadded *WALInsertLocks = NULL;
 
+/* likewise for XLogCtl->Insert.PrevLinks, and its size minus one */
+static XLogPrevLink *PrevLinks = NULL;
+static uint32 PrevLinksMask = 0;
+
 /*
  * We maintain an image of pg_control in shared memory.
  */
@@ -915,6 +961,7 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
+static int	XLogAdaptiveCommitDelay(void);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 								   bool find_free, XLogSegNo max_segno);
@@ -972,6 +1019,8 @@ static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 									  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
+static void XLogPrevLinkPublish(uint64 endbytepos, uint64 startbytepos);
+static uint64 XLogPrevLinkConsume(uint64 startbytepos);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
 static char *GetXLogBuffer(XLogRecPtr ptr);
 static XLogRecPtr XLogBytePosToRecPtr(uint64 bytepos);
@@ -1041,8 +1090,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * record to the shared WAL buffer cache is a two-step process:
 	 *
 	 * 1. Reserve the right amount of space from the WAL. The current head of
-	 *	  reserved space is kept in Insert->CurrBytePos, and is protected by
-	 *	  insertpos_lck.
+	 *	  reserved space is kept in Insert->CurrBytePos, and is advanced
+	 *	  atomically.
 	 *
 	 * 2. Copy the record to the reserved WAL space. This involves finding the
 	 *	  correct WAL buffer containing the reserved space, and copying the
@@ -1051,8 +1100,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * To keep track of which insertions are still in-progress, each concurrent
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
-	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * has progressed. The number of insertion locks is fixed at startup,
+	 * determined by wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1287,9 +1336,9 @@ XLogInsertRecord(XLogRecData *rdata,
  * used to set the xl_prev of this record.
  *
  * This is the performance critical part of XLogInsert that must be serialized
- * across backends. The rest can happen mostly in parallel. Try to keep this
- * section as short as possible, insertpos_lck can be heavily contended on a
- * busy system.
+ * across backends. The rest can happen mostly in parallel. It's done with a
+ * single atomic fetch-and-add on CurrBytePos, which can be heavily contended
+ * on a busy system, so keep anything else out of it.
  *
  * NB: The space calculation here must match the code in CopyXLogRecordToWAL,
  * where we actually copy the record to the reserved space.
@@ -1309,24 +1358,22 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(size > SizeOfXLogRecord);
 
 	/*
-	 * The duration the spinlock needs to be held is minimized by minimizing
-	 * the calculations that have to be done while holding the lock. The
-	 * current tip of reserved WAL is kept in CurrBytePos, as a byte position
-	 * that only counts "usable" bytes in WAL, that is, it excludes all WAL
-	 * page headers. The mapping between "usable" byte positions and physical
-	 * positions (XLogRecPtrs) can be done outside the locked region, and
-	 * because the usable byte position doesn't include any headers, reserving
-	 * X bytes from WAL is almost as simple as "CurrBytePos += X".
+	 * The current tip of reserved WAL is kept in CurrBytePos, as a byte
+	 * position that only counts "usable" bytes in WAL, that is, it excludes
+	 * all WAL page headers. The mapping between "usable" byte positions and
+	 * physical positions (XLogRecPtrs) can be done afterwards, and because
+	 * the usable byte position doesn't include any headers, reserving X bytes
+	 * from WAL is exactly "CurrBytePos += X".
 	 */
-	SpinLockAcquire(&Insert->insertpos_lck);
-
-	startbytepos = Insert->CurrBytePos;
+	startbytepos = pg_atomic_fetch_add_u64(&Insert->CurrBytePos, size);
 	endbytepos = startbytepos + size;
-	prevbytepos = Insert->PrevBytePos;
-	Insert->CurrBytePos = endbytepos;
-	Insert->PrevBytePos = startbytepos;
 
-	SpinLockRelease(&Insert->insertpos_lck);
+	/*
+	 * Leave the way back to our start for the next inserter first, as it may
+	 * already be waiting for it, and then find our own predecessor.
+	 */
+	XLogPrevLinkPublish(endbytepos, startbytepos);
+	prevbytepos = XLogPrevLinkConsume(startbytepos);
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -1341,6 +1388,94 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(XLogRecPtrToBytePos(*PrevPtr) == prevbytepos);
 }
 
+/*
+ * Record that the WAL record reserved up to endbytepos starts at
+ * startbytepos, for the inserter of the following record.
+ *
+ * The table has at least four slots per WAL insertion lock.  Every inserter
+ * holds one of the locks while it publishes a link and consumes its
+ * predecessor's, so at most wal_insert_locks + 1 links exist at any time, and
+ * we're sure to find a free slot without wrapping around more than once or
+ * twice.
+ */
+static void
+XLogPrevLinkPublish(uint64 endbytepos, uint64 startbytepos)
+{
+	uint32		slot;
+
+	Assert(endbytepos > startbytepos);
+
+	slot = murmurhash32((uint32) (endbytepos ^ (endbytepos >> 32))) &
+		PrevLinksMask;
+	for (;;)
+	{
+		XLogPrevLink *link = &PrevLinks[slot];
+		uint64		expected = 0;
+
+		if (pg_atomic_read_u64(&link->endpos) == 0 &&
+			pg_atomic_compare_exchange_u64(&link->endpos, &expected,
+										   endbytepos))
+		{
+			/* the slot is ours; the CAS was a full barrier */
+			pg_atomic_write_u64(&link->prevpos, startbytepos + 1);
+			return;
+		}
+		slot = (slot + 1) & PrevLinksMask;
+	}
+}
+
+/*
+ * Find and remove the link left by the inserter of the record that ends at
+ * startbytepos, and return the start position of that record.
+ *
+ * The previous inserter reserved its space before us, but it might not have
+ * published the link yet.  It does that right after reserving, without
+ * waiting for anything, so we just spin until it appears.
+ */
+static uint64
+XLogPrevLinkConsume(uint64 startbytepos)
+{
+	SpinDelayStatus delayStatus;
+	uint32		start;
+	uint32		slot;
+
+	start = murmurhash32((uint32) (startbytepos ^ (startbytepos >> 32))) &
+		PrevLinksMask;
+	slot = start;
+
+	init_local_spin_delay(&delayStatus);
+	for (;;)
+	{
+		XLogPrevLink *link = &PrevLinks[slot];
+
+		if (pg_atomic_read_u64(&link->endpos) == startbytepos)
+		{
+			uint64		prevpos;
+
+			pg_read_barrier();
+			prevpos = pg_atomic_read_u64(&link->prevpos);
+			if (prevpos != 0)
+			{
+				/* clear prevpos before we allow the slot to be reused */
+				pg_atomic_write_u64(&link->prevpos, 0);
+				pg_write_barrier();
+				pg_atomic_write_u64(&link->endpos, 0);
+				finish_spin_delay(&delayStatus);
+
+				return prevpos - 1;
+			}
+
+			/* found it, but it's being set up */
+			perform_spin_delay(&delayStatus);
+			continue;
+		}
+
+		slot = (slot + 1) & PrevLinksMask;
+		if (slot == start)
+			perform_spin_delay(&delayStatus);
+	}
+}
+
 /*
  * Like ReserveXLogInsertLocation(), but for an xlog-switch record.
  *
@@ -1362,25 +1497,21 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
 	uint32		segleft;
 
 	/*
-	 * These calculations are a bit heavy-weight to be done while holding a
-	 * spinlock, but since we're holding all the WAL insertion locks, there
-	 * are no other inserters competing for it. GetXLogInsertRecPtr() does
-	 * compete for it, but that's not called very frequently.
+	 * Since we're holding all the WAL insertion locks, there are no other
+	 * inserters competing for CurrBytePos, and we can read and then set it.
 	 */
-	SpinLockAcquire(&Insert->insertpos_lck);
+	Assert(holdingAllLocks);
 
-	startbytepos = Insert->CurrBytePos;
+	startbytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	ptr = XLogBytePosToEndRecPtr(startbytepos);
 	if (XLogSegmentOffset(ptr, wal_segment_size) == 0)
 	{
-		SpinLockRelease(&Insert->insertpos_lck);
 		*EndPos = *StartPos = ptr;
 		return false;
 	}
 
 	endbytepos = startbytepos + size;
-	prevbytepos = Insert->PrevBytePos;
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -1392,10 +1523,10 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
 		*EndPos += segleft;
 		endbytepos = XLogRecPtrToBytePos(*EndPos);
 	}
-	Insert->CurrBytePos = endbytepos;
-	Insert->PrevBytePos = startbytepos;
+	pg_atomic_write_u64(&Insert->CurrBytePos, endbytepos);
 
-	SpinLockRelease(&Insert->insertpos_lck);
+	XLogPrevLinkPublish(endbytepos, startbytepos);
+	prevbytepos = XLogPrevLinkConsume(startbytepos);
 
 	*PrevPtr = XLogBytePosToRecPtr(prevbytepos);
 
@@ -1682,7 +1813,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % wal_insert_locks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1700,7 +1831,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % wal_insert_locks;
 	}
 }
 
@@ -1718,7 +1849,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < wal_insert_locks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1744,7 +1875,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < wal_insert_locks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1772,8 +1903,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[wal_insert_locks - 1].l.lock,
+						&WALInsertLocks[wal_insert_locks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1808,10 +1939,13 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	if (MyProc == NULL)
 		elog(PANIC, "cannot wait without a PGPROC structure");
 
-	/* Read the current insert position */
-	SpinLockAcquire(&Insert->insertpos_lck);
-	bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	/*
+	 * Read the current insert position.  The barrier makes sure that we see
+	 * the insertion locks of everyone who reserved space before that, as the
+	 * lock is taken before reserving.
+	 */
+	bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
+	pg_read_barrier();
 	reservedUpto = XLogBytePosToEndRecPtr(bytepos);
 
 	/*
@@ -1840,7 +1974,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -2001,6 +2135,63 @@ GetXLogBuffer(XLogRecPtr ptr)
 	return cachedPos + ptr % XLOG_BLCKSZ;
 }
 
+/*
+ * Read WAL that is still present in the WAL buffers.
+ *
+ * Copies up to "count" bytes of WAL starting at "startptr" on timeline "tli"
+ * into "buf", stopping at the first page that is no longer in the buffers.
+ * Returns the number of bytes copied, which is 0 if the WAL must be read from
+ * the files instead.  The caller must make sure the requested WAL has been
+ * written out already, so that no one is still inserting into it.
+ *
+ * This lets walsenders send WAL that was written just now without reading it
+ * back from the filesystem.  No lock is taken: AdvanceXLInsertBuffer()
+ * invalidates the xlblocks entry of a buffer before reinitializing it, so
+ * finding the same entry before and after the copy means the page we copied
+ * was not replaced meanwhile.
+ */
+Size
+XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count,
+					TimeLineID tli)
+{
+#ifdef PG_HAVE_8BYTE_SINGLE_COPY_ATOMICITY
+	XLogRecPtr	ptr = startptr;
+	Size		nbytes = count;
+	char	   *dst = buf;
+
+	/* Only the current timeline of a primary is in the buffers */
+	if (RecoveryInProgress() || tli != XLogCtl->ThisTimeLineID)
+		return 0;
+
+	while (nbytes > 0)
+	{
+		int			idx = XLogRecPtrToBufIdx(ptr);
+		Size		offset = ptr % XLOG_BLCKSZ;
+		Size		n = Min(nbytes, XLOG_BLCKSZ - offset);
+		XLogRecPtr	expectedEndPtr = ptr - offset + XLOG_BLCKSZ;
+
+		if (*((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]) != expectedEndPtr)
+			break;
+		pg_read_barrier();
+
+		memcpy(dst, XLogCtl->pages + idx * (Size) XLOG_BLCKSZ + offset, n);
+
+		pg_read_barrier();
+		if (*((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]) != expectedEndPtr)
+			break;
+
+		dst += n;
+		ptr += n;
+		nbytes -= n;
+	}
+
+	return count - nbytes;
+#else
+	/* xlblocks can't be read reliably without the lock */
+	return 0;
+#endif
+}
+
 /*
  * Converts a "usable byte position" to XLogRecPtr. A usable byte position
  * is the position starting from the beginning of WAL, excluding all WAL
@@ -2229,6 +2420,13 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 
 		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
+		/*
+		 * Mark the buffer as being replaced before touching it, so that
+		 * XLogReadFromBuffers() can't take the new contents for the old page.
+		 */
+		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = InvalidXLogRecPtr;
+		pg_write_barrier();
+
 		/*
 		 * Be sure to re-zero the buffer so that bytes beyond what we've
 		 * written will look like zeroes and not valid XLOG records...
@@ -2816,9 +3014,12 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	 * process as it should not update its own reference of minRecoveryPoint
 	 * until it has finished crash recovery to make sure that all WAL
 	 * available is replayed in this case.  This also saves from extra locks
-	 * taken on the control file from the startup process.
+	 * taken on the control file from the startup process.  Parallel redo
+	 * workers also run with InRecovery set, but they must advance
+	 * minRecoveryPoint like any other process flushing buffers.
 	 */
-	if (XLogRecPtrIsInvalid(minRecoveryPoint) && InRecovery)
+	if (XLogRecPtrIsInvalid(minRecoveryPoint) && InRecovery &&
+		!IsBackgroundWorker)
 	{
 		updateMinRecoveryPoint = false;
 		return;
@@ -2928,6 +3129,9 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
+	if (AdaptiveCommitDelay)
+		pg_atomic_fetch_add_u64(&XLogCtl->flushRequests, 1);
+
 	/*
 	 * Now wait until we get the write lock, or someone else does the flush
 	 * for us.
@@ -2935,6 +3139,7 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		int			delay;
 
 		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&XLogCtl->info_lck);
@@ -2987,10 +3192,15 @@ XLogFlush(XLogRecPtr record)
 		 * We do not sleep if enableFsync is not turned on, nor if there are
 		 * fewer than CommitSiblings other backends with active transactions.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
+		if (AdaptiveCommitDelay)
+			delay = XLogAdaptiveCommitDelay();
+		else
+			delay = CommitDelay;
+
+		if (delay > 0 && enableFsync &&
 			MinimumActiveBackends(CommitSiblings))
 		{
-			pg_usleep(CommitDelay);
+			pg_usleep(delay);
 
 			/*
 			 * Re-check how far we can now flush the WAL. It's generally not
@@ -3009,7 +3219,22 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
-		XLogWrite(WriteRqst, false);
+		if (AdaptiveCommitDelay)
+		{
+			instr_time	start;
+			instr_time	duration;
+
+			INSTR_TIME_SET_CURRENT(start);
+			XLogWrite(WriteRqst, false);
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+
+			XLogCtl->walFlushUsec +=
+				(INSTR_TIME_GET_MICROSEC(duration) - XLogCtl->walFlushUsec) /
+				ADAPTIVE_COMMIT_DELAY_SMOOTHING;
+		}
+		else
+			XLogWrite(WriteRqst, false);
 
 		LWLockRelease(WALWriteLock);
 		/* done */
@@ -3049,6 +3274,57 @@ XLogFlush(XLogRecPtr record)
 			 LSN_FORMAT_ARGS(LogwrtResult.Flush));
 }
 
+/*
+ * Decide how long to wait before flushing WAL, with adaptive_commit_delay.
+ *
+ * Waiting lets more committers join the group whose commit records the next
+ * flush makes durable.  That's only worth it if they arrive faster than the
+ * flushes complete.  We wait for about CommitSiblings more of them, but no
+ * longer than half of a flush: by then, it's cheaper to start the flush and
+ * let later arrivals form the next group.  commit_delay, if set, caps the
+ * delay.
+ *
+ * Must be called with WALWriteLock held.
+ */
+static int
+XLogAdaptiveCommitDelay(void)
+{
+	uint64		requests;
+	instr_time	now;
+	instr_time	elapsed;
+	double		delay;
+
+	requests = pg_atomic_read_u64(&XLogCtl->flushRequests);
+	INSTR_TIME_SET_CURRENT(now);
+
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->lastFlushTime) &&
+		requests > XLogCtl->lastFlushRequests)
+	{
+		double		gap;
+
+		elapsed = now;
+		INSTR_TIME_SUBTRACT(elapsed, XLogCtl->lastFlushTime);
+		gap = INSTR_TIME_GET_MICROSEC(elapsed) /
+			(double) (requests - XLogCtl->lastFlushRequests);
+		XLogCtl->commitArrivalUsec +=
+			(gap - XLogCtl->commitArrivalUsec) /
+			ADAPTIVE_COMMIT_DELAY_SMOOTHING;
+	}
+	XLogCtl->lastFlushRequests = requests;
+	XLogCtl->lastFlushTime = now;
+
+	if (XLogCtl->commitArrivalUsec <= 0 ||
+		XLogCtl->commitArrivalUsec >= XLogCtl->walFlushUsec)
+		return 0;
+
+	delay = Min(XLogCtl->commitArrivalUsec * Max(CommitSiblings, 1),
+				XLogCtl->walFlushUsec / 2);
+	if (CommitDelay > 0)
+		delay = Min(delay, CommitDelay);
+
+	return (int) delay;
+}
+
 /*
  * Write & flush xlog, but without specifying exactly where to.
  *
@@ -3223,7 +3499,8 @@ XLogNeedsFlush(XLogRecPtr record)
 		 * which cannot update its local copy of minRecoveryPoint as long as
 		 * it has not replayed all WAL available when doing crash recovery.
 		 */
-		if (XLogRecPtrIsInvalid(minRecoveryPoint) && InRecovery)
+		if (XLogRecPtrIsInvalid(minRecoveryPoint) && InRecovery &&
+			!IsBackgroundWorker)
 			updateMinRecoveryPoint = false;
 
 		/* Quick exit if already known to be updated or cannot be updated */
@@ -5068,6 +5345,38 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * Auto-tune the number of WAL insertion locks.
+ *
+ * Inserters take turns on the locks, so there's no point in having many more
+ * of them than backends that can insert concurrently.  The default is one lock
+ * per 16 backends, but no fewer than 8 (the fixed number used before this was
+ * made configurable) and no more than 128, beyond which the cost of scanning
+ * them all when flushing WAL starts to outweigh the gain.
+ *
+ * This should not be called until MaxBackends has received its final value.
+ */
+static int
+XLOGChooseNumInsertLocks(void)
+{
+	return Min(Max(MaxBackends / 16, 8), 128);
+}
+
+/*
+ * GUC check_hook for wal_insert_locks
+ */
+bool
+check_wal_insert_locks(int *newval, void **extra, GucSource source)
+{
+	/* -1 indicates a request for auto-tune, resolved in XLOGShmemSize */
+	if (*newval == 0)
+	{
+		GUC_check_errdetail("wal_insert_locks must be -1 or at least 1.");
+		return false;
+	}
+	return true;
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -5146,11 +5455,25 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* Likewise for wal_insert_locks, which depends on MaxBackends */
+	if (wal_insert_locks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", XLOGChooseNumInsertLocks());
+		SetConfigOption("wal_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_OVERRIDE);
+	}
+	Assert(wal_insert_locks > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), wal_insert_locks + 1));
+	/* prev-link table */
+	size = add_size(size, mul_size(sizeof(XLogPrevLink),
+								   pg_nextpower2_32(4 * wal_insert_locks)));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -5205,8 +5528,10 @@ XLOGShmemInit(void)
 		/* both should be present or neither */
 		Assert(foundCFile && foundXLog);
 
-		/* Initialize local copy of WALInsertLocks */
+		/* Initialize local copy of WALInsertLocks and PrevLinks */
 		WALInsertLocks = XLogCtl->Insert.WALInsertLocks;
+		PrevLinks = XLogCtl->Insert.PrevLinks;
+		PrevLinksMask = pg_nextpower2_32(4 * wal_insert_locks) - 1;
 
 		if (localControlFile)
 			pfree(localControlFile);
@@ -5240,15 +5565,26 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * wal_insert_locks;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
-		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
+		pg_atomic_init_u64(&WALInsertLocks[i].l.insertingAt, InvalidXLogRecPtr);
 		WALInsertLocks[i].l.lastImportantAt = InvalidXLogRecPtr;
 	}
 
+	/* The prev-link table, all slots free */
+	PrevLinksMask = pg_nextpower2_32(4 * wal_insert_locks) - 1;
+	PrevLinks = XLogCtl->Insert.PrevLinks = (XLogPrevLink *) allocptr;
+	allocptr += sizeof(XLogPrevLink) * (PrevLinksMask + 1);
+
+	for (i = 0; i <= PrevLinksMask; i++)
+	{
+		pg_atomic_init_u64(&PrevLinks[i].endpos, 0);
+		pg_atomic_init_u64(&PrevLinks[i].prevpos, 0);
+	}
+
 	/*
 	 * Align the start of the page buffers to a full xlog block size boundary.
 	 * This simplifies some calculations in XLOG insertion. It is also
@@ -5269,7 +5605,12 @@ XLOGShmemInit(void)
 	XLogCtl->SharedPromoteIsTriggered = false;
 	XLogCtl->WalWriterSleeping = false;
 
-	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
+	pg_atomic_init_u64(&XLogCtl->Insert.CurrBytePos, 0);
+	pg_atomic_init_u64(&XLogCtl->flushRequests, 0);
+	XLogCtl->lastFlushRequests = 0;
+	INSTR_TIME_SET_ZERO(XLogCtl->lastFlushTime);
+	XLogCtl->commitArrivalUsec = 0;
+	XLogCtl->walFlushUsec = 0;
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
@@ -6218,6 +6559,9 @@ recoveryPausesHere(bool endOfRecovery)
 	if (LocalPromoteIsTriggered)
 		return;
 
+	/* Make sure what's been reported as replayed really has been */
+	ParallelRedoSync();
+
 	if (endOfRecovery)
 		ereport(LOG,
 				(errmsg("pausing at the end of recovery"),
@@ -7203,6 +7547,24 @@ StartupXLOG(void)
 	abortedRecPtr = InvalidXLogRecPtr;
 	missingContrecPtr = InvalidXLogRecPtr;
 
+	/*
+	 * Load the cumulative statistics saved by the last checkpoint.  After a
+	 * crash they are somewhat out of date, but still much better than
+	 * nothing.  When restoring a base backup or doing archive recovery,
+	 * though, they may describe an entirely different state of the cluster,
+	 * so start from scratch.
+	 */
+	if (ArchiveRecoveryRequested || haveBackupLabel)
+		pgstat_reset_all();
+	else
+		pgstat_restore_stats();
+
+	/*
+	 * Repair data pages torn by a crash from the double-write buffer before
+	 * WAL replay reads them, and get the buffer ready for use.
+	 */
+	StartupDoubleWrite(InRecovery);
+
 	/* REDO */
 	if (InRecovery)
 	{
@@ -7308,11 +7670,6 @@ StartupXLOG(void)
 			minRecoveryPointTLI = 0;
 		}
 
-		/*
-		 * Reset pgstat data, because it may be invalid after recovery.
-		 */
-		pgstat_reset_all();
-
 		/*
 		 * If there was a backup label file, it's done its job and the info
 		 * has now been propagated into pg_control.  We must get rid of the
@@ -7488,6 +7845,7 @@ StartupXLOG(void)
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
 			PGRUsage	ru0;
+			XLogPrefetcher *prefetcher;
 
 			pg_rusage_init(&ru0);
 
@@ -7501,6 +7859,9 @@ StartupXLOG(void)
 			if (!StandbyMode)
 				begin_startup_progress_phase();
 
+			/* Look ahead in the WAL for blocks to prefetch, if enabled. */
+			prefetcher = XLogPrefetcherAllocate();
+
 			/*
 			 * main redo apply loop
 			 */
@@ -7534,6 +7895,9 @@ StartupXLOG(void)
 				/* Handle interrupt signals of startup process */
 				HandleStartupProcInterrupts();
 
+				/* Give the kernel notice of blocks we'll need soon */
+				XLogPrefetcherReadAhead(prefetcher, xlogreader);
+
 				/*
 				 * Pause WAL replay, if requested by a hot-standby session via
 				 * SetRecoveryPause().
@@ -7649,8 +8013,16 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+				/*
+				 * Now apply the WAL record itself, or hand it off to a
+				 * parallel redo worker.  Anything we replay ourselves must
+				 * wait for the workers to catch up first.
+				 */
+				if (!ParallelRedoDispatch(xlogreader))
+				{
+					ParallelRedoSync();
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+				}
 
 				/*
 				 * After redo, check whether the backup pages associated with
@@ -7723,6 +8095,9 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			XLogPrefetcherFree(prefetcher);
+			ParallelRedoShutdown();
+
 			if (reachedRecoveryTarget)
 			{
 				if (!reachedConsistency)
@@ -7986,8 +8361,9 @@ StartupXLOG(void)
 	 * previous incarnation.
 	 */
 	Insert = &XLogCtl->Insert;
-	Insert->PrevBytePos = XLogRecPtrToBytePos(LastRec);
-	Insert->CurrBytePos = XLogRecPtrToBytePos(EndOfLog);
+	pg_atomic_write_u64(&Insert->CurrBytePos, XLogRecPtrToBytePos(EndOfLog));
+	XLogPrevLinkPublish(XLogRecPtrToBytePos(EndOfLog),
+						XLogRecPtrToBytePos(LastRec));
 
 	/*
 	 * Tricky point here: readBuf contains the *last* block that the LastRec
@@ -8065,6 +8441,12 @@ StartupXLOG(void)
 	TrimCLOG();
 	TrimMultiXact();
 
+	/*
+	 * Start up pg_csn.  It's never used during recovery, and needs pg_xact
+	 * to be usable.
+	 */
+	StartupCSNLog(oldestActiveXID);
+
 	/* Reload shared-memory state for prepared transactions */
 	RecoverPreparedTransactions();
 
@@ -8718,7 +9100,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -8795,7 +9177,8 @@ ShutdownXLOG(int code, Datum arg)
 		 * process one more time at the end of shutdown). The checkpoint
 		 * record will go to the next XLOG file and won't be archived (yet).
 		 */
-		if (XLogArchivingActive() && XLogArchiveCommandSet())
+		if (XLogArchivingActive() &&
+			(XLogArchiveCommandSet() || XLogArchiveLibrary[0] != '\0'))
 			RequestXLogSwitch(false);
 
 		CreateCheckPoint(CHECKPOINT_IS_SHUTDOWN | CHECKPOINT_IMMEDIATE);
@@ -9119,7 +9502,7 @@ CreateCheckPoint(int flags)
 	 * determine the checkpoint REDO pointer.
 	 */
 	WALInsertLockAcquireExclusive();
-	curInsert = XLogBytePosToRecPtr(Insert->CurrBytePos);
+	curInsert = XLogBytePosToRecPtr(pg_atomic_read_u64(&Insert->CurrBytePos));
 
 	/*
 	 * If this isn't a shutdown or forced checkpoint, and if there has been no
@@ -9423,14 +9806,20 @@ CreateCheckPoint(int flags)
 	 * the oldest XMIN of any running transaction.  No future transaction will
 	 * attempt to reference any pg_subtrans entry older than that (see Asserts
 	 * in subtrans.c).  During recovery, though, we mustn't do this because
-	 * StartupSUBTRANS hasn't been called yet.
+	 * StartupSUBTRANS hasn't been called yet.  The same applies to pg_csn.
 	 */
 	if (!RecoveryInProgress())
+	{
 		TruncateSUBTRANS(GetOldestTransactionIdConsideredRunning());
+		TruncateCSNLog(GetOldestTransactionIdConsideredRunning());
+	}
 
 	/* Real work is done; log and update stats. */
 	LogCheckpointEnd(false);
 
+	/* Save the cumulative statistics, so they survive a restart or crash */
+	pgstat_write_statsfile();
+
 	/* Reset the process title */
 	update_checkpoint_display(flags, false, true);
 
@@ -9544,6 +9933,8 @@ CreateOverwriteContrecordRecord(XLogRecPtr aborted_lsn)
 static void
 CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 {
+	uint64		dwcycle;
+
 	CheckPointRelationMap();
 	CheckPointReplicationSlots();
 	CheckPointSnapBuild();
@@ -9556,6 +9947,7 @@ CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 	CheckPointCLOG();
 	CheckPointCommitTs();
 	CheckPointSUBTRANS();
+	CheckPointCSNLog();
 	CheckPointMultiXact();
 	CheckPointPredicate();
 	CheckPointBuffers(flags);
@@ -9563,7 +9955,9 @@ CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 	/* Perform all queued up fsyncs */
 	TRACE_POSTGRESQL_BUFFER_CHECKPOINT_SYNC_START();
 	CheckpointStats.ckpt_sync_t = GetCurrentTimestamp();
+	dwcycle = DoubleWriteStartSync();
 	ProcessSyncRequests();
+	DoubleWriteEndSync(dwcycle);
 	CheckpointStats.ckpt_sync_end_t = GetCurrentTimestamp();
 	TRACE_POSTGRESQL_BUFFER_CHECKPOINT_DONE();
 
@@ -9847,6 +10241,9 @@ CreateRestartPoint(int flags)
 	/* Real work is done; log and update stats. */
 	LogCheckpointEnd(true);
 
+	/* Save the cumulative statistics, as in CreateCheckPoint() */
+	pgstat_write_statsfile();
+
 	/* Reset the process title */
 	update_checkpoint_display(flags, true, true);
 
@@ -10743,10 +11140,18 @@ static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
+	int			io_direct_flag = 0;
+
+	/*
+	 * io_direct = wal bypasses the kernel cache regardless of the sync method.
+	 * Not in walreceiver, though, for the reasons explained below.
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		io_direct_flag = PG_O_DIRECT;
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return io_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10764,6 +11169,7 @@ get_sync_bit(int method)
 	 */
 	if (!XLogIsNeeded() && !AmWalReceiverProcess())
 		o_direct_flag = PG_O_DIRECT;
+	o_direct_flag |= io_direct_flag;
 
 	switch (method)
 	{
@@ -10776,7 +11182,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return io_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -10902,15 +11308,22 @@ issue_xlog_fsync(int fd, XLogSegNo segno)
 	pgstat_report_wait_end();
 
 	/*
-	 * Increment the I/O timing and the number of times WAL files were synced.
+	 * Increment the I/O timing and the number of times WAL files were synced,
+	 * and count the sync in the latency histogram.
 	 */
 	if (track_wal_io_timing)
 	{
 		instr_time	duration;
+		uint64		usec;
+		int			bucket;
 
 		INSTR_TIME_SET_CURRENT(duration);
 		INSTR_TIME_SUBTRACT(duration, start);
-		WalStats.m_wal_sync_time += INSTR_TIME_GET_MICROSEC(duration);
+		usec = INSTR_TIME_GET_MICROSEC(duration);
+		WalStats.m_wal_sync_time += usec;
+
+		bucket = (usec == 0) ? 0 : pg_leftmost_one_pos64(usec) + 1;
+		WalStats.m_wal_sync_histogram[Min(bucket, PGSTAT_WAL_SYNC_BUCKETS - 1)]++;
 	}
 
 	WalStats.m_wal_sync++;
@@ -11963,9 +12376,7 @@ GetXLogInsertRecPtr(void)
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	uint64		current_bytepos;
 
-	SpinLockAcquire(&Insert->insertpos_lck);
-	current_bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	current_bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	return XLogBytePosToRecPtr(current_bytepos);
 }
@@ -12117,6 +12528,18 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 								 tli_from_file, BACKUP_LABEL_FILE)));
 	}
 
+	/*
+	 * An incremental backup lacks the blocks that didn't change since the
+	 * backup it's based on, so it can't be recovered on its own.
+	 */
+	if (fscanf(lfp, "INCREMENTAL FROM LSN: %X/%X\n", &hi, &lo) == 2)
+		ereport(FATAL,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("cannot recover from an incremental backup"),
+				 errdetail("File \"%s\" indicates an incremental backup based on %X/%X.",
+						   BACKUP_LABEL_FILE, hi, lo),
+				 errhint("Use pg_combinebackup to combine the incremental backup with the backups it is based on first.")));
+
 	if (ferror(lfp) || FreeFile(lfp))
 		ereport(FATAL,
 				(errcode_for_file_access(),
@@ -491,7 +491,16 @@ XLogArchiveNotify(const char *xlog)
 
 	/* Notify archiver that it's got something to do */
 	if (IsUnderPostmaster)
+	{
+		/*
+		 * Timeline history files are archived ahead of any segments, so make
+		 * sure the archiver doesn't stick with the files it already found.
+		 */
+		if (IsTLHistoryFileName(xlog))
+			PgArchForceDirScan();
+
 		PgArchWakeup();
+	}
 }
 
 /*
@@ -0,0 +1,587 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.c
+ *		Parallel WAL redo.
+ *
+ * Once recovery has reached a consistent state, the startup process can
+ * hand off some WAL records to a set of redo worker processes instead of
+ * replaying them itself.  Only records that reference a single block of a
+ * single relation, and whose redo routine touches nothing but that block
+ * and the relation's own visibility map and free space map, are handed off.
+ * Records are partitioned among the workers by relation, so all changes to
+ * a given relation are still replayed in WAL order by one process, and no
+ * two processes ever extend the same relation fork concurrently.  (Redo
+ * extends the main fork without taking the relation extension lock, so
+ * partitioning by block would not be safe.)
+ *
+ * Every other record, including all records of the XLOG, XACT, SMGR and
+ * STANDBY resource managers and all records that reference more than one
+ * block, acts as a barrier: the startup process waits for the workers to
+ * replay everything they've been sent, and then replays the record itself.
+ * Since commit and abort records are barriers, a hot standby snapshot can
+ * never see a transaction as committed before all of its changes have been
+ * replayed.  The startup process still maintains KnownAssignedXids for every
+ * record, in WAL order, before dispatching it.
+ *
+ * Records are sent to the workers through shm_mq queues, in the format they
+ * have in the WAL, and decoded again by the worker.
+ *
+ * The workers are only started the first time a record eligible for
+ * parallel replay is seen after reaching consistency.  Before that, the
+ * startup process has to remember references to missing pages itself (see
+ * log_invalid_page()), so crash recovery, and archive recovery up to the
+ * consistent point, is always single-threaded.
+ *
+ * Portions Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogutils.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/dsm.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+#define PARALLEL_REDO_MAGIC			0x50524544
+#define PARALLEL_REDO_KEY_SHARED	0
+#define PARALLEL_REDO_KEY_QUEUE(n)	(1 + (n))
+
+#define PARALLEL_REDO_QUEUE_SIZE	(1024 * 1024)
+
+/*
+ * Header of each message sent to a worker.  A record message is followed by
+ * the record itself.  A message consisting of the header alone is a sync
+ * request: the worker reports that it has replayed everything up to end_lsn.
+ */
+typedef struct ParallelRedoMessage
+{
+	XLogRecPtr	read_lsn;
+	XLogRecPtr	end_lsn;
+} ParallelRedoMessage;
+
+/* State in the DSM segment, shared with the workers */
+typedef struct ParallelRedoShared
+{
+	PGPROC	   *leader;			/* the startup process */
+	int			nworkers;
+	pg_atomic_uint64 synced_lsn[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoShared;
+
+/* Per-worker state, private to the startup process */
+typedef struct ParallelRedoWorker
+{
+	int			worker_number;	/* index of the worker's queue */
+	BackgroundWorkerHandle *handle;
+	shm_mq_handle *mqh;
+	XLogRecPtr	sent_lsn;		/* end of the last record sent */
+	bool		dirty;			/* sent anything since the last sync? */
+} ParallelRedoWorker;
+
+/* GUC */
+int			max_parallel_redo_workers = 0;
+
+static dsm_segment *redo_seg = NULL;
+static ParallelRedoShared *redo_shared = NULL;
+static ParallelRedoWorker *redo_workers = NULL;
+static int	redo_nworkers = 0;
+
+/* Have we tried to start the workers?  We only try once. */
+static bool redo_started = false;
+
+static bool ParallelRedoStart(void);
+static bool ParallelRedoIsPartitionable(XLogReaderState *record);
+static void parallel_redo_error_callback(void *arg);
+
+/*
+ * Can this record be replayed by a redo worker?
+ *
+ * The records accepted here have redo routines that modify only the one
+ * block they reference, plus the visibility map and free space map of the
+ * same relation (which are extended under the relation extension lock).
+ * They don't take cleanup locks and don't resolve recovery conflicts, so
+ * they can be replayed concurrently with records for other relations.
+ */
+static bool
+ParallelRedoIsPartitionable(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	ForkNumber	forknum;
+
+	if (record->max_block_id != 0 || !XLogRecHasBlockRef(record, 0))
+		return false;
+	XLogRecGetBlockTag(record, 0, NULL, &forknum, NULL);
+	if (forknum != MAIN_FORKNUM)
+		return false;
+
+	/* Consistency checking is left to the startup process */
+	if ((XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0)
+		return false;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+					return true;
+			}
+			break;
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+					return true;
+			}
+			break;
+		case RM_BTREE_ID:
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_INSERT_POST:
+				case XLOG_BTREE_DEDUP:
+					return true;
+			}
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Set up the shared memory segment and launch the workers.  Returns false if
+ * none could be started, in which case replay continues in the startup
+ * process alone.
+ */
+static bool
+ParallelRedoStart(void)
+{
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	Size		segsize;
+	Size		sharedsize;
+	int			nworkers = max_parallel_redo_workers;
+	int			nlive;
+	int			i;
+
+	Assert(!redo_started);
+	redo_started = true;
+
+	sharedsize = add_size(offsetof(ParallelRedoShared, synced_lsn),
+						  mul_size(sizeof(pg_atomic_uint64), nworkers));
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	for (i = 0; i < nworkers; i++)
+		shm_toc_estimate_chunk(&e, PARALLEL_REDO_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 1 + nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	redo_seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (redo_seg == NULL)
+	{
+		ereport(LOG,
+				(errmsg("could not create shared memory segment for parallel redo")));
+		return false;
+	}
+	dsm_pin_mapping(redo_seg);
+	toc = shm_toc_create(PARALLEL_REDO_MAGIC, dsm_segment_address(redo_seg),
+						 segsize);
+
+	redo_shared = shm_toc_allocate(toc, sharedsize);
+	redo_shared->leader = MyProc;
+	redo_shared->nworkers = nworkers;
+	for (i = 0; i < nworkers; i++)
+		pg_atomic_init_u64(&redo_shared->synced_lsn[i], InvalidXLogRecPtr);
+	shm_toc_insert(toc, PARALLEL_REDO_KEY_SHARED, redo_shared);
+
+	redo_workers = MemoryContextAllocZero(TopMemoryContext,
+										  sizeof(ParallelRedoWorker) * nworkers);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		BackgroundWorker worker;
+		BackgroundWorkerHandle *handle;
+		ParallelRedoWorker *w;
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_REDO_QUEUE_SIZE),
+						   PARALLEL_REDO_QUEUE_SIZE);
+		shm_toc_insert(toc, PARALLEL_REDO_KEY_QUEUE(i), mq);
+		shm_mq_set_sender(mq, MyProc);
+
+		memset(&worker, 0, sizeof(worker));
+		snprintf(worker.bgw_name, BGW_MAXLEN, "parallel redo worker %d", i);
+		snprintf(worker.bgw_type, BGW_MAXLEN, "parallel redo worker");
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		sprintf(worker.bgw_library_name, "postgres");
+		sprintf(worker.bgw_function_name, "ParallelRedoWorkerMain");
+		worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(redo_seg));
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+
+		/*
+		 * The postmaster only notifies regular backends of worker state
+		 * changes, so we poll below instead of setting bgw_notify_pid.
+		 */
+		worker.bgw_notify_pid = 0;
+
+		if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+			break;
+
+		w = &redo_workers[redo_nworkers++];
+		w->worker_number = i;
+		w->handle = handle;
+		w->mqh = shm_mq_attach(mq, redo_seg, handle);
+	}
+
+	/*
+	 * Wait for each worker to attach to its queue, or to die trying.  Until
+	 * the receiver has attached, nobody would wake us up if a send had to
+	 * wait for queue space.
+	 */
+	nlive = 0;
+	for (i = 0; i < redo_nworkers; i++)
+	{
+		ParallelRedoWorker *w = &redo_workers[i];
+
+		for (;;)
+		{
+			pid_t		pid;
+
+			if (shm_mq_get_receiver(shm_mq_get_queue(w->mqh)) != NULL)
+			{
+				redo_workers[nlive++] = *w;
+				break;
+			}
+			if (GetBackgroundWorkerPid(w->handle, &pid) == BGWH_STOPPED)
+			{
+				shm_mq_detach(w->mqh);
+				break;
+			}
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_RECOVERY_PARALLEL_REDO);
+			ResetLatch(MyLatch);
+			HandleStartupProcInterrupts();
+		}
+	}
+	redo_nworkers = nlive;
+
+	if (redo_nworkers == 0)
+	{
+		ereport(LOG,
+				(errmsg("could not start parallel redo workers, continuing with serial redo"),
+				 errhint("You might need to increase max_worker_processes.")));
+		dsm_detach(redo_seg);
+		redo_seg = NULL;
+		redo_shared = NULL;
+		return false;
+	}
+
+	if (redo_nworkers < nworkers)
+		ereport(LOG,
+				(errmsg("started only %d of %d parallel redo workers",
+						redo_nworkers, nworkers),
+				 errhint("You might need to increase max_worker_processes.")));
+	else
+		ereport(LOG,
+				(errmsg("started %d parallel redo workers", redo_nworkers)));
+
+	return true;
+}
+
+/*
+ * Try to hand off a record to a redo worker.
+ *
+ * Returns true if the record was sent to a worker, in which case the caller
+ * must not replay it.  Otherwise, the caller must call ParallelRedoSync()
+ * before replaying it.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	ParallelRedoWorker *w;
+	ParallelRedoMessage msg;
+	shm_mq_iovec iov[2];
+	RelFileNode rnode;
+
+	if (max_parallel_redo_workers == 0 || !reachedConsistency)
+		return false;
+
+	if (!ParallelRedoIsPartitionable(record))
+		return false;
+
+	if (!redo_started && !ParallelRedoStart())
+		return false;
+	if (redo_nworkers == 0)
+		return false;
+
+	XLogRecGetBlockTag(record, 0, &rnode, NULL, NULL);
+	w = &redo_workers[hash_bytes((const unsigned char *) &rnode,
+								 sizeof(RelFileNode)) % redo_nworkers];
+
+	msg.read_lsn = record->ReadRecPtr;
+	msg.end_lsn = record->EndRecPtr;
+	iov[0].data = (const char *) &msg;
+	iov[0].len = sizeof(msg);
+	iov[1].data = (const char *) record->decoded_record;
+	iov[1].len = XLogRecGetTotalLen(record);
+
+	if (shm_mq_sendv(w->mqh, iov, 2, false, true) != SHM_MQ_SUCCESS)
+		ereport(FATAL,
+				(errmsg("parallel redo worker exited unexpectedly")));
+
+	w->sent_lsn = record->EndRecPtr;
+	w->dirty = true;
+
+	return true;
+}
+
+/*
+ * Wait until the redo workers have replayed all the records they've been
+ * sent.
+ */
+void
+ParallelRedoSync(void)
+{
+	bool		waited = false;
+	int			i;
+
+	for (i = 0; i < redo_nworkers; i++)
+	{
+		ParallelRedoWorker *w = &redo_workers[i];
+		ParallelRedoMessage msg;
+
+		if (!w->dirty)
+			continue;
+
+		msg.read_lsn = InvalidXLogRecPtr;
+		msg.end_lsn = w->sent_lsn;
+		if (shm_mq_send(w->mqh, sizeof(msg), &msg, false, true) != SHM_MQ_SUCCESS)
+			ereport(FATAL,
+					(errmsg("parallel redo worker exited unexpectedly")));
+	}
+
+	for (i = 0; i < redo_nworkers; i++)
+	{
+		ParallelRedoWorker *w = &redo_workers[i];
+
+		if (!w->dirty)
+			continue;
+
+		while (pg_atomic_read_u64(&redo_shared->synced_lsn[w->worker_number]) <
+			   w->sent_lsn)
+		{
+			pid_t		pid;
+
+			if (GetBackgroundWorkerPid(w->handle, &pid) == BGWH_STOPPED)
+				ereport(FATAL,
+						(errmsg("parallel redo worker exited unexpectedly")));
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_RECOVERY_PARALLEL_REDO);
+			ResetLatch(MyLatch);
+			HandleStartupProcInterrupts();
+		}
+		w->dirty = false;
+		waited = true;
+	}
+
+	/*
+	 * The workers may have extended relations, so any sizes we have cached
+	 * can be stale.
+	 */
+	if (waited)
+		smgrresetnblocksall();
+}
+
+/*
+ * Wait for the workers to finish replay and tell them to exit.  Called at the
+ * end of recovery.
+ */
+void
+ParallelRedoShutdown(void)
+{
+	int			i;
+
+	ParallelRedoSync();
+
+	for (i = 0; i < redo_nworkers; i++)
+		shm_mq_detach(redo_workers[i].mqh);
+	redo_nworkers = 0;
+
+	if (redo_seg != NULL)
+	{
+		dsm_detach(redo_seg);
+		redo_seg = NULL;
+		redo_shared = NULL;
+	}
+}
+
+/*
+ * Error context callback for errors occurring in a redo worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+
+	errcontext("WAL redo at %X/%X for %s",
+			   LSN_FORMAT_ARGS(record->ReadRecPtr),
+			   RmgrTable[XLogRecGetRmid(record)].rm_name);
+}
+
+/*
+ * Main entrypoint for parallel redo workers.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelRedoShared *shared;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+	int			worker_number;
+	int			rmid;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_REDO_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+	shared = shm_toc_lookup(toc, PARALLEL_REDO_KEY_SHARED, false);
+	Assert(worker_number >= 0 && worker_number < shared->nworkers);
+
+	mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_QUEUE(worker_number), false);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Redo pins buffers, which requires a resource owner. */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel redo worker");
+
+	/*
+	 * Replay as the startup process would.  We are only sent records after
+	 * consistency has been reached, so a reference to a missing page is just
+	 * as fatal here as it would be there.
+	 */
+	InRecovery = true;
+	reachedConsistency = true;
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL,
+								XL_ROUTINE(.page_read = NULL), NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "parallel redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		if (RmgrTable[rmid].rm_startup != NULL)
+			RmgrTable[rmid].rm_startup();
+	}
+
+	for (;;)
+	{
+		ErrorContextCallback errcallback;
+		ParallelRedoMessage *msg;
+		XLogRecord *xlrec;
+		MemoryContext oldcontext;
+		char	   *errormsg;
+		Size		nbytes;
+		void	   *data;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The startup process detaches when recovery ends. */
+		if (shm_mq_receive(mqh, &nbytes, &data, false) != SHM_MQ_SUCCESS)
+			break;
+
+		Assert(nbytes >= sizeof(ParallelRedoMessage));
+		msg = (ParallelRedoMessage *) data;
+
+		if (nbytes == sizeof(ParallelRedoMessage))
+		{
+			/*
+			 * Sync request.  The startup process may extend relations once
+			 * we've replied, so forget any sizes we have cached first.
+			 */
+			smgrresetnblocksall();
+			pg_atomic_write_u64(&shared->synced_lsn[worker_number],
+								msg->end_lsn);
+			SetLatch(&shared->leader->procLatch);
+			continue;
+		}
+
+		xlrec = (XLogRecord *) ((char *) data + sizeof(ParallelRedoMessage));
+		reader->ReadRecPtr = msg->read_lsn;
+		reader->EndRecPtr = msg->end_lsn;
+		if (!DecodeXLogRecord(reader, xlrec, &errormsg))
+			elog(ERROR, "could not decode WAL record at %X/%X: %s",
+				 LSN_FORMAT_ARGS(msg->read_lsn), errormsg);
+
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[xlrec->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+	}
+
+	for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		if (RmgrTable[rmid].rm_cleanup != NULL)
+			RmgrTable[rmid].rm_cleanup();
+	}
+}
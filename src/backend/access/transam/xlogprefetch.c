@@ -0,0 +1,696 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * Portions Copyright (c) 2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ * The startup process reads the data blocks referenced by each WAL record
+ * synchronously, as it replays the record.  With a cold cache, that means
+ * one random read at a time, which is often much slower than the primary
+ * generated the WAL.  To hide some of that latency, this module runs a
+ * second XLogReader ahead of replay, decoding the records that are already
+ * in pg_wal, and calls PrefetchSharedBuffer() for the blocks they reference,
+ * so that the kernel can start reading them in before replay gets there.
+ *
+ * The look-ahead reader never waits for WAL.  It stops whenever it can't
+ * read or validate the next record -- at the end of the WAL received so far
+ * on a standby, at the end of WAL in crash recovery, or when the next
+ * segment is still to be restored from the archive -- and tries again later.
+ * On a standby, it doesn't read past what the WAL receiver has flushed.
+ *
+ * How far ahead we read is limited by recovery_prefetch_distance, in bytes
+ * of WAL, and the number of prefetches we allow to be in flight by
+ * maintenance_io_concurrency.  We can't tell when a prefetch has completed,
+ * so we consider it to be in flight until replay reaches the record that
+ * referenced the block.
+ *
+ * Block references are skipped if we know that replay won't need to read
+ * the block: if the record initializes it from scratch, or has a full page
+ * image that will be restored.  We also skip blocks that we prefetched just
+ * before, and blocks of relations that don't exist yet (because the record
+ * that creates them hasn't been replayed), until replay has caught up.
+ *
+ * The counters are shown in the pg_stat_recovery_prefetch view.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+/* Number of recently prefetched blocks remembered, to skip repeats */
+#define XLOGPREFETCH_RECENT_BLOCKS	8
+
+/* Maximum number of prefetches in flight, allowing for the last record */
+#define XLOGPREFETCH_QUEUE_SIZE		(MAX_IO_CONCURRENCY + XLR_MAX_BLOCK_ID + 1)
+
+/* GUCs */
+int			recovery_prefetch = RECOVERY_PREFETCH_TRY;
+int			recovery_prefetch_distance = 512 * 1024;
+
+/*
+ * A relation fork whose blocks from filter_from_block up are not prefetched
+ * until replay has reached filter_until_replayed, because the file (or the
+ * segment) didn't exist when we looked.
+ */
+typedef struct XLogPrefetchFilterKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} XLogPrefetchFilterKey;
+
+typedef struct XLogPrefetchFilter
+{
+	XLogPrefetchFilterKey key;	/* hash key, must be first */
+	BlockNumber filter_from_block;
+	XLogRecPtr	filter_until_replayed;
+} XLogPrefetchFilter;
+
+typedef struct XLogPrefetchRecentBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetchRecentBlock;
+
+/*
+ * Statistics for pg_stat_recovery_prefetch, in shared memory.  Only the
+ * startup process writes them, except for resets.
+ */
+typedef struct XLogPrefetchStats
+{
+	pg_atomic_uint64 reset_time;	/* time of last reset */
+	pg_atomic_uint64 prefetch;	/* prefetches initiated */
+	pg_atomic_uint64 hit;		/* blocks already in shared buffers */
+	pg_atomic_uint64 skip_init; /* blocks that will be zero-initialized */
+	pg_atomic_uint64 skip_new;	/* blocks of files that don't exist yet */
+	pg_atomic_uint64 skip_fpw;	/* blocks restored from full page images */
+	pg_atomic_uint64 skip_rep;	/* blocks prefetched just before */
+
+	/* Current state of the look-ahead */
+	int			wal_distance;	/* bytes of WAL decoded ahead of replay */
+	int			io_depth;		/* prefetches in flight */
+} XLogPrefetchStats;
+
+static XLogPrefetchStats *Stats = NULL;
+
+struct XLogPrefetcher
+{
+	/* The look-ahead reader, and the WAL segment it has open */
+	XLogReaderState *reader;
+	TimeLineID	tli;
+	int			file;
+	XLogSegNo	file_segno;
+
+	/*
+	 * read_lsn is the start of the last record we decoded, or invalid if we
+	 * haven't started.  If positioned is false, the reader must be restarted
+	 * there, discarding that record again.
+	 */
+	XLogRecPtr	read_lsn;
+	bool		positioned;
+
+	/*
+	 * After we failed to read or validate the next record, we don't try
+	 * again until replay has moved past read_lsn, or past segment
+	 * retry_segno if that segment's file was missing.  Running into the WAL
+	 * receiver's flush position isn't a failure; we just try again next
+	 * time.
+	 */
+	bool		stalled;
+	bool		stalled_at_limit;
+	XLogSegNo	retry_segno;
+
+	/* Record LSNs of the prefetches in flight, oldest first */
+	XLogRecPtr	queue[XLOGPREFETCH_QUEUE_SIZE];
+	int			queue_head;
+	int			queue_count;
+
+	XLogPrefetchRecentBlock recent[XLOGPREFETCH_RECENT_BLOCKS];
+	int			recent_idx;
+
+	HTAB	   *filter_table;
+};
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static void XLogPrefetcherRestart(XLogPrefetcher *prefetcher,
+								  XLogRecPtr lsn, TimeLineID tli);
+static void XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher,
+									 XLogRecPtr replaying);
+static bool XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher,
+									 DecodedBkpBlock *block,
+									 XLogRecPtr replaying);
+static void XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher,
+									DecodedBkpBlock *block, XLogRecPtr lsn);
+
+/*
+ * Only the startup process increments the counters, but use an atomic
+ * increment anyway so that a concurrent reset can't be undone.
+ */
+static inline void
+inc_counter(pg_atomic_uint64 *counter)
+{
+	pg_atomic_fetch_add_u64(counter, 1);
+}
+
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchStats);
+}
+
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	Stats = (XLogPrefetchStats *)
+		ShmemInitStruct("XLogPrefetchStats", sizeof(XLogPrefetchStats),
+						&found);
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&Stats->reset_time, GetCurrentTimestamp());
+		pg_atomic_init_u64(&Stats->prefetch, 0);
+		pg_atomic_init_u64(&Stats->hit, 0);
+		pg_atomic_init_u64(&Stats->skip_init, 0);
+		pg_atomic_init_u64(&Stats->skip_new, 0);
+		pg_atomic_init_u64(&Stats->skip_fpw, 0);
+		pg_atomic_init_u64(&Stats->skip_rep, 0);
+		Stats->wal_distance = 0;
+		Stats->io_depth = 0;
+	}
+}
+
+/*
+ * Reset the counters, for pg_stat_reset_shared('recovery_prefetch').
+ */
+void
+XLogPrefetchResetStats(void)
+{
+	pg_atomic_write_u64(&Stats->reset_time, GetCurrentTimestamp());
+	pg_atomic_write_u64(&Stats->prefetch, 0);
+	pg_atomic_write_u64(&Stats->hit, 0);
+	pg_atomic_write_u64(&Stats->skip_init, 0);
+	pg_atomic_write_u64(&Stats->skip_new, 0);
+	pg_atomic_write_u64(&Stats->skip_fpw, 0);
+	pg_atomic_write_u64(&Stats->skip_rep, 0);
+}
+
+/*
+ * Is prefetching enabled, and can it do anything useful?
+ */
+static bool
+XLogPrefetchEnabled(void)
+{
+#ifdef USE_PREFETCH
+	if (recovery_prefetch == RECOVERY_PREFETCH_OFF)
+		return false;
+
+	/* prefetching into the kernel's cache doesn't help direct reads */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return false;
+
+	return maintenance_io_concurrency > 0 && recovery_prefetch_distance > 0;
+#else
+	return false;
+#endif
+}
+
+/*
+ * GUC check_hook for recovery_prefetch
+ */
+bool
+check_recovery_prefetch(int *newval, void **extra, GucSource source)
+{
+#ifndef USE_PREFETCH
+	if (*newval == RECOVERY_PREFETCH_ON)
+	{
+		GUC_check_errdetail("recovery_prefetch is not supported on platforms that lack posix_fadvise().");
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+/*
+ * Create a prefetcher, for the startup process's redo loop.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+	HASHCTL		ctl;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader =
+		XLogReaderAllocate(wal_segment_size, NULL,
+						   XL_ROUTINE(.page_read = &XLogPrefetcherPageRead,
+									  .segment_open = NULL,
+									  .segment_close = NULL),
+						   prefetcher);
+	if (!prefetcher->reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+	prefetcher->reader->system_identifier = GetSystemIdentifier();
+	prefetcher->file = -1;
+	prefetcher->read_lsn = InvalidXLogRecPtr;
+
+	ctl.keysize = sizeof(XLogPrefetchFilterKey);
+	ctl.entrysize = sizeof(XLogPrefetchFilter);
+	prefetcher->filter_table = hash_create("XLogPrefetcherFilterTable", 64,
+										   &ctl, HASH_ELEM | HASH_BLOBS);
+
+	return prefetcher;
+}
+
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->file >= 0)
+		close(prefetcher->file);
+	XLogReaderFree(prefetcher->reader);
+	hash_destroy(prefetcher->filter_table);
+	pfree(prefetcher);
+
+	Stats->wal_distance = 0;
+	Stats->io_depth = 0;
+}
+
+/*
+ * Read ahead of the record that replay is about to apply, and prefetch the
+ * blocks referenced by the records we find.
+ *
+ * This is called in the redo loop, before each record is replayed.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogReaderState *replay)
+{
+	XLogRecPtr	replaying = replay->ReadRecPtr;
+	XLogReaderState *reader = prefetcher->reader;
+
+	/* Replay has reached the records of the oldest prefetches, if any */
+	while (prefetcher->queue_count > 0 &&
+		   prefetcher->queue[prefetcher->queue_head] <= replaying)
+	{
+		prefetcher->queue_head =
+			(prefetcher->queue_head + 1) % XLOGPREFETCH_QUEUE_SIZE;
+		prefetcher->queue_count--;
+	}
+
+	if (!XLogPrefetchEnabled())
+	{
+		prefetcher->read_lsn = InvalidXLogRecPtr;
+		Stats->wal_distance = 0;
+		Stats->io_depth = prefetcher->queue_count;
+		return;
+	}
+
+	/* Is it time to try again after a failure? */
+	if (prefetcher->stalled && !prefetcher->stalled_at_limit &&
+		prefetcher->tli == replay->seg.ws_tli)
+	{
+		bool		wait;
+
+		if (prefetcher->retry_segno != 0)
+		{
+			XLogSegNo	replay_segno;
+
+			XLByteToSeg(replaying, replay_segno, wal_segment_size);
+			wait = replay_segno <= prefetcher->retry_segno;
+		}
+		else
+			wait = prefetcher->read_lsn >= replaying;
+
+		if (wait)
+		{
+			Stats->wal_distance = 0;
+			Stats->io_depth = prefetcher->queue_count;
+			return;
+		}
+	}
+
+	/*
+	 * Start over at the record being replayed if we've fallen behind replay,
+	 * or replay has moved to another timeline.
+	 */
+	if (XLogRecPtrIsInvalid(prefetcher->read_lsn) ||
+		prefetcher->read_lsn < replaying ||
+		prefetcher->tli != replay->seg.ws_tli)
+		XLogPrefetcherRestart(prefetcher, replaying, replay->seg.ws_tli);
+
+	while (prefetcher->queue_count < maintenance_io_concurrency)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		if (prefetcher->positioned &&
+			reader->EndRecPtr - replaying >= recovery_prefetch_distance)
+			break;
+
+		if (!prefetcher->positioned)
+		{
+			/* re-read the last record we handled, and discard it */
+			XLogBeginRead(reader, prefetcher->read_lsn);
+			prefetcher->stalled_at_limit = false;
+			prefetcher->retry_segno = 0;
+			if (XLogReadRecord(reader, &errormsg) == NULL)
+			{
+				prefetcher->stalled = true;
+				break;
+			}
+			prefetcher->positioned = true;
+			continue;
+		}
+
+		prefetcher->stalled_at_limit = false;
+		prefetcher->retry_segno = 0;
+		record = XLogReadRecord(reader, &errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * Leave the reader to be restarted at the last record we got;
+			 * it may or may not be usable after a failure.
+			 */
+			prefetcher->positioned = false;
+			prefetcher->stalled = true;
+			break;
+		}
+		prefetcher->stalled = false;
+		prefetcher->read_lsn = reader->ReadRecPtr;
+
+		XLogPrefetcherScanBlocks(prefetcher, replaying);
+	}
+
+	Stats->wal_distance = prefetcher->positioned ?
+		(int) Min(reader->EndRecPtr - replaying, INT_MAX) : 0;
+	Stats->io_depth = prefetcher->queue_count;
+
+	/* Forget filters that have expired, once in a while */
+	if (hash_get_num_entries(prefetcher->filter_table) > 256)
+	{
+		HASH_SEQ_STATUS status;
+		XLogPrefetchFilter *filter;
+
+		hash_seq_init(&status, prefetcher->filter_table);
+		while ((filter = hash_seq_search(&status)) != NULL)
+		{
+			if (filter->filter_until_replayed <= replaying)
+				hash_search(prefetcher->filter_table, &filter->key,
+							HASH_REMOVE, NULL);
+		}
+	}
+}
+
+/*
+ * Position the look-ahead reader at lsn, the start of a record that replay
+ * has already read, on timeline tli.
+ */
+static void
+XLogPrefetcherRestart(XLogPrefetcher *prefetcher, XLogRecPtr lsn,
+					  TimeLineID tli)
+{
+	if (prefetcher->tli != tli && prefetcher->file >= 0)
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+	prefetcher->tli = tli;
+	prefetcher->read_lsn = lsn;
+	prefetcher->positioned = false;
+	prefetcher->stalled = false;
+	prefetcher->retry_segno = 0;
+}
+
+/*
+ * Prefetch the blocks referenced by the record the look-ahead reader has
+ * just decoded.
+ */
+static void
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher, XLogRecPtr replaying)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	for (int block_id = 0; block_id <= reader->max_block_id; block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[block_id];
+		SMgrRelation reln;
+		PrefetchBufferResult result;
+		bool		repeat = false;
+
+		if (!block->in_use)
+			continue;
+
+		/* Replay will restore the image, or zero the page, without a read */
+		if (block->apply_image)
+		{
+			inc_counter(&Stats->skip_fpw);
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			inc_counter(&Stats->skip_init);
+			continue;
+		}
+
+		for (int i = 0; i < XLOGPREFETCH_RECENT_BLOCKS; i++)
+		{
+			XLogPrefetchRecentBlock *recent = &prefetcher->recent[i];
+
+			if (recent->blkno == block->blkno &&
+				recent->forknum == block->forknum &&
+				RelFileNodeEquals(recent->rnode, block->rnode))
+			{
+				repeat = true;
+				break;
+			}
+		}
+		if (repeat)
+		{
+			inc_counter(&Stats->skip_rep);
+			continue;
+		}
+
+		if (XLogPrefetcherIsFiltered(prefetcher, block, replaying))
+		{
+			inc_counter(&Stats->skip_new);
+			continue;
+		}
+
+		/*
+		 * Don't hold onto the SMgrRelation: replay may close it before we
+		 * get here again, e.g. when the relation is dropped.
+		 */
+		reln = smgropen(block->rnode, InvalidBackendId);
+		result = PrefetchSharedBuffer(reln, block->forknum, block->blkno);
+
+		if (BufferIsValid(result.recent_buffer))
+			inc_counter(&Stats->hit);
+		else if (result.initiated_io)
+		{
+			int			tail;
+
+			inc_counter(&Stats->prefetch);
+
+			tail = (prefetcher->queue_head + prefetcher->queue_count) %
+				XLOGPREFETCH_QUEUE_SIZE;
+			prefetcher->queue[tail] = reader->ReadRecPtr;
+			prefetcher->queue_count++;
+
+			prefetcher->recent[prefetcher->recent_idx].rnode = block->rnode;
+			prefetcher->recent[prefetcher->recent_idx].forknum = block->forknum;
+			prefetcher->recent[prefetcher->recent_idx].blkno = block->blkno;
+			prefetcher->recent_idx =
+				(prefetcher->recent_idx + 1) % XLOGPREFETCH_RECENT_BLOCKS;
+		}
+		else
+		{
+			/*
+			 * The file or segment doesn't exist yet, presumably because the
+			 * record that creates or extends it hasn't been replayed.  Don't
+			 * try again until replay has reached this record.
+			 */
+			inc_counter(&Stats->skip_new);
+			XLogPrefetcherAddFilter(prefetcher, block, reader->ReadRecPtr);
+		}
+	}
+}
+
+/*
+ * Should we skip this block, because its file didn't exist recently?
+ */
+static bool
+XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher, DecodedBkpBlock *block,
+						 XLogRecPtr replaying)
+{
+	XLogPrefetchFilterKey key;
+	XLogPrefetchFilter *filter;
+
+	if (hash_get_num_entries(prefetcher->filter_table) == 0)
+		return false;
+
+	memset(&key, 0, sizeof(key));
+	key.rnode = block->rnode;
+	key.forknum = block->forknum;
+	filter = hash_search(prefetcher->filter_table, &key, HASH_FIND, NULL);
+	if (filter == NULL)
+		return false;
+
+	if (filter->filter_until_replayed <= replaying)
+	{
+		/* replay has caught up; look again */
+		hash_search(prefetcher->filter_table, &key, HASH_REMOVE, NULL);
+		return false;
+	}
+
+	return block->blkno >= filter->filter_from_block;
+}
+
+static void
+XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher, DecodedBkpBlock *block,
+						XLogRecPtr lsn)
+{
+	XLogPrefetchFilterKey key;
+	XLogPrefetchFilter *filter;
+	BlockNumber from_block;
+	bool		found;
+
+	/* the block's segment is missing, so all later blocks are too */
+	from_block = block->blkno - block->blkno % ((BlockNumber) RELSEG_SIZE);
+
+	memset(&key, 0, sizeof(key));
+	key.rnode = block->rnode;
+	key.forknum = block->forknum;
+	filter = hash_search(prefetcher->filter_table, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		filter->filter_from_block = from_block;
+		filter->filter_until_replayed = lsn;
+	}
+	else
+	{
+		filter->filter_from_block = Min(filter->filter_from_block, from_block);
+		filter->filter_until_replayed = Max(filter->filter_until_replayed,
+											lsn);
+	}
+}
+
+/*
+ * XLogReader page_read callback for the look-ahead reader.
+ *
+ * Reads directly from the segment files in pg_wal, without waiting, and not
+ * beyond the WAL receiver's flush position if it's running.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	segno;
+	int			nbytes = XLOG_BLCKSZ;
+	int			r;
+
+	if (WalRcvRunning())
+	{
+		XLogRecPtr	flushed = GetWalRcvFlushRecPtr(NULL, NULL);
+
+		if (targetPagePtr + reqLen > flushed)
+		{
+			prefetcher->stalled_at_limit = true;
+			return -1;
+		}
+		nbytes = Min(XLOG_BLCKSZ, flushed - targetPagePtr);
+	}
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	if (prefetcher->file >= 0 && prefetcher->file_segno != segno)
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+	if (prefetcher->file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		prefetcher->file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->file < 0)
+		{
+			/* not there (yet), e.g. still in the archive */
+			prefetcher->retry_segno = segno;
+			return -1;
+		}
+		prefetcher->file_segno = segno;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	r = pg_pread(prefetcher->file, readBuf, nbytes,
+				 (off_t) XLogSegmentOffset(targetPagePtr, wal_segment_size));
+	pgstat_report_wait_end();
+
+	if (r < reqLen)
+		return -1;
+
+	reader->seg.ws_tli = prefetcher->tli;
+	return r;
+}
+
+/*
+ * Returns statistics about recovery prefetching.
+ */
+Datum
+pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_RECOVERY_PREFETCH_COLS 9
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+	bool		nulls[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	memset(nulls, 0, sizeof(nulls));
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&Stats->prefetch));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&Stats->hit));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_init));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_new));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_fpw));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_rep));
+	values[6] = Int32GetDatum(Stats->wal_distance);
+	values[7] = Int32GetDatum(Stats->io_depth);
+	values[8] = TimestampTzGetDatum(pg_atomic_read_u64(&Stats->reset_time));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -323,6 +323,7 @@ BootstrapModeMain(int argc, char *argv[], bool check_only)
 	IgnoreSystemIndexes = true;
 
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	CreateSharedMemoryAndSemaphores();
 
@@ -24,8 +24,11 @@
 #include <unistd.h>
 
 #include "access/amapi.h"
+#include "access/gist_private.h"
 #include "access/heapam.h"
 #include "access/multixact.h"
+#include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
@@ -60,6 +63,7 @@
 #include "commands/tablespace.h"
 #include "commands/trigger.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -67,11 +71,15 @@
 #include "parser/parser.h"
 #include "pgstat.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/sharedfileset.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
@@ -99,6 +107,81 @@ typedef struct
 	Oid			pendingReindexedIndexes[FLEXIBLE_ARRAY_MEMBER];
 } SerializedReindexState;
 
+/* Magic numbers for parallel validate_index state sharing */
+#define PARALLEL_KEY_VALIDATE_SHARED	UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_VALIDATE_SNAPSHOT	UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xC000000000000005)
+
+/*
+ * Number of pieces per participant into which a parallel validate_index
+ * splits the table, so that participants that get ahead can take over more
+ * of the work.
+ */
+#define VALIDATE_INDEX_CHUNKS_PER_PARTICIPANT 8
+
+/*
+ * A range of table blocks scanned by one participant of a parallel
+ * validate_index, and the position of the sorted index TIDs pointing into
+ * it in the shared TID file.
+ */
+typedef struct ValidateIndexChunk
+{
+	BlockNumber startblock;		/* first block of the range */
+	BlockNumber numblocks;		/* number of blocks in the range */
+	int			fileno;			/* position of first TID in the TID file */
+	off_t		offset;
+	int64		ntids;			/* number of TIDs in the range */
+} ValidateIndexChunk;
+
+/*
+ * Shared state for a parallel validate_index.
+ *
+ * The leader collects and sorts the index TIDs as usual, and writes them to
+ * a shared file before launching the workers.  Then all participants,
+ * including the leader, claim chunks of the table one at a time and do the
+ * "merge" for each, inserting missing entries into the index themselves.
+ */
+typedef struct ValidateIndexShared
+{
+	/* Immutable state */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	int			nchunks;
+	SharedFileSet fileset;		/* holds the TID file */
+
+	/* Next chunk to scan */
+	pg_atomic_uint32 nextchunk;
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	BlockNumber blocksdone;
+	double		htups;
+	double		tups_inserted;
+
+	ValidateIndexChunk chunks[FLEXIBLE_ARRAY_MEMBER];
+} ValidateIndexShared;
+
+/*
+ * Working state for index_build_multi and its callback.
+ *
+ * The table scan computes the columns of a combined IndexInfo made of every
+ * column, expression and predicate of the indexes in the group.  colmap[i][j]
+ * is the combined column holding column j of index i, and predcol[i] is the
+ * combined column holding index i's predicate, or -1 if it has none.
+ */
+typedef struct MultiIndexBuildState
+{
+	int			nindexes;
+	Relation   *indexRels;
+	void	  **btstates;
+	int		  **colmap;
+	int		   *predcol;
+	Datum		values[INDEX_MAX_KEYS]; /* workspace for one index's values */
+	bool		isnull[INDEX_MAX_KEYS];
+} MultiIndexBuildState;
+
 /* non-export function prototypes */
 static bool relationHasPrimaryKey(Relation rel);
 static TupleDesc ConstructTupleDescriptor(Relation heapRelation,
@@ -124,15 +207,56 @@ static void UpdateIndexRelation(Oid indexoid, Oid heapoid,
 static void index_update_stats(Relation rel,
 							   bool hasindex,
 							   double reltuples);
+static void index_build_finish(Relation heapRelation,
+							   Relation indexRelation,
+							   IndexInfo *indexInfo,
+							   IndexBuildResult *stats,
+							   bool isreindex);
+static void index_build_multi(Relation heapRelation, int nindexes,
+							  Relation *indexRels, IndexInfo **indexInfos);
+static int	index_build_multi_group(Relation heapRelation, int nindexes,
+									Relation *indexRels,
+									IndexInfo **indexInfos);
+static int	index_build_multi_column(AttrNumber *attnums, List **exprs,
+									 int *ncols, AttrNumber attnum,
+									 Node *expr);
+static void index_build_multi_callback(Relation index, ItemPointer tid,
+									   Datum *values, bool *isnull,
+									   bool tupleIsAlive, void *state);
 static void IndexCheckExclusion(Relation heapRelation,
 								Relation indexRelation,
 								IndexInfo *indexInfo);
 static bool validate_index_callback(ItemPointer itemptr, void *opaque);
+static bool validate_index_parallel(Relation heapRelation,
+									Relation indexRelation,
+									IndexInfo *indexInfo,
+									Snapshot snapshot,
+									ValidateIndexState *state,
+									int request);
+static void validate_index_parallel_scan(ValidateIndexShared *shared,
+										 Relation heapRelation,
+										 Relation indexRelation,
+										 IndexInfo *indexInfo,
+										 Snapshot snapshot,
+										 bool progress);
 static bool ReindexIsCurrentlyProcessingIndex(Oid indexOid);
 static void SetReindexProcessing(Oid heapOid, Oid indexOid);
 static void ResetReindexProcessing(void);
 static void SetReindexPending(List *indexes);
+static void AddReindexPending(Oid indexOid);
 static void RemoveReindexPending(Oid indexOid);
+static Relation reindex_index_begin(Relation heapRelation, Oid indexId,
+									bool skip_constraint_checks,
+									ReindexParams *params,
+									IndexInfo **indexInfo,
+									bool *skipped_constraint);
+static void reindex_index_finish(Relation heapRelation, Relation iRel,
+								 IndexInfo *indexInfo,
+								 bool skipped_constraint,
+								 ReindexParams *params, PGRUsage *ru0);
+static void reindex_index_multi(Relation heapRelation, List *indexIds,
+								bool skip_constraint_checks, char persistence,
+								ReindexParams *params);
 
 
 /*
@@ -2916,12 +3040,15 @@ index_build(Relation heapRelation,
 
 	/*
 	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * only btree, and GiST when it builds the index by sorting, have support
+	 * for parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		(indexRelation->rd_rel->relam == BTREE_AM_OID ||
+		 (indexRelation->rd_rel->relam == GIST_AM_OID &&
+		  gistbuildcansort(indexRelation))))
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
@@ -2974,6 +3101,29 @@ index_build(Relation heapRelation,
 											 indexInfo);
 	Assert(PointerIsValid(stats));
 
+	index_build_finish(heapRelation, indexRelation, indexInfo, stats,
+					   isreindex);
+
+	/* Roll back any GUC changes executed by index functions */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+}
+
+/*
+ * index_build_finish - index_build's work after the AM has built the index
+ *
+ * Also used by index_build_multi.  The caller has already switched to the
+ * table owner's userid.
+ */
+static void
+index_build_finish(Relation heapRelation,
+				   Relation indexRelation,
+				   IndexInfo *indexInfo,
+				   IndexBuildResult *stats,
+				   bool isreindex)
+{
 	/*
 	 * If this is an unlogged index, we may need to write out an init fork for
 	 * it -- but we must first check whether one already exists.  If, for
@@ -3066,6 +3216,43 @@ index_build(Relation heapRelation,
 	 */
 	if (indexInfo->ii_ExclusionOps != NULL)
 		IndexCheckExclusion(heapRelation, indexRelation, indexInfo);
+}
+
+/*
+ * index_build_multi - rebuild several btree indexes of a table at once
+ *
+ * This does the work of index_build with isreindex = true for each of the
+ * given indexes, but feeds all of them from one scan of the table rather
+ * than scanning the table once per index.  That saves a great deal of I/O
+ * when a large table with many indexes must be reindexed, as after CLUSTER,
+ * VACUUM FULL or a table rewrite.  All the indexes must be btrees, whose
+ * physical files have been created but are empty.  The build is always
+ * serial, and maintenance_work_mem is divided among the indexes' sorts.
+ *
+ * The scan computes the union of the indexes' columns, so a group is limited
+ * to INDEX_MAX_KEYS distinct columns; more indexes than that take more than
+ * one scan.  A partial index's expressions must not be evaluated for rows
+ * that its predicate excludes, so callers should not pass partial indexes
+ * on expressions.
+ */
+static void
+index_build_multi(Relation heapRelation, int nindexes,
+				  Relation *indexRels, IndexInfo **indexInfos)
+{
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	int			done = 0;
+
+	/* Same security environment as index_build */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(heapRelation->rd_rel->relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+
+	while (done < nindexes)
+		done += index_build_multi_group(heapRelation, nindexes - done,
+										indexRels + done, indexInfos + done);
 
 	/* Roll back any GUC changes executed by index functions */
 	AtEOXact_GUC(false, save_nestlevel);
@@ -3074,6 +3261,227 @@ index_build(Relation heapRelation,
 	SetUserIdAndSecContext(save_userid, save_sec_context);
 }
 
+/*
+ * Build as many of the given indexes as fit in one table scan, starting at
+ * the first one.  Returns the number of indexes built.
+ */
+static int
+index_build_multi_group(Relation heapRelation, int nindexes,
+						Relation *indexRels, IndexInfo **indexInfos)
+{
+	MultiIndexBuildState state;
+	IndexInfo  *combined;
+	AttrNumber	attnums[INDEX_MAX_KEYS];
+	List	   *exprs = NIL;
+	int			ncols = 0;
+	bool		unique = false;
+	int			ngroup;
+	int			sortmem;
+	double		reltuples;
+	int			i;
+
+	/*
+	 * Take indexes in order while they can't overflow the combined column
+	 * list, even if none of their columns are shared.
+	 */
+	for (ngroup = 0; ngroup < nindexes; ngroup++)
+	{
+		IndexInfo  *indexInfo = indexInfos[ngroup];
+		int			needed;
+
+		needed = indexInfo->ii_NumIndexAttrs +
+			(indexInfo->ii_Predicate != NIL ? 1 : 0);
+		if (ngroup > 0 && ncols + needed > INDEX_MAX_KEYS)
+			break;
+		ncols += needed;
+	}
+	ncols = 0;
+
+	state.nindexes = ngroup;
+	state.indexRels = indexRels;
+	state.btstates = (void **) palloc(ngroup * sizeof(void *));
+	state.colmap = (int **) palloc(ngroup * sizeof(int *));
+	state.predcol = (int *) palloc(ngroup * sizeof(int));
+
+	for (i = 0; i < ngroup; i++)
+	{
+		IndexInfo  *indexInfo = indexInfos[i];
+		ListCell   *indexpr_item = list_head(indexInfo->ii_Expressions);
+		int			j;
+
+		Assert(indexRels[i]->rd_rel->relam == BTREE_AM_OID);
+		Assert(indexInfo->ii_Predicate == NIL ||
+			   indexInfo->ii_Expressions == NIL);
+
+		state.colmap[i] = (int *) palloc(indexInfo->ii_NumIndexAttrs *
+										 sizeof(int));
+		for (j = 0; j < indexInfo->ii_NumIndexAttrs; j++)
+		{
+			AttrNumber	attnum = indexInfo->ii_IndexAttrNumbers[j];
+			Node	   *expr = NULL;
+
+			if (attnum == 0)
+			{
+				expr = (Node *) lfirst(indexpr_item);
+				indexpr_item = lnext(indexInfo->ii_Expressions, indexpr_item);
+			}
+			state.colmap[i][j] = index_build_multi_column(attnums, &exprs,
+														  &ncols, attnum,
+														  expr);
+		}
+
+		if (indexInfo->ii_Predicate != NIL)
+			state.predcol[i] =
+				index_build_multi_column(attnums, &exprs, &ncols, 0,
+										 (Node *) make_ands_explicit(indexInfo->ii_Predicate));
+		else
+			state.predcol[i] = -1;
+
+		if (indexInfo->ii_Unique || indexInfo->ii_ExclusionOps != NULL)
+			unique = true;
+	}
+
+	/*
+	 * The combined IndexInfo is used only to compute the columns, so all of
+	 * them are keys.  Claiming uniqueness if any index needs it makes the
+	 * scan wait out in-progress transactions as a unique build would.
+	 */
+	combined = makeIndexInfo(ncols, ncols, BTREE_AM_OID, exprs, NIL,
+							 unique, true, false);
+	memcpy(combined->ii_IndexAttrNumbers, attnums, ncols * sizeof(AttrNumber));
+
+	ereport(DEBUG1,
+			(errmsg_internal("building %d indexes on table \"%s\" with a single table scan",
+							 ngroup, RelationGetRelationName(heapRelation))));
+
+	/* Set up initial progress report status */
+	{
+		const int	progress_index[] = {
+			PROGRESS_CREATEIDX_PHASE,
+			PROGRESS_CREATEIDX_SUBPHASE,
+			PROGRESS_CREATEIDX_TUPLES_DONE,
+			PROGRESS_CREATEIDX_TUPLES_TOTAL,
+			PROGRESS_SCAN_BLOCKS_DONE,
+			PROGRESS_SCAN_BLOCKS_TOTAL
+		};
+		const int64 progress_vals[] = {
+			PROGRESS_CREATEIDX_PHASE_BUILD,
+			PROGRESS_BTREE_PHASE_INDEXBUILD_TABLESCAN,
+			0, 0, 0, 0
+		};
+
+		pgstat_progress_update_multi_param(6, progress_index, progress_vals);
+	}
+
+	sortmem = Max(maintenance_work_mem / ngroup, 64);
+	for (i = 0; i < ngroup; i++)
+		state.btstates[i] = btbuildbegin(heapRelation, indexRels[i],
+										 indexInfos[i], sortmem);
+
+	reltuples = table_index_build_scan(heapRelation, indexRels[0], combined,
+									   true, true,
+									   index_build_multi_callback,
+									   (void *) &state, NULL);
+
+	/* Reset the block number values set by table_index_build_scan */
+	{
+		const int	progress_index[] = {
+			PROGRESS_SCAN_BLOCKS_TOTAL,
+			PROGRESS_SCAN_BLOCKS_DONE
+		};
+		const int64 progress_vals[] = {
+			0, 0
+		};
+
+		pgstat_progress_update_multi_param(2, progress_index, progress_vals);
+	}
+
+	for (i = 0; i < ngroup; i++)
+	{
+		IndexBuildResult *stats;
+
+		stats = btbuildend(state.btstates[i], reltuples);
+
+		/* Broken HOT chains were found for all the indexes together */
+		indexInfos[i]->ii_BrokenHotChain = combined->ii_BrokenHotChain;
+
+		index_build_finish(heapRelation, indexRels[i], indexInfos[i], stats,
+						   true);
+	}
+
+	return ngroup;
+}
+
+/*
+ * Find or add a column of index_build_multi's combined IndexInfo: a plain
+ * table column if attnum is not zero, else the expression expr.
+ */
+static int
+index_build_multi_column(AttrNumber *attnums, List **exprs, int *ncols,
+						 AttrNumber attnum, Node *expr)
+{
+	ListCell   *lc = list_head(*exprs);
+	int			i;
+
+	for (i = 0; i < *ncols; i++)
+	{
+		if (attnums[i] != 0)
+		{
+			if (attnums[i] == attnum)
+				return i;
+		}
+		else
+		{
+			if (attnum == 0 && equal(lfirst(lc), expr))
+				return i;
+			lc = lnext(*exprs, lc);
+		}
+	}
+
+	Assert(*ncols < INDEX_MAX_KEYS);
+	attnums[*ncols] = attnum;
+	if (attnum == 0)
+		*exprs = lappend(*exprs, expr);
+
+	return (*ncols)++;
+}
+
+/*
+ * Per-tuple callback for index_build_multi's table scan
+ */
+static void
+index_build_multi_callback(Relation index,
+						   ItemPointer tid,
+						   Datum *values,
+						   bool *isnull,
+						   bool tupleIsAlive,
+						   void *state)
+{
+	MultiIndexBuildState *mstate = (MultiIndexBuildState *) state;
+	int			i;
+
+	for (i = 0; i < mstate->nindexes; i++)
+	{
+		int			natts = IndexRelationGetNumberOfAttributes(mstate->indexRels[i]);
+		int			predcol = mstate->predcol[i];
+		int			j;
+
+		/* Skip tuples that don't satisfy a partial index's predicate */
+		if (predcol >= 0 &&
+			(isnull[predcol] || !DatumGetBool(values[predcol])))
+			continue;
+
+		for (j = 0; j < natts; j++)
+		{
+			mstate->values[j] = values[mstate->colmap[i][j]];
+			mstate->isnull[j] = isnull[mstate->colmap[i][j]];
+		}
+
+		btbuildtuple(mstate->btstates[i], tid, mstate->values,
+					 mstate->isnull, tupleIsAlive);
+	}
+}
+
 /*
  * IndexCheckExclusion - verify that a new exclusion constraint is satisfied
  *
@@ -3220,6 +3628,8 @@ IndexCheckExclusion(Relation heapRelation,
  * TIDs, and finally scan the table doing a "merge join" against the TID list
  * to see which tuples are missing from the index.  Thus we will ensure that
  * all tuples valid according to the reference snapshot are in the index.
+ * If the planner thinks it worthwhile, the table scan is done by parallel
+ * workers, each handling the TIDs of a range of table blocks at a time.
  *
  * Building a unique index this way is tricky: we might try to insert a
  * tuple that is already dead or is in process of being deleted, and we
@@ -3250,6 +3660,7 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 	IndexInfo  *indexInfo;
 	IndexVacuumInfo ivinfo;
 	ValidateIndexState state;
+	int			nworkers = 0;
 	Oid			save_userid;
 	int			save_sec_context;
 	int			save_nestlevel;
@@ -3316,6 +3727,10 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 											InvalidOid, false,
 											maintenance_work_mem,
 											NULL, false);
+	state.tidfile = NULL;
+	state.ntids = 0;
+	state.startblock = 0;
+	state.numblocks = InvalidBlockNumber;
 	state.htups = state.itups = state.tups_inserted = 0;
 
 	/* ambulkdelete updates progress metrics */
@@ -3343,11 +3758,31 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 	 */
 	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
 								 PROGRESS_CREATEIDX_PHASE_VALIDATE_TABLESCAN);
-	table_index_validate_scan(heapRelation,
-							  indexRelation,
-							  indexInfo,
-							  snapshot,
-							  &state);
+
+	/*
+	 * Determine the number of parallel workers for the table scan.  Only
+	 * heap tables know how to scan just a part of the table for us.  Note
+	 * that planner considers parallel safety for us.
+	 */
+	if (IsNormalProcessingMode() &&
+		heapRelation->rd_rel->relam == HEAP_TABLE_AM_OID)
+		nworkers = plan_create_index_workers(heapId, indexId);
+
+	if (nworkers > 0)
+		ereport(DEBUG1,
+				(errmsg_internal("validating index \"%s\" on table \"%s\" with request for %d parallel workers",
+								 RelationGetRelationName(indexRelation),
+								 RelationGetRelationName(heapRelation),
+								 nworkers)));
+
+	if (nworkers == 0 ||
+		!validate_index_parallel(heapRelation, indexRelation, indexInfo,
+								 snapshot, &state, nworkers))
+		table_index_validate_scan(heapRelation,
+								  indexRelation,
+								  indexInfo,
+								  snapshot,
+								  &state);
 
 	/* Done with tuplesort object */
 	tuplesort_end(state.tuplesort);
@@ -3381,6 +3816,355 @@ validate_index_callback(ItemPointer itemptr, void *opaque)
 	return false;				/* never actually delete anything */
 }
 
+/*
+ * validate_index_next_tid - fetch the next index TID for the "merge"
+ *
+ * Returns false when there are no more TIDs, in the sorted order, for the
+ * part of the table being scanned.
+ */
+bool
+validate_index_next_tid(ValidateIndexState *state, ItemPointer tid)
+{
+	int64		encoded;
+
+	if (state->tidfile == NULL)
+	{
+		Datum		ts_val;
+		bool		ts_isnull;
+
+		if (!tuplesort_getdatum(state->tuplesort, true,
+								&ts_val, &ts_isnull, NULL))
+			return false;
+		Assert(!ts_isnull);
+		encoded = DatumGetInt64(ts_val);
+
+		/* If int8 is pass-by-ref, free (encoded) TID Datum memory */
+#ifndef USE_FLOAT8_BYVAL
+		pfree(DatumGetPointer(ts_val));
+#endif
+	}
+	else
+	{
+		size_t		nread;
+
+		if (state->ntids == 0)
+			return false;
+
+		nread = BufFileRead(state->tidfile, &encoded, sizeof(encoded));
+		if (nread != sizeof(encoded))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from index validation temporary file: read only %zu of %zu bytes",
+							nread, sizeof(encoded))));
+		state->ntids--;
+	}
+
+	itemptr_decode(tid, encoded);
+	return true;
+}
+
+/*
+ * validate_index_parallel - do validate_index's table scan in parallel
+ *
+ * request is the target number of parallel worker processes to launch.  The
+ * TIDs in state->tuplesort must already be sorted; on success, the
+ * statistics of all participants are added to *state.
+ *
+ * Returns false if parallel mode couldn't be set up, in which case the
+ * caller should do a serial scan.  Once we have started reading the sorted
+ * TIDs we always finish the job, even if no workers can be launched.
+ */
+static bool
+validate_index_parallel(Relation heapRelation,
+						Relation indexRelation,
+						IndexInfo *indexInfo,
+						Snapshot snapshot,
+						ValidateIndexState *state,
+						int request)
+{
+	ParallelContext *pcxt;
+	ValidateIndexShared *shared;
+	Size		estshared;
+	Size		estsnapshot;
+	char	   *sharedsnapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	BufFile    *tidfile;
+	ItemPointerData tid;
+	BlockNumber nblocks;
+	int			nchunks;
+	int			chunk;
+	int			querylen;
+
+	nblocks = RelationGetNumberOfBlocks(heapRelation);
+	nchunks = (request + 1) * VALIDATE_INDEX_CHUNKS_PER_PARTICIPANT;
+	if (nblocks < nchunks)
+		return false;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "validate_index_parallel_main",
+								 request);
+
+	/* Estimate the space for the shared state and the snapshot */
+	estshared = add_size(offsetof(ValidateIndexShared, chunks),
+						 mul_size(nchunks, sizeof(ValidateIndexChunk)));
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	estsnapshot = EstimateSnapshotSpace(snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsnapshot);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Estimate space for WalUsage and BufferUsage */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial scan) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = (ValidateIndexShared *) shm_toc_allocate(pcxt->toc, estshared);
+	shared->heaprelid = RelationGetRelid(heapRelation);
+	shared->indexrelid = RelationGetRelid(indexRelation);
+	shared->nchunks = nchunks;
+	SharedFileSetInit(&shared->fileset, pcxt->seg);
+	pg_atomic_init_u32(&shared->nextchunk, 0);
+	SpinLockInit(&shared->mutex);
+	shared->blocksdone = 0;
+	shared->htups = 0;
+	shared->tups_inserted = 0;
+	for (chunk = 0; chunk < nchunks; chunk++)
+	{
+		BlockNumber start = (uint64) nblocks * chunk / nchunks;
+		BlockNumber end = (uint64) nblocks * (chunk + 1) / nchunks;
+
+		shared->chunks[chunk].startblock = start;
+		shared->chunks[chunk].numblocks = end - start;
+		shared->chunks[chunk].ntids = 0;
+	}
+
+	/*
+	 * Write the sorted TIDs to the shared file, remembering where the TIDs of
+	 * each chunk start.  TIDs beyond the end of the table, if any, go with
+	 * the last chunk.
+	 */
+	tidfile = BufFileCreateFileSet(&shared->fileset.fs, "tids");
+	chunk = 0;
+	BufFileTell(tidfile, &shared->chunks[0].fileno,
+				&shared->chunks[0].offset);
+	while (validate_index_next_tid(state, &tid))
+	{
+		int64		encoded = itemptr_encode(&tid);
+
+		while (chunk + 1 < nchunks &&
+			   ItemPointerGetBlockNumber(&tid) >=
+			   shared->chunks[chunk + 1].startblock)
+		{
+			chunk++;
+			BufFileTell(tidfile, &shared->chunks[chunk].fileno,
+						&shared->chunks[chunk].offset);
+		}
+
+		BufFileWrite(tidfile, &encoded, sizeof(encoded));
+		shared->chunks[chunk].ntids++;
+	}
+	while (++chunk < nchunks)
+		BufFileTell(tidfile, &shared->chunks[chunk].fileno,
+					&shared->chunks[chunk].offset);
+	BufFileClose(tidfile);
+
+	sharedsnapshot = shm_toc_allocate(pcxt->toc, estsnapshot);
+	SerializeSnapshot(snapshot, sharedsnapshot);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_VALIDATE_SHARED, shared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_VALIDATE_SNAPSHOT, sharedsnapshot);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+
+	/*
+	 * Join the scan ourselves.  The leader always participates, which also
+	 * takes care of the case that no workers could be launched at all.
+	 */
+	pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL, nblocks);
+	validate_index_parallel_scan(shared, heapRelation, indexRelation,
+								 indexInfo, snapshot, true);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (int i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	state->htups += shared->htups;
+	state->tups_inserted += shared->tups_inserted;
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * Perform a participant's share of a parallel validate_index: claim chunks
+ * of the table one at a time, and "merge" each with its part of the sorted
+ * index TIDs.  If progress is true, report the number of blocks done.
+ */
+static void
+validate_index_parallel_scan(ValidateIndexShared *shared,
+							 Relation heapRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 bool progress)
+{
+	ValidateIndexState state;
+
+	state.tuplesort = NULL;
+	state.tidfile = BufFileOpenFileSet(&shared->fileset.fs, "tids",
+									   O_RDONLY, false);
+	state.htups = state.itups = state.tups_inserted = 0;
+
+	for (;;)
+	{
+		uint32		chunkno = pg_atomic_fetch_add_u32(&shared->nextchunk, 1);
+		ValidateIndexChunk *chunk;
+		BlockNumber blocksdone;
+
+		if (chunkno >= shared->nchunks)
+			break;
+		chunk = &shared->chunks[chunkno];
+
+		if (BufFileSeek(state.tidfile, chunk->fileno, chunk->offset,
+						SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in index validation temporary file")));
+		state.ntids = chunk->ntids;
+		state.startblock = chunk->startblock;
+		state.numblocks = chunk->numblocks;
+
+		table_index_validate_scan(heapRelation,
+								  indexRelation,
+								  indexInfo,
+								  snapshot,
+								  &state);
+
+		SpinLockAcquire(&shared->mutex);
+		shared->blocksdone += chunk->numblocks;
+		blocksdone = shared->blocksdone;
+		SpinLockRelease(&shared->mutex);
+
+		if (progress)
+			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+										 blocksdone);
+	}
+
+	BufFileClose(state.tidfile);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->htups += state.htups;
+	shared->tups_inserted += state.tups_inserted;
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+validate_index_parallel_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	ValidateIndexShared *shared;
+	Snapshot	snapshot;
+	Relation	heapRel;
+	Relation	indexRel;
+	IndexInfo  *indexInfo;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	shared = shm_toc_lookup(toc, PARALLEL_KEY_VALIDATE_SHARED, false);
+	SharedFileSetAttach(&shared->fileset, seg);
+
+	/* Open relations using lock modes known to be obtained by the leader */
+	heapRel = table_open(shared->heaprelid, ShareUpdateExclusiveLock);
+	indexRel = index_open(shared->indexrelid, RowExclusiveLock);
+
+	/* Fetch info needed for index_insert, as validate_index does */
+	indexInfo = BuildIndexInfo(indexRel);
+	indexInfo->ii_Concurrent = true;
+
+	snapshot = RestoreSnapshot(shm_toc_lookup(toc,
+											  PARALLEL_KEY_VALIDATE_SNAPSHOT,
+											  false));
+	snapshot = RegisterSnapshot(snapshot);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	validate_index_parallel_scan(shared, heapRel, indexRel, indexInfo,
+								 snapshot, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	UnregisterSnapshot(snapshot);
+
+	index_close(indexRel, RowExclusiveLock);
+	table_close(heapRel, ShareUpdateExclusiveLock);
+}
+
 /*
  * index_set_state_flags - adjust pg_index state flags
  *
@@ -3504,10 +4288,9 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
 				heapRelation;
 	Oid			heapId;
 	IndexInfo  *indexInfo;
-	volatile bool skipped_constraint = false;
+	bool		skipped_constraint;
 	PGRUsage	ru0;
 	bool		progress = ((params->options & REINDEXOPT_REPORT_PROGRESS) != 0);
-	bool		set_tablespace = false;
 
 	pg_rusage_init(&ru0);
 
@@ -3546,16 +4329,138 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
 		pgstat_progress_update_multi_param(2, progress_cols, progress_vals);
 	}
 
+	iRel = reindex_index_begin(heapRelation, indexId, skip_constraint_checks,
+							   params, &indexInfo, &skipped_constraint);
+
+	/* Suppress use of the target index while rebuilding it */
+	SetReindexProcessing(heapId, indexId);
+
+	/* Create a new physical relation for the index */
+	RelationSetNewRelfilenode(iRel, persistence);
+
+	/* Initialize the index and rebuild */
+	/* Note: we do not need to re-establish pkey setting */
+	index_build(heapRelation, iRel, indexInfo, true, true);
+
+	/* Re-allow use of target index */
+	ResetReindexProcessing();
+
+	reindex_index_finish(heapRelation, iRel, indexInfo, skipped_constraint,
+						 params, &ru0);
+
+	if (progress)
+		pgstat_progress_end_command();
+
+	/* Close rel, but keep lock */
+	table_close(heapRelation, NoLock);
+}
+
+/*
+ * reindex_index_multi - recreate several btree indexes of one table
+ *
+ * This is reindex_index for a list of btree indexes on heapRelation, which
+ * the caller has opened and locked, except that all the indexes are filled
+ * from a single scan of the table by index_build_multi.
+ */
+static void
+reindex_index_multi(Relation heapRelation, List *indexIds,
+					bool skip_constraint_checks, char persistence,
+					ReindexParams *params)
+{
+	Oid			heapId = RelationGetRelid(heapRelation);
+	int			nindexes = list_length(indexIds);
+	Relation   *iRels;
+	IndexInfo **indexInfos;
+	bool	   *skipped_constraints;
+	PGRUsage	ru0;
+	bool		progress = ((params->options & REINDEXOPT_REPORT_PROGRESS) != 0);
+	ListCell   *lc;
+	int			i;
+
+	pg_rusage_init(&ru0);
+
+	if (progress)
+	{
+		const int	progress_cols[] = {
+			PROGRESS_CREATEIDX_COMMAND,
+			PROGRESS_CREATEIDX_INDEX_OID
+		};
+		const int64 progress_vals[] = {
+			PROGRESS_CREATEIDX_COMMAND_REINDEX,
+			linitial_oid(indexIds)
+		};
+
+		pgstat_progress_start_command(PROGRESS_COMMAND_CREATE_INDEX,
+									  heapId);
+		pgstat_progress_update_multi_param(2, progress_cols, progress_vals);
+	}
+
+	iRels = (Relation *) palloc(nindexes * sizeof(Relation));
+	indexInfos = (IndexInfo **) palloc(nindexes * sizeof(IndexInfo *));
+	skipped_constraints = (bool *) palloc(nindexes * sizeof(bool));
+
+	i = 0;
+	foreach(lc, indexIds)
+	{
+		iRels[i] = reindex_index_begin(heapRelation, lfirst_oid(lc),
+									   skip_constraint_checks, params,
+									   &indexInfos[i],
+									   &skipped_constraints[i]);
+		i++;
+	}
+
+	/*
+	 * Suppress use of the target indexes while rebuilding them.  Only one of
+	 * them can be the current one; the others stay, or are put, on the
+	 * pending list until all of them are built.
+	 */
+	SetReindexProcessing(heapId, linitial_oid(indexIds));
+	for_each_from(lc, indexIds, 1)
+		AddReindexPending(lfirst_oid(lc));
+
+	/* Create new physical relations for the indexes */
+	for (i = 0; i < nindexes; i++)
+		RelationSetNewRelfilenode(iRels[i], persistence);
+
+	index_build_multi(heapRelation, nindexes, iRels, indexInfos);
+
+	/* Re-allow use of target indexes */
+	ResetReindexProcessing();
+	for_each_from(lc, indexIds, 1)
+		RemoveReindexPending(lfirst_oid(lc));
+
+	for (i = 0; i < nindexes; i++)
+		reindex_index_finish(heapRelation, iRels[i], indexInfos[i],
+							 skipped_constraints[i], params, &ru0);
+
+	if (progress)
+		pgstat_progress_end_command();
+}
+
+/*
+ * reindex_index_begin - open and check an index that is about to be rebuilt
+ *
+ * Also moves the index to its new tablespace, if requested, and returns its
+ * IndexInfo, without the uniqueness and exclusion checks if the caller asked
+ * to skip them (*skipped_constraint tells whether there were any).
+ */
+static Relation
+reindex_index_begin(Relation heapRelation, Oid indexId,
+					bool skip_constraint_checks, ReindexParams *params,
+					IndexInfo **indexInfo, bool *skipped_constraint)
+{
+	Relation	iRel;
+	bool		set_tablespace = false;
+
 	/*
 	 * Open the target index relation and get an exclusive lock on it, to
 	 * ensure that no one else is touching this particular index.
 	 */
 	iRel = index_open(indexId, AccessExclusiveLock);
 
-	if (progress)
+	if ((params->options & REINDEXOPT_REPORT_PROGRESS) != 0)
 		pgstat_progress_update_param(PROGRESS_CREATEIDX_ACCESS_METHOD_OID,
 									 iRel->rd_rel->relam);
-
 	/*
 	 * Partitioned indexes should never get processed here, as they have no
 	 * physical storage.
@@ -3636,31 +4541,35 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
 	TransferPredicateLocksToHeapRelation(iRel);
 
 	/* Fetch info needed for index_build */
-	indexInfo = BuildIndexInfo(iRel);
+	*indexInfo = BuildIndexInfo(iRel);
 
 	/* If requested, skip checking uniqueness/exclusion constraints */
+	*skipped_constraint = false;
 	if (skip_constraint_checks)
 	{
-		if (indexInfo->ii_Unique || indexInfo->ii_ExclusionOps != NULL)
-			skipped_constraint = true;
-		indexInfo->ii_Unique = false;
-		indexInfo->ii_ExclusionOps = NULL;
-		indexInfo->ii_ExclusionProcs = NULL;
-		indexInfo->ii_ExclusionStrats = NULL;
+		if ((*indexInfo)->ii_Unique || (*indexInfo)->ii_ExclusionOps != NULL)
+			*skipped_constraint = true;
+		(*indexInfo)->ii_Unique = false;
+		(*indexInfo)->ii_ExclusionOps = NULL;
+		(*indexInfo)->ii_ExclusionProcs = NULL;
+		(*indexInfo)->ii_ExclusionStrats = NULL;
 	}
 
-	/* Suppress use of the target index while rebuilding it */
-	SetReindexProcessing(heapId, indexId);
-
-	/* Create a new physical relation for the index */
-	RelationSetNewRelfilenode(iRel, persistence);
-
-	/* Initialize the index and rebuild */
-	/* Note: we do not need to re-establish pkey setting */
-	index_build(heapRelation, iRel, indexInfo, true, true);
+	return iRel;
+}
 
-	/* Re-allow use of target index */
-	ResetReindexProcessing();
+/*
+ * reindex_index_finish - clean up after an index rebuilt by reindex_index
+ *
+ * Fixes up the index's pg_index flags, reports what was done and closes the
+ * index, keeping the lock.
+ */
+static void
+reindex_index_finish(Relation heapRelation, Relation iRel,
+					 IndexInfo *indexInfo, bool skipped_constraint,
+					 ReindexParams *params, PGRUsage *ru0)
+{
+	Oid			indexId = RelationGetRelid(iRel);
 
 	/*
 	 * If the index is marked invalid/not-ready/dead (ie, it's from a failed
@@ -3746,14 +4655,10 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
 				(errmsg("index \"%s\" was reindexed",
 						get_rel_name(indexId)),
 				 errdetail_internal("%s",
-									pg_rusage_show(&ru0))));
+									pg_rusage_show(ru0))));
 
-	if (progress)
-		pgstat_progress_end_command();
-
-	/* Close rels, but keep locks */
+	/* Close rel, but keep lock */
 	index_close(iRel, NoLock);
-	table_close(heapRelation, NoLock);
 }
 
 /*
@@ -3787,9 +4692,12 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
  * REINDEX_REL_FORCE_INDEXES_PERMANENT: if true, set the persistence of the
  * rebuilt indexes to permanent.
  *
+ * The btree indexes of a user table are rebuilt together, from a single scan
+ * of the table (see index_build_multi), before the other indexes.
+ *
  * Returns true if any indexes were rebuilt (including toast table's index
  * when relevant).  Note that a CommandCounterIncrement will occur after each
- * index rebuild.
+ * index rebuild, or group of indexes rebuilt together.
  */
 bool
 reindex_relation(Oid relid, int flags, ReindexParams *params)
@@ -3797,6 +4705,7 @@ reindex_relation(Oid relid, int flags, ReindexParams *params)
 	Relation	rel;
 	Oid			toast_relid;
 	List	   *indexIds;
+	List	   *multiIds = NIL;
 	char		persistence;
 	bool		result;
 	ListCell   *indexId;
@@ -3857,12 +4766,67 @@ reindex_relation(Oid relid, int flags, ReindexParams *params)
 	else
 		persistence = rel->rd_rel->relpersistence;
 
+	/*
+	 * Pick out the btree indexes that can be built from a shared table scan.
+	 * That's not attempted for system catalogs, which must be careful about
+	 * which indexes can be used at each step.  A partial index on expressions
+	 * is left out, since its expressions must not be evaluated for the rows
+	 * its predicate excludes.
+	 */
+	if (!IsSystemRelation(rel) &&
+		rel->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		list_length(indexIds) > 1)
+	{
+		foreach(indexId, indexIds)
+		{
+			Oid			indexOid = lfirst_oid(indexId);
+			Relation	iRel;
+
+			/* Same lock as reindex_index will take */
+			iRel = index_open(indexOid, AccessExclusiveLock);
+
+			if (iRel->rd_rel->relam == BTREE_AM_OID &&
+				iRel->rd_rel->relkind == RELKIND_INDEX &&
+				(heap_attisnull(iRel->rd_indextuple, Anum_pg_index_indpred,
+								NULL) ||
+				 heap_attisnull(iRel->rd_indextuple, Anum_pg_index_indexprs,
+								NULL)))
+				multiIds = lappend_oid(multiIds, indexOid);
+
+			index_close(iRel, NoLock);
+		}
+
+		if (list_length(multiIds) < 2)
+			multiIds = NIL;
+	}
+
 	/* Reindex all the indexes. */
 	i = 1;
+	if (multiIds != NIL)
+	{
+		reindex_index_multi(rel, multiIds,
+							!(flags & REINDEX_REL_CHECK_CONSTRAINTS),
+							persistence, params);
+
+		CommandCounterIncrement();
+
+		i += list_length(multiIds);
+
+		/* Set index rebuild count */
+		pgstat_progress_update_param(PROGRESS_CLUSTER_INDEX_REBUILD_COUNT,
+									 i - 1);
+	}
+
 	foreach(indexId, indexIds)
 	{
 		Oid			indexOid = lfirst_oid(indexId);
-		Oid			indexNamespaceId = get_rel_namespace(indexOid);
+		Oid			indexNamespaceId;
+
+		/* Already rebuilt above? */
+		if (list_member_oid(multiIds, indexOid))
+			continue;
+
+		indexNamespaceId = get_rel_namespace(indexOid);
 
 		/*
 		 * Skip any invalid indexes on a TOAST table.  These can only be
@@ -4021,6 +4985,20 @@ SetReindexPending(List *indexes)
 	reindexingNestLevel = GetCurrentTransactionNestLevel();
 }
 
+/*
+ * AddReindexPending
+ *		Add the given index to the pending list, if it isn't there yet.
+ */
+static void
+AddReindexPending(Oid indexOid)
+{
+	if (IsInParallelMode())
+		elog(ERROR, "cannot modify reindex state during a parallel operation");
+	pendingReindexedIndexes = list_append_unique_oid(pendingReindexedIndexes,
+													 indexOid);
+	reindexingNestLevel = GetCurrentTransactionNestLevel();
+}
+
 /*
  * RemoveReindexPending
  *		Remove the given index from the pending list.
@@ -883,6 +883,23 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_io AS
+    SELECT
+            s.backend_type,
+            s.io_object,
+            s.io_context,
+            s.reads,
+            s.writes,
+            s.extends,
+            s.fsyncs,
+            s.hits,
+            s.read_time,
+            s.write_time,
+            s.read_histogram,
+            s.write_histogram,
+            s.stats_reset
+    FROM pg_stat_get_io() s;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -998,6 +1015,8 @@ CREATE VIEW pg_stat_database AS
             pg_stat_get_db_temp_files(D.oid) AS temp_files,
             pg_stat_get_db_temp_bytes(D.oid) AS temp_bytes,
             pg_stat_get_db_deadlocks(D.oid) AS deadlocks,
+            pg_stat_get_db_deadlock_checks(D.oid) AS deadlock_checks,
+            pg_stat_get_db_deadlock_check_time(D.oid) AS deadlock_check_time,
             pg_stat_get_db_checksum_failures(D.oid) AS checksum_failures,
             pg_stat_get_db_checksum_last_failure(D.oid) AS checksum_last_failure,
             pg_stat_get_db_blk_read_time(D.oid) AS blk_read_time,
@@ -1016,6 +1035,36 @@ CREATE VIEW pg_stat_database AS
         SELECT oid, datname FROM pg_database
     ) D;
 
+CREATE VIEW pg_stat_wait_events AS
+    SELECT
+            D.oid AS datid,
+            D.datname AS datname,
+            W.wait_event_type,
+            W.wait_event,
+            W.calls,
+            W.total_time
+    FROM (
+        SELECT 0 AS oid, NULL::name AS datname
+        UNION ALL
+        SELECT oid, datname FROM pg_database
+    ) D,
+        LATERAL pg_stat_get_db_wait_events(D.oid) W;
+
+CREATE VIEW pg_stat_wait_event_types AS
+    SELECT
+            D.oid AS datid,
+            D.datname AS datname,
+            W.wait_event_type,
+            W.calls,
+            W.total_time,
+            W.time_histogram
+    FROM (
+        SELECT 0 AS oid, NULL::name AS datname
+        UNION ALL
+        SELECT oid, datname FROM pg_database
+    ) D,
+        LATERAL pg_stat_get_db_wait_event_types(D.oid) W;
+
 CREATE VIEW pg_stat_database_conflicts AS
     SELECT
             D.oid AS datid,
@@ -1086,9 +1135,40 @@ CREATE VIEW pg_stat_wal AS
         w.wal_sync,
         w.wal_write_time,
         w.wal_sync_time,
+        w.wal_sync_histogram,
         w.stats_reset
     FROM pg_stat_get_wal() w;
 
+CREATE VIEW pg_stat_recovery_prefetch AS
+    SELECT
+        s.prefetch,
+        s.hit,
+        s.skip_init,
+        s.skip_new,
+        s.skip_fpw,
+        s.skip_rep,
+        s.wal_distance,
+        s.io_depth,
+        s.stats_reset
+    FROM pg_stat_get_recovery_prefetch() s;
+
+CREATE VIEW pg_stat_backend_profile AS
+    SELECT
+        S.datid,
+        D.datname,
+        S.queryid,
+        S.node_type,
+        S.wait_event_type,
+        S.wait_event,
+        S.samples
+    FROM pg_stat_get_backend_profile() S
+        LEFT JOIN pg_database D ON (S.datid = D.oid);
+
+REVOKE ALL ON pg_stat_backend_profile FROM PUBLIC;
+GRANT SELECT ON pg_stat_backend_profile TO pg_read_all_stats;
+REVOKE EXECUTE ON FUNCTION pg_stat_get_backend_profile() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_stat_get_backend_profile() TO pg_read_all_stats;
+
 CREATE VIEW pg_stat_progress_analyze AS
     SELECT
         S.pid AS pid, S.datid AS datid, D.datname AS datname,
@@ -105,7 +105,6 @@ static int	acquire_inherited_sample_rows(Relation onerel, int elevel,
 										  double *totalrows, double *totaldeadrows);
 static void update_attstats(Oid relid, bool inh,
 							int natts, VacAttrStats **vacattrstats);
-static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 static Datum ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 
 
@@ -548,10 +547,37 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	{
 		MemoryContext col_context,
 					old_context;
+		TupleTableSlot *slot = NULL;
+		Datum	   *colvalues = NULL;
+		bool	   *colnulls = NULL;
+		Size		groupsize;
+		int			groupstart = 0;
+		int			groupcnt = 0;
 
 		pgstat_progress_update_param(PROGRESS_ANALYZE_PHASE,
 									 PROGRESS_ANALYZE_PHASE_COMPUTE_STATS);
 
+		/*
+		 * Fetching a column with heap_getattr() has to walk over all the
+		 * preceding columns of the tuple once a variable-width or null one
+		 * is among them, which makes fetching the values of all columns
+		 * quadratic in the number of columns.  So instead deform the sample
+		 * rows once for a group of columns, and let the compute_stats
+		 * routines read the values from arrays, as for index expressions.
+		 * The group is sized so that the arrays fit in maintenance_work_mem.
+		 */
+		groupsize = ((Size) maintenance_work_mem * 1024) /
+			((Size) numrows * (sizeof(Datum) + sizeof(bool)));
+		groupsize = Min(groupsize, MaxAllocSize / ((Size) numrows * sizeof(Datum)));
+		groupsize = Max(groupsize, 1);
+		groupsize = Min(groupsize, attr_cnt);
+		if (attr_cnt > 0)
+		{
+			colvalues = (Datum *) palloc(numrows * groupsize * sizeof(Datum));
+			colnulls = (bool *) palloc(numrows * groupsize * sizeof(bool));
+			slot = MakeSingleTupleTableSlot(onerel->rd_att, &TTSOpsHeapTuple);
+		}
+
 		col_context = AllocSetContextCreate(anl_context,
 											"Analyze Column",
 											ALLOCSET_DEFAULT_SIZES);
@@ -562,10 +588,39 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 			VacAttrStats *stats = vacattrstats[i];
 			AttributeOpts *aopt;
 
+			/* Deform the rows for the next group of columns, if needed */
+			if (i == groupstart + groupcnt)
+			{
+				int			maxattnum = 0;
+
+				groupstart = i;
+				groupcnt = Min(groupsize, attr_cnt - i);
+				for (int j = 0; j < groupcnt; j++)
+					maxattnum = Max(maxattnum,
+									vacattrstats[groupstart + j]->tupattnum);
+
+				for (int row = 0; row < numrows; row++)
+				{
+					ExecStoreHeapTuple(rows[row], slot, false);
+					slot_getsomeattrs(slot, maxattnum);
+					for (int j = 0; j < groupcnt; j++)
+					{
+						int			attnum = vacattrstats[groupstart + j]->tupattnum;
+
+						colvalues[row * groupcnt + j] = slot->tts_values[attnum - 1];
+						colnulls[row * groupcnt + j] = slot->tts_isnull[attnum - 1];
+					}
+				}
+				ExecClearTuple(slot);
+			}
+
 			stats->rows = rows;
 			stats->tupDesc = onerel->rd_att;
+			stats->exprvals = colvalues + (i - groupstart);
+			stats->exprnulls = colnulls + (i - groupstart);
+			stats->rowstride = groupcnt;
 			stats->compute_stats(stats,
-								 std_fetch_func,
+								 ind_fetch_func,
 								 numrows,
 								 totalrows);
 
@@ -595,6 +650,13 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 		MemoryContextSwitchTo(old_context);
 		MemoryContextDelete(col_context);
 
+		if (slot)
+		{
+			ExecDropSingleTupleTableSlot(slot);
+			pfree(colvalues);
+			pfree(colnulls);
+		}
+
 		/*
 		 * Emit the completed stats rows into pg_statistic, replacing any
 		 * previous statistics for the target columns.  (If there are stats in
@@ -1755,26 +1817,13 @@ update_attstats(Oid relid, bool inh, int natts, VacAttrStats **vacattrstats)
 }
 
 /*
- * Standard fetch function for use by compute_stats subroutines.
+ * Fetch function for use by compute_stats subroutines.
  *
  * This exists to provide some insulation between compute_stats routines
- * and the actual storage of the sample data.
- */
-static Datum
-std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull)
-{
-	int			attnum = stats->tupattnum;
-	HeapTuple	tuple = stats->rows[rownum];
-	TupleDesc	tupDesc = stats->tupDesc;
-
-	return heap_getattr(tuple, attnum, tupDesc, isNull);
-}
-
-/*
- * Fetch function for analyzing index expressions.
- *
- * We have not bothered to construct index tuples, instead the data is
- * just in Datum arrays.
+ * and the actual storage of the sample data.  Both table columns and index
+ * expressions are analyzed from Datum arrays, filled in by do_analyze_rel()
+ * and compute_index_stats() respectively; we have not bothered to construct
+ * index tuples for the latter.
  */
 static Datum
 ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull)
@@ -24,8 +24,13 @@
  *	  All notification messages are placed in the queue and later read out
  *	  by listening backends.
  *
- *	  There is no central knowledge of which backend listens on which channel;
- *	  every backend has its own list of interesting channels.
+ *	  Every backend has its own list of interesting channels.  In addition,
+ *	  each listening backend advertises hashes of (up to
+ *	  NOTIFY_LISTENER_CHANNELS of) its channel names in shared memory, so
+ *	  that senders can tell which backends might be interested in their
+ *	  notifications.  This index is only a hint: a backend can be woken for
+ *	  a notification it does not want (hash collision, or channels being
+ *	  added or removed), and then just ignores it.
  *
  *	  Although there is only one queue, notifications are treated as being
  *	  database-local; this is done by including the sender's database OID
@@ -72,12 +77,14 @@
  *	  Then we signal any backends that may be interested in our messages
  *	  (including our own backend, if listening).  This is done by
  *	  SignalBackends(), which scans the list of listening backends and sends a
- *	  PROCSIG_NOTIFY_INTERRUPT signal to every listening backend (we don't
- *	  know which backend is listening on which channel so we must signal them
- *	  all).  We can exclude backends that are already up to date, though, and
- *	  we can also exclude backends that are in other databases (unless they
- *	  are way behind and should be kicked to make them advance their
- *	  pointers).
+ *	  PROCSIG_NOTIFY_INTERRUPT signal to every listening backend in our
+ *	  database whose advertised channels match one of the channels we
+ *	  notified.  We can exclude backends that are already up to date, and
+ *	  backends that are in other databases or are not interested in our
+ *	  channels (unless they are way behind and should be kicked to make them
+ *	  advance their pointers).  A backend that is not interested and had
+ *	  already read everything up to the start of our notifications has its
+ *	  pointer advanced past them directly, without being woken at all.
  *
  *	  Finally, after we are out of the transaction altogether and about to go
  *	  idle, we scan the queue for messages that need to be sent to our
@@ -117,7 +124,7 @@
  * frontend during startup.)  The above design guarantees that notifies from
  * other backends will never be missed by ignoring self-notifies.
  *
- * The amount of shared memory used for notify management (NUM_NOTIFY_BUFFERS)
+ * The amount of shared memory used for notify management (notify_buffers)
  * can be varied without affecting anything but performance.  The maximum
  * amount of notification data that can be queued at one time is determined
  * by slru.c's wraparound limit; see QUEUE_MAX_PAGE below.
@@ -141,6 +148,7 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
@@ -235,13 +243,25 @@ typedef struct QueuePosition
  *
  * Resist the temptation to make this really large.  While that would save
  * work in some places, it would add cost in others.  In particular, this
- * should likely be less than NUM_NOTIFY_BUFFERS, to ensure that backends
+ * should likely be less than notify_buffers, to ensure that backends
  * catch up before the pages they'll need to read fall out of SLRU cache.
  */
 #define QUEUE_CLEANUP_DELAY 4
 
+/*
+ * Number of channel name hashes a listening backend advertises in shared
+ * memory.  A backend listening on more channels than this is treated as
+ * interested in every notification in its database.  The same limit applies
+ * to the distinct channels notified by one transaction; beyond it, all
+ * listeners in the database are signaled.
+ */
+#define NOTIFY_LISTENER_CHANNELS 16
+
 /*
  * Struct describing a listening backend's status
+ *
+ * nchannels is the number of valid entries in channels[], or -1 if the
+ * backend listens on too many channels to advertise them all.
  */
 typedef struct QueueBackendStatus
 {
@@ -249,6 +269,8 @@ typedef struct QueueBackendStatus
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
 	BackendId	nextListener;	/* id of next listener, or InvalidBackendId */
 	QueuePosition pos;			/* backend has read queue up to here */
+	int			nchannels;		/* number of channel hashes, or -1 */
+	uint32		channels[NOTIFY_LISTENER_CHANNELS]; /* channel name hashes */
 } QueueBackendStatus;
 
 /*
@@ -263,7 +285,9 @@ typedef struct QueueBackendStatus
  * (since no other backend will inspect it).
  *
  * When holding NotifyQueueLock in EXCLUSIVE mode, backends can inspect the
- * entries of other backends and also change the head pointer. When holding
+ * entries of other backends and also change the head pointer.  A sender
+ * holding EXCLUSIVE lock may also advance another backend's pos past the
+ * sender's own notifications (see SignalBackends).  When holding
  * both NotifyQueueLock and NotifyQueueTailLock in EXCLUSIVE mode, backends
  * can change the tail pointers.
  *
@@ -304,6 +328,8 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_NCHANNELS(i)	(asyncQueueControl->backend[i].nchannels)
+#define QUEUE_BACKEND_CHANNELS(i)	(asyncQueueControl->backend[i].channels)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -421,6 +447,18 @@ typedef struct NotificationHash
 
 static NotificationList *pendingNotifies = NULL;
 
+/*
+ * Summary of the notifications we queued in PreCommit_Notify, for use by
+ * SignalBackends: the hashes of the distinct channel names (numNotifyChannels
+ * is -1 if there were more than NOTIFY_LISTENER_CHANNELS of them), and the
+ * queue range our entries occupy.  Since writers are serialized, nothing but
+ * our own entries lies between notifyStartPos and notifyEndPos.
+ */
+static uint32 notifyChannels[NOTIFY_LISTENER_CHANNELS];
+static int	numNotifyChannels = 0;
+static QueuePosition notifyStartPos;
+static QueuePosition notifyEndPos;
+
 /*
  * Inbound notifications are initially processed by HandleNotifyInterrupt(),
  * called from inside a signal handler. That just sets the
@@ -452,6 +490,10 @@ static void Exec_ListenCommit(const char *channel);
 static void Exec_UnlistenCommit(const char *channel);
 static void Exec_UnlistenAllCommit(void);
 static bool IsListeningOn(const char *channel);
+static uint32 channel_hash(const char *channel);
+static int	add_channel_hash(uint32 *hashes, int nhashes, uint32 hash);
+static void asyncQueueAdvertiseChannels(bool includePending);
+static bool asyncQueueBackendInterested(BackendId i);
 static void asyncQueueUnregister(void);
 static bool asyncQueueIsFull(void);
 static bool asyncQueueAdvance(volatile QueuePosition *position, int entryLength);
@@ -521,7 +563,7 @@ AsyncShmemSize(void)
 	size = mul_size(MaxBackends + 1, sizeof(QueueBackendStatus));
 	size = add_size(size, offsetof(AsyncQueueControl, backend));
 
-	size = add_size(size, SimpleLruShmemSize(NUM_NOTIFY_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(notify_buffers, 0));
 
 	return size;
 }
@@ -562,6 +604,7 @@ AsyncShmemInit(void)
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			QUEUE_NEXT_LISTENER(i) = InvalidBackendId;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			QUEUE_BACKEND_NCHANNELS(i) = 0;
 		}
 	}
 
@@ -569,7 +612,7 @@ AsyncShmemInit(void)
 	 * Set up SLRU management of the pg_notify data.
 	 */
 	NotifyCtl->PagePrecedes = asyncQueuePagePrecedes;
-	SimpleLruInit(NotifyCtl, "Notify", NUM_NOTIFY_BUFFERS, 0,
+	SimpleLruInit(NotifyCtl, "Notify", notify_buffers, 0,
 				  NotifySLRULock, "pg_notify", LWTRANCHE_NOTIFY_BUFFER,
 				  SYNC_HANDLER_NONE);
 
@@ -774,6 +817,7 @@ Async_Listen(const char *channel)
 	if (Trace_notify)
 		elog(DEBUG1, "Async_Listen(%s,%d)", channel, MyProcPid);
 
+	PinPooledSession("LISTEN");
 	queue_listen(LISTEN_LISTEN, channel);
 }
 
@@ -905,6 +949,13 @@ PreCommit_Notify(void)
 	/* Preflight for any pending listen/unlisten actions */
 	if (pendingActions != NULL)
 	{
+		/*
+		 * Advertise the channels we're about to listen on before registering
+		 * as a listener, so that no sender can see us registered without
+		 * them and skip us over its notifications.
+		 */
+		asyncQueueAdvertiseChannels(true);
+
 		foreach(p, pendingActions->actions)
 		{
 			ListenAction *actrec = (ListenAction *) lfirst(p);
@@ -937,6 +988,22 @@ PreCommit_Notify(void)
 		 */
 		(void) GetCurrentTransactionId();
 
+		/*
+		 * Collect the hashes of the channels we notify, for SignalBackends.
+		 * Like the XID, these are computed before taking any locks.
+		 */
+		numNotifyChannels = 0;
+		foreach(p, pendingNotifies->events)
+		{
+			Notification *n = (Notification *) lfirst(p);
+
+			numNotifyChannels = add_channel_hash(notifyChannels,
+												 numNotifyChannels,
+												 channel_hash(n->data));
+			if (numNotifyChannels < 0)
+				break;
+		}
+
 		/*
 		 * Serialize writers by acquiring a special lock that we hold till
 		 * after commit.  This ensures that queue entries appear in commit
@@ -973,12 +1040,15 @@ PreCommit_Notify(void)
 			 * point in time we can still roll the transaction back.
 			 */
 			LWLockAcquire(NotifyQueueLock, LW_EXCLUSIVE);
+			if (nextNotify == list_head(pendingNotifies->events))
+				notifyStartPos = QUEUE_HEAD;
 			asyncQueueFillWarning();
 			if (asyncQueueIsFull())
 				ereport(ERROR,
 						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 						 errmsg("too many notifications in the NOTIFY queue")));
 			nextNotify = asyncQueueAddEntries(nextNotify);
+			notifyEndPos = QUEUE_HEAD;
 			LWLockRelease(NotifyQueueLock);
 		}
 
@@ -1038,6 +1108,11 @@ AtCommit_Notify(void)
 	/* If no longer listening to anything, get out of listener array */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (pendingActions != NULL)
+	{
+		/* Stop advertising any channels we unlistened */
+		asyncQueueAdvertiseChannels(false);
+	}
 
 	/*
 	 * Send signals to listening backends.  We need do this only if there are
@@ -1257,6 +1332,115 @@ IsListeningOn(const char *channel)
 	return false;
 }
 
+/*
+ * Hash a channel name for the shared listener channel index.
+ */
+static uint32
+channel_hash(const char *channel)
+{
+	return DatumGetUInt32(hash_any((const unsigned char *) channel,
+								   strlen(channel)));
+}
+
+/*
+ * Add hash to the set of nhashes channel hashes in hashes[], unless it's
+ * already present, and return the new size of the set.  The array has room
+ * for NOTIFY_LISTENER_CHANNELS entries; if the set would overflow that, or
+ * nhashes is already -1, return -1.
+ */
+static int
+add_channel_hash(uint32 *hashes, int nhashes, uint32 hash)
+{
+	if (nhashes < 0)
+		return -1;
+
+	for (int i = 0; i < nhashes; i++)
+	{
+		if (hashes[i] == hash)
+			return nhashes;
+	}
+
+	if (nhashes >= NOTIFY_LISTENER_CHANNELS)
+		return -1;
+
+	hashes[nhashes] = hash;
+	return nhashes + 1;
+}
+
+/*
+ * Publish the hashes of the channels we listen on in our shared status
+ * entry.  If includePending is true, also include the channels of pending
+ * LISTEN actions of the current transaction, which are not yet in
+ * listenChannels.
+ *
+ * Advertising a channel we turn out not to listen on only causes spurious
+ * wakeups, whereas failing to advertise one could make senders skip us, so
+ * new channels are advertised before commit and removed channels only after.
+ */
+static void
+asyncQueueAdvertiseChannels(bool includePending)
+{
+	uint32		hashes[NOTIFY_LISTENER_CHANNELS];
+	int			nhashes = 0;
+	ListCell   *p;
+
+	foreach(p, listenChannels)
+	{
+		char	   *lchan = (char *) lfirst(p);
+
+		nhashes = add_channel_hash(hashes, nhashes, channel_hash(lchan));
+	}
+
+	if (includePending && pendingActions != NULL)
+	{
+		foreach(p, pendingActions->actions)
+		{
+			ListenAction *actrec = (ListenAction *) lfirst(p);
+
+			if (actrec->action == LISTEN_LISTEN)
+				nhashes = add_channel_hash(hashes, nhashes,
+										   channel_hash(actrec->channel));
+		}
+	}
+
+	/*
+	 * Nobody else looks at our entry while we hold the lock in shared mode,
+	 * so that's enough to update it.
+	 */
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	QUEUE_BACKEND_NCHANNELS(MyBackendId) = nhashes;
+	if (nhashes > 0)
+		memcpy(QUEUE_BACKEND_CHANNELS(MyBackendId), hashes,
+			   nhashes * sizeof(uint32));
+	LWLockRelease(NotifyQueueLock);
+}
+
+/*
+ * Might listening backend i be interested in the notifications we queued?
+ *
+ * Caller must hold NotifyQueueLock in exclusive mode, and must have checked
+ * that the backend is in our database.
+ */
+static bool
+asyncQueueBackendInterested(BackendId i)
+{
+	int			nchannels = QUEUE_BACKEND_NCHANNELS(i);
+	uint32	   *channels = QUEUE_BACKEND_CHANNELS(i);
+
+	if (nchannels < 0 || numNotifyChannels < 0)
+		return true;
+
+	for (int j = 0; j < numNotifyChannels; j++)
+	{
+		for (int k = 0; k < nchannels; k++)
+		{
+			if (channels[k] == notifyChannels[j])
+				return true;
+		}
+	}
+	return false;
+}
+
 /*
  * Remove our entry from the listeners array when we are no longer listening
  * on any channel.  NB: must not fail if we're already not listening.
@@ -1276,6 +1460,7 @@ asyncQueueUnregister(void)
 	/* Mark our entry as invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	QUEUE_BACKEND_NCHANNELS(MyBackendId) = 0;
 	/* and remove it from the list */
 	if (QUEUE_FIRST_LISTENER == MyBackendId)
 		QUEUE_FIRST_LISTENER = QUEUE_NEXT_LISTENER(MyBackendId);
@@ -1614,11 +1799,14 @@ asyncQueueFillWarning(void)
 /*
  * Send signals to listening backends.
  *
- * Normally we signal only backends in our own database, since only those
- * backends could be interested in notifies we send.  However, if there's
- * notify traffic in our database but no traffic in another database that
- * does have listener(s), those listeners will fall further and further
- * behind.  Waken them anyway if they're far enough behind, so that they'll
+ * Normally we signal only backends in our own database that advertise one
+ * of the channels we notified, since only those backends could be interested
+ * in notifies we send.  However, if there's notify traffic in our database
+ * but no traffic in another database (or on the channels some backend listens
+ * on), those listeners will fall further and further behind.  If such a
+ * backend's pointer is exactly at the start of our notifications, we just
+ * move it past them, which is safe because nothing else lies in between.
+ * Otherwise waken them anyway if they're far enough behind, so that they'll
  * advance their queue position pointers, allowing the global tail to advance.
  *
  * Since we know the BackendId and the Pid the signaling is quite cheap.
@@ -1653,21 +1841,29 @@ SignalBackends(void)
 
 		Assert(pid != InvalidPid);
 		pos = QUEUE_BACKEND_POS(i);
-		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+
+		/* Skip listeners that are already caught up */
+		if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
+			continue;
+
+		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId &&
+			asyncQueueBackendInterested(i))
 		{
-			/*
-			 * Always signal listeners in our own database, unless they're
-			 * already caught up (unlikely, but possible).
-			 */
-			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
-				continue;
+			/* Always signal interested listeners in our own database */
 		}
 		else
 		{
 			/*
-			 * Listeners in other databases should be signaled only if they
-			 * are far behind.
+			 * Other listeners can't want any of our notifications.  If they
+			 * have read everything before them, skip them over ours.
 			 */
+			if (QUEUE_POS_EQUAL(pos, notifyStartPos))
+			{
+				pos = notifyEndPos;
+				QUEUE_BACKEND_POS(i) = pos;
+			}
+
+			/* And signal them only if they are far behind */
 			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
 								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
 				continue;
@@ -1726,6 +1922,11 @@ AtAbort_Notify(void)
 	 */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (pendingActions != NULL)
+	{
+		/* Forget channels advertised for the aborted LISTENs */
+		asyncQueueAdvertiseChannels(false);
+	}
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
@@ -68,9 +68,11 @@ typedef struct
 } RelToCluster;
 
 
-static void rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose);
+static void rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose,
+							 LOCKMODE lockmode);
 static void copy_table_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
-							bool verbose, bool *pSwapToastByContent,
+							bool verbose, LOCKMODE lockmode,
+							bool *pSwapToastByContent,
 							TransactionId *pFreezeXid, MultiXactId *pCutoffMulti);
 static List *get_tables_to_cluster(MemoryContext cluster_context);
 
@@ -105,6 +107,7 @@ cluster(ParseState *pstate, ClusterStmt *stmt, bool isTopLevel)
 	ListCell   *lc;
 	ClusterParams params = {0};
 	bool		verbose = false;
+	bool		allow_reads = false;
 
 	/* Parse option list */
 	foreach(lc, stmt->params)
@@ -113,6 +116,8 @@ cluster(ParseState *pstate, ClusterStmt *stmt, bool isTopLevel)
 
 		if (strcmp(opt->defname, "verbose") == 0)
 			verbose = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "allow_reads") == 0)
+			allow_reads = defGetBoolean(opt);
 		else
 			ereport(ERROR,
 					(errcode(ERRCODE_SYNTAX_ERROR),
@@ -121,7 +126,8 @@ cluster(ParseState *pstate, ClusterStmt *stmt, bool isTopLevel)
 					 parser_errposition(pstate, opt->location)));
 	}
 
-	params.options = (verbose ? CLUOPT_VERBOSE : 0);
+	params.options = (verbose ? CLUOPT_VERBOSE : 0) |
+		(allow_reads ? CLUOPT_ALLOW_READS : 0);
 
 	if (stmt->relation != NULL)
 	{
@@ -130,8 +136,12 @@ cluster(ParseState *pstate, ClusterStmt *stmt, bool isTopLevel)
 					indexOid = InvalidOid;
 		Relation	rel;
 
-		/* Find, lock, and check permissions on the table */
+		/*
+		 * Find, lock, and check permissions on the table.  If reads are to
+		 * be allowed, cluster_rel takes the stronger lock when it's needed.
+		 */
 		tableOid = RangeVarGetRelidExtended(stmt->relation,
+											allow_reads ? ExclusiveLock :
 											AccessExclusiveLock,
 											0,
 											RangeVarCallbackOwnsTable, NULL);
@@ -279,6 +289,15 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 	Relation	OldHeap;
 	bool		verbose = ((params->options & CLUOPT_VERBOSE) != 0);
 	bool		recheck = ((params->options & CLUOPT_RECHECK) != 0);
+	LOCKMODE	lockmode = AccessExclusiveLock;
+
+	/*
+	 * If asked to, let other sessions keep reading the table while its data
+	 * is copied.  System catalogs always get the full lock.
+	 */
+	if ((params->options & CLUOPT_ALLOW_READS) != 0 &&
+		!IsCatalogRelationOid(tableOid))
+		lockmode = ExclusiveLock;
 
 	/* Check for user-requested abort. */
 	CHECK_FOR_INTERRUPTS();
@@ -297,7 +316,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 	 * case, since cluster() already did it.)  The index lock is taken inside
 	 * check_index_is_clusterable.
 	 */
-	OldHeap = try_relation_open(tableOid, AccessExclusiveLock);
+	OldHeap = try_relation_open(tableOid, lockmode);
 
 	/* If the table has gone away, we can skip processing it */
 	if (!OldHeap)
@@ -319,7 +338,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 		/* Check that the user still owns the relation */
 		if (!pg_class_ownercheck(tableOid, GetUserId()))
 		{
-			relation_close(OldHeap, AccessExclusiveLock);
+			relation_close(OldHeap, lockmode);
 			pgstat_progress_end_command();
 			return;
 		}
@@ -334,7 +353,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 		 */
 		if (RELATION_IS_OTHER_TEMP(OldHeap))
 		{
-			relation_close(OldHeap, AccessExclusiveLock);
+			relation_close(OldHeap, lockmode);
 			pgstat_progress_end_command();
 			return;
 		}
@@ -346,7 +365,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 			 */
 			if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(indexOid)))
 			{
-				relation_close(OldHeap, AccessExclusiveLock);
+				relation_close(OldHeap, lockmode);
 				pgstat_progress_end_command();
 				return;
 			}
@@ -356,7 +375,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 			 */
 			if (!get_index_isclustered(indexOid))
 			{
-				relation_close(OldHeap, AccessExclusiveLock);
+				relation_close(OldHeap, lockmode);
 				pgstat_progress_end_command();
 				return;
 			}
@@ -398,7 +417,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 
 	/* Check heap and index are valid to cluster on */
 	if (OidIsValid(indexOid))
-		check_index_is_clusterable(OldHeap, indexOid, recheck, AccessExclusiveLock);
+		check_index_is_clusterable(OldHeap, indexOid, recheck, lockmode);
 
 	/*
 	 * Quietly ignore the request if this is a materialized view which has not
@@ -410,7 +429,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 	if (OldHeap->rd_rel->relkind == RELKIND_MATVIEW &&
 		!RelationIsPopulated(OldHeap))
 	{
-		relation_close(OldHeap, AccessExclusiveLock);
+		relation_close(OldHeap, lockmode);
 		pgstat_progress_end_command();
 		return;
 	}
@@ -424,7 +443,7 @@ cluster_rel(Oid tableOid, Oid indexOid, ClusterParams *params)
 	TransferPredicateLocksToHeapRelation(OldHeap);
 
 	/* rebuild_relation does all the dirty work */
-	rebuild_relation(OldHeap, indexOid, verbose);
+	rebuild_relation(OldHeap, indexOid, verbose, lockmode);
 
 	/* NB: rebuild_relation does table_close() on OldHeap */
 
@@ -569,13 +588,18 @@ mark_index_clustered(Relation rel, Oid indexOid, bool is_internal)
  *
  * OldHeap: table to rebuild --- must be opened and exclusive-locked!
  * indexOid: index to cluster by, or InvalidOid to rewrite in physical order.
+ * lockmode: lock held on OldHeap.  If it is weaker than AccessExclusiveLock,
+ * concurrent reads are allowed while the data is copied, and the lock is
+ * upgraded before the new copy is swapped in.
  *
  * NB: this routine closes OldHeap at the right time; caller should not.
  */
 static void
-rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose)
+rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose,
+				 LOCKMODE lockmode)
 {
 	Oid			tableOid = RelationGetRelid(OldHeap);
+	Oid			toastOid = OldHeap->rd_rel->reltoastrelid;
 	Oid			accessMethod = OldHeap->rd_rel->relam;
 	Oid			tableSpace = OldHeap->rd_rel->reltablespace;
 	Oid			OIDNewHeap;
@@ -600,12 +624,32 @@ rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose)
 	OIDNewHeap = make_new_heap(tableOid, tableSpace,
 							   accessMethod,
 							   relpersistence,
-							   AccessExclusiveLock);
+							   lockmode);
 
 	/* Copy the heap data into the new table in the desired order */
-	copy_table_data(OIDNewHeap, tableOid, indexOid, verbose,
+	copy_table_data(OIDNewHeap, tableOid, indexOid, verbose, lockmode,
 					&swap_toast_by_content, &frozenXid, &cutoffMulti);
 
+	/*
+	 * If readers were let in while the data was copied, wait for them to
+	 * finish now.  Nobody can have modified the table meanwhile, but the swap
+	 * and the index rebuilds need it to ourselves.  Serializable readers may
+	 * have taken new predicate locks on tuples that are about to move, so
+	 * promote those to relation locks too.
+	 */
+	if (lockmode != AccessExclusiveLock)
+	{
+		Relation	rel;
+
+		LockRelationOid(tableOid, AccessExclusiveLock);
+		if (OidIsValid(toastOid))
+			LockRelationOid(toastOid, AccessExclusiveLock);
+
+		rel = table_open(tableOid, NoLock);
+		TransferPredicateLocksToHeapRelation(rel);
+		table_close(rel, NoLock);
+	}
+
 	/*
 	 * Swap the physical files of the target and transient tables, then
 	 * rebuild the target's indexes and throw away the transient table.
@@ -748,6 +792,9 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace, Oid NewAccessMethod,
 /*
  * Do the physical copying of table data.
  *
+ * lockmode is the lock held on the old heap, which is also taken on its
+ * index and toast table.
+ *
  * There are three output parameters:
  * *pSwapToastByContent is set true if toast tables must be swapped by content.
  * *pFreezeXid receives the TransactionId used as freeze cutoff point.
@@ -755,8 +802,8 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace, Oid NewAccessMethod,
  */
 static void
 copy_table_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
-				bool *pSwapToastByContent, TransactionId *pFreezeXid,
-				MultiXactId *pCutoffMulti)
+				LOCKMODE lockmode, bool *pSwapToastByContent,
+				TransactionId *pFreezeXid, MultiXactId *pCutoffMulti)
 {
 	Relation	NewHeap,
 				OldHeap,
@@ -784,9 +831,9 @@ copy_table_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	 * Open the relations we need.
 	 */
 	NewHeap = table_open(OIDNewHeap, AccessExclusiveLock);
-	OldHeap = table_open(OIDOldHeap, AccessExclusiveLock);
+	OldHeap = table_open(OIDOldHeap, lockmode);
 	if (OidIsValid(OIDOldIndex))
-		OldIndex = index_open(OIDOldIndex, AccessExclusiveLock);
+		OldIndex = index_open(OIDOldIndex, lockmode);
 	else
 		OldIndex = NULL;
 
@@ -815,7 +862,7 @@ copy_table_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	 * will be held till end of transaction.
 	 */
 	if (OldHeap->rd_rel->reltoastrelid)
-		LockRelationOid(OldHeap->rd_rel->reltoastrelid, AccessExclusiveLock);
+		LockRelationOid(OldHeap->rd_rel->reltoastrelid, lockmode);
 
 	/*
 	 * If both tables have TOAST tables, perform toast swap by content.  It is
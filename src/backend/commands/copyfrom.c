@@ -65,12 +65,21 @@
 #define MAX_BUFFERED_TUPLES		1000
 
 /*
- * Flush buffers if there are >= this many bytes, as counted by the input
- * size, of tuples stored.
+ * Flush a buffer if there are >= this many bytes, as counted by the input
+ * size, of tuples stored in it.
  */
 #define MAX_BUFFERED_BYTES		65535
 
-/* Trim the list of buffers back down to this number after flushing */
+/*
+ * Flush all buffers if there are >= this many bytes stored in them together.
+ * This bounds the memory used when many partitions are being loaded at once.
+ */
+#define MAX_TOTAL_BUFFERED_BYTES	(MAX_BUFFERED_BYTES * 16)
+
+/*
+ * Keep no more than this many buffers; beyond that, the least recently used
+ * one is flushed and freed to make room for a new one.
+ */
 #define MAX_PARTITION_BUFFERS	32
 
 /* Stores multi-insert data related to a single relation in CopyFrom. */
@@ -80,6 +89,7 @@ typedef struct CopyMultiInsertBuffer
 	ResultRelInfo *resultRelInfo;	/* ResultRelInfo for 'relid' */
 	BulkInsertState bistate;	/* BulkInsertState for this rel */
 	int			nused;			/* number of 'slots' containing tuples */
+	int			bufferedBytes;	/* number of bytes from tuples in 'slots' */
 	uint64		linenos[MAX_BUFFERED_TUPLES];	/* Line # of tuple in copy
 												 * stream */
 } CopyMultiInsertBuffer;
@@ -87,7 +97,8 @@ typedef struct CopyMultiInsertBuffer
 /*
  * Stores one or many CopyMultiInsertBuffers and details about the size and
  * number of tuples which are stored in them.  This allows multiple buffers to
- * exist at once when COPYing into a partitioned table.
+ * exist at once when COPYing into a partitioned table.  The list of buffers
+ * is kept in order of last use, least recently used first.
  */
 typedef struct CopyMultiInsertInfo
 {
@@ -105,6 +116,10 @@ typedef struct CopyMultiInsertInfo
 static char *limit_printout_length(const char *str);
 
 static void ClosePipeFromProgram(CopyFromState cstate);
+static void CopyMultiInsertInfoFlushBuffer(CopyMultiInsertInfo *miinfo,
+										   CopyMultiInsertBuffer *buffer);
+static inline void CopyMultiInsertBufferCleanup(CopyMultiInsertInfo *miinfo,
+												CopyMultiInsertBuffer *buffer);
 
 /*
  * error context callback for COPY FROM
@@ -221,12 +236,16 @@ CopyMultiInsertBufferInit(ResultRelInfo *rri)
 	buffer->resultRelInfo = rri;
 	buffer->bistate = GetBulkInsertState();
 	buffer->nused = 0;
+	buffer->bufferedBytes = 0;
 
 	return buffer;
 }
 
 /*
  * Make a new buffer for this ResultRelInfo.
+ *
+ * If we already have MAX_PARTITION_BUFFERS buffers, the least recently used
+ * one is flushed and removed first.
  */
 static inline void
 CopyMultiInsertInfoSetupBuffer(CopyMultiInsertInfo *miinfo,
@@ -234,6 +253,14 @@ CopyMultiInsertInfoSetupBuffer(CopyMultiInsertInfo *miinfo,
 {
 	CopyMultiInsertBuffer *buffer;
 
+	if (list_length(miinfo->multiInsertBuffers) >= MAX_PARTITION_BUFFERS)
+	{
+		buffer = (CopyMultiInsertBuffer *) linitial(miinfo->multiInsertBuffers);
+		CopyMultiInsertInfoFlushBuffer(miinfo, buffer);
+		CopyMultiInsertBufferCleanup(miinfo, buffer);
+		miinfo->multiInsertBuffers = list_delete_first(miinfo->multiInsertBuffers);
+	}
+
 	buffer = CopyMultiInsertBufferInit(rri);
 
 	/* Setup back-link so we can easily find this buffer again */
@@ -271,13 +298,45 @@ CopyMultiInsertInfoInit(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 }
 
 /*
- * Returns true if the buffers are full
+ * Note that this ResultRelInfo's buffer is being used, by moving it to the
+ * end of the list of buffers.
+ */
+static inline void
+CopyMultiInsertInfoUseBuffer(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri)
+{
+	CopyMultiInsertBuffer *buffer = rri->ri_CopyMultiInsertBuffer;
+
+	Assert(buffer != NULL);
+
+	if (llast(miinfo->multiInsertBuffers) != buffer)
+	{
+		miinfo->multiInsertBuffers = list_delete_ptr(miinfo->multiInsertBuffers,
+													 buffer);
+		miinfo->multiInsertBuffers = lappend(miinfo->multiInsertBuffers, buffer);
+	}
+}
+
+/*
+ * Returns true if the buffer for this ResultRelInfo is full
+ */
+static inline bool
+CopyMultiInsertBufferIsFull(ResultRelInfo *rri)
+{
+	CopyMultiInsertBuffer *buffer = rri->ri_CopyMultiInsertBuffer;
+
+	if (buffer->nused >= MAX_BUFFERED_TUPLES ||
+		buffer->bufferedBytes >= MAX_BUFFERED_BYTES)
+		return true;
+	return false;
+}
+
+/*
+ * Returns true if the buffers are full, taken together
  */
 static inline bool
 CopyMultiInsertInfoIsFull(CopyMultiInsertInfo *miinfo)
 {
-	if (miinfo->bufferedTuples >= MAX_BUFFERED_TUPLES ||
-		miinfo->bufferedBytes >= MAX_BUFFERED_BYTES)
+	if (miinfo->bufferedBytes >= MAX_TOTAL_BUFFERED_BYTES)
 		return true;
 	return false;
 }
@@ -330,6 +389,13 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 					   buffer->bistate);
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * Insert the tuples into the indexes that accept them in batches all at
+	 * once.  The remaining indexes are handled one tuple at a time below.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0)
+		ExecInsertIndexTuplesBatch(resultRelInfo, slots, nused, estate);
+
 	for (i = 0; i < nused; i++)
 	{
 		/*
@@ -344,7 +410,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 			recheckIndexes =
 				ExecInsertIndexTuples(resultRelInfo,
 									  buffer->slots[i], estate, false, false,
-									  NULL, NIL);
+									  NULL, NIL, true);
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 slots[i], recheckIndexes,
 								 cstate->transition_capture);
@@ -369,6 +435,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 
 	/* Mark that all slots are free */
 	buffer->nused = 0;
+	buffer->bufferedBytes = 0;
 
 	/* reset cur_lineno and line_buf_valid to what they were */
 	cstate->line_buf_valid = line_buf_valid;
@@ -404,18 +471,26 @@ CopyMultiInsertBufferCleanup(CopyMultiInsertInfo *miinfo,
 	pfree(buffer);
 }
 
+/*
+ * Write out the tuples stored in one buffer, and forget about them.
+ */
+static void
+CopyMultiInsertInfoFlushBuffer(CopyMultiInsertInfo *miinfo,
+							   CopyMultiInsertBuffer *buffer)
+{
+	if (buffer->nused == 0)
+		return;
+
+	miinfo->bufferedTuples -= buffer->nused;
+	miinfo->bufferedBytes -= buffer->bufferedBytes;
+	CopyMultiInsertBufferFlush(miinfo, buffer);
+}
+
 /*
  * Write out all stored tuples in all buffers out to the tables.
- *
- * Once flushed we also trim the tracked buffers list down to size by removing
- * the buffers created earliest first.
- *
- * Callers should pass 'curr_rri' as the ResultRelInfo that's currently being
- * used.  When cleaning up old buffers we'll never remove the one for
- * 'curr_rri'.
  */
 static inline void
-CopyMultiInsertInfoFlush(CopyMultiInsertInfo *miinfo, ResultRelInfo *curr_rri)
+CopyMultiInsertInfoFlush(CopyMultiInsertInfo *miinfo)
 {
 	ListCell   *lc;
 
@@ -428,33 +503,6 @@ CopyMultiInsertInfoFlush(CopyMultiInsertInfo *miinfo, ResultRelInfo *curr_rri)
 
 	miinfo->bufferedTuples = 0;
 	miinfo->bufferedBytes = 0;
-
-	/*
-	 * Trim the list of tracked buffers down if it exceeds the limit.  Here we
-	 * remove buffers starting with the ones we created first.  It seems less
-	 * likely that these older ones will be needed than the ones that were
-	 * just created.
-	 */
-	while (list_length(miinfo->multiInsertBuffers) > MAX_PARTITION_BUFFERS)
-	{
-		CopyMultiInsertBuffer *buffer;
-
-		buffer = (CopyMultiInsertBuffer *) linitial(miinfo->multiInsertBuffers);
-
-		/*
-		 * We never want to remove the buffer that's currently being used, so
-		 * if we happen to find that then move it to the end of the list.
-		 */
-		if (buffer->resultRelInfo == curr_rri)
-		{
-			miinfo->multiInsertBuffers = list_delete_first(miinfo->multiInsertBuffers);
-			miinfo->multiInsertBuffers = lappend(miinfo->multiInsertBuffers, buffer);
-			buffer = (CopyMultiInsertBuffer *) linitial(miinfo->multiInsertBuffers);
-		}
-
-		CopyMultiInsertBufferCleanup(miinfo, buffer);
-		miinfo->multiInsertBuffers = list_delete_first(miinfo->multiInsertBuffers);
-	}
 }
 
 /*
@@ -512,6 +560,7 @@ CopyMultiInsertInfoStore(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 
 	/* Record this slot as being used */
 	buffer->nused++;
+	buffer->bufferedBytes += tuplen;
 
 	/* Update how many tuples are stored and their size */
 	miinfo->bufferedTuples++;
@@ -920,6 +969,9 @@ CopyFrom(CopyFromState cstate)
 					if (resultRelInfo->ri_CopyMultiInsertBuffer == NULL)
 						CopyMultiInsertInfoSetupBuffer(&multiInsertInfo,
 													   resultRelInfo);
+					else
+						CopyMultiInsertInfoUseBuffer(&multiInsertInfo,
+													 resultRelInfo);
 				}
 				else if (insertMethod == CIM_MULTI_CONDITIONAL &&
 						 !CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
@@ -928,7 +980,7 @@ CopyFrom(CopyFromState cstate)
 					 * Flush pending inserts if this partition can't use
 					 * batching, so rows are visible to triggers etc.
 					 */
-					CopyMultiInsertInfoFlush(&multiInsertInfo, resultRelInfo);
+					CopyMultiInsertInfoFlush(&multiInsertInfo);
 				}
 
 				if (bistate != NULL)
@@ -1060,11 +1112,15 @@ CopyFrom(CopyFromState cstate)
 											 cstate->cur_lineno);
 
 					/*
-					 * If enough inserts have queued up, then flush all
-					 * buffers out to their tables.
+					 * If enough inserts have queued up for this table, flush
+					 * its buffer.  If the buffers are using too much memory
+					 * in total, flush them all.
 					 */
-					if (CopyMultiInsertInfoIsFull(&multiInsertInfo))
-						CopyMultiInsertInfoFlush(&multiInsertInfo, resultRelInfo);
+					if (CopyMultiInsertBufferIsFull(resultRelInfo))
+						CopyMultiInsertInfoFlushBuffer(&multiInsertInfo,
+													   resultRelInfo->ri_CopyMultiInsertBuffer);
+					else if (CopyMultiInsertInfoIsFull(&multiInsertInfo))
+						CopyMultiInsertInfoFlush(&multiInsertInfo);
 				}
 				else
 				{
@@ -1101,7 +1157,8 @@ CopyFrom(CopyFromState cstate)
 																   false,
 																   false,
 																   NULL,
-																   NIL);
+																   NIL,
+																   false);
 					}
 
 					/* AFTER ROW INSERT Triggers */
@@ -1127,7 +1184,7 @@ CopyFrom(CopyFromState cstate)
 	if (insertMethod != CIM_SINGLE)
 	{
 		if (!CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
-			CopyMultiInsertInfoFlush(&multiInsertInfo, NULL);
+			CopyMultiInsertInfoFlush(&multiInsertInfo);
 	}
 
 	/* Done, clean up */
@@ -135,6 +135,16 @@ if (1) \
 	} \
 } else ((void) 0)
 
+/*
+ * Word-at-a-time helpers for CopyScanPlain: broadcast a byte to all bytes of
+ * a uint64, and test whether any byte of a uint64 is zero.
+ */
+#define COPY_SCAN_BROADCAST(c) \
+	(UINT64CONST(0x0101010101010101) * (unsigned char) (c))
+#define COPY_SCAN_HAS_ZERO(v) \
+	(((v) - UINT64CONST(0x0101010101010101)) & ~(v) & \
+	 UINT64CONST(0x8080808080808080))
+
 /* Undo any read-ahead and jump out of the block. */
 #define NO_END_OF_COPY_GOTO \
 if (1) \
@@ -151,6 +161,8 @@ static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 static bool CopyReadLine(CopyFromState cstate);
 static bool CopyReadLineText(CopyFromState cstate);
 static int	CopyReadAttributesText(CopyFromState cstate);
+static inline const char *CopyScanPlain(const char *ptr, const char *end,
+										const char *specials, int nspecials);
 static int	CopyReadAttributesCSV(CopyFromState cstate);
 static Datum CopyReadBinaryAttribute(CopyFromState cstate, FmgrInfo *flinfo,
 									 Oid typioparam, int32 typmod,
@@ -1077,6 +1089,10 @@ CopyReadLineText(CopyFromState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+	/* characters CopyScanPlain must stop at */
+	char		specials[4];
+	int			nspecials;
+
 	if (cstate->opts.csv_mode)
 	{
 		quotec = cstate->opts.quote[0];
@@ -1118,6 +1134,24 @@ CopyReadLineText(CopyFromState cstate)
 	input_buf_ptr = cstate->input_buf_index;
 	copy_buf_len = cstate->input_buf_len;
 
+	/*
+	 * Most bytes of a line are none of the characters the loop below cares
+	 * about, so we skip over runs of such bytes with CopyScanPlain.  A
+	 * backslash need only be considered at the start of a line in CSV mode,
+	 * and we don't skip there.
+	 */
+	nspecials = 0;
+	specials[nspecials++] = '\n';
+	specials[nspecials++] = '\r';
+	if (cstate->opts.csv_mode)
+	{
+		specials[nspecials++] = quotec;
+		if (escapec != '\0')
+			specials[nspecials++] = escapec;
+	}
+	else
+		specials[nspecials++] = '\\';
+
 	for (;;)
 	{
 		int			prev_raw_ptr;
@@ -1155,6 +1189,24 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+		/* Skip over bytes that can't end the line or change CSV state */
+		if (!first_char_in_line)
+		{
+			int			plain_end;
+
+			plain_end = CopyScanPlain(copy_input_buf + input_buf_ptr,
+									  copy_input_buf + copy_buf_len,
+									  specials, nspecials) - copy_input_buf;
+			if (plain_end > input_buf_ptr)
+			{
+				input_buf_ptr = plain_end;
+				/* none of the skipped bytes was an escape */
+				last_was_esc = false;
+				if (input_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1399,6 +1451,46 @@ not_end_of_copy:
 	return result;
 }
 
+/*
+ * CopyScanPlain - find the first of a few special characters
+ *
+ * Returns a pointer to the first byte in [ptr, end) that equals one of the
+ * nspecials characters in specials[], or end if there is none.  The input is
+ * examined a word at a time, which is much faster than testing each byte
+ * when, as is usual, special characters are sparse.
+ */
+static inline const char *
+CopyScanPlain(const char *ptr, const char *end,
+			  const char *specials, int nspecials)
+{
+	while (end - ptr >= sizeof(uint64))
+	{
+		uint64		chunk;
+		uint64		hit = 0;
+		int			i;
+
+		memcpy(&chunk, ptr, sizeof(uint64));
+		for (i = 0; i < nspecials; i++)
+			hit |= COPY_SCAN_HAS_ZERO(chunk ^ COPY_SCAN_BROADCAST(specials[i]));
+		if (hit)
+			break;
+		ptr += sizeof(uint64);
+	}
+
+	for (; ptr < end; ptr++)
+	{
+		int			i;
+
+		for (i = 0; i < nspecials; i++)
+		{
+			if (*ptr == specials[i])
+				return ptr;
+		}
+	}
+
+	return end;
+}
+
 /*
  *	Return decimal value for a hexadecimal digit
  */
@@ -1434,6 +1526,7 @@ static int
 CopyReadAttributesText(CopyFromState cstate)
 {
 	char		delimc = cstate->opts.delim[0];
+	char		specials[2] = {delimc, '\\'};
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
@@ -1505,6 +1598,16 @@ CopyReadAttributesText(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			const char *plain_end;
+
+			/* Copy any run of ordinary bytes in one go */
+			plain_end = CopyScanPlain(cur_ptr, line_end_ptr, specials, 2);
+			if (plain_end > cur_ptr)
+			{
+				memcpy(output_ptr, cur_ptr, plain_end - cur_ptr);
+				output_ptr += plain_end - cur_ptr;
+				cur_ptr = (char *) plain_end;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -1664,6 +1767,8 @@ CopyReadAttributesCSV(CopyFromState cstate)
 	char		delimc = cstate->opts.delim[0];
 	char		quotec = cstate->opts.quote[0];
 	char		escapec = cstate->opts.escape[0];
+	char		unquoted_specials[2] = {delimc, quotec};
+	char		quoted_specials[2] = {quotec, escapec};
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
@@ -1731,10 +1836,20 @@ CopyReadAttributesCSV(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			const char *plain_end;
 
 			/* Not in quote */
 			for (;;)
 			{
+				plain_end = CopyScanPlain(cur_ptr, line_end_ptr,
+										  unquoted_specials, 2);
+				if (plain_end > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, plain_end - cur_ptr);
+					output_ptr += plain_end - cur_ptr;
+					cur_ptr = (char *) plain_end;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -1758,6 +1873,15 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* In quote */
 			for (;;)
 			{
+				plain_end = CopyScanPlain(cur_ptr, line_end_ptr,
+										  quoted_specials, 2);
+				if (plain_end > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, plain_end - cur_ptr);
+					output_ptr += plain_end - cur_ptr;
+					cur_ptr = (char *) plain_end;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
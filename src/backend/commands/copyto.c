@@ -37,6 +37,8 @@
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
 #include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/partcache.h"
@@ -53,6 +55,19 @@ typedef enum CopyDest
 	COPY_FRONTEND,				/* to frontend */
 } CopyDest;
 
+/*
+ * Columns of some common types are output without calling their output or
+ * send function, which is a good deal faster.  CopyOutputKind records which
+ * such shortcut, if any, applies to a column.
+ */
+typedef enum CopyOutputKind
+{
+	COPY_OUTPUT_GENERIC,		/* call the type's output/send function */
+	COPY_OUTPUT_INT2,
+	COPY_OUTPUT_INT4,
+	COPY_OUTPUT_INT8
+} CopyOutputKind;
+
 /*
  * This struct contains all the state variables used throughout a COPY TO
  * operation.
@@ -95,6 +110,7 @@ typedef struct CopyToStateData
 	MemoryContext copycontext;	/* per-copy execution context */
 
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
+	CopyOutputKind *out_kinds;	/* per-column output shortcuts */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 	uint64		bytes_processed;	/* number of bytes processed so far */
 
@@ -116,6 +132,10 @@ static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 static void EndCopy(CopyToState cstate);
 static void ClosePipeToProgram(CopyToState cstate);
 static void CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot);
+static CopyOutputKind CopyGetOutputKind(CopyToState cstate, int attnum,
+										Oid out_func_oid);
+static void CopyAttributeOutInteger(CopyToState cstate, CopyOutputKind kind,
+									Datum value);
 static void CopyAttributeOutText(CopyToState cstate, char *string);
 static void CopyAttributeOutCSV(CopyToState cstate, char *string,
 								bool use_quote, bool single_attr);
@@ -794,6 +814,7 @@ DoCopyTo(CopyToState cstate)
 
 	/* Get info about the columns we need to process. */
 	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
+	cstate->out_kinds = (CopyOutputKind *) palloc(num_phys_attrs * sizeof(CopyOutputKind));
 	foreach(cur, cstate->attnumlist)
 	{
 		int			attnum = lfirst_int(cur);
@@ -810,6 +831,8 @@ DoCopyTo(CopyToState cstate)
 							  &out_func_oid,
 							  &isvarlena);
 		fmgr_info(out_func_oid, &cstate->out_functions[attnum - 1]);
+		cstate->out_kinds[attnum - 1] = CopyGetOutputKind(cstate, attnum,
+														  out_func_oid);
 	}
 
 	/*
@@ -968,6 +991,9 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 			else
 				CopySendInt32(cstate, -1);
 		}
+		else if (cstate->out_kinds[attnum - 1] != COPY_OUTPUT_GENERIC)
+			CopyAttributeOutInteger(cstate, cstate->out_kinds[attnum - 1],
+									value);
 		else
 		{
 			if (!cstate->opts.binary)
@@ -999,6 +1025,121 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Decide whether a column's values can be output by CopyAttributeOutInteger
+ * rather than by calling out_func_oid.
+ *
+ * The printed form of an integer consists of digits and possibly a minus
+ * sign.  That is output unchanged by CopyAttributeOutText and
+ * CopyAttributeOutCSV, unless one of those characters is used as delimiter
+ * or quote, or the value might be taken for the null string, or the column
+ * is to be force-quoted.  We don't bother with the shortcut in those cases.
+ */
+static CopyOutputKind
+CopyGetOutputKind(CopyToState cstate, int attnum, Oid out_func_oid)
+{
+	static const char integer_chars[] = "0123456789-";
+	CopyOutputKind kind;
+
+	switch (out_func_oid)
+	{
+		case F_INT2OUT:
+		case F_INT2SEND:
+			kind = COPY_OUTPUT_INT2;
+			break;
+		case F_INT4OUT:
+		case F_INT4SEND:
+			kind = COPY_OUTPUT_INT4;
+			break;
+		case F_INT8OUT:
+		case F_INT8SEND:
+			kind = COPY_OUTPUT_INT8;
+			break;
+		default:
+			return COPY_OUTPUT_GENERIC;
+	}
+
+	if (cstate->opts.binary)
+		return kind;
+
+	if (strchr(integer_chars, cstate->opts.delim[0]) != NULL)
+		return COPY_OUTPUT_GENERIC;
+
+	if (cstate->opts.csv_mode)
+	{
+		const char *null_print = cstate->opts.null_print;
+
+		if (strchr(integer_chars, cstate->opts.quote[0]) != NULL ||
+			cstate->opts.force_quote_flags[attnum - 1])
+			return COPY_OUTPUT_GENERIC;
+		if (null_print[0] != '\0' &&
+			strspn(null_print, integer_chars) == strlen(null_print))
+			return COPY_OUTPUT_GENERIC;
+	}
+
+	return kind;
+}
+
+/*
+ * Output one attribute of a type selected by CopyGetOutputKind
+ *
+ * The result must be the same as what the type's output or send function
+ * would have produced, followed by CopyAttributeOutText/CSV.  Digits and the
+ * minus sign are the same in every client encoding, so no conversion is
+ * needed.
+ */
+static void
+CopyAttributeOutInteger(CopyToState cstate, CopyOutputKind kind, Datum value)
+{
+	char		buf[MAXINT8LEN + 1];
+	int			len = 0;
+
+	if (cstate->opts.binary)
+	{
+		switch (kind)
+		{
+			case COPY_OUTPUT_INT2:
+				CopySendInt32(cstate, sizeof(int16));
+				CopySendInt16(cstate, DatumGetInt16(value));
+				break;
+			case COPY_OUTPUT_INT4:
+				CopySendInt32(cstate, sizeof(int32));
+				CopySendInt32(cstate, DatumGetInt32(value));
+				break;
+			case COPY_OUTPUT_INT8:
+				{
+					int64		val = DatumGetInt64(value);
+
+					CopySendInt32(cstate, sizeof(int64));
+					CopySendInt32(cstate, (int32) (val >> 32));
+					CopySendInt32(cstate, (int32) val);
+				}
+				break;
+			case COPY_OUTPUT_GENERIC:
+				elog(ERROR, "unexpected COPY output kind");
+				break;
+		}
+		return;
+	}
+
+	switch (kind)
+	{
+		case COPY_OUTPUT_INT2:
+			len = pg_itoa(DatumGetInt16(value), buf);
+			break;
+		case COPY_OUTPUT_INT4:
+			len = pg_ltoa(DatumGetInt32(value), buf);
+			break;
+		case COPY_OUTPUT_INT8:
+			len = pg_lltoa(DatumGetInt64(value), buf);
+			break;
+		case COPY_OUTPUT_GENERIC:
+			elog(ERROR, "unexpected COPY output kind");
+			break;
+	}
+	CopySendData(cstate, buf, len);
+}
+
 /*
  * Send text representation of one attribute, with conversion and escaping
  */
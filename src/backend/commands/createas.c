@@ -267,6 +267,10 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 	}
 	Assert(query->commandType == CMD_SELECT);
 
+	/* Check that an incremental matview's query can be maintained */
+	if (is_matview && into->incremental)
+		CheckIncrementalMatViewQuery(query);
+
 	/*
 	 * For materialized views, lock down security-restricted operations and
 	 * arrange to make GUC variable changes local to this command.  This is
@@ -320,8 +324,14 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		 * matter if the planner executed an allegedly-stable function that
 		 * changed the database contents, but let's do it anyway to be
 		 * parallel to the EXPLAIN code path.)
+		 *
+		 * An incremental matview must include every change committed before
+		 * CheckIncrementalMatViewQuery locked its tables, since those changes
+		 * will never go through its maintenance triggers, so it takes a fresh
+		 * snapshot instead.
 		 */
-		PushCopiedSnapshot(GetActiveSnapshot());
+		PushCopiedSnapshot(into->incremental ? GetLatestSnapshot() :
+						   GetActiveSnapshot());
 		UpdateActiveSnapshotCommandId();
 
 		/* Create a QueryDesc, redirecting output to our tuple receiver */
@@ -358,6 +368,11 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 
 		/* Restore userid and security context */
 		SetUserIdAndSecContext(save_userid, save_sec_context);
+
+		/* Start maintaining the matview */
+		if (into->incremental)
+			CreateIncrementalMatViewTriggers(address.objectId,
+											 (Query *) into->viewQuery);
 	}
 
 	return address;
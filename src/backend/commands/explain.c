@@ -24,6 +24,7 @@
 #include "nodes/extensible.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
@@ -111,6 +112,8 @@ static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 static void show_hash_info(HashState *hashstate, ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
+static void show_redistribute_keys(RedistributeState *rdstate, List *ancestors,
+								   ExplainState *es);
 static void show_hashagg_info(AggState *hashstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
@@ -119,6 +122,8 @@ static void show_instrumentation_count(const char *qlabel, int which,
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
 static void show_eval_params(Bitmapset *bms_params, ExplainState *es);
 static const char *explain_get_index_name(Oid indexId);
+static void show_planning_details(ExplainState *es,
+								  const PlannerInstrumentation *instr);
 static void show_buffer_usage(ExplainState *es, const BufferUsage *usage,
 							  bool planning);
 static void show_wal_usage(ExplainState *es, const WalUsage *usage);
@@ -190,6 +195,8 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 			es->wal = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "settings") == 0)
 			es->settings = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "planning_details") == 0)
+			es->planning_details = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "timing") == 0)
 		{
 			timing_set = true;
@@ -388,13 +395,29 @@ ExplainOneQuery(Query *query, int cursorOptions,
 					planduration;
 		BufferUsage bufusage_start,
 					bufusage;
+		PlannerInstrumentation planinstr;
 
 		if (es->buffers)
 			bufusage_start = pgBufferUsage;
 		INSTR_TIME_SET_CURRENT(planstart);
 
 		/* plan the query */
-		plan = pg_plan_query(query, queryString, cursorOptions, params);
+		if (es->planning_details)
+		{
+			PlannerInstrumentationStart(&planinstr);
+			PG_TRY();
+			{
+				plan = pg_plan_query(query, queryString, cursorOptions, params);
+			}
+			PG_FINALLY();
+			{
+				PlannerInstrumentationStop();
+			}
+			PG_END_TRY();
+			es->planner_instr = &planinstr;
+		}
+		else
+			plan = pg_plan_query(query, queryString, cursorOptions, params);
 
 		INSTR_TIME_SET_CURRENT(planduration);
 		INSTR_TIME_SUBTRACT(planduration, planstart);
@@ -409,6 +432,7 @@ ExplainOneQuery(Query *query, int cursorOptions,
 		/* run it (if needed) and produce output */
 		ExplainOnePlan(plan, into, es, queryString, params, queryEnv,
 					   &planduration, (es->buffers ? &bufusage : NULL));
+		es->planner_instr = NULL;
 	}
 }
 
@@ -457,6 +481,15 @@ ExplainOneUtility(Node *utilityStmt, IntoClause *into, ExplainState *es,
 			return;
 		}
 
+		/*
+		 * The maintenance triggers of an incremental materialized view are
+		 * created by ExecCreateTableAs, which EXPLAIN ANALYZE bypasses.
+		 */
+		if (es->analyze && ctas->into->incremental)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("EXPLAIN ANALYZE is not supported for CREATE INCREMENTAL MATERIALIZED VIEW")));
+
 		rewritten = QueryRewrite(castNode(Query, copyObject(ctas->query)));
 		Assert(list_length(rewritten) == 1);
 		ExplainOneQuery(linitial_node(Query, rewritten),
@@ -629,6 +662,10 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 		ExplainPropertyFloat("Planning Time", "ms", 1000.0 * plantime, 3, es);
 	}
 
+	/* Show per-phase planner statistics, if collected */
+	if (es->planner_instr)
+		show_planning_details(es, es->planner_instr);
+
 	/* Print info about runtime of triggers */
 	if (es->analyze)
 		ExplainPrintTriggers(es, queryDesc);
@@ -1225,6 +1262,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_GatherMerge:
 			pname = sname = "Gather Merge";
 			break;
+		case T_Redistribute:
+			pname = sname = "Redistribute";
+			break;
 		case T_IndexScan:
 			pname = sname = "Index Scan";
 			break;
@@ -2019,6 +2059,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_memoize_info(castNode(MemoizeState, planstate), ancestors,
 							  es);
 			break;
+		case T_Redistribute:
+			show_redistribute_keys(castNode(RedistributeState, planstate),
+								   ancestors, es);
+			break;
 		default:
 			break;
 	}
@@ -2516,6 +2560,24 @@ show_group_keys(GroupState *gstate, List *ancestors,
 	ancestors = list_delete_first(ancestors);
 }
 
+/*
+ * Show the distribution keys for a Redistribute node.
+ */
+static void
+show_redistribute_keys(RedistributeState *rdstate, List *ancestors,
+					   ExplainState *es)
+{
+	Redistribute *plan = (Redistribute *) rdstate->ps.plan;
+
+	/* The key columns refer to the tlist of the child plan */
+	ancestors = lcons(plan, ancestors);
+	show_sort_group_keys(outerPlanState(rdstate), "Hash Key",
+						 plan->numCols, 0, plan->hashColIdx,
+						 NULL, NULL, NULL,
+						 ancestors, es);
+	ancestors = list_delete_first(ancestors);
+}
+
 /*
  * Common code to show sort/group keys, which are represented in plan nodes
  * as arrays of targetlist indexes.  If it's a sort key rather than a group
@@ -3617,6 +3679,70 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 	}
 }
 
+/*
+ * Show statistics collected by the planner for EXPLAIN (PLANNING_DETAILS).
+ */
+static void
+show_planning_details(ExplainState *es, const PlannerInstrumentation *instr)
+{
+	static const char *const phase_names[NUM_PLANNER_PHASES] = {
+		"Preprocessing",
+		"Setup",
+		"Base Relation Paths",
+		"Join Search",
+		"Upper Paths",
+		"Plan Creation"
+	};
+	int			i;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainIndentText(es);
+		appendStringInfoString(es->str, "Planning Details:\n");
+		es->indent++;
+		for (i = 0; i < NUM_PLANNER_PHASES; i++)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str, "%s: time=%.3f ms memory=%lldkB\n",
+							 phase_names[i],
+							 1000.0 * INSTR_TIME_GET_DOUBLE(instr->phase_time[i]),
+							 (long long) (instr->phase_memory[i] / 1024));
+		}
+		ExplainIndentText(es);
+		appendStringInfo(es->str, "Paths: considered=%lld rejected=%lld\n",
+						 (long long) instr->paths_considered,
+						 (long long) instr->paths_rejected);
+		ExplainIndentText(es);
+		appendStringInfo(es->str, "Catalog Cache Lookups: %llu\n",
+						 (unsigned long long) instr->catcache_searches);
+		es->indent--;
+	}
+	else
+	{
+		ExplainOpenGroup("Planning Details", "Planning Details", true, es);
+		ExplainOpenGroup("Phases", "Phases", false, es);
+		for (i = 0; i < NUM_PLANNER_PHASES; i++)
+		{
+			ExplainOpenGroup("Phase", NULL, true, es);
+			ExplainPropertyText("Phase Name", phase_names[i], es);
+			ExplainPropertyFloat("Time", "ms",
+								 1000.0 * INSTR_TIME_GET_DOUBLE(instr->phase_time[i]),
+								 3, es);
+			ExplainPropertyInteger("Memory", "kB",
+								   instr->phase_memory[i] / 1024, es);
+			ExplainCloseGroup("Phase", NULL, true, es);
+		}
+		ExplainCloseGroup("Phases", "Phases", false, es);
+		ExplainPropertyInteger("Paths Considered", NULL,
+							   instr->paths_considered, es);
+		ExplainPropertyInteger("Paths Rejected", NULL,
+							   instr->paths_rejected, es);
+		ExplainPropertyUInteger("Catalog Cache Lookups", NULL,
+								instr->catcache_searches, es);
+		ExplainCloseGroup("Planning Details", "Planning Details", true, es);
+	}
+}
+
 /*
  * Show WAL usage details.
  */
@@ -22,26 +22,41 @@
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_depend.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_trigger.h"
 #include "commands/cluster.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
+#include "executor/tstoreReceiver.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/parse_relation.h"
+#include "parser/parser.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
+#include "rewrite/rewriteManip.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/queryenvironment.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -64,8 +79,10 @@ static void transientrel_startup(DestReceiver *self, int operation, TupleDesc ty
 static bool transientrel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void transientrel_shutdown(DestReceiver *self);
 static void transientrel_destroy(DestReceiver *self);
+static Query *get_matview_query(Relation matviewRel);
 static uint64 refresh_matview_datafill(DestReceiver *dest, Query *query,
-									   const char *queryString);
+									   const char *queryString,
+									   bool use_latest_snapshot);
 static char *make_temptable_name_n(char *tempname, int n);
 static void refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 								   int save_sec_context);
@@ -73,6 +90,8 @@ static void refresh_by_heap_swap(Oid matviewOid, Oid OIDNewHeap, char relpersist
 static bool is_usable_unique_index(Relation indexRel);
 static void OpenMatViewIncrementalMaintenance(void);
 static void CloseMatViewIncrementalMaintenance(void);
+static bool matview_is_incremental(Oid matviewOid);
+static bool ivm_other_changes_pending(Query *query, Oid baseOid);
 
 /*
  * SetMatViewPopulatedState
@@ -140,8 +159,6 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 {
 	Oid			matviewOid;
 	Relation	matviewRel;
-	RewriteRule *rule;
-	List	   *actions;
 	Query	   *dataQuery;
 	Oid			tableSpace;
 	Oid			relowner;
@@ -189,31 +206,11 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 						"CONCURRENTLY", "WITH NO DATA")));
 
 	/*
-	 * Check that everything is correct for a refresh. Problems at this point
-	 * are internal errors, so elog is sufficient.
+	 * Check that everything is correct for a refresh, and fetch the query.
+	 * The stored query was rewritten at the time of the MV definition, but
+	 * has not been scribbled on by the planner.
 	 */
-	if (matviewRel->rd_rel->relhasrules == false ||
-		matviewRel->rd_rules->numLocks < 1)
-		elog(ERROR,
-			 "materialized view \"%s\" is missing rewrite information",
-			 RelationGetRelationName(matviewRel));
-
-	if (matviewRel->rd_rules->numLocks > 1)
-		elog(ERROR,
-			 "materialized view \"%s\" has too many rules",
-			 RelationGetRelationName(matviewRel));
-
-	rule = matviewRel->rd_rules->rules[0];
-	if (rule->event != CMD_SELECT || !(rule->isInstead))
-		elog(ERROR,
-			 "the rule for materialized view \"%s\" is not a SELECT INSTEAD OF rule",
-			 RelationGetRelationName(matviewRel));
-
-	actions = rule->actions;
-	if (list_length(actions) != 1)
-		elog(ERROR,
-			 "the rule for materialized view \"%s\" is not a single action",
-			 RelationGetRelationName(matviewRel));
+	dataQuery = get_matview_query(matviewRel);
 
 	/*
 	 * Check that there is a unique index with no WHERE clause on one or more
@@ -248,12 +245,6 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 					 errhint("Create a unique index with no WHERE clause on one or more columns of the materialized view.")));
 	}
 
-	/*
-	 * The stored query was rewritten at the time of the MV definition, but
-	 * has not been scribbled on by the planner.
-	 */
-	dataQuery = linitial_node(Query, actions);
-
 	/*
 	 * Check for active uses of the relation in the current transaction, such
 	 * as open scans.
@@ -313,7 +304,8 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 
 	/* Generate the data, if wanted. */
 	if (!stmt->skipData)
-		processed = refresh_matview_datafill(dest, dataQuery, queryString);
+		processed = refresh_matview_datafill(dest, dataQuery, queryString,
+											 matview_is_incremental(matviewOid));
 
 	/* Make the matview match the newly generated data. */
 	if (concurrent)
@@ -372,17 +364,62 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 	return address;
 }
 
+/*
+ * get_matview_query
+ *
+ * Return the query of the materialized view's ON SELECT rule, after checking
+ * that the rule looks as expected.  Problems at this point are internal
+ * errors, so elog is sufficient.
+ */
+static Query *
+get_matview_query(Relation matviewRel)
+{
+	RewriteRule *rule;
+	List	   *actions;
+
+	if (matviewRel->rd_rel->relhasrules == false ||
+		matviewRel->rd_rules->numLocks < 1)
+		elog(ERROR,
+			 "materialized view \"%s\" is missing rewrite information",
+			 RelationGetRelationName(matviewRel));
+
+	if (matviewRel->rd_rules->numLocks > 1)
+		elog(ERROR,
+			 "materialized view \"%s\" has too many rules",
+			 RelationGetRelationName(matviewRel));
+
+	rule = matviewRel->rd_rules->rules[0];
+	if (rule->event != CMD_SELECT || !(rule->isInstead))
+		elog(ERROR,
+			 "the rule for materialized view \"%s\" is not a SELECT INSTEAD OF rule",
+			 RelationGetRelationName(matviewRel));
+
+	actions = rule->actions;
+	if (list_length(actions) != 1)
+		elog(ERROR,
+			 "the rule for materialized view \"%s\" is not a single action",
+			 RelationGetRelationName(matviewRel));
+
+	return linitial_node(Query, actions);
+}
+
 /*
  * refresh_matview_datafill
  *
  * Execute the given query, sending result rows to "dest" (which will
  * insert them into the target matview).
  *
+ * If use_latest_snapshot is true, the query is run with a fresh snapshot
+ * rather than the statement's.  Incremental materialized views need that:
+ * a change committed after our statement started but before we got the lock
+ * on the matview has already been through the maintenance triggers, which
+ * takes no account of the data we are about to replace.
+ *
  * Returns number of rows inserted.
  */
 static uint64
 refresh_matview_datafill(DestReceiver *dest, Query *query,
-						 const char *queryString)
+						 const char *queryString, bool use_latest_snapshot)
 {
 	List	   *rewritten;
 	PlannedStmt *plan;
@@ -412,7 +449,8 @@ refresh_matview_datafill(DestReceiver *dest, Query *query,
 	 * the planner executed an allegedly-stable function that changed the
 	 * database contents, but let's do it anyway to be safe.)
 	 */
-	PushCopiedSnapshot(GetActiveSnapshot());
+	PushCopiedSnapshot(use_latest_snapshot ? GetLatestSnapshot() :
+					   GetActiveSnapshot());
 	UpdateActiveSnapshotCommandId();
 
 	/* Create a QueryDesc, redirecting output to our tuple receiver */
@@ -942,3 +980,943 @@ CloseMatViewIncrementalMaintenance(void)
 	matview_maintenance_depth--;
 	Assert(matview_maintenance_depth >= 0);
 }
+
+
+/*
+ * Incremental maintenance
+ *
+ * An incremental materialized view is kept up to date by statement-level
+ * AFTER triggers on each of the tables its query reads.  Supported queries
+ * are aggregations (or DISTINCT-like projections) over inner joins of plain
+ * tables, with every GROUP BY expression in the select list.  For such a
+ * query the rows that a change to one base table can affect are exactly the
+ * groups whose keys appear among the changed rows, so the trigger
+ *
+ *		1. runs the view's query, restricted to its grouping expressions, over
+ *		   the statement's transition tables in place of the changed table,
+ *		   giving the set of affected group keys;
+ *		2. re-runs the view's query with a semi-join against those keys,
+ *		   giving the new contents of the affected groups;
+ *		3. deletes the affected groups from the matview and inserts the new
+ *		   contents in their place.
+ *
+ * Recomputing a whole group, rather than applying a delta to each aggregate,
+ * lets us support any aggregate, HAVING, and groups that disappear, at the
+ * cost of rescanning the group's input rows.  TRUNCATE of a base table just
+ * recomputes the whole view.
+ *
+ * Step 1 finds the groups a changed row belonged to by joining it with the
+ * current contents of the other tables.  That assumes the view reflects all
+ * changes to them, which isn't so if the same statement changed one of them
+ * and its maintenance is still to come; for instance, when a foreign key
+ * cascades a delete, the referencing rows are deleted and maintained before
+ * the statement's maintenance of the referenced table runs, and neither
+ * finds the rows of the other any more.  In that case we recompute the
+ * whole view, too.
+ *
+ * The queries of steps 1 and 2 are built by modifying the view's stored
+ * query, and see the transition tables and the key set as ephemeral named
+ * relations.  All of this runs with a fresh snapshot while holding
+ * ExclusiveLock on the matview, so concurrent maintenance is serialized and
+ * each run sees the results of all the runs before it.
+ */
+
+#define IVM_DELTA_ENRNAME	"__ivm_delta"
+#define IVM_KEYS_ENRNAME	"__ivm_keys"
+#define IVM_NEWDATA_ENRNAME	"__ivm_newdata"
+
+/*
+ * check_ivm_vars_walker
+ *		Reject system columns and whole-row references, which don't survive
+ *		replacing a table by its transition table.
+ */
+static bool
+check_ivm_vars_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		if (((Var *) node)->varattno <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("system columns and whole-row references are not supported in incremental materialized views")));
+		return false;
+	}
+	return expression_tree_walker(node, check_ivm_vars_walker, context);
+}
+
+/*
+ * CheckIncrementalMatViewQuery
+ *		Verify that the query of a new materialized view can be maintained
+ *		incrementally.
+ *
+ * This also takes the lock that CREATE TRIGGER will want on each of the
+ * query's tables, so that no change to them can be made between taking the
+ * snapshot that populates the view and creating its maintenance triggers.
+ */
+void
+CheckIncrementalMatViewQuery(Query *query)
+{
+	List	   *relids = NIL;
+	ListCell   *lc;
+
+	if (query->groupClause == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("incremental materialized view query must have a GROUP BY clause")));
+	if (query->groupingSets != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"GROUPING SETS")));
+	if (query->distinctClause != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"DISTINCT")));
+	if (query->hasWindowFuncs)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("window functions are not supported in incremental materialized views")));
+	if (query->hasTargetSRFs)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-returning functions are not supported in incremental materialized views")));
+	if (query->hasSubLinks)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("subqueries are not supported in incremental materialized views")));
+	if (query->cteList != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"WITH")));
+	if (query->setOperations != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"UNION/INTERSECT/EXCEPT")));
+	if (query->limitCount != NULL || query->limitOffset != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"LIMIT/OFFSET")));
+	if (query->rowMarks != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported in incremental materialized views",
+						"FOR UPDATE/SHARE")));
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_JOIN)
+		{
+			if (rte->jointype != JOIN_INNER)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("outer joins are not supported in incremental materialized views")));
+			continue;
+		}
+
+		if (rte->rtekind != RTE_RELATION)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("incremental materialized views may only reference plain tables")));
+
+		/*
+		 * Statement triggers only fire for the table a statement names, so
+		 * changes made through an inheritance parent would go unnoticed.
+		 */
+		if (rte->relkind != RELKIND_RELATION ||
+			has_subclass(rte->relid) || has_superclass(rte->relid))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("relation \"%s\" cannot be used in an incremental materialized view",
+							get_rel_name(rte->relid)),
+					 errdetail("Only plain tables that are not part of an inheritance hierarchy can be used.")));
+
+		if (list_member_oid(relids, rte->relid))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("table \"%s\" is referenced more than once in incremental materialized view query",
+							get_rel_name(rte->relid))));
+		relids = lappend_oid(relids, rte->relid);
+	}
+
+	if (contain_mutable_functions((Node *) query))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("mutable functions are not supported in incremental materialized views")));
+
+	(void) query_tree_walker(query, check_ivm_vars_walker, NULL, 0);
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+
+		if (tle->resjunk)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GROUP BY expressions of an incremental materialized view must appear in its select list")));
+	}
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		AclResult	aclresult;
+
+		LockRelationOid(relid, ShareRowExclusiveLock);
+
+		aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_TRIGGER);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, OBJECT_TABLE, get_rel_name(relid));
+	}
+
+	list_free(relids);
+}
+
+/*
+ * CreateIncrementalMatViewTriggers
+ *		Create the triggers that maintain a new incremental materialized view.
+ *
+ * "query" is the view's query as passed to CheckIncrementalMatViewQuery.
+ * Each table it reads gets an internal trigger per kind of change; the
+ * triggers depend on the matview, so that they go away with it.
+ */
+void
+CreateIncrementalMatViewTriggers(Oid matviewOid, Query *query)
+{
+	static const struct
+	{
+		int16		events;
+		const char *trigname;
+		bool		oldtable;
+		bool		newtable;
+	}			ivm_triggers[] =
+	{
+		{TRIGGER_TYPE_INSERT, "MatView_Maintenance_i", false, true},
+		{TRIGGER_TYPE_DELETE, "MatView_Maintenance_d", true, false},
+		{TRIGGER_TYPE_UPDATE, "MatView_Maintenance_u", true, true},
+		{TRIGGER_TYPE_TRUNCATE, "MatView_Maintenance_t", false, false}
+	};
+	ObjectAddress matviewAddr;
+	ListCell   *lc;
+
+	ObjectAddressSet(matviewAddr, RelationRelationId, matviewOid);
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+		int			i;
+
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		for (i = 0; i < lengthof(ivm_triggers); i++)
+		{
+			CreateTrigStmt *trig = makeNode(CreateTrigStmt);
+			ObjectAddress trigAddr;
+
+			trig->replace = false;
+			trig->isconstraint = false;
+			trig->trigname = (char *) ivm_triggers[i].trigname;
+			trig->relation = NULL;
+			trig->funcname = SystemFuncName("matview_incremental_maintenance");
+			trig->args = list_make1(makeString(psprintf("%u", matviewOid)));
+			trig->row = false;
+			trig->timing = TRIGGER_TYPE_AFTER;
+			trig->events = ivm_triggers[i].events;
+			trig->columns = NIL;
+			trig->whenClause = NULL;
+			trig->transitionRels = NIL;
+			if (ivm_triggers[i].oldtable)
+			{
+				TriggerTransition *tt = makeNode(TriggerTransition);
+
+				tt->name = "__ivm_oldtable";
+				tt->isNew = false;
+				tt->isTable = true;
+				trig->transitionRels = lappend(trig->transitionRels, tt);
+			}
+			if (ivm_triggers[i].newtable)
+			{
+				TriggerTransition *tt = makeNode(TriggerTransition);
+
+				tt->name = "__ivm_newtable";
+				tt->isNew = true;
+				tt->isTable = true;
+				trig->transitionRels = lappend(trig->transitionRels, tt);
+			}
+			trig->deferrable = false;
+			trig->initdeferred = false;
+			trig->constrrel = NULL;
+
+			trigAddr = CreateTrigger(trig, NULL, rte->relid, InvalidOid,
+									 InvalidOid, InvalidOid, InvalidOid,
+									 InvalidOid, NULL, true, false);
+
+			recordDependencyOn(&trigAddr, &matviewAddr, DEPENDENCY_AUTO);
+
+			/* Make changes-so-far visible */
+			CommandCounterIncrement();
+		}
+	}
+}
+
+/*
+ * matview_is_incremental
+ *		Does the matview have maintenance triggers?
+ */
+static bool
+matview_is_incremental(Oid matviewOid)
+{
+	Relation	depRel;
+	Relation	tgRel;
+	ScanKeyData key[2];
+	SysScanDesc scan;
+	HeapTuple	tup;
+	bool		result = false;
+
+	depRel = table_open(DependRelationId, AccessShareLock);
+	tgRel = table_open(TriggerRelationId, AccessShareLock);
+
+	ScanKeyInit(&key[0],
+				Anum_pg_depend_refclassid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationRelationId));
+	ScanKeyInit(&key[1],
+				Anum_pg_depend_refobjid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(matviewOid));
+
+	scan = systable_beginscan(depRel, DependReferenceIndexId, true,
+							  NULL, 2, key);
+
+	while (!result && HeapTupleIsValid(tup = systable_getnext(scan)))
+	{
+		Form_pg_depend depform = (Form_pg_depend) GETSTRUCT(tup);
+		ScanKeyData tgkey;
+		SysScanDesc tgscan;
+		HeapTuple	tgtup;
+
+		if (depform->classid != TriggerRelationId)
+			continue;
+
+		ScanKeyInit(&tgkey,
+					Anum_pg_trigger_oid,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(depform->objid));
+		tgscan = systable_beginscan(tgRel, TriggerOidIndexId, true,
+									NULL, 1, &tgkey);
+		tgtup = systable_getnext(tgscan);
+		if (HeapTupleIsValid(tgtup) &&
+			((Form_pg_trigger) GETSTRUCT(tgtup))->tgfoid == F_MATVIEW_INCREMENTAL_MAINTENANCE)
+			result = true;
+		systable_endscan(tgscan);
+	}
+
+	systable_endscan(scan);
+	table_close(tgRel, AccessShareLock);
+	table_close(depRel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * ivm_other_changes_pending
+ *		Has one of the query's tables other than baseOid been changed by a
+ *		statement that hasn't run its AFTER STATEMENT triggers yet?
+ */
+static bool
+ivm_other_changes_pending(Query *query, Oid baseOid)
+{
+	ListCell   *lc;
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION && rte->relid != baseOid &&
+			AfterTriggerStatementPendingOnRel(rte->relid))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * make_tuplestore_enr
+ *		Wrap a tuplestore as an ephemeral named relation.
+ *
+ * If relid is valid the tuples are of that relation's rowtype, and tupdesc
+ * is ignored.
+ */
+static EphemeralNamedRelation
+make_tuplestore_enr(const char *name, Oid relid, TupleDesc tupdesc,
+					Tuplestorestate *tstore)
+{
+	EphemeralNamedRelation enr = palloc0(sizeof(EphemeralNamedRelationData));
+
+	enr->md.name = pstrdup(name);
+	enr->md.reliddesc = relid;
+	enr->md.tupdesc = OidIsValid(relid) ? NULL : tupdesc;
+	enr->md.enrtype = ENR_NAMED_TUPLESTORE;
+	enr->md.enrtuples = tuplestore_tuple_count(tstore);
+	enr->reldata = tstore;
+
+	return enr;
+}
+
+/*
+ * make_tuplestore_rte
+ *		Build a range table entry scanning an ephemeral named relation, the
+ *		way addRangeTableEntryForENR would.
+ */
+static RangeTblEntry *
+make_tuplestore_rte(EphemeralNamedRelation enr, char *aliasname)
+{
+	RangeTblEntry *rte = makeNode(RangeTblEntry);
+	TupleDesc	tupdesc = ENRMetadataGetTupDesc(&enr->md);
+	int			attno;
+
+	rte->rtekind = RTE_NAMEDTUPLESTORE;
+	rte->relid = enr->md.reliddesc;
+	rte->enrname = enr->md.name;
+	rte->enrtuples = enr->md.enrtuples;
+	rte->eref = makeAlias(aliasname, NIL);
+
+	for (attno = 0; attno < tupdesc->natts; attno++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attno);
+
+		if (att->attisdropped)
+		{
+			rte->eref->colnames = lappend(rte->eref->colnames, makeString(""));
+			rte->coltypes = lappend_oid(rte->coltypes, InvalidOid);
+			rte->coltypmods = lappend_int(rte->coltypmods, 0);
+			rte->colcollations = lappend_oid(rte->colcollations, InvalidOid);
+		}
+		else
+		{
+			rte->eref->colnames = lappend(rte->eref->colnames,
+										  makeString(pstrdup(NameStr(att->attname))));
+			rte->coltypes = lappend_oid(rte->coltypes, att->atttypid);
+			rte->coltypmods = lappend_int(rte->coltypmods, att->atttypmod);
+			rte->colcollations = lappend_oid(rte->colcollations,
+											 att->attcollation);
+		}
+	}
+
+	rte->lateral = false;
+	rte->inh = false;
+	rte->inFromCl = true;
+
+	return rte;
+}
+
+/*
+ * ivm_execute_query
+ *		Run a maintenance query with the active snapshot, appending its
+ *		result to "tstore".
+ *
+ * The result's tuple descriptor is returned in *tupdesc if that is NULL on
+ * entry.
+ */
+static void
+ivm_execute_query(Query *query, QueryEnvironment *queryEnv,
+				  Tuplestorestate *tstore, TupleDesc *tupdesc)
+{
+	List	   *rewritten;
+	PlannedStmt *plan;
+	DestReceiver *dest;
+	QueryDesc  *queryDesc;
+
+	rewritten = QueryRewrite(query);
+
+	/* SELECT should never rewrite to more or less than one SELECT query */
+	if (list_length(rewritten) != 1)
+		elog(ERROR, "unexpected rewrite result for incremental materialized view maintenance");
+	query = linitial_node(Query, rewritten);
+
+	CHECK_FOR_INTERRUPTS();
+
+	plan = pg_plan_query(query, NULL, 0, NULL);
+
+	dest = CreateDestReceiver(DestTuplestore);
+	SetTuplestoreDestReceiverParams(dest, tstore, CurrentMemoryContext,
+									false, NULL, NULL);
+
+	queryDesc = CreateQueryDesc(plan, "", GetActiveSnapshot(),
+								InvalidSnapshot, dest, NULL, queryEnv, 0);
+
+	ExecutorStart(queryDesc, 0);
+	ExecutorRun(queryDesc, ForwardScanDirection, 0L, true);
+
+	if (*tupdesc == NULL)
+		*tupdesc = CreateTupleDescCopy(queryDesc->tupDesc);
+
+	ExecutorFinish(queryDesc);
+	ExecutorEnd(queryDesc);
+
+	FreeQueryDesc(queryDesc);
+	dest->rDestroy(dest);
+}
+
+/*
+ * ivm_collect_keys
+ *		Compute the keys of the groups affected by a change to one table.
+ *
+ * "query" is the view's query, and "rtindex" the changed table's range table
+ * index in it.  Each of the transition tables that were supplied is joined
+ * with the current contents of the other tables, and its grouping
+ * expressions collected.  The keys tuplestore may contain duplicates.
+ */
+static Tuplestorestate *
+ivm_collect_keys(Query *query, Index rtindex, Oid baseOid,
+				 Tuplestorestate *oldtable, Tuplestorestate *newtable,
+				 TupleDesc *keydesc)
+{
+	Tuplestorestate *keys = tuplestore_begin_heap(false, false, work_mem);
+	Tuplestorestate *deltas[2];
+	int			i;
+
+	deltas[0] = oldtable;
+	deltas[1] = newtable;
+
+	for (i = 0; i < lengthof(deltas); i++)
+	{
+		EphemeralNamedRelation enr;
+		QueryEnvironment *queryEnv;
+		Query	   *keyquery;
+		RangeTblEntry *rte;
+		List	   *tlist = NIL;
+		ListCell   *lc;
+
+		if (deltas[i] == NULL || tuplestore_tuple_count(deltas[i]) == 0)
+			continue;
+
+		enr = make_tuplestore_enr(IVM_DELTA_ENRNAME, baseOid, NULL, deltas[i]);
+		queryEnv = create_queryEnv();
+		register_ENR(queryEnv, enr);
+
+		/* Read the transition table in place of the table itself. */
+		keyquery = copyObject(query);
+		rte = rt_fetch(rtindex, keyquery->rtable);
+		lfirst(list_nth_cell(keyquery->rtable, rtindex - 1)) =
+			make_tuplestore_rte(enr, rte->eref->aliasname);
+
+		/* Keep just the grouping, throwing away aggregates and HAVING. */
+		foreach(lc, keyquery->groupClause)
+		{
+			SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+			TargetEntry *tle;
+
+			tle = flatCopyTargetEntry(get_sortgroupclause_tle(sgc,
+															  keyquery->targetList));
+			tle->resno = list_length(tlist) + 1;
+			tlist = lappend(tlist, tle);
+		}
+		keyquery->targetList = tlist;
+		keyquery->hasAggs = false;
+		keyquery->havingQual = NULL;
+		keyquery->sortClause = NIL;
+
+		ivm_execute_query(keyquery, queryEnv, keys, keydesc);
+	}
+
+	return keys;
+}
+
+/*
+ * ivm_recompute_query
+ *		Restrict the view's query to the groups whose keys are in "keys".
+ *
+ * This adds "AND EXISTS (SELECT FROM keys k WHERE expr1 = k.k1 AND ...)" to
+ * the query's WHERE clause, which the planner turns into a semi-join.  The
+ * comparison is made null-safe for key columns known to contain a NULL,
+ * since GROUP BY puts all NULLs into one group.
+ */
+static Query *
+ivm_recompute_query(Query *query, EphemeralNamedRelation keys,
+					bool *keynulls)
+{
+	Query	   *newquery = copyObject(query);
+	Query	   *subquery = makeNode(Query);
+	SubLink    *sublink = makeNode(SubLink);
+	RangeTblRef *rtr = makeNode(RangeTblRef);
+	List	   *quals = NIL;
+	ListCell   *lc;
+
+	subquery->commandType = CMD_SELECT;
+	subquery->querySource = QSRC_ORIGINAL;
+	subquery->canSetTag = true;
+	subquery->rtable = list_make1(make_tuplestore_rte(keys, "k"));
+	rtr->rtindex = 1;
+
+	foreach(lc, newquery->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, newquery->targetList);
+		int			keyno = list_length(quals);
+		Node	   *expr;
+		Var		   *key;
+		Expr	   *qual;
+
+		expr = copyObject((Node *) tle->expr);
+		IncrementVarSublevelsUp(expr, 1, 0);
+		key = makeVar(1, keyno + 1, exprType(expr), exprTypmod(expr),
+					  exprCollation(expr), 0);
+
+		qual = make_opclause(sgc->eqop, BOOLOID, false,
+							 (Expr *) expr, (Expr *) key,
+							 InvalidOid, exprCollation(expr));
+
+		if (keynulls[keyno])
+		{
+			NullTest   *exprnull = makeNode(NullTest);
+			NullTest   *keynull = makeNode(NullTest);
+
+			exprnull->arg = (Expr *) copyObject(expr);
+			exprnull->nulltesttype = IS_NULL;
+			exprnull->argisrow = false;
+			exprnull->location = -1;
+			keynull->arg = (Expr *) copyObject(key);
+			keynull->nulltesttype = IS_NULL;
+			keynull->argisrow = false;
+			keynull->location = -1;
+
+			qual = makeBoolExpr(OR_EXPR,
+								list_make2(qual,
+										   makeBoolExpr(AND_EXPR,
+														list_make2(exprnull,
+																   keynull),
+														-1)),
+								-1);
+		}
+
+		quals = lappend(quals, qual);
+	}
+
+	subquery->jointree = makeFromExpr(list_make1(rtr),
+									  (Node *) make_ands_explicit(quals));
+
+	sublink->subLinkType = EXISTS_SUBLINK;
+	sublink->subLinkId = 0;
+	sublink->testexpr = NULL;
+	sublink->operName = NIL;
+	sublink->subselect = (Node *) subquery;
+	sublink->location = -1;
+
+	newquery->jointree->quals = make_and_qual(newquery->jointree->quals,
+											  (Node *) sublink);
+	newquery->hasSubLinks = true;
+
+	return newquery;
+}
+
+/*
+ * ivm_apply
+ *		Replace the affected groups of the matview with their new contents.
+ *
+ * If "keys" is NULL, all of the matview is replaced.
+ */
+static void
+ivm_apply(Relation matviewRel, Query *query, EphemeralNamedRelation keys,
+		  bool *keynulls, EphemeralNamedRelation newdata)
+{
+	StringInfoData querybuf;
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	char	   *matviewname;
+	SPIPlanPtr	plan;
+
+	initStringInfo(&querybuf);
+	matviewname = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+											 RelationGetRelationName(matviewRel));
+
+	/* Open SPI context. */
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	if (keys && SPI_register_relation(keys) != SPI_OK_REL_REGISTER)
+		elog(ERROR, "SPI_register_relation failed");
+	if (SPI_register_relation(newdata) != SPI_OK_REL_REGISTER)
+		elog(ERROR, "SPI_register_relation failed");
+
+	appendStringInfo(&querybuf, "DELETE FROM %s mv", matviewname);
+	if (keys)
+	{
+		ListCell   *lc;
+		int			keyno = 0;
+
+		appendStringInfo(&querybuf,
+						 " WHERE EXISTS (SELECT 1 FROM %s k WHERE ",
+						 keys->md.name);
+
+		foreach(lc, query->groupClause)
+		{
+			SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+			TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+			Form_pg_attribute attr = TupleDescAttr(tupdesc, tle->resno - 1);
+			TupleDesc	keydesc = keys->md.tupdesc;
+			const char *leftop;
+			const char *rightop;
+
+			if (keyno > 0)
+				appendStringInfoString(&querybuf, " AND ");
+
+			leftop = quote_qualified_identifier("mv", NameStr(attr->attname));
+			rightop = quote_qualified_identifier("k",
+												 NameStr(TupleDescAttr(keydesc, keyno)->attname));
+
+			if (keynulls[keyno])
+				appendStringInfoChar(&querybuf, '(');
+			generate_operator_clause(&querybuf,
+									 leftop, attr->atttypid,
+									 sgc->eqop,
+									 rightop, attr->atttypid);
+			if (keynulls[keyno])
+				appendStringInfo(&querybuf, " OR (%s IS NULL AND %s IS NULL))",
+								 leftop, rightop);
+			keyno++;
+		}
+		appendStringInfoChar(&querybuf, ')');
+	}
+
+	OpenMatViewIncrementalMaintenance();
+
+	/* Deletes must come before inserts; do them first. */
+	plan = SPI_prepare(querybuf.data, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare returned %s for %s",
+			 SPI_result_code_string(SPI_result), querybuf.data);
+	if (SPI_execute_snapshot(plan, NULL, NULL, GetActiveSnapshot(),
+							 InvalidSnapshot, false, true, 0) != SPI_OK_DELETE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/* Inserts go last. */
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s SELECT * FROM %s",
+					 matviewname, newdata->md.name);
+	plan = SPI_prepare(querybuf.data, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare returned %s for %s",
+			 SPI_result_code_string(SPI_result), querybuf.data);
+	if (SPI_execute_snapshot(plan, NULL, NULL, GetActiveSnapshot(),
+							 InvalidSnapshot, false, true, 0) != SPI_OK_INSERT)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/* We're done maintaining the materialized view. */
+	CloseMatViewIncrementalMaintenance();
+
+	/* Close SPI context. */
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+}
+
+/*
+ * matview_incremental_maintenance
+ *		Trigger function bringing an incremental materialized view up to date
+ *		after a change to one of its tables.
+ *
+ * The trigger's only argument is the OID of the matview.
+ */
+Datum
+matview_incremental_maintenance(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Trigger    *trigger;
+	Oid			matviewOid;
+	Oid			baseOid;
+	Relation	matviewRel;
+	Query	   *query;
+	Index		rtindex = 0;
+	ListCell   *lc;
+	Tuplestorestate *keystore = NULL;
+	TupleDesc	keydesc = NULL;
+	EphemeralNamedRelation keys = NULL;
+	bool	   *keynulls = NULL;
+	Tuplestorestate *newstore;
+	TupleDesc	newdesc = NULL;
+	EphemeralNamedRelation newdata;
+	QueryEnvironment *queryEnv;
+	Oid			relowner;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" was not called by trigger manager",
+						"matview_incremental_maintenance")));
+
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) ||
+		!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" must be fired AFTER STATEMENT",
+						"matview_incremental_maintenance")));
+
+	trigger = trigdata->tg_trigger;
+	if (trigger->tgnargs != 1)
+		elog(ERROR, "wrong number of arguments for function \"%s\"",
+			 "matview_incremental_maintenance");
+	matviewOid = DatumGetObjectId(DirectFunctionCall1(oidin,
+													  CStringGetDatum(trigger->tgargs[0])));
+	baseOid = RelationGetRelid(trigdata->tg_relation);
+
+	/* Nothing to do if the statement didn't change any rows. */
+	if (!TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event) &&
+		(trigdata->tg_oldtable == NULL ||
+		 tuplestore_tuple_count(trigdata->tg_oldtable) == 0) &&
+		(trigdata->tg_newtable == NULL ||
+		 tuplestore_tuple_count(trigdata->tg_newtable) == 0))
+		return PointerGetDatum(NULL);
+
+	/*
+	 * Serialize against other maintenance and against concurrent REFRESH,
+	 * and block readers that would lock rows we are about to replace.
+	 */
+	matviewRel = table_open(matviewOid, ExclusiveLock);
+
+	/* An unpopulated matview will be computed from scratch on REFRESH. */
+	if (!RelationIsPopulated(matviewRel))
+	{
+		table_close(matviewRel, NoLock);
+		return PointerGetDatum(NULL);
+	}
+
+	query = copyObject(get_matview_query(matviewRel));
+	AcquireRewriteLocks(query, true, false);
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION && rte->relid == baseOid)
+		{
+			rtindex = foreach_current_index(lc) + 1;
+			break;
+		}
+	}
+	if (rtindex == 0)
+		elog(ERROR, "materialized view \"%s\" does not reference relation \"%s\"",
+			 RelationGetRelationName(matviewRel),
+			 RelationGetRelationName(trigdata->tg_relation));
+
+	/*
+	 * Run as the matview's owner, as REFRESH does, and arrange to make GUC
+	 * variable changes local to this function.
+	 */
+	relowner = matviewRel->rd_rel->relowner;
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+
+	/*
+	 * Use a fresh snapshot, so that we see the contents of the matview and of
+	 * the other tables as left by any maintenance that committed before we
+	 * got our lock, even in a REPEATABLE READ transaction.
+	 */
+	CommandCounterIncrement();
+	PushActiveSnapshot(GetLatestSnapshot());
+
+	/*
+	 * Find the affected groups, unless the whole view needs to be recomputed:
+	 * after TRUNCATE, or while changes to the other tables are still to be
+	 * maintained.
+	 */
+	if (!TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event) &&
+		!ivm_other_changes_pending(query, baseOid))
+	{
+		TupleTableSlot *slot;
+		int			keyno;
+
+		keystore = ivm_collect_keys(query, rtindex, baseOid,
+									trigdata->tg_oldtable,
+									trigdata->tg_newtable,
+									&keydesc);
+
+		/* Rows outside the view's WHERE clause don't affect it. */
+		if (tuplestore_tuple_count(keystore) == 0)
+		{
+			tuplestore_end(keystore);
+			goto done;
+		}
+
+		/* Name the key columns, for use in SQL. */
+		for (keyno = 0; keyno < keydesc->natts; keyno++)
+			snprintf(NameStr(TupleDescAttr(keydesc, keyno)->attname),
+					 NAMEDATALEN, "k%d", keyno + 1);
+
+		/* Find out which key columns need null-safe comparisons. */
+		keynulls = palloc0(sizeof(bool) * keydesc->natts);
+		slot = MakeSingleTupleTableSlot(keydesc, &TTSOpsMinimalTuple);
+		while (tuplestore_gettupleslot(keystore, true, false, slot))
+		{
+			for (keyno = 0; keyno < keydesc->natts; keyno++)
+			{
+				if (slot_attisnull(slot, keyno + 1))
+					keynulls[keyno] = true;
+			}
+		}
+		ExecDropSingleTupleTableSlot(slot);
+		tuplestore_rescan(keystore);
+
+		keys = make_tuplestore_enr(IVM_KEYS_ENRNAME, InvalidOid, keydesc,
+								   keystore);
+	}
+
+	/* Compute the new contents of the affected groups. */
+	newstore = tuplestore_begin_heap(false, false, work_mem);
+	queryEnv = create_queryEnv();
+	if (keys)
+	{
+		register_ENR(queryEnv, keys);
+		ivm_execute_query(ivm_recompute_query(query, keys, keynulls),
+						  queryEnv, newstore, &newdesc);
+	}
+	else
+		ivm_execute_query(copyObject(query), queryEnv, newstore, &newdesc);
+	newdata = make_tuplestore_enr(IVM_NEWDATA_ENRNAME, InvalidOid, newdesc,
+								  newstore);
+
+	/* And put them into the matview. */
+	{
+		int			old_depth = matview_maintenance_depth;
+
+		PG_TRY();
+		{
+			ivm_apply(matviewRel, query, keys, keynulls, newdata);
+		}
+		PG_CATCH();
+		{
+			matview_maintenance_depth = old_depth;
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		Assert(matview_maintenance_depth == old_depth);
+	}
+
+	tuplestore_end(newstore);
+	if (keystore)
+		tuplestore_end(keystore);
+
+done:
+	PopActiveSnapshot();
+
+	/* Roll back any GUC changes */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	table_close(matviewRel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
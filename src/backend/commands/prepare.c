@@ -29,6 +29,7 @@
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_type.h"
+#include "postmaster/proxy.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
@@ -455,6 +456,8 @@ StorePreparedStatement(const char *stmt_name,
 
 	/* Now it's safe to move the CachedPlanSource to permanent memory */
 	SaveCachedPlan(plansource);
+
+	PinPooledSession("PREPARE");
 }
 
 /*
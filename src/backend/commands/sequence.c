@@ -33,12 +33,17 @@
 #include "commands/defrem.h"
 #include "commands/sequence.h"
 #include "commands/tablecmds.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_type.h"
+#include "postmaster/proxy.h"
+#include "port/atomics.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -55,6 +60,16 @@
  */
 #define SEQ_LOG_VALS	32
 
+/*
+ * Number of values fetched at a time into the shared sequence cache, see
+ * below.  Like the values of a CACHE, the unused ones are lost when the
+ * server stops or the cache slot is reused for another sequence.
+ */
+#define SEQ_SHARED_CACHE_VALS	1024
+
+/* Number of slots probed when looking for a sequence's shared cache slot */
+#define SEQ_SHARED_CACHE_PROBES	4
+
 /*
  * The "special area" of a sequence's buffer page looks like this.
  */
@@ -82,6 +97,7 @@ typedef struct SeqTableData
 	/* if last != cached, we have not used up all the cached values */
 	int64		increment;		/* copy of sequence's increment field */
 	/* note that increment is zero until we first do nextval_internal() */
+	int			shared_slot;	/* last used shared cache slot, or -1 */
 } SeqTableData;
 
 typedef SeqTableData *SeqTable;
@@ -94,6 +110,54 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Shared sequence cache.
+ *
+ * With a per-backend CACHE of 1, every nextval() call locks the sequence's
+ * buffer exclusively, which becomes a bottleneck when many sessions insert
+ * into the same table.  If shared_sequence_cache_slots is set, such sequences
+ * instead fetch SEQ_SHARED_CACHE_VALS values at a time into a slot in shared
+ * memory, exactly as a CACHE would, and nextval() hands them out with an
+ * atomic fetch-and-add while holding the slot's lock in shared mode.  Only
+ * when the block of values is used up does a backend take the slot's lock
+ * exclusively and go back to the buffer to fetch (and WAL-log) the next one.
+ *
+ * A block is always an arithmetic progression starting at "base": the
+ * fetch loop in nextval_internal() never wraps around a CYCLE except for
+ * the first value it returns.  setval(), ALTER SEQUENCE and the like
+ * invalidate the slot after changing the sequence; values handed out from
+ * the old block concurrently with them are no different from values
+ * returned by a concurrent nextval().
+ *
+ * Slots are found by probing SEQ_SHARED_CACHE_PROBES slots starting at a
+ * position computed from the database and sequence OIDs.  Two backends may
+ * concurrently claim two different slots for the same sequence; that wastes
+ * a slot but is otherwise harmless, since each block is fetched from the
+ * sequence's buffer.
+ */
+typedef struct SeqCacheSlot
+{
+	LWLock		lock;			/* protects the other fields, see above */
+	Oid			dbid;			/* database, or InvalidOid if slot unused */
+	Oid			relid;			/* pg_class OID of the sequence */
+	Oid			filenode;		/* relfilenode the block was fetched from */
+	int64		base;			/* first value of the block */
+	int64		increment;		/* the sequence's increment */
+	uint64		count;			/* number of values in the block */
+	pg_atomic_uint64 next;		/* index of next value to hand out */
+} SeqCacheSlot;
+
+/* Keep slots on separate cache lines, they are hammered concurrently */
+typedef union SeqCacheSlotPadded
+{
+	SeqCacheSlot slot;
+	char		pad[2 * PG_CACHE_LINE_SIZE];
+} SeqCacheSlotPadded;
+
+int			shared_sequence_cache_slots = 0;
+
+static SeqCacheSlotPadded *SeqCacheSlots = NULL;
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static Relation lock_and_open_sequence(SeqTable seq);
 static void create_seq_hashtable(void);
@@ -108,6 +172,11 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static bool seq_cache_use(Relation seqrel);
+static bool seq_cache_next(SeqTable elm, Relation seqrel, int64 *result);
+static SeqCacheSlot *seq_cache_lock_slot(SeqTable elm, Relation seqrel,
+										 int64 *result);
+static void seq_cache_invalidate(Oid relid);
 
 
 /*
@@ -332,6 +401,7 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_cache_invalidate(seq_relid);
 
 	relation_close(seq_rel, NoLock);
 }
@@ -514,6 +584,9 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 
 	InvokeObjectPostAlterHook(RelationRelationId, relid, 0);
 
+	/* the parameters of values in the shared cache may have changed */
+	seq_cache_invalidate(relid);
+
 	ObjectAddressSet(address, RelationRelationId, relid);
 
 	table_close(rel, RowExclusiveLock);
@@ -538,6 +611,8 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	table_close(rel, RowExclusiveLock);
+
+	seq_cache_invalidate(relid);
 }
 
 /*
@@ -598,6 +673,7 @@ nextval_internal(Oid relid, bool check_permissions)
 				rescnt = 0;
 	bool		cycle;
 	bool		logit = false;
+	SeqCacheSlot *slot = NULL;
 
 	/* open and lock sequence */
 	init_sequence(relid, &elm, &seqrel);
@@ -621,6 +697,9 @@ nextval_internal(Oid relid, bool check_permissions)
 	 */
 	PreventCommandIfParallelMode("nextval()");
 
+	/* currval(), lastval() and cached values are per-backend state */
+	PinPooledSession("nextval()");
+
 	if (elm->last != elm->cached)	/* some numbers were cached */
 	{
 		Assert(elm->last_valid);
@@ -631,6 +710,14 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/* try to take a value from the shared cache */
+	if (seq_cache_use(seqrel) && seq_cache_next(elm, seqrel, &result))
+	{
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -642,6 +729,23 @@ nextval_internal(Oid relid, bool check_permissions)
 	cycle = pgsform->seqcycle;
 	ReleaseSysCache(pgstuple);
 
+	/*
+	 * Sequences without a per-backend cache use the shared one, if enabled.
+	 * Once we hold the slot's lock exclusively, check whether somebody else
+	 * refilled it meanwhile; if not, fetch a whole block of values below.
+	 */
+	if (cache == 1 && seq_cache_use(seqrel))
+	{
+		slot = seq_cache_lock_slot(elm, seqrel, &result);
+		if (slot == NULL)
+		{
+			relation_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+		cache = SEQ_SHARED_CACHE_VALS;
+	}
+
 	/* lock page' buffer and read tuple */
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
@@ -756,6 +860,17 @@ nextval_internal(Oid relid, bool check_permissions)
 	elm->cached = last;			/* last fetched number */
 	elm->last_valid = true;
 
+	/* or rather, publish the fetched block in the shared cache */
+	if (slot != NULL)
+	{
+		slot->filenode = seqrel->rd_rel->relfilenode;
+		slot->base = result;
+		slot->increment = incby;
+		slot->count = rescnt;
+		pg_atomic_write_u64(&slot->next, 1);	/* we return the first one */
+		elm->cached = result;
+	}
+
 	last_used_seq = elm;
 
 	/*
@@ -821,6 +936,9 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	UnlockReleaseBuffer(buf);
 
+	if (slot != NULL)
+		LWLockRelease(&slot->lock);
+
 	relation_close(seqrel, NoLock);
 
 	return result;
@@ -970,6 +1088,7 @@ do_setval(Oid relid, int64 next, bool iscalled)
 	{
 		elm->last = next;		/* last returned number */
 		elm->last_valid = true;
+		PinPooledSession("setval()");
 	}
 
 	/* In any case, forget any future cached numbers */
@@ -1011,6 +1130,9 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	UnlockReleaseBuffer(buf);
 
+	/* values fetched into the shared cache before us are stale now */
+	seq_cache_invalidate(relid);
+
 	relation_close(seqrel, NoLock);
 }
 
@@ -1126,6 +1248,7 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 		elm->lxid = InvalidLocalTransactionId;
 		elm->last_valid = false;
 		elm->last = elm->cached = 0;
+		elm->shared_slot = -1;
 	}
 
 	/*
@@ -1902,6 +2025,217 @@ seq_redo(XLogReaderState *record)
 	pfree(localpage);
 }
 
+/*
+ * Report shared memory space needed by SequenceCacheShmemInit
+ */
+Size
+SequenceCacheShmemSize(void)
+{
+	return mul_size(shared_sequence_cache_slots, sizeof(SeqCacheSlotPadded));
+}
+
+/*
+ * Allocate and initialize the shared sequence cache, if enabled
+ */
+void
+SequenceCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_sequence_cache_slots == 0)
+		return;
+
+	SeqCacheSlots = (SeqCacheSlotPadded *)
+		ShmemInitStruct("Sequence Cache", SequenceCacheShmemSize(), &found);
+
+	if (!found)
+	{
+		for (int i = 0; i < shared_sequence_cache_slots; i++)
+		{
+			SeqCacheSlot *slot = &SeqCacheSlots[i].slot;
+
+			LWLockInitialize(&slot->lock, LWTRANCHE_SEQUENCE_CACHE);
+			slot->dbid = InvalidOid;
+			slot->relid = InvalidOid;
+			slot->filenode = InvalidOid;
+			slot->base = 0;
+			slot->increment = 0;
+			slot->count = 0;
+			pg_atomic_init_u64(&slot->next, 0);
+		}
+	}
+}
+
+/*
+ * Can this sequence use the shared cache?  Temporary sequences are private
+ * to their session anyway.
+ */
+static bool
+seq_cache_use(Relation seqrel)
+{
+	return SeqCacheSlots != NULL &&
+		seqrel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT;
+}
+
+/* First slot to probe for the given sequence */
+static int
+seq_cache_home(Oid relid)
+{
+	uint32		h;
+
+	h = hash_combine(murmurhash32(MyDatabaseId), murmurhash32(relid));
+	return h % shared_sequence_cache_slots;
+}
+
+/*
+ * Hand out the next value of the block in a slot we hold locked, if there is
+ * one left.  The caller has verified the slot belongs to the sequence.
+ */
+static bool
+seq_cache_take(SeqCacheSlot *slot, SeqTable elm, Relation seqrel,
+			   int64 *result)
+{
+	uint64		n;
+
+	if (slot->filenode != seqrel->rd_rel->relfilenode)
+		return false;
+
+	n = pg_atomic_fetch_add_u64(&slot->next, 1);
+	if (n >= slot->count)
+		return false;
+
+	*result = slot->base + (int64) n * slot->increment;
+
+	elm->increment = slot->increment;
+	elm->last = elm->cached = *result;
+	elm->last_valid = true;
+
+	return true;
+}
+
+/*
+ * Fast path of nextval() for sequences in the shared cache: take a value
+ * from the slot we used last time, holding its lock in shared mode.
+ */
+static bool
+seq_cache_next(SeqTable elm, Relation seqrel, int64 *result)
+{
+	SeqCacheSlot *slot;
+	bool		found = false;
+
+	if (elm->shared_slot < 0)
+		return false;
+
+	slot = &SeqCacheSlots[elm->shared_slot].slot;
+
+	LWLockAcquire(&slot->lock, LW_SHARED);
+	if (slot->dbid == MyDatabaseId && slot->relid == elm->relid)
+		found = seq_cache_take(slot, elm, seqrel, result);
+	LWLockRelease(&slot->lock);
+
+	return found;
+}
+
+/*
+ * Find or claim the sequence's shared cache slot, and lock it exclusively so
+ * that the caller can fetch the next block of values into it.
+ *
+ * If somebody else refilled the slot while we were waiting for the lock,
+ * take a value from it instead, store it in *result, and return NULL.
+ */
+static SeqCacheSlot *
+seq_cache_lock_slot(SeqTable elm, Relation seqrel, int64 *result)
+{
+	SeqCacheSlot *slot = NULL;
+	int			home = seq_cache_home(elm->relid);
+	int			nprobes = Min(SEQ_SHARED_CACHE_PROBES,
+							  shared_sequence_cache_slots);
+	int			idx = home;
+
+	/* look for the sequence's own slot first, then for an unused one */
+	for (int pass = 0; pass < 2 && slot == NULL; pass++)
+	{
+		for (int i = 0; i < nprobes; i++)
+		{
+			SeqCacheSlot *s;
+
+			idx = (home + i) % shared_sequence_cache_slots;
+			s = &SeqCacheSlots[idx].slot;
+
+			LWLockAcquire(&s->lock, LW_EXCLUSIVE);
+			if ((s->dbid == MyDatabaseId && s->relid == elm->relid) ||
+				(pass == 1 && s->dbid == InvalidOid))
+			{
+				slot = s;
+				break;
+			}
+			LWLockRelease(&s->lock);
+		}
+	}
+
+	/* all probed slots are used by other sequences, take over the first */
+	if (slot == NULL)
+	{
+		idx = home;
+		slot = &SeqCacheSlots[idx].slot;
+		LWLockAcquire(&slot->lock, LW_EXCLUSIVE);
+	}
+
+	elm->shared_slot = idx;
+
+	if (slot->dbid == MyDatabaseId && slot->relid == elm->relid)
+	{
+		if (seq_cache_take(slot, elm, seqrel, result))
+		{
+			LWLockRelease(&slot->lock);
+			return NULL;
+		}
+	}
+	else
+	{
+		slot->dbid = MyDatabaseId;
+		slot->relid = elm->relid;
+		slot->filenode = InvalidOid;
+		slot->count = 0;
+	}
+
+	return slot;
+}
+
+/*
+ * Forget the values of a sequence held in the shared cache, after changing
+ * the sequence by other means than nextval().
+ */
+static void
+seq_cache_invalidate(Oid relid)
+{
+	int			home;
+	int			nprobes;
+
+	if (SeqCacheSlots == NULL)
+		return;
+
+	home = seq_cache_home(relid);
+	nprobes = Min(SEQ_SHARED_CACHE_PROBES, shared_sequence_cache_slots);
+
+	for (int i = 0; i < nprobes; i++)
+	{
+		SeqCacheSlot *slot;
+
+		slot = &SeqCacheSlots[(home + i) % shared_sequence_cache_slots].slot;
+
+		LWLockAcquire(&slot->lock, LW_EXCLUSIVE);
+		if (slot->dbid == MyDatabaseId && slot->relid == relid)
+		{
+			slot->dbid = InvalidOid;
+			slot->relid = InvalidOid;
+			slot->filenode = InvalidOid;
+			slot->count = 0;
+		}
+		LWLockRelease(&slot->lock);
+	}
+}
+
 /*
  * Flush cached sequence information.
  */
@@ -223,6 +223,14 @@ typedef struct NewColumnValue
 	bool		is_generated;	/* is it a GENERATED expression? */
 } NewColumnValue;
 
+/*
+ * When rewriting a table, ATRewriteTable buffers this many new tuples, or
+ * tuples of about this total size, and writes them out with
+ * table_multi_insert, as COPY FROM does.
+ */
+#define REWRITE_MAX_BUFFERED_TUPLES		1000
+#define REWRITE_MAX_BUFFERED_BYTES		65535
+
 /*
  * Error-reporting support for RemoveRelations
  */
@@ -5621,7 +5629,7 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 		newrel = NULL;
 
 	/*
-	 * Prepare a BulkInsertState and options for table_tuple_insert.  The FSM
+	 * Prepare a BulkInsertState and options for table_multi_insert.  The FSM
 	 * is empty, so don't bother using it.
 	 */
 	if (newrel)
@@ -5709,6 +5717,10 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 		List	   *dropped_attrs = NIL;
 		ListCell   *lc;
 		Snapshot	snapshot;
+		TupleTableSlot **bufslots = NULL;
+		int			nbufslots = 0;
+		int			nbuffered = 0;
+		Size		bufferedBytes = 0;
 
 		if (newrel)
 			ereport(DEBUG1,
@@ -5931,16 +5943,58 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 							 errtable(oldrel)));
 			}
 
-			/* Write the tuple out to the new relation */
+			/*
+			 * Write the tuple out to the new relation.  It's copied into a
+			 * buffer of slots, which is flushed with a single
+			 * table_multi_insert call when it fills up.  The new tuple is
+			 * always a virtual one in newslot, so its size is easy to get.
+			 */
 			if (newrel)
-				table_tuple_insert(newrel, insertslot, mycid,
-								   ti_options, bistate);
+			{
+				Assert(insertslot == newslot);
+
+				if (bufslots == NULL)
+				{
+					bufslots = (TupleTableSlot **)
+						MemoryContextAlloc(oldCxt,
+										   REWRITE_MAX_BUFFERED_TUPLES *
+										   sizeof(TupleTableSlot *));
+				}
+				if (nbuffered == nbufslots)
+				{
+					MemoryContextSwitchTo(oldCxt);
+					bufslots[nbufslots++] = table_slot_create(newrel, NULL);
+					MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+				}
+
+				ExecCopySlot(bufslots[nbuffered++], insertslot);
+				bufferedBytes += heap_compute_data_size(newTupDesc,
+														insertslot->tts_values,
+														insertslot->tts_isnull);
+
+				if (nbuffered == REWRITE_MAX_BUFFERED_TUPLES ||
+					bufferedBytes >= REWRITE_MAX_BUFFERED_BYTES)
+				{
+					table_multi_insert(newrel, bufslots, nbuffered, mycid,
+									   ti_options, bistate);
+					for (i = 0; i < nbuffered; i++)
+						ExecClearTuple(bufslots[i]);
+					nbuffered = 0;
+					bufferedBytes = 0;
+				}
+			}
 
 			ResetExprContext(econtext);
 
 			CHECK_FOR_INTERRUPTS();
 		}
 
+		/* Write out whatever is left in the buffer */
+		if (nbuffered > 0)
+			table_multi_insert(newrel, bufslots, nbuffered, mycid,
+							   ti_options, bistate);
+		ResetExprContext(econtext);
+
 		MemoryContextSwitchTo(oldCxt);
 		table_endscan(scan);
 		UnregisterSnapshot(snapshot);
@@ -5948,6 +6002,10 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 		ExecDropSingleTupleTableSlot(oldslot);
 		if (newslot)
 			ExecDropSingleTupleTableSlot(newslot);
+		for (i = 0; i < nbufslots; i++)
+			ExecDropSingleTupleTableSlot(bufslots[i]);
+		if (bufslots)
+			pfree(bufslots);
 	}
 
 	FreeExecutorState(estate);
@@ -3678,6 +3678,10 @@ struct AfterTriggersTableData
 
 static AfterTriggersData afterTriggers;
 
+/* Does a trigger slot still hold the tuple an earlier event fetched at tid? */
+#define AfterTriggerSlotHoldsTID(slot, tid) \
+	(!TTS_EMPTY(slot) && ItemPointerEquals(&(slot)->tts_tid, (tid)))
+
 static void AfterTriggerExecute(EState *estate,
 								AfterTriggerEvent event,
 								ResultRelInfo *relInfo,
@@ -3687,6 +3691,7 @@ static void AfterTriggerExecute(EState *estate,
 								MemoryContext per_tuple_context,
 								TupleTableSlot *trig_tuple_slot1,
 								TupleTableSlot *trig_tuple_slot2);
+static void afterTriggerClearSlots(ResultRelInfo *relInfo);
 static AfterTriggersTableData *GetAfterTriggersTableData(Oid relid,
 														 CmdType cmdType);
 static TupleTableSlot *GetAfterTriggersStoreSlot(AfterTriggersTableData *table,
@@ -3697,6 +3702,7 @@ static SetConstraintState SetConstraintStateCopy(SetConstraintState state);
 static SetConstraintState SetConstraintStateAddItem(SetConstraintState state,
 													Oid tgoid, bool tgisdeferred);
 static void cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent);
+static bool afterTriggerPendingOnRel(Oid relid, bool stmtonly);
 
 
 /*
@@ -4105,11 +4111,22 @@ AfterTriggerExecute(EState *estate,
 			break;
 
 		default:
+
+			/*
+			 * Consecutive events for the same row, such as those of several
+			 * foreign key triggers on one table, share the tuple fetched for
+			 * the first of them; afterTriggerInvokeEvents clears the slots
+			 * when it is done with the relation.  The tuple stored at a TID
+			 * can't change under us, since our own transaction created or
+			 * deleted it.
+			 */
 			if (ItemPointerIsValid(&(event->ate_ctid1)))
 			{
 				LocTriggerData.tg_trigslot = ExecGetTriggerOldSlot(estate, relInfo);
 
-				if (!table_tuple_fetch_row_version(rel, &(event->ate_ctid1),
+				if (!AfterTriggerSlotHoldsTID(LocTriggerData.tg_trigslot,
+											  &(event->ate_ctid1)) &&
+					!table_tuple_fetch_row_version(rel, &(event->ate_ctid1),
 												   SnapshotAny,
 												   LocTriggerData.tg_trigslot))
 					elog(ERROR, "failed to fetch tuple1 for AFTER trigger");
@@ -4128,7 +4145,9 @@ AfterTriggerExecute(EState *estate,
 			{
 				LocTriggerData.tg_newslot = ExecGetTriggerNewSlot(estate, relInfo);
 
-				if (!table_tuple_fetch_row_version(rel, &(event->ate_ctid2),
+				if (!AfterTriggerSlotHoldsTID(LocTriggerData.tg_newslot,
+											  &(event->ate_ctid2)) &&
+					!table_tuple_fetch_row_version(rel, &(event->ate_ctid2),
 												   SnapshotAny,
 												   LocTriggerData.tg_newslot))
 					elog(ERROR, "failed to fetch tuple2 for AFTER trigger");
@@ -4198,15 +4217,6 @@ AfterTriggerExecute(EState *estate,
 	if (should_free_new)
 		heap_freetuple(LocTriggerData.tg_newtuple);
 
-	/* don't clear slots' contents if foreign table */
-	if (trig_tuple_slot1 == NULL)
-	{
-		if (LocTriggerData.tg_trigslot)
-			ExecClearTuple(LocTriggerData.tg_trigslot);
-		if (LocTriggerData.tg_newslot)
-			ExecClearTuple(LocTriggerData.tg_newslot);
-	}
-
 	/*
 	 * If doing EXPLAIN ANALYZE, stop charging time to this trigger, and count
 	 * one "tuple returned" (really the number of firings).
@@ -4216,6 +4226,22 @@ AfterTriggerExecute(EState *estate,
 }
 
 
+/*
+ * afterTriggerClearSlots()
+ *
+ *	Release the tuples AfterTriggerExecute left in a relation's trigger
+ *	slots for reuse by the following events.
+ */
+static void
+afterTriggerClearSlots(ResultRelInfo *relInfo)
+{
+	if (relInfo->ri_TrigOldSlot)
+		ExecClearTuple(relInfo->ri_TrigOldSlot);
+	if (relInfo->ri_TrigNewSlot)
+		ExecClearTuple(relInfo->ri_TrigNewSlot);
+}
+
+
 /*
  * afterTriggerMarkEvents()
  *
@@ -4366,7 +4392,11 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 				 */
 				if (rel == NULL || RelationGetRelid(rel) != evtshared->ats_relid)
 				{
+					/* reuse only tuples that we fetched ourselves */
+					if (rInfo != NULL)
+						afterTriggerClearSlots(rInfo);
 					rInfo = ExecGetTriggerResultRel(estate, evtshared->ats_relid);
+					afterTriggerClearSlots(rInfo);
 					rel = rInfo->ri_RelationDesc;
 					/* Catch calls with insufficient relcache refcounting */
 					Assert(!RelationHasReferenceCountZero(rel));
@@ -4428,6 +4458,8 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 				events->tailfree = chunk->freeptr;
 		}
 	}
+	if (rInfo != NULL)
+		afterTriggerClearSlots(rInfo);
 	if (slot1 != NULL)
 	{
 		ExecDropSingleTupleTableSlot(slot1);
@@ -5525,6 +5557,29 @@ AfterTriggerSetState(ConstraintsSetStmt *stmt)
  */
 bool
 AfterTriggerPendingOnRel(Oid relid)
+{
+	return afterTriggerPendingOnRel(relid, false);
+}
+
+/* ----------
+ * AfterTriggerStatementPendingOnRel()
+ *		Test to see if there are any pending AFTER STATEMENT events for rel.
+ *
+ * That is the case while a statement changing rel, or a statement run by one
+ * of its triggers, hasn't finished firing its triggers.  Incremental
+ * materialized view maintenance uses this to detect that the changes the
+ * statement made to rel haven't been accounted for yet.  As above, only
+ * local pending events are examined.
+ * ----------
+ */
+bool
+AfterTriggerStatementPendingOnRel(Oid relid)
+{
+	return afterTriggerPendingOnRel(relid, true);
+}
+
+static bool
+afterTriggerPendingOnRel(Oid relid, bool stmtonly)
 {
 	AfterTriggerEvent event;
 	AfterTriggerEventChunk *chunk;
@@ -5543,7 +5598,8 @@ AfterTriggerPendingOnRel(Oid relid)
 		if (event->ate_flags & AFTER_TRIGGER_DONE)
 			continue;
 
-		if (evtshared->ats_relid == relid)
+		if (evtshared->ats_relid == relid &&
+			(!stmtonly || !TRIGGER_FIRED_FOR_ROW(evtshared->ats_event)))
 			return true;
 	}
 
@@ -5551,6 +5607,8 @@ AfterTriggerPendingOnRel(Oid relid)
 	 * Also scan events queued by incomplete queries.  This could only matter
 	 * if TRUNCATE/etc is executed by a function or trigger within an updating
 	 * query on the same relation, which is pretty perverse, but let's check.
+	 * (Incremental materialized view maintenance does run within such a
+	 * query, though.)
 	 */
 	for (depth = 0; depth <= afterTriggers.query_depth && depth < afterTriggers.maxquerydepth; depth++)
 	{
@@ -5561,7 +5619,8 @@ AfterTriggerPendingOnRel(Oid relid)
 			if (event->ate_flags & AFTER_TRIGGER_DONE)
 				continue;
 
-			if (evtshared->ats_relid == relid)
+			if (evtshared->ats_relid == relid &&
+				(!stmtonly || !TRIGGER_FIRED_FOR_ROW(evtshared->ats_event)))
 				return true;
 		}
 	}
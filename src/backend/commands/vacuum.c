@@ -31,6 +31,7 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
+#include "catalog/catalog.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_inherits.h"
@@ -38,6 +39,7 @@
 #include "commands/cluster.h"
 #include "commands/defrem.h"
 #include "commands/vacuum.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "pgstat.h"
@@ -88,6 +90,7 @@ static void vac_truncate_clog(TransactionId frozenXID,
 							  MultiXactId lastSaneMinMulti);
 static bool vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params);
 static double compute_parallel_delay(void);
+static double compute_delay_scale(double scale);
 static VacOptValue get_vacoptval_from_boolean(DefElem *def);
 
 /*
@@ -107,6 +110,7 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 	bool		full = false;
 	bool		disable_page_skipping = false;
 	bool		process_toast = true;
+	bool		allow_reads = false;
 	ListCell   *lc;
 
 	/* index_cleanup and truncate values unspecified for now */
@@ -159,6 +163,8 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 		}
 		else if (strcmp(opt->defname, "process_toast") == 0)
 			process_toast = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "allow_reads") == 0)
+			allow_reads = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "truncate") == 0)
 			params.truncate = get_vacoptval_from_boolean(opt);
 		else if (strcmp(opt->defname, "parallel") == 0)
@@ -209,7 +215,8 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 		(freeze ? VACOPT_FREEZE : 0) |
 		(full ? VACOPT_FULL : 0) |
 		(disable_page_skipping ? VACOPT_DISABLE_PAGE_SKIPPING : 0) |
-		(process_toast ? VACOPT_PROCESS_TOAST : 0);
+		(process_toast ? VACOPT_PROCESS_TOAST : 0) |
+		(allow_reads ? VACOPT_ALLOW_READS : 0);
 
 	/* sanity checks on options */
 	Assert(params.options & (VACOPT_VACUUM | VACOPT_ANALYZE));
@@ -344,6 +351,13 @@ vacuum(List *relations, VacuumParams *params,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("PROCESS_TOAST required with VACUUM FULL")));
 
+	/* sanity check for ALLOW_READS */
+	if ((params->options & VACOPT_FULL) == 0 &&
+		(params->options & VACOPT_ALLOW_READS) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("VACUUM option ALLOW_READS requires FULL")));
+
 	/*
 	 * Send info about dead objects to the statistics collector, unless we are
 	 * in autovacuum --- autovacuum.c does this for itself.
@@ -1859,9 +1873,17 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params)
 	 * Determine the type of lock we want --- hard exclusive lock for a FULL
 	 * vacuum, but just ShareUpdateExclusiveLock for concurrent vacuum. Either
 	 * way, we can be sure that no other backend is vacuuming the same table.
+	 * A FULL vacuum that allows reads takes ExclusiveLock, and cluster_rel
+	 * upgrades it just before swapping in the new copy of the table; but
+	 * system catalogs always get the hard lock.
 	 */
-	lmode = (params->options & VACOPT_FULL) ?
-		AccessExclusiveLock : ShareUpdateExclusiveLock;
+	if (!(params->options & VACOPT_FULL))
+		lmode = ShareUpdateExclusiveLock;
+	else if ((params->options & VACOPT_ALLOW_READS) &&
+			 !IsCatalogRelationOid(relid))
+		lmode = ExclusiveLock;
+	else
+		lmode = AccessExclusiveLock;
 
 	/* open the relation and get the appropriate lock on it */
 	rel = vacuum_open_relation(relid, relation, params->options,
@@ -2026,6 +2048,8 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params)
 
 		if ((params->options & VACOPT_VERBOSE) != 0)
 			cluster_params.options |= CLUOPT_VERBOSE;
+		if ((params->options & VACOPT_ALLOW_READS) != 0)
+			cluster_params.options |= CLUOPT_ALLOW_READS;
 
 		/* VACUUM FULL is now a variant of CLUSTER; see cluster.c */
 		cluster_rel(relid, InvalidOid, &cluster_params);
@@ -2149,6 +2173,7 @@ void
 vacuum_delay_point(void)
 {
 	double		msec = 0;
+	static double delay_scale = 1.0;
 
 	/* Always check for interrupts */
 	CHECK_FOR_INTERRUPTS();
@@ -2171,6 +2196,12 @@ vacuum_delay_point(void)
 		if (msec > VacuumCostDelay * 4)
 			msec = VacuumCostDelay * 4;
 
+		if (VacuumCostTargetReadLatency > 0 && track_io_timing)
+		{
+			delay_scale = compute_delay_scale(delay_scale);
+			msec *= delay_scale;
+		}
+
 		(void) WaitLatch(MyLatch,
 						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
 						 msec,
@@ -2187,6 +2218,48 @@ vacuum_delay_point(void)
 	}
 }
 
+/*
+ * Adjust the factor by which vacuum_delay_point scales its naps.
+ *
+ * This looks at the reads done since the last call.  If their average
+ * latency was below vacuum_cost_target_read_latency, the storage seems to
+ * have capacity to spare and we nap less; if it was above, we nap more.
+ * The factor changes by a fixed ratio on each call, so it takes a few naps
+ * to move it a long way, and it's kept between 0.1 and 4.
+ */
+static double
+compute_delay_scale(double scale)
+{
+	static instr_time last_read_time;
+	static int64 last_reads = -1;
+	int64		reads;
+	instr_time	read_time;
+
+	reads = pgBufferUsage.shared_blks_read + pgBufferUsage.local_blks_read;
+	read_time = pgBufferUsage.blk_read_time;
+
+	if (last_reads >= 0 && reads - last_reads >= 16)
+	{
+		instr_time	elapsed = read_time;
+		double		latency;
+
+		INSTR_TIME_SUBTRACT(elapsed, last_read_time);
+		latency = INSTR_TIME_GET_MILLISEC(elapsed) / (reads - last_reads);
+
+		if (latency < VacuumCostTargetReadLatency)
+			scale = Max(scale * 0.8, 0.1);
+		else
+			scale = Min(scale * 1.25, 4.0);
+	}
+	else if (last_reads >= 0 && reads - last_reads > 0)
+		return scale;			/* too few reads to judge; keep counting */
+
+	last_reads = reads;
+	last_read_time = read_time;
+
+	return scale;
+}
+
 /*
  * Computes the vacuum delay for parallel workers.
  *
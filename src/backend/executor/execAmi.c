@@ -43,6 +43,7 @@
 #include "executor/nodeNamedtuplestorescan.h"
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
+#include "executor/nodeRedistribute.h"
 #include "executor/nodeRecursiveunion.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
@@ -179,6 +180,10 @@ ExecReScan(PlanState *node)
 			ExecReScanGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RedistributeState:
+			ExecReScanRedistribute((RedistributeState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecReScanIndexScan((IndexScanState *) node);
 			break;
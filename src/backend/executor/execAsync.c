@@ -18,6 +18,7 @@
 #include "executor/executor.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeForeignscan.h"
+#include "executor/nodeGather.h"
 
 /*
  * Asynchronously request a tuple from a designed async-capable node.
@@ -37,6 +38,9 @@ ExecAsyncRequest(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanRequest(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherRequest(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -57,6 +61,10 @@ ExecAsyncRequest(AsyncRequest *areq)
  * make a single call of the following form:
  *
  * AddWaitEventToSet(set, WL_SOCKET_READABLE, fd, NULL, areq);
+ *
+ * A node that waits for the process latch to be set instead just sets
+ * areq->wait_latch; the requestor adds the latch to the set itself, since
+ * only one latch event can be registered.
  */
 void
 ExecAsyncConfigureWait(AsyncRequest *areq)
@@ -70,6 +78,9 @@ ExecAsyncConfigureWait(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanConfigureWait(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherConfigureWait(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -96,6 +107,9 @@ ExecAsyncNotify(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanNotify(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherNotify(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -41,6 +41,7 @@
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/subscripting.h"
+#include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "utils/acl.h"
@@ -48,6 +49,7 @@
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/typcache.h"
 
 
@@ -58,6 +60,29 @@ typedef struct LastAttnumInfo
 	AttrNumber	last_scan;
 } LastAttnumInfo;
 
+/*
+ * A subexpression occurring several times in a projection's target list,
+ * which is evaluated only once per tuple.  occurrences lists the equal()
+ * nodes in evaluation order; the first one computes the value into value
+ * and isnull, from where it and all the others load it.
+ */
+typedef struct ExprCSEEntry
+{
+	List	   *occurrences;
+	bool		compiling;		/* compiling the first occurrence? */
+	bool		computed;		/* first occurrence compiled? */
+	bool		readonly;		/* could be an expanded datum? */
+	Datum		value;
+	bool		isnull;
+} ExprCSEEntry;
+
+/*
+ * Grouping the candidate subexpressions of a projection into ExprCSEEntrys
+ * compares them pairwise, so give up on target lists with more than this
+ * many of them.
+ */
+#define CSE_MAX_CANDIDATES	64
+
 static void ExecReadyExpr(ExprState *state);
 static void ExecInitExprRec(Expr *node, ExprState *state,
 							Datum *resv, bool *resnull);
@@ -65,6 +90,11 @@ static void ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args,
 						 Oid funcid, Oid inputcollid,
 						 ExprState *state);
 static void ExecInitExprSlots(ExprState *state, Node *node);
+static void ExecInitCSE(ExprState *state, List *targetList);
+static void cse_collect_occurrences(Node *node, List **occurrences);
+static bool cse_evaluates_args(Node *node);
+static bool ExecInitCSERef(ExprState *state, Expr *node,
+						   Datum *resv, bool *resnull);
 static void ExecPushExprSlots(ExprState *state, LastAttnumInfo *info);
 static bool get_last_attnums_walker(Node *node, LastAttnumInfo *info);
 static bool ExecComputeSlotInfo(ExprState *state, ExprEvalStep *op);
@@ -374,6 +404,9 @@ ExecBuildProjectionInfo(List *targetList,
 	/* Insert EEOP_*_FETCHSOME steps as needed */
 	ExecInitExprSlots(state, (Node *) targetList);
 
+	/* Find subexpressions we need to evaluate only once */
+	ExecInitCSE(state, targetList);
+
 	/* Now compile each tlist column */
 	foreach(lc, targetList)
 	{
@@ -472,6 +505,11 @@ ExecBuildProjectionInfo(List *targetList,
 	scratch.opcode = EEOP_DONE;
 	ExprEvalPushStep(state, &scratch);
 
+	/* the entries' values are referenced by the steps, so don't free them */
+	list_free(state->cse_entries);
+	state->cse_entries = NIL;
+	state->cse_unconditional = false;
+
 	ExecReadyExpr(state);
 
 	return projInfo;
@@ -901,6 +939,7 @@ ExecInitExprRec(Expr *node, ExprState *state,
 				Datum *resv, bool *resnull)
 {
 	ExprEvalStep scratch = {0};
+	bool		save_cse_unconditional = state->cse_unconditional;
 
 	/* Guard against stack overflow due to overly complex expressions */
 	check_stack_depth();
@@ -910,6 +949,19 @@ ExecInitExprRec(Expr *node, ExprState *state,
 	scratch.resvalue = resv;
 	scratch.resnull = resnull;
 
+	/*
+	 * Reuse the value of a common subexpression, if it is one, and note
+	 * whether node's children are evaluated unconditionally as well.
+	 */
+	if (state->cse_entries != NIL)
+	{
+		if (state->cse_unconditional &&
+			ExecInitCSERef(state, node, resv, resnull))
+			return;
+		state->cse_unconditional = state->cse_unconditional &&
+			cse_evaluates_args((Node *) node);
+	}
+
 	/* cases should be ordered as they are in enum NodeTag */
 	switch (nodeTag(node))
 	{
@@ -2433,6 +2485,8 @@ ExecInitExprRec(Expr *node, ExprState *state,
 				 (int) nodeTag(node));
 			break;
 	}
+
+	state->cse_unconditional = save_cse_unconditional;
 }
 
 /*
@@ -2459,6 +2513,184 @@ ExprEvalPushStep(ExprState *es, const ExprEvalStep *s)
 	memcpy(&es->steps[es->steps_len++], s, sizeof(ExprEvalStep));
 }
 
+/*
+ * Find the subexpressions that occur more than once in a projection's
+ * target list and can be evaluated just once per tuple, and remember them in
+ * state->cse_entries for ExecInitExprRec.
+ *
+ * The first occurrence of each computes the value for all of them, so it
+ * must be evaluated unconditionally, and before the others.  We therefore
+ * only look at the parts of the target list that are evaluated in order and
+ * without exception: the arguments of plain function and operator calls and
+ * of I/O coercions, but nothing under CASE, AND/OR, COALESCE and the like.
+ * Volatile and set-returning expressions, and those with subplans, are not
+ * shared.  Neither is anything if there are more than CSE_MAX_CANDIDATES
+ * candidates.
+ */
+static void
+ExecInitCSE(ExprState *state, List *targetList)
+{
+	List	   *occurrences = NIL;
+	ListCell   *lc;
+
+	foreach(lc, targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		cse_collect_occurrences((Node *) tle->expr, &occurrences);
+	}
+	if (list_length(occurrences) > CSE_MAX_CANDIDATES)
+	{
+		list_free(occurrences);
+		return;
+	}
+	state->cse_unconditional = true;
+
+	while (occurrences != NIL)
+	{
+		Node	   *first = linitial(occurrences);
+		List	   *same = list_make1(first);
+		List	   *rest = NIL;
+		ListCell   *lc2;
+
+		for_each_from(lc2, occurrences, 1)
+		{
+			Node	   *other = lfirst(lc2);
+
+			if (equal(first, other))
+				same = lappend(same, other);
+			else
+				rest = lappend(rest, other);
+		}
+		list_free(occurrences);
+		occurrences = rest;
+
+		if (list_length(same) > 1 &&
+			!contain_volatile_functions(first) &&
+			!contain_subplans(first) &&
+			!expression_returns_set(first))
+		{
+			ExprCSEEntry *entry = palloc0(sizeof(ExprCSEEntry));
+
+			entry->occurrences = same;
+			entry->readonly = (get_typlen(exprType(first)) == -1);
+			state->cse_entries = lappend(state->cse_entries, entry);
+		}
+		else
+			list_free(same);
+	}
+}
+
+/*
+ * Add the shareable nodes in the unconditionally evaluated part of node's
+ * tree to *occurrences, in evaluation order.
+ */
+static void
+cse_collect_occurrences(Node *node, List **occurrences)
+{
+	ListCell   *lc;
+
+	if (node == NULL)
+		return;
+
+	switch (nodeTag(node))
+	{
+		case T_FuncExpr:
+			*occurrences = lappend(*occurrences, node);
+			foreach(lc, ((FuncExpr *) node)->args)
+				cse_collect_occurrences(lfirst(lc), occurrences);
+			break;
+		case T_OpExpr:
+			*occurrences = lappend(*occurrences, node);
+			foreach(lc, ((OpExpr *) node)->args)
+				cse_collect_occurrences(lfirst(lc), occurrences);
+			break;
+		case T_CoerceViaIO:
+			*occurrences = lappend(*occurrences, node);
+			cse_collect_occurrences((Node *) ((CoerceViaIO *) node)->arg,
+									occurrences);
+			break;
+		case T_SubscriptingRef:
+			/* a fetch is shareable, but its parts are evaluated out of order */
+			if (((SubscriptingRef *) node)->refassgnexpr == NULL)
+				*occurrences = lappend(*occurrences, node);
+			break;
+		case T_RelabelType:
+			cse_collect_occurrences((Node *) ((RelabelType *) node)->arg,
+									occurrences);
+			break;
+		default:
+			/* anything else might not evaluate its arguments */
+			break;
+	}
+}
+
+/*
+ * Does ExecInitExprRec compile node's arguments to be evaluated in order and
+ * unconditionally?  This must agree with what cse_collect_occurrences
+ * descends into, so that ExecInitCSERef meets the occurrences in the same
+ * order; a node shared between both kinds of places in the tree is only
+ * reused where it is evaluated unconditionally.
+ */
+static bool
+cse_evaluates_args(Node *node)
+{
+	return IsA(node, FuncExpr) || IsA(node, OpExpr) ||
+		IsA(node, CoerceViaIO) || IsA(node, RelabelType);
+}
+
+/*
+ * If node is an occurrence of a common subexpression, emit steps to compute
+ * it if it is the first, and to load its value into resv/resnull, and return
+ * true.  Otherwise return false, to let the caller compile node normally.
+ */
+static bool
+ExecInitCSERef(ExprState *state, Expr *node, Datum *resv, bool *resnull)
+{
+	ListCell   *lc;
+
+	foreach(lc, state->cse_entries)
+	{
+		ExprCSEEntry *entry = (ExprCSEEntry *) lfirst(lc);
+		ExprEvalStep scratch = {0};
+
+		if (entry->compiling || !list_member_ptr(entry->occurrences, node))
+			continue;
+
+		if (!entry->computed)
+		{
+			Assert(node == linitial(entry->occurrences));
+			entry->compiling = true;
+			ExecInitExprRec(node, state, &entry->value, &entry->isnull);
+			entry->compiling = false;
+			entry->computed = true;
+		}
+
+		/*
+		 * The value might be used several times, so force it to R/O if it
+		 * could be an expanded datum.
+		 */
+		scratch.resvalue = resv;
+		scratch.resnull = resnull;
+		if (entry->readonly)
+		{
+			scratch.opcode = EEOP_MAKE_READONLY;
+			scratch.d.make_readonly.value = &entry->value;
+			scratch.d.make_readonly.isnull = &entry->isnull;
+		}
+		else
+		{
+			scratch.opcode = EEOP_CASE_TESTVAL;
+			scratch.d.casetest.value = &entry->value;
+			scratch.d.casetest.isnull = &entry->isnull;
+		}
+		ExprEvalPushStep(state, &scratch);
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * Perform setup necessary for the evaluation of a function-like expression,
  * appending argument evaluation steps to the steps list in *state, and
@@ -2508,6 +2740,10 @@ ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args, Oid funcid,
 	fmgr_info(funcid, flinfo);
 	fmgr_info_set_expr((Node *) node, flinfo);
 
+	/* Maybe look for the results in the shared result cache */
+	if (SharedResultCacheEnabled())
+		SharedResultCacheSetupCall(flinfo, funcid, inputcollid, node, args);
+
 	/* Initialize function call parameter structure too */
 	InitFunctionCallInfoData(*fcinfo, flinfo,
 							 nargs, inputcollid, NULL, NULL);
@@ -165,6 +165,12 @@ static Datum ExecJustScanVarVirt(ExprState *state, ExprContext *econtext, bool *
 static Datum ExecJustAssignInnerVarVirt(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustAssignOuterVarVirt(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustAssignScanVarVirt(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustInnerVarFunc(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustOuterVarFunc(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarFunc(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustInnerVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustOuterVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
 
 /* execution helper functions */
 static pg_attribute_always_inline void ExecAggPlainTransByVal(AggState *aggstate,
@@ -267,7 +273,60 @@ ExecReadyInterpretedExpr(ExprState *state)
 	 * the full interpreter is a measurable overhead for these, and these
 	 * patterns occur often enough to be worth optimizing.
 	 */
-	if (state->steps_len == 3)
+	if (state->steps_len == 5 &&
+		state->steps[2].opcode == EEOP_FUNCEXPR_STRICT &&
+		state->steps[3].opcode == EEOP_QUAL)
+	{
+		ExprEvalOp	step0 = state->steps[0].opcode;
+		ExprEvalOp	step1 = state->steps[1].opcode;
+
+		/* a qual consisting of a single "Var op Const" clause */
+		if (step0 == EEOP_INNER_FETCHSOME &&
+			step1 == EEOP_INNER_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustInnerVarFuncQual;
+			return;
+		}
+		else if (step0 == EEOP_OUTER_FETCHSOME &&
+				 step1 == EEOP_OUTER_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustOuterVarFuncQual;
+			return;
+		}
+		else if (step0 == EEOP_SCAN_FETCHSOME &&
+				 step1 == EEOP_SCAN_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustScanVarFuncQual;
+			return;
+		}
+	}
+	else if (state->steps_len == 4 &&
+			 state->steps[2].opcode == EEOP_FUNCEXPR_STRICT)
+	{
+		ExprEvalOp	step0 = state->steps[0].opcode;
+		ExprEvalOp	step1 = state->steps[1].opcode;
+
+		/* a strict function of one Var, such as "Var op Const" */
+		if (step0 == EEOP_INNER_FETCHSOME &&
+			step1 == EEOP_INNER_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustInnerVarFunc;
+			return;
+		}
+		else if (step0 == EEOP_OUTER_FETCHSOME &&
+				 step1 == EEOP_OUTER_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustOuterVarFunc;
+			return;
+		}
+		else if (step0 == EEOP_SCAN_FETCHSOME &&
+				 step1 == EEOP_SCAN_VAR)
+		{
+			state->evalfunc_private = (void *) ExecJustScanVarFunc;
+			return;
+		}
+	}
+	else if (state->steps_len == 3)
 	{
 		ExprEvalOp	step0 = state->steps[0].opcode;
 		ExprEvalOp	step1 = state->steps[1].opcode;
@@ -2174,6 +2233,96 @@ ExecJustConst(ExprState *state, ExprContext *econtext, bool *isnull)
 	return op->d.constval.value;
 }
 
+/*
+ * implementation of ExecJust(Inner|Outer|Scan)VarFunc[Qual]
+ *
+ * The function's other arguments, if any, are constants already stored in
+ * its fcinfo, since there are no steps to compute them.
+ */
+static pg_attribute_always_inline Datum
+ExecJustVarFuncImpl(ExprState *state, TupleTableSlot *slot, bool *isnull)
+{
+	ExprEvalStep *varop = &state->steps[1];
+	ExprEvalStep *op = &state->steps[2];
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+	NullableDatum *args = fcinfo->args;
+	int			nargs = op->d.func.nargs;
+	Datum		d;
+
+	CheckOpSlotCompatibility(&state->steps[0], slot);
+
+	/* the Var step stores into the function's argument */
+	*varop->resvalue = slot_getattr(slot, varop->d.var.attnum + 1,
+									varop->resnull);
+
+	/* strict function, so check for NULL args */
+	for (int argno = 0; argno < nargs; argno++)
+	{
+		if (args[argno].isnull)
+		{
+			*isnull = true;
+			return (Datum) 0;
+		}
+	}
+	fcinfo->isnull = false;
+	d = op->d.func.fn_addr(fcinfo);
+	*isnull = fcinfo->isnull;
+	return d;
+}
+
+/* Apply a strict function to an inner Var */
+static Datum
+ExecJustInnerVarFunc(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncImpl(state, econtext->ecxt_innertuple, isnull);
+}
+
+/* Apply a strict function to an outer Var */
+static Datum
+ExecJustOuterVarFunc(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncImpl(state, econtext->ecxt_outertuple, isnull);
+}
+
+/* Apply a strict function to a scan Var */
+static Datum
+ExecJustScanVarFunc(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncImpl(state, econtext->ecxt_scantuple, isnull);
+}
+
+/* Like ExecJustVarFuncImpl, returning the qual's result as EEOP_QUAL would */
+static pg_attribute_always_inline Datum
+ExecJustVarFuncQualImpl(ExprState *state, TupleTableSlot *slot, bool *isnull)
+{
+	bool		resnull;
+	Datum		d = ExecJustVarFuncImpl(state, slot, &resnull);
+
+	*isnull = false;
+	return BoolGetDatum(!resnull && DatumGetBool(d));
+}
+
+/* Qual of a single strict function of an inner Var */
+static Datum
+ExecJustInnerVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_innertuple, isnull);
+}
+
+/* Qual of a single strict function of an outer Var */
+static Datum
+ExecJustOuterVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_outertuple, isnull);
+}
+
+/* Qual of a single strict function of a scan Var */
+static Datum
+ExecJustScanVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_scantuple, isnull);
+}
+
 /* implementation of ExecJust(Inner|Outer|Scan)VarVirt */
 static pg_attribute_always_inline Datum
 ExecJustVarVirtImpl(ExprState *state, TupleTableSlot *slot, bool *isnull)
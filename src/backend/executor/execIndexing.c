@@ -7,7 +7,9 @@
  * ExecInsertIndexTuples() is the main entry point.  It's called after
  * inserting a tuple to the heap, and it inserts corresponding index tuples
  * into all indexes.  At the same time, it enforces any unique and
- * exclusion constraints:
+ * exclusion constraints.  (Callers that insert many heap tuples at a time,
+ * like COPY, can first pass them to ExecInsertIndexTuplesBatch(), which
+ * takes care of indexes that have no constraints to enforce.)
  *
  * Unique Indexes
  * --------------
@@ -106,6 +108,7 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
@@ -136,6 +139,8 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 									 Datum *existing_values, bool *existing_isnull,
 									 Datum *new_values);
+static bool index_insert_batchable(Relation indexRelation,
+								   IndexInfo *indexInfo);
 static bool index_unchanged_by_update(ResultRelInfo *resultRelInfo,
 									  EState *estate, IndexInfo *indexInfo,
 									  Relation indexRelation);
@@ -278,6 +283,10 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
+ *
+ *		If 'skipBatched' is true, indexes that ExecInsertIndexTuplesBatch()
+ *		handles are skipped, because the caller has already passed the
+ *		tuple to it.
  * ----------------------------------------------------------------
  */
 List *
@@ -287,7 +296,8 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool update,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool skipBatched)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -343,6 +353,10 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* Skip indexes the caller has already passed to the batch routine */
+		if (skipBatched && index_insert_batchable(indexRelation, indexInfo))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -484,6 +498,107 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesBatch
+ *
+ *		Insert index tuples for a group of heap tuples that were just
+ *		inserted together, like ExecInsertIndexTuples does for one, but
+ *		only into the indexes whose access method can take a whole batch
+ *		of tuples at once.  The caller must then call
+ *		ExecInsertIndexTuples with skipBatched = true for each tuple to
+ *		take care of the remaining indexes.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+						   TupleTableSlot **slots, int nslots,
+						   EState *estate)
+{
+	int			numIndices = resultRelInfo->ri_NumIndices;
+	RelationPtr relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	IndexInfo **indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	MemoryContext oldcontext;
+	Datum	  **values;
+	bool	  **isnull;
+	ItemPointerData *tids;
+	int			maxatts = 0;
+
+	/* Find out whether there is anything to do, and how wide the rows are */
+	for (int i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo = indexInfoArray[i];
+
+		if (indexRelation != NULL && indexInfo->ii_ReadyForInserts &&
+			index_insert_batchable(indexRelation, indexInfo))
+			maxatts = Max(maxatts, indexInfo->ii_NumIndexAttrs);
+	}
+
+	if (maxatts == 0 || nslots == 0)
+		return;
+
+	/* Work in the per-tuple context; the caller resets it */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	values = palloc(nslots * sizeof(Datum *));
+	isnull = palloc(nslots * sizeof(bool *));
+	tids = palloc(nslots * sizeof(ItemPointerData));
+	for (int j = 0; j < nslots; j++)
+	{
+		values[j] = palloc(maxatts * sizeof(Datum));
+		isnull[j] = palloc(maxatts * sizeof(bool));
+		tids[j] = slots[j]->tts_tid;
+	}
+
+	for (int i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo = indexInfoArray[i];
+		int			natts;
+
+		if (indexRelation == NULL || !indexInfo->ii_ReadyForInserts ||
+			!index_insert_batchable(indexRelation, indexInfo))
+			continue;
+
+		/* Without expressions, FormIndexDatum only fetches columns */
+		natts = indexInfo->ii_NumIndexAttrs;
+		for (int j = 0; j < nslots; j++)
+		{
+			for (int k = 0; k < natts; k++)
+			{
+				AttrNumber	keycol = indexInfo->ii_IndexAttrNumbers[k];
+
+				values[j][k] = slot_getattr(slots[j], keycol, &isnull[j][k]);
+			}
+		}
+
+		index_insert_batch(indexRelation, values, isnull, tids, nslots,
+						   heapRelation, indexInfo);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Can insertions into this index go through ExecInsertIndexTuplesBatch?
+ *
+ * That requires the access method to support batch insertion, and the index
+ * to need no uniqueness or exclusion checks, which are made one tuple at a
+ * time.  Expression and partial indexes are left to ExecInsertIndexTuples
+ * too, so that errors in evaluating their expressions are reported in the
+ * context of the tuple being processed.
+ */
+static bool
+index_insert_batchable(Relation indexRelation, IndexInfo *indexInfo)
+{
+	return indexRelation->rd_indam->aminsertbatch != NULL &&
+		!indexRelation->rd_index->indisunique &&
+		indexInfo->ii_ExclusionOps == NULL &&
+		indexInfo->ii_Expressions == NIL &&
+		indexInfo->ii_Predicate == NIL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
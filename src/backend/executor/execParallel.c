@@ -36,6 +36,7 @@
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeMemoize.h"
+#include "executor/nodeRedistribute.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
@@ -277,6 +278,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecHashJoinEstimate((HashJoinState *) planstate,
 									 e->pcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeEstimate((RedistributeState *) planstate,
+										 e->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashEstimate((HashState *) planstate, e->pcxt);
@@ -501,6 +507,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
 										  d->pcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeInitializeDSM((RedistributeState *) planstate,
+											  d->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
@@ -994,8 +1005,16 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
-		case T_HashState:
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeReInitializeDSM((RedistributeState *) planstate,
+												pcxt);
+			break;
 		case T_SortState:
+			/* even when not parallel-aware, for top-N threshold */
+			ExecSortReInitializeDSM((SortState *) planstate, pcxt);
+			break;
+		case T_HashState:
 		case T_IncrementalSortState:
 		case T_MemoizeState:
 			/* these nodes have DSM state, but no reinitialization is required */
@@ -1345,6 +1364,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecHashJoinInitializeWorker((HashJoinState *) planstate,
 											 pwcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeInitializeWorker((RedistributeState *) planstate,
+												 pwcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeWorker((HashState *) planstate, pwcxt);
@@ -140,6 +140,15 @@ struct PartitionTupleRouting
  *		the index corresponds to the PartitionDispatch for it in its
  *		partition_dispatch_info array.  -1 indicates we've not yet allocated
  *		anything in PartitionTupleRouting for the partition.
+ *
+ * last_found_offset
+ *		For list and range partitioning, the bound offset at which
+ *		get_partition_for_tuple() last found a partition, or -1.
+ *
+ * last_found_count
+ *		Number of consecutive tuples routed using last_found_offset.  Once it
+ *		reaches PARTITION_CACHED_FIND_THRESHOLD, the bound at that offset is
+ *		checked before doing a binary search.
  *-----------------------
  */
 typedef struct PartitionDispatchData
@@ -150,9 +159,19 @@ typedef struct PartitionDispatchData
 	PartitionDesc partdesc;
 	TupleTableSlot *tupslot;
 	AttrMap    *tupmap;
+	int			last_found_offset;
+	int			last_found_count;
 	int			indexes[FLEXIBLE_ARRAY_MEMBER];
 }			PartitionDispatchData;
 
+/*
+ * Number of times in a row the same partition must be found before
+ * get_partition_for_tuple() starts checking it first.  Bulk loads often send
+ * long runs of rows to the same partition, but when they don't, the extra
+ * comparison is wasted, so require some evidence first.
+ */
+#define PARTITION_CACHED_FIND_THRESHOLD	16
+
 
 static ResultRelInfo *ExecInitPartitionInfo(ModifyTableState *mtstate,
 											EState *estate, PartitionTupleRouting *proute,
@@ -1026,6 +1045,8 @@ ExecInitPartitionDispatchInfo(EState *estate,
 	pd->key = RelationGetPartitionKey(rel);
 	pd->keystate = NIL;
 	pd->partdesc = partdesc;
+	pd->last_found_offset = -1;
+	pd->last_found_count = 0;
 	if (parent_pd != NULL)
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
@@ -1238,11 +1259,15 @@ FormPartitionKeyDatum(PartitionDispatch pd,
  *
  * Return value is index of the partition (>= 0 and < partdesc->nparts) if one
  * found or -1 if none found.
+ *
+ * For list and range partitioning, if the same bound was found for the last
+ * PARTITION_CACHED_FIND_THRESHOLD tuples, check whether this tuple belongs to
+ * it too before searching all the bounds.
  */
 static int
 get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 {
-	int			bound_offset;
+	int			bound_offset = -1;
 	int			part_index = -1;
 	PartitionKey key = pd->key;
 	PartitionDesc partdesc = pd->partdesc;
@@ -1274,12 +1299,24 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 			{
 				bool		equal = false;
 
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					bound_offset = pd->last_found_offset;
+					if (partition_datum_cmp(&key->partsupfunc[0],
+											key->partcollation[0],
+											boundinfo->datums[bound_offset][0],
+											values[0]) == 0)
+						return boundinfo->indexes[bound_offset];
+				}
+
 				bound_offset = partition_list_bsearch(key->partsupfunc,
 													  key->partcollation,
 													  boundinfo,
 													  values[0], &equal);
 				if (bound_offset >= 0 && equal)
 					part_index = boundinfo->indexes[bound_offset];
+				else
+					bound_offset = -1;
 			}
 			break;
 
@@ -1302,6 +1339,29 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					}
 				}
 
+				if (!range_partkey_has_null &&
+					pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					/*
+					 * The cached bound offset is that of the partition's
+					 * lower bound, which is inclusive.
+					 */
+					bound_offset = pd->last_found_offset;
+					if (partition_rbound_datum_cmp(key->partsupfunc,
+												   key->partcollation,
+												   boundinfo->datums[bound_offset],
+												   boundinfo->kind[bound_offset],
+												   values,
+												   key->partnatts) <= 0 &&
+						partition_rbound_datum_cmp(key->partsupfunc,
+												   key->partcollation,
+												   boundinfo->datums[bound_offset + 1],
+												   boundinfo->kind[bound_offset + 1],
+												   values,
+												   key->partnatts) > 0)
+						return boundinfo->indexes[bound_offset + 1];
+				}
+
 				if (!range_partkey_has_null)
 				{
 					bound_offset = partition_range_datum_bsearch(key->partsupfunc,
@@ -1318,6 +1378,8 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					 * actually exists one.
 					 */
 					part_index = boundinfo->indexes[bound_offset + 1];
+					if (part_index < 0)
+						bound_offset = -1;
 				}
 			}
 			break;
@@ -1327,6 +1389,20 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 				 (int) key->strategy);
 	}
 
+	/* Remember where we found the partition, see above */
+	if (part_index >= 0 && bound_offset >= 0)
+	{
+		if (bound_offset == pd->last_found_offset)
+			pd->last_found_count++;
+		else
+		{
+			pd->last_found_offset = bound_offset;
+			pd->last_found_count = 1;
+		}
+	}
+	else
+		pd->last_found_count = 0;
+
 	/*
 	 * part_index < 0 means we failed to find a partition of this parent. Use
 	 * the default partition, if there is one.
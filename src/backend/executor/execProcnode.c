@@ -101,6 +101,7 @@
 #include "executor/nodeNamedtuplestorescan.h"
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
+#include "executor/nodeRedistribute.h"
 #include "executor/nodeRecursiveunion.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
@@ -118,9 +119,14 @@
 #include "executor/nodeWorktablescan.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "utils/backend_profile.h"
+
+/* GUC parameter */
+int			executor_batch_size = 0;
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
 static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
+static TupleTableSlot *ExecProcNodeProfile(PlanState *node);
 
 
 /* ------------------------------------------------------------------------
@@ -361,6 +367,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													   estate, eflags);
 			break;
 
+		case T_Redistribute:
+			result = (PlanState *) ExecInitRedistribute((Redistribute *) node,
+														estate, eflags);
+			break;
+
 		case T_Hash:
 			result = (PlanState *) ExecInitHash((Hash *) node,
 												estate, eflags);
@@ -407,8 +418,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 
 	/* Set up instrumentation for this node if requested */
 	if (estate->es_instrument)
+	{
 		result->instrument = InstrAlloc(1, estate->es_instrument,
 										result->async_capable);
+		result->instrument->sample_interval = explain_timing_sample_interval;
+	}
 
 	return result;
 }
@@ -454,8 +468,12 @@ ExecProcNodeFirst(PlanState *node)
 	 * If instrumentation is required, change the wrapper to one that just
 	 * does instrumentation.  Otherwise we can dispense with all wrappers and
 	 * have ExecProcNode() directly call the relevant function from now on.
+	 * While the backend profiler is sampling, use a wrapper that tracks the
+	 * node being executed (and instruments it too, if needed).
 	 */
-	if (node->instrument)
+	if (pgstat_profile_active)
+		node->ExecProcNode = ExecProcNodeProfile;
+	else if (node->instrument)
 		node->ExecProcNode = ExecProcNodeInstr;
 	else
 		node->ExecProcNode = node->ExecProcNodeReal;
@@ -483,6 +501,64 @@ ExecProcNodeInstr(PlanState *node)
 	return result;
 }
 
+/*
+ * ExecProcNode wrapper that tells the backend profiler which type of node is
+ * being executed.
+ */
+static TupleTableSlot *
+ExecProcNodeProfile(PlanState *node)
+{
+	TupleTableSlot *result;
+	NodeTag		save_node = pgstat_profile_node;
+
+	pgstat_profile_node = nodeTag(node->plan);
+
+	if (node->instrument)
+		result = ExecProcNodeInstr(node);
+	else
+		result = node->ExecProcNodeReal(node);
+
+	pgstat_profile_node = save_node;
+
+	return result;
+}
+
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Execute the given node to return a(nother) batch of tuples.
+ *		The node must support the batch protocol, ie have a non-NULL
+ *		ExecProcNodeBatch method; an empty batch means end of data.
+ *
+ *		Unlike ExecProcNode, this is not installed via a wrapper: the
+ *		stack depth check and instrumentation are cheap enough to do on
+ *		every call when amortized over a whole batch.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecProcNodeBatch(PlanState *node)
+{
+	TupleBatch *result;
+
+	Assert(node->ExecProcNodeBatch != NULL);
+
+	check_stack_depth();
+
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	if (node->instrument)
+		InstrStartNode(node->instrument);
+
+	result = node->ExecProcNodeBatch(node);
+
+	if (node->instrument)
+		InstrStopNode(node->instrument, (double) result->nvalid);
+
+	return result;
+}
+
 
 /* ----------------------------------------------------------------
  *		MultiExecProcNode
@@ -630,6 +706,10 @@ ExecEndNode(PlanState *node)
 			ExecEndGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RedistributeState:
+			ExecEndRedistribute((RedistributeState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecEndIndexScan((IndexScanState *) node);
 			break;
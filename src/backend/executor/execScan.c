@@ -19,6 +19,7 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/nodeSort.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
@@ -173,10 +174,11 @@ ExecScan(ScanState *node,
 	/* interrupt checks are in ExecScanFetch */
 
 	/*
-	 * If we have neither a qual to check nor a projection to do, just skip
-	 * all the overhead and return the raw scan tuple.
+	 * If we have neither a qual to check nor a projection to do, nor tuples
+	 * to discard for a Sort above, just skip all the overhead and return the
+	 * raw scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !node->ss_TopNSort)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -212,6 +214,18 @@ ExecScan(ScanState *node,
 				return slot;
 		}
 
+		/*
+		 * If a bounded Sort above us already holds enough tuples that sort
+		 * before this one, skip the tuple before spending anything more on
+		 * it.
+		 */
+		if (node->ss_TopNSort != NULL &&
+			ExecSortRejectTuple(node->ss_TopNSort, slot, node->ss_TopNAttno))
+		{
+			ResetExprContext(econtext);
+			continue;
+		}
+
 		/*
 		 * place the current tuple into the expr context
 		 */
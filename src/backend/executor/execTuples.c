@@ -63,6 +63,7 @@
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "nodes/nodeFuncs.h"
+#include "port/pg_bswap.h"
 #include "storage/bufmgr.h"
 #include "utils/builtins.h"
 #include "utils/expandeddatum.h"
@@ -72,7 +73,7 @@
 static TupleDesc ExecTypeFromTLInternal(List *targetList,
 										bool skipjunk);
 static pg_attribute_always_inline void slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
-															  int natts);
+															  const bool *skipatts, int natts);
 static inline void tts_buffer_heap_store_tuple(TupleTableSlot *slot,
 											   HeapTuple tuple,
 											   Buffer buffer,
@@ -333,7 +334,7 @@ tts_heap_getsomeattrs(TupleTableSlot *slot, int natts)
 
 	Assert(!TTS_EMPTY(slot));
 
-	slot_deform_heap_tuple(slot, hslot->tuple, &hslot->off, natts);
+	slot_deform_heap_tuple(slot, hslot->tuple, &hslot->off, NULL, natts);
 }
 
 static Datum
@@ -508,7 +509,7 @@ tts_minimal_getsomeattrs(TupleTableSlot *slot, int natts)
 
 	Assert(!TTS_EMPTY(slot));
 
-	slot_deform_heap_tuple(slot, mslot->tuple, &mslot->off, natts);
+	slot_deform_heap_tuple(slot, mslot->tuple, &mslot->off, NULL, natts);
 }
 
 static Datum
@@ -683,6 +684,7 @@ tts_buffer_heap_clear(TupleTableSlot *slot)
 	bslot->base.tuple = NULL;
 	bslot->base.off = 0;
 	bslot->buffer = InvalidBuffer;
+	bslot->skipatts = NULL;
 }
 
 static void
@@ -692,7 +694,8 @@ tts_buffer_heap_getsomeattrs(TupleTableSlot *slot, int natts)
 
 	Assert(!TTS_EMPTY(slot));
 
-	slot_deform_heap_tuple(slot, bslot->base.tuple, &bslot->base.off, natts);
+	slot_deform_heap_tuple(slot, bslot->base.tuple, &bslot->base.off,
+						   bslot->skipatts, natts);
 }
 
 static Datum
@@ -907,6 +910,44 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 	}
 }
 
+/*
+ * slot_expand_null_bitmap
+ *		Set isnull[start .. end-1] from a tuple's null bitmap.
+ *
+ * Whole bytes of the bitmap are expanded eight attributes at a time: the
+ * multiplication spreads four bits into the low bit of four bytes, so two
+ * of them give the eight bools for a bitmap byte, which are stored with one
+ * 8-byte write.  This is a good deal cheaper than testing each attribute's
+ * bit separately in the deforming loop, and needs no special instructions.
+ */
+static inline void
+slot_expand_null_bitmap(bits8 *bp, bool *isnull, int start, int end)
+{
+	int			attnum = start;
+
+	/* handle a leading partial byte, if we're not starting on a boundary */
+	for (; attnum < end && (attnum & 0x07) != 0; attnum++)
+		isnull[attnum] = att_isnull(attnum, bp);
+
+	for (; attnum + 8 <= end; attnum += 8)
+	{
+		bits8		nullbyte = ~bp[attnum >> 3];
+		uint64		isnull_8;
+
+		isnull_8 = (uint64) ((nullbyte & 0x0f) * 0x204081);
+		isnull_8 |= ((uint64) (((nullbyte >> 4) & 0x0f) * 0x204081)) << 32;
+		isnull_8 &= UINT64CONST(0x0101010101010101);
+#ifdef WORDS_BIGENDIAN
+		isnull_8 = pg_bswap64(isnull_8);
+#endif
+		memcpy(&isnull[attnum], &isnull_8, sizeof(uint64));
+	}
+
+	/* and the trailing partial byte */
+	for (; attnum < end; attnum++)
+		isnull[attnum] = att_isnull(attnum, bp);
+}
+
 /*
  * slot_deform_heap_tuple
  *		Given a TupleTableSlot, extract data from the slot's physical tuple
@@ -918,12 +959,15 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
  *		re-computing information about previously extracted attributes.
  *		slot->tts_nvalid is the number of attributes already extracted.
  *
+ *		If skipatts is not NULL, columns for which it is true are returned as
+ *		NULL; we only step over them to find the following columns.
+ *
  * This is marked as always inline, so the different offp for different types
- * of slots gets optimized away.
+ * of slots gets optimized away, as does skipatts for those that never have it.
  */
 static pg_attribute_always_inline void
 slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
-					   int natts)
+					   const bool *skipatts, int natts)
 {
 	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
 	Datum	   *values = slot->tts_values;
@@ -959,20 +1003,54 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 
 	tp = (char *) tup + tup->t_hoff;
 
+	/* Fill in all the isnull flags we're going to need up front */
+	if (hasnulls)
+		slot_expand_null_bitmap(bp, isnull, attnum, natts);
+	else if (attnum < natts)
+		memset(&isnull[attnum], false, (natts - attnum) * sizeof(bool));
+
+	/*
+	 * As long as we haven't passed a null or variable-width attribute, the
+	 * leading fixed-width attributes can be fetched straight from their
+	 * cached offsets, without maintaining the running offset.
+	 */
+	if (!slow)
+	{
+		Form_pg_attribute lastatt = NULL;
+
+		for (; attnum < natts; attnum++)
+		{
+			Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
+
+			if (isnull[attnum] || thisatt->attcacheoff < 0 ||
+				thisatt->attlen <= 0)
+				break;
+
+			if (skipatts != NULL && skipatts[attnum])
+			{
+				values[attnum] = (Datum) 0;
+				isnull[attnum] = true;
+			}
+			else
+				values[attnum] = fetchatt(thisatt, tp + thisatt->attcacheoff);
+			lastatt = thisatt;
+		}
+
+		if (lastatt != NULL)
+			off = lastatt->attcacheoff + lastatt->attlen;
+	}
+
 	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
 
-		if (hasnulls && att_isnull(attnum, bp))
+		if (isnull[attnum])
 		{
 			values[attnum] = (Datum) 0;
-			isnull[attnum] = true;
 			slow = true;		/* can't use attcacheoff anymore */
 			continue;
 		}
 
-		isnull[attnum] = false;
-
 		if (!slow && thisatt->attcacheoff >= 0)
 			off = thisatt->attcacheoff;
 		else if (thisatt->attlen == -1)
@@ -1002,7 +1080,13 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 				thisatt->attcacheoff = off;
 		}
 
-		values[attnum] = fetchatt(thisatt, tp + off);
+		if (skipatts != NULL && skipatts[attnum])
+		{
+			values[attnum] = (Datum) 0;
+			isnull[attnum] = true;
+		}
+		else
+			values[attnum] = fetchatt(thisatt, tp + off);
 
 		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
 
@@ -16,12 +16,17 @@
 #include <unistd.h>
 
 #include "executor/instrument.h"
+#include "utils/wait_event.h"
 
 BufferUsage pgBufferUsage;
 static BufferUsage save_pgBufferUsage;
 WalUsage	pgWalUsage;
 static WalUsage save_pgWalUsage;
 
+/* GUC parameter */
+int			explain_timing_sample_interval = 1;
+
+static double InstrCycleTime(Instrumentation *instr);
 static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void WalUsageAdd(WalUsage *dst, WalUsage *add);
 
@@ -34,10 +39,12 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 
 	/* initialize all fields to zeroes, then modify as needed */
 	instr = palloc0(n * sizeof(Instrumentation));
-	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL))
+	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER |
+							  INSTRUMENT_WAL | INSTRUMENT_WAITS))
 	{
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
+		bool		need_waits = (instrument_options & INSTRUMENT_WAITS) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 		int			i;
 
@@ -45,6 +52,7 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 		{
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
+			instr[i].need_waits = need_waits;
 			instr[i].need_timer = need_timer;
 			instr[i].async_mode = async_mode;
 		}
@@ -60,16 +68,30 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	memset(instr, 0, sizeof(Instrumentation));
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
+	instr->need_waits = (instrument_options & INSTRUMENT_WAITS) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 }
 
-/* Entry to a plan node */
+/*
+ * Entry to a plan node
+ *
+ * Timing uses the cheap tick clock (see instr_time.h).  If sample_interval
+ * is set, only every Nth iteration is timed, and InstrCycleTime() scales the
+ * result up to all iterations.  The first iteration is always timed.
+ */
 void
 InstrStartNode(Instrumentation *instr)
 {
-	if (instr->need_timer &&
-		!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
-		elog(ERROR, "InstrStartNode called twice in a row");
+	if (instr->need_timer)
+	{
+		if (instr->starttime != 0)
+			elog(ERROR, "InstrStartNode called twice in a row");
+
+		if (instr->sample_interval <= 1 ||
+			instr->niterations % instr->sample_interval == 0)
+			instr->starttime = pg_get_ticks();
+		instr->niterations++;
+	}
 
 	/* save buffer usage totals at node entry, if needed */
 	if (instr->need_bufusage)
@@ -77,6 +99,10 @@ InstrStartNode(Instrumentation *instr)
 
 	if (instr->need_walusage)
 		instr->walusage_start = pgWalUsage;
+
+	/* pgStatWaitTicks only advances while track_wait_timing is on */
+	if (instr->need_waits)
+		instr->wait_ticks_start = pgStatWaitTicks;
 }
 
 /* Exit from a plan node */
@@ -84,7 +110,6 @@ void
 InstrStopNode(Instrumentation *instr, double nTuples)
 {
 	double		save_tuplecount = instr->tuplecount;
-	instr_time	endtime;
 
 	/* count the returned tuples */
 	instr->tuplecount += nTuples;
@@ -92,13 +117,14 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	/* let's update the time only if the timer was requested */
 	if (instr->need_timer)
 	{
-		if (INSTR_TIME_IS_ZERO(instr->starttime))
+		if (instr->starttime != 0)
+		{
+			instr->counter += pg_get_ticks() - instr->starttime;
+			instr->ntimed++;
+			instr->starttime = 0;
+		}
+		else if (instr->sample_interval <= 1)
 			elog(ERROR, "InstrStopNode called without start");
-
-		INSTR_TIME_SET_CURRENT(endtime);
-		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
-
-		INSTR_TIME_SET_ZERO(instr->starttime);
 	}
 
 	/* Add delta of buffer usage since entry to node's totals */
@@ -110,11 +136,14 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		WalUsageAccumDiff(&instr->walusage,
 						  &pgWalUsage, &instr->walusage_start);
 
+	if (instr->need_waits)
+		instr->wait_ticks += pgStatWaitTicks - instr->wait_ticks_start;
+
 	/* Is this the first tuple of this cycle? */
 	if (!instr->running)
 	{
 		instr->running = true;
-		instr->firsttuple = INSTR_TIME_GET_DOUBLE(instr->counter);
+		instr->firsttuple = InstrCycleTime(instr);
 	}
 	else
 	{
@@ -123,10 +152,27 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		 * this might be the first tuple
 		 */
 		if (instr->async_mode && save_tuplecount < 1.0)
-			instr->firsttuple = INSTR_TIME_GET_DOUBLE(instr->counter);
+			instr->firsttuple = InstrCycleTime(instr);
 	}
 }
 
+/*
+ * Time spent in the node so far this cycle, in seconds, extrapolated from
+ * the timed iterations if timing is sampled
+ */
+static double
+InstrCycleTime(Instrumentation *instr)
+{
+	double		seconds;
+
+	seconds = (double) instr->counter / (double) pg_get_ticks_per_sec();
+
+	if (instr->ntimed > 0 && instr->ntimed < instr->niterations)
+		seconds *= (double) instr->niterations / (double) instr->ntimed;
+
+	return seconds;
+}
+
 /* Update tuple count */
 void
 InstrUpdateTupleCount(Instrumentation *instr, double nTuples)
@@ -145,11 +191,11 @@ InstrEndLoop(Instrumentation *instr)
 	if (!instr->running)
 		return;
 
-	if (!INSTR_TIME_IS_ZERO(instr->starttime))
+	if (instr->starttime != 0)
 		elog(ERROR, "InstrEndLoop called on running node");
 
 	/* Accumulate per-cycle statistics into totals */
-	totaltime = INSTR_TIME_GET_DOUBLE(instr->counter);
+	totaltime = InstrCycleTime(instr);
 
 	instr->startup += instr->firsttuple;
 	instr->total += totaltime;
@@ -158,8 +204,10 @@ InstrEndLoop(Instrumentation *instr)
 
 	/* Reset for next cycle (if any) */
 	instr->running = false;
-	INSTR_TIME_SET_ZERO(instr->starttime);
-	INSTR_TIME_SET_ZERO(instr->counter);
+	instr->starttime = 0;
+	instr->counter = 0;
+	instr->niterations = 0;
+	instr->ntimed = 0;
 	instr->firsttuple = 0;
 	instr->tuplecount = 0;
 }
@@ -176,7 +224,9 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	else if (dst->running && add->running && dst->firsttuple > add->firsttuple)
 		dst->firsttuple = add->firsttuple;
 
-	INSTR_TIME_ADD(dst->counter, add->counter);
+	dst->counter += add->counter;
+	dst->niterations += add->niterations;
+	dst->ntimed += add->ntimed;
 
 	dst->tuplecount += add->tuplecount;
 	dst->startup += add->startup;
@@ -193,6 +243,9 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 
 	if (dst->need_walusage)
 		WalUsageAdd(&dst->walusage, &add->walusage);
+
+	if (dst->need_waits)
+		dst->wait_ticks += add->wait_ticks;
 }
 
 /* note current values during parallel executor startup */
@@ -542,6 +542,9 @@ initialize_phase(AggState *aggstate, int newphase)
  * populated by the previous phase.  Copy it to the sorter for the next phase
  * if any.
  *
+ * If the outer plan supports the batch protocol, we fetch a batch of tuples
+ * at a time from it and hand them out one by one.
+ *
  * Callers cannot rely on memory for tuple in returned slot remaining valid
  * past any subsequently fetched tuple.
  */
@@ -559,6 +562,22 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->use_input_batch)
+	{
+		TupleBatch *batch = aggstate->input_batch;
+
+		if (batch == NULL || aggstate->input_batch_next >= batch->nvalid)
+		{
+			batch = ExecProcNodeBatch(outerPlanState(aggstate));
+			aggstate->input_batch = batch;
+			aggstate->input_batch_next = 0;
+		}
+
+		if (aggstate->input_batch_next < batch->nvalid)
+			slot = batch->slots[aggstate->input_batch_next++];
+		else
+			slot = NULL;
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1845,13 +1864,23 @@ hash_agg_check_limits(AggState *aggstate)
 
 	/*
 	 * Don't spill unless there's at least one group in the hash table so we
-	 * can be sure to make progress even in edge cases.
+	 * can be sure to make progress even in edge cases.  If the backend as a
+	 * whole is over backend_memory_limit, spill once we're using a quarter
+	 * of our own allowance.
 	 */
 	if (aggstate->hash_ngroups_current > 0 &&
 		(meta_mem + hashkey_mem > aggstate->hash_mem_limit ||
-		 ngroups > aggstate->hash_ngroups_limit))
+		 ngroups > aggstate->hash_ngroups_limit ||
+		 (meta_mem + hashkey_mem > aggstate->hash_mem_limit / 4 &&
+		  BackendMemoryLimitExceeded())))
 	{
-		hash_agg_enter_spill_mode(aggstate);
+		if (aggstate->hash_early_emit)
+		{
+			aggstate->hash_emit_pending = true;
+			aggstate->hash_ever_emitted = true;
+		}
+		else
+			hash_agg_enter_spill_mode(aggstate);
 	}
 }
 
@@ -2548,6 +2577,10 @@ agg_fill_hash_table(AggState *aggstate)
 		 * hash lookups do this too
 		 */
 		ResetExprContext(aggstate->tmpcontext);
+
+		/* Out of memory, and allowed to emit what we have so far? */
+		if (aggstate->hash_emit_pending)
+			break;
 	}
 
 	/* finalize spills, if any */
@@ -2733,7 +2766,21 @@ agg_retrieve_hash_table(AggState *aggstate)
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
-			if (!agg_refill_hash_table(aggstate))
+			if (aggstate->hash_emit_pending)
+			{
+				/*
+				 * The hash table was emitted early to stay within hash_mem.
+				 * Empty it and continue reading the input.
+				 */
+				aggstate->hash_emit_pending = false;
+				ReScanExprContext(aggstate->hashcontext);
+				for (int setno = 0; setno < aggstate->num_hashes; setno++)
+					ResetTupleHashTable(aggstate->perhash[setno].hashtable);
+				aggstate->hash_ngroups_current = 0;
+
+				agg_fill_hash_table(aggstate);
+			}
+			else if (!agg_refill_hash_table(aggstate))
 			{
 				aggstate->agg_done = true;
 				break;
@@ -3293,6 +3340,13 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * If the outer plan can return its tuples in batches, prefer that; see
+	 * fetch_input_tuple.
+	 */
+	aggstate->use_input_batch =
+		(outerPlanState(aggstate)->ExecProcNodeBatch != NULL);
+
 	/*
 	 * initialize source tuple type.
 	 */
@@ -3602,6 +3656,20 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 							&aggstate->hash_planned_partitions);
 		find_hash_columns(aggstate);
 
+		/*
+		 * The output of partial aggregation goes to a Finalize Agg that
+		 * combines the partial states of each group anyway, so there's no
+		 * need for it to produce each group only once.  Rather than spilling
+		 * when the hash table is full, emit its contents and start over with
+		 * an empty table.  If the input has poor locality this degenerates
+		 * into streaming roughly one partial state per input tuple, at the
+		 * cost of hashing but without any disk I/O.
+		 */
+		aggstate->hash_early_emit = (node->aggstrategy == AGG_HASHED &&
+									 DO_AGGSPLIT_SKIPFINAL(node->aggsplit));
+		aggstate->hash_emit_pending = false;
+		aggstate->hash_ever_emitted = false;
+
 		/* Skip massive memory allocation if we are just doing EXPLAIN */
 		if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
 			build_hash_tables(aggstate);
@@ -4356,6 +4424,10 @@ ExecReScanAgg(AggState *node)
 
 	node->agg_done = false;
 
+	/* Forget any partially consumed batch of outer tuples */
+	node->input_batch = NULL;
+	node->input_batch_next = 0;
+
 	if (node->aggstrategy == AGG_HASHED)
 	{
 		/*
@@ -4368,13 +4440,14 @@ ExecReScanAgg(AggState *node)
 			return;
 
 		/*
-		 * If we do have the hash table, and it never spilled, and the subplan
-		 * does not have any parameter changes, and none of our own parameter
-		 * changes affect input expressions of the aggregated functions, then
-		 * we can just rescan the existing hash table; no need to build it
-		 * again.
+		 * If we do have the hash table, and it never spilled or was emitted
+		 * early, and the subplan does not have any parameter changes, and
+		 * none of our own parameter changes affect input expressions of the
+		 * aggregated functions, then we can just rescan the existing hash
+		 * table; no need to build it again.
 		 */
 		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+			!node->hash_ever_emitted &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4435,6 +4508,8 @@ ExecReScanAgg(AggState *node)
 
 		node->hash_ever_spilled = false;
 		node->hash_spill_mode = false;
+		node->hash_emit_pending = false;
+		node->hash_ever_emitted = false;
 		node->hash_ngroups_current = 0;
 
 		ReScanExprContext(node->hashcontext);
@@ -262,6 +262,7 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 			areq->requestee = appendplanstates[i];
 			areq->request_index = i;
 			areq->callback_pending = false;
+			areq->wait_latch = false;
 			areq->request_complete = false;
 			areq->result = NULL;
 
@@ -463,6 +464,7 @@ ExecReScanAppend(AppendState *node)
 			AsyncRequest *areq = node->as_asyncrequests[i];
 
 			areq->callback_pending = false;
+			areq->wait_latch = false;
 			areq->request_complete = false;
 			areq->result = NULL;
 		}
@@ -1014,7 +1016,8 @@ ExecAppendAsyncRequest(AppendState *node, TupleTableSlot **result)
 /* ----------------------------------------------------------------
  *		ExecAppendAsyncEventWait
  *
- *		Wait or poll for file descriptor events and fire callbacks.
+ *		Wait or poll for file descriptor or latch events and fire
+ *		callbacks.
  * ----------------------------------------------------------------
  */
 static void
@@ -1024,6 +1027,8 @@ ExecAppendAsyncEventWait(AppendState *node)
 	long		timeout = node->as_syncdone ? -1 : 0;
 	WaitEvent	occurred_event[EVENT_BUFFER_SIZE];
 	int			noccurred;
+	int			nlatchwaits = 0;
+	bool		latch_set = false;
 	int			i;
 
 	/* We should never be called when there are no valid async subplans. */
@@ -1040,20 +1045,35 @@ ExecAppendAsyncEventWait(AppendState *node)
 		AsyncRequest *areq = node->as_asyncrequests[i];
 
 		if (areq->callback_pending)
+		{
+			areq->wait_latch = false;
 			ExecAsyncConfigureWait(areq);
+			if (areq->wait_latch)
+				nlatchwaits++;
+		}
 	}
 
 	/*
 	 * No need for further processing if there are no configured events other
 	 * than the postmaster death event.
 	 */
-	if (GetNumRegisteredWaitEvents(node->as_eventset) == 1)
+	if (GetNumRegisteredWaitEvents(node->as_eventset) == 1 && nlatchwaits == 0)
 	{
 		FreeWaitEventSet(node->as_eventset);
 		node->as_eventset = NULL;
 		return;
 	}
 
+	/*
+	 * Add our latch if any subplan waits for it.  This is done after the
+	 * ExecAsyncConfigureWait calls, as callbacks may look at the number of
+	 * events registered so far.  A subplan waiting for the latch doesn't add
+	 * an event of its own, so the set is large enough.
+	 */
+	if (nlatchwaits > 0)
+		AddWaitEventToSet(node->as_eventset, WL_LATCH_SET, PGINVALID_SOCKET,
+						  MyLatch, NULL);
+
 	/* We wait on at most EVENT_BUFFER_SIZE events. */
 	if (nevents > EVENT_BUFFER_SIZE)
 		nevents = EVENT_BUFFER_SIZE;
@@ -1095,6 +1115,33 @@ ExecAppendAsyncEventWait(AppendState *node)
 				ExecAsyncNotify(areq);
 			}
 		}
+
+		if ((w->events & WL_LATCH_SET) != 0)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+			latch_set = true;
+		}
+	}
+
+	/*
+	 * The latch doesn't tell us who set it, so give every subplan waiting for
+	 * it a chance to make progress.
+	 */
+	if (latch_set)
+	{
+		i = -1;
+		while ((i = bms_next_member(node->as_asyncplans, i)) >= 0)
+		{
+			AsyncRequest *areq = node->as_asyncrequests[i];
+
+			if (areq->callback_pending && areq->wait_latch)
+			{
+				areq->callback_pending = false;
+				areq->wait_latch = false;
+				ExecAsyncNotify(areq);
+			}
+		}
 	}
 }
 
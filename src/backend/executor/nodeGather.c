@@ -32,6 +32,7 @@
 
 #include "access/relscan.h"
 #include "access/xact.h"
+#include "executor/execAsync.h"
 #include "executor/execdebug.h"
 #include "executor/execParallel.h"
 #include "executor/nodeGather.h"
@@ -45,8 +46,11 @@
 
 
 static TupleTableSlot *ExecGather(PlanState *pstate);
-static TupleTableSlot *gather_getnext(GatherState *gatherstate);
-static MinimalTuple gather_readnext(GatherState *gatherstate);
+static void gather_start(GatherState *node);
+static TupleTableSlot *gather_fetch(GatherState *node, bool nowait);
+static void gather_async_fetch(AsyncRequest *areq);
+static TupleTableSlot *gather_getnext(GatherState *gatherstate, bool nowait);
+static MinimalTuple gather_readnext(GatherState *gatherstate, bool nowait);
 static void ExecShutdownGatherWorkers(GatherState *node);
 
 
@@ -77,6 +81,13 @@ ExecInitGather(Gather *node, EState *estate, int eflags)
 		!node->single_copy && parallel_leader_participation;
 	gatherstate->tuples_needed = -1;
 
+	/*
+	 * Determine whether to consume the workers' output asynchronously; this
+	 * has to be kept in sync with the code in ExecInitAppend().
+	 */
+	gatherstate->ps.async_capable = (((Plan *) node)->async_capable &&
+									 estate->es_epq_active == NULL);
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -142,8 +153,6 @@ static TupleTableSlot *
 ExecGather(PlanState *pstate)
 {
 	GatherState *node = castNode(GatherState, pstate);
-	TupleTableSlot *slot;
-	ExprContext *econtext;
 
 	CHECK_FOR_INTERRUPTS();
 
@@ -154,65 +163,87 @@ ExecGather(PlanState *pstate)
 	 * only if it is really needed.
 	 */
 	if (!node->initialized)
+		gather_start(node);
+
+	return gather_fetch(node, false);
+}
+
+/*
+ * Set up the parallel context and launch the workers.
+ */
+static void
+gather_start(GatherState *node)
+{
+	EState	   *estate = node->ps.state;
+	Gather	   *gather = (Gather *) node->ps.plan;
+
+	/*
+	 * Sometimes we might have to run without parallelism; but if parallel
+	 * mode is active then we can try to fire up some workers.
+	 */
+	if (gather->num_workers > 0 && estate->es_use_parallel_mode)
 	{
-		EState	   *estate = node->ps.state;
-		Gather	   *gather = (Gather *) node->ps.plan;
+		ParallelContext *pcxt;
+
+		/* Initialize, or re-initialize, shared state needed by workers. */
+		if (!node->pei)
+			node->pei = ExecInitParallelPlan(node->ps.lefttree,
+											 estate,
+											 gather->initParam,
+											 gather->num_workers,
+											 node->tuples_needed);
+		else
+			ExecParallelReinitialize(node->ps.lefttree,
+									 node->pei,
+									 gather->initParam);
 
 		/*
-		 * Sometimes we might have to run without parallelism; but if parallel
-		 * mode is active then we can try to fire up some workers.
+		 * Register backend workers. We might not get as many as we
+		 * requested, or indeed any at all.
 		 */
-		if (gather->num_workers > 0 && estate->es_use_parallel_mode)
-		{
-			ParallelContext *pcxt;
-
-			/* Initialize, or re-initialize, shared state needed by workers. */
-			if (!node->pei)
-				node->pei = ExecInitParallelPlan(node->ps.lefttree,
-												 estate,
-												 gather->initParam,
-												 gather->num_workers,
-												 node->tuples_needed);
-			else
-				ExecParallelReinitialize(node->ps.lefttree,
-										 node->pei,
-										 gather->initParam);
-
-			/*
-			 * Register backend workers. We might not get as many as we
-			 * requested, or indeed any at all.
-			 */
-			pcxt = node->pei->pcxt;
-			LaunchParallelWorkers(pcxt);
-			/* We save # workers launched for the benefit of EXPLAIN */
-			node->nworkers_launched = pcxt->nworkers_launched;
+		pcxt = node->pei->pcxt;
+		LaunchParallelWorkers(pcxt);
+		/* We save # workers launched for the benefit of EXPLAIN */
+		node->nworkers_launched = pcxt->nworkers_launched;
 
-			/* Set up tuple queue readers to read the results. */
-			if (pcxt->nworkers_launched > 0)
-			{
-				ExecParallelCreateReaders(node->pei);
-				/* Make a working array showing the active readers */
-				node->nreaders = pcxt->nworkers_launched;
-				node->reader = (TupleQueueReader **)
-					palloc(node->nreaders * sizeof(TupleQueueReader *));
-				memcpy(node->reader, node->pei->reader,
-					   node->nreaders * sizeof(TupleQueueReader *));
-			}
-			else
-			{
-				/* No workers?	Then never mind. */
-				node->nreaders = 0;
-				node->reader = NULL;
-			}
-			node->nextreader = 0;
+		/* Set up tuple queue readers to read the results. */
+		if (pcxt->nworkers_launched > 0)
+		{
+			ExecParallelCreateReaders(node->pei);
+			/* Make a working array showing the active readers */
+			node->nreaders = pcxt->nworkers_launched;
+			node->reader = (TupleQueueReader **)
+				palloc(node->nreaders * sizeof(TupleQueueReader *));
+			memcpy(node->reader, node->pei->reader,
+				   node->nreaders * sizeof(TupleQueueReader *));
 		}
-
-		/* Run plan locally if no workers or enabled and not single-copy. */
-		node->need_to_scan_locally = (node->nreaders == 0)
-			|| (!gather->single_copy && parallel_leader_participation);
-		node->initialized = true;
+		else
+		{
+			/* No workers?	Then never mind. */
+			node->nreaders = 0;
+			node->reader = NULL;
+		}
+		node->nextreader = 0;
 	}
 
+	/* Run plan locally if no workers or enabled and not single-copy. */
+	node->need_to_scan_locally = (node->nreaders == 0)
+		|| (!gather->single_copy && parallel_leader_participation);
+	node->initialized = true;
+}
+
+/*
+ * Return the next tuple, projected if need be, or NULL if there are no more.
+ *
+ * If nowait is true, we also return NULL if that would require waiting for a
+ * worker; the caller can tell by nreaders still being nonzero.
+ */
+static TupleTableSlot *
+gather_fetch(GatherState *node, bool nowait)
+{
+	TupleTableSlot *slot;
+	ExprContext *econtext;
+
 	/*
 	 * Reset per-tuple memory context to free any expression evaluation
 	 * storage allocated in the previous tuple cycle.
@@ -224,7 +255,7 @@ ExecGather(PlanState *pstate)
 	 * Get next tuple, either from one of our workers, or by running the plan
 	 * ourselves.
 	 */
-	slot = gather_getnext(node);
+	slot = gather_getnext(node, nowait);
 	if (TupIsNull(slot))
 		return NULL;
 
@@ -239,6 +270,60 @@ ExecGather(PlanState *pstate)
 	return ExecProject(node->ps.ps_ProjInfo);
 }
 
+/* ----------------------------------------------------------------
+ *		Asynchronous execution support
+ *
+ *		A Gather below an async-aware Append launches its workers on the
+ *		first request, and thereafter returns whatever tuples they have
+ *		queued without waiting, so that the leader is free to run other
+ *		subplans meanwhile.  Workers set our latch when they write to their
+ *		tuple queues, which is what we wait for.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAsyncGatherRequest(AsyncRequest *areq)
+{
+	GatherState *node = castNode(GatherState, areq->requestee);
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (!node->initialized)
+		gather_start(node);
+
+	gather_async_fetch(areq);
+}
+
+void
+ExecAsyncGatherConfigureWait(AsyncRequest *areq)
+{
+	Assert(areq->callback_pending);
+	areq->wait_latch = true;
+}
+
+void
+ExecAsyncGatherNotify(AsyncRequest *areq)
+{
+	gather_async_fetch(areq);
+}
+
+/*
+ * Complete the request with the next tuple or end of data, or else mark it
+ * pending until a worker sends us more.
+ */
+static void
+gather_async_fetch(AsyncRequest *areq)
+{
+	GatherState *node = castNode(GatherState, areq->requestee);
+	TupleTableSlot *slot;
+
+	slot = gather_fetch(node, true);
+
+	if (slot == NULL && node->nreaders > 0)
+		ExecAsyncRequestPending(areq);
+	else
+		ExecAsyncRequestDone(areq, slot);
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndGather
  *
@@ -259,9 +344,11 @@ ExecEndGather(GatherState *node)
  * Read the next tuple.  We might fetch a tuple from one of the tuple queues
  * using gather_readnext, or if no tuple queue contains a tuple and the
  * single_copy flag is not set, we might generate one locally instead.
+ *
+ * If nowait is true and we'd have to wait for a worker, return NULL.
  */
 static TupleTableSlot *
-gather_getnext(GatherState *gatherstate)
+gather_getnext(GatherState *gatherstate, bool nowait)
 {
 	PlanState  *outerPlan = outerPlanState(gatherstate);
 	TupleTableSlot *outerTupleSlot;
@@ -274,7 +361,7 @@ gather_getnext(GatherState *gatherstate)
 
 		if (gatherstate->nreaders > 0)
 		{
-			tup = gather_readnext(gatherstate);
+			tup = gather_readnext(gatherstate, nowait);
 
 			if (HeapTupleIsValid(tup))
 			{
@@ -283,6 +370,10 @@ gather_getnext(GatherState *gatherstate)
 									  false);	/* don't pfree tuple  */
 				return fslot;
 			}
+
+			if (nowait && gatherstate->nreaders > 0 &&
+				!gatherstate->need_to_scan_locally)
+				return NULL;
 		}
 
 		if (gatherstate->need_to_scan_locally)
@@ -307,9 +398,11 @@ gather_getnext(GatherState *gatherstate)
 
 /*
  * Attempt to read a tuple from one of our parallel workers.
+ *
+ * If nowait is true, return NULL rather than wait for one to arrive.
  */
 static MinimalTuple
-gather_readnext(GatherState *gatherstate)
+gather_readnext(GatherState *gatherstate, bool nowait)
 {
 	int			nvisited = 0;
 
@@ -379,7 +472,7 @@ gather_readnext(GatherState *gatherstate)
 			 * If (still) running plan locally, return NULL so caller can
 			 * generate another tuple from the local copy of the plan.
 			 */
-			if (gatherstate->need_to_scan_locally)
+			if (gatherstate->need_to_scan_locally || nowait)
 				return NULL;
 
 			/* Nothing to do except wait for developments. */
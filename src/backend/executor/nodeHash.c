@@ -38,12 +38,33 @@
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/datum.h"
 #include "utils/dynahash.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sortsupport.h"
 #include "utils/syscache.h"
 
+/*
+ * Run-time filter state: the range of one inner join key, which is published
+ * through a pair of PARAM_EXEC Params once the inner relation has been read.
+ * See add_hash_runtime_filters() in createplan.c.
+ */
+typedef struct HashRuntimeFilter
+{
+	ExprState  *keyexpr;		/* inner join key */
+	SortSupportData ssup;		/* how to order its values */
+	int16		typlen;			/* type information for copying values */
+	bool		typbyval;
+	int			minparam;		/* PARAM_EXEC id to set to smallest value */
+	int			maxparam;		/* PARAM_EXEC id to set to largest value */
+	bool		found;			/* seen any non-null value yet? */
+	Datum		min;			/* smallest value so far, in hashCxt */
+	Datum		max;			/* largest value so far, in hashCxt */
+} HashRuntimeFilter;
+
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
@@ -61,6 +82,10 @@ static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												size_t size,
 												dsa_pointer *shared);
 static void MultiExecPrivateHash(HashState *node);
+static void ExecHashInitRuntimeFilters(HashState *hashstate, Hash *node);
+static void ExecHashUpdateRuntimeFilters(HashState *node,
+										 ExprContext *econtext);
+static void ExecHashPublishRuntimeFilters(HashState *node);
 static void MultiExecParallelHash(HashState *node);
 static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable table,
 													   int bucketno);
@@ -81,6 +106,23 @@ static bool ExecParallelHashTuplePrealloc(HashJoinTable hashtable,
 static void ExecParallelHashMergeCounters(HashJoinTable hashtable);
 static void ExecParallelHashCloseBatchAccessors(HashJoinTable hashtable);
 
+/* GUC parameter */
+bool		enable_hashjoin_bloom_filter = true;
+
+/*
+ * A Bloom filter costs at least 1MB (the minimum bloom_create() allocates)
+ * plus two bytes per element, so don't bother unless the inner relation is
+ * expected to have at least this many rows.
+ */
+#define HJ_BLOOM_MIN_ROWS		(512 * 1024)
+
+/*
+ * After this many probes, drop the Bloom filter if it has rejected less than
+ * 1/HJ_BLOOM_MIN_REJECT_RATIO of them; it's not paying for itself.
+ */
+#define HJ_BLOOM_TRIAL_PROBES	4096
+#define HJ_BLOOM_MIN_REJECT_RATIO 16
+
 
 /* ----------------------------------------------------------------
  *		ExecHash
@@ -157,6 +199,10 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/* Forget the ranges seen by any previous build */
+	for (int i = 0; i < node->nfilters; i++)
+		node->filters[i].found = false;
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -174,6 +220,9 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (node->nfilters > 0)
+				ExecHashUpdateRuntimeFilters(node, econtext);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -188,9 +237,17 @@ MultiExecPrivateHash(HashState *node)
 				ExecHashTableInsert(hashtable, slot, hashvalue);
 			}
 			hashtable->totalTuples += 1;
+
+			if (hashtable->bloomFilter != NULL)
+				bloom_add_element(hashtable->bloomFilter,
+								  (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
 		}
 	}
 
+	if (node->nfilters > 0)
+		ExecHashPublishRuntimeFilters(node);
+
 	/* resize the hash table if needed (NTUP_PER_BUCKET exceeded) */
 	if (hashtable->nbuckets != hashtable->nbuckets_optimal)
 		ExecHashIncreaseNumBuckets(hashtable);
@@ -394,9 +451,135 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->hashkeys =
 		ExecInitExprList(node->hashkeys, (PlanState *) hashstate);
 
+	if (node->filterKeys != NIL)
+		ExecHashInitRuntimeFilters(hashstate, node);
+
 	return hashstate;
 }
 
+/*
+ * ExecHashInitRuntimeFilters
+ *
+ *		Set up the run-time filters requested by the planner.
+ */
+static void
+ExecHashInitRuntimeFilters(HashState *hashstate, Hash *node)
+{
+	int			nfilters = list_length(node->filterKeys);
+
+	/* The planner doesn't ask for these with a shared hash table */
+	Assert(!node->plan.parallel_aware);
+
+	hashstate->filters = (HashRuntimeFilter *)
+		palloc0(nfilters * sizeof(HashRuntimeFilter));
+	hashstate->nfilters = nfilters;
+
+	for (int i = 0; i < nfilters; i++)
+	{
+		HashRuntimeFilter *filter = &hashstate->filters[i];
+		int			keyno = list_nth_int(node->filterKeys, i);
+		Expr	   *keyexpr = (Expr *) list_nth(node->hashkeys, keyno);
+
+		filter->keyexpr = (ExprState *) list_nth(hashstate->hashkeys, keyno);
+		get_typlenbyval(exprType((Node *) keyexpr),
+						&filter->typlen, &filter->typbyval);
+
+		filter->ssup.ssup_cxt = CurrentMemoryContext;
+		filter->ssup.ssup_collation = list_nth_oid(node->filterCollations, i);
+		filter->ssup.ssup_nulls_first = false;
+		PrepareSortSupportFromOrderingOp(list_nth_oid(node->filterSortOps, i),
+										 &filter->ssup);
+
+		filter->minparam = list_nth_int(node->filterMinParams, i);
+		filter->maxparam = list_nth_int(node->filterMaxParams, i);
+		hashstate->filterParams = bms_add_member(hashstate->filterParams,
+												 filter->minparam);
+		hashstate->filterParams = bms_add_member(hashstate->filterParams,
+												 filter->maxparam);
+	}
+}
+
+/*
+ * ExecHashUpdateRuntimeFilters
+ *
+ *		Widen the filters' ranges to cover the inner tuple in econtext.
+ */
+static void
+ExecHashUpdateRuntimeFilters(HashState *node, ExprContext *econtext)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(node->hashtable->hashCxt);
+
+	for (int i = 0; i < node->nfilters; i++)
+	{
+		HashRuntimeFilter *filter = &node->filters[i];
+		Datum		value;
+		bool		isnull;
+
+		value = ExecEvalExprSwitchContext(filter->keyexpr, econtext, &isnull);
+
+		/* the join operators are strict, so NULLs never find a match */
+		if (isnull)
+			continue;
+
+		if (!filter->found)
+		{
+			filter->min = datumCopy(value, filter->typbyval, filter->typlen);
+			filter->max = datumCopy(value, filter->typbyval, filter->typlen);
+			filter->found = true;
+		}
+		else if (ApplySortComparator(value, false,
+									 filter->min, false,
+									 &filter->ssup) < 0)
+		{
+			if (!filter->typbyval)
+				pfree(DatumGetPointer(filter->min));
+			filter->min = datumCopy(value, filter->typbyval, filter->typlen);
+		}
+		else if (ApplySortComparator(value, false,
+									 filter->max, false,
+									 &filter->ssup) > 0)
+		{
+			if (!filter->typbyval)
+				pfree(DatumGetPointer(filter->max));
+			filter->max = datumCopy(value, filter->typbyval, filter->typlen);
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * ExecHashPublishRuntimeFilters
+ *
+ *		Store the filters' ranges in their Params.  If the inner relation had
+ *		no non-null keys after all, the Params are set to NULL, which makes
+ *		the outer side's pruning eliminate everything.
+ *
+ * By-reference values live in the hash table's memory context, which is
+ * fine since the parent HashJoin destroys the hash table only to rebuild it.
+ */
+static void
+ExecHashPublishRuntimeFilters(HashState *node)
+{
+	ParamExecData *params = node->ps.ps_ExprContext->ecxt_param_exec_vals;
+
+	for (int i = 0; i < node->nfilters; i++)
+	{
+		HashRuntimeFilter *filter = &node->filters[i];
+		ParamExecData *prm;
+
+		prm = &params[filter->minparam];
+		prm->execPlan = NULL;
+		prm->value = filter->found ? filter->min : (Datum) 0;
+		prm->isnull = !filter->found;
+
+		prm = &params[filter->maxparam];
+		prm->execPlan = NULL;
+		prm->value = filter->found ? filter->max : (Datum) 0;
+		prm->isnull = !filter->found;
+	}
+}
+
 /* ---------------------------------------------------------------
  *		ExecEndHash
  *
@@ -508,6 +691,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
+	hashtable->bloomFilter = NULL;
+	hashtable->bloomProbes = 0;
+	hashtable->bloomRejects = 0;
 	hashtable->chunks = NULL;
 	hashtable->current_chunk = NULL;
 	hashtable->parallel_state = state->parallel_state;
@@ -578,6 +764,23 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 		PrepareTempTablespaces();
 	}
 
+	/*
+	 * If the inner relation is expected to be large, also build a Bloom
+	 * filter over the hash values of all inner tuples, including those that
+	 * go to the skew table or to batch files.  The hash join uses it to
+	 * discard outer tuples that cannot have a match before probing the hash
+	 * table, or before writing them out to a later batch.  The filter gets at
+	 * most an eighth of the hash table's memory budget.  It's not used for
+	 * Parallel Hash, where it would have to be built in shared memory.
+	 */
+	if (enable_hashjoin_bloom_filter &&
+		hashtable->parallel_state == NULL &&
+		rows >= HJ_BLOOM_MIN_ROWS)
+		hashtable->bloomFilter =
+			bloom_create((int64) rows,
+						 (int) Min(space_allowed / (8 * 1024), MAX_KILOBYTES),
+						 0);
+
 	MemoryContextSwitchTo(oldcxt);
 
 	if (hashtable->parallel_state)
@@ -1670,13 +1873,19 @@ ExecHashTableInsert(HashJoinTable hashtable,
 			}
 		}
 
-		/* Account for space used, and back off if we've used too much */
+		/*
+		 * Account for space used, and back off if we've used too much.  If
+		 * the backend as a whole is over backend_memory_limit, back off as
+		 * long as we're using more than a quarter of our own allowance.
+		 */
 		hashtable->spaceUsed += hashTupleSize;
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
 		if (hashtable->spaceUsed +
 			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
-			> hashtable->spaceAllowed)
+			> hashtable->spaceAllowed ||
+			(hashtable->spaceUsed > hashtable->spaceAllowed / 4 &&
+			 BackendMemoryLimitExceeded()))
 			ExecHashIncreaseNumBatches(hashtable);
 	}
 	else
@@ -2420,6 +2629,42 @@ ExecHashGetSkewBucket(HashJoinTable hashtable, uint32 hashvalue)
 	return INVALID_SKEW_BUCKET_NO;
 }
 
+/*
+ * ExecHashBloomLacksHashValue
+ *
+ *		Returns true if the hash table's Bloom filter proves that no inner
+ *		tuple has the given hash value.  Caller must check that there is a
+ *		filter.
+ *
+ * If the filter turns out to reject too few outer tuples to be worth its
+ * cost, it is freed, and hashtable->bloomFilter is reset to NULL.
+ */
+bool
+ExecHashBloomLacksHashValue(HashJoinTable hashtable, uint32 hashvalue)
+{
+	bool		lacks;
+
+	Assert(hashtable->bloomFilter != NULL);
+
+	lacks = bloom_lacks_element(hashtable->bloomFilter,
+								(unsigned char *) &hashvalue,
+								sizeof(hashvalue));
+
+	hashtable->bloomProbes++;
+	if (lacks)
+		hashtable->bloomRejects++;
+
+	if (hashtable->bloomProbes == HJ_BLOOM_TRIAL_PROBES &&
+		hashtable->bloomRejects <
+		HJ_BLOOM_TRIAL_PROBES / HJ_BLOOM_MIN_REJECT_RATIO)
+	{
+		bloom_free(hashtable->bloomFilter);
+		hashtable->bloomFilter = NULL;
+	}
+
+	return lacks;
+}
+
 /*
  * ExecHashSkewTableInsert
  *
@@ -255,6 +255,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (hashNode->nfilters > 0)
+				{
+					/*
+					 * The outer plan uses the Hash node's run-time filters,
+					 * so it mustn't be started before they're available.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -383,6 +391,21 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 																 hashvalue);
 				node->hj_CurTuple = NULL;
 
+				/*
+				 * If the hash table has a Bloom filter, it may be able to
+				 * tell us that there is no match for this tuple, without
+				 * scanning a bucket or postponing the tuple to a later
+				 * batch.  Tuples read back from batch files have already
+				 * passed this test, so don't repeat it for them.
+				 */
+				if (hashtable->bloomFilter != NULL &&
+					hashtable->curbatch == 0 &&
+					ExecHashBloomLacksHashValue(hashtable, hashvalue))
+				{
+					node->hj_JoinState = HJ_FILL_OUTER_TUPLE;
+					continue;
+				}
+
 				/*
 				 * The tuple might not belong to the current batch (where
 				 * "current batch" includes the skew buckets if any).
@@ -1346,6 +1369,14 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/*
+			 * The rebuilt hash table will set new run-time filter values, so
+			 * let the outer plan know that they change.
+			 */
+			if (hashNode->filterParams)
+				UpdateChangedParamSet(node->js.ps.lefttree,
+									  hashNode->filterParams);
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
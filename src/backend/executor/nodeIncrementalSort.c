@@ -464,20 +464,26 @@ switchToPresortedPrefixMode(PlanState *pstate)
  * When we have a bound that's less than DEFAULT_MIN_GROUP_SIZE we start looking
  * for the new group as soon as we've met our bound to avoid fetching more
  * tuples than we absolutely have to fetch.
+ *
+ * Every time a batch ends at a prefix key group boundary soon after reaching
+ * that size, the groups are evidently small, so we double the size for the
+ * next batch, up to MAX_MIN_GROUP_SIZE, to spread the per-sort overhead over
+ * more tiny groups.  Finding a large group takes us back to the default.
  */
 #define DEFAULT_MIN_GROUP_SIZE 32
+#define MAX_MIN_GROUP_SIZE (32 * DEFAULT_MIN_GROUP_SIZE)
 
 /*
  * While we've optimized for small prefix key groups by not starting our prefix
  * key comparisons until we've reached a minimum number of tuples, we don't want
  * that optimization to cause us to lose out on the benefits of being able to
  * assume a large group of tuples is fully presorted by its prefix keys.
- * Therefore we use the DEFAULT_MAX_FULL_SORT_GROUP_SIZE cutoff as a heuristic
+ * Therefore we use twice the current minimum group size as a heuristic cutoff
  * for determining when we believe we've encountered a large group, and, if we
  * get to that point without finding a new prefix key group we transition to
  * presorted prefix key mode.
  */
-#define DEFAULT_MAX_FULL_SORT_GROUP_SIZE (2 * DEFAULT_MIN_GROUP_SIZE)
+#define MAX_FULL_SORT_GROUP_SIZE(node) (2 * (node)->fullsort_group_size)
 
 /* ----------------------------------------------------------------
  *		ExecIncrementalSort
@@ -639,13 +645,13 @@ ExecIncrementalSort(PlanState *pstate)
 			 * number of tuples and tuplesort doesn't switch over to top-n
 			 * heap sort anyway unless it hits (2 * bound) tuples.
 			 */
-			if (currentBound < DEFAULT_MIN_GROUP_SIZE)
+			if (currentBound < node->fullsort_group_size)
 				tuplesort_set_bound(fullsort_state, currentBound);
 
-			minGroupSize = Min(DEFAULT_MIN_GROUP_SIZE, currentBound);
+			minGroupSize = Min(node->fullsort_group_size, currentBound);
 		}
 		else
-			minGroupSize = DEFAULT_MIN_GROUP_SIZE;
+			minGroupSize = node->fullsort_group_size;
 
 		/*
 		 * Because we have to read the next tuple to find out that we've
@@ -766,6 +772,10 @@ ExecIncrementalSort(PlanState *pstate)
 						node->bound_Done = Min(node->bound, node->bound_Done + nTuples);
 					}
 
+					/* Prefix key groups are small; batch more of them. */
+					if (node->fullsort_group_size < MAX_MIN_GROUP_SIZE)
+						node->fullsort_group_size *= 2;
+
 					/*
 					 * Once we find changed prefix keys we can complete the
 					 * sort and transition modes to reading out the sorted
@@ -786,14 +796,17 @@ ExecIncrementalSort(PlanState *pstate)
 			/*
 			 * Unless we've already transitioned modes to reading from the
 			 * full sort state, then we assume that having read at least
-			 * DEFAULT_MAX_FULL_SORT_GROUP_SIZE tuples means it's likely we're
+			 * MAX_FULL_SORT_GROUP_SIZE tuples means it's likely we're
 			 * processing a large group of tuples all having equal prefix keys
 			 * (but haven't yet found the final tuple in that prefix key
 			 * group), so we need to transition into presorted prefix mode.
 			 */
-			if (nTuples > DEFAULT_MAX_FULL_SORT_GROUP_SIZE &&
+			if (nTuples > MAX_FULL_SORT_GROUP_SIZE(node) &&
 				node->execution_status != INCSORT_READFULLSORT)
 			{
+				/* Large groups are handled by presorted prefix mode. */
+				node->fullsort_group_size = DEFAULT_MIN_GROUP_SIZE;
+
 				/*
 				 * The group pivot we have stored has already been put into
 				 * the tuplesort; we don't want to carry it over. Since we
@@ -1000,6 +1013,7 @@ ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
 	incrsortstate->group_pivot = NULL;
 	incrsortstate->transfer_tuple = NULL;
 	incrsortstate->n_fullsort_remaining = 0;
+	incrsortstate->fullsort_group_size = DEFAULT_MIN_GROUP_SIZE;
 	incrsortstate->presorted_keys = NULL;
 
 	if (incrsortstate->ss.ps.instrument != NULL)
@@ -1137,6 +1151,7 @@ ExecReScanIncrementalSort(IncrementalSortState *node)
 
 	node->outerNodeDone = false;
 	node->n_fullsort_remaining = 0;
+	node->fullsort_group_size = DEFAULT_MIN_GROUP_SIZE;
 	node->bound_Done = 0;
 	node->presorted_keys = NULL;
 
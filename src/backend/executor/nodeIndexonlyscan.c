@@ -43,6 +43,7 @@
 #include "storage/predicate.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
@@ -97,6 +98,9 @@ IndexOnlyNext(IndexOnlyScanState *node)
 								   node->ioss_NumOrderByKeys);
 
 		node->ioss_ScanDesc = scandesc;
+		/* have the index AM hint upcoming heap fetches, see btgettuple */
+		scandesc->xs_prefetch_target =
+			get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 
 
 		/* Set it up for index-only scan */
@@ -679,6 +683,8 @@ ExecIndexOnlyScanInitializeDSM(IndexOnlyScanState *node,
 								 node->ioss_NumScanKeys,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
+	node->ioss_ScanDesc->xs_prefetch_target =
+		get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 	node->ioss_ScanDesc->xs_want_itup = true;
 	node->ioss_VMBuffer = InvalidBuffer;
 
@@ -724,6 +730,8 @@ ExecIndexOnlyScanInitializeWorker(IndexOnlyScanState *node,
 								 node->ioss_NumScanKeys,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
+	node->ioss_ScanDesc->xs_prefetch_target =
+		get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 	node->ioss_ScanDesc->xs_want_itup = true;
 
 	/*
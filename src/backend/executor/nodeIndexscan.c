@@ -43,6 +43,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 /*
  * When an ordering operator is used, tuples fetched from the index that
@@ -116,6 +117,9 @@ IndexNext(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		/* have the index AM hint upcoming heap fetches, see btgettuple */
+		scandesc->xs_prefetch_target =
+			get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -211,6 +215,8 @@ IndexNextWithReorder(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		scandesc->xs_prefetch_target =
+			get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -727,6 +733,54 @@ ExecIndexEvalArrayKeys(ExprContext *econtext,
 	return result;
 }
 
+/*
+ * ExecIndexAddSkipKey
+ *		Add a key on the first index column in front of an index scan's keys.
+ *
+ * This lets the caller (a merge join) move the scan ahead to a given value of
+ * the first index column by changing the key and rescanning.  The new key is
+ * initialized as IS NOT NULL, which any merge join would reject anyway.  The
+ * runtime keys are updated to point into the new array of keys.  This must be
+ * done before the scan is begun, so that the index AM is told about the new
+ * number of keys.
+ */
+ScanKey
+ExecIndexAddSkipKey(ScanKey *scanKeys, int *numScanKeys,
+					IndexRuntimeKeyInfo *runtimeKeys, int numRuntimeKeys)
+{
+	ScanKey		oldkeys = *scanKeys;
+	ScanKey		newkeys;
+	int			j;
+
+	/* index AMs expect keys to be sorted by index column, so go first */
+	newkeys = (ScanKey) palloc((*numScanKeys + 1) * sizeof(ScanKeyData));
+	if (*numScanKeys > 0)
+		memcpy(newkeys + 1, oldkeys, *numScanKeys * sizeof(ScanKeyData));
+
+	/* row comparison members live elsewhere, and don't need to move */
+	for (j = 0; j < numRuntimeKeys; j++)
+	{
+		ScanKey		scan_key = runtimeKeys[j].scan_key;
+
+		if (scan_key >= oldkeys && scan_key < oldkeys + *numScanKeys)
+			runtimeKeys[j].scan_key = newkeys + 1 + (scan_key - oldkeys);
+	}
+
+	ScanKeyEntryInitialize(newkeys,
+						   SK_ISNULL | SK_SEARCHNOTNULL,
+						   1,	/* first index column */
+						   InvalidStrategy, /* no strategy */
+						   InvalidOid,	/* no strategy subtype */
+						   InvalidOid,	/* no collation */
+						   InvalidOid,	/* no reg proc for this */
+						   (Datum) 0);	/* constant */
+
+	*scanKeys = newkeys;
+	(*numScanKeys)++;
+
+	return newkeys;
+}
+
 /*
  * ExecIndexAdvanceArrayKeys
  *		Advance to the next set of array key values, if any.
@@ -1688,6 +1742,8 @@ ExecIndexScanInitializeDSM(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	node->iss_ScanDesc->xs_prefetch_target =
+		get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -1731,6 +1787,8 @@ ExecIndexScanInitializeWorker(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	node->iss_ScanDesc->xs_prefetch_target =
+		get_tablespace_io_concurrency(node->ss.ss_currentRelation->rd_rel->reltablespace);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
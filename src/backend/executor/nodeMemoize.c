@@ -50,6 +50,15 @@
  * demanding, then that may allow us to start putting useful entries back into
  * the cache again.
  *
+ * A Memoize node on the inner side of a parallel nested loop may be marked
+ * parallel aware.  Each participant then still keeps its own cache as above,
+ * but in addition, every entry that a participant completes is copied into a
+ * hash table in the query's DSA area, so that other participants can return
+ * those tuples instead of executing the subplan again.  Shared entries are
+ * immutable and are never removed before the end of the query, which lets
+ * readers walk the table without any locking.  Rather than evicting, we
+ * simply stop adding to the shared table once it reaches the memory budget.
+ *
  *
  * INTERFACE ROUTINES
  *		ExecMemoize			- lookup cache, exec subplan when not found
@@ -71,6 +80,9 @@
 #include "executor/nodeMemoize.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "utils/dsa.h"
 #include "utils/lsyscache.h"
 
 /* States of the ExecMemoize state machine */
@@ -80,6 +92,15 @@
 #define MEMO_CACHE_BYPASS_MODE		4	/* Bypass mode.  Just read from our
 										 * subplan without caching anything */
 #define MEMO_END_OF_SCAN			5	/* Ready for rescan */
+#define MEMO_SHARED_FETCH_NEXT_TUPLE 6	/* Get another tuple from the shared
+										 * cache */
+
+/*
+ * Shared memory TOC key for a parallel-aware Memoize's shared cache.  The
+ * plan_node_id itself is already used for the instrumentation.
+ */
+#define PARALLEL_MEMOIZE_KEY(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (uint64) (plan_node_id))
 
 
 /* Helper macros for memory accounting */
@@ -122,6 +143,36 @@ typedef struct MemoizeEntry
 } MemoizeEntry;
 
 
+/*
+ * SharedMemoizeEntry
+ *		A completed cache entry published in the shared cache.  The header is
+ *		followed by the key's MinimalTuple and then by 'ntuples' cached
+ *		MinimalTuples, each starting at a MAXALIGNed offset.
+ */
+typedef struct SharedMemoizeEntry
+{
+	dsa_pointer next;			/* next entry in the same bucket */
+	uint32		hash;			/* hash value of the key */
+	uint32		ntuples;		/* number of cached tuples */
+} SharedMemoizeEntry;
+
+#define SHARED_ENTRY_KEY(e) \
+	((MinimalTuple) ((char *) (e) + MAXALIGN(sizeof(SharedMemoizeEntry))))
+
+/*
+ * ParallelMemoizeState
+ *		Shared cache of a parallel-aware Memoize node, stored in the DSM
+ *		segment.  Entries are pushed onto the front of their bucket's list
+ *		with compare-and-swap.
+ */
+typedef struct ParallelMemoizeState
+{
+	pg_atomic_uint64 mem_used;	/* bytes used by published entries */
+	uint64		mem_limit;		/* stop publishing beyond this */
+	uint32		nbuckets;		/* size of buckets[], a power of 2 */
+	dsa_pointer_atomic buckets[FLEXIBLE_ARRAY_MEMBER];
+} ParallelMemoizeState;
+
 #define SH_PREFIX memoize
 #define SH_ELEMENT_TYPE MemoizeEntry
 #define SH_KEY_TYPE MemoizeKey *
@@ -575,6 +626,148 @@ cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * cache_publish_entry
+ *		Copy the completed local cache entry 'entry' into the shared cache
+ *		so that other participants can use it.  Nothing happens if the shared
+ *		cache has used up its memory budget.
+ *
+ * We don't check whether some other participant has published the same key
+ * meanwhile.  That can only happen when both missed it at about the same
+ * time, and a duplicate entry is harmless, if slightly wasteful.
+ */
+static void
+cache_publish_entry(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	ParallelMemoizeState *pstate = mstate->pstate;
+	dsa_area   *area = mstate->ss.ps.state->es_query_dsa;
+	MinimalTuple params = entry->key->params;
+	MemoizeTuple *tuple;
+	SharedMemoizeEntry *sentry;
+	dsa_pointer_atomic *bucket;
+	dsa_pointer dp;
+	dsa_pointer head;
+	uint32		ntuples = 0;
+	Size		size;
+	char	   *ptr;
+
+	Assert(entry->complete);
+
+	size = MAXALIGN(sizeof(SharedMemoizeEntry)) + MAXALIGN(params->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		size += MAXALIGN(tuple->mintuple->t_len);
+		ntuples++;
+	}
+
+	/* Reserve the space within the shared budget, or give up */
+	if (pg_atomic_add_fetch_u64(&pstate->mem_used, size) > pstate->mem_limit)
+	{
+		pg_atomic_sub_fetch_u64(&pstate->mem_used, size);
+		return;
+	}
+
+	dp = dsa_allocate_extended(area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		pg_atomic_sub_fetch_u64(&pstate->mem_used, size);
+		return;
+	}
+
+	sentry = (SharedMemoizeEntry *) dsa_get_address(area, dp);
+	sentry->hash = entry->hash;
+	sentry->ntuples = ntuples;
+
+	ptr = (char *) SHARED_ENTRY_KEY(sentry);
+	memcpy(ptr, params, params->t_len);
+	ptr += MAXALIGN(params->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		memcpy(ptr, tuple->mintuple, tuple->mintuple->t_len);
+		ptr += MAXALIGN(tuple->mintuple->t_len);
+	}
+
+	/*
+	 * Link it in.  The compare-and-swap acts as a full barrier, so the entry
+	 * contents are visible to anyone who can see the new list head.
+	 */
+	bucket = &pstate->buckets[entry->hash & (pstate->nbuckets - 1)];
+	head = dsa_pointer_atomic_read(bucket);
+	do
+	{
+		sentry->next = head;
+	} while (!dsa_pointer_atomic_compare_exchange(bucket, &head, dp));
+}
+
+/*
+ * cache_lookup_shared
+ *		Look in the shared cache for a complete entry for the parameters of
+ *		the local cache entry 'entry'.  Returns NULL if there is none.
+ */
+static SharedMemoizeEntry *
+cache_lookup_shared(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	ParallelMemoizeState *pstate = mstate->pstate;
+	dsa_area   *area = mstate->ss.ps.state->es_query_dsa;
+	ExprContext *econtext = mstate->ss.ps.ps_ExprContext;
+	dsa_pointer dp;
+
+	/*
+	 * Evictions done by cache_lookup() may have left some other key in the
+	 * probe slot, so set it up again.
+	 */
+	prepare_probe_slot(mstate, entry->key);
+
+	dp = dsa_pointer_atomic_read(&pstate->buckets[entry->hash &
+												  (pstate->nbuckets - 1)]);
+	while (DsaPointerIsValid(dp))
+	{
+		SharedMemoizeEntry *sentry;
+
+		/* pairs with the barrier in cache_publish_entry's compare-and-swap */
+		pg_read_barrier();
+
+		sentry = (SharedMemoizeEntry *) dsa_get_address(area, dp);
+		if (sentry->hash == entry->hash)
+		{
+			ExecStoreMinimalTuple(SHARED_ENTRY_KEY(sentry), mstate->tableslot,
+								  false);
+			econtext->ecxt_innertuple = mstate->tableslot;
+			econtext->ecxt_outertuple = mstate->probeslot;
+			if (ExecQualAndReset(mstate->cache_eq_expr, econtext))
+				return sentry;
+		}
+		dp = sentry->next;
+	}
+
+	return NULL;
+}
+
+/*
+ * shared_fetch_next_tuple
+ *		Return the next tuple of the shared cache entry being read, or NULL
+ *		and move to MEMO_END_OF_SCAN if there are no more.
+ */
+static TupleTableSlot *
+shared_fetch_next_tuple(MemoizeState *mstate)
+{
+	TupleTableSlot *slot = mstate->ss.ps.ps_ResultTupleSlot;
+	MinimalTuple mtup;
+
+	if (mstate->shared_remaining == 0)
+	{
+		mstate->mstatus = MEMO_END_OF_SCAN;
+		return NULL;
+	}
+
+	mtup = (MinimalTuple) mstate->shared_next;
+	mstate->shared_next += MAXALIGN(mtup->t_len);
+	mstate->shared_remaining--;
+
+	ExecStoreMinimalTuple(mtup, slot, false);
+	return slot;
+}
+
 static TupleTableSlot *
 ExecMemoize(PlanState *pstate)
 {
@@ -637,6 +830,32 @@ ExecMemoize(PlanState *pstate)
 					return NULL;
 				}
 
+				/*
+				 * Before running the subplan, see if another participant has
+				 * already cached a complete result for these parameters.  If
+				 * so, return the tuples straight from the shared cache; our
+				 * own entry for them would only duplicate it.
+				 */
+				if (node->pstate != NULL && entry != NULL)
+				{
+					SharedMemoizeEntry *sentry;
+
+					sentry = cache_lookup_shared(node, entry);
+					if (sentry != NULL)
+					{
+						node->stats.cache_hits += 1;	/* stats update */
+
+						remove_cache_entry(node, entry);
+
+						node->shared_next = (char *) SHARED_ENTRY_KEY(sentry) +
+							MAXALIGN(SHARED_ENTRY_KEY(sentry)->t_len);
+						node->shared_remaining = sentry->ntuples;
+						node->mstatus = MEMO_SHARED_FETCH_NEXT_TUPLE;
+
+						return shared_fetch_next_tuple(node);
+					}
+				}
+
 				/* Handle cache miss */
 				node->stats.cache_misses += 1;	/* stats update */
 
@@ -666,7 +885,11 @@ ExecMemoize(PlanState *pstate)
 					 * scan.
 					 */
 					if (likely(entry))
+					{
 						entry->complete = true;
+						if (node->pstate != NULL)
+							cache_publish_entry(node, entry);
+					}
 
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
@@ -699,6 +922,8 @@ ExecMemoize(PlanState *pstate)
 					 * executed to completion.
 					 */
 					entry->complete = node->singlerow;
+					if (entry->complete && node->pstate != NULL)
+						cache_publish_entry(node, entry);
 					node->mstatus = MEMO_FILLING_CACHE;
 				}
 
@@ -730,6 +955,12 @@ ExecMemoize(PlanState *pstate)
 				return slot;
 			}
 
+		case MEMO_SHARED_FETCH_NEXT_TUPLE:
+			/* We shouldn't be in this state if this is not set */
+			Assert(node->shared_next != NULL);
+
+			return shared_fetch_next_tuple(node);
+
 		case MEMO_FILLING_CACHE:
 			{
 				TupleTableSlot *outerslot;
@@ -749,6 +980,8 @@ ExecMemoize(PlanState *pstate)
 				{
 					/* No more tuples.  Mark it as complete */
 					entry->complete = true;
+					if (node->pstate != NULL)
+						cache_publish_entry(node, entry);
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
 				}
@@ -915,6 +1148,9 @@ ExecInitMemoize(Memoize *node, EState *estate, int eflags)
 	dlist_init(&mstate->lru_list);
 	mstate->last_tuple = NULL;
 	mstate->entry = NULL;
+	mstate->pstate = NULL;		/* set up later if parallel aware */
+	mstate->shared_next = NULL;
+	mstate->shared_remaining = 0;
 
 	/*
 	 * Mark if we can assume the cache entry is completed after we get the
@@ -1014,6 +1250,8 @@ ExecReScanMemoize(MemoizeState *node)
 	/* nullify pointers used for the last scan */
 	node->entry = NULL;
 	node->last_tuple = NULL;
+	node->shared_next = NULL;
+	node->shared_remaining = 0;
 
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
@@ -1041,10 +1279,29 @@ ExecEstimateCacheEntryOverheadBytes(double ntuples)
  * ----------------------------------------------------------------
  */
 
+/*
+ * Size of the shared cache's DSM chunk, and number of buckets in it.
+ */
+static Size
+parallel_memoize_size(MemoizeState *node, uint32 *nbuckets)
+{
+	Memoize    *plan = (Memoize *) node->ss.ps.plan;
+	uint32		n;
+
+	n = Min(Max(plan->est_entries, 1024), 1024 * 1024);
+	n = pg_nextpower2_32(n);
+	if (nbuckets)
+		*nbuckets = n;
+
+	return add_size(offsetof(ParallelMemoizeState, buckets),
+					mul_size(n, sizeof(dsa_pointer_atomic)));
+}
+
  /* ----------------------------------------------------------------
   *		ExecMemoizeEstimate
   *
-  *		Estimate space required to propagate memoize statistics.
+  *		Estimate space required for the shared cache, if parallel aware,
+  *		and to propagate memoize statistics.
   * ----------------------------------------------------------------
   */
 void
@@ -1052,7 +1309,14 @@ ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   parallel_memoize_size(node, NULL));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	/* don't need the rest if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
 
@@ -1065,7 +1329,7 @@ ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecMemoizeInitializeDSM
  *
- *		Initialize DSM space for memoize statistics.
+ *		Initialize DSM space for the shared cache and memoize statistics.
  * ----------------------------------------------------------------
  */
 void
@@ -1073,7 +1337,27 @@ ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
+	/* The shared cache needs the query's DSA area to store entries in */
+	if (node->ss.ps.plan->parallel_aware &&
+		node->ss.ps.state->es_query_dsa != NULL)
+	{
+		ParallelMemoizeState *pstate;
+		uint32		nbuckets;
+
+		size = parallel_memoize_size(node, &nbuckets);
+		pstate = shm_toc_allocate(pcxt->toc, size);
+		pg_atomic_init_u64(&pstate->mem_used, 0);
+		pstate->mem_limit = node->mem_limit;
+		pstate->nbuckets = nbuckets;
+		for (uint32 i = 0; i < nbuckets; i++)
+			dsa_pointer_atomic_init(&pstate->buckets[i], InvalidDsaPointer);
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_MEMOIZE_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+		node->pstate = pstate;
+	}
+
+	/* don't need the rest if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
 
@@ -1090,12 +1374,19 @@ ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecMemoizeInitializeWorker
  *
- *		Attach worker to DSM space for memoize statistics.
+ *		Attach worker to DSM space for the shared cache and memoize
+ *		statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecMemoizeInitializeWorker(MemoizeState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+		node->pstate =
+			shm_toc_lookup(pwcxt->toc,
+						   PARALLEL_MEMOIZE_KEY(node->ss.ps.plan->plan_node_id),
+						   true);
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 }
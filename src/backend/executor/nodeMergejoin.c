@@ -93,9 +93,16 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "catalog/index.h"
+#include "catalog/pg_am.h"
 #include "executor/execdebug.h"
+#include "executor/nodeIndexonlyscan.h"
+#include "executor/nodeIndexscan.h"
 #include "executor/nodeMergejoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parsetree.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
@@ -115,6 +122,15 @@
 #define EXEC_MJ_ENDOUTER				10
 #define EXEC_MJ_ENDINNER				11
 
+/*
+ * Number of consecutive inner tuples whose first merge key is lower than the
+ * outer tuple's that we advance over one at a time before repositioning an
+ * inner index scan at the current outer key instead.
+ * Repositioning costs a descent of the index, so don't do it when the inner
+ * tuples that don't join are few and far between.
+ */
+#define MJ_INNER_SKIP_THRESHOLD			16
+
 /*
  * Runtime data for each mergejoin clause
  */
@@ -444,6 +460,33 @@ MJCompare(MergeJoinState *mergestate)
 	return result;
 }
 
+/*
+ * MJCompareFirstKey
+ *
+ * Compare the current outer and inner tuples in the first merge key only,
+ * after MJCompare has found them unequal.  Only inner tuples lower in that
+ * key can be skipped by repositioning the inner index scan; with more merge
+ * keys, MJCompare also finds inner tuples with an equal first key lower.
+ */
+static int
+MJCompareFirstKey(MergeJoinState *mergestate)
+{
+	MergeJoinClause clause = &mergestate->mj_Clauses[0];
+	ExprContext *econtext = mergestate->js.ps.ps_ExprContext;
+	MemoryContext oldContext;
+	int			result;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	result = ApplySortComparator(clause->ldatum, clause->lisnull,
+								 clause->rdatum, clause->risnull,
+								 &clause->ssup);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return result;
+}
+
 
 /*
  * Generate a fake join tuple with nulls for the inner tuple,
@@ -592,6 +635,199 @@ ExecMergeTupleDump(MergeJoinState *mergestate)
 }
 #endif
 
+/*
+ * MJInitInnerSkip
+ *
+ * If the inner input is a btree index scan on the first merge key, prepare
+ * to skip over long stretches of inner tuples that are less than the current
+ * outer tuple by repositioning the index scan, instead of fetching each of
+ * them.  A join of a few outer tuples to a large indexed inner relation then
+ * costs an index descent per outer key rather than a scan of the relation.
+ *
+ * The inner tuples skipped this way never join to any outer tuple, so this
+ * can't be done when they must be emitted as fill tuples.
+ */
+static void
+MJInitInnerSkip(MergeJoinState *mergestate, MergeJoin *node, int eflags)
+{
+	PlanState  *innerstate = innerPlanState(mergestate);
+	Plan	   *innerplan = innerstate->plan;
+	OpExpr	   *clause;
+	Expr	   *innerexpr;
+	TargetEntry *tle;
+	Var		   *var;
+	Relation	indexrel;
+	ScanDirection indexorderdir;
+	ScanKey    *scanKeys;
+	int		   *numScanKeys;
+	IndexRuntimeKeyInfo *runtimeKeys;
+	int			numRuntimeKeys;
+	Oid			opfamily;
+	Oid			collation;
+	Oid			argtype;
+	Oid			opno;
+	bool		ascending;
+	StrategyNumber strategy;
+
+	mergestate->mj_InnerSkipKey = NULL;
+	mergestate->mj_InnerSkipCount = 0;
+
+	if (mergestate->mj_FillInner || node->mergeclauses == NIL ||
+		innerplan->parallel_aware || (eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		return;
+
+	/* The inner side of the first merge clause must be an inner column */
+	clause = linitial_node(OpExpr, node->mergeclauses);
+	innerexpr = (Expr *) lsecond(clause->args);
+	while (innerexpr && IsA(innerexpr, RelabelType))
+		innerexpr = ((RelabelType *) innerexpr)->arg;
+	if (innerexpr == NULL || !IsA(innerexpr, Var) ||
+		((Var *) innerexpr)->varno != INNER_VAR)
+		return;
+	tle = get_tle_by_resno(innerplan->targetlist,
+						   ((Var *) innerexpr)->varattno);
+	if (tle == NULL || !IsA(tle->expr, Var))
+		return;
+	var = (Var *) tle->expr;
+
+	/* ... which must be the first column of the index being scanned */
+	if (IsA(innerstate, IndexScanState))
+	{
+		IndexScanState *iss = (IndexScanState *) innerstate;
+		IndexScan  *plan = (IndexScan *) innerplan;
+
+		indexrel = iss->iss_RelationDesc;
+		if (iss->iss_NumOrderByKeys > 0 ||
+			var->varno != plan->scan.scanrelid ||
+			var->varattno != indexrel->rd_index->indkey.values[0])
+			return;
+		indexorderdir = plan->indexorderdir;
+		scanKeys = &iss->iss_ScanKeys;
+		numScanKeys = &iss->iss_NumScanKeys;
+		runtimeKeys = iss->iss_RuntimeKeys;
+		numRuntimeKeys = iss->iss_NumRuntimeKeys;
+	}
+	else if (IsA(innerstate, IndexOnlyScanState))
+	{
+		IndexOnlyScanState *ioss = (IndexOnlyScanState *) innerstate;
+		IndexOnlyScan *plan = (IndexOnlyScan *) innerplan;
+
+		indexrel = ioss->ioss_RelationDesc;
+		if (ioss->ioss_NumOrderByKeys > 0 ||
+			var->varno != INDEX_VAR || var->varattno != 1)
+			return;
+		indexorderdir = plan->indexorderdir;
+		scanKeys = &ioss->ioss_ScanKeys;
+		numScanKeys = &ioss->ioss_NumScanKeys;
+		runtimeKeys = ioss->ioss_RuntimeKeys;
+		numRuntimeKeys = ioss->ioss_NumRuntimeKeys;
+	}
+	else
+		return;
+
+	/* The index must sort the column the way the merge join expects */
+	opfamily = node->mergeFamilies[0];
+	collation = node->mergeCollations[0];
+	if (indexrel->rd_rel->relam != BTREE_AM_OID ||
+		indexrel->rd_opfamily[0] != opfamily ||
+		indexrel->rd_indcollation[0] != collation ||
+		ScanDirectionIsNoMovement(indexorderdir))
+		return;
+	ascending = (ScanDirectionIsForward(indexorderdir) ==
+				 ((indexrel->rd_indoption[0] & INDOPTION_DESC) == 0));
+	if (ascending != (node->mergeStrategies[0] == BTLessStrategyNumber))
+		return;
+
+	/* Look up the operator comparing the column to the outer key */
+	strategy = ascending ? BTGreaterEqualStrategyNumber : BTLessEqualStrategyNumber;
+	argtype = exprType((Node *) linitial(clause->args));
+	opno = get_opfamily_member(opfamily, indexrel->rd_opcintype[0], argtype,
+							   strategy);
+	if (!OidIsValid(opno))
+		return;
+
+	mergestate->mj_InnerSkipTemplate = (ScanKey) palloc(sizeof(ScanKeyData));
+	ScanKeyEntryInitialize(mergestate->mj_InnerSkipTemplate,
+						   0,	/* flags */
+						   1,	/* first index column */
+						   strategy,
+						   argtype,
+						   collation,
+						   get_opcode(opno),
+						   (Datum) 0);	/* set when skipping */
+	get_typlenbyval(argtype, &mergestate->mj_InnerSkipTypLen,
+					&mergestate->mj_InnerSkipByVal);
+
+	mergestate->mj_InnerSkipKey = ExecIndexAddSkipKey(scanKeys, numScanKeys,
+													  runtimeKeys,
+													  numRuntimeKeys);
+}
+
+/*
+ * MJSkipInner
+ *
+ * Reposition the inner index scan at the first tuple whose first merge key
+ * is not less than the current outer tuple's, in the merge ordering.  Any
+ * inner tuples before that are less than the outer tuple, and therefore less
+ * than all of the outer tuples that follow it.
+ */
+static void
+MJSkipInner(MergeJoinState *node)
+{
+	ScanKey		key = node->mj_InnerSkipKey;
+	PlanState  *innerPlan = innerPlanState(node);
+	MemoryContext oldcontext;
+	Datum		oldvalue = 0;
+	bool		hadvalue;
+
+	Assert(!node->mj_Clauses[0].lisnull);
+
+	hadvalue = (key->sk_flags & SK_ISNULL) == 0;
+	if (hadvalue)
+		oldvalue = key->sk_argument;
+
+	/* The key must stay valid for the rest of the (re)scan */
+	oldcontext = MemoryContextSwitchTo(node->js.ps.state->es_query_cxt);
+	*key = *node->mj_InnerSkipTemplate;
+	key->sk_argument = datumCopy(node->mj_Clauses[0].ldatum,
+								 node->mj_InnerSkipByVal,
+								 node->mj_InnerSkipTypLen);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (IsA(innerPlan, IndexScanState))
+		ExecReScanIndexScan((IndexScanState *) innerPlan);
+	else
+		ExecReScanIndexOnlyScan((IndexOnlyScanState *) innerPlan);
+
+	if (hadvalue && !node->mj_InnerSkipByVal)
+		pfree(DatumGetPointer(oldvalue));
+}
+
+/*
+ * MJResetInnerSkip
+ *
+ * Reset the inner index scan's skip key for a rescan of the join.
+ */
+static void
+MJResetInnerSkip(MergeJoinState *node)
+{
+	ScanKey		key = node->mj_InnerSkipKey;
+
+	if ((key->sk_flags & SK_ISNULL) == 0 && !node->mj_InnerSkipByVal)
+		pfree(DatumGetPointer(key->sk_argument));
+
+	ScanKeyEntryInitialize(key,
+						   SK_ISNULL | SK_SEARCHNOTNULL,
+						   1,	/* first index column */
+						   InvalidStrategy, /* no strategy */
+						   InvalidOid,	/* no strategy subtype */
+						   InvalidOid,	/* no collation */
+						   InvalidOid,	/* no reg proc for this */
+						   (Datum) 0);	/* constant */
+	node->mj_InnerSkipCount = 0;
+}
+
+
 /* ----------------------------------------------------------------
  *		ExecMergeJoin
  * ----------------------------------------------------------------
@@ -1190,12 +1426,25 @@ ExecMergeJoin(PlanState *pstate)
 					MarkInnerTuple(node->mj_InnerTupleSlot, node);
 
 					node->mj_JoinState = EXEC_MJ_JOINTUPLES;
+					node->mj_InnerSkipCount = 0;
 				}
 				else if (compareResult < 0)
+				{
 					node->mj_JoinState = EXEC_MJ_SKIPOUTER_ADVANCE;
+					node->mj_InnerSkipCount = 0;
+				}
 				else
+				{
 					/* compareResult > 0 */
+					if (node->mj_InnerSkipKey != NULL)
+					{
+						if (MJCompareFirstKey(node) > 0)
+							node->mj_InnerSkipCount++;
+						else
+							node->mj_InnerSkipCount = 0;
+					}
 					node->mj_JoinState = EXEC_MJ_SKIPINNER_ADVANCE;
+				}
 				break;
 
 				/*
@@ -1289,6 +1538,22 @@ ExecMergeJoin(PlanState *pstate)
 				if (node->mj_ExtraMarks)
 					ExecMarkPos(innerPlan);
 
+				/*
+				 * If we've been advancing over inner tuples lower than the
+				 * outer one in the first merge key for a while (as counted by
+				 * EXEC_MJ_SKIP_TEST), get the inner index scan to skip ahead
+				 * to the outer key.  Since the current inner tuple is one of
+				 * them, that moves the scan forward.  It invalidates the inner
+				 * mark, but we won't go back to it: the outer tuples that
+				 * follow are all greater than it.
+				 */
+				if (node->mj_InnerSkipKey != NULL &&
+					node->mj_InnerSkipCount >= MJ_INNER_SKIP_THRESHOLD)
+				{
+					MJSkipInner(node);
+					node->mj_InnerSkipCount = 0;
+				}
+
 				/*
 				 * now we get the next inner tuple, if any
 				 */
@@ -1603,6 +1868,9 @@ ExecInitMergeJoin(MergeJoin *node, EState *estate, int eflags)
 											node->mergeNullsFirst,
 											(PlanState *) mergestate);
 
+	/* see if we can skip ahead in the inner index scan */
+	MJInitInnerSkip(mergestate, node, eflags);
+
 	/*
 	 * initialize join state
 	 */
@@ -1666,6 +1934,10 @@ ExecReScanMergeJoin(MergeJoinState *node)
 	node->mj_OuterTupleSlot = NULL;
 	node->mj_InnerTupleSlot = NULL;
 
+	/* the inner scan must start from the beginning again */
+	if (node->mj_InnerSkipKey != NULL)
+		MJResetInnerSkip(node);
+
 	/*
 	 * if chgParam of subnodes is not null then plans will be re-scanned by
 	 * first ExecProcNode.
@@ -115,19 +115,23 @@ ExecRecursiveUnion(PlanState *pstate)
 		slot = ExecProcNode(innerPlan);
 		if (TupIsNull(slot))
 		{
+			Tuplestorestate *swaptemp;
+
 			/* Done if there's nothing in the intermediate table */
 			if (node->intermediate_empty)
 				break;
 
-			/* done with old working table ... */
-			tuplestore_end(node->working_table);
-
-			/* intermediate table becomes working table */
+			/*
+			 * The intermediate table becomes the working table, and the old
+			 * working table, emptied, becomes the new intermediate table.
+			 * Recycling it, rather than creating a new tuplestore for every
+			 * iteration, keeps its tuple array allocated at the size the
+			 * previous iterations needed.
+			 */
+			swaptemp = node->working_table;
 			node->working_table = node->intermediate_table;
-
-			/* create new empty intermediate table */
-			node->intermediate_table = tuplestore_begin_heap(false, false,
-															 work_mem);
+			node->intermediate_table = swaptemp;
+			tuplestore_clear(node->intermediate_table);
 			node->intermediate_empty = true;
 
 			/* reset the recursive term */
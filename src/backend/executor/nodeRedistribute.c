@@ -0,0 +1,454 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeRedistribute.c
+ *	  Routines to repartition tuples between the participants of a
+ *	  parallel plan.
+ *
+ * A Redistribute node collects the output of its subplan from every process
+ * taking part in a parallel query, and hands it back out again partitioned
+ * by a hash of some of its columns, so that all rows with equal values in
+ * those columns are returned by the same process.  Nodes above it, such as
+ * a WindowAgg partitioned by those columns, can then compute complete
+ * results in each process.
+ *
+ * Each participant first runs its copy of the subplan to completion,
+ * writing every row into one of a number of partitions, each of which is a
+ * SharedTuplestore in a SharedFileSet.  Once all participants are done
+ * writing, each participant claims whole partitions one at a time and
+ * returns their rows.  Participants that attach only after writing has
+ * finished have nothing to contribute, since the parallel-aware scans
+ * below us have already been exhausted, so they go straight to reading.
+ *
+ * Outside of a parallel query, or if no DSM segment could be set up, the
+ * node just passes its subplan's rows through.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeRedistribute.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecRedistribute		- return the next row of our partitions
+ *		ExecInitRedistribute	- initialize node and subnodes
+ *		ExecEndRedistribute		- shutdown node and subnodes
+ *
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/nodeRedistribute.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
+#include "utils/sharedtuplestore.h"
+
+/* Phases of ParallelRedistributeState's barrier */
+#define RD_PHASE_WRITING		0
+#define RD_PHASE_READING		1
+
+/*
+ * Shared state for a Redistribute node, in the query's DSM segment.
+ *
+ * There is one partition for each planned participant.  The partitions'
+ * SharedTuplestores follow the fixed part of the struct.
+ */
+typedef struct ParallelRedistributeState
+{
+	Barrier		barrier;		/* tracks the phases above */
+	pg_atomic_uint32 next_partition;	/* next partition to hand out */
+	int			nparticipants;	/* number of participants and partitions */
+	SharedFileSet fileset;		/* space for the partitions' files */
+	char		sts[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedistributeState;
+
+static Size redistribute_shared_size(int nparticipants);
+static SharedTuplestore *redistribute_partition(ParallelRedistributeState *pstate,
+												int partition);
+static void redistribute_initialize_partitions(RedistributeState *node);
+static void redistribute_attach_partitions(RedistributeState *node,
+										   int participant);
+static void redistribute_write(RedistributeState *node);
+static uint32 redistribute_hash(RedistributeState *node,
+								TupleTableSlot *slot);
+
+/* ----------------------------------------------------------------
+ *		ExecRedistribute
+ *
+ *		The first call runs the subplan to completion, writing out its
+ *		rows; then we return the rows of whichever partitions we claim.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRedistribute(PlanState *pstate)
+{
+	RedistributeState *node = castNode(RedistributeState, pstate);
+	ParallelRedistributeState *shared = node->pstate;
+	TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Without shared state, we're the only participant. */
+	if (shared == NULL)
+		return ExecProcNode(outerPlanState(node));
+
+	if (!node->attached)
+	{
+		node->attached = true;
+		if (BarrierAttach(&shared->barrier) == RD_PHASE_WRITING)
+		{
+			redistribute_write(node);
+			BarrierArriveAndWait(&shared->barrier,
+								 WAIT_EVENT_REDISTRIBUTE_WRITE);
+		}
+		Assert(BarrierPhase(&shared->barrier) >= RD_PHASE_READING);
+	}
+
+	for (;;)
+	{
+		MinimalTuple tuple;
+
+		if (node->curpartition < 0)
+		{
+			int			partition;
+
+			/* Claim the next partition, if any remain. */
+			partition = pg_atomic_fetch_add_u32(&shared->next_partition, 1);
+			if (partition >= shared->nparticipants)
+			{
+				if (!node->detached)
+				{
+					BarrierDetach(&shared->barrier);
+					node->detached = true;
+				}
+				return ExecClearTuple(slot);
+			}
+			node->curpartition = partition;
+			sts_begin_parallel_scan(node->accessors[partition]);
+		}
+
+		tuple = sts_parallel_scan_next(node->accessors[node->curpartition],
+									   NULL);
+		if (tuple != NULL)
+			return ExecStoreMinimalTuple(tuple, slot, false);
+
+		sts_end_parallel_scan(node->accessors[node->curpartition]);
+		node->curpartition = -1;
+	}
+}
+
+/*
+ * Run our copy of the subplan to completion, writing each row into the
+ * partition its hash value selects.
+ */
+static void
+redistribute_write(RedistributeState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	int			npartitions = node->pstate->nparticipants;
+	int			i;
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MinimalTuple tuple;
+		bool		shouldFree;
+		uint32		hashvalue;
+
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot))
+			break;
+
+		ResetExprContext(econtext);
+		hashvalue = redistribute_hash(node, slot);
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->accessors[hashvalue % npartitions], NULL, tuple);
+		if (shouldFree)
+			heap_free_minimal_tuple(tuple);
+	}
+
+	for (i = 0; i < npartitions; i++)
+		sts_end_write(node->accessors[i]);
+}
+
+/*
+ * Compute the hash value of the slot's distribution columns, the same way
+ * TupleHashTableHash does.
+ */
+static uint32
+redistribute_hash(RedistributeState *node, TupleTableSlot *slot)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	int			i;
+
+	oldContext = MemoryContextSwitchTo(node->ps.ps_ExprContext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < plan->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, plan->hashColIdx[i], &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->hashfunctions[i],
+													plan->hashCollations[i],
+													attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return murmurhash32(hashkey);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitRedistribute
+ * ----------------------------------------------------------------
+ */
+RedistributeState *
+ExecInitRedistribute(Redistribute *node, EState *estate, int eflags)
+{
+	RedistributeState *rdstate;
+	Oid		   *eqfuncoids;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rdstate = makeNode(RedistributeState);
+	rdstate->ps.plan = (Plan *) node;
+	rdstate->ps.state = estate;
+	rdstate->ps.ExecProcNode = ExecRedistribute;
+
+	rdstate->pstate = NULL;
+	rdstate->accessors = NULL;
+	rdstate->attached = false;
+	rdstate->detached = false;
+	rdstate->curpartition = -1;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an ExprContext only for its per-tuple memory, in which the
+	 * hash functions run.
+	 */
+	ExecAssignExprContext(estate, &rdstate->ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(rdstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type and slot.  We return rows straight from the
+	 * tuplestores, so there's no projection.
+	 */
+	ExecInitResultTupleSlotTL(&rdstate->ps, &TTSOpsMinimalTuple);
+	rdstate->ps.ps_ProjInfo = NULL;
+
+	/* Look up the hash functions for the distribution columns */
+	execTuplesHashPrepare(node->numCols, node->hashOperators,
+						  &eqfuncoids, &rdstate->hashfunctions);
+
+	return rdstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndRedistribute
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndRedistribute(RedistributeState *node)
+{
+	ExecFreeExprContext(&node->ps);
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanRedistribute
+ *
+ *		Within a parallel query, we are only rescanned along with the
+ *		Gather above us; ExecRedistributeReInitializeDSM resets the shared
+ *		state in that case.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanRedistribute(RedistributeState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	node->attached = false;
+	node->detached = false;
+	node->curpartition = -1;
+
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+static Size
+redistribute_shared_size(int nparticipants)
+{
+	return add_size(offsetof(ParallelRedistributeState, sts),
+					mul_size(nparticipants,
+							 MAXALIGN(sts_estimate(nparticipants))));
+}
+
+static SharedTuplestore *
+redistribute_partition(ParallelRedistributeState *pstate, int partition)
+{
+	return (SharedTuplestore *)
+		(pstate->sts + partition * MAXALIGN(sts_estimate(pstate->nparticipants)));
+}
+
+/*
+ * Set up the partitions' tuplestores, as participant 0 (the leader).
+ */
+static void
+redistribute_initialize_partitions(RedistributeState *node)
+{
+	ParallelRedistributeState *pstate = node->pstate;
+	int			i;
+
+	node->accessors = (SharedTuplestoreAccessor **)
+		palloc(pstate->nparticipants * sizeof(SharedTuplestoreAccessor *));
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		char		name[NAMEDATALEN];
+
+		snprintf(name, sizeof(name), "p%d", i);
+		node->accessors[i] =
+			sts_initialize(redistribute_partition(pstate, i),
+						   pstate->nparticipants, 0, 0,
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset, name);
+	}
+}
+
+/*
+ * Attach to the partitions' tuplestores, as a parallel worker.
+ */
+static void
+redistribute_attach_partitions(RedistributeState *node, int participant)
+{
+	ParallelRedistributeState *pstate = node->pstate;
+	int			i;
+
+	node->accessors = (SharedTuplestoreAccessor **)
+		palloc(pstate->nparticipants * sizeof(SharedTuplestoreAccessor *));
+	for (i = 0; i < pstate->nparticipants; i++)
+		node->accessors[i] = sts_attach(redistribute_partition(pstate, i),
+										participant, &pstate->fileset);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeEstimate
+ *
+ *		Estimate space required to propagate redistribution state.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeEstimate(RedistributeState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   redistribute_shared_size(pcxt->nworkers + 1));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeInitializeDSM
+ *
+ *		Set up the shared partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeInitializeDSM(RedistributeState *node, ParallelContext *pcxt)
+{
+	ParallelRedistributeState *pstate;
+	int			nparticipants = pcxt->nworkers + 1;
+
+	/* The partitions' files need a real DSM segment to be cleaned up with. */
+	if (pcxt->seg == NULL)
+		return;
+
+	pstate = shm_toc_allocate(pcxt->toc,
+							  redistribute_shared_size(nparticipants));
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_init_u32(&pstate->next_partition, 0);
+	pstate->nparticipants = nparticipants;
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+
+	node->pstate = pstate;
+	redistribute_initialize_partitions(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeReInitializeDSM(RedistributeState *node,
+								ParallelContext *pcxt)
+{
+	ParallelRedistributeState *pstate = node->pstate;
+
+	if (pstate == NULL)
+		return;
+
+	/* The workers are gone, so whatever is left of their files can go. */
+	SharedFileSetDeleteAll(&pstate->fileset);
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+	redistribute_initialize_partitions(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeInitializeWorker
+ *
+ *		Attach worker to the shared partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeInitializeWorker(RedistributeState *node,
+								 ParallelWorkerContext *pwcxt)
+{
+	ParallelRedistributeState *pstate;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ps.plan->plan_node_id, true);
+	if (pstate == NULL)
+		return;
+
+	SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+	node->pstate = pstate;
+	redistribute_attach_partitions(node, ParallelWorkerNumber + 1);
+}
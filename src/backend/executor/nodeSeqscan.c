@@ -16,6 +16,7 @@
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
  *		ExecSeqNext				retrieve next tuple in sequential order.
+ *		ExecSeqScanBatch		retrieve next batch of qualifying tuples.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
@@ -31,9 +32,14 @@
 #include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static TupleBatch *ExecSeqScanBatch(PlanState *pstate);
+static void ExecSeqScanResetBatch(SeqScanState *node);
+static void SeqScanSetColumnProjection(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -72,6 +78,7 @@ SeqNext(SeqScanState *node)
 								   estate->es_snapshot,
 								   0, NULL);
 		node->ss.ss_currentScanDesc = scandesc;
+		SeqScanSetColumnProjection(node);
 	}
 
 	/*
@@ -82,6 +89,17 @@ SeqNext(SeqScanState *node)
 	return NULL;
 }
 
+/*
+ * SeqScanSetColumnProjection -- pass the set of needed columns to the AM
+ */
+static void
+SeqScanSetColumnProjection(SeqScanState *node)
+{
+	if (node->scan_attrs != NULL)
+		table_scan_set_column_projection(node->ss.ss_currentScanDesc,
+										 node->scan_attrs);
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -114,6 +132,116 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Returns the next batch of qualifying tuples, evaluating the
+ *		scan qual for each tuple as it is fetched.  This avoids going
+ *		through ExecProcNode and ExecScan once per tuple.
+ *
+ *		Each slot in the batch keeps its own buffer pin, so to bound the
+ *		number of pins we hold, a batch is ended as soon as the scan moves
+ *		on to another page.  With heap's page-at-a-time visibility checks
+ *		that makes a batch roughly the visible tuples of one page.
+ *
+ *		Only used when no projection is needed and we're not running
+ *		inside EvalPlanQual, see ExecInitSeqScan.
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+ExecSeqScanBatch(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+	TupleBatch *batch = node->batch;
+	ExprState  *qual = node->ss.ps.qual;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	EState	   *estate = node->ss.ps.state;
+	Buffer		firstbuf = InvalidBuffer;
+
+	if (batch == NULL)
+	{
+		Relation	rel = node->ss.ss_currentRelation;
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+		batch = palloc(sizeof(TupleBatch));
+		batch->nvalid = 0;
+		batch->maxslots = executor_batch_size;
+		batch->slots = palloc(sizeof(TupleTableSlot *) * batch->maxslots);
+		for (int i = 0; i < batch->maxslots; i++)
+			batch->slots[i] = ExecInitExtraTupleSlot(estate,
+													 RelationGetDescr(rel),
+													 table_slot_callbacks(rel));
+		node->batch = batch;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (scandesc == NULL)
+	{
+		/* see SeqNext */
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   estate->es_snapshot,
+								   0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+		SeqScanSetColumnProjection(node);
+	}
+
+	batch->nvalid = 0;
+	while (batch->nvalid < batch->maxslots)
+	{
+		TupleTableSlot *slot = batch->slots[batch->nvalid];
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (!table_scan_getnextslot(scandesc, estate->es_direction, slot))
+			break;
+
+		ResetExprContext(econtext);
+		econtext->ecxt_scantuple = slot;
+
+		if (qual != NULL && !ExecQual(qual, econtext))
+		{
+			InstrCountFiltered1(node, 1);
+			ExecClearTuple(slot);
+			continue;
+		}
+
+		batch->nvalid++;
+
+		if (TTS_IS_BUFFERTUPLE(slot))
+		{
+			Buffer		buf = ((BufferHeapTupleTableSlot *) slot)->buffer;
+
+			if (firstbuf == InvalidBuffer)
+				firstbuf = buf;
+			else if (buf != firstbuf)
+				break;
+		}
+	}
+
+	/* release pins held by slots we didn't fill this time around */
+	for (int i = batch->nvalid; i < batch->maxslots; i++)
+		ExecClearTuple(batch->slots[i]);
+
+	return batch;
+}
+
+/*
+ * ExecSeqScanResetBatch -- forget the current batch, releasing buffer pins
+ */
+static void
+ExecSeqScanResetBatch(SeqScanState *node)
+{
+	TupleBatch *batch = node->batch;
+
+	for (int i = 0; i < batch->maxslots; i++)
+		ExecClearTuple(batch->slots[i]);
+	batch->nvalid = 0;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -171,6 +299,33 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * If the table AM can make use of it, work out which columns the target
+	 * list and qual reference.  A whole-row reference needs all of them.
+	 */
+	if (scanstate->ss.ss_currentRelation->rd_tableam->scan_set_column_projection)
+	{
+		Bitmapset  *attrs = NULL;
+
+		pull_varattnos((Node *) node->scan.plan.targetlist,
+					   node->scan.scanrelid, &attrs);
+		pull_varattnos((Node *) node->scan.plan.qual,
+					   node->scan.scanrelid, &attrs);
+		if (!bms_is_member(InvalidAttrNumber - FirstLowInvalidHeapAttributeNumber,
+						   attrs))
+			scanstate->scan_attrs = attrs;
+	}
+
+	/*
+	 * Offer batch-at-a-time retrieval if enabled, the raw scan tuples can be
+	 * returned as they are, and there's no EvalPlanQual recheck to handle.
+	 * The batch itself is only set up if a consumer asks for one.
+	 */
+	if (executor_batch_size > 1 &&
+		scanstate->ss.ps.ps_ProjInfo == NULL &&
+		estate->es_epq_active == NULL)
+		scanstate->ss.ps.ExecProcNodeBatch = ExecSeqScanBatch;
+
 	return scanstate;
 }
 
@@ -201,6 +356,8 @@ ExecEndSeqScan(SeqScanState *node)
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (node->batch)
+		ExecSeqScanResetBatch(node);
 
 	/*
 	 * close heap scan
@@ -227,6 +384,9 @@ ExecReScanSeqScan(SeqScanState *node)
 
 	scan = node->ss.ss_currentScanDesc;
 
+	if (node->batch)
+		ExecSeqScanResetBatch(node);
+
 	if (scan != NULL)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
@@ -278,6 +438,7 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanSetColumnProjection(node);
 }
 
 /* ----------------------------------------------------------------
@@ -311,4 +472,5 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanSetColumnProjection(node);
 }
@@ -19,8 +19,20 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "storage/spin.h"
 #include "utils/tuplesort.h"
 
+/*
+ * In a parallel bounded sort, how many input tuples each participant sorts
+ * between comparing its threshold with the shared one.
+ */
+#define SORT_THRESHOLD_SHARE_INTERVAL	256
+
+static void prepareThreshold(SortState *node);
+static bool rejectKey(SortState *node, Datum value, bool isnull);
+static void shareThreshold(SortState *node);
+static bool sortSharesThreshold(SortState *node);
+
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -118,6 +130,15 @@ ExecSort(PlanState *pstate)
 			tuplesort_set_bound(tuplesortstate, node->bound);
 		node->tuplesortstate = (void *) tuplesortstate;
 
+		/*
+		 * Once a bounded sort has collected enough tuples, tuples whose
+		 * leading key sorts after its current last one can be discarded
+		 * without copying them; better yet, get the scan below to do that
+		 * before it evaluates its quals and target list.
+		 */
+		if (node->bounded)
+			prepareThreshold(node);
+
 		/*
 		 * Scan the subplan and feed all the tuples to tuplesort using the
 		 * appropriate method based on the type of sort we're doing.
@@ -131,9 +152,15 @@ ExecSort(PlanState *pstate)
 				if (TupIsNull(slot))
 					break;
 				slot_getsomeattrs(slot, 1);
+				if (node->topn_active && node->topn_scan == NULL &&
+					rejectKey(node, slot->tts_values[0], slot->tts_isnull[0]))
+					continue;
 				tuplesort_putdatum(tuplesortstate,
 								   slot->tts_values[0],
 								   slot->tts_isnull[0]);
+				if (node->shared_threshold != NULL &&
+					++node->topn_count % SORT_THRESHOLD_SHARE_INTERVAL == 0)
+					shareThreshold(node);
 			}
 		}
 		else
@@ -144,10 +171,30 @@ ExecSort(PlanState *pstate)
 
 				if (TupIsNull(slot))
 					break;
+				if (node->topn_active && node->topn_scan == NULL)
+				{
+					Datum		value;
+					bool		isnull;
+
+					value = slot_getattr(slot, plannode->sortColIdx[0], &isnull);
+					if (rejectKey(node, value, isnull))
+						continue;
+				}
 				tuplesort_puttupleslot(tuplesortstate, slot);
+				if (node->shared_threshold != NULL &&
+					++node->topn_count % SORT_THRESHOLD_SHARE_INTERVAL == 0)
+					shareThreshold(node);
 			}
 		}
 
+		/* the scan must not discard tuples on our behalf anymore */
+		if (node->topn_scan != NULL)
+		{
+			node->topn_scan->ss_TopNSort = NULL;
+			node->topn_scan = NULL;
+		}
+		node->topn_active = false;
+
 		/*
 		 * Complete the sort.
 		 */
@@ -238,6 +285,9 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
+	sortstate->topn_active = false;
+	sortstate->topn_sortkey = NULL;
+	sortstate->topn_scan = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -398,6 +448,165 @@ ExecReScanSort(SortState *node)
 		tuplesort_rescan((Tuplesortstate *) node->tuplesortstate);
 }
 
+/*
+ * Set up to discard input tuples the bound excludes, and push the check down
+ * into the scan below, if its output's leading sort key is a plain column of
+ * the scanned relation.
+ */
+static void
+prepareThreshold(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	AttrNumber	attno = node->datumSort ? 1 : plannode->sortColIdx[0];
+	TargetEntry *tle;
+	Var		   *var;
+
+	if (node->topn_sortkey == NULL)
+	{
+		SortSupport ssup = palloc0(sizeof(SortSupportData));
+
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = plannode->collations[0];
+		ssup->ssup_nulls_first = plannode->nullsFirst[0];
+		ssup->ssup_attno = attno;
+		ssup->abbreviate = false;
+		PrepareSortSupportFromOrderingOp(plannode->sortOperators[0], ssup);
+		node->topn_sortkey = ssup;
+	}
+
+	node->topn_active = true;
+	node->topn_count = 0;
+	node->topn_shared_valid = false;
+
+	switch (nodeTag(outerNode))
+	{
+		case T_SeqScanState:
+		case T_SampleScanState:
+		case T_IndexScanState:
+		case T_BitmapHeapScanState:
+		case T_TidScanState:
+		case T_TidRangeScanState:
+			break;
+		default:
+			return;
+	}
+
+	tle = list_nth_node(TargetEntry, outerNode->plan->targetlist, attno - 1);
+	if (!IsA(tle->expr, Var))
+		return;
+	var = (Var *) tle->expr;
+	if (var->varno != ((Scan *) outerNode->plan)->scanrelid ||
+		var->varattno <= 0)
+		return;
+
+	node->topn_scan = (ScanState *) outerNode;
+	node->topn_scan->ss_TopNSort = node;
+	node->topn_scan->ss_TopNAttno = var->varattno;
+}
+
+/*
+ * Can a tuple with this leading sort key be discarded, because the sort (or,
+ * in a parallel query, some participant's sort) already holds as many tuples
+ * that sort before it as the bound asks for?
+ */
+static bool
+rejectKey(SortState *node, Datum value, bool isnull)
+{
+	Datum		threshold;
+	bool		thresholdnull;
+
+	if (tuplesort_get_bound_threshold((Tuplesortstate *) node->tuplesortstate,
+									  &threshold, &thresholdnull) &&
+		ApplySortComparator(value, isnull, threshold, thresholdnull,
+							node->topn_sortkey) > 0)
+		return true;
+
+	if (node->topn_shared_valid &&
+		ApplySortComparator(value, isnull,
+							node->topn_shared_value, node->topn_shared_isnull,
+							node->topn_sortkey) > 0)
+		return true;
+
+	return false;
+}
+
+/*
+ * ExecSortRejectTuple
+ *
+ *		Called by a scan we pushed the bound threshold down into, to check
+ *		whether the sort would discard its current tuple.
+ */
+bool
+ExecSortRejectTuple(SortState *node, TupleTableSlot *slot, AttrNumber attno)
+{
+	Datum		value;
+	bool		isnull;
+
+	value = slot_getattr(slot, attno, &isnull);
+
+	return rejectKey(node, value, isnull);
+}
+
+/*
+ * Publish our threshold to the other participants of a parallel query if it
+ * is better than the shared one, and remember the shared one otherwise.
+ *
+ * The comparison is done without holding the spinlock; we only replace the
+ * shared value if nobody else changed it meanwhile, else we'll try again
+ * next time.
+ */
+static void
+shareThreshold(SortState *node)
+{
+	SharedSortThreshold *shared = node->shared_threshold;
+	Datum		value;
+	bool		isnull;
+	bool		havelocal;
+	uint64		generation;
+
+	havelocal = tuplesort_get_bound_threshold((Tuplesortstate *) node->tuplesortstate,
+											  &value, &isnull);
+
+	SpinLockAcquire(&shared->mutex);
+	generation = shared->generation;
+	node->topn_shared_valid = shared->valid;
+	node->topn_shared_value = shared->value;
+	node->topn_shared_isnull = shared->isnull;
+	SpinLockRelease(&shared->mutex);
+
+	if (!havelocal ||
+		(node->topn_shared_valid &&
+		 ApplySortComparator(value, isnull,
+							 node->topn_shared_value, node->topn_shared_isnull,
+							 node->topn_sortkey) >= 0))
+		return;
+
+	SpinLockAcquire(&shared->mutex);
+	if (shared->generation == generation)
+	{
+		shared->valid = true;
+		shared->value = value;
+		shared->isnull = isnull;
+		shared->generation++;
+	}
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * Should the participants of a parallel query share a top-N threshold for
+ * this sort?  Only pass-by-value keys can be put in shared memory as is.
+ */
+static bool
+sortSharesThreshold(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleDesc	tupDesc = ExecGetResultType(outerPlanState(node));
+	AttrNumber	attno = node->datumSort ? 1 : plannode->sortColIdx[0];
+
+	return node->bounded && TupleDescAttr(tupDesc, attno - 1)->attbyval;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Query Support
  * ----------------------------------------------------------------
@@ -406,7 +615,8 @@ ExecReScanSort(SortState *node)
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics and share
+ *		the top-N threshold.
  * ----------------------------------------------------------------
  */
 void
@@ -414,8 +624,9 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if no workers, or neither instrumenting nor sharing */
+	if (pcxt->nworkers == 0 ||
+		(!node->ss.ps.instrument && !sortSharesThreshold(node)))
 		return;
 
 	size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
@@ -427,7 +638,7 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics and top-N threshold.
  * ----------------------------------------------------------------
  */
 void
@@ -435,8 +646,9 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if no workers, or neither instrumenting nor sharing */
+	if (pcxt->nworkers == 0 ||
+		(!node->ss.ps.instrument && !sortSharesThreshold(node)))
 		return;
 
 	size = offsetof(SharedSortInfo, sinstrument)
@@ -445,10 +657,37 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 	/* ensure any unfilled slots will contain zeroes */
 	memset(node->shared_info, 0, size);
 	node->shared_info->num_workers = pcxt->nworkers;
+	SpinLockInit(&node->shared_info->threshold.mutex);
+	if (sortSharesThreshold(node))
+	{
+		node->shared_info->threshold.enabled = true;
+		node->shared_threshold = &node->shared_info->threshold;
+	}
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	SharedSortThreshold *shared = node->shared_threshold;
+
+	/* the statistics are retrieved and reset separately */
+	if (shared == NULL)
+		return;
+
+	SpinLockAcquire(&shared->mutex);
+	shared->valid = false;
+	shared->generation++;
+	SpinLockRelease(&shared->mutex);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
@@ -460,6 +699,8 @@ ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	if (node->shared_info != NULL && node->shared_info->threshold.enabled)
+		node->shared_threshold = &node->shared_info->threshold;
 	node->am_worker = true;
 }
 
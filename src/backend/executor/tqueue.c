@@ -45,6 +45,57 @@ struct TupleQueueReader
 	shm_mq_handle *queue;		/* shm_mq to receive from */
 };
 
+/*
+ * Try to build the minimal tuple for the slot directly in the queue's ring
+ * buffer, so that it is only copied once on its way to the leader.  This
+ * works for slots that would otherwise have to form a tuple in private
+ * memory first.  Returns false, having sent nothing, if the slot's tuple is
+ * already in minimal form or there is no contiguous space in the queue right
+ * now.
+ */
+static bool
+tqueueSendSlotInPlace(TQueueDestReceiver *tqueue, TupleTableSlot *slot,
+					  shm_mq_result *result)
+{
+	Size		len;
+	void	   *dst;
+
+	if (TTS_IS_VIRTUAL(slot))
+	{
+		slot_getallattrs(slot);
+		len = heap_compute_minimal_tuple_size(slot->tts_tupleDescriptor,
+											  slot->tts_values,
+											  slot->tts_isnull);
+		dst = shm_mq_send_reserve(tqueue->queue, len);
+		if (dst == NULL)
+			return false;
+
+		memset(dst, 0, len);
+		heap_fill_minimal_tuple(slot->tts_tupleDescriptor,
+								slot->tts_values, slot->tts_isnull,
+								(MinimalTuple) dst, len);
+	}
+	else if (TTS_IS_HEAPTUPLE(slot) || TTS_IS_BUFFERTUPLE(slot))
+	{
+		HeapTuple	htup = ExecFetchSlotHeapTuple(slot, false, NULL);
+
+		/* Same as minimal_tuple_from_heap_tuple, minus the palloc */
+		Assert(htup->t_len > MINIMAL_TUPLE_OFFSET);
+		len = htup->t_len - MINIMAL_TUPLE_OFFSET;
+		dst = shm_mq_send_reserve(tqueue->queue, len);
+		if (dst == NULL)
+			return false;
+
+		memcpy(dst, (char *) htup->t_data + MINIMAL_TUPLE_OFFSET, len);
+		((MinimalTuple) dst)->t_len = len;
+	}
+	else
+		return false;
+
+	*result = shm_mq_send_reserved(tqueue->queue, len, false);
+	return true;
+}
+
 /*
  * Receive a tuple from a query, and send it to the designated shm_mq.
  *
@@ -54,16 +105,21 @@ static bool
 tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
 
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
+	/* Send the tuple itself, without an intermediate copy if possible. */
+	if (!tqueueSendSlotInPlace(tqueue, slot, &result))
+	{
+		MinimalTuple tuple;
+		bool		should_free;
 
-	if (should_free)
-		pfree(tuple);
+		tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+		result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false,
+							 false);
+
+		if (should_free)
+			pfree(tuple);
+	}
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -164,6 +164,30 @@ llvm_create_context(int jitFlags)
 	return context;
 }
 
+/*
+ * Create a context for code that is to be kept until backend exit, rather
+ * than being released with the current resource owner.
+ *
+ * Functions emitted via such a context stay valid for the rest of the
+ * session, so callers can cache pointers to them across queries.
+ */
+LLVMJitContext *
+llvm_create_persistent_context(int jitFlags)
+{
+	LLVMJitContext *context;
+
+	llvm_assert_in_fatal_section();
+
+	llvm_session_initialize();
+
+	context = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+	context->base.resowner = NULL;
+
+	return context;
+}
+
 /*
  * Release resources required by one llvm context.
  */
@@ -7,6 +7,10 @@
  * knowledge of the tuple descriptor. Fixed column widths, NOT NULLness, etc
  * can be taken advantage of.
  *
+ * Since the generated code depends only on the physical layout of the
+ * tuple descriptor, compiled deform functions are also cached for the
+ * lifetime of the backend, see slot_compile_deform_cached().
+ *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,9 +26,47 @@
 
 #include "access/htup_details.h"
 #include "access/tupdesc_details.h"
+#include "common/hashfn.h"
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+
+/*
+ * The properties of each attribute that influence the generated deform code.
+ * Must not contain padding, as it's hashed and compared bytewise.
+ */
+typedef struct DeformCacheAttr
+{
+	int16		attlen;
+	char		attalign;
+	bool		attbyval;
+	bool		attnotnull;
+	bool		atthasmissing;
+	bool		attisdropped;
+	bool		pad;
+} DeformCacheAttr;
+
+typedef struct DeformCacheKey
+{
+	const TupleTableSlotOps *ops;	/* slot type the code is built for */
+	int			natts;			/* number of attributes to deform */
+	int			desc_natts;		/* number of attributes in the descriptor */
+	uint32		layout_hash;	/* hash of the DeformCacheAttr array */
+} DeformCacheKey;
+
+typedef struct DeformCacheEntry
+{
+	DeformCacheKey key;			/* hash key - must be first */
+	DeformCacheAttr *layout;	/* desc_natts entries */
+	void	   *fn;				/* emitted deform function */
+} DeformCacheEntry;
+
+/* backend-lifetime cache of deform functions, and the context owning them */
+static HTAB *deform_cache = NULL;
+static LLVMJitContext *deform_cache_context = NULL;
 
 
 /*
@@ -754,3 +796,127 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	return v_deform_fn;
 }
+
+/*
+ * Like slot_compile_deform(), but reuse code emitted by an earlier call for
+ * an identically laid out tuple descriptor, possibly in an earlier query.
+ *
+ * The result is a pointer to the emitted function rather than a function in
+ * context's module, so it can be used for calls but won't be inlined.  Since
+ * deform functions are usually not tiny, the call overhead is small compared
+ * to compiling them for every query.
+ */
+LLVMValueRef
+slot_compile_deform_cached(LLVMJitContext *context, TupleDesc desc,
+						   const TupleTableSlotOps *ops, int natts)
+{
+	DeformCacheAttr *layout;
+	Size		layout_size;
+	DeformCacheKey key;
+	DeformCacheEntry *entry;
+	bool		found;
+	LLVMTypeRef param_types[1];
+	LLVMTypeRef deform_sig;
+
+	/* decline to JIT for slot types we don't know to handle */
+	if (ops != &TTSOpsHeapTuple && ops != &TTSOpsBufferHeapTuple &&
+		ops != &TTSOpsMinimalTuple)
+		return NULL;
+
+	layout_size = sizeof(DeformCacheAttr) * desc->natts;
+	layout = palloc0(Max(layout_size, 1));
+	for (int attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+
+		layout[attnum].attlen = att->attlen;
+		layout[attnum].attalign = att->attalign;
+		layout[attnum].attbyval = att->attbyval;
+		layout[attnum].attnotnull = att->attnotnull;
+		layout[attnum].atthasmissing = att->atthasmissing;
+		layout[attnum].attisdropped = att->attisdropped;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.ops = ops;
+	key.natts = natts;
+	key.desc_natts = desc->natts;
+	key.layout_hash = hash_bytes((const unsigned char *) layout, layout_size);
+
+	if (deform_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(DeformCacheKey);
+		ctl.entrysize = sizeof(DeformCacheEntry);
+		deform_cache = hash_create("LLVM deform function cache", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS);
+	}
+
+	entry = (DeformCacheEntry *) hash_search(deform_cache, &key,
+											 HASH_FIND, NULL);
+
+	if (entry != NULL &&
+		memcmp(entry->layout, layout, layout_size) != 0)
+	{
+		/* hash collision, just build an uncached function */
+		pfree(layout);
+		return slot_compile_deform(context, desc, ops, natts);
+	}
+
+	if (entry == NULL)
+	{
+		LLVMValueRef v_deform_fn;
+		char	   *funcname;
+		void	   *fn;
+		DeformCacheAttr *saved_layout;
+
+		if (deform_cache_context == NULL)
+			deform_cache_context =
+				llvm_create_persistent_context(PGJIT_PERFORM | PGJIT_OPT3);
+
+		/* throw away anything left behind by an earlier failure */
+		if (deform_cache_context->module != NULL)
+		{
+			LLVMDisposeModule(deform_cache_context->module);
+			deform_cache_context->module = NULL;
+		}
+		memset(&deform_cache_context->base.instr, 0,
+			   sizeof(JitInstrumentation));
+
+		v_deform_fn = slot_compile_deform(deform_cache_context, desc, ops,
+										  natts);
+		if (v_deform_fn == NULL)
+		{
+			pfree(layout);
+			return NULL;
+		}
+
+		/* needs to be visible to be looked up */
+		LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+		funcname = pstrdup(LLVMGetValueName(v_deform_fn));
+		fn = llvm_get_function(deform_cache_context, funcname);
+		pfree(funcname);
+
+		/* charge the compilation to the query that needed it */
+		InstrJitAgg(&context->base.instr, &deform_cache_context->base.instr);
+
+		saved_layout = MemoryContextAlloc(TopMemoryContext,
+										  Max(layout_size, 1));
+		memcpy(saved_layout, layout, layout_size);
+
+		entry = (DeformCacheEntry *) hash_search(deform_cache, &key,
+												 HASH_ENTER, &found);
+		Assert(!found);
+		entry->layout = saved_layout;
+		entry->fn = fn;
+	}
+
+	pfree(layout);
+
+	param_types[0] = l_ptr(StructTupleTableSlot);
+	deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
+								  lengthof(param_types), 0);
+
+	return l_ptr_const(entry->fn, l_ptr(deform_sig));
+}
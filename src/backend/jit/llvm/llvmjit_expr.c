@@ -316,9 +316,9 @@ llvm_compile_expr(ExprState *state)
 					if (tts_ops && desc && (context->base.flags & PGJIT_DEFORM))
 					{
 						l_jit_deform =
-							slot_compile_deform(context, desc,
-												tts_ops,
-												op->d.fetch.last_var);
+							slot_compile_deform_cached(context, desc,
+													   tts_ops,
+													   op->d.fetch.last_var);
 					}
 
 					if (l_jit_deform)
@@ -9,16 +9,28 @@
  * supported: the hash table never becomes smaller.
  *
  * To deal with concurrency, it has a fixed size set of partitions, each of
- * which is independently locked.  Each bucket maps to a partition; so insert,
- * find and iterate operations normally only acquire one lock.  Therefore,
- * good concurrency is achieved whenever such operations don't collide at the
- * lock partition level.  However, when a resize operation begins, all
- * partition locks must be acquired simultaneously for a brief period.  This
- * is only expected to happen a small number of times until a stable size is
- * found, since growth is geometric.
+ * which is independently locked.  Each hash value maps to a partition; so
+ * insert, find and iterate operations normally only acquire one lock.
+ * Therefore, good concurrency is achieved whenever such operations don't
+ * collide at the lock partition level.
  *
- * Future versions may support iterators and incremental resizing; for now
- * the implementation is minimalist.
+ * Each partition has its own array of buckets, which is resized on its own
+ * while only that partition's lock is held.  The table therefore grows
+ * incrementally, one partition at a time: a resize only moves the entries of
+ * one partition and only blocks the backends that need that partition, and
+ * partitions that are hit harder than others grow earlier.
+ *
+ * Lookups that only need a copy of an entry can use dshash_find_copy, which
+ * normally takes no lock at all.  Each partition has a change counter that is
+ * odd while an exclusive lock is held on it; an optimistic reader notes the
+ * counter, searches the partition without a lock, and retries if the counter
+ * has changed meanwhile.  Because entries and bucket arrays can be freed while
+ * such a reader is looking at them, it must translate dsa_pointers with
+ * dsa_get_address_if_mapped, which never maps or unmaps memory and so turns a
+ * stale pointer into a harmless read of garbage rather than a crash.
+ *
+ * A sequential scan holds one partition lock at a time, moving through the
+ * partitions in order.  A partition cannot be resized while it is locked.
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -61,13 +73,23 @@ struct dshash_table_item
 #define DSHASH_NUM_PARTITIONS_LOG2 7
 #define DSHASH_NUM_PARTITIONS (1 << DSHASH_NUM_PARTITIONS_LOG2)
 
+/*
+ * The largest size of one partition's bucket array.  The bucket index is
+ * taken from the hash bits that follow the ones that select the partition.
+ */
+#define DSHASH_MAX_PARTITION_SIZE_LOG2 \
+	((sizeof(dshash_hash) * CHAR_BIT) - DSHASH_NUM_PARTITIONS_LOG2)
+
+/* How many times dshash_find_copy tries without a lock. */
+#define DSHASH_OPTIMISTIC_ATTEMPTS 3
+
 /* A magic value used to identify our hash tables. */
 #define DSHASH_MAGIC 0x75ff6a20
 
 /*
  * Tracking information for each lock partition.  Initially, each partition
- * corresponds to one bucket, but each time the hash table grows, the buckets
- * covered by each partition split so the number of buckets covered doubles.
+ * has one bucket, but each time the partition grows, its buckets split so
+ * the number of buckets doubles.
  *
  * We might want to add padding here so that each partition is on a different
  * cache line, but doing so would bloat this structure considerably.
@@ -75,7 +97,11 @@ struct dshash_table_item
 typedef struct dshash_partition
 {
 	LWLock		lock;			/* Protects all buckets in this partition. */
+	pg_atomic_uint32 changecount;	/* Odd while exclusively locked. */
 	size_t		count;			/* # of items in this partition's buckets */
+	size_t		size_log2;		/* log2(# of buckets in this partition) */
+	dsa_pointer buckets;		/* bucket array, if size_log2 > 0 */
+	dsa_pointer initial_bucket; /* the only bucket, if size_log2 == 0 */
 } dshash_partition;
 
 /*
@@ -88,15 +114,6 @@ typedef struct dshash_table_control
 	uint32		magic;
 	dshash_partition partitions[DSHASH_NUM_PARTITIONS];
 	int			lwlock_tranche_id;
-
-	/*
-	 * The following members are written to only when ALL partitions locks are
-	 * held.  They can be read when any one partition lock is held.
-	 */
-
-	/* Number of buckets expressed as power of 2 (8 = 256 buckets). */
-	size_t		size_log2;		/* log2(number of buckets) */
-	dsa_pointer buckets;		/* current bucket array */
 } dshash_table_control;
 
 /*
@@ -108,8 +125,9 @@ struct dshash_table
 	dshash_parameters params;	/* Parameters. */
 	void	   *arg;			/* User-supplied data pointer. */
 	dshash_table_control *control;	/* Control object in DSM. */
-	dsa_pointer *buckets;		/* Current bucket pointers in DSM. */
-	size_t		size_log2;		/* log2(number of buckets) */
+	/* Each partition's bucket array in DSM, or NULL if not looked up yet. */
+	dsa_pointer *buckets[DSHASH_NUM_PARTITIONS];
+	size_t		size_log2[DSHASH_NUM_PARTITIONS];	/* ... and its size */
 	bool		find_locked;	/* Is any partition lock held by 'find'? */
 	bool		find_exclusively_locked;	/* ... exclusively? */
 };
@@ -123,46 +141,54 @@ struct dshash_table
 	((dshash_table_item *)((char *)(entry) -							\
 							 MAXALIGN(sizeof(dshash_table_item))))
 
-/* How many resize operations (bucket splits) have there been? */
-#define NUM_SPLITS(size_log2)					\
-	(size_log2 - DSHASH_NUM_PARTITIONS_LOG2)
+/* The size of an item holding an entry. */
+#define ITEM_SIZE(hash_table) \
+	(MAXALIGN(sizeof(dshash_table_item)) + (hash_table)->params.entry_size)
 
-/* How many buckets are there in each partition at a given size? */
+/* How many buckets are there in a partition of a given size? */
 #define BUCKETS_PER_PARTITION(size_log2)		\
-	(((size_t) 1) << NUM_SPLITS(size_log2))
+	(((size_t) 1) << (size_log2))
 
 /* Max entries before we need to grow.  Half + quarter = 75% load factor. */
-#define MAX_COUNT_PER_PARTITION(hash_table)				\
-	(BUCKETS_PER_PARTITION(hash_table->size_log2) / 2 + \
-	 BUCKETS_PER_PARTITION(hash_table->size_log2) / 4)
+#define MAX_COUNT_PER_PARTITION(size_log2)			\
+	(BUCKETS_PER_PARTITION(size_log2) / 2 +			\
+	 BUCKETS_PER_PARTITION(size_log2) / 4)
 
 /* Choose partition based on the highest order bits of the hash. */
 #define PARTITION_FOR_HASH(hash)										\
 	(hash >> ((sizeof(dshash_hash) * CHAR_BIT) - DSHASH_NUM_PARTITIONS_LOG2))
 
 /*
- * Find the bucket index for a given hash and table size.  Each time the table
- * doubles in size, the appropriate bucket for a given hash value doubles and
- * possibly adds one, depending on the newly revealed bit, so that all buckets
- * are split.
+ * Find the bucket index within a partition for a given hash and partition
+ * size, using the hash bits that follow the partition bits.  Each time the
+ * partition doubles in size, the appropriate bucket for a given hash value
+ * doubles and possibly adds one, depending on the newly revealed bit, so that
+ * all buckets are split.
  */
-#define BUCKET_INDEX_FOR_HASH_AND_SIZE(hash, size_log2)		\
-	(hash >> ((sizeof(dshash_hash) * CHAR_BIT) - (size_log2)))
-
-/* The index of the first bucket in a given partition. */
-#define BUCKET_INDEX_FOR_PARTITION(partition, size_log2)	\
-	((partition) << NUM_SPLITS(size_log2))
+#define BUCKET_INDEX_FOR_HASH_AND_SIZE(hash, size_log2)					\
+	((size_log2) == 0 ? 0 :												\
+	 ((dshash_hash) ((hash) << DSHASH_NUM_PARTITIONS_LOG2)) >>			\
+	 ((sizeof(dshash_hash) * CHAR_BIT) - (size_log2)))
 
 /* The head of the active bucket for a given hash value (lvalue). */
-#define BUCKET_FOR_HASH(hash_table, hash)								\
-	(hash_table->buckets[												\
+#define BUCKET_FOR_HASH(hash_table, partition, hash)					\
+	(hash_table->buckets[partition][									\
 		BUCKET_INDEX_FOR_HASH_AND_SIZE(hash,							\
-									   hash_table->size_log2)])
+									   hash_table->size_log2[partition])])
 
 static void delete_item(dshash_table *hash_table,
 						dshash_table_item *item);
-static void resize(dshash_table *hash_table, size_t new_size);
-static inline void ensure_valid_bucket_pointers(dshash_table *hash_table);
+static void resize_partition(dshash_table *hash_table,
+							 size_t partition_index);
+static inline void lock_partition(dshash_table *hash_table,
+								  size_t partition_index, bool exclusive);
+static inline void unlock_partition(dshash_table *hash_table,
+									size_t partition_index, bool exclusive);
+static inline void ensure_valid_bucket_pointers(dshash_table *hash_table,
+												size_t partition_index);
+static bool find_copy_optimistic(dshash_table *hash_table, const void *key,
+								 dshash_hash hash, void *entry,
+								 bool *found);
 static inline dshash_table_item *find_in_bucket(dshash_table *hash_table,
 												const void *key,
 												dsa_pointer item_pointer);
@@ -219,37 +245,25 @@ dshash_create(dsa_area *area, const dshash_parameters *params, void *arg)
 		int			tranche_id = hash_table->control->lwlock_tranche_id;
 		int			i;
 
+		/*
+		 * Each partition starts out with a single bucket, which lives in the
+		 * partition itself, so no bucket arrays need to be allocated yet.
+		 */
 		for (i = 0; i < DSHASH_NUM_PARTITIONS; ++i)
 		{
 			LWLockInitialize(&partitions[i].lock, tranche_id);
+			pg_atomic_init_u32(&partitions[i].changecount, 0);
 			partitions[i].count = 0;
+			partitions[i].size_log2 = 0;
+			partitions[i].buckets = InvalidDsaPointer;
+			partitions[i].initial_bucket = InvalidDsaPointer;
 		}
 	}
 
 	hash_table->find_locked = false;
 	hash_table->find_exclusively_locked = false;
-
-	/*
-	 * Set up the initial array of buckets.  Our initial size is the same as
-	 * the number of partitions.
-	 */
-	hash_table->control->size_log2 = DSHASH_NUM_PARTITIONS_LOG2;
-	hash_table->control->buckets =
-		dsa_allocate_extended(area,
-							  sizeof(dsa_pointer) * DSHASH_NUM_PARTITIONS,
-							  DSA_ALLOC_NO_OOM | DSA_ALLOC_ZERO);
-	if (!DsaPointerIsValid(hash_table->control->buckets))
-	{
-		dsa_free(area, control);
-		ereport(ERROR,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("out of memory"),
-				 errdetail("Failed on DSA request of size %zu.",
-						   sizeof(dsa_pointer) * DSHASH_NUM_PARTITIONS)));
-	}
-	hash_table->buckets = dsa_get_address(area,
-										  hash_table->control->buckets);
-	hash_table->size_log2 = hash_table->control->size_log2;
+	memset(hash_table->buckets, 0, sizeof(hash_table->buckets));
+	memset(hash_table->size_log2, 0, sizeof(hash_table->size_log2));
 
 	return hash_table;
 }
@@ -286,8 +300,8 @@ dshash_attach(dsa_area *area, const dshash_parameters *params,
 	 * ensure_valid_bucket_pointers(), at which time we'll be holding a
 	 * partition lock for interlocking against concurrent resizing.
 	 */
-	hash_table->buckets = NULL;
-	hash_table->size_log2 = 0;
+	memset(hash_table->buckets, 0, sizeof(hash_table->buckets));
+	memset(hash_table->size_log2, 0, sizeof(hash_table->size_log2));
 
 	return hash_table;
 }
@@ -318,27 +332,37 @@ void
 dshash_destroy(dshash_table *hash_table)
 {
 	size_t		size;
+	size_t		p;
 	size_t		i;
 
 	Assert(hash_table->control->magic == DSHASH_MAGIC);
-	ensure_valid_bucket_pointers(hash_table);
 
-	/* Free all the entries. */
-	size = ((size_t) 1) << hash_table->size_log2;
-	for (i = 0; i < size; ++i)
+	/* Free all the entries and bucket arrays. */
+	for (p = 0; p < DSHASH_NUM_PARTITIONS; ++p)
 	{
-		dsa_pointer item_pointer = hash_table->buckets[i];
+		dshash_partition *partition = &hash_table->control->partitions[p];
 
-		while (DsaPointerIsValid(item_pointer))
+		ensure_valid_bucket_pointers(hash_table, p);
+
+		size = BUCKETS_PER_PARTITION(hash_table->size_log2[p]);
+		for (i = 0; i < size; ++i)
 		{
-			dshash_table_item *item;
-			dsa_pointer next_item_pointer;
+			dsa_pointer item_pointer = hash_table->buckets[p][i];
 
-			item = dsa_get_address(hash_table->area, item_pointer);
-			next_item_pointer = item->next;
-			dsa_free(hash_table->area, item_pointer);
-			item_pointer = next_item_pointer;
+			while (DsaPointerIsValid(item_pointer))
+			{
+				dshash_table_item *item;
+				dsa_pointer next_item_pointer;
+
+				item = dsa_get_address(hash_table->area, item_pointer);
+				next_item_pointer = item->next;
+				dsa_free(hash_table->area, item_pointer);
+				item_pointer = next_item_pointer;
+			}
 		}
+
+		if (partition->size_log2 > 0)
+			dsa_free(hash_table->area, partition->buckets);
 	}
 
 	/*
@@ -347,8 +371,7 @@ dshash_destroy(dshash_table *hash_table)
 	 */
 	hash_table->control->magic = 0;
 
-	/* Free the active table and control object. */
-	dsa_free(hash_table->area, hash_table->control->buckets);
+	/* Free the control object. */
 	dsa_free(hash_table->area, hash_table->control->handle);
 
 	pfree(hash_table);
@@ -394,17 +417,17 @@ dshash_find(dshash_table *hash_table, const void *key, bool exclusive)
 	Assert(hash_table->control->magic == DSHASH_MAGIC);
 	Assert(!hash_table->find_locked);
 
-	LWLockAcquire(PARTITION_LOCK(hash_table, partition),
-				  exclusive ? LW_EXCLUSIVE : LW_SHARED);
-	ensure_valid_bucket_pointers(hash_table);
+	lock_partition(hash_table, partition, exclusive);
+	ensure_valid_bucket_pointers(hash_table, partition);
 
 	/* Search the active bucket. */
-	item = find_in_bucket(hash_table, key, BUCKET_FOR_HASH(hash_table, hash));
+	item = find_in_bucket(hash_table, key,
+						  BUCKET_FOR_HASH(hash_table, partition, hash));
 
 	if (!item)
 	{
 		/* Not found. */
-		LWLockRelease(PARTITION_LOCK(hash_table, partition));
+		unlock_partition(hash_table, partition, exclusive);
 		return NULL;
 	}
 	else
@@ -416,6 +439,61 @@ dshash_find(dshash_table *hash_table, const void *key, bool exclusive)
 	}
 }
 
+/*
+ * Look up an entry, given a key, and copy it into the caller-supplied space
+ * 'entry', which must be big enough to hold params.entry_size bytes.  Returns
+ * true if the key was found.  If it wasn't, the contents of 'entry' are
+ * undefined.
+ *
+ * Unlike dshash_find, this normally doesn't acquire any lock: the partition
+ * is searched optimistically, and the search is retried if a concurrent
+ * writer may have interfered, before falling back to a shared lock.  The copy
+ * reflects the entry as it was at some moment while no exclusive lock was
+ * held on it, so it is consistent with changes made by dshash_find callers
+ * that modified it in place.
+ *
+ * Since the optimistic search may compare 'key' against bytes from memory
+ * that was concurrently freed and reused, this must only be used with tables
+ * whose compare function only looks at the key's bytes, as dshash_memcmp
+ * does; it must not follow pointers stored in the key.
+ *
+ * The caller must not hold a lock already.
+ */
+bool
+dshash_find_copy(dshash_table *hash_table, const void *key, void *entry)
+{
+	dshash_hash hash;
+	size_t		partition;
+	dshash_table_item *item;
+	bool		found;
+	int			attempt;
+
+	hash = hash_key(hash_table, key);
+	partition = PARTITION_FOR_HASH(hash);
+
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(!hash_table->find_locked);
+
+	for (attempt = 0; attempt < DSHASH_OPTIMISTIC_ATTEMPTS; attempt++)
+	{
+		if (find_copy_optimistic(hash_table, key, hash, entry, &found))
+			return found;
+	}
+
+	/* Too much concurrent activity; do it the slow way. */
+	lock_partition(hash_table, partition, false);
+	ensure_valid_bucket_pointers(hash_table, partition);
+
+	item = find_in_bucket(hash_table, key,
+						  BUCKET_FOR_HASH(hash_table, partition, hash));
+	if (item)
+		memcpy(entry, ENTRY_FROM_ITEM(item), hash_table->params.entry_size);
+
+	unlock_partition(hash_table, partition, false);
+
+	return item != NULL;
+}
+
 /*
  * Returns a pointer to an exclusively locked item which must be released with
  * dshash_release_lock.  If the key is found in the hash table, 'found' is set
@@ -443,13 +521,12 @@ dshash_find_or_insert(dshash_table *hash_table,
 	Assert(hash_table->control->magic == DSHASH_MAGIC);
 	Assert(!hash_table->find_locked);
 
-restart:
-	LWLockAcquire(PARTITION_LOCK(hash_table, partition_index),
-				  LW_EXCLUSIVE);
-	ensure_valid_bucket_pointers(hash_table);
+	lock_partition(hash_table, partition_index, true);
+	ensure_valid_bucket_pointers(hash_table, partition_index);
 
 	/* Search the active bucket. */
-	item = find_in_bucket(hash_table, key, BUCKET_FOR_HASH(hash_table, hash));
+	item = find_in_bucket(hash_table, key,
+						  BUCKET_FOR_HASH(hash_table, partition_index, hash));
 
 	if (item)
 		*found = true;
@@ -457,29 +534,20 @@ restart:
 	{
 		*found = false;
 
-		/* Check if we are getting too full. */
-		if (partition->count > MAX_COUNT_PER_PARTITION(hash_table))
-		{
-			/*
-			 * The load factor (= keys / buckets) for all buckets protected by
-			 * this partition is > 0.75.  Presumably the same applies
-			 * generally across the whole hash table (though we don't attempt
-			 * to track that directly to avoid contention on some kind of
-			 * central counter; we just assume that this partition is
-			 * representative).  This is a good time to resize.
-			 *
-			 * Give up our existing lock first, because resizing needs to
-			 * reacquire all the locks in the right order to avoid deadlocks.
-			 */
-			LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
-			resize(hash_table, hash_table->size_log2 + 1);
-
-			goto restart;
-		}
+		/*
+		 * Check if we are getting too full.  If the load factor (= keys /
+		 * buckets) for the buckets of this partition is > 0.75, this is a
+		 * good time to grow it.  Other partitions are left alone; they grow
+		 * when they fill up themselves.
+		 */
+		if (partition->count > MAX_COUNT_PER_PARTITION(partition->size_log2) &&
+			partition->size_log2 < DSHASH_MAX_PARTITION_SIZE_LOG2)
+			resize_partition(hash_table, partition_index);
 
 		/* Finally we can try to insert the new item. */
 		item = insert_into_bucket(hash_table, key,
-								  &BUCKET_FOR_HASH(hash_table, hash));
+								  &BUCKET_FOR_HASH(hash_table, partition_index,
+												   hash));
 		item->hash = hash;
 		/* Adjust per-lock-partition counter for load factor knowledge. */
 		++partition->count;
@@ -511,11 +579,11 @@ dshash_delete_key(dshash_table *hash_table, const void *key)
 	hash = hash_key(hash_table, key);
 	partition = PARTITION_FOR_HASH(hash);
 
-	LWLockAcquire(PARTITION_LOCK(hash_table, partition), LW_EXCLUSIVE);
-	ensure_valid_bucket_pointers(hash_table);
+	lock_partition(hash_table, partition, true);
+	ensure_valid_bucket_pointers(hash_table, partition);
 
 	if (delete_key_from_bucket(hash_table, key,
-							   &BUCKET_FOR_HASH(hash_table, hash)))
+							   &BUCKET_FOR_HASH(hash_table, partition, hash)))
 	{
 		Assert(hash_table->control->partitions[partition].count > 0);
 		found = true;
@@ -524,7 +592,7 @@ dshash_delete_key(dshash_table *hash_table, const void *key)
 	else
 		found = false;
 
-	LWLockRelease(PARTITION_LOCK(hash_table, partition));
+	unlock_partition(hash_table, partition, true);
 
 	return found;
 }
@@ -551,7 +619,7 @@ dshash_delete_entry(dshash_table *hash_table, void *entry)
 	delete_item(hash_table, item);
 	hash_table->find_locked = false;
 	hash_table->find_exclusively_locked = false;
-	LWLockRelease(PARTITION_LOCK(hash_table, partition));
+	unlock_partition(hash_table, partition, true);
 }
 
 /*
@@ -562,16 +630,148 @@ dshash_release_lock(dshash_table *hash_table, void *entry)
 {
 	dshash_table_item *item = ITEM_FROM_ENTRY(entry);
 	size_t		partition_index = PARTITION_FOR_HASH(item->hash);
+	bool		exclusive = hash_table->find_exclusively_locked;
 
 	Assert(hash_table->control->magic == DSHASH_MAGIC);
 	Assert(hash_table->find_locked);
 	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table, partition_index),
-								hash_table->find_exclusively_locked
-								? LW_EXCLUSIVE : LW_SHARED));
+								exclusive ? LW_EXCLUSIVE : LW_SHARED));
 
 	hash_table->find_locked = false;
 	hash_table->find_exclusively_locked = false;
-	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
+	unlock_partition(hash_table, partition_index, exclusive);
+}
+
+/*
+ * Begin a sequential scan over all entries of the hash table.  The entries
+ * are returned by dshash_seq_next in no particular order.  If 'exclusive' is
+ * true, the partition locks are taken in exclusive mode, which allows the
+ * caller to modify or delete (with dshash_delete_current) the returned
+ * entries.
+ *
+ * The caller must not hold any lock on the hash table, and must not call
+ * dshash_find, dshash_find_or_insert or dshash_delete_key on it until the
+ * scan has been finished with dshash_seq_term.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	status->hash_table = hash_table;
+	status->curbucket = 0;
+	status->nbuckets = 0;
+	status->curitem = NULL;
+	status->pnextitem = InvalidDsaPointer;
+	status->curpartition = -1;
+	status->exclusive = exclusive;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL once all entries have
+ * been returned.  The entry's partition is locked; the lock is released when
+ * the scan moves to another partition or is terminated.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dsa_pointer next_item_pointer;
+
+	if (status->curpartition == -1)
+	{
+		/* First call.  Lock partition 0. */
+		Assert(hash_table->control->magic == DSHASH_MAGIC);
+		Assert(!hash_table->find_locked);
+
+		status->curpartition = 0;
+		lock_partition(hash_table, 0, status->exclusive);
+		hash_table->find_locked = true;
+		hash_table->find_exclusively_locked = status->exclusive;
+
+		ensure_valid_bucket_pointers(hash_table, 0);
+		status->curbucket = 0;
+		status->nbuckets = BUCKETS_PER_PARTITION(hash_table->size_log2[0]);
+		next_item_pointer = hash_table->buckets[0][0];
+	}
+	else
+		next_item_pointer = status->pnextitem;
+
+	/* Advance to the next non-empty bucket, if needed. */
+	while (!DsaPointerIsValid(next_item_pointer))
+	{
+		int			next_partition;
+
+		if (++status->curbucket < status->nbuckets)
+		{
+			next_item_pointer =
+				hash_table->buckets[status->curpartition][status->curbucket];
+			continue;
+		}
+
+		/* Keep the last lock until dshash_seq_term. */
+		next_partition = status->curpartition + 1;
+		if (next_partition >= DSHASH_NUM_PARTITIONS)
+			return NULL;
+
+		/*
+		 * Move on to the next partition.  Its buckets can't be resized while
+		 * we hold its lock, and entries never move between partitions, so
+		 * there is no need to keep holding the current lock meanwhile.
+		 */
+		unlock_partition(hash_table, status->curpartition, status->exclusive);
+		lock_partition(hash_table, next_partition, status->exclusive);
+		status->curpartition = next_partition;
+
+		ensure_valid_bucket_pointers(hash_table, next_partition);
+		status->curbucket = 0;
+		status->nbuckets =
+			BUCKETS_PER_PARTITION(hash_table->size_log2[next_partition]);
+		next_item_pointer = hash_table->buckets[next_partition][0];
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, next_item_pointer);
+
+	/* Remember the successor, in case the caller deletes the current item */
+	status->pnextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * Finish a sequential scan, releasing the lock still held, if any.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+
+	if (status->curpartition >= 0)
+	{
+		hash_table->find_locked = false;
+		hash_table->find_exclusively_locked = false;
+		unlock_partition(hash_table, status->curpartition, status->exclusive);
+		status->curpartition = -1;
+	}
+}
+
+/*
+ * Delete the entry most recently returned by dshash_seq_next.  The scan must
+ * have been started in exclusive mode.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dshash_table_item *item = status->curitem;
+
+	Assert(status->exclusive);
+	Assert(item != NULL);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   PARTITION_FOR_HASH(item->hash)),
+								LW_EXCLUSIVE));
+
+	delete_item(hash_table, item);
+	status->curitem = NULL;
 }
 
 /*
@@ -611,24 +811,22 @@ dshash_dump(dshash_table *hash_table)
 		LWLockAcquire(PARTITION_LOCK(hash_table, i), LW_SHARED);
 	}
 
-	ensure_valid_bucket_pointers(hash_table);
-
-	fprintf(stderr,
-			"hash table size = %zu\n", (size_t) 1 << hash_table->size_log2);
 	for (i = 0; i < DSHASH_NUM_PARTITIONS; ++i)
 	{
 		dshash_partition *partition = &hash_table->control->partitions[i];
-		size_t		begin = BUCKET_INDEX_FOR_PARTITION(i, hash_table->size_log2);
-		size_t		end = BUCKET_INDEX_FOR_PARTITION(i + 1, hash_table->size_log2);
+		size_t		nbuckets;
+
+		ensure_valid_bucket_pointers(hash_table, i);
+		nbuckets = BUCKETS_PER_PARTITION(hash_table->size_log2[i]);
 
-		fprintf(stderr, "  partition %zu\n", i);
+		fprintf(stderr, "  partition %zu (bucket count = %zu)\n", i, nbuckets);
 		fprintf(stderr,
 				"    active buckets (key count = %zu)\n", partition->count);
 
-		for (j = begin; j < end; ++j)
+		for (j = 0; j < nbuckets; ++j)
 		{
 			size_t		count = 0;
-			dsa_pointer bucket = hash_table->buckets[j];
+			dsa_pointer bucket = hash_table->buckets[i][j];
 
 			while (DsaPointerIsValid(bucket))
 			{
@@ -659,7 +857,7 @@ delete_item(dshash_table *hash_table, dshash_table_item *item)
 	Assert(LWLockHeldByMe(PARTITION_LOCK(hash_table, partition)));
 
 	if (delete_item_from_bucket(hash_table, item,
-								&BUCKET_FOR_HASH(hash_table, hash)))
+								&BUCKET_FOR_HASH(hash_table, partition, hash)))
 	{
 		Assert(hash_table->control->partitions[partition].count > 0);
 		--hash_table->control->partitions[partition].count;
@@ -671,56 +869,45 @@ delete_item(dshash_table *hash_table, dshash_table_item *item)
 }
 
 /*
- * Grow the hash table if necessary to the requested number of buckets.  The
- * requested size must be double some previously observed size.
+ * Double the number of buckets of a partition.  The caller must hold the
+ * partition's lock exclusively and have made sure that our bucket pointers
+ * for it are valid.
  *
- * Must be called without any partition lock held.
+ * Only this partition's entries are moved, so the other partitions remain
+ * available to other backends meanwhile.
  */
 static void
-resize(dshash_table *hash_table, size_t new_size_log2)
+resize_partition(dshash_table *hash_table, size_t partition_index)
 {
-	dsa_pointer old_buckets;
+	dshash_partition *partition =
+	&hash_table->control->partitions[partition_index];
+	size_t		old_size_log2 = partition->size_log2;
+	size_t		new_size_log2 = old_size_log2 + 1;
+	dsa_pointer old_buckets = partition->buckets;
 	dsa_pointer new_buckets_shared;
 	dsa_pointer *new_buckets;
 	size_t		size;
-	size_t		new_size = ((size_t) 1) << new_size_log2;
 	size_t		i;
 
-	/*
-	 * Acquire the locks for all lock partitions.  This is expensive, but we
-	 * shouldn't have to do it many times.
-	 */
-	for (i = 0; i < DSHASH_NUM_PARTITIONS; ++i)
-	{
-		Assert(!LWLockHeldByMe(PARTITION_LOCK(hash_table, i)));
-
-		LWLockAcquire(PARTITION_LOCK(hash_table, i), LW_EXCLUSIVE);
-		if (i == 0 && hash_table->control->size_log2 >= new_size_log2)
-		{
-			/*
-			 * Another backend has already increased the size; we can avoid
-			 * obtaining all the locks and return early.
-			 */
-			LWLockRelease(PARTITION_LOCK(hash_table, 0));
-			return;
-		}
-	}
-
-	Assert(new_size_log2 == hash_table->control->size_log2 + 1);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table, partition_index),
+								LW_EXCLUSIVE));
+	Assert(hash_table->size_log2[partition_index] == old_size_log2);
+	Assert(new_size_log2 <= DSHASH_MAX_PARTITION_SIZE_LOG2);
 
-	/* Allocate the space for the new table. */
-	new_buckets_shared = dsa_allocate0(hash_table->area,
-									   sizeof(dsa_pointer) * new_size);
+	/* Allocate the space for the new bucket array. */
+	new_buckets_shared =
+		dsa_allocate0(hash_table->area,
+					  sizeof(dsa_pointer) * BUCKETS_PER_PARTITION(new_size_log2));
 	new_buckets = dsa_get_address(hash_table->area, new_buckets_shared);
 
 	/*
 	 * We've allocated the new bucket array; all that remains to do now is to
-	 * reinsert all items, which amounts to adjusting all the pointers.
+	 * reinsert the partition's items, which amounts to adjusting pointers.
 	 */
-	size = ((size_t) 1) << hash_table->control->size_log2;
+	size = BUCKETS_PER_PARTITION(old_size_log2);
 	for (i = 0; i < size; ++i)
 	{
-		dsa_pointer item_pointer = hash_table->buckets[i];
+		dsa_pointer item_pointer = hash_table->buckets[partition_index][i];
 
 		while (DsaPointerIsValid(item_pointer))
 		{
@@ -736,32 +923,157 @@ resize(dshash_table *hash_table, size_t new_size_log2)
 		}
 	}
 
-	/* Swap the hash table into place and free the old one. */
-	old_buckets = hash_table->control->buckets;
-	hash_table->control->buckets = new_buckets_shared;
-	hash_table->control->size_log2 = new_size_log2;
-	hash_table->buckets = new_buckets;
-	dsa_free(hash_table->area, old_buckets);
+	/* Swap the new bucket array into place and free the old one. */
+	partition->buckets = new_buckets_shared;
+	partition->size_log2 = new_size_log2;
+	partition->initial_bucket = InvalidDsaPointer;
+	hash_table->buckets[partition_index] = new_buckets;
+	hash_table->size_log2[partition_index] = new_size_log2;
+	if (old_size_log2 > 0)
+		dsa_free(hash_table->area, old_buckets);
+}
 
-	/* Release all the locks. */
-	for (i = 0; i < DSHASH_NUM_PARTITIONS; ++i)
-		LWLockRelease(PARTITION_LOCK(hash_table, i));
+/*
+ * Acquire a partition lock.  While a partition is locked exclusively, its
+ * change counter is odd, which tells optimistic readers that they can't trust
+ * what they see.
+ */
+static inline void
+lock_partition(dshash_table *hash_table, size_t partition_index,
+			   bool exclusive)
+{
+	LWLockAcquire(PARTITION_LOCK(hash_table, partition_index),
+				  exclusive ? LW_EXCLUSIVE : LW_SHARED);
+
+	if (exclusive)
+	{
+		pg_atomic_uint32 *changecount =
+		&hash_table->control->partitions[partition_index].changecount;
+		uint32		value = pg_atomic_read_u32(changecount);
+
+		/*
+		 * The counter is already odd if a previous holder of the lock errored
+		 * out before unlock_partition, perhaps in the middle of a change.
+		 * Leave it that way; our unlock_partition will make it even.
+		 */
+		if ((value & 1) == 0)
+			pg_atomic_write_u32(changecount, value + 1);
+		pg_write_barrier();
+	}
 }
 
 /*
- * Make sure that our backend-local bucket pointers are up to date.  The
- * caller must have locked one lock partition, which prevents resize() from
- * running concurrently.
+ * Release a partition lock acquired with lock_partition.
  */
 static inline void
-ensure_valid_bucket_pointers(dshash_table *hash_table)
+unlock_partition(dshash_table *hash_table, size_t partition_index,
+				 bool exclusive)
+{
+	if (exclusive)
+	{
+		pg_atomic_uint32 *changecount =
+		&hash_table->control->partitions[partition_index].changecount;
+
+		pg_write_barrier();
+		pg_atomic_write_u32(changecount, pg_atomic_read_u32(changecount) + 1);
+	}
+
+	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
+}
+
+/*
+ * Make sure that our backend-local bucket pointers for a partition are up to
+ * date.  The caller must have locked the partition, which prevents it from
+ * being resized concurrently.
+ */
+static inline void
+ensure_valid_bucket_pointers(dshash_table *hash_table, size_t partition_index)
+{
+	dshash_partition *partition =
+	&hash_table->control->partitions[partition_index];
+
+	if (hash_table->buckets[partition_index] == NULL ||
+		hash_table->size_log2[partition_index] != partition->size_log2)
+	{
+		if (partition->size_log2 == 0)
+			hash_table->buckets[partition_index] = &partition->initial_bucket;
+		else
+			hash_table->buckets[partition_index] =
+				dsa_get_address(hash_table->area, partition->buckets);
+		hash_table->size_log2[partition_index] = partition->size_log2;
+	}
+}
+
+/*
+ * Search for a key without holding the partition lock, and copy the entry
+ * into 'entry' if found.  Returns false if a concurrent change may have
+ * interfered, in which case the caller should try again; otherwise sets
+ * *found.
+ *
+ * Everything we read here may be concurrently changed or freed, so we don't
+ * use our cached bucket pointers, which are only valid under the lock, and
+ * translate every dsa_pointer with dsa_get_address_if_mapped: if we follow a
+ * stale pointer, we'll read garbage from memory that is still mapped, and the
+ * change counter will tell us to discard the result.  The item count bounds
+ * the walk in case the garbage forms a cycle.
+ */
+static bool
+find_copy_optimistic(dshash_table *hash_table, const void *key,
+					 dshash_hash hash, void *entry, bool *found)
 {
-	if (hash_table->size_log2 != hash_table->control->size_log2)
+	volatile dshash_partition *partition =
+	&hash_table->control->partitions[PARTITION_FOR_HASH(hash)];
+	size_t		item_size = ITEM_SIZE(hash_table);
+	uint32		changecount;
+	size_t		size_log2;
+	size_t		count;
+	dsa_pointer item_pointer;
+
+	changecount = pg_atomic_read_u32(&partition->changecount);
+	if (changecount & 1)
+		return false;			/* a writer is active */
+	pg_read_barrier();
+
+	size_log2 = partition->size_log2;
+	count = partition->count;
+	if (size_log2 == 0)
+		item_pointer = partition->initial_bucket;
+	else
+	{
+		volatile dsa_pointer *buckets;
+
+		if (size_log2 > DSHASH_MAX_PARTITION_SIZE_LOG2)
+			return false;
+		buckets = dsa_get_address_if_mapped(hash_table->area,
+											partition->buckets,
+											sizeof(dsa_pointer) *
+											BUCKETS_PER_PARTITION(size_log2));
+		if (buckets == NULL)
+			return false;
+		item_pointer = buckets[BUCKET_INDEX_FOR_HASH_AND_SIZE(hash, size_log2)];
+	}
+
+	*found = false;
+	while (DsaPointerIsValid(item_pointer))
 	{
-		hash_table->buckets = dsa_get_address(hash_table->area,
-											  hash_table->control->buckets);
-		hash_table->size_log2 = hash_table->control->size_log2;
+		volatile dshash_table_item *item;
+
+		item = dsa_get_address_if_mapped(hash_table->area, item_pointer,
+										 item_size);
+		if (item == NULL || count-- == 0)
+			return false;
+		if (item->hash == hash &&
+			equal_keys(hash_table, key, ENTRY_FROM_ITEM(item)))
+		{
+			memcpy(entry, ENTRY_FROM_ITEM(item), hash_table->params.entry_size);
+			*found = true;
+			break;
+		}
+		item_pointer = item->next;
 	}
+
+	pg_read_barrier();
+	return pg_atomic_read_u32(&partition->changecount) == changecount;
 }
 
 /*
@@ -395,6 +395,18 @@ ClientAuthentication(Port *port)
 
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * A connection proxy relays the client over a socket of its own, so
+	 * methods that identify the client by its socket would identify the
+	 * proxy instead.
+	 */
+	if (port->proxied &&
+		(port->hba->auth_method == uaPeer || port->hba->auth_method == uaIdent))
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_AUTHORIZATION_SPECIFICATION),
+				 errmsg("%s authentication is not supported for connections through a connection proxy",
+						port->hba->auth_method == uaPeer ? "peer" : "ident")));
+
 	/*
 	 * This is the first point where we have access to the hba record for the
 	 * current connection, so perform any verifications based on the hba
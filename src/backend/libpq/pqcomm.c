@@ -76,12 +76,15 @@
 #endif
 
 #include "common/ip.h"
+#include "common/zpq_stream.h"
 #include "libpq/libpq.h"
+#include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
+#include "utils/varlena.h"
 
 /*
  * Cope with the various platform-specific ways to spell TCP keepalive socket
@@ -107,6 +110,7 @@
  */
 int			Unix_socket_permissions;
 char	   *Unix_socket_group;
+int			protocol_compression_methods = 0;	/* bitmask of ZpqAlgorithms */
 
 /* Where the Unix socket files are (list of palloc'd strings) */
 static List *sock_paths = NIL;
@@ -130,6 +134,12 @@ static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+/*
+ * Protocol compression state, if negotiated.  The buffers above then hold
+ * uncompressed data; the stream keeps the compressed data in transit.
+ */
+static ZpqStream *PqCompressStream = NULL;
+
 /*
  * Message status
  */
@@ -148,6 +158,7 @@ static int	socket_putmessage(char msgtype, const char *s, size_t len);
 static void socket_putmessage_noblock(char msgtype, const char *s, size_t len);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static ssize_t internal_recv(char *buf, size_t len);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(const char *unixSocketDir, const char *unixSocketPath);
@@ -954,8 +965,8 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		r = internal_recv(PqRecvBuffer + PqRecvLength,
+						  PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
 		if (r < 0)
 		{
@@ -986,6 +997,50 @@ pq_recvbuf(void)
 	}
 }
 
+/* --------------------------------
+ *		internal_recv - read data from the connection, decompressing it if
+ *			protocol compression is in use
+ *
+ * Returns the same as secure_read().  A decompression failure is reported
+ * here and returned as EOF.
+ * --------------------------------
+ */
+static ssize_t
+internal_recv(char *buf, size_t len)
+{
+	if (PqCompressStream == NULL)
+		return secure_read(MyProcPort, buf, len);
+
+	for (;;)
+	{
+		ssize_t		r;
+		char	   *raw;
+		size_t		avail;
+
+		/* Return already received data first */
+		if (zpq_input_pending(PqCompressStream))
+		{
+			r = zpq_decompress(PqCompressStream, buf, len);
+			if (r < 0)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("could not decompress data from client: %s",
+								zpq_error(PqCompressStream))));
+				return 0;
+			}
+			if (r > 0)
+				return r;
+		}
+
+		raw = zpq_input_space(PqCompressStream, 0, &avail);
+		r = secure_read(MyProcPort, raw, avail);
+		if (r <= 0)
+			return r;
+		zpq_input_done(PqCompressStream, r);
+	}
+}
+
 /* --------------------------------
  *		pq_getbyte	- get a single byte from connection, or return EOF
  * --------------------------------
@@ -1046,7 +1101,23 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	socket_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
+	if (PqCompressStream)
+	{
+		/*
+		 * Decompress as much as fits into the empty buffer, so that we don't
+		 * leave decompressed data behind that the caller won't wait for.
+		 */
+		PqRecvPointer = PqRecvLength = 0;
+		r = internal_recv(PqRecvBuffer, PQ_RECV_BUFFER_SIZE);
+		if (r > 0)
+		{
+			PqRecvLength = r;
+			*c = PqRecvBuffer[PqRecvPointer++];
+			r = 1;
+		}
+	}
+	else
+		r = secure_read(MyProcPort, c, 1);
 	if (r < 0)
 	{
 		/*
@@ -1345,6 +1416,34 @@ internal_flush(void)
 	char	   *bufptr = PqSendBuffer + PqSendStart;
 	char	   *bufend = PqSendBuffer + PqSendPointer;
 
+	/*
+	 * With protocol compression, compress whatever is in the send buffer and
+	 * send the compressed data instead.  Compressed data that can't be sent
+	 * right away stays in the stream, so the send buffer is empty afterwards
+	 * either way.
+	 */
+	if (PqCompressStream)
+	{
+		size_t		len;
+
+		if (bufptr < bufend &&
+			zpq_compress(PqCompressStream, bufptr, bufend - bufptr) < 0)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("could not compress data to client: %s",
+							zpq_error(PqCompressStream))));
+			PqSendStart = PqSendPointer = 0;
+			ClientConnectionLost = 1;
+			InterruptPending = 1;
+			return EOF;
+		}
+		PqSendStart = PqSendPointer = 0;
+
+		bufptr = zpq_output(PqCompressStream, &len);
+		bufend = bufptr + len;
+	}
+
 	while (bufptr < bufend)
 	{
 		int			r;
@@ -1390,6 +1489,8 @@ internal_flush(void)
 			 * the connection.
 			 */
 			PqSendStart = PqSendPointer = 0;
+			if (PqCompressStream)
+				zpq_output_done(PqCompressStream, bufend - bufptr);
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1397,7 +1498,10 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		if (PqCompressStream)
+			zpq_output_done(PqCompressStream, r);
+		else
+			PqSendStart += r;
 	}
 
 	PqSendStart = PqSendPointer = 0;
@@ -1416,7 +1520,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!socket_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1439,7 +1543,98 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
-	return (PqSendStart < PqSendPointer);
+	return (PqSendStart < PqSendPointer ||
+			(PqCompressStream && zpq_output_pending(PqCompressStream)));
+}
+
+/* --------------------------------
+ *		pq_start_compression - negotiate protocol compression
+ *
+ * Called once the startup packet has been processed.  If the client asked
+ * for compression with one of the methods allowed by protocol_compression,
+ * tell it which one we picked with a CompressionAck message, and compress
+ * all further traffic in both directions.  The client sends nothing after
+ * the startup packet until it has heard from us, so everything we receive
+ * from now on is compressed, too.
+ * --------------------------------
+ */
+void
+pq_start_compression(Port *port)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	ZpqAlgorithm algorithm = ZPQ_NONE;
+	ZpqStream  *zs;
+	MemoryContext oldcontext;
+	StringInfoData buf;
+
+	/*
+	 * Connection proxies look at the messages they relay, so they'd have to
+	 * decompress them; don't bother.
+	 */
+	if (port->compression == NULL || port->proxied ||
+		protocol_compression_methods == 0)
+		return;
+
+	/*
+	 * Pick the first of the client's methods that we allow.  Ignore names
+	 * we don't know; they might be supported by newer servers.
+	 */
+	rawstring = pstrdup(port->compression);
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+		elemlist = NIL;
+	foreach(l, elemlist)
+	{
+		ZpqAlgorithm a;
+
+		if (zpq_parse_algorithm((char *) lfirst(l), &a) &&
+			(protocol_compression_methods & (1 << a)) != 0)
+		{
+			algorithm = a;
+			break;
+		}
+	}
+	pfree(rawstring);
+	list_free(elemlist);
+
+	if (algorithm == ZPQ_NONE)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	zs = zpq_create(algorithm);
+	MemoryContextSwitchTo(oldcontext);
+	if (zs == NULL)
+	{
+		ereport(LOG,
+				(errmsg("could not initialize protocol compression method \"%s\"",
+						zpq_algorithm_name(algorithm))));
+		return;
+	}
+
+	/* Announce the method; this message itself is not compressed */
+	pq_beginmessage(&buf, 'z');
+	pq_sendstring(&buf, zpq_algorithm_name(algorithm));
+	pq_endmessage(&buf);
+	pq_flush();
+
+	/* Anything already received belongs to the compressed stream */
+	if (PqRecvPointer < PqRecvLength)
+	{
+		size_t		len = PqRecvLength - PqRecvPointer;
+		size_t		avail;
+
+		memcpy(zpq_input_space(zs, len, &avail),
+			   PqRecvBuffer + PqRecvPointer, len);
+		zpq_input_done(zs, len);
+	}
+	PqRecvPointer = PqRecvLength = 0;
+
+	PqCompressStream = zs;
+
+	ereport(DEBUG1,
+			(errmsg_internal("using protocol compression method \"%s\"",
+							 zpq_algorithm_name(algorithm))));
 }
 
 /* --------------------------------
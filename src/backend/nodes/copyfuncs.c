@@ -407,6 +407,30 @@ _copyGatherMerge(const GatherMerge *from)
 	return newnode;
 }
 
+/*
+ * _copyRedistribute
+ */
+static Redistribute *
+_copyRedistribute(const Redistribute *from)
+{
+	Redistribute *newnode = makeNode(Redistribute);
+
+	/*
+	 * copy node superclass fields
+	 */
+	CopyPlanFields((const Plan *) from, (Plan *) newnode);
+
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(numCols);
+	COPY_POINTER_FIELD(hashColIdx, from->numCols * sizeof(AttrNumber));
+	COPY_POINTER_FIELD(hashOperators, from->numCols * sizeof(Oid));
+	COPY_POINTER_FIELD(hashCollations, from->numCols * sizeof(Oid));
+
+	return newnode;
+}
+
 /*
  * CopyScanFields
  *
@@ -1153,6 +1177,11 @@ _copyHash(const Hash *from)
 	COPY_SCALAR_FIELD(skewColumn);
 	COPY_SCALAR_FIELD(skewInherit);
 	COPY_SCALAR_FIELD(rows_total);
+	COPY_NODE_FIELD(filterKeys);
+	COPY_NODE_FIELD(filterSortOps);
+	COPY_NODE_FIELD(filterCollations);
+	COPY_NODE_FIELD(filterMinParams);
+	COPY_NODE_FIELD(filterMaxParams);
 
 	return newnode;
 }
@@ -1422,6 +1451,7 @@ _copyIntoClause(const IntoClause *from)
 	COPY_SCALAR_FIELD(onCommit);
 	COPY_STRING_FIELD(tableSpaceName);
 	COPY_NODE_FIELD(viewQuery);
+	COPY_SCALAR_FIELD(incremental);
 	COPY_SCALAR_FIELD(skipData);
 
 	return newnode;
@@ -5042,6 +5072,9 @@ copyObjectImpl(const void *from)
 		case T_GatherMerge:
 			retval = _copyGatherMerge(from);
 			break;
+		case T_Redistribute:
+			retval = _copyRedistribute(from);
+			break;
 		case T_SeqScan:
 			retval = _copySeqScan(from);
 			break;
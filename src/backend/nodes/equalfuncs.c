@@ -154,6 +154,7 @@ _equalIntoClause(const IntoClause *a, const IntoClause *b)
 	COMPARE_SCALAR_FIELD(onCommit);
 	COMPARE_STRING_FIELD(tableSpaceName);
 	COMPARE_NODE_FIELD(viewQuery);
+	COMPARE_SCALAR_FIELD(incremental);
 	COMPARE_SCALAR_FIELD(skipData);
 
 	return true;
@@ -529,6 +529,19 @@ _outGatherMerge(StringInfo str, const GatherMerge *node)
 	WRITE_BITMAPSET_FIELD(initParam);
 }
 
+static void
+_outRedistribute(StringInfo str, const Redistribute *node)
+{
+	WRITE_NODE_TYPE("REDISTRIBUTE");
+
+	_outPlanInfo(str, (const Plan *) node);
+
+	WRITE_INT_FIELD(numCols);
+	WRITE_ATTRNUMBER_ARRAY(hashColIdx, node->numCols);
+	WRITE_OID_ARRAY(hashOperators, node->numCols);
+	WRITE_OID_ARRAY(hashCollations, node->numCols);
+}
+
 static void
 _outScan(StringInfo str, const Scan *node)
 {
@@ -924,6 +937,11 @@ _outHash(StringInfo str, const Hash *node)
 	WRITE_INT_FIELD(skewColumn);
 	WRITE_BOOL_FIELD(skewInherit);
 	WRITE_FLOAT_FIELD(rows_total, "%.0f");
+	WRITE_NODE_FIELD(filterKeys);
+	WRITE_NODE_FIELD(filterSortOps);
+	WRITE_NODE_FIELD(filterCollations);
+	WRITE_NODE_FIELD(filterMinParams);
+	WRITE_NODE_FIELD(filterMaxParams);
 }
 
 static void
@@ -1115,6 +1133,7 @@ _outIntoClause(StringInfo str, const IntoClause *node)
 	WRITE_ENUM_FIELD(onCommit, OnCommitAction);
 	WRITE_STRING_FIELD(tableSpaceName);
 	WRITE_NODE_FIELD(viewQuery);
+	WRITE_BOOL_FIELD(incremental);
 	WRITE_BOOL_FIELD(skipData);
 }
 
@@ -2227,6 +2246,17 @@ _outGatherMergePath(StringInfo str, const GatherMergePath *node)
 	WRITE_INT_FIELD(num_workers);
 }
 
+static void
+_outRedistributePath(StringInfo str, const RedistributePath *node)
+{
+	WRITE_NODE_TYPE("REDISTRIBUTEPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(subpath);
+	WRITE_NODE_FIELD(distClauses);
+}
+
 static void
 _outNestPath(StringInfo str, const NestPath *node)
 {
@@ -3885,6 +3915,9 @@ outNode(StringInfo str, const void *obj)
 			case T_GatherMerge:
 				_outGatherMerge(str, obj);
 				break;
+			case T_Redistribute:
+				_outRedistribute(str, obj);
+				break;
 			case T_Scan:
 				_outScan(str, obj);
 				break;
@@ -4260,6 +4293,9 @@ outNode(StringInfo str, const void *obj)
 			case T_GatherMergePath:
 				_outGatherMergePath(str, obj);
 				break;
+			case T_RedistributePath:
+				_outRedistributePath(str, obj);
+				break;
 			case T_NestPath:
 				_outNestPath(str, obj);
 				break;
@@ -564,6 +564,7 @@ _readIntoClause(void)
 	READ_ENUM_FIELD(onCommit, OnCommitAction);
 	READ_STRING_FIELD(tableSpaceName);
 	READ_NODE_FIELD(viewQuery);
+	READ_BOOL_FIELD(incremental);
 	READ_BOOL_FIELD(skipData);
 
 	READ_DONE();
@@ -2414,6 +2415,24 @@ _readGatherMerge(void)
 	READ_DONE();
 }
 
+/*
+ * _readRedistribute
+ */
+static Redistribute *
+_readRedistribute(void)
+{
+	READ_LOCALS(Redistribute);
+
+	ReadCommonPlan(&local_node->plan);
+
+	READ_INT_FIELD(numCols);
+	READ_ATTRNUMBER_ARRAY(hashColIdx, local_node->numCols);
+	READ_OID_ARRAY(hashOperators, local_node->numCols);
+	READ_OID_ARRAY(hashCollations, local_node->numCols);
+
+	READ_DONE();
+}
+
 /*
  * _readHash
  */
@@ -2429,6 +2448,11 @@ _readHash(void)
 	READ_INT_FIELD(skewColumn);
 	READ_BOOL_FIELD(skewInherit);
 	READ_FLOAT_FIELD(rows_total);
+	READ_NODE_FIELD(filterKeys);
+	READ_NODE_FIELD(filterSortOps);
+	READ_NODE_FIELD(filterCollations);
+	READ_NODE_FIELD(filterMinParams);
+	READ_NODE_FIELD(filterMaxParams);
 
 	READ_DONE();
 }
@@ -2941,6 +2965,8 @@ parseNodeString(void)
 		return_value = _readGather();
 	else if (MATCH("GATHERMERGE", 11))
 		return_value = _readGatherMerge();
+	else if (MATCH("REDISTRIBUTE", 12))
+		return_value = _readRedistribute();
 	else if (MATCH("HASH", 4))
 		return_value = _readHash();
 	else if (MATCH("SETOP", 5))
@@ -82,6 +82,13 @@
 /* number of active words for a lossy chunk: */
 #define WORDS_PER_CHUNK  ((PAGES_PER_CHUNK - 1) / BITS_PER_BITMAPWORD + 1)
 
+/*
+ * Most pages a shared iterator claims from the shared state at once.  Each
+ * iterator starts by claiming a single page and doubles its claims up to
+ * this, so that small bitmaps still spread across all participants.
+ */
+#define TBM_SHARED_ITERATE_BATCH	8
+
 /*
  * The hashtable entries are represented by this data structure.  For
  * an exact page, blockno is the page number and bit k of the bitmap
@@ -211,9 +218,22 @@ typedef struct PTIterationArray
 	int			index[FLEXIBLE_ARRAY_MEMBER];	/* index array */
 } PTIterationArray;
 
+/*
+ * A page claimed by a shared iterator but not yet returned by it: either an
+ * exact page, identified by its pagetable index, or a lossy page.
+ */
+typedef struct TBMSharedBatchItem
+{
+	BlockNumber blockno;		/* page number, if lossy */
+	int			pageidx;		/* pagetable index, or -1 if lossy */
+} TBMSharedBatchItem;
+
 /*
  * same as TBMIterator, but it is used for joint iteration, therefore this
  * also holds a reference to the shared state.
+ *
+ * To acquire the shared state's lock less often, the iterator claims several
+ * pages at a time, and returns them one by one from its batch.
  */
 struct TBMSharedIterator
 {
@@ -221,6 +241,10 @@ struct TBMSharedIterator
 	PTEntryArray *ptbase;		/* pagetable element array */
 	PTIterationArray *ptpages;	/* sorted exact page index list */
 	PTIterationArray *ptchunks; /* sorted lossy page index list */
+	int			batchsize;		/* pages to claim next time */
+	int			nbatch;			/* number of pages in batch[] */
+	int			nextbatch;		/* next batch[] entry to return */
+	TBMSharedBatchItem batch[TBM_SHARED_ITERATE_BATCH];
 	TBMIterateResult output;	/* MUST BE LAST (because variable-size) */
 };
 
@@ -1045,7 +1069,8 @@ tbm_iterate(TBMIterator *iterator)
  *
  *	As above, but this will iterate using an iterator which is shared
  *	across multiple processes.  We need to acquire the iterator LWLock,
- *	before accessing the shared members.
+ *	before accessing the shared members; to do that less often, we claim
+ *	a batch of pages at a time.
  */
 TBMIterateResult *
 tbm_shared_iterate(TBMSharedIterator *iterator)
@@ -1055,6 +1080,7 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 	PagetableEntry *ptbase = NULL;
 	int		   *idxpages = NULL;
 	int		   *idxchunks = NULL;
+	TBMSharedBatchItem *item;
 
 	if (iterator->ptbase != NULL)
 		ptbase = iterator->ptbase->ptentry;
@@ -1063,75 +1089,107 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 	if (iterator->ptchunks != NULL)
 		idxchunks = iterator->ptchunks->index;
 
-	/* Acquire the LWLock before accessing the shared members */
-	LWLockAcquire(&istate->lock, LW_EXCLUSIVE);
-
-	/*
-	 * If lossy chunk pages remain, make sure we've advanced schunkptr/
-	 * schunkbit to the next set bit.
-	 */
-	while (istate->schunkptr < istate->nchunks)
+	if (iterator->nextbatch >= iterator->nbatch)
 	{
-		PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
-		int			schunkbit = istate->schunkbit;
+		iterator->nbatch = 0;
+		iterator->nextbatch = 0;
 
-		tbm_advance_schunkbit(chunk, &schunkbit);
-		if (schunkbit < PAGES_PER_CHUNK)
+		/* Acquire the LWLock before accessing the shared members */
+		LWLockAcquire(&istate->lock, LW_EXCLUSIVE);
+
+		while (iterator->nbatch < iterator->batchsize)
 		{
-			istate->schunkbit = schunkbit;
-			break;
-		}
-		/* advance to next chunk */
-		istate->schunkptr++;
-		istate->schunkbit = 0;
-	}
+			item = &iterator->batch[iterator->nbatch];
 
-	/*
-	 * If both chunk and per-page data remain, must output the numerically
-	 * earlier page.
-	 */
-	if (istate->schunkptr < istate->nchunks)
-	{
-		PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
-		BlockNumber chunk_blockno;
+			/*
+			 * If lossy chunk pages remain, make sure we've advanced
+			 * schunkptr/schunkbit to the next set bit.
+			 */
+			while (istate->schunkptr < istate->nchunks)
+			{
+				PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
+				int			schunkbit = istate->schunkbit;
 
-		chunk_blockno = chunk->blockno + istate->schunkbit;
+				tbm_advance_schunkbit(chunk, &schunkbit);
+				if (schunkbit < PAGES_PER_CHUNK)
+				{
+					istate->schunkbit = schunkbit;
+					break;
+				}
+				/* advance to next chunk */
+				istate->schunkptr++;
+				istate->schunkbit = 0;
+			}
 
-		if (istate->spageptr >= istate->npages ||
-			chunk_blockno < ptbase[idxpages[istate->spageptr]].blockno)
-		{
-			/* Return a lossy page indicator from the chunk */
-			output->blockno = chunk_blockno;
-			output->ntuples = -1;
-			output->recheck = true;
-			istate->schunkbit++;
+			/*
+			 * If both chunk and per-page data remain, must claim the
+			 * numerically earlier page.
+			 */
+			if (istate->schunkptr < istate->nchunks)
+			{
+				PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
+				BlockNumber chunk_blockno;
 
-			LWLockRelease(&istate->lock);
-			return output;
+				chunk_blockno = chunk->blockno + istate->schunkbit;
+
+				if (istate->spageptr >= istate->npages ||
+					chunk_blockno < ptbase[idxpages[istate->spageptr]].blockno)
+				{
+					/* Claim a lossy page from the chunk */
+					item->blockno = chunk_blockno;
+					item->pageidx = -1;
+					istate->schunkbit++;
+					iterator->nbatch++;
+					continue;
+				}
+			}
+
+			if (istate->spageptr < istate->npages)
+			{
+				item->pageidx = idxpages[istate->spageptr];
+				istate->spageptr++;
+				iterator->nbatch++;
+				continue;
+			}
+
+			/* Nothing more in the bitmap */
+			break;
 		}
+
+		LWLockRelease(&istate->lock);
+
+		if (iterator->batchsize < TBM_SHARED_ITERATE_BATCH)
+			iterator->batchsize *= 2;
+
+		if (iterator->nbatch == 0)
+			return NULL;
 	}
 
-	if (istate->spageptr < istate->npages)
+	item = &iterator->batch[iterator->nextbatch++];
+
+	if (item->pageidx < 0)
 	{
-		PagetableEntry *page = &ptbase[idxpages[istate->spageptr]];
+		/* Return a lossy page indicator from the chunk */
+		output->blockno = item->blockno;
+		output->ntuples = -1;
+		output->recheck = true;
+	}
+	else
+	{
+		PagetableEntry *page = &ptbase[item->pageidx];
 		int			ntuples;
 
-		/* scan bitmap to extract individual offset numbers */
+		/*
+		 * Scan bitmap to extract individual offset numbers.  The pagetable
+		 * doesn't change during the iteration, so no lock is needed.
+		 */
 		ntuples = tbm_extract_page_tuple(page, output);
 		output->blockno = page->blockno;
 		output->ntuples = ntuples;
 		output->recheck = page->recheck;
-		istate->spageptr++;
-
-		LWLockRelease(&istate->lock);
-
-		return output;
 	}
 
-	LWLockRelease(&istate->lock);
-
-	/* Nothing more in the bitmap */
-	return NULL;
+	return output;
 }
 
 /*
@@ -1476,6 +1534,7 @@ tbm_attach_shared_iterate(dsa_area *dsa, dsa_pointer dp)
 	istate = (TBMSharedIteratorState *) dsa_get_address(dsa, dp);
 
 	iterator->state = istate;
+	iterator->batchsize = 1;
 
 	iterator->ptbase = dsa_get_address(dsa, istate->pagetable);
 
@@ -35,6 +35,7 @@
 #include "optimizer/cost.h"
 #include "optimizer/geqo.h"
 #include "optimizer/inherit.h"
+#include "optimizer/joininfo.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -61,6 +62,7 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+bool		geqo_greedy = false;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -125,6 +127,9 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static RelOptInfo *greedy_join_search(PlannerInfo *root, int levels_needed,
+									  List *initial_rels);
+static bool greedy_join_is_better(RelOptInfo *joinrel, RelOptInfo *best);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -155,6 +160,7 @@ make_one_rel(PlannerInfo *root, List *joinlist)
 	RelOptInfo *rel;
 	Index		rti;
 	double		total_pages;
+	PlannerPhase prev_phase;
 
 	/*
 	 * Construct the all_baserels Relids set.
@@ -180,6 +186,8 @@ make_one_rel(PlannerInfo *root, List *joinlist)
 	/* Mark base rels as to whether we care about fast-start plans */
 	set_base_rel_consider_startup(root);
 
+	prev_phase = PlannerEnterPhase(PLANNER_PHASE_BASE_PATHS);
+
 	/*
 	 * Compute size estimates and consider_parallel flags for each base rel.
 	 */
@@ -225,7 +233,9 @@ make_one_rel(PlannerInfo *root, List *joinlist)
 	/*
 	 * Generate access paths for the entire join tree.
 	 */
+	PlannerEnterPhase(PLANNER_PHASE_JOIN_SEARCH);
 	rel = make_rel_from_joinlist(root, joinlist);
+	PlannerEnterPhase(prev_phase);
 
 	/*
 	 * The result should join all and only the query's base rels.
@@ -2936,7 +2946,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, GEQO (genetic or greedy), or the regular join
+		 * search code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -2946,7 +2957,11 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
+		{
+			if (geqo_greedy)
+				return greedy_join_search(root, levels_needed, initial_rels);
 			return geqo(root, levels_needed, initial_rels);
+		}
 		else
 			return standard_join_search(root, levels_needed, initial_rels);
 	}
@@ -3067,6 +3082,163 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * greedy_join_search
+ *	  Build a join tree for a large join problem by repeatedly performing
+ *	  the most promising single join.
+ *
+ * This is an alternative to the genetic optimizer for queries with at least
+ * geqo_threshold items.  We keep a set of "clumps", initially one per
+ * jointree item.  In each round we consider every pair of clumps that is
+ * connected by a join clause or a join order restriction, and merge the pair
+ * whose join is estimated to produce the fewest rows (breaking ties by
+ * cheapest total cost, then by position in the input list).  Only if no
+ * connected pair remains do we fall back to joining any legal pair, which
+ * means a cartesian product.
+ *
+ * The join of a pair of clumps stays valid until one of the two is merged
+ * with something else, so each round only needs to build the joins that
+ * involve the clump created in the previous round.  That caps the number of
+ * joinrels built at O(n^2), and unlike GEQO the result depends only on the
+ * query and not on a random seed.  Like GEQO this can fail when an early
+ * merge makes a later join illegal, eg. due to LATERAL references.
+ */
+static RelOptInfo *
+greedy_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	int			nclumps = list_length(initial_rels);
+	RelOptInfo **clumps;
+	int		   *sizes;
+	RelOptInfo **joins;
+	bool	   *tried;
+	int			remaining = nclumps;
+	int			i;
+
+	Assert(root->join_rel_level == NULL);
+
+	clumps = (RelOptInfo **) palloc(nclumps * sizeof(RelOptInfo *));
+	sizes = (int *) palloc(nclumps * sizeof(int));
+	joins = (RelOptInfo **) palloc0(nclumps * nclumps * sizeof(RelOptInfo *));
+	tried = (bool *) palloc0(nclumps * nclumps * sizeof(bool));
+
+	for (i = 0; i < nclumps; i++)
+	{
+		clumps[i] = (RelOptInfo *) list_nth(initial_rels, i);
+		sizes[i] = 1;
+	}
+
+	while (remaining > 1)
+	{
+		RelOptInfo *best = NULL;
+		int			best_i = -1;
+		int			best_j = -1;
+		int			pass;
+
+		/* First look only at connected pairs; force a join if there are none */
+		for (pass = 0; pass < 2 && best == NULL; pass++)
+		{
+			bool		force = (pass == 1);
+
+			for (i = 0; i < nclumps; i++)
+			{
+				int			j;
+
+				if (clumps[i] == NULL)
+					continue;
+
+				for (j = i + 1; j < nclumps; j++)
+				{
+					int			k = i * nclumps + j;
+					RelOptInfo *joinrel;
+
+					if (clumps[j] == NULL)
+						continue;
+
+					if (!force &&
+						!have_relevant_joinclause(root, clumps[i], clumps[j]) &&
+						!have_join_order_restriction(root, clumps[i], clumps[j]))
+						continue;
+
+					if (!tried[k])
+					{
+						tried[k] = true;
+						joinrel = make_join_rel(root, clumps[i], clumps[j]);
+						if (joinrel)
+						{
+							/* Create paths for partitionwise joins. */
+							generate_partitionwise_join_paths(root, joinrel);
+
+							/*
+							 * Except for the topmost scan/join rel, consider
+							 * gathering partial paths, as in
+							 * standard_join_search.
+							 */
+							if (sizes[i] + sizes[j] < levels_needed)
+								generate_useful_gather_paths(root, joinrel, false);
+
+							/* Find and save the cheapest paths for this joinrel */
+							set_cheapest(joinrel);
+						}
+						joins[k] = joinrel;
+					}
+
+					joinrel = joins[k];
+					if (joinrel && (best == NULL ||
+									greedy_join_is_better(joinrel, best)))
+					{
+						best = joinrel;
+						best_i = i;
+						best_j = j;
+					}
+				}
+			}
+		}
+
+		if (best == NULL)
+			elog(ERROR, "failed to build any %d-way joins", levels_needed);
+
+		/* Replace the first clump by the join, and forget the second */
+		clumps[best_i] = best;
+		sizes[best_i] += sizes[best_j];
+		clumps[best_j] = NULL;
+		remaining--;
+
+		/* Joins involving the enlarged clump have to be built afresh */
+		for (i = 0; i < nclumps; i++)
+		{
+			if (i < best_i)
+				tried[i * nclumps + best_i] = false;
+			else if (i > best_i)
+				tried[best_i * nclumps + i] = false;
+		}
+
+#ifdef OPTIMIZER_DEBUG
+		debug_print_rel(root, best);
+#endif
+	}
+
+	for (i = 0; i < nclumps; i++)
+	{
+		if (clumps[i] != NULL)
+			break;
+	}
+	Assert(i < nclumps && sizes[i] == levels_needed);
+
+	return clumps[i];
+}
+
+/*
+ * Is joinrel a better next step for greedy_join_search than best?
+ */
+static bool
+greedy_join_is_better(RelOptInfo *joinrel, RelOptInfo *best)
+{
+	if (joinrel->rows != best->rows)
+		return joinrel->rows < best->rows;
+	return joinrel->cheapest_total_path->total_cost <
+		best->cheapest_total_path->total_cost;
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
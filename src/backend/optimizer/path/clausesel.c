@@ -156,6 +156,15 @@ clauselist_selectivity_ext(PlannerInfo *root,
 											jointype, sjinfo, rel,
 											&estimatedclauses, false);
 	}
+	else if (use_extended_stats && varRelid == 0 && sjinfo != NULL)
+	{
+		/*
+		 * For a join, estimate groups of equality clauses between the same
+		 * pair of relations using multivariate ndistinct statistics.
+		 */
+		s1 = statext_join_clauselist_selectivity(root, clauses, jointype,
+												 sjinfo, &estimatedclauses);
+	}
 
 	/*
 	 * Apply normal selectivity estimates for remaining clauses. We'll be
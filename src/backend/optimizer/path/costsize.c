@@ -146,8 +146,12 @@ bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_partitionwise_window = false;
+bool		enable_redistribute = false;
+bool		enable_eager_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_memoize = true;
 bool		enable_partition_pruning = true;
 bool		enable_async_append = true;
 
@@ -2545,6 +2549,39 @@ cost_memoize_rescan(PlannerInfo *root, MemoizePath *mpath,
 	*rescan_total_cost = total_cost;
 }
 
+/*
+ * cost_redistribute
+ *	  Determines and returns the cost of repartitioning a partial relation's
+ *	  rows among the parallel participants.
+ *
+ * Each participant hashes its share of the input and writes it out to
+ * shared temporary files, which it cannot start reading back until every
+ * participant is done writing, so all of that is startup cost.  'tuples' is
+ * the number of rows per participant.
+ */
+void
+cost_redistribute(Path *path, int numCols,
+				  Cost input_startup_cost, Cost input_total_cost,
+				  double tuples, int width)
+{
+	Cost		startup_cost = input_total_cost;
+	Cost		run_cost = 0;
+	double		npages = ceil(relation_byte_size(tuples, width) / BLCKSZ);
+
+	path->rows = tuples;
+
+	/* Hash each tuple, and write it out */
+	startup_cost += (cpu_operator_cost * numCols + cpu_tuple_cost) * tuples;
+	startup_cost += seq_page_cost * npages;
+
+	/* Read the tuples back in */
+	run_cost += cpu_tuple_cost * tuples;
+	run_cost += seq_page_cost * npages;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
@@ -5062,6 +5099,25 @@ get_parameterized_joinrel_size(PlannerInfo *root, RelOptInfo *rel,
 	return nrows;
 }
 
+/*
+ * set_eager_agg_size_estimates
+ *		Set the size estimates for a base relation that is partially
+ *		aggregated below a join.
+ *
+ * rel is the grouped counterpart of input_rel, grouped by group_exprs.  We
+ * estimate the number of groups the same way as for the upper aggregation
+ * steps.  The width is taken from rel's reltarget, which must be set up
+ * already.
+ */
+void
+set_eager_agg_size_estimates(PlannerInfo *root, RelOptInfo *rel,
+							 RelOptInfo *input_rel, List *group_exprs)
+{
+	rel->rows = clamp_row_est(estimate_num_groups(root, group_exprs,
+												  input_rel->rows,
+												  NULL, NULL));
+}
+
 /*
  * calc_joinrel_size_estimate
  *		Workhorse for set_joinrel_size_estimates and
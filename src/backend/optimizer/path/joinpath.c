@@ -1901,8 +1901,17 @@ consider_parallel_nestloop(PlannerInfo *root,
 									 innerpath, outerpath, jointype,
 									 extra);
 			if (mpath != NULL)
+			{
+				/*
+				 * Every participant runs the inner side, so let them share
+				 * the cache.  We don't reduce the cost estimate for that;
+				 * the shared cache can only save work.
+				 */
+				if (enable_parallel_memoize)
+					mpath->parallel_aware = true;
 				try_partial_nestloop_path(root, joinrel, outerpath, mpath,
 										  pathkeys, jointype, extra);
+			}
 		}
 	}
 }
@@ -243,6 +243,9 @@ static Hash *make_hash(Plan *lefttree,
 					   Oid skewTable,
 					   AttrNumber skewColumn,
 					   bool skewInherit);
+static void add_hash_runtime_filters(PlannerInfo *root, HashPath *best_path,
+									 Hash *hash_plan, Append *outer_plan,
+									 List *hashclauses);
 static MergeJoin *make_mergejoin(List *tlist,
 								 List *joinclauses, List *otherclauses,
 								 List *mergeclauses,
@@ -311,6 +314,9 @@ static ModifyTable *make_modifytable(PlannerInfo *root, Plan *subplan,
 									 List *rowMarks, OnConflictExpr *onconflict, int epqParam);
 static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 											 GatherMergePath *best_path);
+static Redistribute *create_redistribute_plan(PlannerInfo *root,
+											  RedistributePath *best_path,
+											  int flags);
 
 
 /*
@@ -536,6 +542,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 			plan = (Plan *) create_gather_merge_plan(root,
 													 (GatherMergePath *) best_path);
 			break;
+		case T_Redistribute:
+			plan = (Plan *) create_redistribute_plan(root,
+													 (RedistributePath *) best_path,
+													 flags);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -1109,6 +1120,14 @@ is_async_capable_path(Path *path)
 					return true;
 			}
 			break;
+		case T_GatherPath:
+
+			/*
+			 * The workers of a Gather run by themselves; the leader can
+			 * consume their output as it arrives, while it works on other
+			 * subplans.
+			 */
+			return true;
 		default:
 			break;
 	}
@@ -1922,6 +1941,58 @@ create_gather_merge_plan(PlannerInfo *root, GatherMergePath *best_path)
 	return gm_plan;
 }
 
+/*
+ * create_redistribute_plan
+ *
+ *	  Create a Redistribute plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ */
+static Redistribute *
+create_redistribute_plan(PlannerInfo *root, RedistributePath *best_path,
+						 int flags)
+{
+	Redistribute *plan;
+	Plan	   *subplan;
+	int			numCols = list_length(best_path->distClauses);
+	int			i;
+	ListCell   *lc;
+
+	/*
+	 * We don't want any excess columns in the stored tuples, and we need to
+	 * find the distribution columns by their sortgroupref labels.  Otherwise,
+	 * since Redistribute doesn't project, tlist requirements pass through.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST | CP_LABEL_TLIST);
+
+	plan = makeNode(Redistribute);
+	plan->plan.targetlist = subplan->targetlist;
+	plan->plan.qual = NIL;
+	plan->plan.lefttree = subplan;
+	plan->plan.righttree = NULL;
+	plan->numCols = numCols;
+	plan->hashColIdx = (AttrNumber *) palloc(numCols * sizeof(AttrNumber));
+	plan->hashOperators = (Oid *) palloc(numCols * sizeof(Oid));
+	plan->hashCollations = (Oid *) palloc(numCols * sizeof(Oid));
+
+	i = 0;
+	foreach(lc, best_path->distClauses)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, subplan->targetlist);
+
+		Assert(sgc->hashable);
+		plan->hashColIdx[i] = tle->resno;
+		plan->hashOperators[i] = sgc->eqop;
+		plan->hashCollations[i] = exprCollation((Node *) tle->expr);
+		i++;
+	}
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_projection_plan
  *
@@ -4753,6 +4824,14 @@ create_hashjoin_plan(PlannerInfo *root,
 		hash_plan->rows_total = best_path->inner_rows_total;
 	}
 
+	/*
+	 * If the outer side is an Append over a partitioned table, maybe it can
+	 * prune partitions at run time using the range of the inner join keys.
+	 */
+	if (IsA(outer_plan, Append))
+		add_hash_runtime_filters(root, best_path, hash_plan,
+								 (Append *) outer_plan, hashclauses);
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4771,6 +4850,198 @@ create_hashjoin_plan(PlannerInfo *root,
 }
 
 
+/*
+ * add_hash_runtime_filters
+ *	  Set up run-time partition pruning of a hash join's outer Append based on
+ *	  the range of values of the inner join keys.
+ *
+ * For each hash clause "outer_key = inner_key" where outer_key is a partition
+ * key of the appendrel, we invent a pair of PARAM_EXEC Params that the Hash
+ * node will set to the smallest and largest non-null value of inner_key, and
+ * add "outer_key >= $min AND outer_key <= $max" to the Append's pruning quals.
+ * Outer rows outside that range can't have a join partner, so this is only
+ * done for join types that discard unmatched outer rows.
+ *
+ * 'hashclauses' must already have the outer key on the left.
+ */
+static void
+add_hash_runtime_filters(PlannerInfo *root, HashPath *best_path,
+						 Hash *hash_plan, Append *outer_plan,
+						 List *hashclauses)
+{
+	Path	   *outerpath = best_path->jpath.outerjoinpath;
+	RelOptInfo *outerrel = outerpath->parent;
+	PartitionScheme partscheme = outerrel->part_scheme;
+	PartitionPruneInfo *pruneinfo;
+	List	   *prunequal = NIL;
+	List	   *filterKeys = NIL;
+	List	   *filterSortOps = NIL;
+	List	   *filterCollations = NIL;
+	List	   *filterMinParams = NIL;
+	List	   *filterMaxParams = NIL;
+	Bitmapset  *filterparamids = NULL;
+	bool		useful = false;
+	int			keyno = 0;
+	ListCell   *lc;
+
+	if (!enable_partition_pruning)
+		return;
+
+	switch (best_path->jpath.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_SEMI:
+		case JOIN_RIGHT:
+			break;
+		default:
+			/* unmatched outer rows are needed */
+			return;
+	}
+
+	/*
+	 * A parallel-aware Hash builds a shared hash table, and no single
+	 * participant sees all of the inner rows.
+	 */
+	if (hash_plan->plan.parallel_aware)
+		return;
+
+	if (!IsA(outerpath, AppendPath) ||
+		outerpath->param_info != NULL ||
+		outerrel->reloptkind != RELOPT_BASEREL ||
+		!IS_PARTITIONED_REL(outerrel) ||
+		partscheme->strategy == PARTITION_STRATEGY_HASH)
+		return;
+
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+		Expr	   *outerkey = (Expr *) linitial(hclause->args);
+		Expr	   *innerkey = (Expr *) lsecond(hclause->args);
+		Expr	   *strippedkey = outerkey;
+		int			i;
+
+		while (IsA(strippedkey, RelabelType))
+			strippedkey = ((RelabelType *) strippedkey)->arg;
+
+		for (i = 0; i < partscheme->partnatts; i++)
+		{
+			Oid			opfamily = partscheme->partopfamily[i];
+			Oid			lefttype;
+			Oid			righttype;
+			Oid			geop;
+			Oid			leop;
+			Oid			sortop;
+			Param	   *minparam;
+			Param	   *maxparam;
+			ListCell   *lc2;
+			bool		matches = false;
+
+			foreach(lc2, outerrel->partexprs[i])
+			{
+				Expr	   *partexpr = (Expr *) lfirst(lc2);
+
+				while (IsA(partexpr, RelabelType))
+					partexpr = ((RelabelType *) partexpr)->arg;
+				if (equal(partexpr, strippedkey))
+				{
+					matches = true;
+					break;
+				}
+			}
+			if (!matches)
+				continue;
+
+			/* NULL keys never match, so the range can ignore them */
+			if (!op_strict(hclause->opno) ||
+				get_op_opfamily_strategy(hclause->opno, opfamily) !=
+				BTEqualStrategyNumber)
+				continue;
+
+			op_input_types(hclause->opno, &lefttype, &righttype);
+			geop = get_opfamily_member(opfamily, lefttype, righttype,
+									   BTGreaterEqualStrategyNumber);
+			leop = get_opfamily_member(opfamily, lefttype, righttype,
+									   BTLessEqualStrategyNumber);
+			sortop = get_opfamily_member(opfamily, righttype, righttype,
+										 BTLessStrategyNumber);
+			if (!OidIsValid(geop) || !OidIsValid(leop) || !OidIsValid(sortop))
+				continue;
+
+			minparam = generate_new_exec_param(root, righttype,
+											   exprTypmod((Node *) innerkey),
+											   exprCollation((Node *) innerkey));
+			maxparam = generate_new_exec_param(root, righttype,
+											   exprTypmod((Node *) innerkey),
+											   exprCollation((Node *) innerkey));
+
+			prunequal = lappend(prunequal,
+								make_opclause(geop, BOOLOID, false,
+											  (Expr *) copyObject(outerkey),
+											  (Expr *) minparam,
+											  InvalidOid,
+											  hclause->inputcollid));
+			prunequal = lappend(prunequal,
+								make_opclause(leop, BOOLOID, false,
+											  (Expr *) copyObject(outerkey),
+											  (Expr *) maxparam,
+											  InvalidOid,
+											  hclause->inputcollid));
+
+			filterKeys = lappend_int(filterKeys, keyno);
+			filterSortOps = lappend_oid(filterSortOps, sortop);
+			filterCollations = lappend_oid(filterCollations,
+										   hclause->inputcollid);
+			filterMinParams = lappend_int(filterMinParams, minparam->paramid);
+			filterMaxParams = lappend_int(filterMaxParams, maxparam->paramid);
+			filterparamids = bms_add_member(filterparamids, minparam->paramid);
+			filterparamids = bms_add_member(filterparamids, maxparam->paramid);
+			break;
+		}
+
+		keyno++;
+	}
+
+	if (filterKeys == NIL)
+		return;
+
+	/*
+	 * Redo the Append's pruning info with the additional quals.  This must
+	 * include the quals create_append_plan() used.
+	 */
+	prunequal = list_concat(extract_actual_clauses(outerrel->baserestrictinfo,
+												   false),
+							prunequal);
+	pruneinfo = make_partition_pruneinfo(root, outerrel,
+										 ((AppendPath *) outerpath)->subpaths,
+										 prunequal);
+	if (pruneinfo == NULL)
+		return;
+
+	/* Give up unless some pruning step actually depends on our Params */
+	foreach(lc, pruneinfo->prune_infos)
+	{
+		ListCell   *lc2;
+
+		foreach(lc2, (List *) lfirst(lc))
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+
+			if (bms_overlap(pinfo->execparamids, filterparamids))
+				useful = true;
+		}
+	}
+	if (!useful)
+		return;
+
+	outer_plan->part_prune_info = pruneinfo;
+	hash_plan->filterKeys = filterKeys;
+	hash_plan->filterSortOps = filterSortOps;
+	hash_plan->filterCollations = filterCollations;
+	hash_plan->filterMinParams = filterMinParams;
+	hash_plan->filterMaxParams = filterMaxParams;
+}
+
+
 /*****************************************************************************
  *
  *	SUPPORTING ROUTINES
@@ -7034,6 +7305,7 @@ is_projection_capable_path(Path *path)
 		case T_Hash:
 		case T_Material:
 		case T_Memoize:
+		case T_Redistribute:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -7084,6 +7356,7 @@ is_projection_capable_plan(Plan *plan)
 		case T_Hash:
 		case T_Material:
 		case T_Memoize:
+		case T_Redistribute:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
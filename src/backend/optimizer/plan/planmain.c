@@ -58,6 +58,9 @@ query_planner(PlannerInfo *root,
 	Query	   *parse = root->parse;
 	List	   *joinlist;
 	RelOptInfo *final_rel;
+	PlannerPhase prev_phase;
+
+	prev_phase = PlannerEnterPhase(PLANNER_PHASE_SETUP);
 
 	/*
 	 * Init planner lists to empty.
@@ -149,6 +152,8 @@ query_planner(PlannerInfo *root,
 				 */
 				(*qp_callback) (root, qp_extra);
 
+				PlannerEnterPhase(prev_phase);
+
 				return final_rel;
 			}
 		}
@@ -280,5 +285,7 @@ query_planner(PlannerInfo *root,
 		final_rel->cheapest_total_path->param_info != NULL)
 		elog(ERROR, "failed to construct the join relation");
 
+	PlannerEnterPhase(prev_phase);
+
 	return final_rel;
 }
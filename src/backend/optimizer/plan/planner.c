@@ -20,12 +20,14 @@
 
 #include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
@@ -56,23 +58,30 @@
 #include "optimizer/tlist.h"
 #include "parser/analyze.h"
 #include "parser/parse_agg.h"
+#include "parser/parse_oper.h"
 #include "parser/parsetree.h"
 #include "partitioning/partdesc.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/dsm_impl.h"
+#include "utils/catcache.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
 #include "utils/syscache.h"
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
+bool		modify_table_tid_order = false;
 int			force_parallel_mode = FORCE_PARALLEL_OFF;
 bool		parallel_leader_participation = true;
 
 /* Hook for plugins to get control in planner() */
 planner_hook_type planner_hook = NULL;
 
+/* Per-phase instrumentation of the current planning run, if wanted */
+PlannerInstrumentation *planner_instrument = NULL;
+
 /* Hook for plugins to get control when grouping_planner() plans upper rels */
 create_upper_paths_hook_type create_upper_paths_hook = NULL;
 
@@ -138,6 +147,8 @@ static double preprocess_limit(PlannerInfo *root,
 							   double tuple_fraction,
 							   int64 *offset_est, int64 *count_est);
 static void remove_useless_groupby_columns(PlannerInfo *root);
+static Path *make_tid_ordered_path(PlannerInfo *root, RelOptInfo *rel,
+								   Path *path);
 static List *preprocess_groupclause(PlannerInfo *root, List *force);
 static List *extract_rollup_sets(List *groupingSets);
 static List *reorder_grouping_sets(List *groupingSets, List *sortclause);
@@ -180,13 +191,24 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows,
+									List *tlist);
+static List *window_distribution_clauses(List *activeWindows);
+static bool windows_have_partkey(RelOptInfo *input_rel, List *targetList,
+								 List *activeWindows);
+static void create_partitionwise_window_paths(PlannerInfo *root,
+											  RelOptInfo *input_rel,
+											  RelOptInfo *window_rel,
+											  PathTarget *input_target,
+											  PathTarget *output_target,
+											  WindowFuncLists *wflists,
+											  List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static void create_partial_distinct_paths(PlannerInfo *root,
@@ -230,6 +252,17 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 grouping_sets_data *gd,
 												 GroupPathExtraData *extra,
 												 bool force_rel_creation);
+static bool can_eager_aggregate(PlannerInfo *root, RelOptInfo *input_rel,
+								GroupPathExtraData *extra);
+static void add_eager_aggregation_paths(PlannerInfo *root,
+										RelOptInfo *input_rel,
+										RelOptInfo *partially_grouped_rel,
+										GroupPathExtraData *extra);
+static void try_eager_aggregation(PlannerInfo *root, RelOptInfo *input_rel,
+								  RelOptInfo *partially_grouped_rel,
+								  GroupPathExtraData *extra,
+								  RelOptInfo *rel, List *aggrefs,
+								  List *other_exprs);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
@@ -278,6 +311,80 @@ planner(Query *parse, const char *query_string, int cursorOptions,
 	return result;
 }
 
+/*
+ * PlannerInstrumentationStart
+ *		Begin collecting per-phase planner statistics into *instr.
+ *
+ * The caller must make sure PlannerInstrumentationStop is called even if
+ * planning fails, since planner_instrument would otherwise be left pointing
+ * at memory that is about to go away.
+ */
+void
+PlannerInstrumentationStart(PlannerInstrumentation *instr)
+{
+	memset(instr, 0, sizeof(PlannerInstrumentation));
+	instr->current_phase = PLANNER_PHASE_PREPROCESS;
+	INSTR_TIME_SET_CURRENT(instr->phase_start);
+	instr->phase_memory_start = BackendMemoryAllocated;
+	instr->catcache_searches = catcache_searches;
+
+	planner_instrument = instr;
+}
+
+/*
+ * PlannerInstrumentationStop
+ *		Charge the remaining time to the current phase and stop collecting.
+ */
+void
+PlannerInstrumentationStop(void)
+{
+	PlannerInstrumentation *instr = planner_instrument;
+
+	if (instr == NULL)
+		return;
+
+	/* flush the current phase by "switching" to a different one */
+	PlannerEnterPhase(instr->current_phase == PLANNER_PHASE_PREPROCESS ?
+					  PLANNER_PHASE_SETUP : PLANNER_PHASE_PREPROCESS);
+	instr->catcache_searches = catcache_searches - instr->catcache_searches;
+
+	planner_instrument = NULL;
+}
+
+/*
+ * PlannerEnterPhase
+ *		Make "phase" the current planner phase, returning the previous one.
+ *
+ * Callers save the result and pass it back in when they're done so that
+ * phases nest properly.  This is cheap enough to call unconditionally; it
+ * does nothing unless planner_instrument is set.
+ */
+PlannerPhase
+PlannerEnterPhase(PlannerPhase phase)
+{
+	PlannerInstrumentation *instr = planner_instrument;
+	PlannerPhase prev;
+	instr_time	now;
+
+	if (instr == NULL)
+		return phase;
+
+	prev = instr->current_phase;
+	if (phase == prev)
+		return prev;
+
+	INSTR_TIME_SET_CURRENT(now);
+	INSTR_TIME_ACCUM_DIFF(instr->phase_time[prev], now, instr->phase_start);
+	instr->phase_memory[prev] += (int64) BackendMemoryAllocated -
+		(int64) instr->phase_memory_start;
+
+	instr->current_phase = phase;
+	instr->phase_start = now;
+	instr->phase_memory_start = BackendMemoryAllocated;
+
+	return prev;
+}
+
 PlannedStmt *
 standard_planner(Query *parse, const char *query_string, int cursorOptions,
 				 ParamListInfo boundParams)
@@ -289,6 +396,7 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	RelOptInfo *final_rel;
 	Path	   *best_path;
 	Plan	   *top_plan;
+	PlannerPhase prev_phase;
 	ListCell   *lp,
 			   *lr;
 
@@ -410,7 +518,9 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	final_rel = fetch_upper_rel(root, UPPERREL_FINAL, NULL);
 	best_path = get_cheapest_fractional_path(final_rel, tuple_fraction);
 
+	prev_phase = PlannerEnterPhase(PLANNER_PHASE_CREATE_PLAN);
 	top_plan = create_plan(root, best_path);
+	PlannerEnterPhase(prev_phase);
 
 	/*
 	 * If creating a plan for a scrollable cursor, make sure it can run
@@ -603,8 +713,11 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	bool		hasOuterJoins;
 	bool		hasResultRTEs;
 	RelOptInfo *final_rel;
+	PlannerPhase prev_phase;
 	ListCell   *l;
 
+	prev_phase = PlannerEnterPhase(PLANNER_PHASE_PREPROCESS);
+
 	/* Create a PlannerInfo data structure for this subquery */
 	root = makeNode(PlannerInfo);
 	root->parse = parse;
@@ -1046,6 +1159,8 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	 */
 	set_cheapest(final_rel);
 
+	PlannerEnterPhase(prev_phase);
+
 	return root;
 }
 
@@ -1245,8 +1360,11 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	RelOptInfo *current_rel;
 	RelOptInfo *final_rel;
 	FinalPathExtraData extra;
+	PlannerPhase prev_phase;
 	ListCell   *lc;
 
+	prev_phase = PlannerEnterPhase(PLANNER_PHASE_UPPER);
+
 	/* Tweak caller-supplied tuple_fraction if have LIMIT/OFFSET */
 	if (parse->limitCount || parse->limitOffset)
 	{
@@ -1845,6 +1963,12 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 			else
 				rowMarks = root->rowMarks;
 
+			/* Maybe visit the target rows in their physical order */
+			if (modify_table_tid_order &&
+				(parse->commandType == CMD_UPDATE ||
+				 parse->commandType == CMD_DELETE))
+				path = make_tid_ordered_path(root, current_rel, path);
+
 			path = (Path *)
 				create_modifytable_path(root, final_rel,
 										path,
@@ -1902,6 +2026,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		(*create_upper_paths_hook) (root, UPPERREL_FINAL,
 									current_rel, final_rel, &extra);
 
+	PlannerEnterPhase(prev_phase);
+
 	/* Note: currently, we leave it to callers to do set_cheapest() */
 }
 
@@ -2525,6 +2651,51 @@ limit_needed(Query *parse)
 }
 
 
+/*
+ * make_tid_ordered_path
+ *		Sort the rows an UPDATE or DELETE will modify by their ctid, for
+ *		modify_table_tid_order.
+ *
+ * Only a target table without inheritance children is handled, since
+ * otherwise the row identity is a ROWID_VAR standing for several tables'
+ * columns.  The path is returned as is if it already has that order, as
+ * does a sequential or bitmap heap scan of the target table alone.
+ */
+static Path *
+make_tid_ordered_path(PlannerInfo *root, RelOptInfo *rel, Path *path)
+{
+	Query	   *parse = root->parse;
+	ListCell   *lc;
+
+	if ((path->pathtype == T_SeqScan || path->pathtype == T_BitmapHeapScan) &&
+		path->parent->relid == parse->resultRelation)
+		return path;
+
+	foreach(lc, root->processed_tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		Var		   *var = (Var *) tle->expr;
+		List	   *pathkeys;
+
+		if (!tle->resjunk || !IsA(var, Var) ||
+			var->varno != parse->resultRelation ||
+			var->varattno != SelfItemPointerAttributeNumber ||
+			var->varlevelsup != 0)
+			continue;
+
+		pathkeys = build_expression_pathkey(root, (Expr *) var, NULL,
+											TIDLessOperator,
+											bms_make_singleton(var->varno),
+											true);
+		if (pathkeys_contained_in(pathkeys, path->pathkeys))
+			return path;
+
+		return (Path *) create_sort_path(root, rel, path, pathkeys, -1.0);
+	}
+
+	return path;
+}
+
 /*
  * remove_useless_groupby_columns
  *		Remove any columns in the GROUP BY clause that are redundant due to
@@ -3541,6 +3712,7 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	RelOptInfo *partially_grouped_rel = NULL;
 	double		dNumGroups;
 	PartitionwiseAggregateType patype = PARTITIONWISE_AGGREGATE_NONE;
+	bool		eager_agg = can_eager_aggregate(root, input_rel, extra);
 
 	/*
 	 * If this is the topmost grouping relation or if the parent relation is
@@ -3580,11 +3752,12 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		bool		force_rel_creation;
 
 		/*
-		 * If we're doing partitionwise aggregation at this level, force
-		 * creation of a partially_grouped_rel so we can add partitionwise
-		 * paths to it.
+		 * If we're doing partitionwise aggregation at this level, or might
+		 * aggregate below the topmost join, force creation of a
+		 * partially_grouped_rel so we can add those paths to it.
 		 */
-		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL);
+		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL ||
+							  eager_agg);
 
 		partially_grouped_rel =
 			create_partial_grouping_paths(root,
@@ -3593,6 +3766,11 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 										  gd,
 										  extra,
 										  force_rel_creation);
+
+		/* Consider partially aggregating one side of the topmost join */
+		if (eager_agg)
+			add_eager_aggregation_paths(root, input_rel,
+										partially_grouped_rel, extra);
 	}
 
 	/* Set out parameter. */
@@ -3621,6 +3799,8 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		gather_grouping_paths(root, partially_grouped_rel);
 		set_cheapest(partially_grouped_rel);
 	}
+	else if (partially_grouped_rel && partially_grouped_rel->pathlist)
+		set_cheapest(partially_grouped_rel);
 
 	/*
 	 * Estimate number of groups.
@@ -4076,13 +4256,64 @@ create_window_paths(PlannerInfo *root,
 			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
 										&presorted_keys) ||
 			presorted_keys > 0)
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows,
+											root->processed_tlist));
+	}
+
+	/*
+	 * Consider computing the window functions in the parallel workers, having
+	 * first redistributed the rows among them so that each window partition
+	 * is seen by just one of them.
+	 */
+	if (enable_redistribute && window_rel->consider_parallel &&
+		input_rel->partial_pathlist != NIL)
+	{
+		List	   *distClauses = window_distribution_clauses(activeWindows);
+
+		if (distClauses != NIL)
+		{
+			Path	   *path;
+
+			path = (Path *)
+				create_redistribute_path(root,
+										 window_rel,
+										 linitial(input_rel->partial_pathlist),
+										 distClauses);
+			add_partial_path(window_rel,
+							 create_one_window_path(root,
+													window_rel,
+													path,
+													input_target,
+													output_target,
+													wflists,
+													activeWindows,
+													root->processed_tlist));
+		}
+	}
+
+	/*
+	 * If every window partition is known to lie within a single partition of
+	 * the input relation, also consider computing the window functions
+	 * separately for each partition.
+	 */
+	if (enable_partitionwise_window && IS_PARTITIONED_REL(input_rel) &&
+		windows_have_partkey(input_rel, root->processed_tlist, activeWindows))
+		create_partitionwise_window_paths(root, input_rel, window_rel,
+										  input_target, output_target,
+										  wflists, activeWindows);
+
+	/* Put Gather or Gather Merge atop any partial paths we've built. */
+	if (window_rel->partial_pathlist != NIL)
+	{
+		window_rel->reltarget = output_target;
+		generate_useful_gather_paths(root, window_rel, false);
 	}
 
 	/*
@@ -4108,7 +4339,7 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the resulting Path for window_rel.
  *
  * window_rel: upperrel to contain result
  * path: input Path to use (must return input_target)
@@ -4116,15 +4347,17 @@ create_window_paths(PlannerInfo *root,
  * output_target: what the topmost WindowAggPath should return
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
+ * tlist: targetlist to look up window partitioning and sorting columns in
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
 					   PathTarget *input_target,
 					   PathTarget *output_target,
 					   WindowFuncLists *wflists,
-					   List *activeWindows)
+					   List *activeWindows,
+					   List *tlist)
 {
 	PathTarget *window_target;
 	ListCell   *l;
@@ -4153,9 +4386,7 @@ create_one_window_path(PlannerInfo *root,
 		int			presorted_keys;
 		bool		is_sorted;
 
-		window_pathkeys = make_pathkeys_for_window(root,
-												   wc,
-												   root->processed_tlist);
+		window_pathkeys = make_pathkeys_for_window(root, wc, tlist);
 
 		is_sorted = pathkeys_count_contained_in(window_pathkeys,
 												path->pathkeys,
@@ -4221,7 +4452,179 @@ create_one_window_path(PlannerInfo *root,
 								  wc);
 	}
 
-	add_path(window_rel, path);
+	return path;
+}
+
+/*
+ * window_distribution_clauses
+ *
+ * Returns the PARTITION BY columns common to all active windows, if they can
+ * be hashed, as a list of SortGroupClauses.  Distributing rows among parallel
+ * workers by these keeps each partition of every window within one worker.
+ */
+static List *
+window_distribution_clauses(List *activeWindows)
+{
+	WindowClause *firstwc = linitial_node(WindowClause, activeWindows);
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, firstwc->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		bool		common = sgc->hashable;
+		ListCell   *lc2;
+
+		for_each_from(lc2, activeWindows, 1)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, lc2);
+			SortGroupClause *other;
+
+			if (!common)
+				break;
+			other = get_sortgroupref_clause_noerr(sgc->tleSortGroupRef,
+												  wc->partitionClause);
+			common = (other != NULL && other->eqop == sgc->eqop);
+		}
+
+		if (common)
+			result = lappend(result, sgc);
+	}
+
+	return result;
+}
+
+/*
+ * windows_have_partkey
+ *
+ * Returns true if the PARTITION BY clause of every active window includes
+ * all the partition keys of the input relation, so that each window
+ * partition comes from a single partition of the input.
+ */
+static bool
+windows_have_partkey(RelOptInfo *input_rel, List *targetList,
+					 List *activeWindows)
+{
+	ListCell   *lc;
+
+	foreach(lc, activeWindows)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+
+		if (!group_by_has_partkey(input_rel, targetList, wc->partitionClause))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * create_partitionwise_window_paths
+ *
+ * Compute the window functions separately for each partition of input_rel,
+ * and add Append paths over the results to window_rel.  The caller has
+ * verified that rows of any one window partition all come from the same
+ * partition of input_rel, so this gives the same answer as computing them
+ * over the whole relation.  Besides sorting smaller sets of rows, this lets
+ * a Parallel Append hand entire partitions to parallel workers, so that the
+ * WindowAgg nodes run below the Gather rather than in the leader.
+ */
+static void
+create_partitionwise_window_paths(PlannerInfo *root,
+								  RelOptInfo *input_rel,
+								  RelOptInfo *window_rel,
+								  PathTarget *input_target,
+								  PathTarget *output_target,
+								  WindowFuncLists *wflists,
+								  List *activeWindows)
+{
+	List	   *live_children = NIL;
+	int			i;
+
+	i = -1;
+	while ((i = bms_next_member(input_rel->live_parts, i)) >= 0)
+	{
+		RelOptInfo *child_input_rel = input_rel->part_rels[i];
+		RelOptInfo *child_window_rel;
+		PathTarget *child_input_target;
+		PathTarget *child_output_target;
+		WindowFuncLists child_wflists;
+		List	   *child_tlist;
+		AppendRelInfo **appinfos;
+		int			nappinfos;
+		Index		winref;
+
+		Assert(child_input_rel != NULL);
+
+		/* Dummy children can be ignored. */
+		if (IS_DUMMY_REL(child_input_rel))
+			continue;
+
+		/* We need a path for every child, or we can't do this at all. */
+		if (child_input_rel->cheapest_total_path == NULL)
+			return;
+
+		appinfos = find_appinfos_by_relids(root, child_input_rel->relids,
+										   &nappinfos);
+
+		/* Translate the targets and window functions for this child. */
+		child_input_target = copy_pathtarget(input_target);
+		child_input_target->exprs = (List *)
+			adjust_appendrel_attrs(root,
+								   (Node *) input_target->exprs,
+								   nappinfos, appinfos);
+		child_output_target = copy_pathtarget(output_target);
+		child_output_target->exprs = (List *)
+			adjust_appendrel_attrs(root,
+								   (Node *) output_target->exprs,
+								   nappinfos, appinfos);
+		child_tlist = (List *)
+			adjust_appendrel_attrs(root,
+								   (Node *) root->processed_tlist,
+								   nappinfos, appinfos);
+
+		child_wflists = *wflists;
+		child_wflists.windowFuncs = (List **)
+			palloc((wflists->maxWinRef + 1) * sizeof(List *));
+		for (winref = 0; winref <= wflists->maxWinRef; winref++)
+			child_wflists.windowFuncs[winref] = (List *)
+				adjust_appendrel_attrs(root,
+									   (Node *) wflists->windowFuncs[winref],
+									   nappinfos, appinfos);
+
+		pfree(appinfos);
+
+		child_window_rel = fetch_upper_rel(root, UPPERREL_WINDOW,
+										   child_input_rel->relids);
+		child_window_rel->reloptkind = RELOPT_OTHER_UPPER_REL;
+		child_window_rel->reltarget = child_output_target;
+		child_window_rel->consider_parallel = window_rel->consider_parallel &&
+			child_input_rel->consider_parallel;
+
+		add_path(child_window_rel,
+				 create_one_window_path(root,
+										child_window_rel,
+										child_input_rel->cheapest_total_path,
+										child_input_target,
+										child_output_target,
+										&child_wflists,
+										activeWindows,
+										child_tlist));
+		set_cheapest(child_window_rel);
+
+		live_children = lappend(live_children, child_window_rel);
+	}
+
+	if (live_children == NIL)
+		return;
+
+	/*
+	 * Build Append paths, and Parallel Append paths if possible.  The
+	 * children have no partial paths, so workers of a Parallel Append each
+	 * run entire partitions' WindowAgg plans.  Our caller adds Gathers.
+	 */
+	window_rel->reltarget = output_target;
+	add_paths_to_append_rel(root, window_rel, live_children);
 }
 
 /*
@@ -5991,7 +6394,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be a btree index,
+ * or a GiST index that is built by sorting).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6945,6 +7349,364 @@ gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel)
 	}
 }
 
+/*
+ * can_eager_aggregate
+ *
+ * Determines whether add_eager_aggregation_paths should be tried for the
+ * given input relation.
+ */
+static bool
+can_eager_aggregate(PlannerInfo *root, RelOptInfo *input_rel,
+					GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+
+	if (!enable_eager_aggregate)
+		return false;
+
+	/* We need aggregates that can be computed in partial mode */
+	if (!parse->hasAggs || (extra->flags & GROUPING_CAN_PARTIAL_AGG) == 0)
+		return false;
+
+	/*
+	 * Only consider the topmost join, and only if all joins are inner joins.
+	 * Outer joins could null-extend a partially aggregated row, and we don't
+	 * try to work out where PlaceHolderVars or lateral references would
+	 * need to be evaluated.
+	 */
+	if (input_rel->reloptkind != RELOPT_JOINREL ||
+		root->join_info_list != NIL ||
+		root->placeholder_list != NIL ||
+		root->hasLateralRTEs)
+		return false;
+
+	return true;
+}
+
+/*
+ * add_eager_aggregation_paths
+ *
+ * Consider partially aggregating a single base relation below the topmost
+ * join, and joining the result to the other relations ("eager
+ * aggregation").  For a query like
+ *
+ *		SELECT d.name, sum(f.amount) FROM fact f JOIN dim d ON f.dim_id = d.id
+ *		GROUP BY d.name
+ *
+ * we can aggregate fact by dim_id first, join the much smaller result to
+ * dim and finalize the aggregation by d.name.  Paths of that shape are added
+ * to partially_grouped_rel, and add_paths_to_grouping_rel finalizes them
+ * along with any other partially grouped paths; costing decides which wins.
+ *
+ * This is only possible if all the aggregates can be computed from the one
+ * base relation.  Each partial group then consists of rows that agree on all
+ * the columns of the base relation used above it, so that all of them join
+ * to the same rows of the other relations, and combining the partial state
+ * once for each joined row gives the same result as aggregating the joined
+ * rows.  To be sure that rows in the same group are really
+ * indistinguishable, the equality operators of the grouping columns must
+ * imply image equality, as for B-Tree deduplication.
+ */
+static void
+add_eager_aggregation_paths(PlannerInfo *root, RelOptInfo *input_rel,
+							RelOptInfo *partially_grouped_rel,
+							GroupPathExtraData *extra)
+{
+	PathTarget *partial_target = partially_grouped_rel->reltarget;
+	List	   *aggrefs = NIL;
+	List	   *other_exprs = NIL;
+	Relids		agg_relids;
+	ListCell   *lc;
+	int			relid;
+
+	/* Separate the partial Aggrefs from the rest of the target */
+	foreach(lc, partial_target->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (IsA(expr, Aggref))
+			aggrefs = lappend(aggrefs, expr);
+		else
+			other_exprs = lappend(other_exprs, expr);
+	}
+
+	/*
+	 * Volatile functions in the aggregates' arguments must be evaluated once
+	 * for each joined row, so they would stop us.
+	 */
+	if (aggrefs == NIL || contain_volatile_functions((Node *) aggrefs))
+		return;
+
+	agg_relids = pull_varnos(root, (Node *) aggrefs);
+
+	if (bms_is_empty(agg_relids))
+	{
+		/* Aggregates like count(*) could be pushed to any relation */
+		relid = -1;
+		while ((relid = bms_next_member(input_rel->relids, relid)) >= 0)
+			try_eager_aggregation(root, input_rel, partially_grouped_rel,
+								  extra, find_base_rel(root, relid),
+								  aggrefs, other_exprs);
+	}
+	else if (bms_get_singleton_member(agg_relids, &relid))
+		try_eager_aggregation(root, input_rel, partially_grouped_rel,
+							  extra, find_base_rel(root, relid),
+							  aggrefs, other_exprs);
+}
+
+/*
+ * try_eager_aggregation
+ *
+ * Subroutine of add_eager_aggregation_paths: try partially aggregating rel,
+ * and joining it to the join relation of all the other relations.
+ */
+static void
+try_eager_aggregation(PlannerInfo *root, RelOptInfo *input_rel,
+					  RelOptInfo *partially_grouped_rel,
+					  GroupPathExtraData *extra,
+					  RelOptInfo *rel, List *aggrefs, List *other_exprs)
+{
+	PathTarget *partial_target = partially_grouped_rel->reltarget;
+	Relids		rest_relids;
+	RelOptInfo *rest_rel;
+	RelOptInfo *grouped_rel;
+	RelOptInfo *joinrel;
+	SpecialJoinInfo sjinfo;
+	PathTarget *input_target;
+	PathTarget *grouped_target;
+	List	   *restrictlist = NIL;
+	List	   *needed_vars;
+	List	   *group_vars = NIL;
+	List	   *group_clauses = NIL;
+	Index		sgref = 0;
+	Path	   *path;
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_BASEREL || IS_DUMMY_REL(rel) ||
+		rel->cheapest_total_path == NULL)
+		return;
+
+	/* Find the relation that the join search built for the other rels */
+	rest_relids = bms_difference(input_rel->relids, rel->relids);
+	if (bms_is_empty(rest_relids))
+		return;
+	if (bms_membership(rest_relids) == BMS_SINGLETON)
+		rest_rel = find_base_rel(root, bms_singleton_member(rest_relids));
+	else
+		rest_rel = find_join_rel(root, rest_relids);
+	if (rest_rel == NULL || rest_rel->pathlist == NIL || IS_DUMMY_REL(rest_rel))
+		return;
+
+	/* Collect the clauses joining the two, as build_joinrel_restrictlist */
+	foreach(lc, rel->joininfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (bms_is_subset(rinfo->required_relids, input_rel->relids))
+			restrictlist = list_append_unique_ptr(restrictlist, rinfo);
+	}
+	foreach(lc, rest_rel->joininfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (bms_is_subset(rinfo->required_relids, input_rel->relids))
+			restrictlist = list_append_unique_ptr(restrictlist, rinfo);
+	}
+	restrictlist = list_concat(restrictlist,
+							   generate_join_implied_equalities(root,
+																input_rel->relids,
+																rest_relids,
+																rel));
+
+	/* There's no point in aggregating by nothing before a cartesian join */
+	if (restrictlist == NIL)
+		return;
+
+	/*
+	 * The partial aggregation must group by all the columns of rel that are
+	 * needed above it: those used by the rest of the grouping target, by the
+	 * join clauses, and by equivalence classes that might be used to build
+	 * parameterized paths for the other side.
+	 */
+	needed_vars = pull_var_clause((Node *) other_exprs,
+								  PVC_INCLUDE_PLACEHOLDERS);
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		needed_vars = list_concat(needed_vars,
+								  pull_var_clause((Node *) rinfo->clause,
+												  PVC_INCLUDE_PLACEHOLDERS));
+	}
+	foreach(lc, root->eq_classes)
+	{
+		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc);
+		ListCell   *lc2;
+
+		if (ec->ec_has_const ||
+			!bms_overlap(ec->ec_relids, rel->relids) ||
+			!bms_overlap(ec->ec_relids, rest_relids))
+			continue;
+
+		foreach(lc2, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+
+			if (!em->em_is_child && bms_equal(em->em_relids, rel->relids))
+				needed_vars = list_concat(needed_vars,
+										  pull_var_clause((Node *) em->em_expr,
+														  PVC_INCLUDE_PLACEHOLDERS));
+		}
+	}
+
+	foreach(lc, needed_vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		Oid			sortop;
+		Oid			eqop;
+		bool		hashable;
+		Oid			opfamily;
+		Oid			opcintype;
+		int16		strategy;
+		Oid			equalimageproc;
+		SortGroupClause *grpcl;
+
+		if (!IsA(var, Var))
+			return;				/* shouldn't happen, but be safe */
+		if (var->varno != rel->relid || list_member(group_vars, var))
+			continue;
+
+		/* We only do hashed partial aggregation; see above about images */
+		get_sort_group_operators(var->vartype, false, false, false,
+								 &sortop, &eqop, NULL, &hashable);
+		if (!OidIsValid(sortop) || !OidIsValid(eqop) || !hashable ||
+			!get_ordering_op_properties(sortop, &opfamily, &opcintype,
+										&strategy))
+			return;
+		equalimageproc = get_opfamily_proc(opfamily, opcintype, opcintype,
+										   BTEQUALIMAGE_PROC);
+		if (!OidIsValid(equalimageproc) ||
+			!DatumGetBool(OidFunctionCall1Coll(equalimageproc,
+											   var->varcollid,
+											   ObjectIdGetDatum(opcintype))))
+			return;
+
+		grpcl = makeNode(SortGroupClause);
+		grpcl->tleSortGroupRef = ++sgref;
+		grpcl->eqop = eqop;
+		grpcl->sortop = sortop;
+		grpcl->nulls_first = false;
+		grpcl->hashable = true;
+
+		group_vars = lappend(group_vars, var);
+		group_clauses = lappend(group_clauses, grpcl);
+	}
+
+	/*
+	 * Build the targets: the aggregation's input is the grouping columns
+	 * plus whatever the aggregates need, and its output is the grouping
+	 * columns plus the partial Aggrefs of the upper partial target, so that
+	 * setrefs.c can match them up.
+	 */
+	input_target = create_empty_pathtarget();
+	grouped_target = create_empty_pathtarget();
+	sgref = 0;
+	foreach(lc, group_vars)
+	{
+		add_column_to_pathtarget(input_target, (Expr *) lfirst(lc), ++sgref);
+		add_column_to_pathtarget(grouped_target, (Expr *) lfirst(lc), 0);
+	}
+	add_new_columns_to_pathtarget(input_target,
+								  pull_var_clause((Node *) aggrefs,
+												  PVC_RECURSE_AGGREGATES));
+	foreach(lc, aggrefs)
+		add_column_to_pathtarget(grouped_target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, input_target);
+	set_pathtarget_cost_width(root, grouped_target);
+
+	/*
+	 * Make a RelOptInfo for the grouped relation.  It masquerades as rel, so
+	 * that the join path machinery treats it like rel, with fewer rows.
+	 */
+	grouped_rel = makeNode(RelOptInfo);
+	memcpy(grouped_rel, rel, sizeof(RelOptInfo));
+	grouped_rel->reltarget = grouped_target;
+	grouped_rel->pathlist = NIL;
+	grouped_rel->ppilist = NIL;
+	grouped_rel->partial_pathlist = NIL;
+	grouped_rel->cheapest_startup_path = NULL;
+	grouped_rel->cheapest_total_path = NULL;
+	grouped_rel->cheapest_unique_path = NULL;
+	grouped_rel->cheapest_parameterized_paths = NIL;
+	grouped_rel->consider_parallel = false;
+	grouped_rel->unique_for_rels = NIL;
+	grouped_rel->non_unique_for_rels = NIL;
+	set_eager_agg_size_estimates(root, grouped_rel, rel, group_vars);
+
+	/* Not worth it unless the aggregation actually merges rows */
+	if (grouped_rel->rows >= rel->rows)
+		return;
+
+	path = (Path *) create_projection_path(root, rel,
+										   rel->cheapest_total_path,
+										   input_target);
+	path = (Path *) create_agg_path(root, grouped_rel, path,
+									grouped_target,
+									AGG_HASHED,
+									AGGSPLIT_INITIAL_SERIAL,
+									group_clauses,
+									NIL,
+									&extra->agg_partial_costs,
+									grouped_rel->rows);
+	add_path(grouped_rel, path);
+	set_cheapest(grouped_rel);
+
+	/*
+	 * Now join it to the other relations.  The join relation emits the
+	 * partial grouping target, which may compute grouping expressions.
+	 */
+	joinrel = makeNode(RelOptInfo);
+	joinrel->reloptkind = RELOPT_JOINREL;
+	joinrel->relids = bms_copy(input_rel->relids);
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->reltarget = partial_target;
+	joinrel->consider_startup = (root->tuple_fraction > 0);
+
+	sjinfo.type = T_SpecialJoinInfo;
+	sjinfo.min_lefthand = grouped_rel->relids;
+	sjinfo.min_righthand = rest_rel->relids;
+	sjinfo.syn_lefthand = grouped_rel->relids;
+	sjinfo.syn_righthand = rest_rel->relids;
+	sjinfo.jointype = JOIN_INNER;
+	/* we don't bother trying to make the remaining fields valid */
+	sjinfo.lhs_strict = false;
+	sjinfo.delay_upper_joins = false;
+	sjinfo.semi_can_btree = false;
+	sjinfo.semi_can_hash = false;
+	sjinfo.semi_operators = NIL;
+	sjinfo.semi_rhs_exprs = NIL;
+
+	set_joinrel_size_estimates(root, joinrel, grouped_rel, rest_rel,
+							   &sjinfo, restrictlist);
+
+	add_paths_to_joinrel(root, joinrel, grouped_rel, rest_rel,
+						 JOIN_INNER, &sjinfo, restrictlist);
+	add_paths_to_joinrel(root, joinrel, rest_rel, grouped_rel,
+						 JOIN_INNER, &sjinfo, restrictlist);
+
+	foreach(lc, joinrel->pathlist)
+	{
+		path = (Path *) lfirst(lc);
+
+		if (path->param_info != NULL)
+			continue;
+
+		add_path(partially_grouped_rel, (Path *)
+				 create_projection_path(root, partially_grouped_rel, path,
+										partial_target));
+	}
+}
+
 /*
  * can_partial_agg
  *
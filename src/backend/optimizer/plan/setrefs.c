@@ -796,6 +796,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			}
 
 		case T_Material:
+		case T_Redistribute:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
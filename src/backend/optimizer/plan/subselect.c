@@ -2242,6 +2242,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 	finalize_primnode_context context;
 	int			locally_added_param;
 	Bitmapset  *nestloop_params;
+	Bitmapset  *hashfilter_params;
 	Bitmapset  *initExtParam;
 	Bitmapset  *initSetParam;
 	Bitmapset  *child_params;
@@ -2254,6 +2255,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 	context.paramids = NULL;	/* initialize set to empty */
 	locally_added_param = -1;	/* there isn't one */
 	nestloop_params = NULL;		/* there aren't any */
+	hashfilter_params = NULL;	/* nor these */
 
 	/*
 	 * Examine any initPlans to determine the set of external params they
@@ -2552,9 +2554,10 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 
 		case T_Append:
 			{
+				Append	   *aplan = (Append *) plan;
 				ListCell   *l;
 
-				foreach(l, ((Append *) plan)->appendplans)
+				foreach(l, aplan->appendplans)
 				{
 					context.paramids =
 						bms_add_members(context.paramids,
@@ -2564,6 +2567,27 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 													  valid_params,
 													  scan_params));
 				}
+
+				/*
+				 * Run-time pruning may use Params that no child references,
+				 * such as those set by a Hash node's run-time filters.
+				 */
+				if (aplan->part_prune_info)
+				{
+					foreach(l, aplan->part_prune_info->prune_infos)
+					{
+						ListCell   *l2;
+
+						foreach(l2, (List *) lfirst(l))
+						{
+							PartitionedRelPruneInfo *pinfo = lfirst(l2);
+
+							context.paramids =
+								bms_add_members(context.paramids,
+												pinfo->execparamids);
+						}
+					}
+				}
 			}
 			break;
 
@@ -2643,10 +2667,22 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			break;
 
 		case T_HashJoin:
-			finalize_primnode((Node *) ((Join *) plan)->joinqual,
-							  &context);
-			finalize_primnode((Node *) ((HashJoin *) plan)->hashclauses,
-							  &context);
+			{
+				Hash	   *hash = castNode(Hash, plan->righttree);
+				ListCell   *l;
+
+				finalize_primnode((Node *) ((Join *) plan)->joinqual,
+								  &context);
+				finalize_primnode((Node *) ((HashJoin *) plan)->hashclauses,
+								  &context);
+				/* collect set of params the Hash node passes to left child */
+				foreach(l, hash->filterMinParams)
+					hashfilter_params = bms_add_member(hashfilter_params,
+													   lfirst_int(l));
+				foreach(l, hash->filterMaxParams)
+					hashfilter_params = bms_add_member(hashfilter_params,
+													   lfirst_int(l));
+			}
 			break;
 
 		case T_Limit:
@@ -2751,6 +2787,7 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 		case T_ProjectSet:
 		case T_Hash:
 		case T_Material:
+		case T_Redistribute:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -2765,11 +2802,26 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 	}
 
 	/* Process left and right child plans, if any */
-	child_params = finalize_plan(root,
-								 plan->lefttree,
-								 gather_param,
-								 valid_params,
-								 scan_params);
+	if (hashfilter_params)
+	{
+		/* left child can reference hashfilter_params as well */
+		child_params = finalize_plan(root,
+									 plan->lefttree,
+									 gather_param,
+									 bms_union(hashfilter_params, valid_params),
+									 scan_params);
+		/* ... and they don't count as parameters used at my level */
+		child_params = bms_difference(child_params, hashfilter_params);
+		bms_free(hashfilter_params);
+	}
+	else
+	{
+		child_params = finalize_plan(root,
+									 plan->lefttree,
+									 gather_param,
+									 valid_params,
+									 scan_params);
+	}
 	context.paramids = bms_add_members(context.paramids, child_params);
 
 	if (nestloop_params)
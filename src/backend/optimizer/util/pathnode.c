@@ -609,6 +609,13 @@ add_path(RelOptInfo *parent_rel, Path *new_path)
 			break;
 	}
 
+	if (planner_instrument)
+	{
+		planner_instrument->paths_considered++;
+		if (!accept_new)
+			planner_instrument->paths_rejected++;
+	}
+
 	if (accept_new)
 	{
 		/* Accept the new path: insert it at proper place in pathlist */
@@ -840,6 +847,13 @@ add_partial_path(RelOptInfo *parent_rel, Path *new_path)
 			break;
 	}
 
+	if (planner_instrument)
+	{
+		planner_instrument->paths_considered++;
+		if (!accept_new)
+			planner_instrument->paths_rejected++;
+	}
+
 	if (accept_new)
 	{
 		/* Accept the new path: insert it at proper place */
@@ -1910,6 +1924,45 @@ create_gather_merge_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	return pathnode;
 }
 
+/*
+ * create_redistribute_path
+ *	  Creates a path corresponding to a Redistribute plan, returning the
+ *	  pathnode.
+ *
+ * 'subpath' must be a partial path; the result is another partial path, in
+ * which all rows with equal values of the 'distClauses' columns are returned
+ * by the same participant.
+ */
+RedistributePath *
+create_redistribute_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+						 List *distClauses)
+{
+	RedistributePath *pathnode = makeNode(RedistributePath);
+
+	Assert(subpath->parallel_safe && subpath->parallel_workers > 0);
+	Assert(distClauses != NIL);
+
+	pathnode->path.pathtype = T_Redistribute;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = subpath->pathtarget;
+	pathnode->path.param_info = subpath->param_info;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	/* The partitions are read back in no particular order */
+	pathnode->path.pathkeys = NIL;
+
+	pathnode->subpath = subpath;
+	pathnode->distClauses = distClauses;
+
+	cost_redistribute(&pathnode->path, list_length(distClauses),
+					  subpath->startup_cost, subpath->total_cost,
+					  subpath->rows, subpath->pathtarget->width);
+
+	return pathnode;
+}
+
 /*
  * translate_sub_tlist - get subquery column numbers represented by tlist
  *
@@ -3583,10 +3583,8 @@ partition_rbound_datum_cmp(FmgrInfo *partsupfunc, Oid *partcollation,
 		else if (rb_kind[i] == PARTITION_RANGE_DATUM_MAXVALUE)
 			return 1;
 
-		cmpval = DatumGetInt32(FunctionCall2Coll(&partsupfunc[i],
-												 partcollation[i],
-												 rb_datums[i],
-												 tuple_datums[i]));
+		cmpval = partition_datum_cmp(&partsupfunc[i], partcollation[i],
+									 rb_datums[i], tuple_datums[i]);
 		if (cmpval != 0)
 			break;
 	}
@@ -3594,6 +3592,45 @@ partition_rbound_datum_cmp(FmgrInfo *partsupfunc, Oid *partcollation,
 	return cmpval;
 }
 
+/*
+ * partition_datum_cmp
+ *
+ * Compare two partition key values using the key's btree comparison
+ * function.  Tuple routing does this for every row it routes, so the
+ * function call is avoided for the most common partition key types.
+ */
+int32
+partition_datum_cmp(FmgrInfo *partsupfunc, Oid partcollation,
+					Datum datum1, Datum datum2)
+{
+	switch (partsupfunc->fn_oid)
+	{
+		case F_BTINT4CMP:
+		case F_DATE_CMP:
+			{
+				int32		a = DatumGetInt32(datum1);
+				int32		b = DatumGetInt32(datum2);
+
+				return (a > b) - (a < b);
+			}
+
+		case F_BTINT8CMP:
+		case F_TIMESTAMP_CMP:
+		case F_TIMESTAMPTZ_CMP:
+			{
+				int64		a = DatumGetInt64(datum1);
+				int64		b = DatumGetInt64(datum2);
+
+				return (a > b) - (a < b);
+			}
+
+		default:
+			return DatumGetInt32(FunctionCall2Coll(partsupfunc,
+												   partcollation,
+												   datum1, datum2));
+	}
+}
+
 /*
  * partition_hbound_cmp
  *
@@ -3635,10 +3672,8 @@ partition_list_bsearch(FmgrInfo *partsupfunc, Oid *partcollation,
 		int32		cmpval;
 
 		mid = (lo + hi + 1) / 2;
-		cmpval = DatumGetInt32(FunctionCall2Coll(&partsupfunc[0],
-												 partcollation[0],
-												 boundinfo->datums[mid][0],
-												 value));
+		cmpval = partition_datum_cmp(&partsupfunc[0], partcollation[0],
+									 boundinfo->datums[mid][0], value);
 		if (cmpval <= 0)
 		{
 			lo = mid;
@@ -4759,10 +4794,34 @@ compute_partition_hash_value(int partnatts, FmgrInfo *partsupfunc, Oid *partcoll
 			/*
 			 * Compute hash for each datum value by calling respective
 			 * datatype-specific hash functions of each partition key
-			 * attribute.
+			 * attribute.  Integer keys are hashed inline, the same way
+			 * hashint4extended() and hashint8extended() do it.
 			 */
-			hash = FunctionCall2Coll(&partsupfunc[i], partcollation[i],
-									 values[i], seed);
+			switch (partsupfunc[i].fn_oid)
+			{
+				case F_HASHINT4EXTENDED:
+					hash = UInt64GetDatum(hash_uint32_extended(DatumGetInt32(values[i]),
+															   HASH_PARTITION_SEED));
+					break;
+
+				case F_HASHINT8EXTENDED:
+					{
+						int64		val = DatumGetInt64(values[i]);
+						uint32		lohalf = (uint32) val;
+						uint32		hihalf = (uint32) (val >> 32);
+
+						lohalf ^= (val >= 0) ? hihalf : ~hihalf;
+						hash = UInt64GetDatum(hash_uint32_extended(lohalf,
+																   HASH_PARTITION_SEED));
+					}
+					break;
+
+				default:
+					hash = FunctionCall2Coll(&partsupfunc[i],
+											 partcollation[i],
+											 values[i], seed);
+					break;
+			}
 
 			/* Form a single 64-bit hash value */
 			rowHash = hash_combine64(rowHash, DatumGetUInt64(hash));
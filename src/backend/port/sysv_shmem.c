@@ -30,6 +30,9 @@
 #ifdef HAVE_SYS_SHM_H
 #include <sys/shm.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
@@ -574,6 +577,83 @@ GetHugePageSize(Size *hugepagesize, int *mmap_flags)
 #endif							/* MAP_HUGETLB */
 }
 
+#if defined(__linux__) && defined(SYS_mbind)
+
+/* From <linux/mempolicy.h>, which we'd rather not depend on */
+#define PG_MPOL_INTERLEAVE	3
+
+/* Highest NUMA node number we know how to describe to mbind() */
+#define PG_MAX_NUMA_NODE	1023
+
+/*
+ * Ask the kernel to spread the pages of a newly created segment round-robin
+ * over all online NUMA nodes, rather than placing each page on the node of
+ * the process that first touches it.  Without this, shared_buffers tends to
+ * end up concentrated on whichever nodes happened to run the processes that
+ * first read data in, and backends on the other nodes pay remote memory
+ * latency for most buffer accesses.
+ *
+ * This must be done before any page of the segment has been touched.
+ * Failure is not fatal; the segment just keeps the default placement.
+ */
+static void
+InterleaveAnonymousSegment(void *ptr, Size size)
+{
+	unsigned long nodemask[(PG_MAX_NUMA_NODE + 1) / (8 * sizeof(unsigned long))];
+	FILE	   *fp;
+	int			maxnode = -1;
+	int			nnodes = 0;
+	int			first,
+				last;
+	char		sep;
+
+	memset(nodemask, 0, sizeof(nodemask));
+
+	/* The online nodes are listed as ranges, like "0-3,6" */
+	fp = AllocateFile("/sys/devices/system/node/online", "r");
+	if (fp == NULL)
+	{
+		elog(DEBUG1, "could not read NUMA node list, not interleaving shared memory");
+		return;
+	}
+	while (fscanf(fp, "%d", &first) == 1)
+	{
+		last = first;
+		sep = fgetc(fp);
+		if (sep == '-')
+		{
+			if (fscanf(fp, "%d", &last) != 1)
+				break;
+			sep = fgetc(fp);
+		}
+		for (int node = first; node <= last && node <= PG_MAX_NUMA_NODE; node++)
+		{
+			nodemask[node / (8 * sizeof(unsigned long))] |=
+				1UL << (node % (8 * sizeof(unsigned long)));
+			maxnode = Max(maxnode, node);
+			nnodes++;
+		}
+		if (sep != ',')
+			break;
+	}
+	FreeFile(fp);
+
+	/* Nothing to gain on a machine with a single node */
+	if (nnodes < 2)
+		return;
+
+	/* mbind() wants one more than the number of bits in the mask */
+	if (syscall(SYS_mbind, ptr, (unsigned long) size, PG_MPOL_INTERLEAVE,
+				nodemask, (unsigned long) maxnode + 2, 0) != 0)
+		ereport(LOG,
+				(errmsg("could not interleave shared memory across NUMA nodes: %m")));
+	else
+		elog(DEBUG1, "interleaving %zu bytes of shared memory across %d NUMA nodes",
+			 size, nnodes);
+}
+
+#endif							/* __linux__ && SYS_mbind */
+
 /*
  * Creates an anonymous mmap()ed shared memory segment.
  *
@@ -641,6 +721,11 @@ CreateAnonymousSegment(Size *size)
 						 allocsize) : 0));
 	}
 
+#if defined(__linux__) && defined(SYS_mbind)
+	if (shared_memory_numa_interleave)
+		InterleaveAnonymousSegment(ptr, allocsize);
+#endif
+
 	*size = allocsize;
 	return ptr;
 }
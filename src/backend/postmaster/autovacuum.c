@@ -185,6 +185,22 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/*
+ * struct to keep track of tables to vacuum and/or analyze, in 1st pass,
+ * together with how urgently they need it
+ */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	double		ac_priority;	/* see relation_needs_vacanalyze */
+} av_candidate;
+
+/*
+ * Priorities of tables that are vacuumed to prevent wraparound are offset by
+ * this much, so that they come before all others.
+ */
+#define AV_WRAPAROUND_PRIORITY	1.0e12
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -336,15 +352,14 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  Form_pg_class classForm,
 									  PgStat_StatTabEntry *tabentry,
 									  int effective_multixact_freeze_max_age,
-									  bool *dovacuum, bool *doanalyze, bool *wraparound);
+									  bool *dovacuum, bool *doanalyze, bool *wraparound,
+									  double *priority);
+static int	av_candidate_cmp(const ListCell *a, const ListCell *b);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 										 TupleDesc pg_class_desc);
-static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
-													  PgStat_StatDBEntry *shared,
-													  PgStat_StatDBEntry *dbentry);
 static void perform_work_item(AutoVacuumWorkItem *workitem);
 static void autovac_report_activity(autovac_table *tab);
 static void autovac_report_workitem(AutoVacuumWorkItem *workitem,
@@ -1688,7 +1703,7 @@ AutoVacWorkerMain(int argc, char *argv[])
 		char		dbname[NAMEDATALEN];
 
 		/*
-		 * Report autovac startup to the stats collector.  We deliberately do
+		 * Report autovac startup to the cumulative stats system.  We deliberately do
 		 * this before InitPostgres, so that the last_autovac_time will get
 		 * updated even if the connection attempt fails.  This is to prevent
 		 * autovac from getting "stuck" repeatedly selecting an unopenable
@@ -1961,12 +1976,11 @@ do_autovacuum(void)
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
 	List	   *table_oids = NIL;
+	List	   *candidates = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
 	ListCell   *volatile cell;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
 	BufferAccessStrategy bstrategy;
 	ScanKeyData key;
 	TupleDesc	pg_class_desc;
@@ -1985,17 +1999,11 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_SIZES);
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/*
-	 * may be NULL if we couldn't find an entry (only happens if we are
-	 * forcing a vacuum for anti-wrap purposes).
-	 */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* Start a transaction so our commands have one to play into. */
 	StartTransactionCommand();
 
 	/*
-	 * Clean up any dead statistics collector entries for this DB. We always
+	 * Clean up any dead shared statistics entries for this DB. We always
 	 * want to do this exactly once per DB-processing cycle, even if we find
 	 * nothing worth vacuuming in the database.
 	 */
@@ -2038,9 +2046,6 @@ do_autovacuum(void)
 	/* StartTransactionCommand changed elsewhere */
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/* The database hash where pgstat keeps shared relations */
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-
 	classRel = table_open(RelationRelationId, AccessShareLock);
 
 	/* create a copy so we can use it after closing pg_class */
@@ -2084,6 +2089,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		priority;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2118,17 +2124,24 @@ do_autovacuum(void)
 
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+												  relid);
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &priority);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc(sizeof(av_candidate));
+
+			cand->ac_relid = relid;
+			cand->ac_priority = priority;
+			candidates = lappend(candidates, cand);
+		}
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2177,6 +2190,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		priority;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2202,21 +2216,43 @@ do_autovacuum(void)
 		}
 
 		/* Fetch the pgstat entry for this table */
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+												  relid);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &priority);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc(sizeof(av_candidate));
+
+			cand->ac_relid = relid;
+			cand->ac_priority = priority;
+			candidates = lappend(candidates, cand);
+		}
 	}
 
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables most in need of attention first: those at risk of
+	 * wraparound, oldest first, then the ones that most exceed their vacuum
+	 * or analyze thresholds.  Without this, a table in urgent need would have
+	 * to wait for all tables before it in pg_class order.
+	 */
+	list_sort(candidates, av_candidate_cmp);
+	foreach(cell, candidates)
+	{
+		av_candidate *cand = (av_candidate *) lfirst(cell);
+
+		table_oids = lappend_oid(table_oids, cand->ac_relid);
+	}
+	list_free_deep(candidates);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2684,6 +2720,10 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_GINCleanPendingList:
+				DirectFunctionCall1(gin_clean_pending_list,
+									ObjectIdGetDatum(workitem->avw_relation));
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -2767,30 +2807,6 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 	return av;
 }
 
-/*
- * get_pgstat_tabentry_relid
- *
- * Fetch the pgstat entry of a table, either local to a database or shared.
- */
-static PgStat_StatTabEntry *
-get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry)
-{
-	PgStat_StatTabEntry *tabentry = NULL;
-
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
-
-	return tabentry;
-}
-
 /*
  * table_recheck_autovac
  *
@@ -3000,21 +3016,14 @@ recheck_relation_needs_vacanalyze(Oid relid,
 								  bool *wraparound)
 {
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared = NULL;
-	PgStat_StatDBEntry *dbentry = NULL;
-
-	if (classForm->relisshared)
-		shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	else
-		dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
 
 	/* fetch the pgstat table entry */
-	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+	tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+											  relid);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  dovacuum, doanalyze, wraparound);
+							  dovacuum, doanalyze, wraparound, NULL);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -3040,7 +3049,7 @@ recheck_relation_needs_vacanalyze(Oid relid,
  *
  * For analyze, the analysis done is that the number of tuples inserted,
  * deleted and updated since the last analyze exceeds a threshold calculated
- * in the same fashion as above.  Note that the collector actually stores
+ * in the same fashion as above.  Note that pgstat actually stores
  * the number of tuples (both live and dead) that there were as of the last
  * analyze.  This is asymmetric to the VACUUM case.
  *
@@ -3050,13 +3059,19 @@ recheck_relation_needs_vacanalyze(Oid relid,
  *
  * A table whose autovacuum_enabled option is false is
  * automatically skipped (unless we have to vacuum it due to freeze_max_age).
- * Thus autovacuum can be disabled for specific tables. Also, when the stats
- * collector does not have data about a table, it will be skipped.
+ * Thus autovacuum can be disabled for specific tables. Also, when pgstat
+ * does not have data about a table, it will be skipped.
  *
  * A table whose vac_base_thresh value is < 0 takes the base value from the
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
  * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ *
+ * If priority isn't NULL, we also return how urgently the table needs work,
+ * for ordering the tables to process.  For a table at risk of wraparound,
+ * that's AV_WRAPAROUND_PRIORITY plus the age of its relfrozenxid or
+ * relminmxid, whichever is older.  Otherwise, it's the largest factor by
+ * which the dead, inserted or changed tuples exceed their threshold.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -3067,7 +3082,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *priority)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -3159,6 +3175,22 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	if (priority)
+	{
+		*priority = 0;
+		if (force_vacuum)
+		{
+			double		xid_age = 0;
+			double		mxid_age = 0;
+
+			if (TransactionIdIsNormal(classForm->relfrozenxid))
+				xid_age = (uint32) (recentXid - classForm->relfrozenxid);
+			if (MultiXactIdIsValid(classForm->relminmxid))
+				mxid_age = (uint32) (recentMulti - classForm->relminmxid);
+			*priority = AV_WRAPAROUND_PRIORITY + Max(xid_age, mxid_age);
+		}
+	}
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
@@ -3207,6 +3239,14 @@ relation_needs_vacanalyze(Oid relid,
 		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
 			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		if (priority && !force_vacuum)
+		{
+			*priority = vactuples / Max(vacthresh, 1);
+			if (vac_ins_base_thresh >= 0)
+				*priority = Max(*priority, instuples / Max(vacinsthresh, 1));
+			*priority = Max(*priority, anltuples / Max(anlthresh, 1));
+		}
 	}
 	else
 	{
@@ -3224,6 +3264,22 @@ relation_needs_vacanalyze(Oid relid,
 		*doanalyze = false;
 }
 
+/*
+ * list_sort comparator for av_candidate entries, most urgent first
+ */
+static int
+av_candidate_cmp(const ListCell *a, const ListCell *b)
+{
+	av_candidate *ca = (av_candidate *) lfirst(a);
+	av_candidate *cb = (av_candidate *) lfirst(b);
+
+	if (ca->ac_priority > cb->ac_priority)
+		return -1;
+	if (ca->ac_priority < cb->ac_priority)
+		return 1;
+	return 0;
+}
+
 /*
  * autovacuum_do_vac_analyze
  *		Vacuum and/or analyze the specified table
@@ -3306,6 +3362,10 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_GINCleanPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
 	}
 
 	/*
@@ -3342,7 +3402,8 @@ AutoVacuumingActive(void)
 
 /*
  * Request one work item to the next autovacuum run processing our database.
- * Return false if the request can't be recorded.
+ * Return false if the request can't be recorded.  An identical request that
+ * hasn't been started yet counts as recorded.
  */
 bool
 AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
@@ -3361,7 +3422,18 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
 
 		if (workitem->avw_used)
+		{
+			if (!workitem->avw_active &&
+				workitem->avw_type == type &&
+				workitem->avw_database == MyDatabaseId &&
+				workitem->avw_relation == relationId &&
+				workitem->avw_blockNumber == blkno)
+			{
+				result = true;
+				break;
+			}
 			continue;
+		}
 
 		workitem->avw_used = true;
 		workitem->avw_active = false;
@@ -3478,8 +3550,8 @@ AutoVacuumShmemInit(void)
  *
  * Cause the next pgstats read operation to obtain fresh data, but throttle
  * such refreshing in the autovacuum launcher.  This is mostly to avoid
- * rereading the pgstats files too many times in quick succession when there
- * are many databases.
+ * rebuilding the pgstats snapshot too many times in quick succession when
+ * there are many databases.
  *
  * Note: we avoid throttling in the autovac worker, as it would be
  * counterproductive in the recheck logic.
@@ -500,6 +500,10 @@ CheckpointerMain(void)
 		/* Send WAL statistics to the stats collector. */
 		pgstat_send_wal(true);
 
+		/* Likewise for I/O and wait event statistics. */
+		pgstat_send_io();
+		pgstat_send_wait_events();
+
 		/*
 		 * If any checkpoint flags have been set, redo the loop to handle the
 		 * checkpoint without sleeping.
@@ -718,6 +722,8 @@ CheckpointWriteDelay(int flags, double progress)
 		 * Report interim activity statistics.
 		 */
 		pgstat_send_checkpointer();
+		pgstat_send_io();
+		pgstat_send_wait_events();
 
 		/*
 		 * This sleep used to be connected to bgwriter_delay, typically 200ms.
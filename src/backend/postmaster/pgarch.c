@@ -35,9 +35,11 @@
 
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
+#include "lib/binaryheap.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "postmaster/fork_process.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/pgarch.h"
 #include "storage/fd.h"
@@ -72,12 +74,36 @@
  */
 #define NUM_ORPHAN_CLEANUP_RETRIES 3
 
+/*
+ * Maximum number of .ready files to gather per directory scan.
+ */
+#define NUM_FILES_PER_DIRECTORY_SCAN 64
+
 /* Shared memory area for archiver process */
 typedef struct PgArchData
 {
 	int			pgprocno;		/* pgprocno of archiver process */
+
+	/* Forces a directory scan in pgarch_readyXlog() */
+	pg_atomic_uint32 force_dir_scan;
 } PgArchData;
 
+/*
+ * An archive_command running in a child process, when archive_parallelism
+ * is more than 1.
+ */
+typedef struct ArchiveJob
+{
+	pid_t		pid;
+	int			failures;		/* failed attempts to archive this file */
+	char		xlog[MAX_XFN_CHARS + 1];
+	char		command[MAXPGPATH];
+} ArchiveJob;
+
+/* GUC parameters */
+char	   *XLogArchiveLibrary = "";
+int			archive_parallelism = 1;
+
 
 /* ----------
  * Local data
@@ -86,6 +112,35 @@ typedef struct PgArchData
 static time_t last_sigterm_time = 0;
 static PgArchData *PgArch = NULL;
 
+/*
+ * Stuff for tracking multiple files to archive from each scan of
+ * archive_status.  Minimizing the number of directory scans when there are
+ * many files to archive can significantly improve archival rate.
+ *
+ * arch_heap is a max-heap that is used during the directory scan to track
+ * the highest-priority files to archive.  After the directory scan
+ * completes, the file names are stored in ascending order of priority in
+ * arch_files.  pgarch_readyXlog() returns files from arch_files until it
+ * is empty, at which point another directory scan must be performed.
+ */
+struct arch_files_state
+{
+	binaryheap *arch_heap;
+	int			arch_files_size;	/* number of live entries in arch_files[] */
+	char	   *arch_files[NUM_FILES_PER_DIRECTORY_SCAN];
+	/* buffers underlying heap, and later arch_files[], entries: */
+	char		arch_filenames[NUM_FILES_PER_DIRECTORY_SCAN][MAX_XFN_CHARS + 1];
+};
+
+static struct arch_files_state *arch_files = NULL;
+
+/* Callbacks of the loaded archive module, if any */
+static ArchiveModuleCallbacks ArchiveContext;
+
+/* archive_command children that are running */
+static ArchiveJob ArchiveJobs[MAX_ARCHIVE_PARALLELISM];
+static int	NumArchiveJobs = 0;
+
 /*
  * Flags set by interrupt handlers for later service in the main loop.
  */
@@ -96,13 +151,24 @@ static volatile sig_atomic_t ready_to_stop = false;
  * ----------
  */
 static void pgarch_waken_stop(SIGNAL_ARGS);
+static void pgarch_child_exit(SIGNAL_ARGS);
 static void pgarch_MainLoop(void);
 static void pgarch_ArchiverCopyLoop(void);
+#ifndef WIN32
+static void pgarch_ArchiverCopyLoopParallel(void);
+static bool pgarch_startJob(ArchiveJob *job);
+#endif
 static bool pgarch_archiveXlog(char *xlog);
+static void pgarch_buildCommand(const char *xlog, char *xlogarchcmd);
+static void pgarch_reportCommandFailure(int rc, const char *xlogarchcmd);
+static bool pgarch_archivingConfigured(void);
 static bool pgarch_readyXlog(char *xlog);
 static void pgarch_archiveDone(char *xlog);
 static void pgarch_die(int code, Datum arg);
 static void HandlePgArchInterrupts(void);
+static int	ready_file_comparator(Datum a, Datum b, void *arg);
+static void LoadArchiveLibrary(void);
+static void pgarch_call_module_shutdown_cb(int code, Datum arg);
 
 /* Report shared memory space needed by PgArchShmemInit */
 Size
@@ -129,6 +195,7 @@ PgArchShmemInit(void)
 		/* First time through, so initialize */
 		MemSet(PgArch, 0, PgArchShmemSize());
 		PgArch->pgprocno = INVALID_PGPROCNO;
+		pg_atomic_init_u32(&PgArch->force_dir_scan, 0);
 	}
 }
 
@@ -180,8 +247,8 @@ PgArchiverMain(void)
 	pqsignal(SIGUSR1, procsignal_sigusr1_handler);
 	pqsignal(SIGUSR2, pgarch_waken_stop);
 
-	/* Reset some signals that are accepted by postmaster but not here */
-	pqsignal(SIGCHLD, SIG_DFL);
+	/* Wake up when an archive_command run in the background finishes */
+	pqsignal(SIGCHLD, pgarch_child_exit);
 
 	/* Unblock signals (they were blocked when the postmaster forked us) */
 	PG_SETMASK(&UnBlockSig);
@@ -198,6 +265,15 @@ PgArchiverMain(void)
 	 */
 	PgArch->pgprocno = MyProc->pgprocno;
 
+	/* Initialize our max-heap for prioritizing files to archive. */
+	arch_files = palloc(sizeof(struct arch_files_state));
+	arch_files->arch_heap = binaryheap_allocate(NUM_FILES_PER_DIRECTORY_SCAN,
+												ready_file_comparator, NULL);
+	arch_files->arch_files_size = 0;
+
+	/* Load the archive_library. */
+	LoadArchiveLibrary();
+
 	pgarch_MainLoop();
 
 	proc_exit(0);
@@ -222,6 +298,20 @@ PgArchWakeup(void)
 }
 
 
+/*
+ * Force a directory scan for files to archive
+ *
+ * Signals the archiver not to archive the files it found in its last scan
+ * of archive_status before looking again, so that a newly created
+ * timeline history file, which must be archived first, isn't delayed.
+ */
+void
+PgArchForceDirScan(void)
+{
+	pg_atomic_write_u32(&PgArch->force_dir_scan, 1);
+}
+
+
 /* SIGUSR2 signal handler for archiver process */
 static void
 pgarch_waken_stop(SIGNAL_ARGS)
@@ -235,6 +325,17 @@ pgarch_waken_stop(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
+/* SIGCHLD signal handler for archiver process */
+static void
+pgarch_child_exit(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
 /*
  * pgarch_MainLoop
  *
@@ -315,6 +416,7 @@ pgarch_MainLoop(void)
 	} while (!time_to_stop);
 }
 
+
 /*
  * pgarch_ArchiverCopyLoop
  *
@@ -325,6 +427,15 @@ pgarch_ArchiverCopyLoop(void)
 {
 	char		xlog[MAX_XFN_CHARS + 1];
 
+#ifndef WIN32
+	/* archive_command can be run for several files at once */
+	if (archive_parallelism > 1 && ArchiveContext.archive_file_cb == NULL)
+	{
+		pgarch_ArchiverCopyLoopParallel();
+		return;
+	}
+#endif
+
 	/*
 	 * loop through all xlogs with archive_status of .ready and archive
 	 * them...mostly we expect this to be a single file, though it is possible
@@ -358,13 +469,9 @@ pgarch_ArchiverCopyLoop(void)
 			 */
 			HandlePgArchInterrupts();
 
-			/* can't do anything if no command ... */
-			if (!XLogArchiveCommandSet())
-			{
-				ereport(WARNING,
-						(errmsg("archive_mode enabled, yet archive_command is not set")));
+			/* can't do anything if not configured ... */
+			if (!pgarch_archivingConfigured())
 				return;
-			}
 
 			/*
 			 * Since archive status files are not removed in a durable manner,
@@ -397,6 +504,9 @@ pgarch_ArchiverCopyLoop(void)
 							(errmsg("removal of orphan archive status file \"%s\" failed too many times, will try again later",
 									xlogready)));
 
+					/* force a directory scan next time, to find it again */
+					arch_files->arch_files_size = 0;
+
 					/* give up cleanup of orphan status files */
 					return;
 				}
@@ -432,6 +542,10 @@ pgarch_ArchiverCopyLoop(void)
 					ereport(WARNING,
 							(errmsg("archiving write-ahead log file \"%s\" failed too many times, will try again later",
 									xlog)));
+
+					/* force a directory scan next time, to find it again */
+					arch_files->arch_files_size = 0;
+
 					return;		/* give up archiving for now */
 				}
 				pg_usleep(1000000L);	/* wait a bit before retrying */
@@ -440,10 +554,206 @@ pgarch_ArchiverCopyLoop(void)
 	}
 }
 
+#ifndef WIN32
+/*
+ * pgarch_ArchiverCopyLoopParallel
+ *
+ * Like pgarch_ArchiverCopyLoop, but keeps up to archive_parallelism
+ * archive_commands running in child processes.  Files are started in the
+ * order pgarch_readyXlog returns them, but can finish in any order.
+ */
+static void
+pgarch_ArchiverCopyLoopParallel(void)
+{
+	bool		more_files = true;
+	bool		give_up = false;
+
+	for (;;)
+	{
+		int			status;
+		pid_t		pid;
+		int			i;
+		ArchiveJob	job;
+
+		/* Start archive commands until all slots are busy */
+		while (!give_up && more_files && NumArchiveJobs < archive_parallelism)
+		{
+			ArchiveJob *newjob = &ArchiveJobs[NumArchiveJobs];
+			struct stat stat_buf;
+			char		pathname[MAXPGPATH];
+
+			/* see pgarch_ArchiverCopyLoop */
+			if (ShutdownRequestPending || !PostmasterIsAlive())
+			{
+				give_up = true;
+				break;
+			}
+
+			HandlePgArchInterrupts();
+
+			if (!pgarch_archivingConfigured())
+			{
+				give_up = true;
+				break;
+			}
+
+			if (!pgarch_readyXlog(newjob->xlog))
+			{
+				more_files = false;
+				break;
+			}
+
+			/* remove orphan status files, as in pgarch_ArchiverCopyLoop */
+			snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", newjob->xlog);
+			if (stat(pathname, &stat_buf) != 0 && errno == ENOENT)
+			{
+				char		xlogready[MAXPGPATH];
+
+				StatusFilePath(xlogready, newjob->xlog, ".ready");
+				if (unlink(xlogready) == 0)
+					ereport(WARNING,
+							(errmsg("removed orphan archive status file \"%s\"",
+									xlogready)));
+				else
+				{
+					ereport(WARNING,
+							(errmsg("removal of orphan archive status file \"%s\" failed, will try again later",
+									xlogready)));
+					give_up = true;
+				}
+				continue;
+			}
+
+			newjob->failures = 0;
+			if (!pgarch_startJob(newjob))
+			{
+				give_up = true;
+				break;
+			}
+			NumArchiveJobs++;
+		}
+
+		if (NumArchiveJobs == 0)
+			break;
+
+		/* Collect a finished archive command, or wait for one */
+		pid = waitpid(-1, &status, WNOHANG);
+		if (pid == 0)
+		{
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+							 1000L,
+							 WAIT_EVENT_ARCHIVE_COMMAND);
+			ResetLatch(MyLatch);
+
+			/* We might have been woken up because there are new files */
+			more_files = true;
+			continue;
+		}
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ereport(FATAL,
+					(errmsg("could not wait for archive command: %m")));
+		}
+
+		for (i = 0; i < NumArchiveJobs; i++)
+		{
+			if (ArchiveJobs[i].pid == pid)
+				break;
+		}
+		if (i == NumArchiveJobs)
+			continue;			/* not one of ours */
+
+		job = ArchiveJobs[i];
+		ArchiveJobs[i] = ArchiveJobs[--NumArchiveJobs];
+
+		if (status == 0)
+		{
+			elog(DEBUG1, "archived write-ahead log file \"%s\"", job.xlog);
+			pgarch_archiveDone(job.xlog);
+			pgstat_send_archiver(job.xlog, false);
+			continue;
+		}
+
+		pgarch_reportCommandFailure(status, job.command);
+		pgstat_send_archiver(job.xlog, true);
+
+		if (give_up)
+			continue;
+
+		if (++job.failures >= NUM_ARCHIVE_RETRIES)
+		{
+			ereport(WARNING,
+					(errmsg("archiving write-ahead log file \"%s\" failed too many times, will try again later",
+							job.xlog)));
+			give_up = true;
+			continue;
+		}
+
+		/* wait a bit before retrying */
+		pg_usleep(1000000L);
+
+		ArchiveJobs[NumArchiveJobs] = job;
+		if (pgarch_startJob(&ArchiveJobs[NumArchiveJobs]))
+			NumArchiveJobs++;
+		else
+			give_up = true;
+	}
+
+	/*
+	 * If we gave up on any files, they have been taken off arch_files.  Force
+	 * a directory scan next time, to find them again.
+	 */
+	if (give_up)
+		arch_files->arch_files_size = 0;
+}
+
+/*
+ * pgarch_startJob
+ *
+ * Starts archive_command for job->xlog in a child process.  Returns false if
+ * the process can't be started.
+ */
+static bool
+pgarch_startJob(ArchiveJob *job)
+{
+	char		activitymsg[MAXFNAMELEN + 16];
+
+	pgarch_buildCommand(job->xlog, job->command);
+
+	ereport(DEBUG3,
+			(errmsg_internal("executing archive command \"%s\"",
+							 job->command)));
+
+	job->pid = fork_process();
+	if (job->pid == 0)
+	{
+		/* in the child: run the command like system(3) would */
+		execl("/bin/sh", "sh", "-c", job->command, (char *) NULL);
+		_exit(127);
+	}
+	if (job->pid < 0)
+	{
+		ereport(LOG,
+				(errmsg("could not fork archive command process: %m")));
+		return false;
+	}
+
+	/* Report archive activity in PS display */
+	snprintf(activitymsg, sizeof(activitymsg), "archiving %s", job->xlog);
+	set_ps_display(activitymsg);
+
+	return true;
+}
+#endif							/* !WIN32 */
+
 /*
  * pgarch_archiveXlog
  *
- * Invokes system(3) to copy one archive file to wherever it should go
+ * Archives one file, using the archive module if one is loaded, else by
+ * invoking system(3) to run archive_command
  *
  * Returns true if successful
  */
@@ -453,16 +763,67 @@ pgarch_archiveXlog(char *xlog)
 	char		xlogarchcmd[MAXPGPATH];
 	char		pathname[MAXPGPATH];
 	char		activitymsg[MAXFNAMELEN + 16];
+	int			rc;
+
+	/* Report archive activity in PS display */
+	snprintf(activitymsg, sizeof(activitymsg), "archiving %s", xlog);
+	set_ps_display(activitymsg);
+
+	if (ArchiveContext.archive_file_cb != NULL)
+	{
+		snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", xlog);
+
+		if (!ArchiveContext.archive_file_cb(xlog, pathname))
+		{
+			snprintf(activitymsg, sizeof(activitymsg), "failed on %s", xlog);
+			set_ps_display(activitymsg);
+
+			return false;
+		}
+	}
+	else
+	{
+		pgarch_buildCommand(xlog, xlogarchcmd);
+
+		ereport(DEBUG3,
+				(errmsg_internal("executing archive command \"%s\"",
+								 xlogarchcmd)));
+
+		rc = system(xlogarchcmd);
+		if (rc != 0)
+		{
+			pgarch_reportCommandFailure(rc, xlogarchcmd);
+
+			snprintf(activitymsg, sizeof(activitymsg), "failed on %s", xlog);
+			set_ps_display(activitymsg);
+
+			return false;
+		}
+	}
+	elog(DEBUG1, "archived write-ahead log file \"%s\"", xlog);
+
+	snprintf(activitymsg, sizeof(activitymsg), "last was %s", xlog);
+	set_ps_display(activitymsg);
+
+	return true;
+}
+
+/*
+ * pgarch_buildCommand
+ *
+ * Constructs the archive_command to run for the given file into
+ * xlogarchcmd, which must have room for MAXPGPATH bytes
+ */
+static void
+pgarch_buildCommand(const char *xlog, char *xlogarchcmd)
+{
+	char		pathname[MAXPGPATH];
 	char	   *dp;
 	char	   *endp;
 	const char *sp;
-	int			rc;
 
 	snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", xlog);
 
-	/*
-	 * construct the command to be executed
-	 */
 	dp = xlogarchcmd;
 	endp = xlogarchcmd + MAXPGPATH - 1;
 	*endp = '\0';
@@ -506,72 +867,88 @@ pgarch_archiveXlog(char *xlog)
 		}
 	}
 	*dp = '\0';
+}
 
-	ereport(DEBUG3,
-			(errmsg_internal("executing archive command \"%s\"",
-							 xlogarchcmd)));
-
-	/* Report archive activity in PS display */
-	snprintf(activitymsg, sizeof(activitymsg), "archiving %s", xlog);
-	set_ps_display(activitymsg);
+/*
+ * pgarch_reportCommandFailure
+ *
+ * Reports that archive_command failed with the given wait status
+ */
+static void
+pgarch_reportCommandFailure(int rc, const char *xlogarchcmd)
+{
+	/*
+	 * If either the shell itself, or a called command, died on a signal,
+	 * abort the archiver.  We do this because system() ignores SIGINT and
+	 * SIGQUIT while waiting; so a signal is very likely something that should
+	 * have interrupted us too.  Also die if the shell got a hard "command not
+	 * found" type of error.  If we overreact it's no big deal, the postmaster
+	 * will just start the archiver again.
+	 */
+	int			lev = wait_result_is_any_signal(rc, true) ? FATAL : LOG;
 
-	rc = system(xlogarchcmd);
-	if (rc != 0)
+	if (WIFEXITED(rc))
+	{
+		ereport(lev,
+				(errmsg("archive command failed with exit code %d",
+						WEXITSTATUS(rc)),
+				 errdetail("The failed archive command was: %s",
+						   xlogarchcmd)));
+	}
+	else if (WIFSIGNALED(rc))
 	{
-		/*
-		 * If either the shell itself, or a called command, died on a signal,
-		 * abort the archiver.  We do this because system() ignores SIGINT and
-		 * SIGQUIT while waiting; so a signal is very likely something that
-		 * should have interrupted us too.  Also die if the shell got a hard
-		 * "command not found" type of error.  If we overreact it's no big
-		 * deal, the postmaster will just start the archiver again.
-		 */
-		int			lev = wait_result_is_any_signal(rc, true) ? FATAL : LOG;
-
-		if (WIFEXITED(rc))
-		{
-			ereport(lev,
-					(errmsg("archive command failed with exit code %d",
-							WEXITSTATUS(rc)),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
-		}
-		else if (WIFSIGNALED(rc))
-		{
 #if defined(WIN32)
-			ereport(lev,
-					(errmsg("archive command was terminated by exception 0x%X",
-							WTERMSIG(rc)),
-					 errhint("See C include file \"ntstatus.h\" for a description of the hexadecimal value."),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
+		ereport(lev,
+				(errmsg("archive command was terminated by exception 0x%X",
+						WTERMSIG(rc)),
+				 errhint("See C include file \"ntstatus.h\" for a description of the hexadecimal value."),
+				 errdetail("The failed archive command was: %s",
+						   xlogarchcmd)));
 #else
-			ereport(lev,
-					(errmsg("archive command was terminated by signal %d: %s",
-							WTERMSIG(rc), pg_strsignal(WTERMSIG(rc))),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
+		ereport(lev,
+				(errmsg("archive command was terminated by signal %d: %s",
+						WTERMSIG(rc), pg_strsignal(WTERMSIG(rc))),
+				 errdetail("The failed archive command was: %s",
+						   xlogarchcmd)));
 #endif
-		}
-		else
+	}
+	else
+	{
+		ereport(lev,
+				(errmsg("archive command exited with unrecognized status %d",
+						rc),
+				 errdetail("The failed archive command was: %s",
+						   xlogarchcmd)));
+	}
+}
+
+/*
+ * pgarch_archivingConfigured
+ *
+ * Checks that the archive module or archive_command is ready to archive
+ * files, with a WARNING if not
+ */
+static bool
+pgarch_archivingConfigured(void)
+{
+	if (ArchiveContext.archive_file_cb != NULL)
+	{
+		if (ArchiveContext.check_configured_cb != NULL &&
+			!ArchiveContext.check_configured_cb())
 		{
-			ereport(lev,
-					(errmsg("archive command exited with unrecognized status %d",
-							rc),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
+			ereport(WARNING,
+					(errmsg("archive_mode enabled, yet archive module is not configured")));
+			return false;
 		}
+		return true;
+	}
 
-		snprintf(activitymsg, sizeof(activitymsg), "failed on %s", xlog);
-		set_ps_display(activitymsg);
-
+	if (!XLogArchiveCommandSet())
+	{
+		ereport(WARNING,
+				(errmsg("archive_mode enabled, yet archive_command is not set")));
 		return false;
 	}
-	elog(DEBUG1, "archived write-ahead log file \"%s\"", xlog);
-
-	snprintf(activitymsg, sizeof(activitymsg), "last was %s", xlog);
-	set_ps_display(activitymsg);
-
 	return true;
 }
 
@@ -579,10 +956,10 @@ pgarch_archiveXlog(char *xlog)
  * pgarch_readyXlog
  *
  * Return name of the oldest xlog file that has not yet been archived.
- * No notification is set that file archiving is now in progress, so
- * this would need to be extended if multiple concurrent archival
- * tasks were created. If a failure occurs, we will completely
- * re-copy the file at the next available opportunity.
+ * No notification is set that file archiving is now in progress; if a
+ * failure occurs, we will completely re-copy the file at the next available
+ * opportunity.  Files whose archive_command is running in the background
+ * are skipped.
  *
  * It is important that we return the oldest, so that we archive xlogs
  * in order that they were written, for two reasons:
@@ -600,18 +977,50 @@ pgarch_archiveXlog(char *xlog)
 static bool
 pgarch_readyXlog(char *xlog)
 {
-	/*
-	 * open xlog status directory and read through list of xlogs that have the
-	 * .ready suffix, looking for earliest file. It is possible to optimise
-	 * this code, though only a single file is expected on the vast majority
-	 * of calls, so....
-	 */
 	char		XLogArchiveStatusDir[MAXPGPATH];
 	DIR		   *rldir;
 	struct dirent *rlde;
-	bool		found = false;
-	bool		historyFound = false;
 
+	/*
+	 * If a directory scan was requested, clear the stored file names and
+	 * proceed.
+	 */
+	if (pg_atomic_exchange_u32(&PgArch->force_dir_scan, 0) == 1)
+		arch_files->arch_files_size = 0;
+
+	/*
+	 * If we still have stored file names from the previous directory scan,
+	 * try to return one of those.  We check to make sure the status file is
+	 * still present, as it might have been removed or marked done since.
+	 */
+	while (arch_files->arch_files_size > 0)
+	{
+		struct stat st;
+		char		status_file[MAXPGPATH];
+		char	   *arch_file;
+
+		arch_files->arch_files_size--;
+		arch_file = arch_files->arch_files[arch_files->arch_files_size];
+		StatusFilePath(status_file, arch_file, ".ready");
+
+		if (stat(status_file, &st) == 0)
+		{
+			strcpy(xlog, arch_file);
+			return true;
+		}
+		else if (errno != ENOENT)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not stat file \"%s\": %m", status_file)));
+	}
+
+	/* arch_heap is probably empty, but let's make sure */
+	binaryheap_reset(arch_files->arch_heap);
+
+	/*
+	 * Open the archive status directory and read through the list of files
+	 * with the .ready suffix, looking for the earliest files.
+	 */
 	snprintf(XLogArchiveStatusDir, MAXPGPATH, XLOGDIR "/archive_status");
 	rldir = AllocateDir(XLogArchiveStatusDir);
 
@@ -619,7 +1028,8 @@ pgarch_readyXlog(char *xlog)
 	{
 		int			basenamelen = (int) strlen(rlde->d_name) - 6;
 		char		basename[MAX_XFN_CHARS + 1];
-		bool		ishistory;
+		char	   *arch_file;
+		bool		running = false;
 
 		/* Ignore entries with unexpected number of characters */
 		if (basenamelen < MIN_XFN_CHARS ||
@@ -638,32 +1048,94 @@ pgarch_readyXlog(char *xlog)
 		memcpy(basename, rlde->d_name, basenamelen);
 		basename[basenamelen] = '\0';
 
-		/* Is this a history file? */
-		ishistory = IsTLHistoryFileName(basename);
+		/* Ignore files that are being archived right now */
+		for (int i = 0; i < NumArchiveJobs; i++)
+		{
+			if (strcmp(ArchiveJobs[i].xlog, basename) == 0)
+			{
+				running = true;
+				break;
+			}
+		}
+		if (running)
+			continue;
 
 		/*
-		 * Consume the file to archive.  History files have the highest
-		 * priority.  If this is the first file or the first history file
-		 * ever, copy it.  In the presence of a history file already chosen as
-		 * target, ignore all other files except history files which have been
-		 * generated for an older timeline than what is already chosen as
-		 * target to archive.
+		 * Store the file in our max-heap if it has a high enough priority.
 		 */
-		if (!found || (ishistory && !historyFound))
+		if (arch_files->arch_heap->bh_size < NUM_FILES_PER_DIRECTORY_SCAN)
 		{
-			strcpy(xlog, basename);
-			found = true;
-			historyFound = ishistory;
+			/* If the heap isn't full yet, quickly add it. */
+			arch_file = arch_files->arch_filenames[arch_files->arch_heap->bh_size];
+			strcpy(arch_file, basename);
+			binaryheap_add_unordered(arch_files->arch_heap, CStringGetDatum(arch_file));
+
+			/* If we just filled the heap, make it a valid one. */
+			if (arch_files->arch_heap->bh_size == NUM_FILES_PER_DIRECTORY_SCAN)
+				binaryheap_build(arch_files->arch_heap);
 		}
-		else if (ishistory || !historyFound)
+		else if (ready_file_comparator(binaryheap_first(arch_files->arch_heap),
+									   CStringGetDatum(basename), NULL) > 0)
 		{
-			if (strcmp(basename, xlog) < 0)
-				strcpy(xlog, basename);
+			/*
+			 * Remove the lowest priority file and add the current one to the
+			 * heap.
+			 */
+			arch_file = DatumGetCString(binaryheap_remove_first(arch_files->arch_heap));
+			strcpy(arch_file, basename);
+			binaryheap_add(arch_files->arch_heap, CStringGetDatum(arch_file));
 		}
 	}
 	FreeDir(rldir);
 
-	return found;
+	/* If no files were found, simply return. */
+	if (arch_files->arch_heap->bh_size == 0)
+		return false;
+
+	/*
+	 * If we didn't fill the heap, we didn't make it a valid one.  Do that
+	 * now.
+	 */
+	if (arch_files->arch_heap->bh_size < NUM_FILES_PER_DIRECTORY_SCAN)
+		binaryheap_build(arch_files->arch_heap);
+
+	/*
+	 * Fill arch_files array with the files to archive in ascending order of
+	 * priority.
+	 */
+	arch_files->arch_files_size = arch_files->arch_heap->bh_size;
+	for (int i = 0; i < arch_files->arch_files_size; i++)
+		arch_files->arch_files[i] = DatumGetCString(binaryheap_remove_first(arch_files->arch_heap));
+
+	/* Return the highest priority file. */
+	arch_files->arch_files_size--;
+	strcpy(xlog, arch_files->arch_files[arch_files->arch_files_size]);
+
+	return true;
+}
+
+/*
+ * ready_file_comparator
+ *
+ * Compares the archival priority of the given files to archive.  If "a"
+ * has a higher priority than "b", a negative value will be returned.  If
+ * "b" has a higher priority than "a", a positive value will be returned.
+ * If "a" and "b" have equivalent values, 0 will be returned.
+ */
+static int
+ready_file_comparator(Datum a, Datum b, void *arg)
+{
+	char	   *a_str = DatumGetCString(a);
+	char	   *b_str = DatumGetCString(b);
+	bool		a_history = IsTLHistoryFileName(a_str);
+	bool		b_history = IsTLHistoryFileName(b_str);
+
+	/* Timeline history files always have the highest priority. */
+	if (a_history != b_history)
+		return a_history ? -1 : 1;
+
+	/* Priority is given to older files. */
+	return strcmp(a_str, b_str);
 }
 
 /*
@@ -712,7 +1184,77 @@ HandlePgArchInterrupts(void)
 
 	if (ConfigReloadPending)
 	{
+		char	   *archiveLib = pstrdup(XLogArchiveLibrary);
+		bool		archiveLibChanged;
+
 		ConfigReloadPending = false;
 		ProcessConfigFile(PGC_SIGHUP);
+
+		archiveLibChanged = strcmp(XLogArchiveLibrary, archiveLib) != 0;
+		pfree(archiveLib);
+
+		if (archiveLibChanged)
+		{
+			/*
+			 * There's no way to unload the old archive module, so exit and
+			 * let the postmaster start a new archiver, which will load the new
+			 * one.  We're called between archive commands, so no file is
+			 * being archived by this process right now; any archive_commands
+			 * running in the background are left to finish on their own, and
+			 * the files are archived again if their status wasn't updated.
+			 */
+			ereport(LOG,
+					(errmsg("restarting archiver process because value of "
+							"\"archive_library\" was changed")));
+
+			proc_exit(0);
+		}
 	}
 }
+
+/*
+ * LoadArchiveLibrary
+ *
+ * Loads the archiving callbacks into our local ArchiveContext.
+ */
+static void
+LoadArchiveLibrary(void)
+{
+	ArchiveModuleInit archive_init;
+
+	memset(&ArchiveContext, 0, sizeof(ArchiveModuleCallbacks));
+
+	/* Without an archive module, archive_command is used */
+	if (XLogArchiveLibrary[0] == '\0')
+		return;
+
+	/*
+	 * load_external_function() raises an ERROR for a missing library, which
+	 * is promoted to FATAL here; the postmaster will try again later.
+	 */
+	archive_init = (ArchiveModuleInit)
+		load_external_function(XLogArchiveLibrary,
+							   "_PG_archive_module_init", false, NULL);
+
+	if (archive_init == NULL)
+		ereport(ERROR,
+				(errmsg("archive modules have to define the symbol %s", "_PG_archive_module_init")));
+
+	(*archive_init) (&ArchiveContext);
+
+	if (ArchiveContext.archive_file_cb == NULL)
+		ereport(ERROR,
+				(errmsg("archive modules must register an archive callback")));
+
+	before_shmem_exit(pgarch_call_module_shutdown_cb, 0);
+}
+
+/*
+ * Call the shutdown callback of the loaded archive module, if defined.
+ */
+static void
+pgarch_call_module_shutdown_cb(int code, Datum arg)
+{
+	if (ArchiveContext.shutdown_cb != NULL)
+		ArchiveContext.shutdown_cb();
+}
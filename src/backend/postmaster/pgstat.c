@@ -1,15 +1,34 @@
 /* ----------
  * pgstat.c
  *
- *	All the statistics collector stuff hacked up in one big, ugly file.
- *
- *	TODO:	- Separate collector, postmaster and backend stuff
- *			  into different files.
- *
- *			- Add some automatic call for pgstat vacuuming.
- *
- *			- Add a pgstat config column to pg_database, so this
- *			  entire thing can be enabled/disabled on a per db basis.
+ *	Cumulative statistics system.
+ *
+ *	Backends accumulate counts in local memory while they work, and
+ *	periodically flush them, in batches, into statistics kept in shared
+ *	memory.  The batches use the message structs declared in pgstat.h; each
+ *	one is applied to shared memory by the process that built it.
+ *
+ *	Fixed-size cluster-wide statistics (archiver, bgwriter, checkpointer,
+ *	WAL, SLRU and replication slots) live in a struct in the main shared
+ *	memory segment, protected by a single LWLock.  Statistics of databases
+ *	live in a dshash table keyed by database OID, and each database entry
+ *	owns two more dshash tables holding its table and function statistics.
+ *	All of those are stored in a DSA area that is created in place in the
+ *	main shared memory segment, so it can grow as objects are added.
+ *
+ *	The dshash tables of a database may only be used while holding the lock
+ *	on the database entry, in shared mode at least.  Dropping the database's
+ *	statistics, or resetting them, takes the lock exclusively and replaces
+ *	the tables, bumping the entry's generation number so that other backends
+ *	know to re-attach.  The database lock is always taken before any lock on
+ *	the database's tables.
+ *
+ *	Readers copy entries out of shared memory the first time they are needed
+ *	in a transaction and keep returning the copy until the snapshot is
+ *	cleared, typically at end of transaction.
+ *
+ *	The statistics are written to disk at the end of every checkpoint and at
+ *	shutdown, and read back during startup.
  *
  *	Copyright (c) 2001-2021, PostgreSQL Global Development Group
  *
@@ -19,18 +38,6 @@
 #include "postgres.h"
 
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/param.h>
-#include <sys/time.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <signal.h>
-#include <time.h>
-#ifdef HAVE_SYS_SELECT_H
-#include <sys/select.h>
-#endif
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
@@ -38,35 +45,27 @@
 #include "access/transam.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlogprefetch.h"
 #include "catalog/catalog.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
-#include "common/ip.h"
 #include "executor/instrument.h"
-#include "libpq/libpq.h"
-#include "libpq/pqsignal.h"
-#include "mb/pg_wchar.h"
+#include "lib/dshash.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "postmaster/autovacuum.h"
-#include "postmaster/fork_process.h"
-#include "postmaster/interrupt.h"
-#include "postmaster/postmaster.h"
 #include "replication/slot.h"
-#include "replication/walsender.h"
-#include "storage/backendid.h"
-#include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
-#include "storage/latch.h"
 #include "storage/lmgr.h"
-#include "storage/pg_shmem.h"
-#include "storage/proc.h"
+#include "storage/lwlock.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
-#include "utils/guc.h"
+#include "utils/dsa.h"
 #include "utils/memutils.h"
-#include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
@@ -75,37 +74,23 @@
  * Timer definitions.
  * ----------
  */
-#define PGSTAT_STAT_INTERVAL	500 /* Minimum time between stats file
-									 * updates; in milliseconds. */
-
-#define PGSTAT_RETRY_DELAY		10	/* How long to wait between checks for a
-									 * new file; in milliseconds. */
-
-#define PGSTAT_MAX_WAIT_TIME	10000	/* Maximum time to wait for a stats
-										 * file update; in milliseconds. */
-
-#define PGSTAT_INQ_INTERVAL		640 /* How often to ping the collector for a
-									 * new file; in milliseconds. */
-
-#define PGSTAT_RESTART_INTERVAL 60	/* How often to attempt to restart a
-									 * failed statistics collector; in
-									 * seconds. */
-
-#define PGSTAT_POLL_LOOP_COUNT	(PGSTAT_MAX_WAIT_TIME / PGSTAT_RETRY_DELAY)
-#define PGSTAT_INQ_LOOP_COUNT	(PGSTAT_INQ_INTERVAL / PGSTAT_RETRY_DELAY)
-
-/* Minimum receive buffer size for the collector's socket. */
-#define PGSTAT_MIN_RCVBUF		(100 * 1024)
+#define PGSTAT_STAT_INTERVAL	500 /* Minimum time between flushes of
+									 * pending counts; in milliseconds. */
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the backend-local hash tables.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
-#define PGSTAT_REPLSLOT_HASH_SIZE	32
+
+/*
+ * Size of the part of the statistics DSA area that lives in the main shared
+ * memory segment.  Further space is allocated in DSM segments as needed.
+ */
+#define PGSTAT_DSA_INITIAL_SIZE	(256 * 1024)
 
 
 /* ----------
@@ -115,22 +100,23 @@
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 
-/* ----------
- * Built from GUC parameter
- * ----------
- */
-char	   *pgstat_stat_directory = NULL;
-char	   *pgstat_stat_filename = NULL;
-char	   *pgstat_stat_tmpname = NULL;
-
 /*
- * BgWriter and WAL global statistics counters.
- * Stored directly in a stats message structure so they can be sent
+ * BgWriter, WAL and I/O global statistics counters.
+ * Stored directly in a stats message structure so they can be applied
  * without needing to copy things around.  We assume these init to zeroes.
  */
 PgStat_MsgBgWriter PendingBgWriterStats;
 PgStat_MsgCheckpointer PendingCheckpointerStats;
 PgStat_MsgWal WalStats;
+PgStat_MsgIO PendingIOStats;
+
+/*
+ * Wait event statistics counts waiting to be flushed to shared memory, per
+ * slot of pgstat_wait_event_slot().  Times are in ticks until they're sent.
+ */
+PgStat_WaitEventCounts PendingWaitEvents[PGSTAT_WAIT_EVENT_SLOTS];
+PgStat_Counter PendingWaitHistograms[PGSTAT_WAIT_CLASSES][PGSTAT_WAIT_TIME_BUCKETS];
+bool		have_wait_event_stats = false;
 
 /*
  * WAL usage counters saved from pgWALUsage at the previous call to
@@ -159,28 +145,101 @@ static const char *const slru_names[] = {
 #define SLRU_NUM_ELEMENTS	lengthof(slru_names)
 
 /*
- * SLRU statistics counts waiting to be sent to the collector.  These are
- * stored directly in stats message format so they can be sent without needing
- * to copy things around.  We assume this variable inits to zeroes.  Entries
- * are one-to-one with slru_names[].
+ * SLRU statistics counts waiting to be flushed to shared memory.  These are
+ * stored directly in stats message format so they can be applied without
+ * needing to copy things around.  We assume this variable inits to zeroes.
+ * Entries are one-to-one with slru_names[].
  */
 static PgStat_MsgSLRU SLRUStats[SLRU_NUM_ELEMENTS];
 
 /* ----------
- * Local data
+ * Shared memory state
  * ----------
  */
-NON_EXEC_STATIC pgsocket pgStatSock = PGINVALID_SOCKET;
 
-static struct sockaddr_storage pgStatAddr;
+/*
+ * A database's entry in the shared database hash table.
+ */
+typedef struct PgStatShared_DBEntry
+{
+	PgStat_StatDBEntry stats;	/* must be first, starts with the hash key */
+	uint64		generation;		/* changes whenever the hashes are replaced */
+	dshash_table_handle tables; /* PgStat_StatTabEntry hash */
+	dshash_table_handle functions;	/* PgStat_StatFuncEntry hash */
+} PgStatShared_DBEntry;
+
+/*
+ * The statistics' control struct in the main shared memory segment.  The
+ * in-place DSA area follows it.
+ */
+typedef struct PgStat_ShmemControl
+{
+	void	   *raw_dsa_area;	/* the in-place DSA area */
+	dshash_table_handle db_hash;	/* PgStatShared_DBEntry hash */
+	pg_atomic_uint64 next_generation;	/* for PgStatShared_DBEntry */
+
+	/* lock protects all fields below */
+	LWLock		lock;
+	PgStat_GlobalStats global;
+	PgStat_ArchiverStats archiver;
+	PgStat_WalStats wal;
+	PgStat_IOStats io;
+	PgStat_SLRUStats slru[SLRU_NUM_ELEMENTS];
+
+	/*
+	 * One entry per replication slot, max_replication_slots of them.  Unused
+	 * entries have an empty slot name.
+	 */
+	PgStat_StatReplSlotEntry replslots[FLEXIBLE_ARRAY_MEMBER];
+} PgStat_ShmemControl;
+
+static const dshash_parameters db_hash_params = {
+	sizeof(Oid),
+	sizeof(PgStatShared_DBEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters tab_hash_params = {
+	sizeof(Oid),
+	sizeof(PgStat_StatTabEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters func_hash_params = {
+	sizeof(Oid),
+	sizeof(PgStat_StatFuncEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static PgStat_ShmemControl *pgStatShmem = NULL;
+
+/* Our attachment to the shared DSA area and database hash */
+static dsa_area *pgStatDSA = NULL;
+static dshash_table *pgStatSharedDBHash = NULL;
 
-static time_t last_pgstat_start_time;
+/*
+ * Our attachments to the table and function hashes of databases, so that we
+ * don't need to attach to them afresh every time.
+ */
+typedef struct PgStat_DBAttachment
+{
+	Oid			databaseid;		/* hash key */
+	uint64		generation;		/* generation of the hashes attached to */
+	dshash_table *tables;
+	dshash_table *functions;
+} PgStat_DBAttachment;
 
-static bool pgStatRunningInCollector = false;
+static HTAB *pgStatDBAttachments = NULL;
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * flushed to shared memory.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -215,14 +274,14 @@ typedef struct TabStatHashEntry
 static HTAB *pgStatTabHash = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
+ * Backends store per-function info that's waiting to be flushed to shared memory
  * in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
@@ -267,28 +326,28 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about the current snapshot of the shared statistics.  Database, table
+ * and function entries are copied into pgStatDBHash (and the per-database
+ * hashes hanging off it) the first time they are fetched; the fixed-size
+ * statistics are all copied into the variables below at once.
  */
+typedef struct PgStat_SnapshotDBEntry
+{
+	Oid			databaseid;		/* hash key */
+	PgStat_StatDBEntry *stats;	/* copy of shared entry; NULL if none */
+	HTAB	   *tables;			/* copied PgStat_StatTabEntry's, or NULL */
+	HTAB	   *functions;		/* copied PgStat_StatFuncEntry's, or NULL */
+} PgStat_SnapshotDBEntry;
+
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
+static bool have_global_snapshot = false;
 
-/*
- * Cluster wide statistics, kept in the stats collector.
- * Contains statistics that are not collected per database
- * or per table.
- */
 static PgStat_ArchiverStats archiverStats;
 static PgStat_GlobalStats globalStats;
 static PgStat_WalStats walStats;
+static PgStat_IOStats ioStats;
 static PgStat_SLRUStats slruStats[SLRU_NUM_ELEMENTS];
-static HTAB *replSlotStatHash = NULL;
-
-/*
- * List of OIDs of databases we need to write out.  If an entry is InvalidOid,
- * it means to write only the shared-catalog stats ("DB 0"); otherwise, we
- * will write both that DB's data and the shared stats.
- */
-static List *pending_write_requests = NIL;
 
 /*
  * Total time charged to functions so far in the current backend.
@@ -311,30 +370,27 @@ static bool pgstat_is_shutdown = false;
  * Local function forward declarations
  * ----------
  */
-#ifdef EXEC_BACKEND
-static pid_t pgstat_forkexec(void);
-#endif
-
-NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
-
-static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-												 Oid tableoid, bool create);
-static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
-static void backend_read_statsfile(void);
-
-static bool pgstat_write_statsfile_needed(void);
-static bool pgstat_db_requested(Oid databaseid);
-
-static PgStat_StatReplSlotEntry *pgstat_get_replslot_entry(NameData name, bool create_it);
+static void pgstat_attach_shmem(void);
+static PgStatShared_DBEntry *pgstat_get_db_entry(Oid databaseid,
+												 bool exclusive, bool create);
+static void pgstat_release_db_entry(PgStatShared_DBEntry *dbentry);
+static void pgstat_create_db_hashes(PgStatShared_DBEntry *dbentry);
+static void pgstat_destroy_db_hashes(PgStatShared_DBEntry *dbentry);
+static dshash_table *pgstat_db_tables(PgStatShared_DBEntry *dbentry);
+static dshash_table *pgstat_db_functions(PgStatShared_DBEntry *dbentry);
+static void reset_dbentry_counters(PgStat_StatDBEntry *dbentry);
+static PgStat_StatTabEntry *pgstat_get_tab_entry(dshash_table *tables,
+												 Oid tableoid);
+static PgStat_SnapshotDBEntry *pgstat_snapshot_db(Oid databaseid);
+static void pgstat_snapshot_global(void);
+
+static int	pgstat_get_replslot_index(const char *name, bool create);
 static void pgstat_reset_replslot(PgStat_StatReplSlotEntry *slotstats, TimestampTz ts);
 
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg, TimestampTz now);
 static void pgstat_send_funcstats(void);
 static void pgstat_send_slru(void);
+static bool pgstat_have_pending_io(void);
 static HTAB *pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid);
 static bool pgstat_should_report_connstat(void);
 static void pgstat_report_disconnect(Oid dboid);
@@ -347,9 +403,7 @@ static void pgstat_assert_is_up(void);
 static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
-static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
 static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
@@ -363,11 +417,13 @@ static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
 static void pgstat_recv_checkpointer(PgStat_MsgCheckpointer *msg, int len);
 static void pgstat_recv_wal(PgStat_MsgWal *msg, int len);
+static void pgstat_recv_io(PgStat_MsgIO *msg, int len);
 static void pgstat_recv_slru(PgStat_MsgSLRU *msg, int len);
 static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
-static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
 static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
+static void pgstat_recv_deadlockcheck(PgStat_MsgDeadlockCheck *msg, int len);
+static void pgstat_recv_waitevents(PgStat_MsgWaitEvents *msg, int len);
 static void pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len);
 static void pgstat_recv_connect(PgStat_MsgConnect *msg, int len);
 static void pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len);
@@ -379,297 +435,85 @@ static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
  * ------------------------------------------------------------
  */
 
-/* ----------
- * pgstat_init() -
- *
- *	Called from postmaster at startup. Create the resources required
- *	by the statistics collector process.  If unable to do so, do not
- *	fail --- better to let the postmaster start with stats collection
- *	disabled.
- * ----------
+/*
+ * Size of the control struct, not including the in-place DSA area.
  */
-void
-pgstat_init(void)
+static Size
+pgstat_control_size(void)
 {
-	ACCEPT_TYPE_ARG3 alen;
-	struct addrinfo *addrs = NULL,
-			   *addr,
-				hints;
-	int			ret;
-	fd_set		rset;
-	struct timeval tv;
-	char		test_byte;
-	int			sel_res;
-	int			tries = 0;
-
-#define TESTBYTEVAL ((char) 199)
-
-	/*
-	 * This static assertion verifies that we didn't mess up the calculations
-	 * involved in selecting maximum payload sizes for our UDP messages.
-	 * Because the only consequence of overrunning PGSTAT_MAX_MSG_SIZE would
-	 * be silent performance loss from fragmentation, it seems worth having a
-	 * compile-time cross-check that we didn't.
-	 */
-	StaticAssertStmt(sizeof(PgStat_Msg) <= PGSTAT_MAX_MSG_SIZE,
-					 "maximum stats message size exceeds PGSTAT_MAX_MSG_SIZE");
-
-	/*
-	 * Create the UDP socket for sending and receiving statistic messages
-	 */
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_protocol = 0;
-	hints.ai_addrlen = 0;
-	hints.ai_addr = NULL;
-	hints.ai_canonname = NULL;
-	hints.ai_next = NULL;
-	ret = pg_getaddrinfo_all("localhost", NULL, &hints, &addrs);
-	if (ret || !addrs)
-	{
-		ereport(LOG,
-				(errmsg("could not resolve \"localhost\": %s",
-						gai_strerror(ret))));
-		goto startup_failed;
-	}
+	Size		size;
 
-	/*
-	 * On some platforms, pg_getaddrinfo_all() may return multiple addresses
-	 * only one of which will actually work (eg, both IPv6 and IPv4 addresses
-	 * when kernel will reject IPv6).  Worse, the failure may occur at the
-	 * bind() or perhaps even connect() stage.  So we must loop through the
-	 * results till we find a working combination. We will generate LOG
-	 * messages, but no error, for bogus combinations.
-	 */
-	for (addr = addrs; addr; addr = addr->ai_next)
-	{
-#ifdef HAVE_UNIX_SOCKETS
-		/* Ignore AF_UNIX sockets, if any are returned. */
-		if (addr->ai_family == AF_UNIX)
-			continue;
-#endif
+	size = offsetof(PgStat_ShmemControl, replslots);
+	size = add_size(size, mul_size(max_replication_slots,
+								   sizeof(PgStat_StatReplSlotEntry)));
 
-		if (++tries > 1)
-			ereport(LOG,
-					(errmsg("trying another address for the statistics collector")));
+	return MAXALIGN(size);
+}
 
-		/*
-		 * Create the socket.
-		 */
-		if ((pgStatSock = socket(addr->ai_family, SOCK_DGRAM, 0)) == PGINVALID_SOCKET)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not create socket for statistics collector: %m")));
-			continue;
-		}
+/*
+ * PgStatShmemSize
+ *		Compute space needed for the shared statistics.
+ */
+Size
+PgStatShmemSize(void)
+{
+	return add_size(pgstat_control_size(), PGSTAT_DSA_INITIAL_SIZE);
+}
 
-		/*
-		 * Bind it to a kernel assigned port on localhost and get the assigned
-		 * port via getsockname().
-		 */
-		if (bind(pgStatSock, addr->ai_addr, addr->ai_addrlen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not bind socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+/*
+ * PgStatShmemInit
+ *		Allocate and initialize the shared statistics.
+ *
+ * The postmaster (or standalone backend) creates the DSA area and the shared
+ * database hash table here.  Other processes attach to them lazily, the
+ * first time they need to, in pgstat_attach_shmem().
+ */
+void
+PgStatShmemInit(void)
+{
+	bool		found;
 
-		alen = sizeof(pgStatAddr);
-		if (getsockname(pgStatSock, (struct sockaddr *) &pgStatAddr, &alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not get address of socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	pgStatShmem = (PgStat_ShmemControl *)
+		ShmemInitStruct("Shared Statistics", PgStatShmemSize(), &found);
 
-		/*
-		 * Connect the socket to its own address.  This saves a few cycles by
-		 * not having to respecify the target address on every send. This also
-		 * provides a kernel-level check that only packets from this same
-		 * address will be received.
-		 */
-		if (connect(pgStatSock, (struct sockaddr *) &pgStatAddr, alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not connect socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *dbhash;
+		TimestampTz ts = GetCurrentTimestamp();
 
-		/*
-		 * Try to send and receive a one-byte test message on the socket. This
-		 * is to catch situations where the socket can be created but will not
-		 * actually pass data (for instance, because kernel packet filtering
-		 * rules prevent it).
-		 */
-		test_byte = TESTBYTEVAL;
+		Assert(!found);
 
-retry1:
-		if (send(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry1;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not send test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+		memset(pgStatShmem, 0, pgstat_control_size());
+		pgStatShmem->raw_dsa_area = (char *) pgStatShmem + pgstat_control_size();
 
 		/*
-		 * There could possibly be a little delay before the message can be
-		 * received.  We arbitrarily allow up to half a second before deciding
-		 * it's broken.
+		 * Create the DSA area and pin it, so that it survives as long as the
+		 * shared memory segment does, whoever happens to be attached.
 		 */
-		for (;;)				/* need a loop to handle EINTR */
-		{
-			FD_ZERO(&rset);
-			FD_SET(pgStatSock, &rset);
-
-			tv.tv_sec = 0;
-			tv.tv_usec = 500000;
-			sel_res = select(pgStatSock + 1, &rset, NULL, NULL, &tv);
-			if (sel_res >= 0 || errno != EINTR)
-				break;
-		}
-		if (sel_res < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-		if (sel_res == 0 || !FD_ISSET(pgStatSock, &rset))
-		{
-			/*
-			 * This is the case we actually think is likely, so take pains to
-			 * give a specific message for it.
-			 *
-			 * errno will not be set meaningfully here, so don't use it.
-			 */
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("test message did not get through on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		test_byte++;			/* just make sure variable is changed */
-
-retry2:
-		if (recv(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry2;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		if (test_byte != TESTBYTEVAL)	/* strictly paranoia ... */
-		{
-			ereport(LOG,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("incorrect test message transmission on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/* If we get here, we have a working socket */
-		break;
-	}
-
-	/* Did we find a working address? */
-	if (!addr || pgStatSock == PGINVALID_SOCKET)
-		goto startup_failed;
-
-	/*
-	 * Set the socket to non-blocking IO.  This ensures that if the collector
-	 * falls behind, statistics messages will be discarded; backends won't
-	 * block waiting to send messages to the collector.
-	 */
-	if (!pg_set_noblock(pgStatSock))
-	{
-		ereport(LOG,
-				(errcode_for_socket_access(),
-				 errmsg("could not set statistics collector socket to nonblocking mode: %m")));
-		goto startup_failed;
-	}
-
-	/*
-	 * Try to ensure that the socket's receive buffer is at least
-	 * PGSTAT_MIN_RCVBUF bytes, so that it won't easily overflow and lose
-	 * data.  Use of UDP protocol means that we are willing to lose data under
-	 * heavy load, but we don't want it to happen just because of ridiculously
-	 * small default buffer sizes (such as 8KB on older Windows versions).
-	 */
-	{
-		int			old_rcvbuf;
-		int			new_rcvbuf;
-		ACCEPT_TYPE_ARG3 rcvbufsize = sizeof(old_rcvbuf);
-
-		if (getsockopt(pgStatSock, SOL_SOCKET, SO_RCVBUF,
-					   (char *) &old_rcvbuf, &rcvbufsize) < 0)
-		{
-			ereport(LOG,
-					(errmsg("%s(%s) failed: %m", "getsockopt", "SO_RCVBUF")));
-			/* if we can't get existing size, always try to set it */
-			old_rcvbuf = 0;
-		}
-
-		new_rcvbuf = PGSTAT_MIN_RCVBUF;
-		if (old_rcvbuf < new_rcvbuf)
-		{
-			if (setsockopt(pgStatSock, SOL_SOCKET, SO_RCVBUF,
-						   (char *) &new_rcvbuf, sizeof(new_rcvbuf)) < 0)
-				ereport(LOG,
-						(errmsg("%s(%s) failed: %m", "setsockopt", "SO_RCVBUF")));
-		}
+		dsa = dsa_create_in_place(pgStatShmem->raw_dsa_area,
+								  PGSTAT_DSA_INITIAL_SIZE,
+								  LWTRANCHE_PGSTATS_DSA, NULL);
+		dsa_pin(dsa);
+
+		dbhash = dshash_create(dsa, &db_hash_params, NULL);
+		pgStatShmem->db_hash = dshash_get_hash_table_handle(dbhash);
+
+		dshash_detach(dbhash);
+		dsa_detach(dsa);
+
+		pg_atomic_init_u64(&pgStatShmem->next_generation, 1);
+		LWLockInitialize(&pgStatShmem->lock, LWTRANCHE_PGSTATS_DATA);
+
+		pgStatShmem->global.bgwriter.stat_reset_timestamp = ts;
+		pgStatShmem->archiver.stat_reset_timestamp = ts;
+		pgStatShmem->wal.stat_reset_timestamp = ts;
+		pgStatShmem->io.stat_reset_timestamp = ts;
+		for (int i = 0; i < SLRU_NUM_ELEMENTS; i++)
+			pgStatShmem->slru[i].stat_reset_timestamp = ts;
 	}
-
-	pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	/* Now that we have a long-lived socket, tell fd.c about it. */
-	ReserveExternalFD();
-
-	return;
-
-startup_failed:
-	ereport(LOG,
-			(errmsg("disabling statistics collector for lack of working socket")));
-
-	if (addrs)
-		pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	if (pgStatSock != PGINVALID_SOCKET)
-		closesocket(pgStatSock);
-	pgStatSock = PGINVALID_SOCKET;
-
-	/*
-	 * Adjust GUC variables to suppress useless activity, and for debugging
-	 * purposes (seeing track_counts off is a clue that we failed here). We
-	 * use PGC_S_OVERRIDE because there is no point in trying to turn it back
-	 * on from postgresql.conf without a restart.
-	 */
-	SetConfigOption("track_counts", "off", PGC_INTERNAL, PGC_S_OVERRIDE);
+	else
+		Assert(found);
 }
 
 /*
@@ -690,7 +534,7 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * The database-specific pattern is one that older releases used.
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
@@ -720,118 +564,76 @@ pgstat_reset_remove_files(const char *directory)
 /*
  * pgstat_reset_all() -
  *
- * Remove the stats files.  This is currently used only if WAL
- * recovery is needed after a crash.
+ * Remove the stats files, and reset all statistics held in shared memory.
+ * This is used at startup if archive recovery is needed, since the saved
+ * statistics can't be trusted to match the restored cluster.
  */
 void
 pgstat_reset_all(void)
 {
-	pgstat_reset_remove_files(pgstat_stat_directory);
-	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
-}
+	dshash_seq_status hstat;
+	PgStatShared_DBEntry *dbentry;
+	TimestampTz ts;
 
-#ifdef EXEC_BACKEND
+	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
+	pgstat_reset_remove_files(PG_STAT_TMP_DIR);
 
-/*
- * pgstat_forkexec() -
- *
- * Format up the arglist for, then fork and exec, statistics collector process
- */
-static pid_t
-pgstat_forkexec(void)
-{
-	char	   *av[10];
-	int			ac = 0;
+	pgstat_attach_shmem();
 
-	av[ac++] = "postgres";
-	av[ac++] = "--forkcol";
-	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
+	dshash_seq_init(&hstat, pgStatSharedDBHash, true);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		pgstat_destroy_db_hashes(dbentry);
+		dshash_delete_current(&hstat);
+	}
+	dshash_seq_term(&hstat);
 
-	av[ac] = NULL;
-	Assert(ac < lengthof(av));
+	ts = GetCurrentTimestamp();
 
-	return postmaster_forkexec(ac, av);
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+	memset(&pgStatShmem->global, 0, sizeof(pgStatShmem->global));
+	memset(&pgStatShmem->archiver, 0, sizeof(pgStatShmem->archiver));
+	memset(&pgStatShmem->wal, 0, sizeof(pgStatShmem->wal));
+	memset(&pgStatShmem->io, 0, sizeof(pgStatShmem->io));
+	memset(pgStatShmem->slru, 0, sizeof(pgStatShmem->slru));
+	memset(pgStatShmem->replslots, 0,
+		   mul_size(max_replication_slots, sizeof(PgStat_StatReplSlotEntry)));
+	pgStatShmem->global.bgwriter.stat_reset_timestamp = ts;
+	pgStatShmem->archiver.stat_reset_timestamp = ts;
+	pgStatShmem->wal.stat_reset_timestamp = ts;
+	pgStatShmem->io.stat_reset_timestamp = ts;
+	for (int i = 0; i < SLRU_NUM_ELEMENTS; i++)
+		pgStatShmem->slru[i].stat_reset_timestamp = ts;
+	LWLockRelease(&pgStatShmem->lock);
 }
-#endif							/* EXEC_BACKEND */
-
 
 /*
- * pgstat_start() -
- *
- *	Called from postmaster at startup or after an existing collector
- *	died.  Attempt to fire up a fresh statistics collector.
+ * pgstat_attach_shmem() -
  *
- *	Returns PID of child process, or 0 if fail.
- *
- *	Note: if fail, we will be called again from the postmaster main loop.
+ *	Attach to the shared statistics' DSA area and database hash, if we
+ *	haven't yet.  The attachments last until process exit.
  */
-int
-pgstat_start(void)
+static void
+pgstat_attach_shmem(void)
 {
-	time_t		curtime;
-	pid_t		pgStatPid;
-
-	/*
-	 * Check that the socket is there, else pgstat_init failed and we can do
-	 * nothing useful.
-	 */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return 0;
-
-	/*
-	 * Do nothing if too soon since last collector start.  This is a safety
-	 * valve to protect against continuous respawn attempts if the collector
-	 * is dying immediately at launch.  Note that since we will be re-called
-	 * from the postmaster main loop, we will get another chance later.
-	 */
-	curtime = time(NULL);
-	if ((unsigned int) (curtime - last_pgstat_start_time) <
-		(unsigned int) PGSTAT_RESTART_INTERVAL)
-		return 0;
-	last_pgstat_start_time = curtime;
-
-	/*
-	 * Okay, fork off the collector.
-	 */
-#ifdef EXEC_BACKEND
-	switch ((pgStatPid = pgstat_forkexec()))
-#else
-	switch ((pgStatPid = fork_process()))
-#endif
-	{
-		case -1:
-			ereport(LOG,
-					(errmsg("could not fork statistics collector: %m")));
-			return 0;
-
-#ifndef EXEC_BACKEND
-		case 0:
-			/* in postmaster child ... */
-			InitPostmasterChild();
+	MemoryContext oldcontext;
 
-			/* Close the postmaster's sockets */
-			ClosePostmasterPorts(false);
+	if (pgStatSharedDBHash != NULL)
+		return;
 
-			/* Drop our connection to postmaster's shared memory, as well */
-			dsm_detach_all();
-			PGSharedMemoryDetach();
+	Assert(pgStatShmem != NULL);
 
-			PgstatCollectorMain(0, NULL);
-			break;
-#endif
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
 
-		default:
-			return (int) pgStatPid;
-	}
+	pgStatDSA = dsa_attach_in_place(pgStatShmem->raw_dsa_area, NULL);
+	dsa_pin_mapping(pgStatDSA);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(pgStatShmem->raw_dsa_area));
 
-	/* shouldn't get here */
-	return 0;
-}
+	pgStatSharedDBHash = dshash_attach(pgStatDSA, &db_hash_params,
+									   pgStatShmem->db_hash, NULL);
 
-void
-allow_immediate_pgstat_restart(void)
-{
-	last_pgstat_start_time = 0;
+	MemoryContextSwitchTo(oldcontext);
 }
 
 /* ------------------------------------------------------------
@@ -845,7 +647,7 @@ allow_immediate_pgstat_restart(void)
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
  *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
+ *	per-table and function usage statistics to shared memory.  Note that this
  *	is called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  *
@@ -876,13 +678,15 @@ pgstat_report_stat(bool disconnect)
 	 * only the number of generated WAL records but also the numbers of WAL
 	 * writes and syncs need to be checked. Because even transaction that
 	 * generates no WAL records can write or sync WAL data when flushing the
-	 * data pages.
+	 * data pages.  Likewise, a transaction that touches no tables can still
+	 * have done buffer I/O, e.g. while scanning catalogs.
 	 */
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
 		pgStatXactCommit == 0 && pgStatXactRollback == 0 &&
 		pgWalUsage.wal_records == prevWalUsage.wal_records &&
 		WalStats.m_wal_write == 0 && WalStats.m_wal_sync == 0 &&
-		!have_function_stats && !disconnect)
+		!have_function_stats && !pgstat_have_pending_io() &&
+		!have_wait_event_stats && !disconnect)
 		return;
 
 	/*
@@ -977,8 +781,14 @@ pgstat_report_stat(bool disconnect)
 	/* Send WAL statistics */
 	pgstat_send_wal(true);
 
-	/* Finally send SLRU statistics */
+	/* Send SLRU statistics */
 	pgstat_send_slru();
+
+	/* Send I/O statistics */
+	pgstat_send_io();
+
+	/* Finally send wait event statistics */
+	pgstat_send_wait_events();
 }
 
 /*
@@ -990,10 +800,6 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg, TimestampTz now)
 	int			n;
 	int			len;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	/*
 	 * Report and reset accumulated xact commit/rollback and I/O timings
 	 * whenever we send a normal tabstat message
@@ -1107,33 +913,86 @@ pgstat_send_funcstats(void)
 	have_function_stats = false;
 }
 
+/* ----------
+ * pgstat_send_wait_events() -
+ *
+ *	Send wait event statistics to shared memory, as part of MyDatabaseId's
+ *	statistics.  Processes that aren't connected to a database report them
+ *	as shared.
+ * ----------
+ */
+void
+pgstat_send_wait_events(void)
+{
+	PgStat_MsgWaitEvents msg;
+	double		ticks_per_usec;
+
+	pgstat_assert_is_up();
+
+	if (!have_wait_event_stats)
+		return;
+
+	ticks_per_usec = (double) pg_get_ticks_per_sec() / 1000000.0;
+
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_WAITEVENTS);
+	msg.m_databaseid = MyDatabaseId;
+	msg.m_nentries = 0;
+	memcpy(msg.m_histograms, PendingWaitHistograms, sizeof(msg.m_histograms));
+
+	for (int slot = 0; slot < PGSTAT_WAIT_EVENT_SLOTS; slot++)
+	{
+		PgStat_WaitEventEntry *m_ent;
+
+		if (PendingWaitEvents[slot].calls == 0)
+			continue;
+
+		/* need to convert the time from ticks */
+		m_ent = &msg.m_entry[msg.m_nentries];
+		m_ent->slot = slot;
+		m_ent->counts.calls = PendingWaitEvents[slot].calls;
+		m_ent->counts.time = (PgStat_Counter)
+			(PendingWaitEvents[slot].time / ticks_per_usec);
+
+		if (++msg.m_nentries >= PGSTAT_NUM_WAITEVENTENTRIES)
+		{
+			pgstat_send(&msg, offsetof(PgStat_MsgWaitEvents, m_entry[0]) +
+						msg.m_nentries * sizeof(PgStat_WaitEventEntry));
+			msg.m_nentries = 0;
+			/* the histograms were sent with the first message */
+			MemSet(msg.m_histograms, 0, sizeof(msg.m_histograms));
+		}
+	}
+
+	if (msg.m_nentries > 0)
+		pgstat_send(&msg, offsetof(PgStat_MsgWaitEvents, m_entry[0]) +
+					msg.m_nentries * sizeof(PgStat_WaitEventEntry));
+
+	MemSet(PendingWaitEvents, 0, sizeof(PendingWaitEvents));
+	MemSet(PendingWaitHistograms, 0, sizeof(PendingWaitHistograms));
+	have_wait_event_stats = false;
+}
+
 
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the statistics of objects that no longer exist.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
-	PgStat_MsgFuncpurge f_msg;
-	HASH_SEQ_STATUS hstat;
-	PgStat_StatDBEntry *dbentry;
+	List	   *dead_dbs = NIL;
+	List	   *slotnames = NIL;
+	ListCell   *lc;
+	dshash_seq_status hstat;
+	PgStatShared_DBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 	PgStat_StatFuncEntry *funcentry;
-	int			len;
+	bool		have_functions;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	pgstat_attach_shmem();
 
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
@@ -1141,108 +1000,97 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases, and drop them.  We
+	 * can't drop them while scanning, since that needs the entry locked
+	 * exclusively.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		Oid			dbid = dbentry->databaseid;
-
-		CHECK_FOR_INTERRUPTS();
+		Oid			dbid = dbentry->stats.databaseid;
 
 		/* the DB entry for shared tables (with InvalidOid) is never dropped */
 		if (OidIsValid(dbid) &&
 			hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
-			pgstat_drop_database(dbid);
+			dead_dbs = lappend_oid(dead_dbs, dbid);
+	}
+	dshash_seq_term(&hstat);
+
+	foreach(lc, dead_dbs)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		pgstat_drop_database(lfirst_oid(lc));
 	}
+	list_free(dead_dbs);
 
 	/* Clean up */
 	hash_destroy(htab);
 
 	/*
-	 * Search for all the dead replication slots in stats hashtable and tell
-	 * the stats collector to drop them.
+	 * Search for all the dead replication slots in the stats array and drop
+	 * their statistics.  Copy the names first, so that we don't need to hold
+	 * our lock while looking at the slots.
 	 */
-	if (replSlotStatHash)
+	LWLockAcquire(&pgStatShmem->lock, LW_SHARED);
+	for (int i = 0; i < max_replication_slots; i++)
 	{
-		PgStat_StatReplSlotEntry *slotentry;
+		PgStat_StatReplSlotEntry *slotent = &pgStatShmem->replslots[i];
 
-		hash_seq_init(&hstat, replSlotStatHash);
-		while ((slotentry = (PgStat_StatReplSlotEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			CHECK_FOR_INTERRUPTS();
+		if (NameStr(slotent->slotname)[0] != '\0')
+			slotnames = lappend(slotnames,
+								pstrdup(NameStr(slotent->slotname)));
+	}
+	LWLockRelease(&pgStatShmem->lock);
 
-			if (SearchNamedReplicationSlot(NameStr(slotentry->slotname), true) == NULL)
-				pgstat_report_replslot_drop(NameStr(slotentry->slotname));
-		}
+	foreach(lc, slotnames)
+	{
+		char	   *slotname = (char *) lfirst(lc);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (SearchNamedReplicationSlot(slotname, true) == NULL)
+			pgstat_report_replslot_drop(slotname);
 	}
+	list_free_deep(slotnames);
 
 	/*
 	 * Lookup our own database entry; if not found, nothing more to do.
 	 */
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &MyDatabaseId,
-												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry == NULL)
 		return;
 
 	/*
 	 * Similarly to above, make a list of all known relations in this DB.
+	 * This reads the catalogs, so don't hold the entry locked meanwhile.
 	 */
-	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
+	pgstat_release_db_entry(dbentry);
 
-	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
+	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
 
 	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
+	 * Check for all tables listed in stats hashtable if they still exist, and
+	 * remove the ones that don't.
 	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry == NULL)
 	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
-			continue;
-
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
-		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
-		}
+		hash_destroy(htab);
+		return;
 	}
 
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
+	dshash_seq_init(&hstat, pgstat_db_tables(dbentry), true);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
+		Oid			tabid = tabentry->tableid;
 
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
+		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) == NULL)
+			dshash_delete_current(&hstat);
 	}
+	dshash_seq_term(&hstat);
+
+	pgstat_release_db_entry(dbentry);
 
 	/* Clean up */
 	hash_destroy(htab);
@@ -1251,59 +1099,39 @@ pgstat_vacuum_stat(void)
 	 * Now repeat the above steps for functions.  However, we needn't bother
 	 * in the common case where no function stats are being collected.
 	 */
-	if (dbentry->functions != NULL &&
-		hash_get_num_entries(dbentry->functions) > 0)
-	{
-		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
-
-		pgstat_setheader(&f_msg.m_hdr, PGSTAT_MTYPE_FUNCPURGE);
-		f_msg.m_databaseid = MyDatabaseId;
-		f_msg.m_nentries = 0;
-
-		hash_seq_init(&hstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			Oid			funcid = funcentry->functionid;
-
-			CHECK_FOR_INTERRUPTS();
-
-			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) != NULL)
-				continue;
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry == NULL)
+		return;
 
-			/*
-			 * Not there, so add this function's Oid to the message
-			 */
-			f_msg.m_functionid[f_msg.m_nentries++] = funcid;
+	dshash_seq_init(&hstat, pgstat_db_functions(dbentry), false);
+	have_functions = (dshash_seq_next(&hstat) != NULL);
+	dshash_seq_term(&hstat);
 
-			/*
-			 * If the message is full, send it out and reinitialize to empty
-			 */
-			if (f_msg.m_nentries >= PGSTAT_NUM_FUNCPURGE)
-			{
-				len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-					+ f_msg.m_nentries * sizeof(Oid);
+	pgstat_release_db_entry(dbentry);
 
-				pgstat_send(&f_msg, len);
+	if (!have_functions)
+		return;
 
-				f_msg.m_nentries = 0;
-			}
-		}
+	htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
 
-		/*
-		 * Send the rest
-		 */
-		if (f_msg.m_nentries > 0)
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry != NULL)
+	{
+		dshash_seq_init(&hstat, pgstat_db_functions(dbentry), true);
+		while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 		{
-			len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-				+ f_msg.m_nentries * sizeof(Oid);
+			Oid			funcid = funcentry->functionid;
 
-			pgstat_send(&f_msg, len);
+			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) == NULL)
+				dshash_delete_current(&hstat);
 		}
+		dshash_seq_term(&hstat);
 
-		hash_destroy(htab);
+		pgstat_release_db_entry(dbentry);
 	}
-}
 
+	hash_destroy(htab);
+}
 
 /* ----------
  * pgstat_collect_oids() -
@@ -1358,8 +1186,8 @@ pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
+ *	Tell the statistics system that we just dropped a database.
+ *	(If we fail to get here, we will still clean the dead DB eventually
  *	via future invocations of pgstat_vacuum_stat().)
  * ----------
  */
@@ -1368,9 +1196,6 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
 	msg.m_databaseid = databaseid;
 	pgstat_send(&msg, sizeof(msg));
@@ -1380,8 +1205,8 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
+ *	Tell the statistics system that we just dropped a relation.
+ *	(If we fail to get here, we will still clean the dead entry eventually
  *	via future invocations of pgstat_vacuum_stat().)
  *
  *	Currently not used for lack of any good place to call it; we rely
@@ -1392,27 +1217,22 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
+	PgStatShared_DBEntry *dbentry;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry == NULL)
 		return;
 
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
+	(void) dshash_delete_key(pgstat_db_tables(dbentry), &relid);
 
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	pgstat_release_db_entry(dbentry);
 }
 #endif							/* NOT_USED */
 
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Tell the statistics system to reset counters for our database.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1423,9 +1243,6 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETCOUNTER);
 	msg.m_databaseid = MyDatabaseId;
 	pgstat_send(&msg, sizeof(msg));
@@ -1434,7 +1251,7 @@ pgstat_reset_counters(void)
 /* ----------
  * pgstat_reset_shared_counters() -
  *
- *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	Tell the statistics system to reset cluster-wide shared counters.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1445,20 +1262,26 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	/* recovery prefetching keeps its own counters in shared memory */
+	if (strcmp(target, "recovery_prefetch") == 0)
+	{
+		XLogPrefetchResetStats();
 		return;
+	}
 
 	if (strcmp(target, "archiver") == 0)
 		msg.m_resettarget = RESET_ARCHIVER;
 	else if (strcmp(target, "bgwriter") == 0)
 		msg.m_resettarget = RESET_BGWRITER;
+	else if (strcmp(target, "io") == 0)
+		msg.m_resettarget = RESET_IO;
 	else if (strcmp(target, "wal") == 0)
 		msg.m_resettarget = RESET_WAL;
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\", \"bgwriter\", or \"wal\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"io\", \"recovery_prefetch\", or \"wal\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1467,7 +1290,7 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Tell the statistics system to reset a single counter.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1478,9 +1301,6 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSINGLECOUNTER);
 	msg.m_databaseid = MyDatabaseId;
 	msg.m_resettype = type;
@@ -1492,7 +1312,7 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 /* ----------
  * pgstat_reset_slru_counter() -
  *
- *	Tell the statistics collector to reset a single SLRU counter, or all
+ *	Tell the statistics system to reset a single SLRU counter, or all
  *	SLRU counters (when name is null).
  *
  *	Permission checking for this function is managed through the normal
@@ -1504,9 +1324,6 @@ pgstat_reset_slru_counter(const char *name)
 {
 	PgStat_MsgResetslrucounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSLRUCOUNTER);
 	msg.m_index = (name) ? pgstat_slru_index(name) : -1;
 
@@ -1516,7 +1333,7 @@ pgstat_reset_slru_counter(const char *name)
 /* ----------
  * pgstat_reset_replslot_counter() -
  *
- *	Tell the statistics collector to reset a single replication slot
+ *	Tell the statistics system to reset a single replication slot
  *	counter, or all replication slots counters (when name is null).
  *
  *	Permission checking for this function is managed through the normal
@@ -1528,9 +1345,6 @@ pgstat_reset_replslot_counter(const char *name)
 {
 	PgStat_MsgResetreplslotcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (name)
 	{
 		namestrcpy(&msg.m_slotname, name);
@@ -1557,9 +1371,6 @@ pgstat_report_autovac(Oid dboid)
 {
 	PgStat_MsgAutovacStart msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
 	msg.m_databaseid = dboid;
 	msg.m_start_time = GetCurrentTimestamp();
@@ -1571,7 +1382,7 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Tell the statistics system about the table we just vacuumed.
  * ---------
  */
 void
@@ -1580,7 +1391,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 {
 	PgStat_MsgVacuum msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
@@ -1596,7 +1407,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Tell the statistics system about the table we just analyzed.
  *
  * Caller must provide new live- and dead-tuples estimates, as well as a
  * flag indicating whether to reset the changes_since_analyze counter.
@@ -1609,7 +1420,7 @@ pgstat_report_analyze(Relation rel,
 {
 	PgStat_MsgAnalyze msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1617,9 +1428,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
+	 * off these counts from what we report now, else they'll be
+	 * double-counted after commit.  (This approach also ensures that the
+	 * shared statistics end up with the right numbers if we abort instead of
 	 * committing.)
 	 *
 	 * Waste no time on partitioned tables, though.
@@ -1655,7 +1466,7 @@ pgstat_report_analyze(Relation rel,
 /* --------
  * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a Hot Standby recovery conflict.
+ *	Tell the statistics system about a Hot Standby recovery conflict.
  * --------
  */
 void
@@ -1663,7 +1474,7 @@ pgstat_report_recovery_conflict(int reason)
 {
 	PgStat_MsgRecoveryConflict msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
@@ -1675,7 +1486,7 @@ pgstat_report_recovery_conflict(int reason)
 /* --------
  * pgstat_report_deadlock() -
  *
- *	Tell the collector about a deadlock detected.
+ *	Tell the statistics system about a deadlock detected.
  * --------
  */
 void
@@ -1683,7 +1494,7 @@ pgstat_report_deadlock(void)
 {
 	PgStat_MsgDeadlock msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCK);
@@ -1691,12 +1502,33 @@ pgstat_report_deadlock(void)
 	pgstat_send(&msg, sizeof(msg));
 }
 
+/* --------
+ * pgstat_report_deadlock_check() -
+ *
+ *	Tell the statistics system about a deadlock check that took check_time
+ *	microseconds, including the time waiting for the lock table.
+ * --------
+ */
+void
+pgstat_report_deadlock_check(PgStat_Counter check_time)
+{
+	PgStat_MsgDeadlockCheck msg;
+
+	if (!pgstat_track_counts)
+		return;
+
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCKCHECK);
+	msg.m_databaseid = MyDatabaseId;
+	msg.m_check_time = check_time;
+	pgstat_send(&msg, sizeof(msg));
+}
+
 
 
 /* --------
  * pgstat_report_checksum_failures_in_db() -
  *
- *	Tell the collector about one or more checksum failures.
+ *	Tell the statistics system about one or more checksum failures.
  * --------
  */
 void
@@ -1704,7 +1536,7 @@ pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount)
 {
 	PgStat_MsgChecksumFailure msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_CHECKSUMFAILURE);
@@ -1718,7 +1550,7 @@ pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount)
 /* --------
  * pgstat_report_checksum_failure() -
  *
- *	Tell the collector about a checksum failure.
+ *	Tell the statistics system about a checksum failure.
  * --------
  */
 void
@@ -1730,7 +1562,7 @@ pgstat_report_checksum_failure(void)
 /* --------
  * pgstat_report_tempfile() -
  *
- *	Tell the collector about a temporary file.
+ *	Tell the statistics system about a temporary file.
  * --------
  */
 void
@@ -1738,7 +1570,7 @@ pgstat_report_tempfile(size_t filesize)
 {
 	PgStat_MsgTempFile msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
@@ -1750,7 +1582,7 @@ pgstat_report_tempfile(size_t filesize)
 /* --------
  * pgstat_report_connect() -
  *
- *	Tell the collector about a new connection.
+ *	Tell the statistics system about a new connection.
  * --------
  */
 void
@@ -1771,7 +1603,7 @@ pgstat_report_connect(Oid dboid)
 /* --------
  * pgstat_report_disconnect() -
  *
- *	Tell the collector about a disconnect.
+ *	Tell the statistics system about a disconnect.
  * --------
  */
 static void
@@ -1807,7 +1639,7 @@ pgstat_should_report_connstat(void)
 /* ----------
  * pgstat_report_replslot() -
  *
- *	Tell the collector about replication slot statistics.
+ *	Tell the statistics system about replication slot statistics.
  * ----------
  */
 void
@@ -1836,7 +1668,7 @@ pgstat_report_replslot(const PgStat_StatReplSlotEntry *repSlotStat)
 /* ----------
  * pgstat_report_replslot_create() -
  *
- *	Tell the collector about creating the replication slot.
+ *	Tell the statistics system about creating the replication slot.
  * ----------
  */
 void
@@ -1854,7 +1686,7 @@ pgstat_report_replslot_create(const char *slotname)
 /* ----------
  * pgstat_report_replslot_drop() -
  *
- *	Tell the collector about dropping the replication slot.
+ *	Tell the statistics system about dropping the replication slot.
  * ----------
  */
 void
@@ -1869,42 +1701,6 @@ pgstat_report_replslot_drop(const char *slotname)
 	pgstat_send(&msg, sizeof(PgStat_MsgReplSlot));
 }
 
-/* ----------
- * pgstat_ping() -
- *
- *	Send some junk data to the collector to increase traffic.
- * ----------
- */
-void
-pgstat_ping(void)
-{
-	PgStat_MsgDummy msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DUMMY);
-	pgstat_send(&msg, sizeof(msg));
-}
-
-/* ----------
- * pgstat_send_inquiry() -
- *
- *	Notify collector that we need fresh data.
- * ----------
- */
-static void
-pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time, Oid databaseid)
-{
-	PgStat_MsgInquiry msg;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
-	msg.clock_time = clock_time;
-	msg.cutoff_time = cutoff_time;
-	msg.databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
-}
-
 
 /*
  * Initialize function call usage data.
@@ -2055,7 +1851,7 @@ pgstat_initstats(Relation rel)
 		return;
 	}
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 	{
 		/* We're not counting at all */
 		rel->pgstat_info = NULL;
@@ -2647,7 +2443,7 @@ AtPrepare_PgStat(void)
 /*
  * All we need do here is unlink the transaction stats state from the
  * nontransactional state.  The nontransactional action counts will be
- * reported to the stats collector immediately, while the effects on
+ * reported to the statistics system immediately, while the effects on
  * live and dead tuple counts are preserved in the 2PC state file.
  *
  * Note: AtEOXact_PgStat_Relations is not called during PREPARE.
@@ -2767,24 +2563,13 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one database or NULL. NULL doesn't mean
  *	that the database doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	statistics system, so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
-
-	/*
-	 * Lookup the requested database; return NULL if not found
-	 */
-	return (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-											  (void *) &dbid,
-											  HASH_FIND, NULL);
+	return pgstat_snapshot_db(dbid)->stats;
 }
 
 
@@ -2794,55 +2579,83 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
  *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	statistics system, so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	tabentry = pgstat_fetch_stat_tabentry_ext(false, relid);
+	if (tabentry != NULL)
+		return tabentry;
 
 	/*
-	 * Lookup our database, then look in its table hash table.
+	 * If we didn't find it, maybe it's a shared table.
 	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	return pgstat_fetch_stat_tabentry_ext(true, relid);
+}
+
+
+/* ----------
+ * pgstat_fetch_stat_tabentry_ext() -
+ *
+ *	As pgstat_fetch_stat_tabentry(), but looks only among shared tables if
+ *	'shared' is true, or only among tables of the current database if not.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_stat_tabentry_ext(bool shared, Oid relid)
+{
+	PgStat_SnapshotDBEntry *snapdb;
+	PgStatShared_DBEntry *dbentry;
+	PgStat_StatTabEntry shtabentry;
+	PgStat_StatTabEntry *tabentry = NULL;
+	dshash_table *tables;
+
+	snapdb = pgstat_snapshot_db(shared ? InvalidOid : MyDatabaseId);
+	if (snapdb->stats == NULL)
+		return NULL;
+
+	if (snapdb->tables == NULL)
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		snapdb->tables = hash_create("Per-database table",
+									 PGSTAT_TAB_HASH_SIZE,
+									 &hash_ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+	else
+	{
+		tabentry = (PgStat_StatTabEntry *) hash_search(snapdb->tables,
 													   (void *) &relid,
 													   HASH_FIND, NULL);
 		if (tabentry)
 			return tabentry;
 	}
 
-	/*
-	 * If we didn't find it, maybe it's a shared table.
-	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	/* Not in the snapshot yet, so look in shared memory */
+	dbentry = pgstat_get_db_entry(snapdb->databaseid, false, false);
+	if (dbentry == NULL)
+		return NULL;
+
+	tables = pgstat_db_tables(dbentry);
+	if (dshash_find_copy(tables, &relid, &shtabentry))
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
+		tabentry = (PgStat_StatTabEntry *) hash_search(snapdb->tables,
 													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
+													   HASH_ENTER, NULL);
+		memcpy(tabentry, &shtabentry, sizeof(PgStat_StatTabEntry));
 	}
 
-	return NULL;
+	pgstat_release_db_entry(dbentry);
+
+	return tabentry;
 }
 
 
@@ -2856,21 +2669,54 @@ pgstat_fetch_stat_tabentry(Oid relid)
 PgStat_StatFuncEntry *
 pgstat_fetch_stat_funcentry(Oid func_id)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_SnapshotDBEntry *snapdb;
+	PgStatShared_DBEntry *dbentry;
+	PgStat_StatFuncEntry shfuncentry;
 	PgStat_StatFuncEntry *funcentry = NULL;
-
-	/* load the stats file if needed */
-	backend_read_statsfile();
+	dshash_table *functions;
 
 	/* Lookup our database, then find the requested function.  */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-	if (dbentry != NULL && dbentry->functions != NULL)
+	snapdb = pgstat_snapshot_db(MyDatabaseId);
+	if (snapdb->stats == NULL)
+		return NULL;
+
+	if (snapdb->functions == NULL)
+	{
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		snapdb->functions = hash_create("Per-database function",
+										PGSTAT_FUNCTION_HASH_SIZE,
+										&hash_ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+	else
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
+		funcentry = (PgStat_StatFuncEntry *) hash_search(snapdb->functions,
 														 (void *) &func_id,
 														 HASH_FIND, NULL);
+		if (funcentry)
+			return funcentry;
+	}
+
+	/* Not in the snapshot yet, so look in shared memory */
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false, false);
+	if (dbentry == NULL)
+		return NULL;
+
+	functions = pgstat_db_functions(dbentry);
+	if (dshash_find_copy(functions, &func_id, &shfuncentry))
+	{
+		funcentry = (PgStat_StatFuncEntry *) hash_search(snapdb->functions,
+														 (void *) &func_id,
+														 HASH_ENTER, NULL);
+		memcpy(funcentry, &shfuncentry, sizeof(PgStat_StatFuncEntry));
 	}
 
+	pgstat_release_db_entry(dbentry);
+
 	return funcentry;
 }
 
@@ -2886,7 +2732,7 @@ pgstat_fetch_stat_funcentry(Oid func_id)
 PgStat_ArchiverStats *
 pgstat_fetch_stat_archiver(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &archiverStats;
 }
@@ -2902,7 +2748,7 @@ pgstat_fetch_stat_archiver(void)
 PgStat_BgWriterStats *
 pgstat_fetch_stat_bgwriter(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats.bgwriter;
 }
@@ -2918,7 +2764,7 @@ pgstat_fetch_stat_bgwriter(void)
 PgStat_CheckpointerStats *
 pgstat_fetch_stat_checkpointer(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats.checkpointer;
 }
@@ -2934,7 +2780,7 @@ pgstat_fetch_stat_checkpointer(void)
 PgStat_GlobalStats *
 pgstat_fetch_global(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats;
 }
@@ -2950,11 +2796,27 @@ pgstat_fetch_global(void)
 PgStat_WalStats *
 pgstat_fetch_stat_wal(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &walStats;
 }
 
+/*
+ * ---------
+ * pgstat_fetch_stat_io() -
+ *
+ *	Support function for the SQL-callable pgstat* functions. Returns
+ *	a pointer to the I/O statistics struct.
+ * ---------
+ */
+PgStat_IOStats *
+pgstat_fetch_stat_io(void)
+{
+	pgstat_snapshot_global();
+
+	return &ioStats;
+}
+
 /*
  * ---------
  * pgstat_fetch_slru() -
@@ -2966,7 +2828,7 @@ pgstat_fetch_stat_wal(void)
 PgStat_SLRUStats *
 pgstat_fetch_slru(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return slruStats;
 }
@@ -2976,21 +2838,33 @@ pgstat_fetch_slru(void)
  * pgstat_fetch_replslot() -
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
- *	a pointer to the replication slot statistics struct.
+ *	a palloc'd copy of the statistics of the given replication slot, or NULL
+ *	if there are none.
  * ---------
  */
 PgStat_StatReplSlotEntry *
 pgstat_fetch_replslot(NameData slotname)
 {
-	backend_read_statsfile();
+	PgStat_StatReplSlotEntry *result = NULL;
+	int			idx;
+
+	LWLockAcquire(&pgStatShmem->lock, LW_SHARED);
+	idx = pgstat_get_replslot_index(NameStr(slotname), false);
+	if (idx >= 0)
+	{
+		result = palloc(sizeof(PgStat_StatReplSlotEntry));
+		memcpy(result, &pgStatShmem->replslots[idx],
+			   sizeof(PgStat_StatReplSlotEntry));
+	}
+	LWLockRelease(&pgStatShmem->lock);
 
-	return pgstat_get_replslot_entry(slotname, false);
+	return result;
 }
 
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
+ * Flush any remaining statistics counts out to shared memory.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
  */
@@ -3001,13 +2875,21 @@ pgstat_shutdown_hook(int code, Datum arg)
 
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
+	 * we did to the statistics system.  Otherwise, we'd be sending an invalid
 	 * database ID, so forget it.  (This means that accesses to pg_database
 	 * during failed backend starts might never get counted.)
 	 */
 	if (OidIsValid(MyDatabaseId))
 		pgstat_report_stat(true);
 
+	/*
+	 * I/O statistics aren't tied to a database, so send them even if we
+	 * didn't get that far, and from auxiliary processes.  Wait event
+	 * statistics of such processes count as shared.
+	 */
+	pgstat_send_io();
+	pgstat_send_wait_events();
+
 #ifdef USE_ASSERT_CHECKING
 	pgstat_is_shutdown = true;
 #endif
@@ -3064,38 +2946,134 @@ pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype)
 /* ----------
  * pgstat_send() -
  *
- *		Send out one statistics message to the collector
+ *		Apply one batch of statistics to shared memory
  * ----------
  */
 static void
 pgstat_send(void *msg, int len)
 {
-	int			rc;
+	PgStat_MsgHdr *hdr = (PgStat_MsgHdr *) msg;
 
 	pgstat_assert_is_up();
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	((PgStat_MsgHdr *) msg)->m_size = len;
+	hdr->m_size = len;
 
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
+	switch (hdr->m_type)
 	{
-		rc = send(pgStatSock, msg, len, 0);
-	} while (rc < 0 && errno == EINTR);
+		case PGSTAT_MTYPE_TABSTAT:
+			pgstat_recv_tabstat(msg, len);
+			break;
 
-#ifdef USE_ASSERT_CHECKING
-	/* In debug builds, log send failures ... */
-	if (rc < 0)
-		elog(LOG, "could not send to statistics collector: %m");
-#endif
+		case PGSTAT_MTYPE_DROPDB:
+			pgstat_recv_dropdb(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETCOUNTER:
+			pgstat_recv_resetcounter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
+			pgstat_recv_resetsharedcounter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSINGLECOUNTER:
+			pgstat_recv_resetsinglecounter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSLRUCOUNTER:
+			pgstat_recv_resetslrucounter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETREPLSLOTCOUNTER:
+			pgstat_recv_resetreplslotcounter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_AUTOVAC_START:
+			pgstat_recv_autovac(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_VACUUM:
+			pgstat_recv_vacuum(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ANALYZE:
+			pgstat_recv_analyze(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ARCHIVER:
+			pgstat_recv_archiver(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_BGWRITER:
+			pgstat_recv_bgwriter(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_CHECKPOINTER:
+			pgstat_recv_checkpointer(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_WAL:
+			pgstat_recv_wal(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_IO:
+			pgstat_recv_io(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_SLRU:
+			pgstat_recv_slru(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCSTAT:
+			pgstat_recv_funcstat(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RECOVERYCONFLICT:
+			pgstat_recv_recoveryconflict(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DEADLOCK:
+			pgstat_recv_deadlock(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DEADLOCKCHECK:
+			pgstat_recv_deadlockcheck(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_WAITEVENTS:
+			pgstat_recv_waitevents(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TEMPFILE:
+			pgstat_recv_tempfile(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_CHECKSUMFAILURE:
+			pgstat_recv_checksum_failure(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_REPLSLOT:
+			pgstat_recv_replslot(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_CONNECT:
+			pgstat_recv_connect(msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DISCONNECT:
+			pgstat_recv_disconnect(msg, len);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized statistics message type: %d",
+				 (int) hdr->m_type);
+	}
 }
 
 /* ----------
  * pgstat_send_archiver() -
  *
- *	Tell the collector about the WAL file that we successfully
+ *	Tell the statistics system about the WAL file that we successfully
  *	archived or failed to archive.
  * ----------
  */
@@ -3117,7 +3095,7 @@ pgstat_send_archiver(const char *xlog, bool failed)
 /* ----------
  * pgstat_send_bgwriter() -
  *
- *		Send bgwriter statistics to the collector
+ *		Send bgwriter statistics to shared memory
  * ----------
  */
 void
@@ -3130,8 +3108,8 @@ pgstat_send_bgwriter(void)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid sending a completely empty batch to shared
+	 * memory.
 	 */
 	if (memcmp(&PendingBgWriterStats, &all_zeroes, sizeof(PgStat_MsgBgWriter)) == 0)
 		return;
@@ -3151,7 +3129,7 @@ pgstat_send_bgwriter(void)
 /* ----------
  * pgstat_send_checkpointer() -
  *
- *		Send checkpointer statistics to the collector
+ *		Send checkpointer statistics to shared memory
  * ----------
  */
 void
@@ -3162,8 +3140,8 @@ pgstat_send_checkpointer(void)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid sending a completely empty batch to shared
+	 * memory.
 	 */
 	if (memcmp(&PendingCheckpointerStats, &all_zeroes, sizeof(PgStat_MsgCheckpointer)) == 0)
 		return;
@@ -3183,7 +3161,7 @@ pgstat_send_checkpointer(void)
 /* ----------
  * pgstat_send_wal() -
  *
- *	Send WAL statistics to the collector.
+ *	Send WAL statistics to shared memory.
  *
  * If 'force' is not set, WAL stats message is only sent if enough time has
  * passed since last one was sent to reach PGSTAT_STAT_INTERVAL.
@@ -3196,8 +3174,8 @@ pgstat_send_wal(bool force)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid sending a completely empty batch to shared
+	 * memory.
 	 *
 	 * Check wal_records counter to determine whether any WAL activity has
 	 * happened since last time. Note that other WalUsage counters don't need
@@ -3227,8 +3205,8 @@ pgstat_send_wal(bool force)
 
 		/*
 		 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-		 * msec since we last sent one to avoid overloading the stats
-		 * collector.
+		 * msec since we last sent one to avoid contention on the shared
+		 * statistics.
 		 */
 		if (!TimestampDifferenceExceeds(sendTime, now, PGSTAT_STAT_INTERVAL))
 			return;
@@ -3277,7 +3255,7 @@ pgstat_send_wal(bool force)
 /* ----------
  * pgstat_send_slru() -
  *
- *		Send SLRU statistics to the collector
+ *		Send SLRU statistics to shared memory
  * ----------
  */
 static void
@@ -3290,8 +3268,8 @@ pgstat_send_slru(void)
 	{
 		/*
 		 * This function can be called even if nothing at all has happened. In
-		 * this case, avoid sending a completely empty message to the stats
-		 * collector.
+		 * this case, avoid sending a completely empty batch to shared
+		 * memory.
 		 */
 		if (memcmp(&SLRUStats[i], &all_zeroes, sizeof(PgStat_MsgSLRU)) == 0)
 			continue;
@@ -3312,314 +3290,265 @@ pgstat_send_slru(void)
 	}
 }
 
+/*
+ * pgstat_have_pending_io() -
+ *
+ *	Returns true if there are I/O statistics counts waiting to be sent.
+ */
+static bool
+pgstat_have_pending_io(void)
+{
+	/* We assume this initializes to zeroes */
+	static const PgStat_IOCounts all_zeroes[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+
+	return memcmp(PendingIOStats.m_counts, all_zeroes,
+				  sizeof(PendingIOStats.m_counts)) != 0;
+}
 
 /* ----------
- * PgstatCollectorMain() -
+ * pgstat_send_io() -
  *
- *	Start up the statistics collector process.  This is the body of the
- *	postmaster child process.
- *
- *	The argc/argv parameters are valid only in EXEC_BACKEND case.
+ *		Send I/O statistics to shared memory
  * ----------
  */
-NON_EXEC_STATIC void
-PgstatCollectorMain(int argc, char *argv[])
+void
+pgstat_send_io(void)
 {
-	int			len;
-	PgStat_Msg	msg;
-	int			wr;
-	WaitEvent	event;
-	WaitEventSet *wes;
+	pgstat_assert_is_up();
 
 	/*
-	 * Ignore all signals usually bound to some action in the postmaster,
-	 * except SIGHUP and SIGQUIT.  Note we don't need a SIGUSR1 handler to
-	 * support latch operations, because we only use a local latch.
+	 * This function can be called even if nothing at all has happened. In
+	 * this case, avoid sending a completely empty batch to shared
+	 * memory.
 	 */
-	pqsignal(SIGHUP, SignalHandlerForConfigReload);
-	pqsignal(SIGINT, SIG_IGN);
-	pqsignal(SIGTERM, SIG_IGN);
-	pqsignal(SIGQUIT, SignalHandlerForShutdownRequest);
-	pqsignal(SIGALRM, SIG_IGN);
-	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);
-	pqsignal(SIGUSR2, SIG_IGN);
-	/* Reset some signals that are accepted by postmaster but not here */
-	pqsignal(SIGCHLD, SIG_DFL);
-	PG_SETMASK(&UnBlockSig);
-
-	MyBackendType = B_STATS_COLLECTOR;
-	init_ps_display(NULL);
+	if (!pgstat_have_pending_io())
+		return;
+
+	/* counts are kept per backend type, so we need to know ours */
+	if (MyBackendType == B_INVALID)
+		return;
 
 	/*
-	 * Read in existing stats files or initialize the stats to zero.
+	 * Prepare and send the message
 	 */
-	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
-
-	/* Prepare to wait for our latch or data in our socket. */
-	wes = CreateWaitEventSet(CurrentMemoryContext, 3);
-	AddWaitEventToSet(wes, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
-	AddWaitEventToSet(wes, WL_POSTMASTER_DEATH, PGINVALID_SOCKET, NULL, NULL);
-	AddWaitEventToSet(wes, WL_SOCKET_READABLE, pgStatSock, NULL, NULL);
+	PendingIOStats.m_backend_type = MyBackendType;
+	pgstat_setheader(&PendingIOStats.m_hdr, PGSTAT_MTYPE_IO);
+	pgstat_send(&PendingIOStats, sizeof(PendingIOStats));
 
 	/*
-	 * Loop to process messages until we get SIGQUIT or detect ungraceful
-	 * death of our parent postmaster.
-	 *
-	 * For performance reasons, we don't want to do ResetLatch/WaitLatch after
-	 * every message; instead, do that only after a recv() fails to obtain a
-	 * message.  (This effectively means that if backends are sending us stuff
-	 * like mad, we won't notice postmaster death until things slack off a
-	 * bit; which seems fine.)	To do that, we have an inner loop that
-	 * iterates as long as recv() succeeds.  We do check ConfigReloadPending
-	 * inside the inner loop, which means that such interrupts will get
-	 * serviced but the latch won't get cleared until next time there is a
-	 * break in the action.
+	 * Clear out the statistics buffer, so it can be re-used.
 	 */
-	for (;;)
-	{
-		/* Clear any already-pending wakeups */
-		ResetLatch(MyLatch);
-
-		/*
-		 * Quit if we get SIGQUIT from the postmaster.
-		 */
-		if (ShutdownRequestPending)
-			break;
-
-		/*
-		 * Inner loop iterates as long as we keep getting messages, or until
-		 * ShutdownRequestPending becomes set.
-		 */
-		while (!ShutdownRequestPending)
-		{
-			/*
-			 * Reload configuration if we got SIGHUP from the postmaster.
-			 */
-			if (ConfigReloadPending)
-			{
-				ConfigReloadPending = false;
-				ProcessConfigFile(PGC_SIGHUP);
-			}
-
-			/*
-			 * Write the stats file(s) if a new request has arrived that is
-			 * not satisfied by existing file(s).
-			 */
-			if (pgstat_write_statsfile_needed())
-				pgstat_write_statsfiles(false, false);
-
-			/*
-			 * Try to receive and process a message.  This will not block,
-			 * since the socket is set to non-blocking mode.
-			 *
-			 * XXX On Windows, we have to force pgwin32_recv to cooperate,
-			 * despite the previous use of pg_set_noblock() on the socket.
-			 * This is extremely broken and should be fixed someday.
-			 */
-#ifdef WIN32
-			pgwin32_noblock = 1;
-#endif
-
-			len = recv(pgStatSock, (char *) &msg,
-					   sizeof(PgStat_Msg), 0);
-
-#ifdef WIN32
-			pgwin32_noblock = 0;
-#endif
-
-			if (len < 0)
-			{
-				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-					break;		/* out of inner loop */
-				ereport(ERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not read statistics message: %m")));
-			}
-
-			/*
-			 * We ignore messages that are smaller than our common header
-			 */
-			if (len < sizeof(PgStat_MsgHdr))
-				continue;
-
-			/*
-			 * The received length must match the length in the header
-			 */
-			if (msg.msg_hdr.m_size != len)
-				continue;
-
-			/*
-			 * O.K. - we accept this message.  Process it.
-			 */
-			switch (msg.msg_hdr.m_type)
-			{
-				case PGSTAT_MTYPE_DUMMY:
-					break;
-
-				case PGSTAT_MTYPE_INQUIRY:
-					pgstat_recv_inquiry(&msg.msg_inquiry, len);
-					break;
-
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat(&msg.msg_tabstat, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge(&msg.msg_tabpurge, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb(&msg.msg_dropdb, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter(&msg.msg_resetcounter, len);
-					break;
+	MemSet(&PendingIOStats, 0, sizeof(PendingIOStats));
+}
 
-				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
-					pgstat_recv_resetsharedcounter(&msg.msg_resetsharedcounter,
-												   len);
-					break;
+/*
+ * pgstat_count_io_time() -
+ *
+ *	Count the time taken by one read or write call of io_object's blocks
+ *	under io_context.  Only called when track_io_timing is on; the blocks
+ *	themselves are counted with pgstat_count_io_op().
+ */
+void
+pgstat_count_io_time(IOObject io_object, IOContext io_context, IOOp io_op,
+					 instr_time io_time)
+{
+	PgStat_IOCounts *counts = &PendingIOStats.m_counts[io_object][io_context];
+	uint64		usec = INSTR_TIME_GET_MICROSEC(io_time);
+	int			bucket;
 
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(&msg.msg_resetsinglecounter,
-												   len);
-					break;
+	bucket = (usec == 0) ? 0 : pg_leftmost_one_pos64(usec) + 1;
+	bucket = Min(bucket, PGSTAT_IO_TIME_BUCKETS - 1);
 
-				case PGSTAT_MTYPE_RESETSLRUCOUNTER:
-					pgstat_recv_resetslrucounter(&msg.msg_resetslrucounter,
-												 len);
-					break;
+	if (io_op == IOOP_READ)
+	{
+		counts->read_time += usec;
+		counts->read_histogram[bucket]++;
+	}
+	else
+	{
+		Assert(io_op == IOOP_WRITE);
+		counts->write_time += usec;
+		counts->write_histogram[bucket]++;
+	}
+}
 
-				case PGSTAT_MTYPE_RESETREPLSLOTCOUNTER:
-					pgstat_recv_resetreplslotcounter(&msg.msg_resetreplslotcounter,
-													 len);
-					break;
+/* ----------
+ * pgstat_get_db_entry() -
+ *
+ *	Lookup the shared entry for the specified database, and lock it, in
+ *	exclusive mode if 'exclusive' is true.  If no entry exists, create and
+ *	initialize one if 'create' is true, else return NULL.
+ *
+ *	The caller must release the entry with pgstat_release_db_entry().  While
+ *	the lock is held, the database's table and function hashes may be used;
+ *	see pgstat_db_tables() and pgstat_db_functions().
+ * ----------
+ */
+static PgStatShared_DBEntry *
+pgstat_get_db_entry(Oid databaseid, bool exclusive, bool create)
+{
+	PgStatShared_DBEntry *result;
+	bool		found;
 
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac(&msg.msg_autovacuum_start, len);
-					break;
+	pgstat_attach_shmem();
 
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum(&msg.msg_vacuum, len);
-					break;
+	for (;;)
+	{
+		result = dshash_find(pgStatSharedDBHash, &databaseid, exclusive);
+		if (result != NULL || !create)
+			return result;
 
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze(&msg.msg_analyze, len);
-					break;
+		/*
+		 * Not there, so create it.  dshash_find_or_insert returns the entry
+		 * exclusively locked; if that's not what the caller asked for, look
+		 * it up again.  Somebody might drop it in between, but then we just
+		 * go around again.
+		 */
+		result = dshash_find_or_insert(pgStatSharedDBHash, &databaseid, &found);
+		if (!found)
+		{
+			reset_dbentry_counters(&result->stats);
+			pgstat_create_db_hashes(result);
+		}
 
-				case PGSTAT_MTYPE_ARCHIVER:
-					pgstat_recv_archiver(&msg.msg_archiver, len);
-					break;
+		if (exclusive)
+			return result;
 
-				case PGSTAT_MTYPE_BGWRITER:
-					pgstat_recv_bgwriter(&msg.msg_bgwriter, len);
-					break;
+		dshash_release_lock(pgStatSharedDBHash, result);
+	}
+}
 
-				case PGSTAT_MTYPE_CHECKPOINTER:
-					pgstat_recv_checkpointer(&msg.msg_checkpointer, len);
-					break;
+/*
+ * Release the lock on a database entry obtained with pgstat_get_db_entry().
+ */
+static void
+pgstat_release_db_entry(PgStatShared_DBEntry *dbentry)
+{
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+}
 
-				case PGSTAT_MTYPE_WAL:
-					pgstat_recv_wal(&msg.msg_wal, len);
-					break;
+/*
+ * Create new, empty table and function hashes for a database entry, which
+ * must be locked exclusively.
+ */
+static void
+pgstat_create_db_hashes(PgStatShared_DBEntry *dbentry)
+{
+	MemoryContext oldcontext;
+	dshash_table *tables;
+	dshash_table *functions;
 
-				case PGSTAT_MTYPE_SLRU:
-					pgstat_recv_slru(&msg.msg_slru, len);
-					break;
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	tables = dshash_create(pgStatDSA, &tab_hash_params, NULL);
+	functions = dshash_create(pgStatDSA, &func_hash_params, NULL);
+	MemoryContextSwitchTo(oldcontext);
 
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat(&msg.msg_funcstat, len);
-					break;
+	dbentry->tables = dshash_get_hash_table_handle(tables);
+	dbentry->functions = dshash_get_hash_table_handle(functions);
+	dbentry->generation = pg_atomic_fetch_add_u64(&pgStatShmem->next_generation, 1);
 
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge(&msg.msg_funcpurge, len);
-					break;
+	/*
+	 * We could keep these attached, but there's no guarantee that this
+	 * process will ever use them again.
+	 */
+	dshash_detach(tables);
+	dshash_detach(functions);
+}
 
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict(&msg.msg_recoveryconflict,
-												 len);
-					break;
+/*
+ * Destroy the table and function hashes of a database entry, which must be
+ * locked exclusively.
+ */
+static void
+pgstat_destroy_db_hashes(PgStatShared_DBEntry *dbentry)
+{
+	Oid			databaseid = dbentry->stats.databaseid;
 
-				case PGSTAT_MTYPE_DEADLOCK:
-					pgstat_recv_deadlock(&msg.msg_deadlock, len);
-					break;
+	dshash_destroy(pgstat_db_tables(dbentry));
+	dshash_destroy(pgstat_db_functions(dbentry));
 
-				case PGSTAT_MTYPE_TEMPFILE:
-					pgstat_recv_tempfile(&msg.msg_tempfile, len);
-					break;
+	/* dshash_destroy released our attachments, so forget them */
+	(void) hash_search(pgStatDBAttachments, &databaseid, HASH_REMOVE, NULL);
+}
 
-				case PGSTAT_MTYPE_CHECKSUMFAILURE:
-					pgstat_recv_checksum_failure(&msg.msg_checksumfailure,
-												 len);
-					break;
+/*
+ * Return our attachment to the table and function hashes of a locked
+ * database entry, making it valid first if need be.
+ */
+static PgStat_DBAttachment *
+pgstat_get_db_attachment(PgStatShared_DBEntry *dbentry)
+{
+	PgStat_DBAttachment *att;
+	MemoryContext oldcontext;
+	bool		found;
 
-				case PGSTAT_MTYPE_REPLSLOT:
-					pgstat_recv_replslot(&msg.msg_replslot, len);
-					break;
+	if (pgStatDBAttachments == NULL)
+	{
+		HASHCTL		hash_ctl;
 
-				case PGSTAT_MTYPE_CONNECT:
-					pgstat_recv_connect(&msg.msg_connect, len);
-					break;
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_DBAttachment);
+		hash_ctl.hcxt = TopMemoryContext;
+		pgStatDBAttachments = hash_create("Database statistics attachments",
+										  PGSTAT_DB_HASH_SIZE,
+										  &hash_ctl,
+										  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
 
-				case PGSTAT_MTYPE_DISCONNECT:
-					pgstat_recv_disconnect(&msg.msg_disconnect, len);
-					break;
+	att = (PgStat_DBAttachment *) hash_search(pgStatDBAttachments,
+											  &dbentry->stats.databaseid,
+											  HASH_ENTER, &found);
 
-				default:
-					break;
-			}
-		}						/* end of inner message-processing loop */
+	if (found && att->generation == dbentry->generation)
+		return att;
 
-		/* Sleep until there's something to do */
-#ifndef WIN32
-		wr = WaitEventSetWait(wes, -1L, &event, 1, WAIT_EVENT_PGSTAT_MAIN);
-#else
+	/*
+	 * Our attachment, if any, is to hashes that have since been destroyed.
+	 * Detaching only frees local memory, so it's safe to do even though the
+	 * shared parts are gone.  Mark the entry invalid until we're done, in case
+	 * we fail partway through.
+	 */
+	if (found)
+	{
+		if (att->tables)
+			dshash_detach(att->tables);
+		if (att->functions)
+			dshash_detach(att->functions);
+	}
+	att->generation = 0;
+	att->tables = NULL;
+	att->functions = NULL;
 
-		/*
-		 * Windows, at least in its Windows Server 2003 R2 incarnation,
-		 * sometimes loses FD_READ events.  Waking up and retrying the recv()
-		 * fixes that, so don't sleep indefinitely.  This is a crock of the
-		 * first water, but until somebody wants to debug exactly what's
-		 * happening there, this is the best we can do.  The two-second
-		 * timeout matches our pre-9.2 behavior, and needs to be short enough
-		 * to not provoke "using stale statistics" complaints from
-		 * backend_read_statsfile.
-		 */
-		wr = WaitEventSetWait(wes, 2 * 1000L /* msec */ , &event, 1,
-							  WAIT_EVENT_PGSTAT_MAIN);
-#endif
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	att->tables = dshash_attach(pgStatDSA, &tab_hash_params,
+								dbentry->tables, NULL);
+	att->functions = dshash_attach(pgStatDSA, &func_hash_params,
+								   dbentry->functions, NULL);
+	MemoryContextSwitchTo(oldcontext);
 
-		/*
-		 * Emergency bailout if postmaster has died.  This is to avoid the
-		 * necessity for manual cleanup of all postmaster children.
-		 */
-		if (wr == 1 && event.events == WL_POSTMASTER_DEATH)
-			break;
-	}							/* end of outer loop */
+	att->generation = dbentry->generation;
 
-	/*
-	 * Save the final stats to reuse at next startup.
-	 */
-	pgstat_write_statsfiles(true, true);
+	return att;
+}
 
-	FreeWaitEventSet(wes);
+static dshash_table *
+pgstat_db_tables(PgStatShared_DBEntry *dbentry)
+{
+	return pgstat_get_db_attachment(dbentry)->tables;
+}
 
-	exit(0);
+static dshash_table *
+pgstat_db_functions(PgStatShared_DBEntry *dbentry)
+{
+	return pgstat_get_db_attachment(dbentry)->functions;
 }
 
 /*
  * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -3638,6 +3567,8 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->n_temp_files = 0;
 	dbentry->n_temp_bytes = 0;
 	dbentry->n_deadlocks = 0;
+	dbentry->n_deadlock_checks = 0;
+	dbentry->total_deadlock_check_time = 0;
 	dbentry->n_checksum_failures = 0;
 	dbentry->last_checksum_failure = 0;
 	dbentry->n_block_read_time = 0;
@@ -3649,75 +3580,27 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->n_sessions_abandoned = 0;
 	dbentry->n_sessions_fatal = 0;
 	dbentry->n_sessions_killed = 0;
+	memset(dbentry->wait_events, 0, sizeof(dbentry->wait_events));
+	memset(dbentry->wait_histograms, 0, sizeof(dbentry->wait_histograms));
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 	dbentry->stats_timestamp = 0;
-
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
-
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_BLOBS);
-}
-
-/*
- * Lookup the hash table entry for the specified database. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
- */
-static PgStat_StatDBEntry *
-pgstat_get_db_entry(Oid databaseid, bool create)
-{
-	PgStat_StatDBEntry *result;
-	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
-
-	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												&databaseid,
-												action, &found);
-
-	if (!create && !found)
-		return NULL;
-
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
-	if (!found)
-		reset_dbentry_counters(result);
-
-	return result;
 }
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Lookup the shared entry for the specified table, creating and initializing
+ * it if it doesn't exist yet.  The entry is returned exclusively locked.
  */
 static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+pgstat_get_tab_entry(dshash_table *tables, Oid tableoid)
 {
 	PgStat_StatTabEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
 	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
-
-	if (!create && !found)
-		return NULL;
+	result = (PgStat_StatTabEntry *) dshash_find_or_insert(tables, &tableoid,
+														   &found);
 
 	/* If not found, initialize the new one. */
 	if (!found)
@@ -3748,34 +3631,32 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 	return result;
 }
 
-
 /* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
- *
- *	'permanent' specifies writing to the permanent files not temporary ones.
- *	When true (happens only when the collector is shutting down), also remove
- *	the temporary files so that backends starting up under a new postmaster
- *	can't read old data before the new collector is ready.
- *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	pending_write_requests) will be written; otherwise, all databases
- *	will be written.
+ * pgstat_write_statsfile() -
+ *		Write all statistics held in shared memory to the stats file.
+ *
+ *	This is called at the end of every checkpoint and restartpoint,
+ *	including the shutdown checkpoint, so that the statistics survive a
+ *	restart, and a crash costs no more than the activity since the last
+ *	checkpoint.  The file is written under a temporary name and renamed into
+ *	place, so that a crash while writing leaves the previous file intact.
  * ----------
  */
-static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+void
+pgstat_write_statsfile(void)
 {
-	HASH_SEQ_STATUS hstat;
-	PgStat_StatDBEntry *dbentry;
+	dshash_seq_status hstat;
+	PgStatShared_DBEntry *dbentry;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 	int			rc;
 
 	elog(DEBUG2, "writing stats file \"%s\"", statfile);
 
+	pgstat_attach_shmem();
+
 	/*
 	 * Open the statistics temp file to write out the current values.
 	 */
@@ -3789,11 +3670,6 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		return;
 	}
 
-	/*
-	 * Set the timestamp of the stats file.
-	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
-
 	/*
 	 * Write the file header --- currently just a format ID.
 	 */
@@ -3802,71 +3678,73 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Write global stats struct
+	 * Write the global, archiver, WAL, I/O and SLRU stats structs.
 	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	LWLockAcquire(&pgStatShmem->lock, LW_SHARED);
+	pgStatShmem->global.stats_timestamp = GetCurrentTimestamp();
+	rc = fwrite(&pgStatShmem->global, sizeof(pgStatShmem->global), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write archiver stats struct
-	 */
-	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
+	rc = fwrite(&pgStatShmem->archiver, sizeof(pgStatShmem->archiver), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write WAL stats struct
-	 */
-	rc = fwrite(&walStats, sizeof(walStats), 1, fpout);
+	rc = fwrite(&pgStatShmem->wal, sizeof(pgStatShmem->wal), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write SLRU stats struct
-	 */
-	rc = fwrite(slruStats, sizeof(slruStats), 1, fpout);
+	rc = fwrite(&pgStatShmem->io, sizeof(pgStatShmem->io), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+	rc = fwrite(pgStatShmem->slru, sizeof(pgStatShmem->slru), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
+	LWLockRelease(&pgStatShmem->lock);
 
 	/*
-	 * Walk through the database table.
+	 * Walk through the database table.  Each database's entry is followed by
+	 * the entries of its tables and functions.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
-		 */
-		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			/* Make DB's timestamp consistent with the global stats */
-			dbentry->stats_timestamp = globalStats.stats_timestamp;
-
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
+		dshash_seq_status tstat;
+		PgStat_StatTabEntry *tabentry;
+		PgStat_StatFuncEntry *funcentry;
 
-		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
-		 */
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(&dbentry->stats, sizeof(PgStat_StatDBEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
+
+		dshash_seq_init(&tstat, pgstat_db_tables(dbentry), false);
+		while ((tabentry = dshash_seq_next(&tstat)) != NULL)
+		{
+			fputc('T', fpout);
+			rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
+			(void) rc;			/* we'll check for error with ferror */
+		}
+		dshash_seq_term(&tstat);
+
+		dshash_seq_init(&tstat, pgstat_db_functions(dbentry), false);
+		while ((funcentry = dshash_seq_next(&tstat)) != NULL)
+		{
+			fputc('F', fpout);
+			rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
+			(void) rc;			/* we'll check for error with ferror */
+		}
+		dshash_seq_term(&tstat);
 	}
+	dshash_seq_term(&hstat);
 
 	/*
-	 * Write replication slot stats struct
+	 * Write replication slot stats structs
 	 */
-	if (replSlotStatHash)
+	LWLockAcquire(&pgStatShmem->lock, LW_SHARED);
+	for (int i = 0; i < max_replication_slots; i++)
 	{
-		PgStat_StatReplSlotEntry *slotent;
+		PgStat_StatReplSlotEntry *slotent = &pgStatShmem->replslots[i];
 
-		hash_seq_init(&hstat, replSlotStatHash);
-		while ((slotent = (PgStat_StatReplSlotEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			fputc('R', fpout);
-			rc = fwrite(slotent, sizeof(PgStat_StatReplSlotEntry), 1, fpout);
-			(void) rc;			/* we'll check for error with ferror */
-		}
+		if (NameStr(slotent->slotname)[0] == '\0')
+			continue;
+
+		fputc('R', fpout);
+		rc = fwrite(slotent, sizeof(PgStat_StatReplSlotEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
 	}
+	LWLockRelease(&pgStatShmem->lock);
 
 	/*
 	 * No more output to be done. Close the temp file and replace the old
@@ -3900,929 +3778,198 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 						tmpfile, statfile)));
 		unlink(tmpfile);
 	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
-
-	/*
-	 * Now throw away the list of requests.  Note that requests sent after we
-	 * started the write are still waiting on the network socket.
-	 */
-	list_free(pending_write_requests);
-	pending_write_requests = NIL;
-}
-
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed >= len)
-		elog(ERROR, "overlength pgstat path");
 }
 
 /* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
+ * pgstat_restore_stats() -
+ *
+ *	Load the statistics saved by pgstat_write_statsfile() into shared
+ *	memory.  Called by the startup process, before anybody else can be
+ *	reporting statistics.
  *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+ *	A missing or corrupted file is not an error; we just start with whatever
+ *	we managed to read.
  * ----------
  */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
+void
+pgstat_restore_stats(void)
 {
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
+	PgStatShared_DBEntry *dbentry = NULL;
+	PgStat_StatDBEntry dbbuf;
+	PgStat_GlobalStats globalbuf;
+	PgStat_ArchiverStats archiverbuf;
+	PgStat_WalStats walbuf;
+	PgStat_IOStats iobuf;
+	PgStat_SLRUStats slrubuf[SLRU_NUM_ELEMENTS];
+	FILE	   *fpin;
 	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
+	bool		found;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 
-	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+	pgstat_attach_shmem();
 
 	/*
-	 * Open the statistics temp file to write out the current values.
+	 * Try to open the stats file.  If it doesn't exist, we simply start from
+	 * scratch with empty counters.  ENOENT is to be expected if the cluster
+	 * was never checkpointed or the file was removed; any other failure
+	 * condition is suspicious.
 	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
-	}
-
-	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
-	{
-		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
-	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write temporary statistics file \"%s\": %m",
-						tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close temporary statistics file \"%s\": %m",
-						tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
-/* ----------
- * pgstat_read_statsfiles() -
- *
- *	Reads in some existing statistics collector files and returns the
- *	databases hash table that is the top level of the data.
- *
- *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
- *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
- *	hash tables for other databases.
- *
- *	'permanent' specifies reading from the permanent files not temporary ones.
- *	When true (happens only when the collector is starting up), remove the
- *	files after reading; the in-memory status is now authoritative, and the
- *	files would be out of date in case somebody else reads them.
- *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
- * ----------
- */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-	int			i;
-	TimestampTz	ts;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-	/*
-	 * Clear out global, archiver, WAL and SLRU statistics so they start from
-	 * zero in case we can't load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-	memset(&archiverStats, 0, sizeof(archiverStats));
-	memset(&walStats, 0, sizeof(walStats));
-	memset(&slruStats, 0, sizeof(slruStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	ts = GetCurrentTimestamp();
-	globalStats.bgwriter.stat_reset_timestamp = ts;
-	archiverStats.stat_reset_timestamp = ts;
-	walStats.stat_reset_timestamp = ts;
-
-	/*
-	 * Set the same reset timestamp for all SLRU items too.
-	 */
-	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
-		slruStats[i].stat_reset_timestamp = ts;
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
 		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
+			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return dbhash;
+		return;
 	}
 
 	/*
-	 * Verify it's of the expected format.
+	 * Verify it's of the expected format, and read the fixed-size stats.
 	 */
 	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
+		format_id != PGSTAT_FILE_FORMAT_ID ||
+		fread(&globalbuf, 1, sizeof(globalbuf), fpin) != sizeof(globalbuf) ||
+		fread(&archiverbuf, 1, sizeof(archiverbuf), fpin) != sizeof(archiverbuf) ||
+		fread(&walbuf, 1, sizeof(walbuf), fpin) != sizeof(walbuf) ||
+		fread(&iobuf, 1, sizeof(iobuf), fpin) != sizeof(iobuf) ||
+		fread(slrubuf, 1, sizeof(slrubuf), fpin) != sizeof(slrubuf))
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
+		ereport(LOG,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&globalStats, 0, sizeof(globalStats));
 		goto done;
 	}
 
-	/*
-	 * In the collector, disregard the timestamp we read from the permanent
-	 * stats file; we should be willing to write a temp stats file immediately
-	 * upon the first request from any backend.  This only matters if the old
-	 * file's timestamp is less than PGSTAT_STAT_INTERVAL ago, but that's not
-	 * an unusual scenario.
-	 */
-	if (pgStatRunningInCollector)
-		globalStats.stats_timestamp = 0;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+	memcpy(&pgStatShmem->global, &globalbuf, sizeof(globalbuf));
+	memcpy(&pgStatShmem->archiver, &archiverbuf, sizeof(archiverbuf));
+	memcpy(&pgStatShmem->wal, &walbuf, sizeof(walbuf));
+	memcpy(&pgStatShmem->io, &iobuf, sizeof(iobuf));
+	memcpy(pgStatShmem->slru, slrubuf, sizeof(slrubuf));
+	LWLockRelease(&pgStatShmem->lock);
 
 	/*
-	 * Read archiver stats struct
+	 * Now read the database, table, function and replication slot entries.
+	 * Table and function entries belong to the database entry preceding
+	 * them, which we keep locked until we're done with it.
 	 */
-	if (fread(&archiverStats, 1, sizeof(archiverStats), fpin) != sizeof(archiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		goto done;
-	}
-
-	/*
-	 * Read WAL stats struct
-	 */
-	if (fread(&walStats, 1, sizeof(walStats), fpin) != sizeof(walStats))
+	for (;;)
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&walStats, 0, sizeof(walStats));
-		goto done;
-	}
+		int			c = fgetc(fpin);
 
-	/*
-	 * Read SLRU stats struct
-	 */
-	if (fread(slruStats, 1, sizeof(slruStats), fpin) != sizeof(slruStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&slruStats, 0, sizeof(slruStats));
-		goto done;
-	}
+		if (dbentry != NULL && c != 'T' && c != 'F')
+		{
+			pgstat_release_db_entry(dbentry);
+			dbentry = NULL;
+		}
 
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
+		switch (c)
 		{
 				/*
 				 * 'D'	A PgStat_StatDBEntry struct describing a database
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-															 (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * In the collector, disregard the timestamp we read from the
-				 * permanent stats file; we should be willing to write a temp
-				 * stats file immediately upon the first request from any
-				 * backend.
-				 */
-				if (pgStatRunningInCollector)
-					dbentry->stats_timestamp = 0;
-
-				/*
-				 * Don't create tables/functions hashtables for uninteresting
-				 * databases.
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
+				if (fread(&dbbuf, 1, sizeof(PgStat_StatDBEntry),
+						  fpin) != sizeof(PgStat_StatDBEntry))
+					goto corrupted;
 
+				dbentry = pgstat_get_db_entry(dbbuf.databaseid, true, true);
+				memcpy(&dbentry->stats, &dbbuf, sizeof(PgStat_StatDBEntry));
 				break;
 
-				/*
-				 * 'R'	A PgStat_StatReplSlotEntry struct describing a
-				 * replication slot follows.
-				 */
-			case 'R':
-				{
-					PgStat_StatReplSlotEntry slotbuf;
-					PgStat_StatReplSlotEntry *slotent;
-
-					if (fread(&slotbuf, 1, sizeof(PgStat_StatReplSlotEntry), fpin)
-						!= sizeof(PgStat_StatReplSlotEntry))
-					{
-						ereport(pgStatRunningInCollector ? LOG : WARNING,
-								(errmsg("corrupted statistics file \"%s\"",
-										statfile)));
-						goto done;
-					}
-
-					/* Create hash table if we don't have it already. */
-					if (replSlotStatHash == NULL)
-					{
-						HASHCTL		hash_ctl;
-
-						hash_ctl.keysize = sizeof(NameData);
-						hash_ctl.entrysize = sizeof(PgStat_StatReplSlotEntry);
-						hash_ctl.hcxt = pgStatLocalContext;
-						replSlotStatHash = hash_create("Replication slots hash",
-													   PGSTAT_REPLSLOT_HASH_SIZE,
-													   &hash_ctl,
-													   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-					}
-
-					slotent = (PgStat_StatReplSlotEntry *) hash_search(replSlotStatHash,
-																	   (void *) &slotbuf.slotname,
-																	   HASH_ENTER, NULL);
-					memcpy(slotent, &slotbuf, sizeof(PgStat_StatReplSlotEntry));
-					break;
-				}
-
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
-}
-
-
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
- *
- *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
 				/*
 				 * 'T'	A PgStat_StatTabEntry follows.
 				 */
 			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table data not wanted.
-				 */
-				if (tabhash == NULL)
+					PgStat_StatTabEntry tabbuf;
+					PgStat_StatTabEntry *tabentry;
+					dshash_table *tables;
+
+					if (dbentry == NULL ||
+						fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
+							  fpin) != sizeof(PgStat_StatTabEntry))
+						goto corrupted;
+
+					tables = pgstat_db_tables(dbentry);
+					tabentry = dshash_find_or_insert(tables, &tabbuf.tableid,
+													 &found);
+					memcpy(tabentry, &tabbuf, sizeof(PgStat_StatTabEntry));
+					dshash_release_lock(tables, tabentry);
+					if (found)
+						goto corrupted;
 					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
 				}
 
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
 				/*
 				 * 'F'	A PgStat_StatFuncEntry follows.
 				 */
 			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if function data not wanted.
-				 */
-				if (funchash == NULL)
+					PgStat_StatFuncEntry funcbuf;
+					PgStat_StatFuncEntry *funcentry;
+					dshash_table *functions;
+
+					if (dbentry == NULL ||
+						fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
+							  fpin) != sizeof(PgStat_StatFuncEntry))
+						goto corrupted;
+
+					functions = pgstat_db_functions(dbentry);
+					funcentry = dshash_find_or_insert(functions,
+													  &funcbuf.functionid,
+													  &found);
+					memcpy(funcentry, &funcbuf, sizeof(PgStat_StatFuncEntry));
+					dshash_release_lock(functions, funcentry);
+					if (found)
+						goto corrupted;
 					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-																 (void *) &funcbuf.functionid,
-																 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
-				break;
-
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
-/* ----------
- * pgstat_read_db_statsfile_timestamp() -
- *
- *	Attempt to determine the timestamp of the last db statfile write.
- *	Returns true if successful; the timestamp is stored in *ts. The caller must
- *	rely on timestamp stored in *ts iff the function returns true.
- *
- *	This needs to be careful about handling databases for which no stats file
- *	exists, such as databases without a stat entry or those not yet written:
- *
- *	- if there's a database entry in the global file, return the corresponding
- *	stats_timestamp value.
- *
- *	- if there's no db stat entry (e.g. for a new or inactive database),
- *	there's no stats_timestamp value, but also nothing to write so we return
- *	the timestamp of the global statfile.
- * ----------
- */
-static bool
-pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
-								   TimestampTz *ts)
-{
-	PgStat_StatDBEntry dbentry;
-	PgStat_GlobalStats myGlobalStats;
-	PgStat_ArchiverStats myArchiverStats;
-	PgStat_WalStats myWalStats;
-	PgStat_SLRUStats mySLRUStats[SLRU_NUM_ELEMENTS];
-	PgStat_StatReplSlotEntry myReplSlotStats;
-	FILE	   *fpin;
-	int32		format_id;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * Try to open the stats file.  As above, anything but ENOENT is worthy of
-	 * complaining about.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return false;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats),
-			  fpin) != sizeof(myGlobalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&myArchiverStats, 1, sizeof(myArchiverStats),
-			  fpin) != sizeof(myArchiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read WAL stats struct
-	 */
-	if (fread(&myWalStats, 1, sizeof(myWalStats), fpin) != sizeof(myWalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read SLRU stats struct
-	 */
-	if (fread(mySLRUStats, 1, sizeof(mySLRUStats), fpin) != sizeof(mySLRUStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/* By default, we're going to return the timestamp of the global file. */
-	*ts = myGlobalStats.stats_timestamp;
-
-	/*
-	 * We found an existing collector stats file.  Read it and look for a
-	 * record for the requested database.  If found, use its timestamp.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-
-				/*
-				 * If this is the DB we're looking for, save its timestamp and
-				 * we're done.
-				 */
-				if (dbentry.databaseid == databaseid)
-				{
-					*ts = dbentry.stats_timestamp;
-					goto done;
 				}
 
-				break;
-
 				/*
 				 * 'R'	A PgStat_StatReplSlotEntry struct describing a
 				 * replication slot follows.
 				 */
 			case 'R':
-				if (fread(&myReplSlotStats, 1, sizeof(PgStat_StatReplSlotEntry), fpin)
-					!= sizeof(PgStat_StatReplSlotEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
+					PgStat_StatReplSlotEntry slotbuf;
+					int			idx;
+
+					if (fread(&slotbuf, 1, sizeof(PgStat_StatReplSlotEntry), fpin)
+						!= sizeof(PgStat_StatReplSlotEntry))
+						goto corrupted;
+
+					/*
+					 * If max_replication_slots was lowered, we might not have
+					 * room for all of them; forget the extra ones.
+					 */
+					LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+					idx = pgstat_get_replslot_index(NameStr(slotbuf.slotname),
+													true);
+					if (idx >= 0)
+						memcpy(&pgStatShmem->replslots[idx], &slotbuf,
+							   sizeof(PgStat_StatReplSlotEntry));
+					LWLockRelease(&pgStatShmem->lock);
+					break;
 				}
-				break;
 
 			case 'E':
 				goto done;
 
 			default:
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
+				goto corrupted;
 		}
 	}
 
-done:
-	FreeFile(fpin);
-	return true;
-}
-
-/*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
- */
-static void
-backend_read_statsfile(void)
-{
-	TimestampTz min_ts = 0;
-	TimestampTz ref_ts = 0;
-	Oid			inquiry_db;
-	int			count;
-
-	pgstat_assert_is_up();
-
-	/* already read it? */
-	if (pgStatDBHash)
-		return;
-	Assert(!pgStatRunningInCollector);
-
-	/*
-	 * In a normal backend, we check staleness of the data for our own DB, and
-	 * so we send MyDatabaseId in inquiry messages.  In the autovac launcher,
-	 * check staleness of the shared-catalog data, and send InvalidOid in
-	 * inquiry messages so as not to force writing unnecessary data.
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		inquiry_db = InvalidOid;
-	else
-		inquiry_db = MyDatabaseId;
-
-	/*
-	 * Loop until fresh enough stats file is available or we ran out of time.
-	 * The stats inquiry message is sent repeatedly in case collector drops
-	 * it; but not every single time, as that just swamps the collector.
-	 */
-	for (count = 0; count < PGSTAT_POLL_LOOP_COUNT; count++)
-	{
-		bool		ok;
-		TimestampTz file_ts = 0;
-		TimestampTz cur_ts;
-
-		CHECK_FOR_INTERRUPTS();
-
-		ok = pgstat_read_db_statsfile_timestamp(inquiry_db, false, &file_ts);
-
-		cur_ts = GetCurrentTimestamp();
-		/* Calculate min acceptable timestamp, if we didn't already */
-		if (count == 0 || cur_ts < ref_ts)
-		{
-			/*
-			 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL
-			 * msec before now.  This indirectly ensures that the collector
-			 * needn't write the file more often than PGSTAT_STAT_INTERVAL. In
-			 * an autovacuum worker, however, we want a lower delay to avoid
-			 * using stale data, so we use PGSTAT_RETRY_DELAY (since the
-			 * number of workers is low, this shouldn't be a problem).
-			 *
-			 * We don't recompute min_ts after sleeping, except in the
-			 * unlikely case that cur_ts went backwards.  So we might end up
-			 * accepting a file a bit older than PGSTAT_STAT_INTERVAL.  In
-			 * practice that shouldn't happen, though, as long as the sleep
-			 * time is less than PGSTAT_STAT_INTERVAL; and we don't want to
-			 * tell the collector that our cutoff time is less than what we'd
-			 * actually accept.
-			 */
-			ref_ts = cur_ts;
-			if (IsAutoVacuumWorkerProcess())
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_RETRY_DELAY);
-			else
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_STAT_INTERVAL);
-		}
-
-		/*
-		 * If the file timestamp is actually newer than cur_ts, we must have
-		 * had a clock glitch (system time went backwards) or there is clock
-		 * skew between our processor and the stats collector's processor.
-		 * Accept the file, but send an inquiry message anyway to make
-		 * pgstat_recv_inquiry do a sanity check on the collector's time.
-		 */
-		if (ok && file_ts > cur_ts)
-		{
-			/*
-			 * A small amount of clock skew between processors isn't terribly
-			 * surprising, but a large difference is worth logging.  We
-			 * arbitrarily define "large" as 1000 msec.
-			 */
-			if (file_ts >= TimestampTzPlusMilliseconds(cur_ts, 1000))
-			{
-				char	   *filetime;
-				char	   *mytime;
-
-				/* Copy because timestamptz_to_str returns a static buffer */
-				filetime = pstrdup(timestamptz_to_str(file_ts));
-				mytime = pstrdup(timestamptz_to_str(cur_ts));
-				ereport(LOG,
-						(errmsg("statistics collector's time %s is later than backend local time %s",
-								filetime, mytime)));
-				pfree(filetime);
-				pfree(mytime);
-			}
-
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
-			break;
-		}
-
-		/* Normal acceptance case: file is not older than cutoff time */
-		if (ok && file_ts >= min_ts)
-			break;
-
-		/* Not there or too old, so kick the collector and wait a bit */
-		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
-
-		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
-	}
-
-	if (count >= PGSTAT_POLL_LOOP_COUNT)
-		ereport(LOG,
-				(errmsg("using stale statistics instead of current ones "
-						"because stats collector is not responding")));
+corrupted:
+	if (dbentry != NULL)
+		pgstat_release_db_entry(dbentry);
+	ereport(LOG,
+			(errmsg("corrupted statistics file \"%s\"", statfile)));
 
-	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.  Regular backends want a deep read for just the tables
-	 * they can see (MyDatabaseId + shared catalogs).
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
+done:
+	FreeFile(fpin);
 }
 
 
@@ -4875,7 +4022,7 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
-	replSlotStatHash = NULL;
+	have_global_snapshot = false;
 
 	/*
 	 * Historically the backend_status.c facilities lived in this file, and
@@ -4887,97 +4034,89 @@ pgstat_clear_snapshot(void)
 
 
 /* ----------
- * pgstat_recv_inquiry() -
+ * pgstat_snapshot_db() -
  *
- *	Process stat inquiry requests.
+ *	Return the snapshot entry for the given database, copying the database's
+ *	statistics out of shared memory if they're not in the snapshot yet.  A
+ *	database without statistics gets a snapshot entry too, with NULL stats,
+ *	so that we don't keep looking for it.
  * ----------
  */
-static void
-pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
+static PgStat_SnapshotDBEntry *
+pgstat_snapshot_db(Oid databaseid)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_SnapshotDBEntry *snapdb;
+	PgStatShared_DBEntry *dbentry;
+	bool		found;
 
-	elog(DEBUG2, "received inquiry for database %u", msg->databaseid);
+	pgstat_assert_is_up();
 
-	/*
-	 * If there's already a write request for this DB, there's nothing to do.
-	 *
-	 * Note that if a request is found, we return early and skip the below
-	 * check for clock skew.  This is okay, since the only way for a DB
-	 * request to be present in the list is that we have been here since the
-	 * last write round.  It seems sufficient to check for clock skew once per
-	 * write round.
-	 */
-	if (list_member_oid(pending_write_requests, msg->databaseid))
-		return;
+	/* The snapshot lives in pgStatLocalContext */
+	pgstat_setup_memcxt();
 
-	/*
-	 * Check to see if we last wrote this database at a time >= the requested
-	 * cutoff time.  If so, this is a stale request that was generated before
-	 * we updated the DB file, and we don't need to do so again.
-	 *
-	 * If the requestor's local clock time is older than stats_timestamp, we
-	 * should suspect a clock glitch, ie system time going backwards; though
-	 * the more likely explanation is just delayed message receipt.  It is
-	 * worth expending a GetCurrentTimestamp call to be sure, since a large
-	 * retreat in the system clock reading could otherwise cause us to neglect
-	 * to update the stats file for a long time.
-	 */
-	dbentry = pgstat_get_db_entry(msg->databaseid, false);
-	if (dbentry == NULL)
+	if (pgStatDBHash == NULL)
 	{
-		/*
-		 * We have no data for this DB.  Enter a write request anyway so that
-		 * the global stats will get updated.  This is needed to prevent
-		 * backend_read_statsfile from waiting for data that we cannot supply,
-		 * in the case of a new DB that nobody has yet reported any stats for.
-		 * See the behavior of pgstat_read_db_statsfile_timestamp.
-		 */
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_SnapshotDBEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatDBHash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE,
+								   &hash_ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 	}
-	else if (msg->clock_time < dbentry->stats_timestamp)
-	{
-		TimestampTz cur_ts = GetCurrentTimestamp();
 
-		if (cur_ts < dbentry->stats_timestamp)
-		{
-			/*
-			 * Sure enough, time went backwards.  Force a new stats file write
-			 * to get back in sync; but first, log a complaint.
-			 */
-			char	   *writetime;
-			char	   *mytime;
+	snapdb = (PgStat_SnapshotDBEntry *) hash_search(pgStatDBHash,
+													(void *) &databaseid,
+													HASH_ENTER, &found);
+	if (found)
+		return snapdb;
 
-			/* Copy because timestamptz_to_str returns a static buffer */
-			writetime = pstrdup(timestamptz_to_str(dbentry->stats_timestamp));
-			mytime = pstrdup(timestamptz_to_str(cur_ts));
-			ereport(LOG,
-					(errmsg("stats_timestamp %s is later than collector's time %s for database %u",
-							writetime, mytime, dbentry->databaseid)));
-			pfree(writetime);
-			pfree(mytime);
-		}
-		else
-		{
-			/*
-			 * Nope, it's just an old request.  Assuming msg's clock_time is
-			 * >= its cutoff_time, it must be stale, so we can ignore it.
-			 */
-			return;
-		}
-	}
-	else if (msg->cutoff_time <= dbentry->stats_timestamp)
+	snapdb->stats = NULL;
+	snapdb->tables = NULL;
+	snapdb->functions = NULL;
+
+	dbentry = pgstat_get_db_entry(databaseid, false, false);
+	if (dbentry != NULL)
 	{
-		/* Stale request, ignore it */
-		return;
+		snapdb->stats = MemoryContextAlloc(pgStatLocalContext,
+										   sizeof(PgStat_StatDBEntry));
+		memcpy(snapdb->stats, &dbentry->stats, sizeof(PgStat_StatDBEntry));
+		pgstat_release_db_entry(dbentry);
+
+		snapdb->stats->stats_timestamp = GetCurrentTimestamp();
 	}
 
-	/*
-	 * We need to write this DB, so create a request.
-	 */
-	pending_write_requests = lappend_oid(pending_write_requests,
-										 msg->databaseid);
+	return snapdb;
 }
 
+/* ----------
+ * pgstat_snapshot_global() -
+ *
+ *	Copy the fixed-size cluster-wide statistics out of shared memory, if not
+ *	done yet for the current snapshot.
+ * ----------
+ */
+static void
+pgstat_snapshot_global(void)
+{
+	pgstat_assert_is_up();
+
+	if (have_global_snapshot)
+		return;
+
+	LWLockAcquire(&pgStatShmem->lock, LW_SHARED);
+	memcpy(&globalStats, &pgStatShmem->global, sizeof(globalStats));
+	memcpy(&archiverStats, &pgStatShmem->archiver, sizeof(archiverStats));
+	memcpy(&walStats, &pgStatShmem->wal, sizeof(walStats));
+	memcpy(&ioStats, &pgStatShmem->io, sizeof(ioStats));
+	memcpy(slruStats, pgStatShmem->slru, sizeof(slruStats));
+	LWLockRelease(&pgStatShmem->lock);
+
+	globalStats.stats_timestamp = GetCurrentTimestamp();
+
+	have_global_snapshot = true;
+}
 
 /* ----------
  * pgstat_recv_tabstat() -
@@ -4988,35 +4127,35 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 static void
 pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
+	dshash_table *tables = NULL;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_TableCounts dbcounts;
 	int			i;
 	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
 	/*
-	 * Update database-wide stats.
+	 * Process all table entries in the message.  Holding the database entry
+	 * locked in shared mode is enough for that, and lets other backends
+	 * update other tables of the same database concurrently.  The totals for
+	 * the database are accumulated locally meanwhile.
 	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
-	dbentry->n_block_read_time += msg->m_block_read_time;
-	dbentry->n_block_write_time += msg->m_block_write_time;
+	memset(&dbcounts, 0, sizeof(dbcounts));
 
-	dbentry->total_session_time += msg->m_session_time;
-	dbentry->total_active_time += msg->m_active_time;
-	dbentry->total_idle_in_xact_time += msg->m_idle_in_xact_time;
+	if (msg->m_nentries > 0)
+	{
+		shdbentry = pgstat_get_db_entry(msg->m_databaseid, false, true);
+		tables = pgstat_db_tables(shdbentry);
+	}
 
-	/*
-	 * Process all table entries in the message.
-	 */
 	for (i = 0; i < msg->m_nentries; i++)
 	{
 		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
 
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
+		tabentry = (PgStat_StatTabEntry *) dshash_find_or_insert(tables,
+																 &(tabmsg->t_id),
+																 &found);
 
 		if (!found)
 		{
@@ -5082,50 +4221,47 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 		/* Likewise for n_dead_tuples */
 		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
 
+		dshash_release_lock(tables, tabentry);
+
 		/*
-		 * Add per-table stats to the per-database entry, too.
+		 * Add per-table stats to the per-database totals, too.
 		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
+		dbcounts.t_tuples_returned += tabmsg->t_counts.t_tuples_returned;
+		dbcounts.t_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
+		dbcounts.t_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
+		dbcounts.t_tuples_updated += tabmsg->t_counts.t_tuples_updated;
+		dbcounts.t_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
+		dbcounts.t_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
+		dbcounts.t_blocks_hit += tabmsg->t_counts.t_blocks_hit;
 	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	if (msg->m_nentries > 0)
+		pgstat_release_db_entry(shdbentry);
 
 	/*
-	 * No need to purge if we don't even know the database.
+	 * Update database-wide stats.
 	 */
-	if (!dbentry || !dbentry->tables)
-		return;
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
+	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
+	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
+	dbentry->n_block_read_time += msg->m_block_read_time;
+	dbentry->n_block_write_time += msg->m_block_write_time;
+
+	dbentry->total_session_time += msg->m_session_time;
+	dbentry->total_active_time += msg->m_active_time;
+	dbentry->total_idle_in_xact_time += msg->m_idle_in_xact_time;
+
+	dbentry->n_tuples_returned += dbcounts.t_tuples_returned;
+	dbentry->n_tuples_fetched += dbcounts.t_tuples_fetched;
+	dbentry->n_tuples_inserted += dbcounts.t_tuples_inserted;
+	dbentry->n_tuples_updated += dbcounts.t_tuples_updated;
+	dbentry->n_tuples_deleted += dbcounts.t_tuples_deleted;
+	dbentry->n_blocks_fetched += dbcounts.t_blocks_fetched;
+	dbentry->n_blocks_hit += dbcounts.t_blocks_hit;
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 
@@ -5139,39 +4275,23 @@ static void
 pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 {
 	Oid			dbid = msg->m_databaseid;
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
 
 	/*
 	 * Lookup the database in the hashtable.
 	 */
-	dbentry = pgstat_get_db_entry(dbid, false);
+	dbentry = pgstat_get_db_entry(dbid, true, false);
 
 	/*
-	 * If found, remove it (along with the db statfile).
+	 * If found, remove it, along with its table and function hashes.
 	 */
 	if (dbentry)
 	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing stats file \"%s\"", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
-		if (hash_search(pgStatDBHash,
-						(void *) &dbid,
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted during cleanup --- abort")));
+		pgstat_destroy_db_hashes(dbentry);
+		dshash_delete_entry(pgStatSharedDBHash, dbentry);
 	}
 }
 
-
 /* ----------
  * pgstat_recv_resetcounter() -
  *
@@ -5181,33 +4301,29 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 static void
 pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
 
 	/*
 	 * Lookup the database in the hashtable.  Nothing to do if not there.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true, false);
 
 	if (!dbentry)
 		return;
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
+	 * We simply throw away all the database's table entries by recreating
+	 * new hash tables for them.
 	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
+	pgstat_destroy_db_hashes(dbentry);
+	pgstat_create_db_hashes(dbentry);
 
 	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * Reset database-level stats, too.
 	 */
-	reset_dbentry_counters(dbentry);
+	reset_dbentry_counters(&dbentry->stats);
+
+	pgstat_release_db_entry(dbentry);
 }
 
 /* ----------
@@ -5219,29 +4335,39 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 static void
 pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 {
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
 	if (msg->m_resettarget == RESET_BGWRITER)
 	{
 		/* Reset the global, bgwriter and checkpointer statistics for the cluster. */
-		memset(&globalStats, 0, sizeof(globalStats));
-		globalStats.bgwriter.stat_reset_timestamp = GetCurrentTimestamp();
+		memset(&pgStatShmem->global, 0, sizeof(pgStatShmem->global));
+		pgStatShmem->global.bgwriter.stat_reset_timestamp = GetCurrentTimestamp();
 	}
 	else if (msg->m_resettarget == RESET_ARCHIVER)
 	{
 		/* Reset the archiver statistics for the cluster. */
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		archiverStats.stat_reset_timestamp = GetCurrentTimestamp();
+		memset(&pgStatShmem->archiver, 0, sizeof(pgStatShmem->archiver));
+		pgStatShmem->archiver.stat_reset_timestamp = GetCurrentTimestamp();
 	}
 	else if (msg->m_resettarget == RESET_WAL)
 	{
 		/* Reset the WAL statistics for the cluster. */
-		memset(&walStats, 0, sizeof(walStats));
-		walStats.stat_reset_timestamp = GetCurrentTimestamp();
+		memset(&pgStatShmem->wal, 0, sizeof(pgStatShmem->wal));
+		pgStatShmem->wal.stat_reset_timestamp = GetCurrentTimestamp();
+	}
+	else if (msg->m_resettarget == RESET_IO)
+	{
+		/* Reset the I/O statistics for the cluster. */
+		memset(&pgStatShmem->io, 0, sizeof(pgStatShmem->io));
+		pgStatShmem->io.stat_reset_timestamp = GetCurrentTimestamp();
 	}
 
 	/*
 	 * Presumably the sender of this message validated the target, don't
 	 * complain here if it's not valid
 	 */
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5254,26 +4380,28 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 static void
 pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
 
 	if (IsSharedRelation(msg->m_objectid))
-		dbentry = pgstat_get_db_entry(InvalidOid, false);
+		dbentry = pgstat_get_db_entry(InvalidOid, true, false);
 	else
-		dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+		dbentry = pgstat_get_db_entry(msg->m_databaseid, true, false);
 
 	if (!dbentry)
 		return;
 
 	/* Set the reset timestamp for the whole database */
-	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
+	dbentry->stats.stat_reset_timestamp = GetCurrentTimestamp();
 
 	/* Remove object if it exists, ignore it if not */
 	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		(void) dshash_delete_key(pgstat_db_tables(dbentry),
+								 &(msg->m_objectid));
 	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		(void) dshash_delete_key(pgstat_db_functions(dbentry),
+								 &(msg->m_objectid));
+
+	pgstat_release_db_entry(dbentry);
 }
 
 /* ----------
@@ -5288,15 +4416,19 @@ pgstat_recv_resetslrucounter(PgStat_MsgResetslrucounter *msg, int len)
 	int			i;
 	TimestampTz ts = GetCurrentTimestamp();
 
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
 	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
 	{
 		/* reset entry with the given index, or all entries (index is -1) */
 		if ((msg->m_index == -1) || (msg->m_index == i))
 		{
-			memset(&slruStats[i], 0, sizeof(slruStats[i]));
-			slruStats[i].stat_reset_timestamp = ts;
+			memset(&pgStatShmem->slru[i], 0, sizeof(pgStatShmem->slru[i]));
+			pgStatShmem->slru[i].stat_reset_timestamp = ts;
 		}
 	}
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5309,41 +4441,38 @@ static void
 pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg,
 								 int len)
 {
-	PgStat_StatReplSlotEntry *slotent;
-	TimestampTz ts;
+	TimestampTz ts = GetCurrentTimestamp();
 
-	/* Return if we don't have replication slot statistics */
-	if (replSlotStatHash == NULL)
-		return;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
 
-	ts = GetCurrentTimestamp();
 	if (msg->clearall)
 	{
-		HASH_SEQ_STATUS sstat;
+		for (int i = 0; i < max_replication_slots; i++)
+		{
+			PgStat_StatReplSlotEntry *slotent = &pgStatShmem->replslots[i];
 
-		hash_seq_init(&sstat, replSlotStatHash);
-		while ((slotent = (PgStat_StatReplSlotEntry *) hash_seq_search(&sstat)) != NULL)
-			pgstat_reset_replslot(slotent, ts);
+			if (NameStr(slotent->slotname)[0] != '\0')
+				pgstat_reset_replslot(slotent, ts);
+		}
 	}
 	else
 	{
 		/* Get the slot statistics to reset */
-		slotent = pgstat_get_replslot_entry(msg->m_slotname, false);
+		int			idx = pgstat_get_replslot_index(NameStr(msg->m_slotname),
+													false);
 
 		/*
 		 * Nothing to do if the given slot entry is not found.  This could
 		 * happen when the slot with the given name is removed and the
-		 * corresponding statistics entry is also removed before receiving the
-		 * reset message.
+		 * corresponding statistics entry is also removed before the reset
+		 * request gets here.
 		 */
-		if (!slotent)
-			return;
-
-		/* Reset the stats for the requested replication slot */
-		pgstat_reset_replslot(slotent, ts);
+		if (idx >= 0)
+			pgstat_reset_replslot(&pgStatShmem->replslots[idx], ts);
 	}
-}
 
+	LWLockRelease(&pgStatShmem->lock);
+}
 
 /* ----------
  * pgstat_recv_autovac() -
@@ -5354,14 +4483,18 @@ pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg,
 static void
 pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
 	/*
 	 * Store the last autovacuum time in the database's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	dbentry->last_autovac_time = msg->m_start_time;
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5373,15 +4506,17 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 static void
 pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
+	dshash_table *tables;
 	PgStat_StatTabEntry *tabentry;
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false, true);
+	tables = pgstat_db_tables(dbentry);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	tabentry = pgstat_get_tab_entry(tables, msg->m_tableoid);
 
 	tabentry->n_live_tuples = msg->m_live_tuples;
 	tabentry->n_dead_tuples = msg->m_dead_tuples;
@@ -5408,6 +4543,9 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 		tabentry->vacuum_timestamp = msg->m_vacuumtime;
 		tabentry->vacuum_count++;
 	}
+
+	dshash_release_lock(tables, tabentry);
+	pgstat_release_db_entry(dbentry);
 }
 
 /* ----------
@@ -5419,15 +4557,17 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 static void
 pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
+	dshash_table *tables;
 	PgStat_StatTabEntry *tabentry;
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false, true);
+	tables = pgstat_db_tables(dbentry);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	tabentry = pgstat_get_tab_entry(tables, msg->m_tableoid);
 
 	tabentry->n_live_tuples = msg->m_live_tuples;
 	tabentry->n_dead_tuples = msg->m_dead_tuples;
@@ -5450,6 +4590,9 @@ pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 		tabentry->analyze_timestamp = msg->m_analyzetime;
 		tabentry->analyze_count++;
 	}
+
+	dshash_release_lock(tables, tabentry);
+	pgstat_release_db_entry(dbentry);
 }
 
 
@@ -5462,22 +4605,26 @@ pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 static void
 pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len)
 {
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
 	if (msg->m_failed)
 	{
 		/* Failed archival attempt */
-		++archiverStats.failed_count;
-		memcpy(archiverStats.last_failed_wal, msg->m_xlog,
-			   sizeof(archiverStats.last_failed_wal));
-		archiverStats.last_failed_timestamp = msg->m_timestamp;
+		++pgStatShmem->archiver.failed_count;
+		memcpy(pgStatShmem->archiver.last_failed_wal, msg->m_xlog,
+			   sizeof(pgStatShmem->archiver.last_failed_wal));
+		pgStatShmem->archiver.last_failed_timestamp = msg->m_timestamp;
 	}
 	else
 	{
 		/* Successful archival operation */
-		++archiverStats.archived_count;
-		memcpy(archiverStats.last_archived_wal, msg->m_xlog,
-			   sizeof(archiverStats.last_archived_wal));
-		archiverStats.last_archived_timestamp = msg->m_timestamp;
+		++pgStatShmem->archiver.archived_count;
+		memcpy(pgStatShmem->archiver.last_archived_wal, msg->m_xlog,
+			   sizeof(pgStatShmem->archiver.last_archived_wal));
+		pgStatShmem->archiver.last_archived_timestamp = msg->m_timestamp;
 	}
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5489,9 +4636,13 @@ pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len)
 static void
 pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 {
-	globalStats.bgwriter.buf_written_clean += msg->m_buf_written_clean;
-	globalStats.bgwriter.maxwritten_clean += msg->m_maxwritten_clean;
-	globalStats.bgwriter.buf_alloc += msg->m_buf_alloc;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
+	pgStatShmem->global.bgwriter.buf_written_clean += msg->m_buf_written_clean;
+	pgStatShmem->global.bgwriter.maxwritten_clean += msg->m_maxwritten_clean;
+	pgStatShmem->global.bgwriter.buf_alloc += msg->m_buf_alloc;
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5503,13 +4654,17 @@ pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 static void
 pgstat_recv_checkpointer(PgStat_MsgCheckpointer *msg, int len)
 {
-	globalStats.checkpointer.timed_checkpoints += msg->m_timed_checkpoints;
-	globalStats.checkpointer.requested_checkpoints += msg->m_requested_checkpoints;
-	globalStats.checkpointer.checkpoint_write_time += msg->m_checkpoint_write_time;
-	globalStats.checkpointer.checkpoint_sync_time += msg->m_checkpoint_sync_time;
-	globalStats.checkpointer.buf_written_checkpoints += msg->m_buf_written_checkpoints;
-	globalStats.checkpointer.buf_written_backend += msg->m_buf_written_backend;
-	globalStats.checkpointer.buf_fsync_backend += msg->m_buf_fsync_backend;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
+	pgStatShmem->global.checkpointer.timed_checkpoints += msg->m_timed_checkpoints;
+	pgStatShmem->global.checkpointer.requested_checkpoints += msg->m_requested_checkpoints;
+	pgStatShmem->global.checkpointer.checkpoint_write_time += msg->m_checkpoint_write_time;
+	pgStatShmem->global.checkpointer.checkpoint_sync_time += msg->m_checkpoint_sync_time;
+	pgStatShmem->global.checkpointer.buf_written_checkpoints += msg->m_buf_written_checkpoints;
+	pgStatShmem->global.checkpointer.buf_written_backend += msg->m_buf_written_backend;
+	pgStatShmem->global.checkpointer.buf_fsync_backend += msg->m_buf_fsync_backend;
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5521,14 +4676,54 @@ pgstat_recv_checkpointer(PgStat_MsgCheckpointer *msg, int len)
 static void
 pgstat_recv_wal(PgStat_MsgWal *msg, int len)
 {
-	walStats.wal_records += msg->m_wal_records;
-	walStats.wal_fpi += msg->m_wal_fpi;
-	walStats.wal_bytes += msg->m_wal_bytes;
-	walStats.wal_buffers_full += msg->m_wal_buffers_full;
-	walStats.wal_write += msg->m_wal_write;
-	walStats.wal_sync += msg->m_wal_sync;
-	walStats.wal_write_time += msg->m_wal_write_time;
-	walStats.wal_sync_time += msg->m_wal_sync_time;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
+	pgStatShmem->wal.wal_records += msg->m_wal_records;
+	pgStatShmem->wal.wal_fpi += msg->m_wal_fpi;
+	pgStatShmem->wal.wal_bytes += msg->m_wal_bytes;
+	pgStatShmem->wal.wal_buffers_full += msg->m_wal_buffers_full;
+	pgStatShmem->wal.wal_write += msg->m_wal_write;
+	pgStatShmem->wal.wal_sync += msg->m_wal_sync;
+	pgStatShmem->wal.wal_write_time += msg->m_wal_write_time;
+	pgStatShmem->wal.wal_sync_time += msg->m_wal_sync_time;
+	for (int i = 0; i < PGSTAT_WAL_SYNC_BUCKETS; i++)
+		pgStatShmem->wal.wal_sync_histogram[i] += msg->m_wal_sync_histogram[i];
+
+	LWLockRelease(&pgStatShmem->lock);
+}
+
+/* ----------
+ * pgstat_recv_io() -
+ *
+ *	Process an I/O message.
+ * ----------
+ */
+static void
+pgstat_recv_io(PgStat_MsgIO *msg, int len)
+{
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
+	for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+	{
+		for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+		{
+			PgStat_IOCounts *dst =
+			&pgStatShmem->io.counts[msg->m_backend_type][io_object][io_context];
+			PgStat_IOCounts *src = &msg->m_counts[io_object][io_context];
+
+			for (int i = 0; i < IOOP_NUM_TYPES; i++)
+				dst->ops[i] += src->ops[i];
+			dst->read_time += src->read_time;
+			dst->write_time += src->write_time;
+			for (int i = 0; i < PGSTAT_IO_TIME_BUCKETS; i++)
+			{
+				dst->read_histogram[i] += src->read_histogram[i];
+				dst->write_histogram[i] += src->write_histogram[i];
+			}
+		}
+	}
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5540,13 +4735,17 @@ pgstat_recv_wal(PgStat_MsgWal *msg, int len)
 static void
 pgstat_recv_slru(PgStat_MsgSLRU *msg, int len)
 {
-	slruStats[msg->m_index].blocks_zeroed += msg->m_blocks_zeroed;
-	slruStats[msg->m_index].blocks_hit += msg->m_blocks_hit;
-	slruStats[msg->m_index].blocks_read += msg->m_blocks_read;
-	slruStats[msg->m_index].blocks_written += msg->m_blocks_written;
-	slruStats[msg->m_index].blocks_exists += msg->m_blocks_exists;
-	slruStats[msg->m_index].flush += msg->m_flush;
-	slruStats[msg->m_index].truncate += msg->m_truncate;
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
+	pgStatShmem->slru[msg->m_index].blocks_zeroed += msg->m_blocks_zeroed;
+	pgStatShmem->slru[msg->m_index].blocks_hit += msg->m_blocks_hit;
+	pgStatShmem->slru[msg->m_index].blocks_read += msg->m_blocks_read;
+	pgStatShmem->slru[msg->m_index].blocks_written += msg->m_blocks_written;
+	pgStatShmem->slru[msg->m_index].blocks_exists += msg->m_blocks_exists;
+	pgStatShmem->slru[msg->m_index].flush += msg->m_flush;
+	pgStatShmem->slru[msg->m_index].truncate += msg->m_truncate;
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5558,9 +4757,11 @@ pgstat_recv_slru(PgStat_MsgSLRU *msg, int len)
 static void
 pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	switch (msg->m_reason)
 	{
@@ -5587,6 +4788,8 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 			dbentry->n_conflict_startup_deadlock++;
 			break;
 	}
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5598,11 +4801,68 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 static void
 pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	dbentry->n_deadlocks++;
+
+	pgstat_release_db_entry(shdbentry);
+}
+
+/* ----------
+ * pgstat_recv_deadlockcheck() -
+ *
+ *	Process a DEADLOCKCHECK message.
+ * ----------
+ */
+static void
+pgstat_recv_deadlockcheck(PgStat_MsgDeadlockCheck *msg, int len)
+{
+	PgStatShared_DBEntry *shdbentry;
+	PgStat_StatDBEntry *dbentry;
+
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
+
+	dbentry->n_deadlock_checks++;
+	dbentry->total_deadlock_check_time += msg->m_check_time;
+
+	pgstat_release_db_entry(shdbentry);
+}
+
+/* ----------
+ * pgstat_recv_waitevents() -
+ *
+ *	Process a WAITEVENTS message.
+ * ----------
+ */
+static void
+pgstat_recv_waitevents(PgStat_MsgWaitEvents *msg, int len)
+{
+	PgStatShared_DBEntry *shdbentry;
+	PgStat_StatDBEntry *dbentry;
+
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
+
+	for (int i = 0; i < msg->m_nentries; i++)
+	{
+		PgStat_WaitEventEntry *m_ent = &msg->m_entry[i];
+
+		dbentry->wait_events[m_ent->slot].calls += m_ent->counts.calls;
+		dbentry->wait_events[m_ent->slot].time += m_ent->counts.time;
+	}
+
+	for (int i = 0; i < PGSTAT_WAIT_CLASSES; i++)
+	{
+		for (int j = 0; j < PGSTAT_WAIT_TIME_BUCKETS; j++)
+			dbentry->wait_histograms[i][j] += msg->m_histograms[i][j];
+	}
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5614,12 +4874,16 @@ pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
 static void
 pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	dbentry->n_checksum_failures += msg->m_failurecount;
 	dbentry->last_checksum_failure = msg->m_failure_time;
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5631,29 +4895,41 @@ pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len)
 static void
 pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len)
 {
+	int			idx;
+
+	LWLockAcquire(&pgStatShmem->lock, LW_EXCLUSIVE);
+
 	if (msg->m_drop)
 	{
 		Assert(!msg->m_create);
 
 		/* Remove the replication slot statistics with the given name */
-		if (replSlotStatHash != NULL)
-			(void) hash_search(replSlotStatHash,
-							   (void *) &(msg->m_slotname),
-							   HASH_REMOVE,
-							   NULL);
+		idx = pgstat_get_replslot_index(NameStr(msg->m_slotname), false);
+		if (idx >= 0)
+			memset(&pgStatShmem->replslots[idx], 0,
+				   sizeof(PgStat_StatReplSlotEntry));
 	}
 	else
 	{
 		PgStat_StatReplSlotEntry *slotent;
 
-		slotent = pgstat_get_replslot_entry(msg->m_slotname, true);
-		Assert(slotent);
+		/*
+		 * There's room for as many entries as there can be slots, so this
+		 * can only fail if a drop went missing; just forget the update then.
+		 */
+		idx = pgstat_get_replslot_index(NameStr(msg->m_slotname), true);
+		if (idx < 0)
+		{
+			LWLockRelease(&pgStatShmem->lock);
+			return;
+		}
+		slotent = &pgStatShmem->replslots[idx];
 
 		if (msg->m_create)
 		{
 			/*
-			 * If the message for dropping the slot with the same name gets
-			 * lost, slotent has stats for the old slot. So we initialize all
+			 * If the slot with the same name was dropped without us hearing
+			 * of it, slotent has stats for the old slot. So we initialize all
 			 * counters at slot creation.
 			 */
 			pgstat_reset_replslot(slotent, 0);
@@ -5671,6 +4947,8 @@ pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len)
 			slotent->total_bytes += msg->m_total_bytes;
 		}
 	}
+
+	LWLockRelease(&pgStatShmem->lock);
 }
 
 /* ----------
@@ -5682,10 +4960,14 @@ pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len)
 static void
 pgstat_recv_connect(PgStat_MsgConnect *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 	dbentry->n_sessions++;
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5697,9 +4979,11 @@ pgstat_recv_connect(PgStat_MsgConnect *msg, int len)
 static void
 pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	switch (msg->m_cause)
 	{
@@ -5717,6 +5001,8 @@ pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len)
 			dbentry->n_sessions_killed++;
 			break;
 	}
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5728,12 +5014,16 @@ pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len)
 static void
 pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 {
+	PgStatShared_DBEntry *shdbentry;
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	shdbentry = pgstat_get_db_entry(msg->m_databaseid, true, true);
+	dbentry = &shdbentry->stats;
 
 	dbentry->n_temp_bytes += msg->m_filesize;
 	dbentry->n_temp_files += 1;
+
+	pgstat_release_db_entry(shdbentry);
 }
 
 /* ----------
@@ -5746,21 +5036,23 @@ static void
 pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 {
 	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
+	PgStatShared_DBEntry *dbentry;
+	dshash_table *functions;
 	PgStat_StatFuncEntry *funcentry;
 	int			i;
 	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false, true);
+	functions = pgstat_db_functions(dbentry);
 
 	/*
 	 * Process all function entries in the message.
 	 */
 	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
+		funcentry = (PgStat_StatFuncEntry *) dshash_find_or_insert(functions,
+																   &(funcmsg->f_id),
+																   &found);
 
 		if (!found)
 		{
@@ -5781,136 +5073,51 @@ pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 			funcentry->f_total_time += funcmsg->f_total_time;
 			funcentry->f_self_time += funcmsg->f_self_time;
 		}
-	}
-}
-
-/* ----------
- * pgstat_recv_funcpurge() -
- *
- *	Arrange for dead function removal.
- * ----------
- */
-static void
-pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
 
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
+		dshash_release_lock(functions, funcentry);
 	}
-}
-
-/* ----------
- * pgstat_write_statsfile_needed() -
- *
- *	Do we need to write out any stats files?
- * ----------
- */
-static bool
-pgstat_write_statsfile_needed(void)
-{
-	if (pending_write_requests != NIL)
-		return true;
-
-	/* Everything was written recently */
-	return false;
-}
-
-/* ----------
- * pgstat_db_requested() -
- *
- *	Checks whether stats for a particular DB need to be written to a file.
- * ----------
- */
-static bool
-pgstat_db_requested(Oid databaseid)
-{
-	/*
-	 * If any requests are outstanding at all, we should write the stats for
-	 * shared catalogs (the "database" with OID 0).  This ensures that
-	 * backends will see up-to-date stats for shared catalogs, even though
-	 * they send inquiry messages mentioning only their own DB.
-	 */
-	if (databaseid == InvalidOid && pending_write_requests != NIL)
-		return true;
-
-	/* Search to see if there's an open request to write this database. */
-	if (list_member_oid(pending_write_requests, databaseid))
-		return true;
 
-	return false;
+	pgstat_release_db_entry(dbentry);
 }
 
 /* ----------
- * pgstat_replslot_entry
+ * pgstat_get_replslot_index
  *
- * Return the entry of replication slot stats with the given name. Return
- * NULL if not found and the caller didn't request to create it.
+ * Return the index of the replication slot stats with the given name in the
+ * shared array. Return -1 if not found and the caller didn't request to
+ * create it, or if there's no free entry left.
  *
  * create tells whether to create the new slot entry if it is not found.
+ * The caller must hold the lock on the shared statistics, exclusively if
+ * create is true.
  * ----------
  */
-static PgStat_StatReplSlotEntry *
-pgstat_get_replslot_entry(NameData name, bool create)
+static int
+pgstat_get_replslot_index(const char *name, bool create)
 {
-	PgStat_StatReplSlotEntry *slotent;
-	bool		found;
+	int			freeidx = -1;
 
-	if (replSlotStatHash == NULL)
+	for (int i = 0; i < max_replication_slots; i++)
 	{
-		HASHCTL		hash_ctl;
+		PgStat_StatReplSlotEntry *slotent = &pgStatShmem->replslots[i];
 
-		/*
-		 * Quick return NULL if the hash table is empty and the caller didn't
-		 * request to create the entry.
-		 */
-		if (!create)
-			return NULL;
-
-		hash_ctl.keysize = sizeof(NameData);
-		hash_ctl.entrysize = sizeof(PgStat_StatReplSlotEntry);
-		replSlotStatHash = hash_create("Replication slots hash",
-									   PGSTAT_REPLSLOT_HASH_SIZE,
-									   &hash_ctl,
-									   HASH_ELEM | HASH_BLOBS);
+		if (NameStr(slotent->slotname)[0] == '\0')
+		{
+			if (freeidx < 0)
+				freeidx = i;
+		}
+		else if (strcmp(NameStr(slotent->slotname), name) == 0)
+			return i;
 	}
 
-	slotent = (PgStat_StatReplSlotEntry *) hash_search(replSlotStatHash,
-													   (void *) &name,
-													   create ? HASH_ENTER : HASH_FIND,
-													   &found);
-
-	if (!slotent)
-	{
-		/* not found */
-		Assert(!create && !found);
-		return NULL;
-	}
+	if (!create || freeidx < 0)
+		return -1;
 
 	/* initialize the entry */
-	if (create && !found)
-	{
-		namestrcpy(&(slotent->slotname), NameStr(name));
-		pgstat_reset_replslot(slotent, 0);
-	}
+	namestrcpy(&pgStatShmem->replslots[freeidx].slotname, name);
+	pgstat_reset_replslot(&pgStatShmem->replslots[freeidx], 0);
 
-	return slotent;
+	return freeidx;
 }
 
 /* ----------
@@ -6039,3 +5246,4 @@ pgstat_count_slru_truncate(int slru_idx)
 {
 	slru_entry(slru_idx)->m_truncate += 1;
 }
+
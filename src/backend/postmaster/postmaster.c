@@ -78,7 +78,6 @@
 #include <limits.h>
 
 #ifdef HAVE_SYS_SELECT_H
-#include <sys/select.h>
 #endif
 
 #ifdef USE_BONJOUR
@@ -107,6 +106,7 @@
 #include "pg_getopt.h"
 #include "pgstat.h"
 #include "port/pg_bswap.h"
+#include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/auxprocess.h"
 #include "postmaster/bgworker_internals.h"
@@ -114,6 +114,7 @@
 #include "postmaster/interrupt.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
@@ -220,6 +221,12 @@ int			ReservedBackends;
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
 
+/* Which of them accept connections for the connection proxies */
+static bool ListenSocketIsProxy[MAXLISTEN];
+
+/* What ServerLoop waits on: our latch, the listen sockets and proxy channels */
+static WaitEventSet *pm_wait_set;
+
 /*
  * These globals control the behavior of the postmaster in case some
  * backend dumps core.  Normally, it kills all peers of the dead backend
@@ -253,7 +260,6 @@ static pid_t StartupPID = 0,
 			WalReceiverPID = 0,
 			AutoVacPID = 0,
 			PgArchPID = 0,
-			PgStatPID = 0,
 			SysLoggerPID = 0;
 
 /* Startup process's status */
@@ -419,7 +425,11 @@ static int	BackendStartup(Port *port);
 static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
 static void processCancelRequest(Port *port, void *pkt);
-static int	initMasks(fd_set *rmask);
+static void ConfigurePostmasterWaitSet(void);
+static int	ProxyStreamServerPort(int family, const char *hostName,
+								  const char *unixSocketDir);
+static Port *ProxyConnCreate(pgsocket sock, SockAddr *raddr);
+static void SignalConnectionProxies(int signal);
 static void report_fork_failure_to_client(Port *port, int errnum);
 static CAC_state canAcceptConnections(int backend_type);
 static bool RandomCancelKey(int32 *cancel_key);
@@ -515,7 +525,6 @@ typedef struct
 	PGPROC	   *AuxiliaryProcs;
 	PGPROC	   *PreparedXactProcs;
 	PMSignalData *PMSignalState;
-	InheritableSocket pgStatSock;
 	pid_t		PostmasterPid;
 	TimestampTz PgStartTime;
 	TimestampTz PgReloadTime;
@@ -524,7 +533,9 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	bool		query_id_enabled;
 	int			max_safe_fds;
+	uint64		pg_tsc_ticks_per_sec;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -638,10 +649,10 @@ PostmasterMain(int argc, char *argv[])
 	 *
 	 * 2. We do not set the SA_RESTART flag.  This is because signals will be
 	 * blocked at all times except when ServerLoop is waiting for something to
-	 * happen, and during that window, we want signals to exit the select(2)
-	 * wait so that ServerLoop can respond if anything interesting happened.
-	 * On some platforms, signals marked SA_RESTART would not cause the
-	 * select() wait to end.
+	 * happen, and during that window, we want signals to exit the wait so
+	 * that ServerLoop can respond if anything interesting happened.  Each
+	 * handler also sets the postmaster's latch, which is what reliably ends
+	 * the wait in WaitEventSetWait().
 	 *
 	 * Child processes will generally want SA_RESTART, so pqsignal() sets that
 	 * flag.  We expect children to set up their own handlers before
@@ -668,15 +679,15 @@ PostmasterMain(int argc, char *argv[])
 	pqsignal_pm(SIGUSR2, dummy_handler);	/* unused, reserve for children */
 	pqsignal_pm(SIGCHLD, reaper);	/* handle child termination */
 
-#ifdef SIGURG
-
 	/*
-	 * Ignore SIGURG for now.  Child processes may change this (see
-	 * InitializeLatchSupport), but they will not receive any such signals
-	 * until they wait on a latch.
+	 * Set up the postmaster's own latch, which its signal handlers set to
+	 * wake up ServerLoop.  This may configure SIGURG, depending on the
+	 * platform; it must come after pqinitmask(), since it can adjust
+	 * UnBlockSig.  Child processes redo this for themselves (see
+	 * InitPostmasterChild).
 	 */
-	pqsignal_pm(SIGURG, SIG_IGN);	/* ignored */
-#endif
+	InitializeLatchSupport();
+	InitProcessLocalLatch();
 
 	/*
 	 * No other place in Postgres should touch SIGTTIN/SIGTTOU handling.  We
@@ -1020,6 +1031,14 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/*
+	 * Likewise register the connection proxies, if any.  The channels they
+	 * use to talk to us are created right away, so that they are inherited
+	 * by every proxy started later.
+	 */
+	ProxyCreateChannels();
+	ProxyRegisterWorkers();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1042,6 +1061,9 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	InitializeMaxBackends();
 
+	/* Likewise, size the per-backend fast-path lock arrays */
+	InitializeFastPathLocks();
+
 	/*
 	 * Now that loadable modules have had their chance to request additional
 	 * shared memory, determine the value of any runtime-computed GUCs that
@@ -1080,6 +1102,12 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	set_max_safe_fds();
 
+	/*
+	 * Calibrate the time stamp counter used for timing plan nodes, if the
+	 * CPU has a usable one.  Child processes inherit the result.
+	 */
+	(void) pg_tsc_init();
+
 	/*
 	 * Set reference point for stack-depth checking.
 	 */
@@ -1185,7 +1213,10 @@ PostmasterMain(int argc, char *argv[])
 	 * charged with closing the sockets again at postmaster shutdown.
 	 */
 	for (i = 0; i < MAXLISTEN; i++)
+	{
 		ListenSocket[i] = PGINVALID_SOCKET;
+		ListenSocketIsProxy[i] = false;
+	}
 
 	on_proc_exit(CloseServerPorts, 0);
 
@@ -1238,6 +1269,14 @@ PostmasterMain(int argc, char *argv[])
 				ereport(WARNING,
 						(errmsg("could not create listen socket for \"%s\"",
 								curhost)));
+
+			if (ConnectionProxies > 0 &&
+				ProxyStreamServerPort(AF_UNSPEC,
+									  strcmp(curhost, "*") == 0 ? NULL : curhost,
+									  NULL) != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create connection proxy listen socket for \"%s\"",
+								curhost)));
 		}
 
 		if (!success && elemlist != NIL)
@@ -1328,6 +1367,12 @@ PostmasterMain(int argc, char *argv[])
 				ereport(WARNING,
 						(errmsg("could not create Unix-domain socket in directory \"%s\"",
 								socketdir)));
+
+			if (ConnectionProxies > 0 &&
+				ProxyStreamServerPort(AF_UNIX, NULL, socketdir) != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create connection proxy Unix-domain socket in directory \"%s\"",
+								socketdir)));
 		}
 
 		if (!success && elemlist != NIL)
@@ -1391,12 +1436,6 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	RemovePgTempFiles();
 
-	/*
-	 * Initialize stats collection subsystem (this does NOT start the
-	 * collector process!)
-	 */
-	pgstat_init();
-
 	/*
 	 * Initialize the autovacuum subsystem (again, no process start yet)
 	 */
@@ -1716,19 +1755,17 @@ DetermineSleepTime(struct timeval *timeout)
 static int
 ServerLoop(void)
 {
-	fd_set		readmask;
-	int			nSockets;
 	time_t		last_lockfile_recheck_time,
 				last_touch_time;
+	WaitEvent	events[MAXLISTEN];
+	int			nevents;
 
 	last_lockfile_recheck_time = last_touch_time = time(NULL);
 
-	nSockets = initMasks(&readmask);
+	ConfigurePostmasterWaitSet();
 
 	for (;;)
 	{
-		fd_set		rmask;
-		int			selres;
 		time_t		now;
 
 		/*
@@ -1736,25 +1773,23 @@ ServerLoop(void)
 		 *
 		 * We block all signals except while sleeping. That makes it safe for
 		 * signal handlers, which again block all signals while executing, to
-		 * do nontrivial work.
+		 * do nontrivial work.  They set our latch to end the wait.
 		 *
 		 * If we are in PM_WAIT_DEAD_END state, then we don't want to accept
-		 * any new connections, so we don't call select(), and just sleep.
+		 * any new connections, so we don't wait on the sockets, and just
+		 * sleep.
 		 */
-		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
-
 		if (pmState == PM_WAIT_DEAD_END)
 		{
 			PG_SETMASK(&UnBlockSig);
 
 			pg_usleep(100000L); /* 100 msec seems reasonable */
-			selres = 0;
+			nevents = 0;
 
 			PG_SETMASK(&BlockSig);
 		}
 		else
 		{
-			/* must set timeout each time; some OSes change it! */
 			struct timeval timeout;
 
 			/* Needs to run with blocked signals! */
@@ -1762,43 +1797,47 @@ ServerLoop(void)
 
 			PG_SETMASK(&UnBlockSig);
 
-			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
+			nevents = WaitEventSetWait(pm_wait_set,
+									   timeout.tv_sec * 1000L + timeout.tv_usec / 1000L,
+									   events, lengthof(events), 0);
 
 			PG_SETMASK(&BlockSig);
 		}
 
-		/* Now check the select() result */
-		if (selres < 0)
-		{
-			if (errno != EINTR && errno != EWOULDBLOCK)
-			{
-				ereport(LOG,
-						(errcode_for_socket_access(),
-						 errmsg("select() failed in postmaster: %m")));
-				return STATUS_ERROR;
-			}
-		}
-
 		/*
 		 * New connection pending on any of our sockets? If so, fork a child
 		 * process to deal with it.
 		 */
-		if (selres > 0)
+		for (int e = 0; e < nevents; e++)
 		{
 			int			i;
 
+			if (events[e].events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				continue;
+			}
+
 			for (i = 0; i < MAXLISTEN; i++)
 			{
 				if (ListenSocket[i] == PGINVALID_SOCKET)
 					break;
-				if (FD_ISSET(ListenSocket[i], &rmask))
+				if (ListenSocket[i] == events[e].fd)
 				{
 					Port	   *port;
 
 					port = ConnCreate(ListenSocket[i]);
 					if (port)
 					{
-						BackendStartup(port);
+						/*
+						 * Connections to the proxy port go to a connection
+						 * proxy, unless we're not accepting connections, in
+						 * which case a backend reports why as usual.
+						 */
+						if (!ListenSocketIsProxy[i] ||
+							canAcceptConnections(BACKEND_TYPE_NORMAL) != CAC_OK ||
+							!ProxyHandOffConnection(port->sock, &port->raddr))
+							BackendStartup(port);
 
 						/*
 						 * We no longer need the open socket or port structure
@@ -1807,7 +1846,32 @@ ServerLoop(void)
 						StreamClose(port->sock);
 						ConnFree(port);
 					}
+					break;
+				}
+			}
+
+			/* Start backends the connection proxies have asked for */
+			for (i = 0; i < ConnectionProxies; i++)
+			{
+				pgsocket	sock;
+				SockAddr	raddr;
+
+				if (ProxyPostmasterChannel(i) != events[e].fd)
+					continue;
+
+				while ((sock = ProxyReceiveBackendRequest(i, &raddr)) != PGINVALID_SOCKET)
+				{
+					Port	   *port;
+
+					port = ProxyConnCreate(sock, &raddr);
+					if (port)
+					{
+						BackendStartup(port);
+						ConnFree(port);
+					}
+					StreamClose(sock);
 				}
+				break;
 			}
 		}
 
@@ -1852,11 +1916,6 @@ ServerLoop(void)
 				start_autovac_launcher = false; /* signal processed */
 		}
 
-		/* If we have lost the stats collector, try to start a new one */
-		if (PgStatPID == 0 &&
-			(pmState == PM_RUN || pmState == PM_HOT_STANDBY))
-			PgStatPID = pgstat_start();
-
 		/* If we have lost the archiver, try to start a new one. */
 		if (PgArchPID == 0 && PgArchStartupAllowed())
 			PgArchPID = StartArchiver();
@@ -1952,30 +2011,67 @@ ServerLoop(void)
 }
 
 /*
- * Initialise the masks for select() for the ports we are listening on.
- * Return the number of sockets to listen on.
+ * Build the WaitEventSet that ServerLoop waits on: the postmaster's latch,
+ * which our signal handlers set, plus the ports we are listening on and the
+ * channels from the connection proxies.
  */
-static int
-initMasks(fd_set *rmask)
+static void
+ConfigurePostmasterWaitSet(void)
 {
-	int			maxsock = -1;
+	int			nsockets = 0;
 	int			i;
 
-	FD_ZERO(rmask);
+	Assert(pm_wait_set == NULL);
 
-	for (i = 0; i < MAXLISTEN; i++)
-	{
-		int			fd = ListenSocket[i];
+	while (nsockets < MAXLISTEN && ListenSocket[nsockets] != PGINVALID_SOCKET)
+		nsockets++;
 
-		if (fd == PGINVALID_SOCKET)
+	pm_wait_set = CreateWaitEventSet(CurrentMemoryContext,
+									 1 + nsockets + ConnectionProxies);
+
+	AddWaitEventToSet(pm_wait_set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch,
+					  NULL);
+
+	for (i = 0; i < nsockets; i++)
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_ACCEPT, ListenSocket[i],
+						  NULL, NULL);
+
+	for (i = 0; i < ConnectionProxies; i++)
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE,
+						  ProxyPostmasterChannel(i), NULL, NULL);
+}
+
+/*
+ * Create listen sockets for the connection proxies, as StreamServerPort()
+ * does for the regular port, and remember which ones they are.
+ */
+static int
+ProxyStreamServerPort(int family, const char *hostName,
+					  const char *unixSocketDir)
+{
+	int			first;
+	int			status;
+	int			i;
+
+	for (first = 0; first < MAXLISTEN; first++)
+	{
+		if (ListenSocket[first] == PGINVALID_SOCKET)
 			break;
-		FD_SET(fd, rmask);
+	}
+
+	status = StreamServerPort(family, hostName,
+							  (unsigned short) ProxyPortNumber,
+							  unixSocketDir,
+							  ListenSocket, MAXLISTEN);
 
-		if (fd > maxsock)
-			maxsock = fd;
+	for (i = first; i < MAXLISTEN; i++)
+	{
+		if (ListenSocket[i] == PGINVALID_SOCKET)
+			break;
+		ListenSocketIsProxy[i] = true;
 	}
 
-	return maxsock + 1;
+	return status;
 }
 
 
@@ -2232,12 +2328,13 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "_pq_.compression") == 0)
+				port->compression = pstrdup(valptr);
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option; this is one we don't know.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -2585,6 +2682,43 @@ ConnCreate(int serverFd)
 }
 
 
+/*
+ * ProxyConnCreate -- create a connection data structure for a backend
+ *		requested by a connection proxy
+ *
+ * sock is the backend's end of the proxy's socket pair, and raddr the
+ * address of the client the proxy is relaying.  Returns NULL on failure.
+ */
+static Port *
+ProxyConnCreate(pgsocket sock, SockAddr *raddr)
+{
+	Port	   *port;
+
+	if (!(port = (Port *) calloc(1, sizeof(Port))))
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		ExitPostmaster(1);
+	}
+
+	port->sock = sock;
+	port->raddr = *raddr;
+	port->laddr.salen = sizeof(port->laddr.addr);
+	if (getsockname(sock, (struct sockaddr *) &port->laddr.addr,
+					&port->laddr.salen) < 0)
+	{
+		ereport(LOG,
+				(errmsg("%s() failed: %m", "getsockname")));
+		ConnFree(port);
+		return NULL;
+	}
+	port->proxied = true;
+
+	return port;
+}
+
+
 /*
  * ConnFree -- free a local connection data structure
  *
@@ -2613,6 +2747,13 @@ ClosePostmasterPorts(bool am_syslogger)
 {
 	int			i;
 
+	/* Release resources held by the postmaster's WaitEventSet */
+	if (pm_wait_set)
+	{
+		FreeWaitEventSetAfterFork(pm_wait_set);
+		pm_wait_set = NULL;
+	}
+
 #ifndef WIN32
 
 	/*
@@ -2642,6 +2783,9 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/* Likewise the channels to the connection proxies */
+	ProxyCloseChannels();
+
 	/*
 	 * If using syslogger, close the read side of the pipe.  We don't bother
 	 * tracking this in fd.c, either.
@@ -2758,8 +2902,6 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(PgArchPID, SIGHUP);
 		if (SysLoggerPID != 0)
 			signal_child(SysLoggerPID, SIGHUP);
-		if (PgStatPID != 0)
-			signal_child(PgStatPID, SIGHUP);
 
 		/* Reload authentication config files too */
 		if (!load_hba())
@@ -2794,6 +2936,9 @@ SIGHUP_handler(SIGNAL_ARGS)
 #endif
 	}
 
+	/* Wake up ServerLoop so it can act on whatever we changed */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -2837,6 +2982,9 @@ pmdie(SIGNAL_ARGS)
 			ereport(LOG,
 					(errmsg("received smart shutdown request")));
 
+			/* let the connection proxies give up unneeded backends */
+			SignalConnectionProxies(SIGUSR2);
+
 			/* Report status */
 			AddToDataDirLockFile(LOCK_FILE_LINE_PM_STATUS, PM_STATUS_STOPPING);
 #ifdef USE_SYSTEMD
@@ -2947,6 +3095,9 @@ pmdie(SIGNAL_ARGS)
 			break;
 	}
 
+	/* Wake up ServerLoop so it can act on whatever we changed */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -3088,8 +3239,6 @@ reaper(SIGNAL_ARGS)
 				AutoVacPID = StartAutoVacLauncher();
 			if (PgArchStartupAllowed() && PgArchPID == 0)
 				PgArchPID = StartArchiver();
-			if (PgStatPID == 0)
-				PgStatPID = pgstat_start();
 
 			/* workers may be scheduled to start now */
 			maybe_start_bgworkers();
@@ -3156,13 +3305,6 @@ reaper(SIGNAL_ARGS)
 				SignalChildren(SIGUSR2);
 
 				pmState = PM_SHUTDOWN_2;
-
-				/*
-				 * We can also shut down the stats collector now; there's
-				 * nothing left for it to do.
-				 */
-				if (PgStatPID != 0)
-					signal_child(PgStatPID, SIGQUIT);
 			}
 			else
 			{
@@ -3241,22 +3383,6 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
-		/*
-		 * Was it the statistics collector?  If so, just try to start a new
-		 * one; no need to force reset of the rest of the system.  (If fail,
-		 * we'll try again in future cycles of the main loop.)
-		 */
-		if (pid == PgStatPID)
-		{
-			PgStatPID = 0;
-			if (!EXIT_STATUS_0(exitstatus))
-				LogChildExit(LOG, _("statistics collector process"),
-							 pid, exitstatus);
-			if (pmState == PM_RUN || pmState == PM_HOT_STANDBY)
-				PgStatPID = pgstat_start();
-			continue;
-		}
-
 		/* Was it the system logger?  If so, try to start a new one */
 		if (pid == SysLoggerPID)
 		{
@@ -3290,6 +3416,9 @@ reaper(SIGNAL_ARGS)
 	PostmasterStateMachine();
 
 	/* Done with signal handler */
+	/* Wake up ServerLoop so it can act on whatever we changed */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -3698,22 +3827,6 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 		signal_child(PgArchPID, (SendStop ? SIGSTOP : SIGQUIT));
 	}
 
-	/*
-	 * Force a power-cycle of the pgstat process too.  (This isn't absolutely
-	 * necessary, but it seems like a good idea for robustness, and it
-	 * simplifies the state-machine logic in the case where a shutdown request
-	 * arrives during crash processing.)
-	 */
-	if (PgStatPID != 0 && take_action)
-	{
-		ereport(DEBUG2,
-				(errmsg_internal("sending %s to process %d",
-								 "SIGQUIT",
-								 (int) PgStatPID)));
-		signal_child(PgStatPID, SIGQUIT);
-		allow_immediate_pgstat_restart();
-	}
-
 	/* We do NOT restart the syslogger */
 
 	if (Shutdown != ImmediateShutdown)
@@ -3935,12 +4048,10 @@ PostmasterStateMachine(void)
 					FatalError = true;
 					pmState = PM_WAIT_DEAD_END;
 
-					/* Kill the walsenders, archiver and stats collector too */
+					/* Kill the walsenders and archiver too */
 					SignalChildren(SIGQUIT);
 					if (PgArchPID != 0)
 						signal_child(PgArchPID, SIGQUIT);
-					if (PgStatPID != 0)
-						signal_child(PgStatPID, SIGQUIT);
 				}
 			}
 		}
@@ -3964,10 +4075,9 @@ PostmasterStateMachine(void)
 	{
 		/*
 		 * PM_WAIT_DEAD_END state ends when the BackendList is entirely empty
-		 * (ie, no dead_end children remain), and the archiver and stats
-		 * collector are gone too.
+		 * (ie, no dead_end children remain), and the archiver is gone too.
 		 *
-		 * The reason we wait for those two is to protect them against a new
+		 * The reason we wait for the archiver is to protect them against a new
 		 * postmaster starting conflicting subprocesses; this isn't an
 		 * ironclad protection, but it at least helps in the
 		 * shutdown-and-immediately-restart scenario.  Note that they have
@@ -3976,7 +4086,7 @@ PostmasterStateMachine(void)
 		 * FatalError processing.
 		 */
 		if (dlist_is_empty(&BackendList) &&
-			PgArchPID == 0 && PgStatPID == 0)
+			PgArchPID == 0)
 		{
 			/* These other guys should be dead already */
 			Assert(StartupPID == 0);
@@ -4126,6 +4236,24 @@ signal_child(pid_t pid, int signal)
 #endif
 }
 
+/*
+ * Send a signal to the running connection proxies.
+ */
+static void
+SignalConnectionProxies(int signal)
+{
+	slist_iter	siter;
+
+	slist_foreach(siter, &BackgroundWorkerList)
+	{
+		RegisteredBgWorker *rw;
+
+		rw = slist_container(RegisteredBgWorker, rw_lnode, siter.cur);
+		if (rw->rw_pid != 0 && ProxyWorkerIndex(&rw->rw_worker) >= 0)
+			signal_child(rw->rw_pid, signal);
+	}
+}
+
 /*
  * Send a signal to the targeted children (but NOT special children;
  * dead_end children are never signaled, either).
@@ -4196,8 +4324,6 @@ TerminateChildren(int signal)
 		signal_child(AutoVacPID, signal);
 	if (PgArchPID != 0)
 		signal_child(PgArchPID, signal);
-	if (PgStatPID != 0)
-		signal_child(PgStatPID, signal);
 }
 
 /*
@@ -4521,6 +4647,9 @@ BackendInitialize(Port *port)
 	if (status != STATUS_OK)
 		proc_exit(0);
 
+	/* Switch to protocol compression, if the client asked for it */
+	pq_start_compression(port);
+
 	/*
 	 * Now that we have the user and database name, we can set the process
 	 * title for ps.  It's good to do this as early as possible in startup.
@@ -5129,12 +5258,6 @@ SubPostmasterMain(int argc, char *argv[])
 
 		StartBackgroundWorker();
 	}
-	if (strcmp(argv[1], "--forkcol") == 0)
-	{
-		/* Do not want to attach to shared memory */
-
-		PgstatCollectorMain(argc, argv);	/* does not return */
-	}
 	if (strcmp(argv[1], "--forklog") == 0)
 	{
 		/* Do not want to attach to shared memory */
@@ -5238,12 +5361,6 @@ sigusr1_handler(SIGNAL_ARGS)
 	if (CheckPostmasterSignal(PMSIGNAL_BEGIN_HOT_STANDBY) &&
 		pmState == PM_RECOVERY && Shutdown == NoShutdown)
 	{
-		/*
-		 * Likewise, start other special children as needed.
-		 */
-		Assert(PgStatPID == 0);
-		PgStatPID = pgstat_start();
-
 		ereport(LOG,
 				(errmsg("database system is ready to accept read-only connections")));
 
@@ -5344,6 +5461,9 @@ sigusr1_handler(SIGNAL_ARGS)
 		signal_child(StartupPID, SIGUSR2);
 	}
 
+	/* Wake up ServerLoop so it can act on whatever we changed */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -5864,6 +5984,9 @@ do_start_bgworker(RegisteredBgWorker *rw)
 			/* in postmaster child ... */
 			InitPostmasterChild();
 
+			/* A connection proxy keeps its channel to the postmaster */
+			MyProxyIndex = ProxyWorkerIndex(&rw->rw_worker);
+
 			/* Close the postmaster's sockets */
 			ClosePostmasterPorts(false);
 
@@ -6159,7 +6282,6 @@ extern slock_t *ShmemLock;
 extern slock_t *ProcStructLock;
 extern PGPROC *AuxiliaryProcs;
 extern PMSignalData *PMSignalState;
-extern pgsocket pgStatSock;
 extern pg_time_t first_syslogger_file_time;
 
 #ifndef WIN32
@@ -6215,8 +6337,6 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->AuxiliaryProcs = AuxiliaryProcs;
 	param->PreparedXactProcs = PreparedXactProcs;
 	param->PMSignalState = PMSignalState;
-	if (!write_inheritable_socket(&param->pgStatSock, pgStatSock, childPid))
-		return false;
 
 	param->PostmasterPid = PostmasterPid;
 	param->PgStartTime = PgStartTime;
@@ -6227,8 +6347,10 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->IsBinaryUpgrade = IsBinaryUpgrade;
 	param->query_id_enabled = query_id_enabled;
 	param->max_safe_fds = max_safe_fds;
+	param->pg_tsc_ticks_per_sec = pg_tsc_ticks_per_sec;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6450,7 +6572,6 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	AuxiliaryProcs = param->AuxiliaryProcs;
 	PreparedXactProcs = param->PreparedXactProcs;
 	PMSignalState = param->PMSignalState;
-	read_inheritable_socket(&pgStatSock, &param->pgStatSock);
 
 	PostmasterPid = param->PostmasterPid;
 	PgStartTime = param->PgStartTime;
@@ -6461,8 +6582,10 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	IsBinaryUpgrade = param->IsBinaryUpgrade;
 	query_id_enabled = param->query_id_enabled;
 	max_safe_fds = param->max_safe_fds;
+	pg_tsc_ticks_per_sec = param->pg_tsc_ticks_per_sec;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -6489,8 +6612,6 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	if (postmaster_alive_fds[1] >= 0)
 		ReserveExternalFD();
 #endif
-	if (pgStatSock != PGINVALID_SOCKET)
-		ReserveExternalFD();
 }
 
 
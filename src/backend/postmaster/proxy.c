@@ -0,0 +1,1691 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.c
+ *	  Built-in connection pooler.
+ *
+ * When connection_proxies is greater than zero, the postmaster listens on
+ * proxy_port in addition to the regular port, and hands every connection
+ * accepted there to one of a set of connection proxy processes.  A proxy
+ * multiplexes its client connections over a small number of backends,
+ * returning a backend to a pool whenever the client it serves is between
+ * transactions.  This lets a large number of mostly idle clients share a
+ * bounded number of backends.
+ *
+ * Proxies are background workers without database access.  Each has a
+ * datagram socket pair shared with the postmaster (the "channel"), over
+ * which file descriptors are passed with SCM_RIGHTS: the postmaster sends
+ * accepted client sockets to the proxy, and the proxy sends back one end
+ * of a fresh socket pair whenever it needs a new backend.  The postmaster
+ * then launches an ordinary backend on that socket, with the client's
+ * address recorded as its remote address so that pg_hba.conf matching and
+ * logging see the real client.
+ *
+ * There is one pool per set of startup parameters (user, database and any
+ * options; application_name is ignored).  The first time a client connects,
+ * the proxy launches a backend for it and relays the startup packet and the
+ * whole authentication exchange, so authentication is performed by the
+ * backend exactly as for a direct connection.  Once the backend reports
+ * ReadyForQuery, it becomes a member of the client's pool if the pool has
+ * fewer than session_pool_size backends; otherwise it is terminated as soon
+ * as the client first becomes idle.  From then on, the client is given any
+ * idle backend of its pool when it sends a message, and the backend goes
+ * back to the pool when it reports ReadyForQuery with status "idle" and no
+ * further replies are outstanding.  Clients that find no idle backend wait.
+ *
+ * Session state can't move between backends, so a backend that acquires
+ * any (a session-level SET, a prepared statement, a temporary table, a
+ * LISTEN, a session-level advisory lock, a holdable cursor, a LOADed
+ * library, or sequence state visible to currval() and lastval()) calls
+ * PinPooledSession() and reports a "session_pinned" ParameterStatus before
+ * its next ReadyForQuery.  The proxy consumes that message and keeps the
+ * backend attached to the client until the client disconnects, at which
+ * point the backend is terminated rather than returned to the pool.
+ *
+ * Clients are given a BackendKeyData message carrying the proxy's PID and a
+ * random key.  Cancel requests sent to the proxy port are routed through
+ * shared memory to the proxy owning that key, which signals whichever
+ * backend currently serves the client.
+ *
+ * The proxy doesn't negotiate SSL or GSSAPI encryption, and doesn't support
+ * replication connections.  Since backends see a Unix-domain socket rather
+ * than the client's own connection, peer and ident authentication are
+ * rejected for proxied connections.  The passing of sockets needs fork()
+ * semantics, so the proxy isn't available in EXEC_BACKEND builds.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/proxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "lib/ilist.h"
+#include "libpq/libpq-be.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/wait_event.h"
+
+/*
+ * Size of the per-connection buffer.  This must be able to hold a complete
+ * startup packet.
+ */
+#define PROXY_BUFFER_SIZE		16384
+
+/* Maximum number of events handled per WaitEventSetWait() call */
+#define PROXY_MAX_EVENTS		64
+
+/* Cancel requests forwarded from other proxies that may be queued */
+#define PROXY_MAX_PENDING_CANCELS 16
+
+/* Size of a message header: type byte plus length word */
+#define MSG_HEADER_SIZE			5
+
+/*
+ * Per-proxy data in shared memory, used to forward cancel requests to the
+ * proxy that owns the session being canceled.
+ */
+typedef struct ProxyState
+{
+	slock_t		mutex;			/* protects the fields below */
+	pid_t		pid;			/* PID of running proxy, or 0 */
+	Latch	   *latch;			/* proxy's latch */
+	int			ncancels;		/* number of queued cancel keys */
+	uint32		cancels[PROXY_MAX_PENDING_CANCELS];
+} ProxyState;
+
+typedef enum ProxyChannelState
+{
+	CHANNEL_CLIENT_STARTUP,		/* reading client's startup packet */
+	CHANNEL_CLIENT_AUTH,		/* client authenticating with its backend */
+	CHANNEL_CLIENT_READY,		/* client authenticated */
+	CHANNEL_BACKEND_AUTH,		/* backend authenticating a client */
+	CHANNEL_BACKEND_ACTIVE,		/* backend attached to a client */
+	CHANNEL_BACKEND_IDLE		/* backend idle in its pool */
+} ProxyChannelState;
+
+typedef struct ProxyPool ProxyPool;
+
+/*
+ * A client or backend connection handled by the proxy.
+ *
+ * Data read from the connection is kept in buf until it has been written
+ * to the peer: buf[0 .. tx_pos) has been sent, buf[tx_pos .. scan_pos) has
+ * been examined and may be sent, and buf[scan_pos .. rx_pos) still has to
+ * be examined.  msg_left is the number of bytes of a message whose header
+ * has already been examined that have not yet been scanned.
+ */
+typedef struct ProxyChannel
+{
+	dlist_node	node;			/* link in all_channels */
+	pgsocket	sock;
+	bool		is_backend;
+	ProxyChannelState state;
+	bool		closed;			/* socket closed, free at end of cycle */
+	struct ProxyChannel *peer;	/* attached backend or client, if any */
+	ProxyPool  *pool;
+	int			events;			/* wait events of interest */
+	int			wait_pos;		/* position in wait set, or -1 */
+
+	char	   *buf;
+	int			rx_pos;
+	int			scan_pos;
+	int			tx_pos;
+	int			msg_left;
+
+	/* fields used for clients only */
+	SockAddr	raddr;			/* client's address */
+	uint32		cancel_key;		/* key given out in BackendKeyData */
+	bool		waiting;		/* in pool's list of waiting clients */
+
+	/* fields used for backends only */
+	int			backend_pid;	/* PID reported in BackendKeyData */
+	int			pending_rfq;	/* ReadyForQuery messages still expected */
+	bool		in_pool;		/* counted in pool->nbackends */
+	bool		pinned;			/* session state ties it to its client */
+	bool		retire;			/* terminate instead of returning to pool */
+	bool		detach_pending; /* detach from client once flushed */
+} ProxyChannel;
+
+/*
+ * A pool of backends sharing the same startup parameters.
+ */
+struct ProxyPool
+{
+	char	   *key;			/* startup parameters identifying the pool */
+	int			keylen;
+	int			nclients;		/* clients using this pool */
+	int			nbackends;		/* backends belonging to this pool */
+	int			holds;			/* references held while closing channels */
+	List	   *idle_backends;	/* backends that can be given to a client */
+	List	   *waiting_clients;	/* clients waiting for a backend */
+};
+
+/* GUC variables */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+int			MaxSessions = 1000;
+
+int			MyProxyIndex = -1;
+
+static ProxyState *ProxyStates = NULL;
+
+/*
+ * Postmaster's channels; [i][0] is the postmaster's end and [i][1] the end
+ * used by proxy i.
+ */
+static pgsocket ProxyChannels[MAX_CONNECTION_PROXIES][2];
+static bool ProxyChannelsCreated = false;
+static int	NextProxy = 0;
+
+/* Backend-local state, for backends launched on behalf of a proxy */
+static bool PooledSessionPinned = false;
+static bool PooledSessionPinReported = false;
+
+/* Proxy-local state */
+static pgsocket MyChannel = PGINVALID_SOCKET;
+static dlist_head all_channels = DLIST_STATIC_INIT(all_channels);
+static List *closed_channels = NIL;
+static List *pools = NIL;
+static int	nclients = 0;
+static WaitEventSet *proxy_wait_set = NULL;
+static bool proxy_wait_set_dirty = true;
+static bool proxy_draining = false;
+static volatile sig_atomic_t SmartShutdownPending = false;
+
+static bool proxy_send_socket(pgsocket chan, pgsocket sock,
+							  const void *data, size_t len);
+static bool proxy_receive_socket(pgsocket chan, pgsocket *sock,
+								 void *data, size_t len);
+static void proxy_sigusr2_handler(SIGNAL_ARGS);
+static void proxy_shmem_exit(int code, Datum arg);
+static void proxy_rebuild_wait_set(void);
+static void proxy_accept_clients(void);
+static void proxy_process_cancels(void);
+static void proxy_handle_cancel(uint32 pid, uint32 key);
+static ProxyChannel *channel_create(pgsocket sock, bool is_backend);
+static void channel_close(ProxyChannel *ch);
+static void channel_set_events(ProxyChannel *ch);
+static void channel_read(ProxyChannel *ch);
+static void channel_process(ProxyChannel *ch);
+static void channel_forward(ProxyChannel *ch);
+static void client_process_startup(ProxyChannel *client);
+static bool client_attach_backend(ProxyChannel *client);
+static void client_close(ProxyChannel *client);
+static void client_fail(ProxyChannel *client, const char *sqlstate,
+						const char *message);
+static bool backend_launch(ProxyChannel *client);
+static bool backend_scan_message(ProxyChannel *backend, char type, int len);
+static void backend_detach(ProxyChannel *backend);
+static void backend_release(ProxyChannel *backend);
+static void backend_close(ProxyChannel *backend);
+static ProxyPool *pool_lookup(const char *key, int keylen);
+static void pool_release_idle(ProxyPool *pool);
+static void pool_maybe_free(ProxyPool *pool);
+
+
+/* ----------------------------------------------------------------
+ *		Shared memory
+ * ----------------------------------------------------------------
+ */
+
+Size
+ProxyShmemSize(void)
+{
+	return mul_size(ConnectionProxies, sizeof(ProxyState));
+}
+
+void
+ProxyShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	if (ConnectionProxies == 0)
+		return;
+
+	ProxyStates = (ProxyState *)
+		ShmemInitStruct("Connection Proxy Data", ProxyShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < ConnectionProxies; i++)
+		{
+			ProxyState *state = &ProxyStates[i];
+
+			SpinLockInit(&state->mutex);
+			state->pid = 0;
+			state->latch = NULL;
+			state->ncancels = 0;
+		}
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		Functions called in the postmaster
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Create the channels between the postmaster and the proxies.  This is done
+ * once at postmaster start, so that a restarted proxy finds any connections
+ * that were queued for it while it was gone.
+ */
+void
+ProxyCreateChannels(void)
+{
+	int			i;
+
+	if (ConnectionProxies == 0)
+		return;
+
+#ifdef EXEC_BACKEND
+	ereport(FATAL,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("connection proxies are not supported by this build")));
+#endif
+
+	if (ProxyPortNumber == PostPortNumber)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"proxy_port\" must be different from \"port\"")));
+
+	if (ConnectionProxies > max_worker_processes)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"connection_proxies\" (%d) must not exceed \"max_worker_processes\" (%d)",
+						ConnectionProxies, max_worker_processes)));
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, ProxyChannels[i]) < 0)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not create connection proxy channel: %m")));
+
+		if (!pg_set_noblock(ProxyChannels[i][0]) ||
+			!pg_set_noblock(ProxyChannels[i][1]))
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not set connection proxy channel to nonblocking mode: %m")));
+	}
+	ProxyChannelsCreated = true;
+}
+
+/*
+ * Register the proxy processes as background workers.
+ */
+void
+ProxyRegisterWorkers(void)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		BackgroundWorker bgw;
+
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+		snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ConnectionProxyMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "connection proxy %d", i);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "connection proxy");
+		bgw.bgw_restart_time = 1;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(i);
+
+		RegisterBackgroundWorker(&bgw);
+	}
+}
+
+/*
+ * If the given background worker is a connection proxy, return its index,
+ * else -1.
+ */
+int
+ProxyWorkerIndex(const BackgroundWorker *worker)
+{
+	if (strcmp(worker->bgw_library_name, "postgres") == 0 &&
+		strcmp(worker->bgw_function_name, "ConnectionProxyMain") == 0)
+		return DatumGetInt32(worker->bgw_main_arg);
+	return -1;
+}
+
+/*
+ * Return the postmaster's end of the channel to the given proxy.
+ */
+pgsocket
+ProxyPostmasterChannel(int proxyno)
+{
+	Assert(ProxyChannelsCreated && proxyno < ConnectionProxies);
+	return ProxyChannels[proxyno][0];
+}
+
+/*
+ * Pass a newly accepted client connection to one of the proxies.  The
+ * caller remains responsible for closing its copy of the socket.
+ *
+ * Returns false if the connection couldn't be handed off.
+ */
+bool
+ProxyHandOffConnection(pgsocket sock, SockAddr *raddr)
+{
+	int			proxyno = NextProxy;
+
+	NextProxy = (NextProxy + 1) % ConnectionProxies;
+
+	if (!proxy_send_socket(ProxyChannels[proxyno][0], sock,
+						   raddr, sizeof(SockAddr)))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not pass connection to connection proxy %d: %m",
+						proxyno)));
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Receive a request to launch a backend from the given proxy.  Returns the
+ * socket the backend should use, and sets *raddr to the address of the
+ * client it is for, or returns PGINVALID_SOCKET if there are no more
+ * requests.
+ */
+pgsocket
+ProxyReceiveBackendRequest(int proxyno, SockAddr *raddr)
+{
+	pgsocket	sock;
+
+	while (proxy_receive_socket(ProxyChannels[proxyno][0], &sock,
+								raddr, sizeof(SockAddr)))
+	{
+		if (sock != PGINVALID_SOCKET)
+			return sock;
+		ereport(LOG,
+				(errmsg("invalid message received from connection proxy %d",
+						proxyno)));
+	}
+
+	if (errno != EAGAIN && errno != EWOULDBLOCK)
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive from connection proxy %d: %m",
+						proxyno)));
+	return PGINVALID_SOCKET;
+}
+
+/*
+ * Close the postmaster's channels in a child process, except for the end
+ * belonging to the proxy this process is going to be, if any.
+ */
+void
+ProxyCloseChannels(void)
+{
+	int			i;
+
+	if (!ProxyChannelsCreated)
+		return;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (i == MyProxyIndex)
+			MyChannel = ProxyChannels[i][1];
+		else
+			closesocket(ProxyChannels[i][1]);
+		closesocket(ProxyChannels[i][0]);
+		ProxyChannels[i][0] = ProxyChannels[i][1] = PGINVALID_SOCKET;
+	}
+	ProxyChannelsCreated = false;
+}
+
+/*
+ * Send a socket, plus some data, over a channel.
+ */
+static bool
+proxy_send_socket(pgsocket chan, pgsocket sock, const void *data, size_t len)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			control;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = unconstify(void *, data);
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &sock, sizeof(int));
+
+	do
+	{
+		rc = sendmsg(chan, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	return rc == (ssize_t) len;
+}
+
+/*
+ * Receive a socket, plus len bytes of data, from a channel.
+ *
+ * Returns false if no message could be received, with errno set.  Returns
+ * true if a message was consumed; *sock is set to PGINVALID_SOCKET if it
+ * was malformed.
+ */
+static bool
+proxy_receive_socket(pgsocket chan, pgsocket *sock, void *data, size_t len)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			control;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = data;
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	do
+	{
+		rc = recvmsg(chan, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		return false;
+
+	*sock = PGINVALID_SOCKET;
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg != NULL &&
+		cmsg->cmsg_level == SOL_SOCKET &&
+		cmsg->cmsg_type == SCM_RIGHTS &&
+		cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+	{
+		memcpy(sock, CMSG_DATA(cmsg), sizeof(int));
+		if (rc != (ssize_t) len || (msg.msg_flags & MSG_TRUNC))
+		{
+			closesocket(*sock);
+			*sock = PGINVALID_SOCKET;
+		}
+	}
+
+	return true;
+}
+
+
+/* ----------------------------------------------------------------
+ *		Functions called in backends serving a proxy
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Note that the session has acquired state that can't be moved to another
+ * backend, so that the proxy has to keep this backend attached to its
+ * current client.  Does nothing unless this backend serves a proxy.
+ */
+void
+PinPooledSession(const char *reason)
+{
+	if (MyProcPort == NULL || !MyProcPort->proxied || PooledSessionPinned)
+		return;
+
+	PooledSessionPinned = true;
+	elog(DEBUG1, "pooled session pinned to its backend by %s", reason);
+}
+
+/*
+ * Tell the proxy if the session has been pinned.  Called just before
+ * sending ReadyForQuery.
+ */
+void
+ReportPooledSessionState(void)
+{
+	StringInfoData msgbuf;
+
+	if (!PooledSessionPinned || PooledSessionPinReported)
+		return;
+
+	pq_beginmessage(&msgbuf, 'S');
+	pq_sendstring(&msgbuf, "session_pinned");
+	pq_sendstring(&msgbuf, "on");
+	pq_endmessage(&msgbuf);
+
+	PooledSessionPinReported = true;
+}
+
+
+/* ----------------------------------------------------------------
+ *		Proxy process
+ * ----------------------------------------------------------------
+ */
+
+void
+ConnectionProxyMain(Datum main_arg)
+{
+	ProxyState *state;
+
+	Assert(MyProxyIndex == DatumGetInt32(main_arg));
+	Assert(MyChannel != PGINVALID_SOCKET);
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGUSR2, proxy_sigusr2_handler);
+	BackgroundWorkerUnblockSignals();
+
+	MemoryContextSwitchTo(AllocSetContextCreate(TopMemoryContext,
+												"Connection Proxy",
+												ALLOCSET_DEFAULT_SIZES));
+
+	/* Advertise ourselves, so that other proxies can forward cancels */
+	state = &ProxyStates[MyProxyIndex];
+	SpinLockAcquire(&state->mutex);
+	state->pid = MyProcPid;
+	state->latch = MyLatch;
+	state->ncancels = 0;
+	SpinLockRelease(&state->mutex);
+	on_shmem_exit(proxy_shmem_exit, 0);
+
+	for (;;)
+	{
+		WaitEvent	events[PROXY_MAX_EVENTS];
+		int			nevents;
+		int			i;
+		ListCell   *lc;
+
+		if (ShutdownRequestPending)
+			proc_exit(0);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/*
+		 * On smart shutdown, keep serving the clients we have, but let go of
+		 * backends no client can need anymore so that the shutdown can
+		 * proceed once the last client has disconnected.
+		 */
+		if (SmartShutdownPending && !proxy_draining)
+		{
+			proxy_draining = true;
+			foreach(lc, pools)
+				pool_release_idle((ProxyPool *) lfirst(lc));
+		}
+
+		if (proxy_wait_set_dirty)
+			proxy_rebuild_wait_set();
+
+		nevents = WaitEventSetWait(proxy_wait_set, -1, events,
+								   lengthof(events),
+								   WAIT_EVENT_CONNECTION_PROXY_MAIN);
+
+		for (i = 0; i < nevents; i++)
+		{
+			WaitEvent  *event = &events[i];
+			ProxyChannel *ch = (ProxyChannel *) event->user_data;
+
+			if (event->events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				proxy_process_cancels();
+				continue;
+			}
+
+			if (ch == NULL)
+			{
+				proxy_accept_clients();
+				continue;
+			}
+
+			if (ch->closed)
+				continue;
+
+			/* socket is writable: send the data the peer has for it */
+			if ((event->events & WL_SOCKET_WRITEABLE) && ch->peer)
+				channel_forward(ch->peer);
+
+			if (!ch->closed && (event->events & WL_SOCKET_READABLE))
+				channel_read(ch);
+		}
+
+		/* now it's safe to free the channels closed in this cycle */
+		foreach(lc, closed_channels)
+		{
+			ProxyChannel *ch = (ProxyChannel *) lfirst(lc);
+
+			pfree(ch->buf);
+			pfree(ch);
+		}
+		list_free(closed_channels);
+		closed_channels = NIL;
+	}
+}
+
+/*
+ * SIGUSR2: the postmaster has received a smart shutdown request.
+ */
+static void
+proxy_sigusr2_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	SmartShutdownPending = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+static void
+proxy_shmem_exit(int code, Datum arg)
+{
+	ProxyState *state = &ProxyStates[MyProxyIndex];
+
+	SpinLockAcquire(&state->mutex);
+	state->pid = 0;
+	state->latch = NULL;
+	SpinLockRelease(&state->mutex);
+}
+
+/*
+ * Recreate the wait set after channels have come or gone, or stopped
+ * waiting for any event at all.  (A socket registered without any events
+ * would still report hangups, so it has to be left out.)
+ */
+static void
+proxy_rebuild_wait_set(void)
+{
+	dlist_iter	iter;
+	int			nevents = 3;
+
+	if (proxy_wait_set)
+		FreeWaitEventSet(proxy_wait_set);
+
+	dlist_foreach(iter, &all_channels)
+		nevents++;
+
+	proxy_wait_set = CreateWaitEventSet(TopMemoryContext, nevents);
+	AddWaitEventToSet(proxy_wait_set, WL_LATCH_SET, PGINVALID_SOCKET,
+					  MyLatch, NULL);
+	AddWaitEventToSet(proxy_wait_set, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	AddWaitEventToSet(proxy_wait_set, WL_SOCKET_READABLE, MyChannel,
+					  NULL, NULL);
+
+	dlist_foreach(iter, &all_channels)
+	{
+		ProxyChannel *ch = dlist_container(ProxyChannel, node, iter.cur);
+
+		if (ch->events != 0)
+			ch->wait_pos = AddWaitEventToSet(proxy_wait_set, ch->events,
+											 ch->sock, NULL, ch);
+		else
+			ch->wait_pos = -1;
+	}
+
+	proxy_wait_set_dirty = false;
+}
+
+/*
+ * Accept the client connections the postmaster has passed us.
+ */
+static void
+proxy_accept_clients(void)
+{
+	pgsocket	sock;
+	SockAddr	raddr;
+
+	while (proxy_receive_socket(MyChannel, &sock, &raddr, sizeof(raddr)))
+	{
+		ProxyChannel *client;
+
+		if (sock == PGINVALID_SOCKET)
+		{
+			ereport(LOG,
+					(errmsg("invalid message received from postmaster")));
+			continue;
+		}
+
+		if (!pg_set_noblock(sock))
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not set socket to nonblocking mode: %m")));
+			closesocket(sock);
+			continue;
+		}
+
+		client = channel_create(sock, false);
+		client->state = CHANNEL_CLIENT_STARTUP;
+		client->raddr = raddr;
+		if (!pg_strong_random(&client->cancel_key, sizeof(client->cancel_key)))
+			client->cancel_key = (uint32) random();
+		nclients++;
+
+		if (nclients > MaxSessions)
+		{
+			client_fail(client, "53300",
+						"sorry, too many clients already");
+			continue;
+		}
+		channel_set_events(client);
+	}
+
+	if (errno != EAGAIN && errno != EWOULDBLOCK)
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive from postmaster: %m")));
+}
+
+/*
+ * Process cancel requests forwarded to us by other proxies.
+ */
+static void
+proxy_process_cancels(void)
+{
+	ProxyState *state = &ProxyStates[MyProxyIndex];
+	uint32		cancels[PROXY_MAX_PENDING_CANCELS];
+	int			ncancels;
+	int			i;
+
+	SpinLockAcquire(&state->mutex);
+	ncancels = state->ncancels;
+	memcpy(cancels, state->cancels, ncancels * sizeof(uint32));
+	state->ncancels = 0;
+	SpinLockRelease(&state->mutex);
+
+	for (i = 0; i < ncancels; i++)
+		proxy_handle_cancel(MyProcPid, cancels[i]);
+}
+
+/*
+ * Handle a cancel request for the session identified by the proxy PID and
+ * the key it gave out.
+ */
+static void
+proxy_handle_cancel(uint32 pid, uint32 key)
+{
+	int			i;
+
+	if (pid == MyProcPid)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &all_channels)
+		{
+			ProxyChannel *ch = dlist_container(ProxyChannel, node, iter.cur);
+
+			if (!ch->is_backend && !ch->closed && ch->cancel_key == key)
+			{
+				if (ch->peer && ch->peer->backend_pid != 0)
+					kill(ch->peer->backend_pid, SIGINT);
+				return;
+			}
+		}
+		return;
+	}
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		ProxyState *state = &ProxyStates[i];
+		Latch	   *latch = NULL;
+
+		SpinLockAcquire(&state->mutex);
+		if (state->pid == pid)
+		{
+			if (state->ncancels < PROXY_MAX_PENDING_CANCELS)
+				state->cancels[state->ncancels++] = key;
+			latch = state->latch;
+		}
+		SpinLockRelease(&state->mutex);
+
+		if (latch)
+		{
+			SetLatch(latch);
+			return;
+		}
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		Channel handling
+ * ----------------------------------------------------------------
+ */
+
+static ProxyChannel *
+channel_create(pgsocket sock, bool is_backend)
+{
+	ProxyChannel *ch = palloc0(sizeof(ProxyChannel));
+
+	ch->sock = sock;
+	ch->is_backend = is_backend;
+	ch->wait_pos = -1;
+	ch->buf = palloc(PROXY_BUFFER_SIZE);
+	dlist_push_tail(&all_channels, &ch->node);
+	proxy_wait_set_dirty = true;
+
+	return ch;
+}
+
+/*
+ * Close a channel's socket and forget about it, apart from the bookkeeping
+ * that depends on its peer, which is up to the caller.  The memory is freed
+ * at the end of the current cycle, as pending events may still point to it.
+ */
+static void
+channel_close(ProxyChannel *ch)
+{
+	ProxyPool  *pool = ch->pool;
+
+	if (ch->closed)
+		return;
+
+	if (pool)
+		pool->holds++;
+
+	closesocket(ch->sock);
+	ch->closed = true;
+	dlist_delete(&ch->node);
+	closed_channels = lappend(closed_channels, ch);
+	proxy_wait_set_dirty = true;
+
+	if (ch->peer)
+	{
+		ch->peer->peer = NULL;
+		ch->peer = NULL;
+	}
+
+	if (ch->is_backend)
+	{
+		if (pool && ch->state == CHANNEL_BACKEND_IDLE)
+			pool->idle_backends = list_delete_ptr(pool->idle_backends, ch);
+		if (pool && ch->in_pool)
+		{
+			pool->nbackends--;
+
+			/* clients waiting for a backend of this pool would wait forever */
+			while (pool->nbackends == 0 && pool->waiting_clients != NIL)
+				client_fail((ProxyChannel *) linitial(pool->waiting_clients),
+							"08006",
+							"no backends are available in the connection pool");
+		}
+	}
+	else
+	{
+		nclients--;
+		if (pool && ch->waiting)
+			pool->waiting_clients = list_delete_ptr(pool->waiting_clients, ch);
+		if (pool)
+			pool->nclients--;
+	}
+
+	if (pool)
+	{
+		pool->holds--;
+		pool_maybe_free(pool);
+	}
+}
+
+/*
+ * Update the wait events a channel is interested in: reading, unless its
+ * buffer is full, and writing, if its peer has data for it that couldn't
+ * be sent yet.
+ */
+static void
+channel_set_events(ProxyChannel *ch)
+{
+	int			events = 0;
+
+	if (ch->closed)
+		return;
+
+	if (ch->rx_pos - ch->tx_pos < PROXY_BUFFER_SIZE)
+		events |= WL_SOCKET_READABLE;
+	if (ch->peer && ch->peer->tx_pos < ch->peer->scan_pos)
+		events |= WL_SOCKET_WRITEABLE;
+
+	if (events == ch->events)
+		return;
+	ch->events = events;
+
+	if (events == 0 || ch->wait_pos < 0)
+		proxy_wait_set_dirty = true;
+	else if (!proxy_wait_set_dirty)
+		ModifyWaitEvent(proxy_wait_set, ch->wait_pos, events, NULL);
+}
+
+/*
+ * Read whatever is available from a channel and process it.
+ */
+static void
+channel_read(ProxyChannel *ch)
+{
+	ssize_t		n;
+
+	/* make room at the end of the buffer, if needed */
+	if (ch->rx_pos == PROXY_BUFFER_SIZE && ch->tx_pos > 0)
+	{
+		memmove(ch->buf, ch->buf + ch->tx_pos, ch->rx_pos - ch->tx_pos);
+		ch->rx_pos -= ch->tx_pos;
+		ch->scan_pos -= ch->tx_pos;
+		ch->tx_pos = 0;
+	}
+	if (ch->rx_pos == PROXY_BUFFER_SIZE)
+	{
+		channel_set_events(ch);
+		return;
+	}
+
+	n = recv(ch->sock, ch->buf + ch->rx_pos, PROXY_BUFFER_SIZE - ch->rx_pos, 0);
+	if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+
+	if (n <= 0)
+	{
+		/* EOF or connection failure */
+		if (ch->is_backend)
+			backend_close(ch);
+		else
+			client_close(ch);
+		return;
+	}
+
+	ch->rx_pos += n;
+	channel_process(ch);
+}
+
+/*
+ * Examine the data received on a channel, message by message, and forward
+ * what can be forwarded.
+ */
+static void
+channel_process(ProxyChannel *ch)
+{
+	if (ch->state == CHANNEL_CLIENT_STARTUP)
+	{
+		client_process_startup(ch);
+		if (ch->closed || ch->state == CHANNEL_CLIENT_STARTUP)
+			return;
+	}
+
+	while (ch->scan_pos < ch->rx_pos)
+	{
+		char		type;
+		uint32		len;
+
+		/* pass over the rest of the current message */
+		if (ch->msg_left > 0)
+		{
+			int			n = Min(ch->msg_left, ch->rx_pos - ch->scan_pos);
+
+			ch->scan_pos += n;
+			ch->msg_left -= n;
+			continue;
+		}
+
+		/* a backend about to be detached mustn't have more sent for it */
+		if (ch->detach_pending)
+			break;
+
+		if (ch->rx_pos - ch->scan_pos < MSG_HEADER_SIZE)
+			break;
+
+		type = ch->buf[ch->scan_pos];
+		memcpy(&len, ch->buf + ch->scan_pos + 1, sizeof(len));
+		len = pg_ntoh32(len);
+		if (len < 4 || len > PG_INT32_MAX - 1)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid message length received by connection proxy")));
+			if (ch->is_backend)
+				backend_close(ch);
+			else
+				client_close(ch);
+			return;
+		}
+
+		if (ch->is_backend)
+		{
+			if (ch->peer == NULL)
+				ch->msg_left = len + 1;
+			else if (!backend_scan_message(ch, type, len))
+				break;
+		}
+		else
+		{
+			ProxyChannel *backend;
+
+			if (type == 'X')
+			{
+				/* Terminate: the backend doesn't need to see it */
+				client_close(ch);
+				return;
+			}
+
+			if (ch->peer == NULL && !client_attach_backend(ch))
+				break;
+			backend = ch->peer;
+
+			/* the backend must keep serving us until it has replied */
+			if (backend->detach_pending)
+				backend->detach_pending = false;
+			if (type == 'Q' || type == 'S' || type == 'F')
+				backend->pending_rfq++;
+
+			ch->msg_left = len + 1;
+		}
+	}
+
+	channel_forward(ch);
+}
+
+/*
+ * Send the examined data of a channel to its peer.
+ */
+static void
+channel_forward(ProxyChannel *ch)
+{
+	ProxyChannel *peer = ch->peer;
+
+	if (peer == NULL)
+	{
+		/* an idle backend has nobody to send anything to */
+		ch->tx_pos = ch->scan_pos;
+	}
+
+	while (ch->tx_pos < ch->scan_pos)
+	{
+		ssize_t		n;
+
+		n = send(peer->sock, ch->buf + ch->tx_pos, ch->scan_pos - ch->tx_pos, 0);
+		if (n > 0)
+		{
+			ch->tx_pos += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+
+		/* the peer's connection is broken */
+		if (peer->is_backend)
+			backend_close(peer);
+		else
+			client_close(peer);
+		return;
+	}
+
+	if (ch->tx_pos == ch->rx_pos)
+		ch->tx_pos = ch->scan_pos = ch->rx_pos = 0;
+
+	if (ch->tx_pos == ch->scan_pos && ch->detach_pending)
+	{
+		/* the client has everything it asked for */
+		backend_detach(ch);
+		if (ch->closed)
+			return;
+		channel_process(ch);
+		return;
+	}
+
+	channel_set_events(ch);
+	if (ch->peer)
+		channel_set_events(ch->peer);
+}
+
+/* ----------------------------------------------------------------
+ *		Clients
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Process a client's startup packet, if complete.
+ */
+static void
+client_process_startup(ProxyChannel *client)
+{
+	for (;;)
+	{
+		int			avail = client->rx_pos - client->scan_pos;
+		char	   *buf = client->buf + client->scan_pos;
+		uint32		len;
+		ProtocolVersion proto;
+		StringInfoData key;
+		char	   *p;
+		char	   *end;
+
+		if (avail < 4)
+			return;
+		memcpy(&len, buf, 4);
+		len = pg_ntoh32(len);
+		if (len < 8 || len > MAX_STARTUP_PACKET_LENGTH)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid length of startup packet")));
+			client_close(client);
+			return;
+		}
+		if (avail < len)
+			return;
+
+		memcpy(&proto, buf + 4, 4);
+		proto = pg_ntoh32(proto);
+
+		if (proto == CANCEL_REQUEST_CODE)
+		{
+			CancelRequestPacket canc;
+
+			if (len == sizeof(canc) + 4)
+			{
+				memcpy(&canc, buf + 4, sizeof(canc));
+				proxy_handle_cancel(pg_ntoh32(canc.backendPID),
+									pg_ntoh32(canc.cancelAuthCode));
+			}
+			client_close(client);
+			return;
+		}
+
+		if (proto == NEGOTIATE_SSL_CODE || proto == NEGOTIATE_GSS_CODE)
+		{
+			/* encryption is not supported; the client may go on without */
+			if (send(client->sock, "N", 1, 0) != 1)
+			{
+				client_close(client);
+				return;
+			}
+			client->scan_pos += len;
+			client->tx_pos = client->scan_pos;
+			continue;
+		}
+
+		if (PG_PROTOCOL_MAJOR(proto) != 3)
+		{
+			client_fail(client, "0A000",
+						"unsupported frontend protocol for connection proxy");
+			return;
+		}
+
+		/*
+		 * Build the pool key from the startup parameters, except those that
+		 * don't affect what a backend can be used for.
+		 */
+		initStringInfo(&key);
+		p = buf + 8;
+		end = buf + len;
+		while (p < end && *p)
+		{
+			char	   *name = p;
+			char	   *value;
+
+			p = memchr(name, '\0', end - name);
+			if (p == NULL || ++p >= end)
+				break;
+			value = p;
+			p = memchr(value, '\0', end - value);
+			if (p == NULL)
+				break;
+			p++;
+
+			if (strcmp(name, "replication") == 0)
+			{
+				pfree(key.data);
+				client_fail(client, "0A000",
+							"replication connections are not supported by the connection proxy");
+				return;
+			}
+			if (strcmp(name, "application_name") == 0)
+				continue;
+			appendBinaryStringInfo(&key, name, p - name);
+		}
+
+		client->pool = pool_lookup(key.data, key.len);
+		client->pool->nclients++;
+		pfree(key.data);
+
+		if (!backend_launch(client))
+		{
+			client_fail(client, "53000",
+						"could not launch a backend for the connection");
+			return;
+		}
+
+		/* relay the startup packet, and then the authentication exchange */
+		client->state = CHANNEL_CLIENT_AUTH;
+		client->scan_pos += len;
+		return;
+	}
+}
+
+/*
+ * Give a client a backend from its pool.  If there is none, put the client
+ * in the pool's waiting list and return false.
+ */
+static bool
+client_attach_backend(ProxyChannel *client)
+{
+	ProxyPool  *pool = client->pool;
+	ProxyChannel *backend;
+
+	Assert(client->state == CHANNEL_CLIENT_READY);
+
+	if (pool->idle_backends == NIL)
+	{
+		if (pool->nbackends == 0)
+			client_fail(client, "08006",
+						"no backends are available in the connection pool");
+		else if (!client->waiting)
+		{
+			pool->waiting_clients = lappend(pool->waiting_clients, client);
+			client->waiting = true;
+		}
+		return false;
+	}
+
+	backend = (ProxyChannel *) linitial(pool->idle_backends);
+	pool->idle_backends = list_delete_first(pool->idle_backends);
+
+	backend->state = CHANNEL_BACKEND_ACTIVE;
+	backend->peer = client;
+	client->peer = backend;
+
+	/* the backend may have something buffered for nobody; drop it */
+	backend->tx_pos = backend->scan_pos;
+	channel_set_events(backend);
+
+	return true;
+}
+
+/*
+ * Close a client connection.  Its backend goes back to the pool if it is
+ * between transactions, else it is terminated.
+ */
+static void
+client_close(ProxyChannel *client)
+{
+	ProxyChannel *backend = client->peer;
+	ProxyPool  *pool = client->pool;
+
+	if (pool)
+		pool->holds++;
+
+	channel_close(client);
+
+	if (backend)
+	{
+		if (backend->detach_pending && !backend->retire &&
+			backend->state == CHANNEL_BACKEND_ACTIVE)
+		{
+			/* whatever is left was meant for the client; drop it */
+			backend->tx_pos = backend->scan_pos;
+			backend->detach_pending = false;
+			backend_release(backend);
+		}
+		else
+			channel_close(backend);
+	}
+
+	if (pool)
+	{
+		if (proxy_draining && pool->nclients == 0)
+			pool_release_idle(pool);
+		pool->holds--;
+		pool_maybe_free(pool);
+	}
+}
+
+/*
+ * Send an error to a client and close its connection.
+ */
+static void
+client_fail(ProxyChannel *client, const char *sqlstate, const char *message)
+{
+	StringInfoData buf;
+	uint32		len;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, 'E');
+	appendBinaryStringInfo(&buf, "\0\0\0\0", 4);
+	appendStringInfoString(&buf, "SFATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoString(&buf, "VFATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfo(&buf, "C%s", sqlstate);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfo(&buf, "M%s", message);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, '\0');
+	len = pg_hton32(buf.len - 1);
+	memcpy(buf.data + 1, &len, 4);
+
+	/* best effort only, the client won't get it if its buffer is full */
+	(void) send(client->sock, buf.data, buf.len, 0);
+	pfree(buf.data);
+
+	client_close(client);
+}
+
+/* ----------------------------------------------------------------
+ *		Backends
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Ask the postmaster for a new backend, to authenticate the given client.
+ */
+static bool
+backend_launch(ProxyChannel *client)
+{
+	pgsocket	fds[2];
+	ProxyChannel *backend;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for backend: %m")));
+		return false;
+	}
+
+	if (!pg_set_noblock(fds[0]) ||
+		!proxy_send_socket(MyChannel, fds[1], &client->raddr, sizeof(SockAddr)))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not request a backend from postmaster: %m")));
+		closesocket(fds[0]);
+		closesocket(fds[1]);
+		return false;
+	}
+	closesocket(fds[1]);
+
+	backend = channel_create(fds[0], true);
+	backend->state = CHANNEL_BACKEND_AUTH;
+	backend->pool = client->pool;
+	backend->peer = client;
+	client->peer = backend;
+	channel_set_events(backend);
+
+	return true;
+}
+
+/*
+ * Examine the header of a message a backend is sending to its client, and
+ * intercept the messages the proxy has to act on.  Returns false if more
+ * data is needed first.
+ */
+static bool
+backend_scan_message(ProxyChannel *backend, char type, int len)
+{
+	char	   *msg = backend->buf + backend->scan_pos;
+	bool		complete = backend->rx_pos - backend->scan_pos >= len + 1;
+
+	switch (type)
+	{
+		case 'K':
+			/* BackendKeyData: remember the PID, give the client our key */
+			if (backend->state != CHANNEL_BACKEND_AUTH || len != 12)
+				break;
+			if (!complete)
+				return false;
+			{
+				uint32		pid;
+				uint32		key;
+
+				memcpy(&pid, msg + MSG_HEADER_SIZE, 4);
+				backend->backend_pid = pg_ntoh32(pid);
+				pid = pg_hton32(MyProcPid);
+				key = pg_hton32(backend->peer->cancel_key);
+				memcpy(msg + MSG_HEADER_SIZE, &pid, 4);
+				memcpy(msg + MSG_HEADER_SIZE + 4, &key, 4);
+			}
+			break;
+
+		case 'S':
+			/* ParameterStatus: swallow the backend's pin notification */
+			if (len + 1 > PROXY_BUFFER_SIZE)
+				break;
+			if (!complete)
+				return false;
+			if (len > 4 &&
+				memchr(msg + MSG_HEADER_SIZE, '\0', len - 4) != NULL &&
+				strcmp(msg + MSG_HEADER_SIZE, "session_pinned") == 0)
+			{
+				backend->pinned = true;
+				memmove(msg, msg + len + 1,
+						backend->rx_pos - backend->scan_pos - (len + 1));
+				backend->rx_pos -= len + 1;
+				return true;
+			}
+			break;
+
+		case 'Z':
+			/* ReadyForQuery: see if the backend can be detached */
+			if (len != 5)
+				break;
+			if (!complete)
+				return false;
+			if (backend->state == CHANNEL_BACKEND_AUTH)
+			{
+				ProxyPool  *pool = backend->pool;
+
+				/* authentication is complete */
+				backend->peer->state = CHANNEL_CLIENT_READY;
+				backend->state = CHANNEL_BACKEND_ACTIVE;
+				backend->pending_rfq = 0;
+				if (!proxy_draining && pool->nbackends < SessionPoolSize)
+				{
+					backend->in_pool = true;
+					pool->nbackends++;
+				}
+				else
+					backend->retire = true;
+			}
+			else if (backend->pending_rfq > 0)
+				backend->pending_rfq--;
+
+			if (backend->pending_rfq == 0 && !backend->pinned &&
+				msg[MSG_HEADER_SIZE] == 'I')
+				backend->detach_pending = true;
+			break;
+	}
+
+	backend->msg_left = len + 1;
+	return true;
+}
+
+/*
+ * Detach a backend from its client, now that the client is between
+ * transactions.
+ */
+static void
+backend_detach(ProxyChannel *backend)
+{
+	ProxyChannel *client = backend->peer;
+
+	Assert(client != NULL && !backend->pinned && backend->pending_rfq == 0);
+
+	backend->detach_pending = false;
+	backend->peer = NULL;
+	client->peer = NULL;
+	channel_set_events(client);
+
+	if (backend->retire)
+		channel_close(backend);
+	else
+		backend_release(backend);
+}
+
+/*
+ * Give a backend that isn't attached to any client to the first waiting
+ * client of its pool, or put it in the pool's idle list.
+ */
+static void
+backend_release(ProxyChannel *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	Assert(backend->in_pool && backend->peer == NULL);
+
+	if (pool->waiting_clients != NIL)
+	{
+		ProxyChannel *client = (ProxyChannel *) linitial(pool->waiting_clients);
+
+		pool->waiting_clients = list_delete_first(pool->waiting_clients);
+		client->waiting = false;
+
+		backend->state = CHANNEL_BACKEND_ACTIVE;
+		backend->peer = client;
+		client->peer = backend;
+
+		/* send the client's pending message on its way */
+		channel_process(client);
+		return;
+	}
+
+	if (proxy_draining && pool->nclients == 0)
+	{
+		channel_close(backend);
+		return;
+	}
+
+	backend->state = CHANNEL_BACKEND_IDLE;
+	pool->idle_backends = lappend(pool->idle_backends, backend);
+	channel_set_events(backend);
+}
+
+/*
+ * Close a backend connection that has failed or gone away.  If it was
+ * attached to a client, the client's session is lost, so the client is
+ * disconnected too, after passing on whatever the backend had to say.
+ */
+static void
+backend_close(ProxyChannel *backend)
+{
+	ProxyChannel *client = backend->peer;
+
+	if (client)
+	{
+		backend->scan_pos = backend->rx_pos;
+		backend->msg_left = 0;
+		while (backend->tx_pos < backend->scan_pos)
+		{
+			ssize_t		n = send(client->sock, backend->buf + backend->tx_pos,
+								 backend->scan_pos - backend->tx_pos, 0);
+
+			if (n <= 0)
+				break;
+			backend->tx_pos += n;
+		}
+	}
+
+	channel_close(backend);
+	if (client)
+		client_close(client);
+}
+
+/* ----------------------------------------------------------------
+ *		Pools
+ * ----------------------------------------------------------------
+ */
+
+static ProxyPool *
+pool_lookup(const char *key, int keylen)
+{
+	ListCell   *lc;
+	ProxyPool  *pool;
+
+	foreach(lc, pools)
+	{
+		pool = (ProxyPool *) lfirst(lc);
+		if (pool->keylen == keylen && memcmp(pool->key, key, keylen) == 0)
+			return pool;
+	}
+
+	pool = palloc0(sizeof(ProxyPool));
+	pool->key = palloc(keylen);
+	memcpy(pool->key, key, keylen);
+	pool->keylen = keylen;
+	pools = lappend(pools, pool);
+
+	return pool;
+}
+
+/*
+ * Terminate the idle backends of a pool.
+ */
+static void
+pool_release_idle(ProxyPool *pool)
+{
+	while (pool->idle_backends != NIL)
+		channel_close((ProxyChannel *) linitial(pool->idle_backends));
+}
+
+/*
+ * Free a pool that no longer has any clients or backends.
+ */
+static void
+pool_maybe_free(ProxyPool *pool)
+{
+	dlist_iter	iter;
+
+	if (pool->nclients > 0 || pool->nbackends > 0 || pool->holds > 0)
+		return;
+
+	/* backends still authenticating, or about to retire, refer to it too */
+	dlist_foreach(iter, &all_channels)
+	{
+		ProxyChannel *ch = dlist_container(ProxyChannel, node, iter.cur);
+
+		if (ch->pool == pool)
+			return;
+	}
+
+	pools = list_delete_ptr(pools, pool);
+	pfree(pool->key);
+	pfree(pool);
+}
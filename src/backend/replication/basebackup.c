@@ -17,8 +17,11 @@
 #include <time.h>
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
+#include "access/xlogutils.h"
+#include "catalog/pg_tablespace_d.h"
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
+#include "commands/dbcommands_xlog.h"
 #include "commands/defrem.h"
 #include "commands/progress.h"
 #include "lib/stringinfo.h"
@@ -36,16 +39,22 @@
 #include "replication/walsender_private.h"
 #include "storage/bufpage.h"
 #include "storage/checksum.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/resowner.h"
 #include "utils/timestamp.h"
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
 typedef struct
 {
 	const char *label;
@@ -57,6 +66,9 @@ typedef struct
 	bool		sendtblspcmapfile;
 	backup_manifest_option manifest;
 	pg_checksum_type manifest_checksum_type;
+	bool		compression;
+	int			compression_level;
+	XLogRecPtr	incremental_since;
 } basebackup_options;
 
 static int64 sendTablespace(char *path, char *oid, bool sizeonly,
@@ -78,18 +90,28 @@ static void perform_base_backup(basebackup_options *opt);
 static void parse_basebackup_options(List *options, basebackup_options *opt);
 static void SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli);
 static int	compareWalFileNames(const ListCell *a, const ListCell *b);
+static void archive_begin(void);
+static void archive_send(const char *data, size_t len);
+static void archive_end(void);
 static void throttle(size_t increment);
 static void update_basebackup_progress(int64 delta);
 static bool is_checksummed_file(const char *fullpath, const char *filename);
+static List *find_created_databases(XLogRecPtr since, XLogRecPtr until);
+static bool is_created_database_file(const char *fullpath,
+									 const char *spcoid);
+static bool is_incremental_candidate(const char *fullpath,
+									 struct stat *statbuf,
+									 const char *spcoid);
+static bool sendIncrementalFile(int fd, const char *readfilename,
+								const char *tarfilename, struct stat *statbuf,
+								backup_manifest_info *manifest,
+								const char *spcoid);
 static int	basebackup_read_file(int fd, char *buf, size_t nbytes, off_t offset,
 								 const char *filename, bool partial_read_ok);
 
 /* Was the backup currently in-progress initiated in recovery mode? */
 static bool backup_started_in_recovery = false;
 
-/* Relative path of temporary statistics directory */
-static char *statrelpath = NULL;
-
 /*
  * Size of each block sent into the tar stream for larger files.
  */
@@ -112,9 +134,35 @@ static TimeOffset elapsed_min_unit;
 /* The last check of the transfer rate. */
 static TimestampTz throttled_last;
 
+/*
+ * Whether the tar archives are gzip-compressed before being sent, and the
+ * state of the compressor for the archive being sent at the moment.
+ */
+static bool compress_archives = false;
+
+#ifdef HAVE_LIBZ
+static int	archive_compresslevel;
+static z_stream zstream;
+static bool zstream_active = false;
+static char *zbuffer = NULL;
+#endif
+
 /* The starting XLOG position of the base backup. */
 static XLogRecPtr startptr;
 
+/*
+ * For an incremental backup, the start position of the earlier backup it's
+ * based on; relation blocks with an older LSN are not sent.
+ */
+static XLogRecPtr incremental_since = InvalidXLogRecPtr;
+
+/*
+ * Databases created since incremental_since, as xl_dbase_create_rec.  Their
+ * files were copied from the template with its page LSNs, so they must be
+ * sent in full.
+ */
+static List *incremental_created_dbs = NIL;
+
 /* Total number of checksum failures during base backup. */
 static long long int total_checksum_failures;
 
@@ -153,9 +201,8 @@ struct exclude_list_item
 static const char *const excludeDirContents[] =
 {
 	/*
-	 * Skip temporary statistics files. PG_STAT_TMP_DIR must be skipped even
-	 * when stats_temp_directory is set because PGSS_TEXT_FILE is always
-	 * created there.
+	 * Skip temporary statistics files.  Extensions such as
+	 * pg_stat_statements keep files there.
 	 */
 	PG_STAT_TMP_DIR,
 
@@ -184,6 +231,9 @@ static const char *const excludeDirContents[] =
 	/* Contents zeroed on startup, see StartupSUBTRANS(). */
 	"pg_subtrans",
 
+	/* Contents reinitialized on startup, see StartupCSNLog(). */
+	"pg_csn",
+
 	/* end of list */
 	NULL
 };
@@ -225,6 +275,12 @@ static const struct exclude_list_item excludeFiles[] =
 	{"postmaster.pid", false},
 	{"postmaster.opts", false},
 
+	/*
+	 * The double-write buffer only protects against torn writes in this
+	 * cluster; base backups rely on full-page writes instead.
+	 */
+	{DOUBLE_WRITE_FILE, false},
+
 	/* end of list */
 	{NULL, false}
 };
@@ -261,7 +317,6 @@ perform_base_backup(basebackup_options *opt)
 	StringInfo	labelfile;
 	StringInfo	tblspc_map_file;
 	backup_manifest_info manifest;
-	int			datadirpathlen;
 	List	   *tablespaces = NIL;
 
 	backup_total = 0;
@@ -284,8 +339,6 @@ perform_base_backup(basebackup_options *opt)
 	Assert(CurrentResourceOwner == NULL);
 	CurrentResourceOwner = ResourceOwnerCreate(NULL, "base backup");
 
-	datadirpathlen = strlen(DataDir);
-
 	backup_started_in_recovery = RecoveryInProgress();
 
 	labelfile = makeStringInfo();
@@ -315,16 +368,24 @@ perform_base_backup(basebackup_options *opt)
 		int			tblspc_streamed = 0;
 
 		/*
-		 * Calculate the relative path of temporary statistics directory in
-		 * order to skip the files which are located in that directory later.
+		 * Record in the backup label that this is an incremental backup, so
+		 * that nobody tries to start a server from it directly.
 		 */
-		if (is_absolute_path(pgstat_stat_directory) &&
-			strncmp(pgstat_stat_directory, DataDir, datadirpathlen) == 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory + datadirpathlen + 1);
-		else if (strncmp(pgstat_stat_directory, "./", 2) != 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory);
+		incremental_since = opt->incremental_since;
+		if (!XLogRecPtrIsInvalid(incremental_since))
+		{
+			if (incremental_since >= startptr)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("incremental backup must be based on a backup started before %X/%X",
+								LSN_FORMAT_ARGS(startptr))));
+			appendStringInfo(labelfile, "INCREMENTAL FROM LSN: %X/%X\n",
+							 LSN_FORMAT_ARGS(incremental_since));
+			incremental_created_dbs = find_created_databases(incremental_since,
+															 startptr);
+		}
 		else
-			statrelpath = pgstat_stat_directory;
+			incremental_created_dbs = NIL;
 
 		/* Add a node for the base directory at the end */
 		ti = palloc0(sizeof(tablespaceinfo));
@@ -399,17 +460,18 @@ perform_base_backup(basebackup_options *opt)
 			throttling_counter = -1;
 		}
 
+		/* Set up compression of the tar archives, if requested. */
+		compress_archives = opt->compression;
+#ifdef HAVE_LIBZ
+		archive_compresslevel = opt->compression_level;
+#endif
+
 		/* Send off our tablespaces one by one */
 		foreach(lc, tablespaces)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
-			StringInfoData buf;
 
-			/* Send CopyOutResponse message */
-			pq_beginmessage(&buf, 'H');
-			pq_sendbyte(&buf, 0);	/* overall format */
-			pq_sendint16(&buf, 0);	/* natts */
-			pq_endmessage(&buf);
+			archive_begin();
 
 			if (ti->path == NULL)
 			{
@@ -455,7 +517,7 @@ perform_base_backup(basebackup_options *opt)
 				Assert(lnext(tablespaces, lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				archive_end();
 
 			tblspc_streamed++;
 			pgstat_progress_update_param(PROGRESS_BASEBACKUP_TBLSPC_STREAMED,
@@ -638,14 +700,10 @@ perform_base_backup(basebackup_options *opt)
 											   len, pathbuf, true)) > 0)
 			{
 				CheckXLogRemoved(segno, tli);
-				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
-					ereport(ERROR,
-							(errmsg("base backup could not send data, aborting backup")));
+				archive_send(buf, cnt);
 				update_basebackup_progress(cnt);
 
 				len += cnt;
-				throttle(cnt);
 
 				if (len == wal_segment_size)
 					break;
@@ -705,8 +763,8 @@ perform_base_backup(basebackup_options *opt)
 			sendFileWithContent(pathbuf, "", &manifest);
 		}
 
-		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		/* Finish the last tar file */
+		archive_end();
 	}
 
 	AddWALInfoToBackupManifest(&manifest, startptr, starttli, endptr, endtli);
@@ -772,6 +830,9 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_noverify_checksums = false;
 	bool		o_manifest = false;
 	bool		o_manifest_checksums = false;
+	bool		o_compression = false;
+	bool		o_compression_level = false;
+	bool		o_incremental_since = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	opt->manifest = MANIFEST_OPTION_NO;
@@ -914,6 +975,68 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 								optval)));
 			o_manifest_checksums = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *optval = defGetString(defel);
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (pg_strcasecmp(optval, "gzip") == 0)
+				opt->compression = true;
+			else if (pg_strcasecmp(optval, "none") == 0)
+				opt->compression = false;
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unrecognized compression algorithm: \"%s\"",
+								optval)));
+#ifndef HAVE_LIBZ
+			if (opt->compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("gzip compression is not supported by this build")));
+#endif
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			int64		level;
+
+			if (o_compression_level)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+
+			level = defGetInt64(defel);
+			if (level < 1 || level > 9)
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+								(int) level, "COMPRESSION_LEVEL", 1, 9)));
+
+			opt->compression_level = (int) level;
+			o_compression_level = true;
+		}
+		else if (strcmp(defel->defname, "incremental_since") == 0)
+		{
+			char	   *optval = defGetString(defel);
+
+			if (o_incremental_since)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->incremental_since =
+				DatumGetLSN(DirectFunctionCall1(pg_lsn_in,
+												CStringGetDatum(optval)));
+			if (XLogRecPtrIsInvalid(opt->incremental_since))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid value for parameter \"%s\": \"%s\"",
+								"INCREMENTAL_SINCE", optval)));
+			o_incremental_since = true;
+		}
 		else
 			ereport(ERROR,
 					errcode(ERRCODE_SYNTAX_ERROR),
@@ -930,6 +1053,14 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 					 errmsg("manifest checksums require a backup manifest")));
 		opt->manifest_checksum_type = CHECKSUM_TYPE_NONE;
 	}
+	if (o_compression_level && !opt->compression)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("compression level requires compression")));
+#ifdef HAVE_LIBZ
+	if (!o_compression_level)
+		opt->compression_level = Z_DEFAULT_COMPRESSION;
+#endif
 }
 
 
@@ -1136,8 +1267,7 @@ sendFileWithContent(const char *filename, const char *content,
 	statbuf.st_size = len;
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
-	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	archive_send(content, len);
 	update_basebackup_progress(len);
 
 	/* Pad to a multiple of the tar block size. */
@@ -1147,7 +1277,7 @@ sendFileWithContent(const char *filename, const char *content,
 		char		buf[TAR_BLOCK_SIZE];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		archive_send(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1391,19 +1521,6 @@ sendDir(const char *path, int basepathlen, bool sizeonly, List *tablespaces,
 		if (excludeFound)
 			continue;
 
-		/*
-		 * Exclude contents of directory specified by statrelpath if not set
-		 * to the default (pg_stat_tmp) which is caught in the loop above.
-		 */
-		if (statrelpath != NULL && strcmp(pathbuf, statrelpath) == 0)
-		{
-			elog(DEBUG1, "contents of directory \"%s\" excluded from backup", statrelpath);
-			convert_link_to_directory(pathbuf, &statbuf);
-			size += _tarWriteHeader(pathbuf + basepathlen + 1, NULL, &statbuf,
-									sizeonly);
-			continue;
-		}
-
 		/*
 		 * We can skip pg_wal, the WAL segments need to be fetched from the
 		 * WAL archive anyway. But include it as an empty directory anyway, so
@@ -1574,6 +1691,290 @@ is_checksummed_file(const char *fullpath, const char *filename)
 		return false;
 }
 
+/*
+ * Find the databases created between two WAL locations, by reading the WAL.
+ *
+ * CREATE DATABASE (and ALTER DATABASE SET TABLESPACE) copy the files of the
+ * source database as they are, page LSNs included, so the pages of the new
+ * database can look older than the earlier backup even though that backup
+ * doesn't have them at all.  The WAL since the earlier backup must still be
+ * available for this.
+ */
+static List *
+find_created_databases(XLogRecPtr since, XLogRecPtr until)
+{
+	XLogReaderState *xlogreader;
+	XLogRecord *record;
+	char	   *errormsg;
+	TimeLineID	save_currtli = ThisTimeLineID;
+	List	   *result = NIL;
+
+	xlogreader = XLogReaderAllocate(wal_segment_size, NULL,
+									XL_ROUTINE(.page_read = &read_local_xlog_page,
+											   .segment_open = &wal_segment_open,
+											   .segment_close = &wal_segment_close),
+									NULL);
+	if (!xlogreader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	/* a backup starts at its checkpoint's redo pointer, a record boundary */
+	XLogBeginRead(xlogreader, since);
+
+	while (xlogreader->EndRecPtr < until)
+	{
+		record = XLogReadRecord(xlogreader, &errormsg);
+		if (record == NULL)
+		{
+			if (errormsg)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read WAL record at %X/%X: %s",
+								LSN_FORMAT_ARGS(xlogreader->EndRecPtr),
+								errormsg),
+						 errhint("An incremental backup needs the WAL written since the backup it is based on.")));
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read WAL record at %X/%X",
+								LSN_FORMAT_ARGS(xlogreader->EndRecPtr)),
+						 errhint("An incremental backup needs the WAL written since the backup it is based on.")));
+		}
+
+		if (XLogRecGetRmid(xlogreader) == RM_DBASE_ID &&
+			(XLogRecGetInfo(xlogreader) & ~XLR_INFO_MASK) == XLOG_DBASE_CREATE)
+		{
+			xl_dbase_create_rec *xlrec = palloc(sizeof(xl_dbase_create_rec));
+
+			memcpy(xlrec, XLogRecGetData(xlogreader),
+				   sizeof(xl_dbase_create_rec));
+			result = lappend(result, xlrec);
+		}
+	}
+
+	/* read_local_xlog_page() may have changed it */
+	ThisTimeLineID = save_currtli;
+
+	XLogReaderFree(xlogreader);
+
+	return result;
+}
+
+/*
+ * Does the given file belong to a database in incremental_created_dbs?
+ *
+ * Database directories are base/<dboid> in the default tablespace, and
+ * <TABLESPACE_VERSION_DIRECTORY>/<dboid> in the tablespace spcoid otherwise.
+ */
+static bool
+is_created_database_file(const char *fullpath, const char *spcoid)
+{
+	const char *end = last_dir_separator(fullpath);
+	const char *start;
+	Oid			spcid;
+	Oid			dbid;
+	ListCell   *lc;
+
+	if (incremental_created_dbs == NIL || end == NULL)
+		return false;
+
+	/* find the name of the directory containing the file */
+	for (start = end; start > fullpath && !IS_DIR_SEP(start[-1]); start--)
+		;
+	if (end == start || strspn(start, "0123456789") != end - start)
+		return false;
+	dbid = atooid(start);
+
+	if (spcoid != NULL)
+		spcid = atooid(spcoid);
+	else if (start - fullpath >= 5 &&
+			 strncmp(start - 5, "base", 4) == 0 && IS_DIR_SEP(start[-1]))
+		spcid = DEFAULTTABLESPACE_OID;
+	else
+		return false;
+
+	foreach(lc, incremental_created_dbs)
+	{
+		xl_dbase_create_rec *xlrec = (xl_dbase_create_rec *) lfirst(lc);
+
+		if (xlrec->db_id == dbid && xlrec->tablespace_id == spcid)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Could the given file be sent as an incremental file?
+ *
+ * Only segments of the main fork of relations qualify.  The other forks are
+ * small, and changes to the free space map aren't WAL-logged, so their page
+ * LSNs can't be trusted.  Nor can those of databases created since the
+ * earlier backup.
+ */
+static bool
+is_incremental_candidate(const char *fullpath, struct stat *statbuf,
+						 const char *spcoid)
+{
+	const char *filename = last_dir_separator(fullpath) + 1;
+	size_t		n;
+
+	if (!is_checksummed_file(fullpath, filename))
+		return false;
+
+	if (is_created_database_file(fullpath, spcoid))
+		return false;
+
+	/* <relfilenode> or <relfilenode>.<segno> */
+	n = strspn(filename, "0123456789");
+	if (n == 0)
+		return false;
+	if (filename[n] == '.')
+	{
+		size_t		m = strspn(filename + n + 1, "0123456789");
+
+		if (m == 0 || filename[n + 1 + m] != '\0')
+			return false;
+	}
+	else if (filename[n] != '\0')
+		return false;
+
+	return statbuf->st_size > 0 && statbuf->st_size % BLCKSZ == 0;
+}
+
+/*
+ * Send a relation segment as an incremental file, containing only the blocks
+ * modified since incremental_since (see basebackup.h for the format).
+ *
+ * A block was modified if its LSN is at least incremental_since.  Blocks with
+ * no LSN at all, such as new pages, are always included.  Blocks modified
+ * after we looked at them are fine for the same reason torn pages are in any
+ * base backup: replaying the WAL from startptr restores them.
+ * pg_combinebackup applies the blocks to the file from the earlier backup.
+ *
+ * Returns false without sending anything if so many blocks changed that the
+ * whole file should be sent instead.
+ */
+static bool
+sendIncrementalFile(int fd, const char *readfilename, const char *tarfilename,
+					struct stat *statbuf, backup_manifest_info *manifest,
+					const char *spcoid)
+{
+	BlockNumber nblocks = statbuf->st_size / BLCKSZ;
+	BlockNumber blkno = 0;
+	uint32	   *header;
+	uint32		nchanged = 0;
+	char		buf[TAR_SEND_SIZE];
+	char	   *incname;
+	const char *sep;
+	struct stat incstat;
+	size_t		hdrlen;
+	pg_checksum_context checksum_ctx;
+
+	/* The header doubles as the list of blocks to send. */
+	header = palloc(sizeof(uint32) * (3 + nblocks));
+
+	/* Find the blocks modified since the earlier backup. */
+	while (blkno < nblocks)
+	{
+		off_t		cnt;
+
+		cnt = basebackup_read_file(fd, buf,
+								   Min(sizeof(buf),
+									   (Size) (nblocks - blkno) * BLCKSZ),
+								   (off_t) blkno * BLCKSZ, readfilename, true);
+
+		/*
+		 * A concurrent truncation; WAL replay will fix things up, but the
+		 * remaining blocks must be sent, zero-filled, for the file to have
+		 * the length announced in the header.
+		 */
+		if (cnt < BLCKSZ)
+		{
+			while (blkno < nblocks)
+				header[3 + nchanged++] = blkno++;
+			break;
+		}
+
+		for (int i = 0; i < cnt / BLCKSZ; i++, blkno++)
+		{
+			XLogRecPtr	lsn = PageGetLSN(buf + BLCKSZ * i);
+
+			if (XLogRecPtrIsInvalid(lsn) || lsn >= incremental_since)
+				header[3 + nchanged++] = blkno;
+		}
+	}
+
+	/* Sending most of the file anyway?  Then send all of it. */
+	if (nchanged > nblocks / 10 * 9)
+	{
+		pfree(header);
+		return false;
+	}
+
+	if (pg_checksum_init(&checksum_ctx, manifest->checksum_type) < 0)
+		elog(ERROR, "could not initialize checksum of file \"%s\"",
+			 readfilename);
+
+	header[0] = INCREMENTAL_MAGIC;
+	header[1] = nchanged;
+	header[2] = nblocks;
+	hdrlen = sizeof(uint32) * (3 + nchanged);
+
+	sep = last_dir_separator(tarfilename);
+	if (sep == NULL)
+		incname = psprintf("INCREMENTAL.%s", tarfilename);
+	else
+		incname = psprintf("%.*s/INCREMENTAL.%s", (int) (sep - tarfilename),
+						   tarfilename, sep + 1);
+
+	incstat = *statbuf;
+	incstat.st_size = hdrlen + (off_t) nchanged * BLCKSZ;
+	_tarWriteHeader(incname, NULL, &incstat, false);
+
+	archive_send((char *) header, hdrlen);
+	if (pg_checksum_update(&checksum_ctx, (uint8 *) header, hdrlen) < 0)
+		elog(ERROR, "could not update checksum of base backup");
+	update_basebackup_progress(hdrlen);
+
+	for (uint32 i = 0; i < nchanged; i++)
+	{
+		off_t		cnt;
+
+		cnt = basebackup_read_file(fd, buf, BLCKSZ,
+								   (off_t) header[3 + i] * BLCKSZ,
+								   readfilename, true);
+		/* if the file was truncated meanwhile, pad it with zeros */
+		if (cnt < BLCKSZ)
+			MemSet(buf + cnt, 0, BLCKSZ - cnt);
+
+		archive_send(buf, BLCKSZ);
+		if (pg_checksum_update(&checksum_ctx, (uint8 *) buf, BLCKSZ) < 0)
+			elog(ERROR, "could not update checksum of base backup");
+		update_basebackup_progress(BLCKSZ);
+	}
+
+	/* Pad to a block boundary, per tar format requirements. */
+	if (tarPaddingBytesRequired(incstat.st_size) > 0)
+	{
+		size_t		pad = tarPaddingBytesRequired(incstat.st_size);
+
+		MemSet(buf, 0, pad);
+		archive_send(buf, pad);
+		update_basebackup_progress(pad);
+	}
+
+	AddFileToBackupManifest(manifest, spcoid, incname, incstat.st_size,
+							(pg_time_t) statbuf->st_mtime, &checksum_ctx);
+
+	pfree(incname);
+	pfree(header);
+
+	return true;
+}
+
 /*****
  * Functions for handling tar file format
  *
@@ -1628,6 +2029,15 @@ sendFile(const char *readfilename, const char *tarfilename,
 				 errmsg("could not open file \"%s\": %m", readfilename)));
 	}
 
+	if (!XLogRecPtrIsInvalid(incremental_since) &&
+		is_incremental_candidate(readfilename, statbuf, spcoid) &&
+		sendIncrementalFile(fd, readfilename, tarfilename, statbuf,
+							manifest, spcoid))
+	{
+		CloseTransientFile(fd);
+		return true;
+	}
+
 	_tarWriteHeader(tarfilename, NULL, statbuf, false);
 
 	if (!noverify_checksums && DataChecksumsEnabled())
@@ -1783,10 +2193,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 			}
 		}
 
-		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
-			ereport(ERROR,
-					(errmsg("base backup could not send data, aborting backup")));
+		archive_send(buf, cnt);
 		update_basebackup_progress(cnt);
 
 		/* Also feed it to the checksum machinery. */
@@ -1794,7 +2201,6 @@ sendFile(const char *readfilename, const char *tarfilename,
 			elog(ERROR, "could not update checksum of base backup");
 
 		len += cnt;
-		throttle(cnt);
 	}
 
 	/* If the file was truncated while we were sending it, pad it with zeros */
@@ -1804,25 +2210,24 @@ sendFile(const char *readfilename, const char *tarfilename,
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			archive_send(buf, cnt);
 			if (pg_checksum_update(&checksum_ctx, (uint8 *) buf, cnt) < 0)
 				elog(ERROR, "could not update checksum of base backup");
 			update_basebackup_progress(cnt);
 			len += cnt;
-			throttle(cnt);
 		}
 	}
 
 	/*
 	 * Pad to a block boundary, per tar format requirements. (This small piece
-	 * of data is probably not worth throttling, and is not checksummed
-	 * because it's not actually part of the file.)
+	 * of data is not checksummed because it's not actually part of the
+	 * file.)
 	 */
 	pad = tarPaddingBytesRequired(len);
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		archive_send(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1880,7 +2285,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		archive_send(h, sizeof(h));
 		update_basebackup_progress(sizeof(h));
 	}
 
@@ -1977,6 +2382,133 @@ throttle(size_t increment)
 	throttled_last = GetCurrentTimestamp();
 }
 
+/*
+ * Start sending a tar archive, as a COPY OUT stream of its own.
+ */
+static void
+archive_begin(void)
+{
+	StringInfoData buf;
+
+	/* Send CopyOutResponse message */
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint16(&buf, 0);		/* natts */
+	pq_endmessage(&buf);
+
+#ifdef HAVE_LIBZ
+	if (compress_archives)
+	{
+		if (zbuffer == NULL)
+			zbuffer = MemoryContextAlloc(TopMemoryContext, TAR_SEND_SIZE);
+
+		/* an earlier backup may have failed halfway through an archive */
+		if (zstream_active)
+			deflateEnd(&zstream);
+		zstream_active = false;
+
+		MemSet(&zstream, 0, sizeof(zstream));
+		zstream.next_out = (Bytef *) zbuffer;
+		zstream.avail_out = TAR_SEND_SIZE;
+
+		/* windowBits of 15 + 16 make zlib write a gzip header and trailer */
+		if (deflateInit2(&zstream, archive_compresslevel, Z_DEFLATED, 15 + 16,
+						 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("could not initialize compression library")));
+		zstream_active = true;
+	}
+#endif
+}
+
+#ifdef HAVE_LIBZ
+/*
+ * Run the compressor over whatever input it has been given, sending out the
+ * output buffer whenever it fills up.  With flush = Z_FINISH, the rest of
+ * the compressed stream is sent too.
+ */
+static void
+archive_deflate(int flush)
+{
+	for (;;)
+	{
+		int			ret;
+		size_t		nbytes;
+
+		ret = deflate(&zstream, flush);
+		if (ret == Z_STREAM_ERROR)
+			elog(ERROR, "could not compress data: %s",
+				 zstream.msg ? zstream.msg : "unknown error");
+
+		nbytes = TAR_SEND_SIZE - zstream.avail_out;
+		if (zstream.avail_out == 0 || (flush == Z_FINISH && nbytes > 0))
+		{
+			if (pq_putmessage('d', zbuffer, nbytes))
+				ereport(ERROR,
+						(errmsg("base backup could not send data, aborting backup")));
+			throttle(nbytes);
+			zstream.next_out = (Bytef *) zbuffer;
+			zstream.avail_out = TAR_SEND_SIZE;
+		}
+
+		if (flush == Z_FINISH ? ret == Z_STREAM_END : zstream.avail_in == 0)
+			break;
+	}
+}
+#endif
+
+/*
+ * Send a piece of the tar archive currently being sent, compressing it first
+ * if requested.  Bytes actually going out to the client are throttled.
+ */
+static void
+archive_send(const char *data, size_t len)
+{
+#ifdef HAVE_LIBZ
+	if (compress_archives)
+	{
+		zstream.next_in = (Bytef *) data;
+		zstream.avail_in = len;
+		archive_deflate(Z_NO_FLUSH);
+		return;
+	}
+#endif
+
+	/* Send the chunk as a CopyData message */
+	if (pq_putmessage('d', data, len))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+	throttle(len);
+}
+
+/*
+ * Finish the tar archive currently being sent.
+ *
+ * Uncompressed archives are terminated by the client, which may want to
+ * append files of its own.  That's not possible with a compressed archive,
+ * so we add the two empty blocks that end a tar file ourselves.
+ */
+static void
+archive_end(void)
+{
+#ifdef HAVE_LIBZ
+	if (compress_archives)
+	{
+		char		zerobuf[TAR_BLOCK_SIZE * 2];
+
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		zstream.next_in = (Bytef *) zerobuf;
+		zstream.avail_in = sizeof(zerobuf);
+		archive_deflate(Z_FINISH);
+		deflateEnd(&zstream);
+		zstream_active = false;
+	}
+#endif
+
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
 /*
  * Increment the counter for the amount of data already streamed
  * by the given number of bytes, and update the progress report for
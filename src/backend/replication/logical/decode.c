@@ -1208,7 +1208,8 @@ DecodeMultiInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 			change->data.tp.clear_toast_afterwards = false;
 
 		ReorderBufferQueueChange(ctx->reorder, XLogRecGetXid(r),
-								 buf->origptr, change, false);
+								 buf->origptr, change,
+								 xlrec->flags & XLH_INSERT_ON_TOAST_RELATION);
 
 		/* move to the next xl_multi_insert_tuple entry */
 		data += datalen;
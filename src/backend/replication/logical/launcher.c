@@ -53,6 +53,7 @@
 
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
+int			max_sync_connections_per_table = 1;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
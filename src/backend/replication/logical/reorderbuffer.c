@@ -178,6 +178,13 @@ typedef struct ReorderBufferDiskChange
 	/* data follows */
 } ReorderBufferDiskChange;
 
+/*
+ * Changes spilled to disk are collected in a buffer of this size, so that
+ * they're written out in large sequential chunks rather than with one
+ * write() per change.
+ */
+#define SPILL_WRITE_BUFFER_SIZE		(64 * 1024)
+
 #define IsSpecInsert(action) \
 ( \
 	((action) == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT) \
@@ -247,6 +254,12 @@ static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										 int fd, ReorderBufferChange *change);
+static void ReorderBufferSpillWrite(ReorderBuffer *rb, ReorderBufferTXN *txn,
+									int fd, char *data, Size len);
+static void ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn,
+									int fd);
+static void ReorderBufferWriteSpillFile(ReorderBufferTXN *txn, int fd,
+										char *data, Size len);
 static Size ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										TXNEntryFile *file, XLogSegNo *segno);
 static void ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
@@ -344,6 +357,8 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->spillbuf = NULL;
+	buffer->spillbufused = 0;
 	buffer->size = 0;
 
 	buffer->spillTxns = 0;
@@ -1047,6 +1062,13 @@ ReorderBufferAssignChild(ReorderBuffer *rb, TransactionId xid,
 	/* set the reference to top-level transaction */
 	subtxn->toptxn = txn;
 
+	/*
+	 * Changes the subtxn already has in memory were accounted to it as if it
+	 * were top-level; from now on they count towards its parent.
+	 */
+	txn->total_size += subtxn->total_size;
+	subtxn->total_size = 0;
+
 	/* add to subtransaction list */
 	dlist_push_tail(&txn->subtxns, &subtxn->node);
 	txn->nsubtxns++;
@@ -3351,36 +3373,35 @@ ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
 }
 
 /*
- * Find the largest transaction (toplevel or subxact) to evict (spill to disk).
+ * Find the largest transaction to evict (spill to disk).
  *
- * XXX With many subtransactions this might be quite slow, because we'll have
- * to walk through all of them. There are some options how we could improve
- * that: (a) maintain some secondary structure with transactions sorted by
- * amount of changes, (b) not looking for the entirely largest transaction,
- * but e.g. for transaction using at least some fraction of the memory limit,
- * and (c) evicting multiple transactions at once, e.g. to free a given portion
- * of the memory limit (e.g. 50%).
+ * We pick the toplevel transaction using the most memory together with its
+ * subtransactions, and spill all of them.  Picking individual
+ * subtransactions instead can be very inefficient for a transaction with many
+ * small subtransactions, since evicting any one of them frees too little
+ * memory to get us under the limit for long.  Walking only the toplevel list
+ * is also much cheaper than walking every (sub)transaction.
  */
 static ReorderBufferTXN *
 ReorderBufferLargestTXN(ReorderBuffer *rb)
 {
-	HASH_SEQ_STATUS hash_seq;
-	ReorderBufferTXNByIdEnt *ent;
+	dlist_iter	iter;
 	ReorderBufferTXN *largest = NULL;
 
-	hash_seq_init(&hash_seq, rb->by_txn);
-	while ((ent = hash_seq_search(&hash_seq)) != NULL)
+	dlist_foreach(iter, &rb->toplevel_by_lsn)
 	{
-		ReorderBufferTXN *txn = ent->txn;
+		ReorderBufferTXN *txn;
+
+		txn = dlist_container(ReorderBufferTXN, node, iter.cur);
 
 		/* if the current transaction is larger, remember it */
-		if ((!largest) || (txn->size > largest->size))
+		if ((!largest) || (txn->total_size > largest->total_size))
 			largest = txn;
 	}
 
 	Assert(largest);
-	Assert(largest->size > 0);
-	Assert(largest->size <= rb->size);
+	Assert(largest->total_size > 0);
+	Assert(largest->total_size <= rb->size);
 
 	return largest;
 }
@@ -3526,6 +3547,9 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	elog(DEBUG2, "spill %u changes in XID %u to disk",
 		 (uint32) txn->nentries_mem, txn->xid);
 
+	/* discard anything left behind by a previous serialization that failed */
+	rb->spillbufused = 0;
+
 	/* do the same to all child TXs */
 	dlist_foreach(subtxn_i, &txn->subtxns)
 	{
@@ -3552,7 +3576,10 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 			char		path[MAXPGPATH];
 
 			if (fd != -1)
+			{
+				ReorderBufferSpillFlush(rb, txn, fd);
 				CloseTransientFile(fd);
+			}
 
 			XLByteToSeg(change->lsn, curOpenSegNo, wal_segment_size);
 
@@ -3599,7 +3626,10 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	txn->txn_flags |= RBTXN_IS_SERIALIZED;
 
 	if (fd != -1)
+	{
+		ReorderBufferSpillFlush(rb, txn, fd);
 		CloseTransientFile(fd);
+	}
 }
 
 /*
@@ -3788,9 +3818,67 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	ondisk->size = sz;
 
+	ReorderBufferSpillWrite(rb, txn, fd, rb->outbuf, ondisk->size);
+
+	/*
+	 * Keep the transaction's final_lsn up to date with each change we send to
+	 * disk, so that ReorderBufferRestoreCleanup works correctly.  (We used to
+	 * only do this on commit and abort records, but that doesn't work if a
+	 * system crash leaves a transaction without its abort record).
+	 *
+	 * Make sure not to move it backwards.
+	 */
+	if (txn->final_lsn < change->lsn)
+		txn->final_lsn = change->lsn;
+
+	Assert(ondisk->change.action == change->action);
+}
+
+/*
+ * Add a serialized change to the spill buffer, writing the buffer out to fd
+ * first if the change doesn't fit.  Changes larger than the buffer are
+ * written directly.
+ */
+static void
+ReorderBufferSpillWrite(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd,
+						char *data, Size len)
+{
+	if (rb->spillbuf == NULL)
+		rb->spillbuf = MemoryContextAlloc(rb->context, SPILL_WRITE_BUFFER_SIZE);
+
+	if (rb->spillbufused + len > SPILL_WRITE_BUFFER_SIZE)
+		ReorderBufferSpillFlush(rb, txn, fd);
+
+	if (len >= SPILL_WRITE_BUFFER_SIZE)
+		ReorderBufferWriteSpillFile(txn, fd, data, len);
+	else
+	{
+		memcpy(rb->spillbuf + rb->spillbufused, data, len);
+		rb->spillbufused += len;
+	}
+}
+
+/*
+ * Write out the spill buffer to fd, which must be the file the buffered
+ * changes belong in.
+ */
+static void
+ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd)
+{
+	if (rb->spillbufused > 0)
+	{
+		ReorderBufferWriteSpillFile(txn, fd, rb->spillbuf, rb->spillbufused);
+		rb->spillbufused = 0;
+	}
+}
+
+static void
+ReorderBufferWriteSpillFile(ReorderBufferTXN *txn, int fd, char *data,
+							Size len)
+{
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
-	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
+	if (write(fd, data, len) != len)
 	{
 		int			save_errno = errno;
 
@@ -3804,19 +3892,6 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 						txn->xid)));
 	}
 	pgstat_report_wait_end();
-
-	/*
-	 * Keep the transaction's final_lsn up to date with each change we send to
-	 * disk, so that ReorderBufferRestoreCleanup works correctly.  (We used to
-	 * only do this on commit and abort records, but that doesn't work if a
-	 * system crash leaves a transaction without its abort record).
-	 *
-	 * Make sure not to move it backwards.
-	 */
-	if (txn->final_lsn < change->lsn)
-		txn->final_lsn = change->lsn;
-
-	Assert(ondisk->change.action == change->action);
 }
 
 /* Returns true, if the output plugin supports streaming, false, otherwise. */
@@ -123,6 +123,21 @@ static bool FetchTableStates(bool *started_tx);
 
 StringInfo	copybuf = NULL;
 
+/*
+ * Connections the initial data of a table is being read from.  Entries are
+ * reset to NULL as the COPY on them finishes.
+ */
+static WalReceiverConn **copy_conns = NULL;
+static pgsocket *copy_conn_fds = NULL;
+static int	ncopy_conns = 0;
+static int	copy_conn_next = 0;
+
+/*
+ * A table is only split for copying over several connections if each of
+ * them gets at least this many blocks to copy (128MB with 8kB blocks).
+ */
+#define MIN_SYNC_RANGE_BLOCKS	16384
+
 /*
  * Exit routine for synchronization worker.
  */
@@ -611,9 +626,51 @@ make_copy_attnamelist(LogicalRepRelMapEntry *rel)
 	return attnamelist;
 }
 
+/*
+ * Receive the next CopyData message from any of the connections the table is
+ * being copied over.  Returns its length, 0 if none of them has data right
+ * now, or -1 once the COPY has finished on all of them.
+ *
+ * The publisher sends every row in a message of its own, so the rows of
+ * different connections can be interleaved freely.  We go round-robin so
+ * that none of the connections falls behind.
+ */
+static int
+copy_receive(char **buf)
+{
+	bool		alldone = true;
+
+	for (int i = 0; i < ncopy_conns; i++)
+	{
+		int			n = (copy_conn_next + i) % ncopy_conns;
+		pgsocket	fd = PGINVALID_SOCKET;
+		int			len;
+
+		if (copy_conns[n] == NULL)
+			continue;
+
+		len = walrcv_receive(copy_conns[n], buf, &fd);
+		if (len > 0)
+		{
+			copy_conn_next = (n + 1) % ncopy_conns;
+			return len;
+		}
+		else if (len < 0)
+		{
+			copy_conns[n] = NULL;
+			continue;
+		}
+
+		copy_conn_fds[n] = fd;
+		alldone = false;
+	}
+
+	return alldone ? -1 : 0;
+}
+
 /*
  * Data source callback for the COPY FROM, which reads from the remote
- * connection and passes the data back to our local COPY.
+ * connections and passes the data back to our local COPY.
  */
 static int
 copy_read_data(void *outbuf, int minread, int maxread)
@@ -635,14 +692,15 @@ copy_read_data(void *outbuf, int minread, int maxread)
 
 	while (maxread > 0 && bytesread < minread)
 	{
-		pgsocket	fd = PGINVALID_SOCKET;
+		WaitEventSet *wes;
+		WaitEvent	event;
 		int			len;
 		char	   *buf = NULL;
 
 		for (;;)
 		{
 			/* Try read the data. */
-			len = walrcv_receive(LogRepWorkerWalRcvConn, &buf, &fd);
+			len = copy_receive(&buf);
 
 			CHECK_FOR_INTERRUPTS();
 
@@ -672,12 +730,21 @@ copy_read_data(void *outbuf, int minread, int maxread)
 		}
 
 		/*
-		 * Wait for more data or latch.
+		 * Wait for more data on any of the connections or latch.
 		 */
-		(void) WaitLatchOrSocket(MyLatch,
-								 WL_SOCKET_READABLE | WL_LATCH_SET |
-								 WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-								 fd, 1000L, WAIT_EVENT_LOGICAL_SYNC_DATA);
+		wes = CreateWaitEventSet(CurrentMemoryContext, ncopy_conns + 2);
+		AddWaitEventToSet(wes, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+		AddWaitEventToSet(wes, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+						  NULL, NULL);
+		for (int i = 0; i < ncopy_conns; i++)
+		{
+			if (copy_conns[i] != NULL)
+				AddWaitEventToSet(wes, WL_SOCKET_READABLE, copy_conn_fds[i],
+								  NULL, NULL);
+		}
+		(void) WaitEventSetWait(wes, 1000L, &event, 1,
+								WAIT_EVENT_LOGICAL_SYNC_DATA);
+		FreeWaitEventSet(wes);
 
 		ResetLatch(MyLatch);
 	}
@@ -799,13 +866,176 @@ fetch_remote_table_info(char *nspname, char *relname,
 	pfree(cmd.data);
 }
 
+/*
+ * Get the current size of the remote relation in blocks.
+ */
+static int64
+fetch_remote_table_nblocks(LogicalRepRelation *lrel)
+{
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+	TupleTableSlot *slot;
+	Oid			sizeRow[] = {INT8OID};
+	bool		isnull;
+	int64		nblocks;
+
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT pg_catalog.pg_relation_size(%u)"
+					 " / pg_catalog.current_setting('block_size')::pg_catalog.int8",
+					 lrel->remoteid);
+	res = walrcv_exec(LogRepWorkerWalRcvConn, cmd.data,
+					  lengthof(sizeRow), sizeRow);
+	pfree(cmd.data);
+
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not fetch table info for table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("table \"%s.%s\" not found on publisher",
+						lrel->nspname, lrel->relname)));
+
+	nblocks = DatumGetInt64(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	return nblocks;
+}
+
+/*
+ * Export the snapshot of the transaction open on the main connection, so
+ * that additional connections can copy data consistent with it.
+ */
+static char *
+export_remote_snapshot(void)
+{
+	WalRcvExecResult *res;
+	TupleTableSlot *slot;
+	Oid			snapRow[] = {TEXTOID};
+	bool		isnull;
+	char	   *snapshot;
+
+	res = walrcv_exec(LogRepWorkerWalRcvConn,
+					  "SELECT pg_catalog.pg_export_snapshot()",
+					  lengthof(snapRow), snapRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not export snapshot on publisher: %s",
+						res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		elog(ERROR, "pg_export_snapshot() returned no rows");
+
+	snapshot = TextDatumGetCString(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	return snapshot;
+}
+
+/*
+ * Open an additional connection to the publisher for copying part of a
+ * table, and start a transaction on it using the given exported snapshot.
+ */
+static WalReceiverConn *
+connect_copy_helper(char *slotname, char *snapshot)
+{
+	WalReceiverConn *conn;
+	WalRcvExecResult *res;
+	char	   *err;
+	char	   *cmd;
+
+	conn = walrcv_connect(MySubscription->conninfo, true, slotname, &err);
+	if (conn == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not connect to the publisher: %s", err)));
+
+	res = walrcv_exec(conn,
+					  "BEGIN READ ONLY ISOLATION LEVEL REPEATABLE READ",
+					  0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("table copy could not start transaction on publisher: %s",
+						res->err)));
+	walrcv_clear_result(res);
+
+	cmd = psprintf("SET TRANSACTION SNAPSHOT %s",
+				   quote_literal_cstr(snapshot));
+	res = walrcv_exec(conn, cmd, 0, NULL);
+	pfree(cmd);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("table copy could not import snapshot on publisher: %s",
+						res->err)));
+	walrcv_clear_result(res);
+
+	return conn;
+}
+
+/*
+ * Start the COPY of the part of the table between the given blocks on the
+ * given connection.  endblk of InvalidBlockNumber means the end of the table.
+ */
+static void
+start_copy_range(WalReceiverConn *conn, LogicalRepRelation *lrel,
+				 BlockNumber startblk, BlockNumber endblk)
+{
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+
+	initStringInfo(&cmd);
+	appendStringInfoString(&cmd, "COPY (SELECT ");
+	for (int i = 0; i < lrel->natts; i++)
+	{
+		appendStringInfoString(&cmd, quote_identifier(lrel->attnames[i]));
+		if (i < lrel->natts - 1)
+			appendStringInfoString(&cmd, ", ");
+	}
+	appendStringInfo(&cmd, " FROM %s WHERE ctid >= '(%u,0)'",
+					 quote_qualified_identifier(lrel->nspname, lrel->relname),
+					 startblk);
+	if (endblk != InvalidBlockNumber)
+		appendStringInfo(&cmd, " AND ctid < '(%u,0)'", endblk);
+	appendStringInfoString(&cmd, ") TO STDOUT");
+
+	res = walrcv_exec(conn, cmd.data, 0, NULL);
+	pfree(cmd.data);
+	if (res->status != WALRCV_OK_COPY_OUT)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not start initial contents copy for table \"%s.%s\": %s",
+						lrel->nspname, lrel->relname, res->err)));
+	walrcv_clear_result(res);
+}
+
 /*
  * Copy existing data of a table from publisher.
  *
+ * A large table is read over up to max_sync_connections_per_table
+ * connections, each copying its own range of blocks with a TID range scan.
+ * The additional connections import the snapshot of the transaction on the
+ * main connection, which is the one the tablesync slot was created with, so
+ * the complete copy is consistent with the slot.
+ *
  * Caller is responsible for locking the local relation.
  */
 static void
-copy_table(Relation rel)
+copy_table(Relation rel, char *slotname)
 {
 	LogicalRepRelMapEntry *relmapentry;
 	LogicalRepRelation lrel;
@@ -814,6 +1044,9 @@ copy_table(Relation rel)
 	CopyFromState cstate;
 	List	   *attnamelist;
 	ParseState *pstate;
+	int64		nblocks = 0;
+	int			nconns = 1;
+	WalReceiverConn **helpers = NULL;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
@@ -826,35 +1059,77 @@ copy_table(Relation rel)
 	relmapentry = logicalrep_rel_open(lrel.remoteid, NoLock);
 	Assert(rel == relmapentry->localrel);
 
-	/* Start copy on the publisher. */
-	initStringInfo(&cmd);
-	if (lrel.relkind == RELKIND_RELATION)
-		appendStringInfo(&cmd, "COPY %s TO STDOUT",
-						 quote_qualified_identifier(lrel.nspname, lrel.relname));
-	else
+	/* Decide whether to split the table. */
+	if (max_sync_connections_per_table > 1 &&
+		lrel.relkind == RELKIND_RELATION &&
+		walrcv_server_version(LogRepWorkerWalRcvConn) >= 140000)
 	{
+		nblocks = fetch_remote_table_nblocks(&lrel);
+		nconns = Min(max_sync_connections_per_table,
+					 nblocks / MIN_SYNC_RANGE_BLOCKS);
+		nconns = Max(nconns, 1);
+	}
+
+	copy_conns = palloc(sizeof(WalReceiverConn *) * nconns);
+	copy_conn_fds = palloc(sizeof(pgsocket) * nconns);
+	ncopy_conns = nconns;
+	copy_conn_next = 0;
+	copy_conns[0] = LogRepWorkerWalRcvConn;
+
+	if (nconns > 1)
+	{
+		BlockNumber blocks_per_conn = nblocks / nconns;
+		char	   *snapshot = export_remote_snapshot();
+
+		helpers = palloc(sizeof(WalReceiverConn *) * nconns);
+		for (int i = 1; i < nconns; i++)
+			copy_conns[i] = helpers[i] = connect_copy_helper(slotname,
+															 snapshot);
+
 		/*
-		 * For non-tables, we need to do COPY (SELECT ...), but we can't just
-		 * do SELECT * because we need to not copy generated columns.
+		 * The last range is left open-ended, but the snapshot can't see any
+		 * rows beyond the size we got anyway.
 		 */
-		appendStringInfoString(&cmd, "COPY (SELECT ");
-		for (int i = 0; i < lrel.natts; i++)
+		for (int i = 0; i < nconns; i++)
+			start_copy_range(copy_conns[i], &lrel, i * blocks_per_conn,
+							 i == nconns - 1 ? InvalidBlockNumber :
+							 (i + 1) * blocks_per_conn);
+
+		elog(DEBUG1, "copying table \"%s.%s\" over %d connections",
+			 lrel.nspname, lrel.relname, nconns);
+	}
+	else
+	{
+		/* Start copy on the publisher. */
+		initStringInfo(&cmd);
+		if (lrel.relkind == RELKIND_RELATION)
+			appendStringInfo(&cmd, "COPY %s TO STDOUT",
+							 quote_qualified_identifier(lrel.nspname, lrel.relname));
+		else
 		{
-			appendStringInfoString(&cmd, quote_identifier(lrel.attnames[i]));
-			if (i < lrel.natts - 1)
-				appendStringInfoString(&cmd, ", ");
+			/*
+			 * For non-tables, we need to do COPY (SELECT ...), but we can't
+			 * just do SELECT * because we need to not copy generated columns.
+			 */
+			appendStringInfoString(&cmd, "COPY (SELECT ");
+			for (int i = 0; i < lrel.natts; i++)
+			{
+				appendStringInfoString(&cmd, quote_identifier(lrel.attnames[i]));
+				if (i < lrel.natts - 1)
+					appendStringInfoString(&cmd, ", ");
+			}
+			appendStringInfo(&cmd, " FROM %s) TO STDOUT",
+							 quote_qualified_identifier(lrel.nspname, lrel.relname));
 		}
-		appendStringInfo(&cmd, " FROM %s) TO STDOUT",
-						 quote_qualified_identifier(lrel.nspname, lrel.relname));
+		res = walrcv_exec(LogRepWorkerWalRcvConn, cmd.data, 0, NULL);
+		pfree(cmd.data);
+		if (res->status != WALRCV_OK_COPY_OUT)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not start initial contents copy for table \"%s.%s\": %s",
+							lrel.nspname, lrel.relname, res->err)));
+		walrcv_clear_result(res);
 	}
-	res = walrcv_exec(LogRepWorkerWalRcvConn, cmd.data, 0, NULL);
-	pfree(cmd.data);
-	if (res->status != WALRCV_OK_COPY_OUT)
-		ereport(ERROR,
-				(errcode(ERRCODE_CONNECTION_FAILURE),
-				 errmsg("could not start initial contents copy for table \"%s.%s\": %s",
-						lrel.nspname, lrel.relname, res->err)));
-	walrcv_clear_result(res);
 
 	copybuf = makeStringInfo();
 
@@ -868,6 +1143,20 @@ copy_table(Relation rel)
 	/* Do the copy */
 	(void) CopyFrom(cstate);
 
+	/*
+	 * The helper connections are no longer needed.  Their read-only
+	 * transactions simply go away with them.
+	 */
+	for (int i = 1; i < nconns; i++)
+		walrcv_disconnect(helpers[i]);
+	if (helpers)
+		pfree(helpers);
+	pfree(copy_conns);
+	pfree(copy_conn_fds);
+	copy_conns = NULL;
+	copy_conn_fds = NULL;
+	ncopy_conns = 0;
+
 	logicalrep_rel_close(relmapentry, NoLock);
 }
 
@@ -1108,7 +1397,7 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 
 	/* Now do the initial data copy */
 	PushActiveSnapshot(GetTransactionSnapshot());
-	copy_table(rel);
+	copy_table(rel, slotname);
 	PopActiveSnapshot();
 
 	res = walrcv_exec(LogRepWorkerWalRcvConn, "COMMIT", 0, NULL);
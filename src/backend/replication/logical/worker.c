@@ -215,6 +215,30 @@ typedef struct ApplyExecutionData
 	PartitionTupleRouting *proute;	/* partition routing info */
 } ApplyExecutionData;
 
+/*
+ * Consecutive INSERTs into the same plain table are buffered and written out
+ * with table_multi_insert(), much like COPY FROM does (see copyfrom.c).  The
+ * batch keeps the relation, its executor state and its indexes open until it
+ * is flushed, which happens when it is full, or before any other change is
+ * applied.  Everything lives in batch_context, since ApplyMessageContext is
+ * reset after each message.
+ */
+#define MAX_BUFFERED_INSERTS		1000
+#define MAX_BUFFERED_INSERT_BYTES	65535
+
+typedef struct ApplyInsertBatch
+{
+	LogicalRepRelMapEntry *rel; /* target relation, or NULL if no batch */
+	ApplyExecutionData *edata;	/* executor state for same */
+	TupleTableSlot *remoteslot; /* slot to convert remote tuples in */
+	TupleTableSlot *slots[MAX_BUFFERED_INSERTS];	/* buffered tuples */
+	int			nused;			/* number of slots in use */
+	Size		nbytes;			/* total size of buffered remote tuples */
+	MemoryContext batch_context;
+} ApplyInsertBatch;
+
+static ApplyInsertBatch insert_batch;
+
 /* Struct for saving and restoring apply errcontext information */
 typedef struct ApplyErrorCallbackArg
 {
@@ -305,6 +329,11 @@ static void maybe_reread_subscription(void);
 static void apply_dispatch(StringInfo s);
 
 static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
+static bool can_batch_inserts(LogicalRepRelMapEntry *rel);
+static void apply_insert_batch_begin(LogicalRepRelMapEntry *rel);
+static void apply_insert_batch_add(LogicalRepTupleData *newtup, Size nbytes);
+static void apply_insert_batch_flush(void);
+static void apply_insert_batch_finish(void);
 static void apply_handle_insert_internal(ApplyExecutionData *edata,
 										 ResultRelInfo *relinfo,
 										 TupleTableSlot *remoteslot);
@@ -1400,6 +1429,9 @@ apply_spooled_messages(TransactionId xid, XLogRecPtr lsn)
 
 	BufFileClose(fd);
 
+	/* Caller is about to commit or prepare */
+	apply_insert_batch_finish();
+
 	pfree(buffer);
 	pfree(s2.data);
 
@@ -1548,6 +1580,21 @@ apply_handle_insert(StringInfo s)
 	begin_replication_step();
 
 	relid = logicalrep_read_insert(s, &newtup);
+
+	/* Add to the pending batch if it's for the same relation ... */
+	if (insert_batch.rel != NULL)
+	{
+		if (insert_batch.rel->remoterel.remoteid == relid)
+		{
+			apply_insert_batch_add(&newtup, s->len);
+			end_replication_step();
+			return;
+		}
+
+		/* ... else write it out first */
+		apply_insert_batch_flush();
+	}
+
 	rel = logicalrep_rel_open(relid, RowExclusiveLock);
 	if (!should_apply_changes_for_rel(rel))
 	{
@@ -1560,6 +1607,15 @@ apply_handle_insert(StringInfo s)
 		return;
 	}
 
+	/* Start a new batch, if the relation allows it */
+	if (can_batch_inserts(rel))
+	{
+		apply_insert_batch_begin(rel);
+		apply_insert_batch_add(&newtup, s->len);
+		end_replication_step();
+		return;
+	}
+
 	/* Set relation for error callback */
 	apply_error_callback_arg.rel = rel;
 
@@ -1594,6 +1650,207 @@ apply_handle_insert(StringInfo s)
 	end_replication_step();
 }
 
+/*
+ * Can INSERTs into this relation be batched?
+ *
+ * As in COPY FROM, we can't if there are BEFORE or INSTEAD OF row triggers,
+ * since they might look at the table and expect to see the rows that have
+ * already been applied.  The same goes for volatile default expressions; to
+ * keep this simple, we insist on all columns coming from the publisher.
+ */
+static bool
+can_batch_inserts(LogicalRepRelMapEntry *rel)
+{
+	Relation	localrel = rel->localrel;
+	TriggerDesc *trigdesc = localrel->trigdesc;
+
+	if (localrel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	if (trigdesc != NULL &&
+		(trigdesc->trig_insert_before_row ||
+		 trigdesc->trig_insert_instead_row))
+		return false;
+
+	if (RelationGetDescr(localrel)->natts != rel->remoterel.natts)
+		return false;
+
+	return true;
+}
+
+/*
+ * Start a batch of INSERTs into rel, which the caller has opened.
+ */
+static void
+apply_insert_batch_begin(LogicalRepRelMapEntry *rel)
+{
+	MemoryContext oldctx;
+
+	Assert(insert_batch.rel == NULL);
+
+	if (insert_batch.batch_context == NULL)
+		insert_batch.batch_context = AllocSetContextCreate(ApplyContext,
+														   "ApplyInsertBatch",
+														   ALLOCSET_DEFAULT_SIZES);
+
+	oldctx = MemoryContextSwitchTo(insert_batch.batch_context);
+
+	CheckCmdReplicaIdentity(rel->localrel, CMD_INSERT);
+
+	insert_batch.rel = rel;
+	insert_batch.edata = create_edata_for_relation(rel);
+	insert_batch.remoteslot = ExecInitExtraTupleSlot(insert_batch.edata->estate,
+													 RelationGetDescr(rel->localrel),
+													 &TTSOpsVirtual);
+	memset(insert_batch.slots, 0, sizeof(insert_batch.slots));
+	insert_batch.nused = 0;
+	insert_batch.nbytes = 0;
+
+	ExecOpenIndices(insert_batch.edata->targetRelInfo, false);
+
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Add a remote tuple to the current batch, flushing it if it becomes full.
+ *
+ * Everything that doesn't depend on the tuples inserted before this one is
+ * done right away, so that errors are reported against the right tuple.
+ */
+static void
+apply_insert_batch_add(LogicalRepTupleData *newtup, Size nbytes)
+{
+	EState	   *estate = insert_batch.edata->estate;
+	ResultRelInfo *relinfo = insert_batch.edata->targetRelInfo;
+	Relation	localrel = relinfo->ri_RelationDesc;
+	TupleTableSlot *slot;
+	MemoryContext oldctx;
+
+	/* Set relation for error callback */
+	apply_error_callback_arg.rel = insert_batch.rel;
+
+	slot = insert_batch.slots[insert_batch.nused];
+	if (slot == NULL)
+	{
+		oldctx = MemoryContextSwitchTo(estate->es_query_cxt);
+		slot = table_slot_create(localrel, &estate->es_tupleTable);
+		insert_batch.slots[insert_batch.nused] = slot;
+		MemoryContextSwitchTo(oldctx);
+	}
+
+	/* Process remote tuple and copy it into the batch */
+	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	slot_store_data(insert_batch.remoteslot, insert_batch.rel, newtup);
+	ExecCopySlot(slot, insert_batch.remoteslot);
+
+	/* Compute stored generated columns */
+	if (localrel->rd_att->constr &&
+		localrel->rd_att->constr->has_generated_stored)
+		ExecComputeStoredGenerated(relinfo, estate, slot, CMD_INSERT);
+
+	/* Check the constraints of the tuple */
+	if (localrel->rd_att->constr)
+		ExecConstraints(relinfo, slot, estate);
+	if (localrel->rd_rel->relispartition)
+		ExecPartitionCheck(relinfo, slot, estate, true);
+	MemoryContextSwitchTo(oldctx);
+
+	ExecClearTuple(insert_batch.remoteslot);
+	ResetPerTupleExprContext(estate);
+
+	insert_batch.nused++;
+	insert_batch.nbytes += nbytes;
+
+	/* Reset relation for error callback */
+	apply_error_callback_arg.rel = NULL;
+
+	if (insert_batch.nused >= MAX_BUFFERED_INSERTS ||
+		insert_batch.nbytes >= MAX_BUFFERED_INSERT_BYTES)
+		apply_insert_batch_flush();
+}
+
+/*
+ * Write out the current batch of INSERTs, if any, and close its relation.
+ *
+ * Must be called within a replication step.
+ */
+static void
+apply_insert_batch_flush(void)
+{
+	ApplyExecutionData *edata = insert_batch.edata;
+	EState	   *estate;
+	ResultRelInfo *relinfo;
+	LogicalRepMsgType saved_command;
+	MemoryContext oldctx;
+
+	if (insert_batch.rel == NULL)
+		return;
+
+	estate = edata->estate;
+	relinfo = edata->targetRelInfo;
+
+	/* Set command and relation for error callback */
+	saved_command = apply_error_callback_arg.command;
+	apply_error_callback_arg.command = LOGICAL_REP_MSG_INSERT;
+	apply_error_callback_arg.rel = insert_batch.rel;
+
+	if (insert_batch.nused > 0)
+	{
+		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+		table_multi_insert(relinfo->ri_RelationDesc, insert_batch.slots,
+						   insert_batch.nused, estate->es_output_cid, 0, NULL);
+		MemoryContextSwitchTo(oldctx);
+
+		for (int i = 0; i < insert_batch.nused; i++)
+		{
+			TupleTableSlot *slot = insert_batch.slots[i];
+			List	   *recheckIndexes = NIL;
+
+			if (relinfo->ri_NumIndices > 0)
+				recheckIndexes = ExecInsertIndexTuples(relinfo, slot, estate,
+													   false, false, NULL, NIL,
+													   false);
+
+			/* AFTER ROW INSERT Triggers */
+			ExecARInsertTriggers(estate, relinfo, slot, recheckIndexes, NULL);
+
+			list_free(recheckIndexes);
+			ExecClearTuple(slot);
+			ResetPerTupleExprContext(estate);
+		}
+	}
+
+	ExecCloseIndices(relinfo);
+	finish_edata(edata);
+	logicalrep_rel_close(insert_batch.rel, NoLock);
+
+	insert_batch.rel = NULL;
+	insert_batch.edata = NULL;
+	insert_batch.remoteslot = NULL;
+	insert_batch.nused = 0;
+	insert_batch.nbytes = 0;
+	MemoryContextReset(insert_batch.batch_context);
+
+	/* Reset command and relation for error callback */
+	apply_error_callback_arg.command = saved_command;
+	apply_error_callback_arg.rel = NULL;
+}
+
+/*
+ * Write out the current batch of INSERTs, if any, in a replication step of
+ * its own.
+ */
+static void
+apply_insert_batch_finish(void)
+{
+	if (insert_batch.rel == NULL)
+		return;
+
+	begin_replication_step();
+	apply_insert_batch_flush();
+	end_replication_step();
+}
+
 /*
  * Workhorse for apply_handle_insert()
  * relinfo is for the relation we're actually inserting into
@@ -2324,6 +2581,10 @@ apply_dispatch(StringInfo s)
 	saved_command = apply_error_callback_arg.command;
 	apply_error_callback_arg.command = action;
 
+	/* Any change other than another INSERT must see batched INSERTs */
+	if (action != LOGICAL_REP_MSG_INSERT)
+		apply_insert_batch_finish();
+
 	switch (action)
 	{
 		case LOGICAL_REP_MSG_BEGIN:
@@ -84,6 +84,7 @@
 #include "storage/proc.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 
 /* User-settable parameters for sync rep */
@@ -99,7 +100,9 @@ static int	SyncRepWaitMode = SYNC_REP_NO_WAIT;
 
 static void SyncRepQueueInsert(int mode);
 static void SyncRepCancelWait(void);
-static int	SyncRepWakeQueue(bool all, int mode);
+static int	SyncRepWakeQueue(bool all, int mode, int *wakeprocs);
+static int *SyncRepGetWakeProcs(void);
+static void SyncRepSetLatches(int *wakeprocs, int nprocs);
 
 static bool SyncRepGetSyncRecPtr(XLogRecPtr *writePtr,
 								 XLogRecPtr *flushPtr,
@@ -448,6 +451,7 @@ SyncRepReleaseWaiters(void)
 	int			numwrite = 0;
 	int			numflush = 0;
 	int			numapply = 0;
+	int		   *wakeprocs;
 
 	/*
 	 * If this WALSender is serving a standby that is not on the list of
@@ -465,19 +469,16 @@ SyncRepReleaseWaiters(void)
 		return;
 	}
 
-	/*
-	 * We're a potential sync standby. Release waiters if there are enough
-	 * sync standbys and we are considered as sync.
-	 */
-	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+	wakeprocs = SyncRepGetWakeProcs();
 
 	/*
-	 * Check whether we are a sync standby or not, and calculate the synced
-	 * positions among all sync standbys.  (Note: although this step does not
-	 * of itself require holding SyncRepLock, it seems like a good idea to do
-	 * it after acquiring the lock.  This ensures that the WAL pointers we use
-	 * to release waiters are newer than any previous execution of this
-	 * routine used.)
+	 * We're a potential sync standby.  Check whether we are a sync standby or
+	 * not, and calculate the synced positions among all sync standbys.  This
+	 * doesn't require holding SyncRepLock, which every committing backend
+	 * also needs, so we do it before acquiring the lock.  The positions may
+	 * then be older than the ones another walsender has meanwhile used to
+	 * release waiters, but we only ever advance the shared positions below,
+	 * so that's harmless.
 	 */
 	got_recptr = SyncRepGetSyncRecPtr(&writePtr, &flushPtr, &applyPtr, &am_sync);
 
@@ -505,11 +506,26 @@ SyncRepReleaseWaiters(void)
 	 */
 	if (!got_recptr || !am_sync)
 	{
-		LWLockRelease(SyncRepLock);
 		announce_next_takeover = !am_sync;
 		return;
 	}
 
+#ifdef PG_HAVE_8BYTE_SINGLE_COPY_ATOMICITY
+
+	/*
+	 * Most replies don't move any of the positions past what some walsender
+	 * has already released waiters up to.  Check that without the lock,
+	 * which is safe because the shared positions only ever advance.
+	 */
+	if (walsndctl->lsn[SYNC_REP_WAIT_WRITE] >= writePtr &&
+		walsndctl->lsn[SYNC_REP_WAIT_FLUSH] >= flushPtr &&
+		walsndctl->lsn[SYNC_REP_WAIT_APPLY] >= applyPtr)
+		return;
+#endif
+
+	/* Release waiters up to the positions we computed */
+	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+
 	/*
 	 * Set the lsn first so that when we wake backends they will release up to
 	 * this location.
@@ -517,21 +533,27 @@ SyncRepReleaseWaiters(void)
 	if (walsndctl->lsn[SYNC_REP_WAIT_WRITE] < writePtr)
 	{
 		walsndctl->lsn[SYNC_REP_WAIT_WRITE] = writePtr;
-		numwrite = SyncRepWakeQueue(false, SYNC_REP_WAIT_WRITE);
+		numwrite = SyncRepWakeQueue(false, SYNC_REP_WAIT_WRITE,
+									wakeprocs);
 	}
 	if (walsndctl->lsn[SYNC_REP_WAIT_FLUSH] < flushPtr)
 	{
 		walsndctl->lsn[SYNC_REP_WAIT_FLUSH] = flushPtr;
-		numflush = SyncRepWakeQueue(false, SYNC_REP_WAIT_FLUSH);
+		numflush = SyncRepWakeQueue(false, SYNC_REP_WAIT_FLUSH,
+									wakeprocs + numwrite);
 	}
 	if (walsndctl->lsn[SYNC_REP_WAIT_APPLY] < applyPtr)
 	{
 		walsndctl->lsn[SYNC_REP_WAIT_APPLY] = applyPtr;
-		numapply = SyncRepWakeQueue(false, SYNC_REP_WAIT_APPLY);
+		numapply = SyncRepWakeQueue(false, SYNC_REP_WAIT_APPLY,
+									wakeprocs + numwrite + numflush);
 	}
 
 	LWLockRelease(SyncRepLock);
 
+	/* Now that they can run without blocking on the lock, wake them */
+	SyncRepSetLatches(wakeprocs, numwrite + numflush + numapply);
+
 	elog(DEBUG3, "released %d procs up to write %X/%X, %d procs up to flush %X/%X, %d procs up to apply %X/%X",
 		 numwrite, LSN_FORMAT_ARGS(writePtr),
 		 numflush, LSN_FORMAT_ARGS(flushPtr),
@@ -868,14 +890,18 @@ SyncRepGetStandbyPriority(void)
 
 /*
  * Walk the specified queue from head.  Set the state of any backends that
- * need to be woken, remove them from the queue, and then wake them.
- * Pass all = true to wake whole queue; otherwise, just wake up to
- * the walsender's LSN.
+ * need to be woken and remove them from the queue.  Pass all = true to wake
+ * whole queue; otherwise, just wake up to the walsender's LSN.
+ *
+ * The pgprocnos of the removed backends are stored into wakeprocs, and their
+ * number is returned.  The caller must wake them with SyncRepSetLatches(),
+ * preferably after releasing the lock, so that they don't wake up only to
+ * queue up on it.
  *
  * The caller must hold SyncRepLock in exclusive mode.
  */
 static int
-SyncRepWakeQueue(bool all, int mode)
+SyncRepWakeQueue(bool all, int mode, int *wakeprocs)
 {
 	volatile WalSndCtlData *walsndctl = WalSndCtl;
 	PGPROC	   *proc = NULL;
@@ -928,14 +954,44 @@ SyncRepWakeQueue(bool all, int mode)
 		/*
 		 * Wake only when we have set state and removed from queue.
 		 */
-		SetLatch(&(thisproc->procLatch));
-
-		numprocs++;
+		wakeprocs[numprocs++] = thisproc->pgprocno;
 	}
 
 	return numprocs;
 }
 
+/*
+ * Get an array large enough to hold the pgprocnos of all backends that
+ * SyncRepWakeQueue() can remove from the queues at once.  Each backend waits
+ * in at most one queue, so one entry per PGPROC suffices.
+ */
+static int *
+SyncRepGetWakeProcs(void)
+{
+	static int *wakeprocs = NULL;
+
+	if (wakeprocs == NULL)
+		wakeprocs = MemoryContextAlloc(TopMemoryContext,
+									   sizeof(int) * ProcGlobal->allProcCount);
+	return wakeprocs;
+}
+
+/*
+ * Set the latches of backends removed from the queue by SyncRepWakeQueue().
+ *
+ * This may be done after releasing SyncRepLock.  A backend may have noticed
+ * its changed syncRepState already and gone on, even exited, in which case
+ * the wakeup is spurious, which latch waiters always have to tolerate.
+ */
+static void
+SyncRepSetLatches(int *wakeprocs, int nprocs)
+{
+	int			i;
+
+	for (i = 0; i < nprocs; i++)
+		SetLatch(&ProcGlobal->allProcs[wakeprocs[i]].procLatch);
+}
+
 /*
  * The checkpointer calls this as needed to update the shared
  * sync_standbys_defined flag, so that backends don't remain permanently wedged
@@ -959,10 +1015,14 @@ SyncRepUpdateSyncStandbysDefined(void)
 		 */
 		if (!sync_standbys_defined)
 		{
+			int		   *wakeprocs = SyncRepGetWakeProcs();
+			int			numprocs = 0;
 			int			i;
 
 			for (i = 0; i < NUM_SYNC_REP_WAIT_MODE; i++)
-				SyncRepWakeQueue(true, i);
+				numprocs += SyncRepWakeQueue(true, i, wakeprocs + numprocs);
+
+			SyncRepSetLatches(wakeprocs, numprocs);
 		}
 
 		/*
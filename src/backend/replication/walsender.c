@@ -928,7 +928,15 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	else
 		count = flushptr - targetPagePtr;	/* part of the page available */
 
-	/* now actually read the data, we know it's there */
+	/*
+	 * Now actually read the data, we know it's there.  If it was written
+	 * recently enough to still be in the WAL buffers, get it from there.
+	 */
+	if (!sendTimeLineIsHistoric &&
+		XLogReadFromBuffers(cur_page, targetPagePtr, count,
+							state->currTLI) == count)
+		return count;
+
 	if (!WALRead(state,
 				 cur_page,
 				 targetPagePtr,
@@ -2658,6 +2666,7 @@ XLogSendPhysical(void)
 	XLogRecPtr	startptr;
 	XLogRecPtr	endptr;
 	Size		nbytes;
+	Size		bufbytes = 0;
 	XLogSegNo	segno;
 	WALReadError errinfo;
 
@@ -2875,11 +2884,21 @@ XLogSendPhysical(void)
 	 */
 	enlargeStringInfo(&output_message, nbytes);
 
+	/*
+	 * WAL that was flushed recently is likely to be still in the WAL buffers,
+	 * in which case we can copy it from there rather than read it back from
+	 * the file.  Only the remainder, if any, is read from disk.
+	 */
+	if (!am_cascading_walsender && !sendTimeLineIsHistoric)
+		bufbytes = XLogReadFromBuffers(&output_message.data[output_message.len],
+									   startptr, nbytes, sendTimeLine);
+
 retry:
-	if (!WALRead(xlogreader,
-				 &output_message.data[output_message.len],
-				 startptr,
-				 nbytes,
+	if (bufbytes < nbytes &&
+		!WALRead(xlogreader,
+				 &output_message.data[output_message.len + bufbytes],
+				 startptr + bufbytes,
+				 nbytes - bufbytes,
 				 xlogreader->seg.ws_tli,	/* Pass the current TLI because
 											 * only WalSndSegmentOpen controls
 											 * whether new TLI is needed. */
@@ -22,6 +22,7 @@
 #include "access/table.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_collation.h"
+#include "catalog/pg_statistic.h"
 #include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_statistic_ext_data.h"
 #include "executor/executor.h"
@@ -30,6 +31,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "statistics/extended_stats_internal.h"
@@ -2009,6 +2011,234 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * Equality join clauses between one pair of base relations, collected by
+ * statext_join_clauselist_selectivity.
+ */
+typedef struct JoinClauseGroup
+{
+	Index		relid1;			/* lower-numbered relation */
+	Index		relid2;			/* higher-numbered relation */
+	List	   *vars1;			/* join columns of relid1 */
+	List	   *vars2;			/* matching join columns of relid2 */
+	Bitmapset  *attnums1;		/* attnums of vars1 */
+	Bitmapset  *attnums2;		/* attnums of vars2 */
+	Bitmapset  *clauses;		/* list positions of the clauses */
+} JoinClauseGroup;
+
+/*
+ * statext_join_var
+ *		Return the plain user column a join clause argument refers to, or
+ *		NULL if it's anything else.
+ */
+static Var *
+statext_join_var(Node *node)
+{
+	if (IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+
+	if (!IsA(node, Var))
+		return NULL;
+
+	if (((Var *) node)->varlevelsup != 0 ||
+		!AttrNumberIsForUserDefinedAttr(((Var *) node)->varattno))
+		return NULL;
+
+	return (Var *) node;
+}
+
+/*
+ * statext_join_covered
+ *		Is there an ndistinct statistic covering all the given columns?
+ */
+static bool
+statext_join_covered(RelOptInfo *rel, Bitmapset *attnums)
+{
+	ListCell   *l;
+
+	if (rel->rtekind != RTE_RELATION)
+		return false;
+
+	foreach(l, rel->statlist)
+	{
+		StatisticExtInfo *stat = (StatisticExtInfo *) lfirst(l);
+
+		if (stat->kind == STATS_EXT_NDISTINCT &&
+			bms_is_subset(attnums, stat->keys))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * statext_join_nonnull_frac
+ *		Estimate the fraction of rows in which none of the columns is NULL,
+ *		assuming the columns' nulls are independent.
+ */
+static Selectivity
+statext_join_nonnull_frac(PlannerInfo *root, List *vars)
+{
+	Selectivity frac = 1.0;
+	ListCell   *l;
+
+	foreach(l, vars)
+	{
+		VariableStatData vardata;
+
+		examine_variable(root, (Node *) lfirst(l), 0, &vardata);
+
+		if (HeapTupleIsValid(vardata.statsTuple))
+		{
+			Form_pg_statistic stats;
+
+			stats = (Form_pg_statistic) GETSTRUCT(vardata.statsTuple);
+			frac *= 1.0 - stats->stanullfrac;
+		}
+
+		ReleaseVariableStats(vardata);
+	}
+
+	return frac;
+}
+
+/*
+ * statext_join_clauselist_selectivity
+ *		Estimate groups of equality join clauses using ndistinct statistics.
+ *
+ * The per-clause join estimate, 1/max(nd1, nd2), assumes the join columns
+ * are independent, so a join on several correlated columns (e.g. a composite
+ * foreign key that isn't declared as one) is underestimated, often by orders
+ * of magnitude.  When two or more equality clauses join the same pair of base
+ * relations, and an ndistinct statistic covers the join columns of at least
+ * one side, we instead estimate the number of distinct combinations on each
+ * side with estimate_num_groups() (which uses the multivariate ndistinct
+ * coefficients) and apply the same formula to the whole group of clauses.
+ *
+ * Only inner joins are handled; eqjoinsel() takes care of the adjustments
+ * needed for outer and semi/anti joins.  Clauses estimated here are added to
+ * *estimatedclauses, using their 0-based position in the list.
+ */
+Selectivity
+statext_join_clauselist_selectivity(PlannerInfo *root, List *clauses,
+									JoinType jointype, SpecialJoinInfo *sjinfo,
+									Bitmapset **estimatedclauses)
+{
+	Selectivity sel = 1.0;
+	List	   *groups = NIL;
+	ListCell   *l;
+	int			listidx;
+
+	if (jointype != JOIN_INNER)
+		return sel;
+
+	/* Collect the equality join clauses, grouped by pair of relations */
+	listidx = -1;
+	foreach(l, clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
+		OpExpr	   *expr;
+		Var		   *var1;
+		Var		   *var2;
+		JoinClauseGroup *group = NULL;
+		ListCell   *lc;
+
+		listidx++;
+
+		if (bms_is_member(listidx, *estimatedclauses))
+			continue;
+
+		if (!IsA(rinfo, RestrictInfo) || rinfo->pseudoconstant ||
+			!is_opclause(rinfo->clause))
+			continue;
+
+		if (bms_membership(rinfo->left_relids) != BMS_SINGLETON ||
+			bms_membership(rinfo->right_relids) != BMS_SINGLETON ||
+			bms_overlap(rinfo->left_relids, rinfo->right_relids))
+			continue;
+
+		expr = (OpExpr *) rinfo->clause;
+		if (list_length(expr->args) != 2 ||
+			get_oprrest(expr->opno) != F_EQJOINSEL)
+			continue;
+
+		var1 = statext_join_var(linitial(expr->args));
+		var2 = statext_join_var(lsecond(expr->args));
+		if (var1 == NULL || var2 == NULL || var1->varno == var2->varno)
+			continue;
+
+		if (var1->varno > var2->varno)
+		{
+			Var		   *tmp = var1;
+
+			var1 = var2;
+			var2 = tmp;
+		}
+
+		foreach(lc, groups)
+		{
+			JoinClauseGroup *g = (JoinClauseGroup *) lfirst(lc);
+
+			if (g->relid1 == var1->varno && g->relid2 == var2->varno)
+			{
+				group = g;
+				break;
+			}
+		}
+
+		if (group == NULL)
+		{
+			group = (JoinClauseGroup *) palloc0(sizeof(JoinClauseGroup));
+			group->relid1 = var1->varno;
+			group->relid2 = var2->varno;
+			groups = lappend(groups, group);
+		}
+
+		/* leave clauses repeating a column to the per-clause estimate */
+		if (bms_is_member(var1->varattno, group->attnums1) ||
+			bms_is_member(var2->varattno, group->attnums2))
+			continue;
+
+		group->vars1 = lappend(group->vars1, var1);
+		group->vars2 = lappend(group->vars2, var2);
+		group->attnums1 = bms_add_member(group->attnums1, var1->varattno);
+		group->attnums2 = bms_add_member(group->attnums2, var2->varattno);
+		group->clauses = bms_add_member(group->clauses, listidx);
+	}
+
+	foreach(l, groups)
+	{
+		JoinClauseGroup *group = (JoinClauseGroup *) lfirst(l);
+		RelOptInfo *rel1;
+		RelOptInfo *rel2;
+		double		nd1;
+		double		nd2;
+		Selectivity group_sel;
+
+		if (list_length(group->vars1) < 2)
+			continue;
+
+		rel1 = find_base_rel(root, group->relid1);
+		rel2 = find_base_rel(root, group->relid2);
+
+		if (!statext_join_covered(rel1, group->attnums1) &&
+			!statext_join_covered(rel2, group->attnums2))
+			continue;
+
+		nd1 = estimate_num_groups(root, group->vars1, rel1->rows, NULL, NULL);
+		nd2 = estimate_num_groups(root, group->vars2, rel2->rows, NULL, NULL);
+
+		group_sel = statext_join_nonnull_frac(root, group->vars1) *
+			statext_join_nonnull_frac(root, group->vars2) / Max(nd1, nd2);
+		CLAMP_PROBABILITY(group_sel);
+
+		sel *= group_sel;
+		*estimatedclauses = bms_add_members(*estimatedclauses, group->clauses);
+	}
+
+	return sel;
+}
+
 /*
  * examine_opclause_args
  *		Split an operator expression's arguments into Expr and Const parts.
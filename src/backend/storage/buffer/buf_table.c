@@ -9,6 +9,11 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * The exception is BufTableLookupOptimistic(), which doesn't need a lock:
+ * writers bump a per-partition sequence counter before and after modifying
+ * the table, which lets readers detect concurrent changes and fall back to
+ * a locked lookup.
+ *
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,8 +26,10 @@
  */
 #include "postgres.h"
 
+#include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/shmem.h"
 
 /* entry for buffer lookup hashtable */
 typedef struct
@@ -31,7 +38,29 @@ typedef struct
 	int			id;				/* Associated buffer ID */
 } BufferLookupEnt;
 
+/*
+ * Per-partition modification counter.  It is odd while a modification is
+ * in progress.  Each counter gets its own cache line, so that writers in one
+ * partition don't disturb optimistic readers of another.
+ */
+typedef union BufTableSeqCounter
+{
+	pg_atomic_uint32 seq;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufTableSeqCounter;
+
+/*
+ * Maximum number of hash chain elements an optimistic lookup visits.  Chains
+ * are normally very short, this just guards against chasing links that are
+ * being changed concurrently for a long time.
+ */
+#define BUFTABLE_OPTIMISTIC_MAX_STEPS	64
+
 static HTAB *SharedBufHash;
+static BufTableSeqCounter *BufTableSeqCounters;
+
+static inline void BufTableBeginModify(uint32 hashcode);
+static inline void BufTableEndModify(uint32 hashcode);
 
 
 /*
@@ -41,7 +70,9 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	return add_size(hash_estimate_size(size, sizeof(BufferLookupEnt)),
+					mul_size(NUM_BUFFER_PARTITIONS,
+							 sizeof(BufTableSeqCounter)));
 }
 
 /*
@@ -52,6 +83,7 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -64,6 +96,16 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	BufTableSeqCounters = (BufTableSeqCounter *)
+		ShmemInitStruct("Shared Buffer Lookup Sequence Counters",
+						NUM_BUFFER_PARTITIONS * sizeof(BufTableSeqCounter),
+						&found);
+	if (!found)
+	{
+		for (int i = 0; i < NUM_BUFFER_PARTITIONS; i++)
+			pg_atomic_init_u32(&BufTableSeqCounters[i].seq, 0);
+	}
 }
 
 /*
@@ -105,6 +147,54 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupOptimistic
+ *		Lookup the given BufferTag without holding the BufMappingLock
+ *
+ * Returns the buffer ID, or -1 if the tag wasn't found or the partition was
+ * modified concurrently.  In either case the caller has to retry with
+ * BufTableLookup() under the partition lock to get a definite answer.
+ *
+ * Even a buffer ID returned by this function may have been reassigned to
+ * another page by the time the caller gets to look at it, just as with
+ * BufTableLookup() once the lock is released.  Callers must therefore pin
+ * the buffer and then recheck its tag.
+ */
+int
+BufTableLookupOptimistic(BufferTag *tagPtr, uint32 hashcode)
+{
+	pg_atomic_uint32 *seqp;
+	BufferLookupEnt *result;
+	uint32		before;
+	int			buf_id;
+
+	seqp = &BufTableSeqCounters[BufTableHashPartition(hashcode)].seq;
+
+	before = pg_atomic_read_u32(seqp);
+	if (before & 1)
+		return -1;				/* modification in progress */
+
+	pg_read_barrier();
+
+	result = (BufferLookupEnt *)
+		hash_search_unlocked(SharedBufHash,
+							 (void *) tagPtr,
+							 hashcode,
+							 BUFTABLE_OPTIMISTIC_MAX_STEPS);
+	if (!result)
+		return -1;
+	buf_id = result->id;
+
+	pg_read_barrier();
+
+	if (pg_atomic_read_u32(seqp) != before)
+		return -1;				/* table changed while we looked */
+	if (buf_id < 0 || buf_id >= NBuffers)
+		return -1;				/* paranoia */
+
+	return buf_id;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -124,6 +214,8 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
 
+	BufTableBeginModify(hashcode);
+
 	result = (BufferLookupEnt *)
 		hash_search_with_hash_value(SharedBufHash,
 									(void *) tagPtr,
@@ -131,11 +223,14 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 									HASH_ENTER,
 									&found);
 
+	if (!found)
+		result->id = buf_id;
+
+	BufTableEndModify(hashcode);
+
 	if (found)					/* found something already in the table */
 		return result->id;
 
-	result->id = buf_id;
-
 	return -1;
 }
 
@@ -150,6 +245,8 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 {
 	BufferLookupEnt *result;
 
+	BufTableBeginModify(hashcode);
+
 	result = (BufferLookupEnt *)
 		hash_search_with_hash_value(SharedBufHash,
 									(void *) tagPtr,
@@ -157,6 +254,28 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 									HASH_REMOVE,
 									NULL);
 
+	BufTableEndModify(hashcode);
+
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
 }
+
+/*
+ * BufTableBeginModify, BufTableEndModify
+ *		Bracket a modification of the tag's partition
+ *
+ * The atomic increments act as full memory barriers, so optimistic readers
+ * seeing the same even counter value before and after their lookup can be
+ * sure no modification overlapped with it.
+ */
+static inline void
+BufTableBeginModify(uint32 hashcode)
+{
+	pg_atomic_fetch_add_u32(&BufTableSeqCounters[BufTableHashPartition(hashcode)].seq, 1);
+}
+
+static inline void
+BufTableEndModify(uint32 hashcode)
+{
+	pg_atomic_fetch_add_u32(&BufTableSeqCounters[BufTableHashPartition(hashcode)].seq, 1);
+}
@@ -45,11 +45,13 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -157,9 +159,40 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
+/*
+ * Maximum number of consecutive blocks read with a single vectored read.  A
+ * backend can have I/O in progress on that many buffers at once, plus one
+ * more for flushing a victim buffer while it is collecting them.
+ */
+#define MAX_BUFFERS_PER_READ	16
+
+/*
+ * Maximum number of consecutive dirty buffers the checkpointer writes with a
+ * single vectored write.  It holds I/O on all of them at once.
+ */
+#define MAX_BUFFERS_PER_WRITE	32
+
+#define MAX_IN_PROGRESS_IO \
+	(Max(MAX_BUFFERS_PER_READ, MAX_BUFFERS_PER_WRITE) + 1)
+
+/*
+ * A run of consecutive blocks of one relation fork, pinned, share-locked and
+ * with I/O started, that BufferSync is about to write.
+ */
+typedef struct CkptWriteBatch
+{
+	WritebackContext *wb_context;	/* where to schedule writeback */
+	int			nbufs;
+	BufferDesc *bufs[MAX_BUFFERS_PER_WRITE];
+} CkptWriteBatch;
+
+/* private page copies for checksumming batched writes; see CkptBatchFlush */
+static char *CkptWriteCopies = NULL;
+
 /* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_IO];
+static bool InProgressIsForInput[MAX_IN_PROGRESS_IO];
+static int	NumInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -461,6 +494,11 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 								ForkNumber forkNum, BlockNumber blockNum,
 								ReadBufferMode mode, BufferAccessStrategy strategy,
 								bool *hit);
+static void ReadBufferRange(Relation reln, ForkNumber forkNum,
+							BlockNumber firstBlock, int nblocks,
+							BufferAccessStrategy strategy, Buffer *buffers);
+static void CompleteReadRange(SMgrRelation smgr, ForkNumber forkNum,
+							  BufferDesc **run, int nrun, IOContext io_context);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
@@ -480,7 +518,10 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln,
+						IOContext io_context);
+static bool CkptBatchAddBuffer(CkptWriteBatch *batch, int buf_id);
+static void CkptBatchFlush(CkptWriteBatch *batch);
 static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
 										  ForkNumber forkNum,
 										  BlockNumber nForkBlock,
@@ -530,7 +571,7 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 		 * Try to initiate an asynchronous read.  This returns false in
 		 * recovery if the relation file doesn't exist.
 		 */
-		if (smgrprefetch(smgr_reln, forkNum, blockNum))
+		if (smgrprefetch(smgr_reln, forkNum, blockNum, 1))
 			result.initiated_io = true;
 #endif							/* USE_PREFETCH */
 	}
@@ -607,6 +648,323 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 }
 
+/*
+ * PrefetchBufferRange -- initiate asynchronous read of a range of blocks
+ *
+ * Unlike PrefetchBuffer, this doesn't look the blocks up in the buffer pool
+ * first; the whole range is handed straight to the storage manager, which
+ * can then issue one request per segment file rather than one per block.
+ * That makes it suitable for sequential access patterns, where the cost of
+ * probing the buffer mapping table for every block would be wasted on data
+ * that is mostly not cached.  Callers that know the blocks are likely to be
+ * in shared buffers should not use this.
+ */
+void
+PrefetchBufferRange(Relation reln, ForkNumber forkNum,
+					BlockNumber firstBlock, BlockNumber nblocks)
+{
+#ifdef USE_PREFETCH
+	Assert(RelationIsValid(reln));
+	Assert(BlockNumberIsValid(firstBlock));
+
+	if (nblocks == 0)
+		return;
+
+	/* see comments in ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(reln))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	(void) smgrprefetch(RelationGetSmgr(reln), forkNum, firstBlock, nblocks);
+#endif							/* USE_PREFETCH */
+}
+
+/* Hard upper limit on the read-ahead distance, in blocks */
+#define MAX_READAHEAD_DISTANCE	512
+
+/*
+ * ReadAheadInit -- set up adaptive read-ahead for a sequential scan
+ *
+ * nblocks is the number of blocks in the fork being scanned; io_concurrency
+ * is the applicable effective_io_concurrency or maintenance_io_concurrency
+ * setting, which scales the maximum distance.  Zero disables read-ahead.
+ */
+void
+ReadAheadInit(ReadAheadState *ra, ForkNumber forkNum, BlockNumber nblocks,
+			  int io_concurrency)
+{
+	ra->forknum = forkNum;
+	ra->nblocks = nblocks;
+	ra->last_blkno = InvalidBlockNumber;
+	ra->next_blkno = InvalidBlockNumber;
+#ifdef USE_PREFETCH
+	ra->max_distance = Min(io_concurrency * 16, MAX_READAHEAD_DISTANCE);
+#else
+	ra->max_distance = 0;
+#endif
+	ra->distance = Min(ra->max_distance, 8);
+	ra->last_reads = pgBufferUsage.shared_blks_read +
+		pgBufferUsage.local_blks_read;
+}
+
+/*
+ * ReadAheadBlock -- note that the caller is about to read blkno
+ *
+ * When the scan is progressing forward, keep a window of up to "distance"
+ * blocks beyond blkno prefetched, refilling it with a single range request
+ * once less than half of it remains.  At each refill the distance is
+ * adapted: if any of the blocks read since the previous refill missed the
+ * buffer pool, the distance doubles (up to max_distance), otherwise it
+ * halves.  A scan over a table that is entirely in shared buffers therefore
+ * quickly stops issuing prefetch requests (until it sees a miss again), while
+ * a scan that has to go to storage ramps up to deep prefetching.
+ *
+ * Anything other than advancing by one block (or wrapping around to block 0,
+ * as a synchronized scan does) suppresses read-ahead for that call, so
+ * backward scans and skipping scans don't prefetch data they won't read.
+ */
+void
+ReadAheadBlock(ReadAheadState *ra, Relation reln, BlockNumber blkno)
+{
+#ifdef USE_PREFETCH
+	int64		reads;
+	BlockNumber window_end;
+
+	if (ra->max_distance <= 0)
+		return;
+
+	if (ra->last_blkno != InvalidBlockNumber && blkno != 0 &&
+		blkno != ra->last_blkno + 1)
+	{
+		/* not moving forward one block at a time; don't guess */
+		ra->last_blkno = blkno;
+		ra->next_blkno = blkno + 1;
+		return;
+	}
+	if (ra->last_blkno == InvalidBlockNumber || blkno == 0 ||
+		blkno >= ra->next_blkno)
+	{
+		/* (re)start the window just after the block being read */
+		ra->next_blkno = blkno + 1;
+	}
+	ra->last_blkno = blkno;
+
+	if (ra->next_blkno >= ra->nblocks)
+		return;
+
+	reads = pgBufferUsage.shared_blks_read + pgBufferUsage.local_blks_read;
+
+	if (ra->distance == 0)
+	{
+		/* idle: resume as soon as the scan starts missing the buffer pool */
+		if (reads == ra->last_reads)
+			return;
+		ra->distance = Min(ra->max_distance, 8);
+	}
+	else
+	{
+		/* still enough blocks in flight? */
+		if (ra->next_blkno - blkno > (BlockNumber) Max(ra->distance / 2, 1))
+			return;
+
+		if (reads != ra->last_reads)
+			ra->distance = Min(ra->distance * 2, ra->max_distance);
+		else
+			ra->distance /= 2;
+	}
+	ra->last_reads = reads;
+
+	window_end = Min(blkno + 1 + (BlockNumber) ra->distance, ra->nblocks);
+	if (window_end > ra->next_blkno)
+	{
+		PrefetchBufferRange(reln, ra->forknum, ra->next_blkno,
+							window_end - ra->next_blkno);
+		ra->next_blkno = window_end;
+	}
+#endif							/* USE_PREFETCH */
+}
+
+/*
+ * Read streams
+ *
+ * A read stream returns pinned buffers for the blocks produced by a callback,
+ * in the order it produces them.  Consecutive block numbers are collected
+ * into runs and read with a single vectored read, so a sequential consumer
+ * costs one system call per run rather than one per block.  The run length
+ * adapts like the read-ahead distance above: it doubles (up to
+ * MAX_BUFFERS_PER_READ) while reads miss shared buffers and halves down to a
+ * single block while they hit, so cached data isn't pinned further ahead
+ * than necessary.
+ *
+ * The callback returns InvalidBlockNumber to signal the end of the stream.
+ * Buffers that have been read ahead stay pinned until they are returned by
+ * ReadStreamNextBuffer, or released by ReadStreamReset or ReadStreamEnd.
+ */
+struct ReadStream
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+	ReadStreamBlockCB callback;
+	void	   *callback_private;
+
+	int			distance;		/* current run length target */
+	int			max_distance;	/* upper limit for distance */
+	bool		finished;		/* has the callback returned InvalidBlockNumber? */
+	BlockNumber pending_blkno;	/* block from the callback not yet read */
+
+	int			nbuffers;		/* number of valid entries in buffers[] */
+	int			next;			/* next entry of buffers[] to return */
+	Buffer		buffers[MAX_BUFFERS_PER_READ];
+};
+
+/*
+ * ReadStreamBegin -- create a read stream for a fork of a relation
+ *
+ * The stream is allocated in CurrentMemoryContext.  "strategy" is used for
+ * all reads and must live as long as the stream.
+ */
+ReadStream *
+ReadStreamBegin(Relation rel, ForkNumber forkNum,
+				BufferAccessStrategy strategy,
+				ReadStreamBlockCB callback, void *callback_private)
+{
+	ReadStream *stream;
+
+	/* see comments in ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	stream = (ReadStream *) palloc(sizeof(ReadStream));
+	stream->rel = rel;
+	stream->forknum = forkNum;
+	stream->strategy = strategy;
+	stream->callback = callback;
+	stream->callback_private = callback_private;
+	stream->distance = 1;
+
+	/* local buffers are read one at a time */
+	stream->max_distance =
+		RelationUsesLocalBuffers(rel) ? 1 : MAX_BUFFERS_PER_READ;
+	stream->finished = false;
+	stream->pending_blkno = InvalidBlockNumber;
+	stream->nbuffers = 0;
+	stream->next = 0;
+
+	return stream;
+}
+
+/*
+ * ReadStreamNextBuffer -- return the next block of the stream, pinned
+ *
+ * Returns InvalidBuffer once the callback has ended the stream.  The caller
+ * owns the returned pin and must release it.
+ */
+Buffer
+ReadStreamNextBuffer(ReadStream *stream)
+{
+	BlockNumber first_blkno;
+	int64		reads;
+	int			n;
+
+	if (stream->next < stream->nbuffers)
+		return stream->buffers[stream->next++];
+
+	stream->next = stream->nbuffers = 0;
+
+	if (stream->pending_blkno != InvalidBlockNumber)
+	{
+		first_blkno = stream->pending_blkno;
+		stream->pending_blkno = InvalidBlockNumber;
+	}
+	else if (stream->finished)
+		return InvalidBuffer;
+	else
+	{
+		first_blkno = stream->callback(stream, stream->callback_private);
+		if (first_blkno == InvalidBlockNumber)
+		{
+			stream->finished = true;
+			return InvalidBuffer;
+		}
+	}
+
+	/* collect as many consecutive blocks as the current distance allows */
+	n = 1;
+	while (n < stream->distance && !stream->finished)
+	{
+		BlockNumber blkno;
+
+		blkno = stream->callback(stream, stream->callback_private);
+		if (blkno == InvalidBlockNumber)
+			stream->finished = true;
+		else if (blkno != first_blkno + n)
+		{
+			/* not consecutive; start the next run with it */
+			stream->pending_blkno = blkno;
+			break;
+		}
+		else
+			n++;
+	}
+
+	reads = pgBufferUsage.shared_blks_read + pgBufferUsage.local_blks_read;
+
+	if (n == 1 || RelationUsesLocalBuffers(stream->rel))
+	{
+		for (int i = 0; i < n; i++)
+			stream->buffers[i] = ReadBufferExtended(stream->rel,
+													stream->forknum,
+													first_blkno + i,
+													RBM_NORMAL,
+													stream->strategy);
+	}
+	else
+		ReadBufferRange(stream->rel, stream->forknum, first_blkno, n,
+						stream->strategy, stream->buffers);
+
+	/* adapt the run length to how much of it had to come from storage */
+	if (pgBufferUsage.shared_blks_read + pgBufferUsage.local_blks_read != reads)
+		stream->distance = Min(stream->distance * 2, stream->max_distance);
+	else
+		stream->distance = Max(stream->distance / 2, 1);
+
+	stream->nbuffers = n;
+	stream->next = 1;
+
+	return stream->buffers[0];
+}
+
+/*
+ * ReadStreamReset -- release any buffers read ahead, and restart the stream
+ *
+ * After this, the next ReadStreamNextBuffer call consults the callback again,
+ * even if it had previously ended the stream.
+ */
+void
+ReadStreamReset(ReadStream *stream)
+{
+	while (stream->next < stream->nbuffers)
+		ReleaseBuffer(stream->buffers[stream->next++]);
+	stream->next = stream->nbuffers = 0;
+	stream->pending_blkno = InvalidBlockNumber;
+	stream->finished = false;
+	stream->distance = 1;
+}
+
+/*
+ * ReadStreamEnd -- release any buffers read ahead, and free the stream
+ */
+void
+ReadStreamEnd(ReadStream *stream)
+{
+	ReadStreamReset(stream);
+	pfree(stream);
+}
+
 /*
  * ReadRecentBuffer -- try to pin a block in a recently observed buffer
  *
@@ -807,6 +1165,8 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	bool		found;
 	bool		isExtend;
 	bool		isLocalBuf = SmgrIsTemp(smgr);
+	IOObject	io_object;
+	IOContext	io_context;
 
 	*hit = false;
 
@@ -837,6 +1197,9 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
+		io_object = IOOBJECT_TEMP_RELATION;
+		io_context = IOCONTEXT_NORMAL;
+
 		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
@@ -848,6 +1211,9 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	}
 	else
 	{
+		io_object = IOOBJECT_RELATION;
+		io_context = IOContextForStrategy(strategy);
+
 		/*
 		 * lookup the buffer.  IO_IN_PROGRESS is set if the requested block is
 		 * not currently in memory.
@@ -863,6 +1229,14 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			pgBufferUsage.shared_blks_read++;
 	}
 
+	if (found)
+		pgstat_count_io_op(io_object, io_context, IOOP_HIT, 1);
+	else if (isExtend)
+		pgstat_count_io_op(io_object, io_context, IOOP_EXTEND, 1);
+	else if (mode == RBM_NORMAL || mode == RBM_NORMAL_NO_LOG ||
+			 mode == RBM_ZERO_ON_ERROR)
+		pgstat_count_io_op(io_object, io_context, IOOP_READ, 1);
+
 	/* At this point we do NOT hold any locks. */
 
 	/* if it was already in the buffer pool, we're done */
@@ -1007,6 +1381,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				INSTR_TIME_SET_CURRENT(io_time);
 				INSTR_TIME_SUBTRACT(io_time, io_start);
 				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+				pgstat_count_io_time(io_object, io_context, IOOP_READ, io_time);
 				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
 			}
 
@@ -1078,6 +1453,167 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	return BufferDescriptorGetBuffer(bufHdr);
 }
 
+/*
+ * ReadBufferRange -- read nblocks consecutive blocks into shared buffers
+ *
+ * This is the multi-block equivalent of ReadBufferExtended in RBM_NORMAL
+ * mode: on return buffers[] holds a pinned, valid buffer for each block.
+ * Blocks that are not already cached are read with as few vectored reads as
+ * possible; a cached block in the middle of the range splits it.
+ *
+ * We hold I/O-in-progress on all the buffers of a run while allocating the
+ * next one.  That can't deadlock against another backend doing the same,
+ * because both acquire them in increasing block number order.
+ */
+static void
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber firstBlock,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr = RelationGetSmgr(reln);
+	IOContext	io_context = IOContextForStrategy(strategy);
+	BufferDesc *run[MAX_BUFFERS_PER_READ];
+	int			nrun = 0;
+
+	Assert(nblocks > 0 && nblocks <= MAX_BUFFERS_PER_READ);
+	Assert(!RelationUsesLocalBuffers(reln));
+
+	for (int i = 0; i < nblocks; i++)
+	{
+		BlockNumber blockNum = firstBlock + i;
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blockNum,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+							 blockNum, strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (found)
+		{
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_HIT, 1);
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum,
+											  smgr->smgr_rnode.node.spcNode,
+											  smgr->smgr_rnode.node.dbNode,
+											  smgr->smgr_rnode.node.relNode,
+											  smgr->smgr_rnode.backend,
+											  false,
+											  true);
+
+			/* a hit ends the current run of misses */
+			if (nrun > 0)
+			{
+				CompleteReadRange(smgr, forkNum, run, nrun, io_context);
+				nrun = 0;
+			}
+		}
+		else
+		{
+			/* IO_IN_PROGRESS is set; read it along with its neighbors */
+			pgBufferUsage.shared_blks_read++;
+			run[nrun++] = bufHdr;
+		}
+	}
+
+	if (nrun > 0)
+		CompleteReadRange(smgr, forkNum, run, nrun, io_context);
+}
+
+/*
+ * CompleteReadRange -- subroutine for ReadBufferRange
+ *
+ * Reads the consecutive blocks of the nrun buffers in run[], all of which we
+ * have I/O in progress on, verifies them, and marks them valid.  io_context
+ * is the I/O statistics context of the caller's strategy.
+ */
+static void
+CompleteReadRange(SMgrRelation smgr, ForkNumber forkNum, BufferDesc **run,
+				  int nrun, IOContext io_context)
+{
+	char	   *pages[MAX_BUFFERS_PER_READ];
+	BlockNumber firstBlock = run[0]->tag.blockNum;
+	instr_time	io_start,
+				io_time;
+
+	for (int i = 0; i < nrun; i++)
+	{
+		Assert(run[i]->tag.blockNum == firstBlock + i);
+		pages[i] = (char *) BufHdrGetBlock(run[i]);
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrreadv(smgr, forkNum, firstBlock, pages, nrun);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_READ,
+							 io_time);
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+	pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_READ, nrun);
+
+	for (int i = 0; i < nrun; i++)
+	{
+		BlockNumber blockNum = firstBlock + i;
+
+		/* check for garbage data */
+		if (!PageIsVerifiedExtended((Page) pages[i], blockNum,
+									PIV_LOG_WARNING | PIV_REPORT_STAT))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(pages[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(run[i], false, BM_VALID);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  false);
+	}
+}
+
 /*
  * BufferAlloc -- subroutine for ReadBuffer.  Handles lookup of a shared
  *		buffer.  If no buffer exists already, selects a replacement
@@ -1122,6 +1658,35 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First try to find the block without taking the mapping lock.  This is
+	 * a win for workloads with lots of buffer hits, because it avoids
+	 * bouncing the partition lock's cache line between CPUs.  As we don't
+	 * hold the lock, the buffer could get reassigned before we pin it, so
+	 * recheck its tag afterwards; once pinned it can't change anymore.
+	 */
+	buf_id = BufTableLookupOptimistic(&newTag, newHash);
+	if (buf_id >= 0)
+	{
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer(buf, strategy);
+
+		if (BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			*foundPtr = true;
+
+			/* see below */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = false;
+
+			return buf;
+		}
+
+		/* lost a race against eviction, do it the hard way */
+		UnpinBuffer(buf, true);
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1251,7 +1816,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, IOContextForStrategy(strategy));
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
@@ -1944,6 +2509,7 @@ BufferSync(int flags)
 	int			i;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
+	CkptWriteBatch batch;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -2116,48 +2682,79 @@ BufferSync(int flags)
 	 */
 	num_processed = 0;
 	num_written = 0;
+	batch.wb_context = &wb_context;
+	batch.nbufs = 0;
 	while (!binaryheap_empty(ts_heap))
 	{
-		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
-
-		buf_id = CkptBufferIds[ts_stat->index].buf_id;
-		Assert(buf_id != -1);
-
-		bufHdr = GetBufferDescriptor(buf_id);
-
-		num_processed++;
+		int			nrun;
 
 		/*
-		 * We don't need to acquire the lock here, because we're only looking
-		 * at a single bit. It's possible that someone else writes the buffer
-		 * and clears the flag right after we check, but that doesn't matter
-		 * since SyncOneBuffer will then do nothing.  However, there is a
-		 * further race condition: it's conceivable that between the time we
-		 * examine the bit here and the time SyncOneBuffer acquires the lock,
-		 * someone else not only wrote the buffer but replaced it with another
-		 * page and dirtied it.  In that improbable case, SyncOneBuffer will
-		 * write the buffer though we didn't need to.  It doesn't seem worth
-		 * guarding against this, though.
+		 * Take a run of consecutive blocks of one relation fork from this
+		 * tablespace, so that they can be written with a single vectored
+		 * write.  Runs are short enough that balancing between tablespaces
+		 * still works.
 		 */
-		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
+		nrun = 1;
+		while (nrun < MAX_BUFFERS_PER_WRITE &&
+			   ts_stat->num_scanned + nrun < ts_stat->num_to_scan)
+		{
+			CkptSortItem *prev = &CkptBufferIds[ts_stat->index + nrun - 1];
+			CkptSortItem *cur = &CkptBufferIds[ts_stat->index + nrun];
+
+			if (cur->relNode != prev->relNode ||
+				cur->forkNum != prev->forkNum ||
+				cur->blockNum != prev->blockNum + 1)
+				break;
+			nrun++;
+		}
+
+		for (i = 0; i < nrun; i++)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			BufferDesc *bufHdr;
+
+			buf_id = CkptBufferIds[ts_stat->index + i].buf_id;
+			Assert(buf_id != -1);
+
+			bufHdr = GetBufferDescriptor(buf_id);
+
+			/*
+			 * We don't need to acquire the lock here, because we're only
+			 * looking at a single bit. It's possible that someone else writes
+			 * the buffer and clears the flag right after we check, but that
+			 * doesn't matter since CkptBatchAddBuffer will then do nothing.
+			 * However, there is a further race condition: it's conceivable
+			 * that between the time we examine the bit here and the time
+			 * CkptBatchAddBuffer acquires the lock, someone else not only
+			 * wrote the buffer but replaced it with another page and dirtied
+			 * it.  In that improbable case, we will write the buffer though
+			 * we didn't need to.  It doesn't seem worth guarding against
+			 * this, though.
+			 */
+			if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				PendingCheckpointerStats.m_buf_written_checkpoints++;
-				num_written++;
+				if (CkptBatchAddBuffer(&batch, buf_id))
+				{
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
+					PendingCheckpointerStats.m_buf_written_checkpoints++;
+					num_written++;
+				}
 			}
 		}
 
+		/* write out the run before we might sleep */
+		CkptBatchFlush(&batch);
+
+		num_processed += nrun;
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * nrun;
+		ts_stat->num_scanned += nrun;
+		ts_stat->index += nrun;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2244,6 +2841,8 @@ BgBufferSync(WritebackContext *wb_context)
 	int			num_to_scan;
 	int			num_written;
 	int			reusable_buffers;
+	int			free_buf_ids[64];
+	int			num_free = 0;
 
 	/* Variables for final smoothed_density update */
 	long		new_strategy_delta;
@@ -2428,11 +3027,27 @@ BgBufferSync(WritebackContext *wb_context)
 	num_written = 0;
 	reusable_buffers = reusable_buffers_est;
 
-	/* Execute the LRU scan */
+	/*
+	 * Execute the LRU scan.  Buffers found to be clean and unused, or that
+	 * we cleaned, are put on the freelist, so that backends needing a buffer
+	 * can usually take one from there rather than running the clock sweep.
+	 * They remain valid until reused, and StrategyGetBuffer rechecks that
+	 * they're still unused.
+	 */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		int			buf_id = next_to_clean;
+		int			sync_state = SyncOneBuffer(buf_id, true, wb_context);
+
+		if (sync_state & BUF_REUSABLE)
+		{
+			free_buf_ids[num_free++] = buf_id;
+			if (num_free == lengthof(free_buf_ids))
+			{
+				StrategyFreeBuffers(free_buf_ids, num_free);
+				num_free = 0;
+			}
+		}
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -2454,6 +3069,9 @@ BgBufferSync(WritebackContext *wb_context)
 			reusable_buffers++;
 	}
 
+	if (num_free > 0)
+		StrategyFreeBuffers(free_buf_ids, num_free);
+
 	PendingBgWriterStats.m_buf_written_clean += num_written;
 
 #ifdef BGW_DEBUG
@@ -2555,7 +3173,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2568,6 +3186,253 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * CkptBatchAddBuffer -- BufferSync's version of SyncOneBuffer
+ *
+ * If the buffer is dirty, pin and share-lock it and start output I/O on it,
+ * then append it to the batch.  If it doesn't directly follow the batch's
+ * last block, the batch is written out first.
+ *
+ * Only the first buffer of a batch is locked unconditionally: while holding
+ * content locks on the earlier ones, waiting for another could deadlock
+ * against a backend that locks pages in a different order (e.g. a btree
+ * split locking a child page before its parent).  If the conditional lock
+ * fails, we write what we have and then wait.
+ *
+ * Returns true if the buffer was dirty, like BUF_WRITTEN from SyncOneBuffer.
+ */
+static bool
+CkptBatchAddBuffer(CkptWriteBatch *batch, int buf_id)
+{
+	BufferDesc *bufHdr = GetBufferDescriptor(buf_id);
+	uint32		buf_state;
+
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+	ReservePrivateRefCountEntry();
+
+	buf_state = LockBufHdr(bufHdr);
+
+	if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+	{
+		/* It's clean, so nothing to do */
+		UnlockBufHdr(bufHdr, buf_state);
+		return false;
+	}
+
+	if (batch->nbufs > 0)
+	{
+		BufferDesc *last = batch->bufs[batch->nbufs - 1];
+
+		if (!RelFileNodeEquals(bufHdr->tag.rnode, last->tag.rnode) ||
+			bufHdr->tag.forkNum != last->tag.forkNum ||
+			bufHdr->tag.blockNum != last->tag.blockNum + 1)
+		{
+			/* a different run, so start a new batch */
+			PinBuffer_Locked(bufHdr);
+			CkptBatchFlush(batch);
+			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+		}
+		else
+		{
+			PinBuffer_Locked(bufHdr);
+			if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+										  LW_SHARED))
+			{
+				CkptBatchFlush(batch);
+				LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+			}
+		}
+	}
+	else
+	{
+		PinBuffer_Locked(bufHdr);
+		LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+	}
+
+	/*
+	 * Don't wait for somebody else's I/O while holding I/O on the batch's
+	 * buffers.
+	 */
+	if (batch->nbufs > 0 &&
+		(pg_atomic_read_u32(&bufHdr->state) & BM_IO_IN_PROGRESS))
+		CkptBatchFlush(batch);
+
+	/*
+	 * If StartBufferIO returns false, someone else flushed the buffer before
+	 * we could, so we need not do anything.
+	 */
+	if (!StartBufferIO(bufHdr, false))
+	{
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr, true);
+		return true;
+	}
+
+	batch->bufs[batch->nbufs++] = bufHdr;
+	if (batch->nbufs == MAX_BUFFERS_PER_WRITE)
+		CkptBatchFlush(batch);
+
+	return true;
+}
+
+/*
+ * CkptBatchFlush -- write out the buffers collected by CkptBatchAddBuffer
+ *
+ * This is FlushBuffer for a run of buffers: the WAL is flushed once up to
+ * the highest LSN among them, and the pages are written with one smgrwritev
+ * call.  Afterwards, the buffers are unlocked and unpinned, and writeback is
+ * scheduled for them.
+ */
+static void
+CkptBatchFlush(CkptWriteBatch *batch)
+{
+	BufferDesc *first;
+	SMgrRelation reln;
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+	char	   *pages[MAX_BUFFERS_PER_WRITE];
+	int			dwslots[MAX_BUFFERS_PER_WRITE];
+	bool		double_write = false;
+	XLogRecPtr	max_lsn = InvalidXLogRecPtr;
+	bool		need_xlog_flush = false;
+
+	StaticAssertStmt(MAX_BUFFERS_PER_WRITE <= DOUBLE_WRITE_MAX_PAGES,
+					 "a write batch must fit in the double-write buffer");
+
+	if (batch->nbufs == 0)
+		return;
+
+	first = batch->bufs[0];
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) first;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(first->tag.rnode, InvalidBackendId);
+
+	for (int i = 0; i < batch->nbufs; i++)
+	{
+		BufferDesc *buf = batch->bufs[i];
+		XLogRecPtr	recptr;
+		uint32		buf_state;
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
+											buf->tag.blockNum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode);
+
+		/* see FlushBuffer */
+		buf_state = LockBufHdr(buf);
+		recptr = BufferGetLSN(buf);
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(buf, buf_state);
+
+		if (buf_state & BM_PERMANENT)
+		{
+			need_xlog_flush = true;
+			if (recptr > max_lsn)
+				max_lsn = recptr;
+		}
+	}
+
+	/* WAL before data, as in FlushBuffer */
+	if (need_xlog_flush)
+		XLogFlush(max_lsn);
+
+	/*
+	 * With checksums, copy each page to private storage before setting the
+	 * checksum, since hint bits can change under a share lock.  There's one
+	 * copy per batch slot, rather than PageSetChecksumCopy's single one.
+	 */
+	if (DataChecksumsEnabled() && CkptWriteCopies == NULL)
+		CkptWriteCopies = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 MAX_BUFFERS_PER_WRITE * BLCKSZ +
+										 PG_IO_ALIGN_SIZE));
+
+	for (int i = 0; i < batch->nbufs; i++)
+	{
+		BufferDesc *buf = batch->bufs[i];
+		char	   *bufBlock = (char *) BufHdrGetBlock(buf);
+
+		if (DataChecksumsEnabled())
+		{
+			pages[i] = CkptWriteCopies + i * BLCKSZ;
+			memcpy(pages[i], bufBlock, BLCKSZ);
+			PageSetChecksumInplace((Page) pages[i], buf->tag.blockNum);
+		}
+		else
+			pages[i] = bufBlock;
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	/* see FlushBuffer; the buffers of a relation are all permanent or not */
+	if (need_xlog_flush && DoubleWriteActive())
+	{
+		DoubleWritePages(first->tag.rnode, first->tag.forkNum,
+						 first->tag.blockNum, pages, batch->nbufs, dwslots);
+		double_write = true;
+	}
+
+	smgrwritev(reln, first->tag.forkNum, first->tag.blockNum, pages,
+			   batch->nbufs, false);
+
+	if (double_write)
+		DoubleWriteRelease(dwslots, batch->nbufs);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		pgstat_count_io_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_WRITE,
+							 io_time);
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += batch->nbufs;
+	pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_WRITE,
+					   batch->nbufs);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	for (int i = 0; i < batch->nbufs; i++)
+	{
+		BufferDesc *buf = batch->bufs[i];
+		BufferTag	tag;
+
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set)
+		 * and end the BM_IO_IN_PROGRESS state.
+		 */
+		TerminateBufferIO(buf, true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
+										   buf->tag.blockNum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode);
+
+		LWLockRelease(BufferDescriptorGetContentLock(buf));
+
+		tag = buf->tag;
+
+		UnpinBuffer(buf, true);
+
+		ScheduleBufferTagForWriteback(batch->wb_context, &tag);
+	}
+
+	batch->nbufs = 0;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2802,10 +3667,11 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  io_context is the context
+ * the write is counted under in the I/O statistics.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOContext io_context)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcallback;
@@ -2814,6 +3680,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	Block		bufBlock;
 	char	   *bufToWrite;
 	uint32		buf_state;
+	int			dwslot = -1;
 
 	/*
 	 * Try to start an I/O operation.  If StartBufferIO returns false, then
@@ -2888,6 +3755,15 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	if (track_io_timing)
 		INSTR_TIME_SET_CURRENT(io_start);
 
+	/*
+	 * If the double-write buffer is in use, save the page there first, so
+	 * that crash recovery can repair the block if the write below is torn.
+	 * Like the WAL flush, this isn't needed for non-permanent relations.
+	 */
+	if ((buf_state & BM_PERMANENT) && DoubleWriteActive())
+		DoubleWritePages(buf->tag.rnode, buf->tag.forkNum, buf->tag.blockNum,
+						 &bufToWrite, 1, &dwslot);
+
 	/*
 	 * bufToWrite is either the shared buffer or a copy, as appropriate.
 	 */
@@ -2897,15 +3773,21 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 			  bufToWrite,
 			  false);
 
+	if (dwslot >= 0)
+		DoubleWriteRelease(&dwslot, 1);
+
 	if (track_io_timing)
 	{
 		INSTR_TIME_SET_CURRENT(io_time);
 		INSTR_TIME_SUBTRACT(io_time, io_start);
 		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_WRITE,
+							 io_time);
 		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
 	}
 
 	pgBufferUsage.shared_blks_written++;
+	pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_WRITE, 1);
 
 	/*
 	 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
@@ -2998,6 +3880,30 @@ BufferIsPermanent(Buffer buffer)
 	return (pg_atomic_read_u32(&bufHdr->state) & BM_PERMANENT) != 0;
 }
 
+/*
+ * BufferIsDirty
+ *		Determines whether a buffer is marked dirty.  Caller must hold a
+ *		buffer pin.
+ *
+ * Without a lock on the buffer, the result can be out of date by the time
+ * the caller looks at it, so it can only be used as a hint.
+ */
+bool
+BufferIsDirty(Buffer buffer)
+{
+	BufferDesc *bufHdr;
+
+	Assert(BufferIsValid(buffer));
+	Assert(BufferIsPinned(buffer));
+
+	if (BufferIsLocal(buffer))
+		bufHdr = GetLocalBufferDescriptor(-buffer - 1);
+	else
+		bufHdr = GetBufferDescriptor(buffer - 1);
+
+	return (pg_atomic_read_u32(&bufHdr->state) & BM_DIRTY) != 0;
+}
+
 /*
  * BufferGetLSNAtomic
  *		Retrieves the LSN of the buffer atomically using a buffer header lock.
@@ -3543,6 +4449,8 @@ FlushRelationBuffers(Relation rel)
 						  bufHdr->tag.blockNum,
 						  localpage,
 						  false);
+				pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+								   IOOP_WRITE, 1);
 
 				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
@@ -3579,7 +4487,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, RelationGetSmgr(rel));
+			FlushBuffer(bufHdr, RelationGetSmgr(rel), IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3675,7 +4583,7 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3731,7 +4639,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3758,7 +4666,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 }
 
 /*
@@ -4375,7 +5283,7 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is not already executing IO on this buffer
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
@@ -4395,7 +5303,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_IO);
 
 	for (;;)
 	{
@@ -4419,8 +5327,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	InProgressIsForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -4445,8 +5354,21 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	/* forget it; usually it's the most recently started one */
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
+	NumInProgressBufs--;
+	for (; i < NumInProgressBufs; i++)
+	{
+		InProgressBufs[i] = InProgressBufs[i + 1];
+		InProgressIsForInput[i] = InProgressIsForInput[i + 1];
+	}
 
 	buf_state = LockBufHdr(buf);
 
@@ -4459,8 +5381,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
-
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
 
@@ -4468,7 +5388,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
+ *	There can be several buffers with I/O in progress if we failed in the
+ *	middle of a multi-block read.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -4476,15 +5398,14 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (InProgressIsForInput[NumInProgressBufs - 1])
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -4513,6 +5434,9 @@ AbortBufferIO(void)
 		}
 		TerminateBufferIO(buf, false, BM_IO_ERROR);
 	}
+
+	/* Release double-write slots of writes that didn't finish, if any */
+	AbortDoubleWrite();
 }
 
 /*
@@ -0,0 +1,676 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.c
+ *	  Double-write buffer for protecting data pages against torn writes.
+ *
+ * A data page write that is in progress when the operating system crashes
+ * might be only partially completed.  Normally, full_page_writes protects
+ * against that by logging a full image of each page in WAL on its first
+ * modification after a checkpoint.  As an alternative, the double-write
+ * buffer saves a copy of every page in a separate file, pg_doublewrite,
+ * and fsyncs it before the page is written to its relation file.  If the
+ * in-place write is torn, recovery finds an intact copy of the page in
+ * pg_doublewrite and puts it back before WAL replay starts.
+ *
+ * pg_doublewrite is a ring of double_write_buffer_size slots, each holding
+ * a header and a page.  A slot cannot be reused until the in-place write
+ * it protects is known to be durable.  Each in-place write is stamped with
+ * the "cycle" current when it finished; a checkpoint starts a new cycle
+ * before it fsyncs the relation files, and advances durableCycle once the
+ * fsyncs are done.  A process that needs a slot that isn't durable yet
+ * fsyncs the relation fork itself, which should be rare if the buffer is
+ * big enough to hold the writes of a checkpoint cycle.
+ *
+ * Concurrent writers share fsyncs of pg_doublewrite: a process that wants
+ * its double-writes flushed waits for an fsync that started after them,
+ * much like XLogFlush() waits for WAL to be flushed.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/doublewrite.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/relpath.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "port/pg_crc32c.h"
+#include "port/pg_iovec.h"
+#include "storage/buf_internals.h"
+#include "storage/bufpage.h"
+#include "storage/doublewrite.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+
+/*
+ * On-disk header of a double-write slot.  The page follows it.
+ */
+typedef struct DoubleWriteHeader
+{
+	uint32		magic;
+	pg_crc32c	crc;			/* CRC of the rest of the header and the page */
+	uint64		seq;			/* orders writes of the same block */
+	BufferTag	tag;			/* block the page belongs to */
+} DoubleWriteHeader;
+
+#define DOUBLE_WRITE_MAGIC		0x44570001
+#define DOUBLE_WRITE_SLOT_SIZE	(sizeof(DoubleWriteHeader) + BLCKSZ)
+
+/* slot state of a slot whose in-place write hasn't finished */
+#define DW_SLOT_IN_USE			PG_UINT64_MAX
+
+/* skip this many slots that aren't durable yet before fsyncing one */
+#define DW_PROBE_LIMIT			8
+
+typedef struct DoubleWriteSlot
+{
+	/*
+	 * 0 if never used, DW_SLOT_IN_USE while the in-place write is going on,
+	 * else the cycle in which the in-place write finished.
+	 */
+	pg_atomic_uint64 state;
+	BufferTag	tag;			/* protected by owning the slot */
+} DoubleWriteSlot;
+
+typedef struct DoubleWriteCtlData
+{
+	pg_atomic_uint32 ready;		/* has pg_doublewrite been set up? */
+	pg_atomic_uint64 nextSlot;	/* next slot to try, modulo the size */
+	pg_atomic_uint64 cycle;		/* current cycle */
+	pg_atomic_uint64 durableCycle;	/* in-place writes up to here are
+									 * durable */
+	pg_atomic_uint64 flushStarted;	/* number of fsyncs started */
+	pg_atomic_uint64 flushDone; /* latest fsync completed */
+	LWLock		flushLock;		/* held while fsyncing pg_doublewrite */
+	DoubleWriteSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} DoubleWriteCtlData;
+
+/* GUC parameter */
+int			double_write_buffer_size = 0;
+
+static DoubleWriteCtlData *DoubleWriteCtl = NULL;
+
+/* This process's file descriptor for pg_doublewrite */
+static File DoubleWriteFile = -1;
+
+/* Slots this process has claimed but not released yet */
+static int	HeldSlots[DOUBLE_WRITE_MAX_PAGES];
+static int	NumHeldSlots = 0;
+
+typedef struct DoubleWriteEntry
+{
+	BufferTag	tag;			/* hash key */
+	uint64		seq;
+	int			slot;
+} DoubleWriteEntry;
+
+static int	dw_claim_slot(const BufferTag *tag, uint64 *seq);
+static void dw_flush(void);
+static bool dw_read_slot(int fd, int slot, DoubleWriteHeader *hdr, char *page);
+static bool dw_page_needs_restore(Page inplace, Page copy, BlockNumber blkno);
+static void dw_restore_pages(void);
+
+
+/*
+ * Report shared-memory space needed by DoubleWriteShmemInit
+ */
+Size
+DoubleWriteShmemSize(void)
+{
+	if (double_write_buffer_size == 0)
+		return 0;
+
+	return add_size(offsetof(DoubleWriteCtlData, slots),
+					mul_size(double_write_buffer_size,
+							 sizeof(DoubleWriteSlot)));
+}
+
+/*
+ * Initialize the double-write buffer's shared state
+ */
+void
+DoubleWriteShmemInit(void)
+{
+	bool		found;
+
+	if (double_write_buffer_size == 0)
+		return;
+
+	DoubleWriteCtl = (DoubleWriteCtlData *)
+		ShmemInitStruct("Double-Write Buffer", DoubleWriteShmemSize(), &found);
+
+	if (!found)
+	{
+		pg_atomic_init_u32(&DoubleWriteCtl->ready, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->nextSlot, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->cycle, 1);
+		pg_atomic_init_u64(&DoubleWriteCtl->durableCycle, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->flushStarted, 0);
+		pg_atomic_init_u64(&DoubleWriteCtl->flushDone, 0);
+		LWLockInitialize(&DoubleWriteCtl->flushLock, LWTRANCHE_DOUBLE_WRITE);
+
+		for (int i = 0; i < double_write_buffer_size; i++)
+			pg_atomic_init_u64(&DoubleWriteCtl->slots[i].state, 0);
+	}
+}
+
+/*
+ * GUC check_hook for double_write_buffer_size
+ */
+bool
+check_double_write_buffer_size(int *newval, void **extra, GucSource source)
+{
+	/*
+	 * The checkpointer claims a slot for each page of a batch it writes, and
+	 * other processes one at a time, so a tiny buffer could run out of slots
+	 * that are not in use.
+	 */
+	if (*newval != 0 && *newval < DOUBLE_WRITE_MIN_SLOTS)
+	{
+		GUC_check_errdetail("double_write_buffer_size must be 0 or at least %d blocks.",
+							DOUBLE_WRITE_MIN_SLOTS);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Are writes of permanent buffers to go through the double-write buffer?
+ *
+ * Not until StartupDoubleWrite() has repaired any torn pages from the last
+ * crash and set up the file; in particular, not in bootstrap mode.
+ */
+bool
+DoubleWriteActive(void)
+{
+	return double_write_buffer_size > 0 &&
+		pg_atomic_read_u32(&DoubleWriteCtl->ready) != 0;
+}
+
+/*
+ * Save copies of pages about to be written in place, and fsync them.
+ *
+ * The pages are for npages consecutive blocks starting at blocknum.  On
+ * return, slots[] holds the slot used for each page.  The caller must pass
+ * them to DoubleWriteRelease() once the in-place writes are done.
+ *
+ * The pages must be exactly what is going to be written, with the checksum
+ * set, and WAL must already have been flushed up to their LSNs.
+ */
+void
+DoubleWritePages(RelFileNode rnode, ForkNumber forknum, BlockNumber blocknum,
+				 char **pages, int npages, int *slots)
+{
+	Assert(NumHeldSlots + npages <= DOUBLE_WRITE_MAX_PAGES);
+
+	if (DoubleWriteFile < 0)
+	{
+		DoubleWriteFile = PathNameOpenFile(DOUBLE_WRITE_FILE,
+										   O_RDWR | PG_BINARY);
+		if (DoubleWriteFile < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+	}
+
+	for (int i = 0; i < npages; i++)
+	{
+		DoubleWriteHeader hdr;
+		struct iovec iov[2];
+		int			nbytes;
+
+		/* zero the padding too, since it's covered by the CRC */
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = DOUBLE_WRITE_MAGIC;
+		INIT_BUFFERTAG(hdr.tag, rnode, forknum, blocknum + i);
+
+		slots[i] = dw_claim_slot(&hdr.tag, &hdr.seq);
+
+		INIT_CRC32C(hdr.crc);
+		COMP_CRC32C(hdr.crc, (char *) &hdr + offsetof(DoubleWriteHeader, seq),
+					sizeof(hdr) - offsetof(DoubleWriteHeader, seq));
+		COMP_CRC32C(hdr.crc, pages[i], BLCKSZ);
+		FIN_CRC32C(hdr.crc);
+
+		iov[0].iov_base = (char *) &hdr;
+		iov[0].iov_len = sizeof(hdr);
+		iov[1].iov_base = pages[i];
+		iov[1].iov_len = BLCKSZ;
+
+		nbytes = FileWriteV(DoubleWriteFile, iov, 2,
+							(off_t) slots[i] * DOUBLE_WRITE_SLOT_SIZE,
+							WAIT_EVENT_DOUBLE_WRITE_WRITE);
+		if (nbytes != DOUBLE_WRITE_SLOT_SIZE)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write to file \"%s\": %m",
+								DOUBLE_WRITE_FILE)));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write to file \"%s\": wrote only %d of %d bytes",
+							DOUBLE_WRITE_FILE,
+							nbytes, (int) DOUBLE_WRITE_SLOT_SIZE),
+					 errhint("Check free disk space.")));
+		}
+	}
+
+	dw_flush();
+}
+
+/*
+ * Release slots claimed by DoubleWritePages(), after the in-place writes
+ * of their pages have been done (though not necessarily fsync'd).
+ */
+void
+DoubleWriteRelease(int *slots, int nslots)
+{
+	uint64		cycle;
+
+	/*
+	 * The in-place writes have queued their fsync requests for the
+	 * checkpointer by now.  Read the cycle only after that: if the
+	 * checkpoint that ends this cycle has already started processing fsync
+	 * requests, it might have missed ours.
+	 */
+	pg_memory_barrier();
+	cycle = pg_atomic_read_u64(&DoubleWriteCtl->cycle);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		pg_atomic_write_u64(&DoubleWriteCtl->slots[slots[i]].state, cycle);
+
+		for (int j = 0; j < NumHeldSlots; j++)
+		{
+			if (HeldSlots[j] == slots[i])
+			{
+				HeldSlots[j] = HeldSlots[--NumHeldSlots];
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Release the slots of in-place writes that failed, during error recovery.
+ *
+ * The failed write might have changed the relation file partially, so the
+ * slots are treated like those of completed writes: they're kept until the
+ * relation files have been fsync'd.
+ */
+void
+AbortDoubleWrite(void)
+{
+	while (NumHeldSlots > 0)
+		DoubleWriteRelease(&HeldSlots[NumHeldSlots - 1], 1);
+}
+
+/*
+ * Start a new cycle, before fsyncing the relation files at a checkpoint.
+ *
+ * Returns the cycle that ended, to be passed to DoubleWriteEndSync() when
+ * the fsyncs are done.
+ */
+uint64
+DoubleWriteStartSync(void)
+{
+	if (double_write_buffer_size == 0)
+		return 0;
+
+	return pg_atomic_fetch_add_u64(&DoubleWriteCtl->cycle, 1);
+}
+
+/*
+ * Mark the in-place writes of the given cycle and earlier as durable, making
+ * their slots available for reuse.
+ */
+void
+DoubleWriteEndSync(uint64 cycle)
+{
+	if (double_write_buffer_size == 0)
+		return;
+
+	pg_atomic_write_u64(&DoubleWriteCtl->durableCycle, cycle);
+}
+
+/*
+ * Claim a slot for a page of the given block.
+ *
+ * Returns the slot number, and sets *seq to a number that is higher than
+ * that of any earlier write of the same block.
+ */
+static int
+dw_claim_slot(const BufferTag *tag, uint64 *seq)
+{
+	int			nslots = double_write_buffer_size;
+	int			tries = 0;
+
+	for (;;)
+	{
+		uint64		pos = pg_atomic_fetch_add_u64(&DoubleWriteCtl->nextSlot, 1);
+		DoubleWriteSlot *slot = &DoubleWriteCtl->slots[pos % nslots];
+		uint64		state = pg_atomic_read_u64(&slot->state);
+		bool		durable;
+
+		if (state == DW_SLOT_IN_USE)
+		{
+			/* every slot is being written right now; wait a bit */
+			if (++tries >= nslots)
+			{
+				pg_usleep(1000L);
+				tries = 0;
+			}
+			continue;
+		}
+
+		durable = state <= pg_atomic_read_u64(&DoubleWriteCtl->durableCycle);
+		if (!durable && ++tries < DW_PROBE_LIMIT)
+			continue;
+
+		if (!pg_atomic_compare_exchange_u64(&slot->state, &state,
+											DW_SLOT_IN_USE))
+			continue;
+
+		HeldSlots[NumHeldSlots++] = pos % nslots;
+
+		/*
+		 * If the in-place write protected by this slot might not be on disk
+		 * yet, make it so.  There's nothing to do if the relation has been
+		 * dropped since.
+		 */
+		if (!durable)
+		{
+			SMgrRelation reln = smgropen(slot->tag.rnode, InvalidBackendId);
+
+			if (smgrexists(reln, slot->tag.forkNum))
+				smgrimmedsync(reln, slot->tag.forkNum);
+		}
+
+		slot->tag = *tag;
+		*seq = pos;
+		return pos % nslots;
+	}
+}
+
+/*
+ * Wait until all of this process's writes to pg_doublewrite are fsync'd.
+ *
+ * Any fsync of the file that starts after our writes are done covers them,
+ * no matter which process issues it.
+ */
+static void
+dw_flush(void)
+{
+	uint64		started;
+
+	pg_memory_barrier();
+	started = pg_atomic_read_u64(&DoubleWriteCtl->flushStarted);
+
+	for (;;)
+	{
+		if (pg_atomic_read_u64(&DoubleWriteCtl->flushDone) > started)
+			break;
+
+		/*
+		 * If another process is fsyncing the file, wait for it, then check
+		 * whether its fsync was late enough to cover our writes.
+		 */
+		if (!LWLockAcquireOrWait(&DoubleWriteCtl->flushLock, LW_EXCLUSIVE))
+			continue;
+
+		if (pg_atomic_read_u64(&DoubleWriteCtl->flushDone) <= started)
+		{
+			uint64		flush;
+
+			flush = pg_atomic_add_fetch_u64(&DoubleWriteCtl->flushStarted, 1);
+			if (FileSync(DoubleWriteFile, WAIT_EVENT_DOUBLE_WRITE_SYNC) < 0)
+				ereport(data_sync_elevel(ERROR),
+						(errcode_for_file_access(),
+						 errmsg("could not fsync file \"%s\": %m",
+								DOUBLE_WRITE_FILE)));
+			pg_atomic_write_u64(&DoubleWriteCtl->flushDone, flush);
+		}
+		LWLockRelease(&DoubleWriteCtl->flushLock);
+		break;
+	}
+}
+
+/*
+ * Set up the double-write buffer at startup.
+ *
+ * If the server didn't shut down cleanly, relation pages that were being
+ * written at the time of the crash are first repaired from the copies in
+ * pg_doublewrite.  This must be done before WAL replay reads them.  Then the
+ * file is emptied, since all the in-place writes it protected are either
+ * repaired or durable (crash recovery fsyncs the data directory before
+ * anything else).
+ */
+void
+StartupDoubleWrite(bool recovery)
+{
+	int			fd;
+
+	if (recovery)
+		dw_restore_pages();
+
+	if (double_write_buffer_size == 0)
+	{
+		if (unlink(DOUBLE_WRITE_FILE) < 0 && errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+		return;
+	}
+
+	fd = OpenTransientFile(DOUBLE_WRITE_FILE, O_RDWR | O_CREAT | PG_BINARY);
+	if (fd < 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+
+	/*
+	 * Truncate the file first to get rid of the old contents, then extend it
+	 * without writing anything, leaving it sparse where possible.
+	 */
+	if (ftruncate(fd, 0) < 0 ||
+		ftruncate(fd, (off_t) double_write_buffer_size * DOUBLE_WRITE_SLOT_SIZE) < 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not truncate file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+
+	if (pg_fsync(fd) != 0)
+		ereport(data_sync_elevel(FATAL),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+
+	fsync_fname(".", true);
+
+	pg_atomic_write_u32(&DoubleWriteCtl->ready, 1);
+}
+
+/*
+ * Read the given slot of pg_doublewrite.  Returns false if the slot doesn't
+ * hold a valid page, e.g. because it was never used or its write was torn.
+ */
+static bool
+dw_read_slot(int fd, int slot, DoubleWriteHeader *hdr, char *page)
+{
+	off_t		offset = (off_t) slot * DOUBLE_WRITE_SLOT_SIZE;
+	pg_crc32c	crc;
+	int			nbytes;
+
+	pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+	nbytes = pg_pread(fd, hdr, sizeof(DoubleWriteHeader), offset);
+	if (nbytes == sizeof(DoubleWriteHeader))
+		nbytes = pg_pread(fd, page, BLCKSZ, offset + sizeof(DoubleWriteHeader));
+	pgstat_report_wait_end();
+
+	if (nbytes < 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+	if (nbytes != BLCKSZ || hdr->magic != DOUBLE_WRITE_MAGIC)
+		return false;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, (char *) hdr + offsetof(DoubleWriteHeader, seq),
+				sizeof(DoubleWriteHeader) - offsetof(DoubleWriteHeader, seq));
+	COMP_CRC32C(crc, page, BLCKSZ);
+	FIN_CRC32C(crc);
+
+	return EQ_CRC32C(crc, hdr->crc);
+}
+
+/*
+ * Does the in-place page need to be replaced with the double-written copy?
+ *
+ * With data checksums, a torn page fails verification.  Without them, it
+ * might still pass the header checks, so the copy is also restored if it's
+ * at least as new as the page and differs from it.  The LSN test keeps a
+ * stale copy from replacing a later, intact write of the block.
+ */
+static bool
+dw_page_needs_restore(Page inplace, Page copy, BlockNumber blkno)
+{
+	if (!PageIsVerifiedExtended(inplace, blkno, 0))
+		return true;
+
+	/*
+	 * An all-zeroes page hasn't been written through the buffer pool since
+	 * the relation was last extended, so any copy is of an older incarnation
+	 * of the block.
+	 */
+	if (PageIsNew(inplace))
+		return false;
+
+	if (PageGetLSN(inplace) > PageGetLSN(copy))
+		return false;
+
+	return memcmp(inplace, copy, BLCKSZ) != 0;
+}
+
+/*
+ * Repair torn relation pages from the copies in pg_doublewrite.
+ *
+ * Only the newest copy of each block is considered, since writes of the
+ * same block are serialized and only the last one can have been in progress
+ * at the time of the crash.
+ */
+static void
+dw_restore_pages(void)
+{
+	int			fd;
+	struct stat st;
+	int			nslots;
+	HASHCTL		ctl;
+	HTAB	   *entries;
+	HASH_SEQ_STATUS status;
+	DoubleWriteEntry *entry;
+	DoubleWriteHeader hdr;
+	PGAlignedBlock copy;
+	PGAlignedBlock inplace;
+
+	fd = OpenTransientFile(DOUBLE_WRITE_FILE, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return;
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+	}
+
+	if (fstat(fd, &st) < 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+	nslots = st.st_size / DOUBLE_WRITE_SLOT_SIZE;
+
+	ctl.keysize = sizeof(BufferTag);
+	ctl.entrysize = sizeof(DoubleWriteEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	entries = hash_create("double-write entries", 1024, &ctl,
+						  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (int slot = 0; slot < nslots; slot++)
+	{
+		bool		found;
+
+		if (!dw_read_slot(fd, slot, &hdr, copy.data))
+			continue;
+
+		entry = hash_search(entries, &hdr.tag, HASH_ENTER, &found);
+		if (!found || hdr.seq > entry->seq)
+		{
+			entry->seq = hdr.seq;
+			entry->slot = slot;
+		}
+	}
+
+	hash_seq_init(&status, entries);
+	while ((entry = (DoubleWriteEntry *) hash_seq_search(&status)) != NULL)
+	{
+		BufferTag  *tag = &entry->tag;
+		SMgrRelation reln;
+		char	   *path;
+
+		if (!dw_read_slot(fd, entry->slot, &hdr, copy.data))
+			continue;
+
+		/* Blocks of dropped or truncated relations don't matter anymore */
+		reln = smgropen(tag->rnode, InvalidBackendId);
+		if (!smgrexists(reln, tag->forkNum) ||
+			tag->blockNum >= smgrnblocks(reln, tag->forkNum))
+			continue;
+
+		smgrread(reln, tag->forkNum, tag->blockNum, inplace.data);
+		if (!dw_page_needs_restore((Page) inplace.data, (Page) copy.data,
+								   tag->blockNum))
+			continue;
+
+		smgrwrite(reln, tag->forkNum, tag->blockNum, copy.data, true);
+		smgrimmedsync(reln, tag->forkNum);
+
+		path = relpathperm(tag->rnode, tag->forkNum);
+		ereport(LOG,
+				(errmsg("restored block %u of relation %s from the double-write buffer",
+						tag->blockNum, path)));
+		pfree(path);
+	}
+
+	hash_destroy(entries);
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(FATAL,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+}
@@ -22,6 +22,15 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * To reduce contention on the shared clock hand, each backend claims a run
+ * of up to this many consecutive clock positions at a time, and sweeps over
+ * them privately.  Likewise, up to FREELIST_BATCH_SIZE buffers are taken
+ * off the freelist per acquisition of buffer_strategy_lock.
+ */
+#define CLOCK_SWEEP_BATCH_SIZE	16
+#define FREELIST_BATCH_SIZE		8
+
 
 /*
  * The shared freelist control information.
@@ -63,6 +72,16 @@ typedef struct
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Backend-local state: the run of clock positions claimed by ClockSweepTick,
+ * as [ClockSweepNext, ClockSweepEnd) in unwrapped nextVictimBuffer values,
+ * and buffers taken off the freelist but not yet used.
+ */
+static uint32 ClockSweepNext = 0;
+static uint32 ClockSweepEnd = 0;
+static int	LocalFreeBuffers[FREELIST_BATCH_SIZE];
+static int	NumLocalFreeBuffers = 0;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -108,40 +127,53 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
  *
  * Move the clock hand one buffer ahead of its current position and return the
  * id of the buffer now under the hand.
+ *
+ * The shared hand is advanced in runs of up to CLOCK_SWEEP_BATCH_SIZE
+ * positions, which this backend then hands out one by one.  That way the
+ * atomic operation on nextVictimBuffer, which is heavily contended when many
+ * backends need to evict buffers, is only done once per run.
  */
 static inline uint32
 ClockSweepTick(void)
 {
 	uint32		victim;
+	uint32		batch;
+
+	if (ClockSweepNext != ClockSweepEnd)
+		return ClockSweepNext++ % NBuffers;
+
+	/* don't let a few backends claim a large part of a small buffer pool */
+	batch = Max(1, Min(CLOCK_SWEEP_BATCH_SIZE, NBuffers / 1024));
 
 	/*
-	 * Atomically move hand ahead one buffer - if there's several processes
-	 * doing this, this can lead to buffers being returned slightly out of
-	 * apparent order.
+	 * Atomically move hand ahead - if there's several processes doing this,
+	 * this can lead to buffers being returned slightly out of apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, batch);
 
-	if (victim >= NBuffers)
-	{
-		uint32		originalVictim = victim;
+	ClockSweepNext = victim + 1;
+	ClockSweepEnd = victim + batch;
 
-		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+	/*
+	 * If our run contains a multiple of NBuffers (other than 0), we're the
+	 * one that just caused a wraparound, so force completePasses to be
+	 * incremented while holding the spinlock.  We need the spinlock so
+	 * StrategySyncStart() can return a consistent value consisting of
+	 * nextVictimBuffer and completePasses.
+	 */
+	if (victim + batch > NBuffers)
+	{
+		uint32		nextwrap;
 
-		/*
-		 * If we're the one that just caused a wraparound, force
-		 * completePasses to be incremented while holding the spinlock. We
-		 * need the spinlock so StrategySyncStart() can return a consistent
-		 * value consisting of nextVictimBuffer and completePasses.
-		 */
-		if (victim == 0)
+		nextwrap = ((victim + NBuffers - 1) / NBuffers) * NBuffers;
+		if (nextwrap >= NBuffers && nextwrap < victim + batch)
 		{
 			uint32		expected;
 			uint32		wrapped;
 			bool		success = false;
 
-			expected = originalVictim + 1;
+			expected = victim + batch;
 
 			while (!success)
 			{
@@ -165,7 +197,9 @@ ClockSweepTick(void)
 			}
 		}
 	}
-	return victim;
+
+	/* always wrap what we look up in BufferDescriptors */
+	return victim % NBuffers;
 }
 
 /*
@@ -257,59 +291,63 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * put on the freelist but we don't see the store yet - but that's pretty
 	 * harmless, it'll just get used during the next buffer acquisition.
 	 *
-	 * If there's buffers on the freelist, acquire the spinlock to pop one
-	 * buffer of the freelist. Then check whether that buffer is usable and
-	 * repeat if not.
+	 * If there's buffers on the freelist, acquire the spinlock to pop a batch
+	 * of buffers off the freelist into LocalFreeBuffers.  Then check whether
+	 * one of those is usable and repeat if not.
 	 *
 	 * Note that the freeNext fields are considered to be protected by the
 	 * buffer_strategy_lock not the individual buffer spinlocks, so it's OK to
 	 * manipulate them without holding the spinlock.
 	 */
-	if (StrategyControl->firstFreeBuffer >= 0)
+	for (;;)
 	{
-		while (true)
+		if (NumLocalFreeBuffers == 0 && StrategyControl->firstFreeBuffer >= 0)
 		{
-			/* Acquire the spinlock to remove element from the freelist */
+			/* Acquire the spinlock to remove elements from the freelist */
 			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-			if (StrategyControl->firstFreeBuffer < 0)
+			while (NumLocalFreeBuffers < FREELIST_BATCH_SIZE &&
+				   StrategyControl->firstFreeBuffer >= 0)
 			{
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-				break;
-			}
+				buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer);
+				Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
 
-			buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer);
-			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
+				/* Unconditionally remove buffer from freelist */
+				StrategyControl->firstFreeBuffer = buf->freeNext;
+				buf->freeNext = FREENEXT_NOT_IN_LIST;
 
-			/* Unconditionally remove buffer from freelist */
-			StrategyControl->firstFreeBuffer = buf->freeNext;
-			buf->freeNext = FREENEXT_NOT_IN_LIST;
+				LocalFreeBuffers[NumLocalFreeBuffers++] = buf->buf_id;
+			}
 
 			/*
 			 * Release the lock so someone else can access the freelist while
-			 * we check out this buffer.
+			 * we check out these buffers.
 			 */
 			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+		}
 
-			/*
-			 * If the buffer is pinned or has a nonzero usage_count, we cannot
-			 * use it; discard it and retry.  (This can only happen if VACUUM
-			 * put a valid buffer in the freelist and then someone else used
-			 * it before we got to it.  It's probably impossible altogether as
-			 * of 8.3, but we'd better check anyway.)
-			 */
-			local_buf_state = LockBufHdr(buf);
-			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
-				&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
-			{
-				if (strategy != NULL)
-					AddBufferToRing(strategy, buf);
-				*buf_state = local_buf_state;
-				return buf;
-			}
-			UnlockBufHdr(buf, local_buf_state);
+		if (NumLocalFreeBuffers == 0)
+			break;
 
+		buf = GetBufferDescriptor(LocalFreeBuffers[--NumLocalFreeBuffers]);
+
+		/*
+		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
+		 * it; discard it and retry.  This can happen if VACUUM or the
+		 * bgwriter put a valid buffer in the freelist and then someone else
+		 * used it before we got to it, or if someone else took it while it
+		 * sat in our local batch.
+		 */
+		local_buf_state = LockBufHdr(buf);
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
+			&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
+		{
+			if (strategy != NULL)
+				AddBufferToRing(strategy, buf);
+			*buf_state = local_buf_state;
+			return buf;
 		}
+		UnlockBufHdr(buf, local_buf_state);
 	}
 
 	/* Nothing on the freelist, so run the "clock sweep" algorithm */
@@ -380,6 +418,34 @@ StrategyFreeBuffer(BufferDesc *buf)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategyFreeBuffers: put several buffers on the freelist
+ *
+ * Like StrategyFreeBuffer, but only acquires the spinlock once.  The buffers
+ * don't need to be invalid; the bgwriter uses this to offer buffers it knows
+ * to be clean and unused, and StrategyGetBuffer rechecks them anyway.
+ */
+void
+StrategyFreeBuffers(int *buf_ids, int nbufs)
+{
+	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferDesc *buf = GetBufferDescriptor(buf_ids[i]);
+
+		if (buf->freeNext == FREENEXT_NOT_IN_LIST)
+		{
+			buf->freeNext = StrategyControl->firstFreeBuffer;
+			if (buf->freeNext < 0)
+				StrategyControl->lastFreeBuffer = buf->buf_id;
+			StrategyControl->firstFreeBuffer = buf->buf_id;
+		}
+	}
+
+	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+}
+
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
@@ -587,6 +653,37 @@ GetAccessStrategy(BufferAccessStrategyType btype)
 	return strategy;
 }
 
+/*
+ * IOContextForStrategy -- the I/O statistics context of a strategy
+ *
+ * I/O through a ring buffer is counted separately from the rest, since the
+ * ring keeps it from competing for shared buffers.
+ */
+IOContext
+IOContextForStrategy(BufferAccessStrategy strategy)
+{
+	/* a "default" strategy is also represented by NULL */
+	if (strategy == NULL)
+		return IOCONTEXT_NORMAL;
+
+	switch (strategy->btype)
+	{
+		case BAS_NORMAL:
+			/* GetAccessStrategy never returns an object for this */
+			break;
+		case BAS_BULKREAD:
+			return IOCONTEXT_BULKREAD;
+		case BAS_BULKWRITE:
+			return IOCONTEXT_BULKWRITE;
+		case BAS_VACUUM:
+			return IOCONTEXT_VACUUM;
+	}
+
+	elog(ERROR, "unrecognized buffer access strategy: %d",
+		 (int) strategy->btype);
+	return IOCONTEXT_NORMAL;	/* keep compiler quiet */
+}
+
 /*
  * FreeAccessStrategy -- release a BufferAccessStrategy object
  *
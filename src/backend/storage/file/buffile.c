@@ -778,6 +778,40 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlocks --- initiate asynchronous read of a range of blocks
+ *
+ * This is only a hint; blocks that are past the end of the file, or in
+ * segments that don't exist, are silently skipped.  Any data still sitting
+ * in our own buffer is not affected.
+ */
+void
+BufFilePrefetchBlocks(BufFile *file, long blknum, int nblocks)
+{
+#ifdef USE_PREFETCH
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblock = blknum % BUFFILE_SEG_SIZE;
+		int			nthisfile;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		/* Don't cross a segment boundary in a single request */
+		nthisfile = (int) Min((long) nblocks, BUFFILE_SEG_SIZE - segblock);
+
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblock * BLCKSZ,
+							nthisfile * BLCKSZ,
+							WAIT_EVENT_BUFFILE_READ);
+
+		blknum += nthisfile;
+		nblocks -= nthisfile;
+	}
+#endif							/* USE_PREFETCH */
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
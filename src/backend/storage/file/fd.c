@@ -164,6 +164,10 @@ bool		data_sync_retry = false;
 /* How SyncDataDirectory() should do its job. */
 int			recovery_init_sync_method = RECOVERY_INIT_SYNC_METHOD_FSYNC;
 
+/* Which kinds of files to open with PG_O_DIRECT (GUC io_direct). */
+char	   *io_direct_string;
+int			io_direct_flags;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -2163,6 +2167,126 @@ retry:
 	return returnCode;
 }
 
+/*
+ * Like FileRead, but scatters the data into the iovcnt buffers described by
+ * iov.  Returns the total number of bytes read, which can be less than
+ * requested for the same reasons as with FileRead.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		  uint32 wait_event_info)
+{
+	int			returnCode;
+	Vfd		   *vfdP;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = pg_preadv(vfdP->fd, iov, iovcnt, offset);
+	pgstat_report_wait_end();
+
+	if (returnCode < 0)
+	{
+		/* see comments in FileRead */
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+	}
+
+	return returnCode;
+}
+
+/*
+ * Like FileWrite, but gathers the data from the iovcnt buffers described by
+ * iov.  Returns the total number of bytes written.  This does not do
+ * temp_file_limit accounting, so it must not be used on temporary files.
+ */
+int
+FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		   uint32 wait_event_info)
+{
+	int			returnCode;
+	size_t		amount = 0;
+	Vfd		   *vfdP;
+
+	Assert(FileIsValid(file));
+	Assert(!(VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT));
+
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+	for (int i = 0; i < iovcnt; i++)
+		amount += iov[i].iov_len;
+
+retry:
+	errno = 0;
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = pg_pwritev(vfdP->fd, iov, iovcnt, offset);
+	pgstat_report_wait_end();
+
+	/* if write didn't set errno, assume problem is no disk space */
+	if (returnCode != amount && errno == 0)
+		errno = ENOSPC;
+
+	if (returnCode < 0)
+	{
+		/* see comments in FileRead */
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+	}
+
+	return returnCode;
+}
+
 int
 FileWrite(File file, char *buffer, int amount, off_t offset,
 		  uint32 wait_event_info)
@@ -2328,6 +2452,51 @@ FileTruncate(File file, off_t offset, uint32 wait_event_info)
 	return returnCode;
 }
 
+/*
+ * Reserve space for "amount" bytes at "offset", extending the file if needed,
+ * without writing anything; the new space reads as zeroes.  Returns 0 on
+ * success, or -1 with errno set.  If the platform or filesystem doesn't
+ * support that, errno is EOPNOTSUPP and the caller should write zeroes
+ * instead.  Like FileWriteV, this must not be used on temporary files.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+	Assert(!(VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+
+	/* OK to retry if interrupted */
+	if (returnCode == EINTR)
+		goto retry;
+
+	/* posix_fallocate() returns the error rather than setting errno */
+	errno = (returnCode == EINVAL) ? EOPNOTSUPP : returnCode;
+	return -1;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 /*
  * Return the pathname associated with an open file.
  *
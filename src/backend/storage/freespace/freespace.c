@@ -136,6 +136,41 @@ GetPageWithFreeSpace(Relation rel, Size spaceNeeded)
 	return fsm_search(rel, min_cat);
 }
 
+/*
+ * GetPageWithFreeSpaceNear - like GetPageWithFreeSpace, but prefer the first
+ *		suitable page at or after nearPage covered by the same FSM page.
+ *
+ * Unlike GetPageWithFreeSpace, this doesn't follow or advance the FSM's
+ * shared next-slot hint, so backends searching from different places find
+ * different pages.  If there's no suitable page near nearPage, search as
+ * usual.
+ */
+BlockNumber
+GetPageWithFreeSpaceNear(Relation rel, Size spaceNeeded, BlockNumber nearPage)
+{
+	uint8		min_cat = fsm_space_needed_to_cat(spaceNeeded);
+	FSMAddress	addr;
+	uint16		slot;
+	int			search_slot = -1;
+	Buffer		buf;
+
+	/* Get the location of the FSM byte representing the heap block */
+	addr = fsm_get_location(nearPage, &slot);
+
+	buf = fsm_readbuf(rel, addr, false);
+	if (BufferIsValid(buf))
+	{
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		search_slot = fsm_search_avail_from(buf, min_cat, slot, false, false);
+		UnlockReleaseBuffer(buf);
+	}
+
+	if (search_slot != -1)
+		return fsm_get_heap_blk(addr, search_slot);
+	else
+		return fsm_search(rel, min_cat);
+}
+
 /*
  * RecordAndGetPageWithFreeSpace - update info about a page and try again.
  *
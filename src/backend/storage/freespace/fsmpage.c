@@ -157,6 +157,20 @@ fsm_get_max_avail(Page page)
 int
 fsm_search_avail(Buffer buf, uint8 minvalue, bool advancenext,
 				 bool exclusive_lock_held)
+{
+	return fsm_search_avail_from(buf, minvalue, -1, advancenext,
+								 exclusive_lock_held);
+}
+
+/*
+ * Like fsm_search_avail, but if startslot isn't -1, start the search at that
+ * slot instead of fp_next_slot, and leave fp_next_slot alone.  This returns
+ * the first suitable slot at or after startslot, wrapping around at the end
+ * of the page.
+ */
+int
+fsm_search_avail_from(Buffer buf, uint8 minvalue, int startslot,
+					  bool advancenext, bool exclusive_lock_held)
 {
 	Page		page = BufferGetPage(buf);
 	FSMPage		fsmpage = (FSMPage) PageGetContents(page);
@@ -174,11 +188,11 @@ restart:
 		return -1;
 
 	/*
-	 * Start search using fp_next_slot.  It's just a hint, so check that it's
-	 * sane.  (This also handles wrapping around when the prior call returned
-	 * the last slot on the page.)
+	 * Start search using fp_next_slot, unless told otherwise.  It's just a
+	 * hint, so check that it's sane.  (This also handles wrapping around when
+	 * the prior call returned the last slot on the page.)
 	 */
-	target = fsmpage->fp_next_slot;
+	target = (startslot >= 0) ? startslot : fsmpage->fp_next_slot;
 	if (target < 0 || target >= LeafNodesPerPage)
 		target = 0;
 	target += NonLeafNodesPerPage;
@@ -300,7 +314,8 @@ restart:
 	 *
 	 * Wrap-around is handled at the beginning of this function.
 	 */
-	fsmpage->fp_next_slot = slot + (advancenext ? 1 : 0);
+	if (startslot < 0)
+		fsmpage->fp_next_slot = slot + (advancenext ? 1 : 0);
 
 	return slot;
 }
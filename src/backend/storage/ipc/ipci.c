@@ -16,25 +16,31 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/syncscan.h"
 #include "access/twophase.h"
+#include "access/xlogprefetch.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "replication/logicallauncher.h"
 #include "replication/origin.h"
 #include "replication/slot.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
@@ -44,7 +50,12 @@
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/spin.h"
+#include "utils/backend_profile.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -119,15 +130,18 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, PredicateLockShmemSize());
 	size = add_size(size, ProcGlobalShmemSize());
 	size = add_size(size, XLOGShmemSize());
+	size = add_size(size, XLogPrefetchShmemSize());
 	size = add_size(size, CLOGShmemSize());
 	size = add_size(size, CommitTsShmemSize());
 	size = add_size(size, SUBTRANSShmemSize());
+	size = add_size(size, CSNLogShmemSize());
 	size = add_size(size, TwoPhaseShmemSize());
 	size = add_size(size, BackgroundWorkerShmemSize());
 	size = add_size(size, MultiXactShmemSize());
 	size = add_size(size, LWLockShmemSize());
 	size = add_size(size, ProcArrayShmemSize());
 	size = add_size(size, BackendStatusShmemSize());
+	size = add_size(size, BackendProfileShmemSize());
 	size = add_size(size, SInvalShmemSize());
 	size = add_size(size, PMSignalShmemSize());
 	size = add_size(size, ProcSignalShmemSize());
@@ -139,10 +153,19 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, WalRcvShmemSize());
 	size = add_size(size, PgArchShmemSize());
 	size = add_size(size, ApplyLauncherShmemSize());
+	size = add_size(size, ProxyShmemSize());
 	size = add_size(size, SnapMgrShmemSize());
 	size = add_size(size, BTreeShmemSize());
+	size = add_size(size, ParallelWorkerPoolShmemSize());
 	size = add_size(size, SyncScanShmemSize());
 	size = add_size(size, AsyncShmemSize());
+	size = add_size(size, PgStatShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
+	size = add_size(size, SharedPlanCacheShmemSize());
+	size = add_size(size, SharedResultCacheShmemSize());
+	size = add_size(size, SequenceCacheShmemSize());
+	size = add_size(size, SmgrShmemSize());
+	size = add_size(size, DoubleWriteShmemSize());
 #ifdef EXEC_BACKEND
 	size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -241,9 +264,11 @@ CreateSharedMemoryAndSemaphores(void)
 	 * Set up xlog, clog, and buffers
 	 */
 	XLOGShmemInit();
+	XLogPrefetchShmemInit();
 	CLOGShmemInit();
 	CommitTsShmemInit();
 	SUBTRANSShmemInit();
+	CSNLogShmemInit();
 	MultiXactShmemInit();
 	InitBufferPool();
 
@@ -264,6 +289,7 @@ CreateSharedMemoryAndSemaphores(void)
 		InitProcGlobal();
 	CreateSharedProcArray();
 	CreateSharedBackendStatus();
+	BackendProfileShmemInit();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
 
@@ -285,14 +311,23 @@ CreateSharedMemoryAndSemaphores(void)
 	WalRcvShmemInit();
 	PgArchShmemInit();
 	ApplyLauncherShmemInit();
+	ProxyShmemInit();
 
 	/*
 	 * Set up other modules that need some shared memory space
 	 */
 	SnapMgrInit();
 	BTreeShmemInit();
+	ParallelWorkerPoolShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	PgStatShmemInit();
+	SharedCatCacheShmemInit();
+	SharedPlanCacheShmemInit();
+	SharedResultCacheShmemInit();
+	SequenceCacheShmemInit();
+	SmgrShmemInit();
+	DoubleWriteShmemInit();
 
 #ifdef EXEC_BACKEND
 
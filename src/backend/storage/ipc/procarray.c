@@ -48,6 +48,7 @@
 #include <signal.h>
 
 #include "access/clog.h"
+#include "access/csnlog.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -68,6 +69,12 @@
 
 #define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
 
+/*
+ * Number of commits after which the shared xmin bound for CSN snapshots is
+ * recomputed, see GetSnapshotDataCSNXmin().
+ */
+#define CSN_XMIN_BOUND_REFRESH_INTERVAL 64
+
 /* Our shared memory area */
 typedef struct ProcArrayStruct
 {
@@ -97,6 +104,15 @@ typedef struct ProcArrayStruct
 	/* oldest catalog xmin of any replication slot */
 	TransactionId replication_slot_catalog_xmin;
 
+	/*
+	 * With csn_snapshots, a conservative xmin for new snapshots: no XID that
+	 * precedes it can be running.  Only ever advances, see
+	 * GetSnapshotDataCSNXmin().  csnXminBoundCSN is the CSN counter at the
+	 * time it was last computed.
+	 */
+	pg_atomic_uint32 csnXminBound;
+	pg_atomic_uint64 csnXminBoundCSN;
+
 	/* indexes into allProcs[], has PROCARRAY_MAXPROCS entries */
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
@@ -429,6 +445,8 @@ CreateSharedProcArray(void)
 		procArray->lastOverflowedXid = InvalidTransactionId;
 		procArray->replication_slot_xmin = InvalidTransactionId;
 		procArray->replication_slot_catalog_xmin = InvalidTransactionId;
+		pg_atomic_init_u32(&procArray->csnXminBound, InvalidTransactionId);
+		pg_atomic_init_u64(&procArray->csnXminBoundCSN, InvalidCommitSeqNo);
 		ShmemVariableCache->xactCompletionCount = 1;
 	}
 
@@ -2169,6 +2187,237 @@ GetSnapshotDataReuse(Snapshot snapshot)
 	return true;
 }
 
+/*
+ * Helper function for GetSnapshotData() that tries to advance the bounds of
+ * GlobalVis{Shared,Catalog,Data,Temp}Rels, based on the xmin of the snapshot
+ * just built and the other values gathered while building it.
+ */
+static void
+GetSnapshotDataUpdateGlobalVis(FullTransactionId latest_completed,
+							   TransactionId oldestxid,
+							   TransactionId xmin,
+							   TransactionId myxid,
+							   TransactionId replication_slot_xmin,
+							   TransactionId replication_slot_catalog_xmin)
+{
+	TransactionId def_vis_xid;
+	TransactionId def_vis_xid_data;
+	FullTransactionId def_vis_fxid;
+	FullTransactionId def_vis_fxid_data;
+	FullTransactionId oldestfxid;
+
+	/*
+	 * Converting oldestXid is only safe when xid horizon cannot advance,
+	 * i.e. holding locks. While we don't hold the lock anymore, all the
+	 * necessary data has been gathered with lock held.
+	 */
+	oldestfxid = FullXidRelativeTo(latest_completed, oldestxid);
+
+	/* apply vacuum_defer_cleanup_age */
+	def_vis_xid_data =
+		TransactionIdRetreatedBy(xmin, vacuum_defer_cleanup_age);
+
+	/* Check whether there's a replication slot requiring an older xmin. */
+	def_vis_xid_data =
+		TransactionIdOlder(def_vis_xid_data, replication_slot_xmin);
+
+	/*
+	 * Rows in non-shared, non-catalog tables possibly could be vacuumed
+	 * if older than this xid.
+	 */
+	def_vis_xid = def_vis_xid_data;
+
+	/*
+	 * Check whether there's a replication slot requiring an older catalog
+	 * xmin.
+	 */
+	def_vis_xid =
+		TransactionIdOlder(replication_slot_catalog_xmin, def_vis_xid);
+
+	def_vis_fxid = FullXidRelativeTo(latest_completed, def_vis_xid);
+	def_vis_fxid_data = FullXidRelativeTo(latest_completed, def_vis_xid_data);
+
+	/*
+	 * Check if we can increase upper bound. As a previous
+	 * GlobalVisUpdate() might have computed more aggressive values, don't
+	 * overwrite them if so.
+	 */
+	GlobalVisSharedRels.definitely_needed =
+		FullTransactionIdNewer(def_vis_fxid,
+							   GlobalVisSharedRels.definitely_needed);
+	GlobalVisCatalogRels.definitely_needed =
+		FullTransactionIdNewer(def_vis_fxid,
+							   GlobalVisCatalogRels.definitely_needed);
+	GlobalVisDataRels.definitely_needed =
+		FullTransactionIdNewer(def_vis_fxid_data,
+							   GlobalVisDataRels.definitely_needed);
+	/* See temp_oldest_nonremovable computation in ComputeXidHorizons() */
+	if (TransactionIdIsNormal(myxid))
+		GlobalVisTempRels.definitely_needed =
+			FullXidRelativeTo(latest_completed, myxid);
+	else
+	{
+		GlobalVisTempRels.definitely_needed = latest_completed;
+		FullTransactionIdAdvance(&GlobalVisTempRels.definitely_needed);
+	}
+
+	/*
+	 * Check if we know that we can initialize or increase the lower
+	 * bound. Currently the only cheap way to do so is to use
+	 * ShmemVariableCache->oldestXid as input.
+	 *
+	 * We should definitely be able to do better. We could e.g. put a
+	 * global lower bound value into ShmemVariableCache.
+	 */
+	GlobalVisSharedRels.maybe_needed =
+		FullTransactionIdNewer(GlobalVisSharedRels.maybe_needed,
+							   oldestfxid);
+	GlobalVisCatalogRels.maybe_needed =
+		FullTransactionIdNewer(GlobalVisCatalogRels.maybe_needed,
+							   oldestfxid);
+	GlobalVisDataRels.maybe_needed =
+		FullTransactionIdNewer(GlobalVisDataRels.maybe_needed,
+							   oldestfxid);
+	/* accurate value known */
+	GlobalVisTempRels.maybe_needed = GlobalVisTempRels.definitely_needed;
+}
+
+/*
+ * Helper function for GetSnapshotDataCSN() that returns a conservative xmin
+ * for a new CSN snapshot: no XID that precedes it can still be running.
+ *
+ * Computing an exact xmin would require scanning the ProcArray, which is
+ * exactly what CSN snapshots avoid.  Instead we share a bound in the
+ * ProcArray, and recompute it only once CSN_XMIN_BOUND_REFRESH_INTERVAL
+ * transactions have committed since it was last computed.  A stale bound is
+ * still correct, since any XID assigned after the bound was computed follows
+ * it, but it holds back vacuum's horizon a little.
+ */
+static TransactionId
+GetSnapshotDataCSNXmin(void)
+{
+	TransactionId *other_xids = ProcGlobal->xids;
+	TransactionId bound;
+	TransactionId newbound;
+	CommitSeqNo boundcsn;
+	CommitSeqNo csn;
+
+	bound = pg_atomic_read_u32(&procArray->csnXminBound);
+	boundcsn = pg_atomic_read_u64(&procArray->csnXminBoundCSN);
+	csn = ReadNextCommitSeqNo();
+
+	if (TransactionIdIsValid(bound))
+	{
+		if (csn - boundcsn < CSN_XMIN_BOUND_REFRESH_INTERVAL)
+			return bound;
+
+		/* somebody else is probably refreshing it; they're welcome to */
+		if (!LWLockConditionalAcquire(ProcArrayLock, LW_SHARED))
+			return bound;
+	}
+	else
+		LWLockAcquire(ProcArrayLock, LW_SHARED);
+
+	newbound = XidFromFullTransactionId(ShmemVariableCache->latestCompletedXid);
+	TransactionIdAdvance(newbound);
+
+	for (int pgxactoff = 0; pgxactoff < procArray->numProcs; pgxactoff++)
+	{
+		/* Fetch xid just once - see GetNewTransactionId */
+		TransactionId xid = UINT32_ACCESS_ONCE(other_xids[pgxactoff]);
+
+		if (TransactionIdIsNormal(xid) &&
+			NormalTransactionIdPrecedes(xid, newbound))
+			newbound = xid;
+	}
+
+	LWLockRelease(ProcArrayLock);
+
+	/* Never move the bound backwards */
+	while (!TransactionIdIsValid(bound) ||
+		   TransactionIdPrecedes(bound, newbound))
+	{
+		if (pg_atomic_compare_exchange_u32(&procArray->csnXminBound,
+										   &bound, newbound))
+		{
+			pg_atomic_write_u64(&procArray->csnXminBoundCSN, csn);
+			return newbound;
+		}
+	}
+
+	return bound;
+}
+
+/*
+ * GetSnapshotData() for csn_snapshots.  The snapshot consists of just xmin,
+ * xmax and the CSN counter, so none of the ProcArray needs to be scanned,
+ * and there's nothing to copy.
+ */
+static Snapshot
+GetSnapshotDataCSN(Snapshot snapshot)
+{
+	TransactionId xmin;
+	TransactionId myxid = MyProc->xid;
+	FullTransactionId latest_completed;
+	TransactionId oldestxid;
+	CommitSeqNo snapshotcsn;
+
+	xmin = GetSnapshotDataCSNXmin();
+	if (TransactionIdIsValid(MyProc->xmin) &&
+		TransactionIdPrecedes(xmin, TransactionXmin))
+		xmin = TransactionXmin;
+
+	if (!TransactionIdIsValid(MyProc->xmin))
+		MyProc->xmin = TransactionXmin = xmin;
+
+	/*
+	 * Our xmin must be visible to others before we read the CSN counter, so
+	 * that nothing which is still running as far as this snapshot is
+	 * concerned can be removed by vacuum.  Pairs with the barrier in
+	 * CSNLogSetCommitSeqNo().
+	 */
+	pg_memory_barrier();
+	snapshotcsn = ReadNextCommitSeqNo();
+
+	/*
+	 * Anything with a CSN smaller than the snapshot's has an XID that's
+	 * already been assigned, so nextXid is a valid xmax.
+	 */
+	LWLockAcquire(XidGenLock, LW_SHARED);
+	latest_completed = ShmemVariableCache->nextXid;
+	oldestxid = ShmemVariableCache->oldestXid;
+	LWLockRelease(XidGenLock);
+
+	snapshot->xmax = XidFromFullTransactionId(latest_completed);
+	FullTransactionIdRetreat(&latest_completed);
+
+	/* maintain state for GlobalVis* */
+	GetSnapshotDataUpdateGlobalVis(latest_completed, oldestxid, xmin, myxid,
+								   procArray->replication_slot_xmin,
+								   procArray->replication_slot_catalog_xmin);
+
+	RecentXmin = xmin;
+	Assert(TransactionIdPrecedesOrEquals(TransactionXmin, RecentXmin));
+
+	snapshot->xmin = xmin;
+	snapshot->xcnt = 0;
+	snapshot->subxcnt = 0;
+	snapshot->suboverflowed = false;
+	snapshot->takenDuringRecovery = false;
+	snapshot->snapshotcsn = snapshotcsn;
+	snapshot->snapXactCompletionCount = 0;
+
+	snapshot->curcid = GetCurrentCommandId(false);
+
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+
+	GetSnapshotDataInitOldSnapshot(snapshot);
+
+	return snapshot;
+}
+
 /*
  * GetSnapshotData -- returns information about running transactions.
  *
@@ -2199,6 +2448,9 @@ GetSnapshotDataReuse(Snapshot snapshot)
  * And try to advance the bounds of GlobalVis{Shared,Catalog,Data,Temp}Rels
  * for the benefit of the GlobalVisTest* family of functions.
  *
+ * With csn_snapshots, snapshots taken outside recovery are built by
+ * GetSnapshotDataCSN() instead, and don't list the running XIDs at all.
+ *
  * Note: this function should probably not be called with an argument that's
  * not statically allocated (see xip allocation below).
  */
@@ -2255,6 +2507,9 @@ GetSnapshotData(Snapshot snapshot)
 					 errmsg("out of memory")));
 	}
 
+	if (csn_snapshots && !RecoveryInProgress())
+		return GetSnapshotDataCSN(snapshot);
+
 	/*
 	 * It is sufficient to get shared lock on ProcArrayLock, even if we are
 	 * going to set MyProc->xmin.
@@ -2447,88 +2702,9 @@ GetSnapshotData(Snapshot snapshot)
 	LWLockRelease(ProcArrayLock);
 
 	/* maintain state for GlobalVis* */
-	{
-		TransactionId def_vis_xid;
-		TransactionId def_vis_xid_data;
-		FullTransactionId def_vis_fxid;
-		FullTransactionId def_vis_fxid_data;
-		FullTransactionId oldestfxid;
-
-		/*
-		 * Converting oldestXid is only safe when xid horizon cannot advance,
-		 * i.e. holding locks. While we don't hold the lock anymore, all the
-		 * necessary data has been gathered with lock held.
-		 */
-		oldestfxid = FullXidRelativeTo(latest_completed, oldestxid);
-
-		/* apply vacuum_defer_cleanup_age */
-		def_vis_xid_data =
-			TransactionIdRetreatedBy(xmin, vacuum_defer_cleanup_age);
-
-		/* Check whether there's a replication slot requiring an older xmin. */
-		def_vis_xid_data =
-			TransactionIdOlder(def_vis_xid_data, replication_slot_xmin);
-
-		/*
-		 * Rows in non-shared, non-catalog tables possibly could be vacuumed
-		 * if older than this xid.
-		 */
-		def_vis_xid = def_vis_xid_data;
-
-		/*
-		 * Check whether there's a replication slot requiring an older catalog
-		 * xmin.
-		 */
-		def_vis_xid =
-			TransactionIdOlder(replication_slot_catalog_xmin, def_vis_xid);
-
-		def_vis_fxid = FullXidRelativeTo(latest_completed, def_vis_xid);
-		def_vis_fxid_data = FullXidRelativeTo(latest_completed, def_vis_xid_data);
-
-		/*
-		 * Check if we can increase upper bound. As a previous
-		 * GlobalVisUpdate() might have computed more aggressive values, don't
-		 * overwrite them if so.
-		 */
-		GlobalVisSharedRels.definitely_needed =
-			FullTransactionIdNewer(def_vis_fxid,
-								   GlobalVisSharedRels.definitely_needed);
-		GlobalVisCatalogRels.definitely_needed =
-			FullTransactionIdNewer(def_vis_fxid,
-								   GlobalVisCatalogRels.definitely_needed);
-		GlobalVisDataRels.definitely_needed =
-			FullTransactionIdNewer(def_vis_fxid_data,
-								   GlobalVisDataRels.definitely_needed);
-		/* See temp_oldest_nonremovable computation in ComputeXidHorizons() */
-		if (TransactionIdIsNormal(myxid))
-			GlobalVisTempRels.definitely_needed =
-				FullXidRelativeTo(latest_completed, myxid);
-		else
-		{
-			GlobalVisTempRels.definitely_needed = latest_completed;
-			FullTransactionIdAdvance(&GlobalVisTempRels.definitely_needed);
-		}
-
-		/*
-		 * Check if we know that we can initialize or increase the lower
-		 * bound. Currently the only cheap way to do so is to use
-		 * ShmemVariableCache->oldestXid as input.
-		 *
-		 * We should definitely be able to do better. We could e.g. put a
-		 * global lower bound value into ShmemVariableCache.
-		 */
-		GlobalVisSharedRels.maybe_needed =
-			FullTransactionIdNewer(GlobalVisSharedRels.maybe_needed,
-								   oldestfxid);
-		GlobalVisCatalogRels.maybe_needed =
-			FullTransactionIdNewer(GlobalVisCatalogRels.maybe_needed,
-								   oldestfxid);
-		GlobalVisDataRels.maybe_needed =
-			FullTransactionIdNewer(GlobalVisDataRels.maybe_needed,
-								   oldestfxid);
-		/* accurate value known */
-		GlobalVisTempRels.maybe_needed = GlobalVisTempRels.definitely_needed;
-	}
+	GetSnapshotDataUpdateGlobalVis(latest_completed, oldestxid, xmin, myxid,
+								   replication_slot_xmin,
+								   replication_slot_catalog_xmin);
 
 	RecentXmin = xmin;
 	Assert(TransactionIdPrecedesOrEquals(TransactionXmin, RecentXmin));
@@ -2538,6 +2714,7 @@ GetSnapshotData(Snapshot snapshot)
 	snapshot->xcnt = count;
 	snapshot->subxcnt = subcount;
 	snapshot->suboverflowed = suboverflowed;
+	snapshot->snapshotcsn = InvalidCommitSeqNo;
 	snapshot->snapXactCompletionCount = curXactCompletionCount;
 
 	snapshot->curcid = GetCurrentCommandId(false);
@@ -548,6 +548,82 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait,
 	return SHM_MQ_SUCCESS;
 }
 
+/*
+ * Reserve space for a message of nbytes bytes directly in the ring buffer.
+ *
+ * This is a fast path for callers that would otherwise have to build the
+ * message in private memory only for shm_mq_send to copy it into the queue.
+ * If the whole message, with its length word, fits contiguously into space
+ * the receiver has already freed up, we write the length word and return a
+ * MAXALIGN'd pointer to where the payload goes; the caller must fill in
+ * exactly nbytes bytes there and then call shm_mq_send_reserved.  Otherwise
+ * we return NULL without changing any state, and the caller should send the
+ * message with shm_mq_send as usual.  We never wait.
+ */
+void *
+shm_mq_send_reserve(shm_mq_handle *mqh, Size nbytes)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	Size		ringsize = mq->mq_ring_size;
+	Size		needed = MAXALIGN(sizeof(Size)) + MAXALIGN(nbytes);
+	uint64		rb;
+	uint64		wb;
+	Size		offset;
+	char	   *ptr;
+
+	Assert(mq->mq_sender == MyProc);
+
+	/* Can't interleave with a partially sent message, or before attach. */
+	if (mqh->mqh_length_word_complete || mqh->mqh_partial_bytes != 0 ||
+		!mqh->mqh_counterparty_attached || mq->mq_detached)
+		return NULL;
+
+	rb = pg_atomic_read_u64(&mq->mq_bytes_read);
+	wb = pg_atomic_read_u64(&mq->mq_bytes_written) + mqh->mqh_send_pending;
+	Assert(wb >= rb);
+	offset = wb % (uint64) ringsize;
+	if (needed > ringsize - (wb - rb) || needed > ringsize - offset)
+		return NULL;
+
+	/*
+	 * The caller's writes must happen after the read of mq_bytes_read,
+	 * above, just as in shm_mq_send_bytes.
+	 */
+	pg_memory_barrier();
+	ptr = &mq->mq_ring[mq->mq_ring_offset + offset];
+	memcpy(ptr, &nbytes, sizeof(Size));
+
+	return ptr + MAXALIGN(sizeof(Size));
+}
+
+/*
+ * Complete sending a message whose payload the caller has written into space
+ * obtained from shm_mq_send_reserve.  force_flush is as for shm_mq_send.
+ */
+shm_mq_result
+shm_mq_send_reserved(shm_mq_handle *mqh, Size nbytes, bool force_flush)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+
+	Assert(mqh->mqh_counterparty_attached);
+
+	mqh->mqh_send_pending += MAXALIGN(sizeof(Size)) + MAXALIGN(nbytes);
+
+	/* If queue has been detached, let caller know. */
+	if (mq->mq_detached)
+		return SHM_MQ_DETACHED;
+
+	/* As in shm_mq_sendv, tell the receiver only once in a while. */
+	if (force_flush || mqh->mqh_send_pending > (mq->mq_ring_size >> 2))
+	{
+		shm_mq_inc_bytes_written(mq, mqh->mqh_send_pending);
+		SetLatch(&mq->mq_receiver->procLatch);
+		mqh->mqh_send_pending = 0;
+	}
+
+	return SHM_MQ_SUCCESS;
+}
+
 /*
  * Receive a message from a shared message queue.
  *
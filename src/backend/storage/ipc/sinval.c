@@ -21,6 +21,9 @@
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -44,10 +47,16 @@ volatile sig_atomic_t catchupInterruptPending = false;
 /*
  * SendSharedInvalidMessages
  *	Add shared-cache-invalidation message(s) to the global SI message queue.
+ *
+ * Entries of the shared catalog, plan and result caches that the messages
+ * affect are removed right away, before anyone can see the messages.
  */
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	SharedCatCacheInvalidateMessages(msgs, n);
+	SharedPlanCacheInvalidateMessages(msgs, n);
+	SharedResultCacheInvalidateMessages(msgs, n);
 	SIInsertDataEntries(msgs, n);
 }
 
@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "access/transam.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "storage/backendid.h"
 #include "storage/ipc.h"
@@ -26,6 +27,7 @@
 #include "storage/shmem.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/builtins.h"
 
 /*
  * Conceptually, the shared cache invalidation messages are stored in an
@@ -43,7 +45,7 @@
  * SICleanupQueue is called, and we try not to do that often.)
  *
  * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
+ * (that is, sinval_queue_size) entries.  We translate MsgNum values into circular-buffer indexes by
  * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
  * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
  * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
@@ -107,10 +109,14 @@
  * Configurable parameters.
  *
  * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * Set by the sinval_queue_size GUC, which must be a power of 2 for speed.
+ * Backends that fall further behind than that are reset, and have to throw
+ * away all their caches, so installations with lots of DDL and many idle
+ * sessions may want a bigger queue.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of MAXNUMMESSAGES, which it is since that is a power
+ * of 2 no larger than SINVAL_QUEUE_SIZE_MAX.  Should be large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -127,8 +133,9 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
+#define MAXNUMMESSAGES sinval_queue_size
+#define MSGNUMWRAPAROUND (SINVAL_QUEUE_SIZE_MAX * 1024)
+#define MSGINDEX(msgnum) ((msgnum) & (MAXNUMMESSAGES - 1))
 #define CLEANUP_MIN (MAXNUMMESSAGES / 2)
 #define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
 #define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
@@ -154,6 +161,9 @@ typedef struct ProcState
 	 */
 	bool		sendOnly;		/* backend only sends, never receives */
 
+	/* Number of times the backend has been reset, for monitoring */
+	int64		resetCount;
+
 	/*
 	 * Next LocalTransactionId to use for each idle backend slot.  We keep
 	 * this here because it is indexed by BackendId and it is convenient to
@@ -178,17 +188,22 @@ typedef struct SISeg
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
-	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
-
-	/*
-	 * Per-backend invalidation state info (has MaxBackends entries).
+	 * Per-backend invalidation state info (has MaxBackends entries).  It is
+	 * followed by the circular buffer holding shared-inval messages, which
+	 * has MAXNUMMESSAGES entries.
 	 */
 	ProcState	procState[FLEXIBLE_ARRAY_MEMBER];
 } SISeg;
 
+#define SISegMessagesOffset() \
+	MAXALIGN(add_size(offsetof(SISeg, procState), \
+					  mul_size(sizeof(ProcState), MaxBackends)))
+
 static SISeg *shmInvalBuffer;	/* pointer to the shared inval buffer */
+static SharedInvalidationMessage *shmInvalMessages; /* its circular buffer */
+
+/* GUC variable */
+int			sinval_queue_size = 4096;
 
 
 static LocalTransactionId nextLocalTransactionId;
@@ -204,8 +219,9 @@ SInvalShmemSize(void)
 {
 	Size		size;
 
-	size = offsetof(SISeg, procState);
-	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+	size = SISegMessagesOffset();
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   MAXNUMMESSAGES));
 
 	return size;
 }
@@ -223,6 +239,8 @@ CreateSharedInvalidationState(void)
 	/* Allocate space in shared memory */
 	shmInvalBuffer = (SISeg *)
 		ShmemInitStruct("shmInvalBuffer", SInvalShmemSize(), &found);
+	shmInvalMessages = (SharedInvalidationMessage *)
+		((char *) shmInvalBuffer + SISegMessagesOffset());
 	if (found)
 		return;
 
@@ -234,7 +252,7 @@ CreateSharedInvalidationState(void)
 	shmInvalBuffer->maxBackends = MaxBackends;
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
-	/* The buffer[] array is initially all unused, so we need not fill it */
+	/* The message buffer is initially all unused, so we need not fill it */
 
 	/* Mark all backends inactive, and initialize nextLXID */
 	for (i = 0; i < shmInvalBuffer->maxBackends; i++)
@@ -245,6 +263,7 @@ CreateSharedInvalidationState(void)
 		shmInvalBuffer->procState[i].resetState = false;
 		shmInvalBuffer->procState[i].signaled = false;
 		shmInvalBuffer->procState[i].hasMessages = false;
+		shmInvalBuffer->procState[i].resetCount = 0;
 		shmInvalBuffer->procState[i].nextLXID = InvalidLocalTransactionId;
 	}
 }
@@ -314,6 +333,7 @@ SharedInvalBackendInit(bool sendOnly)
 	stateP->signaled = false;
 	stateP->hasMessages = false;
 	stateP->sendOnly = sendOnly;
+	stateP->resetCount = 0;
 
 	LWLockRelease(SInvalWriteLock);
 
@@ -477,7 +497,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			shmInvalMessages[MSGINDEX(max)] = *data++;
 			max++;
 		}
 
@@ -600,7 +620,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = shmInvalMessages[MSGINDEX(stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -679,6 +699,7 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 		if (n < lowbound)
 		{
 			stateP->resetState = true;
+			stateP->resetCount++;
 			/* no point in signaling him ... */
 			continue;
 		}
@@ -775,3 +796,83 @@ GetNextLocalTransactionId(void)
 
 	return result;
 }
+
+/*
+ * check_hook for sinval_queue_size: must be a power of 2
+ */
+bool
+check_sinval_queue_size(int *newval, void **extra, GucSource source)
+{
+	if ((*newval & (*newval - 1)) != 0)
+	{
+		GUC_check_errdetail("\"sinval_queue_size\" must be a power of 2.");
+		return false;
+	}
+	return true;
+}
+
+/*
+ * SQL SRF showing how often each backend had to reset its caches because it
+ * fell too far behind in reading invalidation messages
+ */
+Datum
+pg_stat_get_sinval_resets(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SINVAL_RESETS_COLS 2
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	SISeg	   *segP = shmInvalBuffer;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Need to lock out additions/removals of backends */
+	LWLockAcquire(SInvalWriteLock, LW_SHARED);
+
+	for (i = 0; i < segP->lastBackend; i++)
+	{
+		ProcState  *stateP = &segP->procState[i];
+		Datum		values[PG_STAT_GET_SINVAL_RESETS_COLS];
+		bool		nulls[PG_STAT_GET_SINVAL_RESETS_COLS];
+
+		if (stateP->procPid == 0 || stateP->sendOnly)
+			continue;
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = Int32GetDatum(stateP->procPid);
+		values[1] = Int64GetDatum(stateP->resetCount);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(SInvalWriteLock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
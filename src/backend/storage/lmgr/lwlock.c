@@ -176,7 +176,33 @@ static const char *const BuiltinTrancheNames[] = {
 	/* LWTRANCHE_PARALLEL_APPEND: */
 	"ParallelAppend",
 	/* LWTRANCHE_PER_XACT_PREDICATE_LIST: */
-	"PerXactPredicateList"
+	"PerXactPredicateList",
+	/* LWTRANCHE_PGSTATS_DSA: */
+	"PgStatsDSA",
+	/* LWTRANCHE_PGSTATS_HASH: */
+	"PgStatsHash",
+	/* LWTRANCHE_PGSTATS_DATA: */
+	"PgStatsData",
+	/* LWTRANCHE_CSNLOG_BUFFER: */
+	"CSNLogBuffer",
+	/* LWTRANCHE_SHARED_CATCACHE_DSA: */
+	"SharedCatCacheDSA",
+	/* LWTRANCHE_SHARED_CATCACHE_HASH: */
+	"SharedCatCacheHash",
+	/* LWTRANCHE_SHARED_PLAN_CACHE_DSA: */
+	"SharedPlanCacheDSA",
+	/* LWTRANCHE_SHARED_PLAN_CACHE_HASH: */
+	"SharedPlanCacheHash",
+	/* LWTRANCHE_SHARED_RESULT_CACHE_DSA: */
+	"SharedResultCacheDSA",
+	/* LWTRANCHE_SHARED_RESULT_CACHE_HASH: */
+	"SharedResultCacheHash",
+	/* LWTRANCHE_SEQUENCE_CACHE: */
+	"SequenceCache",
+	/* LWTRANCHE_RELSIZE_CACHE: */
+	"RelationSizeCache",
+	/* LWTRANCHE_DOUBLE_WRITE: */
+	"DoubleWrite"
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -216,6 +242,23 @@ typedef struct LWLockHandle
 static int	num_held_lwlocks = 0;
 static LWLockHandle held_lwlocks[MAX_SIMUL_LWLOCKS];
 
+/*
+ * Before sleeping on a contended lock, LWLockAcquire spins for a while,
+ * watching for the lock to be released.  How long it is willing to spin is
+ * learned separately for each built-in tranche (each individual LWLock such
+ * as ProcArrayLock has a tranche of its own); all extension tranches share
+ * one slot.  Like spins_per_delay in s_lock.c, the limit is raised quickly
+ * when spinning got us the lock and lowered slowly when we had to sleep
+ * anyway, so it settles high for locks held only briefly and low for locks
+ * held across longer operations, or on a uniprocessor.  Zero means not yet
+ * initialized.  The values are local to each backend.
+ */
+#define MIN_LWLOCK_SPINS		10
+#define MAX_LWLOCK_SPINS		1000
+#define DEFAULT_LWLOCK_SPINS	100
+
+static int	lwlock_spins[LWTRANCHE_FIRST_USER_DEFINED + 1];
+
 /* struct representing the LWLock tranche request for named tranche */
 typedef struct NamedLWLockTrancheRequest
 {
@@ -240,6 +283,8 @@ NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 static bool lock_named_request_allowed = true;
 
 static void InitializeLWLocks(void);
+static bool LWLockSpinUntilFree(LWLock *lock, LWLockMode mode);
+static void LWLockAdjustSpins(LWLock *lock, bool success);
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
 static const char *GetLWTrancheName(uint16 trancheId);
@@ -876,6 +921,49 @@ LWLockAttemptLock(LWLock *lock, LWLockMode mode)
 	pg_unreachable();
 }
 
+/*
+ * Spin, without touching the cache line more than necessary, until the lock
+ * looks free for the requested mode or the tranche's spin limit runs out.
+ *
+ * Returns true if the lock looked free, in which case the caller should just
+ * retry LWLockAttemptLock.
+ */
+static bool
+LWLockSpinUntilFree(LWLock *lock, LWLockMode mode)
+{
+	uint32		mask = (mode == LW_EXCLUSIVE) ? LW_LOCK_MASK : LW_VAL_EXCLUSIVE;
+	int		   *limit;
+	int			spins;
+
+	limit = &lwlock_spins[Min(lock->tranche, LWTRANCHE_FIRST_USER_DEFINED)];
+	if (*limit == 0)
+		*limit = DEFAULT_LWLOCK_SPINS;
+
+	for (spins = 0; spins < *limit; spins++)
+	{
+		SPIN_DELAY();
+		if ((pg_atomic_read_u32(&lock->state) & mask) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Learn from whether spinning in LWLockAcquire was enough to get the lock.
+ */
+static void
+LWLockAdjustSpins(LWLock *lock, bool success)
+{
+	int		   *limit;
+
+	limit = &lwlock_spins[Min(lock->tranche, LWTRANCHE_FIRST_USER_DEFINED)];
+	if (success)
+		*limit = Min(*limit + 100, MAX_LWLOCK_SPINS);
+	else
+		*limit = Max(*limit - 1, MIN_LWLOCK_SPINS);
+}
+
 /*
  * Lock the LWLock's wait list against concurrent activity.
  *
@@ -1200,6 +1288,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 {
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
+	bool		spun = false;
 	int			extraWaits = 0;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
@@ -1269,6 +1358,20 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			break;				/* got the lock */
 		}
 
+		/*
+		 * Most LWLocks are held only for a short time, so first spin for a
+		 * bit in the hope the holder releases it, which is much cheaper than
+		 * a trip through the semaphore.  Do this only once per acquisition;
+		 * once we have slept, we are woken exactly when it is worth trying
+		 * again.
+		 */
+		if (!spun)
+		{
+			spun = true;
+			if (LWLockSpinUntilFree(lock, mode))
+				continue;
+		}
+
 		/*
 		 * Ok, at this point we couldn't grab the lock on the first try. We
 		 * cannot simply queue ourselves to the end of the list and wait to be
@@ -1343,6 +1446,10 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		result = false;
 	}
 
+	/* If we spun, remember whether that saved us from sleeping */
+	if (spun)
+		LWLockAdjustSpins(lock, result);
+
 	if (TRACE_POSTGRESQL_LWLOCK_ACQUIRE_ENABLED())
 		TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
 
@@ -1552,7 +1659,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
  */
 static bool
 LWLockConflictsWithVar(LWLock *lock,
-					   uint64 *valptr, uint64 oldval, uint64 *newval,
+					   pg_atomic_uint64 *valptr, uint64 oldval, uint64 *newval,
 					   bool *result)
 {
 	bool		mustwait;
@@ -1561,9 +1668,9 @@ LWLockConflictsWithVar(LWLock *lock,
 	/*
 	 * Test first to see if it the slot is free right now.
 	 *
-	 * XXX: the caller uses a spinlock before this, so we don't need a memory
-	 * barrier here as far as the current usage is concerned.  But that might
-	 * not be safe in general.
+	 * XXX: the only caller, WaitXLogInsertionsToFinish(), issues a read
+	 * barrier before this, so we don't need one here as far as the current
+	 * usage is concerned.  But that might not be safe in general.
 	 */
 	mustwait = (pg_atomic_read_u32(&lock->state) & LW_VAL_EXCLUSIVE) != 0;
 
@@ -1576,13 +1683,11 @@ LWLockConflictsWithVar(LWLock *lock,
 	*result = false;
 
 	/*
-	 * Read value using the lwlock's wait list lock, as we can't generally
-	 * rely on atomic 64 bit reads/stores.  TODO: On platforms with a way to
-	 * do atomic 64 bit reads/writes the spinlock should be optimized away.
+	 * The variable is a 64 bit atomic, so this can't observe a torn value
+	 * even on platforms without native 64 bit loads, and we don't need the
+	 * wait list lock.
 	 */
-	LWLockWaitListLock(lock);
-	value = *valptr;
-	LWLockWaitListUnlock(lock);
+	value = pg_atomic_read_u64(valptr);
 
 	if (value != oldval)
 	{
@@ -1611,7 +1716,8 @@ LWLockConflictsWithVar(LWLock *lock,
  * in shared mode, returns 'true'.
  */
 bool
-LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
+LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval,
+				 uint64 *newval)
 {
 	PGPROC	   *proc = MyProc;
 	int			extraWaits = 0;
@@ -1746,22 +1852,26 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
  * The caller must be holding the lock in exclusive mode.
  */
 void
-LWLockUpdateVar(LWLock *lock, uint64 *valptr, uint64 val)
+LWLockUpdateVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 val)
 {
 	proclist_head wakeup;
 	proclist_mutable_iter iter;
 
 	PRINT_LWDEBUG("LWLockUpdateVar", lock, LW_EXCLUSIVE);
 
+	/*
+	 * pg_atomic_exchange_u64 is a full barrier, so the new value is visible
+	 * before we look for waiters to wake up.  Anyone who queues up after
+	 * this will see it when rechecking in LWLockWaitForVar.
+	 */
+	pg_atomic_exchange_u64(valptr, val);
+
 	proclist_init(&wakeup);
 
 	LWLockWaitListLock(lock);
 
 	Assert(pg_atomic_read_u32(&lock->state) & LW_VAL_EXCLUSIVE);
 
-	/* Update the lock's value */
-	*valptr = val;
-
 	/*
 	 * See if there are any LW_WAIT_UNTIL_FREE waiters that need to be woken
 	 * up. They are always in the front of the queue.
@@ -1873,17 +1983,15 @@ LWLockRelease(LWLock *lock)
  * LWLockReleaseClearVar - release a previously acquired lock, reset variable
  */
 void
-LWLockReleaseClearVar(LWLock *lock, uint64 *valptr, uint64 val)
+LWLockReleaseClearVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 val)
 {
-	LWLockWaitListLock(lock);
-
 	/*
 	 * Set the variable's value before releasing the lock, that prevents race
 	 * a race condition wherein a new locker acquires the lock, but hasn't yet
-	 * set the variables value.
+	 * set the variables value.  pg_atomic_exchange_u64 is a full barrier, so
+	 * the store can't be reordered after the release.
 	 */
-	*valptr = val;
-	LWLockWaitListUnlock(lock);
+	pg_atomic_exchange_u64(valptr, val);
 
 	LWLockRelease(lock);
 }
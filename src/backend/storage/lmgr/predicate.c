@@ -200,8 +200,10 @@
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/predicate.h"
 #include "storage/predicate_internals.h"
@@ -393,6 +395,31 @@ static HTAB *PredicateLockTargetHash;
 static HTAB *PredicateLockHash;
 static SHM_QUEUE *FinishedSerializableTransactions;
 
+/*
+ * Summary of which relations have any predicate lock targets, consulted by
+ * CheckForSerializableConflictIn() before it probes the target hash at all.
+ * Each counter holds the number of targets whose relation hashes to it.  A
+ * zero counter proves that no serializable transaction has anything in the
+ * relation locked, so a write to it can't cause a rw-conflict in; that's
+ * the common case for writes to tables only ever read with index scans of
+ * other keys, or not read by serializable transactions at all.
+ *
+ * Counters are updated with the target's partition lock held, before the
+ * lock is released, so anyone who could have seen the target in the hash
+ * sees the counter's increment too.
+ */
+#define PREDLOCK_REL_SUMMARY_SIZE	4096
+
+static pg_atomic_uint32 *PredicateLockRelSummary;
+
+#define PredicateLockRelSummarySlot(dbid, relid) \
+	(&PredicateLockRelSummary[hash_combine(murmurhash32(dbid), \
+										   murmurhash32(relid)) % \
+							  PREDLOCK_REL_SUMMARY_SIZE])
+#define PredicateLockTargetSummarySlot(targettag) \
+	PredicateLockRelSummarySlot(GET_PREDICATELOCKTARGETTAG_DB(*(targettag)), \
+								GET_PREDICATELOCKTARGETTAG_RELATION(*(targettag)))
+
 /*
  * Tag for a dummy entry in PredicateLockTargetHash. By temporarily removing
  * this entry, you can ensure that there's enough scratch space available for
@@ -1341,6 +1368,21 @@ InitPredicateLocks(void)
 	if (!found)
 		SHMQueueInit(FinishedSerializableTransactions);
 
+	/* Create or attach to the per-relation target summary. */
+	PredicateLockRelSummary = (pg_atomic_uint32 *)
+		ShmemInitStruct("PredicateLockRelSummary",
+						mul_size(PREDLOCK_REL_SUMMARY_SIZE,
+								 sizeof(pg_atomic_uint32)),
+						&found);
+	Assert(found == IsUnderPostmaster);
+	if (!found)
+	{
+		int			i;
+
+		for (i = 0; i < PREDLOCK_REL_SUMMARY_SIZE; i++)
+			pg_atomic_init_u32(&PredicateLockRelSummary[i], 0);
+	}
+
 	/*
 	 * Initialize the SLRU storage for old committed serializable
 	 * transactions.
@@ -1393,6 +1435,10 @@ PredicateLockShmemSize(void)
 	/* Head for list of finished serializable transactions. */
 	size = add_size(size, sizeof(SHM_QUEUE));
 
+	/* Per-relation target summary. */
+	size = add_size(size, mul_size(PREDLOCK_REL_SUMMARY_SIZE,
+								   sizeof(pg_atomic_uint32)));
+
 	/* Shared memory structures for SLRU tracking of old committed xids. */
 	size = add_size(size, sizeof(SerialControlData));
 	size = add_size(size, SimpleLruShmemSize(NUM_SERIAL_BUFFERS, 0));
@@ -2178,6 +2224,7 @@ RemoveTargetIfNoLongerUsed(PREDICATELOCKTARGET *target, uint32 targettaghash)
 										   targettaghash,
 										   HASH_REMOVE, NULL);
 	Assert(rmtarget == target);
+	pg_atomic_fetch_sub_u32(PredicateLockTargetSummarySlot(&target->tag), 1);
 }
 
 /*
@@ -2470,7 +2517,10 @@ CreatePredicateLock(const PREDICATELOCKTARGETTAG *targettag,
 				 errmsg("out of shared memory"),
 				 errhint("You might need to increase max_pred_locks_per_transaction.")));
 	if (!found)
+	{
 		SHMQueueInit(&(target->predicateLocks));
+		pg_atomic_fetch_add_u32(PredicateLockTargetSummarySlot(targettag), 1);
+	}
 
 	/* We've got the sxact and target, make sure they're joined. */
 	locktag.myTarget = target;
@@ -2810,7 +2860,10 @@ TransferPredicateLocksToNewTarget(PREDICATELOCKTARGETTAG oldtargettag,
 
 		/* If we created a new entry, initialize it */
 		if (!found)
+		{
 			SHMQueueInit(&(newtarget->predicateLocks));
+			pg_atomic_fetch_add_u32(PredicateLockTargetSummarySlot(&newtargettag), 1);
+		}
 
 		newpredlocktag.myTarget = newtarget;
 
@@ -3045,7 +3098,10 @@ DropAllPredicateLocksFromTable(Relation relation, bool transfer)
 													 heaptargettaghash,
 													 HASH_ENTER, &found);
 			if (!found)
+			{
 				SHMQueueInit(&heaptarget->predicateLocks);
+				pg_atomic_fetch_add_u32(PredicateLockTargetSummarySlot(&heaptargettag), 1);
+			}
 		}
 
 		/*
@@ -3121,6 +3177,7 @@ DropAllPredicateLocksFromTable(Relation relation, bool transfer)
 			oldpredlock = nextpredlock;
 		}
 
+		pg_atomic_fetch_sub_u32(PredicateLockTargetSummarySlot(&oldtarget->tag), 1);
 		hash_search(PredicateLockTargetHash, &oldtarget->tag, HASH_REMOVE,
 					&found);
 		Assert(found);
@@ -4076,6 +4133,10 @@ XidIsConcurrent(TransactionId xid)
 	if (TransactionIdFollowsOrEquals(xid, snap->xmax))
 		return true;
 
+	/* CSN snapshots don't list the concurrent transactions */
+	if (CommitSeqNoIsValid(snap->snapshotcsn))
+		return XidInMVCCSnapshot(xid, snap);
+
 	for (i = 0; i < snap->xcnt; i++)
 	{
 		if (xid == snap->xip[i])
@@ -4464,6 +4525,17 @@ CheckForSerializableConflictIn(Relation relation, ItemPointer tid, BlockNumber b
 	 */
 	MyXactDidWrite = true;
 
+	/*
+	 * If nothing in the relation is predicate-locked, there's nothing to
+	 * conflict with.  Granularity promotion acquires the coarser lock before
+	 * releasing the finer ones, so it never makes the counter drop to zero
+	 * while a lock on the relation is held.
+	 */
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(PredicateLockRelSummarySlot(relation->rd_node.dbNode,
+													   relation->rd_id)) == 0)
+		return;
+
 	/*
 	 * It is important that we check for locks from the finest granularity to
 	 * the coarsest granularity, so that granularity promotion doesn't cause
@@ -95,6 +95,22 @@ static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
 
 
+/*
+ * Size of the fast-path lock arrays of one PGPROC.
+ */
+static Size
+FastPathLockArraysSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(mul_size(FastPathLockGroupsPerBackend, sizeof(uint64)));
+	size = add_size(size,
+					MAXALIGN(mul_size(FastPathLockSlotsPerBackend(),
+									  sizeof(Oid))));
+
+	return size;
+}
+
 /*
  * Report shared-memory space needed by InitProcGlobal.
  */
@@ -114,6 +130,8 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->subxidStates)));
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->statusFlags)));
 
+	size = add_size(size, mul_size(TotalProcs, FastPathLockArraysSize()));
+
 	return size;
 }
 
@@ -163,6 +181,8 @@ InitProcGlobal(void)
 				j;
 	bool		found;
 	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
+	char	   *fpPtr;
+	Size		fpLockBitsSize;
 
 	/* Create the ProcGlobal shared structure */
 	ProcGlobal = (PROC_HDR *)
@@ -214,10 +234,22 @@ InitProcGlobal(void)
 	ProcGlobal->statusFlags = (uint8 *) ShmemAlloc(TotalProcs * sizeof(*ProcGlobal->statusFlags));
 	MemSet(ProcGlobal->statusFlags, 0, TotalProcs * sizeof(*ProcGlobal->statusFlags));
 
+	/*
+	 * Allocate the fast-path lock arrays, whose size is only known at
+	 * startup; each PGPROC gets its lock bits followed by its relation OIDs.
+	 */
+	fpPtr = ShmemAlloc(TotalProcs * FastPathLockArraysSize());
+	MemSet(fpPtr, 0, TotalProcs * FastPathLockArraysSize());
+	fpLockBitsSize = MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		procs[i].fpRelId = (Oid *) (fpPtr + fpLockBitsSize);
+		fpPtr += FastPathLockArraysSize();
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and fpInfoLock.  Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -1785,6 +1817,36 @@ static void
 CheckDeadLock(void)
 {
 	int			i;
+	LWLock	   *partitionLock;
+	bool		awoken;
+	instr_time	start_time;
+	instr_time	duration;
+
+	Assert(lockAwaited != NULL);
+
+	/*
+	 * If we've been awoken by anyone in the interim, we've nothing to do.
+	 * Our own lock's partition lock is enough to tell, see below, so check
+	 * that before locking the whole lock table.
+	 */
+	partitionLock = LockHashPartitionLock(lockAwaited->hashcode);
+	LWLockAcquire(partitionLock, LW_SHARED);
+	awoken = (MyProc->links.prev == NULL ||
+			  MyProc->links.next == NULL);
+	LWLockRelease(partitionLock);
+	if (awoken)
+		return;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	/*
+	 * Only one process at a time checks for deadlocks.  Otherwise, processes
+	 * whose deadlock_timeout expires at the same time would queue up on the
+	 * lock partition locks, each holding some of them while waiting for the
+	 * others, which stalls all locking until every one of them has finished
+	 * its check.  This way, others can get at the lock table in between.
+	 */
+	LWLockAcquire(DeadlockCheckLock, LW_EXCLUSIVE);
 
 	/*
 	 * Acquire exclusive lock on the entire shared lock data structures. Must
@@ -1860,6 +1922,12 @@ CheckDeadLock(void)
 check_done:
 	for (i = NUM_LOCK_PARTITIONS; --i >= 0;)
 		LWLockRelease(LockHashPartitionLockByIndex(i));
+
+	LWLockRelease(DeadlockCheckLock);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start_time);
+	pgstat_report_deadlock_check(INSTR_TIME_GET_MICROSEC(duration));
 }
 
 /*
@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -87,6 +88,17 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/*
+ * With io_direct = data, relation files are opened with PG_O_DIRECT, which
+ * requires the memory of every read and write to be aligned.  Shared and
+ * local buffers always are, but callers like index builds pass their own
+ * pages; those are copied through this aligned block.
+ */
+static char *md_io_bounce = NULL;
+
+#define MD_IO_IS_ALIGNED(p) \
+	(((uintptr_t) (p) & (PG_IO_ALIGN_SIZE - 1)) == 0)
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rnode,xx_forknum,xx_segno) \
@@ -121,6 +133,8 @@ static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
 						 bool isRedo);
+static inline int _mdfd_open_flags(void);
+static char *md_bounce_buffer(void);
 static MdfdVec *mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior);
 static void register_dirty_segment(SMgrRelation reln, ForkNumber forknum,
 								   MdfdVec *seg);
@@ -152,6 +166,33 @@ mdinit(void)
 								  ALLOCSET_DEFAULT_SIZES);
 }
 
+/*
+ * Flags for opening relation files.
+ */
+static inline int
+_mdfd_open_flags(void)
+{
+	int			flags = O_RDWR | PG_BINARY;
+
+	if (io_direct_flags & IO_DIRECT_DATA)
+		flags |= PG_O_DIRECT;
+
+	return flags;
+}
+
+/*
+ * Return the aligned block used for direct I/O on unaligned caller memory.
+ */
+static char *
+md_bounce_buffer(void)
+{
+	if (md_io_bounce == NULL)
+		md_io_bounce = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(MdCxt, BLCKSZ + PG_IO_ALIGN_SIZE));
+	return md_io_bounce;
+}
+
 /*
  *	mdexists() -- Does the physical file exist?
  *
@@ -201,14 +242,14 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags() | O_CREAT | O_EXCL);
 
 	if (fd < 0)
 	{
 		int			save_errno = errno;
 
 		if (isRedo)
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+			fd = PathNameOpenFile(path, _mdfd_open_flags());
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -442,6 +483,9 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if ((io_direct_flags & IO_DIRECT_DATA) && !MD_IO_IS_ALIGNED(buffer))
+		buffer = memcpy(md_bounce_buffer(), buffer, BLCKSZ);
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -465,6 +509,101 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks zeroed blocks to the specified relation,
+ *		starting at blocknum.
+ *
+ *		This is like calling mdextend() for each of the blocks, but for more
+ *		than one block in a segment, the space is reserved with a single
+ *		FileFallocate() rather than by writing out zeroes.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum,
+			 BlockNumber blocknum, int nblocks, bool skipFsync)
+{
+	BlockNumber curblocknum = blocknum;
+	int			remblocks = nblocks;
+
+	Assert(nblocks > 0);
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* see mdextend() */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	while (remblocks > 0)
+	{
+		BlockNumber segstartblock = curblocknum % ((BlockNumber) RELSEG_SIZE);
+		off_t		seekpos = (off_t) BLCKSZ * segstartblock;
+		int			numblocks;
+		MdfdVec    *v;
+
+		/* don't cross a segment boundary in one go */
+		numblocks = Min(remblocks, (int) (RELSEG_SIZE - segstartblock));
+
+		v = _mdfd_getseg(reln, forknum, curblocknum, skipFsync, EXTENSION_CREATE);
+
+		if (numblocks == 1 ||
+			FileFallocate(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * numblocks,
+						  WAIT_EVENT_DATA_FILE_EXTEND) != 0)
+		{
+			char	   *zerobuf;
+
+			if (numblocks > 1 && errno != EOPNOTSUPP)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\": %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+
+			/* no fallocate support, write the zeroes out */
+			zerobuf = md_bounce_buffer();
+			MemSet(zerobuf, 0, BLCKSZ);
+
+			for (int i = 0; i < numblocks; i++)
+			{
+				int			nbytes;
+
+				nbytes = FileWrite(v->mdfd_vfd, zerobuf, BLCKSZ,
+								   seekpos + (off_t) BLCKSZ * i,
+								   WAIT_EVENT_DATA_FILE_EXTEND);
+				if (nbytes != BLCKSZ)
+				{
+					if (nbytes < 0)
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not extend file \"%s\": %m",
+										FilePathName(v->mdfd_vfd)),
+								 errhint("Check free disk space.")));
+					/* short write: complain appropriately */
+					ereport(ERROR,
+							(errcode(ERRCODE_DISK_FULL),
+							 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+									FilePathName(v->mdfd_vfd),
+									nbytes, BLCKSZ, curblocknum + i),
+							 errhint("Check free disk space.")));
+				}
+			}
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		remblocks -= numblocks;
+		curblocknum += numblocks;
+	}
+}
+
 /*
  *	mdopenfork() -- Open one fork of the specified relation.
  *
@@ -488,7 +627,7 @@ mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags());
 
 	if (fd < 0)
 	{
@@ -550,25 +689,47 @@ mdclose(SMgrRelation reln, ForkNumber forknum)
 }
 
 /*
- *	mdprefetch() -- Initiate asynchronous read of the specified block of a relation
+ *	mdprefetch() -- Initiate asynchronous read of the specified blocks of a
+ *					relation
+ *
+ * One request is issued for each segment file the range touches.
  */
 bool
-mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   int nblocks)
 {
 #ifdef USE_PREFETCH
-	off_t		seekpos;
-	MdfdVec    *v;
+	Assert(nblocks > 0);
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false,
-					 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
-	if (v == NULL)
-		return false;
+	/* the kernel's cache is pointless when reads bypass it */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return true;
 
-	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		MdfdVec    *v;
+		int			nblocks_this_segment;
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
+		if (v == NULL)
+			return false;
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (int) (blocknum % ((BlockNumber) RELSEG_SIZE)));
 
-	(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ, WAIT_EVENT_DATA_FILE_PREFETCH);
+		(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ * nblocks_this_segment,
+							WAIT_EVENT_DATA_FILE_PREFETCH);
+
+		nblocks -= nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
 #endif							/* USE_PREFETCH */
 
 	return true;
@@ -584,6 +745,10 @@ void
 mdwriteback(SMgrRelation reln, ForkNumber forknum,
 			BlockNumber blocknum, BlockNumber nblocks)
 {
+	/* with direct I/O, there's no dirty data in the kernel to flush */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return;
+
 	/*
 	 * Issue flush requests in as few requests as possible; have to split at
 	 * segment boundaries though, since those are actually separate files.
@@ -636,6 +801,7 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuf = buffer;
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -650,7 +816,13 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+	if ((io_direct_flags & IO_DIRECT_DATA) && !MD_IO_IS_ALIGNED(buffer))
+		iobuf = md_bounce_buffer();
+
+	nbytes = FileRead(v->mdfd_vfd, iobuf, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+
+	if (iobuf != buffer && nbytes > 0)
+		memcpy(buffer, iobuf, nbytes);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -687,6 +859,91 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read the specified consecutive blocks from a relation.
+ *
+ * Each segment file touched by the range is read with as few preadv calls
+ * as PG_IOV_MAX allows.  If the kernel comes back short, the remaining
+ * blocks are handed to mdread one at a time, which takes care of retrying
+ * and of reporting EOF and errors exactly as it would for a single block.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, int nblocks)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		off_t		seekpos;
+		int			nbytes;
+		int			iovcnt;
+		int			ndone;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		iovcnt = Min(nblocks, PG_IOV_MAX);
+		iovcnt = Min(iovcnt,
+					 RELSEG_SIZE - (int) (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		for (int i = 0; i < iovcnt; i++)
+		{
+			/* for direct I/O, stop before memory that isn't aligned */
+			if ((io_direct_flags & IO_DIRECT_DATA) &&
+				!MD_IO_IS_ALIGNED(buffers[i]))
+			{
+				iovcnt = i;
+				break;
+			}
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = BLCKSZ;
+		}
+
+		if (iovcnt == 0)
+		{
+			/* mdread will bounce it */
+			mdread(reln, forknum, blocknum, buffers[0]);
+			nblocks--;
+			blocknum++;
+			buffers++;
+			continue;
+		}
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode,
+											reln->smgr_rnode.backend);
+
+		nbytes = FileReadV(v->mdfd_vfd, iov, iovcnt, seekpos,
+						   WAIT_EVENT_DATA_FILE_READ);
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode,
+										   reln->smgr_rnode.backend,
+										   nbytes,
+										   BLCKSZ * iovcnt);
+
+		ndone = nbytes > 0 ? nbytes / BLCKSZ : 0;
+		if (ndone < iovcnt)
+		{
+			/* short or failed read: let mdread deal with the first bad block */
+			mdread(reln, forknum, blocknum + ndone, buffers[ndone]);
+			ndone++;
+		}
+
+		nblocks -= ndone;
+		blocknum += ndone;
+		buffers += ndone;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -720,6 +977,9 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if ((io_direct_flags & IO_DIRECT_DATA) && !MD_IO_IS_ALIGNED(buffer))
+		buffer = memcpy(md_bounce_buffer(), buffer, BLCKSZ);
+
 	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
@@ -751,6 +1011,94 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwritev() -- Write the supplied consecutive blocks.
+ *
+ * Like mdreadv, this issues one pwritev per segment file (and PG_IOV_MAX
+ * blocks), and lets mdwrite handle a short write so that the error is
+ * reported exactly as for a single block.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, int nblocks, bool skipFsync)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		off_t		seekpos;
+		int			nbytes;
+		int			iovcnt;
+		int			ndone;
+		MdfdVec    *v;
+
+		iovcnt = Min(nblocks, PG_IOV_MAX);
+		iovcnt = Min(iovcnt,
+					 RELSEG_SIZE - (int) (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		for (int i = 0; i < iovcnt; i++)
+		{
+			/* for direct I/O, stop before memory that isn't aligned */
+			if ((io_direct_flags & IO_DIRECT_DATA) &&
+				!MD_IO_IS_ALIGNED(buffers[i]))
+			{
+				iovcnt = i;
+				break;
+			}
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = BLCKSZ;
+		}
+
+		if (iovcnt <= 1)
+		{
+			/* nothing to combine; mdwrite will bounce it if needed */
+			mdwrite(reln, forknum, blocknum, buffers[0], skipFsync);
+			nblocks--;
+			blocknum++;
+			buffers++;
+			continue;
+		}
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
+											 reln->smgr_rnode.node.spcNode,
+											 reln->smgr_rnode.node.dbNode,
+											 reln->smgr_rnode.node.relNode,
+											 reln->smgr_rnode.backend);
+
+		nbytes = FileWriteV(v->mdfd_vfd, iov, iovcnt, seekpos,
+							WAIT_EVENT_DATA_FILE_WRITE);
+
+		TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode,
+											reln->smgr_rnode.backend,
+											nbytes,
+											BLCKSZ * iovcnt);
+
+		ndone = nbytes > 0 ? nbytes / BLCKSZ : 0;
+
+		if (ndone > 0 && !skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		if (ndone < iovcnt)
+		{
+			/* short or failed write: let mdwrite deal with the first block */
+			mdwrite(reln, forknum, blocknum + ndone, buffers[ndone], skipFsync);
+			ndone++;
+		}
+
+		nblocks -= ndone;
+		blocknum += ndone;
+		buffers += ndone;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -950,6 +1298,7 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
 							FilePathName(v->mdfd_vfd))));
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC, 1);
 
 		/* Close inactive segments immediately */
 		if (segno > min_inactive_seg)
@@ -991,6 +1340,7 @@ register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
 							FilePathName(seg->mdfd_vfd))));
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC, 1);
 	}
 }
 
@@ -1150,7 +1500,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags);
+	fd = PathNameOpenFile(fullpath, _mdfd_open_flags() | oflags);
 
 	pfree(fullpath);
 
@@ -1364,6 +1714,9 @@ mdsyncfiletag(const FileTag *ftag, char *path)
 	result = FileSync(file, WAIT_EVENT_DATA_FILE_SYNC);
 	save_errno = errno;
 
+	if (result >= 0)
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC, 1);
+
 	if (need_to_close)
 		FileClose(file);
 
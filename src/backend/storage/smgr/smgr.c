@@ -6,6 +6,9 @@
  *	  All file system operations in POSTGRES dispatch through these
  *	  routines.
  *
+ *	  This module also keeps a shared-memory cache of relation fork sizes,
+ *	  so that smgrnblocks() doesn't have to ask the kernel every time.
+ *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -21,7 +24,9 @@
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -50,12 +55,21 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
-								  BlockNumber blocknum);
+								  BlockNumber blocknum, int nblocks);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   int nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum, char **buffers,
+								int nblocks, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -75,9 +89,12 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
+		.smgr_readv = mdreadv,
 		.smgr_write = mdwrite,
+		.smgr_writev = mdwritev,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
 		.smgr_truncate = mdtruncate,
@@ -95,8 +112,117 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * The relation size cache maps a relation fork to its size in blocks, for
+ * all permanent and unlogged relations, shared by all backends.
+ *
+ * Every change to a fork's size goes through this module, so it keeps the
+ * entries up to date: extensions advance a known size, truncations forget
+ * it, and unlinking a relation removes its entries.  DROP DATABASE and ALTER
+ * DATABASE SET TABLESPACE remove files wholesale, and must call
+ * smgrdropdb() to forget any sizes of the database's relations.
+ *
+ * An entry whose size is unknown is filled in by the next smgrnblocks(),
+ * which asks the storage manager.  To avoid installing an answer that a
+ * concurrent extension or truncation has already made stale, each entry has
+ * a change counter that such operations advance; the answer is stored only
+ * if the counter is still the same as it was before the storage manager was
+ * asked.  For that to work, the entry must exist before asking, so a missing
+ * entry is created first, with an unknown size.
+ *
+ * When the cache is full, sizes simply aren't cached.  Entries are only
+ * removed when their relation goes away.
+ */
+#define RELSIZE_CACHE_PARTITIONS	16
+
+typedef struct RelSizeCacheTag
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} RelSizeCacheTag;
+
+typedef struct RelSizeCacheEnt
+{
+	RelSizeCacheTag tag;		/* hash key, must be first */
+	BlockNumber nblocks;		/* size, or InvalidBlockNumber if unknown */
+	uint32		changecount;	/* advanced by each change of the size */
+} RelSizeCacheEnt;
+
+/* GUC variable */
+int			shared_relsize_cache_entries = 8192;
+
+static HTAB *RelSizeCacheHash = NULL;
+static LWLockPadded *RelSizeCacheLocks = NULL;
+
+#define RelSizeCachePartitionLock(hashcode) \
+	(&RelSizeCacheLocks[(hashcode) % RELSIZE_CACHE_PARTITIONS].lock)
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static bool relsize_cache_usable(SMgrRelation reln);
+static BlockNumber relsize_cache_nblocks(SMgrRelation reln,
+										 ForkNumber forknum);
+static void relsize_cache_extended(SMgrRelation reln, ForkNumber forknum,
+								   BlockNumber newnblocks);
+static void relsize_cache_forget(RelFileNode rnode, ForkNumber forknum,
+								 bool remove);
+
+
+/*
+ * Size of the shared relation size cache
+ */
+Size
+SmgrShmemSize(void)
+{
+	Size		size = 0;
+
+	if (shared_relsize_cache_entries <= 0)
+		return 0;
+
+	size = add_size(size, hash_estimate_size(shared_relsize_cache_entries,
+											 sizeof(RelSizeCacheEnt)));
+	size = add_size(size, mul_size(RELSIZE_CACHE_PARTITIONS,
+								   sizeof(LWLockPadded)));
+	return size;
+}
+
+/*
+ * Create or attach to the shared relation size cache
+ */
+void
+SmgrShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (shared_relsize_cache_entries <= 0)
+		return;
+
+	RelSizeCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Relation Size Cache Locks",
+						mul_size(RELSIZE_CACHE_PARTITIONS,
+								 sizeof(LWLockPadded)),
+						&found);
+	if (!found)
+	{
+		int			i;
+
+		for (i = 0; i < RELSIZE_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&RelSizeCacheLocks[i].lock,
+							 LWTRANCHE_RELSIZE_CACHE);
+	}
+
+	info.keysize = sizeof(RelSizeCacheTag);
+	info.entrysize = sizeof(RelSizeCacheEnt);
+	info.num_partitions = RELSIZE_CACHE_PARTITIONS;
+
+	RelSizeCacheHash = ShmemInitHash("Relation Size Cache",
+									 shared_relsize_cache_entries,
+									 shared_relsize_cache_entries,
+									 &info,
+									 HASH_ELEM | HASH_BLOBS |
+									 HASH_PARTITION | HASH_FIXED_SIZE);
+}
 
 
 /*
@@ -298,6 +424,32 @@ smgrcloseall(void)
 		smgrclose(reln);
 }
 
+/*
+ *	smgrresetnblocksall() -- Forget the cached sizes of all relations.
+ *
+ * Sizes are only cached during recovery, where normally the startup process
+ * is the only one changing them.  With parallel redo, another process may
+ * have extended a relation since we last looked.
+ */
+void
+smgrresetnblocksall(void)
+{
+	HASH_SEQ_STATUS status;
+	SMgrRelation reln;
+
+	/* Nothing to do if hashtable not set up */
+	if (SMgrRelationHash == NULL)
+		return;
+
+	hash_seq_init(&status, SMgrRelationHash);
+
+	while ((reln = (SMgrRelation) hash_seq_search(&status)) != NULL)
+	{
+		for (int i = 0; i <= MAX_FORKNUM; ++i)
+			reln->smgr_cached_nblocks[i] = InvalidBlockNumber;
+	}
+}
+
 /*
  *	smgrclosenode() -- Close SMgrRelation object for given RelFileNode,
  *					   if one exists.
@@ -442,7 +594,11 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 		int			which = rels[i]->smgr_which;
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+			if (relsize_cache_usable(rels[i]))
+				relsize_cache_forget(rnodes[i].node, forknum, true);
+		}
 	}
 
 	pfree(rnodes);
@@ -474,19 +630,54 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
 	else
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	if (relsize_cache_usable(reln))
+		relsize_cache_extended(reln, forknum, blocknum + 1);
 }
 
 /*
- *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
+ *	smgrzeroextend() -- Add nblocks zeroed blocks to a file, starting at
+ *						blocknum.
+ *
+ *		This is equivalent to calling smgrextend() with an all-zeroes page
+ *		for each block, but lets the storage manager reserve the space with
+ *		a single request.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	/* see smgrextend() */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	if (relsize_cache_usable(reln))
+		relsize_cache_extended(reln, forknum, blocknum + nblocks);
+}
+
+/*
+ *	smgrprefetch() -- Initiate asynchronous read of the specified blocks of a
+ *					  relation.
+ *
+ *		nblocks consecutive blocks starting at blocknum are prefetched.  Doing
+ *		this for a range, rather than block by block, lets the storage manager
+ *		issue fewer and larger requests.
  *
  *		In recovery only, this can return false to indicate that a file
  *		doesn't	exist (presumably it has been dropped by a later WAL
  *		record).
  */
 bool
-smgrprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+smgrprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 int nblocks)
 {
-	return smgrsw[reln->smgr_which].smgr_prefetch(reln, forknum, blocknum);
+	return smgrsw[reln->smgr_which].smgr_prefetch(reln, forknum, blocknum,
+												  nblocks);
 }
 
 /*
@@ -504,6 +695,21 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].smgr_read(reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read nblocks consecutive blocks, starting at blocknum, into
+ *				   the supplied buffers.
+ *
+ *		The result is the same as calling smgrread() for each block, but the
+ *		storage manager is free to use fewer, larger system calls.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, int nblocks)
+{
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, buffers,
+										nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -527,6 +733,21 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 										buffer, skipFsync);
 }
 
+/*
+ *	smgrwritev() -- Write nblocks consecutive blocks, starting at blocknum,
+ *					from the supplied buffers.
+ *
+ *		Same as calling smgrwrite() for each block, but the storage manager
+ *		may combine the writes.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char **buffers, int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_writev(reln, forknum, blocknum, buffers,
+										 nblocks, skipFsync);
+}
+
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
@@ -554,7 +775,10 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 	if (result != InvalidBlockNumber)
 		return result;
 
-	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	if (relsize_cache_usable(reln))
+		result = relsize_cache_nblocks(reln, forknum);
+	else
+		result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
 
 	reln->smgr_cached_nblocks[forknum] = result;
 
@@ -619,9 +843,15 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	{
 		/* Make the cached size is invalid if we encounter an error. */
 		reln->smgr_cached_nblocks[forknum[i]] = InvalidBlockNumber;
+		if (relsize_cache_usable(reln))
+			relsize_cache_forget(reln->smgr_rnode.node, forknum[i], false);
 
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
 
+		/* Also stop anyone who looked at the size meanwhile from caching it */
+		if (relsize_cache_usable(reln))
+			relsize_cache_forget(reln->smgr_rnode.node, forknum[i], false);
+
 		/*
 		 * We might as well update the local smgr_cached_nblocks values. The
 		 * smgr cache inval message that this function sent will cause other
@@ -633,6 +863,36 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	}
 }
 
+/*
+ *	smgrdropdb() -- Forget the cached sizes of all relations of a database.
+ *
+ *		To be called when a database's files are removed or moved other than
+ *		through this module.
+ */
+void
+smgrdropdb(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	RelSizeCacheEnt *entry;
+	int			i;
+
+	if (RelSizeCacheHash == NULL)
+		return;
+
+	for (i = 0; i < RELSIZE_CACHE_PARTITIONS; i++)
+		LWLockAcquire(&RelSizeCacheLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, RelSizeCacheHash);
+	while ((entry = (RelSizeCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->tag.rnode.dbNode == dbid)
+			hash_search(RelSizeCacheHash, &entry->tag, HASH_REMOVE, NULL);
+	}
+
+	for (i = RELSIZE_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&RelSizeCacheLocks[i].lock);
+}
+
 /*
  *	smgrimmedsync() -- Force the specified relation to stable storage.
  *
@@ -693,3 +953,153 @@ AtEOXact_SMgr(void)
 		smgrclose(rel);
 	}
 }
+
+/*
+ * Can the shared relation size cache be used for this relation?  Temporary
+ * relations are private to their backend, and their relfilenode numbers
+ * aren't unique against those of permanent relations.
+ */
+static bool
+relsize_cache_usable(SMgrRelation reln)
+{
+	return RelSizeCacheHash != NULL &&
+		!RelFileNodeBackendIsTemp(reln->smgr_rnode);
+}
+
+/*
+ * Return the size of a relation fork from the shared cache, asking the
+ * storage manager and remembering the answer if it's not known.
+ */
+static BlockNumber
+relsize_cache_nblocks(SMgrRelation reln, ForkNumber forknum)
+{
+	RelSizeCacheTag tag;
+	RelSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	uint32		changecount;
+	BlockNumber result;
+	bool		found;
+
+	tag.rnode = reln->smgr_rnode.node;
+	tag.forknum = forknum;
+	hashcode = get_hash_value(RelSizeCacheHash, &tag);
+	partitionLock = RelSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (RelSizeCacheEnt *)
+		hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry && entry->nblocks != InvalidBlockNumber)
+	{
+		result = entry->nblocks;
+		LWLockRelease(partitionLock);
+		return result;
+	}
+	LWLockRelease(partitionLock);
+
+	/* Make sure there's an entry whose changes we can detect */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (RelSizeCacheEnt *)
+		hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+									HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		/* cache is full */
+		LWLockRelease(partitionLock);
+		return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	}
+	if (!found)
+	{
+		entry->nblocks = InvalidBlockNumber;
+		entry->changecount = 0;
+	}
+	else if (entry->nblocks != InvalidBlockNumber)
+	{
+		/* someone else filled it in meanwhile */
+		result = entry->nblocks;
+		LWLockRelease(partitionLock);
+		return result;
+	}
+	changecount = entry->changecount;
+	LWLockRelease(partitionLock);
+
+	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (RelSizeCacheEnt *)
+		hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry && entry->changecount == changecount &&
+		entry->nblocks == InvalidBlockNumber)
+		entry->nblocks = result;
+	LWLockRelease(partitionLock);
+
+	return result;
+}
+
+/*
+ * Note that a relation fork has been extended to at least newnblocks blocks.
+ */
+static void
+relsize_cache_extended(SMgrRelation reln, ForkNumber forknum,
+					   BlockNumber newnblocks)
+{
+	RelSizeCacheTag tag;
+	RelSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	tag.rnode = reln->smgr_rnode.node;
+	tag.forknum = forknum;
+	hashcode = get_hash_value(RelSizeCacheHash, &tag);
+	partitionLock = RelSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (RelSizeCacheEnt *)
+		hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry)
+	{
+		entry->changecount++;
+		if (entry->nblocks != InvalidBlockNumber &&
+			entry->nblocks < newnblocks)
+			entry->nblocks = newnblocks;
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Forget the size of a relation fork, or, if remove is true, remove its
+ * entry entirely.
+ */
+static void
+relsize_cache_forget(RelFileNode rnode, ForkNumber forknum, bool remove)
+{
+	RelSizeCacheTag tag;
+	RelSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	tag.rnode = rnode;
+	tag.forknum = forknum;
+	hashcode = get_hash_value(RelSizeCacheHash, &tag);
+	partitionLock = RelSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	if (remove)
+		hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+									HASH_REMOVE, NULL);
+	else
+	{
+		entry = (RelSizeCacheEnt *)
+			hash_search_with_hash_value(RelSizeCacheHash, &tag, hashcode,
+										HASH_FIND, NULL);
+		if (entry)
+		{
+			entry->changecount++;
+			entry->nblocks = InvalidBlockNumber;
+		}
+	}
+	LWLockRelease(partitionLock);
+}
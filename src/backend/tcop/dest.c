@@ -39,6 +39,7 @@
 #include "executor/tstoreReceiver.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
+#include "postmaster/proxy.h"
 #include "utils/portal.h"
 
 
@@ -278,6 +279,8 @@ ReadyForQuery(CommandDest dest)
 			{
 				StringInfoData buf;
 
+				ReportPooledSessionState();
+
 				pq_beginmessage(&buf, 'Z');
 				pq_sendbyte(&buf, TransactionBlockStatusCode());
 				pq_endmessage(&buf);
@@ -42,8 +42,10 @@
 #include "catalog/pg_type.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "common/hashfn.h"
 #include "executor/spi.h"
 #include "jit/jit.h"
+#include "lib/ilist.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
@@ -75,6 +77,7 @@
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
 #include "tcop/utility.h"
+#include "utils/backend_profile.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/ps_status.h"
@@ -105,6 +108,9 @@ int			PostAuthDelay = 0;
 /* Time between checks that the client is still connected. */
 int			client_connection_check_interval = 0;
 
+/* Number of statements to keep in the simple query cache. */
+int			simple_query_cache_size = 0;
+
 /* ----------------
  *		private typedefs etc
  * ----------------
@@ -118,6 +124,14 @@ typedef struct BindParamCbData
 	const char *paramval;		/* textual input string, if available */
 } BindParamCbData;
 
+/* cached input function of a bind parameter, see bind_read_params() */
+typedef struct BindParamIOInfo
+{
+	bool		valid;			/* have we looked up the function yet? */
+	Oid			typioparam;
+	FmgrInfo	finfo;			/* input or receive function */
+} BindParamIOInfo;
+
 /* ----------------
  *		private variables
  * ----------------
@@ -168,6 +182,26 @@ static bool ignore_till_sync = false;
  */
 static CachedPlanSource *unnamed_stmt_psrc = NULL;
 
+/*
+ * Statements received with the simple Query protocol that we keep the parse
+ * trees and plans of, when simple_query_cache_size > 0.  A query string is
+ * only cached the second time it's seen; the first time, we just remember
+ * its hash.  The entries are kept in LRU order, most recently used first.
+ *
+ * Plans can depend on the settings they were made with, so the whole cache
+ * is thrown away whenever any setting has changed.
+ */
+typedef struct SimpleQueryCacheEntry
+{
+	uint64		hash;			/* hash of the query string (hash key) */
+	CachedPlanSource *plansource;	/* the statement, or NULL if only seen */
+	dlist_node	lru_node;		/* link in simple_query_cache_lru */
+} SimpleQueryCacheEntry;
+
+static HTAB *simple_query_cache = NULL;
+static dlist_head simple_query_cache_lru = DLIST_STATIC_INIT(simple_query_cache_lru);
+static uint64 simple_query_cache_guc_count = 0;
+
 /* assorted command-line switches */
 static const char *userDoption = NULL;	/* -D switch */
 static bool EchoQuery = false;	/* -E switch */
@@ -203,6 +237,12 @@ static bool IsTransactionExitStmt(Node *parsetree);
 static bool IsTransactionExitStmtList(List *pstmts);
 static bool IsTransactionStmtList(List *pstmts);
 static void drop_unnamed_stmt(void);
+static CachedPlanSource *simple_query_cache_lookup(const char *query_string,
+												   bool *seen);
+static void simple_query_cache_insert(const char *query_string,
+									  CachedPlanSource *plansource);
+static void simple_query_cache_remove(SimpleQueryCacheEntry *entry);
+static bool simple_query_is_cacheable(RawStmt *parsetree);
 static void log_disconnections(int code, Datum arg);
 static void enable_statement_timeout(void);
 static void disable_statement_timeout(void);
@@ -402,6 +442,7 @@ SocketBackend(StringInfo inBuf)
 			break;
 
 		case 'B':				/* bind */
+		case 'b':				/* bulk bind */
 		case 'P':				/* parse */
 			maxmsglen = PQ_LARGE_MESSAGE_LIMIT;
 			doing_extended_query_message = true;
@@ -962,6 +1003,8 @@ exec_simple_query(const char *query_string)
 	bool		save_log_statement_stats = log_statement_stats;
 	bool		was_logged = false;
 	bool		use_implicit_block;
+	CachedPlanSource *plansource = NULL;
+	bool		cache_seen = false;
 	char		msec_str[32];
 
 	/*
@@ -1003,10 +1046,17 @@ exec_simple_query(const char *query_string)
 	oldcontext = MemoryContextSwitchTo(MessageContext);
 
 	/*
-	 * Do basic parsing of the query or queries (this should be safe even if
-	 * we are in aborted transaction state!)
+	 * If the query string is in the simple query cache, reuse its raw parse
+	 * tree.  Otherwise, do basic parsing of the query or queries (this should
+	 * be safe even if we are in aborted transaction state!)
 	 */
-	parsetree_list = pg_parse_query(query_string);
+	if (simple_query_cache_size > 0)
+		plansource = simple_query_cache_lookup(query_string, &cache_seen);
+
+	if (plansource != NULL)
+		parsetree_list = list_make1(plansource->raw_parse_tree);
+	else
+		parsetree_list = pg_parse_query(query_string);
 
 	/* Log immediately if dictated by log_statement */
 	if (check_log_statement(parsetree_list))
@@ -1045,6 +1095,7 @@ exec_simple_query(const char *query_string)
 		MemoryContext per_parsetree_context = NULL;
 		List	   *querytree_list,
 				   *plantree_list;
+		CachedPlan *cplan = NULL;
 		Portal		portal;
 		DestReceiver *receiver;
 		int16		format;
@@ -1127,11 +1178,62 @@ exec_simple_query(const char *query_string)
 		else
 			oldcontext = MemoryContextSwitchTo(MessageContext);
 
-		querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
-												NULL, 0, NULL);
+		/*
+		 * If we've seen this query string before, add the statement to the
+		 * simple query cache.  The CachedPlanSource must be created before
+		 * parse analysis, since it needs to see the unmodified raw parse
+		 * tree.
+		 */
+		if (plansource == NULL && cache_seen &&
+			list_length(parsetree_list) == 1 &&
+			simple_query_is_cacheable(parsetree))
+		{
+			plansource = CreateCachedPlan(parsetree, query_string, commandTag);
+			querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
+													NULL, 0, NULL);
+			CompleteCachedPlan(plansource,
+							   querytree_list,
+							   NULL,
+							   NULL,
+							   0,
+							   NULL,
+							   NULL,
+							   CURSOR_OPT_PARALLEL_OK,	/* allow parallel mode */
+							   false);	/* result may change with the tables */
+			SaveCachedPlan(plansource);
+			simple_query_cache_insert(query_string, plansource);
+		}
+
+		if (plansource != NULL)
+		{
+			ListCell   *lc;
 
-		plantree_list = pg_plan_queries(querytree_list, query_string,
-										CURSOR_OPT_PARALLEL_OK, NULL);
+			/*
+			 * Use the cached plan, which GetCachedPlan() replans first if
+			 * anything it depends on has changed.
+			 */
+			cplan = GetCachedPlan(plansource, NULL, NULL, NULL);
+			plantree_list = cplan->stmt_list;
+
+			foreach(lc, plantree_list)
+			{
+				PlannedStmt *stmt = lfirst_node(PlannedStmt, lc);
+
+				if (stmt->queryId != UINT64CONST(0))
+				{
+					pgstat_report_query_id(stmt->queryId, false);
+					break;
+				}
+			}
+		}
+		else
+		{
+			querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
+													NULL, 0, NULL);
+
+			plantree_list = pg_plan_queries(querytree_list, query_string,
+											CURSOR_OPT_PARALLEL_OK, NULL);
+		}
 
 		/*
 		 * Done with the snapshot used for parsing/planning.
@@ -1160,14 +1262,15 @@ exec_simple_query(const char *query_string)
 		/*
 		 * We don't have to copy anything into the portal, because everything
 		 * we are passing here is in MessageContext or the
-		 * per_parsetree_context, and so will outlive the portal anyway.
+		 * per_parsetree_context, and so will outlive the portal anyway.  A
+		 * cached plan is kept pinned by the portal until it's dropped.
 		 */
 		PortalDefineQuery(portal,
 						  NULL,
 						  query_string,
 						  commandTag,
 						  plantree_list,
-						  NULL);
+						  cplan);
 
 		/*
 		 * Start the portal.  No parameters here.
@@ -1572,19 +1675,251 @@ exec_parse_message(const char *query_string,	/* string to execute */
 	debug_query_string = NULL;
 }
 
+/*
+ * bind_read_params
+ *
+ * Read one set of parameter values from a Bind or BulkBind message into a
+ * new ParamListInfo allocated in CurrentMemoryContext.  ioinfo caches the
+ * parameters' input functions; it is filled in on first use, so that a bulk
+ * bind looks them up only once for all of its parameter sets.
+ */
+static ParamListInfo
+bind_read_params(StringInfo input_message, CachedPlanSource *psrc,
+				 Portal portal, int numParams,
+				 int numPFormats, int16 *pformats,
+				 BindParamIOInfo *ioinfo)
+{
+	ParamListInfo params;
+	char	  **knownTextValues = NULL; /* allocate on first use */
+	BindParamCbData one_param_data;
+	ErrorContextCallback params_errcxt;
+
+	/*
+	 * Set up an error callback so that if there's an error in this phase,
+	 * we can report the specific parameter causing the problem.
+	 */
+	one_param_data.portalName = portal->name;
+	one_param_data.paramno = -1;
+	one_param_data.paramval = NULL;
+	params_errcxt.previous = error_context_stack;
+	params_errcxt.callback = bind_param_error_callback;
+	params_errcxt.arg = (void *) &one_param_data;
+	error_context_stack = &params_errcxt;
+
+	params = makeParamList(numParams);
+
+	for (int paramno = 0; paramno < numParams; paramno++)
+	{
+		Oid			ptype = psrc->param_types[paramno];
+		int32		plength;
+		Datum		pval;
+		bool		isNull;
+		StringInfoData pbuf;
+		char		csave;
+		int16		pformat;
+
+		one_param_data.paramno = paramno;
+		one_param_data.paramval = NULL;
+
+		plength = pq_getmsgint(input_message, 4);
+		isNull = (plength == -1);
+
+		if (!isNull)
+		{
+			const char *pvalue = pq_getmsgbytes(input_message, plength);
+
+			/*
+			 * Rather than copying data around, we just set up a phony
+			 * StringInfo pointing to the correct portion of the message
+			 * buffer.  We assume we can scribble on the message buffer so
+			 * as to maintain the convention that StringInfos have a
+			 * trailing null.  This is grotty but is a big win when
+			 * dealing with very large parameter strings.
+			 */
+			pbuf.data = unconstify(char *, pvalue);
+			pbuf.maxlen = plength + 1;
+			pbuf.len = plength;
+			pbuf.cursor = 0;
+
+			csave = pbuf.data[plength];
+			pbuf.data[plength] = '\0';
+		}
+		else
+		{
+			pbuf.data = NULL;	/* keep compiler quiet */
+			csave = 0;
+		}
+
+		if (numPFormats > 1)
+			pformat = pformats[paramno];
+		else if (numPFormats > 0)
+			pformat = pformats[0];
+		else
+			pformat = 0;	/* default = text */
+
+		if (pformat == 0)	/* text mode */
+		{
+			char	   *pstring;
+
+			if (!ioinfo[paramno].valid)
+			{
+				Oid			typinput;
+
+				getTypeInputInfo(ptype, &typinput,
+								 &ioinfo[paramno].typioparam);
+				fmgr_info(typinput, &ioinfo[paramno].finfo);
+				ioinfo[paramno].valid = true;
+			}
+
+			/*
+			 * We have to do encoding conversion before calling the
+			 * typinput routine.
+			 */
+			if (isNull)
+				pstring = NULL;
+			else
+				pstring = pg_client_to_server(pbuf.data, plength);
+
+			/* Now we can log the input string in case of error */
+			one_param_data.paramval = pstring;
+
+			pval = InputFunctionCall(&ioinfo[paramno].finfo, pstring,
+									 ioinfo[paramno].typioparam, -1);
+
+			one_param_data.paramval = NULL;
+
+			/*
+			 * If we might need to log parameters later, save a copy of
+			 * the converted string in MessageContext; then free the
+			 * result of encoding conversion, if any was done.
+			 */
+			if (pstring)
+			{
+				if (log_parameter_max_length_on_error != 0)
+				{
+					MemoryContext oldcxt;
+
+					oldcxt = MemoryContextSwitchTo(MessageContext);
+
+					if (knownTextValues == NULL)
+						knownTextValues =
+							palloc0(numParams * sizeof(char *));
+
+					if (log_parameter_max_length_on_error < 0)
+						knownTextValues[paramno] = pstrdup(pstring);
+					else
+					{
+						/*
+						 * We can trim the saved string, knowing that we
+						 * won't print all of it.  But we must copy at
+						 * least two more full characters than
+						 * BuildParamLogString wants to use; otherwise it
+						 * might fail to include the trailing ellipsis.
+						 */
+						knownTextValues[paramno] =
+							pnstrdup(pstring,
+									 log_parameter_max_length_on_error
+									 + 2 * MAX_MULTIBYTE_CHAR_LEN);
+					}
+
+					MemoryContextSwitchTo(oldcxt);
+				}
+				if (pstring != pbuf.data)
+					pfree(pstring);
+			}
+		}
+		else if (pformat == 1)	/* binary mode */
+		{
+			StringInfo	bufptr;
+
+			/*
+			 * Call the parameter type's binary input converter
+			 */
+			if (!ioinfo[paramno].valid)
+			{
+				Oid			typreceive;
+
+				getTypeBinaryInputInfo(ptype, &typreceive,
+									   &ioinfo[paramno].typioparam);
+				fmgr_info(typreceive, &ioinfo[paramno].finfo);
+				ioinfo[paramno].valid = true;
+			}
+
+			if (isNull)
+				bufptr = NULL;
+			else
+				bufptr = &pbuf;
+
+			pval = ReceiveFunctionCall(&ioinfo[paramno].finfo, bufptr,
+									   ioinfo[paramno].typioparam, -1);
+
+			/* Trouble if it didn't eat the whole buffer */
+			if (!isNull && pbuf.cursor != pbuf.len)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						 errmsg("incorrect binary data format in bind parameter %d",
+								paramno + 1)));
+		}
+		else
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("unsupported format code: %d",
+							pformat)));
+			pval = 0;		/* keep compiler quiet */
+		}
+
+		/* Restore message buffer contents */
+		if (!isNull)
+			pbuf.data[plength] = csave;
+
+		params->params[paramno].value = pval;
+		params->params[paramno].isnull = isNull;
+
+		/*
+		 * We mark the params as CONST.  This ensures that any custom plan
+		 * makes full use of the parameter values.
+		 */
+		params->params[paramno].pflags = PARAM_FLAG_CONST;
+		params->params[paramno].ptype = ptype;
+	}
+
+	/* Pop the per-parameter error callback */
+	error_context_stack = error_context_stack->previous;
+
+	/*
+	 * Once all parameters have been received, prepare for printing them
+	 * in future errors, if configured to do so.  (This is saved in the
+	 * portal, so that they'll appear when the query is executed later.)
+	 */
+	if (log_parameter_max_length_on_error != 0)
+		params->paramValuesStr =
+			BuildParamLogString(params,
+								knownTextValues,
+								log_parameter_max_length_on_error);
+
+	return params;
+}
+
 /*
  * exec_bind_message
  *
  * Process a "Bind" message to create a portal from a prepared statement
+ *
+ * If bulk is true, this is a "BulkBind" message instead, which supplies any
+ * number of parameter sets for the statement.  The portal then executes the
+ * statement once per set, see PortalRunBulk().
  */
 static void
-exec_bind_message(StringInfo input_message)
+exec_bind_message(StringInfo input_message, bool bulk)
 {
 	const char *portal_name;
 	const char *stmt_name;
 	int			numPFormats;
 	int16	   *pformats = NULL;
 	int			numParams;
+	int			numSets = 1;
+	ParamListInfo *bulkParams = NULL;
 	int			numRFormats;
 	int16	   *rformats = NULL;
 	CachedPlanSource *psrc;
@@ -1674,6 +2009,16 @@ exec_bind_message(StringInfo input_message)
 				 errmsg("bind message supplies %d parameters, but prepared statement \"%s\" requires %d",
 						numParams, stmt_name, psrc->num_params)));
 
+	/* A bulk bind goes on with the number of parameter sets */
+	if (bulk)
+	{
+		numSets = pq_getmsgint(input_message, 4);
+		if (numSets < 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("bulk bind message must supply at least one parameter set")));
+	}
+
 	/*
 	 * If we are in aborted transaction state, the only portals we can
 	 * actually run are those containing COMMIT or ROLLBACK commands. We
@@ -1685,7 +2030,7 @@ exec_bind_message(StringInfo input_message)
 	if (IsAbortedTransactionBlockState() &&
 		(!(psrc->raw_parse_tree &&
 		   IsTransactionExitStmt(psrc->raw_parse_tree->stmt)) ||
-		 numParams != 0))
+		 numParams != 0 || bulk))
 		ereport(ERROR,
 				(errcode(ERRCODE_IN_FAILED_SQL_TRANSACTION),
 				 errmsg("current transaction is aborted, "
@@ -1735,201 +2080,30 @@ exec_bind_message(StringInfo input_message)
 
 	/*
 	 * Fetch parameters, if any, and store in the portal's memory context.
+	 * For a bulk bind every parameter set is kept; the first one also serves
+	 * as the portal's parameters for planning and error reporting.
 	 */
+	if (bulk)
+		bulkParams = (ParamListInfo *) palloc0(numSets * sizeof(ParamListInfo));
+
 	if (numParams > 0)
 	{
-		char	  **knownTextValues = NULL; /* allocate on first use */
-		BindParamCbData one_param_data;
+		BindParamIOInfo *ioinfo;
 
-		/*
-		 * Set up an error callback so that if there's an error in this phase,
-		 * we can report the specific parameter causing the problem.
-		 */
-		one_param_data.portalName = portal->name;
-		one_param_data.paramno = -1;
-		one_param_data.paramval = NULL;
-		params_errcxt.previous = error_context_stack;
-		params_errcxt.callback = bind_param_error_callback;
-		params_errcxt.arg = (void *) &one_param_data;
-		error_context_stack = &params_errcxt;
+		ioinfo = (BindParamIOInfo *) palloc0(numParams * sizeof(BindParamIOInfo));
 
-		params = makeParamList(numParams);
-
-		for (int paramno = 0; paramno < numParams; paramno++)
+		for (int setno = 0; setno < numSets; setno++)
 		{
-			Oid			ptype = psrc->param_types[paramno];
-			int32		plength;
-			Datum		pval;
-			bool		isNull;
-			StringInfoData pbuf;
-			char		csave;
-			int16		pformat;
-
-			one_param_data.paramno = paramno;
-			one_param_data.paramval = NULL;
-
-			plength = pq_getmsgint(input_message, 4);
-			isNull = (plength == -1);
-
-			if (!isNull)
-			{
-				const char *pvalue = pq_getmsgbytes(input_message, plength);
-
-				/*
-				 * Rather than copying data around, we just set up a phony
-				 * StringInfo pointing to the correct portion of the message
-				 * buffer.  We assume we can scribble on the message buffer so
-				 * as to maintain the convention that StringInfos have a
-				 * trailing null.  This is grotty but is a big win when
-				 * dealing with very large parameter strings.
-				 */
-				pbuf.data = unconstify(char *, pvalue);
-				pbuf.maxlen = plength + 1;
-				pbuf.len = plength;
-				pbuf.cursor = 0;
-
-				csave = pbuf.data[plength];
-				pbuf.data[plength] = '\0';
-			}
-			else
-			{
-				pbuf.data = NULL;	/* keep compiler quiet */
-				csave = 0;
-			}
-
-			if (numPFormats > 1)
-				pformat = pformats[paramno];
-			else if (numPFormats > 0)
-				pformat = pformats[0];
-			else
-				pformat = 0;	/* default = text */
-
-			if (pformat == 0)	/* text mode */
-			{
-				Oid			typinput;
-				Oid			typioparam;
-				char	   *pstring;
-
-				getTypeInputInfo(ptype, &typinput, &typioparam);
-
-				/*
-				 * We have to do encoding conversion before calling the
-				 * typinput routine.
-				 */
-				if (isNull)
-					pstring = NULL;
-				else
-					pstring = pg_client_to_server(pbuf.data, plength);
-
-				/* Now we can log the input string in case of error */
-				one_param_data.paramval = pstring;
-
-				pval = OidInputFunctionCall(typinput, pstring, typioparam, -1);
-
-				one_param_data.paramval = NULL;
-
-				/*
-				 * If we might need to log parameters later, save a copy of
-				 * the converted string in MessageContext; then free the
-				 * result of encoding conversion, if any was done.
-				 */
-				if (pstring)
-				{
-					if (log_parameter_max_length_on_error != 0)
-					{
-						MemoryContext oldcxt;
-
-						oldcxt = MemoryContextSwitchTo(MessageContext);
-
-						if (knownTextValues == NULL)
-							knownTextValues =
-								palloc0(numParams * sizeof(char *));
-
-						if (log_parameter_max_length_on_error < 0)
-							knownTextValues[paramno] = pstrdup(pstring);
-						else
-						{
-							/*
-							 * We can trim the saved string, knowing that we
-							 * won't print all of it.  But we must copy at
-							 * least two more full characters than
-							 * BuildParamLogString wants to use; otherwise it
-							 * might fail to include the trailing ellipsis.
-							 */
-							knownTextValues[paramno] =
-								pnstrdup(pstring,
-										 log_parameter_max_length_on_error
-										 + 2 * MAX_MULTIBYTE_CHAR_LEN);
-						}
-
-						MemoryContextSwitchTo(oldcxt);
-					}
-					if (pstring != pbuf.data)
-						pfree(pstring);
-				}
-			}
-			else if (pformat == 1)	/* binary mode */
-			{
-				Oid			typreceive;
-				Oid			typioparam;
-				StringInfo	bufptr;
-
-				/*
-				 * Call the parameter type's binary input converter
-				 */
-				getTypeBinaryInputInfo(ptype, &typreceive, &typioparam);
-
-				if (isNull)
-					bufptr = NULL;
-				else
-					bufptr = &pbuf;
-
-				pval = OidReceiveFunctionCall(typreceive, bufptr, typioparam, -1);
-
-				/* Trouble if it didn't eat the whole buffer */
-				if (!isNull && pbuf.cursor != pbuf.len)
-					ereport(ERROR,
-							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
-							 errmsg("incorrect binary data format in bind parameter %d",
-									paramno + 1)));
-			}
-			else
-			{
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-						 errmsg("unsupported format code: %d",
-								pformat)));
-				pval = 0;		/* keep compiler quiet */
-			}
-
-			/* Restore message buffer contents */
-			if (!isNull)
-				pbuf.data[plength] = csave;
-
-			params->params[paramno].value = pval;
-			params->params[paramno].isnull = isNull;
-
-			/*
-			 * We mark the params as CONST.  This ensures that any custom plan
-			 * makes full use of the parameter values.
-			 */
-			params->params[paramno].pflags = PARAM_FLAG_CONST;
-			params->params[paramno].ptype = ptype;
+			ParamListInfo setparams;
+
+			setparams = bind_read_params(input_message, psrc, portal,
+										 numParams, numPFormats, pformats,
+										 ioinfo);
+			if (bulkParams)
+				bulkParams[setno] = setparams;
+			if (setno == 0)
+				params = setparams;
 		}
-
-		/* Pop the per-parameter error callback */
-		error_context_stack = error_context_stack->previous;
-
-		/*
-		 * Once all parameters have been received, prepare for printing them
-		 * in future errors, if configured to do so.  (This is saved in the
-		 * portal, so that they'll appear when the query is executed later.)
-		 */
-		if (log_parameter_max_length_on_error != 0)
-			params->paramValuesStr =
-				BuildParamLogString(params,
-									knownTextValues,
-									log_parameter_max_length_on_error);
 	}
 	else
 		params = NULL;
@@ -1963,8 +2137,11 @@ exec_bind_message(StringInfo input_message)
 	 * Obtain a plan from the CachedPlanSource.  Any cruft from (re)planning
 	 * will be generated in MessageContext.  The plan refcount will be
 	 * assigned to the Portal, so it will be released at portal destruction.
+	 *
+	 * A bulk bind must use the generic plan, since a custom plan would have
+	 * the first set's parameter values folded into it.
 	 */
-	cplan = GetCachedPlan(psrc, params, NULL, NULL);
+	cplan = GetCachedPlan(psrc, bulk ? NULL : params, NULL, NULL);
 
 	/*
 	 * Now we can define the portal.
@@ -1979,6 +2156,30 @@ exec_bind_message(StringInfo input_message)
 					  cplan->stmt_list,
 					  cplan);
 
+	/*
+	 * Running a statement many times over is only sensible when it neither
+	 * returns rows nor is a utility command.
+	 */
+	if (bulk)
+	{
+		ListCell   *lc;
+
+		if (ChoosePortalStrategy(portal->stmts) != PORTAL_MULTI_QUERY)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("bulk bind is not supported for statements that return rows")));
+
+		foreach(lc, portal->stmts)
+		{
+			PlannedStmt *pstmt = lfirst_node(PlannedStmt, lc);
+
+			if (pstmt->utilityStmt != NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("bulk bind is not supported for utility commands")));
+		}
+	}
+
 	/* Done with the snapshot used for parameter I/O and parsing/planning */
 	if (snapshot_set)
 		PopActiveSnapshot();
@@ -1988,6 +2189,12 @@ exec_bind_message(StringInfo input_message)
 	 */
 	PortalStart(portal, params, 0, InvalidSnapshot);
 
+	if (bulk)
+	{
+		portal->bulkParams = bulkParams;
+		portal->numBulkParams = numSets;
+	}
+
 	/*
 	 * Apply the result format requests to the portal.
 	 */
@@ -2802,6 +3009,129 @@ drop_unnamed_stmt(void)
 	}
 }
 
+/*
+ * Look up a query string in the simple query cache, and return its cached
+ * statement, if any.  *seen is set to true if the query string has been seen
+ * before, whether or not its statement has been cached.
+ *
+ * The query string is added to the cache if it's not there yet, evicting the
+ * least recently used entry if the cache is full.
+ */
+static CachedPlanSource *
+simple_query_cache_lookup(const char *query_string, bool *seen)
+{
+	SimpleQueryCacheEntry *entry;
+	uint64		hash;
+	bool		found;
+
+	/* Forget everything if any setting has changed since we last looked */
+	if (simple_query_cache != NULL &&
+		simple_query_cache_guc_count != guc_change_count)
+	{
+		while (!dlist_is_empty(&simple_query_cache_lru))
+			simple_query_cache_remove(dlist_head_element(SimpleQueryCacheEntry,
+														 lru_node,
+														 &simple_query_cache_lru));
+	}
+	simple_query_cache_guc_count = guc_change_count;
+
+	if (simple_query_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(SimpleQueryCacheEntry);
+		simple_query_cache = hash_create("Simple query cache", 64, &ctl,
+										 HASH_ELEM | HASH_BLOBS);
+	}
+
+	hash = hash_bytes_extended((const unsigned char *) query_string,
+							   strlen(query_string), 0);
+	entry = (SimpleQueryCacheEntry *) hash_search(simple_query_cache, &hash,
+												  HASH_ENTER, &found);
+	if (found)
+	{
+		dlist_delete(&entry->lru_node);
+
+		/* The hash might belong to a different query string */
+		if (entry->plansource != NULL &&
+			strcmp(entry->plansource->query_string, query_string) != 0)
+		{
+			DropCachedPlan(entry->plansource);
+			entry->plansource = NULL;
+		}
+	}
+	else
+	{
+		entry->plansource = NULL;
+
+		while (hash_get_num_entries(simple_query_cache) > simple_query_cache_size)
+			simple_query_cache_remove(dlist_tail_element(SimpleQueryCacheEntry,
+														 lru_node,
+														 &simple_query_cache_lru));
+	}
+	dlist_push_head(&simple_query_cache_lru, &entry->lru_node);
+
+	*seen = found;
+	return entry->plansource;
+}
+
+/*
+ * Store a saved CachedPlanSource as the statement of a query string that
+ * we've just looked up in the simple query cache.
+ */
+static void
+simple_query_cache_insert(const char *query_string,
+						  CachedPlanSource *plansource)
+{
+	SimpleQueryCacheEntry *entry;
+	uint64		hash;
+
+	hash = hash_bytes_extended((const unsigned char *) query_string,
+							   strlen(query_string), 0);
+	entry = (SimpleQueryCacheEntry *) hash_search(simple_query_cache, &hash,
+												  HASH_FIND, NULL);
+	Assert(entry != NULL && entry->plansource == NULL);
+	entry->plansource = plansource;
+}
+
+/* Remove an entry from the simple query cache */
+static void
+simple_query_cache_remove(SimpleQueryCacheEntry *entry)
+{
+	CachedPlanSource *plansource = entry->plansource;
+
+	dlist_delete(&entry->lru_node);
+	if (hash_search(simple_query_cache, &entry->hash, HASH_REMOVE,
+					NULL) == NULL)
+		elog(ERROR, "simple query cache corrupted");
+
+	if (plansource != NULL)
+		DropCachedPlan(plansource);
+}
+
+/*
+ * Can a simple-protocol statement be kept in the simple query cache?  We only
+ * cache plannable statements, since utility statements keep no plan and can
+ * change the transaction state.
+ */
+static bool
+simple_query_is_cacheable(RawStmt *parsetree)
+{
+	switch (nodeTag(parsetree->stmt))
+	{
+		case T_SelectStmt:
+			/* SELECT INTO is CREATE TABLE AS in disguise */
+			return ((SelectStmt *) parsetree->stmt)->intoClause == NULL;
+		case T_InsertStmt:
+		case T_UpdateStmt:
+		case T_DeleteStmt:
+			return true;
+		default:
+			return false;
+	}
+}
+
 
 /* --------------------------------
  *		signal handler routines used in PostgresMain()
@@ -3975,11 +4305,15 @@ PostgresSingleUserMain(int argc, char *argv[],
 	/* read control file (error checking and contains config ) */
 	LocalProcessControlFile(false);
 
-	/* Initialize MaxBackends */
+	/* Initialize MaxBackends and the fast-path lock arrays' size */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	CreateSharedMemoryAndSemaphores();
 
+	/* Calibrate the time stamp counter, as the postmaster does */
+	(void) pg_tsc_init();
+
 	/*
 	 * Remember stand-alone backend startup time,roughly at the same point
 	 * during startup that postmaster does so.
@@ -4125,6 +4459,10 @@ PostgresMain(const char *dbname, const char *username)
 	if (IsUnderPostmaster && Log_disconnections)
 		on_proc_exit(log_disconnections, 0);
 
+	/* Allow the backend profiler to sample this process */
+	if (IsUnderPostmaster)
+		pgstat_profile_init();
+
 	pgstat_report_connect(MyDatabaseId);
 
 	/* Perform initialization specific to a WAL sender process. */
@@ -4230,6 +4568,9 @@ PostgresMain(const char *dbname, const char *username)
 		disable_all_timeouts(false);
 		QueryCancelPending = false; /* second to avoid race condition */
 
+		/* We are no longer inside any plan node */
+		pgstat_profile_node = T_Invalid;
+
 		/* Not reading from the client anymore. */
 		DoingCommandRead = false;
 
@@ -4538,7 +4879,16 @@ PostgresMain(const char *dbname, const char *username)
 				 * this message is complex enough that it seems best to put
 				 * the field extraction out-of-line
 				 */
-				exec_bind_message(&input_message);
+				exec_bind_message(&input_message, false);
+				break;
+
+			case 'b':			/* bulk bind */
+				forbidden_in_wal_sender(firstchar);
+
+				/* Set statement_timestamp() */
+				SetCurrentStatementStartTimestamp();
+
+				exec_bind_message(&input_message, true);
 				break;
 
 			case 'E':			/* execute */
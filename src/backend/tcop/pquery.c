@@ -53,6 +53,9 @@ static void PortalRunMulti(Portal portal,
 						   bool isTopLevel, bool setHoldSnapshot,
 						   DestReceiver *dest, DestReceiver *altdest,
 						   QueryCompletion *qc);
+static void PortalRunBulk(Portal portal, bool isTopLevel,
+						  DestReceiver *dest, DestReceiver *altdest,
+						  QueryCompletion *qc);
 static uint64 DoPortalRunFetch(Portal portal,
 							   FetchDirection fdirection,
 							   long count,
@@ -785,8 +788,11 @@ PortalRun(Portal portal, long count, bool isTopLevel, bool run_once,
 				break;
 
 			case PORTAL_MULTI_QUERY:
-				PortalRunMulti(portal, isTopLevel, false,
-							   dest, altdest, qc);
+				if (portal->bulkParams)
+					PortalRunBulk(portal, isTopLevel, dest, altdest, qc);
+				else
+					PortalRunMulti(portal, isTopLevel, false,
+								   dest, altdest, qc);
 
 				/* Prevent portal's commands from being re-executed */
 				MarkPortalDone(portal);
@@ -1372,6 +1378,42 @@ PortalRunMulti(Portal portal,
 	}
 }
 
+/*
+ * PortalRunBulk
+ *		Execute a bulk-bound portal's queries once for each parameter set
+ *
+ * Each parameter set is run as if it had been bound and executed on its own,
+ * with a command counter increment in between, but without the per-message
+ * overhead of Bind and Execute.  The completion tag reports the total number
+ * of rows processed.
+ */
+static void
+PortalRunBulk(Portal portal, bool isTopLevel,
+			  DestReceiver *dest, DestReceiver *altdest,
+			  QueryCompletion *qc)
+{
+	QueryCompletion setqc;
+	uint64		nprocessed = 0;
+
+	InitializeQueryCompletion(&setqc);
+
+	for (int setno = 0; setno < portal->numBulkParams; setno++)
+	{
+		portal->portalParams = portal->bulkParams[setno];
+
+		InitializeQueryCompletion(&setqc);
+		PortalRunMulti(portal, isTopLevel, false, dest, altdest,
+					   qc ? &setqc : NULL);
+		nprocessed += setqc.nprocessed;
+
+		if (setno < portal->numBulkParams - 1)
+			CommandCounterIncrement();
+	}
+
+	if (qc)
+		SetQueryCompletion(qc, setqc.commandTag, nprocessed);
+}
+
 /*
  * PortalRunFetch
  *		Variant form of PortalRun that supports SQL FETCH directions.
@@ -0,0 +1,451 @@
+/* ----------
+ * backend_profile.c
+ *
+ *	Built-in sampling profiler for backends.
+ *
+ *	When backend_profile_interval is set, each backend arms a profiling
+ *	timer (ITIMER_PROF) that fires after every interval of CPU time used.
+ *	The SIGPROF handler records the database, the query identifier, the
+ *	type of the plan node being executed and the current wait event into a
+ *	ring of samples in shared memory.  pg_stat_get_backend_profile()
+ *	aggregates the samples in all rings, so the view shows where recent CPU
+ *	time went.
+ *
+ *	Each backend has a ring of its own, which only it writes to, so the
+ *	signal handler needs no locks.  Readers don't lock either; a sample
+ *	being overwritten while it is read may be counted with mixed-up fields,
+ *	which is acceptable for statistical sampling.
+ *
+ *	The plan node is tracked by an ExecProcNode wrapper that is installed
+ *	only while profiling is active, see ExecProcNodeFirst().
+ *
+ *	Copyright (c) 2001-2021, PostgreSQL Global Development Group
+ *
+ *	src/backend/utils/activity/backend_profile.c
+ * ----------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+#include <sys/time.h>
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "port/atomics.h"		/* for memory barriers */
+#include "storage/backendid.h"
+#include "storage/shmem.h"
+#include "utils/backend_profile.h"
+#include "utils/backend_status.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/tuplestore.h"
+#include "utils/wait_event.h"
+
+
+/* Number of samples kept per backend; must be a power of 2 */
+#define PROFILE_RING_SIZE	512
+
+typedef struct ProfileSample
+{
+	Oid			databaseid;
+	uint32		wait_event_info;
+	uint64		queryid;
+	NodeTag		nodetag;		/* type of plan node, or T_Invalid */
+} ProfileSample;
+
+typedef struct ProfileRing
+{
+	/* count of samples ever written; the ring wraps around */
+	uint32		nwritten;
+	ProfileSample samples[PROFILE_RING_SIZE];
+} ProfileRing;
+
+/* hash key and entry used to aggregate the samples */
+typedef struct ProfileKey
+{
+	Oid			databaseid;
+	uint32		wait_event_info;
+	uint64		queryid;
+	NodeTag		nodetag;
+} ProfileKey;
+
+typedef struct ProfileEntry
+{
+	ProfileKey	key;
+	int64		count;
+} ProfileEntry;
+
+int			backend_profile_interval = 0;
+bool		pgstat_profile_active = false;
+volatile NodeTag pgstat_profile_node = T_Invalid;
+
+/* all the rings, one per backend ID */
+static ProfileRing *ProfileRings = NULL;
+
+/* this backend's ring, once it may take samples */
+static ProfileRing *MyProfileRing = NULL;
+
+
+static void profile_sigprof_handler(SIGNAL_ARGS);
+static void profile_set_timer(void);
+static const char *profile_node_name(NodeTag tag);
+
+
+/*
+ * Report shared-memory space needed by BackendProfileShmemInit
+ */
+Size
+BackendProfileShmemSize(void)
+{
+	return mul_size(MaxBackends, sizeof(ProfileRing));
+}
+
+/*
+ * Initialize the sample rings during shared-memory initialization
+ */
+void
+BackendProfileShmemInit(void)
+{
+	bool		found;
+
+	ProfileRings = (ProfileRing *)
+		ShmemInitStruct("Backend Profile Rings", BackendProfileShmemSize(),
+						&found);
+
+	if (!found)
+		MemSet(ProfileRings, 0, BackendProfileShmemSize());
+}
+
+/* ----------
+ * pgstat_profile_init() -
+ *
+ * Called from PostgresMain once the backend has a backend ID, to let it take
+ * samples and to start the profiling timer if backend_profile_interval is
+ * already set.
+ * ----------
+ */
+void
+pgstat_profile_init(void)
+{
+#ifndef WIN32
+	Assert(MyBackendId >= 1 && MyBackendId <= MaxBackends);
+
+	/* the samples of the slot's previous user are kept */
+	MyProfileRing = &ProfileRings[MyBackendId - 1];
+
+	pqsignal(SIGPROF, profile_sigprof_handler);
+
+	profile_set_timer();
+#endif
+}
+
+/*
+ * Start, restart or stop the profiling timer to match the current setting
+ */
+static void
+profile_set_timer(void)
+{
+#ifndef WIN32
+	struct itimerval timeval;
+
+	MemSet(&timeval, 0, sizeof(timeval));
+	timeval.it_value.tv_sec = backend_profile_interval / 1000;
+	timeval.it_value.tv_usec = (backend_profile_interval % 1000) * 1000;
+	timeval.it_interval = timeval.it_value;
+
+	/* there's nothing useful to do if this fails, so just ignore errors */
+	(void) setitimer(ITIMER_PROF, &timeval, NULL);
+
+	pgstat_profile_active = (backend_profile_interval > 0);
+	if (!pgstat_profile_active)
+		pgstat_profile_node = T_Invalid;
+#endif
+}
+
+/*
+ * SIGPROF handler: record one sample in this backend's ring
+ *
+ * Everything read here is maintained by the backend itself with plain
+ * stores, so this is safe to run at any point.
+ */
+static void
+profile_sigprof_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+	ProfileRing *ring = MyProfileRing;
+
+	if (ring != NULL && pgstat_profile_active)
+	{
+		ProfileSample *sample;
+
+		sample = &ring->samples[ring->nwritten % PROFILE_RING_SIZE];
+		sample->databaseid = MyDatabaseId;
+		sample->wait_event_info = *(volatile uint32 *) my_wait_event_info;
+		sample->queryid = pgstat_get_my_query_id();
+		sample->nodetag = pgstat_profile_node;
+
+		/* make the sample visible before advertising it */
+		pg_write_barrier();
+		ring->nwritten++;
+	}
+
+	errno = save_errno;
+}
+
+/*
+ * GUC check_hook for backend_profile_interval
+ */
+bool
+check_backend_profile_interval(int *newval, void **extra, GucSource source)
+{
+#ifdef WIN32
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("backend_profile_interval must be set to 0 on platforms that lack setitimer().");
+		return false;
+	}
+#endif
+	return true;
+}
+
+/*
+ * GUC assign_hook for backend_profile_interval
+ */
+void
+assign_backend_profile_interval(int newval, void *extra)
+{
+	backend_profile_interval = newval;
+
+	/* before pgstat_profile_init(), just remember the setting */
+	if (MyProfileRing != NULL)
+		profile_set_timer();
+}
+
+/*
+ * Name of a plan node type, as shown by EXPLAIN
+ */
+static const char *
+profile_node_name(NodeTag tag)
+{
+	switch (tag)
+	{
+		case T_Result:
+			return "Result";
+		case T_ProjectSet:
+			return "ProjectSet";
+		case T_ModifyTable:
+			return "ModifyTable";
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "Merge Append";
+		case T_RecursiveUnion:
+			return "Recursive Union";
+		case T_BitmapAnd:
+			return "BitmapAnd";
+		case T_BitmapOr:
+			return "BitmapOr";
+		case T_SeqScan:
+			return "Seq Scan";
+		case T_SampleScan:
+			return "Sample Scan";
+		case T_IndexScan:
+			return "Index Scan";
+		case T_IndexOnlyScan:
+			return "Index Only Scan";
+		case T_BitmapIndexScan:
+			return "Bitmap Index Scan";
+		case T_BitmapHeapScan:
+			return "Bitmap Heap Scan";
+		case T_TidScan:
+			return "Tid Scan";
+		case T_TidRangeScan:
+			return "Tid Range Scan";
+		case T_SubqueryScan:
+			return "Subquery Scan";
+		case T_FunctionScan:
+			return "Function Scan";
+		case T_ValuesScan:
+			return "Values Scan";
+		case T_TableFuncScan:
+			return "Table Function Scan";
+		case T_CteScan:
+			return "CTE Scan";
+		case T_NamedTuplestoreScan:
+			return "Named Tuplestore Scan";
+		case T_WorkTableScan:
+			return "WorkTable Scan";
+		case T_ForeignScan:
+			return "Foreign Scan";
+		case T_CustomScan:
+			return "Custom Scan";
+		case T_NestLoop:
+			return "Nested Loop";
+		case T_MergeJoin:
+			return "Merge Join";
+		case T_HashJoin:
+			return "Hash Join";
+		case T_Material:
+			return "Materialize";
+		case T_Memoize:
+			return "Memoize";
+		case T_Sort:
+			return "Sort";
+		case T_IncrementalSort:
+			return "Incremental Sort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			return "Aggregate";
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_Gather:
+			return "Gather";
+		case T_GatherMerge:
+			return "Gather Merge";
+		case T_Redistribute:
+			return "Redistribute";
+		case T_Hash:
+			return "Hash";
+		case T_SetOp:
+			return "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		default:
+			return "???";
+	}
+}
+
+/*
+ * Aggregate the samples of all backends by database, query, plan node type
+ * and wait event
+ */
+Datum
+pg_stat_get_backend_profile(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BACKEND_PROFILE_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASHCTL		ctl;
+	HTAB	   *counts;
+	HASH_SEQ_STATUS status;
+	ProfileEntry *entry;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	ctl.keysize = sizeof(ProfileKey);
+	ctl.entrysize = sizeof(ProfileEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	counts = hash_create("backend profile samples", 256, &ctl,
+						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		volatile ProfileRing *ring = &ProfileRings[i];
+		uint32		nwritten;
+		uint32		nsamples;
+
+		nwritten = ring->nwritten;
+		pg_read_barrier();
+		nsamples = Min(nwritten, PROFILE_RING_SIZE);
+
+		for (uint32 j = nwritten - nsamples; j != nwritten; j++)
+		{
+			volatile ProfileSample *sample;
+			ProfileKey	key;
+			bool		found;
+
+			sample = &ring->samples[j % PROFILE_RING_SIZE];
+
+			/* zero the key's padding, since it is hashed as a blob */
+			MemSet(&key, 0, sizeof(key));
+			key.databaseid = sample->databaseid;
+			key.wait_event_info = sample->wait_event_info;
+			key.queryid = sample->queryid;
+			key.nodetag = sample->nodetag;
+
+			entry = (ProfileEntry *) hash_search(counts, &key, HASH_ENTER,
+												 &found);
+			if (!found)
+				entry->count = 0;
+			entry->count++;
+		}
+	}
+
+	hash_seq_init(&status, counts);
+	while ((entry = (ProfileEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum		values[PG_STAT_GET_BACKEND_PROFILE_COLS];
+		bool		nulls[PG_STAT_GET_BACKEND_PROFILE_COLS];
+		uint32		wait_event_info = entry->key.wait_event_info;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		if (OidIsValid(entry->key.databaseid))
+			values[0] = ObjectIdGetDatum(entry->key.databaseid);
+		else
+			nulls[0] = true;
+
+		if (entry->key.queryid != 0)
+			values[1] = Int64GetDatum((int64) entry->key.queryid);
+		else
+			nulls[1] = true;
+
+		if (entry->key.nodetag != T_Invalid)
+			values[2] = CStringGetTextDatum(profile_node_name(entry->key.nodetag));
+		else
+			nulls[2] = true;
+
+		if (wait_event_info != 0)
+		{
+			values[3] = CStringGetTextDatum(pgstat_get_wait_event_type(wait_event_info));
+			values[4] = CStringGetTextDatum(pgstat_get_wait_event(wait_event_info));
+		}
+		else
+		{
+			nulls[3] = true;
+			nulls[4] = true;
+		}
+
+		values[5] = Int64GetDatum(entry->count);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	hash_destroy(counts);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
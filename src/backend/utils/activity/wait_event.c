@@ -18,10 +18,17 @@
  * the same reason pgstat_track_activities is not checked - the check adds
  * more work than it saves.
  *
+ * With track_wait_timing, pgstat_report_wait_end() also counts each wait
+ * and its duration in PendingWaitEvents, from where pgstat.c sends them to
+ * the cumulative statistics of the process's database.
+ *
  * ----------
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "storage/lmgr.h"		/* for GetLockNameFromTagType */
 #include "storage/lwlock.h"		/* for GetLWLockIdentifier */
 #include "utils/wait_event.h"
@@ -37,6 +44,36 @@ static const char *pgstat_get_wait_io(WaitEventIO w);
 static uint32 local_my_wait_event_info;
 uint32	   *my_wait_event_info = &local_my_wait_event_info;
 
+bool		track_wait_timing = false;
+uint64		my_wait_start_ticks = 0;
+uint64		pgStatWaitTicks = 0;
+
+/*
+ * Number of wait events of each wait event type that get a statistics slot
+ * of their own, in the order of the type's index.  Event IDs at or above
+ * the limit (e.g. LWLock tranches registered by extensions) share one more
+ * slot.  The limits for the enumerated types leave room for new events.
+ */
+static const struct
+{
+	uint32		classId;
+	int			nevents;
+}			wait_class_slots[PGSTAT_WAIT_CLASSES] =
+{
+	{PG_WAIT_LWLOCK, LWTRANCHE_FIRST_USER_DEFINED},
+	{PG_WAIT_LOCK, LOCKTAG_LAST_TYPE + 1},
+	{PG_WAIT_BUFFER_PIN, 1},
+	{PG_WAIT_ACTIVITY, 32},
+	{PG_WAIT_CLIENT, 16},
+	{PG_WAIT_EXTENSION, 1},
+	{PG_WAIT_IPC, 96},
+	{PG_WAIT_TIMEOUT, 16},
+	{PG_WAIT_IO, 128}
+};
+
+/* first slot of each wait event type; see wait_class_first_slots_init() */
+static int	wait_class_first_slot[PGSTAT_WAIT_CLASSES + 1];
+
 
 /*
  * Configure wait event reporting to report wait events to *wait_event_info.
@@ -64,6 +101,152 @@ pgstat_reset_wait_event_storage(void)
 	my_wait_event_info = &local_my_wait_event_info;
 }
 
+static void
+wait_class_first_slots_init(void)
+{
+	int			slot = 0;
+
+	for (int i = 0; i < PGSTAT_WAIT_CLASSES; i++)
+	{
+		wait_class_first_slot[i] = slot;
+		slot += wait_class_slots[i].nevents + 1;
+	}
+	wait_class_first_slot[PGSTAT_WAIT_CLASSES] = slot;
+
+	if (slot > PGSTAT_WAIT_EVENT_SLOTS)
+		elog(FATAL, "wait events need %d statistics slots, but only %d are available",
+			 slot, PGSTAT_WAIT_EVENT_SLOTS);
+}
+
+/*
+ * pgstat_wait_class_index() -
+ *
+ *	Return the index of the type of wait_event_info, or -1 if its type is
+ *	unknown.
+ */
+int
+pgstat_wait_class_index(uint32 wait_event_info)
+{
+	uint32		classId = wait_event_info & 0xFF000000;
+
+	for (int i = 0; i < PGSTAT_WAIT_CLASSES; i++)
+	{
+		if (wait_class_slots[i].classId == classId)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * pgstat_wait_class_info() -
+ *
+ *	Return the wait event type with the given index, in the form of a wait
+ *	event it includes.
+ */
+uint32
+pgstat_wait_class_info(int class_index)
+{
+	Assert(class_index >= 0 && class_index < PGSTAT_WAIT_CLASSES);
+
+	return wait_class_slots[class_index].classId;
+}
+
+/*
+ * pgstat_wait_event_slot() -
+ *
+ *	Return the statistics slot of wait_event_info, or -1 if its type is
+ *	unknown.
+ */
+int
+pgstat_wait_event_slot(uint32 wait_event_info)
+{
+	uint16		eventId = wait_event_info & 0x0000FFFF;
+	int			class_index;
+
+	class_index = pgstat_wait_class_index(wait_event_info);
+	if (class_index < 0)
+		return -1;
+
+	if (unlikely(wait_class_first_slot[PGSTAT_WAIT_CLASSES] == 0))
+		wait_class_first_slots_init();
+
+	return wait_class_first_slot[class_index] +
+		Min(eventId, wait_class_slots[class_index].nevents);
+}
+
+/*
+ * pgstat_wait_event_slot_info() -
+ *
+ *	Return the wait event counted in the given statistics slot.  If the slot
+ *	is the one shared by the type's events without a slot of their own, sets
+ *	*other and returns the first such event.
+ */
+uint32
+pgstat_wait_event_slot_info(int slot, bool *other)
+{
+	int			class_index;
+
+	Assert(slot >= 0 && slot < PGSTAT_WAIT_EVENT_SLOTS);
+
+	if (unlikely(wait_class_first_slot[PGSTAT_WAIT_CLASSES] == 0))
+		wait_class_first_slots_init();
+
+	for (class_index = PGSTAT_WAIT_CLASSES - 1; class_index > 0; class_index--)
+	{
+		if (slot >= wait_class_first_slot[class_index])
+			break;
+	}
+
+	slot -= wait_class_first_slot[class_index];
+	*other = (slot >= wait_class_slots[class_index].nevents);
+
+	return wait_class_slots[class_index].classId | slot;
+}
+
+/*
+ * pgstat_count_wait_end() -
+ *
+ *	Count the wait that is ending, which pgstat_report_wait_start() started
+ *	timing.
+ */
+void
+pgstat_count_wait_end(void)
+{
+	static uint64 ticks_per_usec = 0;
+	uint64		ticks = pg_get_ticks() - my_wait_start_ticks;
+	uint32		wait_event_info = *my_wait_event_info;
+	uint64		usec;
+	int			slot;
+	int			bucket;
+
+	my_wait_start_ticks = 0;
+
+	/*
+	 * The postmaster doesn't report statistics, and any counts it had would
+	 * be duplicated into its children.
+	 */
+	if (MyBackendType == B_INVALID)
+		return;
+
+	pgStatWaitTicks += ticks;
+
+	slot = pgstat_wait_event_slot(wait_event_info);
+	if (slot < 0)
+		return;
+
+	PendingWaitEvents[slot].calls++;
+	PendingWaitEvents[slot].time += ticks;
+
+	if (ticks_per_usec == 0)
+		ticks_per_usec = Max(pg_get_ticks_per_sec() / 1000000, 1);
+	usec = ticks / ticks_per_usec;
+	bucket = (usec == 0) ? 0 : pg_leftmost_one_pos64(usec) + 1;
+	bucket = Min(bucket, PGSTAT_WAIT_TIME_BUCKETS - 1);
+	PendingWaitHistograms[pgstat_wait_class_index(wait_event_info)][bucket]++;
+
+	have_wait_event_stats = true;
+}
+
 /* ----------
  * pgstat_get_wait_event_type() -
  *
@@ -224,14 +407,17 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_CHECKPOINTER_MAIN:
 			event_name = "CheckpointerMain";
 			break;
+		case WAIT_EVENT_CONNECTION_PROXY_MAIN:
+			event_name = "ConnectionProxyMain";
+			break;
 		case WAIT_EVENT_LOGICAL_APPLY_MAIN:
 			event_name = "LogicalApplyMain";
 			break;
 		case WAIT_EVENT_LOGICAL_LAUNCHER_MAIN:
 			event_name = "LogicalLauncherMain";
 			break;
-		case WAIT_EVENT_PGSTAT_MAIN:
-			event_name = "PgStatMain";
+		case WAIT_EVENT_PARALLEL_WORKER_IDLE:
+			event_name = "ParallelWorkerIdle";
 			break;
 		case WAIT_EVENT_RECOVERY_WAL_STREAM:
 			event_name = "RecoveryWalStream";
@@ -313,6 +499,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_APPEND_READY:
 			event_name = "AppendReady";
 			break;
+		case WAIT_EVENT_ARCHIVE_COMMAND:
+			event_name = "ArchiveCommand";
+			break;
 		case WAIT_EVENT_BACKEND_TERMINATION:
 			event_name = "BackendTermination";
 			break;
@@ -427,9 +616,15 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_RECOVERY_CONFLICT_TABLESPACE:
 			event_name = "RecoveryConflictTablespace";
 			break;
+		case WAIT_EVENT_RECOVERY_PARALLEL_REDO:
+			event_name = "RecoveryParallelRedo";
+			break;
 		case WAIT_EVENT_RECOVERY_PAUSE:
 			event_name = "RecoveryPause";
 			break;
+		case WAIT_EVENT_REDISTRIBUTE_WRITE:
+			event_name = "RedistributeWrite";
+			break;
 		case WAIT_EVENT_REPLICATION_ORIGIN_DROP:
 			event_name = "ReplicationOriginDrop";
 			break;
@@ -564,6 +759,15 @@ pgstat_get_wait_io(WaitEventIO w)
 		case WAIT_EVENT_DATA_FILE_WRITE:
 			event_name = "DataFileWrite";
 			break;
+		case WAIT_EVENT_DOUBLE_WRITE_READ:
+			event_name = "DoubleWriteRead";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_SYNC:
+			event_name = "DoubleWriteSync";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_WRITE:
+			event_name = "DoubleWriteWrite";
+			break;
 		case WAIT_EVENT_DSM_FILL_ZERO_WRITE:
 			event_name = "DSMFillZeroWrite";
 			break;
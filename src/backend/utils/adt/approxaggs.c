@@ -0,0 +1,585 @@
+/*-------------------------------------------------------------------------
+ *
+ * approxaggs.c
+ *		Approximate aggregate functions.
+ *
+ * The aggregates in this file trade exactness for a transition state of
+ * bounded size that can be combined across partial aggregates, so that
+ * unlike count(DISTINCT ...) and percentile_disc() they need no sort and
+ * can run in parallel and partitionwise aggregation.
+ *
+ * approx_count_distinct() feeds the hash values of its input into a
+ * HyperLogLog estimator (see lib/hyperloglog.c).
+ *
+ * approx_percentile() keeps a histogram of its input with logarithmically
+ * sized buckets, as in the DDSketch paper ("DDSketch: A Fast and Fully-
+ * Mergeable Quantile Sketch with Relative-Error Guarantees", Masson, Rim and
+ * Lee, 2019).  Bucket i counts the values whose magnitude is in
+ * (gamma^(i-1), gamma^i], so any value may be reported in place of any other
+ * value of the same bucket with a relative error of at most
+ * APPROX_PERCENTILE_ACCURACY.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/approxaggs.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "fmgr.h"
+#include "lib/hyperloglog.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/float.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+
+
+/*
+ * Register width of approx_count_distinct's estimator.  2^14 registers give
+ * a standard error of about 0.8%, with 16kB of state.
+ */
+#define APPROX_COUNT_DISTINCT_BWIDTH	14
+
+/* relative accuracy of approx_percentile's results */
+#define APPROX_PERCENTILE_ACCURACY		0.01
+
+/*
+ * Most buckets kept for each sign by approx_percentile.  If the input spans
+ * more than that, the buckets of the smallest magnitudes are merged, which
+ * loses accuracy only near zero.  With the accuracy above, this still covers
+ * values across about 35 orders of magnitude exactly.
+ */
+#define APPROX_PERCENTILE_MAX_BUCKETS	4096
+
+/* Per-aggregate-call cache of approx_count_distinct's hash function */
+typedef struct ApproxCountDistinctCache
+{
+	Oid			typid;			/* input type the cache is for */
+	FmgrInfo	hashfn;			/* its default hash support function */
+} ApproxCountDistinctCache;
+
+/* Buckets of approx_percentile for the values of one sign */
+typedef struct ApproxPercentileBuckets
+{
+	int32		offset;			/* bucket index of counts[0] */
+	int32		nbuckets;		/* length of counts[] */
+	int64	   *counts;			/* number of values in each bucket */
+} ApproxPercentileBuckets;
+
+/* Transition state of approx_percentile */
+typedef struct ApproxPercentileState
+{
+	float8		fraction;		/* requested percentile, from the first row */
+	int64		zero_count;		/* number of zeroes */
+	int64		pinf_count;		/* number of +Infinity */
+	int64		ninf_count;		/* number of -Infinity */
+	int64		nan_count;		/* number of NaN */
+	ApproxPercentileBuckets positive;
+	ApproxPercentileBuckets negative;	/* by magnitude */
+} ApproxPercentileState;
+
+
+/*
+ * approx_count_distinct(anyelement)
+ */
+
+Datum
+approx_count_distinct_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	ApproxCountDistinctCache *cache;
+	Oid			typid;
+	uint32		hash;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	if (state == NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(aggcontext);
+
+		state = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+		initHyperLogLog(state, APPROX_COUNT_DISTINCT_BWIDTH);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	/* Look up the input type's hash function once per query */
+	typid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+	cache = (ApproxCountDistinctCache *) fcinfo->flinfo->fn_extra;
+	if (cache == NULL || cache->typid != typid)
+	{
+		TypeCacheEntry *typentry;
+
+		typentry = lookup_type_cache(typid, TYPECACHE_HASH_PROC);
+		if (!OidIsValid(typentry->hash_proc))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(typid))));
+
+		if (cache == NULL)
+			cache = (ApproxCountDistinctCache *)
+				MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+								   sizeof(ApproxCountDistinctCache));
+		fmgr_info_cxt(typentry->hash_proc, &cache->hashfn,
+					  fcinfo->flinfo->fn_mcxt);
+		cache->typid = typid;
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	hash = DatumGetUInt32(FunctionCall1Coll(&cache->hashfn,
+											PG_GET_COLLATION(),
+											PG_GETARG_DATUM(1)));
+	addHyperLogLog(state, hash);
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+	{
+		/* copy state2, which may live in a shorter-lived context */
+		MemoryContext oldcontext = MemoryContextSwitchTo(aggcontext);
+
+		state1 = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+		initHyperLogLog(state1, state2->registerWidth);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	mergeHyperLogLog(state1, state2);
+
+	PG_RETURN_POINTER(state1);
+}
+
+Datum
+approx_count_distinct_serialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+	StringInfoData buf;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+	pq_sendbyte(&buf, state->registerWidth);
+	pq_sendbytes(&buf, (char *) state->hashesArr, state->nRegisters);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+Datum
+approx_count_distinct_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	hyperLogLogState *result;
+	StringInfoData buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	result = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(result, pq_getmsgbyte(&buf));
+	memcpy(result->hashesArr, pq_getmsgbytes(&buf, result->nRegisters),
+		   result->nRegisters);
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
+Datum
+approx_count_distinct_final(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	/* like count(), return zero rather than NULL if there were no rows */
+	if (state == NULL)
+		PG_RETURN_INT64(0);
+
+	PG_RETURN_INT64((int64) rint(estimateHyperLogLog(state)));
+}
+
+
+/*
+ * approx_percentile(float8, float8)
+ */
+
+/* ln(gamma), where gamma = (1 + accuracy) / (1 - accuracy) */
+static inline double
+approx_percentile_log_gamma(void)
+{
+	return log((1.0 + APPROX_PERCENTILE_ACCURACY) /
+			   (1.0 - APPROX_PERCENTILE_ACCURACY));
+}
+
+/*
+ * Resize the buckets to cover indexes lo .. hi, which must include all of the
+ * current ones except possibly some below lo, which are merged into lo.
+ */
+static void
+approx_percentile_resize(ApproxPercentileBuckets *buckets, int32 lo, int32 hi)
+{
+	int32		nbuckets = hi - lo + 1;
+	int64	   *counts = palloc0(nbuckets * sizeof(int64));
+
+	for (int32 i = 0; i < buckets->nbuckets; i++)
+	{
+		int32		index = Max(buckets->offset + i, lo);
+
+		Assert(index <= hi);
+		counts[index - lo] += buckets->counts[i];
+	}
+
+	if (buckets->counts)
+		pfree(buckets->counts);
+	buckets->offset = lo;
+	buckets->nbuckets = nbuckets;
+	buckets->counts = counts;
+}
+
+/*
+ * Add count to bucket index, creating the bucket if needed.  Must be called
+ * in the memory context holding the buckets.
+ */
+static void
+approx_percentile_add(ApproxPercentileBuckets *buckets, int32 index,
+					  int64 count)
+{
+	int32		lo = index;
+	int32		hi = index;
+
+	if (buckets->nbuckets > 0)
+	{
+		lo = Min(lo, buckets->offset);
+		hi = Max(hi, buckets->offset + buckets->nbuckets - 1);
+	}
+
+	/* if the range is too wide, give up on the smallest magnitudes */
+	if (hi - lo >= APPROX_PERCENTILE_MAX_BUCKETS)
+		lo = hi - APPROX_PERCENTILE_MAX_BUCKETS + 1;
+
+	if (buckets->nbuckets == 0 ||
+		lo != buckets->offset ||
+		hi != buckets->offset + buckets->nbuckets - 1)
+		approx_percentile_resize(buckets, lo, hi);
+
+	index = Max(index, lo);
+	buckets->counts[index - buckets->offset] += count;
+}
+
+static ApproxPercentileState *
+approx_percentile_create(MemoryContext aggcontext, float8 fraction)
+{
+	ApproxPercentileState *state;
+
+	state = (ApproxPercentileState *)
+		MemoryContextAllocZero(aggcontext, sizeof(ApproxPercentileState));
+	state->fraction = fraction;
+
+	return state;
+}
+
+Datum
+approx_percentile_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	ApproxPercentileState *state;
+	float8		value;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (ApproxPercentileState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	if (state == NULL)
+	{
+		float8		fraction;
+
+		if (PG_ARGISNULL(2))
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("percentile value must not be null")));
+		fraction = PG_GETARG_FLOAT8(2);
+		if (fraction < 0 || fraction > 1 || isnan(fraction))
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("percentile value %g is not between 0 and 1",
+							fraction)));
+
+		state = approx_percentile_create(aggcontext, fraction);
+	}
+
+	value = PG_GETARG_FLOAT8(1);
+
+	if (isnan(value))
+		state->nan_count++;
+	else if (isinf(value))
+	{
+		if (value > 0)
+			state->pinf_count++;
+		else
+			state->ninf_count++;
+	}
+	else if (value == 0)
+		state->zero_count++;
+	else
+	{
+		int32		index;
+
+		index = (int32) ceil(log(fabs(value)) / approx_percentile_log_gamma());
+
+		oldcontext = MemoryContextSwitchTo(aggcontext);
+		approx_percentile_add(value > 0 ? &state->positive : &state->negative,
+							  index, 1);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+approx_percentile_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	ApproxPercentileState *state1;
+	ApproxPercentileState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (ApproxPercentileState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (ApproxPercentileState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+		state1 = approx_percentile_create(aggcontext, state2->fraction);
+
+	state1->zero_count += state2->zero_count;
+	state1->pinf_count += state2->pinf_count;
+	state1->ninf_count += state2->ninf_count;
+	state1->nan_count += state2->nan_count;
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	for (int32 i = 0; i < state2->positive.nbuckets; i++)
+	{
+		if (state2->positive.counts[i] != 0)
+			approx_percentile_add(&state1->positive,
+								  state2->positive.offset + i,
+								  state2->positive.counts[i]);
+	}
+	for (int32 i = 0; i < state2->negative.nbuckets; i++)
+	{
+		if (state2->negative.counts[i] != 0)
+			approx_percentile_add(&state1->negative,
+								  state2->negative.offset + i,
+								  state2->negative.counts[i]);
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_RETURN_POINTER(state1);
+}
+
+static void
+approx_percentile_send_buckets(StringInfo buf, ApproxPercentileBuckets *buckets)
+{
+	pq_sendint32(buf, buckets->offset);
+	pq_sendint32(buf, buckets->nbuckets);
+	for (int32 i = 0; i < buckets->nbuckets; i++)
+		pq_sendint64(buf, buckets->counts[i]);
+}
+
+static void
+approx_percentile_recv_buckets(StringInfo buf, ApproxPercentileBuckets *buckets)
+{
+	buckets->offset = pq_getmsgint(buf, 4);
+	buckets->nbuckets = pq_getmsgint(buf, 4);
+	if (buckets->nbuckets < 0 ||
+		buckets->nbuckets > APPROX_PERCENTILE_MAX_BUCKETS)
+		elog(ERROR, "invalid number of approx_percentile buckets: %d",
+			 buckets->nbuckets);
+
+	buckets->counts = NULL;
+	if (buckets->nbuckets > 0)
+	{
+		buckets->counts = palloc(buckets->nbuckets * sizeof(int64));
+		for (int32 i = 0; i < buckets->nbuckets; i++)
+			buckets->counts[i] = pq_getmsgint64(buf);
+	}
+}
+
+Datum
+approx_percentile_serialize(PG_FUNCTION_ARGS)
+{
+	ApproxPercentileState *state;
+	StringInfoData buf;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (ApproxPercentileState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+	pq_sendfloat8(&buf, state->fraction);
+	pq_sendint64(&buf, state->zero_count);
+	pq_sendint64(&buf, state->pinf_count);
+	pq_sendint64(&buf, state->ninf_count);
+	pq_sendint64(&buf, state->nan_count);
+	approx_percentile_send_buckets(&buf, &state->positive);
+	approx_percentile_send_buckets(&buf, &state->negative);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+Datum
+approx_percentile_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	ApproxPercentileState *result;
+	StringInfoData buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	result = approx_percentile_create(CurrentMemoryContext,
+									  pq_getmsgfloat8(&buf));
+	result->zero_count = pq_getmsgint64(&buf);
+	result->pinf_count = pq_getmsgint64(&buf);
+	result->ninf_count = pq_getmsgint64(&buf);
+	result->nan_count = pq_getmsgint64(&buf);
+	approx_percentile_recv_buckets(&buf, &result->positive);
+	approx_percentile_recv_buckets(&buf, &result->negative);
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * The value reported for the values of bucket index: the one with the same
+ * relative distance to both ends of the bucket.
+ */
+static float8
+approx_percentile_bucket_value(int32 index)
+{
+	double		log_gamma = approx_percentile_log_gamma();
+	double		result;
+
+	/* 2 * gamma^index / (gamma + 1), computed so as not to overflow early */
+	result = exp(index * log_gamma + log(2.0 / (exp(log_gamma) + 1.0)));
+
+	return Min(result, DBL_MAX);
+}
+
+Datum
+approx_percentile_final(PG_FUNCTION_ARGS)
+{
+	ApproxPercentileState *state;
+	int64		total;
+	int64		rank;
+
+	state = PG_ARGISNULL(0) ? NULL : (ApproxPercentileState *) PG_GETARG_POINTER(0);
+
+	if (state == NULL)
+		PG_RETURN_NULL();
+
+	total = state->zero_count + state->pinf_count + state->ninf_count +
+		state->nan_count;
+	for (int32 i = 0; i < state->positive.nbuckets; i++)
+		total += state->positive.counts[i];
+	for (int32 i = 0; i < state->negative.nbuckets; i++)
+		total += state->negative.counts[i];
+
+	/*
+	 * As percentile_disc() does, return the first value in sort order whose
+	 * position is at least the requested fraction of the input.  The sort
+	 * order is -Infinity, negative values, zero, positive values, +Infinity
+	 * and NaN.
+	 */
+	rank = (int64) ceil(state->fraction * total);
+	rank = Max(rank, 1);
+
+	if ((rank -= state->ninf_count) <= 0)
+		PG_RETURN_FLOAT8(-get_float8_infinity());
+
+	for (int32 i = state->negative.nbuckets - 1; i >= 0; i--)
+	{
+		if ((rank -= state->negative.counts[i]) <= 0)
+			PG_RETURN_FLOAT8(-approx_percentile_bucket_value(state->negative.offset + i));
+	}
+
+	if ((rank -= state->zero_count) <= 0)
+		PG_RETURN_FLOAT8(0.0);
+
+	for (int32 i = 0; i < state->positive.nbuckets; i++)
+	{
+		if ((rank -= state->positive.counts[i]) <= 0)
+			PG_RETURN_FLOAT8(approx_percentile_bucket_value(state->positive.offset + i));
+	}
+
+	if ((rank -= state->pinf_count) <= 0)
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8(get_float8_nan());
+}
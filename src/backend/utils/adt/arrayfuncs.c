@@ -18,6 +18,7 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
@@ -4160,18 +4161,115 @@ hash_array_extended(PG_FUNCTION_ARGS)
  *----------------------------------------------------------------------------
  */
 
+/*
+ * Below this many element pairs, comparing every element of array1 with
+ * every element of array2 is cheaper than building a hash table of array2.
+ */
+#define ARRAY_CONTAIN_HASH_MIN_PAIRS	256
+
+/* Entry of the hash table of array2's elements */
+typedef struct ArrayContainHashEntry
+{
+	Datum		key;			/* the element */
+	uint32		status;			/* hash status */
+	uint32		hash;			/* hash value (cached) */
+} ArrayContainHashEntry;
+
+/* private_data of the hash table: how to hash and compare elements */
+typedef struct ArrayContainHashFuncs
+{
+	FunctionCallInfo eq_fcinfo;
+	FunctionCallInfo hash_fcinfo;
+} ArrayContainHashFuncs;
+
+#define SH_PREFIX arraycontainhash
+#define SH_ELEMENT_TYPE ArrayContainHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+static uint32 array_contain_hash_element(struct arraycontainhash_hash *tb,
+										 Datum key);
+static bool array_contain_match_elements(struct arraycontainhash_hash *tb,
+										 Datum key1, Datum key2);
+
+#define SH_PREFIX arraycontainhash
+#define SH_ELEMENT_TYPE ArrayContainHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) array_contain_hash_element(tb, key)
+#define SH_EQUAL(tb, a, b) array_contain_match_elements(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+static uint32
+array_contain_hash_element(struct arraycontainhash_hash *tb, Datum key)
+{
+	FunctionCallInfo fcinfo = ((ArrayContainHashFuncs *) tb->private_data)->hash_fcinfo;
+
+	fcinfo->args[0].value = key;
+	fcinfo->args[0].isnull = false;
+	fcinfo->isnull = false;
+
+	return DatumGetUInt32(FunctionCallInvoke(fcinfo));
+}
+
+static bool
+array_contain_match_elements(struct arraycontainhash_hash *tb,
+							 Datum key1, Datum key2)
+{
+	FunctionCallInfo fcinfo = ((ArrayContainHashFuncs *) tb->private_data)->eq_fcinfo;
+	bool		oprresult;
+
+	fcinfo->args[0].value = key1;
+	fcinfo->args[0].isnull = false;
+	fcinfo->args[1].value = key2;
+	fcinfo->args[1].isnull = false;
+	fcinfo->isnull = false;
+	oprresult = DatumGetBool(FunctionCallInvoke(fcinfo));
+
+	/* treat NULL as false, like the nested loop does */
+	return !fcinfo->isnull && oprresult;
+}
+
+/*
+ * Can array_contain_compare look up the elements of arrays of this type in a
+ * hash table?  The type's default hash opclass must exist and use the same
+ * equality operator as the one we compare with.
+ */
+static bool
+array_contain_can_hash(TypeCacheEntry *typentry)
+{
+	if (!OidIsValid(typentry->hash_proc_finfo.fn_oid))
+		return false;
+
+	return get_opfamily_member(typentry->hash_opf,
+							   typentry->type_id, typentry->type_id,
+							   HTEqualStrategyNumber) == typentry->eq_opr;
+}
+
 /*
  * array_contain_compare :
  *		  compares two arrays for overlap/containment
  *
  * When matchall is true, return true if all members of array1 are in array2.
  * When matchall is false, return true if any members of array1 are in array2.
+ *
+ * If both arrays are large, the elements of array2 are put in a hash table
+ * so that each element of array1 needs only one lookup.
  */
 static bool
 array_contain_compare(AnyArrayType *array1, AnyArrayType *array2, Oid collation,
 					  bool matchall, void **fn_extra)
 {
 	LOCAL_FCINFO(locfcinfo, 2);
+	LOCAL_FCINFO(hashfcinfo, 1);
+	ArrayContainHashFuncs hashfuncs;
+	arraycontainhash_hash *hashtab = NULL;
 	bool		result = matchall;
 	Oid			element_type = AARR_ELEMTYPE(array1);
 	TypeCacheEntry *typentry;
@@ -4202,7 +4300,9 @@ array_contain_compare(AnyArrayType *array1, AnyArrayType *array2, Oid collation,
 		typentry->type_id != element_type)
 	{
 		typentry = lookup_type_cache(element_type,
-									 TYPECACHE_EQ_OPR_FINFO);
+									 TYPECACHE_EQ_OPR_FINFO |
+									 TYPECACHE_HASH_PROC_FINFO |
+									 TYPECACHE_HASH_OPFAMILY);
 		if (!OidIsValid(typentry->eq_opr_finfo.fn_oid))
 			ereport(ERROR,
 					(errcode(ERRCODE_UNDEFINED_FUNCTION),
@@ -4242,10 +4342,33 @@ array_contain_compare(AnyArrayType *array1, AnyArrayType *array2, Oid collation,
 	nelems1 = ArrayGetNItems(AARR_NDIM(array1), AARR_DIMS(array1));
 	array_iter_setup(&it1, array1);
 
+	/* Build a hash table of array2's elements, if worthwhile */
+	if (nelems2 > 1 &&
+		(int64) nelems1 * nelems2 >= ARRAY_CONTAIN_HASH_MIN_PAIRS &&
+		array_contain_can_hash(typentry))
+	{
+		InitFunctionCallInfoData(*hashfcinfo, &typentry->hash_proc_finfo, 1,
+								 collation, NULL, NULL);
+		hashfuncs.eq_fcinfo = locfcinfo;
+		hashfuncs.hash_fcinfo = hashfcinfo;
+
+		hashtab = arraycontainhash_create(CurrentMemoryContext, nelems2,
+										  &hashfuncs);
+		for (j = 0; j < nelems2; j++)
+		{
+			bool		found;
+
+			if (nulls2 && nulls2[j])
+				continue;		/* can't match */
+			arraycontainhash_insert(hashtab, values2[j], &found);
+		}
+	}
+
 	for (i = 0; i < nelems1; i++)
 	{
 		Datum		elt1;
 		bool		isnull1;
+		bool		matched;
 
 		/* Get element, checking for NULL */
 		elt1 = array_iter_next(&it1, &isnull1, i, typlen, typbyval, typalign);
@@ -4265,29 +4388,38 @@ array_contain_compare(AnyArrayType *array1, AnyArrayType *array2, Oid collation,
 			continue;
 		}
 
-		for (j = 0; j < nelems2; j++)
+		if (hashtab != NULL)
+			matched = arraycontainhash_lookup(hashtab, elt1) != NULL;
+		else
 		{
-			Datum		elt2 = values2[j];
-			bool		isnull2 = nulls2 ? nulls2[j] : false;
-			bool		oprresult;
+			matched = false;
+			for (j = 0; j < nelems2; j++)
+			{
+				Datum		elt2 = values2[j];
+				bool		isnull2 = nulls2 ? nulls2[j] : false;
+				bool		oprresult;
 
-			if (isnull2)
-				continue;		/* can't match */
+				if (isnull2)
+					continue;	/* can't match */
 
-			/*
-			 * Apply the operator to the element pair; treat NULL as false
-			 */
-			locfcinfo->args[0].value = elt1;
-			locfcinfo->args[0].isnull = false;
-			locfcinfo->args[1].value = elt2;
-			locfcinfo->args[1].isnull = false;
-			locfcinfo->isnull = false;
-			oprresult = DatumGetBool(FunctionCallInvoke(locfcinfo));
-			if (!locfcinfo->isnull && oprresult)
-				break;
+				/*
+				 * Apply the operator to the element pair; treat NULL as false
+				 */
+				locfcinfo->args[0].value = elt1;
+				locfcinfo->args[0].isnull = false;
+				locfcinfo->args[1].value = elt2;
+				locfcinfo->args[1].isnull = false;
+				locfcinfo->isnull = false;
+				oprresult = DatumGetBool(FunctionCallInvoke(locfcinfo));
+				if (!locfcinfo->isnull && oprresult)
+				{
+					matched = true;
+					break;
+				}
+			}
 		}
 
-		if (j < nelems2)
+		if (matched)
 		{
 			/* found a match for elt1 */
 			if (!matchall)
@@ -4307,6 +4439,9 @@ array_contain_compare(AnyArrayType *array1, AnyArrayType *array2, Oid collation,
 		}
 	}
 
+	if (hashtab != NULL)
+		arraycontainhash_destroy(hashtab);
+
 	return result;
 }
 
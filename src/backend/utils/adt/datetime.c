@@ -42,6 +42,7 @@ static int	DecodeTime(char *str, int fmask, int range,
 static const datetkn *datebsearch(const char *key, const datetkn *base, int nel);
 static int	DecodeDate(char *str, int fmask, int *tmask, bool *is2digits,
 					   struct pg_tm *tm);
+static inline bool DecodeFixedDigits(const char **str, int ndigits, int *result);
 static char *AppendSeconds(char *cp, int sec, fsec_t fsec,
 						   int precision, bool fillzeros);
 static void AdjustFractSeconds(double frac, struct pg_tm *tm, fsec_t *fsec,
@@ -775,6 +776,140 @@ ParseDateTime(const char *timestr, char *workbuf, size_t buflen,
 }
 
 
+/* DecodeFixedDigits()
+ * Read exactly ndigits decimal digits from *str into *result, advancing *str.
+ * Returns false if there are fewer digits than that.
+ */
+static inline bool
+DecodeFixedDigits(const char **str, int ndigits, int *result)
+{
+	const char *cp = *str;
+	int			val = 0;
+
+	for (int i = 0; i < ndigits; i++)
+	{
+		if (!isdigit((unsigned char) cp[i]))
+			return false;
+		val = val * 10 + (cp[i] - '0');
+	}
+
+	*str = cp + ndigits;
+	*result = val;
+	return true;
+}
+
+/* DecodeISODateTimeFast()
+ * Interpret a date and time in the most common ISO 8601 format, without the
+ * tokenization done by ParseDateTime and DecodeDateTime.
+ *
+ *		Accepted format:
+ *				"YYYY-MM-DD[( |T)HH:MM[:SS[.ffffff]][(+|-)HH[:MM]]]"
+ *
+ * Returns true and fills in *tm, *fsec and, if tzp isn't NULL, *tzp the same
+ * way DecodeDateTime would.  Returns false if the string has any other form,
+ * or if any field is out of range; such strings must be handed to the
+ * general parser, which accepts more formats and reports errors properly.
+ * Nothing is reported here.
+ */
+bool
+DecodeISODateTimeFast(const char *str, struct pg_tm *tm, fsec_t *fsec,
+					  int *tzp)
+{
+	const char *cp = str;
+	bool		havetz = false;
+	int			tz = 0;
+
+	tm->tm_hour = 0;
+	tm->tm_min = 0;
+	tm->tm_sec = 0;
+	*fsec = 0;
+	tm->tm_isdst = -1;
+
+	if (!DecodeFixedDigits(&cp, 4, &tm->tm_year) || *cp++ != '-' ||
+		!DecodeFixedDigits(&cp, 2, &tm->tm_mon) || *cp++ != '-' ||
+		!DecodeFixedDigits(&cp, 2, &tm->tm_mday))
+		return false;
+
+	if (tm->tm_year == 0 ||
+		tm->tm_mon < 1 || tm->tm_mon > MONTHS_PER_YEAR ||
+		tm->tm_mday < 1 ||
+		tm->tm_mday > day_tab[isleap(tm->tm_year)][tm->tm_mon - 1])
+		return false;
+
+	if (*cp == ' ' || *cp == 'T')
+	{
+		cp++;
+		if (!DecodeFixedDigits(&cp, 2, &tm->tm_hour) || *cp++ != ':' ||
+			!DecodeFixedDigits(&cp, 2, &tm->tm_min))
+			return false;
+
+		if (*cp == ':')
+		{
+			cp++;
+			if (!DecodeFixedDigits(&cp, 2, &tm->tm_sec))
+				return false;
+
+			if (*cp == '.')
+			{
+				int			ndigits = 0;
+				int			frac = 0;
+
+				cp++;
+				while (isdigit((unsigned char) *cp))
+				{
+					/* leave rounding of extra digits to the general parser */
+					if (++ndigits > 6)
+						return false;
+					frac = frac * 10 + (*cp++ - '0');
+				}
+				if (ndigits == 0)
+					return false;
+				while (ndigits++ < 6)
+					frac *= 10;
+				*fsec = frac;
+			}
+		}
+
+		/* "24:00:00" and leap seconds are left to the general parser */
+		if (tm->tm_hour >= HOURS_PER_DAY || tm->tm_min >= MINS_PER_HOUR ||
+			tm->tm_sec >= SECS_PER_MINUTE)
+			return false;
+
+		if (*cp == '+' || *cp == '-')
+		{
+			char		sign = *cp++;
+			int			hr;
+			int			min = 0;
+
+			if (!DecodeFixedDigits(&cp, 2, &hr))
+				return false;
+			if (*cp == ':')
+			{
+				cp++;
+				if (!DecodeFixedDigits(&cp, 2, &min))
+					return false;
+			}
+			if (hr > MAX_TZDISP_HOUR || min >= MINS_PER_HOUR)
+				return false;
+
+			/* as in DecodeTimezone, the result is in seconds west of UTC */
+			tz = (hr * MINS_PER_HOUR + min) * SECS_PER_MINUTE;
+			if (sign == '+')
+				tz = -tz;
+			havetz = true;
+		}
+	}
+
+	if (*cp != '\0')
+		return false;
+
+	if (tzp != NULL)
+		*tzp = havetz ? tz : DetermineTimeZoneOffset(tm, session_timezone);
+
+	return true;
+}
+
+
 /* DecodeDateTime()
  * Interpret previously parsed fields for general date and time.
  * Return 0 if full date, 1 if only time, and negative DTERR code if problems.
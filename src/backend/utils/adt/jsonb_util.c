@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -23,6 +24,7 @@
 #include "utils/json.h"
 #include "utils/jsonb.h"
 #include "utils/memutils.h"
+#include "utils/snapmgr.h"
 #include "utils/varlena.h"
 
 /*
@@ -37,6 +39,35 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+/*
+ * Number of detoasted values DatumGetJsonbPCached() remembers, and the
+ * largest value it is willing to remember.
+ */
+#define JSONB_DETOAST_CACHE_SIZE		4
+#define JSONB_DETOAST_CACHE_MAX_VALUE	(1024 * 1024)
+
+typedef struct JsonbDetoastCacheEntry
+{
+	Oid			toastrelid;		/* TOAST pointer of the value */
+	Oid			valueid;
+	Jsonb	   *value;			/* detoasted value, or NULL if unused */
+} JsonbDetoastCacheEntry;
+
+typedef struct JsonbDetoastCache
+{
+	MemoryContext cxt;			/* holds the detoasted values */
+
+	/* identity of the snapshot the values were fetched with */
+	TransactionId xmin;
+	TransactionId xmax;
+	CommandId	curcid;
+
+	int			next;			/* entry to replace next */
+	JsonbDetoastCacheEntry entries[JSONB_DETOAST_CACHE_SIZE];
+} JsonbDetoastCache;
+
+static JsonbDetoastCache *jsonb_detoast_cache = NULL;
+
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
@@ -68,6 +99,94 @@ static JsonbValue *pushJsonbValueScalar(JsonbParseState **pstate,
 										JsonbIteratorToken seq,
 										JsonbValue *scalarVal);
 
+/*
+ * Detoast a jsonb datum, remembering the result if it was stored out of line.
+ *
+ * A query that extracts several fields from one jsonb column, as in
+ * "SELECT doc->>'a', doc->>'b', ...", calls an accessor function for each of
+ * them, and each would otherwise fetch and decompress the whole document
+ * again.  The accessors use this instead of PG_GETARG_JSONB_P, so that only
+ * the first one pays for that.
+ *
+ * Values are identified by their TOAST pointer.  That is only unique among
+ * values that someone can still see, so entries are only used under the
+ * snapshot they were fetched with; a new snapshot (or command ID) empties the
+ * cache.
+ *
+ * The result belongs to the cache and may be freed by the next call, so
+ * callers must not free it, and must not return it or anything pointing into
+ * it.
+ */
+Jsonb *
+DatumGetJsonbPCached(Datum d)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(d);
+	struct varatt_external toast_pointer;
+	JsonbDetoastCache *cache = jsonb_detoast_cache;
+	JsonbDetoastCacheEntry *entry;
+	Snapshot	snapshot;
+	MemoryContext oldcxt;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr) || !ActiveSnapshotSet())
+		return DatumGetJsonbP(d);
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	if (toast_pointer.va_rawsize > JSONB_DETOAST_CACHE_MAX_VALUE)
+		return DatumGetJsonbP(d);
+
+	if (cache == NULL)
+	{
+		cache = MemoryContextAllocZero(TopMemoryContext,
+									   sizeof(JsonbDetoastCache));
+		cache->cxt = AllocSetContextCreate(TopMemoryContext,
+										   "jsonb detoast cache",
+										   ALLOCSET_DEFAULT_SIZES);
+		jsonb_detoast_cache = cache;
+	}
+
+	snapshot = GetActiveSnapshot();
+	if (cache->xmin != snapshot->xmin ||
+		cache->xmax != snapshot->xmax ||
+		cache->curcid != snapshot->curcid)
+	{
+		MemoryContextReset(cache->cxt);
+		for (int i = 0; i < JSONB_DETOAST_CACHE_SIZE; i++)
+			cache->entries[i].value = NULL;
+		cache->xmin = snapshot->xmin;
+		cache->xmax = snapshot->xmax;
+		cache->curcid = snapshot->curcid;
+	}
+	else
+	{
+		for (int i = 0; i < JSONB_DETOAST_CACHE_SIZE; i++)
+		{
+			entry = &cache->entries[i];
+			if (entry->value != NULL &&
+				entry->valueid == toast_pointer.va_valueid &&
+				entry->toastrelid == toast_pointer.va_toastrelid)
+				return entry->value;
+		}
+	}
+
+	entry = &cache->entries[cache->next];
+	cache->next = (cache->next + 1) % JSONB_DETOAST_CACHE_SIZE;
+
+	if (entry->value != NULL)
+	{
+		pfree(entry->value);
+		entry->value = NULL;
+	}
+
+	oldcxt = MemoryContextSwitchTo(cache->cxt);
+	entry->value = DatumGetJsonbP(d);
+	MemoryContextSwitchTo(oldcxt);
+
+	entry->toastrelid = toast_pointer.va_toastrelid;
+	entry->valueid = toast_pointer.va_valueid;
+
+	return entry->value;
+}
+
 void
 JsonbToJsonbValue(Jsonb *jsonb, JsonbValue *val)
 {
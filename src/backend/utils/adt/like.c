@@ -45,8 +45,10 @@ static int	UTF8_MatchText(const char *t, int tlen, const char *p, int plen,
 static int	SB_IMatchText(const char *t, int tlen, const char *p, int plen,
 						  pg_locale_t locale, bool locale_is_c);
 
+static int	LiteralMatchText(const char *s, int slen, const char *p, int plen);
 static int	GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation);
 static int	Generic_Text_IC_like(text *str, text *pat, Oid collation);
+static text *fetch_like_string(Datum str, const char *p, int plen);
 
 /*--------------------
  * Support routine for MatchText. Compares given multibyte streams
@@ -146,10 +148,80 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 
 #include "like_match.c"
 
+/*
+ * Fast path for the most common kinds of pattern: a literal string, possibly
+ * with a leading and/or trailing '%', such as '%token%' or 'abc%'.
+ *
+ * Returns LIKE_TRUE or LIKE_FALSE if the pattern is of that form, or
+ * LIKE_ABORT if it's not and the caller has to use MatchText.  Matching bytes
+ * is only equivalent to matching characters in single-byte encodings and in
+ * UTF8, where a valid character can't start in the middle of another one, so
+ * the caller must check for that.
+ */
+static int
+LiteralMatchText(const char *s, int slen, const char *p, int plen)
+{
+	bool		leading = false;
+	bool		trailing = false;
+	const char *send;
+
+	if (plen > 0 && p[0] == '%')
+	{
+		leading = true;
+		p++, plen--;
+	}
+	if (plen > 0 && p[plen - 1] == '%')
+	{
+		trailing = true;
+		plen--;
+	}
+
+	/* Let MatchText deal with an empty literal, and with pure '%' patterns */
+	if (plen == 0)
+		return LIKE_ABORT;
+	for (int i = 0; i < plen; i++)
+	{
+		if (p[i] == '%' || p[i] == '_' || p[i] == '\\')
+			return LIKE_ABORT;
+	}
+
+	if (slen < plen)
+		return LIKE_FALSE;
+
+	if (!leading)
+	{
+		if (!trailing && slen != plen)
+			return LIKE_FALSE;
+		return memcmp(s, p, plen) == 0 ? LIKE_TRUE : LIKE_FALSE;
+	}
+	if (!trailing)
+		return memcmp(s + slen - plen, p, plen) == 0 ? LIKE_TRUE : LIKE_FALSE;
+
+	/*
+	 * '%literal%': look for the literal's first byte with memchr(), which is
+	 * much faster than looping here, and check its last byte before
+	 * comparing the rest.
+	 */
+	send = s + slen - plen;
+	while (s <= send)
+	{
+		s = memchr(s, (unsigned char) p[0], send - s + 1);
+		if (s == NULL)
+			break;
+		if (s[plen - 1] == p[plen - 1] && memcmp(s + 1, p + 1, plen - 1) == 0)
+			return LIKE_TRUE;
+		s++;
+	}
+
+	return LIKE_FALSE;
+}
+
 /* Generic for all cases not requiring inline case-folding */
 static inline int
 GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation)
 {
+	int			result;
+
 	if (collation && !lc_ctype_is_c(collation) && collation != DEFAULT_COLLATION_OID)
 	{
 		pg_locale_t locale = pg_newlocale_from_collation(collation);
@@ -161,9 +233,19 @@ GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation
 	}
 
 	if (pg_database_encoding_max_length() == 1)
+	{
+		result = LiteralMatchText(s, slen, p, plen);
+		if (result != LIKE_ABORT)
+			return result;
 		return SB_MatchText(s, slen, p, plen, 0, true);
+	}
 	else if (GetDatabaseEncoding() == PG_UTF8)
+	{
+		result = LiteralMatchText(s, slen, p, plen);
+		if (result != LIKE_ABORT)
+			return result;
 		return UTF8_MatchText(s, slen, p, plen, 0, true);
+	}
 	else
 		return MB_MatchText(s, slen, p, plen, 0, true);
 }
@@ -280,10 +362,42 @@ namenlike(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(result);
 }
 
+/*
+ * Fetch the string operand of LIKE or NOT LIKE.
+ *
+ * If the pattern is a plain prefix followed by '%' (as in 'abc%'), no more
+ * than the prefix's length in bytes of the string can affect the result, so
+ * for a compressed or out-of-line value we fetch just that slice rather than
+ * detoasting all of it.
+ */
+static text *
+fetch_like_string(Datum str, const char *p, int plen)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(str);
+	int			prefixlen;
+
+	if (!VARATT_IS_EXTERNAL(attr) && !VARATT_IS_COMPRESSED(attr))
+		return DatumGetTextPP(str);
+
+	prefixlen = plen;
+	while (prefixlen > 0 && p[prefixlen - 1] == '%')
+		prefixlen--;
+	if (prefixlen == plen)
+		return DatumGetTextPP(str);
+
+	for (int i = 0; i < prefixlen; i++)
+	{
+		if (p[i] == '%' || p[i] == '_' || p[i] == '\\')
+			return DatumGetTextPP(str);
+	}
+
+	return DatumGetTextPSlice(str, 0, prefixlen);
+}
+
 Datum
 textlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
@@ -291,10 +405,11 @@ textlike(PG_FUNCTION_ARGS)
 	int			slen,
 				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
+	str = fetch_like_string(PG_GETARG_DATUM(0), p, plen);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
 
 	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) == LIKE_TRUE);
 
@@ -304,7 +419,7 @@ textlike(PG_FUNCTION_ARGS)
 Datum
 textnlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
@@ -312,10 +427,11 @@ textnlike(PG_FUNCTION_ARGS)
 	int			slen,
 				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
+	str = fetch_like_string(PG_GETARG_DATUM(0), p, plen);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
 
 	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) != LIKE_TRUE);
 
@@ -519,6 +519,8 @@ static void apply_typmod_special(Numeric num, int32 typmod);
 static bool numericvar_to_int32(const NumericVar *var, int32 *result);
 static bool numericvar_to_int64(const NumericVar *var, int64 *result);
 static void int64_to_numericvar(int64 val, NumericVar *var);
+static bool numeric_to_scaled_int64(Numeric num, int scale, int64 *result);
+static Numeric scaled_int64_to_numeric(int64 val, int scale);
 static bool numericvar_to_uint64(const NumericVar *var, uint64 *result);
 #ifdef HAVE_INT128
 static bool numericvar_to_int128(const NumericVar *var, int128 *result);
@@ -2815,6 +2817,27 @@ numeric_add_opt_error(Numeric num1, Numeric num2, bool *have_error)
 		return make_result(&const_ninf);
 	}
 
+	/*
+	 * If both values fit in an int64 when scaled to the larger of their
+	 * dscales, which is the dscale add_var() would give the result, just add
+	 * those.
+	 */
+	{
+		int			rscale = Max(NUMERIC_DSCALE(num1), NUMERIC_DSCALE(num2));
+		int64		val1;
+		int64		val2;
+		int64		sum;
+
+		if (numeric_to_scaled_int64(num1, rscale, &val1) &&
+			numeric_to_scaled_int64(num2, rscale, &val2) &&
+			!pg_add_s64_overflow(val1, val2, &sum))
+		{
+			if (have_error)
+				*have_error = false;
+			return scaled_int64_to_numeric(sum, rscale);
+		}
+	}
+
 	/*
 	 * Unpack the values, let add_var() compute the result and return it.
 	 */
@@ -2893,6 +2916,23 @@ numeric_sub_opt_error(Numeric num1, Numeric num2, bool *have_error)
 		return make_result(&const_pinf);
 	}
 
+	/* Fast path for small values, as in numeric_add_opt_error() */
+	{
+		int			rscale = Max(NUMERIC_DSCALE(num1), NUMERIC_DSCALE(num2));
+		int64		val1;
+		int64		val2;
+		int64		diff;
+
+		if (numeric_to_scaled_int64(num1, rscale, &val1) &&
+			numeric_to_scaled_int64(num2, rscale, &val2) &&
+			!pg_sub_s64_overflow(val1, val2, &diff))
+		{
+			if (have_error)
+				*have_error = false;
+			return scaled_int64_to_numeric(diff, rscale);
+		}
+	}
+
 	/*
 	 * Unpack the values, let sub_var() compute the result and return it.
 	 */
@@ -3013,7 +3053,28 @@ numeric_mul_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	 * after computing the exact result ensures that the final result is
 	 * correctly rounded (rounding in mul_var() using a truncated product
 	 * would not guarantee this).
+	 *
+	 * If both values fit in int64s scaled by their own dscales, and so does
+	 * their product, that is the exact result, scaled by the sum of the
+	 * dscales.  That sum is small enough not to need rounding.
 	 */
+	{
+		int64		val1;
+		int64		val2;
+		int64		product;
+
+		if (numeric_to_scaled_int64(num1, NUMERIC_DSCALE(num1), &val1) &&
+			numeric_to_scaled_int64(num2, NUMERIC_DSCALE(num2), &val2) &&
+			!pg_mul_s64_overflow(val1, val2, &product))
+		{
+			if (have_error)
+				*have_error = false;
+			return scaled_int64_to_numeric(product,
+										   NUMERIC_DSCALE(num1) +
+										   NUMERIC_DSCALE(num2));
+		}
+	}
+
 	init_var_from_num(num1, &arg1);
 	init_var_from_num(num2, &arg2);
 
@@ -7644,6 +7705,104 @@ numericvar_to_int64(const NumericVar *var, int64 *result)
 	return true;
 }
 
+/*
+ * Convert a finite numeric to an int64 holding its value times 10^scale.
+ *
+ * Returns false if the numeric has more than scale digits after the decimal
+ * point (in which case the result would not be exact), or the result would
+ * not fit.  This is used for fast paths in arithmetic on small values, such
+ * as the amounts in a numeric(12,2) column, so it works directly on the
+ * packed digits.
+ */
+static bool
+numeric_to_scaled_int64(Numeric num, int scale, int64 *result)
+{
+	NumericDigit *digits;
+	int			ndigits;
+	int			weight;
+	int			fracgroups;
+	int64		val = 0;
+
+	if (NUMERIC_IS_SPECIAL(num) || NUMERIC_DSCALE(num) > scale ||
+		scale > 18)
+		return false;
+
+	digits = NUMERIC_DIGITS(num);
+	ndigits = NUMERIC_NDIGITS(num);
+	weight = NUMERIC_WEIGHT(num);
+
+	/* Quick exit for values that would obviously overflow */
+	if (ndigits > 5 || weight > 4)
+		return false;
+
+	/*
+	 * Collect the digits from the highest one down to the NBASE digit that
+	 * holds the scale'th decimal digit; there are no nonzero digits below
+	 * that, since the dscale is no more than scale.
+	 */
+	fracgroups = (scale + DEC_DIGITS - 1) / DEC_DIGITS;
+	for (int i = 0; i < weight + 1 + fracgroups; i++)
+	{
+		NumericDigit dig = i < ndigits ? digits[i] : 0;
+
+		if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)) ||
+			unlikely(pg_add_s64_overflow(val, dig, &val)))
+			return false;
+	}
+
+	/* Now val is scaled by NBASE^fracgroups; reduce that to 10^scale */
+	if (scale % DEC_DIGITS != 0)
+		val /= round_powers[scale % DEC_DIGITS];
+
+	*result = NUMERIC_SIGN(num) == NUMERIC_NEG ? -val : val;
+	return true;
+}
+
+/*
+ * Convert an int64 holding a value times 10^scale back to a numeric with
+ * the given dscale.  This is the inverse of numeric_to_scaled_int64().
+ */
+static Numeric
+scaled_int64_to_numeric(int64 val, int scale)
+{
+	NumericVar	var;
+	NumericDigit buf[(20 + DEC_DIGITS) / DEC_DIGITS + 1];
+	NumericDigit *ptr = buf + lengthof(buf);
+	uint64		uval;
+	int			fracgroups = (scale + DEC_DIGITS - 1) / DEC_DIGITS;
+	int			ndigits = 0;
+
+	uval = val < 0 ? -(uint64) val : (uint64) val;
+
+	/*
+	 * If the scale is not a multiple of DEC_DIGITS, the lowest NBASE digit
+	 * holds only the last few decimal digits, padded with zeroes.
+	 */
+	if (scale % DEC_DIGITS != 0 && uval != 0)
+	{
+		uint64		lowpow = NBASE / round_powers[scale % DEC_DIGITS];
+
+		*--ptr = (uval % lowpow) * round_powers[scale % DEC_DIGITS];
+		ndigits++;
+		uval /= lowpow;
+	}
+	while (uval != 0)
+	{
+		*--ptr = uval % NBASE;
+		ndigits++;
+		uval /= NBASE;
+	}
+
+	var.sign = val < 0 ? NUMERIC_NEG : NUMERIC_POS;
+	var.ndigits = ndigits;
+	var.weight = ndigits - 1 - fracgroups;
+	var.dscale = scale;
+	var.buf = NULL;
+	var.digits = ptr;
+
+	return make_result(&var);
+}
+
 /*
  * Convert int8 value to numeric.
  */
@@ -28,6 +28,7 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/inet.h"
 #include "utils/timestamp.h"
@@ -1561,6 +1562,210 @@ pg_stat_get_db_deadlocks(PG_FUNCTION_ARGS)
 	PG_RETURN_INT64(result);
 }
 
+Datum
+pg_stat_get_db_deadlock_checks(PG_FUNCTION_ARGS)
+{
+	Oid			dbid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatDBEntry *dbentry;
+
+	if ((dbentry = pgstat_fetch_stat_dbentry(dbid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (dbentry->n_deadlock_checks);
+
+	PG_RETURN_INT64(result);
+}
+
+Datum
+pg_stat_get_db_deadlock_check_time(PG_FUNCTION_ARGS)
+{
+	Oid			dbid = PG_GETARG_OID(0);
+	double		result = 0.0;
+	PgStat_StatDBEntry *dbentry;
+
+	/* convert counter from microsec to millisec for display */
+	if ((dbentry = pgstat_fetch_stat_dbentry(dbid)) != NULL)
+		result = ((double) dbentry->total_deadlock_check_time) / 1000.0;
+
+	PG_RETURN_FLOAT8(result);
+}
+
+/*
+ * Returns the wait event statistics of a database, one row per wait event
+ * that was waited for.
+ */
+Datum
+pg_stat_get_db_wait_events(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_DB_WAIT_EVENTS_COLS	4
+	Oid			dbid = PG_GETARG_OID(0);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_StatDBEntry *dbentry;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if ((dbentry = pgstat_fetch_stat_dbentry(dbid)) != NULL)
+	{
+		for (int slot = 0; slot < PGSTAT_WAIT_EVENT_SLOTS; slot++)
+		{
+			/* for each row */
+			Datum		values[PG_STAT_GET_DB_WAIT_EVENTS_COLS];
+			bool		nulls[PG_STAT_GET_DB_WAIT_EVENTS_COLS];
+			PgStat_WaitEventCounts *counts = &dbentry->wait_events[slot];
+			uint32		wait_event_info;
+			bool		other;
+
+			if (counts->calls == 0)
+				continue;
+
+			wait_event_info = pgstat_wait_event_slot_info(slot, &other);
+
+			MemSet(values, 0, sizeof(values));
+			MemSet(nulls, 0, sizeof(nulls));
+
+			values[0] = CStringGetTextDatum(pgstat_get_wait_event_type(wait_event_info));
+			if (other)
+				values[1] = CStringGetTextDatum("other");
+			else
+				values[1] = CStringGetTextDatum(pgstat_get_wait_event(wait_event_info));
+			values[2] = Int64GetDatum(counts->calls);
+			/* convert counter from microsec to millisec for display */
+			values[3] = Float8GetDatum(((double) counts->time) / 1000.0);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the wait time histograms of a database, one row per wait event
+ * type.
+ */
+Datum
+pg_stat_get_db_wait_event_types(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_DB_WAIT_EVENT_TYPES_COLS	4
+	Oid			dbid = PG_GETARG_OID(0);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_StatDBEntry *dbentry;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if ((dbentry = pgstat_fetch_stat_dbentry(dbid)) != NULL)
+	{
+		PgStat_Counter calls[PGSTAT_WAIT_CLASSES] = {0};
+		PgStat_Counter time[PGSTAT_WAIT_CLASSES] = {0};
+
+		/* sum up the events of each type */
+		for (int slot = 0; slot < PGSTAT_WAIT_EVENT_SLOTS; slot++)
+		{
+			PgStat_WaitEventCounts *counts = &dbentry->wait_events[slot];
+			int			class_index;
+			bool		other;
+
+			if (counts->calls == 0)
+				continue;
+
+			class_index =
+				pgstat_wait_class_index(pgstat_wait_event_slot_info(slot, &other));
+			calls[class_index] += counts->calls;
+			time[class_index] += counts->time;
+		}
+
+		for (int i = 0; i < PGSTAT_WAIT_CLASSES; i++)
+		{
+			/* for each row */
+			Datum		values[PG_STAT_GET_DB_WAIT_EVENT_TYPES_COLS];
+			bool		nulls[PG_STAT_GET_DB_WAIT_EVENT_TYPES_COLS];
+			Datum		histogram[PGSTAT_WAIT_TIME_BUCKETS];
+
+			if (calls[i] == 0)
+				continue;
+
+			MemSet(values, 0, sizeof(values));
+			MemSet(nulls, 0, sizeof(nulls));
+
+			values[0] = CStringGetTextDatum(pgstat_get_wait_event_type(pgstat_wait_class_info(i)));
+			values[1] = Int64GetDatum(calls[i]);
+			/* convert counter from microsec to millisec for display */
+			values[2] = Float8GetDatum(((double) time[i]) / 1000.0);
+
+			for (int j = 0; j < PGSTAT_WAIT_TIME_BUCKETS; j++)
+				histogram[j] = Int64GetDatum(dbentry->wait_histograms[i][j]);
+			values[3] = PointerGetDatum(construct_array(histogram,
+														PGSTAT_WAIT_TIME_BUCKETS,
+														INT8OID, sizeof(int64),
+														FLOAT8PASSBYVAL,
+														TYPALIGN_DOUBLE));
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_db_checksum_failures(PG_FUNCTION_ARGS)
 {
@@ -1802,12 +2007,13 @@ pg_stat_get_buf_alloc(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_wal(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_WAL_COLS	9
+#define PG_STAT_GET_WAL_COLS	10
 	TupleDesc	tupdesc;
 	Datum		values[PG_STAT_GET_WAL_COLS];
 	bool		nulls[PG_STAT_GET_WAL_COLS];
 	char		buf[256];
 	PgStat_WalStats *wal_stats;
+	Datum		histogram[PGSTAT_WAL_SYNC_BUCKETS];
 
 	/* Initialise values and NULL flags arrays */
 	MemSet(values, 0, sizeof(values));
@@ -1831,7 +2037,9 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 					   FLOAT8OID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "wal_sync_time",
 					   FLOAT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "stats_reset",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "wal_sync_histogram",
+					   INT8ARRAYOID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 10, "stats_reset",
 					   TIMESTAMPTZOID, -1, 0);
 
 	BlessTupleDesc(tupdesc);
@@ -1858,7 +2066,15 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 	values[6] = Float8GetDatum(((double) wal_stats->wal_write_time) / 1000.0);
 	values[7] = Float8GetDatum(((double) wal_stats->wal_sync_time) / 1000.0);
 
-	values[8] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
+	for (int i = 0; i < PGSTAT_WAL_SYNC_BUCKETS; i++)
+		histogram[i] = Int64GetDatum(wal_stats->wal_sync_histogram[i]);
+	values[8] = PointerGetDatum(construct_array(histogram,
+												PGSTAT_WAL_SYNC_BUCKETS,
+												INT8OID, sizeof(int64),
+												FLOAT8PASSBYVAL,
+												TYPALIGN_DOUBLE));
+
+	values[9] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
 
 	/* Returns the record as Datum */
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
@@ -1941,6 +2157,148 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Can a process of type bktype do buffer I/O on io_object under io_context?
+ * pg_stat_get_io() leaves out the rows whose counts can only be zero.
+ */
+static bool
+pgstat_io_row_possible(BackendType bktype, IOObject io_object,
+					   IOContext io_context)
+{
+	switch (bktype)
+	{
+		case B_INVALID:
+		case B_ARCHIVER:
+		case B_LOGGER:
+		case B_WAL_RECEIVER:
+		case B_WAL_WRITER:
+			/* these never touch relation data */
+			return false;
+		default:
+			break;
+	}
+
+	/* only sessions use temporary tables, which never use a ring buffer */
+	if (io_object == IOOBJECT_TEMP_RELATION)
+		return (bktype == B_BACKEND || bktype == B_BG_WORKER) &&
+			io_context == IOCONTEXT_NORMAL;
+
+	return true;
+}
+
+static Datum
+io_histogram_datum(PgStat_Counter *histogram)
+{
+	Datum		elems[PGSTAT_IO_TIME_BUCKETS];
+
+	for (int i = 0; i < PGSTAT_IO_TIME_BUCKETS; i++)
+		elems[i] = Int64GetDatum(histogram[i]);
+
+	return PointerGetDatum(construct_array(elems, PGSTAT_IO_TIME_BUCKETS,
+										   INT8OID, sizeof(int64),
+										   FLOAT8PASSBYVAL,
+										   TYPALIGN_DOUBLE));
+}
+
+/*
+ * Returns I/O statistics, one row per backend type, I/O object and I/O
+ * context.
+ */
+Datum
+pg_stat_get_io(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_IO_COLS	13
+	static const char *const io_object_names[IOOBJECT_NUM_TYPES] = {
+		"relation",
+		"temp relation"
+	};
+	static const char *const io_context_names[IOCONTEXT_NUM_TYPES] = {
+		"normal",
+		"vacuum",
+		"bulkread",
+		"bulkwrite"
+	};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_IOStats *stats;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Get statistics about I/O */
+	stats = pgstat_fetch_stat_io();
+
+	for (int bktype = 0; bktype < BACKEND_NUM_TYPES; bktype++)
+	{
+		for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+		{
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+			{
+				/* for each row */
+				Datum		values[PG_STAT_GET_IO_COLS];
+				bool		nulls[PG_STAT_GET_IO_COLS];
+				PgStat_IOCounts *counts;
+
+				if (!pgstat_io_row_possible(bktype, io_object, io_context))
+					continue;
+
+				counts = &stats->counts[bktype][io_object][io_context];
+
+				MemSet(values, 0, sizeof(values));
+				MemSet(nulls, 0, sizeof(nulls));
+
+				values[0] = CStringGetTextDatum(GetBackendTypeDesc(bktype));
+				values[1] = CStringGetTextDatum(io_object_names[io_object]);
+				values[2] = CStringGetTextDatum(io_context_names[io_context]);
+				values[3] = Int64GetDatum(counts->ops[IOOP_READ]);
+				values[4] = Int64GetDatum(counts->ops[IOOP_WRITE]);
+				values[5] = Int64GetDatum(counts->ops[IOOP_EXTEND]);
+				values[6] = Int64GetDatum(counts->ops[IOOP_FSYNC]);
+				values[7] = Int64GetDatum(counts->ops[IOOP_HIT]);
+
+				/* Convert counters from microsec to millisec for display */
+				values[8] = Float8GetDatum(((double) counts->read_time) / 1000.0);
+				values[9] = Float8GetDatum(((double) counts->write_time) / 1000.0);
+
+				values[10] = io_histogram_datum(counts->read_histogram);
+				values[11] = io_histogram_datum(counts->write_histogram);
+				values[12] = TimestampTzGetDatum(stats->stat_reset_timestamp);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_xact_numscans(PG_FUNCTION_ARGS)
 {
@@ -30,7 +30,9 @@
 #include "postgres.h"
 
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "regex/regex.h"
 #include "utils/array.h"
@@ -74,7 +76,7 @@ typedef struct regexp_matches_ctx
  * Over time, an item's average position corresponds to its frequency of use.
  *
  * When we first create an entry, it's inserted at the front of
- * the array, dropping the entry at the end of the array if necessary to
+ * the list, dropping the entry at the end of the list if necessary to
  * make room.  (This might seem to be weighting the new entry too heavily,
  * but if we insert new entries further back, we'll be unable to adjust to
  * a sudden shift in the query mix where we are presented with MAX_CACHED_RES
@@ -89,13 +91,21 @@ typedef struct regexp_matches_ctx
  * patterns are seen will "fail to keep up" and will drop off the end of the
  * cache.  With move-to-front, a reusable pattern is guaranteed to stay in
  * the cache as long as it's used at least once in every MAX_CACHED_RES uses.
+ *
+ * The list is doubly linked, and entries are also found through a small
+ * hash table, so that the cache can be large enough for applications that
+ * use hundreds of distinct patterns without lookups getting slower.  An
+ * entry stays in the same slot of re_array for as long as it's cached.
  */
 
 /* this is the maximum number of cached regular expressions */
 #ifndef MAX_CACHED_RES
-#define MAX_CACHED_RES	32
+#define MAX_CACHED_RES	256
 #endif
 
+/* number of hash buckets; must be a power of 2 */
+#define RE_CACHE_NBUCKETS	(MAX_CACHED_RES * 2)
+
 /* this structure describes one cached regular expression */
 typedef struct cached_re_str
 {
@@ -104,10 +114,15 @@ typedef struct cached_re_str
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
 	regex_t		cre_re;			/* the compiled regular expression */
+	uint32		cre_hash;		/* hash of the above identifying fields */
+	struct cached_re_str *cre_next; /* next entry in the same hash bucket */
+	dlist_node	cre_node;		/* links in the list, most recent first */
 } cached_re_str;
 
 static int	num_res = 0;		/* # of cached re's */
 static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
+static cached_re_str *re_buckets[RE_CACHE_NBUCKETS];
+static dlist_head re_list = DLIST_STATIC_INIT(re_list);
 
 
 /* Local functions */
@@ -141,34 +156,35 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	char	   *text_re_val = VARDATA_ANY(text_re);
 	pg_wchar   *pattern;
 	int			pattern_len;
-	int			i;
+	uint32		hash;
+	cached_re_str **bucket;
+	cached_re_str *entry;
 	int			regcomp_result;
 	cached_re_str re_temp;
 	char		errMsg[100];
 
 	/*
-	 * Look for a match among previously compiled REs.  Since the data
-	 * structure is self-organizing with most-used entries at the front, our
-	 * search strategy can just be to scan from the front.
+	 * Look for a match among previously compiled REs.
 	 */
-	for (i = 0; i < num_res; i++)
+	hash = hash_bytes((const unsigned char *) text_re_val, text_re_len);
+	hash = hash_combine(hash, murmurhash32((uint32) cflags));
+	hash = hash_combine(hash, murmurhash32((uint32) collation));
+	bucket = &re_buckets[hash & (RE_CACHE_NBUCKETS - 1)];
+
+	for (entry = *bucket; entry != NULL; entry = entry->cre_next)
 	{
-		if (re_array[i].cre_pat_len == text_re_len &&
-			re_array[i].cre_flags == cflags &&
-			re_array[i].cre_collation == collation &&
-			memcmp(re_array[i].cre_pat, text_re_val, text_re_len) == 0)
+		if (entry->cre_hash == hash &&
+			entry->cre_pat_len == text_re_len &&
+			entry->cre_flags == cflags &&
+			entry->cre_collation == collation &&
+			memcmp(entry->cre_pat, text_re_val, text_re_len) == 0)
 		{
 			/*
 			 * Found a match; move it to front if not there already.
 			 */
-			if (i > 0)
-			{
-				re_temp = re_array[i];
-				memmove(&re_array[1], &re_array[0], i * sizeof(cached_re_str));
-				re_array[0] = re_temp;
-			}
+			dlist_move_head(&re_list, &entry->cre_node);
 
-			return &re_array[0].cre_re;
+			return &entry->cre_re;
 		}
 	}
 
@@ -228,25 +244,36 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_temp.cre_flags = cflags;
 	re_temp.cre_collation = collation;
 
+	re_temp.cre_hash = hash;
+
 	/*
 	 * Okay, we have a valid new item in re_temp; insert it into the storage
 	 * array.  Discard last entry if needed.
 	 */
 	if (num_res >= MAX_CACHED_RES)
 	{
-		--num_res;
-		Assert(num_res < MAX_CACHED_RES);
-		pg_regfree(&re_array[num_res].cre_re);
-		free(re_array[num_res].cre_pat);
-	}
+		cached_re_str **prev;
+
+		entry = dlist_tail_element(cached_re_str, cre_node, &re_list);
+		dlist_delete(&entry->cre_node);
 
-	if (num_res > 0)
-		memmove(&re_array[1], &re_array[0], num_res * sizeof(cached_re_str));
+		prev = &re_buckets[entry->cre_hash & (RE_CACHE_NBUCKETS - 1)];
+		while (*prev != entry)
+			prev = &(*prev)->cre_next;
+		*prev = entry->cre_next;
+
+		pg_regfree(&entry->cre_re);
+		free(entry->cre_pat);
+	}
+	else
+		entry = &re_array[num_res++];
 
-	re_array[0] = re_temp;
-	num_res++;
+	*entry = re_temp;
+	entry->cre_next = *bucket;
+	*bucket = entry;
+	dlist_push_head(&re_list, &entry->cre_node);
 
-	return &re_array[0].cre_re;
+	return &entry->cre_re;
 }
 
 /*
@@ -23,6 +23,7 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -108,6 +109,7 @@ typedef struct RI_ConstraintInfo
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
 	Oid			fk_relid;		/* referencing relation */
+	Oid			conindid;		/* unique index on referenced columns */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
 	char		confmatchtype;	/* foreign key's match type */
@@ -213,6 +215,9 @@ static const RI_ConstraintInfo *ri_LoadConstraintInfo(Oid constraintOid);
 static Oid	get_ri_constraint_root(Oid constrOid);
 static SPIPlanPtr ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 							   RI_QueryKey *qkey, Relation fk_rel, Relation pk_rel);
+static bool ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+							 Relation fk_rel, Relation pk_rel,
+							 TupleTableSlot *newslot, bool *found);
 static bool ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 							RI_QueryKey *qkey, SPIPlanPtr qplan,
 							Relation fk_rel, Relation pk_rel,
@@ -241,6 +246,7 @@ RI_FKey_check(TriggerData *trigdata)
 	TupleTableSlot *newslot;
 	RI_QueryKey qkey;
 	SPIPlanPtr	qplan;
+	bool		found;
 
 	riinfo = ri_FetchConstraintInfo(trigdata->tg_trigger,
 									trigdata->tg_relation, false);
@@ -337,6 +343,24 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * In the common case, the key can be looked up directly in the PK
+	 * table's unique index, which is much cheaper than going through SPI.
+	 */
+	if (ri_FastPathCheck(riinfo, fk_rel, pk_rel, newslot, &found))
+	{
+		if (!found)
+			ri_ReportViolation(riinfo,
+							   pk_rel, fk_rel,
+							   newslot,
+							   NULL,
+							   RI_PLAN_CHECK_LOOKUPPK, false);
+
+		table_close(pk_rel, RowShareLock);
+
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -2088,6 +2112,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
 	riinfo->fk_relid = conForm->conrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
@@ -2234,6 +2259,215 @@ ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 	return qplan;
 }
 
+/*
+ * Look up the FK key of newslot in the PK table's unique index, without SPI.
+ *
+ * This does the same thing as the SELECT ... FOR KEY SHARE query that
+ * RI_FKey_check would otherwise run: find the PK row using a fresh snapshot
+ * and lock it in KEY SHARE mode, following the update chain in READ
+ * COMMITTED mode.  *found is set to whether such a row exists.
+ *
+ * Returns false if the fast path can't be used, because the PK table is
+ * partitioned, because its owner lacks the privileges the query would need
+ * (so that the query reports the error), or because the FK values would need
+ * a type coercion before they can be compared to the index column.  The
+ * caller must run the query in that case.
+ */
+static bool
+ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+				 Relation fk_rel, Relation pk_rel,
+				 TupleTableSlot *newslot, bool *found)
+{
+	Relation	idx_rel;
+	ScanKeyData skey[INDEX_MAX_KEYS];
+	int			nkeys;
+	IndexScanDesc scan;
+	TupleTableSlot *pk_slot;
+	Snapshot	snapshot;
+	Oid			save_userid;
+	int			save_sec_context;
+
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	if (pg_class_aclcheck(RelationGetRelid(pk_rel),
+						  RelationGetForm(pk_rel)->relowner,
+						  ACL_SELECT | ACL_UPDATE) != ACLCHECK_OK)
+		return false;
+
+	idx_rel = index_open(riinfo->conindid, AccessShareLock);
+	nkeys = IndexRelationGetNumberOfKeyAttributes(idx_rel);
+	Assert(nkeys == riinfo->nkeys);
+
+	/*
+	 * Build a scan key for each index column.  The index's columns are not
+	 * necessarily in the same order as the constraint's.
+	 */
+	for (int j = 0; j < nkeys; j++)
+	{
+		AttrNumber	pk_attnum = idx_rel->rd_index->indkey.values[j];
+		Oid			opfamily = idx_rel->rd_opfamily[j];
+		Oid			fk_type;
+		Oid			eq_opr;
+		int			op_strategy;
+		Oid			op_lefttype;
+		Oid			op_righttype;
+		Datum		value;
+		bool		isnull;
+		int			i;
+
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			if (riinfo->pk_attnums[i] == pk_attnum)
+				break;
+		}
+		if (i >= riinfo->nkeys)
+		{
+			index_close(idx_rel, AccessShareLock);
+			return false;
+		}
+
+		eq_opr = riinfo->pf_eq_oprs[i];
+		fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+
+		if (!op_in_opfamily(eq_opr, opfamily))
+		{
+			index_close(idx_rel, AccessShareLock);
+			return false;
+		}
+		get_op_opfamily_properties(eq_opr, opfamily, false,
+								   &op_strategy,
+								   &op_lefttype,
+								   &op_righttype);
+		if (fk_type != op_righttype &&
+			!IsBinaryCoercible(fk_type, op_righttype))
+		{
+			index_close(idx_rel, AccessShareLock);
+			return false;
+		}
+
+		value = slot_getattr(newslot, riinfo->fk_attnums[i], &isnull);
+		Assert(!isnull);
+
+		ScanKeyEntryInitialize(&skey[j],
+							   0,
+							   j + 1,
+							   op_strategy,
+							   op_righttype,
+							   idx_rel->rd_indcollation[j],
+							   get_opcode(eq_opr),
+							   value);
+	}
+
+	/*
+	 * Do the lookup as the PK table's owner, like the query would.  As in
+	 * SPI, make sure our own earlier work is visible.
+	 */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(RelationGetForm(pk_rel)->relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	CommandCounterIncrement();
+	snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	pk_slot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idx_rel, snapshot, nkeys, 0);
+	index_rescan(scan, skey, nkeys, NULL, 0);
+
+	*found = false;
+	while (!*found && index_getnext_slot(scan, ForwardScanDirection, pk_slot))
+	{
+		TM_FailureData tmfd;
+		TM_Result	res;
+		int			lockflags;
+
+		lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+		if (!IsolationUsesXactSnapshot())
+			lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+		res = table_tuple_lock(pk_rel, &pk_slot->tts_tid, snapshot,
+							   pk_slot,
+							   GetCurrentCommandId(false),
+							   LockTupleKeyShare,
+							   LockWaitBlock,
+							   lockflags,
+							   &tmfd);
+
+		switch (res)
+		{
+			case TM_Ok:
+				*found = true;
+
+				/*
+				 * If we locked a newer version of the row, it might no longer
+				 * have the key we were looking for.
+				 */
+				if (tmfd.traversed)
+				{
+					for (int j = 0; j < nkeys; j++)
+					{
+						Datum		value;
+						bool		isnull;
+
+						value = slot_getattr(pk_slot,
+											 idx_rel->rd_index->indkey.values[j],
+											 &isnull);
+						if (isnull ||
+							!DatumGetBool(FunctionCall2Coll(&skey[j].sk_func,
+															skey[j].sk_collation,
+															value,
+															skey[j].sk_argument)))
+						{
+							*found = false;
+							break;
+						}
+					}
+				}
+				break;
+
+			case TM_SelfModified:
+				/* updated or deleted by the current command; ignore it */
+				break;
+
+			case TM_Updated:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				elog(ERROR, "unexpected table_tuple_lock status: %u", res);
+				break;
+
+			case TM_Deleted:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				/* row was deleted, so it doesn't count */
+				break;
+
+			case TM_Invisible:
+				elog(ERROR, "attempted to lock invisible tuple");
+				break;
+
+			default:
+				elog(ERROR, "unrecognized table_tuple_lock status: %u", res);
+				break;
+		}
+	}
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(pk_slot);
+	UnregisterSnapshot(snapshot);
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	index_close(idx_rel, AccessShareLock);
+
+	return true;
+}
+
 /*
  * Perform a query to enforce an RI restriction
  */
@@ -100,6 +100,7 @@
 #include "access/brin.h"
 #include "access/brin_page.h"
 #include "access/gin.h"
+#include "access/nbtree.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/visibilitymap.h"
@@ -6626,8 +6627,125 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		num_skip_values;
+	double		num_descents;
 	ListCell   *lc;
 
+	/*
+	 * Fetch the statistics of the first index column, if any.  We use them
+	 * below to decide about skip scans and to estimate the correlation.
+	 */
+	MemSet(&vardata, 0, sizeof(vardata));
+
+	if (index->indexkeys[0] != 0)
+	{
+		/* Simple variable --- look to stats for the underlying table */
+		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
+
+		Assert(rte->rtekind == RTE_RELATION);
+		relid = rte->relid;
+		Assert(relid != InvalidOid);
+		colnum = index->indexkeys[0];
+
+		if (get_relation_stats_hook &&
+			(*get_relation_stats_hook) (root, rte, colnum, &vardata))
+		{
+			/*
+			 * The hook took control of acquiring a stats tuple.  If it did
+			 * supply a tuple, it'd better have supplied a freefunc.
+			 */
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(relid),
+												 Int16GetDatum(colnum),
+												 BoolGetDatum(rte->inh));
+			vardata.freefunc = ReleaseSysCache;
+		}
+	}
+	else
+	{
+		/* Expression --- maybe there are stats for the index itself */
+		relid = index->indexoid;
+		colnum = 1;
+
+		if (get_index_stats_hook &&
+			(*get_index_stats_hook) (root, relid, colnum, &vardata))
+		{
+			/*
+			 * The hook took control of acquiring a stats tuple.  If it did
+			 * supply a tuple, it'd better have supplied a freefunc.
+			 */
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(relid),
+												 Int16GetDatum(colnum),
+												 BoolGetDatum(false));
+			vardata.freefunc = ReleaseSysCache;
+		}
+	}
+
+	/*
+	 * If there are quals on the second index column but none on the first,
+	 * and no ScalarArrayOpExprs, nbtree can do a skip scan (see
+	 * _bt_preprocess_skip_key): it treats the first column as if it had an
+	 * '=' qual, at the price of two descents of the tree per distinct value
+	 * of that column.  Cost the scan that way if the values are few enough
+	 * that each one spans a couple of leaf pages on average; with more of
+	 * them, skipping saves nothing, and nbtree ends up reading the whole
+	 * index anyway.  Whether the index's opclass allows a skip scan at all
+	 * is up to nbtree.
+	 */
+	num_skip_values = 0;
+	if (index->nkeycolumns >= 2 &&
+		!path->path.parallel_aware &&
+		path->indexclauses != NIL &&
+		linitial_node(IndexClause, path->indexclauses)->indexcol == 1 &&
+		HeapTupleIsValid(vardata.statsTuple))
+	{
+		Relation	indexRel;
+		bool		supported;
+		bool		found_array = false;
+
+		indexRel = index_open(index->indexoid, NoLock);
+		supported = _bt_skip_scan_supported(indexRel);
+		index_close(indexRel, NoLock);
+
+		foreach(lc, path->indexclauses)
+		{
+			IndexClause *iclause = lfirst_node(IndexClause, lc);
+			ListCell   *lc2;
+
+			foreach(lc2, iclause->indexquals)
+			{
+				RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+				if (IsA(rinfo->clause, ScalarArrayOpExpr))
+					found_array = true;
+			}
+		}
+
+		if (supported && !found_array)
+		{
+			double		ndistinct;
+			bool		isdefault;
+
+			vardata.rel = index->rel;
+			ndistinct = get_variable_numdistinct(&vardata, &isdefault);
+			if (!isdefault && ndistinct * 2 <= index->pages)
+				num_skip_values = ndistinct;
+		}
+	}
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6643,10 +6761,11 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform N
 	 * index scans not one, but the ScalarArrayOpExpr's operator can be
-	 * considered to act the same as it normally does.
+	 * considered to act the same as it normally does.  Likewise for the
+	 * first column's implied '=' qual in a skip scan.
 	 */
 	indexBoundQuals = NIL;
-	indexcol = 0;
+	indexcol = (num_skip_values > 0) ? 1 : 0;
 	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
@@ -6738,7 +6857,8 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
-		!found_is_null_op)
+		!found_is_null_op &&
+		num_skip_values == 0)
 		numIndexTuples = 1.0;
 	else
 	{
@@ -6764,6 +6884,14 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		 * to integer.
 		 */
 		numIndexTuples = rint(numIndexTuples / num_sa_scans);
+
+		/*
+		 * Each primitive scan of a skip scan reads at least one leaf page,
+		 * even if it finds nothing there.
+		 */
+		if (num_skip_values > 0 && index->pages > 0)
+			numIndexTuples += rint(num_skip_values *
+								   index->tuples / index->pages);
 	}
 
 	/*
@@ -6783,13 +6911,18 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there are ScalarArrayOpExprs, charge this once per SA scan.  The
 	 * ones after the first one are not startup cost so far as the overall
-	 * plan is concerned, so add them only to "total" cost.
+	 * plan is concerned, so add them only to "total" cost.  A skip scan
+	 * descends twice for each value of the first column.
 	 */
+	num_descents = costs.num_sa_scans;
+	if (num_skip_values > 0)
+		num_descents = 2 * num_skip_values;
+
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
-		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		costs.indexTotalCost += num_descents * descentCost;
 	}
 
 	/*
@@ -6800,11 +6933,11 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * in cases where only a single leaf page is expected to be visited.  This
 	 * cost is somewhat arbitrarily set at 50x cpu_operator_cost per page
 	 * touched.  The number of such pages is btree tree height plus one (ie,
-	 * we charge for the leaf page too).  As above, charge once per SA scan.
+	 * we charge for the leaf page too).  As above, charge once per descent.
 	 */
 	descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
-	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	costs.indexTotalCost += num_descents * descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
@@ -6814,65 +6947,6 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * ordering, but don't negate it entirely.  Before 8.0 we divided the
 	 * correlation by the number of columns, but that seems too strong.)
 	 */
-	MemSet(&vardata, 0, sizeof(vardata));
-
-	if (index->indexkeys[0] != 0)
-	{
-		/* Simple variable --- look to stats for the underlying table */
-		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
-
-		Assert(rte->rtekind == RTE_RELATION);
-		relid = rte->relid;
-		Assert(relid != InvalidOid);
-		colnum = index->indexkeys[0];
-
-		if (get_relation_stats_hook &&
-			(*get_relation_stats_hook) (root, rte, colnum, &vardata))
-		{
-			/*
-			 * The hook took control of acquiring a stats tuple.  If it did
-			 * supply a tuple, it'd better have supplied a freefunc.
-			 */
-			if (HeapTupleIsValid(vardata.statsTuple) &&
-				!vardata.freefunc)
-				elog(ERROR, "no function provided to release variable stats with");
-		}
-		else
-		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(rte->inh));
-			vardata.freefunc = ReleaseSysCache;
-		}
-	}
-	else
-	{
-		/* Expression --- maybe there are stats for the index itself */
-		relid = index->indexoid;
-		colnum = 1;
-
-		if (get_index_stats_hook &&
-			(*get_index_stats_hook) (root, relid, colnum, &vardata))
-		{
-			/*
-			 * The hook took control of acquiring a stats tuple.  If it did
-			 * supply a tuple, it'd better have supplied a freefunc.
-			 */
-			if (HeapTupleIsValid(vardata.statsTuple) &&
-				!vardata.freefunc)
-				elog(ERROR, "no function provided to release variable stats with");
-		}
-		else
-		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(false));
-			vardata.freefunc = ReleaseSysCache;
-		}
-	}
-
 	if (HeapTupleIsValid(vardata.statsTuple))
 	{
 		Oid			sortop;
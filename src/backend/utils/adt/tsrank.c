@@ -34,8 +34,22 @@ static const float weights[] = {0.1f, 0.2f, 0.4f, 1.0f};
 #define RANK_NORM_RDIVRPLUS1	0x20
 #define DEF_NORM_METHOD			RANK_NO_NORM
 
-static float calc_rank_or(const float *w, TSVector t, TSQuery q);
-static float calc_rank_and(const float *w, TSVector t, TSQuery q);
+/*
+ * Sorted, de-duplicated operands of a tsquery, kept in fn_extra of ts_rank()
+ * so that they need not be collected again for every row when the query is
+ * the same.  The operands point into our own copy of the query.
+ */
+typedef struct RankQueryCache
+{
+	TSQuery		query;
+	QueryOperand **item;
+	int			size;
+} RankQueryCache;
+
+static float calc_rank_or(const float *w, TSVector t, TSQuery q,
+						  QueryOperand **item, int size);
+static float calc_rank_and(const float *w, TSVector t, TSQuery q,
+						   QueryOperand **item, int size);
 
 /*
  * Returns a weight of a word collocation
@@ -196,8 +210,52 @@ SortAndUniqItems(TSQuery q, int *size)
 	return res;
 }
 
+/*
+ * Returns the sorted, de-duplicated operands of 'q', reusing those computed
+ * by the previous call through 'flinfo' if the query is the same.  Since the
+ * cached operands point into a copy of the query, the query they belong to
+ * is returned in *cachedq, and must be used in place of 'q' from then on.
+ */
+static QueryOperand **
+GetSortedQueryItems(FmgrInfo *flinfo, TSQuery q, TSQuery *cachedq, int *size)
+{
+	RankQueryCache *cache = (RankQueryCache *) flinfo->fn_extra;
+	MemoryContext oldcontext;
+
+	if (cache != NULL &&
+		VARSIZE(cache->query) == VARSIZE(q) &&
+		memcmp(cache->query, q, VARSIZE(q)) == 0)
+	{
+		*cachedq = cache->query;
+		*size = cache->size;
+		return cache->item;
+	}
+
+	if (cache == NULL)
+		cache = (RankQueryCache *)
+			MemoryContextAllocZero(flinfo->fn_mcxt, sizeof(RankQueryCache));
+	else
+	{
+		pfree(cache->query);
+		pfree(cache->item);
+	}
+	flinfo->fn_extra = cache;
+
+	oldcontext = MemoryContextSwitchTo(flinfo->fn_mcxt);
+	cache->query = (TSQuery) palloc(VARSIZE(q));
+	memcpy(cache->query, q, VARSIZE(q));
+	cache->size = q->size;
+	cache->item = SortAndUniqItems(cache->query, &cache->size);
+	MemoryContextSwitchTo(oldcontext);
+
+	*cachedq = cache->query;
+	*size = cache->size;
+	return cache->item;
+}
+
 static float
-calc_rank_and(const float *w, TSVector t, TSQuery q)
+calc_rank_and(const float *w, TSVector t, TSQuery q,
+			  QueryOperand **item, int size)
 {
 	WordEntryPosVector **pos;
 	WordEntryPosVector1 posnull;
@@ -215,15 +273,9 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 				dist,
 				nitem;
 	float		res = -1.0;
-	QueryOperand **item;
-	int			size = q->size;
 
-	item = SortAndUniqItems(q, &size);
 	if (size < 2)
-	{
-		pfree(item);
-		return calc_rank_or(w, t, q);
-	}
+		return calc_rank_or(w, t, q, item, size);
 	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * q->size);
 
 	/* A dummy WordEntryPos array to use when haspos is false */
@@ -275,12 +327,12 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 		}
 	}
 	pfree(pos);
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank_or(const float *w, TSVector t, TSQuery q)
+calc_rank_or(const float *w, TSVector t, TSQuery q,
+			 QueryOperand **item, int size)
 {
 	WordEntry  *entry,
 			   *firstentry;
@@ -291,15 +343,11 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 				i,
 				nitem;
 	float		res = 0.0;
-	QueryOperand **item;
-	int			size = q->size;
 
 	/* A dummy WordEntryPos array to use when haspos is false */
 	posnull.npos = 1;
 	posnull.pos[0] = 0;
 
-	item = SortAndUniqItems(q, &size);
-
 	for (i = 0; i < size; i++)
 	{
 		float		resj,
@@ -349,25 +397,29 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 	}
 	if (size > 0)
 		res = res / size;
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank(const float *w, TSVector t, TSQuery q, int32 method)
+calc_rank(FmgrInfo *flinfo, const float *w, TSVector t, TSQuery q,
+		  int32 method)
 {
 	QueryItem  *item = GETQUERY(q);
+	QueryOperand **operands;
+	int			size;
 	float		res = 0.0;
 	int			len;
 
 	if (!t->size || !q->size)
 		return 0.0;
 
+	operands = GetSortedQueryItems(flinfo, q, &q, &size);
+
 	/* XXX: What about NOT? */
 	res = (item->type == QI_OPR && (item->qoperator.oper == OP_AND ||
 									item->qoperator.oper == OP_PHRASE)) ?
-		calc_rank_and(w, t, q) :
-		calc_rank_or(w, t, q);
+		calc_rank_and(w, t, q, operands, size) :
+		calc_rank_or(w, t, q, operands, size);
 
 	if (res < 0)
 		res = 1e-20f;
@@ -443,7 +495,7 @@ ts_rank_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, method);
+	res = calc_rank(fcinfo->flinfo, getWeights(win), txt, query, method);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -459,7 +511,7 @@ ts_rank_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(fcinfo->flinfo, getWeights(win), txt, query, DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -475,7 +527,7 @@ ts_rank_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, method);
+	res = calc_rank(fcinfo->flinfo, getWeights(NULL), txt, query, method);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -489,7 +541,7 @@ ts_rank_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(fcinfo->flinfo, getWeights(NULL), txt, query, DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -126,7 +126,6 @@ static int	namefastcmp_c(Datum x, Datum y, SortSupport ssup);
 static int	varlenafastcmp_locale(Datum x, Datum y, SortSupport ssup);
 static int	namefastcmp_locale(Datum x, Datum y, SortSupport ssup);
 static int	varstrfastcmp_locale(char *a1p, int len1, char *a2p, int len2, SortSupport ssup);
-static int	varstrcmp_abbrev(Datum x, Datum y, SortSupport ssup);
 static Datum varstr_abbrev_convert(Datum original, SortSupport ssup);
 static bool varstr_abbrev_abort(int memtupcount, SortSupport ssup);
 static int32 text_length(Datum str);
@@ -1400,15 +1399,10 @@ text_position_next_internal(char *start_ptr, TextPositionState *state)
 	if (needle_len == 1)
 	{
 		/* No point in using B-M-H for a one-character needle */
-		char		nchar = *needle;
-
-		hptr = start_ptr;
-		while (hptr < haystack_end)
-		{
-			if (*hptr == nchar)
-				return (char *) hptr;
-			hptr++;
-		}
+		hptr = memchr(start_ptr, (unsigned char) *needle,
+					  haystack_end - start_ptr);
+		if (hptr != NULL)
+			return (char *) hptr;
 	}
 	else
 	{
@@ -1518,6 +1512,28 @@ check_collation_set(Oid collid)
 	}
 }
 
+#ifdef USE_ICU
+/*
+ * Can this string be passed to ICU as UTF-8?  That's always true in a UTF8
+ * database.  In other databases it's still true for strings that are pure
+ * ASCII, because all server encodings are ASCII supersets, and checking that
+ * is much cheaper than converting the string to UTF-16 for ICU.
+ */
+static inline bool
+icu_string_is_utf8(const char *str, int len)
+{
+	if (GetDatabaseEncoding() == PG_UTF8)
+		return true;
+
+	for (int i = 0; i < len; i++)
+	{
+		if (IS_HIGHBIT_SET(str[i]))
+			return false;
+	}
+	return true;
+}
+#endif							/* USE_ICU */
+
 /* varstr_cmp()
  * Comparison function for text strings with given lengths.
  * Includes locale support, but must copy strings to temporary memory
@@ -1680,7 +1696,8 @@ varstr_cmp(const char *arg1, int len1, const char *arg2, int len2, Oid collid)
 			{
 #ifdef USE_ICU
 #ifdef HAVE_UCOL_STRCOLLUTF8
-				if (GetDatabaseEncoding() == PG_UTF8)
+				if (icu_string_is_utf8(arg1, len1) &&
+					icu_string_is_utf8(arg2, len2))
 				{
 					UErrorCode	status;
 
@@ -2168,7 +2185,15 @@ varstr_sortsupport(SortSupport ssup, Oid typid, Oid collid)
 			initHyperLogLog(&sss->abbr_card, 10);
 			initHyperLogLog(&sss->full_card, 10);
 			ssup->abbrev_full_comparator = ssup->comparator;
-			ssup->comparator = varstrcmp_abbrev;
+			/*
+			 * When the abbreviated keys are equal, the core system will call
+			 * varstrfastcmp_c() (bpcharfastcmp_c() in BpChar case) or
+			 * varlenafastcmp_locale().  Even a strcmp() on two non-truncated
+			 * strxfrm() blobs cannot indicate *equality* authoritatively, for
+			 * the same reason that there is a strcoll() tie-breaker call to
+			 * strcmp() in varstr_cmp().
+			 */
+			ssup->comparator = ssup_datum_unsigned_cmp;
 			ssup->abbrev_converter = varstr_abbrev_convert;
 			ssup->abbrev_abort = varstr_abbrev_abort;
 		}
@@ -2394,7 +2419,8 @@ varstrfastcmp_locale(char *a1p, int len1, char *a2p, int len2, SortSupport ssup)
 		{
 #ifdef USE_ICU
 #ifdef HAVE_UCOL_STRCOLLUTF8
-			if (GetDatabaseEncoding() == PG_UTF8)
+			if (icu_string_is_utf8(a1p, len1) &&
+				icu_string_is_utf8(a2p, len2))
 			{
 				UErrorCode	status;
 
@@ -2454,27 +2480,6 @@ varstrfastcmp_locale(char *a1p, int len1, char *a2p, int len2, SortSupport ssup)
 	return result;
 }
 
-/*
- * Abbreviated key comparison func
- */
-static int
-varstrcmp_abbrev(Datum x, Datum y, SortSupport ssup)
-{
-	/*
-	 * When 0 is returned, the core system will call varstrfastcmp_c()
-	 * (bpcharfastcmp_c() in BpChar case) or varlenafastcmp_locale().  Even a
-	 * strcmp() on two non-truncated strxfrm() blobs cannot indicate *equality*
-	 * authoritatively, for the same reason that there is a strcoll()
-	 * tie-breaker call to strcmp() in varstr_cmp().
-	 */
-	if (x > y)
-		return 1;
-	else if (x == y)
-		return 0;
-	else
-		return -1;
-}
-
 /*
  * Conversion routine for sortsupport.  Converts original to abbreviated key
  * representation.  Our encoding strategy is simple -- pack the first 8 bytes
@@ -2513,7 +2518,7 @@ varstr_abbrev_convert(Datum original, SortSupport ssup)
 	 * strings may contain NUL bytes.  Besides, this should be faster, too.
 	 *
 	 * More generally, it's okay that bytea callers can have NUL bytes in
-	 * strings because varstrcmp_abbrev() need not make a distinction between
+	 * strings because ssup_datum_unsigned_cmp() need not make a distinction between
 	 * terminating NUL bytes, and NUL bytes representing actual NULs in the
 	 * authoritative representation.  Hopefully a comparison at or past one
 	 * abbreviated key's terminating NUL byte will resolve the comparison
@@ -2539,6 +2544,7 @@ varstr_abbrev_convert(Datum original, SortSupport ssup)
 #ifdef USE_ICU
 		int32_t		ulen = -1;
 		UChar	   *uchar = NULL;
+		bool		icu_utf8 = false;
 #endif
 
 		/*
@@ -2573,10 +2579,13 @@ varstr_abbrev_convert(Datum original, SortSupport ssup)
 		sss->last_len1 = len;
 
 #ifdef USE_ICU
-		/* When using ICU and not UTF8, convert string to UChar. */
-		if (sss->locale && sss->locale->provider == COLLPROVIDER_ICU &&
-			GetDatabaseEncoding() != PG_UTF8)
-			ulen = icu_to_uchar(&uchar, sss->buf1, len);
+		/* When using ICU and the string isn't UTF-8, convert it to UChar. */
+		if (sss->locale && sss->locale->provider == COLLPROVIDER_ICU)
+		{
+			icu_utf8 = icu_string_is_utf8(sss->buf1, len);
+			if (!icu_utf8)
+				ulen = icu_to_uchar(&uchar, sss->buf1, len);
+		}
 #endif
 
 		/*
@@ -2593,10 +2602,10 @@ varstr_abbrev_convert(Datum original, SortSupport ssup)
 			if (sss->locale && sss->locale->provider == COLLPROVIDER_ICU)
 			{
 				/*
-				 * When using UTF8, use the iteration interface so we only
-				 * need to produce as many bytes as we actually need.
+				 * When the string is UTF-8, use the iteration interface so we
+				 * only need to produce as many bytes as we actually need.
 				 */
-				if (GetDatabaseEncoding() == PG_UTF8)
+				if (icu_utf8)
 				{
 					UCharIterator iter;
 					uint32_t	state[2];
@@ -2703,7 +2712,7 @@ done:
 	/*
 	 * Byteswap on little-endian machines.
 	 *
-	 * This is needed so that varstrcmp_abbrev() (an unsigned integer 3-way
+	 * This is needed so that ssup_datum_unsigned_cmp() (an unsigned integer 3-way
 	 * comparator) works correctly on all platforms.  If we didn't do this,
 	 * the comparator would have to call memcmp() with a pair of pointers to
 	 * the first byte of each abbreviated key, which is slower.
@@ -5376,6 +5385,9 @@ pg_column_compression(PG_FUNCTION_ARGS)
 		case TOAST_LZ4_COMPRESSION_ID:
 			result = "lz4";
 			break;
+		case TOAST_ZSTD_COMPRESSION_ID:
+			result = "zstd";
+			break;
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 	}
@@ -37,7 +37,10 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 
 
  /* #define CACHEDEBUG */	/* turns DEBUG elogs on */
@@ -63,11 +66,33 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC variables */
+int			catalog_cache_prune_min_age = 300;
+int			catalog_cache_memory_limit = 0;
+
+/* approximate memory used by all catalog cache entries, in bytes */
+Size		catcache_memory_used = 0;
+
+/* where CatCacheEnforceMemoryLimit's clock hand stopped last time */
+static CatCache *catcache_hand_cache = NULL;
+static int	catcache_hand_bucket = 0;
+
+/* memory accounted to a cache entry; negative entries' keys are ignored */
+#define CatCTupSize(ct) \
+	(sizeof(CatCTup) + ((ct)->negative ? 0 : MAXIMUM_ALIGNOF + (ct)->tuple.t_len))
+
+/* Time of the current statement, as far as cache entry ages are concerned */
+TimestampTz catcacheclock = 0;
+
+/* total number of searches in this backend, for planner instrumentation */
+uint64		catcache_searches = 0;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
 											   Datum v3, Datum v4);
 
+static inline bool CatCacheUseSharedTier(CatCache *cache);
 static pg_noinline HeapTuple SearchCatCacheMiss(CatCache *cache,
 												int nkeys,
 												uint32 hashValue,
@@ -88,6 +113,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static bool CatCacheCleanupOldEntries(CatCache *cp);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -482,6 +508,8 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
 
+	catcache_memory_used -= CatCTupSize(ct);
+
 	pfree(ct);
 
 	--cache->cc_ntup;
@@ -853,6 +881,167 @@ InitCatCache(int id,
 	return cp;
 }
 
+/*
+ * Remove entries that haven't been searched for catalog_cache_prune_min_age
+ * seconds.  Without this, a backend that touches many objects over its
+ * lifetime, say one that visits many tables or functions once each, keeps
+ * all their catalog entries forever.
+ *
+ * Returns true if enough entries were removed that the hash table doesn't
+ * need to be enlarged.
+ */
+static bool
+CatCacheCleanupOldEntries(CatCache *cp)
+{
+	int			nremoved = 0;
+	int			i;
+
+	if (catalog_cache_prune_min_age < 0)
+		return false;
+
+	for (i = 0; i < cp->cc_nbuckets; i++)
+	{
+		dlist_mutable_iter iter;
+
+		dlist_foreach_modify(iter, &cp->cc_bucket[i])
+		{
+			CatCTup    *ct = dlist_container(CatCTup, cache_elem, iter.cur);
+			long		age;
+			int			us;
+
+			/* entries in use, or in a list in use, must stay */
+			if (ct->refcount > 0 ||
+				(ct->c_list && ct->c_list->refcount > 0))
+				continue;
+
+			TimestampDifference(ct->lastaccess, catcacheclock, &age, &us);
+			if (age <= catalog_cache_prune_min_age)
+				continue;
+
+			/*
+			 * Removing a list member removes the list, and thus may remove
+			 * other dead members of the same bucket; restart the bucket then.
+			 */
+			if (ct->c_list)
+			{
+				CatCacheRemoveCTup(cp, ct);
+				nremoved++;
+				iter.cur = &cp->cc_bucket[i].head;
+				iter.next = iter.cur->next;
+				continue;
+			}
+
+			CatCacheRemoveCTup(cp, ct);
+			nremoved++;
+		}
+	}
+
+	if (nremoved > 0)
+		elog(DEBUG1, "pruned %d entries from catalog cache id %d for %s; %d tups, %d buckets",
+			 nremoved, cp->id, cp->cc_relname, cp->cc_ntup, cp->cc_nbuckets);
+
+	/* don't bother if we'd be back here after a few more insertions */
+	return cp->cc_ntup <= cp->cc_nbuckets * 3 / 2;
+}
+
+/*
+ * Evict unreferenced catalog cache entries until the memory they use is back
+ * below 90% of catalog_cache_memory_limit, then prune the relation cache
+ * likewise.  SetCatCacheClock calls this when the limit has been exceeded.
+ *
+ * The caches are swept like a clock: each call resumes where the previous
+ * one stopped, so that all entries take their turn.  On the first revolution
+ * entries that have been used since 'recent', normally the start of the
+ * previous statement, are skipped; only if that doesn't free enough memory
+ * are they evicted too.  Entries that are referenced must stay, so the limit
+ * can still be exceeded while a statement uses a great many catalog entries.
+ */
+void
+CatCacheEnforceMemoryLimit(TimestampTz recent)
+{
+	Size		target = (Size) catalog_cache_memory_limit * 1024 / 10 * 9;
+	Size		before = catcache_memory_used;
+	int			nremoved = 0;
+	int			pass;
+
+	if (CacheHdr == NULL || slist_is_empty(&CacheHdr->ch_caches))
+		return;
+
+	if (catcache_hand_cache == NULL)
+	{
+		catcache_hand_cache = slist_head_element(CatCache, cc_next,
+												 &CacheHdr->ch_caches);
+		catcache_hand_bucket = 0;
+	}
+
+	for (pass = 0; pass < 2 && catcache_memory_used > target; pass++)
+	{
+		CatCache   *start_cache = catcache_hand_cache;
+		int			start_bucket = catcache_hand_bucket;
+
+		do
+		{
+			CatCache   *cp = catcache_hand_cache;
+			dlist_mutable_iter iter;
+
+			dlist_foreach_modify(iter, &cp->cc_bucket[catcache_hand_bucket])
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem, iter.cur);
+
+				if (catcache_memory_used <= target)
+					break;
+
+				/* entries in use, or in a list in use, must stay */
+				if (ct->refcount > 0 ||
+					(ct->c_list && ct->c_list->refcount > 0))
+					continue;
+
+				/* spare recently used entries the first time around */
+				if (pass == 0 && ct->lastaccess >= recent)
+					continue;
+
+				/*
+				 * Removing a list member removes the list, and thus may
+				 * remove other dead members of the same bucket; restart the
+				 * bucket then.
+				 */
+				if (ct->c_list)
+				{
+					CatCacheRemoveCTup(cp, ct);
+					nremoved++;
+					iter.cur = &cp->cc_bucket[catcache_hand_bucket].head;
+					iter.next = iter.cur->next;
+					continue;
+				}
+
+				CatCacheRemoveCTup(cp, ct);
+				nremoved++;
+			}
+
+			if (catcache_memory_used <= target)
+				break;
+
+			/* advance the hand to the next bucket, or the next cache */
+			if (++catcache_hand_bucket >= cp->cc_nbuckets)
+			{
+				catcache_hand_bucket = 0;
+				if (slist_has_next(&CacheHdr->ch_caches, &cp->cc_next))
+					catcache_hand_cache = slist_container(CatCache, cc_next,
+														  cp->cc_next.next);
+				else
+					catcache_hand_cache = slist_head_element(CatCache, cc_next,
+															 &CacheHdr->ch_caches);
+			}
+		} while (catcache_hand_cache != start_cache ||
+				 catcache_hand_bucket != start_bucket);
+	}
+
+	elog(DEBUG1, "evicted %d catalog cache entries, reducing their memory from %zu to %zu bytes",
+		 nremoved, before, catcache_memory_used);
+
+	RelationCachePrune(recent);
+}
+
 /*
  * Enlarge a catcache, doubling the number of buckets.
  */
@@ -1222,6 +1411,7 @@ SearchCatCacheInternal(CatCache *cache,
 	if (unlikely(cache->cc_tupdesc == NULL))
 		CatalogCacheInitializeCache(cache);
 
+	catcache_searches++;
 #ifdef CATCACHE_STATS
 	cache->cc_searches++;
 #endif
@@ -1265,6 +1455,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		ct->lastaccess = catcacheclock;
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1301,9 +1492,29 @@ SearchCatCacheInternal(CatCache *cache,
 	return SearchCatCacheMiss(cache, nkeys, hashValue, hashIndex, v1, v2, v3, v4);
 }
 
+/*
+ * Can the shared catalog cache be used for a search in this cache?
+ *
+ * It can't while our own transaction may have changed the catalogs, since
+ * we could then see some tuples differently from everyone else, nor while
+ * we're looking at the catalogs through a historic snapshot.
+ */
+static inline bool
+CatCacheUseSharedTier(CatCache *cache)
+{
+	return SharedCatCacheEnabled() &&
+		!IsBootstrapProcessingMode() &&
+		(cache->cc_relisshared || OidIsValid(MyDatabaseId)) &&
+		!HistoricSnapshotActive() &&
+		!HavePendingInvalidations();
+}
+
 /*
  * Search the actual catalogs, rather than the cache.
  *
+ * If the shared catalog cache is enabled, it is consulted first, and a tuple
+ * that has to be read from the catalog is added to it.
+ *
  * This is kept separate from SearchCatCacheInternal() to keep the fast-path
  * as small as possible.  To avoid that effort being undone by a helpful
  * compiler, try to explicitly forbid inlining.
@@ -1324,6 +1535,9 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		use_shared = CatCacheUseSharedTier(cache);
+	Oid			shared_dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	uint64		shared_generation = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1331,6 +1545,50 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * See if another backend has loaded the tuple into the shared catalog
+	 * cache.  Only the hash value was matched there, so check the keys.
+	 */
+	if (use_shared &&
+		(ntp = SharedCatCacheLookup(shared_dbid, cache->id, cache->cc_reloid,
+									hashValue)) != NULL)
+	{
+		Datum		keys[CATCACHE_MAXKEYS];
+		int			i;
+
+		for (i = 0; i < nkeys; i++)
+		{
+			bool		isnull;
+
+			keys[i] = heap_getattr(ntp, cache->cc_keyno[i],
+								   cache->cc_tupdesc, &isnull);
+			Assert(!isnull);
+		}
+
+		if (CatalogCacheCompareTuple(cache, nkeys, keys, arguments))
+		{
+			ct = CatalogCacheCreateEntry(cache, ntp, arguments,
+										 hashValue, hashIndex,
+										 false);
+			heap_freetuple(ntp);
+
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+			CACHE_elog(DEBUG2, "SearchCatCache(%s): loaded from shared cache",
+					   cache->cc_relname);
+
+#ifdef CATCACHE_STATS
+			cache->cc_newloads++;
+#endif
+
+			return &ct->tuple;
+		}
+
+		heap_freetuple(ntp);
+	}
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1365,6 +1623,10 @@ SearchCatCacheMiss(CatCache *cache,
 								  nkeys,
 								  cur_skey);
 
+	/* the scan's snapshot is the current catalog snapshot */
+	if (use_shared)
+		shared_generation = SharedCatCacheSnapshotGeneration();
+
 	ct = NULL;
 
 	while (HeapTupleIsValid(ntp = systable_getnext(scandesc)))
@@ -1383,6 +1645,14 @@ SearchCatCacheMiss(CatCache *cache,
 
 	table_close(relation, AccessShareLock);
 
+	/*
+	 * Share the tuple with other backends.  The copy in the cache entry has
+	 * its toasted fields expanded already.
+	 */
+	if (ct != NULL && use_shared)
+		SharedCatCacheInsert(shared_dbid, cache->id, cache->cc_reloid,
+							 hashValue, &ct->tuple, shared_generation);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1533,6 +1803,7 @@ SearchCatCacheList(CatCache *cache,
 
 	Assert(nkeys > 0 && nkeys < cache->cc_nkeys);
 
+	catcache_searches++;
 #ifdef CATCACHE_STATS
 	cache->cc_lsearches++;
 #endif
@@ -1890,17 +2161,21 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->dead = false;
 	ct->negative = negative;
 	ct->hash_value = hashValue;
+	ct->lastaccess = catcacheclock;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	catcache_memory_used += CatCTupSize(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
-	 * arbitrarily, we enlarge when fill factor > 2.
+	 * arbitrarily, we enlarge when fill factor > 2.  But first try to make
+	 * room by evicting entries that haven't been used for a while.
 	 */
-	if (cache->cc_ntup > cache->cc_nbuckets * 2)
+	if (cache->cc_ntup > cache->cc_nbuckets * 2 &&
+		!CatCacheCleanupOldEntries(cache))
 		RehashCatCache(cache);
 
 	return ct;
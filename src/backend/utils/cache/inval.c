@@ -1190,6 +1190,19 @@ CommandEndInvalidationMessages(void)
 							   &transInvalInfo->CurrentCmdInvalidMsgs);
 }
 
+/*
+ * HavePendingInvalidations
+ *		Has the current transaction queued any invalidations so far?
+ *
+ * If so, it may have modified the system catalogs, and what it reads from
+ * them can differ from what other transactions see.
+ */
+bool
+HavePendingInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
 
 /*
  * CacheInvalidateHeapTuple
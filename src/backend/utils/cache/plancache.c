@@ -38,6 +38,11 @@
  * catalogs to be infrequent enough that more-detailed tracking is not worth
  * the effort.
  *
+ * If the shared plan cache is enabled (see sharedplancache.c), generic plans
+ * of saved plan sources are also offered to other sessions, and a session
+ * that has no generic plan of its own yet first looks for one made by
+ * another session for the same statement.
+ *
  * In addition to full-fledged query plans, we provide a facility for
  * detecting invalidations of simple scalar expressions.  This is fairly
  * bare-bones; it's the caller's responsibility to build a new expression
@@ -58,6 +63,8 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -67,10 +74,14 @@
 #include "storage/lmgr.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
+#include "utils/guc.h"
+#include "utils/guc_tables.h"
 #include "utils/inval.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -102,6 +113,16 @@ static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 static bool CheckCachedPlan(CachedPlanSource *plansource);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
+static CachedPlan *MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+								  MemoryContext plan_context);
+static void InstallGenericPlan(CachedPlanSource *plansource, CachedPlan *plan);
+static bool PlanSourceIsShareable(CachedPlanSource *plansource,
+								  QueryEnvironment *queryEnv);
+static void GetSharedPlanIdentity(CachedPlanSource *plansource,
+								  SharedPlanIdentity *id);
+static bool LoadSharedGenericPlan(CachedPlanSource *plansource);
+static void StoreSharedGenericPlan(CachedPlanSource *plansource,
+								   CachedPlan *plan, uint64 generation);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
@@ -220,6 +241,8 @@ CreateCachedPlan(RawStmt *raw_parse_tree,
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
 	plansource->num_custom_plans = 0;
+	plansource->shared_custom_cost = 0;
+	plansource->shared_custom_plans = 0;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -288,6 +311,8 @@ CreateOneShotCachedPlan(RawStmt *raw_parse_tree,
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
 	plansource->num_custom_plans = 0;
+	plansource->shared_custom_cost = 0;
+	plansource->shared_custom_plans = 0;
 
 	return plansource;
 }
@@ -882,10 +907,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	CachedPlan *plan;
 	List	   *plist;
 	bool		snapshot_set;
-	bool		is_transient;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
-	ListCell   *lc;
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -962,6 +985,29 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	else
 		plan_context = CurrentMemoryContext;
 
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return plan;
+}
+
+/*
+ * MakeCachedPlan: create the CachedPlan struct for a list of PlannedStmts.
+ *
+ * The struct is allocated in the current memory context, which must be
+ * plan_context.
+ */
+static CachedPlan *
+MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context)
+{
+	CachedPlan *plan;
+	bool		is_transient;
+	ListCell   *lc;
+
+	Assert(CurrentMemoryContext == plan_context);
+
 	/*
 	 * Create and fill the CachedPlan struct within the new context.
 	 */
@@ -1005,9 +1051,343 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
 
+	return plan;
+}
+
+/*
+ * InstallGenericPlan: make a new generic plan the plansource's current one.
+ */
+static void
+InstallGenericPlan(CachedPlanSource *plansource, CachedPlan *plan)
+{
+	/* Just make real sure plansource->gplan is clear */
+	ReleaseGenericPlan(plansource);
+	/* Link the new generic plan into the plansource */
+	plansource->gplan = plan;
+	plan->refcount++;
+	/* Immediately reparent into appropriate context */
+	if (plansource->is_saved)
+	{
+		/* saved plans all live under CacheMemoryContext */
+		MemoryContextSetParent(plan->context, CacheMemoryContext);
+		plan->is_saved = true;
+	}
+	else
+	{
+		/* otherwise, it should be a sibling of the plansource */
+		MemoryContextSetParent(plan->context,
+							   MemoryContextGetParent(plansource->context));
+	}
+	/* Update generic_cost whenever we make a new generic plan */
+	plansource->generic_cost = cached_plan_cost(plan, false);
+}
+
+/*
+ * PlanSourceIsShareable: can the generic plan be shared with other sessions?
+ *
+ * Only saved plan sources whose meaning is fully determined by their source
+ * text, parameter types and the session environment hashed by
+ * GetSharedPlanIdentity qualify.  Sessions with a temporary namespace, whose
+ * tables could shadow other ones, and transactions that may have changed
+ * the catalogs themselves keep to their own plans.
+ */
+static bool
+PlanSourceIsShareable(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+	ListCell   *lc;
+
+	if (!SharedPlanCacheEnabled() ||
+		!plansource->is_saved ||
+		plansource->is_oneshot ||
+		plansource->raw_parse_tree == NULL ||
+		plansource->parserSetup != NULL ||
+		queryEnv != NULL ||
+		IsTransactionStmtPlan(plansource) ||
+		plan_cache_mode == PLAN_CACHE_MODE_FORCE_CUSTOM_PLAN ||
+		HavePendingInvalidations())
+		return false;
+
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId))
+		return false;
+
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Settings that parse analysis or rewriting of a statement can depend on,
+ * besides the search path; see GetSharedPlanIdentity.  Planner settings are
+ * picked by their group instead, see shared_plan_setting_group.
+ */
+static const char *const shared_plan_settings[] = {
+	"DateStyle",
+	"IntervalStyle",
+	"TimeZone",
+	"lc_monetary",
+	"default_text_search_config",
+	"row_security",
+	"session_replication_role",
+	"standard_conforming_strings",
+	"transform_null_equals",
+};
+
+/*
+ * Do the settings of this group affect planning?
+ *
+ * Rather than listing the planner's settings, which would silently miss
+ * new ones, take every setting of the groups they live in, including
+ * those of extensions.  Settings in there that don't matter for planning
+ * just make sessions that differ in them keep separate plans.
+ */
+static bool
+shared_plan_setting_group(enum config_group group)
+{
+	switch (group)
+	{
+		case QUERY_TUNING_METHOD:
+		case QUERY_TUNING_COST:
+		case QUERY_TUNING_GEQO:
+		case QUERY_TUNING_OTHER:
+		case RESOURCES_MEM:
+		case RESOURCES_ASYNCHRONOUS:
+		case DEVELOPER_OPTIONS:
+		case CUSTOM_OPTIONS:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Fold the current value of a setting into a hash.
+ */
+static uint64
+hash_setting_value(uint64 h, struct config_generic *conf)
+{
+	const void *value = NULL;
+	Size		len = 0;
+
+	switch (conf->vartype)
+	{
+		case PGC_BOOL:
+			value = ((struct config_bool *) conf)->variable;
+			len = sizeof(bool);
+			break;
+		case PGC_INT:
+			value = ((struct config_int *) conf)->variable;
+			len = sizeof(int);
+			break;
+		case PGC_REAL:
+			value = ((struct config_real *) conf)->variable;
+			len = sizeof(double);
+			break;
+		case PGC_ENUM:
+			value = ((struct config_enum *) conf)->variable;
+			len = sizeof(int);
+			break;
+		case PGC_STRING:
+			value = *((struct config_string *) conf)->variable;
+			len = value ? strlen(value) : 0;
+			break;
+	}
+
+	h = hash_combine64(h,
+					   hash_bytes_extended((const unsigned char *) conf->name,
+										   strlen(conf->name), 0));
+	if (len > 0)
+		h = hash_combine64(h,
+						   hash_bytes_extended((const unsigned char *) value,
+											   len, 0));
+
+	return h;
+}
+
+/*
+ * GetSharedPlanIdentity: compute what the shared plan cache knows a plan by.
+ */
+static void
+GetSharedPlanIdentity(CachedPlanSource *plansource, SharedPlanIdentity *id)
+{
+	List	   *search_path;
+	ListCell   *lc;
+	struct config_generic **guc_vars;
+	int			num_guc_vars;
+	uint64		h = 0;
+	int			i;
+
+	id->dbid = MyDatabaseId;
+	id->roleid = GetUserId();
+	id->query_string = plansource->query_string;
+	id->stmt_location = plansource->raw_parse_tree->stmt_location;
+	id->stmt_len = plansource->raw_parse_tree->stmt_len;
+	id->cursor_options = plansource->cursor_options;
+	id->num_params = plansource->num_params;
+	id->param_types = plansource->param_types;
+
+	search_path = fetch_search_path(true);
+	foreach(lc, search_path)
+		h = hash_combine64(h, hash_bytes_uint32_extended(lfirst_oid(lc), 0));
+	list_free(search_path);
+
+	for (i = 0; i < lengthof(shared_plan_settings); i++)
+	{
+		const char *value = GetConfigOption(shared_plan_settings[i],
+											false, false);
+
+		h = hash_combine64(h,
+						   hash_bytes_extended((const unsigned char *) value,
+											   strlen(value), 0));
+	}
+
+	/* and all the settings the planner may look at */
+	guc_vars = get_guc_variables();
+	num_guc_vars = GetNumConfigOptions();
+	for (i = 0; i < num_guc_vars; i++)
+	{
+		if (shared_plan_setting_group(guc_vars[i]->group))
+			h = hash_setting_value(h, guc_vars[i]);
+	}
+
+	id->env_hash = h;
+}
+
+/*
+ * LoadSharedGenericPlan: adopt another session's generic plan, if any.
+ *
+ * On success, the plan becomes plansource's generic plan, and the custom
+ * plan statistics of the session that made it are taken over too, so that
+ * choose_custom_plan doesn't have to gather them again.
+ */
+static bool
+LoadSharedGenericPlan(CachedPlanSource *plansource)
+{
+	SharedPlanIdentity id;
+	char	   *plan_string;
+	double		shared_custom_cost;
+	int64		shared_custom_plans;
+	MemoryContext plan_context;
+	MemoryContext oldcxt;
+	CachedPlan *plan;
+	List	   *plist;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	GetSharedPlanIdentity(plansource, &id);
+	plan_string = SharedPlanCacheLookup(&id, &shared_custom_cost,
+										&shared_custom_plans);
+	if (plan_string == NULL)
+		return false;
+
+	plan_context = AllocSetContextCreate(CurrentMemoryContext,
+										 "CachedPlan",
+										 ALLOCSET_START_SMALL_SIZES);
+	MemoryContextCopyAndSetIdentifier(plan_context, plansource->query_string);
+	oldcxt = MemoryContextSwitchTo(plan_context);
+
+	plist = (List *) stringToNode(plan_string);
+
+	/*
+	 * The plan was made for the same statement in the same environment, so
+	 * it must match our query tree; but cross-check the basics anyway.
+	 */
+	if (list_length(plist) != list_length(plansource->query_list))
+	{
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(plan_context);
+		pfree(plan_string);
+		return false;
+	}
+	forboth(lc1, plist, lc2, plansource->query_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Query	   *query = lfirst_node(Query, lc2);
+
+		if (plannedstmt->commandType != query->commandType ||
+			plannedstmt->canSetTag != query->canSetTag)
+		{
+			MemoryContextSwitchTo(oldcxt);
+			MemoryContextDelete(plan_context);
+			pfree(plan_string);
+			return false;
+		}
+	}
+
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
 	MemoryContextSwitchTo(oldcxt);
+	pfree(plan_string);
 
-	return plan;
+	InstallGenericPlan(plansource, plan);
+	plansource->shared_custom_cost = shared_custom_cost;
+	plansource->shared_custom_plans = shared_custom_plans;
+
+	elog(DEBUG2, "using generic plan from the shared plan cache");
+
+	return true;
+}
+
+/*
+ * StoreSharedGenericPlan: offer a new generic plan to other sessions.
+ *
+ * "generation" is the shared plan cache generation from before planning.
+ */
+static void
+StoreSharedGenericPlan(CachedPlanSource *plansource, CachedPlan *plan,
+					   uint64 generation)
+{
+	SharedPlanIdentity id;
+	List	   *relationOids;
+	List	   *invalItems;
+	char	   *plan_string;
+	ListCell   *lc;
+
+	/* Transient plans are only good for the transaction that made them */
+	if (TransactionIdIsValid(plan->saved_xmin))
+		return;
+
+	relationOids = list_copy(plansource->relationOids);
+	invalItems = list_copy(plansource->invalItems);
+	foreach(lc, plan->stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY)
+			return;
+		relationOids = list_concat_unique_oid(relationOids,
+											  plannedstmt->relationOids);
+		invalItems = list_concat(invalItems, plannedstmt->invalItems);
+	}
+
+	/* Temporary tables could end up in a plan without being in our path */
+	foreach(lc, relationOids)
+	{
+		if (get_rel_persistence(lfirst_oid(lc)) == RELPERSISTENCE_TEMP)
+			return;
+	}
+
+	GetSharedPlanIdentity(plansource, &id);
+	plan_string = nodeToString(plan->stmt_list);
+
+	SharedPlanCacheStore(&id, plan_string, relationOids, invalItems,
+						 plansource->total_custom_cost +
+						 plansource->shared_custom_cost,
+						 plansource->num_custom_plans +
+						 plansource->shared_custom_plans,
+						 generation);
+
+	pfree(plan_string);
+	list_free(relationOids);
+	list_free(invalItems);
 }
 
 /*
@@ -1019,6 +1399,7 @@ static bool
 choose_custom_plan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	double		avg_custom_cost;
+	int64		num_custom_plans;
 
 	/* One-shot plans will always be considered custom */
 	if (plansource->is_oneshot)
@@ -1043,11 +1424,17 @@ choose_custom_plan(CachedPlanSource *plansource, ParamListInfo boundParams)
 	if (plansource->cursor_options & CURSOR_OPT_CUSTOM_PLAN)
 		return true;
 
-	/* Generate custom plans until we have done at least 5 (arbitrary) */
-	if (plansource->num_custom_plans < 5)
+	/*
+	 * Generate custom plans until we have done at least 5 (arbitrary).  The
+	 * ones made by the session we got a shared generic plan from count too.
+	 */
+	num_custom_plans = plansource->num_custom_plans +
+		plansource->shared_custom_plans;
+	if (num_custom_plans < 5)
 		return true;
 
-	avg_custom_cost = plansource->total_custom_cost / plansource->num_custom_plans;
+	avg_custom_cost = (plansource->total_custom_cost +
+					   plansource->shared_custom_cost) / num_custom_plans;
 
 	/*
 	 * Prefer generic plan if it's less expensive than the average custom
@@ -1081,12 +1468,33 @@ cached_plan_cost(CachedPlan *plan, bool include_planner)
 	foreach(lc, plan->stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+		int			nlocked = 0;
+		ListCell   *lc2;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
 			continue;			/* Ignore utility statements */
 
 		result += plannedstmt->planTree->total_cost;
 
+		/*
+		 * Every relation in the rangetable is locked by AcquireExecutorLocks
+		 * before each execution, whether or not run-time pruning later
+		 * discards it.  For a generic plan over a large partition tree that
+		 * means locking every partition on every execution, while a custom
+		 * plan only carries the partitions that survived plan-time pruning.
+		 * Charge both kinds of plan for that work so that the choice between
+		 * them can see it; when the rangetables are of similar size this
+		 * cancels out.
+		 */
+		foreach(lc2, plannedstmt->rtable)
+		{
+			RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc2);
+
+			if (rte->rtekind == RTE_RELATION && rte->rellockmode != NoLock)
+				nlocked++;
+		}
+		result += 100.0 * cpu_operator_cost * nlocked;
+
 		if (include_planner)
 		{
 			/*
@@ -1155,6 +1563,14 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource, queryEnv);
 
+	/*
+	 * Until we have made a generic plan of our own, see if another session
+	 * has one for the same statement.
+	 */
+	if (plansource->gplan == NULL && plansource->generic_cost < 0 &&
+		PlanSourceIsShareable(plansource, queryEnv))
+		(void) LoadSharedGenericPlan(plansource);
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
@@ -1168,28 +1584,27 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 		}
 		else
 		{
-			/* Build a new generic plan */
-			plan = BuildCachedPlan(plansource, qlist, NULL, queryEnv);
-			/* Just make real sure plansource->gplan is clear */
-			ReleaseGenericPlan(plansource);
-			/* Link the new generic plan into the plansource */
-			plansource->gplan = plan;
-			plan->refcount++;
-			/* Immediately reparent into appropriate context */
-			if (plansource->is_saved)
-			{
-				/* saved plans all live under CacheMemoryContext */
-				MemoryContextSetParent(plan->context, CacheMemoryContext);
-				plan->is_saved = true;
-			}
-			else
+			bool		share = PlanSourceIsShareable(plansource, queryEnv);
+			uint64		shared_generation = 0;
+
+			/*
+			 * If the plan is to be shared, make sure it's made from fresh
+			 * catalog contents: note the shared plan cache's generation, then
+			 * catch up with invalidations.  BuildCachedPlan revalidates the
+			 * querytree if that invalidated it.
+			 */
+			if (share)
 			{
-				/* otherwise, it should be a sibling of the plansource */
-				MemoryContextSetParent(plan->context,
-									   MemoryContextGetParent(plansource->context));
+				shared_generation = SharedPlanCacheGeneration();
+				AcceptInvalidationMessages();
 			}
-			/* Update generic_cost whenever we make a new generic plan */
-			plansource->generic_cost = cached_plan_cost(plan, false);
+
+			/* Build a new generic plan */
+			plan = BuildCachedPlan(plansource, qlist, NULL, queryEnv);
+			InstallGenericPlan(plansource, plan);
+
+			if (share)
+				StoreSharedGenericPlan(plansource, plan, shared_generation);
 
 			/*
 			 * If, based on the now-known value of generic_cost, we'd not have
@@ -1580,6 +1995,8 @@ CopyCachedPlan(CachedPlanSource *plansource)
 	newsource->total_custom_cost = plansource->total_custom_cost;
 	newsource->num_generic_plans = plansource->num_generic_plans;
 	newsource->num_custom_plans = plansource->num_custom_plans;
+	newsource->shared_custom_cost = plansource->shared_custom_cost;
+	newsource->shared_custom_plans = plansource->shared_custom_plans;
 
 	MemoryContextSwitchTo(oldcxt);
 
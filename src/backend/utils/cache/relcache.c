@@ -77,6 +77,7 @@
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -2120,6 +2121,7 @@ RelationIncrementReferenceCount(Relation rel)
 {
 	ResourceOwnerEnlargeRelationRefs(CurrentResourceOwner);
 	rel->rd_refcnt += 1;
+	rel->rd_lastaccess = catcacheclock;
 	if (!IsBootstrapProcessingMode())
 		ResourceOwnerRememberRelationRef(CurrentResourceOwner, rel);
 }
@@ -2683,8 +2685,9 @@ RelationClearRelation(Relation relation, bool rebuild)
 
 		/* rd_smgr must not be swapped, due to back-links from smgr level */
 		SWAPFIELD(SMgrRelation, rd_smgr);
-		/* rd_refcnt must be preserved */
+		/* rd_refcnt must be preserved, and so must its companion */
 		SWAPFIELD(int, rd_refcnt);
+		SWAPFIELD(TimestampTz, rd_lastaccess);
 		/* isnailed shouldn't change */
 		Assert(newrel->rd_isnailed == relation->rd_isnailed);
 		/* creation sub-XIDs must be preserved */
@@ -3011,6 +3014,51 @@ RelationCacheInvalidate(bool debug_discard)
 			in_progress_list[i].invalidated = true;
 }
 
+/*
+ * RelationCachePrune
+ *	 Remove unreferenced entries that haven't been opened since 'recent'.
+ *
+ *	 This is used together with the eviction of catalog cache entries when
+ *	 catalog_cache_memory_limit is exceeded, so that a session that has
+ *	 touched many relations doesn't keep all their entries forever.  It must
+ *	 only be called when no scan of the relation cache is in progress.  An
+ *	 entry is only removed if an invalidation could have removed it too.
+ */
+void
+RelationCachePrune(TimestampTz recent)
+{
+	HASH_SEQ_STATUS status;
+	RelIdCacheEnt *idhentry;
+	int			nremoved = 0;
+
+	if (RelationIdCache == NULL)
+		return;
+
+	hash_seq_init(&status, RelationIdCache);
+
+	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Relation	relation = idhentry->reldesc;
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_lastaccess >= recent)
+			continue;
+
+		/* entries for uncommitted changes must stay */
+		if (relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_firstRelfilenodeSubid != InvalidSubTransactionId ||
+			relation->rd_droppedSubid != InvalidSubTransactionId)
+			continue;
+
+		RelationClearRelation(relation, false);
+		nremoved++;
+	}
+
+	if (nremoved > 0)
+		elog(DEBUG1, "pruned %d relation cache entries", nremoved);
+}
+
 /*
  * RelationCloseSmgrByOid - close a relcache entry's smgr link
  *
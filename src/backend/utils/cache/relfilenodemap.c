@@ -31,6 +31,13 @@
 /* Hash table for information about each relfilenode <-> oid pair */
 static HTAB *RelfilenodeMapHash = NULL;
 
+/*
+ * Reverse index of RelfilenodeMapHash, listing the keys that map to each
+ * relation, so that invalidating one relation doesn't need to walk the whole
+ * map.  Negative entries are listed under InvalidOid.
+ */
+static HTAB *RelfilenodeMapRelidHash = NULL;
+
 /* built first time through in InitializeRelfilenodeMap */
 static ScanKeyData relfilenode_skey[2];
 
@@ -46,6 +53,39 @@ typedef struct
 	Oid			relid;			/* pg_class.oid */
 } RelfilenodeMapEntry;
 
+typedef struct
+{
+	Oid			relid;			/* lookup key - must be first */
+	List	   *keys;			/* palloc'd RelfilenodeMapKeys */
+} RelfilenodeMapRelidEntry;
+
+/*
+ * Remove all the mapping entries that point to relid.
+ */
+static void
+RelfilenodeMapRemoveRelid(Oid relid)
+{
+	RelfilenodeMapRelidEntry *relentry;
+	ListCell   *lc;
+
+	relentry = hash_search(RelfilenodeMapRelidHash, (void *) &relid,
+						   HASH_FIND, NULL);
+	if (relentry == NULL)
+		return;
+
+	/*
+	 * A key can be missing from the map if we failed to enter it after
+	 * listing it here.
+	 */
+	foreach(lc, relentry->keys)
+		hash_search(RelfilenodeMapHash, lfirst(lc), HASH_REMOVE, NULL);
+	list_free_deep(relentry->keys);
+
+	if (hash_search(RelfilenodeMapRelidHash, (void *) &relid, HASH_REMOVE,
+					NULL) == NULL)
+		elog(ERROR, "hash table corrupted");
+}
+
 /*
  * RelfilenodeMapInvalidateCallback
  *		Flush mapping entries when pg_class is updated in a relevant fashion.
@@ -54,29 +94,30 @@ static void
 RelfilenodeMapInvalidateCallback(Datum arg, Oid relid)
 {
 	HASH_SEQ_STATUS status;
-	RelfilenodeMapEntry *entry;
+	RelfilenodeMapRelidEntry *relentry;
 
 	/* callback only gets registered after creating the hash */
 	Assert(RelfilenodeMapHash != NULL);
 
-	hash_seq_init(&status, RelfilenodeMapHash);
-	while ((entry = (RelfilenodeMapEntry *) hash_seq_search(&status)) != NULL)
+	/*
+	 * If relid is InvalidOid, signaling a complete reset, we must remove all
+	 * entries, otherwise just remove the specific relation's entries.  Always
+	 * remove negative cache entries.
+	 *
+	 * While logical decoding replays a transaction's invalidations, this is
+	 * called for every relation the transaction touched, so avoid walking
+	 * the whole map unless it's really being reset.
+	 */
+	if (relid == InvalidOid)
 	{
-		/*
-		 * If relid is InvalidOid, signaling a complete reset, we must remove
-		 * all entries, otherwise just remove the specific relation's entry.
-		 * Always remove negative cache entries.
-		 */
-		if (relid == InvalidOid ||	/* complete reset */
-			entry->relid == InvalidOid ||	/* negative cache entry */
-			entry->relid == relid)	/* individual flushed relation */
-		{
-			if (hash_search(RelfilenodeMapHash,
-							(void *) &entry->key,
-							HASH_REMOVE,
-							NULL) == NULL)
-				elog(ERROR, "hash table corrupted");
-		}
+		hash_seq_init(&status, RelfilenodeMapRelidHash);
+		while ((relentry = (RelfilenodeMapRelidEntry *) hash_seq_search(&status)) != NULL)
+			RelfilenodeMapRemoveRelid(relentry->relid);
+	}
+	else
+	{
+		RelfilenodeMapRemoveRelid(relid);
+		RelfilenodeMapRemoveRelid(InvalidOid);
 	}
 }
 
@@ -123,6 +164,14 @@ InitializeRelfilenodeMap(void)
 		hash_create("RelfilenodeMap cache", 64, &ctl,
 					HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(RelfilenodeMapRelidEntry);
+	ctl.hcxt = CacheMemoryContext;
+
+	RelfilenodeMapRelidHash =
+		hash_create("RelfilenodeMap reverse index", 64, &ctl,
+					HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
 	/* Watch for invalidation events. */
 	CacheRegisterRelcacheCallback(RelfilenodeMapInvalidateCallback,
 								  (Datum) 0);
@@ -139,6 +188,8 @@ RelidByRelfilenode(Oid reltablespace, Oid relfilenode)
 {
 	RelfilenodeMapKey key;
 	RelfilenodeMapEntry *entry;
+	RelfilenodeMapRelidEntry *relentry;
+	MemoryContext oldcxt;
 	bool		found;
 	SysScanDesc scandesc;
 	Relation	relation;
@@ -234,7 +285,20 @@ RelidByRelfilenode(Oid reltablespace, Oid relfilenode)
 	 * Only enter entry into cache now, our opening of pg_class could have
 	 * caused cache invalidations to be executed which would have deleted a
 	 * new entry if we had entered it above.
+	 *
+	 * List the entry in the reverse index first, so that an out-of-memory
+	 * failure can't leave a map entry that invalidations won't find.
 	 */
+	relentry = hash_search(RelfilenodeMapRelidHash, (void *) &relid,
+						   HASH_ENTER, &found);
+	if (!found)
+		relentry->keys = NIL;
+	oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+	relentry->keys = lappend(relentry->keys,
+							 memcpy(palloc(sizeof(RelfilenodeMapKey)), &key,
+									sizeof(RelfilenodeMapKey)));
+	MemoryContextSwitchTo(oldcxt);
+
 	entry = hash_search(RelfilenodeMapHash, (void *) &key, HASH_ENTER, &found);
 	if (found)
 		elog(ERROR, "corrupted hashtable");
@@ -0,0 +1,560 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Shared-memory tier of the system catalog cache.
+ *
+ * Every backend keeps its own catalog cache (see catcache.c), so a freshly
+ * started backend has to read each catalog tuple it needs from the catalogs
+ * again, even if hundreds of other backends have just done the same.  When
+ * shared_catalog_cache_size is set, catcache.c additionally keeps copies of
+ * the tuples it loads in a hash table in shared memory, and consults that
+ * table before scanning a catalog on a local cache miss.
+ *
+ * The table is a dshash in a DSA area carved out of the main shared memory
+ * segment, with its size limited to what was reserved there, so it never
+ * creates DSM segments.  Entries are keyed by database (InvalidOid for
+ * shared catalogs), cache ID and hash value, exactly like the catcache
+ * invalidation messages, and hold a single positive tuple each.  Negative
+ * entries and list searches are left to the local caches.  When the area
+ * is full, the whole table is emptied and refilled as backends miss again;
+ * that is crude but keeps the memory accounting trivial.
+ *
+ * Invalidation piggybacks on the shared invalidation machinery: every
+ * message that passes through SendSharedInvalidMessages() also removes the
+ * matching shared entries before it is queued, which happens after the
+ * transaction that made the change has become visible.  That alone is not
+ * enough, because a backend may have read the old version of a tuple with
+ * an older catalog snapshot and try to add it just after its entry was
+ * removed.  To close that race, each batch of invalidations advances a
+ * global generation counter before removing anything; every backend
+ * remembers the counter as of when it took its catalog snapshot, and an
+ * insertion is refused if the counter has moved since.  Tuples read by a
+ * transaction that has catalog changes of its own pending, or under a
+ * historic snapshot, are never added nor looked up.
+ *
+ * Conversely, a backend whose catalog snapshot is older than the one an
+ * entry was read with must not see a newer version of a tuple, nor one
+ * that has been deleted meanwhile.  Lookups therefore check the xmin and
+ * xmax of the shared copy against the backend's own catalog snapshot, and
+ * ignore the entry unless the tuple is visible in that snapshot.
+ *
+ * Entries of a database are removed by DROP DATABASE, so that a database
+ * created later with the same OID doesn't inherit them.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+/* the area is never made smaller than this */
+#define SHARED_CATCACHE_MIN_SIZE	(1024 * 1024)
+
+/*
+ * Only this fraction of the area is handed out for entries, leaving the
+ * rest for the hash table's own bookkeeping, which dshash allocates without
+ * a way to back off when the area is full.
+ */
+#define SHARED_CATCACHE_BUDGET(size)	((size) / 2)
+
+/* rough per-entry overhead of dshash and DSA, used for accounting */
+#define SHARED_CATCACHE_ENTRY_OVERHEAD	64
+
+typedef struct SharedCatCacheKey
+{
+	Oid			dbid;			/* database, or InvalidOid if shared */
+	int			cacheid;		/* syscache identifier */
+	uint32		hashvalue;		/* catcache hash value of the keys */
+} SharedCatCacheKey;
+
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key, must be first */
+	Oid			reloid;			/* catalog the tuple belongs to */
+	uint32		t_len;			/* length of the tuple data */
+	ItemPointerData t_self;		/* TID of the tuple */
+	dsa_pointer tuple;			/* tuple header and data */
+} SharedCatCacheEntry;
+
+typedef struct SharedCatCacheControl
+{
+	Size		area_size;		/* size of the DSA area */
+	dshash_table_handle hash;	/* handle of the entry table */
+	pg_atomic_uint64 generation;	/* advanced by each invalidation batch */
+	pg_atomic_uint64 bytes_used;	/* approximate memory used by entries */
+	pg_atomic_flag resetting;	/* is someone emptying the table? */
+	char	   *raw_dsa_area;	/* the DSA area, follows this struct */
+} SharedCatCacheControl;
+
+static const dshash_parameters shared_catcache_params = {
+	sizeof(SharedCatCacheKey),
+	sizeof(SharedCatCacheEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_CATCACHE_HASH
+};
+
+/* GUC variable */
+int			shared_catalog_cache_size = 0;
+
+static SharedCatCacheControl *SharedCatCache = NULL;
+
+/* per-process attachment, established lazily */
+static dsa_area *sharedCatCacheDSA = NULL;
+static dshash_table *sharedCatCacheHash = NULL;
+
+/* generation as of when the current catalog snapshot was taken */
+static uint64 catalogSnapshotGeneration = 0;
+
+static Size
+shared_catcache_area_size(void)
+{
+	return Max((Size) shared_catalog_cache_size * 1024,
+			   SHARED_CATCACHE_MIN_SIZE);
+}
+
+/*
+ * SharedCatCacheShmemSize
+ *		Compute space needed for the shared catalog cache.
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	if (shared_catalog_cache_size <= 0)
+		return 0;
+
+	return add_size(MAXALIGN(sizeof(SharedCatCacheControl)),
+					shared_catcache_area_size());
+}
+
+/*
+ * SharedCatCacheShmemInit
+ *		Allocate and initialize the shared catalog cache, if enabled.
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_catalog_cache_size <= 0)
+		return;
+
+	SharedCatCache = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catalog Cache", SharedCatCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *hash;
+
+		Assert(!found);
+
+		SharedCatCache->area_size = shared_catcache_area_size();
+		SharedCatCache->raw_dsa_area = (char *) SharedCatCache +
+			MAXALIGN(sizeof(SharedCatCacheControl));
+		pg_atomic_init_u64(&SharedCatCache->generation, 1);
+		pg_atomic_init_u64(&SharedCatCache->bytes_used, 0);
+		pg_atomic_init_flag(&SharedCatCache->resetting);
+
+		/*
+		 * Keep the area within the space reserved for it in the main shared
+		 * memory segment, and pin it so that it lives as long as that does.
+		 */
+		dsa = dsa_create_in_place(SharedCatCache->raw_dsa_area,
+								  SharedCatCache->area_size,
+								  LWTRANCHE_SHARED_CATCACHE_DSA, NULL);
+		dsa_set_size_limit(dsa, SharedCatCache->area_size);
+		dsa_pin(dsa);
+
+		hash = dshash_create(dsa, &shared_catcache_params, NULL);
+		SharedCatCache->hash = dshash_get_hash_table_handle(hash);
+
+		dshash_detach(hash);
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the DSA area and the hash table, if this process hasn't yet.
+ */
+static void
+shared_catcache_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (sharedCatCacheHash != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	sharedCatCacheDSA = dsa_attach_in_place(SharedCatCache->raw_dsa_area,
+											NULL);
+	dsa_pin_mapping(sharedCatCacheDSA);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(SharedCatCache->raw_dsa_area));
+
+	sharedCatCacheHash = dshash_attach(sharedCatCacheDSA,
+									   &shared_catcache_params,
+									   SharedCatCache->hash, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Release the memory of an entry that is about to be deleted.
+ */
+static void
+shared_catcache_free_entry(SharedCatCacheEntry *entry)
+{
+	if (DsaPointerIsValid(entry->tuple))
+	{
+		dsa_free(sharedCatCacheDSA, entry->tuple);
+		pg_atomic_fetch_sub_u64(&SharedCatCache->bytes_used,
+								entry->t_len + SHARED_CATCACHE_ENTRY_OVERHEAD);
+		entry->tuple = InvalidDsaPointer;
+	}
+}
+
+/*
+ * Remove all entries of the given catalog in the given database, all
+ * entries of the database if reloid is InvalidOid and alldbs is false, or
+ * all entries if reloid is InvalidOid and alldbs is true.  Returns the
+ * number of entries removed.
+ */
+static int
+shared_catcache_remove_all(Oid dbid, Oid reloid, bool alldbs)
+{
+	dshash_seq_status status;
+	SharedCatCacheEntry *entry;
+	int			nremoved = 0;
+
+	dshash_seq_init(&status, sharedCatCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (!alldbs && entry->key.dbid != dbid)
+			continue;
+		if (OidIsValid(reloid) && entry->reloid != reloid)
+			continue;
+
+		shared_catcache_free_entry(entry);
+		dshash_delete_current(&status);
+		nremoved++;
+	}
+	dshash_seq_term(&status);
+
+	return nremoved;
+}
+
+/*
+ * SharedCatCacheEnabled
+ *		Is the shared tier available in this process?
+ */
+bool
+SharedCatCacheEnabled(void)
+{
+	return SharedCatCache != NULL;
+}
+
+/*
+ * SharedCatCacheNoteCatalogSnapshot
+ *		Remember the invalidation generation, just before a new catalog
+ *		snapshot is taken.
+ */
+void
+SharedCatCacheNoteCatalogSnapshot(void)
+{
+	if (SharedCatCache == NULL)
+		return;
+
+	catalogSnapshotGeneration = pg_atomic_read_u64(&SharedCatCache->generation);
+}
+
+/*
+ * SharedCatCacheSnapshotGeneration
+ *		Return the generation noted for the current catalog snapshot.
+ *
+ * Callers must fetch this right after setting up the catalog scan whose
+ * result they intend to insert, before anything can replace the snapshot.
+ */
+uint64
+SharedCatCacheSnapshotGeneration(void)
+{
+	return catalogSnapshotGeneration;
+}
+
+/*
+ * Is a tuple from the shared tier visible in the given catalog snapshot?
+ *
+ * The backend that added the tuple saw it as live, so xmin committed and
+ * xmax, if set, did not commit before that backend's snapshot.  All that's
+ * left to check is whether our snapshot sees the same: that xmin isn't
+ * still running for us, and that no deletion or update has committed as
+ * far as we're concerned.
+ */
+static bool
+shared_catcache_tuple_visible(HeapTupleHeader tuple, Snapshot snapshot)
+{
+	TransactionId xmax;
+
+	if (!HeapTupleHeaderXminFrozen(tuple) &&
+		XidInMVCCSnapshot(HeapTupleHeaderGetRawXmin(tuple), snapshot))
+		return false;
+
+	if (tuple->t_infomask & HEAP_XMAX_INVALID ||
+		HEAP_XMAX_IS_LOCKED_ONLY(tuple->t_infomask))
+		return true;
+
+	xmax = HeapTupleHeaderGetUpdateXid(tuple);
+	if (!TransactionIdIsValid(xmax) ||
+		XidInMVCCSnapshot(xmax, snapshot) ||
+		!TransactionIdDidCommit(xmax))
+		return true;
+
+	return false;
+}
+
+/*
+ * SharedCatCacheLookup
+ *		Look for a tuple of catalog reloid in the shared tier.
+ *
+ * Returns a palloc'd copy of the tuple, or NULL if there is none or it is
+ * not visible in our catalog snapshot.  The caller must check that its keys
+ * really match, since only the hash value is compared here.
+ */
+HeapTuple
+SharedCatCacheLookup(Oid dbid, int cacheid, Oid reloid, uint32 hashValue)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	HeapTuple	tuple = NULL;
+	Snapshot	snapshot;
+
+	Assert(SharedCatCache != NULL);
+
+	/* the snapshot a catalog scan would use instead */
+	snapshot = GetCatalogSnapshot(reloid);
+
+	shared_catcache_attach();
+
+	memset(&key, 0, sizeof(key));
+	key.dbid = dbid;
+	key.cacheid = cacheid;
+	key.hashvalue = hashValue;
+
+	entry = dshash_find(sharedCatCacheHash, &key, false);
+	if (entry == NULL)
+		return NULL;
+
+	if (DsaPointerIsValid(entry->tuple))
+	{
+		tuple = (HeapTuple) palloc(HEAPTUPLESIZE + entry->t_len);
+		tuple->t_len = entry->t_len;
+		tuple->t_self = entry->t_self;
+		tuple->t_tableOid = entry->reloid;
+		tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+		memcpy(tuple->t_data,
+			   dsa_get_address(sharedCatCacheDSA, entry->tuple),
+			   entry->t_len);
+	}
+
+	dshash_release_lock(sharedCatCacheHash, entry);
+
+	if (tuple != NULL &&
+		!shared_catcache_tuple_visible(tuple->t_data, snapshot))
+	{
+		heap_freetuple(tuple);
+		tuple = NULL;
+	}
+
+	return tuple;
+}
+
+/*
+ * SharedCatCacheInsert
+ *		Add a tuple read from a catalog to the shared tier.
+ *
+ * "generation" is what SharedCatCacheSnapshotGeneration() returned for the
+ * snapshot the tuple was read with; if any invalidations have been sent
+ * since, the tuple may already be outdated and is silently not added.  The
+ * tuple must not contain any out-of-line toasted fields.
+ */
+void
+SharedCatCacheInsert(Oid dbid, int cacheid, Oid reloid, uint32 hashValue,
+					 HeapTuple tuple, uint64 generation)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	Size		cost = tuple->t_len + SHARED_CATCACHE_ENTRY_OVERHEAD;
+	Size		budget;
+	dsa_pointer dp;
+	bool		found;
+
+	Assert(SharedCatCache != NULL);
+	Assert(!HeapTupleHasExternal(tuple));
+
+	if (pg_atomic_read_u64(&SharedCatCache->generation) != generation)
+		return;
+
+	shared_catcache_attach();
+
+	/* Make room by starting over if the area is full */
+	budget = SHARED_CATCACHE_BUDGET(SharedCatCache->area_size);
+	if (pg_atomic_read_u64(&SharedCatCache->bytes_used) + cost > budget)
+	{
+		if (!pg_atomic_test_set_flag(&SharedCatCache->resetting))
+			return;				/* someone else is already at it */
+
+		PG_TRY();
+		{
+			shared_catcache_remove_all(InvalidOid, InvalidOid, true);
+		}
+		PG_FINALLY();
+		{
+			pg_atomic_clear_flag(&SharedCatCache->resetting);
+		}
+		PG_END_TRY();
+
+		elog(DEBUG1, "shared catalog cache was full and has been emptied");
+
+		if (pg_atomic_read_u64(&SharedCatCache->bytes_used) + cost > budget)
+			return;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.dbid = dbid;
+	key.cacheid = cacheid;
+	key.hashvalue = hashValue;
+
+	entry = dshash_find_or_insert(sharedCatCacheHash, &key, &found);
+
+	/*
+	 * Check the generation again while holding the partition lock.  An
+	 * invalidation that advanced it after this point will find and remove
+	 * our entry, since it takes the same lock afterwards.
+	 */
+	if (pg_atomic_read_u64(&SharedCatCache->generation) != generation)
+	{
+		if (found)
+			dshash_release_lock(sharedCatCacheHash, entry);
+		else
+			dshash_delete_entry(sharedCatCacheHash, entry);
+		return;
+	}
+
+	if (found)
+		shared_catcache_free_entry(entry);
+
+	dp = dsa_allocate_extended(sharedCatCacheDSA, tuple->t_len,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		dshash_delete_entry(sharedCatCacheHash, entry);
+		return;
+	}
+
+	memcpy(dsa_get_address(sharedCatCacheDSA, dp), tuple->t_data,
+		   tuple->t_len);
+	entry->reloid = reloid;
+	entry->t_len = tuple->t_len;
+	entry->t_self = tuple->t_self;
+	entry->tuple = dp;
+	pg_atomic_fetch_add_u64(&SharedCatCache->bytes_used, cost);
+
+	dshash_release_lock(sharedCatCacheHash, entry);
+}
+
+/*
+ * SharedCatCacheInvalidateMessages
+ *		Remove the shared entries affected by a batch of invalidation
+ *		messages that is about to be sent.
+ *
+ * This must be called after the changes the messages describe have become
+ * visible to other transactions.
+ */
+void
+SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs, int n)
+{
+	bool		advanced = false;
+	int			i;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id < 0 && msg->id != SHAREDINVALCATALOG_ID)
+			continue;
+
+		if (!advanced)
+		{
+			shared_catcache_attach();
+			pg_atomic_fetch_add_u64(&SharedCatCache->generation, 1);
+			advanced = true;
+		}
+
+		if (msg->id >= 0)
+		{
+			SharedCatCacheKey key;
+			SharedCatCacheEntry *entry;
+
+			memset(&key, 0, sizeof(key));
+			key.dbid = msg->cc.dbId;
+			key.cacheid = msg->cc.id;
+			key.hashvalue = msg->cc.hashValue;
+
+			entry = dshash_find(sharedCatCacheHash, &key, true);
+			if (entry != NULL)
+			{
+				shared_catcache_free_entry(entry);
+				dshash_delete_entry(sharedCatCacheHash, entry);
+			}
+		}
+		else
+			shared_catcache_remove_all(msg->cat.dbId, msg->cat.catId, false);
+	}
+}
+
+/*
+ * SharedCatCacheDropDatabase
+ *		Remove all entries of a database that is being dropped.
+ *
+ * Nobody can be connected to the database any more, but advance the
+ * generation anyway, so that nothing read before this point gets in.
+ */
+void
+SharedCatCacheDropDatabase(Oid dbid)
+{
+	int			nremoved;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	shared_catcache_attach();
+	pg_atomic_fetch_add_u64(&SharedCatCache->generation, 1);
+	nremoved = shared_catcache_remove_all(dbid, InvalidOid, false);
+
+	elog(DEBUG1, "removed %d shared catalog cache entries of database %u",
+		 nremoved, dbid);
+}
@@ -0,0 +1,630 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Generic plans shared between backends.
+ *
+ * Generic plans are kept per CachedPlanSource, so every session that
+ * prepares a statement has to plan it again, even if many other sessions
+ * run the very same statement.  When shared_plan_cache_size is set,
+ * plancache.c stores the generic plans it makes for saved plan sources in a
+ * hash table in shared memory, in the nodeToString() format that is also
+ * used to pass plans to parallel workers, and a new session preparing the
+ * same statement picks the plan up from there instead of planning.
+ *
+ * Plans are looked up by database, role, the statement text, its parameter
+ * types and cursor options, and a hash of whatever else in the session's
+ * environment could change the plan's meaning (see plancache.c).  Like the
+ * shared catalog cache, the table lives in a DSA area carved out of the
+ * main shared memory segment, and is simply emptied when it fills up.
+ *
+ * Each entry remembers the relations and the other objects its plan
+ * depends on, and SendSharedInvalidMessages() removes the entries that a
+ * batch of invalidation messages affects, as soon as the changes that
+ * caused them are visible; this mirrors what the plancache.c inval
+ * callbacks do with local plans.  A plan made from catalog state that was
+ * outdated by then must not be added later, so each batch also advances a
+ * generation counter, and a plan is only stored if the counter hasn't moved
+ * since its creator last processed invalidations, before planning.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+/* the area is never made smaller than this */
+#define SHARED_PLAN_CACHE_MIN_SIZE	(1024 * 1024)
+
+/* fraction of the area handed out for entries; see sharedcatcache.c */
+#define SHARED_PLAN_CACHE_BUDGET(size)	((size) / 2)
+
+/* rough per-entry overhead of dshash and DSA, used for accounting */
+#define SHARED_PLAN_CACHE_ENTRY_OVERHEAD	96
+
+typedef struct SharedPlanKey
+{
+	Oid			dbid;			/* database */
+	Oid			roleid;			/* role */
+	uint64		query_hash;		/* hash of statement, params and options */
+	uint64		env_hash;		/* hash of the session environment */
+} SharedPlanKey;
+
+typedef struct SharedPlanDep
+{
+	int			cacheId;		/* syscache ID */
+	uint32		hashValue;		/* hash value of the object */
+} SharedPlanDep;
+
+/*
+ * The variable-length part of an entry is a single chunk holding, in this
+ * order, the relation OIDs and other objects the plan depends on, the
+ * parameter types, and the NUL-terminated statement and plan strings.
+ */
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key, must be first */
+	int			cursor_options; /* to check for hash collisions ... */
+	int			num_params;
+	int			query_len;
+	int			plan_len;		/* length of plan string */
+	int			nrels;			/* number of relation dependencies */
+	int			ndeps;			/* number of other dependencies */
+	double		total_custom_cost;	/* creator's custom plan statistics */
+	int64		num_custom_plans;
+	Size		data_size;		/* size of the chunk */
+	dsa_pointer data;			/* the chunk */
+} SharedPlanEntry;
+
+#define SharedPlanRels(data) \
+	((Oid *) (data))
+#define SharedPlanDeps(entry, data) \
+	((SharedPlanDep *) (SharedPlanRels(data) + (entry)->nrels))
+#define SharedPlanParams(entry, data) \
+	((Oid *) (SharedPlanDeps(entry, data) + (entry)->ndeps))
+#define SharedPlanQuery(entry, data) \
+	((char *) (SharedPlanParams(entry, data) + (entry)->num_params))
+#define SharedPlanString(entry, data) \
+	(SharedPlanQuery(entry, data) + (entry)->query_len + 1)
+
+typedef struct SharedPlanCacheControl
+{
+	Size		area_size;		/* size of the DSA area */
+	dshash_table_handle hash;	/* handle of the entry table */
+	pg_atomic_uint64 generation;	/* advanced by each invalidation batch */
+	pg_atomic_uint64 bytes_used;	/* approximate memory used by entries */
+	pg_atomic_flag resetting;	/* is someone emptying the table? */
+	char	   *raw_dsa_area;	/* the DSA area, follows this struct */
+} SharedPlanCacheControl;
+
+static const dshash_parameters shared_plan_cache_params = {
+	sizeof(SharedPlanKey),
+	sizeof(SharedPlanEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH
+};
+
+/* GUC variable */
+int			shared_plan_cache_size = 0;
+
+static SharedPlanCacheControl *SharedPlanCache = NULL;
+
+/* per-process attachment, established lazily */
+static dsa_area *sharedPlanCacheDSA = NULL;
+static dshash_table *sharedPlanCacheHash = NULL;
+
+static Size
+shared_plan_cache_area_size(void)
+{
+	return Max((Size) shared_plan_cache_size * 1024,
+			   SHARED_PLAN_CACHE_MIN_SIZE);
+}
+
+/*
+ * SharedPlanCacheShmemSize
+ *		Compute space needed for the shared plan cache.
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	if (shared_plan_cache_size <= 0)
+		return 0;
+
+	return add_size(MAXALIGN(sizeof(SharedPlanCacheControl)),
+					shared_plan_cache_area_size());
+}
+
+/*
+ * SharedPlanCacheShmemInit
+ *		Allocate and initialize the shared plan cache, if enabled.
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_plan_cache_size <= 0)
+		return;
+
+	SharedPlanCache = (SharedPlanCacheControl *)
+		ShmemInitStruct("Shared Plan Cache", SharedPlanCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *hash;
+
+		Assert(!found);
+
+		SharedPlanCache->area_size = shared_plan_cache_area_size();
+		SharedPlanCache->raw_dsa_area = (char *) SharedPlanCache +
+			MAXALIGN(sizeof(SharedPlanCacheControl));
+		pg_atomic_init_u64(&SharedPlanCache->generation, 1);
+		pg_atomic_init_u64(&SharedPlanCache->bytes_used, 0);
+		pg_atomic_init_flag(&SharedPlanCache->resetting);
+
+		dsa = dsa_create_in_place(SharedPlanCache->raw_dsa_area,
+								  SharedPlanCache->area_size,
+								  LWTRANCHE_SHARED_PLAN_CACHE_DSA, NULL);
+		dsa_set_size_limit(dsa, SharedPlanCache->area_size);
+		dsa_pin(dsa);
+
+		hash = dshash_create(dsa, &shared_plan_cache_params, NULL);
+		SharedPlanCache->hash = dshash_get_hash_table_handle(hash);
+
+		dshash_detach(hash);
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the DSA area and the hash table, if this process hasn't yet.
+ */
+static void
+shared_plan_cache_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (sharedPlanCacheHash != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	sharedPlanCacheDSA = dsa_attach_in_place(SharedPlanCache->raw_dsa_area,
+											 NULL);
+	dsa_pin_mapping(sharedPlanCacheDSA);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(SharedPlanCache->raw_dsa_area));
+
+	sharedPlanCacheHash = dshash_attach(sharedPlanCacheDSA,
+										&shared_plan_cache_params,
+										SharedPlanCache->hash, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Release the memory of an entry that is about to be deleted.
+ */
+static void
+shared_plan_cache_free_entry(SharedPlanEntry *entry)
+{
+	if (DsaPointerIsValid(entry->data))
+	{
+		dsa_free(sharedPlanCacheDSA, entry->data);
+		pg_atomic_fetch_sub_u64(&SharedPlanCache->bytes_used,
+								entry->data_size +
+								SHARED_PLAN_CACHE_ENTRY_OVERHEAD);
+		entry->data = InvalidDsaPointer;
+	}
+}
+
+/*
+ * Compute the hash key of a statement.
+ */
+static void
+shared_plan_cache_make_key(const SharedPlanIdentity *id, const char *query,
+						   int query_len, SharedPlanKey *key)
+{
+	uint64		h;
+
+	memset(key, 0, sizeof(SharedPlanKey));
+	key->dbid = id->dbid;
+	key->roleid = id->roleid;
+	key->env_hash = id->env_hash;
+
+	h = hash_bytes_extended((const unsigned char *) query, query_len, 0);
+	h = hash_combine64(h, hash_bytes_uint32_extended((uint32) id->cursor_options, 0));
+	if (id->num_params > 0)
+		h = hash_combine64(h,
+						   hash_bytes_extended((const unsigned char *) id->param_types,
+											   id->num_params * sizeof(Oid), 0));
+	key->query_hash = h;
+}
+
+/*
+ * Get the statement out of the source text.
+ */
+static void
+shared_plan_cache_statement(const SharedPlanIdentity *id,
+							const char **query, int *query_len)
+{
+	*query = id->query_string + id->stmt_location;
+	if (id->stmt_len > 0)
+		*query_len = id->stmt_len;
+	else
+		*query_len = strlen(*query);
+}
+
+/*
+ * Does a found entry really belong to the statement?
+ */
+static bool
+shared_plan_cache_matches(SharedPlanEntry *entry, char *data,
+						  const SharedPlanIdentity *id,
+						  const char *query, int query_len)
+{
+	if (entry->cursor_options != id->cursor_options ||
+		entry->num_params != id->num_params ||
+		entry->query_len != query_len)
+		return false;
+	if (id->num_params > 0 &&
+		memcmp(SharedPlanParams(entry, data), id->param_types,
+			   id->num_params * sizeof(Oid)) != 0)
+		return false;
+	return memcmp(SharedPlanQuery(entry, data), query, query_len) == 0;
+}
+
+/*
+ * SharedPlanCacheEnabled
+ *		Is the shared plan cache available in this process?
+ */
+bool
+SharedPlanCacheEnabled(void)
+{
+	return SharedPlanCache != NULL;
+}
+
+/*
+ * SharedPlanCacheGeneration
+ *		Get the current invalidation generation.
+ *
+ * A backend about to make a plan it means to store must fetch this and then
+ * process pending invalidations before it starts planning.
+ */
+uint64
+SharedPlanCacheGeneration(void)
+{
+	Assert(SharedPlanCache != NULL);
+
+	return pg_atomic_read_u64(&SharedPlanCache->generation);
+}
+
+/*
+ * SharedPlanCacheLookup
+ *		Find the shared generic plan of a statement.
+ *
+ * Returns a palloc'd copy of the plan string, or NULL.  The custom plan
+ * statistics gathered by the session that made the plan are returned too.
+ */
+char *
+SharedPlanCacheLookup(const SharedPlanIdentity *id,
+					  double *total_custom_cost, int64 *num_custom_plans)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	const char *query;
+	int			query_len;
+	char	   *result = NULL;
+
+	Assert(SharedPlanCache != NULL);
+
+	shared_plan_cache_attach();
+
+	shared_plan_cache_statement(id, &query, &query_len);
+	shared_plan_cache_make_key(id, query, query_len, &key);
+
+	entry = dshash_find(sharedPlanCacheHash, &key, false);
+	if (entry == NULL)
+		return NULL;
+
+	if (DsaPointerIsValid(entry->data))
+	{
+		char	   *data = dsa_get_address(sharedPlanCacheDSA, entry->data);
+
+		if (shared_plan_cache_matches(entry, data, id, query, query_len))
+		{
+			result = palloc(entry->plan_len + 1);
+			memcpy(result, SharedPlanString(entry, data), entry->plan_len + 1);
+			*total_custom_cost = entry->total_custom_cost;
+			*num_custom_plans = entry->num_custom_plans;
+		}
+	}
+
+	dshash_release_lock(sharedPlanCacheHash, entry);
+
+	return result;
+}
+
+/*
+ * SharedPlanCacheStore
+ *		Store the generic plan of a statement.
+ *
+ * relationOids and invalItems are the plan's dependencies, as in
+ * PlannedStmt.  "generation" is what SharedPlanCacheGeneration() returned
+ * before planning; if it has moved since, the plan is silently not stored.
+ */
+void
+SharedPlanCacheStore(const SharedPlanIdentity *id, const char *plan_string,
+					 List *relationOids, List *invalItems,
+					 double total_custom_cost, int64 num_custom_plans,
+					 uint64 generation)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	const char *query;
+	int			query_len;
+	int			plan_len = strlen(plan_string);
+	int			nrels = list_length(relationOids);
+	int			ndeps = list_length(invalItems);
+	Size		data_size;
+	Size		budget;
+	dsa_pointer dp;
+	char	   *data;
+	ListCell   *lc;
+	int			i;
+	bool		found;
+
+	Assert(SharedPlanCache != NULL);
+
+	if (pg_atomic_read_u64(&SharedPlanCache->generation) != generation)
+		return;
+
+	shared_plan_cache_attach();
+
+	shared_plan_cache_statement(id, &query, &query_len);
+
+	data_size = nrels * sizeof(Oid) + ndeps * sizeof(SharedPlanDep) +
+		id->num_params * sizeof(Oid) + query_len + 1 + plan_len + 1;
+
+	/* Make room by starting over if the area is full */
+	budget = SHARED_PLAN_CACHE_BUDGET(SharedPlanCache->area_size);
+	if (data_size + SHARED_PLAN_CACHE_ENTRY_OVERHEAD > budget)
+		return;
+	if (pg_atomic_read_u64(&SharedPlanCache->bytes_used) + data_size +
+		SHARED_PLAN_CACHE_ENTRY_OVERHEAD > budget)
+	{
+		dshash_seq_status status;
+
+		if (!pg_atomic_test_set_flag(&SharedPlanCache->resetting))
+			return;				/* someone else is already at it */
+
+		PG_TRY();
+		{
+			dshash_seq_init(&status, sharedPlanCacheHash, true);
+			while ((entry = dshash_seq_next(&status)) != NULL)
+			{
+				shared_plan_cache_free_entry(entry);
+				dshash_delete_current(&status);
+			}
+			dshash_seq_term(&status);
+		}
+		PG_FINALLY();
+		{
+			pg_atomic_clear_flag(&SharedPlanCache->resetting);
+		}
+		PG_END_TRY();
+
+		elog(DEBUG1, "shared plan cache was full and has been emptied");
+
+		if (pg_atomic_read_u64(&SharedPlanCache->bytes_used) + data_size +
+			SHARED_PLAN_CACHE_ENTRY_OVERHEAD > budget)
+			return;
+	}
+
+	shared_plan_cache_make_key(id, query, query_len, &key);
+
+	entry = dshash_find_or_insert(sharedPlanCacheHash, &key, &found);
+
+	/*
+	 * Check the generation again while holding the partition lock, so that
+	 * an invalidation advancing it later will see our entry.
+	 */
+	if (pg_atomic_read_u64(&SharedPlanCache->generation) != generation)
+	{
+		if (found)
+			dshash_release_lock(sharedPlanCacheHash, entry);
+		else
+			dshash_delete_entry(sharedPlanCacheHash, entry);
+		return;
+	}
+
+	if (found)
+		shared_plan_cache_free_entry(entry);
+
+	dp = dsa_allocate_extended(sharedPlanCacheDSA, data_size,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		dshash_delete_entry(sharedPlanCacheHash, entry);
+		return;
+	}
+
+	entry->cursor_options = id->cursor_options;
+	entry->num_params = id->num_params;
+	entry->query_len = query_len;
+	entry->plan_len = plan_len;
+	entry->nrels = nrels;
+	entry->ndeps = ndeps;
+	entry->total_custom_cost = total_custom_cost;
+	entry->num_custom_plans = num_custom_plans;
+	entry->data_size = data_size;
+	entry->data = dp;
+
+	data = dsa_get_address(sharedPlanCacheDSA, dp);
+	i = 0;
+	foreach(lc, relationOids)
+		SharedPlanRels(data)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, invalItems)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		SharedPlanDeps(entry, data)[i].cacheId = item->cacheId;
+		SharedPlanDeps(entry, data)[i].hashValue = item->hashValue;
+		i++;
+	}
+	if (id->num_params > 0)
+		memcpy(SharedPlanParams(entry, data), id->param_types,
+			   id->num_params * sizeof(Oid));
+	memcpy(SharedPlanQuery(entry, data), query, query_len);
+	SharedPlanQuery(entry, data)[query_len] = '\0';
+	memcpy(SharedPlanString(entry, data), plan_string, plan_len + 1);
+
+	pg_atomic_fetch_add_u64(&SharedPlanCache->bytes_used,
+							data_size + SHARED_PLAN_CACHE_ENTRY_OVERHEAD);
+
+	dshash_release_lock(sharedPlanCacheHash, entry);
+}
+
+/*
+ * Is this an invalidation that local plans would react to?
+ */
+static bool
+shared_plan_cache_relevant(const SharedInvalidationMessage *msg)
+{
+	switch (msg->id)
+	{
+		case SHAREDINVALRELCACHE_ID:
+		case SHAREDINVALCATALOG_ID:
+			return true;
+		case PROCOID:
+		case TYPEOID:
+		case NAMESPACEOID:
+		case OPEROID:
+		case AMOPOPID:
+		case FOREIGNSERVEROID:
+		case FOREIGNDATAWRAPPEROID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Does the message invalidate the plan of the entry?
+ *
+ * This follows the plancache.c inval callbacks: relcache invalidations hit
+ * plans using the relation, pg_proc and pg_type invalidations plans using
+ * the object, and the other ones everything in the database.
+ */
+static bool
+shared_plan_cache_affected(SharedPlanEntry *entry, char *data,
+						   const SharedInvalidationMessage *msg)
+{
+	int			i;
+
+	switch (msg->id)
+	{
+		case SHAREDINVALRELCACHE_ID:
+			if (OidIsValid(msg->rc.dbId) && msg->rc.dbId != entry->key.dbid)
+				return false;
+			if (!OidIsValid(msg->rc.relId))
+				return true;
+			for (i = 0; i < entry->nrels; i++)
+			{
+				if (SharedPlanRels(data)[i] == msg->rc.relId)
+					return true;
+			}
+			return false;
+
+		case SHAREDINVALCATALOG_ID:
+			return !OidIsValid(msg->cat.dbId) ||
+				msg->cat.dbId == entry->key.dbid;
+
+		case PROCOID:
+		case TYPEOID:
+			if (OidIsValid(msg->cc.dbId) && msg->cc.dbId != entry->key.dbid)
+				return false;
+			for (i = 0; i < entry->ndeps; i++)
+			{
+				SharedPlanDep *dep = &SharedPlanDeps(entry, data)[i];
+
+				if (dep->cacheId == msg->id &&
+					dep->hashValue == msg->cc.hashValue)
+					return true;
+			}
+			return false;
+
+		default:
+			return !OidIsValid(msg->cc.dbId) ||
+				msg->cc.dbId == entry->key.dbid;
+	}
+}
+
+/*
+ * SharedPlanCacheInvalidateMessages
+ *		Remove the shared plans affected by a batch of invalidation messages
+ *		that is about to be sent.
+ */
+void
+SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs, int n)
+{
+	dshash_seq_status status;
+	SharedPlanEntry *entry;
+	bool		relevant = false;
+	int			i;
+
+	if (SharedPlanCache == NULL)
+		return;
+
+	for (i = 0; i < n && !relevant; i++)
+		relevant = shared_plan_cache_relevant(&msgs[i]);
+	if (!relevant)
+		return;
+
+	shared_plan_cache_attach();
+	pg_atomic_fetch_add_u64(&SharedPlanCache->generation, 1);
+
+	dshash_seq_init(&status, sharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		char	   *data;
+
+		if (!DsaPointerIsValid(entry->data))
+			continue;
+
+		data = dsa_get_address(sharedPlanCacheDSA, entry->data);
+		for (i = 0; i < n; i++)
+		{
+			if (shared_plan_cache_relevant(&msgs[i]) &&
+				shared_plan_cache_affected(entry, data, &msgs[i]))
+			{
+				shared_plan_cache_free_entry(entry);
+				dshash_delete_current(&status);
+				break;
+			}
+		}
+	}
+	dshash_seq_term(&status);
+}
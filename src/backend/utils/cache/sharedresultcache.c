@@ -0,0 +1,641 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedresultcache.c
+ *	  Results of expensive immutable functions shared between backends.
+ *
+ * Memoize nodes only remember results for the duration of one execution.
+ * When shared_result_cache_size is set, the calls that the executor makes
+ * to IMMUTABLE functions declared with a COST of at least
+ * shared_result_cache_min_cost are routed through a wrapper that looks the
+ * arguments up in a hash table in shared memory, and only calls the function
+ * if no session has computed that result yet.  The COST threshold is what
+ * makes this opt-in: a function is cached once it is declared expensive
+ * enough to be worth a hash table probe.
+ *
+ * Entries are keyed by database, function OID and a hash of the call, which
+ * consists of the input collation, the result and argument types and the
+ * serialized argument values; the whole call is compared on lookup.  Two
+ * values are only considered the same if their serialized forms are byte
+ * for byte identical, which is always safe for an immutable function even
+ * where the type's equality operator would say otherwise.  Like the shared
+ * plan cache, the table lives in a DSA area carved out of the main shared
+ * memory segment, and is simply emptied when it fills up.
+ *
+ * Since the functions are immutable, the only thing a result can depend on
+ * is the function's definition.  SendSharedInvalidMessages() therefore
+ * removes the entries of a function when its pg_proc row is invalidated,
+ * and uses a generation counter like sharedplancache.c to keep sessions that
+ * haven't processed the invalidation yet from storing results computed with
+ * the old definition.  Functions whose definition was changed by the current
+ * transaction are not cached at all.  Stable functions and subplans would
+ * need results to be tied to snapshots and are not handled.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedresultcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/datum.h"
+#include "utils/dsa.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sharedresultcache.h"
+#include "utils/syscache.h"
+
+/* the area is never made smaller than this */
+#define SHARED_RESULT_CACHE_MIN_SIZE	(1024 * 1024)
+
+/* fraction of the area handed out for entries; see sharedcatcache.c */
+#define SHARED_RESULT_CACHE_BUDGET(size)	((size) / 2)
+
+/* rough per-entry overhead of dshash and DSA, used for accounting */
+#define SHARED_RESULT_CACHE_ENTRY_OVERHEAD	96
+
+typedef struct SharedResultKey
+{
+	Oid			dbid;			/* database */
+	Oid			funcid;			/* function */
+	uint64		call_hash;		/* hash of the serialized call */
+} SharedResultKey;
+
+/*
+ * The data chunk holds the serialized call, as built by
+ * shared_result_cache_serialize_call(), followed by the serialized result.
+ */
+typedef struct SharedResultEntry
+{
+	SharedResultKey key;		/* hash key, must be first */
+	uint32		proc_hash;		/* syscache hash value of the pg_proc row */
+	Size		call_len;		/* length of the serialized call */
+	Size		data_size;		/* size of the chunk */
+	dsa_pointer data;			/* the chunk */
+} SharedResultEntry;
+
+typedef struct SharedResultCacheControl
+{
+	Size		area_size;		/* size of the DSA area */
+	dshash_table_handle hash;	/* handle of the entry table */
+	pg_atomic_uint64 generation;	/* advanced by each invalidation batch */
+	pg_atomic_uint64 bytes_used;	/* approximate memory used by entries */
+	pg_atomic_flag resetting;	/* is someone emptying the table? */
+	char	   *raw_dsa_area;	/* the DSA area, follows this struct */
+} SharedResultCacheControl;
+
+/*
+ * What the wrapper needs to know about a call site.  This is kept in the
+ * fn_extra of the FmgrInfo the executor calls through, while flinfo is the
+ * one used to call the real function.
+ */
+typedef struct SharedResultCacheCall
+{
+	FmgrInfo	flinfo;			/* lookup info for the real function */
+	Oid			funcid;
+	Oid			collation;
+	Oid			rettype;
+	int16		rettyplen;
+	bool		rettypbyval;
+	int			nargs;
+	Oid		   *argtypes;
+	int16	   *argtyplens;
+	bool	   *argtypbyvals;
+	uint32		proc_hash;		/* syscache hash value of the pg_proc row */
+	uint64		generation;		/* results are only stored while unchanged */
+} SharedResultCacheCall;
+
+static const dshash_parameters shared_result_cache_params = {
+	sizeof(SharedResultKey),
+	sizeof(SharedResultEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_RESULT_CACHE_HASH
+};
+
+/* GUC variables */
+int			shared_result_cache_size = 0;
+double		shared_result_cache_min_cost = 1000.0;
+
+static SharedResultCacheControl *SharedResultCache = NULL;
+
+/* per-process attachment, established lazily */
+static dsa_area *sharedResultCacheDSA = NULL;
+static dshash_table *sharedResultCacheHash = NULL;
+
+static Datum shared_result_cache_call(PG_FUNCTION_ARGS);
+
+static Size
+shared_result_cache_area_size(void)
+{
+	return Max((Size) shared_result_cache_size * 1024,
+			   SHARED_RESULT_CACHE_MIN_SIZE);
+}
+
+/*
+ * SharedResultCacheShmemSize
+ *		Compute space needed for the shared result cache.
+ */
+Size
+SharedResultCacheShmemSize(void)
+{
+	if (shared_result_cache_size <= 0)
+		return 0;
+
+	return add_size(MAXALIGN(sizeof(SharedResultCacheControl)),
+					shared_result_cache_area_size());
+}
+
+/*
+ * SharedResultCacheShmemInit
+ *		Allocate and initialize the shared result cache, if enabled.
+ */
+void
+SharedResultCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_result_cache_size <= 0)
+		return;
+
+	SharedResultCache = (SharedResultCacheControl *)
+		ShmemInitStruct("Shared Result Cache", SharedResultCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *hash;
+
+		Assert(!found);
+
+		SharedResultCache->area_size = shared_result_cache_area_size();
+		SharedResultCache->raw_dsa_area = (char *) SharedResultCache +
+			MAXALIGN(sizeof(SharedResultCacheControl));
+		pg_atomic_init_u64(&SharedResultCache->generation, 1);
+		pg_atomic_init_u64(&SharedResultCache->bytes_used, 0);
+		pg_atomic_init_flag(&SharedResultCache->resetting);
+
+		dsa = dsa_create_in_place(SharedResultCache->raw_dsa_area,
+								  SharedResultCache->area_size,
+								  LWTRANCHE_SHARED_RESULT_CACHE_DSA, NULL);
+		dsa_set_size_limit(dsa, SharedResultCache->area_size);
+		dsa_pin(dsa);
+
+		hash = dshash_create(dsa, &shared_result_cache_params, NULL);
+		SharedResultCache->hash = dshash_get_hash_table_handle(hash);
+
+		dshash_detach(hash);
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the DSA area and the hash table, if this process hasn't yet.
+ */
+static void
+shared_result_cache_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (sharedResultCacheHash != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	sharedResultCacheDSA = dsa_attach_in_place(SharedResultCache->raw_dsa_area,
+											   NULL);
+	dsa_pin_mapping(sharedResultCacheDSA);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(SharedResultCache->raw_dsa_area));
+
+	sharedResultCacheHash = dshash_attach(sharedResultCacheDSA,
+										  &shared_result_cache_params,
+										  SharedResultCache->hash, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Release the memory of an entry that is about to be deleted.
+ */
+static void
+shared_result_cache_free_entry(SharedResultEntry *entry)
+{
+	if (DsaPointerIsValid(entry->data))
+	{
+		dsa_free(sharedResultCacheDSA, entry->data);
+		pg_atomic_fetch_sub_u64(&SharedResultCache->bytes_used,
+								entry->data_size +
+								SHARED_RESULT_CACHE_ENTRY_OVERHEAD);
+		entry->data = InvalidDsaPointer;
+	}
+}
+
+/*
+ * SharedResultCacheEnabled
+ *		Is the shared result cache available in this process?
+ */
+bool
+SharedResultCacheEnabled(void)
+{
+	return SharedResultCache != NULL;
+}
+
+/*
+ * SharedResultCacheSetupCall
+ *		Route the calls made through flinfo via the shared result cache, if
+ *		the function qualifies.
+ *
+ * flinfo must have just been set up for funcid by fmgr_info(); node and args
+ * are the expression calling it and its arguments.  If the function doesn't
+ * qualify, flinfo is left alone.
+ */
+void
+SharedResultCacheSetupCall(FmgrInfo *flinfo, Oid funcid, Oid inputcollid,
+						   Expr *node, List *args)
+{
+	SharedResultCacheCall *call;
+	HeapTuple	proctup;
+	Form_pg_proc procform;
+	bool		qualifies;
+	uint64		generation;
+	ListCell   *lc;
+	int			i;
+
+	if (SharedResultCache == NULL || flinfo->fn_retset)
+		return;
+
+	/*
+	 * Get the generation before making sure we have seen all invalidations,
+	 * so that any change to the function that we haven't seen also stops us
+	 * from storing results.
+	 */
+	generation = pg_atomic_read_u64(&SharedResultCache->generation);
+	AcceptInvalidationMessages();
+
+	proctup = SearchSysCache1(PROCOID, ObjectIdGetDatum(funcid));
+	if (!HeapTupleIsValid(proctup))
+		elog(ERROR, "cache lookup failed for function %u", funcid);
+	procform = (Form_pg_proc) GETSTRUCT(proctup);
+
+	qualifies = procform->provolatile == PROVOLATILE_IMMUTABLE &&
+		procform->procost >= shared_result_cache_min_cost &&
+		!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(proctup->t_data));
+
+	ReleaseSysCache(proctup);
+
+	if (!qualifies)
+		return;
+
+	/* We can't serialize the result or arguments of pseudo-types */
+	if (get_typtype(exprType((Node *) node)) == TYPTYPE_PSEUDO)
+		return;
+	foreach(lc, args)
+	{
+		if (get_typtype(exprType((Node *) lfirst(lc))) == TYPTYPE_PSEUDO)
+			return;
+	}
+
+	call = MemoryContextAllocZero(flinfo->fn_mcxt,
+								  sizeof(SharedResultCacheCall));
+	fmgr_info_copy(&call->flinfo, flinfo, flinfo->fn_mcxt);
+	call->funcid = funcid;
+	call->collation = inputcollid;
+	call->rettype = exprType((Node *) node);
+	get_typlenbyval(call->rettype, &call->rettyplen, &call->rettypbyval);
+	call->nargs = list_length(args);
+	call->argtypes = MemoryContextAlloc(flinfo->fn_mcxt,
+										(call->nargs + 1) * sizeof(Oid));
+	call->argtyplens = MemoryContextAlloc(flinfo->fn_mcxt,
+										  (call->nargs + 1) * sizeof(int16));
+	call->argtypbyvals = MemoryContextAlloc(flinfo->fn_mcxt,
+											(call->nargs + 1) * sizeof(bool));
+	i = 0;
+	foreach(lc, args)
+	{
+		call->argtypes[i] = exprType((Node *) lfirst(lc));
+		get_typlenbyval(call->argtypes[i], &call->argtyplens[i],
+						&call->argtypbyvals[i]);
+		i++;
+	}
+	call->proc_hash = GetSysCacheHashValue1(PROCOID, ObjectIdGetDatum(funcid));
+	call->generation = generation;
+
+	flinfo->fn_addr = shared_result_cache_call;
+	flinfo->fn_extra = call;
+}
+
+/*
+ * Serialize a call into a palloc'd buffer, returning its length.
+ */
+static Size
+shared_result_cache_serialize_call(SharedResultCacheCall *call,
+								   FunctionCallInfo fcinfo, char **buffer)
+{
+	Datum	   *values = palloc(Max(call->nargs, 1) * sizeof(Datum));
+	Size		len;
+	char	   *ptr;
+	int			i;
+
+	len = 2 * sizeof(Oid) + call->nargs * sizeof(Oid);
+	for (i = 0; i < call->nargs; i++)
+	{
+		Datum		value = fcinfo->args[i].value;
+
+		/* compressed or out-of-line values must be compared flattened */
+		if (!fcinfo->args[i].isnull && call->argtyplens[i] == -1 &&
+			!VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(value)))
+			value = PointerGetDatum(PG_DETOAST_DATUM_PACKED(value));
+		values[i] = value;
+
+		len += datumEstimateSpace(value, fcinfo->args[i].isnull,
+								  call->argtypbyvals[i], call->argtyplens[i]);
+	}
+
+	*buffer = ptr = palloc(len);
+	memcpy(ptr, &call->collation, sizeof(Oid));
+	ptr += sizeof(Oid);
+	memcpy(ptr, &call->rettype, sizeof(Oid));
+	ptr += sizeof(Oid);
+	memcpy(ptr, call->argtypes, call->nargs * sizeof(Oid));
+	ptr += call->nargs * sizeof(Oid);
+	for (i = 0; i < call->nargs; i++)
+		datumSerialize(values[i], fcinfo->args[i].isnull,
+					   call->argtypbyvals[i], call->argtyplens[i], &ptr);
+	Assert(ptr == *buffer + len);
+
+	pfree(values);
+
+	return len;
+}
+
+/*
+ * Look for the result of a serialized call.  On success, the result is
+ * restored into the current memory context.
+ */
+static bool
+shared_result_cache_lookup(const SharedResultKey *key, const char *buffer,
+						   Size len, Datum *result, bool *isnull)
+{
+	SharedResultEntry *entry;
+	bool		found = false;
+
+	entry = dshash_find(sharedResultCacheHash, key, false);
+	if (entry == NULL)
+		return false;
+
+	if (DsaPointerIsValid(entry->data) && entry->call_len == len)
+	{
+		char	   *data = dsa_get_address(sharedResultCacheDSA, entry->data);
+
+		if (memcmp(data, buffer, len) == 0)
+		{
+			data += len;
+			*result = datumRestore(&data, isnull);
+			found = true;
+		}
+	}
+
+	dshash_release_lock(sharedResultCacheHash, entry);
+
+	return found;
+}
+
+/*
+ * Store the result of a serialized call, unless an invalidation has come in
+ * since the call site was set up.
+ */
+static void
+shared_result_cache_store(SharedResultCacheCall *call,
+						  const SharedResultKey *key, const char *buffer,
+						  Size len, Datum result, bool isnull)
+{
+	SharedResultEntry *entry;
+	Size		data_size;
+	Size		budget;
+	dsa_pointer dp;
+	char	   *data;
+	bool		found;
+
+	if (pg_atomic_read_u64(&SharedResultCache->generation) != call->generation)
+		return;
+
+	/* flatten compressed or out-of-line results, like the arguments */
+	if (!isnull && call->rettyplen == -1 &&
+		!VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(result)))
+		result = PointerGetDatum(PG_DETOAST_DATUM_PACKED(result));
+
+	data_size = len + datumEstimateSpace(result, isnull, call->rettypbyval,
+										 call->rettyplen);
+
+	/* Make room by starting over if the area is full */
+	budget = SHARED_RESULT_CACHE_BUDGET(SharedResultCache->area_size);
+	if (data_size + SHARED_RESULT_CACHE_ENTRY_OVERHEAD > budget)
+		return;
+	if (pg_atomic_read_u64(&SharedResultCache->bytes_used) + data_size +
+		SHARED_RESULT_CACHE_ENTRY_OVERHEAD > budget)
+	{
+		dshash_seq_status status;
+
+		if (!pg_atomic_test_set_flag(&SharedResultCache->resetting))
+			return;				/* someone else is already at it */
+
+		PG_TRY();
+		{
+			dshash_seq_init(&status, sharedResultCacheHash, true);
+			while ((entry = dshash_seq_next(&status)) != NULL)
+			{
+				shared_result_cache_free_entry(entry);
+				dshash_delete_current(&status);
+			}
+			dshash_seq_term(&status);
+		}
+		PG_FINALLY();
+		{
+			pg_atomic_clear_flag(&SharedResultCache->resetting);
+		}
+		PG_END_TRY();
+
+		elog(DEBUG1, "shared result cache was full and has been emptied");
+
+		if (pg_atomic_read_u64(&SharedResultCache->bytes_used) + data_size +
+			SHARED_RESULT_CACHE_ENTRY_OVERHEAD > budget)
+			return;
+	}
+
+	entry = dshash_find_or_insert(sharedResultCacheHash, key, &found);
+
+	/*
+	 * Check the generation again while holding the partition lock, so that
+	 * an invalidation advancing it later will see our entry.
+	 */
+	if (pg_atomic_read_u64(&SharedResultCache->generation) != call->generation)
+	{
+		if (found)
+			dshash_release_lock(sharedResultCacheHash, entry);
+		else
+			dshash_delete_entry(sharedResultCacheHash, entry);
+		return;
+	}
+
+	if (found)
+		shared_result_cache_free_entry(entry);
+
+	dp = dsa_allocate_extended(sharedResultCacheDSA, data_size,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		dshash_delete_entry(sharedResultCacheHash, entry);
+		return;
+	}
+
+	entry->proc_hash = call->proc_hash;
+	entry->call_len = len;
+	entry->data_size = data_size;
+	entry->data = dp;
+
+	data = dsa_get_address(sharedResultCacheDSA, dp);
+	memcpy(data, buffer, len);
+	data += len;
+	datumSerialize(result, isnull, call->rettypbyval, call->rettyplen, &data);
+
+	pg_atomic_fetch_add_u64(&SharedResultCache->bytes_used,
+							data_size + SHARED_RESULT_CACHE_ENTRY_OVERHEAD);
+
+	dshash_release_lock(sharedResultCacheHash, entry);
+}
+
+/*
+ * The function the executor calls in place of a cached function.
+ */
+static Datum
+shared_result_cache_call(PG_FUNCTION_ARGS)
+{
+	SharedResultCacheCall *call = (SharedResultCacheCall *) fcinfo->flinfo->fn_extra;
+	FmgrInfo   *save_flinfo = fcinfo->flinfo;
+	SharedResultKey key;
+	char	   *buffer;
+	Size		len;
+	Datum		result;
+	bool		isnull;
+
+	shared_result_cache_attach();
+
+	len = shared_result_cache_serialize_call(call, fcinfo, &buffer);
+
+	memset(&key, 0, sizeof(SharedResultKey));
+	key.dbid = MyDatabaseId;
+	key.funcid = call->funcid;
+	key.call_hash = hash_bytes_extended((const unsigned char *) buffer,
+										len, 0);
+
+	if (shared_result_cache_lookup(&key, buffer, len, &result, &isnull))
+	{
+		pfree(buffer);
+		fcinfo->isnull = isnull;
+		return result;
+	}
+
+	/* Not there; call the function itself through its own FmgrInfo */
+	PG_TRY();
+	{
+		fcinfo->flinfo = &call->flinfo;
+		result = FunctionCallInvoke(fcinfo);
+	}
+	PG_FINALLY();
+	{
+		fcinfo->flinfo = save_flinfo;
+	}
+	PG_END_TRY();
+
+	shared_result_cache_store(call, &key, buffer, len, result, fcinfo->isnull);
+	pfree(buffer);
+
+	return result;
+}
+
+/*
+ * Does the message invalidate the entries of the given database and
+ * pg_proc row, or all of the database's entries if proc_hash is NULL?
+ */
+static bool
+shared_result_cache_affected(const SharedInvalidationMessage *msg,
+							 Oid dbid, uint32 proc_hash)
+{
+	switch (msg->id)
+	{
+		case PROCOID:
+			return (!OidIsValid(msg->cc.dbId) || msg->cc.dbId == dbid) &&
+				msg->cc.hashValue == proc_hash;
+
+		case SHAREDINVALCATALOG_ID:
+			return msg->cat.catId == ProcedureRelationId &&
+				(!OidIsValid(msg->cat.dbId) || msg->cat.dbId == dbid);
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * SharedResultCacheInvalidateMessages
+ *		Remove the shared results affected by a batch of invalidation
+ *		messages that is about to be sent.
+ */
+void
+SharedResultCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+									int n)
+{
+	dshash_seq_status status;
+	SharedResultEntry *entry;
+	bool		relevant = false;
+	int			i;
+
+	if (SharedResultCache == NULL)
+		return;
+
+	for (i = 0; i < n && !relevant; i++)
+		relevant = (msgs[i].id == PROCOID ||
+					(msgs[i].id == SHAREDINVALCATALOG_ID &&
+					 msgs[i].cat.catId == ProcedureRelationId));
+	if (!relevant)
+		return;
+
+	shared_result_cache_attach();
+	pg_atomic_fetch_add_u64(&SharedResultCache->generation, 1);
+
+	dshash_seq_init(&status, sharedResultCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (shared_result_cache_affected(&msgs[i], entry->key.dbid,
+											 entry->proc_hash))
+			{
+				shared_result_cache_free_entry(entry);
+				dshash_delete_current(&status);
+				break;
+			}
+		}
+	}
+	dshash_seq_term(&status);
+}
@@ -1139,6 +1139,52 @@ hash_search_with_hash_value(HTAB *hashp,
 	return NULL;				/* keep compiler quiet */
 }
 
+/*
+ * hash_search_unlocked -- look up a key without holding any lock
+ *
+ * This is only usable for partitioned shared tables.  Those can't be
+ * expanded, so the directory and bucket arrays never change, and elements
+ * are never given back to the allocator, only moved between bucket chains
+ * and freelists.  Thus following links is always safe, even while other
+ * backends modify the table, but the result is not guaranteed to be right
+ * if that happened: callers must detect concurrent modifications by other
+ * means, for example a sequence counter bumped by writers, and redo the
+ * lookup under the partition lock if so.
+ *
+ * To be sure not to loop forever on links changing underneath us, we give
+ * up after visiting max_steps elements.  NULL is returned in that case, as
+ * well as if the key wasn't found.
+ */
+void *
+hash_search_unlocked(HTAB *hashp,
+					 const void *keyPtr,
+					 uint32 hashvalue,
+					 int max_steps)
+{
+	HASHHDR    *hctl = hashp->hctl;
+	Size		keysize = hashp->keysize;
+	HashCompareFunc match = hashp->match;
+	uint32		bucket;
+	HASHSEGMENT segp;
+	HASHBUCKET	currBucket;
+
+	Assert(IS_PARTITIONED(hctl));
+
+	bucket = calc_bucket(hctl, hashvalue);
+	segp = hashp->dir[bucket >> hashp->sshift];
+	currBucket = segp[MOD(bucket, hashp->ssize)];
+
+	while (currBucket != NULL && max_steps-- > 0)
+	{
+		if (currBucket->hashvalue == hashvalue &&
+			match(ELEMENTKEY(currBucket), keyPtr, keysize) == 0)
+			return (void *) ELEMENTKEY(currBucket);
+		currBucket = currBucket->link;
+	}
+
+	return NULL;
+}
+
 /*
  * hash_update_hash_key -- change the hash key of an existing table entry
  *
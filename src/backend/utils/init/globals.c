@@ -124,6 +124,7 @@ bool		allowSystemTableMods = false;
 int			work_mem = 4096;
 double		hash_mem_multiplier = 1.0;
 int			maintenance_work_mem = 65536;
+int			backend_memory_limit = 0;
 int			max_parallel_maintenance_workers = 2;
 
 /*
@@ -138,11 +139,19 @@ int			max_worker_processes = 8;
 int			max_parallel_workers = 8;
 int			MaxBackends = 0;
 
+/* Number of page buffers for the SLRU caches; see slru.c */
+int			subtransaction_buffers = 32;
+int			multixact_offset_buffers = 8;
+int			multixact_member_buffers = 16;
+int			notify_buffers = 8;
+int			commit_timestamp_buffers = 0;	/* 0 = size automatically */
+
 int			VacuumCostPageHit = 1;	/* GUC parameters for vacuum */
 int			VacuumCostPageMiss = 2;
 int			VacuumCostPageDirty = 20;
 int			VacuumCostLimit = 200;
 double		VacuumCostDelay = 0;
+double		VacuumCostTargetReadLatency = 0;
 
 int64		VacuumPageHit = 0;
 int64		VacuumPageMiss = 0;
@@ -499,6 +499,35 @@ InitializeMaxBackends(void)
 		elog(ERROR, "too many backends configured");
 }
 
+/*
+ * Initialize the number of fast-path lock groups per backend.
+ *
+ * We allow enough fast-path slots for max_locks_per_transaction relation
+ * locks, rounded up to a power of two number of groups.  Sizing them by the
+ * same setting as the main lock table means that a backend that's used all
+ * of its fast-path slots can't easily exhaust the lock table when its locks
+ * are transferred to it.
+ *
+ * This must be called after modules have had the chance to alter GUCs in
+ * shared_preload_libraries, and before shared memory size is determined.
+ * As with MaxBackends, in EXEC_BACKEND environment the value is passed down
+ * from postmaster to subprocesses via BackendParameters in
+ * SubPostmasterMain; only postmaster itself and processes not under
+ * postmaster control should call this.
+ */
+void
+InitializeFastPathLocks(void)
+{
+	Assert(FastPathLockGroupsPerBackend == 0);
+
+	/* we need at least one group */
+	FastPathLockGroupsPerBackend = 1;
+
+	while (FastPathLockGroupsPerBackend < FP_LOCK_GROUPS_PER_BACKEND_MAX &&
+		   FastPathLockSlotsPerBackend() < max_locks_per_xact)
+		FastPathLockGroupsPerBackend *= 2;
+}
+
 /*
  * Early initialization of a backend (either standalone or under postmaster).
  * This happens even before InitPostgres.
@@ -528,6 +528,16 @@ UtfToLocal(const unsigned char *utf, int len,
 		unsigned char b3 = 0;
 		unsigned char b4 = 0;
 
+		/* fast path for runs of ASCII, assumed to convert one-to-one */
+		if (len >= PG_ASCII_CHUNK_LEN && is_valid_ascii(utf, PG_ASCII_CHUNK_LEN))
+		{
+			memcpy(iso, utf, PG_ASCII_CHUNK_LEN);
+			iso += PG_ASCII_CHUNK_LEN;
+			utf += PG_ASCII_CHUNK_LEN;
+			l = PG_ASCII_CHUNK_LEN;
+			continue;
+		}
+
 		/* "break" cases all represent errors */
 		if (*utf == '\0')
 			break;
@@ -739,6 +749,16 @@ LocalToUtf(const unsigned char *iso, int len,
 		unsigned char b3 = 0;
 		unsigned char b4 = 0;
 
+		/* fast path for runs of ASCII, assumed to convert one-to-one */
+		if (len >= PG_ASCII_CHUNK_LEN && is_valid_ascii(iso, PG_ASCII_CHUNK_LEN))
+		{
+			memcpy(utf, iso, PG_ASCII_CHUNK_LEN);
+			utf += PG_ASCII_CHUNK_LEN;
+			iso += PG_ASCII_CHUNK_LEN;
+			l = PG_ASCII_CHUNK_LEN;
+			continue;
+		}
+
 		/* "break" cases all represent errors */
 		if (*iso == '\0')
 			break;
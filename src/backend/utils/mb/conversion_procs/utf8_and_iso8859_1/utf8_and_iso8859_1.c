@@ -48,6 +48,16 @@ iso8859_1_to_utf8(PG_FUNCTION_ARGS)
 
 	while (len > 0)
 	{
+		/* fast path for runs of ASCII, which convert one-to-one */
+		if (len >= PG_ASCII_CHUNK_LEN && is_valid_ascii(src, PG_ASCII_CHUNK_LEN))
+		{
+			memcpy(dest, src, PG_ASCII_CHUNK_LEN);
+			dest += PG_ASCII_CHUNK_LEN;
+			src += PG_ASCII_CHUNK_LEN;
+			len -= PG_ASCII_CHUNK_LEN;
+			continue;
+		}
+
 		c = *src;
 		if (c == 0)
 		{
@@ -85,6 +95,16 @@ utf8_to_iso8859_1(PG_FUNCTION_ARGS)
 
 	while (len > 0)
 	{
+		/* fast path for runs of ASCII, which convert one-to-one */
+		if (len >= PG_ASCII_CHUNK_LEN && is_valid_ascii(src, PG_ASCII_CHUNK_LEN))
+		{
+			memcpy(dest, src, PG_ASCII_CHUNK_LEN);
+			dest += PG_ASCII_CHUNK_LEN;
+			src += PG_ASCII_CHUNK_LEN;
+			len -= PG_ASCII_CHUNK_LEN;
+			continue;
+		}
+
 		c = *src;
 		if (c == 0)
 		{
@@ -33,24 +33,35 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/gin.h"
+#include "access/heapam.h"
+#include "access/hio.h"
+#include "access/parallel.h"
 #include "access/rmgr.h"
+#include "access/slru.h"
 #include "access/tableam.h"
 #include "access/toast_compression.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "commands/sequence.h"
 #include "commands/trigger.h"
 #include "commands/user.h"
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "common/string.h"
+#include "common/zpq_stream.h"
+#include "executor/executor.h"
+#include "executor/nodeHash.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -70,7 +81,9 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/startup.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
@@ -81,19 +94,24 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
+#include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/standby.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/acl.h"
+#include "utils/backend_profile.h"
 #include "utils/backend_status.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/float.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
@@ -104,6 +122,9 @@
 #include "utils/ps_status.h"
 #include "utils/queryjumble.h"
 #include "utils/rls.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/snapmgr.h"
 #include "utils/tzparser.h"
 #include "utils/inval.h"
@@ -133,6 +154,7 @@
 extern bool Log_disconnections;
 extern int	CommitDelay;
 extern int	CommitSiblings;
+extern bool AdaptiveCommitDelay;
 extern char *default_tablespace;
 extern char *temp_tablespaces;
 extern bool ignore_checksum_failure;
@@ -210,8 +232,13 @@ static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource sourc
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_huge_page_size(int *newval, void **extra, GucSource source);
+static bool check_shared_memory_numa_interleave(bool *newval, void **extra,
+												GucSource source);
+static bool check_io_direct(char **newval, void **extra, GucSource source);
+static void assign_io_direct(const char *newval, void *extra);
 static bool check_client_connection_check_interval(int *newval, void **extra, GucSource source);
-static void assign_pgstat_temp_directory(const char *newval, void *extra);
+static bool check_protocol_compression(char **newval, void **extra, GucSource source);
+static void assign_protocol_compression(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
 static bool check_cluster_name(char **newval, void **extra, GucSource source);
@@ -520,6 +547,13 @@ static struct config_enum_entry recovery_init_sync_method_options[] = {
 	{NULL, 0, false}
 };
 
+static struct config_enum_entry recovery_prefetch_options[] = {
+	{"off", RECOVERY_PREFETCH_OFF, false},
+	{"on", RECOVERY_PREFETCH_ON, false},
+	{"try", RECOVERY_PREFETCH_TRY, false},
+	{NULL, 0, false}
+};
+
 static struct config_enum_entry shared_memory_options[] = {
 #ifndef WIN32
 	{"sysv", SHMEM_TYPE_SYSV, false},
@@ -537,6 +571,9 @@ static struct config_enum_entry default_toast_compression_options[] = {
 	{"pglz", TOAST_PGLZ_COMPRESSION, false},
 #ifdef  USE_LZ4
 	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
 #endif
 	{NULL, 0, false}
 };
@@ -545,6 +582,9 @@ static const struct config_enum_entry wal_compression_options[] = {
 	{"pglz", WAL_COMPRESSION_PGLZ, false},
 #ifdef USE_LZ4
 	{"lz4", WAL_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", WAL_COMPRESSION_ZSTD, false},
 #endif
 	{"on", WAL_COMPRESSION_PGLZ, false},
 	{"off", WAL_COMPRESSION_NONE, false},
@@ -617,8 +657,6 @@ char	   *HbaFileName;
 char	   *IdentFileName;
 char	   *external_pid_file;
 
-char	   *pgstat_temp_directory;
-
 char	   *application_name;
 
 int			tcp_keepalives_idle;
@@ -640,6 +678,7 @@ int			ssl_renegotiation_limit;
  */
 int			huge_pages;
 int			huge_page_size;
+bool		shared_memory_numa_interleave;
 
 /*
  * These variables are all dummies that don't do anything, except in some
@@ -660,6 +699,7 @@ static char *log_timezone_string;
 static char *timezone_abbreviations_string;
 static char *data_directory;
 static char *session_authorization_string;
+static char *protocol_compression_string;
 static int	max_function_args;
 static int	max_index_keys;
 static int	max_identifier_length;
@@ -761,6 +801,8 @@ const char *const config_group_names[] =
 	gettext_noop("Write-Ahead Log / Checkpoints"),
 	/* WAL_ARCHIVING */
 	gettext_noop("Write-Ahead Log / Archiving"),
+	/* WAL_RECOVERY */
+	gettext_noop("Write-Ahead Log / Recovery"),
 	/* WAL_ARCHIVE_RECOVERY */
 	gettext_noop("Write-Ahead Log / Archive Recovery"),
 	/* WAL_RECOVERY_TARGET */
@@ -1100,6 +1142,26 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_hashjoin_bloom_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the use of Bloom filters by hash joins."),
+			gettext_noop("A hash join with a large inner relation builds a Bloom "
+						 "filter over it, to discard outer tuples that cannot match.")
+		},
+		&enable_hashjoin_bloom_filter,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_eager_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation of a relation below a join."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_eager_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -1130,6 +1192,27 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_partitionwise_window", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partitionwise computation of window functions."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_partitionwise_window,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_redistribute", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of redistribute plans."),
+			gettext_noop("These repartition rows between parallel workers, so that "
+						 "window functions can be computed below a Gather."),
+			GUC_EXPLAIN
+		},
+		&enable_redistribute,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -1150,6 +1233,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_memoize", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel memoize plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_memoize,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -1183,6 +1276,17 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"geqo_greedy", PGC_USERSET, QUERY_TUNING_GEQO,
+			gettext_noop("Uses a deterministic greedy join search in place of the genetic algorithm."),
+			gettext_noop("Large join problems are then planned by repeatedly "
+						 "performing the connected join with the smallest result."),
+			GUC_EXPLAIN
+		},
+		&geqo_greedy,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		/* Not for general use --- used by SET SESSION AUTHORIZATION */
 		{"is_superuser", PGC_INTERNAL, UNGROUPED,
@@ -1299,6 +1403,16 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"csn_snapshots", PGC_POSTMASTER, DEVELOPER_OPTIONS,
+			gettext_noop("Uses commit sequence numbers to take MVCC snapshots."),
+			gettext_noop("This is an experimental feature."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&csn_snapshots,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"full_page_writes", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Writes full pages to WAL when first modified after a checkpoint."),
@@ -1333,6 +1447,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"adaptive_commit_delay", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Chooses the delay before flushing WAL from observed commit and flush rates."),
+			gettext_noop("commit_delay, if set, is the longest delay used.")
+		},
+		&AdaptiveCommitDelay,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_recycle", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Recycles WAL files by renaming them."),
@@ -1555,6 +1679,15 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"track_wait_timing", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects timing statistics for wait events."),
+			NULL
+		},
+		&track_wait_timing,
+		false,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"update_process_title", PGC_SUSET, PROCESS_TITLE,
@@ -1734,6 +1867,24 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"write_hint_bits", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Marks pages dirty when setting hint bits on them."),
+			gettext_noop("When off, hint bits are only written out if the page is modified anyway.")
+		},
+		&write_hint_bits,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"insert_page_affinity", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Makes concurrent inserts into a table fill different pages."),
+			NULL
+		},
+		&insert_page_affinity,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"check_function_bodies", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Check routine bodies during CREATE FUNCTION and CREATE PROCEDURE."),
@@ -2034,6 +2185,17 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"modify_table_tid_order", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sorts the rows to be updated or deleted by their physical location."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&modify_table_tid_order,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit_debugging_support", PGC_SU_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Register JIT-compiled functions with debugger."),
@@ -2101,6 +2263,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_memory_numa_interleave", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Interleaves the main shared memory area across NUMA nodes."),
+			NULL
+		},
+		&shared_memory_numa_interleave,
+		false,
+		check_shared_memory_numa_interleave, NULL, NULL
+	},
+
 	{
 		{"data_sync_retry", PGC_POSTMASTER, ERROR_HANDLING_OPTIONS,
 			gettext_noop("Whether to continue running after a failure to sync data files."),
@@ -2139,6 +2311,15 @@ static struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX / 2,
 		NULL, NULL, NULL
 	},
+	{
+		{"archive_parallelism", PGC_SIGHUP, WAL_ARCHIVING,
+			gettext_noop("Sets the maximum number of archive commands run at the same time."),
+			NULL
+		},
+		&archive_parallelism,
+		1, 1, MAX_ARCHIVE_PARALLELISM,
+		NULL, NULL, NULL
+	},
 	{
 		{"post_auth_delay", PGC_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Waits N seconds on connection startup after authentication."),
@@ -2172,6 +2353,27 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"executor_batch_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of tuples a plan node returns per batch."),
+			gettext_noop("Zero or one disables batch-at-a-time execution."),
+			GUC_EXPLAIN
+		},
+		&executor_batch_size,
+		0, 0, 8192,
+		NULL, NULL, NULL
+	},
+	{
+		{"simple_query_cache_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of simple-protocol statements whose plans are cached."),
+			gettext_noop("A statement sent with the simple query protocol is cached "
+						 "the second time the same query string is seen.  Zero disables the cache."),
+			0
+		},
+		&simple_query_cache_size,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
 	{
 		{"join_collapse_limit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Sets the FROM-list size beyond which JOIN "
@@ -2340,6 +2542,61 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"subtransaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the subtransaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&subtransaction_buffers,
+		32, 8, SLRU_MAX_ALLOWED_BUFFERS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact offset cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_offset_buffers,
+		8, 8, SLRU_MAX_ALLOWED_BUFFERS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact member cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_member_buffers,
+		16, 8, SLRU_MAX_ALLOWED_BUFFERS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"notify_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the LISTEN/NOTIFY message cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&notify_buffers,
+		8, 8, SLRU_MAX_ALLOWED_BUFFERS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"commit_timestamp_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the commit timestamp cache."),
+			gettext_noop("0 means a size based on shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&commit_timestamp_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"shared_memory_size", PGC_INTERNAL, PRESET_OPTIONS,
 			gettext_noop("Shows the size of the server's main shared memory area (rounded up to the nearest MB)."),
@@ -2383,6 +2640,46 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"connection_proxies", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of connection proxy processes."),
+			gettext_noop("Zero disables the built-in connection pooler.")
+		},
+		&ConnectionProxies,
+		0, 0, MAX_CONNECTION_PROXIES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"proxy_port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the TCP port the connection proxies accept connections on."),
+			NULL
+		},
+		&ProxyPortNumber,
+		6543, 1, 65535,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends per connection pool of each connection proxy."),
+			NULL
+		},
+		&SessionPoolSize,
+		10, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_sessions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of client connections per connection proxy."),
+			NULL
+		},
+		&MaxSessions,
+		1000, 1, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"unix_socket_permissions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the access permissions of the Unix-domain socket."),
@@ -2451,6 +2748,19 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"backend_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the memory use above which a backend makes queries spill to disk early."),
+			gettext_noop("Sorts, hash joins and hash aggregates give up memory "
+						 "early while the backend's memory contexts hold more "
+						 "than this.  0 disables the limit."),
+			GUC_UNIT_KB
+		},
+		&backend_memory_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used for logical decoding."),
@@ -2463,6 +2773,96 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"catalog_cache_prune_min_age", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the minimum unused duration of cache entries before removal."),
+			gettext_noop("Catalog cache entries that are not used for this long "
+						 "may be removed to make room for new ones. "
+						 "-1 disables removal."),
+			GUC_UNIT_S
+		},
+		&catalog_cache_prune_min_age,
+		300, -1, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"catalog_cache_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for catalog cache entries."),
+			gettext_noop("Unused catalog and relation cache entries are evicted "
+						 "at the start of a statement once this is exceeded. "
+						 "0 disables the limit."),
+			GUC_UNIT_KB
+		},
+		&catalog_cache_memory_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catalog_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share catalog cache entries between backends."),
+			gettext_noop("0 disables the shared catalog cache."),
+			GUC_UNIT_KB
+		},
+		&shared_catalog_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans of prepared statements between sessions."),
+			gettext_noop("0 disables the shared plan cache."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_result_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share results of expensive immutable functions between sessions."),
+			gettext_noop("0 disables the shared result cache."),
+			GUC_UNIT_KB
+		},
+		&shared_result_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_sequence_cache_slots", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of sequences that can hand out values from shared memory."),
+			gettext_noop("0 disables the shared sequence cache.")
+		},
+		&shared_sequence_cache_slots,
+		0, 0, 65536,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_relsize_cache_entries", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relation fork sizes cached in shared memory."),
+			gettext_noop("0 disables the shared relation size cache.")
+		},
+		&shared_relsize_cache_entries,
+		8192, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"sinval_queue_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared cache invalidation messages that can be queued."),
+			gettext_noop("Processes that fall further behind have to reset all their caches. "
+						 "Must be a power of 2.")
+		},
+		&sinval_queue_size,
+		4096, 1024, SINVAL_QUEUE_SIZE_MAX,
+		check_sinval_queue_size, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -2852,6 +3252,50 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"double_write_buffer_size", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of data pages that the double-write buffer file holds."),
+			gettext_noop("Pages are copied to the double-write buffer before being written "
+						 "in place, so that pages torn by a crash can be repaired. "
+						 "0 disables the double-write buffer."),
+			GUC_UNIT_BLOCKS
+		},
+		&double_write_buffer_size,
+		0, 0, INT_MAX / 2,
+		check_double_write_buffer_size, NULL, NULL
+	},
+
+	{
+		{"max_parallel_redo_workers", PGC_POSTMASTER, WAL_RECOVERY,
+			gettext_noop("Sets the maximum number of parallel processes used to replay WAL."),
+			NULL
+		},
+		&max_parallel_redo_workers,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"recovery_prefetch_distance", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Sets how far ahead of replay to look for blocks to prefetch."),
+			NULL,
+			GUC_UNIT_BYTE
+		},
+		&recovery_prefetch_distance,
+		512 * 1024, 0, MaxAllocSize,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks for concurrent WAL insertion."),
+			gettext_noop("-1 means choose a value based on max_connections.")
+		},
+		&wal_insert_locks,
+		-1, -1, 1024,
+		check_wal_insert_locks, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -3140,6 +3584,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_sync_connections_per_table",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of publisher connections used to copy the initial data of a table."),
+			NULL,
+		},
+		&max_sync_connections_per_table,
+		1, 1, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -3358,6 +3814,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_worker_idle_timeout", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets how long a finished parallel worker waits to be reused by its leader."),
+			gettext_noop("A value of 0 makes parallel workers exit as soon as they finish."),
+			GUC_UNIT_MS
+		},
+		&parallel_worker_idle_timeout,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"autovacuum_work_mem", PGC_SIGHUP, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used by each autovacuum worker process."),
@@ -3493,6 +3960,29 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"backend_profile_interval", PGC_SUSET, STATS_MONITORING,
+			gettext_noop("Sets the CPU time between samples taken by the backend profiler."),
+			gettext_noop("Zero turns off the profiler."),
+			GUC_UNIT_MS
+		},
+		&backend_profile_interval,
+		0, 0, 60000,
+		check_backend_profile_interval, assign_backend_profile_interval, NULL
+	},
+
+	{
+		{"explain_timing_sample_interval", PGC_USERSET, STATS_MONITORING,
+			gettext_noop("Sets how often EXPLAIN ANALYZE times plan node executions."),
+			gettext_noop("Only every Nth execution of each plan node is timed, "
+						 "and the reported times are extrapolated from those. "
+						 "1 times every execution.")
+		},
+		&explain_timing_sample_interval,
+		1, 1, 1000000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"track_activity_query_size", PGC_POSTMASTER, STATS_COLLECTOR,
 			gettext_noop("Sets the size reserved for pg_stat_activity.query, in bytes."),
@@ -3715,6 +4205,16 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_result_cache_min_cost", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the minimum declared cost of immutable functions whose results are shared between sessions."),
+			gettext_noop("Only has an effect if shared_result_cache_size is set.")
+		},
+		&shared_result_cache_min_cost,
+		1000.0, 0.0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -3780,6 +4280,17 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"vacuum_cost_target_read_latency", PGC_USERSET, RESOURCES_VACUUM_DELAY,
+			gettext_noop("Average read latency in milliseconds that cost-based vacuum delay adapts to."),
+			gettext_noop("0 disables adapting the delay. Requires track_io_timing."),
+			GUC_UNIT_MS
+		},
+		&VacuumCostTargetReadLatency,
+		0, 0, 1000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"autovacuum_vacuum_cost_delay", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Vacuum cost delay in milliseconds, for autovacuum."),
@@ -3871,6 +4382,16 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, show_archive_command
 	},
 
+	{
+		{"archive_library", PGC_SIGHUP, WAL_ARCHIVING,
+			gettext_noop("Sets the library that will be called to archive a WAL file."),
+			gettext_noop("An empty string indicates that \"archive_command\" should be used.")
+		},
+		&XLogArchiveLibrary,
+		"",
+		NULL, NULL, NULL
+	},
+
 	{
 		{"restore_command", PGC_SIGHUP, WAL_ARCHIVE_RECOVERY,
 			gettext_noop("Sets the shell command that will be called to retrieve an archived WAL file."),
@@ -4342,6 +4863,17 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"protocol_compression", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the protocol compression methods clients may use."),
+			gettext_noop("An empty string disables protocol compression."),
+			GUC_LIST_INPUT
+		},
+		&protocol_compression_string,
+		"",
+		check_protocol_compression, assign_protocol_compression, NULL
+	},
+
 	{
 		{"unix_socket_directories", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the directories where Unix-domain sockets will be created."),
@@ -4492,17 +5024,6 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"stats_temp_directory", PGC_SIGHUP, STATS_COLLECTOR,
-			gettext_noop("Writes temporary statistics files to the specified directory."),
-			NULL,
-			GUC_SUPERUSER_ONLY
-		},
-		&pgstat_temp_directory,
-		PG_STAT_TMP_DIR,
-		check_canonical_path, assign_pgstat_temp_directory, NULL
-	},
-
 	{
 		{"synchronous_standby_names", PGC_SIGHUP, REPLICATION_PRIMARY,
 			gettext_noop("Number of synchronous standbys and list of names of potential synchronous ones."),
@@ -4631,6 +5152,19 @@ static struct config_string ConfigureNamesString[] =
 		check_backtrace_functions, assign_backtrace_functions, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_DISK,
+			gettext_noop("Bypasses the kernel page cache for the listed kinds of files."),
+			gettext_noop("A comma-separated list of \"data\" (relation files) "
+						 "and \"wal\" (WAL segments).  An empty string "
+						 "means all I/O is buffered by the kernel."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, NULL, NULL, NULL, NULL
@@ -4998,6 +5532,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Prefetch blocks referenced in the WAL during recovery."),
+			gettext_noop("Look ahead in the WAL to find blocks that are not yet in the buffer pool.")
+		},
+		&recovery_prefetch,
+		RECOVERY_PREFETCH_TRY, recovery_prefetch_options,
+		check_recovery_prefetch, NULL, NULL
+	},
+
 	{
 		{"recovery_init_sync_method", PGC_SIGHUP, ERROR_HANDLING_OPTIONS,
 			gettext_noop("Sets the method for synchronizing the data directory before crash recovery."),
@@ -5047,6 +5591,8 @@ static bool reporting_enabled;	/* true to enable GUC_REPORT */
 
 static bool report_needed;		/* true if any GUC_REPORT reports are needed */
 
+uint64		guc_change_count = 0;
+
 static int	GUCNestLevel = 0;	/* 1 when in main transaction */
 
 
@@ -6129,6 +6675,8 @@ ResetAllOptions(void)
 			report_needed = true;
 		}
 	}
+
+	guc_change_count++;
 }
 
 
@@ -6518,6 +7066,8 @@ AtEOXact_GUC(bool isCommit, int nestLevel)
 				gconf->status |= GUC_NEEDS_REPORT;
 				report_needed = true;
 			}
+			if (changed)
+				guc_change_count++;
 		}						/* end of stack-popping loop */
 
 		if (stack != NULL)
@@ -7565,6 +8115,15 @@ set_config_option(const char *name, const char *value,
 		changeVal = false;
 	}
 
+	/*
+	 * A session-level setting stays with this backend, so a pooled session
+	 * making one can't be moved to another backend anymore.  The transaction
+	 * characteristics only look like session-level settings.
+	 */
+	if (changeVal && action == GUC_ACTION_SET && source == PGC_S_SESSION &&
+		strncmp(record->name, "transaction_", 12) != 0)
+		PinPooledSession("SET");
+
 	/*
 	 * Evaluate value and set variable.
 	 */
@@ -8077,6 +8636,8 @@ set_config_option(const char *name, const char *value,
 		record->status |= GUC_NEEDS_REPORT;
 		report_needed = true;
 	}
+	if (changeVal)
+		guc_change_count++;
 
 	return changeVal ? 1 : -1;
 }
@@ -11760,6 +12321,67 @@ assign_log_destination(const char *newval, void *extra)
 	Log_destination = *((int *) extra);
 }
 
+static bool
+check_protocol_compression(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			methods = 0;
+	int		   *myextra;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *tok = (char *) lfirst(l);
+		ZpqAlgorithm algorithm;
+
+		if (!zpq_parse_algorithm(tok, &algorithm))
+		{
+			GUC_check_errdetail("Unrecognized compression method: \"%s\".", tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+		if (!zpq_algorithm_supported(algorithm))
+		{
+			GUC_check_errdetail("Compression method \"%s\" is not supported by this build.",
+								tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+		methods |= 1 << algorithm;
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	myextra = (int *) guc_malloc(ERROR, sizeof(int));
+	*myextra = methods;
+	*extra = (void *) myextra;
+
+	return true;
+}
+
+static void
+assign_protocol_compression(const char *newval, void *extra)
+{
+	protocol_compression_methods = *((int *) extra);
+}
+
 static void
 assign_syslog_facility(int newval, void *extra)
 {
@@ -12114,46 +12736,102 @@ check_huge_page_size(int *newval, void **extra, GucSource source)
 }
 
 static bool
-check_client_connection_check_interval(int *newval, void **extra, GucSource source)
+check_shared_memory_numa_interleave(bool *newval, void **extra, GucSource source)
 {
-#ifndef POLLRDHUP
-	/* Linux only, for now.  See pq_check_connection(). */
-	if (*newval != 0)
+#ifndef __linux__
+	/* Linux only, for now.  See InterleaveAnonymousSegment(). */
+	if (*newval)
 	{
-		GUC_check_errdetail("client_connection_check_interval must be set to 0 on platforms that lack POLLRDHUP.");
+		GUC_check_errdetail("shared_memory_numa_interleave is not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static bool
+check_io_direct(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			flags = 0;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *tok = (char *) lfirst(l);
+
+		if (pg_strcasecmp(tok, "data") == 0)
+			flags |= IO_DIRECT_DATA;
+		else if (pg_strcasecmp(tok, "wal") == 0)
+			flags |= IO_DIRECT_WAL;
+		else
+		{
+			GUC_check_errdetail("Unrecognized key word: \"%s\".", tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+#if PG_O_DIRECT == 0
+	if (flags != 0)
+	{
+		GUC_check_errdetail("io_direct is not supported on this platform.");
 		return false;
 	}
 #endif
+	if ((flags & IO_DIRECT_DATA) && BLCKSZ < PG_IO_ALIGN_SIZE)
+	{
+		GUC_check_errdetail("io_direct is not supported for data files because BLCKSZ is too small.");
+		return false;
+	}
+	if ((flags & IO_DIRECT_WAL) && XLOG_BLCKSZ < PG_IO_ALIGN_SIZE)
+	{
+		GUC_check_errdetail("io_direct is not supported for WAL because XLOG_BLCKSZ is too small.");
+		return false;
+	}
+
+	*extra = guc_malloc(ERROR, sizeof(int));
+	*((int *) *extra) = flags;
+
 	return true;
 }
 
 static void
-assign_pgstat_temp_directory(const char *newval, void *extra)
+assign_io_direct(const char *newval, void *extra)
 {
-	/* check_canonical_path already canonicalized newval for us */
-	char	   *dname;
-	char	   *tname;
-	char	   *fname;
+	io_direct_flags = *((int *) extra);
+}
 
-	/* directory */
-	dname = guc_malloc(ERROR, strlen(newval) + 1);	/* runtime dir */
-	sprintf(dname, "%s", newval);
-
-	/* global stats */
-	tname = guc_malloc(ERROR, strlen(newval) + 12); /* /global.tmp */
-	sprintf(tname, "%s/global.tmp", newval);
-	fname = guc_malloc(ERROR, strlen(newval) + 13); /* /global.stat */
-	sprintf(fname, "%s/global.stat", newval);
-
-	if (pgstat_stat_directory)
-		free(pgstat_stat_directory);
-	pgstat_stat_directory = dname;
-	if (pgstat_stat_tmpname)
-		free(pgstat_stat_tmpname);
-	pgstat_stat_tmpname = tname;
-	if (pgstat_stat_filename)
-		free(pgstat_stat_filename);
-	pgstat_stat_filename = fname;
+static bool
+check_client_connection_check_interval(int *newval, void **extra, GucSource source)
+{
+#ifndef POLLRDHUP
+	/* Linux only, for now.  See pq_check_connection(). */
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("client_connection_check_interval must be set to 0 on platforms that lack POLLRDHUP.");
+		return false;
+	}
+#endif
+	return true;
 }
 
 static bool
@@ -447,8 +447,8 @@ AllocSetContextCreateInternal(MemoryContext parent,
 								parent,
 								name);
 
-			((MemoryContext) set)->mem_allocated =
-				set->keeper->endptr - ((char *) set);
+			MemoryContextNoteAllocated((MemoryContext) set,
+									   set->keeper->endptr - ((char *) set));
 
 			return (MemoryContext) set;
 		}
@@ -538,7 +538,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 						parent,
 						name);
 
-	((MemoryContext) set)->mem_allocated = firstBlockSize;
+	MemoryContextNoteAllocated((MemoryContext) set, firstBlockSize);
 
 	return (MemoryContext) set;
 }
@@ -600,7 +600,7 @@ AllocSetReset(MemoryContext context)
 		else
 		{
 			/* Normal case, release the block */
-			context->mem_allocated -= block->endptr - ((char *) block);
+			MemoryContextNoteFreed(context, block->endptr - ((char *) block));
 
 #ifdef CLOBBER_FREED_MEMORY
 			wipe_mem(block, block->freeptr - ((char *) block));
@@ -628,8 +628,7 @@ AllocSetDelete(MemoryContext context)
 {
 	AllocSet	set = (AllocSet) context;
 	AllocBlock	block = set->blocks;
-	Size		keepersize PG_USED_FOR_ASSERTS_ONLY
-	= set->keeper->endptr - ((char *) set);
+	Size		keepersize = set->keeper->endptr - ((char *) set);
 
 	AssertArg(AllocSetIsValid(set));
 
@@ -653,6 +652,9 @@ AllocSetDelete(MemoryContext context)
 		if (!context->isReset)
 			MemoryContextResetOnly(context);
 
+		/* The keeper no longer counts as in use by this backend */
+		MemoryContextNoteFreed(context, keepersize);
+
 		/*
 		 * If the freelist is full, just discard what's already in it.  See
 		 * comments with context_freelists[].
@@ -686,7 +688,7 @@ AllocSetDelete(MemoryContext context)
 		AllocBlock	next = block->next;
 
 		if (block != set->keeper)
-			context->mem_allocated -= block->endptr - ((char *) block);
+			MemoryContextNoteFreed(context, block->endptr - ((char *) block));
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -699,6 +701,7 @@ AllocSetDelete(MemoryContext context)
 	}
 
 	Assert(context->mem_allocated == keepersize);
+	MemoryContextNoteFreed(context, keepersize);
 
 	/* Finally, free the context header, including the keeper block */
 	free(set);
@@ -741,7 +744,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 		if (block == NULL)
 			return NULL;
 
-		context->mem_allocated += blksize;
+		MemoryContextNoteAllocated(context, blksize);
 
 		block->aset = set;
 		block->freeptr = block->endptr = ((char *) block) + blksize;
@@ -934,7 +937,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 		if (block == NULL)
 			return NULL;
 
-		context->mem_allocated += blksize;
+		MemoryContextNoteAllocated(context, blksize);
 
 		block->aset = set;
 		block->freeptr = ((char *) block) + ALLOC_BLOCKHDRSZ;
@@ -1033,7 +1036,7 @@ AllocSetFree(MemoryContext context, void *pointer)
 		if (block->next)
 			block->next->prev = block->prev;
 
-		context->mem_allocated -= block->endptr - ((char *) block);
+		MemoryContextNoteFreed(context, block->endptr - ((char *) block));
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -1136,8 +1139,8 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 		}
 
 		/* updated separately, not to underflow when (oldblksize > blksize) */
-		context->mem_allocated -= oldblksize;
-		context->mem_allocated += blksize;
+		MemoryContextNoteFreed(context, oldblksize);
+		MemoryContextNoteAllocated(context, blksize);
 
 		block->freeptr = block->endptr = ((char *) block) + blksize;
 
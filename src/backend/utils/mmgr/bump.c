@@ -0,0 +1,765 @@
+/*-------------------------------------------------------------------------
+ *
+ * bump.c
+ *	  Bump allocator definitions.
+ *
+ * Bump is a MemoryContext implementation designed for memory that is only
+ * ever released all at once, by resetting or deleting the context.
+ *
+ * Portions Copyright (c) 2017-2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/bump.c
+ *
+ *
+ *	Allocation simply carves the requested space, rounded up to MAXALIGN,
+ *	off the end of the current block, so it is little more than a pointer
+ *	increment.  Unlike aset.c there is no power-of-2 rounding of chunk sizes
+ *	and no freelists, which for many small allocations of varying size (such
+ *	as tuples being collected for a sort) saves a good deal of space.
+ *
+ *	The price is that pfree() does not make any space available for reuse;
+ *	freed chunks stay allocated until the context is reset.  repalloc() to a
+ *	larger size likewise leaves the old copy behind.  So this is only a
+ *	good choice where chunks are practically never freed individually.
+ *
+ *	Each chunk still has a small header, since pfree() and
+ *	GetMemoryChunkSpace() must work on any palloc'd pointer.
+ *
+ *	Like aset.c, the context keeps its first block across resets to avoid
+ *	malloc thrashing, and subsequent blocks double in size up to
+ *	maxBlockSize.  Requests larger than a fraction of maxBlockSize get
+ *	dedicated blocks of their own.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "lib/ilist.h"
+#include "utils/memdebug.h"
+#include "utils/memutils.h"
+
+
+#define Bump_BLOCKHDRSZ		MAXALIGN(sizeof(BumpBlock))
+#define Bump_CHUNKHDRSZ		sizeof(BumpChunk)
+
+/* Requests larger than maxBlockSize / this get a dedicated block */
+#define Bump_CHUNK_FRACTION	8
+
+typedef struct BumpBlock BumpBlock; /* forward reference */
+typedef struct BumpChunk BumpChunk;
+
+typedef void *BumpPointer;
+
+/*
+ * BumpContext is a memory context that never reuses freed space.
+ */
+typedef struct BumpContext
+{
+	MemoryContextData header;	/* Standard memory-context fields */
+
+	/* Bump context parameters */
+	Size		initBlockSize;	/* initial block size */
+	Size		maxBlockSize;	/* maximum block size */
+	Size		nextBlockSize;	/* next block size to allocate */
+	Size		allocChunkLimit;	/* larger requests get dedicated blocks */
+
+	BumpBlock  *keeper;			/* keep this block over resets */
+	dlist_head	blocks;			/* list of blocks, current one first */
+} BumpContext;
+
+/*
+ * BumpBlock
+ *		BumpBlock is the unit of memory that is obtained by bump.c from
+ *		malloc().  It contains one or more BumpChunks, which are the units
+ *		requested by palloc().
+ *
+ *		BumpBlock is the header data for a block --- the usable space
+ *		within the block begins at the next alignment boundary.
+ */
+struct BumpBlock
+{
+	dlist_node	node;			/* doubly-linked list of blocks */
+	Size		blksize;		/* allocated size of this block */
+	char	   *freeptr;		/* start of free space in this block */
+	char	   *endptr;			/* end of space in this block */
+};
+
+/*
+ * BumpChunk
+ *		The prefix of each piece of memory in a BumpBlock
+ *
+ * Note: to meet the memory context APIs, the payload area of the chunk must
+ * be maxaligned, and the "context" link must be immediately adjacent to the
+ * payload area (cf. GetMemoryChunkContext).  As in generation.c, we require
+ * sizeof(BumpChunk) to be maxaligned and add any required padding before
+ * the context pointer.
+ */
+struct BumpChunk
+{
+	/* size is always the size of the usable space in the chunk */
+	Size		size;
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* when debugging memory usage, also store actual requested size */
+	Size		requested_size;
+
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_SIZE_T * 2 + SIZEOF_VOID_P)
+#else
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_SIZE_T + SIZEOF_VOID_P)
+#endif							/* MEMORY_CONTEXT_CHECKING */
+
+	/* ensure proper alignment by adding padding if needed */
+#if (BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF) != 0
+	char		padding[MAXIMUM_ALIGNOF - BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF];
+#endif
+
+	BumpContext *context;		/* owning context */
+	/* there must not be any padding to reach a MAXALIGN boundary here! */
+};
+
+/*
+ * Only the "context" field should be accessed outside this module.
+ * We keep the rest of an allocated chunk's header marked NOACCESS when using
+ * valgrind.
+ */
+#define BUMPCHUNK_PRIVATE_LEN	offsetof(BumpChunk, context)
+
+/*
+ * BumpIsValid
+ *		True iff set is valid bump context.
+ */
+#define BumpIsValid(set) PointerIsValid(set)
+
+#define BumpPointerGetChunk(ptr) \
+	((BumpChunk *)(((char *)(ptr)) - Bump_CHUNKHDRSZ))
+#define BumpChunkGetPointer(chk) \
+	((BumpPointer *)(((char *)(chk)) + Bump_CHUNKHDRSZ))
+
+/*
+ * These functions implement the MemoryContext API for Bump contexts.
+ */
+static void *BumpAlloc(MemoryContext context, Size size);
+static void BumpFree(MemoryContext context, void *pointer);
+static void *BumpRealloc(MemoryContext context, void *pointer, Size size);
+static void BumpReset(MemoryContext context);
+static void BumpDelete(MemoryContext context);
+static Size BumpGetChunkSpace(MemoryContext context, void *pointer);
+static bool BumpIsEmpty(MemoryContext context);
+static void BumpStats(MemoryContext context,
+					  MemoryStatsPrintFunc printfunc, void *passthru,
+					  MemoryContextCounters *totals,
+					  bool print_to_stderr);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+static void BumpCheck(MemoryContext context);
+#endif
+
+/*
+ * This is the virtual function table for Bump contexts.
+ */
+static const MemoryContextMethods BumpMethods = {
+	BumpAlloc,
+	BumpFree,
+	BumpRealloc,
+	BumpReset,
+	BumpDelete,
+	BumpGetChunkSpace,
+	BumpIsEmpty,
+	BumpStats
+#ifdef MEMORY_CONTEXT_CHECKING
+	,BumpCheck
+#endif
+};
+
+
+/*
+ * Public routines
+ */
+
+
+/*
+ * BumpContextCreate
+ *		Create a new Bump context.
+ *
+ * parent: parent context, or NULL if top-level context
+ * name: name of context (must be statically allocated)
+ * minContextSize: ignored, present so the ALLOCSET_*_SIZES macros can be used
+ * initBlockSize: initial allocation block size, also kept over resets
+ * maxBlockSize: maximum allocation block size
+ */
+MemoryContext
+BumpContextCreate(MemoryContext parent,
+				  const char *name,
+				  Size minContextSize,
+				  Size initBlockSize,
+				  Size maxBlockSize)
+{
+	Size		firstBlockSize;
+	BumpContext *set;
+	BumpBlock  *block;
+
+	/* Assert we padded BumpChunk properly */
+	StaticAssertStmt(Bump_CHUNKHDRSZ == MAXALIGN(Bump_CHUNKHDRSZ),
+					 "sizeof(BumpChunk) is not maxaligned");
+	StaticAssertStmt(offsetof(BumpChunk, context) + sizeof(MemoryContext) ==
+					 Bump_CHUNKHDRSZ,
+					 "padding calculation in BumpChunk is wrong");
+
+	/*
+	 * First, validate allocation parameters.  We enforce the same limits as
+	 * AllocSetContextCreate.
+	 */
+	Assert(initBlockSize == MAXALIGN(initBlockSize) &&
+		   initBlockSize >= 1024);
+	Assert(maxBlockSize == MAXALIGN(maxBlockSize) &&
+		   maxBlockSize >= initBlockSize &&
+		   AllocHugeSizeIsValid(maxBlockSize)); /* must be safe to double */
+
+	/*
+	 * Allocate the initial block along with the context header, as aset.c
+	 * does; it is never freed before the context is deleted.
+	 */
+	firstBlockSize = MAXALIGN(sizeof(BumpContext)) + initBlockSize;
+
+	set = (BumpContext *) malloc(firstBlockSize);
+	if (set == NULL)
+	{
+		if (TopMemoryContext)
+			MemoryContextStats(TopMemoryContext);
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while creating memory context \"%s\".",
+						   name)));
+	}
+
+	/*
+	 * Avoid writing code that can fail between here and MemoryContextCreate;
+	 * we'd leak the header/initial block if we ereport in this stretch.
+	 */
+	dlist_init(&set->blocks);
+
+	/* Fill in the initial block's block header */
+	block = (BumpBlock *) (((char *) set) + MAXALIGN(sizeof(BumpContext)));
+	block->blksize = initBlockSize;
+	block->freeptr = ((char *) block) + Bump_BLOCKHDRSZ;
+	block->endptr = ((char *) block) + initBlockSize;
+	dlist_push_head(&set->blocks, &block->node);
+
+	/* Mark unallocated space NOACCESS; leave the block header alone. */
+	VALGRIND_MAKE_MEM_NOACCESS(block->freeptr, block->endptr - block->freeptr);
+
+	set->keeper = block;
+
+	/* Fill in BumpContext-specific header fields */
+	set->initBlockSize = initBlockSize;
+	set->maxBlockSize = maxBlockSize;
+	set->nextBlockSize = initBlockSize;
+	set->allocChunkLimit = maxBlockSize / Bump_CHUNK_FRACTION;
+
+	/* Finally, do the type-independent part of context creation */
+	MemoryContextCreate((MemoryContext) set,
+						T_BumpContext,
+						&BumpMethods,
+						parent,
+						name);
+
+	MemoryContextNoteAllocated((MemoryContext) set, firstBlockSize);
+
+	return (MemoryContext) set;
+}
+
+/*
+ * BumpReset
+ *		Frees all memory which is allocated in the given set.
+ *
+ * All blocks except the keeper block are returned to malloc(), and the
+ * keeper block is emptied.
+ */
+static void
+BumpReset(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	dlist_mutable_iter miter;
+
+	AssertArg(BumpIsValid(set));
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Check for corruption and leaks before freeing */
+	BumpCheck(context);
+#endif
+
+	dlist_foreach_modify(miter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, miter.cur);
+
+		if (block == set->keeper)
+		{
+			/* Reset the block, but don't return it to malloc */
+			char	   *datastart = ((char *) block) + Bump_BLOCKHDRSZ;
+
+#ifdef CLOBBER_FREED_MEMORY
+			wipe_mem(datastart, block->freeptr - datastart);
+#else
+			/* wipe_mem() would have done this */
+			VALGRIND_MAKE_MEM_NOACCESS(datastart, block->freeptr - datastart);
+#endif
+			block->freeptr = datastart;
+		}
+		else
+		{
+			/* Normal case, release the block */
+			dlist_delete(miter.cur);
+
+			MemoryContextNoteFreed(context, block->blksize);
+
+#ifdef CLOBBER_FREED_MEMORY
+			wipe_mem(block, block->blksize);
+#endif
+
+			free(block);
+		}
+	}
+
+	/* Reset block size allocation sequence, too */
+	set->nextBlockSize = set->initBlockSize;
+
+	Assert(dlist_head_element(BumpBlock, node, &set->blocks) == set->keeper);
+	Assert(dlist_has_next(&set->blocks, &set->keeper->node) == false);
+}
+
+/*
+ * BumpDelete
+ *		Free all memory which is allocated in the given context.
+ */
+static void
+BumpDelete(MemoryContext context)
+{
+	/* Reset to release all the BumpBlocks but the keeper */
+	BumpReset(context);
+	/* And free the context header and keeper block */
+	MemoryContextNoteFreed(context, context->mem_allocated);
+	free(context);
+}
+
+/*
+ * BumpAlloc
+ *		Returns pointer to allocated memory of given size or NULL if
+ *		request could not be completed; memory is added to the set.
+ *
+ * No request may exceed:
+ *		MAXALIGN_DOWN(SIZE_MAX) - Bump_BLOCKHDRSZ - Bump_CHUNKHDRSZ
+ * All callers use a much-lower limit.
+ *
+ * Note: when using valgrind, it doesn't matter how the returned allocation
+ * is marked, as mcxt.c will set it to UNDEFINED.
+ */
+static void *
+BumpAlloc(MemoryContext context, Size size)
+{
+	BumpContext *set = (BumpContext *) context;
+	BumpBlock  *block;
+	BumpChunk  *chunk;
+	Size		chunk_size = MAXALIGN(size);
+	Size		required_size = chunk_size + Bump_CHUNKHDRSZ;
+
+	/* is it an over-sized chunk? if yes, allocate special block */
+	if (chunk_size > set->allocChunkLimit)
+	{
+		Size		blksize = required_size + Bump_BLOCKHDRSZ;
+
+		block = (BumpBlock *) malloc(blksize);
+		if (block == NULL)
+			return NULL;
+
+		MemoryContextNoteAllocated(context, blksize);
+
+		/* the block is completely full */
+		block->blksize = blksize;
+		block->freeptr = block->endptr = ((char *) block) + blksize;
+
+		chunk = (BumpChunk *) (((char *) block) + Bump_BLOCKHDRSZ);
+
+		/*
+		 * Add the block at the tail of the list, so the current block stays
+		 * at the head.
+		 */
+		dlist_push_tail(&set->blocks, &block->node);
+	}
+	else
+	{
+		/*
+		 * Not an over-sized chunk.  Is there enough space in the current
+		 * block?  If not, allocate a new, bigger one.  Whatever space is left
+		 * in the old block is simply wasted; since it is less than the
+		 * chunk size limit, and blocks grow, that is never very much.
+		 */
+		block = dlist_head_element(BumpBlock, node, &set->blocks);
+
+		if ((Size) (block->endptr - block->freeptr) < required_size)
+		{
+			Size		blksize = set->nextBlockSize;
+
+			/* double the block size for next time, up to the limit */
+			set->nextBlockSize <<= 1;
+			if (set->nextBlockSize > set->maxBlockSize)
+				set->nextBlockSize = set->maxBlockSize;
+
+			/*
+			 * If initBlockSize is less than the chunk size limit, the block
+			 * may need to be bigger than the sequence says.
+			 */
+			while (blksize < required_size + Bump_BLOCKHDRSZ)
+				blksize <<= 1;
+
+			block = (BumpBlock *) malloc(blksize);
+			if (block == NULL)
+				return NULL;
+
+			MemoryContextNoteAllocated(context, blksize);
+
+			block->blksize = blksize;
+			block->freeptr = ((char *) block) + Bump_BLOCKHDRSZ;
+			block->endptr = ((char *) block) + blksize;
+
+			/* Mark unallocated space NOACCESS. */
+			VALGRIND_MAKE_MEM_NOACCESS(block->freeptr,
+									   blksize - Bump_BLOCKHDRSZ);
+
+			/* make it the current block */
+			dlist_push_head(&set->blocks, &block->node);
+		}
+
+		Assert((Size) (block->endptr - block->freeptr) >= required_size);
+
+		chunk = (BumpChunk *) block->freeptr;
+
+		/* Prepare to initialize the chunk header. */
+		VALGRIND_MAKE_MEM_UNDEFINED(chunk, Bump_CHUNKHDRSZ);
+
+		block->freeptr += required_size;
+		Assert(block->freeptr <= block->endptr);
+	}
+
+	chunk->context = set;
+	chunk->size = chunk_size;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	chunk->requested_size = size;
+	/* set mark to catch clobber of "unused" space */
+	if (size < chunk_size)
+		set_sentinel(BumpChunkGetPointer(chunk), size);
+#endif
+#ifdef RANDOMIZE_ALLOCATED_MEMORY
+	/* fill the allocated space with junk */
+	randomize_mem((char *) BumpChunkGetPointer(chunk), size);
+#endif
+
+	/* Ensure any padding bytes are marked NOACCESS. */
+	VALGRIND_MAKE_MEM_NOACCESS((char *) BumpChunkGetPointer(chunk) + size,
+							   chunk_size - size);
+
+	/* Disallow external access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+	return BumpChunkGetPointer(chunk);
+}
+
+/*
+ * BumpFree
+ *		Freed space is not reused, so there is nothing to do apart from
+ *		debugging checks; the memory goes away when the context is reset.
+ */
+static void
+BumpFree(MemoryContext context, void *pointer)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+
+	/* Allow access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Test for someone scribbling on unused space in chunk */
+	if (chunk->requested_size < chunk->size)
+		if (!sentinel_ok(pointer, chunk->requested_size))
+			elog(WARNING, "detected write past chunk end in %s %p",
+				 context->name, chunk);
+#endif
+
+#ifdef CLOBBER_FREED_MEMORY
+	wipe_mem(pointer, chunk->size);
+#endif
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* The sentinel is gone now, so don't check it again */
+	chunk->requested_size = chunk->size;
+#endif
+
+	/* Disallow external access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+}
+
+/*
+ * BumpRealloc
+ *		When handling repalloc, we simply allocate a new chunk and copy the
+ *		data, leaving the old one in place.  The only exception is when the
+ *		new size fits into the old chunk - in that case we just update the
+ *		chunk header.
+ */
+static void *
+BumpRealloc(MemoryContext context, void *pointer, Size size)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+	BumpPointer newPointer;
+	Size		oldsize;
+
+	/* Allow access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+	oldsize = chunk->size;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Test for someone scribbling on unused space in chunk */
+	if (chunk->requested_size < oldsize)
+		if (!sentinel_ok(pointer, chunk->requested_size))
+			elog(WARNING, "detected write past chunk end in %s %p",
+				 context->name, chunk);
+#endif
+
+	/* Maybe the allocated area already is >= the new size. */
+	if (oldsize >= size)
+	{
+#ifdef MEMORY_CONTEXT_CHECKING
+		Size		oldrequest = chunk->requested_size;
+
+#ifdef RANDOMIZE_ALLOCATED_MEMORY
+		/* We can only fill the extra space if we know the prior request */
+		if (size > oldrequest)
+			randomize_mem((char *) pointer + oldrequest,
+						  size - oldrequest);
+#endif
+
+		chunk->requested_size = size;
+
+		/*
+		 * If this is an increase, mark any newly-available part UNDEFINED.
+		 * Otherwise, mark the obsolete part NOACCESS.
+		 */
+		if (size > oldrequest)
+			VALGRIND_MAKE_MEM_UNDEFINED((char *) pointer + oldrequest,
+										size - oldrequest);
+		else
+			VALGRIND_MAKE_MEM_NOACCESS((char *) pointer + size,
+									   oldsize - size);
+
+		/* set mark to catch clobber of "unused" space */
+		if (size < oldsize)
+			set_sentinel(pointer, size);
+#else							/* !MEMORY_CONTEXT_CHECKING */
+
+		/*
+		 * We don't have the information to determine whether we're growing
+		 * the old request or shrinking it, so we conservatively mark the
+		 * entire new allocation DEFINED.
+		 */
+		VALGRIND_MAKE_MEM_NOACCESS(pointer, oldsize);
+		VALGRIND_MAKE_MEM_DEFINED(pointer, size);
+#endif
+
+		/* Disallow external access to private part of chunk header. */
+		VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+		return pointer;
+	}
+
+	/* allocate new chunk */
+	newPointer = BumpAlloc(context, size);
+
+	/* leave immediately if request was not completed */
+	if (newPointer == NULL)
+	{
+		/* Disallow external access to private part of chunk header. */
+		VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+		return NULL;
+	}
+
+	/*
+	 * BumpAlloc() may have returned a region that is still NOACCESS.  Change
+	 * it to UNDEFINED for the moment; memcpy() will then transfer definedness
+	 * from the old allocation to the new.  If we know the old allocation,
+	 * copy just that much.  Otherwise, make the entire old chunk defined to
+	 * avoid errors as we copy the currently-NOACCESS trailing bytes.
+	 */
+	VALGRIND_MAKE_MEM_UNDEFINED(newPointer, size);
+#ifdef MEMORY_CONTEXT_CHECKING
+	oldsize = chunk->requested_size;
+#else
+	VALGRIND_MAKE_MEM_DEFINED(pointer, oldsize);
+#endif
+
+	/* transfer existing data (certain to fit) */
+	memcpy(newPointer, pointer, oldsize);
+
+	/* "free" the old chunk, which just runs the debugging checks */
+	BumpFree(context, pointer);
+
+	return newPointer;
+}
+
+/*
+ * BumpGetChunkSpace
+ *		Given a currently-allocated chunk, determine the total space
+ *		it occupies (including all memory-allocation overhead).
+ */
+static Size
+BumpGetChunkSpace(MemoryContext context, void *pointer)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+	Size		result;
+
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+	result = chunk->size + Bump_CHUNKHDRSZ;
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+	return result;
+}
+
+/*
+ * BumpIsEmpty
+ *		Is a BumpContext empty of any allocated space?
+ */
+static bool
+BumpIsEmpty(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	BumpBlock  *keeper = set->keeper;
+
+	return dlist_has_next(&set->blocks, &keeper->node) == false &&
+		dlist_head_element(BumpBlock, node, &set->blocks) == keeper &&
+		keeper->freeptr == ((char *) keeper) + Bump_BLOCKHDRSZ;
+}
+
+/*
+ * BumpStats
+ *		Compute stats about memory consumption of a Bump context.
+ *
+ * printfunc: if not NULL, pass a human-readable stats string to this.
+ * passthru: pass this pointer through to printfunc.
+ * totals: if not NULL, add stats about this context into *totals.
+ * print_to_stderr: print stats to stderr if true, elog otherwise.
+ *
+ * freespace only accounts for empty space at the end of each block; space
+ * of freed chunks is unknown, and counted as used.
+ */
+static void
+BumpStats(MemoryContext context,
+		  MemoryStatsPrintFunc printfunc, void *passthru,
+		  MemoryContextCounters *totals, bool print_to_stderr)
+{
+	BumpContext *set = (BumpContext *) context;
+	Size		nblocks = 0;
+	Size		totalspace;
+	Size		freespace = 0;
+	dlist_iter	iter;
+
+	/* Include context header in totalspace */
+	totalspace = MAXALIGN(sizeof(BumpContext));
+
+	dlist_foreach(iter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+
+		nblocks++;
+		totalspace += block->blksize;
+		freespace += (block->endptr - block->freeptr);
+	}
+
+	if (printfunc)
+	{
+		char		stats_string[200];
+
+		snprintf(stats_string, sizeof(stats_string),
+				 "%zu total in %zd blocks; %zu free; %zu used",
+				 totalspace, nblocks, freespace, totalspace - freespace);
+		printfunc(context, passthru, stats_string, print_to_stderr);
+	}
+
+	if (totals)
+	{
+		totals->nblocks += nblocks;
+		totals->totalspace += totalspace;
+		totals->freespace += freespace;
+	}
+}
+
+
+#ifdef MEMORY_CONTEXT_CHECKING
+
+/*
+ * BumpCheck
+ *		Walk through chunks and check consistency of memory.
+ *
+ * NOTE: report errors as WARNING, *not* ERROR or FATAL.  Otherwise you'll
+ * find yourself in an infinite loop when trouble occurs, because this
+ * routine will be entered again when elog cleanup tries to release memory!
+ */
+static void
+BumpCheck(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	const char *name = context->name;
+	dlist_iter	iter;
+	Size		total_allocated = 0;
+
+	/* walk all blocks in this context */
+	dlist_foreach(iter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+		char	   *ptr;
+
+		if (block == set->keeper)
+			total_allocated += block->blksize + MAXALIGN(sizeof(BumpContext));
+		else
+			total_allocated += block->blksize;
+
+		ptr = ((char *) block) + Bump_BLOCKHDRSZ;
+
+		while (ptr < block->freeptr)
+		{
+			BumpChunk  *chunk = (BumpChunk *) ptr;
+
+			/* Allow access to private part of chunk header. */
+			VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+			/* move to the next chunk */
+			ptr += (chunk->size + Bump_CHUNKHDRSZ);
+
+			if (chunk->context != set)
+				elog(WARNING, "problem in Bump %s: bogus context link in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* now make sure the chunk size is correct */
+			if (chunk->size < chunk->requested_size ||
+				chunk->size != MAXALIGN(chunk->size))
+				elog(WARNING, "problem in Bump %s: bogus chunk size in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* check sentinel */
+			if (chunk->requested_size < chunk->size &&
+				!sentinel_ok(chunk, Bump_CHUNKHDRSZ + chunk->requested_size))
+				elog(WARNING, "problem in Bump %s: detected write past chunk end in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* Disallow external access to private part of chunk header. */
+			VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+		}
+
+		if (ptr != block->freeptr)
+			elog(WARNING, "problem in Bump %s: chunks overrun free pointer in block %p",
+				 name, block);
+	}
+
+	Assert(total_allocated == context->mem_allocated);
+}
+
+#endif							/* MEMORY_CONTEXT_CHECKING */
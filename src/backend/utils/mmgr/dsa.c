@@ -956,6 +956,38 @@ dsa_get_address(dsa_area *area, dsa_pointer dp)
 	return area->segment_maps[index].mapped_address + offset;
 }
 
+/*
+ * Like dsa_get_address, but for callers that read memory without holding
+ * whatever keeps 'dp' from being freed, and check afterwards whether what
+ * they read was consistent.  Such a 'dp' may be stale or even garbage.  This
+ * never maps or unmaps segments, so memory that was mapped at the time 'dp'
+ * was valid stays readable, and raises no errors; instead, it returns NULL
+ * unless 'size' bytes at 'dp' lie within a segment mapped by this backend.
+ */
+void *
+dsa_get_address_if_mapped(dsa_area *area, dsa_pointer dp, size_t size)
+{
+	dsa_segment_index index;
+	size_t		offset;
+	dsa_segment_map *segment_map;
+
+	if (!DsaPointerIsValid(dp))
+		return NULL;
+
+	index = DSA_EXTRACT_SEGMENT_NUMBER(dp);
+	offset = DSA_EXTRACT_OFFSET(dp);
+	if (index >= DSA_MAX_SEGMENTS)
+		return NULL;
+
+	segment_map = &area->segment_maps[index];
+	if (segment_map->mapped_address == NULL ||
+		offset > segment_map->header->size ||
+		size > segment_map->header->size - offset)
+		return NULL;
+
+	return segment_map->mapped_address + offset;
+}
+
 /*
  * Pin this area, so that it will continue to exist even if all backends
  * detach from it.  In that case, the area can still be reattached to if a
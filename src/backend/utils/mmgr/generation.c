@@ -282,7 +282,7 @@ GenerationReset(MemoryContext context)
 
 		dlist_delete(miter.cur);
 
-		context->mem_allocated -= block->blksize;
+		MemoryContextNoteFreed(context, block->blksize);
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->blksize);
@@ -339,7 +339,7 @@ GenerationAlloc(MemoryContext context, Size size)
 		if (block == NULL)
 			return NULL;
 
-		context->mem_allocated += blksize;
+		MemoryContextNoteAllocated(context, blksize);
 
 		/* block with a single (used) chunk */
 		block->blksize = blksize;
@@ -394,7 +394,7 @@ GenerationAlloc(MemoryContext context, Size size)
 		if (block == NULL)
 			return NULL;
 
-		context->mem_allocated += blksize;
+		MemoryContextNoteAllocated(context, blksize);
 
 		block->blksize = blksize;
 		block->nchunks = 0;
@@ -509,7 +509,7 @@ GenerationFree(MemoryContext context, void *pointer)
 	if (set->block == block)
 		set->block = NULL;
 
-	context->mem_allocated -= block->blksize;
+	MemoryContextNoteFreed(context, block->blksize);
 	free(block);
 }
 
@@ -56,6 +56,9 @@ MemoryContext CurTransactionContext = NULL;
 /* This is a transient link to the active portal's memory context: */
 MemoryContext PortalContext = NULL;
 
+/* Sum of mem_allocated over all live contexts, see memutils.h */
+Size		BackendMemoryAllocated = 0;
+
 static void MemoryContextCallResetCallbacks(MemoryContext context);
 static void MemoryContextStatsInternal(MemoryContext context, int level,
 									   bool print, int max_children,
@@ -493,6 +496,21 @@ MemoryContextMemAllocated(MemoryContext context, bool recurse)
 	return total;
 }
 
+/*
+ * BackendMemoryLimitExceeded
+ *		Is this backend holding more memory than backend_memory_limit?
+ *
+ * Executor nodes that can spill to disk check this when deciding whether to
+ * keep growing, so that they give up memory early when the backend as a
+ * whole is over budget.  Nothing fails when the limit is exceeded.
+ */
+bool
+BackendMemoryLimitExceeded(void)
+{
+	return backend_memory_limit > 0 &&
+		BackendMemoryAllocated > (Size) backend_memory_limit * 1024;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
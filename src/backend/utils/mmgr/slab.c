@@ -308,7 +308,7 @@ SlabReset(MemoryContext context)
 #endif
 			free(block);
 			slab->nblocks--;
-			context->mem_allocated -= slab->blockSize;
+			MemoryContextNoteFreed(context, slab->blockSize);
 		}
 	}
 
@@ -393,7 +393,7 @@ SlabAlloc(MemoryContext context, Size size)
 
 		slab->minFreeChunks = slab->chunksPerBlock;
 		slab->nblocks += 1;
-		context->mem_allocated += slab->blockSize;
+		MemoryContextNoteAllocated(context, slab->blockSize);
 	}
 
 	/* grab the block from the freelist (even the new block is there) */
@@ -560,7 +560,7 @@ SlabFree(MemoryContext context, void *pointer)
 	{
 		free(block);
 		slab->nblocks--;
-		context->mem_allocated -= slab->blockSize;
+		MemoryContextNoteFreed(context, slab->blockSize);
 	}
 	else
 		dlist_push_head(&slab->freelist[block->nfree], &block->node);
@@ -337,6 +337,20 @@ ltsReadFillBuffer(LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/*
+	 * If the buffer holds more than one block, start the kernel reading the
+	 * blocks that we expect the next refill to need, so that the I/O overlaps
+	 * with the caller consuming what we just read.  We only know the first
+	 * of those blocks, but since tapes are mostly written one at a time (or
+	 * else with preallocated blocks), a tape's blocks tend to be contiguous
+	 * and guessing that the rest follow it is usually right.  A wrong guess
+	 * merely wastes some read-ahead.
+	 */
+	if (lt->nextBlockNumber != -1L && lt->buffer_size > BLCKSZ)
+		BufFilePrefetchBlocks(lt->tapeSet->pfile,
+							  lt->nextBlockNumber + lt->offsetBlockNumber,
+							  lt->buffer_size / BLCKSZ);
+
 	return (lt->nbytes > 0);
 }
 
@@ -434,6 +434,13 @@ struct Tuplesortstate
 	 */
 	SortSupport onlyKey;
 
+	/*
+	 * Does datum1 of every SortTuple hold the leading sort key (possibly
+	 * abbreviated)?  If so, and that key's comparator is one of the
+	 * ssup_datum_*_cmp ones, specialized sort routines can be used.
+	 */
+	bool		haveDatum1;
+
 	/*
 	 * Additional state for managing "abbreviated key" sortsupport routines
 	 * (which currently may be used by all cases except the hash index case).
@@ -542,6 +549,10 @@ struct Sharedsort
 #define WRITETUP(state,tape,stup)	((*(state)->writetup) (state, tape, stup))
 #define READTUP(state,stup,tape,len) ((*(state)->readtup) (state, stup, tape, len))
 #define LACKMEM(state)		((state)->availMem < 0 && !(state)->slabAllocatorUsed)
+/* also spill early if the backend is over budget and we hold a fair share */
+#define OVERBUDGET(state)	((state)->availMem < (state)->allowedMem / 4 * 3 && \
+							 !(state)->slabAllocatorUsed && \
+							 BackendMemoryLimitExceeded())
 #define USEMEM(state,amt)	((state)->availMem -= (amt))
 #define FREEMEM(state,amt)	((state)->availMem += (amt))
 #define SERIAL(state)		((state)->shared == NULL)
@@ -668,14 +679,149 @@ static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
 static void tuplesort_free(Tuplesortstate *state);
 static void tuplesort_updatemax(Tuplesortstate *state);
 
+/*
+ * Specialized comparators, see their declarations in sortsupport.h.  Sorting
+ * never calls them through the function pointer when it can inline them, but
+ * they are also used for merging, and by anything else using SortSupport.
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+
+/*
+ * Comparison routines for the specialized sorts below.  The leading key is
+ * compared inline; only if that's a tie do we call comparetup, which will
+ * compare the leading key again (authoritatively, if it's abbreviated) and
+ * the remaining ones.  A tie is final if there's only one key to begin with.
+ */
+static pg_attribute_always_inline int
+qsort_tuple_unsigned_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyUnsignedSortComparator(a->datum1, a->isnull1,
+										  b->datum1, b->isnull1,
+										  &state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
+#if SIZEOF_DATUM >= 8
+static pg_attribute_always_inline int
+qsort_tuple_signed_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplySignedSortComparator(a->datum1, a->isnull1,
+										b->datum1, b->isnull1,
+										&state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+#endif
+
+static pg_attribute_always_inline int
+qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyInt32SortComparator(a->datum1, a->isnull1,
+									   b->datum1, b->isnull1,
+									   &state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
 /*
  * Special versions of qsort just for SortTuple objects.  qsort_tuple() sorts
  * any variant of SortTuples, using the appropriate comparetup function.
  * qsort_ssup() is specialized for the case where the comparetup function
  * reduces to ApplySortComparator(), that is single-key MinimalTuple sorts
- * and Datum sorts.
+ * and Datum sorts.  qsort_tuple_{unsigned,signed,int32}() are specialized
+ * for leading keys that use the ssup_datum_*_cmp comparators.
  */
 
+#define ST_SORT qsort_tuple_unsigned
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_unsigned_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
+#if SIZEOF_DATUM >= 8
+#define ST_SORT qsort_tuple_signed
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_signed_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+#endif
+
+#define ST_SORT qsort_tuple_int32
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_tuple_int32_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#define ST_CHECK_FOR_INTERRUPTS
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
 #define ST_SORT qsort_tuple
 #define ST_ELEMENT_TYPE SortTuple
 #define ST_COMPARE_RUNTIME_POINTER
@@ -843,10 +989,14 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	 * fragmentation. Note that the memtuples array of SortTuples is allocated
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.
+	 *
+	 * Unless the sort turns out to be bounded (see tuplesort_set_bound),
+	 * tuples are only ever released all at once, so use a bump context,
+	 * which packs them without aset.c's power-of-2 rounding.
 	 */
-	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
-												"Caller tuples",
-												ALLOCSET_DEFAULT_SIZES);
+	state->tuplecontext = BumpContextCreate(state->sortcontext,
+											"Caller tuples",
+											ALLOCSET_DEFAULT_SIZES);
 
 	state->status = TSS_INITIAL;
 	state->bounded = false;
@@ -928,6 +1078,7 @@ tuplesort_begin_heap(TupleDesc tupDesc,
 	state->copytup = copytup_heap;
 	state->writetup = writetup_heap;
 	state->readtup = readtup_heap;
+	state->haveDatum1 = true;
 
 	state->tupDesc = tupDesc;	/* assume we need not copy tupDesc */
 	state->abbrevNext = 10;
@@ -1007,6 +1158,12 @@ tuplesort_begin_cluster(TupleDesc tupDesc,
 
 	state->indexInfo = BuildIndexInfo(indexRel);
 
+	/*
+	 * If the first key is an expression, datum1 isn't set up and
+	 * comparetup_cluster evaluates the expressions instead.
+	 */
+	state->haveDatum1 = (state->indexInfo->ii_IndexAttrNumbers[0] != 0);
+
 	state->tupDesc = tupDesc;	/* assume we need not copy tupDesc */
 
 	indexScanKey = _bt_mkscankey(indexRel, NULL);
@@ -1098,6 +1255,7 @@ tuplesort_begin_index_btree(Relation heapRel,
 	state->copytup = copytup_index;
 	state->writetup = writetup_index;
 	state->readtup = readtup_index;
+	state->haveDatum1 = true;
 	state->abbrevNext = 10;
 
 	state->heapRel = heapRel;
@@ -1212,6 +1370,7 @@ tuplesort_begin_index_gist(Relation heapRel,
 	state->copytup = copytup_index;
 	state->writetup = writetup_index;
 	state->readtup = readtup_index;
+	state->haveDatum1 = true;
 
 	state->heapRel = heapRel;
 	state->indexRel = indexRel;
@@ -1275,6 +1434,7 @@ tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 	state->copytup = copytup_datum;
 	state->writetup = writetup_datum;
 	state->readtup = readtup_datum;
+	state->haveDatum1 = true;
 	state->abbrevNext = 10;
 
 	state->datumType = datumType;
@@ -1356,6 +1516,17 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	state->bounded = true;
 	state->bound = (int) bound;
 
+	/*
+	 * A bounded sort frees tuples one at a time as better ones come along,
+	 * which a bump context can't take advantage of, so switch the (still
+	 * empty) tuple context to an ordinary one.
+	 */
+	Assert(MemoryContextIsEmpty(state->tuplecontext));
+	MemoryContextDelete(state->tuplecontext);
+	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
+												"Caller tuples",
+												ALLOCSET_DEFAULT_SIZES);
+
 	/*
 	 * Bounded sorts are not an effective target for abbreviated key
 	 * optimization.  Disable by setting state to be consistent with no
@@ -1381,6 +1552,30 @@ tuplesort_used_bound(Tuplesortstate *state)
 	return state->boundUsed;
 }
 
+/*
+ * tuplesort_get_bound_threshold
+ *
+ * If a bounded sort already holds as many tuples as its bound, set *datum
+ * and *isnull to the leading key of the last tuple it would currently
+ * return, and return true.  No tuple whose leading key sorts after that can
+ * be in the result.  Otherwise, return false.
+ *
+ * A pass-by-reference *datum points into the sort's copy of the tuple, so it
+ * is only valid until the next tuple is added to the sort.
+ */
+bool
+tuplesort_get_bound_threshold(Tuplesortstate *state, Datum *datum,
+							  bool *isnull)
+{
+	/* abbreviation is disabled for bounded sorts, so datum1 is the key */
+	if (state->status != TSS_BOUNDED || !state->haveDatum1)
+		return false;
+
+	*datum = state->memtuples[0].datum1;
+	*isnull = state->memtuples[0].isnull1;
+	return true;
+}
+
 /*
  * tuplesort_free
  *
@@ -1938,7 +2133,8 @@ puttuple_common(Tuplesortstate *state, SortTuple *tuple)
 			/*
 			 * Done if we still fit in available memory and have array slots.
 			 */
-			if (state->memtupcount < state->memtupsize && !LACKMEM(state))
+			if (state->memtupcount < state->memtupsize && !LACKMEM(state) &&
+				!OVERBUDGET(state))
 				return;
 
 			/*
@@ -3142,7 +3338,7 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	 * unless this is the final call during initial run generation.
 	 */
 	if (state->memtupcount < state->memtupsize && !LACKMEM(state) &&
-		!alltuples)
+		!OVERBUDGET(state) && !alltuples)
 		return;
 
 	/*
@@ -3503,6 +3699,37 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		/*
+		 * Do we have the leading key in datum1, with a comparator we have a
+		 * specialized sort routine for?
+		 */
+		if (state->haveDatum1 && state->sortKeys)
+		{
+			if (state->sortKeys[0].comparator == ssup_datum_unsigned_cmp)
+			{
+				qsort_tuple_unsigned(state->memtuples,
+									 state->memtupcount,
+									 state);
+				return;
+			}
+#if SIZEOF_DATUM >= 8
+			else if (state->sortKeys[0].comparator == ssup_datum_signed_cmp)
+			{
+				qsort_tuple_signed(state->memtuples,
+								   state->memtupcount,
+								   state);
+				return;
+			}
+#endif
+			else if (state->sortKeys[0].comparator == ssup_datum_int32_cmp)
+			{
+				qsort_tuple_int32(state->memtuples,
+								  state->memtupcount,
+								  state);
+				return;
+			}
+		}
+
 		/* Can we use the single-key sort function? */
 		if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
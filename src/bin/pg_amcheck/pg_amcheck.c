@@ -61,6 +61,13 @@ typedef struct AmcheckOptions
 	bool		show_progress;
 	int			jobs;
 
+	/*
+	 * With more than one job, relations larger than this many blocks are
+	 * checked in ranges of this many blocks, each using its own connection.
+	 * Zero disables splitting.
+	 */
+	int64		split_blocks;
+
 	/*
 	 * Whether to install missing extensions, and optionally the name of the
 	 * schema in which to install the extension's objects.
@@ -115,6 +122,7 @@ static AmcheckOptions opts = {
 	.strict_names = true,
 	.show_progress = false,
 	.jobs = 1,
+	.split_blocks = 131072,
 	.install_missing = false,
 	.install_schema = "pg_catalog",
 	.include = {NULL, 0},
@@ -148,6 +156,7 @@ typedef struct DatabaseInfo
 {
 	char	   *datname;
 	char	   *amcheck_schema; /* escaped, quoted literal */
+	bool		has_check_blocks;	/* amcheck has bt_index_check_blocks? */
 } DatabaseInfo;
 
 typedef struct RelationInfo
@@ -159,6 +168,17 @@ typedef struct RelationInfo
 	char	   *relname;
 	int			relpages;
 	int			blocks_to_check;
+	int64		startblock;		/* first block to check, or -1 */
+	int64		endblock;		/* last block to check, or -1 */
+
+	/*
+	 * When a large relation is split into several block ranges, the ranges
+	 * are computed from relpages, which may overstate the relation's actual
+	 * size.  These are true if startblock or endblock came from splitting and
+	 * must be clamped to the size of the relation when it is checked.
+	 */
+	bool		clamp_start;
+	bool		clamp_end;
 	char	   *sql;			/* set during query run, pg_free'd after */
 } RelationInfo;
 
@@ -175,6 +195,7 @@ static void prepare_heap_command(PQExpBuffer sql, RelationInfo *rel,
 								 PGconn *conn);
 static void prepare_btree_command(PQExpBuffer sql, RelationInfo *rel,
 								  PGconn *conn);
+static void append_block_range(PQExpBuffer sql, RelationInfo *rel);
 static void run_command(ParallelSlot *slot, const char *sql);
 static bool verify_heap_slot_handler(PGresult *res, PGconn *conn,
 									 void *context);
@@ -196,6 +217,8 @@ static void append_btree_pattern(PatternInfoArray *pia, const char *pattern,
 								 int encoding);
 static void compile_database_list(PGconn *conn, SimplePtrList *databases,
 								  const char *initial_dbname);
+static void append_relation_ranges(SimplePtrList *relations,
+								   RelationInfo *rel, uint64 *pagecount);
 static void compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 										 const DatabaseInfo *datinfo,
 										 uint64 *pagecount);
@@ -267,6 +290,7 @@ main(int argc, char *argv[])
 		{"heapallindexed", no_argument, NULL, 11},
 		{"parent-check", no_argument, NULL, 12},
 		{"install-missing", optional_argument, NULL, 13},
+		{"split-blocks", required_argument, NULL, 14},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -449,6 +473,21 @@ main(int argc, char *argv[])
 				if (optarg)
 					opts.install_schema = pg_strdup(optarg);
 				break;
+			case 14:
+				errno = 0;
+				optval = strtoul(optarg, &endptr, 10);
+				if (endptr == optarg || *endptr != '\0' || errno != 0)
+				{
+					pg_log_error("invalid split block count");
+					exit(1);
+				}
+				if (optval > MaxBlockNumber)
+				{
+					pg_log_error("split block count out of bounds");
+					exit(1);
+				}
+				opts.split_blocks = optval;
+				break;
 			default:
 				fprintf(stderr,
 						_("Try \"%s --help\" for more information.\n"),
@@ -547,6 +586,8 @@ main(int argc, char *argv[])
 		PGresult   *result;
 		int			ntups;
 		const char *amcheck_schema = NULL;
+		int			amcheck_major;
+		int			amcheck_minor;
 		DatabaseInfo *dat = (DatabaseInfo *) cell->ptr;
 
 		cparams.override_dbname = dat->datname;
@@ -609,6 +650,10 @@ main(int argc, char *argv[])
 			continue;
 		}
 		amcheck_schema = PQgetvalue(result, 0, 0);
+		if (sscanf(PQgetvalue(result, 0, 1), "%d.%d",
+				   &amcheck_major, &amcheck_minor) == 2)
+			dat->has_check_blocks = (amcheck_major > 1 ||
+									 (amcheck_major == 1 && amcheck_minor >= 4));
 		if (opts.verbose)
 			pg_log_info("in database \"%s\": using amcheck version \"%s\" in schema \"%s\"",
 						PQdb(conn), PQgetvalue(result, 0, 1), amcheck_schema);
@@ -655,12 +700,15 @@ main(int argc, char *argv[])
 
 	/*
 	 * Set parallel_workers to the lesser of opts.jobs and the number of
-	 * relations.
+	 * commands to run, counting each range of a split relation separately.
+	 * Progress is reported in relations, so only count the first range of
+	 * each relation towards reltotal.
 	 */
 	parallel_workers = 0;
 	for (cell = relations.head; cell; cell = cell->next)
 	{
-		reltotal++;
+		if (!((RelationInfo *) cell->ptr)->clamp_start)
+			reltotal++;
 		if (parallel_workers < opts.jobs)
 			parallel_workers++;
 	}
@@ -717,7 +765,8 @@ main(int argc, char *argv[])
 		progress_report(reltotal, relprogress, pagestotal, pageschecked,
 						latest_datname, false, false);
 
-		relprogress++;
+		if (!rel->clamp_start)
+			relprogress++;
 		pageschecked += rel->blocks_to_check;
 
 		/*
@@ -753,8 +802,13 @@ main(int argc, char *argv[])
 			{
 				if (opts.show_progress && progress_since_last_stderr)
 					fprintf(stderr, "\n");
-				pg_log_info("checking heap table \"%s.%s.%s\"",
-							rel->datinfo->datname, rel->nspname, rel->relname);
+				if (rel->clamp_start || rel->clamp_end)
+					pg_log_info("checking heap table \"%s.%s.%s\" from block " INT64_FORMAT,
+								rel->datinfo->datname, rel->nspname, rel->relname,
+								Max(rel->startblock, 0));
+				else
+					pg_log_info("checking heap table \"%s.%s.%s\"",
+								rel->datinfo->datname, rel->nspname, rel->relname);
 				progress_since_last_stderr = false;
 			}
 			prepare_heap_command(&sql, rel, free_slot->connection);
@@ -769,8 +823,13 @@ main(int argc, char *argv[])
 				if (opts.show_progress && progress_since_last_stderr)
 					fprintf(stderr, "\n");
 
-				pg_log_info("checking btree index \"%s.%s.%s\"",
-							rel->datinfo->datname, rel->nspname, rel->relname);
+				if (rel->clamp_start || rel->clamp_end)
+					pg_log_info("checking btree index \"%s.%s.%s\" from block " INT64_FORMAT,
+								rel->datinfo->datname, rel->nspname, rel->relname,
+								Max(rel->startblock, 0));
+				else
+					pg_log_info("checking btree index \"%s.%s.%s\"",
+								rel->datinfo->datname, rel->nspname, rel->relname);
 				progress_since_last_stderr = false;
 			}
 			prepare_btree_command(&sql, rel, free_slot->connection);
@@ -836,15 +895,17 @@ prepare_heap_command(PQExpBuffer sql, RelationInfo *rel, PGconn *conn)
 					  opts.reconcile_toast ? "true" : "false",
 					  opts.skip);
 
-	if (opts.startblock >= 0)
-		appendPQExpBuffer(sql, ", startblock := " INT64_FORMAT, opts.startblock);
-	if (opts.endblock >= 0)
-		appendPQExpBuffer(sql, ", endblock := " INT64_FORMAT, opts.endblock);
+	append_block_range(sql, rel);
 
 	appendPQExpBuffer(sql,
 					  "\n) v WHERE c.oid = %u "
 					  "AND c.relpersistence != 't'",
 					  rel->reloid);
+	if (rel->clamp_start)
+		appendPQExpBuffer(sql,
+						  " AND pg_catalog.pg_relation_size(c.oid) > " INT64_FORMAT
+						  " * pg_catalog.current_setting('block_size')::bigint",
+						  rel->startblock);
 }
 
 /*
@@ -868,7 +929,26 @@ prepare_btree_command(PQExpBuffer sql, RelationInfo *rel, PGconn *conn)
 {
 	resetPQExpBuffer(sql);
 
-	if (opts.parent_check)
+	if (rel->startblock >= 0 || rel->endblock >= 0)
+	{
+		appendPQExpBuffer(sql,
+						  "SELECT %s.bt_index_check_blocks(index := c.oid",
+						  rel->datinfo->amcheck_schema);
+		append_block_range(sql, rel);
+		appendPQExpBuffer(sql,
+						  ")\nFROM pg_catalog.pg_class c, pg_catalog.pg_index i "
+						  "WHERE c.oid = %u "
+						  "AND c.oid = i.indexrelid "
+						  "AND c.relpersistence != 't' "
+						  "AND i.indisready AND i.indisvalid AND i.indislive",
+						  rel->reloid);
+		if (rel->clamp_start)
+			appendPQExpBuffer(sql,
+							  " AND pg_catalog.pg_relation_size(c.oid) > " INT64_FORMAT
+							  " * pg_catalog.current_setting('block_size')::bigint",
+							  rel->startblock);
+	}
+	else if (opts.parent_check)
 		appendPQExpBuffer(sql,
 						  "SELECT %s.bt_index_parent_check("
 						  "index := c.oid, heapallindexed := %s, rootdescend := %s)"
@@ -895,6 +975,32 @@ prepare_btree_command(PQExpBuffer sql, RelationInfo *rel, PGconn *conn)
 						  rel->reloid);
 }
 
+/*
+ * append_block_range
+ *
+ * Appends the startblock and endblock arguments for checking the given
+ * relation's block range, if any, to an amcheck function call.  A range that
+ * was computed by splitting the relation has its end clamped to the
+ * relation's current size, since relpages may be out of date.
+ *
+ * sql: buffer holding the amcheck function call being constructed
+ * rel: relation information for the relation to be checked
+ */
+static void
+append_block_range(PQExpBuffer sql, RelationInfo *rel)
+{
+	if (rel->startblock >= 0)
+		appendPQExpBuffer(sql, ", startblock := " INT64_FORMAT, rel->startblock);
+	if (rel->endblock >= 0 && rel->clamp_end)
+		appendPQExpBuffer(sql,
+						  ", endblock := pg_catalog.least(" INT64_FORMAT ", "
+						  "pg_catalog.pg_relation_size(c.oid) / "
+						  "pg_catalog.current_setting('block_size')::bigint - 1)",
+						  rel->endblock);
+	else if (rel->endblock >= 0)
+		appendPQExpBuffer(sql, ", endblock := " INT64_FORMAT, rel->endblock);
+}
+
 /*
  * run_command
  *
@@ -971,6 +1077,7 @@ should_processing_continue(PGresult *res)
 		case PGRES_SINGLE_TUPLE:
 		case PGRES_PIPELINE_SYNC:
 		case PGRES_PIPELINE_ABORTED:
+		case PGRES_TUPLES_CHUNK:
 			return false;
 	}
 	return true;
@@ -1197,6 +1304,7 @@ help(const char *progname)
 	printf(_("\nOther options:\n"));
 	printf(_("  -e, --echo                      show the commands being sent to the server\n"));
 	printf(_("  -j, --jobs=NUM                  use this many concurrent connections to the server\n"));
+	printf(_("      --split-blocks=BLOCKS       with --jobs, check relations in ranges of this many blocks\n"));
 	printf(_("  -P, --progress                  show progress information\n"));
 	printf(_("  -v, --verbose                   write a lot of output\n"));
 	printf(_("  -V, --version                   output version information, then exit\n"));
@@ -2160,8 +2268,13 @@ compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 			rel->relname = pstrdup(relname);
 			rel->relpages = relpages;
 			rel->blocks_to_check = relpages;
+			rel->startblock = -1;
+			rel->endblock = -1;
 			if (is_heap && (opts.startblock >= 0 || opts.endblock >= 0))
 			{
+				rel->startblock = opts.startblock;
+				rel->endblock = opts.endblock;
+
 				/*
 				 * We apply --startblock and --endblock to heap tables, but
 				 * not btree indexes, and for progress purposes we need to
@@ -2177,10 +2290,84 @@ compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 						rel->blocks_to_check = 0;
 				}
 			}
-			*pagecount += rel->blocks_to_check;
 
-			simple_ptr_list_append(relations, rel);
+			/*
+			 * Split large relations into ranges that can be checked
+			 * concurrently.  Each btree range is checked without reference
+			 * to the heap or to parent pages, so indexes cannot be split when
+			 * those checks were requested.
+			 */
+			if (opts.jobs > 1 && opts.split_blocks > 0 &&
+				rel->blocks_to_check > opts.split_blocks &&
+				(is_heap ||
+				 (dat->has_check_blocks && !opts.parent_check &&
+				  !opts.heapallindexed)))
+				append_relation_ranges(relations, rel, pagecount);
+			else
+			{
+				*pagecount += rel->blocks_to_check;
+				simple_ptr_list_append(relations, rel);
+			}
 		}
 	}
 	PQclear(res);
 }
+
+/*
+ * append_relation_ranges
+ *
+ * Appends the given relation to the list of relations to be checked as a
+ * series of consecutive ranges of opts.split_blocks blocks, each of which is
+ * checked by its own amcheck command, so that a large relation does not leave
+ * the other connections idle while it is checked.  The last range is left
+ * open ended, in case the relation has grown since relpages was computed.
+ *
+ * relations: list onto which the relation's ranges are appended
+ * rel: relation information for the relation to be split, which is used as
+ *		the first range
+ * pagecount: gets incremented by the number of blocks to check
+ */
+static void
+append_relation_ranges(SimplePtrList *relations, RelationInfo *rel,
+					   uint64 *pagecount)
+{
+	int64		start = Max(rel->startblock, 0);
+	int64		end = rel->endblock;
+	int64		remaining = rel->blocks_to_check;
+
+	for (;;)
+	{
+		RelationInfo *range = rel;
+
+		if (start != Max(rel->startblock, 0))
+		{
+			range = (RelationInfo *) pg_malloc(sizeof(RelationInfo));
+			memcpy(range, rel, sizeof(RelationInfo));
+			range->nspname = pstrdup(rel->nspname);
+			range->relname = pstrdup(rel->relname);
+			range->clamp_start = true;
+		}
+		range->startblock = start;
+
+		if (remaining > opts.split_blocks)
+		{
+			range->endblock = start + opts.split_blocks - 1;
+			range->clamp_end = true;
+			range->blocks_to_check = opts.split_blocks;
+		}
+		else
+		{
+			range->endblock = end;
+			range->clamp_end = false;
+			range->blocks_to_check = remaining;
+		}
+
+		*pagecount += range->blocks_to_check;
+		simple_ptr_list_append(relations, range);
+
+		remaining -= range->blocks_to_check;
+		start += range->blocks_to_check;
+		if (remaining <= 0)
+			break;
+	}
+}
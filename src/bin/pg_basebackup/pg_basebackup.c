@@ -137,6 +137,8 @@ static bool showprogress = false;
 static bool estimatesize = true;
 static int	verbose = 0;
 static int	compresslevel = 0;
+static int	server_compresslevel = 0;
+static char *incremental_base = NULL;
 static IncludeWal includewal = STREAM_WAL;
 static bool fastcheckpoint = false;
 static bool writerecoveryconf = false;
@@ -210,6 +212,7 @@ static bool reached_end_position(XLogRecPtr segendpos, uint32 timeline,
 								 bool segment_finished);
 
 static const char *get_tablespace_mapping(const char *dir);
+static char *get_incremental_since(const char *dir);
 static void tablespace_list_append(const char *arg);
 
 
@@ -396,10 +399,14 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
 	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("      --server-compress=1-9\n"
+			 "                         have the server compress tar output with given level\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
 	printf(_("  -C, --create-slot      create replication slot\n"));
+	printf(_("  -i, --incremental=DIRECTORY\n"
+			 "                         only send blocks changed since the given backup\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -1022,6 +1029,40 @@ writeTarData(WriteTarState *state, char *buf, int r)
 	}
 }
 
+/*
+ * Get the start position of the backup in the given directory from its
+ * backup_label, to use as the base of an incremental backup.
+ */
+static char *
+get_incremental_since(const char *dir)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+
+	snprintf(path, sizeof(path), "%s/backup_label", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+		{
+			fclose(fp);
+			return psprintf("%X/%X", hi, lo);
+		}
+	}
+
+	pg_log_error("could not find start WAL location in file \"%s\"", path);
+	exit(1);
+}
+
 /*
  * Receive a tar format file from the connection to the server, and write
  * the data from this file directly into a tar file. If compression is
@@ -1109,7 +1150,8 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 #endif
 			{
 				snprintf(state.filename, sizeof(state.filename),
-						 "%s/base.tar", basedir);
+						 "%s/base.tar%s", basedir,
+						 server_compresslevel != 0 ? ".gz" : "");
 				state.tarfile = fopen(state.filename, "wb");
 			}
 		}
@@ -1137,8 +1179,9 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		else
 #endif
 		{
-			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar",
-					 basedir, PQgetvalue(res, rownum, 0));
+			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar%s",
+					 basedir, PQgetvalue(res, rownum, 0),
+					 server_compresslevel != 0 ? ".gz" : "");
 			state.tarfile = fopen(state.filename, "wb");
 		}
 	}
@@ -1253,8 +1296,12 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		termPQExpBuffer(&buf);
 	}
 
-	/* 2 * TAR_BLOCK_SIZE bytes empty data at end of file */
-	writeTarData(&state, zerobuf, sizeof(zerobuf));
+	/*
+	 * 2 * TAR_BLOCK_SIZE bytes empty data at end of file.  An archive the
+	 * server compressed already ends with them.
+	 */
+	if (server_compresslevel == 0)
+		writeTarData(&state, zerobuf, sizeof(zerobuf));
 
 #ifdef HAVE_LIBZ
 	if (state.ztarfile != NULL)
@@ -1901,6 +1948,31 @@ BaseBackup(void)
 										"NOVERIFY_CHECKSUMS");
 	}
 
+	if (incremental_base != NULL)
+	{
+		if (!use_new_option_syntax)
+		{
+			pg_log_error("server does not support incremental backups");
+			exit(1);
+		}
+		AppendStringCommandOption(&buf, use_new_option_syntax,
+								  "INCREMENTAL_SINCE",
+								  get_incremental_since(incremental_base));
+	}
+
+	if (server_compresslevel != 0)
+	{
+		if (!use_new_option_syntax)
+		{
+			pg_log_error("server does not support server-side compression");
+			exit(1);
+		}
+		AppendStringCommandOption(&buf, use_new_option_syntax,
+								  "COMPRESSION", "gzip");
+		AppendIntegerCommandOption(&buf, use_new_option_syntax,
+								   "COMPRESSION_LEVEL", server_compresslevel);
+	}
+
 	if (manifest)
 	{
 		AppendStringCommandOption(&buf, use_new_option_syntax, "MANIFEST",
@@ -2255,6 +2327,7 @@ main(int argc, char **argv)
 		{"format", required_argument, NULL, 'F'},
 		{"checkpoint", required_argument, NULL, 'c'},
 		{"create-slot", no_argument, NULL, 'C'},
+		{"incremental", required_argument, NULL, 'i'},
 		{"max-rate", required_argument, NULL, 'r'},
 		{"write-recovery-conf", no_argument, NULL, 'R'},
 		{"slot", required_argument, NULL, 'S'},
@@ -2281,6 +2354,7 @@ main(int argc, char **argv)
 		{"no-manifest", no_argument, NULL, 5},
 		{"manifest-force-encode", no_argument, NULL, 6},
 		{"manifest-checksums", required_argument, NULL, 7},
+		{"server-compress", required_argument, NULL, 8},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2308,7 +2382,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "CD:F:r:RS:T:X:l:nNzZ:d:c:h:p:U:s:wWkvP",
+	while ((c = getopt_long(argc, argv, "CD:F:i:r:RS:T:X:l:nNzZ:d:c:h:p:U:s:wWkvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2316,6 +2390,9 @@ main(int argc, char **argv)
 			case 'C':
 				create_slot = true;
 				break;
+			case 'i':
+				incremental_base = pg_strdup(optarg);
+				break;
 			case 'D':
 				basedir = pg_strdup(optarg);
 				break;
@@ -2457,6 +2534,11 @@ main(int argc, char **argv)
 			case 7:
 				manifest_checksums = pg_strdup(optarg);
 				break;
+			case 8:
+				if (!option_parse_int(optarg, "--server-compress", 1, 9,
+									  &server_compresslevel))
+					exit(1);
+				break;
 			default:
 
 				/*
@@ -2502,6 +2584,42 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (server_compresslevel != 0)
+	{
+		/*
+		 * The archives the server compressed are written out as they are, so
+		 * we can neither unpack them nor add anything to them.
+		 */
+		if (format == 'p')
+		{
+			pg_log_error("only tar mode backups can be compressed");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (compresslevel != 0)
+		{
+			pg_log_error("--server-compress cannot be used with --compress");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (writerecoveryconf)
+		{
+			pg_log_error("--server-compress cannot be used with --write-recovery-conf");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (strcmp(basedir, "-") == 0)
+		{
+			pg_log_error("--server-compress cannot be used when writing to stdout");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+	}
+
 	if (format == 't' && includewal == STREAM_WAL && strcmp(basedir, "-") == 0)
 	{
 		pg_log_error("cannot stream write-ahead logs in tar mode to stdout");
@@ -0,0 +1,833 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c - combine a full backup with incremental backups
+ *
+ * The result is a plain-format backup equivalent to a full backup taken at
+ * the time of the last incremental backup.  The backups are applied to the
+ * output directory one after another: every file of an incremental backup
+ * replaces the one from the backups before, INCREMENTAL.<segment> files
+ * overwrite just the blocks they contain, and files an incremental backup
+ * doesn't have any more are removed.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  src/bin/pg_basebackup/pg_combinebackup.c
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xlogdefs.h"
+#include "common/file_perm.h"
+#include "common/file_utils.h"
+#include "common/logging.h"
+#include "getopt_long.h"
+#include "lib/stringinfo.h"
+#include "replication/basebackup.h"
+#include "storage/block.h"
+
+#define INCREMENTAL_PREFIX		"INCREMENTAL."
+#define INCREMENTAL_PREFIX_LEN	(sizeof(INCREMENTAL_PREFIX) - 1)
+
+/* Contents of the backup_label of one of the backups to combine */
+typedef struct BackupInfo
+{
+	char	   *path;			/* backup directory */
+	XLogRecPtr	start_lsn;		/* START WAL LOCATION */
+	XLogRecPtr	incremental_since;	/* INCREMENTAL FROM LSN, if any */
+	char	   *label;			/* backup_label, less the INCREMENTAL line */
+} BackupInfo;
+
+static const char *progname;
+static bool dry_run = false;
+static bool do_sync = true;
+
+static BackupInfo *backups;
+static int	nbackups;
+static char *output_dir;
+
+static void usage(void);
+static void read_backup_label(BackupInfo *backup);
+static void check_no_tablespaces(BackupInfo *backup);
+static void copy_tree(const char *src, const char *dst, bool top);
+static void copy_file(const char *src, const char *dst);
+static void remove_missing(int k, const char *relpath);
+static void apply_backup(int k, const char *relpath);
+static void apply_incremental(int k, const char *relpath, const char *name);
+static BlockNumber earlier_nblocks(int k, const char *relpath,
+								   const char *name);
+static uint32 *read_incremental_header(const char *path, int fd,
+									   off_t size, uint32 *nblocks,
+									   uint32 *nchanged);
+static void write_backup_label(BackupInfo *backup);
+
+
+static void
+usage(void)
+{
+	printf(_("%s combines a full backup with incremental backups based on it.\n\n"),
+		   progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... FULLBACKUP INCREMENTAL...\n"), progname);
+	printf(_("\nOptions:\n"));
+	printf(_("  -n, --dry-run          check the backups, but don't write anything\n"));
+	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
+	printf(_("  -o, --output=DIRECTORY write the combined backup into this directory\n"));
+	printf(_("  -V, --version          output version information, then exit\n"));
+	printf(_("  -?, --help             show this help, then exit\n"));
+	printf(_("\nThe backups must be plain-format backups, given oldest first.  Each\n"
+			 "incremental backup must have been taken with --incremental based on\n"
+			 "the one before it.\n"));
+	printf(_("\nReport bugs to <%s>.\n"), PACKAGE_BUGREPORT);
+	printf(_("%s home page: <%s>\n"), PACKAGE_NAME, PACKAGE_URL);
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"dry-run", no_argument, NULL, 'n'},
+		{"no-sync", no_argument, NULL, 'N'},
+		{"output", required_argument, NULL, 'o'},
+		{NULL, 0, NULL, 0}
+	};
+	int			c;
+	int			i;
+
+	pg_logging_init(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_basebackup"));
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "nNo:", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				dry_run = true;
+				break;
+			case 'N':
+				do_sync = false;
+				break;
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				canonicalize_path(output_dir);
+				break;
+			default:
+				fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+						progname);
+				exit(1);
+		}
+	}
+
+	nbackups = argc - optind;
+	if (nbackups < 2)
+	{
+		pg_log_error("a full backup and at least one incremental backup must be specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+	if (output_dir == NULL && !dry_run)
+	{
+		pg_log_error("no output directory specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	/* Check that the backups form a chain */
+	backups = pg_malloc0(sizeof(BackupInfo) * nbackups);
+	for (i = 0; i < nbackups; i++)
+	{
+		BackupInfo *backup = &backups[i];
+
+		backup->path = pg_strdup(argv[optind + i]);
+		canonicalize_path(backup->path);
+		read_backup_label(backup);
+		check_no_tablespaces(backup);
+
+		if (i == 0)
+		{
+			if (!XLogRecPtrIsInvalid(backup->incremental_since))
+			{
+				pg_log_error("backup \"%s\" is an incremental backup, not a full one",
+							 backup->path);
+				exit(1);
+			}
+		}
+		else if (XLogRecPtrIsInvalid(backup->incremental_since))
+		{
+			pg_log_error("backup \"%s\" is not an incremental backup",
+						 backup->path);
+			exit(1);
+		}
+		else if (backup->incremental_since != backups[i - 1].start_lsn)
+		{
+			pg_log_error("backup \"%s\" is based on a backup started at %X/%X, but backup \"%s\" started at %X/%X",
+						 backup->path,
+						 LSN_FORMAT_ARGS(backup->incremental_since),
+						 backups[i - 1].path,
+						 LSN_FORMAT_ARGS(backups[i - 1].start_lsn));
+			exit(1);
+		}
+	}
+
+	if (!dry_run)
+	{
+		switch (pg_check_dir(output_dir))
+		{
+			case 0:
+				if (pg_mkdir_p(output_dir, pg_dir_create_mode) != 0)
+				{
+					pg_log_error("could not create directory \"%s\": %m",
+								 output_dir);
+					exit(1);
+				}
+				break;
+			case 1:
+				break;
+			case 2:
+			case 3:
+			case 4:
+				pg_log_error("directory \"%s\" exists but is not empty",
+							 output_dir);
+				exit(1);
+			case -1:
+				pg_log_error("could not access directory \"%s\": %m",
+							 output_dir);
+				exit(1);
+		}
+
+		copy_tree(backups[0].path, output_dir, true);
+	}
+
+	/*
+	 * Apply each incremental backup in turn.  Even in a dry run, this checks
+	 * that every incremental file has a counterpart in the backup before
+	 * and is consistent with it.
+	 */
+	for (i = 1; i < nbackups; i++)
+	{
+		if (!dry_run)
+			remove_missing(i, "");
+		apply_backup(i, "");
+	}
+
+	if (!dry_run)
+	{
+		write_backup_label(&backups[nbackups - 1]);
+
+		if (do_sync)
+			fsync_pgdata(output_dir, PG_VERSION_NUM);
+	}
+
+	exit(0);
+}
+
+/*
+ * Read the backup_label of a backup.
+ */
+static void
+read_backup_label(BackupInfo *backup)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+	StringInfoData label;
+
+	snprintf(path, sizeof(path), "%s/backup_label", backup->path);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+
+	initStringInfo(&label);
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+		if (sscanf(line, "INCREMENTAL FROM LSN: %X/%X", &hi, &lo) == 2)
+			backup->incremental_since = ((uint64) hi) << 32 | lo;
+		else
+			appendStringInfoString(&label, line);
+	}
+	if (ferror(fp))
+	{
+		pg_log_error("could not read file \"%s\": %m", path);
+		exit(1);
+	}
+	fclose(fp);
+
+	if (XLogRecPtrIsInvalid(backup->start_lsn))
+	{
+		pg_log_error("could not find start WAL location in file \"%s\"", path);
+		exit(1);
+	}
+
+	backup->label = label.data;
+}
+
+/*
+ * Backups with user-defined tablespaces keep those outside the backup
+ * directory, where we'd have to apply the incremental files as well.  That
+ * isn't supported.
+ */
+static void
+check_no_tablespaces(BackupInfo *backup)
+{
+	char		path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(path, sizeof(path), "%s/pg_tblspc", backup->path);
+	dir = opendir(path);
+	if (dir == NULL)
+	{
+		if (errno == ENOENT)
+			return;
+		pg_log_error("could not open directory \"%s\": %m", path);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		pg_log_error("backup \"%s\" contains user-defined tablespaces, which are not supported",
+					 backup->path);
+		exit(1);
+	}
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", path);
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Should this file be left out of the combined backup?  The manifest would
+ * be wrong, and the backup label is written separately.
+ */
+static bool
+skip_file(const char *relpath, const char *name)
+{
+	return relpath[0] == '\0' &&
+		(strcmp(name, "backup_manifest") == 0 ||
+		 strcmp(name, "backup_label") == 0);
+}
+
+/*
+ * Copy the directory src recursively into dst, which must exist.  top is
+ * true for the top-level directory of a backup.
+ */
+static void
+copy_tree(const char *src, const char *dst, bool top)
+{
+	DIR		   *dir;
+	struct dirent *de;
+
+	dir = opendir(src);
+	if (dir == NULL)
+	{
+		pg_log_error("could not open directory \"%s\": %m", src);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		srcpath[MAXPGPATH];
+		char		dstpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+		if (top && skip_file("", de->d_name))
+			continue;
+
+		snprintf(srcpath, sizeof(srcpath), "%s/%s", src, de->d_name);
+		snprintf(dstpath, sizeof(dstpath), "%s/%s", dst, de->d_name);
+
+		if (stat(srcpath, &st) != 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", srcpath);
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (mkdir(dstpath, pg_dir_create_mode) != 0)
+			{
+				pg_log_error("could not create directory \"%s\": %m", dstpath);
+				exit(1);
+			}
+			copy_tree(srcpath, dstpath, false);
+		}
+		else if (S_ISREG(st.st_mode))
+			copy_file(srcpath, dstpath);
+	}
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", src);
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Copy the file src to dst, replacing dst if it exists.
+ */
+static void
+copy_file(const char *src, const char *dst)
+{
+	char		buf[BLCKSZ * 8];
+	int			srcfd;
+	int			dstfd;
+	ssize_t		nread;
+
+	srcfd = open(src, O_RDONLY | PG_BINARY, 0);
+	if (srcfd < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", src);
+		exit(1);
+	}
+	dstfd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY,
+				 pg_file_create_mode);
+	if (dstfd < 0)
+	{
+		pg_log_error("could not create file \"%s\": %m", dst);
+		exit(1);
+	}
+
+	while ((nread = read(srcfd, buf, sizeof(buf))) > 0)
+	{
+		errno = 0;
+		if (write(dstfd, buf, nread) != nread)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			pg_log_error("could not write file \"%s\": %m", dst);
+			exit(1);
+		}
+	}
+	if (nread < 0)
+	{
+		pg_log_error("could not read file \"%s\": %m", src);
+		exit(1);
+	}
+
+	if (close(dstfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", dst);
+		exit(1);
+	}
+	close(srcfd);
+}
+
+/*
+ * Remove what's in the output directory below relpath but not in backup k,
+ * be it as an ordinary or as an incremental file.
+ */
+static void
+remove_missing(int k, const char *relpath)
+{
+	char		outdir[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(outdir, sizeof(outdir), "%s%s", output_dir, relpath);
+	dir = opendir(outdir);
+	if (dir == NULL)
+	{
+		pg_log_error("could not open directory \"%s\": %m", outdir);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		outpath[MAXPGPATH];
+		char		inpath[MAXPGPATH];
+		char		incpath[MAXPGPATH];
+		char		subpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(outpath, sizeof(outpath), "%s/%s", outdir, de->d_name);
+		snprintf(inpath, sizeof(inpath), "%s%s/%s",
+				 backups[k].path, relpath, de->d_name);
+		snprintf(incpath, sizeof(incpath), "%s%s/%s%s",
+				 backups[k].path, relpath, INCREMENTAL_PREFIX, de->d_name);
+		snprintf(subpath, sizeof(subpath), "%s/%s", relpath, de->d_name);
+
+		if (lstat(outpath, &st) != 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", outpath);
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (access(inpath, F_OK) == 0)
+				remove_missing(k, subpath);
+			else if (!rmtree(outpath, true))
+			{
+				pg_log_error("could not remove directory \"%s\"", outpath);
+				exit(1);
+			}
+		}
+		else if (access(inpath, F_OK) != 0 && access(incpath, F_OK) != 0 &&
+				 unlink(outpath) != 0)
+		{
+			pg_log_error("could not remove file \"%s\": %m", outpath);
+			exit(1);
+		}
+	}
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", outdir);
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Apply the files below relpath of incremental backup k to the output
+ * directory, or just check them in a dry run.
+ */
+static void
+apply_backup(int k, const char *relpath)
+{
+	char		indir[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(indir, sizeof(indir), "%s%s", backups[k].path, relpath);
+	dir = opendir(indir);
+	if (dir == NULL)
+	{
+		pg_log_error("could not open directory \"%s\": %m", indir);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		inpath[MAXPGPATH];
+		char		outpath[MAXPGPATH];
+		char		subpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+		if (skip_file(relpath, de->d_name))
+			continue;
+
+		snprintf(inpath, sizeof(inpath), "%s/%s", indir, de->d_name);
+		snprintf(outpath, sizeof(outpath), "%s%s/%s",
+				 output_dir ? output_dir : "", relpath, de->d_name);
+		snprintf(subpath, sizeof(subpath), "%s/%s", relpath, de->d_name);
+
+		if (stat(inpath, &st) != 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", inpath);
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (!dry_run && mkdir(outpath, pg_dir_create_mode) != 0 &&
+				errno != EEXIST)
+			{
+				pg_log_error("could not create directory \"%s\": %m", outpath);
+				exit(1);
+			}
+			apply_backup(k, subpath);
+		}
+		else if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						 INCREMENTAL_PREFIX_LEN) == 0)
+			apply_incremental(k, relpath,
+							  de->d_name + INCREMENTAL_PREFIX_LEN);
+		else if (S_ISREG(st.st_mode) && !dry_run)
+			copy_file(inpath, outpath);
+	}
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", indir);
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Apply the incremental file relpath/INCREMENTAL.name of backup k to the
+ * file relpath/name of the output directory.
+ */
+static void
+apply_incremental(int k, const char *relpath, const char *name)
+{
+	char		incpath[MAXPGPATH];
+	char		outpath[MAXPGPATH];
+	char		block[BLCKSZ];
+	int			incfd;
+	int			outfd = -1;
+	struct stat st;
+	uint32	   *blocks;
+	uint32		nblocks;
+	uint32		nchanged;
+	BlockNumber oldnblocks;
+	uint32		i;
+	uint32		j;
+
+	snprintf(incpath, sizeof(incpath), "%s%s/%s%s",
+			 backups[k].path, relpath, INCREMENTAL_PREFIX, name);
+
+	incfd = open(incpath, O_RDONLY | PG_BINARY, 0);
+	if (incfd < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", incpath);
+		exit(1);
+	}
+	if (fstat(incfd, &st) != 0)
+	{
+		pg_log_error("could not stat file \"%s\": %m", incpath);
+		exit(1);
+	}
+
+	blocks = read_incremental_header(incpath, incfd, st.st_size,
+									 &nblocks, &nchanged);
+
+	/*
+	 * All blocks past the end of the file in the earlier backup are new, so
+	 * they must all be included.
+	 */
+	oldnblocks = earlier_nblocks(k, relpath, name);
+	for (i = oldnblocks, j = 0; i < nblocks; i++)
+	{
+		while (j < nchanged && blocks[j] < i)
+			j++;
+		if (j >= nchanged || blocks[j] != i)
+		{
+			pg_log_error("file \"%s\" lacks block %u, which is not in the earlier backups either",
+						 incpath, i);
+			exit(1);
+		}
+	}
+
+	if (dry_run)
+	{
+		close(incfd);
+		pg_free(blocks);
+		return;
+	}
+
+	snprintf(outpath, sizeof(outpath), "%s%s/%s", output_dir, relpath, name);
+	outfd = open(outpath, O_RDWR | PG_BINARY, 0);
+	if (outfd < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", outpath);
+		exit(1);
+	}
+	if (ftruncate(outfd, (off_t) nblocks * BLCKSZ) != 0)
+	{
+		pg_log_error("could not truncate file \"%s\": %m", outpath);
+		exit(1);
+	}
+
+	for (i = 0; i < nchanged; i++)
+	{
+		ssize_t		rc;
+
+		rc = read(incfd, block, BLCKSZ);
+		if (rc != BLCKSZ)
+		{
+			if (rc < 0)
+				pg_log_error("could not read file \"%s\": %m", incpath);
+			else
+				pg_log_error("could not read file \"%s\": read %d of %zu",
+							 incpath, (int) rc, (size_t) BLCKSZ);
+			exit(1);
+		}
+
+		errno = 0;
+		if (pg_pwrite(outfd, block, BLCKSZ,
+					  (off_t) blocks[i] * BLCKSZ) != BLCKSZ)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			pg_log_error("could not write file \"%s\": %m", outpath);
+			exit(1);
+		}
+	}
+
+	if (close(outfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", outpath);
+		exit(1);
+	}
+	close(incfd);
+	pg_free(blocks);
+}
+
+/*
+ * Return the length in blocks of relpath/name as of backup k - 1, which must
+ * have it either in full or as an incremental file.
+ */
+static BlockNumber
+earlier_nblocks(int k, const char *relpath, const char *name)
+{
+	char		path[MAXPGPATH];
+	struct stat st;
+	int			fd;
+	uint32		nblocks;
+	uint32		nchanged;
+
+	snprintf(path, sizeof(path), "%s%s/%s", backups[k - 1].path, relpath, name);
+	if (stat(path, &st) == 0)
+	{
+		if (st.st_size % BLCKSZ != 0)
+		{
+			pg_log_error("file \"%s\" has a size that is not a multiple of the block size",
+						 path);
+			exit(1);
+		}
+		return st.st_size / BLCKSZ;
+	}
+	if (errno != ENOENT)
+	{
+		pg_log_error("could not stat file \"%s\": %m", path);
+		exit(1);
+	}
+
+	snprintf(path, sizeof(path), "%s%s/%s%s",
+			 backups[k - 1].path, relpath, INCREMENTAL_PREFIX, name);
+	fd = open(path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			pg_log_error("file \"%s/%s\" is incremental in backup \"%s\", but the backup before has no such file",
+						 relpath + 1, name, backups[k].path);
+		else
+			pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		pg_log_error("could not stat file \"%s\": %m", path);
+		exit(1);
+	}
+	pg_free(read_incremental_header(path, fd, st.st_size,
+									&nblocks, &nchanged));
+	close(fd);
+
+	return nblocks;
+}
+
+/*
+ * Read and check the header of an incremental file (see basebackup.h), and
+ * return the numbers of the blocks included.  The file is left positioned
+ * at the first block.
+ */
+static uint32 *
+read_incremental_header(const char *path, int fd, off_t size,
+						uint32 *nblocks, uint32 *nchanged)
+{
+	uint32		header[3];
+	uint32	   *blocks;
+	size_t		len;
+	uint32		i;
+
+	if (read(fd, header, sizeof(header)) != sizeof(header))
+	{
+		pg_log_error("could not read file \"%s\": %m", path);
+		exit(1);
+	}
+	if (header[0] != INCREMENTAL_MAGIC)
+	{
+		pg_log_error("file \"%s\" has invalid magic number 0x%08X",
+					 path, header[0]);
+		exit(1);
+	}
+	*nchanged = header[1];
+	*nblocks = header[2];
+
+	if (*nchanged > *nblocks ||
+		size != (off_t) (sizeof(header) + sizeof(uint32) * *nchanged) +
+		(off_t) *nchanged * BLCKSZ)
+	{
+		pg_log_error("file \"%s\" has invalid size %lld for %u blocks",
+					 path, (long long int) size, *nchanged);
+		exit(1);
+	}
+
+	len = sizeof(uint32) * *nchanged;
+	blocks = pg_malloc(len + 1);
+	if (len > 0 && read(fd, blocks, len) != len)
+	{
+		pg_log_error("could not read file \"%s\": %m", path);
+		exit(1);
+	}
+
+	for (i = 0; i < *nchanged; i++)
+	{
+		if (blocks[i] >= *nblocks || (i > 0 && blocks[i] <= blocks[i - 1]))
+		{
+			pg_log_error("file \"%s\" has invalid block number %u",
+						 path, blocks[i]);
+			exit(1);
+		}
+	}
+
+	return blocks;
+}
+
+/*
+ * Write the backup label of the combined backup: that of the last backup,
+ * without the line that marks it as incremental.
+ */
+static void
+write_backup_label(BackupInfo *backup)
+{
+	char		path[MAXPGPATH];
+	FILE	   *fp;
+
+	snprintf(path, sizeof(path), "%s/backup_label", output_dir);
+	fp = fopen(path, PG_BINARY_W);
+	if (fp == NULL)
+	{
+		pg_log_error("could not create file \"%s\": %m", path);
+		exit(1);
+	}
+	if (fputs(backup->label, fp) < 0 || fclose(fp) != 0)
+	{
+		pg_log_error("could not write file \"%s\": %m", path);
+		exit(1);
+	}
+}
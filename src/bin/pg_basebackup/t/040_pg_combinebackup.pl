@@ -0,0 +1,167 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for incremental backups and pg_combinebackup
+
+use strict;
+use warnings;
+use File::Find;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 29;
+
+program_help_ok('pg_combinebackup');
+program_version_ok('pg_combinebackup');
+program_options_handling_ok('pg_combinebackup');
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init(allows_streaming => 1);
+$node->start;
+
+# A table in template1 is copied by CREATE DATABASE below, along with the
+# old LSNs of its pages.
+$node->safe_psql('template1',
+	'CREATE TABLE tmpl_tab AS SELECT g AS a FROM generate_series(1, 10000) g'
+);
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE big_tab (a int, b text) WITH (fillfactor = 50);
+INSERT INTO big_tab SELECT g, 'row ' || g FROM generate_series(1, 20000) g;
+CREATE TABLE drop_tab AS SELECT 1 AS a;
+CHECKPOINT;
+});
+
+my $backup_dir = $node->backup_dir;
+$node->backup('full');
+
+# Changes since the full backup: a few updated blocks, a new relation, a
+# dropped one, and databases created from both templates.
+$node->safe_psql(
+	'postgres', q{
+UPDATE big_tab SET b = 'updated' WHERE a IN (1, 10000);
+CREATE TABLE new_tab AS SELECT g AS a FROM generate_series(1, 1000) g;
+DROP TABLE drop_tab;
+CREATE DATABASE db_from_template1;
+CREATE DATABASE db_from_template0 TEMPLATE template0;
+});
+$node->safe_psql('db_from_template0',
+	'CREATE TABLE db0_tab AS SELECT g AS a FROM generate_series(1, 100) g');
+
+$node->backup('incr1',
+	backup_options => [ '--incremental', "$backup_dir/full" ]);
+
+# At least big_tab must have been sent as an incremental file, while the
+# files of the new databases must have been sent in full.
+my $dboid = $node->safe_psql('postgres',
+	"SELECT oid FROM pg_database WHERE datname = 'db_from_template1'");
+my (@incremental, @incremental_newdb);
+find(
+	sub {
+		return unless /^INCREMENTAL\./;
+		push @incremental, $File::Find::name;
+		push @incremental_newdb, $File::Find::name
+		  if $File::Find::dir =~ m{/base/$dboid$};
+	},
+	"$backup_dir/incr1");
+ok(@incremental > 0, 'incremental backup contains incremental files');
+is(scalar @incremental_newdb, 0,
+	'database created since the full backup is sent in full');
+
+# More changes for a second incremental backup based on the first one
+$node->safe_psql(
+	'postgres', q{
+UPDATE big_tab SET b = 'updated again' WHERE a = 20000;
+INSERT INTO new_tab SELECT g FROM generate_series(1001, 2000) g;
+});
+$node->safe_psql('db_from_template1',
+	'DELETE FROM tmpl_tab WHERE a > 5000');
+
+$node->backup('incr2',
+	backup_options => [ '--incremental', "$backup_dir/incr1" ]);
+
+# A server can't be started from an incremental backup.
+my $incr_node = PostgreSQL::Test::Cluster->new('incremental');
+$incr_node->init_from_backup($node, 'incr1');
+is($incr_node->start(fail_ok => 1), 0,
+	'server does not start from an incremental backup');
+like(
+	slurp_file($incr_node->logfile),
+	qr/cannot recover from an incremental backup/,
+	'starting from an incremental backup is refused');
+
+# The backups must be given in the right order and form a chain.
+command_fails_like(
+	[ 'pg_combinebackup', '-n', "$backup_dir/incr1", "$backup_dir/full" ],
+	qr/is an incremental backup, not a full one/,
+	'incremental backup given first');
+command_fails_like(
+	[ 'pg_combinebackup', '-n', "$backup_dir/full", "$backup_dir/incr2" ],
+	qr/is based on a backup started at/,
+	'incremental backup based on a backup not given');
+command_fails_like(
+	[ 'pg_combinebackup', '-n', "$backup_dir/full", "$backup_dir/full" ],
+	qr/is not an incremental backup/,
+	'full backup given as incremental');
+command_fails_like(
+	[ 'pg_combinebackup', "$backup_dir/full", "$backup_dir/incr1" ],
+	qr/no output directory specified/,
+	'output directory is required');
+command_fails_like(
+	[
+		'pg_combinebackup', '-o', "$backup_dir/full", "$backup_dir/full",
+		"$backup_dir/incr1"
+	],
+	qr/exists but is not empty/,
+	'output directory must be empty');
+command_ok(
+	[
+		'pg_combinebackup', '-n', "$backup_dir/full", "$backup_dir/incr1",
+		"$backup_dir/incr2"
+	],
+	'dry run succeeds');
+
+command_ok(
+	[
+		'pg_combinebackup', '-N', '-o', "$backup_dir/combined1",
+		"$backup_dir/full", "$backup_dir/incr1"
+	],
+	'combine a full and an incremental backup');
+command_ok(
+	[
+		'pg_combinebackup', '-o', "$backup_dir/combined2",
+		"$backup_dir/full", "$backup_dir/incr1", "$backup_dir/incr2"
+	],
+	'combine a full and two incremental backups');
+
+# The data in the combined backup must be that of the time of the last
+# backup; nothing was changed since.
+my %queries = (
+	postgres =>
+	  q{SELECT count(*), count(*) FILTER (WHERE b LIKE 'updated%'), md5(string_agg(b, ',' ORDER BY a)) FROM big_tab;
+SELECT count(*), sum(a) FROM new_tab;
+SELECT to_regclass('drop_tab') IS NULL},
+	db_from_template1 => 'SELECT count(*), sum(a) FROM tmpl_tab',
+	db_from_template0 => 'SELECT count(*), sum(a) FROM db0_tab');
+my %expected =
+  map { $_ => $node->safe_psql($_, $queries{$_}) } keys %queries;
+
+my $restored = PostgreSQL::Test::Cluster->new('combined');
+$restored->init_from_backup($node, 'combined2');
+$restored->start;
+
+foreach my $db (sort keys %queries)
+{
+	is($restored->safe_psql($db, $queries{$db}),
+		$expected{$db}, "data of database $db is restored");
+}
+$restored->stop;
+
+# Combining just the first incremental backup gives the state at its time.
+$restored = PostgreSQL::Test::Cluster->new('combined_first');
+$restored->init_from_backup($node, 'combined1');
+$restored->start;
+is($restored->safe_psql('postgres', 'SELECT count(*) FROM new_tab'),
+	'1000', 'first combined backup has the state of the first backup');
+$restored->stop;
+
+$node->stop;
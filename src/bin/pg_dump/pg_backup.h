@@ -129,6 +129,8 @@ typedef struct _restoreOptions
 	int			suppressDumpWarnings;	/* Suppress output of WARNING entries
 										 * to stderr */
 	bool		single_txn;
+	int			txn_size;		/* restore this many entries per transaction,
+								 * or 0 to use autocommit */
 
 	bool	   *idWanted;		/* array showing which dump IDs to emit */
 	int			enable_row_security;
@@ -149,6 +151,8 @@ typedef struct _dumpOptions
 	bool		aclsSkip;
 	const char *lockWaitTimeout;
 	int			dump_inserts;	/* 0 = COPY, otherwise rows per INSERT */
+	int			table_chunk_size;	/* split table data into chunks of this
+									 * many MB; 0 = don't */
 
 	/* flags for various command-line long options */
 	int			disable_dollar_quoting;
@@ -135,11 +135,15 @@ static void mark_restore_job_done(ArchiveHandle *AH,
 static void fix_dependencies(ArchiveHandle *AH);
 static bool has_lock_conflicts(TocEntry *te1, TocEntry *te2);
 static void repoint_table_dependencies(ArchiveHandle *AH);
+static void add_chunk_dependencies(ArchiveHandle *AH, TocEntry *te,
+								   DumpId tableid, DumpId known);
 static void identify_locking_dependencies(ArchiveHandle *AH, TocEntry *te);
 static void reduce_dependencies(ArchiveHandle *AH, TocEntry *te,
 								ParallelReadyList *ready_list);
 static void mark_create_done(ArchiveHandle *AH, TocEntry *te);
 static void inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te);
+static void start_transaction_batch(ArchiveHandle *AH);
+static void commit_transaction_batch(ArchiveHandle *AH);
 
 static void StrictNamesCheck(RestoreOptions *ropt);
 
@@ -727,6 +731,8 @@ RestoreArchive(Archive *AHX)
 		else
 			ahprintf(AH, "COMMIT;\n\n");
 	}
+	else if (ropt->txn_size > 0)
+		commit_transaction_batch(AH);
 
 	if (AH->public.verbose)
 		dumpTimestamp(AH, "Completed on", time(NULL));
@@ -774,6 +780,20 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 	/* Work out what, if anything, we want from this entry */
 	reqs = te->reqs;
 
+	/*
+	 * In --transaction-size mode, restore the entry inside the current batch,
+	 * except for a database, which cannot be created inside a transaction
+	 * block, and database properties, after which we reconnect.
+	 */
+	if (ropt->txn_size > 0 && (reqs & (REQ_SCHEMA | REQ_DATA)) != 0)
+	{
+		if (strcmp(te->desc, "DATABASE") == 0 ||
+			strcmp(te->desc, "DATABASE PROPERTIES") == 0)
+			commit_transaction_batch(AH);
+		else
+			start_transaction_batch(AH);
+	}
+
 	defnDumped = false;
 
 	/*
@@ -950,6 +970,10 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 		}
 	}
 
+	/* Commit the batch once it holds --transaction-size entries */
+	if (AH->txnCount >= 0 && ++AH->txnCount >= ropt->txn_size)
+		commit_transaction_batch(AH);
+
 	if (AH->public.n_errors > 0 && status == WORKER_OK)
 		status = WORKER_IGNORED_ERRORS;
 
@@ -1252,7 +1276,8 @@ StartRestoreBlobs(ArchiveHandle *AH)
 {
 	RestoreOptions *ropt = AH->public.ropt;
 
-	if (!ropt->single_txn)
+	/* The blobs become part of the open --transaction-size batch, if any */
+	if (!ropt->single_txn && AH->txnCount < 0)
 	{
 		if (AH->connection)
 			StartTransaction(&AH->public);
@@ -1271,7 +1296,7 @@ EndRestoreBlobs(ArchiveHandle *AH)
 {
 	RestoreOptions *ropt = AH->public.ropt;
 
-	if (!ropt->single_txn)
+	if (!ropt->single_txn && AH->txnCount < 0)
 	{
 		if (AH->connection)
 			CommitTransaction(&AH->public);
@@ -1850,6 +1875,17 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
+			/*
+			 * A table's data might have been dumped in several chunks.  We
+			 * remember only the last one here, so mark them all as chunked to
+			 * tell users of tableDataId to look for the others.
+			 */
+			if (AH->tableDataId[tableId] != 0)
+			{
+				AH->tocsByDumpId[AH->tableDataId[tableId]]->chunked = true;
+				te->chunked = true;
+			}
+
 			AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
@@ -2245,6 +2281,8 @@ _allocAH(const char *FileSpec, const ArchiveFormat fmt,
 	AH->currTablespace = NULL;	/* ditto */
 	AH->currTableAm = NULL;		/* ditto */
 
+	AH->txnCount = -1;			/* no --transaction-size batch open */
+
 	AH->toc = (TocEntry *) pg_malloc0(sizeof(TocEntry));
 
 	AH->toc->next = AH->toc;
@@ -4590,9 +4628,11 @@ repoint_table_dependencies(ArchiveHandle *AH)
 
 	for (te = AH->toc->next; te != AH->toc; te = te->next)
 	{
+		int			nOrigDeps = te->nDeps;
+
 		if (te->section != SECTION_POST_DATA)
 			continue;
-		for (i = 0; i < te->nDeps; i++)
+		for (i = 0; i < nOrigDeps; i++)
 		{
 			olddep = te->dependencies[i];
 			if (olddep <= AH->maxDumpId &&
@@ -4605,11 +4645,42 @@ repoint_table_dependencies(ArchiveHandle *AH)
 				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/*
+				 * If the table's data was dumped in chunks, the item must
+				 * wait for all of them, not just the one tableDataId knows.
+				 */
+				if (tabledatate->chunked)
+					add_chunk_dependencies(AH, te, olddep, tabledataid);
 			}
 		}
 	}
 }
 
+/*
+ * Make te depend on all TABLE DATA chunks of the given table, other than the
+ * one it already depends on, and account for their sizes in its dataLength.
+ */
+static void
+add_chunk_dependencies(ArchiveHandle *AH, TocEntry *te,
+					   DumpId tableid, DumpId known)
+{
+	TocEntry   *chunkte;
+
+	for (chunkte = AH->toc->next; chunkte != AH->toc; chunkte = chunkte->next)
+	{
+		if (!chunkte->chunked || chunkte->dumpId == known ||
+			chunkte->nDeps == 0 || chunkte->dependencies[0] != tableid)
+			continue;
+
+		te->dependencies = (DumpId *) pg_realloc(te->dependencies,
+												 (te->nDeps + 1) * sizeof(DumpId));
+		te->dependencies[te->nDeps++] = chunkte->dumpId;
+		te->depCount++;
+		te->dataLength = Max(te->dataLength, chunkte->dataLength);
+	}
+}
+
 /*
  * Identify which objects we'll need exclusive lock on in order to restore
  * the given TOC entry (*other* than the one identified by the TOC entry
@@ -4715,6 +4786,38 @@ reduce_dependencies(ArchiveHandle *AH, TocEntry *te,
 	}
 }
 
+/*
+ * Open a transaction for --transaction-size mode, unless one is open already.
+ */
+static void
+start_transaction_batch(ArchiveHandle *AH)
+{
+	if (AH->txnCount >= 0)
+		return;
+
+	if (AH->connection)
+		StartTransaction(&AH->public);
+	else
+		ahprintf(AH, "BEGIN;\n\n");
+	AH->txnCount = 0;
+}
+
+/*
+ * Commit the open --transaction-size transaction, if any.
+ */
+static void
+commit_transaction_batch(ArchiveHandle *AH)
+{
+	if (AH->txnCount < 0)
+		return;
+
+	if (AH->connection)
+		CommitTransaction(&AH->public);
+	else
+		ahprintf(AH, "COMMIT;\n\n");
+	AH->txnCount = -1;
+}
+
 /*
  * Set the created flag on the DATA member corresponding to the given
  * TABLE member
@@ -4726,7 +4829,12 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		/*
+		 * Chunked data is loaded by several jobs, so none of them may
+		 * truncate the table first.
+		 */
+		if (!ted->chunked)
+			ted->created = true;
 	}
 }
 
@@ -4745,6 +4853,17 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
 		ted->reqs = 0;
+
+		/* If the data was dumped in chunks, inhibit all of them */
+		if (ted->chunked)
+		{
+			for (ted = AH->toc->next; ted != AH->toc; ted = ted->next)
+			{
+				if (ted->chunked && ted->nDeps > 0 &&
+					ted->dependencies[0] == te->dumpId)
+					ted->reqs = 0;
+			}
+		}
 	}
 }
 
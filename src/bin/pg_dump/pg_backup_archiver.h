@@ -363,6 +363,9 @@ struct _archiveHandle
 	RestorePass restorePass;	/* used only during parallel restore */
 	struct _tocEntry *currentTE;
 	struct _tocEntry *lastErrorTE;
+
+	/* entries restored in the open --transaction-size batch, or -1 if none */
+	int			txnCount;
 };
 
 struct _tocEntry
@@ -396,6 +399,7 @@ struct _tocEntry
 	int			reqs;			/* do we need schema and/or data of object
 								 * (REQ_* bit mask) */
 	bool		created;		/* set for DATA member if TABLE was created */
+	bool		chunked;		/* DATA member is one of several for TABLE */
 
 	/* working state (needed only for parallel restore) */
 	struct _tocEntry *pending_prev; /* list links for pending-items list; */
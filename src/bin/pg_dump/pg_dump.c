@@ -403,6 +403,7 @@ main(int argc, char **argv)
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
 		{"include-foreign-data", required_argument, NULL, 11},
+		{"table-chunk-size", required_argument, NULL, 12},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -613,6 +614,13 @@ main(int argc, char **argv)
 										  optarg);
 				break;
 
+			case 12:			/* table chunk size */
+				if (!option_parse_int(optarg, "--table-chunk-size", 1,
+									  INT_MAX / 1024,
+									  &dopt.table_chunk_size))
+					exit_nicely(1);
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -1060,6 +1068,7 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-size=MB        dump data of larger tables in chunks of this size\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -2385,28 +2394,93 @@ dumpTableData(Archive *fout, const TableDataInfo *tdinfo)
 	{
 		TocEntry   *te;
 
-		te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
-						  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
-									   .namespace = tbinfo->dobj.namespace->dobj.name,
-									   .owner = tbinfo->rolname,
-									   .description = "TABLE DATA",
-									   .section = SECTION_DATA,
-									   .copyStmt = copyStmt,
-									   .deps = &(tbinfo->dobj.dumpId),
-									   .nDeps = 1,
-									   .dumpFn = dumpFn,
-									   .dumpArg = tdinfo));
+		/*
+		 * relpages is declared as "integer" in pg_class, and hence also in
+		 * TableInfo, but it's really BlockNumber a/k/a unsigned int.  Cast so
+		 * that we get the right interpretation of table sizes exceeding
+		 * INT_MAX pages.
+		 */
+		BlockNumber relpages = (BlockNumber) tbinfo->relpages;
+		BlockNumber chunkpages = 0;
 
 		/*
-		 * Set the TocEntry's dataLength in case we are doing a parallel dump
-		 * and want to order dump jobs by table size.  We choose to measure
-		 * dataLength in table pages during dump, so no scaling is needed.
-		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
+		 * If requested, split the data of a large table into chunks of
+		 * blocks, each of which becomes a TABLE DATA item of its own, so that
+		 * parallel dump and restore can work on them concurrently.  Chunks
+		 * are read with TID range scans, which servers before 14 don't have.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		if (dopt->table_chunk_size > 0 &&
+			tbinfo->relkind == RELKIND_RELATION &&
+			tdinfo->filtercond == NULL &&
+			fout->remoteVersion >= 140000)
+		{
+			chunkpages = (BlockNumber) ((uint64) dopt->table_chunk_size *
+										1024 * 1024 / BLCKSZ);
+			if (relpages <= chunkpages)
+				chunkpages = 0;
+		}
+
+		if (chunkpages == 0)
+		{
+			te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
+							  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+										   .namespace = tbinfo->dobj.namespace->dobj.name,
+										   .owner = tbinfo->rolname,
+										   .description = "TABLE DATA",
+										   .section = SECTION_DATA,
+										   .copyStmt = copyStmt,
+										   .deps = &(tbinfo->dobj.dumpId),
+										   .nDeps = 1,
+										   .dumpFn = dumpFn,
+										   .dumpArg = tdinfo));
+
+			/*
+			 * Set the TocEntry's dataLength in case we are doing a parallel
+			 * dump and want to order dump jobs by table size.  We choose to
+			 * measure dataLength in table pages during dump, so no scaling
+			 * is needed.
+			 */
+			te->dataLength = relpages;
+		}
+		else
+		{
+			BlockNumber startpage;
+
+			for (startpage = 0; startpage < relpages; startpage += chunkpages)
+			{
+				TableDataInfo *chunk = pg_malloc(sizeof(TableDataInfo));
+				bool		last = (relpages - startpage <= chunkpages);
+
+				/*
+				 * The first chunk takes the place of the whole table's data;
+				 * the others get dump IDs of their own.  The last chunk is
+				 * left open-ended, in case the table grew since we looked.
+				 */
+				*chunk = *tdinfo;
+				if (startpage > 0)
+					chunk->dobj.dumpId = createDumpId();
+				if (last)
+					chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)'",
+												 startpage);
+				else
+					chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)' AND ctid < '(%u,0)'",
+												 startpage,
+												 startpage + chunkpages);
+
+				te = ArchiveEntry(fout, chunk->dobj.catId, chunk->dobj.dumpId,
+								  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+											   .namespace = tbinfo->dobj.namespace->dobj.name,
+											   .owner = tbinfo->rolname,
+											   .description = "TABLE DATA",
+											   .section = SECTION_DATA,
+											   .copyStmt = copyStmt,
+											   .deps = &(tbinfo->dobj.dumpId),
+											   .nDeps = 1,
+											   .dumpFn = dumpFn,
+											   .dumpArg = chunk));
+				te->dataLength = last ? relpages - startpage : chunkpages;
+			}
+		}
 	}
 
 	destroyPQExpBuffer(copyBuf);
@@ -6370,6 +6444,7 @@ getTables(Archive *fout, int *numTables)
 	int			i_relhastriggers;
 	int			i_relpersistence;
 	int			i_relispopulated;
+	int			i_relisincremental;
 	int			i_relreplident;
 	int			i_relrowsec;
 	int			i_relforcerowsec;
@@ -6445,6 +6520,19 @@ getTables(Archive *fout, int *numTables)
 		appendPQExpBufferStr(query,
 							 "'t' as relispopulated, ");
 
+	if (fout->remoteVersion >= 150000)
+		appendPQExpBufferStr(query,
+							 "EXISTS (SELECT 1 FROM pg_catalog.pg_depend d "
+							 "JOIN pg_catalog.pg_trigger t ON (d.objid = t.oid) "
+							 "WHERE d.classid = 'pg_catalog.pg_trigger'::pg_catalog.regclass "
+							 "AND d.refclassid = 'pg_catalog.pg_class'::pg_catalog.regclass "
+							 "AND d.refobjid = c.oid "
+							 "AND t.tgfoid = 'pg_catalog.matview_incremental_maintenance'::pg_catalog.regproc) "
+							 "AS relisincremental, ");
+	else
+		appendPQExpBufferStr(query,
+							 "false AS relisincremental, ");
+
 	if (fout->remoteVersion >= 90400)
 		appendPQExpBufferStr(query,
 							 "c.relreplident, ");
@@ -6696,6 +6784,7 @@ getTables(Archive *fout, int *numTables)
 	i_relhastriggers = PQfnumber(res, "relhastriggers");
 	i_relpersistence = PQfnumber(res, "relpersistence");
 	i_relispopulated = PQfnumber(res, "relispopulated");
+	i_relisincremental = PQfnumber(res, "relisincremental");
 	i_relreplident = PQfnumber(res, "relreplident");
 	i_relrowsec = PQfnumber(res, "relrowsecurity");
 	i_relforcerowsec = PQfnumber(res, "relforcerowsecurity");
@@ -6765,6 +6854,7 @@ getTables(Archive *fout, int *numTables)
 		tblinfo[i].hastriggers = (strcmp(PQgetvalue(res, i, i_relhastriggers), "t") == 0);
 		tblinfo[i].relpersistence = *(PQgetvalue(res, i, i_relpersistence));
 		tblinfo[i].relispopulated = (strcmp(PQgetvalue(res, i, i_relispopulated), "t") == 0);
+		tblinfo[i].relisincremental = (strcmp(PQgetvalue(res, i, i_relisincremental), "t") == 0);
 		tblinfo[i].relreplident = *(PQgetvalue(res, i, i_relreplident));
 		tblinfo[i].rowsec = (strcmp(PQgetvalue(res, i, i_relrowsec), "t") == 0);
 		tblinfo[i].forcerowsec = (strcmp(PQgetvalue(res, i, i_relforcerowsec), "t") == 0);
@@ -15868,9 +15958,10 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 			binary_upgrade_set_pg_class_oids(fout, q,
 											 tbinfo->dobj.catId.oid, false);
 
-		appendPQExpBuffer(q, "CREATE %s%s %s",
+		appendPQExpBuffer(q, "CREATE %s%s%s %s",
 						  tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED ?
 						  "UNLOGGED " : "",
+						  tbinfo->relisincremental ? "INCREMENTAL " : "",
 						  reltypename,
 						  qualrelname);
 
@@ -16368,6 +16459,9 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 					case 'l':
 						cmname = "lz4";
 						break;
+					case 'z':
+						cmname = "zstd";
+						break;
 					default:
 						cmname = NULL;
 						break;
@@ -115,6 +115,7 @@ main(int argc, char **argv)
 		{"no-tablespaces", no_argument, &outputNoTablespaces, 1},
 		{"role", required_argument, NULL, 2},
 		{"section", required_argument, NULL, 3},
+		{"transaction-size", required_argument, NULL, 4},
 		{"strict-names", no_argument, &strict_names, 1},
 		{"use-set-session-authorization", no_argument, &use_setsessauth, 1},
 		{"no-comments", no_argument, &no_comments, 1},
@@ -284,6 +285,14 @@ main(int argc, char **argv)
 				set_dump_section(optarg, &(opts->dumpSections));
 				break;
 
+			case 4:				/* transaction size */
+				if (!option_parse_int(optarg, "--transaction-size",
+									  1, INT_MAX,
+									  &opts->txn_size))
+					exit_nicely(1);
+				opts->exit_on_error = true;
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -355,6 +364,19 @@ main(int argc, char **argv)
 		exit_nicely(1);
 	}
 
+	if (opts->single_txn && opts->txn_size > 0)
+	{
+		pg_log_error("options -1/--single-transaction and --transaction-size cannot be used together");
+		exit_nicely(1);
+	}
+
+	/* Batches are per connection, so the same goes for --transaction-size */
+	if (opts->txn_size > 0 && numWorkers > 1)
+	{
+		pg_log_error("cannot specify both --transaction-size and multiple jobs");
+		exit_nicely(1);
+	}
+
 	opts->disable_triggers = disable_triggers;
 	opts->enable_row_security = enable_row_security;
 	opts->noDataForFailedTables = no_data_for_failed_tables;
@@ -491,6 +513,7 @@ usage(const char *progname)
 	printf(_("  --section=SECTION            restore named section (pre-data, data, or post-data)\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --transaction-size=N         commit after every N objects\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
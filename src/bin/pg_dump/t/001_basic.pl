@@ -7,7 +7,7 @@ use warnings;
 use Config;
 use PostgreSQL::Test::Cluster;
 use PostgreSQL::Test::Utils;
-use Test::More tests => 82;
+use Test::More tests => 86;
 
 my $tempdir       = PostgreSQL::Test::Utils::tempdir;
 
@@ -121,6 +121,17 @@ command_fails_like(
 	qr/\Qpg_restore: error: cannot specify both --single-transaction and multiple jobs\E/,
 	'pg_restore: cannot specify both --single-transaction and multiple jobs');
 
+command_fails_like(
+	[ 'pg_restore', '--transaction-size=100', '-j3', '-f -' ],
+	qr/\Qpg_restore: error: cannot specify both --transaction-size and multiple jobs\E/,
+	'pg_restore: cannot specify both --transaction-size and multiple jobs');
+
+command_fails_like(
+	[ 'pg_restore', '-1', '--transaction-size=100', '-f -' ],
+	qr/\Qpg_restore: error: options -1\/--single-transaction and --transaction-size cannot be used together\E/,
+	'pg_restore: options -1/--single-transaction and --transaction-size cannot be used together'
+);
+
 command_fails_like(
 	[ 'pg_dump', '-Z', '-1' ],
 	qr/\Qpg_dump: error: -Z\/--compress must be in range 0..9\E/,
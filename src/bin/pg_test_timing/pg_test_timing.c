@@ -18,6 +18,7 @@ static unsigned int test_duration = 3;
 static void handle_args(int argc, char *argv[]);
 static uint64 test_timing(unsigned int duration);
 static void output(uint64 loop_count);
+static void test_tsc(unsigned int duration);
 
 /* record duration in powers of 2 microseconds */
 long long int histogram[32];
@@ -36,6 +37,8 @@ main(int argc, char *argv[])
 
 	output(loop_count);
 
+	test_tsc(test_duration);
+
 	return 0;
 }
 
@@ -206,3 +209,61 @@ output(uint64 loop_count)
 			   Max(10, len2) - 1, (double) histogram[i] * 100 / loop_count,
 			   Max(10, len3), histogram[i]);
 }
+
+/*
+ * Check the time stamp counter that the server uses to time plan nodes, if
+ * any: report its frequency and the cost of reading it, and how far the
+ * elapsed time derived from it drifts from the system clock.
+ */
+static void
+test_tsc(unsigned int duration)
+{
+	uint64		total_time;
+	int64		time_elapsed = 0;
+	uint64		loop_count = 0;
+	uint64		start_ticks,
+				end_ticks;
+	double		tsc_elapsed;
+	instr_time	start_time,
+				temp;
+
+	printf("\n");
+	if (!pg_tsc_init())
+	{
+		printf(_("The time stamp counter is not used for timing plan nodes.\n"));
+		return;
+	}
+
+	printf(_("Time stamp counter frequency: %0.3f MHz\n"),
+		   (double) pg_tsc_ticks_per_sec / 1e6);
+
+	total_time = duration > 0 ? duration * INT64CONST(1000000) : 0;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+	start_ticks = pg_get_ticks();
+
+	while (time_elapsed < total_time)
+	{
+		int			i;
+
+		/* read the counter many times per system clock reading */
+		for (i = 0; i < 1000; i++)
+			end_ticks = pg_get_ticks();
+		loop_count += 1000;
+
+		INSTR_TIME_SET_CURRENT(temp);
+		INSTR_TIME_SUBTRACT(temp, start_time);
+		time_elapsed = INSTR_TIME_GET_MICROSEC(temp);
+	}
+
+	end_ticks = pg_get_ticks();
+	INSTR_TIME_SET_CURRENT(temp);
+	INSTR_TIME_SUBTRACT(temp, start_time);
+
+	tsc_elapsed = (double) (end_ticks - start_ticks) / pg_tsc_ticks_per_sec;
+
+	printf(_("Per loop time including overhead: %0.2f ns\n"),
+		   INSTR_TIME_GET_DOUBLE(temp) * 1e9 / loop_count);
+	printf(_("Drift from system clock: %0.1f ppm\n"),
+		   (tsc_elapsed / INSTR_TIME_GET_DOUBLE(temp) - 1.0) * 1e6);
+}
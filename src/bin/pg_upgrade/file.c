@@ -9,6 +9,7 @@
 
 #include "postgres_fe.h"
 
+#include <limits.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #ifdef HAVE_COPYFILE_H
@@ -73,12 +74,24 @@ cloneFile(const char *src, const char *dst,
  *
  * Copies a relation file from src to dst.
  * schemaName/relName are relation's SQL name (used for error messages only).
+ *
+ * Where the file system supports it, the copy is made by cloning the file,
+ * which shares its blocks with the source until either file is modified, or
+ * else by copy_file_range(), which lets the kernel copy the data without
+ * passing it through user space.  Once either method has failed for lack of
+ * support, it is not tried again.
  */
 void
 copyFile(const char *src, const char *dst,
 		 const char *schemaName, const char *relName)
 {
 #ifndef WIN32
+#if defined(__linux__) && defined(FICLONE)
+	static bool try_clone = true;
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+	static bool try_copy_file_range = true;
+#endif
 	int			src_fd;
 	int			dest_fd;
 	char	   *buffer;
@@ -92,6 +105,54 @@ copyFile(const char *src, const char *dst,
 		pg_fatal("error while copying relation \"%s.%s\": could not create file \"%s\": %s\n",
 				 schemaName, relName, dst, strerror(errno));
 
+#if defined(__linux__) && defined(FICLONE)
+	if (try_clone)
+	{
+		if (ioctl(dest_fd, FICLONE, src_fd) == 0)
+		{
+			close(src_fd);
+			close(dest_fd);
+			return;
+		}
+
+		/* the destination is still empty, so just fall back to copying */
+		if (errno != EOPNOTSUPP && errno != EXDEV && errno != EINVAL &&
+			errno != ENOTTY && errno != EPERM)
+			pg_fatal("error while copying relation \"%s.%s\" (\"%s\" to \"%s\"): %s\n",
+					 schemaName, relName, src, dst, strerror(errno));
+		try_clone = false;
+	}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	while (try_copy_file_range)
+	{
+		ssize_t		nbytes = copy_file_range(src_fd, NULL, dest_fd, NULL,
+											 SSIZE_MAX, 0);
+
+		if (nbytes == 0)
+		{
+			close(src_fd);
+			close(dest_fd);
+			return;
+		}
+
+		if (nbytes < 0)
+		{
+			/*
+			 * Nothing was copied by the failed call, and both file positions
+			 * reflect what was copied before it, so the loop below can pick
+			 * up from there.
+			 */
+			if (errno != ENOSYS && errno != EXDEV && errno != EOPNOTSUPP &&
+				errno != EINVAL)
+				pg_fatal("error while copying relation \"%s.%s\" (\"%s\" to \"%s\"): %s\n",
+						 schemaName, relName, src, dst, strerror(errno));
+			try_copy_file_range = false;
+		}
+	}
+#endif
+
 	/* copy in fairly large chunks for best efficiency */
 #define COPY_BUF_SIZE (50 * BLCKSZ)
 
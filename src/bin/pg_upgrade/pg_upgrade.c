@@ -313,9 +313,24 @@ static void
 create_new_objects(void)
 {
 	int			dbnum;
+	int			txn_size;
 
 	prep_status("Restoring database schemas in the new cluster\n");
 
+	/*
+	 * Restore each database's objects in batches rather than committing each
+	 * one separately.  The locks taken by all of the concurrent restores must
+	 * fit into the shared lock table, so use smaller batches when restoring
+	 * several databases in parallel.
+	 */
+	txn_size = RESTORE_TRANSACTION_SIZE;
+	if (user_opts.jobs > 1)
+	{
+		txn_size /= user_opts.jobs;
+		/* keep some sanity if -j is huge */
+		txn_size = Max(txn_size, 10);
+	}
+
 	/*
 	 * We cannot process the template1 database concurrently with others,
 	 * because when it's transiently dropped, connection attempts would fail.
@@ -348,10 +363,12 @@ create_new_objects(void)
 				  true,
 				  true,
 				  "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+				  "--transaction-size=%d "
 				  "--dbname postgres \"%s\"",
 				  new_cluster.bindir,
 				  cluster_conn_opts(&new_cluster),
 				  create_opts,
+				  txn_size,
 				  sql_file_name);
 
 		break;					/* done once we've processed template1 */
@@ -385,10 +402,12 @@ create_new_objects(void)
 		parallel_exec_prog(log_file_name,
 						   NULL,
 						   "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+						   "--transaction-size=%d "
 						   "--dbname template1 \"%s\"",
 						   new_cluster.bindir,
 						   cluster_conn_opts(&new_cluster),
 						   create_opts,
+						   txn_size,
 						   sql_file_name);
 	}
 
@@ -22,6 +22,12 @@
 
 #define GET_MAJOR_VERSION(v)	((v) / 100)
 
+/*
+ * Number of database objects pg_restore creates per transaction, to avoid a
+ * commit per object without exhausting the lock table.
+ */
+#define RESTORE_TRANSACTION_SIZE	1000
+
 /* contains both global db information and CREATE DATABASE commands */
 #define GLOBALS_DUMP_FILE	"pg_upgrade_dump_globals.sql"
 #define DB_DUMP_FILE_MASK	"pg_upgrade_dump_%u.custom"
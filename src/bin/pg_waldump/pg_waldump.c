@@ -59,6 +59,7 @@ typedef struct Stats
 {
 	uint64		count;
 	uint64		rec_len;
+	uint64		hdr_len;
 	uint64		fpi_len;
 } Stats;
 
@@ -406,6 +407,26 @@ XLogDumpRecordLen(XLogReaderState *record, uint32 *rec_len, uint32 *fpi_len)
 	*rec_len = XLogRecGetTotalLen(record) - *fpi_len;
 }
 
+/*
+ * Calculate how much of the !FPI part of a record is taken up by headers:
+ * the record header, block reference headers and data length fields.
+ */
+static uint32
+XLogDumpRecordHeaderLen(XLogReaderState *record, uint32 rec_len)
+{
+	uint32		payload_len = XLogRecGetDataLen(record);
+	int			block_id;
+
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		if (XLogRecHasBlockRef(record, block_id) &&
+			record->blocks[block_id].has_data)
+			payload_len += record->blocks[block_id].data_len;
+	}
+
+	return rec_len - payload_len;
+}
+
 /*
  * Store per-rmgr and per-record statistics for a given record.
  */
@@ -416,6 +437,7 @@ XLogDumpCountRecord(XLogDumpConfig *config, XLogDumpStats *stats,
 	RmgrId		rmid;
 	uint8		recid;
 	uint32		rec_len;
+	uint32		hdr_len;
 	uint32		fpi_len;
 
 	stats->count++;
@@ -423,11 +445,13 @@ XLogDumpCountRecord(XLogDumpConfig *config, XLogDumpStats *stats,
 	rmid = XLogRecGetRmid(record);
 
 	XLogDumpRecordLen(record, &rec_len, &fpi_len);
+	hdr_len = XLogDumpRecordHeaderLen(record, rec_len);
 
 	/* Update per-rmgr statistics */
 
 	stats->rmgr_stats[rmid].count++;
 	stats->rmgr_stats[rmid].rec_len += rec_len;
+	stats->rmgr_stats[rmid].hdr_len += hdr_len;
 	stats->rmgr_stats[rmid].fpi_len += fpi_len;
 
 	/*
@@ -450,6 +474,7 @@ XLogDumpCountRecord(XLogDumpConfig *config, XLogDumpStats *stats,
 
 	stats->record_stats[rmid][recid].count++;
 	stats->record_stats[rmid][recid].rec_len += rec_len;
+	stats->record_stats[rmid][recid].hdr_len += hdr_len;
 	stats->record_stats[rmid][recid].fpi_len += fpi_len;
 }
 
@@ -548,6 +573,8 @@ XLogDumpDisplayRecord(XLogDumpConfig *config, XLogReaderState *record)
 						method = "pglz";
 					else if ((bimg_info & BKPIMAGE_COMPRESS_LZ4) != 0)
 						method = "lz4";
+					else if ((bimg_info & BKPIMAGE_COMPRESS_ZSTD) != 0)
+						method = "zstd";
 					else
 						method = "unknown";
 
@@ -583,11 +610,13 @@ static void
 XLogDumpStatsRow(const char *name,
 				 uint64 n, uint64 total_count,
 				 uint64 rec_len, uint64 total_rec_len,
+				 uint64 hdr_len, uint64 total_hdr_len,
 				 uint64 fpi_len, uint64 total_fpi_len,
 				 uint64 tot_len, uint64 total_len)
 {
 	double		n_pct,
 				rec_len_pct,
+				hdr_len_pct,
 				fpi_len_pct,
 				tot_len_pct;
 
@@ -599,6 +628,10 @@ XLogDumpStatsRow(const char *name,
 	if (total_rec_len != 0)
 		rec_len_pct = 100 * (double) rec_len / total_rec_len;
 
+	hdr_len_pct = 0;
+	if (total_hdr_len != 0)
+		hdr_len_pct = 100 * (double) hdr_len / total_hdr_len;
+
 	fpi_len_pct = 0;
 	if (total_fpi_len != 0)
 		fpi_len_pct = 100 * (double) fpi_len / total_fpi_len;
@@ -611,9 +644,10 @@ XLogDumpStatsRow(const char *name,
 		   "%20" INT64_MODIFIER "u (%6.02f) "
 		   "%20" INT64_MODIFIER "u (%6.02f) "
 		   "%20" INT64_MODIFIER "u (%6.02f) "
+		   "%20" INT64_MODIFIER "u (%6.02f) "
 		   "%20" INT64_MODIFIER "u (%6.02f)\n",
-		   name, n, n_pct, rec_len, rec_len_pct, fpi_len, fpi_len_pct,
-		   tot_len, tot_len_pct);
+		   name, n, n_pct, rec_len, rec_len_pct, hdr_len, hdr_len_pct,
+		   fpi_len, fpi_len_pct, tot_len, tot_len_pct);
 }
 
 
@@ -627,9 +661,11 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 				rj;
 	uint64		total_count = 0;
 	uint64		total_rec_len = 0;
+	uint64		total_hdr_len = 0;
 	uint64		total_fpi_len = 0;
 	uint64		total_len = 0;
 	double		rec_len_pct,
+				hdr_len_pct,
 				fpi_len_pct;
 
 	/*
@@ -641,6 +677,7 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 	{
 		total_count += stats->rmgr_stats[ri].count;
 		total_rec_len += stats->rmgr_stats[ri].rec_len;
+		total_hdr_len += stats->rmgr_stats[ri].hdr_len;
 		total_fpi_len += stats->rmgr_stats[ri].fpi_len;
 	}
 	total_len = total_rec_len + total_fpi_len;
@@ -650,15 +687,16 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 	 * strlen("(100.00%)")
 	 */
 
-	printf("%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n"
-		   "%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n",
-		   "Type", "N", "(%)", "Record size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
-		   "----", "-", "---", "-----------", "---", "--------", "---", "-------------", "---");
+	printf("%-27s %20s %8s %20s %8s %20s %8s %20s %8s %20s %8s\n"
+		   "%-27s %20s %8s %20s %8s %20s %8s %20s %8s %20s %8s\n",
+		   "Type", "N", "(%)", "Record size", "(%)", "Header size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
+		   "----", "-", "---", "-----------", "---", "-----------", "---", "--------", "---", "-------------", "---");
 
 	for (ri = 0; ri < RM_NEXT_ID; ri++)
 	{
 		uint64		count,
 					rec_len,
+					hdr_len,
 					fpi_len,
 					tot_len;
 		const RmgrDescData *desc = &RmgrDescTable[ri];
@@ -667,11 +705,13 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 		{
 			count = stats->rmgr_stats[ri].count;
 			rec_len = stats->rmgr_stats[ri].rec_len;
+			hdr_len = stats->rmgr_stats[ri].hdr_len;
 			fpi_len = stats->rmgr_stats[ri].fpi_len;
 			tot_len = rec_len + fpi_len;
 
 			XLogDumpStatsRow(desc->rm_name,
 							 count, total_count, rec_len, total_rec_len,
+							 hdr_len, total_hdr_len,
 							 fpi_len, total_fpi_len, tot_len, total_len);
 		}
 		else
@@ -682,6 +722,7 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 
 				count = stats->record_stats[ri][rj].count;
 				rec_len = stats->record_stats[ri][rj].rec_len;
+				hdr_len = stats->record_stats[ri][rj].hdr_len;
 				fpi_len = stats->record_stats[ri][rj].fpi_len;
 				tot_len = rec_len + fpi_len;
 
@@ -696,13 +737,14 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 
 				XLogDumpStatsRow(psprintf("%s/%s", desc->rm_name, id),
 								 count, total_count, rec_len, total_rec_len,
+								 hdr_len, total_hdr_len,
 								 fpi_len, total_fpi_len, tot_len, total_len);
 			}
 		}
 	}
 
-	printf("%-27s %20s %8s %20s %8s %20s %8s %20s\n",
-		   "", "--------", "", "--------", "", "--------", "", "--------");
+	printf("%-27s %20s %8s %20s %8s %20s %8s %20s %8s %20s\n",
+		   "", "--------", "", "--------", "", "--------", "", "--------", "", "--------");
 
 	/*
 	 * The percentages in earlier rows were calculated against the column
@@ -715,6 +757,10 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 	if (total_len != 0)
 		rec_len_pct = 100 * (double) total_rec_len / total_len;
 
+	hdr_len_pct = 0;
+	if (total_len != 0)
+		hdr_len_pct = 100 * (double) total_hdr_len / total_len;
+
 	fpi_len_pct = 0;
 	if (total_len != 0)
 		fpi_len_pct = 100 * (double) total_fpi_len / total_len;
@@ -723,9 +769,11 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 		   "%20" INT64_MODIFIER "u %-9s"
 		   "%20" INT64_MODIFIER "u %-9s"
 		   "%20" INT64_MODIFIER "u %-9s"
+		   "%20" INT64_MODIFIER "u %-9s"
 		   "%20" INT64_MODIFIER "u %-6s\n",
 		   "Total", stats->count, "",
 		   total_rec_len, psprintf("[%.02f%%]", rec_len_pct),
+		   total_hdr_len, psprintf("[%.02f%%]", hdr_len_pct),
 		   total_fpi_len, psprintf("[%.02f%%]", fpi_len_pct),
 		   total_len, "[100%]");
 }
@@ -275,6 +275,7 @@ int			nclients = 1;		/* number of clients */
 int			nthreads = 1;		/* number of threads */
 bool		is_connect;			/* establish connection for each transaction */
 bool		report_per_command; /* report per-command latencies */
+bool		report_percentiles; /* report latency percentiles */
 int			main_pid;			/* main process id used in log filename */
 
 const char *pghost = NULL;
@@ -323,6 +324,31 @@ typedef struct SimpleStats
 	double		sum2;			/* sum of squared values */
 } SimpleStats;
 
+/*
+ * Histogram of latencies, for computing percentiles.
+ *
+ * Values below LATENCY_HIST_SUB_BUCKETS microseconds have a bucket each.
+ * Above that, each power of two is split into LATENCY_HIST_SUB_BUCKETS
+ * equally wide buckets, so the relative error of any reported value is at
+ * most 1 / LATENCY_HIST_SUB_BUCKETS, whatever its magnitude.  Values of
+ * 2^LATENCY_HIST_MAX_EXP microseconds (about 19 hours) or more go into the
+ * last bucket.
+ */
+#define LATENCY_HIST_SUB_BITS	6
+#define LATENCY_HIST_SUB_BUCKETS	(1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_EXP	36
+#define LATENCY_HIST_BUCKETS \
+	((LATENCY_HIST_MAX_EXP - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS)
+
+typedef struct LatencyHistogram
+{
+	int64		count;			/* total number of values */
+	int64		buckets[LATENCY_HIST_BUCKETS];
+} LatencyHistogram;
+
+/* percentiles shown by --percentiles */
+static const double report_percentile_values[] = {50.0, 90.0, 99.0, 99.9};
+
 /*
  * The instr_time type is expensive when dealing with time arithmetic.  Define
  * a type to hold microseconds instead.  Type int64 is good enough for about
@@ -513,6 +539,7 @@ typedef struct
 									 * delays */
 
 	StatsData	stats;
+	LatencyHistogram *latency_hist; /* if report_percentiles */
 	int64		latency_late;	/* count executed but late transactions */
 } TState;
 
@@ -595,6 +622,7 @@ typedef struct ParsedScript
 	int			weight;			/* selection weight */
 	Command   **commands;		/* NULL-terminated array of Commands */
 	StatsData	stats;			/* total time spent in script */
+	LatencyHistogram *latency_hist; /* if report_percentiles */
 } ParsedScript;
 
 static ParsedScript sql_script[MAX_SCRIPTS];	/* SQL script files */
@@ -747,6 +775,7 @@ usage(void)
 		   "  --aggregate-interval=NUM aggregate data over NUM seconds\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
+		   "  --percentiles            report latency percentiles\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
 		   "  --random-seed=SEED       set random seed (\"time\", \"rand\", integer)\n"
 		   "  --sampling-rate=NUM      fraction of transactions to log (e.g., 0.01 for 1%%)\n"
@@ -1282,6 +1311,93 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->sum2 += ss->sum2;
 }
 
+/*
+ * Map a latency in microseconds to its LatencyHistogram bucket
+ */
+static int
+latencyHistBucket(double val)
+{
+	uint64		v = (val <= 0) ? 0 : (uint64) val;
+	int			exp;
+
+	if (v < LATENCY_HIST_SUB_BUCKETS)
+		return (int) v;
+
+	exp = pg_leftmost_one_pos64(v);
+	if (exp >= LATENCY_HIST_MAX_EXP)
+		return LATENCY_HIST_BUCKETS - 1;
+
+	return (exp - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS +
+		(int) (v >> (exp - LATENCY_HIST_SUB_BITS)) - LATENCY_HIST_SUB_BUCKETS;
+}
+
+/*
+ * Return the largest latency in microseconds that maps to the given bucket
+ */
+static double
+latencyHistBucketValue(int bucket)
+{
+	int			exp;
+	uint64		sub;
+
+	if (bucket < LATENCY_HIST_SUB_BUCKETS)
+		return bucket;
+
+	exp = bucket / LATENCY_HIST_SUB_BUCKETS + LATENCY_HIST_SUB_BITS - 1;
+	sub = bucket % LATENCY_HIST_SUB_BUCKETS + LATENCY_HIST_SUB_BUCKETS;
+
+	return (double) (((sub + 1) << (exp - LATENCY_HIST_SUB_BITS)) - 1);
+}
+
+/*
+ * Accumulate one value into a LatencyHistogram.
+ */
+static void
+addToLatencyHist(LatencyHistogram *hist, double val)
+{
+	hist->buckets[latencyHistBucket(val)]++;
+	hist->count++;
+}
+
+/*
+ * Merge two LatencyHistogram objects
+ */
+static void
+mergeLatencyHist(LatencyHistogram *acc, LatencyHistogram *hist)
+{
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		acc->buckets[i] += hist->buckets[i];
+	acc->count += hist->count;
+}
+
+/*
+ * Compute the given percentile of the values in a LatencyHistogram, in
+ * microseconds.  The result is capped at "max", the largest value seen, as the
+ * upper bound of the last bucket can be well above it.
+ */
+static double
+getLatencyPercentile(LatencyHistogram *hist, double percentile, double max)
+{
+	int64		rank;
+	int64		seen = 0;
+
+	if (hist->count == 0)
+		return 0.0;
+
+	rank = (int64) ceil(hist->count * percentile / 100.0);
+	if (rank < 1)
+		rank = 1;
+
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		seen += hist->buckets[i];
+		if (seen >= rank)
+			return Min(latencyHistBucketValue(i), max);
+	}
+
+	return max;
+}
+
 /*
  * Initialize a StatsData struct to mostly zeroes, with its start time set to
  * the given value.
@@ -3900,7 +4016,8 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 {
 	double		latency = 0.0,
 				lag = 0.0;
-	bool		thread_details = progress || throttle_delay || latency_limit,
+	bool		thread_details = progress || throttle_delay || latency_limit ||
+		report_percentiles,
 				detailed = thread_details || use_log || per_script_stats;
 
 	if (detailed && !skipped)
@@ -3916,6 +4033,8 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 	{
 		/* keep detailed thread stats */
 		accumStats(&thread->stats, skipped, latency, lag);
+		if (report_percentiles && !skipped)
+			addToLatencyHist(thread->latency_hist, latency);
 
 		/* count transactions over the latency limit, if needed */
 		if (latency_limit && latency > latency_limit)
@@ -3935,7 +4054,11 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 
 	/* XXX could use a mutex here, but we choose not to */
 	if (per_script_stats)
+	{
 		accumStats(&sql_script[st->use_file].stats, skipped, latency, lag);
+		if (report_percentiles && !skipped)
+			addToLatencyHist(sql_script[st->use_file].latency_hist, latency);
+	}
 }
 
 
@@ -5468,6 +5591,8 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 				stdev;
 	char		tbuf[315];
 	StatsData	cur;
+	static LatencyHistogram *cur_hist = NULL;
+	static LatencyHistogram *last_hist = NULL;
 
 	/*
 	 * Add up the statistics of all threads.
@@ -5488,6 +5613,30 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 		cur.skipped += threads[i].stats.skipped;
 	}
 
+	/*
+	 * Likewise for the latency histograms.  The histogram of the interval is
+	 * the difference between the current one and the one at the last report.
+	 */
+	if (report_percentiles)
+	{
+		if (cur_hist == NULL)
+		{
+			cur_hist = pg_malloc0(sizeof(LatencyHistogram));
+			last_hist = pg_malloc0(sizeof(LatencyHistogram));
+		}
+		else
+		{
+			LatencyHistogram *tmp = last_hist;
+
+			last_hist = cur_hist;
+			cur_hist = tmp;
+		}
+
+		memset(cur_hist, 0, sizeof(LatencyHistogram));
+		for (int i = 0; i < nthreads; i++)
+			mergeLatencyHist(cur_hist, threads[i].latency_hist);
+	}
+
 	/* we count only actually executed transactions */
 	ntx = (cur.cnt - cur.skipped) - (last->cnt - last->skipped);
 	total_run = (now - test_start) / 1000000.0;
@@ -5519,6 +5668,19 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 			"progress: %s, %.1f tps, lat %.3f ms stddev %.3f",
 			tbuf, tps, latency, stdev);
 
+	if (report_percentiles)
+	{
+		LatencyHistogram interval;
+
+		interval.count = cur_hist->count - last_hist->count;
+		for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+			interval.buckets[i] = cur_hist->buckets[i] - last_hist->buckets[i];
+
+		fprintf(stderr, ", p50 %.3f ms, p99 %.3f ms",
+				0.001 * getLatencyPercentile(&interval, 50.0, cur.latency.max),
+				0.001 * getLatencyPercentile(&interval, 99.0, cur.latency.max));
+	}
+
 	if (throttle_delay)
 	{
 		fprintf(stderr, ", lag %.3f ms", lag);
@@ -5545,6 +5707,22 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 	}
 }
 
+static void
+printLatencyPercentiles(const char *prefix, LatencyHistogram *hist,
+						SimpleStats *ss)
+{
+	if (hist->count > 0)
+	{
+		printf("%s percentiles:", prefix);
+		for (int i = 0; i < lengthof(report_percentile_values); i++)
+			printf(" %g%% = %.3f ms%s", report_percentile_values[i],
+				   0.001 * getLatencyPercentile(hist, report_percentile_values[i],
+												ss->max),
+				   i < lengthof(report_percentile_values) - 1 ? "," : "");
+		printf(", max = %.3f ms\n", 0.001 * ss->max);
+	}
+}
+
 /* print version banner */
 static void
 printVersion(PGconn *con)
@@ -5578,7 +5756,7 @@ printVersion(PGconn *con)
 
 /* print out results */
 static void
-printResults(StatsData *total,
+printResults(StatsData *total, LatencyHistogram *total_hist,
 			 pg_time_usec_t total_duration, /* benchmarking time */
 			 pg_time_usec_t conn_total_duration,	/* is_connect */
 			 pg_time_usec_t conn_elapsed_duration,	/* !is_connect */
@@ -5626,8 +5804,12 @@ printResults(StatsData *total,
 			   latency_limit / 1000.0, latency_late, ntx,
 			   (ntx > 0) ? 100.0 * latency_late / ntx : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || report_percentiles)
+	{
 		printSimpleStats("latency", &total->latency);
+		if (report_percentiles)
+			printLatencyPercentiles("latency", total_hist, &total->latency);
+	}
 	else
 	{
 		/* no measurement, show average latency computed from run time */
@@ -5694,6 +5876,10 @@ printResults(StatsData *total,
 						   100.0 * sstats->skipped / sstats->cnt);
 
 				printSimpleStats(" - latency", &sstats->latency);
+				if (report_percentiles)
+					printLatencyPercentiles(" - latency",
+											sql_script[i].latency_hist,
+											&sstats->latency);
 			}
 
 			/* Report per-command latencies */
@@ -5818,6 +6004,7 @@ main(int argc, char **argv)
 		{"show-script", required_argument, NULL, 10},
 		{"partitions", required_argument, NULL, 11},
 		{"partition-method", required_argument, NULL, 12},
+		{"percentiles", no_argument, NULL, 13},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -5844,6 +6031,7 @@ main(int argc, char **argv)
 										 * threads */
 	int64		latency_late = 0;
 	StatsData	stats;
+	LatencyHistogram total_hist;
 	int			weight;
 
 	int			i;
@@ -6171,6 +6359,10 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 13:			/* percentiles */
+				benchmarking_option_set = true;
+				report_percentiles = true;
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -6209,6 +6401,12 @@ main(int argc, char **argv)
 	if (num_scripts > 1)
 		per_script_stats = true;
 
+	if (report_percentiles && per_script_stats)
+	{
+		for (int i = 0; i < num_scripts; i++)
+			sql_script[i].latency_hist = pg_malloc0(sizeof(LatencyHistogram));
+	}
+
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
@@ -6491,6 +6689,8 @@ main(int argc, char **argv)
 		thread->logfile = NULL; /* filled in later */
 		thread->latency_late = 0;
 		initStats(&thread->stats, 0);
+		thread->latency_hist = report_percentiles ?
+			pg_malloc0(sizeof(LatencyHistogram)) : NULL;
 
 		nclients_dealt += thread->nstate;
 	}
@@ -6541,6 +6741,7 @@ main(int argc, char **argv)
 
 	/* wait for other threads and accumulate results */
 	initStats(&stats, 0);
+	memset(&total_hist, 0, sizeof(total_hist));
 	conn_total_duration = 0;
 
 	for (i = 0; i < nthreads; i++)
@@ -6561,6 +6762,8 @@ main(int argc, char **argv)
 		mergeSimpleStats(&stats.lag, &thread->stats.lag);
 		stats.cnt += thread->stats.cnt;
 		stats.skipped += thread->stats.skipped;
+		if (report_percentiles)
+			mergeLatencyHist(&total_hist, thread->latency_hist);
 		latency_late += thread->latency_late;
 		conn_total_duration += thread->conn_duration;
 
@@ -6583,7 +6786,8 @@ main(int argc, char **argv)
 	 * here encompasses all transactions so that tps shown is somehow slightly
 	 * underestimated.
 	 */
-	printResults(&stats, pg_time_now() - bench_start, conn_total_duration,
+	printResults(&stats, &total_hist,
+				 pg_time_now() - bench_start, conn_total_duration,
 				 bench_start - start_time, latency_late);
 
 	THREAD_BARRIER_DESTROY(&barrier);
@@ -1114,6 +1114,18 @@ $node->pgbench(
 	'pgbench late throttling',
 	{ '001_pgbench_sleep' => q{\sleep 2ms} });
 
+# latency percentiles, overall and per script
+$node->pgbench(
+	'-t 20 -c 2 -n --percentiles -b select-only@2 -b simple-update',
+	0,
+	[
+		qr{processed: 40/40},
+		qr{^latency percentiles: 50% = \d+\.\d{3} ms, 90% = .*, max = \d+\.\d{3} ms$}m,
+		qr{ - latency percentiles: 50% = }
+	],
+	[qr{^$}],
+	'pgbench percentiles');
+
 # return a list of files from directory $dir matching regexpr $re
 # this works around glob portability and escaping issues
 sub list_files
@@ -95,6 +95,24 @@ lex_expect(JsonParseContext ctx, JsonLexContext *lex, JsonTokenType token)
 	 (c) == '_' || \
 	 IS_HIGHBIT_SET(c))
 
+/* chars that end a run of plain chars in a string token */
+#define JSON_STRING_SPECIAL_CHAR(c) \
+	((c) == '"' || (c) == '\\' || (unsigned char) (c) < 32)
+
+/*
+ * Word-at-a-time version of JSON_STRING_SPECIAL_CHAR: nonzero if any byte of
+ * the uint64 v is a double quote, a backslash or a control character.  This
+ * uses the usual has-zero-byte and has-less-than tricks.
+ */
+#define JSON_SCAN_BROADCAST(c) \
+	(UINT64CONST(0x0101010101010101) * (unsigned char) (c))
+#define JSON_SCAN_HAS_LESS(v, n) \
+	(((v) - JSON_SCAN_BROADCAST(n)) & ~(v) & UINT64CONST(0x8080808080808080))
+#define JSON_SCAN_HAS_SPECIAL(v) \
+	(JSON_SCAN_HAS_LESS((v) ^ JSON_SCAN_BROADCAST('"'), 1) | \
+	 JSON_SCAN_HAS_LESS((v) ^ JSON_SCAN_BROADCAST('\\'), 1) | \
+	 JSON_SCAN_HAS_LESS(v, 32))
+
 /*
  * Utility function to check if a string is a valid JSON number.
  *
@@ -684,6 +702,38 @@ json_lex_string(JsonLexContext *lex)
 	len = lex->token_start - lex->input;
 	for (;;)
 	{
+		/*
+		 * Most of a typical string consists of chars that need no special
+		 * treatment; skip over a run of them, eight bytes at a time where
+		 * possible, and copy them to strval in one go.  Not after a high
+		 * surrogate, which must be followed by a low one.
+		 */
+		if (hi_surrogate == -1)
+		{
+			char	   *p = s + 1;
+			char	   *end = lex->input + lex->input_length;
+
+			while (end - p >= sizeof(uint64))
+			{
+				uint64		chunk;
+
+				memcpy(&chunk, p, sizeof(chunk));
+				if (JSON_SCAN_HAS_SPECIAL(chunk))
+					break;
+				p += sizeof(chunk);
+			}
+			while (p < end && !JSON_STRING_SPECIAL_CHAR(*p))
+				p++;
+
+			if (p > s + 1)
+			{
+				if (lex->strval != NULL)
+					appendBinaryStringInfo(lex->strval, s + 1, p - (s + 1));
+				len += p - (s + 1);
+				s = p - 1;
+			}
+		}
+
 		s++;
 		len++;
 		/* Premature end of the string. */
@@ -711,6 +711,19 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 		unsigned char ctrl = *sp++;
 		int			ctrlc;
 
+		/*
+		 * A zero control byte means the next 8 items are all literal bytes,
+		 * which is common in poorly compressible data.  Copy them in one go
+		 * when there's room in both buffers.
+		 */
+		if (ctrl == 0 && srcend - sp >= 8 && destend - dp >= 8)
+		{
+			memcpy(dp, sp, 8);
+			sp += 8;
+			dp += 8;
+			continue;
+		}
+
 		for (ctrlc = 0; ctrlc < 8 && sp < srcend && dp < destend; ctrlc++)
 		{
 			if (ctrl & 1)
@@ -1750,6 +1750,12 @@ pg_utf8_verifychar(const unsigned char *s, int len)
 	return l;
 }
 
+/*
+ * Number of bytes checked at a time by the ASCII fast path of
+ * pg_utf8_verifystr.
+ */
+#define UTF8_STRIDE_LENGTH	(2 * PG_ASCII_CHUNK_LEN)
+
 static int
 pg_utf8_verifystr(const unsigned char *s, int len)
 {
@@ -1757,23 +1763,41 @@ pg_utf8_verifystr(const unsigned char *s, int len)
 
 	while (len > 0)
 	{
-		int			l;
+		const unsigned char *stride_end;
 
-		/* fast path for ASCII-subset characters */
-		if (!IS_HIGHBIT_SET(*s))
+		/* fast path for runs of ASCII, a stride at a time */
+		if (len >= UTF8_STRIDE_LENGTH && is_valid_ascii(s, UTF8_STRIDE_LENGTH))
 		{
-			if (*s == '\0')
-				break;
-			l = 1;
+			s += UTF8_STRIDE_LENGTH;
+			len -= UTF8_STRIDE_LENGTH;
+			continue;
 		}
-		else
+
+		/*
+		 * Check character by character until we are past the stride that
+		 * failed, so that mostly non-ASCII input doesn't keep retrying the
+		 * fast path at every byte.
+		 */
+		stride_end = s + Min(len, UTF8_STRIDE_LENGTH);
+		while (s < stride_end)
 		{
-			l = pg_utf8_verifychar(s, len);
-			if (l == -1)
-				break;
+			int			l;
+
+			if (!IS_HIGHBIT_SET(*s))
+			{
+				if (*s == '\0')
+					return s - start;
+				l = 1;
+			}
+			else
+			{
+				l = pg_utf8_verifychar(s, len);
+				if (l == -1)
+					return s - start;
+			}
+			s += l;
+			len -= l;
 		}
-		s += l;
-		len -= l;
 	}
 
 	return s - start;
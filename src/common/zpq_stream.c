@@ -0,0 +1,530 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.c
+ *	  Streaming compression of the frontend/backend protocol.
+ *
+ * This is used by both the backend and libpq.  The stream owns a buffer of
+ * compressed output waiting to be written to the socket, and a buffer of
+ * compressed input read from the socket but not yet decompressed; the
+ * callers do the actual socket I/O, since they each have their own ideas
+ * about blocking and error reporting.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/common/zpq_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/zpq_stream.h"
+
+/*
+ * In backend, use palloc/pfree to ease the error handling.  In frontend,
+ * use malloc to be able to return a failure status back to the caller.
+ * Streams are used for the life of a connection, so the backend caller is
+ * expected to create them in a long-lived memory context; repalloc keeps
+ * the buffers there.
+ */
+#ifndef FRONTEND
+#define ALLOC(size) palloc(size)
+#define REALLOC(ptr, size) repalloc(ptr, size)
+#define FREE(ptr) pfree(ptr)
+#else
+#define ALLOC(size) malloc(size)
+#define REALLOC(ptr, size) realloc(ptr, size)
+#define FREE(ptr) free(ptr)
+#endif
+
+#ifdef USE_LZ4
+/* Older lz4 versions don't export this */
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX	19
+#endif
+#endif
+
+#ifdef USE_ZSTD
+/* Favor speed over ratio; the data is usually sent right away */
+#define ZPQ_ZSTD_LEVEL			1
+#endif
+
+#define ZPQ_BUFFER_SIZE			8192
+
+/* A buffer of pending data, consumed from start and filled at end */
+typedef struct ZpqBuffer
+{
+	char	   *data;
+	size_t		size;
+	size_t		start;
+	size_t		end;
+} ZpqBuffer;
+
+struct ZpqStream
+{
+	ZpqAlgorithm algorithm;
+	ZpqBuffer	tx;				/* compressed data to send */
+	ZpqBuffer	rx;				/* compressed data received */
+	bool		rx_full;		/* did the last zpq_decompress() fill dst? */
+	const char *errmsg;
+
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4_cctx;
+	LZ4F_dctx  *lz4_dctx;
+	LZ4F_preferences_t lz4_prefs;
+	bool		lz4_begun;		/* frame header written yet? */
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd_cctx;
+	ZSTD_DCtx  *zstd_dctx;
+#endif
+};
+
+static const char *const zpq_algorithm_names[] = {
+	[ZPQ_NONE] = "none",
+	[ZPQ_LZ4] = "lz4",
+	[ZPQ_ZSTD] = "zstd"
+};
+
+/*
+ * Look up a compression algorithm by name.  Returns false if the name is
+ * not known, whether or not this build supports the algorithm.
+ */
+bool
+zpq_parse_algorithm(const char *name, ZpqAlgorithm *algorithm)
+{
+	int			i;
+
+	for (i = ZPQ_LZ4; i < lengthof(zpq_algorithm_names); i++)
+	{
+		if (pg_strcasecmp(name, zpq_algorithm_names[i]) == 0)
+		{
+			*algorithm = (ZpqAlgorithm) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *
+zpq_algorithm_name(ZpqAlgorithm algorithm)
+{
+	Assert(algorithm >= ZPQ_NONE && algorithm < lengthof(zpq_algorithm_names));
+	return zpq_algorithm_names[algorithm];
+}
+
+/*
+ * Was this build compiled with support for the given algorithm?
+ */
+bool
+zpq_algorithm_supported(ZpqAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case ZPQ_NONE:
+			break;
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			return true;
+#endif
+			break;
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#endif
+			break;
+	}
+	return false;
+}
+
+/*
+ * Make room for at least "needed" more bytes at the end of a buffer,
+ * left-justifying the pending data first.  Returns false on out of memory
+ * (frontend only).
+ */
+static bool
+zpq_reserve(ZpqBuffer *buf, size_t needed)
+{
+	if (buf->start > 0)
+	{
+		if (buf->end > buf->start)
+			memmove(buf->data, buf->data + buf->start, buf->end - buf->start);
+		buf->end -= buf->start;
+		buf->start = 0;
+	}
+
+	if (buf->size - buf->end < needed)
+	{
+		size_t		newsize = buf->size;
+		char	   *newdata;
+
+		while (newsize - buf->end < needed)
+			newsize *= 2;
+		newdata = REALLOC(buf->data, newsize);
+		if (newdata == NULL)
+			return false;
+		buf->data = newdata;
+		buf->size = newsize;
+	}
+	return true;
+}
+
+/*
+ * Create a stream for the given algorithm.  Returns NULL on failure, which
+ * in the backend can only mean that the compression library refused to
+ * set up its state.
+ */
+ZpqStream *
+zpq_create(ZpqAlgorithm algorithm)
+{
+	ZpqStream  *zs;
+
+	if (!zpq_algorithm_supported(algorithm))
+		return NULL;
+
+	zs = ALLOC(sizeof(ZpqStream));
+	if (zs == NULL)
+		return NULL;
+	memset(zs, 0, sizeof(ZpqStream));
+	zs->algorithm = algorithm;
+
+	zs->tx.data = ALLOC(ZPQ_BUFFER_SIZE);
+	zs->rx.data = ALLOC(ZPQ_BUFFER_SIZE);
+	if (zs->tx.data == NULL || zs->rx.data == NULL)
+	{
+		zpq_free(zs);
+		return NULL;
+	}
+	zs->tx.size = zs->rx.size = ZPQ_BUFFER_SIZE;
+
+	switch (algorithm)
+	{
+		case ZPQ_NONE:
+			break;
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			if (LZ4F_isError(LZ4F_createCompressionContext(&zs->lz4_cctx,
+														   LZ4F_VERSION)) ||
+				LZ4F_isError(LZ4F_createDecompressionContext(&zs->lz4_dctx,
+															 LZ4F_VERSION)))
+			{
+				zpq_free(zs);
+				return NULL;
+			}
+			/* Emit each chunk right away, rather than buffering a block */
+			zs->lz4_prefs.autoFlush = 1;
+#endif
+			break;
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			zs->zstd_cctx = ZSTD_createCCtx();
+			zs->zstd_dctx = ZSTD_createDCtx();
+			if (zs->zstd_cctx == NULL || zs->zstd_dctx == NULL ||
+				ZSTD_isError(ZSTD_CCtx_setParameter(zs->zstd_cctx,
+													ZSTD_c_compressionLevel,
+													ZPQ_ZSTD_LEVEL)))
+			{
+				zpq_free(zs);
+				return NULL;
+			}
+#endif
+			break;
+	}
+
+	return zs;
+}
+
+void
+zpq_free(ZpqStream *zs)
+{
+	if (zs == NULL)
+		return;
+
+#ifdef USE_LZ4
+	if (zs->lz4_cctx)
+		LZ4F_freeCompressionContext(zs->lz4_cctx);
+	if (zs->lz4_dctx)
+		LZ4F_freeDecompressionContext(zs->lz4_dctx);
+#endif
+#ifdef USE_ZSTD
+	if (zs->zstd_cctx)
+		ZSTD_freeCCtx(zs->zstd_cctx);
+	if (zs->zstd_dctx)
+		ZSTD_freeDCtx(zs->zstd_dctx);
+#endif
+
+	if (zs->tx.data)
+		FREE(zs->tx.data);
+	if (zs->rx.data)
+		FREE(zs->rx.data);
+	FREE(zs);
+}
+
+/*
+ * Return a description of the last failure of zpq_compress() or
+ * zpq_decompress().
+ */
+const char *
+zpq_error(ZpqStream *zs)
+{
+	return zs->errmsg ? zs->errmsg : "unknown compression error";
+}
+
+/*
+ * Compress "len" bytes and flush them, appending the result to the
+ * stream's output.  Returns 0 on success, -1 on failure.
+ */
+int
+zpq_compress(ZpqStream *zs, const char *src, size_t len)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_NONE:
+			break;
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		r;
+
+				if (!zpq_reserve(&zs->tx, LZ4F_HEADER_SIZE_MAX +
+								 LZ4F_compressBound(len, &zs->lz4_prefs)))
+				{
+					zs->errmsg = "out of memory";
+					return -1;
+				}
+
+				if (!zs->lz4_begun)
+				{
+					r = LZ4F_compressBegin(zs->lz4_cctx,
+										   zs->tx.data + zs->tx.end,
+										   zs->tx.size - zs->tx.end,
+										   &zs->lz4_prefs);
+					if (LZ4F_isError(r))
+					{
+						zs->errmsg = LZ4F_getErrorName(r);
+						return -1;
+					}
+					zs->tx.end += r;
+					zs->lz4_begun = true;
+				}
+
+				r = LZ4F_compressUpdate(zs->lz4_cctx,
+										zs->tx.data + zs->tx.end,
+										zs->tx.size - zs->tx.end,
+										src, len, NULL);
+				if (!LZ4F_isError(r))
+				{
+					zs->tx.end += r;
+					r = LZ4F_flush(zs->lz4_cctx,
+								   zs->tx.data + zs->tx.end,
+								   zs->tx.size - zs->tx.end,
+								   NULL);
+				}
+				if (LZ4F_isError(r))
+				{
+					zs->errmsg = LZ4F_getErrorName(r);
+					return -1;
+				}
+				zs->tx.end += r;
+				return 0;
+			}
+#endif
+			break;
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, len, 0};
+				size_t		needed = ZSTD_compressBound(len);
+
+				/* Loop until everything has been compressed and flushed */
+				for (;;)
+				{
+					ZSTD_outBuffer out;
+					size_t		r;
+
+					if (!zpq_reserve(&zs->tx, needed))
+					{
+						zs->errmsg = "out of memory";
+						return -1;
+					}
+
+					out.dst = zs->tx.data + zs->tx.end;
+					out.size = zs->tx.size - zs->tx.end;
+					out.pos = 0;
+					r = ZSTD_compressStream2(zs->zstd_cctx, &out, &in,
+											 ZSTD_e_flush);
+					if (ZSTD_isError(r))
+					{
+						zs->errmsg = ZSTD_getErrorName(r);
+						return -1;
+					}
+					zs->tx.end += out.pos;
+					if (r == 0)
+						return 0;
+					needed = Max(r, ZPQ_BUFFER_SIZE);
+				}
+			}
+#endif
+			break;
+	}
+
+	zs->errmsg = "compression algorithm not supported by this build";
+	return -1;
+}
+
+/*
+ * Return the compressed data waiting to be sent, and its length.
+ */
+char *
+zpq_output(ZpqStream *zs, size_t *len)
+{
+	*len = zs->tx.end - zs->tx.start;
+	return zs->tx.data + zs->tx.start;
+}
+
+/*
+ * Mark "len" bytes of the compressed output as sent.
+ */
+void
+zpq_output_done(ZpqStream *zs, size_t len)
+{
+	Assert(len <= zs->tx.end - zs->tx.start);
+	zs->tx.start += len;
+	if (zs->tx.start == zs->tx.end)
+		zs->tx.start = zs->tx.end = 0;
+}
+
+/*
+ * Is there compressed output that hasn't been sent yet?
+ */
+bool
+zpq_output_pending(ZpqStream *zs)
+{
+	return zs->tx.start < zs->tx.end;
+}
+
+/*
+ * Return space to read compressed data from the socket into, at least
+ * "minspace" bytes and at least the usual socket read size.  The amount
+ * available is returned in *avail.  Returns NULL on out of memory (frontend
+ * only).
+ */
+char *
+zpq_input_space(ZpqStream *zs, size_t minspace, size_t *avail)
+{
+	if (!zpq_reserve(&zs->rx, Max(minspace, ZPQ_BUFFER_SIZE)))
+		return NULL;
+	*avail = zs->rx.size - zs->rx.end;
+	return zs->rx.data + zs->rx.end;
+}
+
+/*
+ * Mark "len" bytes of the space returned by zpq_input_space() as filled.
+ */
+void
+zpq_input_done(ZpqStream *zs, size_t len)
+{
+	Assert(len <= zs->rx.size - zs->rx.end);
+	zs->rx.end += len;
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Account for a decompression step that consumed "consumed" bytes of input
+ * and produced "produced" bytes of output into a "len" byte buffer.
+ */
+static ssize_t
+zpq_decompressed(ZpqStream *zs, size_t consumed, size_t produced, size_t len)
+{
+	zs->rx.start += consumed;
+	if (zs->rx.start == zs->rx.end)
+		zs->rx.start = zs->rx.end = 0;
+
+	/*
+	 * If the output filled dst, the decompressor may be holding more output
+	 * even if all input has been consumed.
+	 */
+	zs->rx_full = (produced == len);
+	return produced;
+}
+#endif
+
+/*
+ * Decompress received data into dst, up to "len" bytes.
+ *
+ * Returns the number of bytes produced, which is 0 if more input is needed,
+ * or -1 on failure.
+ */
+ssize_t
+zpq_decompress(ZpqStream *zs, char *dst, size_t len)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_NONE:
+			break;
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		produced = len;
+				size_t		consumed = zs->rx.end - zs->rx.start;
+				size_t		r;
+
+				r = LZ4F_decompress(zs->lz4_dctx, dst, &produced,
+									zs->rx.data + zs->rx.start, &consumed,
+									NULL);
+				if (LZ4F_isError(r))
+				{
+					zs->errmsg = LZ4F_getErrorName(r);
+					return -1;
+				}
+				return zpq_decompressed(zs, consumed, produced, len);
+			}
+#endif
+			break;
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in;
+				ZSTD_outBuffer out = {dst, len, 0};
+				size_t		r;
+
+				in.src = zs->rx.data + zs->rx.start;
+				in.size = zs->rx.end - zs->rx.start;
+				in.pos = 0;
+				r = ZSTD_decompressStream(zs->zstd_dctx, &out, &in);
+				if (ZSTD_isError(r))
+				{
+					zs->errmsg = ZSTD_getErrorName(r);
+					return -1;
+				}
+				return zpq_decompressed(zs, in.pos, out.pos, len);
+			}
+#endif
+			break;
+	}
+
+	zs->errmsg = "compression algorithm not supported by this build";
+	return -1;
+}
+
+/*
+ * Could zpq_decompress() produce more output without reading more input?
+ */
+bool
+zpq_input_pending(ZpqStream *zs)
+{
+	return zs->rx.start < zs->rx.end || zs->rx_full;
+}
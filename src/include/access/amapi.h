@@ -113,6 +113,15 @@ typedef bool (*aminsert_function) (Relation indexRelation,
 								   bool indexUnchanged,
 								   struct IndexInfo *indexInfo);
 
+/* insert a batch of tuples, without uniqueness checks */
+typedef void (*aminsertbatch_function) (Relation indexRelation,
+										Datum **values,
+										bool **isnull,
+										ItemPointer heap_tids,
+										int ntuples,
+										Relation heapRelation,
+										struct IndexInfo *indexInfo);
+
 /* bulk delete */
 typedef IndexBulkDeleteResult *(*ambulkdelete_function) (IndexVacuumInfo *info,
 														 IndexBulkDeleteResult *stats,
@@ -259,6 +268,7 @@ typedef struct IndexAmRoutine
 	ambuild_function ambuild;
 	ambuildempty_function ambuildempty;
 	aminsert_function aminsert;
+	aminsertbatch_function aminsertbatch;	/* can be NULL */
 	ambulkdelete_function ambulkdelete;
 	amvacuumcleanup_function amvacuumcleanup;
 	amcanreturn_function amcanreturn;	/* can be NULL */
@@ -0,0 +1,31 @@
+/*
+ * csnlog.h
+ *
+ * Commit sequence number log manager
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/csnlog.h
+ */
+#ifndef CSNLOG_H
+#define CSNLOG_H
+
+#include "access/transam.h"
+
+/* GUC */
+extern PGDLLIMPORT bool csn_snapshots;
+
+extern void CSNLogSetCommitSeqNo(TransactionId xid, int nsubxids,
+								 TransactionId *subxids);
+extern CommitSeqNo CSNLogGetCommitSeqNo(TransactionId xid);
+extern CommitSeqNo ReadNextCommitSeqNo(void);
+
+extern Size CSNLogShmemSize(void);
+extern void CSNLogShmemInit(void);
+extern void StartupCSNLog(TransactionId oldestActiveXID);
+extern void CheckPointCSNLog(void);
+extern void ExtendCSNLog(TransactionId newestXact);
+extern void TruncateCSNLog(TransactionId oldestXact);
+
+#endif							/* CSNLOG_H */
@@ -27,6 +27,7 @@ typedef struct GinOptions
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
 	bool		useFastUpdate;	/* use fast updates? */
 	int			pendingListCleanupSize; /* maximum size of pending list */
+	bool		autoCleanup;	/* leave pending list cleanup to autovacuum? */
 } GinOptions;
 
 #define GIN_DEFAULT_USE_FASTUPDATE	true
@@ -42,6 +43,11 @@ typedef struct GinOptions
 	 ((GinOptions *) (relation)->rd_options)->pendingListCleanupSize != -1 ? \
 	 ((GinOptions *) (relation)->rd_options)->pendingListCleanupSize : \
 	 gin_pending_list_limit)
+#define GinGetAutoCleanup(relation) \
+	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
+				 relation->rd_rel->relam == GIN_AM_OID), \
+	 (relation)->rd_options ? \
+	 ((GinOptions *) (relation)->rd_options)->autoCleanup : false)
 
 
 /* Macros for buffer lock/unlock operations */
@@ -118,6 +124,9 @@ extern bool gininsert(Relation index, Datum *values, bool *isnull,
 					  IndexUniqueCheck checkUnique,
 					  bool indexUnchanged,
 					  struct IndexInfo *indexInfo);
+extern void gininsertbatch(Relation index, Datum **values, bool **isnull,
+						   ItemPointer heap_tids, int ntuples,
+						   Relation heapRel, struct IndexInfo *indexInfo);
 extern void ginEntryInsert(GinState *ginstate,
 						   OffsetNumber attnum, Datum key, GinNullCategory category,
 						   ItemPointerData *items, uint32 nitem,
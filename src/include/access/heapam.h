@@ -22,6 +22,7 @@
 #include "access/tableam.h"
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
+#include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
@@ -63,8 +64,26 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/* read-ahead state; only used for non-parallel sequential scans */
+	ReadAheadState rs_readahead;
+
+	/*
+	 * Read stream for non-parallel sequential scans, or NULL.  heapgetpage
+	 * takes pages from it while the scan moves forward one page at a time;
+	 * rs_stream_expect is the page that would continue that pattern.  The
+	 * stream's callback hands out rs_stream_next, stopping before
+	 * rs_stream_stop.
+	 */
+	ReadStream *rs_stream;
+	BlockNumber rs_stream_expect;
+	BlockNumber rs_stream_next;
+	BlockNumber rs_stream_stop;
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
+	/* columns not needed by the scan's caller, or NULL if all are needed */
+	bool	   *rs_skipatts;
+
 	/*
 	 * For parallel scans to store page allocation data.  NULL when not
 	 * performing a parallel scan.
@@ -87,6 +106,9 @@ typedef struct IndexFetchHeapData
 
 	Buffer		xs_cbuf;		/* current heap buffer in scan, if any */
 	/* NB: if xs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
+
+	BlockNumber xs_prefetch_block;	/* last block prefetched, if any */
+	Buffer		xs_vmbuffer;	/* visibility map buffer for prefetching */
 } IndexFetchHeapData;
 
 /* Result codes for HeapTupleSatisfiesVacuum */
@@ -127,6 +149,8 @@ extern void heap_endscan(TableScanDesc scan);
 extern HeapTuple heap_getnext(TableScanDesc scan, ScanDirection direction);
 extern bool heap_getnextslot(TableScanDesc sscan,
 							 ScanDirection direction, struct TupleTableSlot *slot);
+extern void heap_set_column_projection(TableScanDesc sscan,
+									  Bitmapset *attrs);
 extern void heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 							  ItemPointer maxtid);
 extern bool heap_getnextslot_tidrange(TableScanDesc sscan,
@@ -201,6 +225,8 @@ extern void heap_vacuum_rel(Relation rel,
 extern void parallel_vacuum_main(dsm_segment *seg, shm_toc *toc);
 
 /* in heap/heapam_visibility.c */
+extern PGDLLIMPORT bool write_hint_bits;
+
 extern bool HeapTupleSatisfiesVisibility(HeapTuple stup, Snapshot snapshot,
 										 Buffer buffer);
 extern TM_Result HeapTupleSatisfiesUpdate(HeapTuple stup, CommandId curcid,
@@ -24,14 +24,23 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * A bulk insert extends the relation by more than one block at a time.  The
+ * blocks added but not yet used are next_free .. last_free, or none if
+ * next_free is InvalidBlockNumber.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+	BlockNumber next_free;		/* next block we extended by but haven't used */
+	BlockNumber last_free;		/* last such block */
+	uint32		already_extended_by;	/* # of blocks we extended by so far */
 } BulkInsertStateData;
 
+/* GUC parameter */
+extern PGDLLIMPORT bool insert_page_affinity;
 
 extern void RelationPutHeapTuple(Relation relation, Buffer buffer,
 								 HeapTuple tuple, bool token);
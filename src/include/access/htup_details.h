@@ -805,6 +805,11 @@ extern HeapTuple heap_modify_tuple_by_cols(HeapTuple tuple,
 extern void heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 							  Datum *values, bool *isnull);
 extern void heap_freetuple(HeapTuple htup);
+extern Size heap_compute_minimal_tuple_size(TupleDesc tupleDescriptor,
+											Datum *values, bool *isnull);
+extern void heap_fill_minimal_tuple(TupleDesc tupleDescriptor,
+									Datum *values, bool *isnull,
+									MinimalTuple tuple, Size len);
 extern MinimalTuple heap_form_minimal_tuple(TupleDesc tupleDescriptor,
 											Datum *values, bool *isnull);
 extern void heap_free_minimal_tuple(MinimalTuple mtup);
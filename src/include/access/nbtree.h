@@ -979,6 +979,7 @@ typedef struct BTScanPosData
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
+	int			prefetchIndex;	/* next entry to prefetch, see btgettuple */
 
 	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
@@ -1043,6 +1044,34 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/*
+	 * Workspace for skip scans, which run one primitive indexscan per
+	 * distinct value of the unconstrained first index column (see
+	 * _bt_preprocess_skip_key).  skipKeyData holds a manufactured key on the
+	 * first column followed by a copy of scan->keyData; it lives in
+	 * arrayContext, which array keys don't need in that case.
+	 */
+	bool		skipScan;		/* doing a skip scan? */
+	ScanDirection skipFinalDir; /* direction we stopped skipping in, if any */
+	ScanKey		skipKeyData;	/* input keys including the skip key */
+	StrategyNumber skipStrategy;	/* skip key's strategy before indoption */
+	FmgrInfo	skipProcs[BTMaxStrategyNumber]; /* =, <= and >= operators */
+	int			skipCount;		/* number of first-column values visited */
+	int			skipFutile;		/* ... that were on an already-read page */
+	BlockNumber skipLastPage;	/* page of last tuple returned for value */
+	StrategyNumber skipMarkStrategy;	/* skip key state at btmarkpos */
+	Datum		skipMarkValue;
+	bool		skipMarkIsNull;
+	ScanDirection skipMarkFinalDir;
+
+	/*
+	 * Leaf page most recently read by the scan, kept across rescans.  When
+	 * a rescan's starting point falls on that same page (typical for the
+	 * inner side of a nested loop whose outer keys arrive in index order),
+	 * _bt_first can skip the descent from the root.
+	 */
+	BlockNumber lastLeafPage;
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -1123,6 +1152,9 @@ extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 					 IndexUniqueCheck checkUnique,
 					 bool indexUnchanged,
 					 struct IndexInfo *indexInfo);
+extern void btinsertbatch(Relation rel, Datum **values, bool **isnull,
+						  ItemPointer heap_tids, int ntuples,
+						  Relation heapRel, struct IndexInfo *indexInfo);
 extern IndexScanDesc btbeginscan(Relation rel, int nkeys, int norderbys);
 extern Size btestimateparallelscan(void);
 extern void btinitparallelscan(void *target);
@@ -1174,6 +1206,8 @@ extern IndexTuple _bt_swap_posting(IndexTuple newitem, IndexTuple oposting,
 extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 						 IndexUniqueCheck checkUnique, bool indexUnchanged,
 						 Relation heapRel);
+extern void _bt_doinsert_batch(Relation rel, IndexTuple *itups, int nitups,
+							   Relation heapRel);
 extern void _bt_finish_split(Relation rel, Buffer lbuf, BTStack stack);
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, BlockNumber child);
 
@@ -1231,6 +1265,9 @@ extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 							   Snapshot snapshot);
+extern bool _bt_skip_find_value(IndexScanDesc scan, ScanDirection dir,
+								bool first, Datum *value, bool *isnull,
+								BlockNumber *blkno);
 
 /*
  * prototypes for functions in nbtutils.c
@@ -1242,6 +1279,12 @@ extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
+extern bool _bt_skip_scan_supported(Relation rel);
+extern void _bt_preprocess_skip_key(IndexScanDesc scan);
+extern bool _bt_start_skip_key(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_advance_skip_key(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_mark_skip_key(IndexScanDesc scan);
+extern void _bt_restore_skip_key(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
@@ -1281,6 +1324,11 @@ extern void btadjustmembers(Oid opfamilyoid,
  */
 extern IndexBuildResult *btbuild(Relation heap, Relation index,
 								 struct IndexInfo *indexInfo);
+extern void *btbuildbegin(Relation heap, Relation index,
+						  struct IndexInfo *indexInfo, int sortmem);
+extern void btbuildtuple(void *state, ItemPointer tid, Datum *values,
+						 bool *isnull, bool tupleIsAlive);
+extern IndexBuildResult *btbuildend(void *state, double reltuples);
 extern void _bt_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 #endif							/* NBTREE_H */
@@ -57,6 +57,7 @@ typedef struct ParallelWorkerContext
 extern volatile bool ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
+extern PGDLLIMPORT int parallel_worker_idle_timeout;
 
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
@@ -77,6 +78,9 @@ extern void AtEOXact_Parallel(bool isCommit);
 extern void AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId);
 extern void ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end);
 
+extern Size ParallelWorkerPoolShmemSize(void);
+extern void ParallelWorkerPoolShmemInit(void);
+
 extern void ParallelWorkerMain(Datum main_arg);
 
 #endif							/* PARALLEL_H */
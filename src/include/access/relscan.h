@@ -69,6 +69,13 @@ typedef struct ParallelTableScanDescData
 } ParallelTableScanDescData;
 typedef struct ParallelTableScanDescData *ParallelTableScanDesc;
 
+/*
+ * Number of block ranges a parallel scan of block oriented storage divides
+ * the relation into.  Each participant scans whole ranges, and helps with
+ * other participants' ranges only once no range is left unclaimed.
+ */
+#define PARALLEL_SEQSCAN_NRANGES	64
+
 /*
  * Shared state for parallel table scans, for block oriented storage.
  */
@@ -79,8 +86,10 @@ typedef struct ParallelBlockTableScanDescData
 	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
 	slock_t		phs_mutex;		/* mutual exclusion for setting startblock */
 	BlockNumber phs_startblock; /* starting block number */
-	pg_atomic_uint64 phs_nallocated;	/* number of blocks allocated to
-										 * workers so far. */
+	uint32		phs_nranges;	/* # block ranges in use */
+	pg_atomic_uint32 phs_nextrange; /* next range to hand out */
+	/* number of blocks allocated to workers so far, for each range */
+	pg_atomic_uint64 phs_nallocated[PARALLEL_SEQSCAN_NRANGES];
 }			ParallelBlockTableScanDescData;
 typedef struct ParallelBlockTableScanDescData *ParallelBlockTableScanDesc;
 
@@ -89,6 +98,7 @@ typedef struct ParallelBlockTableScanDescData *ParallelBlockTableScanDesc;
  */
 typedef struct ParallelBlockTableScanWorkerData
 {
+	int			phsw_range;		/* Current range, or -1 if none */
 	uint64		phsw_nallocated;	/* Current # of blocks into the scan */
 	uint32		phsw_chunk_remaining;	/* # blocks left in this chunk */
 	uint32		phsw_chunk_size;	/* The number of blocks to allocate in
@@ -123,6 +133,8 @@ typedef struct IndexScanDescData
 	struct ScanKeyData *orderByData;	/* array of ordering op descriptors */
 	bool		xs_want_itup;	/* caller requests index tuples */
 	bool		xs_temp_snap;	/* unregister snapshot at scan end? */
+	int			xs_prefetch_target; /* how many upcoming TIDs the AM should
+									 * pass to index_prefetch_tid(), or 0 */
 
 	/* signaling to index AM about killing index tuples */
 	bool		kill_prior_tuple;	/* last-returned tuple is dead */
@@ -33,6 +33,19 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * Buffer slots are grouped into banks of SLRU_BANK_SIZE slots each, and a
+ * given page can only be cached in the one bank selected by its page number.
+ * This bounds the cost of looking up a page or choosing a victim slot, no
+ * matter how many buffers the SLRU has.
+ */
+#define SLRU_BANK_SIZE			16
+
+/*
+ * Upper limit for the configurable SLRU buffer counts (1GB worth of pages).
+ */
+#define SLRU_MAX_ALLOWED_BUFFERS	((1024 * 1024 * 1024) / BLCKSZ)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be true only in the VALID or WRITE_IN_PROGRESS states;
@@ -57,6 +70,13 @@ typedef struct SlruSharedData
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/*
+	 * The slots are divided into num_banks banks of bank_size consecutive
+	 * slots; see SlruBankStart().  Small SLRUs have a single bank.
+	 */
+	int			num_banks;
+	int			bank_size;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
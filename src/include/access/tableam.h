@@ -355,6 +355,21 @@ typedef struct TableAmRoutine
 											  ScanDirection direction,
 											  TupleTableSlot *slot);
 
+	/*
+	 * Optional callback to tell a sequential scan which columns its caller
+	 * needs, allowing e.g. a column-oriented AM to avoid reading the others.
+	 * `attrs` contains attribute numbers offset by
+	 * FirstLowInvalidHeapAttributeNumber, as built by pull_varattnos(), and
+	 * may include system columns.  Slots must still have the relation's full
+	 * rowtype, but columns not in `attrs` may be returned as NULL.
+	 *
+	 * Called after scan_begin and before the first scan_getnextslot, and the
+	 * set applies for the rest of the scan, including after scan_rescan.  If
+	 * it's never called, all columns are needed.
+	 */
+	void		(*scan_set_column_projection) (TableScanDesc scan,
+											   Bitmapset *attrs);
+
 	/* ------------------------------------------------------------------------
 	 * Parallel table scan related functions.
 	 * ------------------------------------------------------------------------
@@ -434,6 +449,16 @@ typedef struct TableAmRoutine
 									  TupleTableSlot *slot,
 									  bool *call_again, bool *all_dead);
 
+	/*
+	 * Optional callback to hint that index_fetch_tuple() will probably be
+	 * called for `tid` soon, so the AM can start reading it in.  If
+	 * `skip_all_visible` is true, the caller is an index-only scan, which
+	 * won't fetch the tuple if the AM can tell it is visible to everyone.
+	 */
+	void		(*index_fetch_prefetch) (struct IndexFetchTableData *scan,
+										 ItemPointer tid,
+										 bool skip_all_visible);
+
 
 	/* ------------------------------------------------------------------------
 	 * Callbacks for non-modifying operations on individual tuples
@@ -1102,6 +1127,18 @@ table_scan_getnextslot_tidrange(TableScanDesc sscan, ScanDirection direction,
 															   slot);
 }
 
+/*
+ * Tell the AM which columns of the relation the caller of a sequential scan
+ * needs, see the scan_set_column_projection callback.  This is only a hint,
+ * which AMs without the callback ignore.
+ */
+static inline void
+table_scan_set_column_projection(TableScanDesc sscan, Bitmapset *attrs)
+{
+	if (sscan->rs_rd->rd_tableam->scan_set_column_projection != NULL)
+		sscan->rs_rd->rd_tableam->scan_set_column_projection(sscan, attrs);
+}
+
 
 /* ----------------------------------------------------------------------------
  * Parallel table scan related functions.
@@ -1226,6 +1263,19 @@ table_index_fetch_tuple(struct IndexFetchTableData *scan,
 													all_dead);
 }
 
+/*
+ * Hint that table_index_fetch_tuple() is likely to be called for tid soon.
+ * See the index_fetch_prefetch callback.
+ */
+static inline void
+table_index_fetch_prefetch(struct IndexFetchTableData *scan, ItemPointer tid,
+						   bool skip_all_visible)
+{
+	if (scan->rel->rd_tableam->index_fetch_prefetch != NULL)
+		scan->rel->rd_tableam->index_fetch_prefetch(scan, tid,
+													skip_all_visible);
+}
+
 /*
  * This is a convenience wrapper around table_index_fetch_tuple() which
  * returns whether there are table tuple items corresponding to an index
@@ -33,12 +33,17 @@ extern int	default_toast_compression;
  * below. We might someday support more than 4 compression methods, but
  * we can never have more than 4 values in this enum, because there are
  * only 2 bits available in the places where this is stored.
+ *
+ * zstd took the last free ID.  TOAST_INVALID_COMPRESSION_ID must stay
+ * reserved: any further method will need an extended header format that
+ * is flagged by that value, not a fifth entry here.
  */
 typedef enum ToastCompressionId
 {
 	TOAST_PGLZ_COMPRESSION_ID = 0,
 	TOAST_LZ4_COMPRESSION_ID = 1,
-	TOAST_INVALID_COMPRESSION_ID = 2
+	TOAST_ZSTD_COMPRESSION_ID = 2,
+	TOAST_INVALID_COMPRESSION_ID = 3
 } ToastCompressionId;
 
 /*
@@ -48,6 +53,7 @@ typedef enum ToastCompressionId
  */
 #define TOAST_PGLZ_COMPRESSION			'p'
 #define TOAST_LZ4_COMPRESSION			'l'
+#define TOAST_ZSTD_COMPRESSION			'z'
 #define InvalidCompressionMethod		'\0'
 
 #define CompressionMethodIsValid(cm)  ((cm) != InvalidCompressionMethod)
@@ -64,6 +70,16 @@ extern struct varlena *lz4_compress_datum(const struct varlena *value);
 extern struct varlena *lz4_decompress_datum(const struct varlena *value);
 extern struct varlena *lz4_decompress_datum_slice(const struct varlena *value,
 												  int32 slicelength);
+extern int32 lz4_maximum_compressed_size(int32 rawsize,
+										 int32 total_compressed_size);
+
+/* zstd compression/decompression routines */
+extern struct varlena *zstd_compress_datum(const struct varlena *value);
+extern struct varlena *zstd_decompress_datum(const struct varlena *value);
+extern struct varlena *zstd_decompress_datum_slice(const struct varlena *value,
+												   int32 slicelength);
+extern int32 zstd_maximum_compressed_size(int32 rawsize,
+										  int32 total_compressed_size);
 
 /* other stuff */
 extern ToastCompressionId toast_get_compression_id(struct varlena *attr);
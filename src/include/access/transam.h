@@ -67,6 +67,16 @@ typedef struct FullTransactionId
 	uint64		value;
 } FullTransactionId;
 
+/*
+ * A commit sequence number (CSN) orders the commits of transactions; see
+ * csnlog.c.  A CSN-based MVCC snapshot records the next CSN to be assigned,
+ * and sees exactly those transactions that committed with a smaller CSN.
+ */
+typedef uint64 CommitSeqNo;
+
+#define InvalidCommitSeqNo			((CommitSeqNo) 0)
+#define CommitSeqNoIsValid(csn)		((csn) != InvalidCommitSeqNo)
+
 static inline FullTransactionId
 FullTransactionIdFromEpochAndXid(uint32 epoch, TransactionId xid)
 {
@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.h
+ *		Declarations for parallel WAL redo.
+ *
+ * Portions Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/include/access/xlogparallel.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPARALLEL_H
+#define XLOGPARALLEL_H
+
+#include "access/xlogreader.h"
+
+/* GUCs */
+extern int	max_parallel_redo_workers;
+
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern void ParallelRedoSync(void);
+extern void ParallelRedoShutdown(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "catalog/objectaddress.h"
 #include "nodes/execnodes.h"
+#include "storage/shm_toc.h"
 
 
 #define DEFAULT_INDEX_TYPE	"btree"
@@ -43,10 +44,22 @@ typedef struct ReindexParams
 #define REINDEXOPT_MISSING_OK 	0x04	/* skip missing relations */
 #define REINDEXOPT_CONCURRENTLY	0x08	/* concurrent mode */
 
-/* state info for validate_index bulkdelete callback */
+/*
+ * state info for validate_index bulkdelete callback and table scan
+ *
+ * The table AM's index_validate_scan callback fetches the sorted index TIDs
+ * with validate_index_next_tid().  In a parallel validation, each participant
+ * reads them from a shared file instead of the tuplesort, and scans only the
+ * numblocks blocks starting at startblock.
+ */
 typedef struct ValidateIndexState
 {
 	Tuplesortstate *tuplesort;	/* for sorting the index TIDs */
+	struct BufFile *tidfile;	/* sorted TIDs, in a parallel validation */
+	int64		ntids;			/* number of TIDs left to read from tidfile */
+	BlockNumber startblock;		/* first table block to scan */
+	BlockNumber numblocks;		/* number of blocks, or InvalidBlockNumber to
+								 * scan the whole table */
 	/* statistics (for debug purposes only): */
 	double		htups,
 				itups,
@@ -144,6 +157,11 @@ extern void index_build(Relation heapRelation,
 
 extern void validate_index(Oid heapId, Oid indexId, Snapshot snapshot);
 
+extern bool validate_index_next_tid(ValidateIndexState *state,
+									ItemPointer tid);
+
+extern void validate_index_parallel_main(dsm_segment *seg, shm_toc *toc);
+
 extern void index_set_state_flags(Oid indexId, IndexStateFlagsAction action);
 
 extern Oid	IndexGetRelation(Oid indexId, bool missing_ok);
@@ -167,9 +167,9 @@ typedef struct VacAttrStats
 	 * looked at by type-specific functions.
 	 */
 	int			tupattnum;		/* attribute number within tuples */
-	HeapTuple  *rows;			/* access info for std fetch function */
+	HeapTuple  *rows;			/* the sample rows */
 	TupleDesc	tupDesc;
-	Datum	   *exprvals;		/* access info for index fetch function */
+	Datum	   *exprvals;		/* access info for fetch function */
 	bool	   *exprnulls;
 	int			rowstride;
 } VacAttrStats;
@@ -183,6 +183,7 @@ typedef struct VacAttrStats
 #define VACOPT_SKIP_LOCKED 0x20 /* skip if cannot get lock */
 #define VACOPT_PROCESS_TOAST 0x40	/* process the TOAST table, if any */
 #define VACOPT_DISABLE_PAGE_SKIPPING 0x80	/* don't skip any pages */
+#define VACOPT_ALLOW_READS 0x100	/* allow reads during most of FULL */
 
 /*
  * Values used by index_cleanup and truncate params.
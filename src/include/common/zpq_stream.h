@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.h
+ *	  Streaming compression of the frontend/backend protocol.
+ *
+ * A ZpqStream compresses the data sent over a connection and decompresses
+ * the data received from it.  Each direction is a single never-ending
+ * compressed stream, flushed after every chunk handed to zpq_compress(), so
+ * that the peer can decode each message as soon as it arrives.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		  src/include/common/zpq_stream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef ZPQ_STREAM_H
+#define ZPQ_STREAM_H
+
+typedef enum ZpqAlgorithm
+{
+	ZPQ_NONE = 0,
+	ZPQ_LZ4,
+	ZPQ_ZSTD
+} ZpqAlgorithm;
+
+/* opaque stream state, private to zpq_stream.c */
+typedef struct ZpqStream ZpqStream;
+
+extern bool zpq_parse_algorithm(const char *name, ZpqAlgorithm *algorithm);
+extern const char *zpq_algorithm_name(ZpqAlgorithm algorithm);
+extern bool zpq_algorithm_supported(ZpqAlgorithm algorithm);
+
+extern ZpqStream *zpq_create(ZpqAlgorithm algorithm);
+extern void zpq_free(ZpqStream *zs);
+extern const char *zpq_error(ZpqStream *zs);
+
+/* sending side */
+extern int	zpq_compress(ZpqStream *zs, const char *src, size_t len);
+extern char *zpq_output(ZpqStream *zs, size_t *len);
+extern void zpq_output_done(ZpqStream *zs, size_t len);
+extern bool zpq_output_pending(ZpqStream *zs);
+
+/* receiving side */
+extern char *zpq_input_space(ZpqStream *zs, size_t minspace, size_t *avail);
+extern void zpq_input_done(ZpqStream *zs, size_t len);
+extern ssize_t zpq_decompress(ZpqStream *zs, char *dst, size_t len);
+extern bool zpq_input_pending(ZpqStream *zs);
+
+#endif							/* ZPQ_STREAM_H */
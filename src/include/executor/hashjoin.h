@@ -14,6 +14,7 @@
 #ifndef HASHJOIN_H
 #define HASHJOIN_H
 
+#include "lib/bloomfilter.h"
 #include "nodes/execnodes.h"
 #include "port/atomics.h"
 #include "storage/barrier.h"
@@ -348,6 +349,11 @@ typedef struct HashJoinTableData
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
 
+	/* optional Bloom filter over the hash values of all inner tuples */
+	bloom_filter *bloomFilter;	/* NULL if not in use */
+	int64		bloomProbes;	/* # of outer tuples checked against it */
+	int64		bloomRejects;	/* # of those it proved had no match */
+
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
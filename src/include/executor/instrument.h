@@ -58,6 +58,7 @@ typedef enum InstrumentOption
 	INSTRUMENT_BUFFERS = 1 << 1,	/* needs buffer usage */
 	INSTRUMENT_ROWS = 1 << 2,	/* needs row count */
 	INSTRUMENT_WAL = 1 << 3,	/* needs WAL usage */
+	INSTRUMENT_WAITS = 1 << 4,	/* needs wait event time */
 	INSTRUMENT_ALL = PG_INT32_MAX
 } InstrumentOption;
 
@@ -67,15 +68,21 @@ typedef struct Instrumentation
 	bool		need_timer;		/* true if we need timer data */
 	bool		need_bufusage;	/* true if we need buffer usage data */
 	bool		need_walusage;	/* true if we need WAL usage data */
+	bool		need_waits;		/* true if we need wait event time */
 	bool		async_mode;		/* true if node is in async mode */
+	int			sample_interval;	/* if > 1, time only every Nth iteration */
 	/* Info about current plan cycle: */
 	bool		running;		/* true if we've completed first tuple */
-	instr_time	starttime;		/* start time of current iteration of node */
-	instr_time	counter;		/* accumulated runtime for this node */
+	uint64		starttime;		/* start of current iteration, in ticks */
+	uint64		counter;		/* accumulated runtime for this node, in
+								 * ticks */
+	uint64		niterations;	/* # of iterations started this cycle */
+	uint64		ntimed;			/* # of those that were timed */
 	double		firsttuple;		/* time for first tuple of this cycle */
 	double		tuplecount;		/* # of tuples emitted so far this cycle */
 	BufferUsage bufusage_start; /* buffer usage at start */
 	WalUsage	walusage_start; /* WAL usage at start */
+	uint64		wait_ticks_start;	/* pgStatWaitTicks at start */
 	/* Accumulated statistics across all completed cycles: */
 	double		startup;		/* total startup time (in seconds) */
 	double		total;			/* total time (in seconds) */
@@ -86,6 +93,7 @@ typedef struct Instrumentation
 	double		nfiltered2;		/* # of tuples removed by "other" quals */
 	BufferUsage bufusage;		/* total buffer usage */
 	WalUsage	walusage;		/* total WAL usage */
+	uint64		wait_ticks;		/* total time in timed waits, in ticks */
 } Instrumentation;
 
 typedef struct WorkerInstrumentation
@@ -97,6 +105,9 @@ typedef struct WorkerInstrumentation
 extern PGDLLIMPORT BufferUsage pgBufferUsage;
 extern PGDLLIMPORT WalUsage pgWalUsage;
 
+/* GUC parameter */
+extern PGDLLIMPORT int explain_timing_sample_interval;
+
 extern Instrumentation *InstrAlloc(int n, int instrument_options,
 								   bool async_mode);
 extern void InstrInit(Instrumentation *instr, int instrument_options);
@@ -44,4 +44,9 @@ extern bool ExecIndexEvalArrayKeys(ExprContext *econtext,
 								   IndexArrayKeyInfo *arrayKeys, int numArrayKeys);
 extern bool ExecIndexAdvanceArrayKeys(IndexArrayKeyInfo *arrayKeys, int numArrayKeys);
 
+/* Used by nodeMergejoin.c to reposition inner index scans */
+extern ScanKey ExecIndexAddSkipKey(ScanKey *scanKeys, int *numScanKeys,
+								   IndexRuntimeKeyInfo *runtimeKeys,
+								   int numRuntimeKeys);
+
 #endif							/* NODEINDEXSCAN_H */
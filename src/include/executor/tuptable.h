@@ -265,6 +265,14 @@ typedef struct BufferHeapTupleTableSlot
 	 * such a case, since presumably tts_tuple is pointing into the buffer.)
 	 */
 	Buffer		buffer;			/* tuple's buffer, or InvalidBuffer */
+
+	/*
+	 * If skipatts is not NULL, columns for which it's true are not needed by
+	 * anyone reading this tuple, and are deformed as NULL without fetching
+	 * them.  It is set by the table AM after storing each tuple, and reset
+	 * when the slot is cleared.
+	 */
+	const bool *skipatts;
 } BufferHeapTupleTableSlot;
 
 typedef struct MinimalTupleTableSlot
@@ -59,6 +59,21 @@ typedef struct dshash_parameters
 struct dshash_table_item;
 typedef struct dshash_table_item dshash_table_item;
 
+/*
+ * Status of a sequential scan, see dshash_seq_init.  The members are private
+ * to dshash.c.
+ */
+typedef struct dshash_seq_status
+{
+	dshash_table *hash_table;	/* table being scanned */
+	int			curbucket;		/* index of the current bucket */
+	int			nbuckets;		/* number of buckets in curpartition */
+	dshash_table_item *curitem; /* item last returned, if any */
+	dsa_pointer pnextitem;		/* item following curitem */
+	int			curpartition;	/* partition we hold a lock on, or -1 */
+	bool		exclusive;		/* locking partitions exclusively? */
+} dshash_seq_status;
+
 /* Creating, sharing and destroying from hash tables. */
 extern dshash_table *dshash_create(dsa_area *area,
 								   const dshash_parameters *params,
@@ -74,12 +89,21 @@ extern void dshash_destroy(dshash_table *hash_table);
 /* Finding, creating, deleting entries. */
 extern void *dshash_find(dshash_table *hash_table,
 						 const void *key, bool exclusive);
+extern bool dshash_find_copy(dshash_table *hash_table,
+							 const void *key, void *entry);
 extern void *dshash_find_or_insert(dshash_table *hash_table,
 								   const void *key, bool *found);
 extern bool dshash_delete_key(dshash_table *hash_table, const void *key);
 extern void dshash_delete_entry(dshash_table *hash_table, void *entry);
 extern void dshash_release_lock(dshash_table *hash_table, void *entry);
 
+/* Sequential scans. */
+extern void dshash_seq_init(dshash_seq_status *status,
+							dshash_table *hash_table, bool exclusive);
+extern void *dshash_seq_next(dshash_seq_status *status);
+extern void dshash_seq_term(dshash_seq_status *status);
+extern void dshash_delete_current(dshash_seq_status *status);
+
 /* Convenience hash and compare functions wrapping memcmp and tag_hash. */
 extern int	dshash_memcmp(const void *a, const void *b, size_t size, void *arg);
 extern dshash_hash dshash_memhash(const void *v, size_t size, void *arg);
@@ -81,6 +81,10 @@ extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
 extern int	pq_putmessage_v2(char msgtype, const char *s, size_t len);
 extern bool pq_check_connection(void);
+extern void pq_start_compression(Port *port);
+
+/* bitmask of ZpqAlgorithms allowed by protocol_compression */
+extern int	protocol_compression_methods;
 
 /*
  * prototypes for functions in be-secure.c
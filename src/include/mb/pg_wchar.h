@@ -559,6 +559,49 @@ surrogate_pair_to_codepoint(pg_wchar first, pg_wchar second)
 	return ((first & 0x3FF) << 10) + 0x10000 + (second & 0x3FF);
 }
 
+/*
+ * Verify a chunk of bytes for valid ASCII, a word at a time.
+ *
+ * Returns false if the input contains any zero bytes or bytes with the
+ * high bit set.  len must be a multiple of PG_ASCII_CHUNK_LEN.
+ */
+#define PG_ASCII_CHUNK_LEN	sizeof(uint64)
+
+static inline bool
+is_valid_ascii(const unsigned char *s, int len)
+{
+	uint64		chunk,
+				highbit_cum = UINT64CONST(0),
+				zero_cum = UINT64CONST(0x8080808080808080);
+
+	Assert(len % PG_ASCII_CHUNK_LEN == 0);
+
+	while (len > 0)
+	{
+		memcpy(&chunk, s, sizeof(chunk));
+
+		/* capture any set high bits */
+		highbit_cum |= chunk;
+
+		/*
+		 * Adding 0x7F to each byte sets its high bit unless the byte was
+		 * zero.  This can't carry into the next byte as long as no high bits
+		 * were set, which is checked separately below.
+		 */
+		zero_cum &= (chunk + UINT64CONST(0x7f7f7f7f7f7f7f7f));
+
+		s += sizeof(chunk);
+		len -= sizeof(chunk);
+	}
+
+	if (highbit_cum & UINT64CONST(0x8080808080808080))
+		return false;
+	if (zero_cum != UINT64CONST(0x8080808080808080))
+		return false;
+
+	return true;
+}
+
 
 /*
  * These functions are considered part of libpq's exported API and
@@ -114,6 +114,9 @@ typedef struct ExprState
 
 	Datum	   *innermost_domainval;
 	bool	   *innermost_domainnull;
+
+	List	   *cse_entries;	/* common subexpressions of a projection */
+	bool		cse_unconditional;	/* compiling unconditional part? */
 } ExprState;
 
 
@@ -539,6 +542,7 @@ typedef struct AsyncRequest
 	struct PlanState *requestee;	/* Node from which a tuple is wanted */
 	int			request_index;	/* Scratch space for requestor */
 	bool		callback_pending;	/* Callback is needed */
+	bool		wait_latch;		/* Callback is needed when MyLatch is set */
 	bool		request_complete;	/* Request complete, result valid */
 	TupleTableSlot *result;		/* Result (NULL or an empty slot if no more
 								 * tuples) */
@@ -953,6 +957,33 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 TupleBatch
+ *
+ * A group of tuples returned at once by a node's ExecProcNodeBatch method.
+ * slots[0 .. nvalid-1] hold the tuples; they are owned by the producing
+ * node and stay valid only until its next ExecProcNodeBatch call or rescan.
+ * A batch with nvalid == 0 means no more tuples are available.
+ * ----------------
+ */
+typedef struct TupleBatch
+{
+	int			nvalid;			/* number of valid tuples in slots[] */
+	int			maxslots;		/* allocated length of slots[] */
+	TupleTableSlot **slots;		/* the tuples themselves */
+} TupleBatch;
+
+/* ----------------
+ *	 ExecProcNodeBatchMtd
+ *
+ * Optional method returning a batch of tuples from an executor node, used by
+ * consumers that can process several input tuples per call.  Nodes that
+ * don't support batches leave this NULL, and callers must then use the
+ * tuple-at-a-time ExecProcNode protocol.
+ * ----------------
+ */
+typedef TupleBatch *(*ExecProcNodeBatchMtd) (struct PlanState *pstate);
+
 /* ----------------
  *		PlanState node
  *
@@ -973,6 +1004,9 @@ typedef struct PlanState
 	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
 	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
 										 * wrapper */
+	ExecProcNodeBatchMtd ExecProcNodeBatch; /* function to return next batch
+											 * of tuples, or NULL if not
+											 * supported */
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
@@ -1379,6 +1413,9 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	struct SortState *ss_TopNSort;	/* bounded Sort above, to discard tuples
+									 * it would reject, or NULL */
+	AttrNumber	ss_TopNAttno;	/* scan tuple column of its leading key */
 } ScanState;
 
 /* ----------------
@@ -1389,6 +1426,8 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	TupleBatch *batch;			/* tuples returned by ExecSeqScanBatch */
+	Bitmapset  *scan_attrs;		/* columns needed, or NULL if all are */
 } SeqScanState;
 
 /* ----------------
@@ -1945,6 +1984,11 @@ typedef struct NestLoopState
  *		NullInnerTupleSlot prepared null tuple for left outer joins
  *		OuterEContext	   workspace for computing outer tuple's join values
  *		InnerEContext	   workspace for computing inner tuple's join values
+ *		InnerSkipKey	   inner index scan's key used to skip ahead, or NULL
+ *		InnerSkipTemplate  InnerSkipKey as it is set for skipping ahead
+ *		InnerSkipByVal	   is the outer key type pass-by-value?
+ *		InnerSkipTypLen	   typlen of the outer key type
+ *		InnerSkipCount	   inner tuples skipped one at a time since last match
  * ----------------
  */
 /* private in nodeMergejoin.c: */
@@ -1970,6 +2014,11 @@ typedef struct MergeJoinState
 	TupleTableSlot *mj_NullInnerTupleSlot;
 	ExprContext *mj_OuterEContext;
 	ExprContext *mj_InnerEContext;
+	struct ScanKeyData *mj_InnerSkipKey;
+	struct ScanKeyData *mj_InnerSkipTemplate;
+	bool		mj_InnerSkipByVal;
+	int16		mj_InnerSkipTypLen;
+	int			mj_InnerSkipCount;
 } MergeJoinState;
 
 /* ----------------
@@ -2111,6 +2160,10 @@ typedef struct MemoizeState
 								 * complete after caching the first tuple. */
 	MemoizeInstrumentation stats;	/* execution statistics */
 	SharedMemoizeInfo *shared_info; /* statistics for parallel workers */
+	struct ParallelMemoizeState *pstate;	/* shared cache, if parallel
+											 * aware */
+	char	   *shared_next;	/* next tuple to return from a shared entry */
+	uint32		shared_remaining;	/* number of tuples left in it */
 } MemoizeState;
 
 /* ----------------
@@ -2127,12 +2180,32 @@ typedef struct PresortedKeyData
 	OffsetNumber attno;			/* attribute number in tuple */
 } PresortedKeyData;
 
+/* ----------------
+ *	 Top-N threshold shared by the participants of a parallel bounded sort
+ *
+ *	 value is the leading key of the worst tuple the best of the participants'
+ *	 bounded heaps currently holds; only pass-by-value keys are shared.
+ *	 generation is advanced on every change, so that participants can compare
+ *	 keys without holding the spinlock.
+ * ----------------
+ */
+typedef struct SharedSortThreshold
+{
+	slock_t		mutex;
+	bool		enabled;		/* is the threshold shared at all? */
+	bool		valid;			/* has a participant set it yet? */
+	bool		isnull;
+	uint64		generation;
+	Datum		value;
+} SharedSortThreshold;
+
 /* ----------------
  *	 Shared memory container for per-worker sort information
  * ----------------
  */
 typedef struct SharedSortInfo
 {
+	SharedSortThreshold threshold;
 	int			num_workers;
 	TuplesortInstrumentation sinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedSortInfo;
@@ -2154,6 +2227,14 @@ typedef struct SortState
 	bool		am_worker;		/* are we a worker? */
 	bool		datumSort;		/* Datum sort instead of tuple sort? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	SharedSortThreshold *shared_threshold;	/* in DSM, or NULL */
+	bool		topn_active;	/* discarding tuples the bound excludes? */
+	SortSupport topn_sortkey;	/* leading sort key, for doing so */
+	ScanState  *topn_scan;		/* scan doing it for us, or NULL */
+	uint32		topn_count;		/* tuples sorted, for sharing threshold */
+	bool		topn_shared_valid;	/* last seen shared threshold */
+	bool		topn_shared_isnull;
+	Datum		topn_shared_value;
 } SortState;
 
 /* ----------------
@@ -2207,6 +2288,7 @@ typedef struct IncrementalSortState
 	int64		bound_Done;		/* value of bound we did the sort with */
 	IncrementalSortExecutionStatus execution_status;
 	int64		n_fullsort_remaining;
+	int64		fullsort_group_size;	/* current minimum full sort batch */
 	Tuplesortstate *fullsort_state; /* private state of tuplesort.c */
 	Tuplesortstate *prefixsort_state;	/* private state of tuplesort.c */
 	/* the keys by which the input path is already sorted */
@@ -2326,6 +2408,11 @@ typedef struct AggState
 	bool		hash_ever_spilled;	/* ever spilled during this execution? */
 	bool		hash_spill_mode;	/* we hit a limit during the current batch
 									 * and we must not create new groups */
+	bool		hash_early_emit;	/* emit groups instead of spilling? */
+	bool		hash_emit_pending;	/* hit a limit; emit the table, then
+									 * continue reading input */
+	bool		hash_ever_emitted;	/* ever emitted early during this
+									 * execution? */
 	Size		hash_mem_limit; /* limit before spilling hash table */
 	uint64		hash_ngroups_limit; /* limit before spilling hash table */
 	int			hash_planned_partitions;	/* number of partitions planned
@@ -2347,6 +2434,10 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+	/* these fields are used if the outer plan returns batches: */
+	bool		use_input_batch;	/* fetch outer tuples in batches? */
+	TupleBatch *input_batch;	/* current batch, or NULL if none */
+	int			input_batch_next;	/* next tuple to return from batch */
 } AggState;
 
 /* ----------------
@@ -2505,6 +2596,28 @@ typedef struct GatherMergeState
 	struct binaryheap *gm_heap; /* binary heap of slot indices */
 } GatherMergeState;
 
+/* ----------------
+ * RedistributeState information
+ *
+ *		Redistribute nodes run their subplan to completion in each parallel
+ *		participant, writing its output to shared partitions by hash value,
+ *		and then return the rows of the partitions they claim.
+ * ----------------
+ */
+struct ParallelRedistributeState;	/* private in nodeRedistribute.c */
+struct SharedTuplestoreAccessor;
+
+typedef struct RedistributeState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	FmgrInfo   *hashfunctions;	/* per-column hash functions */
+	struct ParallelRedistributeState *pstate;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor **accessors;	/* one per partition */
+	bool		attached;		/* attached to the shared barrier yet? */
+	bool		detached;		/* done with all partitions? */
+	int			curpartition;	/* partition being returned, or -1 */
+} RedistributeState;
+
 /* ----------------
  *	 Values displayed by EXPLAIN ANALYZE
  * ----------------
@@ -2555,6 +2668,11 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Run-time filters published to the outer side, see nodeHash.c */
+	int			nfilters;		/* number of filters */
+	struct HashRuntimeFilter *filters;	/* array of nfilters entries */
+	Bitmapset  *filterParams;	/* PARAM_EXEC ids they set */
 } HashState;
 
 /* ----------------
@@ -83,6 +83,7 @@ typedef enum NodeTag
 	T_Unique,
 	T_Gather,
 	T_GatherMerge,
+	T_Redistribute,
 	T_Hash,
 	T_SetOp,
 	T_LockRows,
@@ -142,6 +143,7 @@ typedef enum NodeTag
 	T_UniqueState,
 	T_GatherState,
 	T_GatherMergeState,
+	T_RedistributeState,
 	T_HashState,
 	T_SetOpState,
 	T_LockRowsState,
@@ -247,6 +249,7 @@ typedef enum NodeTag
 	T_UniquePath,
 	T_GatherPath,
 	T_GatherMergePath,
+	T_RedistributePath,
 	T_ProjectionPath,
 	T_ProjectSetPath,
 	T_SortPath,
@@ -286,6 +289,7 @@ typedef enum NodeTag
 	T_AllocSetContext,
 	T_SlabContext,
 	T_GenerationContext,
+	T_BumpContext,
 
 	/*
 	 * TAGS FOR VALUE NODES (value.h)
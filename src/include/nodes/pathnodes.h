@@ -1573,6 +1573,18 @@ typedef struct GatherMergePath
 	int			num_workers;	/* number of workers sought to help */
 } GatherMergePath;
 
+/*
+ * RedistributePath repartitions the rows of a partial path among the
+ * participants of the parallel query, by a hash of the columns listed in
+ * distClauses (a list of hashable SortGroupClauses).
+ */
+typedef struct RedistributePath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each participant */
+	List	   *distClauses;	/* columns to distribute the rows by */
+} RedistributePath;
+
 
 /*
  * All join-type paths share these fields.
@@ -955,6 +955,24 @@ typedef struct GatherMerge
 								 * at gather merge or one of it's child node */
 } GatherMerge;
 
+/* ------------
+ *		redistribute node
+ *
+ * Within a parallel plan, Redistribute collects its subplan's output from all
+ * participants and hands it out again, partitioned by a hash of the given
+ * columns, so that rows with equal values there are all returned by the same
+ * participant.  It is always marked parallel_aware.
+ * ------------
+ */
+typedef struct Redistribute
+{
+	Plan		plan;
+	int			numCols;		/* number of columns to hash on */
+	AttrNumber *hashColIdx;		/* their indexes in the target list */
+	Oid		   *hashOperators;	/* equality operators to hash them for */
+	Oid		   *hashCollations; /* collations to hash them with */
+} Redistribute;
+
 /* ----------------
  *		hash build node
  *
@@ -977,6 +995,18 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	/* all other info is in the parent HashJoin node */
 	Cardinality	rows_total;		/* estimate total rows if parallel_aware */
+
+	/*
+	 * Run-time filters: for each listed hash key, the Hash node sets a pair
+	 * of PARAM_EXEC Params to the smallest and largest value of that key in
+	 * the inner relation, once it has been built.  The outer side of the
+	 * join uses them for run-time partition pruning.
+	 */
+	List	   *filterKeys;		/* integer list of indexes into hashkeys */
+	List	   *filterSortOps;	/* OIDs of "<" operators ordering the keys */
+	List	   *filterCollations;	/* OIDs of collations for the comparisons */
+	List	   *filterMinParams;	/* integer list of PARAM_EXEC ids for min */
+	List	   *filterMaxParams;	/* integer list of PARAM_EXEC ids for max */
 } Hash;
 
 /* ----------------
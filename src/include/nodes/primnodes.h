@@ -116,6 +116,7 @@ typedef struct IntoClause
 	OnCommitAction onCommit;	/* what do we do at COMMIT? */
 	char	   *tableSpaceName; /* table space to use, or NULL */
 	Node	   *viewQuery;		/* materialized view's SELECT query */
+	bool		incremental;	/* true for INCREMENTAL MATERIALIZED VIEW */
 	bool		skipData;		/* true for WITH NO DATA */
 } IntoClause;
 
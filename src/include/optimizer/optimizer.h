@@ -23,6 +23,7 @@
 #define OPTIMIZER_H
 
 #include "nodes/parsenodes.h"
+#include "portability/instr_time.h"
 
 /* Test if an expression node represents a SRF call.  Beware multiple eval! */
 #define IS_SRF_CALL(node) \
@@ -114,6 +115,46 @@ typedef enum
 extern int	force_parallel_mode;
 extern bool parallel_leader_participation;
 
+/* phases of planning that EXPLAIN (PLANNING_DETAILS) reports on */
+typedef enum PlannerPhase
+{
+	PLANNER_PHASE_PREPROCESS,	/* subquery_planner's preprocessing */
+	PLANNER_PHASE_SETUP,		/* query_planner, incl. appendrel expansion */
+	PLANNER_PHASE_BASE_PATHS,	/* sizes and paths for base relations */
+	PLANNER_PHASE_JOIN_SEARCH,	/* join order search and join paths */
+	PLANNER_PHASE_UPPER,		/* grouping, sorting etc. in grouping_planner */
+	PLANNER_PHASE_CREATE_PLAN	/* converting the best path into a Plan */
+} PlannerPhase;
+
+#define NUM_PLANNER_PHASES		(PLANNER_PHASE_CREATE_PLAN + 1)
+
+/*
+ * Counters collected while planner_instrument is set.  Time and memory are
+ * charged to the phase that was current when they were spent, so nested
+ * planning of subqueries ends up in the phases it passes through rather
+ * than in its caller's.  Memory is the net change of BackendMemoryAllocated,
+ * so a phase that frees more than it allocates can show a negative value.
+ */
+typedef struct PlannerInstrumentation
+{
+	instr_time	phase_time[NUM_PLANNER_PHASES];
+	int64		phase_memory[NUM_PLANNER_PHASES];
+	int64		paths_considered;	/* calls to add_path/add_partial_path */
+	int64		paths_rejected; /* of which the new path was discarded */
+	uint64		catcache_searches;	/* catalog cache lookups */
+
+	/* private state */
+	PlannerPhase current_phase;
+	instr_time	phase_start;
+	Size		phase_memory_start;
+} PlannerInstrumentation;
+
+extern PGDLLIMPORT PlannerInstrumentation *planner_instrument;
+
+extern void PlannerInstrumentationStart(PlannerInstrumentation *instr);
+extern void PlannerInstrumentationStop(void);
+extern PlannerPhase PlannerEnterPhase(PlannerPhase phase);
+
 extern struct PlannedStmt *planner(Query *parse, const char *query_string,
 								   int cursorOptions,
 								   struct ParamListInfoData *boundParams);
@@ -101,6 +101,10 @@ extern GatherMergePath *create_gather_merge_path(PlannerInfo *root,
 												 List *pathkeys,
 												 Relids required_outer,
 												 double *rows);
+extern RedistributePath *create_redistribute_path(PlannerInfo *root,
+												  RelOptInfo *rel,
+												  Path *subpath,
+												  List *distClauses);
 extern SubqueryScanPath *create_subqueryscan_path(PlannerInfo *root,
 												  RelOptInfo *rel, Path *subpath,
 												  List *pathkeys, Relids required_outer);
@@ -265,6 +265,14 @@
  */
 #define PG_CACHE_LINE_SIZE		128
 
+/*
+ * Assumed alignment requirement for direct I/O (see io_direct).  4kB matches
+ * the logical sector size of modern storage and the memory page size of
+ * common platforms.  Shared buffers and local buffers are aligned to this;
+ * md.c copies any other buffer through an aligned one when necessary.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  *------------------------------------------------------------------------
  * The following symbols are for enabling debugging code, not for
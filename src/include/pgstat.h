@@ -1,7 +1,7 @@
 /* ----------
  *	pgstat.h
  *
- *	Definitions for the PostgreSQL statistics collector daemon.
+ *	Definitions for the PostgreSQL cumulative statistics system.
  *
  *	Copyright (c) 2001-2021, PostgreSQL Global Development Group
  *
@@ -12,6 +12,7 @@
 #define PGSTAT_H
 
 #include "datatype/timestamp.h"
+#include "miscadmin.h"			/* for BackendType */
 #include "portability/instr_time.h"
 #include "postmaster/pgarch.h"	/* for MAX_XFN_CHARS */
 #include "utils/backend_progress.h" /* for backward compatibility */
@@ -22,14 +23,17 @@
 
 
 /* ----------
- * Paths for the statistics files (relative to installation's $PGDATA).
+ * Paths for the statistics file (relative to installation's $PGDATA).
  * ----------
  */
 #define PGSTAT_STAT_PERMANENT_DIRECTORY		"pg_stat"
 #define PGSTAT_STAT_PERMANENT_FILENAME		"pg_stat/global.stat"
 #define PGSTAT_STAT_PERMANENT_TMPFILE		"pg_stat/global.tmp"
 
-/* Default directory to store temporary statistics data in */
+/*
+ * Directory for temporary statistics data.  The core system no longer writes
+ * anything there, but extensions still do, so it is kept around.
+ */
 #define PG_STAT_TMP_DIR		"pg_stat_tmp"
 
 /* Values for track_functions GUC variable --- order is significant! */
@@ -51,15 +55,13 @@ typedef enum SessionEndType
 } SessionEndType;
 
 /* ----------
- * The types of backend -> collector messages
+ * The types of statistics messages, in which backends batch up their
+ * pending counts before applying them to shared memory
  * ----------
  */
 typedef enum StatMsgType
 {
-	PGSTAT_MTYPE_DUMMY,
-	PGSTAT_MTYPE_INQUIRY,
 	PGSTAT_MTYPE_TABSTAT,
-	PGSTAT_MTYPE_TABPURGE,
 	PGSTAT_MTYPE_DROPDB,
 	PGSTAT_MTYPE_RESETCOUNTER,
 	PGSTAT_MTYPE_RESETSHAREDCOUNTER,
@@ -74,11 +76,13 @@ typedef enum StatMsgType
 	PGSTAT_MTYPE_CHECKPOINTER,
 	PGSTAT_MTYPE_WAL,
 	PGSTAT_MTYPE_SLRU,
+	PGSTAT_MTYPE_IO,
 	PGSTAT_MTYPE_FUNCSTAT,
-	PGSTAT_MTYPE_FUNCPURGE,
 	PGSTAT_MTYPE_RECOVERYCONFLICT,
 	PGSTAT_MTYPE_TEMPFILE,
 	PGSTAT_MTYPE_DEADLOCK,
+	PGSTAT_MTYPE_DEADLOCKCHECK,
+	PGSTAT_MTYPE_WAITEVENTS,
 	PGSTAT_MTYPE_CHECKSUMFAILURE,
 	PGSTAT_MTYPE_REPLSLOT,
 	PGSTAT_MTYPE_CONNECT,
@@ -138,6 +142,7 @@ typedef enum PgStat_Shared_Reset_Target
 {
 	RESET_ARCHIVER,
 	RESET_BGWRITER,
+	RESET_IO,
 	RESET_WAL
 } PgStat_Shared_Reset_Target;
 
@@ -218,54 +223,16 @@ typedef struct PgStat_MsgHdr
 } PgStat_MsgHdr;
 
 /* ----------
- * Space available in a message.  This will keep the UDP packets below 1K,
- * which should fit unfragmented into the MTU of the loopback interface.
- * (Larger values of PGSTAT_MAX_MSG_SIZE would work for that on most
- * platforms, but we're being conservative here.)
+ * Space available in a message.  Messages are applied to shared memory by
+ * the process that built them, so this only bounds the size of the batches
+ * in which table and function counts are flushed, and the stack space the
+ * batch buffers take.
  * ----------
  */
-#define PGSTAT_MAX_MSG_SIZE 1000
+#define PGSTAT_MAX_MSG_SIZE 8192
 #define PGSTAT_MSG_PAYLOAD	(PGSTAT_MAX_MSG_SIZE - sizeof(PgStat_MsgHdr))
 
 
-/* ----------
- * PgStat_MsgDummy				A dummy message, ignored by the collector
- * ----------
- */
-typedef struct PgStat_MsgDummy
-{
-	PgStat_MsgHdr m_hdr;
-} PgStat_MsgDummy;
-
-
-/* ----------
- * PgStat_MsgInquiry			Sent by a backend to ask the collector
- *								to write the stats file(s).
- *
- * Ordinarily, an inquiry message prompts writing of the global stats file,
- * the stats file for shared catalogs, and the stats file for the specified
- * database.  If databaseid is InvalidOid, only the first two are written.
- *
- * New file(s) will be written only if the existing file has a timestamp
- * older than the specified cutoff_time; this prevents duplicated effort
- * when multiple requests arrive at nearly the same time, assuming that
- * backends send requests with cutoff_times a little bit in the past.
- *
- * clock_time should be the requestor's current local time; the collector
- * uses this to check for the system clock going backward, but it has no
- * effect unless that occurs.  We assume clock_time >= cutoff_time, though.
- * ----------
- */
-
-typedef struct PgStat_MsgInquiry
-{
-	PgStat_MsgHdr m_hdr;
-	TimestampTz clock_time;		/* observed local clock time */
-	TimestampTz cutoff_time;	/* minimum acceptable file timestamp */
-	Oid			databaseid;		/* requested DB (InvalidOid => shared only) */
-} PgStat_MsgInquiry;
-
-
 /* ----------
  * PgStat_TableEntry			Per-table info in a MsgTabstat
  * ----------
@@ -302,25 +269,7 @@ typedef struct PgStat_MsgTabstat
 
 
 /* ----------
- * PgStat_MsgTabpurge			Sent by the backend to tell the collector
- *								about dead tables.
- * ----------
- */
-#define PGSTAT_NUM_TABPURGE  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(Oid))
-
-typedef struct PgStat_MsgTabpurge
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	Oid			m_tableid[PGSTAT_NUM_TABPURGE];
-} PgStat_MsgTabpurge;
-
-
-/* ----------
- * PgStat_MsgDropdb				Sent by the backend to tell the collector
+ * PgStat_MsgDropdb				Sent by the backend to tell the stats system
  *								about a dropped database
  * ----------
  */
@@ -332,7 +281,7 @@ typedef struct PgStat_MsgDropdb
 
 
 /* ----------
- * PgStat_MsgResetcounter		Sent by the backend to tell the collector
+ * PgStat_MsgResetcounter		Sent by the backend to tell the stats system
  *								to reset counters
  * ----------
  */
@@ -343,7 +292,7 @@ typedef struct PgStat_MsgResetcounter
 } PgStat_MsgResetcounter;
 
 /* ----------
- * PgStat_MsgResetsharedcounter Sent by the backend to tell the collector
+ * PgStat_MsgResetsharedcounter Sent by the backend to tell the stats system
  *								to reset a shared counter
  * ----------
  */
@@ -354,7 +303,7 @@ typedef struct PgStat_MsgResetsharedcounter
 } PgStat_MsgResetsharedcounter;
 
 /* ----------
- * PgStat_MsgResetsinglecounter Sent by the backend to tell the collector
+ * PgStat_MsgResetsinglecounter Sent by the backend to tell the stats system
  *								to reset a single counter
  * ----------
  */
@@ -367,7 +316,7 @@ typedef struct PgStat_MsgResetsinglecounter
 } PgStat_MsgResetsinglecounter;
 
 /* ----------
- * PgStat_MsgResetslrucounter Sent by the backend to tell the collector
+ * PgStat_MsgResetslrucounter Sent by the backend to tell the stats system
  *								to reset a SLRU counter
  * ----------
  */
@@ -378,7 +327,7 @@ typedef struct PgStat_MsgResetslrucounter
 } PgStat_MsgResetslrucounter;
 
 /* ----------
- * PgStat_MsgResetreplslotcounter Sent by the backend to tell the collector
+ * PgStat_MsgResetreplslotcounter Sent by the backend to tell the stats system
  *								to reset replication slot counter(s)
  * ----------
  */
@@ -479,6 +428,13 @@ typedef struct PgStat_MsgCheckpointer
 	PgStat_Counter m_checkpoint_sync_time;
 } PgStat_MsgCheckpointer;
 
+/*
+ * Number of buckets in the histogram of WAL sync times.  Bucket 0 counts
+ * syncs that took less than a microsecond, bucket i those that took between
+ * 2^(i-1) and 2^i microseconds, and the last bucket all longer ones.
+ */
+#define PGSTAT_WAL_SYNC_BUCKETS	20
+
 /* ----------
  * PgStat_MsgWal			Sent by backends and background processes to update WAL statistics.
  * ----------
@@ -496,8 +452,78 @@ typedef struct PgStat_MsgWal
 										 * microseconds */
 	PgStat_Counter m_wal_sync_time; /* time spent syncing wal records in
 									 * microseconds */
+	PgStat_Counter m_wal_sync_histogram[PGSTAT_WAL_SYNC_BUCKETS];
 } PgStat_MsgWal;
 
+/*
+ * Kinds of relation data that buffer I/O is counted for.
+ */
+typedef enum IOObject
+{
+	IOOBJECT_RELATION,			/* permanent and unlogged relations */
+	IOOBJECT_TEMP_RELATION		/* temporary relations, in local buffers */
+} IOObject;
+
+#define IOOBJECT_NUM_TYPES (IOOBJECT_TEMP_RELATION + 1)
+
+/*
+ * The buffer access strategy an I/O was done under.  I/O done with a ring
+ * buffer is counted separately, since it doesn't compete for the rest of
+ * shared buffers.
+ */
+typedef enum IOContext
+{
+	IOCONTEXT_NORMAL,
+	IOCONTEXT_VACUUM,
+	IOCONTEXT_BULKREAD,
+	IOCONTEXT_BULKWRITE
+} IOContext;
+
+#define IOCONTEXT_NUM_TYPES (IOCONTEXT_BULKWRITE + 1)
+
+typedef enum IOOp
+{
+	IOOP_READ,
+	IOOP_WRITE,
+	IOOP_EXTEND,
+	IOOP_FSYNC,
+	IOOP_HIT
+} IOOp;
+
+#define IOOP_NUM_TYPES (IOOP_HIT + 1)
+
+/*
+ * Number of buckets in the histograms of block read and write times, which
+ * are laid out like the WAL sync time histogram.
+ */
+#define PGSTAT_IO_TIME_BUCKETS	20
+
+/*
+ * I/O counts of one I/O object and context.  Blocks are counted by ops[];
+ * the times and histograms, which are only kept when track_io_timing is on,
+ * have one sample per read or write call, which may cover several blocks.
+ */
+typedef struct PgStat_IOCounts
+{
+	PgStat_Counter ops[IOOP_NUM_TYPES];
+	PgStat_Counter read_time;	/* times in microseconds */
+	PgStat_Counter write_time;
+	PgStat_Counter read_histogram[PGSTAT_IO_TIME_BUCKETS];
+	PgStat_Counter write_histogram[PGSTAT_IO_TIME_BUCKETS];
+} PgStat_IOCounts;
+
+/* ----------
+ * PgStat_MsgIO				Sent by backends and background processes to
+ *							update the I/O statistics of their backend type.
+ * ----------
+ */
+typedef struct PgStat_MsgIO
+{
+	PgStat_MsgHdr m_hdr;
+	BackendType m_backend_type;
+	PgStat_IOCounts m_counts[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+} PgStat_MsgIO;
+
 /* ----------
  * PgStat_MsgSLRU			Sent by a backend to update SLRU statistics.
  * ----------
@@ -568,7 +594,7 @@ typedef struct PgStat_MsgTempFile
  * it against zeroes to detect whether there are any counts to transmit.
  *
  * Note that the time counters are in instr_time format here.  We convert to
- * microseconds in PgStat_Counter format when transmitting to the collector.
+ * microseconds in PgStat_Counter format when flushing to shared memory.
  * ----------
  */
 typedef struct PgStat_FunctionCounts
@@ -618,35 +644,71 @@ typedef struct PgStat_MsgFuncstat
 } PgStat_MsgFuncstat;
 
 /* ----------
- * PgStat_MsgFuncpurge			Sent by the backend to tell the collector
- *								about dead functions.
+ * PgStat_MsgDeadlock			Sent by the backend to tell the stats system
+ *								about a deadlock that occurred.
  * ----------
  */
-#define PGSTAT_NUM_FUNCPURGE  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(Oid))
+typedef struct PgStat_MsgDeadlock
+{
+	PgStat_MsgHdr m_hdr;
+	Oid			m_databaseid;
+} PgStat_MsgDeadlock;
 
-typedef struct PgStat_MsgFuncpurge
+/* ----------
+ * PgStat_MsgDeadlockCheck		Sent by the backend to tell the stats system
+ *								about a deadlock check it ran.
+ * ----------
+ */
+typedef struct PgStat_MsgDeadlockCheck
 {
 	PgStat_MsgHdr m_hdr;
 	Oid			m_databaseid;
-	int			m_nentries;
-	Oid			m_functionid[PGSTAT_NUM_FUNCPURGE];
-} PgStat_MsgFuncpurge;
+	PgStat_Counter m_check_time;	/* time in microseconds */
+} PgStat_MsgDeadlockCheck;
+
+/*
+ * Wait event statistics are kept in an array with a slot for each wait
+ * event, see pgstat_wait_event_slot(), and a histogram of wait times for
+ * each of the PGSTAT_WAIT_CLASSES wait event types.  The histograms are laid
+ * out like the WAL sync time histogram.
+ */
+#define PGSTAT_WAIT_EVENT_SLOTS	512
+#define PGSTAT_WAIT_CLASSES		9
+#define PGSTAT_WAIT_TIME_BUCKETS	20
+
+typedef struct PgStat_WaitEventCounts
+{
+	PgStat_Counter calls;
+	PgStat_Counter time;		/* microseconds, or ticks while pending */
+} PgStat_WaitEventCounts;
+
+typedef struct PgStat_WaitEventEntry
+{
+	int			slot;
+	PgStat_WaitEventCounts counts;
+} PgStat_WaitEventEntry;
 
 /* ----------
- * PgStat_MsgDeadlock			Sent by the backend to tell the collector
- *								about a deadlock that occurred.
+ * PgStat_MsgWaitEvents			Sent by a process to report the time it spent
+ *								in wait events.
  * ----------
  */
-typedef struct PgStat_MsgDeadlock
+#define PGSTAT_NUM_WAITEVENTENTRIES	\
+	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int) - \
+	  PGSTAT_WAIT_CLASSES * PGSTAT_WAIT_TIME_BUCKETS * sizeof(PgStat_Counter)) \
+	 / sizeof(PgStat_WaitEventEntry))
+
+typedef struct PgStat_MsgWaitEvents
 {
 	PgStat_MsgHdr m_hdr;
 	Oid			m_databaseid;
-} PgStat_MsgDeadlock;
+	int			m_nentries;
+	PgStat_Counter m_histograms[PGSTAT_WAIT_CLASSES][PGSTAT_WAIT_TIME_BUCKETS];
+	PgStat_WaitEventEntry m_entry[PGSTAT_NUM_WAITEVENTENTRIES];
+} PgStat_MsgWaitEvents;
 
 /* ----------
- * PgStat_MsgChecksumFailure	Sent by the backend to tell the collector
+ * PgStat_MsgChecksumFailure	Sent by the backend to tell the stats system
  *								about checksum failures noticed.
  * ----------
  */
@@ -680,55 +742,19 @@ typedef struct PgStat_MsgDisconnect
 	SessionEndType m_cause;
 } PgStat_MsgDisconnect;
 
-/* ----------
- * PgStat_Msg					Union over all possible messages.
- * ----------
- */
-typedef union PgStat_Msg
-{
-	PgStat_MsgHdr msg_hdr;
-	PgStat_MsgDummy msg_dummy;
-	PgStat_MsgInquiry msg_inquiry;
-	PgStat_MsgTabstat msg_tabstat;
-	PgStat_MsgTabpurge msg_tabpurge;
-	PgStat_MsgDropdb msg_dropdb;
-	PgStat_MsgResetcounter msg_resetcounter;
-	PgStat_MsgResetsharedcounter msg_resetsharedcounter;
-	PgStat_MsgResetsinglecounter msg_resetsinglecounter;
-	PgStat_MsgResetslrucounter msg_resetslrucounter;
-	PgStat_MsgResetreplslotcounter msg_resetreplslotcounter;
-	PgStat_MsgAutovacStart msg_autovacuum_start;
-	PgStat_MsgVacuum msg_vacuum;
-	PgStat_MsgAnalyze msg_analyze;
-	PgStat_MsgArchiver msg_archiver;
-	PgStat_MsgBgWriter msg_bgwriter;
-	PgStat_MsgCheckpointer msg_checkpointer;
-	PgStat_MsgWal msg_wal;
-	PgStat_MsgSLRU msg_slru;
-	PgStat_MsgFuncstat msg_funcstat;
-	PgStat_MsgFuncpurge msg_funcpurge;
-	PgStat_MsgRecoveryConflict msg_recoveryconflict;
-	PgStat_MsgDeadlock msg_deadlock;
-	PgStat_MsgTempFile msg_tempfile;
-	PgStat_MsgChecksumFailure msg_checksumfailure;
-	PgStat_MsgReplSlot msg_replslot;
-	PgStat_MsgConnect msg_connect;
-	PgStat_MsgDisconnect msg_disconnect;
-} PgStat_Msg;
-
 
 /* ------------------------------------------------------------
- * Statistic collector data structures follow
+ * Cumulative statistics data structures follow
  *
  * PGSTAT_FILE_FORMAT_ID should be changed whenever any of these
  * data structures change.
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCA4
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCA9
 
 /* ----------
- * PgStat_StatDBEntry			The collector's data per database
+ * PgStat_StatDBEntry			The statistics kept per database
  * ----------
  */
 typedef struct PgStat_StatDBEntry
@@ -752,6 +778,8 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_temp_files;
 	PgStat_Counter n_temp_bytes;
 	PgStat_Counter n_deadlocks;
+	PgStat_Counter n_deadlock_checks;
+	PgStat_Counter total_deadlock_check_time;	/* times in microseconds */
 	PgStat_Counter n_checksum_failures;
 	TimestampTz last_checksum_failure;
 	PgStat_Counter n_block_read_time;	/* times in microseconds */
@@ -763,21 +791,16 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_sessions_abandoned;
 	PgStat_Counter n_sessions_fatal;
 	PgStat_Counter n_sessions_killed;
+	PgStat_WaitEventCounts wait_events[PGSTAT_WAIT_EVENT_SLOTS];
+	PgStat_Counter wait_histograms[PGSTAT_WAIT_CLASSES][PGSTAT_WAIT_TIME_BUCKETS];
 
 	TimestampTz stat_reset_timestamp;
-	TimestampTz stats_timestamp;	/* time of db stats file update */
-
-	/*
-	 * tables and functions must be last in the struct, because we don't write
-	 * the pointers out to the stats file.
-	 */
-	HTAB	   *tables;
-	HTAB	   *functions;
+	TimestampTz stats_timestamp;	/* time the entry was fetched */
 } PgStat_StatDBEntry;
 
 
 /* ----------
- * PgStat_StatTabEntry			The collector's data per table (or index)
+ * PgStat_StatTabEntry			The statistics kept per table (or index)
  * ----------
  */
 typedef struct PgStat_StatTabEntry
@@ -814,7 +837,7 @@ typedef struct PgStat_StatTabEntry
 
 
 /* ----------
- * PgStat_StatFuncEntry			The collector's data per function
+ * PgStat_StatFuncEntry			The statistics kept per function
  * ----------
  */
 typedef struct PgStat_StatFuncEntry
@@ -829,7 +852,7 @@ typedef struct PgStat_StatFuncEntry
 
 
 /*
- * Archiver statistics kept in the stats collector
+ * Archiver statistics kept in shared memory
  */
 typedef struct PgStat_ArchiverStats
 {
@@ -845,7 +868,7 @@ typedef struct PgStat_ArchiverStats
 } PgStat_ArchiverStats;
 
 /*
- * Background writer statistics kept in the stats collector
+ * Background writer statistics kept in shared memory
  */
 typedef struct PgStat_BgWriterStats
 {
@@ -856,7 +879,7 @@ typedef struct PgStat_BgWriterStats
 } PgStat_BgWriterStats;
 
 /*
- * Checkpointer statistics kept in the stats collector
+ * Checkpointer statistics kept in shared memory
  */
 typedef struct PgStat_CheckpointerStats
 {
@@ -871,18 +894,18 @@ typedef struct PgStat_CheckpointerStats
 } PgStat_CheckpointerStats;
 
 /*
- * Global statistics kept in the stats collector
+ * Global statistics kept in shared memory
  */
 typedef struct PgStat_GlobalStats
 {
-	TimestampTz stats_timestamp;	/* time of stats file update */
+	TimestampTz stats_timestamp;	/* time the snapshot was taken */
 
 	PgStat_CheckpointerStats checkpointer;
 	PgStat_BgWriterStats bgwriter;
 } PgStat_GlobalStats;
 
 /*
- * WAL statistics kept in the stats collector
+ * WAL statistics kept in shared memory
  */
 typedef struct PgStat_WalStats
 {
@@ -894,11 +917,21 @@ typedef struct PgStat_WalStats
 	PgStat_Counter wal_sync;
 	PgStat_Counter wal_write_time;
 	PgStat_Counter wal_sync_time;
+	PgStat_Counter wal_sync_histogram[PGSTAT_WAL_SYNC_BUCKETS];
 	TimestampTz stat_reset_timestamp;
 } PgStat_WalStats;
 
 /*
- * SLRU statistics kept in the stats collector
+ * I/O statistics kept in shared memory, per backend type
+ */
+typedef struct PgStat_IOStats
+{
+	PgStat_IOCounts counts[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+	TimestampTz stat_reset_timestamp;
+} PgStat_IOStats;
+
+/*
+ * SLRU statistics kept in shared memory
  */
 typedef struct PgStat_SLRUStats
 {
@@ -913,7 +946,7 @@ typedef struct PgStat_SLRUStats
 } PgStat_SLRUStats;
 
 /*
- * Replication slot statistics kept in the stats collector
+ * Replication slot statistics kept in shared memory
  */
 typedef struct PgStat_StatReplSlotEntry
 {
@@ -953,9 +986,6 @@ typedef struct PgStat_FunctionCallUsage
  */
 extern PGDLLIMPORT bool pgstat_track_counts;
 extern PGDLLIMPORT int pgstat_track_functions;
-extern char *pgstat_stat_directory;
-extern char *pgstat_stat_tmpname;
-extern char *pgstat_stat_filename;
 
 /*
  * BgWriter statistics counters are updated directly by bgwriter and bufmgr
@@ -973,6 +1003,19 @@ extern PgStat_MsgCheckpointer PendingCheckpointerStats;
  */
 extern PgStat_MsgWal WalStats;
 
+/*
+ * I/O statistics counters are updated by bufmgr, localbuf and md, through
+ * the pgstat_count_io_* functions
+ */
+extern PgStat_MsgIO PendingIOStats;
+
+/*
+ * Wait event statistics counters are updated by pgstat_count_wait_end()
+ */
+extern PgStat_WaitEventCounts PendingWaitEvents[PGSTAT_WAIT_EVENT_SLOTS];
+extern PgStat_Counter PendingWaitHistograms[PGSTAT_WAIT_CLASSES][PGSTAT_WAIT_TIME_BUCKETS];
+extern bool have_wait_event_stats;
+
 /*
  * Updated by pgstat_count_buffer_*_time macros
  */
@@ -993,25 +1036,20 @@ extern PgStat_Counter pgStatTransactionIdleTime;
 extern SessionEndType pgStatSessionEndCause;
 
 /* ----------
- * Functions called from postmaster
+ * Functions called during startup, checkpoints and shared memory setup
  * ----------
  */
-extern void pgstat_init(void);
-extern int	pgstat_start(void);
+extern Size PgStatShmemSize(void);
+extern void PgStatShmemInit(void);
 extern void pgstat_reset_all(void);
-extern void allow_immediate_pgstat_restart(void);
-
-#ifdef EXEC_BACKEND
-extern void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
-#endif
+extern void pgstat_restore_stats(void);
+extern void pgstat_write_statsfile(void);
 
 
 /* ----------
  * Functions called from backends
  * ----------
  */
-extern void pgstat_ping(void);
-
 extern void pgstat_report_stat(bool force);
 extern void pgstat_vacuum_stat(void);
 extern void pgstat_drop_database(Oid databaseid);
@@ -1033,6 +1071,7 @@ extern void pgstat_report_analyze(Relation rel,
 
 extern void pgstat_report_recovery_conflict(int reason);
 extern void pgstat_report_deadlock(void);
+extern void pgstat_report_deadlock_check(PgStat_Counter check_time);
 extern void pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount);
 extern void pgstat_report_checksum_failure(void);
 extern void pgstat_report_replslot(const PgStat_StatReplSlotEntry *repSlotStat);
@@ -1088,6 +1127,8 @@ extern void pgstat_initstats(Relation rel);
 	(pgStatBlockReadTime += (n))
 #define pgstat_count_buffer_write_time(n)							\
 	(pgStatBlockWriteTime += (n))
+#define pgstat_count_io_op(io_object, io_context, io_op, cnt)			\
+	(PendingIOStats.m_counts[io_object][io_context].ops[io_op] += (cnt))
 #define pgstat_count_conn_active_time(n)							\
 	(pgStatActiveTime += (n))
 #define pgstat_count_conn_txn_idle_time(n)							\
@@ -1120,6 +1161,10 @@ extern void pgstat_send_archiver(const char *xlog, bool failed);
 extern void pgstat_send_bgwriter(void);
 extern void pgstat_send_checkpointer(void);
 extern void pgstat_send_wal(bool force);
+extern void pgstat_send_io(void);
+extern void pgstat_send_wait_events(void);
+extern void pgstat_count_io_time(IOObject io_object, IOContext io_context,
+								 IOOp io_op, instr_time io_time);
 
 /* ----------
  * Support functions for the SQL-callable functions to
@@ -1128,6 +1173,8 @@ extern void pgstat_send_wal(bool force);
  */
 extern PgStat_StatDBEntry *pgstat_fetch_stat_dbentry(Oid dbid);
 extern PgStat_StatTabEntry *pgstat_fetch_stat_tabentry(Oid relid);
+extern PgStat_StatTabEntry *pgstat_fetch_stat_tabentry_ext(bool shared,
+														   Oid relid);
 extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid funcid);
 extern PgStat_ArchiverStats *pgstat_fetch_stat_archiver(void);
 extern PgStat_BgWriterStats *pgstat_fetch_stat_bgwriter(void);
@@ -1135,6 +1182,7 @@ extern PgStat_CheckpointerStats *pgstat_fetch_stat_checkpointer(void);
 extern PgStat_GlobalStats *pgstat_fetch_global(void);
 extern PgStat_WalStats *pgstat_fetch_stat_wal(void);
 extern PgStat_SLRUStats *pgstat_fetch_slru(void);
+extern PgStat_IOStats *pgstat_fetch_stat_io(void);
 extern PgStat_StatReplSlotEntry *pgstat_fetch_replslot(NameData slotname);
 
 extern void pgstat_count_slru_page_zeroed(int slru_idx);
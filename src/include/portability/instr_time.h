@@ -39,6 +39,18 @@
  * absolute times to intervals.  The INSTR_TIME_GET_xxx operations are
  * only useful on intervals.
  *
+ * For timing very short intervals, such as single executions of a plan
+ * node, there is also a cheaper "tick" clock that reads the CPU's time stamp
+ * counter where that is known to be reliable:
+ *
+ * pg_tsc_init()					decide whether to use the TSC, calibrate it
+ * pg_get_ticks()					current time, in ticks (uint64)
+ * pg_get_ticks_per_sec()			clock frequency, to convert tick intervals
+ *
+ * Without pg_tsc_init(), or if the TSC is unsuitable, ticks are derived from
+ * INSTR_TIME_SET_CURRENT.  Tick values are only comparable within a cluster,
+ * since the calibration is inherited from the postmaster.
+ *
  * When summing multiple measurements, it's recommended to leave the
  * running sum in instr_time form (ie, use INSTR_TIME_ADD or
  * INSTR_TIME_ACCUM_DIFF) and convert to a result format only at the end.
@@ -141,6 +153,11 @@ typedef struct timespec instr_time;
 #define INSTR_TIME_GET_MICROSEC(t) \
 	(((uint64) (t).tv_sec * (uint64) 1000000) + (uint64) ((t).tv_nsec / 1000))
 
+#define INSTR_TIME_GET_TICKS(t) \
+	(((uint64) (t).tv_sec * (uint64) 1000000000) + (uint64) (t).tv_nsec)
+
+#define INSTR_TIME_TICKS_PER_SEC	UINT64CONST(1000000000)
+
 #else							/* !HAVE_CLOCK_GETTIME */
 
 /* Use gettimeofday() */
@@ -205,6 +222,10 @@ typedef struct timeval instr_time;
 #define INSTR_TIME_GET_MICROSEC(t) \
 	(((uint64) (t).tv_sec * (uint64) 1000000) + (uint64) (t).tv_usec)
 
+#define INSTR_TIME_GET_TICKS(t)		INSTR_TIME_GET_MICROSEC(t)
+
+#define INSTR_TIME_TICKS_PER_SEC	UINT64CONST(1000000)
+
 #endif							/* HAVE_CLOCK_GETTIME */
 
 #else							/* WIN32 */
@@ -237,6 +258,10 @@ typedef LARGE_INTEGER instr_time;
 #define INSTR_TIME_GET_MICROSEC(t) \
 	((uint64) (((double) (t).QuadPart * 1000000.0) / GetTimerFrequency()))
 
+#define INSTR_TIME_GET_TICKS(t)		((uint64) (t).QuadPart)
+
+#define INSTR_TIME_TICKS_PER_SEC	((uint64) GetTimerFrequency())
+
 static inline double
 GetTimerFrequency(void)
 {
@@ -253,4 +278,45 @@ GetTimerFrequency(void)
 #define INSTR_TIME_SET_CURRENT_LAZY(t) \
 	(INSTR_TIME_IS_ZERO(t) ? INSTR_TIME_SET_CURRENT(t), true : false)
 
+/*
+ * The tick clock.  We can only use the time stamp counter on x86-64, where
+ * pg_tsc_init() can check with cpuid that it runs at a constant rate.
+ */
+#if (defined(__x86_64__) || defined(_M_X64)) && \
+	(defined(HAVE__GET_CPUID) || defined(HAVE__CPUID))
+#define PG_HAVE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/* TSC frequency, or 0 if ticks come from INSTR_TIME_SET_CURRENT */
+extern PGDLLIMPORT uint64 pg_tsc_ticks_per_sec;
+
+extern bool pg_tsc_init(void);
+
+static inline uint64
+pg_get_ticks(void)
+{
+	instr_time	now;
+
+#ifdef PG_HAVE_TSC
+	if (pg_tsc_ticks_per_sec != 0)
+		return __rdtsc();
+#endif
+
+	INSTR_TIME_SET_CURRENT(now);
+	return INSTR_TIME_GET_TICKS(now);
+}
+
+static inline uint64
+pg_get_ticks_per_sec(void)
+{
+	if (pg_tsc_ticks_per_sec != 0)
+		return pg_tsc_ticks_per_sec;
+	return INSTR_TIME_TICKS_PER_SEC;
+}
+
 #endif							/* INSTR_TIME_H */
@@ -26,10 +26,45 @@
 #define MAX_XFN_CHARS	40
 #define VALID_XFN_CHARS "0123456789ABCDEF.history.backup.partial"
 
+/* largest allowed archive_parallelism */
+#define MAX_ARCHIVE_PARALLELISM	64
+
+/*
+ * Callbacks for archive modules, which archive_library loads to replace
+ * archive_command.
+ *
+ * check_configured_cb returns whether the module is ready to archive files;
+ * if not, the archiver warns and tries again later.  archive_file_cb
+ * archives one file, given its name and its path relative to the data
+ * directory, and returns true if it succeeded.  shutdown_cb, if set, is
+ * called when the archiver exits.
+ */
+typedef bool (*ArchiveCheckConfiguredCB) (void);
+typedef bool (*ArchiveFileCB) (const char *file, const char *path);
+typedef void (*ArchiveShutdownCB) (void);
+
+typedef struct ArchiveModuleCallbacks
+{
+	ArchiveCheckConfiguredCB check_configured_cb;
+	ArchiveFileCB archive_file_cb;
+	ArchiveShutdownCB shutdown_cb;
+} ArchiveModuleCallbacks;
+
+/*
+ * Archive modules must define a function called _PG_archive_module_init of
+ * this type, which fills in the callbacks.
+ */
+typedef void (*ArchiveModuleInit) (ArchiveModuleCallbacks *cb);
+
+/* GUC parameters */
+extern PGDLLIMPORT char *XLogArchiveLibrary;
+extern PGDLLIMPORT int archive_parallelism;
+
 extern Size PgArchShmemSize(void);
 extern void PgArchShmemInit(void);
 extern bool PgArchCanRestart(void);
 extern void PgArchiverMain(void) pg_attribute_noreturn();
 extern void PgArchWakeup(void);
+extern void PgArchForceDirScan(void);
 
 #endif							/* _PGARCH_H */
@@ -0,0 +1,51 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.h
+ *	  Exports from postmaster/proxy.c, the built-in connection pooler.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/proxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _PROXY_H
+#define _PROXY_H
+
+#include "libpq/pqcomm.h"
+#include "postmaster/bgworker.h"
+
+/* upper limit for connection_proxies */
+#define MAX_CONNECTION_PROXIES	64
+
+/* GUC options */
+extern int	ConnectionProxies;
+extern int	ProxyPortNumber;
+extern int	SessionPoolSize;
+extern int	MaxSessions;
+
+/* index of the proxy this process is, or -1 */
+extern int	MyProxyIndex;
+
+/* shared memory */
+extern Size ProxyShmemSize(void);
+extern void ProxyShmemInit(void);
+
+/* functions called in the postmaster */
+extern void ProxyCreateChannels(void);
+extern void ProxyRegisterWorkers(void);
+extern int	ProxyWorkerIndex(const BackgroundWorker *worker);
+extern pgsocket ProxyPostmasterChannel(int proxyno);
+extern bool ProxyHandOffConnection(pgsocket sock, SockAddr *raddr);
+extern pgsocket ProxyReceiveBackendRequest(int proxyno, SockAddr *raddr);
+extern void ProxyCloseChannels(void);
+
+/* proxy process entry point */
+extern void ConnectionProxyMain(Datum main_arg) pg_attribute_noreturn();
+
+/* functions called in backends serving a proxy */
+extern void PinPooledSession(const char *reason);
+extern void ReportPooledSessionState(void);
+
+#endif							/* _PROXY_H */
@@ -20,6 +20,21 @@
 #define MAX_RATE_LOWER	32
 #define MAX_RATE_UPPER	1048576
 
+/*
+ * An incremental backup contains relation segments that were only partially
+ * modified since the backup it's based on as files named
+ * INCREMENTAL.<segment>, laid out as follows:
+ *
+ *	uint32		magic (INCREMENTAL_MAGIC)
+ *	uint32		number of blocks included
+ *	uint32		length of the segment in blocks
+ *	uint32		block numbers of the included blocks, in ascending order
+ *	the included blocks themselves, BLCKSZ bytes each, in the same order
+ *
+ * All blocks not included are unchanged since the earlier backup.
+ */
+#define INCREMENTAL_MAGIC	0xd3ae1f0d
+
 /*
  * Information about a tablespace
  *
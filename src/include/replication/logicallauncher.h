@@ -14,6 +14,7 @@
 
 extern int	max_logical_replication_workers;
 extern int	max_sync_workers_per_subscription;
+extern int	max_sync_connections_per_table;
 
 extern void ApplyLauncherRegister(void);
 extern void ApplyLauncherMain(Datum main_arg);
@@ -590,6 +590,10 @@ struct ReorderBuffer
 	char	   *outbuf;
 	Size		outbufsize;
 
+	/* buffer collecting serialized changes until they're written to disk */
+	char	   *spillbuf;
+	Size		spillbufused;
+
 	/* memory accounting */
 	Size		size;
 
@@ -55,6 +55,29 @@ typedef struct PrefetchBufferResult
 	bool		initiated_io;	/* If true, a miss resulting in async I/O */
 } PrefetchBufferResult;
 
+/*
+ * State for adaptive sequential read-ahead; see ReadAheadBlock().  Callers
+ * embed this in their scan state and set it up with ReadAheadInit().
+ */
+typedef struct ReadAheadState
+{
+	ForkNumber	forknum;		/* fork being scanned */
+	BlockNumber nblocks;		/* don't prefetch at or beyond this block */
+	BlockNumber last_blkno;		/* block of the previous call, if any */
+	BlockNumber next_blkno;		/* first block not yet prefetched */
+	int			distance;		/* current look-ahead distance, in blocks */
+	int			max_distance;	/* upper limit for distance; 0 disables */
+	int64		last_reads;		/* buffer misses seen at the last refill */
+} ReadAheadState;
+
+/*
+ * Read streams; see ReadStreamBegin().  The callback returns the next block
+ * number to read, or InvalidBlockNumber at the end of the stream.
+ */
+typedef struct ReadStream ReadStream;
+typedef BlockNumber (*ReadStreamBlockCB) (ReadStream *stream,
+										  void *callback_private);
+
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
@@ -176,6 +199,19 @@ extern PrefetchBufferResult PrefetchSharedBuffer(struct SMgrRelationData *smgr_r
 												 BlockNumber blockNum);
 extern PrefetchBufferResult PrefetchBuffer(Relation reln, ForkNumber forkNum,
 										   BlockNumber blockNum);
+extern void PrefetchBufferRange(Relation reln, ForkNumber forkNum,
+								BlockNumber firstBlock, BlockNumber nblocks);
+extern void ReadAheadInit(ReadAheadState *ra, ForkNumber forkNum,
+						  BlockNumber nblocks, int io_concurrency);
+extern void ReadAheadBlock(ReadAheadState *ra, Relation reln,
+						   BlockNumber blkno);
+extern ReadStream *ReadStreamBegin(Relation rel, ForkNumber forkNum,
+								   BufferAccessStrategy strategy,
+								   ReadStreamBlockCB callback,
+								   void *callback_private);
+extern Buffer ReadStreamNextBuffer(ReadStream *stream);
+extern void ReadStreamReset(ReadStream *stream);
+extern void ReadStreamEnd(ReadStream *stream);
 extern bool ReadRecentBuffer(RelFileNode rnode, ForkNumber forkNum,
 							 BlockNumber blockNum, Buffer recent_buffer);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
@@ -213,6 +249,7 @@ extern void DropDatabaseBuffers(Oid dbid);
 	RelationGetNumberOfBlocksInFork(reln, MAIN_FORKNUM)
 
 extern bool BufferIsPermanent(Buffer buffer);
+extern bool BufferIsDirty(Buffer buffer);
 extern XLogRecPtr BufferGetLSNAtomic(Buffer buffer);
 
 #ifdef NOT_USED
@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.h
+ *	  Double-write buffer for protecting data pages against torn writes.
+ *
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/doublewrite.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOUBLEWRITE_H
+#define DOUBLEWRITE_H
+
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+#include "utils/guc.h"
+
+/* name of the double-write file, relative to the data directory */
+#define DOUBLE_WRITE_FILE		"pg_doublewrite"
+
+/* most pages that one process can have in the double-write buffer at once */
+#define DOUBLE_WRITE_MAX_PAGES	32
+
+/* smallest non-zero double_write_buffer_size */
+#define DOUBLE_WRITE_MIN_SLOTS	(4 * DOUBLE_WRITE_MAX_PAGES)
+
+/* GUC parameter */
+extern PGDLLIMPORT int double_write_buffer_size;
+
+extern Size DoubleWriteShmemSize(void);
+extern void DoubleWriteShmemInit(void);
+extern void StartupDoubleWrite(bool crashRecovery);
+
+extern bool DoubleWriteActive(void);
+extern void DoubleWritePages(RelFileNode rnode, ForkNumber forknum,
+							 BlockNumber blocknum, char **pages, int npages,
+							 int *slots);
+extern void DoubleWriteRelease(int *slots, int nslots);
+extern void AbortDoubleWrite(void);
+
+extern uint64 DoubleWriteStartSync(void);
+extern void DoubleWriteEndSync(uint64 cycle);
+
+extern bool check_double_write_buffer_size(int *newval, void **extra,
+										   GucSource source);
+
+#endif							/* DOUBLEWRITE_H */
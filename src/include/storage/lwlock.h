@@ -117,13 +117,14 @@ extern bool LWLockAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockAcquireOrWait(LWLock *lock, LWLockMode mode);
 extern void LWLockRelease(LWLock *lock);
-extern void LWLockReleaseClearVar(LWLock *lock, uint64 *valptr, uint64 val);
+extern void LWLockReleaseClearVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 val);
 extern void LWLockReleaseAll(void);
 extern bool LWLockHeldByMe(LWLock *lock);
 extern bool LWLockHeldByMeInMode(LWLock *lock, LWLockMode mode);
 
-extern bool LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval);
-extern void LWLockUpdateVar(LWLock *lock, uint64 *valptr, uint64 value);
+extern bool LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr,
+							 uint64 oldval, uint64 *newval);
+extern void LWLockUpdateVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 value);
 
 extern Size LWLockShmemSize(void);
 extern void CreateLWLocks(void);
@@ -189,6 +190,19 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_SHARED_TIDBITMAP,
 	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_PER_XACT_PREDICATE_LIST,
+	LWTRANCHE_PGSTATS_DSA,
+	LWTRANCHE_PGSTATS_HASH,
+	LWTRANCHE_PGSTATS_DATA,
+	LWTRANCHE_CSNLOG_BUFFER,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_SHARED_CATCACHE_HASH,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH,
+	LWTRANCHE_SHARED_RESULT_CACHE_DSA,
+	LWTRANCHE_SHARED_RESULT_CACHE_HASH,
+	LWTRANCHE_SEQUENCE_CACHE,
+	LWTRANCHE_RELSIZE_CACHE,
+	LWTRANCHE_DOUBLE_WRITE,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
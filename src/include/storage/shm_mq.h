@@ -74,6 +74,9 @@ extern shm_mq_result shm_mq_send(shm_mq_handle *mqh,
 								 bool force_flush);
 extern shm_mq_result shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov,
 								  int iovcnt, bool nowait, bool force_flush);
+extern void *shm_mq_send_reserve(shm_mq_handle *mqh, Size nbytes);
+extern shm_mq_result shm_mq_send_reserved(shm_mq_handle *mqh, Size nbytes,
+										  bool force_flush);
 extern shm_mq_result shm_mq_receive(shm_mq_handle *mqh,
 									Size *nbytesp, void **datap, bool nowait);
 extern void shm_mq_flush(shm_mq_handle *mqh);
@@ -24,6 +24,13 @@
 
 #include "storage/lock.h"
 #include "storage/sinval.h"
+#include "utils/guc.h"
+
+/* maximum allowed value of sinval_queue_size */
+#define SINVAL_QUEUE_SIZE_MAX	(1024 * 1024)
+
+/* GUC variable */
+extern PGDLLIMPORT int sinval_queue_size;
 
 /*
  * prototypes for functions in sinvaladt.c
@@ -40,4 +47,7 @@ extern void SICleanupQueue(bool callerHasWriteLock, int minFree);
 
 extern LocalTransactionId GetNextLocalTransactionId(void);
 
+extern bool check_sinval_queue_size(int *newval, void **extra,
+									GucSource source);
+
 #endif							/* SINVALADT_H */
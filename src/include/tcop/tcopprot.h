@@ -43,6 +43,8 @@ typedef enum
 
 extern PGDLLIMPORT int log_statement;
 
+extern int	simple_query_cache_size;
+
 extern List *pg_parse_query(const char *query_string);
 extern List *pg_rewrite_query(Query *query);
 extern List *pg_analyze_and_rewrite(RawStmt *parsetree,
@@ -0,0 +1,37 @@
+/* ----------
+ * backend_profile.h
+ *	  Definitions for the built-in sampling profiler.
+ *
+ * Copyright (c) 2001-2021, PostgreSQL Global Development Group
+ *
+ * src/include/utils/backend_profile.h
+ * ----------
+ */
+#ifndef BACKEND_PROFILE_H
+#define BACKEND_PROFILE_H
+
+#include "nodes/nodes.h"
+#include "utils/guc.h"
+
+
+/* GUC parameter */
+extern PGDLLIMPORT int backend_profile_interval;
+
+/*
+ * Is this process taking samples?  The executor only bothers to track the
+ * plan node being executed if so.
+ */
+extern PGDLLIMPORT bool pgstat_profile_active;
+
+/* Type of the plan node currently being executed, or T_Invalid */
+extern PGDLLIMPORT volatile NodeTag pgstat_profile_node;
+
+extern Size BackendProfileShmemSize(void);
+extern void BackendProfileShmemInit(void);
+extern void pgstat_profile_init(void);
+
+extern bool check_backend_profile_interval(int *newval, void **extra,
+										   GucSource source);
+extern void assign_backend_profile_interval(int newval, void *extra);
+
+#endif							/* BACKEND_PROFILE_H */
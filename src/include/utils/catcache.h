@@ -22,6 +22,7 @@
 
 #include "access/htup.h"
 #include "access/skey.h"
+#include "datatype/timestamp.h"
 #include "lib/ilist.h"
 #include "utils/relcache.h"
 
@@ -118,6 +119,7 @@ typedef struct catctup
 	int			refcount;		/* number of active references */
 	bool		dead;			/* dead but not yet removed? */
 	bool		negative;		/* negative cache entry? */
+	TimestampTz lastaccess;		/* catcacheclock at last search hit */
 	HeapTupleData tuple;		/* tuple management header */
 
 	/*
@@ -189,6 +191,39 @@ typedef struct catcacheheader
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
+/* GUC: entries idle for longer than this many seconds may be pruned */
+extern int	catalog_cache_prune_min_age;
+
+/* GUC: evict entries when they use more than this many kilobytes */
+extern int	catalog_cache_memory_limit;
+
+/* approximate memory used by catalog cache entries, in bytes */
+extern PGDLLIMPORT Size catcache_memory_used;
+
+/* coarse clock used to stamp cache entries, advanced once per statement */
+extern PGDLLIMPORT TimestampTz catcacheclock;
+
+/* number of catalog cache searches made by this backend */
+extern PGDLLIMPORT uint64 catcache_searches;
+
+extern void CatCacheEnforceMemoryLimit(TimestampTz recent);
+
+/*
+ * Advance the clock.  This is also when catalog_cache_memory_limit is
+ * enforced, since no cache entry can be in the middle of being used.
+ */
+static inline void
+SetCatCacheClock(TimestampTz ts)
+{
+	TimestampTz prev = catcacheclock;
+
+	catcacheclock = ts;
+
+	if (unlikely(catalog_cache_memory_limit > 0 &&
+				 catcache_memory_used > (Size) catalog_cache_memory_limit * 1024))
+		CatCacheEnforceMemoryLimit(prev);
+}
+
 extern void CreateCacheMemoryContext(void);
 
 extern CatCache *InitCatCache(int id, Oid reloid, Oid indexoid,
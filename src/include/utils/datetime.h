@@ -295,6 +295,8 @@ extern int	ParseDateTime(const char *timestr, char *workbuf, size_t buflen,
 extern int	DecodeDateTime(char **field, int *ftype,
 						   int nf, int *dtype,
 						   struct pg_tm *tm, fsec_t *fsec, int *tzp);
+extern bool DecodeISODateTimeFast(const char *str, struct pg_tm *tm,
+								  fsec_t *fsec, int *tzp);
 extern int	DecodeTimezone(char *str, int *tzp);
 extern int	DecodeTimeOnly(char **field, int *ftype,
 						   int nf, int *dtype,
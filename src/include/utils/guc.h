@@ -288,6 +288,9 @@ extern int	tcp_user_timeout;
 extern bool trace_sort;
 #endif
 
+/* advanced whenever the value of any GUC variable may have changed */
+extern uint64 guc_change_count;
+
 /*
  * Functions exported by guc.c
  */
@@ -445,6 +448,8 @@ extern void assign_search_path(const char *newval, void *extra);
 
 /* in access/transam/xlog.c */
 extern bool check_wal_buffers(int *newval, void **extra, GucSource source);
+extern bool check_wal_insert_locks(int *newval, void **extra, GucSource source);
+extern bool check_recovery_prefetch(int *newval, void **extra, GucSource source);
 extern void assign_xlog_sync_method(int new_sync_method, void *extra);
 
 #endif							/* GUC_H */
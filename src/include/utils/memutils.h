@@ -145,6 +145,31 @@ extern void MemoryContextCreate(MemoryContext node,
 								MemoryContext parent,
 								const char *name);
 
+/*
+ * Total memory held by all live memory contexts of this backend, that is the
+ * sum of their mem_allocated.  Context implementations must make every
+ * change to mem_allocated through the two functions below, and give back
+ * whatever a context still holds when it is deleted.
+ */
+extern PGDLLIMPORT Size BackendMemoryAllocated;
+
+static inline void
+MemoryContextNoteAllocated(MemoryContext context, Size size)
+{
+	context->mem_allocated += size;
+	BackendMemoryAllocated += size;
+}
+
+static inline void
+MemoryContextNoteFreed(MemoryContext context, Size size)
+{
+	Assert(context->mem_allocated >= size);
+	context->mem_allocated -= size;
+	BackendMemoryAllocated -= size;
+}
+
+extern bool BackendMemoryLimitExceeded(void);
+
 extern void HandleLogMemoryContextInterrupt(void);
 extern void ProcessLogMemoryContextInterrupt(void);
 
@@ -185,6 +210,13 @@ extern MemoryContext GenerationContextCreate(MemoryContext parent,
 											 const char *name,
 											 Size blockSize);
 
+/* bump.c */
+extern MemoryContext BumpContextCreate(MemoryContext parent,
+									   const char *name,
+									   Size minContextSize,
+									   Size initBlockSize,
+									   Size maxBlockSize);
+
 /*
  * Recommended default alloc parameters, suitable for "ordinary" contexts
  * that might hold quite a lot of data.
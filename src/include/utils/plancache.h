@@ -132,6 +132,9 @@ typedef struct CachedPlanSource
 	double		total_custom_cost;	/* total cost of custom plans so far */
 	int64		num_custom_plans;	/* # of custom plans included in total */
 	int64		num_generic_plans;	/* # of generic plans */
+	/* Custom plan statistics inherited along with a shared generic plan: */
+	double		shared_custom_cost; /* total cost of those custom plans */
+	int64		shared_custom_plans;	/* # of custom plans included in total */
 } CachedPlanSource;
 
 /*
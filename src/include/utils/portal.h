@@ -140,6 +140,8 @@ typedef struct PortalData
 	CachedPlan *cplan;			/* CachedPlan, if stmts are from one */
 
 	ParamListInfo portalParams; /* params to pass to query */
+	ParamListInfo *bulkParams;	/* parameter sets of a bulk bind, or NULL */
+	int			numBulkParams;	/* number of entries in bulkParams */
 	QueryEnvironment *queryEnv; /* environment for query */
 
 	/* Features/options */
@@ -160,6 +162,8 @@ typedef struct PortalData
 	TupleDesc	tupDesc;		/* descriptor for result tuples */
 	/* and these are the format codes to use for the columns: */
 	int16	   *formats;		/* a format code for each column */
+	/* and this is printtup.c's cached output info for them, if any: */
+	void	   *printtupInfo;
 
 	/*
 	 * Outermost ActiveSnapshot for execution of the portal's queries.  For
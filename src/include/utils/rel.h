@@ -56,6 +56,7 @@ typedef struct RelationData
 	RelFileNode rd_node;		/* relation physical identifier */
 	SMgrRelation rd_smgr;		/* cached file handle, or NULL */
 	int			rd_refcnt;		/* reference count */
+	TimestampTz rd_lastaccess;	/* catcacheclock when last opened */
 	BackendId	rd_backend;		/* owning backend id, if temporary relation */
 	bool		rd_islocaltemp; /* rel is a temp rel of this session */
 	bool		rd_isnailed;	/* rel is nailed in cache */
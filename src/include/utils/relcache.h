@@ -15,6 +15,7 @@
 #define RELCACHE_H
 
 #include "access/tupdesc.h"
+#include "datatype/timestamp.h"
 #include "nodes/bitmapset.h"
 
 
@@ -124,6 +125,8 @@ extern void RelationCacheInvalidateEntry(Oid relationId);
 
 extern void RelationCacheInvalidate(bool debug_discard);
 
+extern void RelationCachePrune(TimestampTz recent);
+
 extern void RelationCloseSmgrByOid(Oid relationId);
 
 #ifdef USE_ASSERT_CHECKING
@@ -0,0 +1,38 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Shared-memory tier of the system catalog cache.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+
+/* GUC: size of the shared catalog cache in kilobytes, 0 disables it */
+extern int	shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheEnabled(void);
+extern void SharedCatCacheNoteCatalogSnapshot(void);
+extern uint64 SharedCatCacheSnapshotGeneration(void);
+
+extern HeapTuple SharedCatCacheLookup(Oid dbid, int cacheid, Oid reloid,
+									  uint32 hashValue);
+extern void SharedCatCacheInsert(Oid dbid, int cacheid, Oid reloid,
+								 uint32 hashValue, HeapTuple tuple,
+								 uint64 generation);
+extern void SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+											 int n);
+extern void SharedCatCacheDropDatabase(Oid dbid);
+
+#endif							/* SHAREDCATCACHE_H */
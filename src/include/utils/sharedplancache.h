@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Generic plans shared between backends.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "nodes/pg_list.h"
+#include "storage/sinval.h"
+
+/*
+ * What a shared generic plan is looked up by.  Besides the statement itself,
+ * env_hash must cover everything else that parse analysis and planning of
+ * the statement depend on, such as the search path.
+ */
+typedef struct SharedPlanIdentity
+{
+	Oid			dbid;			/* database */
+	Oid			roleid;			/* user the plan was made for */
+	uint64		env_hash;		/* hash of the session environment */
+	const char *query_string;	/* source text containing the statement */
+	int			stmt_location;	/* statement's location in query_string */
+	int			stmt_len;		/* and its length, or 0 for "rest" */
+	int			cursor_options; /* CURSOR_OPT_XXX flags */
+	int			num_params;		/* number of parameters */
+	const Oid  *param_types;	/* their types */
+} SharedPlanIdentity;
+
+/* GUC: size of the shared plan cache in kilobytes, 0 disables it */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern bool SharedPlanCacheEnabled(void);
+extern uint64 SharedPlanCacheGeneration(void);
+
+extern char *SharedPlanCacheLookup(const SharedPlanIdentity *id,
+								   double *total_custom_cost,
+								   int64 *num_custom_plans);
+extern void SharedPlanCacheStore(const SharedPlanIdentity *id,
+								 const char *plan_string,
+								 List *relationOids, List *invalItems,
+								 double total_custom_cost,
+								 int64 num_custom_plans,
+								 uint64 generation);
+extern void SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+											  int n);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedresultcache.h
+ *	  Results of expensive immutable functions shared between backends.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedresultcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDRESULTCACHE_H
+#define SHAREDRESULTCACHE_H
+
+#include "fmgr.h"
+#include "nodes/pg_list.h"
+#include "nodes/primnodes.h"
+#include "storage/sinval.h"
+
+/* GUC: size of the shared result cache in kilobytes, 0 disables it */
+extern int	shared_result_cache_size;
+
+/* GUC: only functions declared at least this expensive are cached */
+extern double shared_result_cache_min_cost;
+
+extern Size SharedResultCacheShmemSize(void);
+extern void SharedResultCacheShmemInit(void);
+
+extern bool SharedResultCacheEnabled(void);
+extern void SharedResultCacheSetupCall(FmgrInfo *flinfo, Oid funcid,
+									   Oid inputcollid, Expr *node,
+									   List *args);
+extern void SharedResultCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+												int n);
+
+#endif							/* SHAREDRESULTCACHE_H */
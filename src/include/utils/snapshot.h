@@ -14,6 +14,7 @@
 #define SNAPSHOT_H
 
 #include "access/htup.h"
+#include "access/transam.h"
 #include "access/xlogdefs.h"
 #include "datatype/timestamp.h"
 #include "lib/pairingheap.h"
@@ -181,6 +182,14 @@ typedef struct SnapshotData
 	int32		subxcnt;		/* # of xact ids in subxip[] */
 	bool		suboverflowed;	/* has the subxip array overflowed? */
 
+	/*
+	 * With csn_snapshots, normal MVCC snapshots taken outside recovery don't
+	 * list the in-progress XIDs at all.  Instead, an XID between xmin and
+	 * xmax is visible if its commit sequence number (see csnlog.c) is smaller
+	 * than snapshotcsn.  InvalidCommitSeqNo for all other snapshots.
+	 */
+	CommitSeqNo snapshotcsn;
+
 	bool		takenDuringRecovery;	/* recovery-shaped snapshot? */
 	bool		copied;			/* false if it's a static snapshot */
 
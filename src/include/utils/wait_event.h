@@ -10,6 +10,7 @@
 #ifndef WAIT_EVENT_H
 #define WAIT_EVENT_H
 
+#include "portability/instr_time.h"
 
 /* ----------
  * Wait Classes
@@ -40,9 +41,10 @@ typedef enum
 	WAIT_EVENT_BGWRITER_HIBERNATE,
 	WAIT_EVENT_BGWRITER_MAIN,
 	WAIT_EVENT_CHECKPOINTER_MAIN,
+	WAIT_EVENT_CONNECTION_PROXY_MAIN,
 	WAIT_EVENT_LOGICAL_APPLY_MAIN,
 	WAIT_EVENT_LOGICAL_LAUNCHER_MAIN,
-	WAIT_EVENT_PGSTAT_MAIN,
+	WAIT_EVENT_PARALLEL_WORKER_IDLE,
 	WAIT_EVENT_RECOVERY_WAL_STREAM,
 	WAIT_EVENT_SYSLOGGER_MAIN,
 	WAIT_EVENT_WAL_RECEIVER_MAIN,
@@ -80,6 +82,7 @@ typedef enum
 typedef enum
 {
 	WAIT_EVENT_APPEND_READY = PG_WAIT_IPC,
+	WAIT_EVENT_ARCHIVE_COMMAND,
 	WAIT_EVENT_BACKEND_TERMINATION,
 	WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE,
 	WAIT_EVENT_BGWORKER_SHUTDOWN,
@@ -118,7 +121,9 @@ typedef enum
 	WAIT_EVENT_PROMOTE,
 	WAIT_EVENT_RECOVERY_CONFLICT_SNAPSHOT,
 	WAIT_EVENT_RECOVERY_CONFLICT_TABLESPACE,
+	WAIT_EVENT_RECOVERY_PARALLEL_REDO,
 	WAIT_EVENT_RECOVERY_PAUSE,
+	WAIT_EVENT_REDISTRIBUTE_WRITE,
 	WAIT_EVENT_REPLICATION_ORIGIN_DROP,
 	WAIT_EVENT_REPLICATION_SLOT_DROP,
 	WAIT_EVENT_SAFE_SNAPSHOT,
@@ -171,6 +176,9 @@ typedef enum
 	WAIT_EVENT_DATA_FILE_SYNC,
 	WAIT_EVENT_DATA_FILE_TRUNCATE,
 	WAIT_EVENT_DATA_FILE_WRITE,
+	WAIT_EVENT_DOUBLE_WRITE_READ,
+	WAIT_EVENT_DOUBLE_WRITE_SYNC,
+	WAIT_EVENT_DOUBLE_WRITE_WRITE,
 	WAIT_EVENT_DSM_FILL_ZERO_WRITE,
 	WAIT_EVENT_LOCK_FILE_ADDTODATADIR_READ,
 	WAIT_EVENT_LOCK_FILE_ADDTODATADIR_SYNC,
@@ -231,9 +239,27 @@ static inline void pgstat_report_wait_start(uint32 wait_event_info);
 static inline void pgstat_report_wait_end(void);
 extern void pgstat_set_wait_event_storage(uint32 *wait_event_info);
 extern void pgstat_reset_wait_event_storage(void);
+extern void pgstat_count_wait_end(void);
+extern int	pgstat_wait_event_slot(uint32 wait_event_info);
+extern uint32 pgstat_wait_event_slot_info(int slot, bool *other);
+extern int	pgstat_wait_class_index(uint32 wait_event_info);
+extern uint32 pgstat_wait_class_info(int class_index);
 
 extern PGDLLIMPORT uint32 *my_wait_event_info;
 
+/* GUC parameter */
+extern PGDLLIMPORT bool track_wait_timing;
+
+/* start of the current wait in ticks, if it is being timed, else 0 */
+extern PGDLLIMPORT uint64 my_wait_start_ticks;
+
+/*
+ * Total time this process has spent in timed waits, in ticks.  Like
+ * pgBufferUsage, this is never reset, so that callers can measure the wait
+ * time of some work by subtracting.
+ */
+extern PGDLLIMPORT uint64 pgStatWaitTicks;
+
 
 /* ----------
  * pgstat_report_wait_start() -
@@ -252,6 +278,9 @@ extern PGDLLIMPORT uint32 *my_wait_event_info;
  *
  *	my_wait_event_info initially points to local memory, making it safe to
  *	call this before MyProc has been initialized.
+ *
+ *	With track_wait_timing, we also note when the wait started, so that
+ *	pgstat_report_wait_end() can count the time spent.
  * ----------
  */
 static inline void
@@ -262,6 +291,9 @@ pgstat_report_wait_start(uint32 wait_event_info)
 	 * four-bytes, updates are atomic.
 	 */
 	*(volatile uint32 *) my_wait_event_info = wait_event_info;
+
+	if (unlikely(track_wait_timing))
+		my_wait_start_ticks = pg_get_ticks();
 }
 
 /* ----------
@@ -273,6 +305,10 @@ pgstat_report_wait_start(uint32 wait_event_info)
 static inline void
 pgstat_report_wait_end(void)
 {
+	/* this needs the wait event, so must come first */
+	if (unlikely(my_wait_start_ticks != 0))
+		pgstat_count_wait_end();
+
 	/* see pgstat_report_wait_start() */
 	*(volatile uint32 *) my_wait_event_info = 0;
 }
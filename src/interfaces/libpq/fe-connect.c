@@ -344,6 +344,10 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Target-Session-Attrs", "", 15, /* sizeof("prefer-standby") = 15 */
 	offsetof(struct pg_conn, target_session_attrs)},
 
+	{"compression", "PGCOMPRESSION", NULL, NULL,
+		"Protocol-Compression", "", 16,
+	offsetof(struct pg_conn, compression)},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -462,6 +466,13 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Always discard any unsent data */
 	conn->outCount = 0;
 
+	/* Compression state belongs to the connection */
+	if (conn->zstream)
+	{
+		zpq_free(conn->zstream);
+		conn->zstream = NULL;
+	}
+
 	/* Free authentication/encryption state */
 #ifdef ENABLE_GSS
 	{
@@ -1424,6 +1435,45 @@ connectOptions2(PGconn *conn)
 	else
 		conn->target_server_type = SERVER_TYPE_ANY;
 
+	/*
+	 * validate compression option: all the listed methods must be supported
+	 * by this build, since the server may pick any of them
+	 */
+	if (conn->compression && conn->compression[0])
+	{
+		char	   *s = conn->compression;
+		bool		more = true;
+
+		while (more)
+		{
+			char	   *method = parse_comma_separated_list(&s, &more);
+			ZpqAlgorithm algorithm;
+
+			if (method == NULL)
+				goto oom_error;
+			if (!zpq_parse_algorithm(method, &algorithm))
+			{
+				conn->status = CONNECTION_BAD;
+				appendPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid %s value: \"%s\"\n"),
+								  "compression",
+								  conn->compression);
+				free(method);
+				return false;
+			}
+			if (!zpq_algorithm_supported(algorithm))
+			{
+				conn->status = CONNECTION_BAD;
+				appendPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("compression method \"%s\" is not supported by this build\n"),
+								  method);
+				free(method);
+				return false;
+			}
+			free(method);
+		}
+	}
+
 	/*
 	 * Resolve special "auto" client_encoding from the locale
 	 */
@@ -3246,10 +3296,13 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
-				 * it's not Postgres on the other end at all.
+				 * request or an error here, or the server's choice of
+				 * protocol compression if we asked for that.  Anything else
+				 * probably means it's not Postgres on the other end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' ||
+					  (beresp == 'z' && conn->compression &&
+					   conn->compression[0] && conn->zstream == NULL)))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext("expected authentication request from server, but received %c\n"),
@@ -3282,6 +3335,13 @@ keep_going:						/* We will come back to here until there is
 					goto error_return;
 				}
 
+				if (beresp == 'z' && (msgLength < 5 || msgLength > 100))
+				{
+					appendPQExpBufferStr(&conn->errorMessage,
+										 libpq_gettext("invalid compression message from server\n"));
+					goto error_return;
+				}
+
 				if (beresp == 'E' && (msgLength < 8 || msgLength > 30000))
 				{
 					/* Handle error from a pre-3.0 server */
@@ -3327,6 +3387,32 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/* Switch to the compression method the server picked. */
+				if (beresp == 'z')
+				{
+					ZpqAlgorithm algorithm;
+
+					if (pqGets(&conn->workBuffer, conn))
+					{
+						/* We'll come back when there is more data */
+						return PGRES_POLLING_READING;
+					}
+					if (!zpq_parse_algorithm(conn->workBuffer.data, &algorithm) ||
+						!zpq_algorithm_supported(algorithm))
+					{
+						appendPQExpBuffer(&conn->errorMessage,
+										  libpq_gettext("server requested unsupported compression method \"%s\"\n"),
+										  conn->workBuffer.data);
+						goto error_return;
+					}
+					/* OK, we read the message; mark data consumed */
+					conn->inStart = conn->inCursor;
+
+					if (pqStartCompression(conn, algorithm) < 0)
+						goto error_return;
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -4134,8 +4220,14 @@ freePGconn(PGconn *conn)
 		free(conn->outBuffer);
 	if (conn->rowBuf)
 		free(conn->rowBuf);
+	if (conn->rowBatchValues)
+		free(conn->rowBatchValues);
+	if (conn->rowBatchLengths)
+		free(conn->rowBatchLengths);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
+	if (conn->compression)
+		free(conn->compression);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -41,7 +41,8 @@ char	   *const pgresStatus[] = {
 	"PGRES_COPY_BOTH",
 	"PGRES_SINGLE_TUPLE",
 	"PGRES_PIPELINE_SYNC",
-	"PGRES_PIPELINE_ABORTED"
+	"PGRES_PIPELINE_ABORTED",
+	"PGRES_TUPLES_CHUNK"
 };
 
 /*
@@ -61,6 +62,7 @@ static int	PQsendQueryGuts(PGconn *conn,
 							const char *command,
 							const char *stmtName,
 							int nParams,
+							int nSets,
 							const Oid *paramTypes,
 							const char *const *paramValues,
 							const int *paramLengths,
@@ -188,6 +190,7 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 			case PGRES_COPY_IN:
 			case PGRES_COPY_BOTH:
 			case PGRES_SINGLE_TUPLE:
+			case PGRES_TUPLES_CHUNK:
 				/* non-error cases */
 				break;
 			default:
@@ -1102,6 +1105,13 @@ pqSaveParameterStatus(PGconn *conn, const char *name, const char *value)
  * stashing the previous result in conn->next_result so that it becomes
  * active again after pqPrepareAsyncResult().  This allows the result metadata
  * (column descriptions) to be carried forward to each result row.
+ *
+ * Chunked rows mode works the same way, except that the new result holds
+ * rows until it has maxChunkSize of them.  pqParseInput3() makes sure that a
+ * partially filled chunk is returned before anything that ends the rows.
+ *
+ * In row batch mode, we just remember where the row's values are in the
+ * input buffer, for PQgetRowBatch.
  */
 int
 pqRowProcessor(PGconn *conn, const char **errmsgp)
@@ -1112,12 +1122,64 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 	PGresAttValue *tup;
 	int			i;
 
+	if (conn->rowBatchMode)
+	{
+		int			row = conn->rowBatchRows;
+
+		Assert(conn->rowBatchCollect && row < conn->rowBatchMax);
+
+		/* Make room for a full batch when we get its first row */
+		if (row == 0)
+		{
+			size_t		len = (size_t) nfields * conn->rowBatchMax;
+
+			if (len > conn->rowBatchLen)
+			{
+				const char **values;
+				int		   *lengths;
+
+				values = (const char **) realloc(conn->rowBatchValues,
+												 len * sizeof(char *));
+				if (!values)
+					return 0;
+				conn->rowBatchValues = values;
+				lengths = (int *) realloc(conn->rowBatchLengths,
+										  len * sizeof(int));
+				if (!lengths)
+					return 0;
+				conn->rowBatchLengths = lengths;
+				conn->rowBatchLen = len;
+			}
+			conn->rowBatchFields = nfields;
+		}
+
+		for (i = 0; i < nfields; i++)
+		{
+			size_t		idx = (size_t) i * conn->rowBatchMax + row;
+
+			if (columns[i].len < 0)
+			{
+				conn->rowBatchValues[idx] = NULL;
+				conn->rowBatchLengths[idx] = NULL_LEN;
+			}
+			else
+			{
+				conn->rowBatchValues[idx] = columns[i].value;
+				conn->rowBatchLengths[idx] = columns[i].len;
+			}
+		}
+		conn->rowBatchRows++;
+
+		return 1;
+	}
+
 	/*
 	 * In single-row mode, make a new PGresult that will hold just this one
 	 * row; the original conn->result is left unchanged so that it can be used
 	 * again as the template for future rows.
 	 */
-	if (conn->singleRowMode)
+	if (conn->singleRowMode ||
+		(conn->maxChunkSize > 0 && res->resultStatus != PGRES_TUPLES_CHUNK))
 	{
 		/* Copy everything that should be in the result at this point */
 		res = PQcopyResult(res,
@@ -1187,6 +1249,19 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 		/* And mark the result ready to return */
 		conn->asyncStatus = PGASYNC_READY_MORE;
 	}
+	else if (conn->maxChunkSize > 0)
+	{
+		/* Start a new chunk, stashing old result like single-row mode */
+		if (res != conn->result)
+		{
+			res->resultStatus = PGRES_TUPLES_CHUNK;
+			conn->next_result = conn->result;
+			conn->result = res;
+		}
+		/* Make the chunk available to the client once it's full */
+		if (res->ntups >= conn->maxChunkSize)
+			conn->asyncStatus = PGASYNC_READY_MORE;
+	}
 
 	return 1;
 
@@ -1466,6 +1541,7 @@ PQsendQueryParams(PGconn *conn,
 						   command,
 						   "",	/* use unnamed statement */
 						   nParams,
+						   0,	/* ordinary Bind */
 						   paramTypes,
 						   paramValues,
 						   paramLengths,
@@ -1611,6 +1687,67 @@ PQsendQueryPrepared(PGconn *conn,
 						   NULL,	/* no command to parse */
 						   stmtName,
 						   nParams,
+						   0,	/* ordinary Bind */
+						   NULL,	/* no param types */
+						   paramValues,
+						   paramLengths,
+						   paramFormats,
+						   resultFormat);
+}
+
+/*
+ * PQsendQueryPreparedBulk
+ *		Like PQsendQueryPrepared, but execute the statement once for each of
+ *		nSets parameter sets, using a single BulkBind message
+ *
+ * paramValues and paramLengths hold nSets * nParams entries, one parameter
+ * set after the other; paramFormats applies to all the sets.
+ */
+int
+PQsendQueryPreparedBulk(PGconn *conn,
+						const char *stmtName,
+						int nParams,
+						int nSets,
+						const char *const *paramValues,
+						const int *paramLengths,
+						const int *paramFormats,
+						int resultFormat)
+{
+	if (!PQsendQueryStart(conn, true))
+		return 0;
+
+	/* check the arguments */
+	if (!stmtName)
+	{
+		appendPQExpBufferStr(&conn->errorMessage,
+							 libpq_gettext("statement name is a null pointer\n"));
+		return 0;
+	}
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
+	{
+		appendPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("number of parameters must be between 0 and %d\n"),
+						  PQ_QUERY_PARAM_MAX_LIMIT);
+		return 0;
+	}
+	if (nSets <= 0 || (nParams > 0 && nSets > INT_MAX / nParams))
+	{
+		appendPQExpBufferStr(&conn->errorMessage,
+							 libpq_gettext("invalid number of parameter sets\n"));
+		return 0;
+	}
+	if (conn->sversion < 150000)
+	{
+		appendPQExpBufferStr(&conn->errorMessage,
+							 libpq_gettext("bulk bind requires server version 15 or later\n"));
+		return 0;
+	}
+
+	return PQsendQueryGuts(conn,
+						   NULL,	/* no command to parse */
+						   stmtName,
+						   nParams,
+						   nSets,
 						   NULL,	/* no param types */
 						   paramValues,
 						   paramLengths,
@@ -1688,8 +1825,10 @@ PQsendQueryStart(PGconn *conn, bool newQuery)
 		 */
 		pqClearAsyncResult(conn);
 
-		/* reset single-row processing mode */
+		/* reset single-row, chunked rows and row batch processing modes */
 		conn->singleRowMode = false;
+		conn->maxChunkSize = 0;
+		conn->rowBatchMode = false;
 
 	}
 	/* ready to send command message */
@@ -1702,12 +1841,16 @@ PQsendQueryStart(PGconn *conn, bool newQuery)
  *		PQsendQueryStart should be done already
  *
  * command may be NULL to indicate we use an already-prepared statement
+ *
+ * nSets is the number of parameter sets to send in a BulkBind message, or 0
+ * to send an ordinary Bind message with a single set
  */
 static int
 PQsendQueryGuts(PGconn *conn,
 				const char *command,
 				const char *stmtName,
 				int nParams,
+				int nSets,
 				const Oid *paramTypes,
 				const char *const *paramValues,
 				const int *paramLengths,
@@ -1753,8 +1896,8 @@ PQsendQueryGuts(PGconn *conn,
 			goto sendFailed;
 	}
 
-	/* Construct the Bind message */
-	if (pqPutMsgStart('B', conn) < 0 ||
+	/* Construct the Bind or BulkBind message */
+	if (pqPutMsgStart(nSets > 0 ? 'b' : 'B', conn) < 0 ||
 		pqPuts("", conn) < 0 ||
 		pqPuts(stmtName, conn) < 0)
 		goto sendFailed;
@@ -1779,14 +1922,17 @@ PQsendQueryGuts(PGconn *conn,
 	if (pqPutInt(nParams, 2, conn) < 0)
 		goto sendFailed;
 
-	/* Send parameters */
-	for (i = 0; i < nParams; i++)
+	if (nSets > 0 && pqPutInt(nSets, 4, conn) < 0)
+		goto sendFailed;
+
+	/* Send parameters, set by set */
+	for (i = 0; i < nParams * Max(nSets, 1); i++)
 	{
 		if (paramValues && paramValues[i])
 		{
 			int			nbytes;
 
-			if (paramFormats && paramFormats[i] != 0)
+			if (paramFormats && paramFormats[i % nParams] != 0)
 			{
 				/* binary parameter */
 				if (paramLengths)
@@ -1890,11 +2036,71 @@ PQsetSingleRowMode(PGconn *conn)
 	if (conn->result)
 		return 0;
 
+	if (conn->rowBatchMode || conn->maxChunkSize > 0)
+		return 0;
+
 	/* OK, set flag */
 	conn->singleRowMode = true;
 	return 1;
 }
 
+/*
+ * Select chunked rows processing mode
+ *
+ * This is like single-row mode, except that each result holds up to
+ * chunkSize rows, which saves the overhead of a PGresult per row.
+ */
+int
+PQsetChunkedRowsMode(PGconn *conn, int chunkSize)
+{
+	/* The same restrictions apply as for single-row mode. */
+	if (!conn || chunkSize <= 0)
+		return 0;
+	if (conn->asyncStatus != PGASYNC_BUSY)
+		return 0;
+	if (!conn->cmd_queue_head ||
+		(conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE &&
+		 conn->cmd_queue_head->queryclass != PGQUERY_EXTENDED))
+		return 0;
+	if (conn->result)
+		return 0;
+	if (conn->singleRowMode || conn->rowBatchMode)
+		return 0;
+
+	/* OK, set chunk size */
+	conn->maxChunkSize = chunkSize;
+	return 1;
+}
+
+/*
+ * Select row batch processing mode
+ *
+ * The query's rows are then retrieved with PQgetRowBatch, straight from the
+ * input buffer.
+ */
+int
+PQsetRowBatchMode(PGconn *conn)
+{
+	/* The same restrictions apply as for single-row mode. */
+	if (!conn)
+		return 0;
+	if (conn->asyncStatus != PGASYNC_BUSY)
+		return 0;
+	if (!conn->cmd_queue_head ||
+		(conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE &&
+		 conn->cmd_queue_head->queryclass != PGQUERY_EXTENDED))
+		return 0;
+	if (conn->result)
+		return 0;
+	if (conn->singleRowMode || conn->maxChunkSize > 0)
+		return 0;
+
+	/* OK, set flag */
+	conn->rowBatchMode = true;
+	conn->rowBatchRows = 0;
+	return 1;
+}
+
 /*
  * Consume any available input from the backend
  * 0 return: some kind of trouble
@@ -1958,8 +2164,11 @@ PQisBusy(PGconn *conn)
 
 	/*
 	 * PQgetResult will return immediately in all states except BUSY, or if we
-	 * had a write failure.
+	 * had a write failure.  In row batch mode, PQgetRowBatch will also return
+	 * immediately if a row is waiting for it.
 	 */
+	if (conn->rowBatchMode && conn->rowBatchPending)
+		return false;
 	return conn->asyncStatus == PGASYNC_BUSY || conn->write_failed;
 }
 
@@ -1982,6 +2191,13 @@ PQgetResult(PGconn *conn)
 	if (!conn)
 		return NULL;
 
+	/*
+	 * Leave row batch mode; any rows not retrieved by PQgetRowBatch will be
+	 * collected in the result.
+	 */
+	conn->rowBatchMode = false;
+	conn->rowBatchPending = false;
+
 	/* Parse any available data, if our state permits. */
 	parseInput(conn);
 
@@ -2147,6 +2363,107 @@ PQgetResult(PGconn *conn)
 	return res;
 }
 
+/*
+ * PQgetRowBatch
+ *	  Get up to maxRows rows of the current query result, in row batch mode.
+ *	  Returns the number of rows, or 0 if no more rows will arrive (or on
+ *	  error; PQgetResult then reports it), or -1 if not in row batch mode.
+ *
+ * Like PQgetResult, this blocks until rows arrive.  The rows are not copied;
+ * PQrowBatchValues and PQrowBatchLengths point into the input buffer.  They
+ * are valid only until the next call of a libpq function on the connection,
+ * which is why we stop parsing input at the first row that doesn't fit in
+ * the batch.
+ */
+int
+PQgetRowBatch(PGconn *conn, int maxRows)
+{
+	if (!conn)
+		return -1;
+	if (!conn->rowBatchMode || maxRows <= 0)
+		return -1;
+
+	/* Forget the previous batch, if any */
+	conn->rowBatchRows = 0;
+	conn->rowBatchMax = maxRows;
+
+	for (;;)
+	{
+		int			flushResult;
+
+		/* Collect whatever rows are available */
+		conn->rowBatchPending = false;
+		conn->rowBatchCollect = true;
+		parseInput(conn);
+		conn->rowBatchCollect = false;
+
+		if (conn->rowBatchRows > 0)
+			return conn->rowBatchRows;
+
+		/* Done if the rows have ended, or something went wrong */
+		if (conn->asyncStatus != PGASYNC_BUSY || conn->write_failed)
+			return 0;
+
+		/* Otherwise wait for more rows, as PQgetResult would */
+		while ((flushResult = pqFlush(conn)) > 0)
+		{
+			if (pqWait(false, true, conn))
+			{
+				flushResult = -1;
+				break;
+			}
+		}
+
+		/* On I/O failure, let PQgetResult encounter it again and report it */
+		if (flushResult ||
+			pqWait(true, false, conn) ||
+			pqReadData(conn) < 0)
+			return 0;
+	}
+}
+
+/*
+ * PQrowBatchDescription
+ *	  Get a result describing the columns of the rows returned by
+ *	  PQgetRowBatch.  It's valid until PQgetResult returns it.
+ */
+const PGresult *
+PQrowBatchDescription(const PGconn *conn)
+{
+	if (!conn || !conn->rowBatchMode || !conn->result ||
+		conn->result->resultStatus != PGRES_TUPLES_OK)
+		return NULL;
+	return conn->result;
+}
+
+/*
+ * PQrowBatchValues
+ *	  Get an array of the values of one column in the rows returned by
+ *	  PQgetRowBatch.  The values are not null-terminated; nulls are NULL.
+ */
+const char *const *
+PQrowBatchValues(const PGconn *conn, int field_num)
+{
+	if (!conn || !conn->rowBatchMode || conn->rowBatchRows == 0 ||
+		field_num < 0 || field_num >= conn->rowBatchFields)
+		return NULL;
+	return conn->rowBatchValues + (size_t) field_num * conn->rowBatchMax;
+}
+
+/*
+ * PQrowBatchLengths
+ *	  Get an array of the lengths of the values of one column in the rows
+ *	  returned by PQgetRowBatch, with -1 for nulls.
+ */
+const int *
+PQrowBatchLengths(const PGconn *conn, int field_num)
+{
+	if (!conn || !conn->rowBatchMode || conn->rowBatchRows == 0 ||
+		field_num < 0 || field_num >= conn->rowBatchFields)
+		return NULL;
+	return conn->rowBatchLengths + (size_t) field_num * conn->rowBatchMax;
+}
+
 /*
  * getCopyResult
  *	  Helper for PQgetResult: generate result for COPY-in-progress cases
@@ -2268,6 +2585,30 @@ PQexecPrepared(PGconn *conn,
 	return PQexecFinish(conn);
 }
 
+/*
+ * PQexecPreparedBulk
+ *		Like PQexecPrepared, but execute the statement once for each of
+ *		nSets parameter sets
+ */
+PGresult *
+PQexecPreparedBulk(PGconn *conn,
+				   const char *stmtName,
+				   int nParams,
+				   int nSets,
+				   const char *const *paramValues,
+				   const int *paramLengths,
+				   const int *paramFormats,
+				   int resultFormat)
+{
+	if (!PQexecStart(conn))
+		return NULL;
+	if (!PQsendQueryPreparedBulk(conn, stmtName,
+								 nParams, nSets, paramValues, paramLengths,
+								 paramFormats, resultFormat))
+		return NULL;
+	return PQexecFinish(conn);
+}
+
 /*
  * Common code for PQexec and sibling routines: prepare to send command
  */
@@ -3020,10 +3361,12 @@ pqPipelineProcessQueue(PGconn *conn)
 	pqClearAsyncResult(conn);
 
 	/*
-	 * Reset single-row processing mode.  (Client has to set it up for each
-	 * query, if desired.)
+	 * Reset single-row, chunked rows and row batch processing modes.  (Client
+	 * has to set them up for each query, if desired.)
 	 */
 	conn->singleRowMode = false;
+	conn->maxChunkSize = 0;
+	conn->rowBatchMode = false;
 
 	if (conn->pipelineStatus == PQ_PIPELINE_ABORTED &&
 		conn->cmd_queue_head->queryclass != PGQUERY_SYNC)
@@ -54,6 +54,7 @@
 #include "port/pg_bswap.h"
 
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
+static ssize_t pqReadSome(PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
 static int	pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 						  time_t end_time);
@@ -617,8 +618,7 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadSome(conn);
 	if (nread < 0)
 	{
 		switch (SOCK_ERRNO)
@@ -712,8 +712,7 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadSome(conn);
 	if (nread < 0)
 	{
 		switch (SOCK_ERRNO)
@@ -764,6 +763,126 @@ definitelyFailed:
 	return -1;
 }
 
+/*
+ * pqReadSome: read data into the free space of conn->inBuffer
+ *
+ * This is pqsecure_read(), except that with protocol compression the data is
+ * decompressed.  In that case we decompress everything received so far,
+ * enlarging the buffer as needed: callers wait for the socket to become
+ * readable before asking for more, so nothing may be left behind in the
+ * stream.  Returns the same as pqsecure_read(); conn->inEnd is not advanced.
+ */
+static ssize_t
+pqReadSome(PGconn *conn)
+{
+	size_t		total = 0;
+
+	if (conn->zstream == NULL)
+		return pqsecure_read(conn, conn->inBuffer + conn->inEnd,
+							 conn->inBufSize - conn->inEnd);
+
+	for (;;)
+	{
+		ssize_t		n;
+		char	   *raw;
+		size_t		avail;
+
+		/* Decompress whatever we have */
+		while (zpq_input_pending(conn->zstream))
+		{
+			if (conn->inBufSize - conn->inEnd - total < 8192 &&
+				pqCheckInBufferSpace(conn->inEnd + total + 8192, conn))
+			{
+				/* errorMessage already set; not recoverable */
+				SOCK_ERRNO_SET(ECONNRESET);
+				return -1;
+			}
+
+			n = zpq_decompress(conn->zstream,
+							   conn->inBuffer + conn->inEnd + total,
+							   conn->inBufSize - conn->inEnd - total);
+			if (n < 0)
+			{
+				appendPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("could not decompress data from server: %s\n"),
+								  zpq_error(conn->zstream));
+				SOCK_ERRNO_SET(ECONNRESET);
+				return -1;
+			}
+			if (n == 0)
+				break;
+			total += n;
+		}
+		if (total > 0)
+			return total;
+
+		/* Need more input */
+		raw = zpq_input_space(conn->zstream, 0, &avail);
+		if (raw == NULL)
+		{
+			appendPQExpBufferStr(&conn->errorMessage,
+								 libpq_gettext("out of memory\n"));
+			SOCK_ERRNO_SET(ECONNRESET);
+			return -1;
+		}
+		n = pqsecure_read(conn, raw, avail);
+		if (n <= 0)
+			return n;
+		zpq_input_done(conn->zstream, n);
+	}
+}
+
+/*
+ * pqStartCompression: switch to protocol compression
+ *
+ * Called when the server has announced the compression method it chose;
+ * everything after that message is compressed, in both directions.  Input
+ * already read past the message is handed to the stream and decompressed.
+ *
+ * Returns 0 on success, -1 on failure with conn->errorMessage set.
+ */
+int
+pqStartCompression(PGconn *conn, ZpqAlgorithm algorithm)
+{
+	ZpqStream  *zs;
+
+	zs = zpq_create(algorithm);
+	if (zs == NULL)
+	{
+		appendPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not initialize protocol compression method \"%s\"\n"),
+						  zpq_algorithm_name(algorithm));
+		return -1;
+	}
+
+	if (conn->inStart < conn->inEnd)
+	{
+		size_t		len = conn->inEnd - conn->inStart;
+		char	   *raw;
+		size_t		avail;
+
+		raw = zpq_input_space(zs, len, &avail);
+		if (raw == NULL)
+		{
+			zpq_free(zs);
+			appendPQExpBufferStr(&conn->errorMessage,
+								 libpq_gettext("out of memory\n"));
+			return -1;
+		}
+		memcpy(raw, conn->inBuffer + conn->inStart, len);
+		zpq_input_done(zs, len);
+		conn->inEnd = conn->inCursor = conn->inStart;
+	}
+
+	conn->zstream = zs;
+
+	/* The socket needn't become readable again for data we already have */
+	if (zpq_input_pending(zs) && pqReadData(conn) < 0)
+		return -1;
+
+	return 0;
+}
+
 /*
  * pqSendSome: send data waiting in the output buffer.
  *
@@ -791,6 +910,7 @@ pqSendSome(PGconn *conn, int len)
 	int			remaining = conn->outCount;
 	int			oldmsglen = conn->errorMessage.len;
 	int			result = 0;
+	size_t		zlen = 0;
 
 	/*
 	 * If we already had a write failure, we will never again try to send data
@@ -825,6 +945,40 @@ pqSendSome(PGconn *conn, int len)
 		return 0;
 	}
 
+	/*
+	 * With protocol compression, compress the data now and send the
+	 * compressed data instead.  Whatever can't be sent right away stays in
+	 * the stream; "len" and "remaining" then count compressed bytes.
+	 */
+	if (conn->zstream)
+	{
+		if (len > 0)
+		{
+			if (zpq_compress(conn->zstream, ptr, len) < 0)
+			{
+				char		msgbuf[256];
+
+				snprintf(msgbuf, sizeof(msgbuf),
+						 libpq_gettext("could not compress data to send: %s\n"),
+						 zpq_error(conn->zstream));
+				conn->write_failed = true;
+				/* (strdup failure is OK, we'll cope later) */
+				conn->write_err_msg = strdup(msgbuf);
+				conn->outCount = 0;
+				return 0;
+			}
+
+			/* remove the compressed data from the output buffer */
+			remaining -= len;
+			if (remaining > 0)
+				memmove(conn->outBuffer, conn->outBuffer + len, remaining);
+			conn->outCount = remaining;
+		}
+
+		ptr = zpq_output(conn->zstream, &zlen);
+		len = remaining = (int) zlen;
+	}
+
 	/* while there's still data to send */
 	while (len > 0)
 	{
@@ -879,6 +1033,8 @@ pqSendSome(PGconn *conn, int len)
 
 					/* Discard queued data; no chance it'll ever be sent */
 					conn->outCount = 0;
+					if (conn->zstream)
+						zpq_output_done(conn->zstream, zlen);
 
 					/* Absorb input data if any, and detect socket closure */
 					if (conn->sock != PGINVALID_SOCKET)
@@ -945,10 +1101,18 @@ pqSendSome(PGconn *conn, int len)
 		}
 	}
 
-	/* shift the remaining contents of the buffer */
-	if (remaining > 0)
-		memmove(conn->outBuffer, ptr, remaining);
-	conn->outCount = remaining;
+	if (conn->zstream)
+	{
+		/* just mark what we sent of the compressed data */
+		zpq_output_done(conn->zstream, zlen - remaining);
+	}
+	else
+	{
+		/* shift the remaining contents of the buffer */
+		if (remaining > 0)
+			memmove(conn->outBuffer, ptr, remaining);
+		conn->outCount = remaining;
+	}
 
 	return result;
 }
@@ -964,7 +1128,8 @@ pqSendSome(PGconn *conn, int len)
 int
 pqFlush(PGconn *conn)
 {
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 ||
+		(conn->zstream && zpq_output_pending(conn->zstream)))
 	{
 		if (conn->Pfdebug)
 			fflush(conn->Pfdebug);
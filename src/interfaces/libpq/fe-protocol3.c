@@ -201,6 +201,17 @@ pqParseInput3(PGconn *conn)
 		}
 		else
 		{
+			/*
+			 * In chunked rows mode, return a partially filled chunk before
+			 * whatever comes after the last row.
+			 */
+			if (id != 'D' && conn->result != NULL &&
+				conn->result->resultStatus == PGRES_TUPLES_CHUNK)
+			{
+				conn->asyncStatus = PGASYNC_READY_MORE;
+				return;
+			}
+
 			/*
 			 * In BUSY state, we can process everything.
 			 */
@@ -380,8 +391,22 @@ pqParseInput3(PGconn *conn)
 						return;
 					break;
 				case 'D':		/* Data Row */
+					if (conn->rowBatchMode && conn->result != NULL &&
+						conn->result->resultStatus == PGRES_TUPLES_OK &&
+						(!conn->rowBatchCollect ||
+						 conn->rowBatchRows >= conn->rowBatchMax))
+					{
+						/*
+						 * Leave the row for the next PQgetRowBatch call, so
+						 * that the input buffer isn't disturbed before the
+						 * rows already returned have been used.
+						 */
+						conn->rowBatchPending = true;
+						return;
+					}
 					if (conn->result != NULL &&
-						conn->result->resultStatus == PGRES_TUPLES_OK)
+						(conn->result->resultStatus == PGRES_TUPLES_OK ||
+						 conn->result->resultStatus == PGRES_TUPLES_CHUNK))
 					{
 						/* Read another tuple of a normal query response */
 						if (getAnotherTuple(conn, msgLength))
@@ -2230,6 +2255,8 @@ build_startup_packet(const PGconn *conn, char *packet,
 
 	if (conn->client_encoding_initial && conn->client_encoding_initial[0])
 		ADD_STARTUP_OPTION("client_encoding", conn->client_encoding_initial);
+	if (conn->compression && conn->compression[0])
+		ADD_STARTUP_OPTION("_pq_.compression", conn->compression);
 
 	/* Add any environment-driven GUC settings needed */
 	for (next_eo = options; next_eo->envName; next_eo++)
@@ -107,8 +107,9 @@ typedef enum
 	PGRES_COPY_BOTH,			/* Copy In/Out data transfer in progress */
 	PGRES_SINGLE_TUPLE,			/* single tuple from larger resultset */
 	PGRES_PIPELINE_SYNC,		/* pipeline synchronization point */
-	PGRES_PIPELINE_ABORTED		/* Command didn't run because of an abort
+	PGRES_PIPELINE_ABORTED,		/* Command didn't run because of an abort
 								 * earlier in a pipeline */
+	PGRES_TUPLES_CHUNK			/* chunk of tuples from larger resultset */
 } ExecStatusType;
 
 typedef enum
@@ -436,6 +437,14 @@ extern PGresult *PQexecPrepared(PGconn *conn,
 								const int *paramLengths,
 								const int *paramFormats,
 								int resultFormat);
+extern PGresult *PQexecPreparedBulk(PGconn *conn,
+									const char *stmtName,
+									int nParams,
+									int nSets,
+									const char *const *paramValues,
+									const int *paramLengths,
+									const int *paramFormats,
+									int resultFormat);
 
 /* Interface for multiple-result or asynchronous queries */
 #define PQ_QUERY_PARAM_MAX_LIMIT 65535
@@ -459,9 +468,25 @@ extern int	PQsendQueryPrepared(PGconn *conn,
 								const int *paramLengths,
 								const int *paramFormats,
 								int resultFormat);
+extern int	PQsendQueryPreparedBulk(PGconn *conn,
+									const char *stmtName,
+									int nParams,
+									int nSets,
+									const char *const *paramValues,
+									const int *paramLengths,
+									const int *paramFormats,
+									int resultFormat);
 extern int	PQsetSingleRowMode(PGconn *conn);
+extern int	PQsetChunkedRowsMode(PGconn *conn, int chunkSize);
 extern PGresult *PQgetResult(PGconn *conn);
 
+/* Routines for retrieving rows without copying them */
+extern int	PQsetRowBatchMode(PGconn *conn);
+extern int	PQgetRowBatch(PGconn *conn, int maxRows);
+extern const PGresult *PQrowBatchDescription(const PGconn *conn);
+extern const char *const *PQrowBatchValues(const PGconn *conn, int field_num);
+extern const int *PQrowBatchLengths(const PGconn *conn, int field_num);
+
 /* Routines for managing an asynchronous query */
 extern int	PQisBusy(PGconn *conn);
 extern int	PQconsumeInput(PGconn *conn);
@@ -38,6 +38,7 @@
 #endif
 
 /* include stuff common to fe and be */
+#include "common/zpq_stream.h"
 #include "getaddrinfo.h"
 #include "libpq/pqcomm.h"
 /* include stuff found in fe only */
@@ -393,6 +394,7 @@ struct pg_conn
 	char	   *ssl_min_protocol_version;	/* minimum TLS protocol version */
 	char	   *ssl_max_protocol_version;	/* maximum TLS protocol version */
 	char	   *target_session_attrs;	/* desired session properties */
+	char	   *compression;	/* protocol compression methods to request */
 
 	/* Optional file to write trace info to */
 	FILE	   *Pfdebug;
@@ -416,6 +418,9 @@ struct pg_conn
 								 * sending semantics */
 	PGpipelineStatus pipelineStatus;	/* status of pipeline mode */
 	bool		singleRowMode;	/* return current query result row-by-row? */
+	int			maxChunkSize;	/* return current query result in chunks of
+								 * this many rows, if > 0 */
+	bool		rowBatchMode;	/* return current query's rows in batches? */
 	char		copy_is_binary; /* 1 = copy binary, 0 = copy text */
 	int			copy_already_done;	/* # bytes already returned in COPY OUT */
 	PGnotify   *notifyHead;		/* oldest unreported Notify msg */
@@ -496,10 +501,26 @@ struct pg_conn
 	PGdataValue *rowBuf;		/* array for passing values to rowProcessor */
 	int			rowBufLen;		/* number of entries allocated in rowBuf */
 
+	/*
+	 * Row batch mode workspace.  The values point into inBuffer, in arrays of
+	 * rowBatchMax entries per column.
+	 */
+	bool		rowBatchCollect;	/* is PQgetRowBatch parsing rows? */
+	bool		rowBatchPending;	/* is a row waiting for PQgetRowBatch? */
+	int			rowBatchMax;	/* maximum number of rows in current batch */
+	int			rowBatchRows;	/* number of rows in current batch */
+	int			rowBatchFields; /* number of fields in current batch */
+	size_t		rowBatchLen;	/* number of entries allocated in arrays */
+	const char **rowBatchValues;	/* field values, or NULL for nulls */
+	int		   *rowBatchLengths;	/* field lengths, or -1 for nulls */
+
 	/* Status for asynchronous result construction */
 	PGresult   *result;			/* result being constructed */
 	PGresult   *next_result;	/* next result (used in single-row mode) */
 
+	/* Protocol compression state, if the server agreed to compression */
+	ZpqStream  *zstream;
+
 	/* Assorted state for SASL, SSL, GSS, etc */
 	const pg_fe_sasl_mech *sasl;
 	void	   *sasl_state;
@@ -692,6 +713,7 @@ extern int	pqPutMsgStart(char msg_type, PGconn *conn);
 extern int	pqPutMsgEnd(PGconn *conn);
 extern int	pqReadData(PGconn *conn);
 extern int	pqFlush(PGconn *conn);
+extern int	pqStartCompression(PGconn *conn, ZpqAlgorithm algorithm);
 extern int	pqWait(int forRead, int forWrite, PGconn *conn);
 extern int	pqWaitTimed(int forRead, int forWrite, PGconn *conn,
 						time_t finish_time);
@@ -18,6 +18,133 @@
 
 #include "port/pg_crc32c.h"
 
+#ifdef __x86_64__
+
+/*
+ * The CRC instruction has a latency of several cycles but can start a new
+ * computation every cycle, so a single dependent chain of them leaves most of
+ * the CPU's capacity unused.  For long inputs we therefore compute the CRCs
+ * of three adjacent blocks independently and combine them afterwards.
+ *
+ * Combining needs the CRC of each of the first two blocks "shifted" past the
+ * zero bytes standing in for the blocks that follow, that is, multiplied by
+ * x^(8 * n) modulo the CRC polynomial for a shift of n bytes.  This is done
+ * as a carry-less multiplication by x^(8 * n - 33) mod P, followed by a CRC
+ * instruction that reduces the 64-bit product (and supplies the remaining
+ * factor of x^33).  The multiplication is done a nibble at a time, using the
+ * tables below: entry i of each table is the carry-less product of i and the
+ * constant noted above it, in the bit-reflected representation used by the
+ * CRC instructions.
+ */
+#define CRC32C_LONG_BLOCK	1024
+#define CRC32C_SHORT_BLOCK	256
+
+/* x^(8 * 1024 - 33) mod P = 0x170076fa */
+static const uint64 crc32c_shift_long1[16] = {
+	UINT64CONST(0x000000000), UINT64CONST(0x0170076fa), UINT64CONST(0x02e00edf4),
+	UINT64CONST(0x039009b0e), UINT64CONST(0x05c01dbe8), UINT64CONST(0x04b01ad12),
+	UINT64CONST(0x07201361c), UINT64CONST(0x0650140e6), UINT64CONST(0x0b803b7d0),
+	UINT64CONST(0x0af03c12a), UINT64CONST(0x096035a24), UINT64CONST(0x081032cde),
+	UINT64CONST(0x0e4026c38), UINT64CONST(0x0f3021ac2), UINT64CONST(0x0ca0281cc),
+	UINT64CONST(0x0dd02f736)
+};
+
+/* x^(8 * 2048 - 33) mod P = 0xa51b6135 */
+static const uint64 crc32c_shift_long2[16] = {
+	UINT64CONST(0x000000000), UINT64CONST(0x0a51b6135), UINT64CONST(0x14a36c26a),
+	UINT64CONST(0x1ef2da35f), UINT64CONST(0x2946d84d4), UINT64CONST(0x23176e5e1),
+	UINT64CONST(0x3de5b46be), UINT64CONST(0x37b40278b), UINT64CONST(0x528db09a8),
+	UINT64CONST(0x58dc0689d), UINT64CONST(0x462edcbc2), UINT64CONST(0x4c7f6aaf7),
+	UINT64CONST(0x7bcb68d7c), UINT64CONST(0x719adec49), UINT64CONST(0x6f6804f16),
+	UINT64CONST(0x6539b2e23)
+};
+
+/* x^(8 * 256 - 33) mod P = 0xb9e02b86 */
+static const uint64 crc32c_shift_short1[16] = {
+	UINT64CONST(0x000000000), UINT64CONST(0x0b9e02b86), UINT64CONST(0x173c0570c),
+	UINT64CONST(0x1ca207c8a), UINT64CONST(0x2e780ae18), UINT64CONST(0x25e60859e),
+	UINT64CONST(0x39440f914), UINT64CONST(0x32da0d292), UINT64CONST(0x5cf015c30),
+	UINT64CONST(0x576e177b6), UINT64CONST(0x4bcc10b3c), UINT64CONST(0x4052120ba),
+	UINT64CONST(0x72881f228), UINT64CONST(0x79161d9ae), UINT64CONST(0x65b41a524),
+	UINT64CONST(0x6e2a18ea2)
+};
+
+/* x^(8 * 512 - 33) mod P = 0xdd7e3b0c */
+static const uint64 crc32c_shift_short2[16] = {
+	UINT64CONST(0x000000000), UINT64CONST(0x0dd7e3b0c), UINT64CONST(0x1bafc7618),
+	UINT64CONST(0x167824d14), UINT64CONST(0x375f8ec30), UINT64CONST(0x3a886d73c),
+	UINT64CONST(0x2cf049a28), UINT64CONST(0x2127aa124), UINT64CONST(0x6ebf1d860),
+	UINT64CONST(0x6368fe36c), UINT64CONST(0x7510dae78), UINT64CONST(0x78c739574),
+	UINT64CONST(0x59e093450), UINT64CONST(0x543770f5c), UINT64CONST(0x424f54248),
+	UINT64CONST(0x4f98b7944)
+};
+
+/*
+ * Shift a CRC past as many zero bytes as the given table stands for.
+ */
+static inline pg_crc32c
+crc32c_shift(pg_crc32c crc, const uint64 *table)
+{
+	uint64		product = 0;
+
+	for (int i = 0; i < 32; i += 4)
+		product ^= table[(crc >> i) & 0xF] << i;
+
+	return (pg_crc32c) _mm_crc32_u64(0, product);
+}
+
+/*
+ * Process as many groups of three blocks of "blocklen" bytes as fit between
+ * *pp and pend, advancing *pp past them.
+ */
+pg_attribute_no_sanitize_alignment()
+static inline pg_crc32c
+crc32c_sse42_blocks(pg_crc32c crc, const unsigned char **pp,
+					const unsigned char *pend, size_t blocklen,
+					const uint64 *shift1, const uint64 *shift2)
+{
+	const unsigned char *p = *pp;
+
+	while ((size_t) (pend - p) >= 3 * blocklen)
+	{
+		const unsigned char *end = p + blocklen;
+		pg_crc32c	crc1 = 0;
+		pg_crc32c	crc2 = 0;
+
+		for (; p < end; p += 8)
+		{
+			crc = (uint32) _mm_crc32_u64(crc, *((const uint64 *) p));
+			crc1 = (uint32) _mm_crc32_u64(crc1, *((const uint64 *) (p + blocklen)));
+			crc2 = (uint32) _mm_crc32_u64(crc2, *((const uint64 *) (p + 2 * blocklen)));
+		}
+
+		crc = crc32c_shift(crc, shift2) ^ crc32c_shift(crc1, shift1) ^ crc2;
+		p += 2 * blocklen;
+	}
+
+	*pp = p;
+	return crc;
+}
+
+/*
+ * Consume the part of a long input that can be processed three blocks at a
+ * time.  Kept out of line so that short inputs, which are the common case for
+ * WAL records, don't pay for it.
+ */
+pg_attribute_no_sanitize_alignment()
+static pg_noinline pg_crc32c
+crc32c_sse42_long(pg_crc32c crc, const unsigned char **pp,
+				  const unsigned char *pend)
+{
+	crc = crc32c_sse42_blocks(crc, pp, pend, CRC32C_LONG_BLOCK,
+							  crc32c_shift_long1, crc32c_shift_long2);
+	crc = crc32c_sse42_blocks(crc, pp, pend, CRC32C_SHORT_BLOCK,
+							  crc32c_shift_short1, crc32c_shift_short2);
+	return crc;
+}
+
+#endif							/* __x86_64__ */
+
 pg_attribute_no_sanitize_alignment()
 pg_crc32c
 pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
@@ -25,6 +152,11 @@ pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
 	const unsigned char *p = data;
 	const unsigned char *pend = p + len;
 
+#ifdef __x86_64__
+	if (len >= 3 * CRC32C_SHORT_BLOCK)
+		crc = crc32c_sse42_long(crc, &p, pend);
+#endif
+
 	/*
 	 * Process eight bytes of data at a time.
 	 *
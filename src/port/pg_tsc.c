@@ -0,0 +1,123 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_tsc.c
+ *	  Detect and calibrate the CPU's time stamp counter.
+ *
+ * Reading the time stamp counter takes a few nanoseconds, compared to tens
+ * of nanoseconds for clock_gettime(), which makes it the better choice for
+ * timing individual plan node executions.  It can only be used if it ticks
+ * at a constant rate regardless of the CPU's frequency and power state
+ * ("invariant TSC"), and, on Linux, if the kernel itself trusts it enough to
+ * use it as its clock source, which means it is also synchronized across
+ * CPUs.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_tsc.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
+
+#ifdef HAVE__CPUID
+#include <intrin.h>
+#endif
+
+#include "portability/instr_time.h"
+
+uint64		pg_tsc_ticks_per_sec = 0;
+
+#ifdef PG_HAVE_TSC
+
+/* how long to spend calibrating the counter against the system clock */
+#define TSC_CALIBRATION_USEC	10000
+
+static bool
+pg_tsc_invariant(void)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+
+#if defined(HAVE__GET_CPUID)
+	if (!__get_cpuid(0x80000007, &exx[0], &exx[1], &exx[2], &exx[3]))
+		return false;
+#elif defined(HAVE__CPUID)
+	__cpuid(exx, 0x80000000);
+	if ((unsigned int) exx[0] < 0x80000007)
+		return false;
+	__cpuid(exx, 0x80000007);
+#endif
+
+	return (exx[3] & (1 << 8)) != 0;	/* invariant TSC */
+}
+
+static bool
+pg_tsc_trusted_by_kernel(void)
+{
+#ifdef __linux__
+	FILE	   *fp;
+	char		buf[32];
+	bool		result = true;
+
+	fp = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (fp == NULL)
+		return true;			/* can't tell, rely on cpuid */
+
+	if (fgets(buf, sizeof(buf), fp) == NULL || strncmp(buf, "tsc", 3) != 0)
+		result = false;
+
+	fclose(fp);
+	return result;
+#else
+	return true;
+#endif
+}
+
+#endif							/* PG_HAVE_TSC */
+
+/*
+ * Decide whether pg_get_ticks() should read the time stamp counter, and if
+ * so measure its frequency.  Returns true if the TSC is in use.
+ *
+ * This busy-waits for a few milliseconds, so it should be called only once
+ * per cluster, by the postmaster, whose children inherit the result.
+ */
+bool
+pg_tsc_init(void)
+{
+#ifdef PG_HAVE_TSC
+	instr_time	start_time;
+	instr_time	now;
+	uint64		start_tsc;
+	uint64		elapsed_tsc;
+	uint64		elapsed_usec;
+
+	pg_tsc_ticks_per_sec = 0;
+
+	if (!pg_tsc_invariant() || !pg_tsc_trusted_by_kernel())
+		return false;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+	start_tsc = __rdtsc();
+
+	do
+	{
+		INSTR_TIME_SET_CURRENT(now);
+		INSTR_TIME_SUBTRACT(now, start_time);
+		elapsed_usec = INSTR_TIME_GET_MICROSEC(now);
+	} while (elapsed_usec < TSC_CALIBRATION_USEC);
+
+	elapsed_tsc = __rdtsc() - start_tsc;
+
+	pg_tsc_ticks_per_sec = elapsed_tsc * 1000000 / elapsed_usec;
+	return pg_tsc_ticks_per_sec != 0;
+#else
+	return false;
+#endif
+}
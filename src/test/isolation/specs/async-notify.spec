@@ -50,6 +50,7 @@ teardown		{ UNLISTEN *; }
 session listener2
 step l2listen	{ LISTEN c1; }
 step l2begin	{ BEGIN; }
+step l2check	{ SELECT 1 AS x; }
 step l2commit	{ COMMIT; }
 step l2stop		{ UNLISTEN *; }
 
@@ -73,6 +74,10 @@ permutation listenc llisten notify1 notify2 notify3 notifyf lcheck
 # and notify queue is not empty
 permutation l2listen l2begin notify1 lbegins llisten lcommit l2commit l2stop
 
+# Listeners on other channels are skipped over notifications they don't want,
+# but still get the ones they do want.
+permutation l2listen llisten notify2 notify3 notify1 l2check lcheck l2stop
+
 # Verify that pg_notification_queue_usage correctly reports a non-zero result,
 # after submitting notifications while another connection is listening for
 # those notifications and waiting inside an active transaction.  We have to
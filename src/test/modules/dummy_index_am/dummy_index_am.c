@@ -304,6 +304,7 @@ dihandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = dibuild;
 	amroutine->ambuildempty = dibuildempty;
 	amroutine->aminsert = diinsert;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = dibulkdelete;
 	amroutine->amvacuumcleanup = divacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -86,6 +86,406 @@ pg_fatal_impl(int line, const char *fmt,...)
 	exit(1);
 }
 
+/*
+ * Expect a result of the given status from PQgetResult(), and return it.
+ */
+static PGresult *
+expect_result(PGconn *conn, ExecStatusType status, const char *what)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (res == NULL)
+		pg_fatal("PQgetResult returned null for %s: %s", what,
+				 PQerrorMessage(conn));
+	if (PQresultStatus(res) != status)
+		pg_fatal("Unexpected result status %s for %s, expected %s: %s",
+				 PQresStatus(PQresultStatus(res)), what, PQresStatus(status),
+				 PQerrorMessage(conn));
+	return res;
+}
+
+/*
+ * Check the number of rows in ppln_bulk.
+ */
+static void
+check_bulk_count(PGconn *conn, const char *count)
+{
+	PGresult   *res;
+
+	res = PQexec(conn, "SELECT count(*) FROM ppln_bulk");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("failed to count rows: %s", PQerrorMessage(conn));
+	if (strcmp(PQgetvalue(res, 0, 0), count) != 0)
+		pg_fatal("expected %s rows, got %s", count, PQgetvalue(res, 0, 0));
+	PQclear(res);
+}
+
+/*
+ * Test bulk execution of prepared statements with PQexecPreparedBulk() and
+ * PQsendQueryPreparedBulk(): errors partway through the parameter sets, and
+ * bulk binds interleaved with other commands and Syncs in a pipeline.
+ */
+static void
+test_bulkbind(PGconn *conn)
+{
+	PGresult   *res;
+	const char *values[8];
+
+	fprintf(stderr, "bulk bind ...");
+
+	res = PQexec(conn, "DROP TABLE IF EXISTS ppln_bulk;"
+				 "CREATE TABLE ppln_bulk(a int PRIMARY KEY, b text)");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("failed to create table: %s", PQerrorMessage(conn));
+	PQclear(res);
+
+	res = PQprepare(conn, "bulk_insert",
+					"INSERT INTO ppln_bulk VALUES ($1, $2)", 2, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("failed to prepare query: %s", PQerrorMessage(conn));
+	PQclear(res);
+	res = PQprepare(conn, "bulk_select", "SELECT $1::int", 1, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("failed to prepare query: %s", PQerrorMessage(conn));
+	PQclear(res);
+
+	/* Three sets, with a null value */
+	values[0] = "1";
+	values[1] = "one";
+	values[2] = "2";
+	values[3] = NULL;
+	values[4] = "3";
+	values[5] = "three";
+	res = PQexecPreparedBulk(conn, "bulk_insert", 2, 3, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("bulk insert failed: %s", PQerrorMessage(conn));
+	if (strcmp(PQcmdTuples(res), "3") != 0)
+		pg_fatal("expected 3 rows inserted, got \"%s\"", PQcmdTuples(res));
+	PQclear(res);
+	check_bulk_count(conn, "3");
+
+	/*
+	 * A unique violation in the third of four sets undoes the sets executed
+	 * before it, and leaves the connection usable.
+	 */
+	values[0] = "4";
+	values[1] = "four";
+	values[2] = "5";
+	values[3] = "five";
+	values[4] = "1";
+	values[5] = "one again";
+	values[6] = "6";
+	values[7] = "six";
+	res = PQexecPreparedBulk(conn, "bulk_insert", 2, 4, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		pg_fatal("expected unique violation, got %s",
+				 PQresStatus(PQresultStatus(res)));
+	if (strcmp(PQresultErrorField(res, PG_DIAG_SQLSTATE), "23505") != 0)
+		pg_fatal("expected unique violation, got: %s",
+				 PQresultErrorMessage(res));
+	PQclear(res);
+	check_bulk_count(conn, "3");
+
+	/* Likewise for a value that can't be parsed */
+	values[4] = "not a number";
+	res = PQexecPreparedBulk(conn, "bulk_insert", 2, 4, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		pg_fatal("expected invalid input error, got %s",
+				 PQresStatus(PQresultStatus(res)));
+	if (strcmp(PQresultErrorField(res, PG_DIAG_SQLSTATE), "22P02") != 0)
+		pg_fatal("expected invalid input error, got: %s",
+				 PQresultErrorMessage(res));
+	PQclear(res);
+	check_bulk_count(conn, "3");
+
+	/* Statements returning rows are refused */
+	values[0] = "1";
+	values[1] = "2";
+	res = PQexecPreparedBulk(conn, "bulk_select", 1, 2, values, NULL, NULL, 0);
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		pg_fatal("expected bulk bind of SELECT to fail, got %s",
+				 PQresStatus(PQresultStatus(res)));
+	if (strcmp(PQresultErrorField(res, PG_DIAG_SQLSTATE), "0A000") != 0)
+		pg_fatal("expected feature not supported error, got: %s",
+				 PQresultErrorMessage(res));
+	PQclear(res);
+
+	/* as are empty batches, by libpq itself */
+	if (PQsendQueryPreparedBulk(conn, "bulk_insert", 2, 0, values,
+								NULL, NULL, 0) != 0)
+		pg_fatal("bulk bind with no parameter sets was accepted");
+
+	/*
+	 * In a pipeline: a bulk bind that succeeds and is synced, one that fails
+	 * with a later command in the same segment, and a final segment that
+	 * mixes bulk and ordinary commands.
+	 */
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	values[0] = "10";
+	values[1] = "ten";
+	values[2] = "11";
+	values[3] = "eleven";
+	if (PQsendQueryPreparedBulk(conn, "bulk_insert", 2, 2, values,
+								NULL, NULL, 0) != 1)
+		pg_fatal("failed to send bulk insert: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	values[0] = "12";
+	values[1] = "twelve";
+	values[2] = "10";
+	values[3] = "ten again";
+	if (PQsendQueryPreparedBulk(conn, "bulk_insert", 2, 2, values,
+								NULL, NULL, 0) != 1)
+		pg_fatal("failed to send bulk insert: %s", PQerrorMessage(conn));
+	values[0] = "13";
+	values[1] = "thirteen";
+	if (PQsendQueryPrepared(conn, "bulk_insert", 2, values,
+							NULL, NULL, 0) != 1)
+		pg_fatal("failed to send insert: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	values[0] = "14";
+	values[1] = "fourteen";
+	if (PQsendQueryPrepared(conn, "bulk_insert", 2, values,
+							NULL, NULL, 0) != 1)
+		pg_fatal("failed to send insert: %s", PQerrorMessage(conn));
+	values[0] = "15";
+	values[1] = "fifteen";
+	values[2] = "16";
+	values[3] = "sixteen";
+	if (PQsendQueryPreparedBulk(conn, "bulk_insert", 2, 2, values,
+								NULL, NULL, 0) != 1)
+		pg_fatal("failed to send bulk insert: %s", PQerrorMessage(conn));
+	if (PQsendQueryParams(conn, "SELECT count(*) FROM ppln_bulk",
+						  0, NULL, NULL, NULL, NULL, 0) != 1)
+		pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	/* first segment */
+	res = expect_result(conn, PGRES_COMMAND_OK, "first bulk insert");
+	if (strcmp(PQcmdTuples(res), "2") != 0)
+		pg_fatal("expected 2 rows inserted, got \"%s\"", PQcmdTuples(res));
+	PQclear(res);
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after first bulk insert");
+	PQclear(expect_result(conn, PGRES_PIPELINE_SYNC, "first sync"));
+
+	/* second segment: the failed bulk insert aborts the rest */
+	res = expect_result(conn, PGRES_FATAL_ERROR, "failing bulk insert");
+	if (strcmp(PQresultErrorField(res, PG_DIAG_SQLSTATE), "23505") != 0)
+		pg_fatal("expected unique violation, got: %s",
+				 PQresultErrorMessage(res));
+	PQclear(res);
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after failing bulk insert");
+	PQclear(expect_result(conn, PGRES_PIPELINE_ABORTED,
+						  "insert after failing bulk insert"));
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after aborted insert");
+	PQclear(expect_result(conn, PGRES_PIPELINE_SYNC, "second sync"));
+
+	/* third segment */
+	PQclear(expect_result(conn, PGRES_COMMAND_OK, "insert in third segment"));
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after insert");
+	res = expect_result(conn, PGRES_COMMAND_OK,
+						"bulk insert in third segment");
+	if (strcmp(PQcmdTuples(res), "2") != 0)
+		pg_fatal("expected 2 rows inserted, got \"%s\"", PQcmdTuples(res));
+	PQclear(res);
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after bulk insert");
+	res = expect_result(conn, PGRES_TUPLES_OK, "count");
+	if (strcmp(PQgetvalue(res, 0, 0), "8") != 0)
+		pg_fatal("expected 8 rows after the pipeline, got %s",
+				 PQgetvalue(res, 0, 0));
+	PQclear(res);
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result after count");
+	PQclear(expect_result(conn, PGRES_PIPELINE_SYNC, "third sync"));
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("failed to end pipeline mode: %s", PQerrorMessage(conn));
+
+	check_bulk_count(conn, "8");
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * Fetch the results of one query in chunked rows mode, and check that they
+ * come in chunks of chunk_size rows followed by an empty PGRES_TUPLES_OK
+ * result, or by an error if expect_error.
+ */
+static void
+consume_chunked_results(PGconn *conn, int query, int chunk_size,
+						int expected_rows, bool expect_error)
+{
+	PGresult   *res;
+	int			nrows = 0;
+	bool		saw_end = false;
+
+	while ((res = PQgetResult(conn)) != NULL)
+	{
+		ExecStatusType est = PQresultStatus(res);
+
+		if (saw_end)
+			pg_fatal("unexpected result %s after the end of query %d",
+					 PQresStatus(est), query);
+
+		fprintf(stderr, "Result status %s for query %d, tuples: %d\n",
+				PQresStatus(est), query, PQntuples(res));
+		switch (est)
+		{
+			case PGRES_TUPLES_CHUNK:
+				if (PQntuples(res) < 1 || PQntuples(res) > chunk_size)
+					pg_fatal("chunk of %d rows for query %d, expected 1 to %d",
+							 PQntuples(res), query, chunk_size);
+				/* only the last chunk may be partially filled */
+				if (nrows % chunk_size != 0)
+					pg_fatal("chunk of query %d follows a partial chunk",
+							 query);
+				for (int i = 0; i < PQntuples(res); i++)
+				{
+					if (atoi(PQgetvalue(res, i, 0)) != nrows + i + 1)
+						pg_fatal("row %d of query %d has value %s",
+								 nrows + i, query, PQgetvalue(res, i, 0));
+				}
+				nrows += PQntuples(res);
+				break;
+
+			case PGRES_TUPLES_OK:
+				if (expect_error)
+					pg_fatal("query %d succeeded, expected an error", query);
+				if (PQntuples(res) != 0)
+					pg_fatal("expected no rows in the final result of query %d, got %d",
+							 query, PQntuples(res));
+				if (PQnfields(res) != 1)
+					pg_fatal("expected 1 field in the final result of query %d, got %d",
+							 query, PQnfields(res));
+				saw_end = true;
+				break;
+
+			case PGRES_FATAL_ERROR:
+				if (!expect_error)
+					pg_fatal("query %d failed: %s",
+							 query, PQerrorMessage(conn));
+				saw_end = true;
+				break;
+
+			default:
+				pg_fatal("unexpected result status %s for query %d",
+						 PQresStatus(est), query);
+		}
+		PQclear(res);
+	}
+
+	if (!saw_end)
+		pg_fatal("didn't get the final result of query %d", query);
+	if (nrows != expected_rows)
+		pg_fatal("got %d rows for query %d, expected %d",
+				 nrows, query, expected_rows);
+}
+
+/*
+ * Test chunked rows mode, outside of and in a pipeline.
+ */
+static void
+test_chunkedrowsmode(PGconn *conn)
+{
+	PGresult   *res;
+	const int	chunk_size = 3;
+	int			i;
+
+	/* Rows in full and partial chunks, without a pipeline */
+	if (PQsendQuery(conn, "SELECT generate_series(1, 10)") != 1)
+		pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	if (PQsetChunkedRowsMode(conn, 0) != 0)
+		pg_fatal("PQsetChunkedRowsMode() accepted a chunk size of 0");
+	if (PQsetChunkedRowsMode(conn, chunk_size) != 1)
+		pg_fatal("PQsetChunkedRowsMode() failed");
+	if (PQsetSingleRowMode(conn) != 0)
+		pg_fatal("PQsetSingleRowMode() succeeded in chunked rows mode");
+	consume_chunked_results(conn, 0, chunk_size, 10, false);
+
+	/* The rows received before an error are returned, then the error */
+	if (PQsendQuery(conn, "SELECT g + 0 / (3 - g) FROM generate_series(1, 5) g") != 1)
+		pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	if (PQsetChunkedRowsMode(conn, chunk_size) != 1)
+		pg_fatal("PQsetChunkedRowsMode() failed");
+	consume_chunked_results(conn, 1, chunk_size, 2, true);
+
+	/*
+	 * 1 pipeline, 3 queries in it; chunked rows mode for the first two, with
+	 * a number of rows that fills the chunks exactly in the second one.
+	 */
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s",
+				 PQerrorMessage(conn));
+
+	for (i = 0; i < 3; i++)
+	{
+		char	   *param[1];
+
+		param[0] = psprintf("%d", 7 - i);
+
+		if (PQsendQueryParams(conn,
+							  "SELECT generate_series(1, $1)",
+							  1,
+							  NULL,
+							  (const char **) param,
+							  NULL,
+							  NULL,
+							  0) != 1)
+			pg_fatal("failed to send query: %s",
+					 PQerrorMessage(conn));
+		pfree(param[0]);
+	}
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	for (i = 0; i < 2; i++)
+	{
+		if (PQsetChunkedRowsMode(conn, chunk_size) != 1)
+			pg_fatal("PQsetChunkedRowsMode() failed for i=%d", i);
+		consume_chunked_results(conn, i + 2, chunk_size, 7 - i, false);
+	}
+
+	/* The mode applies to one query only */
+	res = PQgetResult(conn);
+	if (res == NULL)
+		pg_fatal("PQgetResult returned null when there's a pipeline item: %s",
+				 PQerrorMessage(conn));
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("Expected PGRES_TUPLES_OK for query 4, got %s",
+				 PQresStatus(PQresultStatus(res)));
+	if (PQntuples(res) != 5)
+		pg_fatal("expected 5 rows for query 4, got %d", PQntuples(res));
+	PQclear(res);
+	res = PQgetResult(conn);
+	if (res != NULL)
+		pg_fatal("expected NULL result");
+
+	res = PQgetResult(conn);
+	if (res == NULL)
+		pg_fatal("PQgetResult returned null when sync result expected: %s",
+				 PQerrorMessage(conn));
+	if (PQresultStatus(res) != PGRES_PIPELINE_SYNC)
+		pg_fatal("Unexpected result code %s instead of sync result, error: %s",
+				 PQresStatus(PQresultStatus(res)), PQerrorMessage(conn));
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("failed to end pipeline mode: %s", PQerrorMessage(conn));
+
+	fprintf(stderr, "ok\n");
+}
+
 static void
 test_disallowed_in_pipeline(PGconn *conn)
 {
@@ -1545,6 +1945,8 @@ usage(const char *progname)
 static void
 print_test_list(void)
 {
+	printf("bulkbind\n");
+	printf("chunkedrows\n");
 	printf("disallowed_in_pipeline\n");
 	printf("multi_pipelines\n");
 	printf("nosync\n");
@@ -1642,7 +2044,11 @@ main(int argc, char **argv)
 						PQTRACE_SUPPRESS_TIMESTAMPS | PQTRACE_REGRESS_MODE);
 	}
 
-	if (strcmp(testname, "disallowed_in_pipeline") == 0)
+	if (strcmp(testname, "bulkbind") == 0)
+		test_bulkbind(conn);
+	else if (strcmp(testname, "chunkedrows") == 0)
+		test_chunkedrowsmode(conn);
+	else if (strcmp(testname, "disallowed_in_pipeline") == 0)
 		test_disallowed_in_pipeline(conn);
 	else if (strcmp(testname, "multi_pipelines") == 0)
 		test_multi_pipelines(conn);
@@ -0,0 +1,57 @@
+# Tests for the shared sequence cache
+#
+# With the cache enabled, sequences without a per-backend CACHE fetch blocks
+# of 1024 values into shared memory, and all sessions take their values from
+# the same block.  Changing the sequence by other means than nextval() must
+# discard the block, as must DISCARD SEQUENCES the session's own state.
+# Values left unused in a discarded block are lost, as with CACHE.
+
+setup
+{
+    CREATE SEQUENCE seq1;
+    CREATE SEQUENCE seq2;
+}
+
+teardown
+{
+    DROP SEQUENCE seq1, seq2;
+}
+
+session s1
+step s1nv       { SELECT nextval('seq1'); }
+step s1cv       { SELECT currval('seq1'); }
+step s1lv       { SELECT lastval(); }
+step s1setval   { SELECT setval('seq1', 100); }
+step s1begin    { BEGIN; }
+step s1alter    { ALTER SEQUENCE seq1 INCREMENT BY 10; }
+step s1restart  { ALTER SEQUENCE seq1 RESTART WITH 50; }
+step s1commit   { COMMIT; }
+step s1rollback { ROLLBACK; }
+step s1discard  { DISCARD SEQUENCES; }
+
+session s2
+step s2nv       { SELECT nextval('seq1'); }
+step s2nv3      { SELECT nextval('seq1') FROM generate_series(1, 3); }
+step s2nvseq2   { SELECT nextval('seq2'); }
+step s2lv       { SELECT lastval(); }
+
+# both sessions take their values from one block; currval() and lastval()
+# still report the session's own values
+permutation s1nv s2nv s1nv s2nv3 s1lv s2lv s1cv
+
+# setval() is seen by the other session at once
+permutation s1nv s2nv s1setval s2nv s1nv
+
+# ALTER SEQUENCE blocks nextval() until it commits, and later values use
+# the new increment
+permutation s1nv s2nv s1begin s1alter s2nv s1commit s1nv
+
+# a restart that is rolled back doesn't hand out values twice
+permutation s1nv s1begin s1restart s2nv s1rollback s1nv
+permutation s1nv s1begin s1restart s1commit s2nv s1nv
+
+# DISCARD SEQUENCES forgets the session's state, but not the shared block
+permutation s1nv s2nv s1discard s1cv s1lv s1nv s2nv s1lv
+
+# with a single slot, the sequences take it over from each other
+permutation s1nv s2nvseq2 s1nv s2nvseq2 s1cv s2lv
@@ -0,0 +1,10 @@
+CREATE EXTENSION test_microbench;
+
+-- The timings vary from run to run, so only check that each benchmark runs.
+SELECT benchmark, loops, total_ms >= 0 AS timed
+  FROM test_microbench(loops => 10);
+
+SELECT benchmark, loops FROM test_microbench('crc32c', 5);
+
+SELECT * FROM test_microbench('no_such_benchmark');
+SELECT * FROM test_microbench('crc32c', 0);
@@ -0,0 +1,13 @@
+/* src/test/modules/test_microbench/test_microbench--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_microbench" to load this file. \quit
+
+CREATE FUNCTION test_microbench(name text DEFAULT NULL,
+    loops bigint DEFAULT NULL,
+    OUT benchmark text,
+    OUT loops bigint,
+    OUT total_ms float8,
+    OUT ns_per_loop float8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME' LANGUAGE C;
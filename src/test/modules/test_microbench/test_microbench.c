@@ -0,0 +1,551 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_microbench.c
+ *		Microbenchmarks of hot internal primitives.
+ *
+ * Each benchmark does whatever setup it needs, then times "loops" calls of
+ * the primitive it measures, so that the result reflects the primitive alone
+ * and can be compared across builds.  All input data is generated from a
+ * fixed seed, so repeated runs do the same work.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_microbench/test_microbench.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tupdesc.h"
+#include "catalog/pg_operator_d.h"
+#include "catalog/pg_type_d.h"
+#include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "port/pg_crc32c.h"
+#include "portability/instr_time.h"
+#include "storage/bufpage.h"
+#include "storage/checksum.h"
+#include "storage/lwlock.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_microbench);
+
+/* number of entries in the hash table looked up by bench_hash_search */
+#define HASH_BENCH_ENTRIES		1024
+
+/* size of the buffer CRC'd by bench_crc32c_record */
+#define CRC_RECORD_BENCH_LEN	100
+
+/* number of attributes of the tuple deformed by bench_slot_deform */
+#define DEFORM_BENCH_NATTS		16
+
+/* check for interrupts once every this many loops */
+#define INTERRUPT_CHECK_MASK	0xFFFF
+
+typedef void (*microbench_fn) (int64 loops, instr_time *elapsed);
+
+typedef struct MicroBenchmark
+{
+	const char *name;
+	int64		default_loops;	/* used if loops is NULL */
+	microbench_fn run;
+} MicroBenchmark;
+
+static void bench_lwlock_exclusive(int64 loops, instr_time *elapsed);
+static void bench_lwlock_shared(int64 loops, instr_time *elapsed);
+static void bench_hash_search(int64 loops, instr_time *elapsed);
+static void bench_aset_alloc(int64 loops, instr_time *elapsed);
+static void bench_slot_deform(int64 loops, instr_time *elapsed);
+static void bench_tuplesort(int64 loops, instr_time *elapsed);
+static void bench_checksum_page(int64 loops, instr_time *elapsed);
+static void bench_crc32c(int64 loops, instr_time *elapsed);
+static void bench_crc32c_record(int64 loops, instr_time *elapsed);
+static void bench_pglz_compress(int64 loops, instr_time *elapsed);
+
+static const MicroBenchmark benchmarks[] = {
+	{"lwlock_exclusive", 10000000, bench_lwlock_exclusive},
+	{"lwlock_shared", 10000000, bench_lwlock_shared},
+	{"hash_search", 10000000, bench_hash_search},
+	{"aset_alloc", 10000000, bench_aset_alloc},
+	{"slot_deform", 1000000, bench_slot_deform},
+	{"tuplesort", 1000000, bench_tuplesort},
+	{"checksum_page", 100000, bench_checksum_page},
+	{"crc32c", 100000, bench_crc32c},
+	{"crc32c_record", 10000000, bench_crc32c_record},
+	{"pglz_compress", 10000, bench_pglz_compress}
+};
+
+/* keeps the compiler from optimizing away the benchmarked work */
+static volatile uint64 bench_sink;
+
+/* state of bench_random() */
+static uint64 bench_random_state;
+
+
+/*
+ * Simple deterministic pseudo-random number generator, so that every run
+ * works on the same data.
+ */
+static void
+bench_random_init(void)
+{
+	bench_random_state = UINT64CONST(0x5DEECE66D);
+}
+
+static uint32
+bench_random(void)
+{
+	bench_random_state = bench_random_state * UINT64CONST(6364136223846793005) +
+		UINT64CONST(1442695040888963407);
+	return (uint32) (bench_random_state >> 32);
+}
+
+/*
+ * Fill a buffer with text that compresses about as well as typical table
+ * data: words drawn from a small vocabulary, with some random digits.
+ */
+static void
+bench_fill_text(char *buf, int len)
+{
+	static const char *const words[] = {
+		"postgres", "tuple", "buffer", "page", "index", "relation",
+		"snapshot", "vacuum", "checkpoint", "transaction"
+	};
+	int			pos = 0;
+
+	while (pos < len)
+	{
+		const char *word = words[bench_random() % lengthof(words)];
+		char		digits[12];
+		const char *p;
+
+		snprintf(digits, sizeof(digits), " %u ", bench_random() % 10000);
+		for (p = word; *p && pos < len; p++)
+			buf[pos++] = *p;
+		for (p = digits; *p && pos < len; p++)
+			buf[pos++] = *p;
+	}
+}
+
+static inline void
+bench_start(instr_time *start)
+{
+	INSTR_TIME_SET_CURRENT(*start);
+}
+
+static inline void
+bench_stop(instr_time *start, instr_time *elapsed)
+{
+	INSTR_TIME_SET_CURRENT(*elapsed);
+	INSTR_TIME_SUBTRACT(*elapsed, *start);
+}
+
+/*
+ * Uncontended LWLockAcquire/LWLockRelease of a lock in local memory.
+ */
+static void
+bench_lwlock(int64 loops, instr_time *elapsed, LWLockMode mode)
+{
+	LWLock	   *lock = palloc(sizeof(LWLock));
+	instr_time	start;
+
+	LWLockInitialize(lock, LWTRANCHE_FIRST_USER_DEFINED);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		LWLockAcquire(lock, mode);
+		LWLockRelease(lock);
+	}
+	bench_stop(&start, elapsed);
+
+	pfree(lock);
+}
+
+static void
+bench_lwlock_exclusive(int64 loops, instr_time *elapsed)
+{
+	bench_lwlock(loops, elapsed, LW_EXCLUSIVE);
+}
+
+static void
+bench_lwlock_shared(int64 loops, instr_time *elapsed)
+{
+	bench_lwlock(loops, elapsed, LW_SHARED);
+}
+
+/*
+ * hash_search_with_hash_value() lookups of existing keys in a small table,
+ * with the hash values computed in advance, as the buffer mapping table
+ * does.
+ */
+static void
+bench_hash_search(int64 loops, instr_time *elapsed)
+{
+	HASHCTL		ctl;
+	HTAB	   *htab;
+	uint32		keys[HASH_BENCH_ENTRIES];
+	uint32		hashes[HASH_BENCH_ENTRIES];
+	uint64		found = 0;
+	instr_time	start;
+
+	ctl.keysize = sizeof(uint32);
+	ctl.entrysize = sizeof(uint32) * 2;
+	htab = hash_create("microbench hash", HASH_BENCH_ENTRIES, &ctl,
+					   HASH_ELEM | HASH_BLOBS);
+
+	for (int i = 0; i < HASH_BENCH_ENTRIES; i++)
+	{
+		keys[i] = bench_random();
+		hashes[i] = get_hash_value(htab, &keys[i]);
+		(void) hash_search_with_hash_value(htab, &keys[i], hashes[i],
+										   HASH_ENTER, NULL);
+	}
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		int			n = i % HASH_BENCH_ENTRIES;
+
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		if (hash_search_with_hash_value(htab, &keys[n], hashes[n],
+										HASH_FIND, NULL) != NULL)
+			found++;
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = found;
+	hash_destroy(htab);
+}
+
+/*
+ * Allocation and release of small chunks in an AllocSet context.  A few
+ * chunks of varying sizes are kept allocated at any time, to exercise the
+ * freelists rather than always reusing the same chunk.
+ */
+static void
+bench_aset_alloc(int64 loops, instr_time *elapsed)
+{
+	MemoryContext cxt;
+	char	   *chunks[8];
+	instr_time	start;
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"microbench allocset",
+								ALLOCSET_DEFAULT_SIZES);
+
+	for (int i = 0; i < lengthof(chunks); i++)
+		chunks[i] = MemoryContextAlloc(cxt, 16 << (i % 4));
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		int			n = i % lengthof(chunks);
+
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		pfree(chunks[n]);
+		chunks[n] = MemoryContextAlloc(cxt, 16 << (i % 4));
+	}
+	bench_stop(&start, elapsed);
+
+	MemoryContextDelete(cxt);
+}
+
+/*
+ * Deforming all attributes of a heap tuple stored in a slot, with a mix of
+ * fixed-width and variable-width attributes.
+ */
+static void
+bench_slot_deform(int64 loops, instr_time *elapsed)
+{
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	HeapTuple	tuple;
+	Datum		values[DEFORM_BENCH_NATTS];
+	bool		isnull[DEFORM_BENCH_NATTS];
+	uint64		sum = 0;
+	instr_time	start;
+
+	tupdesc = CreateTemplateTupleDesc(DEFORM_BENCH_NATTS);
+	for (int i = 0; i < DEFORM_BENCH_NATTS; i++)
+	{
+		switch (i % 4)
+		{
+			case 0:
+			case 2:
+				TupleDescInitEntry(tupdesc, i + 1, NULL, INT4OID, -1, 0);
+				values[i] = Int32GetDatum(bench_random());
+				break;
+			case 1:
+				TupleDescInitEntry(tupdesc, i + 1, NULL, INT8OID, -1, 0);
+				values[i] = Int64GetDatum(bench_random());
+				break;
+			case 3:
+				TupleDescInitEntry(tupdesc, i + 1, NULL, TEXTOID, -1, 0);
+				values[i] = CStringGetTextDatum("microbench");
+				break;
+		}
+		isnull[i] = false;
+	}
+
+	tuple = heap_form_tuple(tupdesc, values, isnull);
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		ExecStoreHeapTuple(tuple, slot, false);
+		slot_getallattrs(slot);
+		sum += DatumGetInt32(slot->tts_values[0]);
+		ExecClearTuple(slot);
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = sum;
+	ExecDropSingleTupleTableSlot(slot);
+	heap_freetuple(tuple);
+}
+
+/*
+ * In-memory sort of "loops" random int4 datums, including putting them into
+ * the sort and reading them back.
+ */
+static void
+bench_tuplesort(int64 loops, instr_time *elapsed)
+{
+	Tuplesortstate *sortstate;
+	int			sortmem;
+	Datum		val;
+	bool		isnull;
+	uint64		sum = 0;
+	instr_time	start;
+
+	/* make sure the sort fits in memory, at about 32 bytes per datum */
+	sortmem = (int) Min((double) MAX_KILOBYTES,
+						Max((double) work_mem, loops * 32.0 / 1024 + 64));
+
+	sortstate = tuplesort_begin_datum(INT4OID, Int4LessOperator, InvalidOid,
+									  false, sortmem, NULL, false);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+		tuplesort_putdatum(sortstate, Int32GetDatum(bench_random()), false);
+
+	tuplesort_performsort(sortstate);
+
+	while (tuplesort_getdatum(sortstate, true, &val, &isnull, NULL))
+		sum += DatumGetInt32(val);
+	bench_stop(&start, elapsed);
+
+	bench_sink = sum;
+	tuplesort_end(sortstate);
+}
+
+/*
+ * pg_checksum_page() of a full page.
+ */
+static void
+bench_checksum_page(int64 loops, instr_time *elapsed)
+{
+	PGAlignedBlock page;
+	uint64		sum = 0;
+	instr_time	start;
+
+	PageInit(page.data, BLCKSZ, 0);
+	bench_fill_text(page.data + SizeOfPageHeaderData,
+					BLCKSZ - SizeOfPageHeaderData);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		sum += pg_checksum_page(page.data, (BlockNumber) i);
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = sum;
+}
+
+/*
+ * CRC-32C of a BLCKSZ buffer, as computed for full-page images in WAL.
+ */
+static void
+bench_crc32c(int64 loops, instr_time *elapsed)
+{
+	PGAlignedBlock buf;
+	pg_crc32c	crc = 0;
+	instr_time	start;
+
+	bench_fill_text(buf.data, BLCKSZ);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, buf.data, BLCKSZ);
+		FIN_CRC32C(crc);
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = crc;
+}
+
+/*
+ * CRC-32C of a buffer the size of a typical WAL record without a full-page
+ * image.
+ */
+static void
+bench_crc32c_record(int64 loops, instr_time *elapsed)
+{
+	char		buf[CRC_RECORD_BENCH_LEN];
+	pg_crc32c	crc = 0;
+	instr_time	start;
+
+	bench_fill_text(buf, CRC_RECORD_BENCH_LEN);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if ((i & INTERRUPT_CHECK_MASK) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, buf, CRC_RECORD_BENCH_LEN);
+		FIN_CRC32C(crc);
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = crc;
+}
+
+/*
+ * pglz_compress() of a BLCKSZ buffer of compressible text.
+ */
+static void
+bench_pglz_compress(int64 loops, instr_time *elapsed)
+{
+	PGAlignedBlock src;
+	char	   *dest = palloc(PGLZ_MAX_OUTPUT(BLCKSZ));
+	uint64		sum = 0;
+	instr_time	start;
+
+	bench_fill_text(src.data, BLCKSZ);
+
+	bench_start(&start);
+	for (int64 i = 0; i < loops; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		sum += pglz_compress(src.data, BLCKSZ, dest, PGLZ_strategy_always);
+	}
+	bench_stop(&start, elapsed);
+
+	bench_sink = sum;
+	pfree(dest);
+}
+
+/*
+ * SQL-callable entry point.  Runs the named benchmark, or all of them if the
+ * name is NULL, and returns one row per benchmark run.
+ */
+Datum
+test_microbench(PG_FUNCTION_ARGS)
+{
+	char	   *name = PG_ARGISNULL(0) ? NULL : text_to_cstring(PG_GETARG_TEXT_PP(0));
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	bool		matched = false;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (!PG_ARGISNULL(1) && PG_GETARG_INT64(1) <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of loops must be greater than zero")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (int i = 0; i < lengthof(benchmarks); i++)
+	{
+		const MicroBenchmark *bench = &benchmarks[i];
+		int64		loops;
+		instr_time	elapsed;
+		double		total_ms;
+		Datum		values[4];
+		bool		nulls[4] = {0};
+
+		if (name != NULL && strcmp(name, bench->name) != 0)
+			continue;
+		matched = true;
+
+		loops = PG_ARGISNULL(1) ? bench->default_loops : PG_GETARG_INT64(1);
+
+		bench_random_init();
+		bench->run(loops, &elapsed);
+		total_ms = INSTR_TIME_GET_MILLISEC(elapsed);
+
+		values[0] = CStringGetTextDatum(bench->name);
+		values[1] = Int64GetDatum(loops);
+		values[2] = Float8GetDatum(total_ms);
+		values[3] = Float8GetDatum(total_ms * 1000000.0 / loops);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	if (!matched)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized benchmark \"%s\"", name)));
+
+	return (Datum) 0;
+}
@@ -0,0 +1,197 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for the built-in connection pooler: sharing of backends, pinning
+# of sessions with backend-local state, cancel routing and authentication.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use IPC::Run;
+
+if ($windows_os)
+{
+	plan skip_all => 'connection proxies are not supported on Windows';
+}
+else
+{
+	plan tests => 22;
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+my $proxy_port = PostgreSQL::Test::Cluster::get_free_port();
+$node->append_conf(
+	'postgresql.conf', qq{
+connection_proxies = 1
+proxy_port = $proxy_port
+session_pool_size = 2
+log_min_messages = debug1
+});
+
+# Password authentication for one role, peer for another, trust for the rest
+unlink($node->data_dir . '/pg_hba.conf');
+$node->append_conf(
+	'pg_hba.conf', qq{
+local all regress_pw scram-sha-256
+local all regress_peer peer
+local all all trust
+});
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+SET password_encryption = 'scram-sha-256';
+CREATE ROLE regress_pw LOGIN PASSWORD 'pass';
+CREATE ROLE regress_peer LOGIN;
+CREATE SEQUENCE proxy_seq;
+});
+
+my $proxy_connstr = "port=$proxy_port host=" . $node->host;
+
+# Start a psql session through the proxy, capturing stdout and stderr.
+sub proxy_session
+{
+	my %session = (stdin => '', stdout => '');
+	my $timer = IPC::Run::timeout(180);
+
+	$session{harness} = IPC::Run::start(
+		[
+			'psql', '-XAtq', '-d', "$proxy_connstr dbname=postgres",
+			'-f', '-'
+		],
+		'<', \$session{stdin}, '>', \$session{stdout}, '2>&1', $timer);
+	$session{timer} = $timer;
+	return \%session;
+}
+
+# Send a query to a session and wait for its result, or for $until.
+sub proxy_query
+{
+	my ($session, $sql, $until) = @_;
+
+	$until = qr/\@\@done\@\@\n/ unless defined $until;
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql\n\\echo \@\@done\@\@\n";
+	$session->{harness}->pump
+	  until $session->{stdout} =~ $until || $session->{timer}->is_expired;
+	die "query timed out: $sql" if $session->{timer}->is_expired;
+
+	my $result = $session->{stdout};
+	$result =~ s/\n?\@\@done\@\@\n//;
+	chomp($result);
+	return $result;
+}
+
+sub proxy_finish
+{
+	my ($session) = @_;
+
+	$session->{stdin} .= "\\q\n";
+	$session->{harness}->finish;
+}
+
+# Basic connectivity
+$node->connect_ok("$proxy_connstr dbname=postgres",
+	'connection through the proxy',
+	sql => 'SELECT 1', expected_stdout => qr/^1$/);
+
+# Five clients share the two backends of their pool.
+my @sessions = map { proxy_session() } 1 .. 5;
+my %pids;
+foreach my $session (@sessions)
+{
+	$pids{ proxy_query($session, 'SELECT pg_backend_pid();') } = 1;
+}
+ok(keys %pids <= 2, 'clients share the backends of their pool');
+ok($node->poll_query_until('postgres',
+		"SELECT count(*) <= 2 FROM pg_stat_activity "
+		  . "WHERE backend_type = 'client backend' AND pid <> pg_backend_pid()"),
+	'surplus backends are terminated');
+
+# A prepared statement pins the session to its backend; the other clients
+# are left with the remaining backend.
+my $log_offset = -s $node->logfile;
+my ($s1, $s2, $s3) = @sessions;
+proxy_query($s1, 'PREPARE q AS SELECT pg_backend_pid();');
+my $pinned_pid = proxy_query($s1, 'EXECUTE q;');
+is(proxy_query($s1, 'SELECT pg_backend_pid();'),
+	$pinned_pid, 'pinned session keeps its backend');
+my $other_pid = proxy_query($s2, 'SELECT pg_backend_pid();');
+isnt($other_pid, $pinned_pid, 'pinned backend is not given to other clients');
+is(proxy_query($s3, 'SELECT pg_backend_pid();'),
+	$other_pid, 'other clients share the remaining backend');
+is(proxy_query($s1, 'EXECUTE q;'),
+	$pinned_pid, 'prepared statement survives other clients\' transactions');
+like(
+	slurp_file($node->logfile, $log_offset),
+	qr/pooled session pinned to its backend by PREPARE/,
+	'pinning is logged');
+
+# The pinned backend goes away with its client.
+proxy_finish($s1);
+ok( $node->poll_query_until(
+		'postgres', "SELECT count(*) = 0 FROM pg_stat_activity WHERE pid = $pinned_pid"),
+	'pinned backend is terminated when its client disconnects');
+proxy_finish($_) foreach @sessions[ 1 .. 4 ];
+
+# nextval() state is used by later currval() and lastval() calls, so it pins
+# the session too.
+$log_offset = -s $node->logfile;
+my $seq1 = proxy_session();
+my $seq2 = proxy_session();
+my $val = proxy_query($seq1, "SELECT nextval('proxy_seq');");
+$pinned_pid = proxy_query($seq1, 'SELECT pg_backend_pid();');
+isnt(proxy_query($seq2, 'SELECT pg_backend_pid();'),
+	$pinned_pid, 'nextval() pins the session');
+is(proxy_query($seq1, "SELECT currval('proxy_seq');"),
+	$val, 'currval() works in a later transaction');
+is(proxy_query($seq1, 'SELECT lastval();'),
+	$val, 'lastval() works in a later transaction');
+like(
+	slurp_file($node->logfile, $log_offset),
+	qr/pooled session pinned to its backend by nextval\(\)/,
+	'pinning by nextval() is logged');
+proxy_finish($seq1);
+
+# A cancel request sent to the proxy port reaches the backend currently
+# serving the client.
+my $canceled = proxy_session();
+$canceled->{stdin} .= "SELECT pg_sleep(180);\n";
+$canceled->{harness}->pump_nb;
+ok( $node->poll_query_until(
+		'postgres',
+		"SELECT count(*) = 1 FROM pg_stat_activity "
+		  . "WHERE query = 'SELECT pg_sleep(180);' AND state = 'active'"),
+	'query through the proxy is running');
+$canceled->{harness}->signal('INT');
+like(
+	proxy_query(
+		$canceled, "SELECT 'after cancel';",
+		qr/canceling statement due to user request.*\@\@done\@\@\n/s),
+	qr/canceling statement due to user request/,
+	'cancel request is routed through the proxy');
+is(proxy_query($canceled, "SELECT 'still here';"),
+	'still here', 'session is usable after the cancel');
+proxy_finish($canceled);
+proxy_finish($seq2);
+
+# Authentication is performed by the backend, as for direct connections.
+$node->connect_fails(
+	"$proxy_connstr dbname=postgres user=regress_pw password=wrong",
+	'wrong password is rejected through the proxy',
+	expected_stderr => qr/password authentication failed for user "regress_pw"/
+);
+$node->connect_ok(
+	"$proxy_connstr dbname=postgres user=regress_pw password=pass",
+	'right password is accepted through the proxy');
+$node->connect_fails(
+	"$proxy_connstr dbname=postgres user=regress_peer",
+	'peer authentication is refused through the proxy',
+	expected_stderr =>
+	  qr/peer authentication is not supported for connections through a connection proxy/
+);
+
+$node->stop;
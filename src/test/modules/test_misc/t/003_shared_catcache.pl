@@ -0,0 +1,105 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for the shared catalog cache: entries loaded by one backend must be
+# used by others only as long as they're current.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 12;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', q{
+shared_catalog_cache_size = 8MB
+log_min_messages = debug1
+});
+$node->start;
+
+# Every safe_psql() call below runs in a new backend, whose local catalog
+# cache is empty, so its lookups go to the shared tier first.
+$node->safe_psql(
+	'postgres', q{
+CREATE FUNCTION scc_func() RETURNS int LANGUAGE sql AS 'SELECT 1';
+CREATE TABLE scc_tab (a int);
+CREATE ROLE regress_scc_role;
+});
+is($node->safe_psql('postgres', 'SELECT scc_func()'),
+	'1', 'function is found');
+is($node->safe_psql('postgres', 'SELECT scc_func()'),
+	'1', 'function is found by another backend');
+
+# Changes that are committed are seen by later backends.
+$node->safe_psql('postgres',
+	"CREATE OR REPLACE FUNCTION scc_func() RETURNS int LANGUAGE sql AS 'SELECT 2'"
+);
+is($node->safe_psql('postgres', 'SELECT scc_func()'),
+	'2', 'replaced function is seen');
+
+# Changes that are rolled back are not, even if the transaction used the
+# changed catalog entries itself.
+is( $node->safe_psql(
+		'postgres', q{
+BEGIN;
+CREATE OR REPLACE FUNCTION scc_func() RETURNS int LANGUAGE sql AS 'SELECT 3';
+SELECT scc_func();
+ROLLBACK;
+}), '3', 'uncommitted function is seen by its own transaction');
+is($node->safe_psql('postgres', 'SELECT scc_func()'),
+	'2', 'rolled back change is not seen by others');
+
+$node->safe_psql('postgres', 'DROP FUNCTION scc_func()');
+my ($ret, $stdout, $stderr) =
+  $node->psql('postgres', 'SELECT scc_func()');
+like($stderr, qr/function scc_func\(\) does not exist/,
+	'dropped function is gone');
+
+# Renaming a table invalidates its entry under the old name.
+$node->safe_psql('postgres', 'SELECT * FROM scc_tab');
+$node->safe_psql('postgres', 'ALTER TABLE scc_tab RENAME TO scc_tab2');
+is( $node->safe_psql(
+		'postgres', q{SELECT to_regclass('scc_tab') IS NULL, to_regclass('scc_tab2')}
+	),
+	't|scc_tab2',
+	'renamed table is found under its new name only');
+
+# Likewise for entries of shared catalogs.
+$node->safe_psql('postgres', q{SELECT 'regress_scc_role'::regrole});
+$node->safe_psql('postgres',
+	'ALTER ROLE regress_scc_role RENAME TO regress_scc_role2');
+is( $node->safe_psql(
+		'postgres',
+		q{SELECT to_regrole('regress_scc_role') IS NULL, to_regrole('regress_scc_role2')}
+	),
+	't|regress_scc_role2',
+	'renamed role is found under its new name only');
+
+# Entries of another database are not used.
+$node->safe_psql('postgres', 'CREATE DATABASE scc_db');
+$node->safe_psql('scc_db',
+	"CREATE FUNCTION scc_func() RETURNS int LANGUAGE sql AS 'SELECT 10'");
+is($node->safe_psql('scc_db', 'SELECT scc_func()'),
+	'10', 'function of another database is found there');
+($ret, $stdout, $stderr) = $node->psql('postgres', 'SELECT scc_func()');
+like($stderr, qr/function scc_func\(\) does not exist/,
+	'function of another database is not found here');
+
+# DROP DATABASE removes the database's entries, so that they can't turn up
+# again should its OID be reused.
+my $dboid = $node->safe_psql('postgres',
+	"SELECT oid FROM pg_database WHERE datname = 'scc_db'");
+my $log_offset = -s $node->logfile;
+$node->safe_psql('postgres', 'DROP DATABASE scc_db');
+my $log = slurp_file($node->logfile, $log_offset);
+ok( $log =~
+	  /removed (\d+) shared catalog cache entries of database $dboid\b/
+	  && $1 > 0,
+	'DROP DATABASE removes the entries of the database');
+
+is($node->safe_psql('postgres', 'SELECT 1 FROM scc_tab2'),
+	'', 'entries of other databases are still usable');
+
+$node->stop;
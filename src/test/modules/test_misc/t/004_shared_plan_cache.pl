@@ -0,0 +1,90 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for the shared plan cache: generic plans are shared only between
+# sessions whose settings would make the planner produce the same plan.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 16;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'shared_plan_cache_size = 8MB');
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE spc_tab (a int PRIMARY KEY, b text);
+INSERT INTO spc_tab SELECT g, g::text FROM generate_series(1, 1000) g;
+ANALYZE spc_tab;
+});
+
+my $hit_message = qr/using generic plan from the shared plan cache/;
+
+# Prepare the test statement in a new session, after applying the given
+# settings, and return the plan used and whether it came from the shared
+# plan cache.
+sub prepare_and_explain
+{
+	my ($settings) = @_;
+
+	my ($ret, $stdout, $stderr) = $node->psql(
+		'postgres', qq{
+SET plan_cache_mode = force_generic_plan;
+$settings
+SET client_min_messages = debug2;
+PREPARE q(int) AS SELECT b FROM spc_tab WHERE a = \$1;
+EXPLAIN (COSTS OFF) EXECUTE q(1);
+});
+	die "psql failed: $stderr" if $ret != 0;
+
+	my ($scan) = $stdout =~ /^\s*(?:->\s*)?(\w+(?: Only)? Scan)/m;
+	return ($scan, $stderr =~ $hit_message ? 1 : 0);
+}
+
+my ($scan, $hit) = prepare_and_explain('');
+is($scan, 'Index Scan', 'first session plans an index scan');
+is($hit, 0, 'first session plans by itself');
+
+($scan, $hit) = prepare_and_explain('');
+is($scan, 'Index Scan', 'second session uses an index scan');
+is($hit, 1, 'second session uses the shared plan');
+
+# Sessions with different planner settings must plan for themselves.
+my $noindex = 'SET enable_indexscan = off; SET enable_bitmapscan = off;';
+($scan, $hit) = prepare_and_explain($noindex);
+is($scan, 'Seq Scan', 'session without index scans plans a seqscan');
+is($hit, 0, 'session without index scans does not use the shared plan');
+
+($scan, $hit) = prepare_and_explain($noindex);
+is($scan, 'Seq Scan', 'plan for the same settings is a seqscan');
+is($hit, 1, 'plan for the same settings is shared');
+
+foreach my $setting (
+	q{SET work_mem = '8MB';},
+	q{SET random_page_cost = 1.5;},
+	q{SET jit = off;},
+	q{SET max_parallel_workers_per_gather = 0;})
+{
+	($scan, $hit) = prepare_and_explain($setting);
+	is($hit, 0, "shared plan is not used after $setting");
+}
+
+# Parse-time settings still count, too.
+($scan, $hit) = prepare_and_explain(q{SET search_path = public, pg_catalog;});
+is($hit, 0, 'shared plan is not used with another search_path');
+
+# Dropping the index invalidates the shared plan.
+$node->safe_psql('postgres',
+	'ALTER TABLE spc_tab DROP CONSTRAINT spc_tab_pkey');
+($scan, $hit) = prepare_and_explain('');
+is($scan, 'Seq Scan', 'plan is made again after the index is dropped');
+is($hit, 0, 'invalidated shared plan is not used');
+
+($scan, $hit) = prepare_and_explain('');
+is($hit, 1, 'the new plan is shared in turn');
+
+$node->stop;
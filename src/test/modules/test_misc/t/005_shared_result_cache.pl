@@ -0,0 +1,146 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for the shared result cache: results of expensive immutable
+# functions are computed once, shared between sessions of a database, and
+# discarded when the function changes or the cache fills up.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 24;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'shared_result_cache_size = 1MB');
+$node->start;
+
+# The functions log each computation, so that results coming from the cache
+# can be told apart from computed ones.
+my $functions = q{
+CREATE FUNCTION src_func(n int) RETURNS text
+LANGUAGE plpgsql IMMUTABLE COST 10000 AS $$
+BEGIN
+	RAISE NOTICE 'computing src_func(%)', n;
+	RETURN 'v1:' || n;
+END $$;
+CREATE FUNCTION src_big(n int) RETURNS text
+LANGUAGE plpgsql IMMUTABLE COST 10000 AS $$
+BEGIN
+	RAISE NOTICE 'computing src_big(%)', n;
+	RETURN repeat(md5(n::text), 4000);
+END $$;
+};
+$node->safe_psql('postgres', $functions);
+$node->safe_psql('postgres', 'CREATE DATABASE src_db');
+$node->safe_psql('src_db', $functions);
+
+# Run a query in a new session, and return its output and the number of
+# function results it computed rather than found in the cache.
+sub run_query
+{
+	my ($dbname, $sql) = @_;
+
+	my ($ret, $stdout, $stderr) =
+	  $node->psql($dbname, "SET client_min_messages = debug1;\n$sql");
+	die "psql failed: $stderr" if $ret != 0;
+
+	my $computed = () = $stderr =~ /NOTICE:  computing/g;
+	return ($stdout, $computed, $stderr);
+}
+
+my $query = 'SELECT src_func(g) FROM generate_series(1, 3) g';
+my ($result, $computed) = run_query('postgres', $query);
+is($result, "v1:1\nv1:2\nv1:3", 'results are computed');
+is($computed, 3, 'first session computes all results');
+
+($result, $computed) = run_query('postgres', $query);
+is($result, "v1:1\nv1:2\nv1:3", 'results are found in the cache');
+is($computed, 0, 'second session uses the cached results');
+
+($result, $computed) =
+  run_query('postgres', 'SELECT src_func(g) FROM generate_series(3, 4) g');
+is($result, "v1:3\nv1:4", 'results for other arguments');
+is($computed, 1, 'only results for new arguments are computed');
+
+($result, $computed) = run_query('src_db', $query);
+is($result, "v1:1\nv1:2\nv1:3", 'results in another database');
+is($computed, 3, 'results are not shared between databases');
+
+# A definition changed by a transaction that is rolled back has no effect
+# on the cache, neither while in progress nor afterwards.
+($result, $computed) = run_query(
+	'postgres', qq{
+BEGIN;
+CREATE OR REPLACE FUNCTION src_func(n int) RETURNS text
+LANGUAGE plpgsql IMMUTABLE COST 10000 AS \$\$
+BEGIN
+	RAISE NOTICE 'computing src_func(%)', n;
+	RETURN 'rolled back:' || n;
+END \$\$;
+$query;
+ROLLBACK;
+});
+is($result, "rolled back:1\nrolled back:2\nrolled back:3",
+	'uncommitted definition is used by its own transaction');
+is($computed, 3, 'uncommitted definition does not use the cache');
+
+($result, $computed) = run_query('postgres', $query);
+is($result, "v1:1\nv1:2\nv1:3", 'rolled back definition is not seen');
+is($computed, 0, 'rolled back definition leaves the cache alone');
+
+# A committed change invalidates the cached results.
+$node->safe_psql(
+	'postgres', q{
+CREATE OR REPLACE FUNCTION src_func(n int) RETURNS text
+LANGUAGE plpgsql IMMUTABLE COST 10000 AS $$
+BEGIN
+	RAISE NOTICE 'computing src_func(%)', n;
+	RETURN 'v2:' || n;
+END $$;
+});
+($result, $computed) = run_query('postgres', $query);
+is($result, "v2:1\nv2:2\nv2:3", 'new definition is used');
+is($computed, 3, 'replacing the function invalidates its results');
+
+($result, $computed) = run_query('postgres', $query);
+is($computed, 0, 'results of the new definition are cached in turn');
+
+($result, $computed) = run_query('src_db', $query);
+is($result, "v1:1\nv1:2\nv1:3",
+	'function of the same name in another database is unaffected');
+is($computed, 0, 'results in another database are kept');
+
+# Functions that are cheap, or no longer immutable, are not cached.
+$node->safe_psql('postgres', 'ALTER FUNCTION src_func(int) COST 1');
+($result, $computed) = run_query('postgres', $query);
+is($computed, 3, 'ALTER FUNCTION invalidates the results');
+($result, $computed) = run_query('postgres', $query);
+is($computed, 3, 'results of cheap functions are not cached');
+
+$node->safe_psql('postgres', 'ALTER FUNCTION src_func(int) COST 10000 STABLE');
+run_query('postgres', $query);
+($result, $computed) = run_query('postgres', $query);
+is($computed, 3, 'results of stable functions are not cached');
+
+# With a 1MB cache, about half of which is used for results, storing eight
+# results of 128kB each empties it at least once.  The latest result
+# survives that, the first one does not.
+my $stderr;
+($result, $computed, $stderr) = run_query('postgres',
+	'SELECT length(src_big(g)) FROM generate_series(1, 8) g');
+is($computed, 8, 'large results are computed');
+like(
+	$stderr,
+	qr/shared result cache was full and has been emptied/,
+	'full cache is emptied');
+
+($result, $computed) =
+  run_query('postgres', 'SELECT length(src_big(8))');
+is($computed, 0, 'latest result is kept when the cache is emptied');
+($result, $computed) =
+  run_query('postgres', 'SELECT length(src_big(1))');
+is($computed, 1, 'earlier results are evicted when the cache is emptied');
+
+$node->stop;
@@ -0,0 +1,126 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for compression of the frontend/backend protocol: results, COPY
+# data and replication commands must come through intact, and connections
+# must fall back to no compression when the server allows none of the
+# methods the client asks for.
+
+use strict;
+use warnings;
+use Digest::MD5 qw(md5_hex);
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my @methods;
+push @methods, 'lz4'  if check_pg_config("#define USE_LZ4 1");
+push @methods, 'zstd' if check_pg_config("#define USE_ZSTD 1");
+if (!@methods)
+{
+	plan skip_all => 'no protocol compression methods are supported by this build';
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init(allows_streaming => 1);
+$node->append_conf(
+	'postgresql.conf', qq{
+protocol_compression = '@{[ join(',', @methods) ]}'
+log_min_messages = debug1
+});
+$node->start;
+
+my $compressed = qr/using protocol compression method "(\w+)"/;
+my $connstr = $node->connstr('postgres');
+
+# Run a query over a connection with the given extra connection options, and
+# return its output and the compression method the server used, if any.
+sub run_query
+{
+	my ($options, $sql, %params) = @_;
+
+	my $log_offset = -s $node->logfile;
+	my ($ret, $stdout, $stderr) =
+	  $node->psql('postgres', $sql, connstr => "$connstr $options", %params);
+	die "psql failed: $stderr" if $ret != 0;
+
+	my ($method) = slurp_file($node->logfile, $log_offset) =~ $compressed;
+	return ($stdout, $method);
+}
+
+# Results much larger than the send and receive buffers
+my $result_sql =
+  'SELECT g, repeat(md5(g::text), 40) FROM generate_series(1, 20000) g';
+my ($expected) = run_query('', $result_sql);
+
+foreach my $m (@methods)
+{
+	my ($result, $method) = run_query("compression=$m", $result_sql);
+	is($method, $m, "connection uses $m");
+	ok($result eq $expected, "large result is received intact with $m");
+}
+
+# COPY data sent by the client, likewise crossing buffer boundaries.  The
+# rows are not very compressible, so the compressed stream is long, too.
+$node->safe_psql('postgres', 'CREATE TABLE copy_tab (a int, b text)');
+my $copy_data = '';
+my $seed = 'x';
+foreach my $i (1 .. 20000)
+{
+	$seed = md5_hex($seed);
+	$copy_data .= "$i\t$seed$seed\n";
+}
+
+foreach my $m (@methods)
+{
+	$node->safe_psql('postgres', 'TRUNCATE copy_tab');
+	my ($result, $method) = run_query("compression=$m",
+		"COPY copy_tab FROM STDIN;\n$copy_data\\.\n");
+	is($method, $m, "COPY connection uses $m");
+	is( $node->safe_psql(
+			'postgres',
+			q{SELECT md5(string_agg(a || E'\t' || b || E'\n', '' ORDER BY a)) FROM copy_tab}
+		),
+		md5_hex($copy_data),
+		"COPY data is received intact with $m");
+}
+
+# Replication connections are compressed, too.
+my ($result, $method) = run_query("compression=$methods[0]",
+	'IDENTIFY_SYSTEM', replication => 'database');
+is($method, $methods[0], 'replication connection is compressed');
+like($result, qr/^\d+\|1\|[0-9A-F]+\/[0-9A-F]+\|postgres$/,
+	'replication command works over a compressed connection');
+
+# The server picks the first of the client's methods that it allows.
+if (@methods == 2)
+{
+	($result, $method) = run_query('compression=zstd,lz4', 'SELECT 1');
+	is($method, 'zstd', 'client preference order is followed');
+
+	$node->append_conf('postgresql.conf', "protocol_compression = 'lz4'");
+	$node->restart;
+	($result, $method) = run_query('compression=zstd,lz4', 'SELECT 1');
+	is($method, 'lz4', 'methods the server does not allow are skipped');
+	($result, $method) = run_query('compression=zstd', 'SELECT 1');
+	is($method, undef,
+		'no compression if the server allows none of the methods');
+	is($result, '1', 'uncompressed connection works');
+}
+
+# Without protocol_compression, clients asking for compression get none.
+$node->append_conf('postgresql.conf', "protocol_compression = ''");
+$node->restart;
+($result, $method) = run_query("compression=$methods[0]", $result_sql);
+is($method, undef, 'no compression if the server allows none');
+ok($result eq $expected, 'large result is received on fallback');
+
+# Unknown methods are rejected by libpq itself.
+$node->connect_fails(
+	"$connstr compression=nosuchmethod",
+	'unknown compression method',
+	expected_stderr => qr/invalid compression value: "nosuchmethod"/);
+
+$node->stop;
+
+done_testing();
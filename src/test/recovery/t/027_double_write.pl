@@ -0,0 +1,118 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test that a page torn by a crash is repaired from the double-write buffer.
+#
+# With full_page_writes off, WAL replay can't fix a page whose in-place write
+# was only partially completed.  We simulate such a write by combining the
+# first half of a page with the second half of its previous version, after
+# an immediate shutdown.
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 7;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+double_write_buffer_size = 128
+full_page_writes = off
+autovacuum = off
+});
+$node->start;
+
+my $pgdata = $node->data_dir;
+ok(-f "$pgdata/pg_doublewrite", 'double-write file is created');
+
+my $blcksz = $node->safe_psql('postgres', 'SHOW block_size');
+
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE dw_tab (a int, b text) WITH (fillfactor = 50);
+INSERT INTO dw_tab SELECT g, 'row ' || g FROM generate_series(1, 1000) g;
+CHECKPOINT;
+});
+my $relpath = $node->safe_psql('postgres',
+	"SELECT pg_relation_filepath('dw_tab')");
+
+# Read or write block 0 of the table
+sub read_block
+{
+	my $block;
+
+	open(my $fh, '<', "$pgdata/$relpath")
+	  or BAIL_OUT("open failed: $!");
+	binmode $fh;
+	sysread($fh, $block, $blcksz) == $blcksz
+	  or BAIL_OUT("sysread failed: $!");
+	close($fh);
+	return $block;
+}
+
+sub write_block
+{
+	my ($block) = @_;
+
+	open(my $fh, '+<', "$pgdata/$relpath")
+	  or BAIL_OUT("open failed: $!");
+	binmode $fh;
+	syswrite($fh, $block) == $blcksz
+	  or BAIL_OUT("syswrite failed: $!");
+	close($fh);
+	return;
+}
+
+my $old_block = read_block();
+
+# Update the rows of the first block in place, and have the checkpoint
+# write the block through the double-write buffer.  Later changes are
+# replayed from WAL, but only onto an intact page.
+$node->safe_psql(
+	'postgres', q{
+UPDATE dw_tab SET b = 'updated' WHERE ctid < '(1,0)';
+CHECKPOINT;
+INSERT INTO dw_tab VALUES (0, 'after checkpoint');
+});
+my $expected = $node->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE b = 'updated'), md5(string_agg(b, ',' ORDER BY a)) FROM dw_tab"
+);
+$node->stop('immediate');
+
+my $new_block = read_block();
+isnt($new_block, $old_block, 'block was changed by the checkpoint');
+
+my $half = $blcksz / 2;
+my $torn_block =
+  substr($new_block, 0, $half) . substr($old_block, $half, $half);
+isnt($torn_block, $new_block, 'second half of the block was changed, too');
+write_block($torn_block);
+
+my $log_offset = -s $node->logfile;
+$node->start;
+
+my $log = slurp_file($node->logfile, $log_offset);
+like(
+	$log,
+	qr/restored block 0 of relation \Q$relpath\E from the double-write buffer/,
+	'torn block is restored');
+unlike(
+	$log,
+	qr/restored block [1-9]\d* of relation \Q$relpath\E /,
+	'intact blocks are not restored');
+
+is( $node->safe_psql(
+		'postgres',
+		"SELECT count(*), count(*) FILTER (WHERE b = 'updated'), md5(string_agg(b, ',' ORDER BY a)) FROM dw_tab"
+	),
+	$expected,
+	'data is intact after crash recovery');
+
+# Without the double-write buffer, the file is removed.
+$node->append_conf('postgresql.conf', 'double_write_buffer_size = 0');
+$node->restart;
+ok(!-e "$pgdata/pg_doublewrite",
+	'double-write file is removed when disabled');
+
+$node->stop;
@@ -0,0 +1,173 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Tests for the order in which the archiver processes status files, for
+# retries of failed archive commands, and for archive_parallelism.
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use List::Util qw(max);
+
+if ($PostgreSQL::Test::Utils::windows_os)
+{
+	plan skip_all => 'archive_parallelism is not supported on Windows';
+}
+else
+{
+	plan tests => 12;
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init(has_archiving => 1);
+
+my $pgdata  = $node->data_dir;
+my $archive = $node->archive_dir;
+my $tmpdir  = PostgreSQL::Test::Utils::tempdir;
+mkdir "$tmpdir/running";
+mkdir "$tmpdir/tried";
+
+# Start with an archive command that fails; see 020_archive_status.pl for
+# why it isn't just "false".
+$node->append_conf(
+	'postgresql.conf', qq{
+autovacuum = off
+archive_command = 'cp "%p_does_not_exist" "$archive/%f"'
+});
+$node->start;
+
+# Switch to a new archive_command and archive_parallelism
+sub set_archiving
+{
+	my ($command, $parallelism) = @_;
+
+	$node->append_conf(
+		'postgresql.conf', qq{
+archive_command = '$command'
+archive_parallelism = $parallelism
+});
+	$node->reload;
+	return;
+}
+
+# Fill the given number of WAL segments, returning their names
+sub switch_segments
+{
+	my ($count) = @_;
+	my @segments;
+
+	$node->safe_psql('postgres',
+		'CREATE TABLE IF NOT EXISTS filler (a int)');
+	foreach (1 .. $count)
+	{
+		push @segments,
+		  $node->safe_psql(
+			'postgres', q{
+INSERT INTO filler VALUES (1);
+SELECT pg_walfile_name(pg_current_wal_lsn());
+SELECT pg_switch_wal();
+}) =~ /^(\w+)/;
+	}
+	return @segments;
+}
+
+sub archived_count
+{
+	return $node->safe_psql('postgres',
+		'SELECT archived_count FROM pg_stat_archiver');
+}
+
+# Check that all the given files have been marked as archived
+sub all_done
+{
+	foreach my $f (@_)
+	{
+		return 0
+		  if -f "$pgdata/pg_wal/archive_status/$f.ready"
+		  || !-f "$pgdata/pg_wal/archive_status/$f.done"
+		  || !-f "$archive/$f";
+	}
+	return 1;
+}
+
+# A failing archive command is retried a few times before the archiver
+# gives up on the file for a while.
+my @segments = switch_segments(3);
+
+$node->poll_query_until('postgres',
+	q{SELECT failed_count >= 3 FROM pg_stat_archiver})
+  or die "Timed out while waiting for archiving to fail";
+my $log = slurp_file($node->logfile);
+like(
+	$log,
+	qr/archive command failed with exit code/,
+	'failure of archive command is reported');
+like(
+	$log,
+	qr/archiving write-ahead log file "$segments[0]" failed too many times, will try again later/,
+	'archiver gives up after several failures');
+ok( -f "$pgdata/pg_wal/archive_status/$segments[0].ready"
+	  && !-f "$pgdata/pg_wal/archive_status/$segments[0].done",
+	'failed segment is still waiting to be archived');
+is(archived_count(), '0', 'nothing was archived');
+
+# Timeline history files are archived before WAL segments, and segments
+# oldest first.  The history file here isn't of any real timeline, but the
+# archiver doesn't care.
+my $history = '00000002.history';
+append_to_file("$pgdata/pg_wal/$history",
+	"1\t0/3000000\tno recovery target specified\n");
+append_to_file("$pgdata/pg_wal/archive_status/$history.ready", '');
+
+set_archiving(qq{echo "%f" >> "$tmpdir/started" && cp "%p" "$archive/%f"},
+	1);
+$node->poll_query_until('postgres',
+	'SELECT archived_count FROM pg_stat_archiver', '4')
+  or die "Timed out while waiting for archiving to succeed";
+
+ok(all_done($history, @segments), 'all files are archived');
+is_deeply(
+	[ split /\n/, slurp_file("$tmpdir/started") ],
+	[ $history, @segments ],
+	'history file first, then segments in order');
+
+# With archive_parallelism, several archive commands run at the same time.
+# Each command counts the commands running while it sleeps, before it
+# finishes.
+set_archiving(
+	qq{touch "$tmpdir/running/%f" && sleep 2 && ls "$tmpdir/running" | wc -l >> "$tmpdir/concurrency" && cp "%p" "$archive/%f" && rm "$tmpdir/running/%f"},
+	4);
+@segments = switch_segments(4);
+$node->poll_query_until('postgres',
+	'SELECT archived_count FROM pg_stat_archiver', '8')
+  or die "Timed out while waiting for parallel archiving";
+
+ok(all_done(@segments), 'all files are archived in parallel');
+my @concurrency = split ' ', slurp_file("$tmpdir/concurrency");
+is(scalar @concurrency, 4, 'archive command ran once per file');
+cmp_ok(max(@concurrency), '>', 1, 'archive commands ran concurrently');
+
+# Each file is retried on its own: the command fails for every file the
+# first time it sees it, then succeeds.
+my $failed_before = $node->safe_psql('postgres',
+	'SELECT failed_count FROM pg_stat_archiver');
+my $log_offset = -s $node->logfile;
+set_archiving(
+	qq{test -f "$tmpdir/tried/%f" && cp "%p" "$archive/%f" || { touch "$tmpdir/tried/%f"; exit 1; }},
+	4);
+@segments = switch_segments(3);
+$node->poll_query_until('postgres',
+	'SELECT archived_count FROM pg_stat_archiver', '11')
+  or die "Timed out while waiting for archiving to be retried";
+
+ok(all_done(@segments), 'all files are archived after a retry');
+is( $node->safe_psql(
+		'postgres', 'SELECT failed_count FROM pg_stat_archiver'),
+	$failed_before + 3,
+	'each file failed once');
+$log = slurp_file($node->logfile, $log_offset);
+unlike($log, qr/failed too many times/,
+	'archiver does not give up on files failing only once');
+
+$node->stop;
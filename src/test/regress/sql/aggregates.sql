@@ -775,6 +775,22 @@ select rank('3') within group (order by x) from generate_series(1,5) x;
 -- divide by zero check
 select percent_rank(0) within group (order by x) from generate_series(1,0) x;
 
+-- approximate aggregates
+select approx_count_distinct(x) between 980 and 1020 as ok
+  from generate_series(1, 1000) x, generate_series(1, 3);
+select approx_count_distinct(x) from (values ('a'), ('b'), (null), ('a')) v(x);
+select approx_count_distinct(x) from generate_series(1, 0) x;
+select abs(approx_percentile(x, 0.5) - 500) <= 5 as ok
+  from generate_series(1, 1000) x;
+select approx_percentile(x, 0) between -2.53 and -2.47 as min_ok,
+       approx_percentile(x, 0.5) = 0 as median_ok,
+       approx_percentile(x, 1) between 0.99e10 and 1.01e10 as max_ok
+  from (values (-2.5), (0), (1e10), (null)) v(x);
+select approx_percentile(x, 0) as lo, approx_percentile(x, 1) as hi
+  from (values ('-infinity'::float8), ('infinity'), ('nan')) v(x);
+select approx_percentile(x, 0.5) from generate_series(1, 0) x;
+select approx_percentile(x, 1.5) from generate_series(1, 5) x;
+
 -- deparse and multiple features:
 create view aggordview1 as
 select ten,
@@ -1086,6 +1102,14 @@ FROM (SELECT * FROM tenk1
       UNION ALL SELECT * FROM tenk1
       UNION ALL SELECT * FROM tenk1) u;
 
+-- approx_count_distinct and approx_percentile cover their combine functions
+SELECT approx_count_distinct(unique1) BETWEEN 9800 AND 10200 AS count_ok,
+       abs(approx_percentile(unique1, 0.5) - 4999) <= 50 AS median_ok
+FROM (SELECT * FROM tenk1
+      UNION ALL SELECT * FROM tenk1
+      UNION ALL SELECT * FROM tenk1
+      UNION ALL SELECT * FROM tenk1) u;
+
 ROLLBACK;
 
 -- test coverage for dense_rank
@@ -1245,3 +1269,32 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+-- Check that fetching input in batches gives the same results
+create temp table agg_batch_0 as
+  select ten as a, count(*) as c1, sum(unique1) as c2, max(stringu1) as c3
+  from tenk1 where unique1 % 3 <> 0 group by ten;
+create temp table agg_plain_0 as
+  select count(*) as c1, sum(unique1) as c2, max(stringu1) as c3
+  from tenk1 where unique1 % 3 <> 0;
+set executor_batch_size = 100;
+create temp table agg_batch_1 as
+  select ten as a, count(*) as c1, sum(unique1) as c2, max(stringu1) as c3
+  from tenk1 where unique1 % 3 <> 0 group by ten;
+create temp table agg_plain_1 as
+  select count(*) as c1, sum(unique1) as c2, max(stringu1) as c3
+  from tenk1 where unique1 % 3 <> 0;
+reset executor_batch_size;
+
+(select * from agg_batch_0 except select * from agg_batch_1)
+  union all
+(select * from agg_batch_1 except select * from agg_batch_0);
+
+(select * from agg_plain_0 except select * from agg_plain_1)
+  union all
+(select * from agg_plain_1 except select * from agg_plain_0);
+
+drop table agg_batch_0;
+drop table agg_batch_1;
+drop table agg_plain_0;
+drop table agg_plain_1;
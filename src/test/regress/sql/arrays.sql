@@ -345,6 +345,12 @@ SELECT * FROM array_op_test WHERE t = '{}' ORDER BY seqno;
 SELECT * FROM array_op_test WHERE t @> '{}' ORDER BY seqno;
 SELECT * FROM array_op_test WHERE t && '{}' ORDER BY seqno;
 SELECT * FROM array_op_test WHERE t <@ '{}' ORDER BY seqno;
+-- large enough for the elements of one side to be looked up in a hash table
+SELECT ARRAY(SELECT g FROM generate_series(1, 100) g) @> ARRAY(SELECT g FROM generate_series(1, 100, 3) g) AS "TRUE";
+SELECT ARRAY(SELECT g FROM generate_series(1, 100) g) @> ARRAY(SELECT g FROM generate_series(1, 101, 4) g) AS "FALSE";
+SELECT ARRAY(SELECT g FROM generate_series(1, 100, 2) g) && ARRAY(SELECT g FROM generate_series(2, 100, 2) g) AS "FALSE";
+SELECT ARRAY(SELECT g::text FROM generate_series(1, 100) g) <@ (ARRAY(SELECT g::text FROM generate_series(1, 100) g) || NULL::text) AS "TRUE";
+SELECT (ARRAY(SELECT g FROM generate_series(1, 100) g) || NULL::int) <@ ARRAY(SELECT g FROM generate_series(1, 100) g) AS "FALSE";
 
 -- array casts
 SELECT ARRAY[1,2,3]::text[]::int[]::float8[] AS "{1,2,3}";
@@ -183,3 +183,81 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test skip scans: a condition on the second column only, where the index
+-- scan skips between the values of the first column
+--
+create table btree_skip (a int, b int, c int);
+insert into btree_skip
+  select a, b, a * 10000 + b
+  from generate_series(1, 10) a, generate_series(1, 1000) b;
+insert into btree_skip select null, b, b from generate_series(1, 1000) b;
+create index on btree_skip (a, b);
+analyze btree_skip;
+
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+set enable_sort to false;
+explain (costs off)
+select * from btree_skip where b = 500 order by a;
+select * from btree_skip where b = 500 order by a;
+explain (costs off)
+select * from btree_skip where b = 500 order by a desc;
+select * from btree_skip where b = 500 order by a desc;
+select count(*), sum(c) from btree_skip where b >= 999;
+select * from btree_skip where b > 10 and b < 13 and (a > 8 or a is null) order by a, b;
+
+-- Changes of scan direction
+begin;
+declare c scroll cursor for select a, c from btree_skip where b = 500 order by a;
+fetch 3 from c;
+fetch backward 2 from c;
+fetch 4 from c;
+fetch last from c;
+fetch backward 2 from c;
+commit;
+
+-- A descending index, with NULLs first
+drop index btree_skip_a_b_idx;
+create index on btree_skip (a desc nulls first, b);
+explain (costs off)
+select * from btree_skip where b = 500 order by a desc;
+select * from btree_skip where b = 500 order by a desc;
+explain (costs off)
+select * from btree_skip where b = 500 order by a;
+select * from btree_skip where b = 500 order by a;
+
+-- Mark and restore, for a merge join with duplicate outer values
+create table btree_skip_outer (a int);
+insert into btree_skip_outer values (2), (2), (5), (5), (5), (11);
+set enable_hashjoin to false;
+set enable_nestloop to false;
+set enable_material to false;
+select o.a, t.c from btree_skip_outer o join btree_skip t on t.a = o.a
+  where t.b = 7 order by o.a;
+reset enable_hashjoin;
+reset enable_nestloop;
+reset enable_material;
+
+-- With many values of the first column, the scan stops skipping and just
+-- reads the index from where it is
+create table btree_skip_many (a int, b int);
+insert into btree_skip_many select g, g % 3 from generate_series(1, 2000) g;
+create index on btree_skip_many (a, b);
+analyze btree_skip_many;
+select count(*), sum(a) from btree_skip_many where b = 1;
+select a from btree_skip_many where b = 1 order by a limit 3;
+select a from btree_skip_many where b = 1 order by a desc limit 3;
+
+-- name_ops stores cstrings, which we can't skip over
+create table btree_skip_name (n name, b int);
+insert into btree_skip_name select 'n' || g % 4, g from generate_series(1, 1000) g;
+create index on btree_skip_name (n, b);
+analyze btree_skip_name;
+select * from btree_skip_name where b between 41 and 44 order by n;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_sort;
+drop table btree_skip, btree_skip_outer, btree_skip_many, btree_skip_name;
@@ -225,6 +225,13 @@ select * from
         tenthous, lag(tenthous) over () as ltenthous from clstr_4) ss
 where row(hundred, thousand, tenthous) <= row(lhundred, lthousand, ltenthous);
 
+-- ALLOW_READS only changes the locking
+create index cluster_sort_desc on clstr_4 (tenthous desc);
+cluster (allow_reads) clstr_4 using cluster_sort_desc;
+select count(*) from
+(select tenthous, lag(tenthous) over () as ltenthous from clstr_4) ss
+where tenthous >= ltenthous;
+
 reset enable_indexscan;
 reset maintenance_work_mem;
 
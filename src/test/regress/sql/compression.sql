@@ -150,4 +150,29 @@ CREATE TABLE badcompresstbl (a text);
 ALTER TABLE badcompresstbl ALTER a SET COMPRESSION I_Do_Not_Exist_Compression; -- fails
 DROP TABLE badcompresstbl;
 
+-- test zstd compression
+CREATE TABLE cmdata_zstd(f1 text COMPRESSION zstd);
+INSERT INTO cmdata_zstd VALUES(repeat('1234567890', 1004));
+\d+ cmdata_zstd
+SELECT pg_column_compression(f1) FROM cmdata_zstd;
+SELECT SUBSTR(f1, 2000, 50) FROM cmdata_zstd;
+-- copy to an existing table using another compression method
+CREATE TABLE cmmove_zstd(f1 text COMPRESSION pglz);
+INSERT INTO cmmove_zstd SELECT * FROM cmdata_zstd;
+SELECT pg_column_compression(f1) FROM cmmove_zstd;
+-- externally stored compressed data
+INSERT INTO cmdata_zstd SELECT large_val() || repeat('a', 4000);
+SELECT pg_column_compression(f1) FROM cmdata_zstd;
+SELECT SUBSTR(f1, 200, 5) FROM cmdata_zstd;
+SELECT length(f1) FROM cmdata_zstd;
+-- default_toast_compression and changing the method afterwards
+SET default_toast_compression = 'zstd';
+CREATE TABLE cmdefault_zstd(f1 text);
+INSERT INTO cmdefault_zstd VALUES (repeat('123456789', 4004));
+RESET default_toast_compression;
+ALTER TABLE cmdefault_zstd ALTER COLUMN f1 SET COMPRESSION pglz;
+INSERT INTO cmdefault_zstd VALUES (repeat('123456789', 4004));
+SELECT pg_column_compression(f1) FROM cmdefault_zstd;
+DROP TABLE cmmove_zstd, cmdefault_zstd;
+DROP TABLE IF EXISTS cmdata_zstd;
 \set HIDE_TOAST_COMPRESSION true
@@ -512,6 +512,23 @@ VACUUM FULL concur_heap;
 REINDEX TABLE concur_heap;
 \d concur_heap
 
+-- Concurrent builds and rebuilds whose validation scan runs in parallel
+CREATE TABLE concur_parallel (i int, t text) WITH (parallel_workers = 2);
+INSERT INTO concur_parallel
+  SELECT g, repeat('x', 100) FROM generate_series(1, 5000) g;
+SET max_parallel_maintenance_workers = 2;
+SET maintenance_work_mem = '128MB';
+CREATE UNIQUE INDEX CONCURRENTLY concur_parallel_i ON concur_parallel (i);
+CREATE INDEX CONCURRENTLY concur_parallel_h ON concur_parallel USING hash (i);
+REINDEX TABLE CONCURRENTLY concur_parallel;
+RESET max_parallel_maintenance_workers;
+RESET maintenance_work_mem;
+SET enable_seqscan = off;
+SELECT count(*) FROM concur_parallel WHERE i BETWEEN 100 AND 199;
+SELECT count(*) FROM concur_parallel WHERE i = 4321;
+RESET enable_seqscan;
+DROP TABLE concur_parallel;
+
 -- Temporary tables with concurrent builds and on-commit actions
 -- CONCURRENTLY used with CREATE INDEX and DROP INDEX is ignored.
 -- PRESERVE ROWS, the default.
@@ -801,6 +818,28 @@ REINDEX (VERBOSE) TABLE reindex_verbose;
 \set VERBOSITY default
 DROP TABLE reindex_verbose;
 
+--
+-- REINDEX of a table's btree indexes from a single table scan
+--
+CREATE TABLE reindex_multi (a int PRIMARY KEY, b text, c int);
+CREATE INDEX reindex_multi_b ON reindex_multi (b) INCLUDE (c);
+CREATE INDEX reindex_multi_lower_b ON reindex_multi (lower(b));
+CREATE INDEX reindex_multi_c_part ON reindex_multi (c) WHERE c % 10 = 0;
+CREATE INDEX reindex_multi_c_hash ON reindex_multi USING hash (c);
+INSERT INTO reindex_multi SELECT g, 'Val' || g, g % 100 FROM generate_series(1, 1000) g;
+DELETE FROM reindex_multi WHERE a % 7 = 0;
+REINDEX TABLE reindex_multi;
+VACUUM FULL reindex_multi;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM reindex_multi WHERE a > 500;
+SELECT count(*) FROM reindex_multi WHERE b = 'Val41';
+SELECT count(*) FROM reindex_multi WHERE lower(b) = 'val43';
+SELECT count(*) FROM reindex_multi WHERE c = 20 AND c % 10 = 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE reindex_multi;
+
 --
 -- REINDEX CONCURRENTLY
 --
@@ -201,3 +201,23 @@ select * from inttest where a not in (1::myint,2::myint,3::myint,4::myint,5::myi
 select * from inttest where a not in (0::myint,2::myint,3::myint,4::myint,5::myint, null);
 
 rollback;
+
+--
+-- Tests for subexpressions repeated in a target list
+--
+create function cse_f(int) returns int language plpgsql immutable as
+$$ begin raise notice 'cse_f(%)', $1; return $1 * 2; end $$;
+-- computed once per row
+select cse_f(a) + 1, cse_f(a) * 10 from (values (1), (2)) v(a);
+-- but not hoisted out of CASE or COALESCE
+select case when a > 1 then cse_f(a) end, cse_f(a) from (values (1), (2)) v(a);
+select coalesce(a, cse_f(a)), cse_f(a) + 1 from (values (1), (null)) v(a);
+-- an expanded array used twice must not be modified in place
+create function cse_arr(int) returns int[] language plpgsql immutable as
+$$ declare r int[] := array[$1, $1]; begin r[2] := $1 + 1; return r; end $$;
+create function cse_poke(a int[]) returns int[] language plpgsql immutable as
+$$ begin a[1] := 0; return a; end $$;
+select cse_poke(cse_arr(a)), cse_arr(a) from (values (1), (2)) v(a);
+drop function cse_f(int);
+drop function cse_arr(int);
+drop function cse_poke(int[]);
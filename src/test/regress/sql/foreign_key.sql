@@ -1829,3 +1829,42 @@ UPDATE fkpart10.tbl1 SET f1 = 2 WHERE f1 = 1;
 INSERT INTO fkpart10.tbl1 VALUES (0), (1);
 COMMIT;
 DROP SCHEMA fkpart10 CASCADE;
+
+-- Foreign key checks look up the referenced key in the index directly where
+-- they can.  Check the cases where the column order or data types differ,
+-- and where the referenced table's owner lacks the privileges the lookup
+-- query would need.
+CREATE TABLE fkord_pk (a int, b text, PRIMARY KEY (b, a));
+CREATE TABLE fkord_fk (x int, y text, FOREIGN KEY (x, y) REFERENCES fkord_pk (a, b));
+INSERT INTO fkord_pk VALUES (1, 'one'), (2, 'two');
+INSERT INTO fkord_fk VALUES (1, 'one'), (2, 'two');
+INSERT INTO fkord_fk VALUES (1, 'two');
+DROP TABLE fkord_fk, fkord_pk;
+
+CREATE TABLE fkcoerce_pk (t text PRIMARY KEY, i int UNIQUE);
+CREATE TABLE fkcoerce_fk (v varchar(10) REFERENCES fkcoerce_pk,
+  s int2 REFERENCES fkcoerce_pk (i), l int8 REFERENCES fkcoerce_pk (i));
+INSERT INTO fkcoerce_pk VALUES ('abc', 1), ('def', 2);
+INSERT INTO fkcoerce_fk VALUES ('abc', 1, 2), ('def', 2, 1);
+INSERT INTO fkcoerce_fk VALUES ('xyz', 1, 1);
+INSERT INTO fkcoerce_fk VALUES ('abc', 3, 1);
+INSERT INTO fkcoerce_fk VALUES ('abc', 1, 4000000000);
+DROP TABLE fkcoerce_fk, fkcoerce_pk;
+
+CREATE ROLE regress_fk_pk_owner;
+CREATE TABLE fkacl_pk (a int PRIMARY KEY);
+CREATE TABLE fkacl_fk (a int REFERENCES fkacl_pk);
+INSERT INTO fkacl_pk VALUES (1);
+ALTER TABLE fkacl_pk OWNER TO regress_fk_pk_owner;
+REVOKE SELECT ON fkacl_pk FROM regress_fk_pk_owner;
+\set VERBOSITY terse
+INSERT INTO fkacl_fk VALUES (1);
+GRANT SELECT ON fkacl_pk TO regress_fk_pk_owner;
+REVOKE UPDATE ON fkacl_pk FROM regress_fk_pk_owner;
+INSERT INTO fkacl_fk VALUES (1);
+\set VERBOSITY default
+GRANT UPDATE ON fkacl_pk TO regress_fk_pk_owner;
+INSERT INTO fkacl_fk VALUES (1);
+INSERT INTO fkacl_fk VALUES (2);
+DROP TABLE fkacl_fk, fkacl_pk;
+DROP ROLE regress_fk_pk_owner;
@@ -568,3 +568,31 @@ SELECT to_char('2012-12-12 12:00'::timestamptz, 'YYYY-MM-DD SSSS');
 SELECT to_char('2012-12-12 12:00'::timestamptz, 'YYYY-MM-DD SSSSS');
 
 RESET TIME ZONE;
+
+--
+-- ISO 8601 dates and timestamps, which are mostly read without tokenizing,
+-- and the cases left to the general parser
+--
+SET DateStyle = 'ISO';
+SELECT s, s::timestamp AS ts, s::timestamptz AS tstz, s::date AS d
+FROM (VALUES ('2021-06-15'),
+             ('2021-06-15 13:45'),
+             ('2021-06-15T13:45:30'),
+             ('2021-06-15 13:45:30.5'),
+             ('2021-06-15 13:45:30.123456'),
+             ('2021-06-15 13:45:30.1234567'),
+             ('2021-06-15 13:45:30+05'),
+             ('2021-06-15T13:45:30.25+05:30'),
+             ('2021-06-15 13:45:30-03:15'),
+             ('2021-06-15 24:00:00'),
+             ('2021-06-15 23:59:60'),
+             ('2020-02-29'),
+             ('2000-02-29T23:59'),
+             ('2021-03-14 02:30'),
+             ('2021-11-07 01:30')) v(s);
+SELECT timestamp '2021-02-29 12:00';
+SELECT timestamptz '2021-02-29T12:00+05';
+SELECT date '2100-02-29';
+SELECT timestamp '2021-06-15 13:60';
+SELECT timestamptz '2021-06-15 24:00:01';
+RESET DateStyle;
@@ -205,6 +205,27 @@ delete from t;
 
 drop table t;
 
+-- Bounded sorts discard tuples whose leading key sorts after the last one
+-- they hold, either on their own or in the scan below them
+create table tn (a int, b int, c text);
+insert into tn
+  select case when g % 9 = 0 then null else g % 7 end, g, 'v' || g
+  from generate_series(1, 1000) g;
+explain (costs off) select a, b from tn order by a, b limit 5;
+select a, b from tn order by a, b limit 5;
+-- ties on the leading key are kept
+select a, count(*) from (select a from tn order by a, b limit 300) s
+group by a order by a;
+-- the scan checks the leading key before its quals and projection
+select b, c || '!' from tn where b % 2 = 0 order by a desc, b limit 4;
+select a, b from tn order by a nulls first, b desc limit 3;
+select a, b from tn order by a desc nulls last, b limit 3;
+select a, count(*) from (select a from tn order by a nulls first limit 115) s
+group by a order by a nulls first;
+select c from tn order by c collate "C" desc, b limit 3;
+select a, b from tn order by a % 3, b limit 4;
+drop table tn;
+
 -- Incremental sort vs. parallel queries
 set min_parallel_table_scan_size = '1kB';
 set min_parallel_index_scan_size = '1kB';
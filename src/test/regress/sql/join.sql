@@ -2298,3 +2298,41 @@ where exists (select 1 from j3
       and t1.unique1 < 1;
 
 drop table j3;
+
+--
+-- merge join repositioning an inner index scan to skip over inner tuples
+--
+create temp table mj_skip_o (a int, b int);
+create temp table mj_skip_i (a int, b int);
+insert into mj_skip_o values (1, 100), (500, 1), (999, 2), (2000, 1);
+insert into mj_skip_i select 1, g from generate_series(1, 50) g;
+insert into mj_skip_i select g, 1 from generate_series(2, 1000) g;
+create index on mj_skip_i (a, b);
+vacuum analyze mj_skip_i;
+analyze mj_skip_o;
+set enable_hashjoin = off;
+set enable_nestloop = off;
+set enable_material = off;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+-- many inner tuples equal to the outer one in the first merge key but lower
+-- in the second must be advanced over, not skipped
+explain (costs off)
+select * from mj_skip_o o
+where not exists (select 1 from mj_skip_i i where i.a = o.a and i.b = o.b);
+select * from mj_skip_o o
+where not exists (select 1 from mj_skip_i i where i.a = o.a and i.b = o.b);
+select count(*) from mj_skip_o o join mj_skip_i i on i.a = o.a and i.b = o.b;
+-- with a single merge key, long stretches of lower inner tuples are skipped
+select * from mj_skip_o o
+where exists (select 1 from mj_skip_i i where i.a = o.a)
+order by o.a;
+select * from mj_skip_o o
+where not exists (select 1 from mj_skip_i i where i.a = o.a);
+reset enable_hashjoin;
+reset enable_nestloop;
+reset enable_material;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table mj_skip_o;
+drop table mj_skip_i;
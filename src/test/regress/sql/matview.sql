@@ -295,3 +295,56 @@ EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)
   CREATE MATERIALIZED VIEW IF NOT EXISTS matview_ine_tab AS
     SELECT 1 / 0 WITH NO DATA; -- ok
 DROP MATERIALIZED VIEW matview_ine_tab;
+
+-- incremental materialized views
+CREATE TABLE mvtest_ivm_t (k int, v int);
+CREATE TABLE mvtest_ivm_d (k int, name text);
+INSERT INTO mvtest_ivm_t VALUES (1, 10), (1, 20), (2, 5), (NULL, 7);
+INSERT INTO mvtest_ivm_d VALUES (1, 'one'), (2, 'two'), (3, 'three');
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_sum AS
+  SELECT k, count(*) AS n, sum(v) AS s FROM mvtest_ivm_t GROUP BY k;
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_join AS
+  SELECT d.name, sum(t.v) AS s
+  FROM mvtest_ivm_t t JOIN mvtest_ivm_d d ON t.k = d.k
+  GROUP BY d.name HAVING sum(t.v) > 6;
+INSERT INTO mvtest_ivm_t VALUES (2, 3), (3, 8), (NULL, 1);
+UPDATE mvtest_ivm_t SET v = v + 100 WHERE k = 1 AND v = 10;
+DELETE FROM mvtest_ivm_t WHERE k = 2 AND v = 5;
+UPDATE mvtest_ivm_d SET name = 'uno' WHERE k = 1;
+SELECT * FROM mvtest_ivm_sum ORDER BY k;
+SELECT * FROM mvtest_ivm_join ORDER BY name;
+TRUNCATE mvtest_ivm_d;
+SELECT * FROM mvtest_ivm_join ORDER BY name;
+INSERT INTO mvtest_ivm_sum VALUES (9, 1, 1); -- error
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_bad AS
+  SELECT k, v FROM mvtest_ivm_t; -- error
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_bad AS
+  SELECT t.k, count(*) FROM mvtest_ivm_t t
+  LEFT JOIN mvtest_ivm_d d ON t.k = d.k GROUP BY t.k; -- error
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_bad AS
+  SELECT k, count(*) FROM mvtest_ivm_t GROUP BY k, v; -- error
+DROP MATERIALIZED VIEW mvtest_ivm_sum, mvtest_ivm_join;
+DROP TABLE mvtest_ivm_t, mvtest_ivm_d;
+-- statements changing more than one of the view's tables
+CREATE TABLE mvtest_ivm_p (id int PRIMARY KEY, grp text);
+CREATE TABLE mvtest_ivm_c (pid int REFERENCES mvtest_ivm_p
+                             ON DELETE CASCADE ON UPDATE CASCADE,
+                           v int);
+INSERT INTO mvtest_ivm_p VALUES (1, 'a'), (2, 'a'), (3, 'b');
+INSERT INTO mvtest_ivm_c VALUES (1, 10), (1, 20), (2, 5), (3, 7);
+CREATE INCREMENTAL MATERIALIZED VIEW mvtest_ivm_casc AS
+  SELECT p.grp, count(*) AS n, sum(c.v) AS s
+  FROM mvtest_ivm_p p JOIN mvtest_ivm_c c ON c.pid = p.id
+  GROUP BY p.grp;
+DELETE FROM mvtest_ivm_p WHERE id = 1;
+SELECT * FROM mvtest_ivm_casc ORDER BY grp;
+UPDATE mvtest_ivm_p SET id = 4, grp = 'c' WHERE id = 2;
+SELECT * FROM mvtest_ivm_casc ORDER BY grp;
+WITH p AS (INSERT INTO mvtest_ivm_p VALUES (5, 'd') RETURNING id)
+  INSERT INTO mvtest_ivm_c SELECT id, 1 FROM p;
+SELECT * FROM mvtest_ivm_casc ORDER BY grp;
+WITH c AS (DELETE FROM mvtest_ivm_c WHERE pid = 5)
+  DELETE FROM mvtest_ivm_p WHERE id = 5;
+SELECT * FROM mvtest_ivm_casc ORDER BY grp;
+DROP MATERIALIZED VIEW mvtest_ivm_casc;
+DROP TABLE mvtest_ivm_c, mvtest_ivm_p;
@@ -1433,3 +1433,33 @@ SELECT pg_lsn(18446744073709551615::numeric);
 SELECT pg_lsn(-1::numeric);
 SELECT pg_lsn(18446744073709551616::numeric);
 SELECT pg_lsn('NaN'::numeric);
+
+--
+-- Tests for addition, subtraction and multiplication of values that can
+-- be done in int64 arithmetic, and of values just too big for that
+--
+SELECT a, b, a + b AS sum, a - b AS diff, a * b AS prod
+  FROM (VALUES (0.123456789012345678::numeric, 0.000000000000000001::numeric),
+               (9.223372036854775807, 0.000000000000000001),
+               (-9.223372036854775807, 0.000000000000000001),
+               (-9.223372036854775808, 0.000000000000000001),
+               (0.1234567890123456789, 1),
+               (9223372036854775807, 1),
+               (-9223372036854775807, 2),
+               (-9223372036854775808, -1),
+               (4611686018427387904, 2),
+               (3037000499, 3037000499),
+               (3037000500, 3037000500),
+               (1.5, 2.25),
+               (1.5, 2.255),
+               (100, 0.001),
+               (1.10, 2.5),
+               (12345.6789, 0.00001),
+               (123456789012345678, 0.1),
+               (123456789012345678, 0.01),
+               (-0.00, 0),
+               (-0.0, 5),
+               (-1.5, 1.5),
+               (-0.01, 0),
+               (99999999999, 99999999999),
+               (0.000000000000000001, 0.000000000000000001)) AS v(a, b);
@@ -1187,3 +1187,56 @@ explain (costs off) select * from hp_contradict_test where a === 1 and b === 1 a
 drop table hp_contradict_test;
 drop operator class part_test_int4_ops2 using hash;
 drop operator ===(int4, int4);
+
+--
+-- Run-time pruning of the outer side of a hash join using the range of the
+-- inner join keys
+--
+create table hjp (a int, b int) partition by range (a);
+create table hjp1 partition of hjp for values from (0) to (100);
+create table hjp2 partition of hjp for values from (100) to (200);
+create table hjp3 partition of hjp for values from (200) to (300);
+insert into hjp select g, g % 10 from generate_series(0, 299) g;
+create table hjp_inner (a int, b int);
+insert into hjp_inner values (110, 1), (250, 2), (null, 3);
+analyze hjp, hjp_inner;
+-- The statistics of the hash table depend on the platform
+create function explain_hashjoin_prune(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            $1)
+    loop
+        continue when ln ~ 'Buckets: ';
+        return next ln;
+    end loop;
+end;
+$$;
+set enable_nestloop = off;
+set enable_mergejoin = off;
+set max_parallel_workers_per_gather = 0;
+-- Inner, semi and right joins don't need the outer rows outside the range of
+-- inner keys, [110, 250] here
+select explain_hashjoin_prune('select * from hjp join hjp_inner i on hjp.a = i.a');
+select explain_hashjoin_prune('select * from hjp where a in (select a from hjp_inner)');
+select explain_hashjoin_prune('select * from hjp right join hjp_inner i on hjp.a = i.a');
+-- Left and anti joins need all outer rows
+select explain_hashjoin_prune('select * from hjp left join hjp_inner i on hjp.a = i.a');
+select explain_hashjoin_prune('select * from hjp where not exists (select 1 from hjp_inner i where i.a = hjp.a)');
+-- An empty inner side means the outer side isn't scanned at all, and an inner
+-- side without non-null keys prunes all partitions
+select explain_hashjoin_prune('select * from hjp join hjp_inner i on hjp.a = i.a where i.b = 0');
+select explain_hashjoin_prune('select * from hjp right join hjp_inner i on hjp.a = i.a where i.b = 3');
+select * from hjp right join hjp_inner i on hjp.a = i.a where i.b = 3;
+-- A rescan rebuilding the hash table prunes the outer side again
+select explain_hashjoin_prune('select * from (values (1), (2)) v(b) cross join lateral (select hjp.a from hjp join hjp_inner i on hjp.a = i.a where i.b = v.b offset 0) s');
+select * from (values (1), (2)) v(b) cross join lateral (select hjp.a from hjp join hjp_inner i on hjp.a = i.a where i.b = v.b offset 0) s;
+reset enable_nestloop;
+reset enable_mergejoin;
+reset max_parallel_workers_per_gather;
+drop function explain_hashjoin_prune(text);
+drop table hjp, hjp_inner;
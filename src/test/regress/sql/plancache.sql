@@ -223,3 +223,17 @@ select name, generic_plans, custom_plans from pg_prepared_statements
   where  name = 'test_mode_pp';
 
 drop table test_mode;
+
+-- Test the simple query cache
+create temp table simple_cache (a int);
+insert into simple_cache values (1), (2);
+set simple_query_cache_size = 10;
+select * from simple_cache order by a;
+select * from simple_cache order by a;
+select * from simple_cache order by a;
+-- the cached statement must notice that the table changed
+alter table simple_cache add column b text default 'x';
+select * from simple_cache order by a;
+select * from simple_cache order by a;
+reset simple_query_cache_size;
+drop table simple_cache;
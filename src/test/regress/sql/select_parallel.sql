@@ -326,6 +326,31 @@ explain (costs off)
 
 select fivethous from tenk1 order by fivethous limit 4;
 
+-- test rescans of a bounded sort below gather merge, whose participants
+-- share the leading key of the last tuple they hold
+set enable_material = false;
+explain (costs off)
+select * from
+  (select fivethous, unique1 from tenk1
+   order by fivethous desc, unique1 limit 3) ss
+  right join (values (1),(2)) v(x) on true;
+select * from
+  (select fivethous, unique1 from tenk1
+   order by fivethous desc, unique1 limit 3) ss
+  right join (values (1),(2)) v(x) on true;
+select x, count(*), sum(fivethous), sum(unique1) from
+  (select fivethous, unique1 from tenk1
+   order by fivethous desc, unique1 limit 151) ss
+  right join (values (1),(2)) v(x) on true
+group by x order by x;
+-- compare with an unbounded sort
+select count(*), sum(fivethous), sum(unique1) from
+  (select fivethous, unique1,
+          row_number() over (order by fivethous desc, unique1) as rn
+   from tenk1) ss
+where rn <= 151;
+reset enable_material;
+
 -- gather merge test with 0 worker
 set max_parallel_workers = 0;
 explain (costs off)
@@ -40,6 +40,14 @@ select count(*) >= 0 as ok from pg_prepared_xacts;
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
+-- One record for each backend type, I/O object and I/O context that can
+-- have nonzero counts
+select count(*) = 34 as ok from pg_stat_io;
+
+-- Every wait event type has a histogram of the same size
+select count(*) = 0 as ok from pg_stat_wait_event_types
+  where cardinality(time_histogram) <> 20;
+
 -- We expect no walreceiver running in this test
 select count(*) = 0 as ok from pg_stat_wal_receiver;
 
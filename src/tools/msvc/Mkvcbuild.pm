@@ -104,7 +104,7 @@ sub mkvcbuild
 	  erand48.c snprintf.c strlcat.c strlcpy.c dirmod.c noblock.c path.c
 	  dirent.c dlopen.c getopt.c getopt_long.c link.c
 	  pread.c preadv.c pwrite.c pwritev.c pg_bitutils.c
-	  pg_strong_random.c pgcheckdir.c pgmkdirp.c pgsleep.c pgstrcasecmp.c
+	  pg_strong_random.c pg_tsc.c pgcheckdir.c pgmkdirp.c pgsleep.c pgstrcasecmp.c
 	  pqsignal.c mkdtemp.c qsort.c qsort_arg.c bsearch_arg.c quotes.c system.c
 	  strerror.c tar.c thread.c
 	  win32env.c win32error.c win32security.c win32setlocale.c win32stat.c);
@@ -129,7 +129,7 @@ sub mkvcbuild
 	  keywords.c kwlookup.c link-canary.c md5_common.c
 	  pg_get_line.c pg_lzcompress.c pgfnames.c psprintf.c relpath.c rmtree.c
 	  saslprep.c scram-common.c string.c stringinfo.c unicode_norm.c username.c
-	  wait_error.c wchar.c);
+	  wait_error.c wchar.c zpq_stream.c);
 
 	if ($solution->{options}->{openssl})
 	{
@@ -376,6 +376,11 @@ sub mkvcbuild
 	$pgbasebackup->AddFile('src/bin/pg_basebackup/pg_basebackup.c');
 	$pgbasebackup->AddLibrary('ws2_32.lib');
 
+	my $pgcombinebackup = AddSimpleFrontend('pg_basebackup', 1);
+	$pgcombinebackup->{name} = 'pg_combinebackup';
+	$pgcombinebackup->AddFile('src/bin/pg_basebackup/pg_combinebackup.c');
+	$pgcombinebackup->AddLibrary('ws2_32.lib');
+
 	my $pgreceivewal = AddSimpleFrontend('pg_basebackup', 1);
 	$pgreceivewal->{name} = 'pg_receivewal';
 	$pgreceivewal->AddFile('src/bin/pg_basebackup/pg_receivewal.c');